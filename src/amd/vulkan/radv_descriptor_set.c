@@ -468,6 +468,20 @@ void radv_DestroyPipelineLayout(
 
 #define EMPTY 1
 
+static void
+radv_descriptor_set_free(struct radv_device *device,
+			 struct radv_descriptor_pool *pool,
+			 struct radv_descriptor_set *set)
+{
+	/* The pool memory is reclaimed at reset. */
+	if ((uint8_t*)set >= pool->set_memory_base &&
+	    (uint8_t*)set < pool->set_memory_end)
+		return;
+
+	vk_free2(&device->alloc, NULL, set);
+	pool->allocated_set_count--;
+}
+
 static VkResult
 radv_descriptor_set_create(struct radv_device *device,
 			   struct radv_descriptor_pool *pool,
@@ -487,12 +501,16 @@ radv_descriptor_set_create(struct radv_device *device,
 
 		set = (struct radv_descriptor_set*)pool->host_memory_ptr;
 		pool->host_memory_ptr += mem_size;
+	} else if (pool->set_memory_end - pool->set_memory_ptr >= mem_size) {
+		set = (struct radv_descriptor_set*)pool->set_memory_ptr;
+		pool->set_memory_ptr += mem_size;
 	} else {
 		set = vk_alloc2(&device->alloc, NULL, mem_size, 8,
 		                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
 
 		if (!set)
 			return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+		pool->allocated_set_count++;
 	}
 
 	memset(set, 0, mem_size);
@@ -507,7 +525,7 @@ radv_descriptor_set_create(struct radv_device *device,
 		set->size = layout_size;
 
 		if (!pool->host_memory_base && pool->entry_count == pool->max_entry_count) {
-			vk_free2(&device->alloc, NULL, set);
+			radv_descriptor_set_free(device, pool, set);
 			return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
 		}
 
@@ -536,7 +554,7 @@ radv_descriptor_set_create(struct radv_device *device,
 			}
 
 			if (pool->size - offset < layout_size) {
-				vk_free2(&device->alloc, NULL, set);
+				radv_descriptor_set_free(device, pool, set);
 				return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
 			}
 			set->bo = pool->bo;
@@ -593,7 +611,7 @@ radv_descriptor_set_destroy(struct radv_device *device,
 			}
 		}
 	}
-	vk_free2(&device->alloc, NULL, set);
+	radv_descriptor_set_free(device, pool, set);
 }
 
 VkResult radv_CreateDescriptorPool(
@@ -657,14 +675,13 @@ VkResult radv_CreateDescriptorPool(
 		}
 	}
 
-	if (!(pCreateInfo->flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)) {
-		uint64_t host_size = pCreateInfo->maxSets * sizeof(struct radv_descriptor_set);
-		host_size += sizeof(struct radeon_winsys_bo*) * bo_count;
-		host_size += sizeof(struct radv_descriptor_range) * range_count;
-		size += host_size;
-	} else {
+	uint64_t host_size = pCreateInfo->maxSets * sizeof(struct radv_descriptor_set);
+	host_size += sizeof(struct radeon_winsys_bo*) * bo_count;
+	host_size += sizeof(struct radv_descriptor_range) * range_count;
+	size += host_size;
+
+	if (pCreateInfo->flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
 		size += sizeof(struct radv_descriptor_pool_entry) * pCreateInfo->maxSets;
-	}
 
 	pool = vk_alloc2(&device->alloc, pAllocator, size, 8,
 	                 VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
@@ -677,6 +694,14 @@ VkResult radv_CreateDescriptorPool(
 		pool->host_memory_base = (uint8_t*)pool + sizeof(struct radv_descriptor_pool);
 		pool->host_memory_ptr = pool->host_memory_base;
 		pool->host_memory_end = (uint8_t*)pool + size;
+	} else {
+		/* Sets that are freed don't give their memory back until the
+		 * pool is reset, the sets allocated after use the heap once
+		 * it's exhausted.
+		 */
+		pool->set_memory_base = (uint8_t*)(pool->entries + pCreateInfo->maxSets);
+		pool->set_memory_ptr = pool->set_memory_base;
+		pool->set_memory_end = (uint8_t*)pool + size;
 	}
 
 	if (bo_size) {
@@ -726,14 +751,17 @@ VkResult radv_ResetDescriptorPool(
 	RADV_FROM_HANDLE(radv_descriptor_pool, pool, descriptorPool);
 
 	if (!pool->host_memory_base) {
-		for(int i = 0; i < pool->entry_count; ++i) {
+		/* Nothing to free if all the sets are in the pool memory. */
+		for(int i = 0; pool->allocated_set_count && i < pool->entry_count; ++i) {
 			radv_descriptor_set_destroy(device, pool, pool->entries[i].set, false);
 		}
 		pool->entry_count = 0;
+		pool->allocated_set_count = 0;
 	}
 
 	pool->current_offset = 0;
 	pool->host_memory_ptr = pool->host_memory_base;
+	pool->set_memory_ptr = pool->set_memory_base;
 
 	return VK_SUCCESS;
 }
@@ -1096,6 +1124,63 @@ void radv_UpdateDescriptorSets(
 			            descriptorCopyCount, pDescriptorCopies);
 }
 
+/**
+ * Append \p b to \p a if it updates the descriptors that follow the ones
+ * of \p a with the data that follows theirs, which is common when the
+ * entries are for consecutive bindings of the same type, so that the update
+ * is one loop.
+ */
+static bool
+radv_merge_update_template_entries(struct radv_descriptor_update_template_entry *a,
+                                   const struct radv_descriptor_update_template_entry *b)
+{
+	size_t src_stride;
+
+	if (b->src_offset < a->src_offset)
+		return false;
+
+	/* The stride doesn't matter for a single descriptor. */
+	src_stride = a->descriptor_count == 1 ? b->src_offset - a->src_offset : a->src_stride;
+
+	if (a->descriptor_type != b->descriptor_type ||
+	    a->descriptor_type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT ||
+	    a->has_sampler != b->has_sampler ||
+	    a->sampler_offset != b->sampler_offset ||
+	    a->dst_stride != b->dst_stride)
+		return false;
+
+	if (b->src_offset != a->src_offset + a->descriptor_count * src_stride ||
+	    (b->descriptor_count > 1 && b->src_stride != src_stride))
+		return false;
+
+	switch (a->descriptor_type) {
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		if (b->dst_offset != a->dst_offset + a->descriptor_count)
+			return false;
+		break;
+	default:
+		if (b->dst_offset != a->dst_offset + a->descriptor_count * a->dst_stride)
+			return false;
+		break;
+	}
+
+	/* Samplers have no buffers. */
+	if (a->descriptor_type != VK_DESCRIPTOR_TYPE_SAMPLER &&
+	    b->buffer_offset != a->buffer_offset + a->descriptor_count)
+		return false;
+
+	if (a->immutable_samplers || b->immutable_samplers) {
+		if (!a->immutable_samplers ||
+		    b->immutable_samplers != a->immutable_samplers + 4 * a->descriptor_count)
+			return false;
+	}
+
+	a->descriptor_count += b->descriptor_count;
+	a->src_stride = src_stride;
+	return true;
+}
+
 VkResult radv_CreateDescriptorUpdateTemplate(VkDevice _device,
                                              const VkDescriptorUpdateTemplateCreateInfo *pCreateInfo,
                                              const VkAllocationCallbacks *pAllocator,
@@ -1113,7 +1198,7 @@ VkResult radv_CreateDescriptorUpdateTemplate(VkDevice _device,
 	if (!templ)
 		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
 
-	templ->entry_count = entry_count;
+	templ->entry_count = 0;
 	templ->bind_point = pCreateInfo->pipelineBindPoint;
 
 	for (i = 0; i < entry_count; i++) {
@@ -1157,7 +1242,7 @@ VkResult radv_CreateDescriptorUpdateTemplate(VkDevice _device,
 			break;
 		}
 
-		templ->entry[i] = (struct radv_descriptor_update_template_entry) {
+		struct radv_descriptor_update_template_entry templ_entry = {
 			.descriptor_type = entry->descriptorType,
 			.descriptor_count = entry->descriptorCount,
 			.src_offset = entry->offset,
@@ -1169,6 +1254,16 @@ VkResult radv_CreateDescriptorUpdateTemplate(VkDevice _device,
 			.sampler_offset = radv_combined_image_descriptor_sampler_offset(binding_layout),
 			.immutable_samplers = immutable_samplers
 		};
+
+		if (!templ_entry.descriptor_count)
+			continue;
+
+		if (templ->entry_count &&
+		    radv_merge_update_template_entries(&templ->entry[templ->entry_count - 1],
+		                                       &templ_entry))
+			continue;
+
+		templ->entry[templ->entry_count++] = templ_entry;
 	}
 
 	*pDescriptorUpdateTemplate = radv_descriptor_update_template_to_handle(templ);
@@ -1198,66 +1293,77 @@ void radv_update_descriptor_set_with_template(struct radv_device *device,
 	uint32_t i;
 
 	for (i = 0; i < templ->entry_count; ++i) {
-		struct radeon_winsys_bo **buffer_list = set->descriptors + templ->entry[i].buffer_offset;
-		uint32_t *pDst = set->mapped_ptr + templ->entry[i].dst_offset;
-		const uint8_t *pSrc = ((const uint8_t *) pData) + templ->entry[i].src_offset;
+		const struct radv_descriptor_update_template_entry *entry = &templ->entry[i];
+		struct radeon_winsys_bo **buffer_list = set->descriptors + entry->buffer_offset;
+		uint32_t *pDst = set->mapped_ptr + entry->dst_offset;
+		const uint8_t *pSrc = ((const uint8_t *) pData) + entry->src_offset;
+		const uint32_t count = entry->descriptor_count;
+		const size_t src_stride = entry->src_stride;
+		const uint32_t dst_stride = entry->dst_stride;
 		uint32_t j;
 
-		if (templ->entry[i].descriptor_type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT) {
-			memcpy((uint8_t*)pDst, pSrc, templ->entry[i].descriptor_count);
-			continue;
-		}
-
-		for (j = 0; j < templ->entry[i].descriptor_count; ++j) {
-			switch (templ->entry[i].descriptor_type) {
-			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
-			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC: {
-				const unsigned idx = templ->entry[i].dst_offset + j;
-				assert(!(set->layout->flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR));
-				write_dynamic_buffer_descriptor(device, set->dynamic_descriptors + idx,
-								buffer_list, (struct VkDescriptorBufferInfo *) pSrc);
-				break;
+		/* The type is the same for all the descriptors of an entry,
+		 * only loop in the cases.
+		 */
+		switch (entry->descriptor_type) {
+		case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT:
+			memcpy((uint8_t*)pDst, pSrc, count);
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			assert(!(set->layout->flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR));
+			for (j = 0; j < count; ++j, pSrc += src_stride) {
+				write_dynamic_buffer_descriptor(device, set->dynamic_descriptors + entry->dst_offset + j,
+								buffer_list + j, (struct VkDescriptorBufferInfo *) pSrc);
 			}
-			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-				write_buffer_descriptor(device, cmd_buffer, pDst, buffer_list,
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			for (j = 0; j < count; ++j, pSrc += src_stride, pDst += dst_stride) {
+				write_buffer_descriptor(device, cmd_buffer, pDst, buffer_list + j,
 				                        (struct VkDescriptorBufferInfo *) pSrc);
-				break;
-			case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-			case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-				write_texel_buffer_descriptor(device, cmd_buffer, pDst, buffer_list,
+			}
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			for (j = 0; j < count; ++j, pSrc += src_stride, pDst += dst_stride) {
+				write_texel_buffer_descriptor(device, cmd_buffer, pDst, buffer_list + j,
 						              *(VkBufferView *) pSrc);
-				break;
-			case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-			case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-				write_image_descriptor(device, cmd_buffer, 64, pDst, buffer_list,
-						       templ->entry[i].descriptor_type,
+			}
+			break;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			for (j = 0; j < count; ++j, pSrc += src_stride, pDst += dst_stride) {
+				write_image_descriptor(device, cmd_buffer, 64, pDst, buffer_list + j,
+						       entry->descriptor_type,
 					               (struct VkDescriptorImageInfo *) pSrc);
-				break;
-			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-				write_combined_image_sampler_descriptor(device, cmd_buffer, templ->entry[i].sampler_offset,
-									pDst, buffer_list, templ->entry[i].descriptor_type,
+			}
+			break;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			for (j = 0; j < count; ++j, pSrc += src_stride, pDst += dst_stride) {
+				write_combined_image_sampler_descriptor(device, cmd_buffer, entry->sampler_offset,
+									pDst, buffer_list + j, entry->descriptor_type,
 									(struct VkDescriptorImageInfo *) pSrc,
-									templ->entry[i].has_sampler);
-				if (templ->entry[i].immutable_samplers) {
-					memcpy((char*)pDst + templ->entry[i].sampler_offset, templ->entry[i].immutable_samplers + 4 * j, 16);
+									entry->has_sampler);
+				if (entry->immutable_samplers) {
+					memcpy((char*)pDst + entry->sampler_offset, entry->immutable_samplers + 4 * j, 16);
 				}
-				break;
-			case VK_DESCRIPTOR_TYPE_SAMPLER:
-				if (templ->entry[i].has_sampler)
+			}
+			break;
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+			if (entry->has_sampler) {
+				for (j = 0; j < count; ++j, pSrc += src_stride, pDst += dst_stride)
 					write_sampler_descriptor(device, pDst,
 					                         (struct VkDescriptorImageInfo *) pSrc);
-				else if (templ->entry[i].immutable_samplers)
-					memcpy(pDst, templ->entry[i].immutable_samplers + 4 * j, 16);
-				break;
-			default:
-				unreachable("unimplemented descriptor type");
-				break;
+			} else if (entry->immutable_samplers) {
+				for (j = 0; j < count; ++j, pDst += dst_stride)
+					memcpy(pDst, entry->immutable_samplers + 4 * j, 16);
 			}
-		        pSrc += templ->entry[i].src_stride;
-			pDst += templ->entry[i].dst_stride;
-			++buffer_list;
+			break;
+		default:
+			unreachable("unimplemented descriptor type");
+			break;
 		}
 	}
 }
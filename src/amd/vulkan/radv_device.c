@@ -47,6 +47,7 @@
 #include "gfx9d.h"
 #include "util/build_id.h"
 #include "util/debug.h"
+#include "util/u_cpu_detect.h"
 #include "util/mesa-sha1.h"
 #include "compiler/glsl_types.h"
 #include "util/xmlpool.h"
@@ -438,6 +439,15 @@ static const VkAllocationCallbacks default_alloc = {
 	.pfnFree = default_free_func,
 };
 
+/* Whether the allocation callbacks are the driver's own, which can be called
+ * from any thread.
+ */
+bool
+radv_is_default_allocator(const VkAllocationCallbacks *alloc)
+{
+	return alloc->pfnAllocation == default_alloc_func;
+}
+
 static const struct debug_control radv_debug_options[] = {
 	{"nofastclears", RADV_DEBUG_NO_FAST_CLEARS},
 	{"nodcc", RADV_DEBUG_NO_DCC},
@@ -463,6 +473,7 @@ static const struct debug_control radv_debug_options[] = {
 	{"checkir", RADV_DEBUG_CHECKIR},
 	{"nothreadllvm", RADV_DEBUG_NOTHREADLLVM},
 	{"nobinning", RADV_DEBUG_NOBINNING},
+	{"nopipelinethreads", RADV_DEBUG_NO_PIPELINE_THREADS},
 	{NULL, 0}
 };
 
@@ -781,6 +792,10 @@ void radv_GetPhysicalDeviceFeatures(
 		.shaderInt64                              = true,
 		.shaderInt16                              = pdevice->rad_info.chip_class >= GFX9,
 		.sparseBinding                            = true,
+		.sparseResidencyBuffer                    = pdevice->rad_info.has_sparse_vm_mappings &&
+		                                            pdevice->rad_info.family >= CHIP_POLARIS10,
+		.sparseResidencyAliased                   = pdevice->rad_info.has_sparse_vm_mappings &&
+		                                            pdevice->rad_info.family >= CHIP_POLARIS10,
 		.variableMultisampleRate                  = true,
 		.inheritedQueries                         = true,
 	};
@@ -1106,7 +1121,11 @@ void radv_GetPhysicalDeviceProperties(
 		.deviceID = pdevice->rad_info.pci_id,
 		.deviceType = pdevice->rad_info.has_dedicated_vram ? VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU : VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU,
 		.limits = limits,
-		.sparseProperties = {0},
+		.sparseProperties = {
+			/* Reads of PRT pages return 0 since Polaris. */
+			.residencyNonResidentStrict = pdevice->rad_info.has_sparse_vm_mappings &&
+			                              pdevice->rad_info.family >= CHIP_POLARIS10,
+		},
 	};
 
 	strcpy(pProperties->deviceName, pdevice->name);
@@ -1801,6 +1820,8 @@ VkResult radv_CreateDevice(
 	mtx_init(&device->shader_slab_mutex, mtx_plain);
 	list_inithead(&device->shader_slabs);
 
+	radv_nir_cache_init(device);
+
 	radv_bo_list_init(&device->bo_list);
 
 	for (unsigned i = 0; i < pCreateInfo->queueCreateInfoCount; i++) {
@@ -1933,6 +1954,18 @@ VkResult radv_CreateDevice(
 
 	device->mem_cache = radv_pipeline_cache_from_handle(pc);
 
+	if (!(device->instance->debug_flags & RADV_DEBUG_NO_PIPELINE_THREADS)) {
+		util_cpu_detect();
+
+		/* If this fails, pipelines are just compiled on the calling
+		 * thread.
+		 */
+		if (util_cpu_caps.nr_cpus > 1)
+			util_queue_init(&device->pipeline_queue, "radv_pipeline",
+					64, MIN2(util_cpu_caps.nr_cpus, 16),
+					UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+	}
+
 	device->force_aniso =
 		MIN2(16, radv_get_int_debug_option("RADV_TEX_ANISO", -1));
 	if (device->force_aniso >= 0) {
@@ -1948,6 +1981,9 @@ fail_meta:
 fail:
 	radv_bo_list_finish(&device->bo_list);
 
+	if (device->nir_cache)
+		radv_nir_cache_finish(device);
+
 	if (device->trace_bo)
 		device->ws->buffer_destroy(device->trace_bo);
 
@@ -1990,10 +2026,14 @@ void radv_DestroyDevice(
 	}
 	radv_device_finish_meta(device);
 
+	if (util_queue_is_initialized(&device->pipeline_queue))
+		util_queue_destroy(&device->pipeline_queue);
+
 	VkPipelineCache pc = radv_pipeline_cache_to_handle(device->mem_cache);
 	radv_DestroyPipelineCache(radv_device_to_handle(device), pc, NULL);
 
 	radv_destroy_shader_slabs(device);
+	radv_nir_cache_finish(device);
 
 	radv_bo_list_finish(&device->bo_list);
 	vk_free(&device->alloc, device);
@@ -2932,25 +2972,37 @@ VkResult radv_QueueSubmit(
 	if (result != VK_SUCCESS)
 		return result;
 
-	for (uint32_t i = 0; i < submitCount; i++) {
+	for (uint32_t i = 0, next; i < submitCount; i = next) {
 		struct radeon_cmdbuf **cs_array;
 		bool do_flush = !i || pSubmits[i].pWaitDstStageMask;
 		bool can_patch = true;
 		uint32_t advance;
+		uint32_t cs_count = pSubmits[i].commandBufferCount;
 		struct radv_winsys_sem_info sem_info;
 
+		/* Merge the following submits into this one as long as no
+		 * semaphore has to be signaled or waited on in between, so
+		 * that they go to the kernel in as few CS ioctls as possible.
+		 */
+		for (next = i + 1; next < submitCount; next++) {
+			if (pSubmits[next - 1].signalSemaphoreCount ||
+			    pSubmits[next].waitSemaphoreCount)
+				break;
+			cs_count += pSubmits[next].commandBufferCount;
+		}
+
 		result = radv_alloc_sem_info(queue->device->instance,
 					     &sem_info,
 					     pSubmits[i].waitSemaphoreCount,
 					     pSubmits[i].pWaitSemaphores,
-					     pSubmits[i].signalSemaphoreCount,
-					     pSubmits[i].pSignalSemaphores,
+					     pSubmits[next - 1].signalSemaphoreCount,
+					     pSubmits[next - 1].pSignalSemaphores,
 					     _fence);
 		if (result != VK_SUCCESS)
 			return result;
 
-		if (!pSubmits[i].commandBufferCount) {
-			if (pSubmits[i].waitSemaphoreCount || pSubmits[i].signalSemaphoreCount) {
+		if (!cs_count) {
+			if (pSubmits[i].waitSemaphoreCount || pSubmits[next - 1].signalSemaphoreCount) {
 				ret = queue->device->ws->cs_submit(ctx, queue->queue_idx,
 								   &queue->device->empty_cs[queue->queue_family_index],
 								   1, NULL, NULL,
@@ -2962,37 +3014,45 @@ VkResult radv_QueueSubmit(
 				}
 				fence_emitted = true;
 			}
+			radv_free_temp_syncobjs(queue->device,
+						pSubmits[i].waitSemaphoreCount,
+						pSubmits[i].pWaitSemaphores);
 			radv_free_sem_info(&sem_info);
 			continue;
 		}
 
-		cs_array = malloc(sizeof(struct radeon_cmdbuf *) *
-					        (pSubmits[i].commandBufferCount));
+		cs_array = malloc(sizeof(struct radeon_cmdbuf *) * cs_count);
+		if (!cs_array) {
+			radv_free_sem_info(&sem_info);
+			return vk_error(queue->device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+		}
 
-		for (uint32_t j = 0; j < pSubmits[i].commandBufferCount; j++) {
-			RADV_FROM_HANDLE(radv_cmd_buffer, cmd_buffer,
-					 pSubmits[i].pCommandBuffers[j]);
-			assert(cmd_buffer->level == VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		cs_count = 0;
+		for (uint32_t k = i; k < next; k++) {
+			for (uint32_t j = 0; j < pSubmits[k].commandBufferCount; j++) {
+				RADV_FROM_HANDLE(radv_cmd_buffer, cmd_buffer,
+						 pSubmits[k].pCommandBuffers[j]);
+				assert(cmd_buffer->level == VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
-			cs_array[j] = cmd_buffer->cs;
-			if ((cmd_buffer->usage_flags & VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT))
-				can_patch = false;
+				cs_array[cs_count++] = cmd_buffer->cs;
+				if ((cmd_buffer->usage_flags & VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT))
+					can_patch = false;
 
-			cmd_buffer->status = RADV_CMD_BUFFER_STATUS_PENDING;
+				cmd_buffer->status = RADV_CMD_BUFFER_STATUS_PENDING;
+			}
 		}
 
-		for (uint32_t j = 0; j < pSubmits[i].commandBufferCount; j += advance) {
+		for (uint32_t j = 0; j < cs_count; j += advance) {
 			struct radeon_cmdbuf *initial_preamble = (do_flush && !j) ? initial_flush_preamble_cs : initial_preamble_cs;
 			const struct radv_winsys_bo_list *bo_list = NULL;
 
-			advance = MIN2(max_cs_submission,
-				       pSubmits[i].commandBufferCount - j);
+			advance = MIN2(max_cs_submission, cs_count - j);
 
 			if (queue->device->trace_bo)
 				*queue->device->trace_id_ptr = 0;
 
 			sem_info.cs_emit_wait = j == 0;
-			sem_info.cs_emit_signal = j + advance == pSubmits[i].commandBufferCount;
+			sem_info.cs_emit_signal = j + advance == cs_count;
 
 			if (unlikely(queue->device->use_global_bo_list)) {
 				pthread_mutex_lock(&queue->device->bo_list.mutex);
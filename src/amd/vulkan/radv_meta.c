@@ -51,17 +51,19 @@ radv_meta_save(struct radv_meta_saved_state *state,
 
 		state->old_pipeline = cmd_buffer->state.pipeline;
 
-		/* Save all viewports. */
+		/* Save the viewports and scissors in use. Meta operations only
+		 * set the first ones, which can also be set before binding a
+		 * pipeline.
+		 */
 		state->viewport.count = cmd_buffer->state.dynamic.viewport.count;
 		typed_memcpy(state->viewport.viewports,
 			     cmd_buffer->state.dynamic.viewport.viewports,
-			     MAX_VIEWPORTS);
+			     MAX2(state->viewport.count, 1));
 
-		/* Save all scissors. */
 		state->scissor.count = cmd_buffer->state.dynamic.scissor.count;
 		typed_memcpy(state->scissor.scissors,
 			     cmd_buffer->state.dynamic.scissor.scissors,
-			     MAX_SCISSORS);
+			     MAX2(state->scissor.count, 1));
 
 		/* The most common meta operations all want to have the
 		 * viewport reset and any scissors disabled. The rest of the
@@ -115,17 +117,16 @@ radv_meta_restore(const struct radv_meta_saved_state *state,
 
 		cmd_buffer->state.dirty |= RADV_CMD_DIRTY_PIPELINE;
 
-		/* Restore all viewports. */
+		/* Restore the viewports and scissors in use. */
 		cmd_buffer->state.dynamic.viewport.count = state->viewport.count;
 		typed_memcpy(cmd_buffer->state.dynamic.viewport.viewports,
 			     state->viewport.viewports,
-			     MAX_VIEWPORTS);
+			     MAX2(state->viewport.count, 1));
 
-		/* Restore all scissors. */
 		cmd_buffer->state.dynamic.scissor.count = state->scissor.count;
 		typed_memcpy(cmd_buffer->state.dynamic.scissor.scissors,
 			     state->scissor.scissors,
-			     MAX_SCISSORS);
+			     MAX2(state->scissor.count, 1));
 
 		cmd_buffer->state.dirty |= 1 << VK_DYNAMIC_STATE_VIEWPORT |
 					   1 << VK_DYNAMIC_STATE_SCISSOR;
@@ -581,6 +581,13 @@ radv_emit_color_decompress(struct radv_cmd_buffer *cmd_buffer,
 
 	assert(cmd_buffer->queue_family_index == RADV_QUEUE_GENERAL);
 
+	/* Nothing to decompress, e.g. when resolving an image without
+	 * metadata.
+	 */
+	if (!radv_image_has_cmask(image) && !radv_image_has_fmask(image) &&
+	    !radv_image_has_dcc(image))
+		return;
+
 	if (!cmd_buffer->device->meta_state.fast_clear_flush.cmask_eliminate_pipeline) {
 		VkResult ret = radv_device_init_meta_fast_clear_flush_state_internal(cmd_buffer->device);
 		if (ret != VK_SUCCESS) {
@@ -2132,6 +2132,18 @@ void radv_create_shaders(struct radv_pipeline *pipeline,
 	if (radv_create_shader_variants_from_pipeline_cache(device, cache, hash, pipeline->shaders,
 	                                                    &found_in_application_cache) &&
 	    (!modules[MESA_SHADER_GEOMETRY] || pipeline->gs_copy_shader)) {
+		/* No stage was compiled, report where they all came from.
+		 * Hits in the device memory or disk caches are valid without
+		 * the cache hit bit, which is for the application cache only.
+		 */
+		for (unsigned i = 0; i < MESA_SHADER_STAGES; ++i) {
+			if (!modules[i])
+				continue;
+
+			radv_start_feedback(stage_feedbacks[i]);
+			radv_stop_feedback(stage_feedbacks[i], found_in_application_cache);
+		}
+
 		radv_stop_feedback(pipeline_feedback, found_in_application_cache);
 		return;
 	}
@@ -3821,6 +3833,128 @@ radv_graphics_pipeline_create(
 	return VK_SUCCESS;
 }
 
+struct radv_pipeline_job {
+	struct radv_device *device;
+	struct radv_pipeline_cache *cache;
+	struct radv_pipeline *pipeline;
+	const VkGraphicsPipelineCreateInfo *graphics_info;
+	const VkComputePipelineCreateInfo *compute_info;
+	VkResult result;
+	struct util_queue_fence fence;
+};
+
+static VkResult
+radv_compute_pipeline_init(struct radv_pipeline *pipeline,
+			   struct radv_device *device,
+			   struct radv_pipeline_cache *cache,
+			   const VkComputePipelineCreateInfo *pCreateInfo);
+
+static void
+radv_pipeline_job_execute(void *data, int thread_index)
+{
+	struct radv_pipeline_job *job = data;
+
+	if (job->graphics_info)
+		job->result = radv_pipeline_init(job->pipeline, job->device,
+						 job->cache, job->graphics_info,
+						 NULL);
+	else
+		job->result = radv_compute_pipeline_init(job->pipeline,
+							 job->device, job->cache,
+							 job->compute_info);
+}
+
+static bool
+radv_can_create_pipelines_in_parallel(struct radv_device *device,
+				      struct radv_pipeline_cache *cache,
+				      uint32_t count)
+{
+	if (count < 2 || !util_queue_is_initialized(&device->pipeline_queue))
+		return false;
+
+	/* Allocation callbacks must only be called from the thread of the API
+	 * command, but the pipeline cache allocates its entries while
+	 * compiling.
+	 */
+	if (!cache)
+		cache = device->mem_cache;
+	return radv_is_default_allocator(&cache->alloc);
+}
+
+/* Compile the pipelines of a batch on the pipeline queue and the calling
+ * thread. The pipelines are allocated and destroyed on the calling thread,
+ * so pAllocator is only called from it.
+ *
+ * radv doesn't use base pipelines, so derivatives don't have to wait for
+ * their parent.
+ */
+static VkResult
+radv_create_pipelines_in_parallel(struct radv_device *device,
+				  struct radv_pipeline_cache *cache,
+				  uint32_t count,
+				  const VkGraphicsPipelineCreateInfo *graphics_infos,
+				  const VkComputePipelineCreateInfo *compute_infos,
+				  const VkAllocationCallbacks *pAllocator,
+				  VkPipeline *pPipelines)
+{
+	struct radv_pipeline_job *jobs;
+	VkResult result = VK_SUCCESS;
+
+	jobs = calloc(count, sizeof(*jobs));
+	if (!jobs) {
+		for (uint32_t i = 0; i < count; i++)
+			pPipelines[i] = VK_NULL_HANDLE;
+		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct radv_pipeline_job *job = &jobs[i];
+
+		job->device = device;
+		job->cache = cache;
+		job->graphics_info = graphics_infos ? &graphics_infos[i] : NULL;
+		job->compute_info = compute_infos ? &compute_infos[i] : NULL;
+		util_queue_fence_init(&job->fence);
+
+		job->pipeline = vk_zalloc2(&device->alloc, pAllocator,
+					   sizeof(*job->pipeline), 8,
+					   VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+		if (!job->pipeline) {
+			job->result = vk_error(device->instance,
+					       VK_ERROR_OUT_OF_HOST_MEMORY);
+			continue;
+		}
+
+		/* The calling thread compiles the last pipeline itself. */
+		if (i == count - 1)
+			radv_pipeline_job_execute(job, 0);
+		else
+			util_queue_add_job(&device->pipeline_queue, job,
+					   &job->fence, radv_pipeline_job_execute,
+					   NULL);
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct radv_pipeline_job *job = &jobs[i];
+
+		util_queue_fence_wait(&job->fence);
+		util_queue_fence_destroy(&job->fence);
+
+		if (job->result != VK_SUCCESS) {
+			if (job->pipeline)
+				radv_pipeline_destroy(device, job->pipeline,
+						      pAllocator);
+			result = job->result;
+			pPipelines[i] = VK_NULL_HANDLE;
+		} else {
+			pPipelines[i] = radv_pipeline_to_handle(job->pipeline);
+		}
+	}
+
+	free(jobs);
+	return result;
+}
+
 VkResult radv_CreateGraphicsPipelines(
 	VkDevice                                    _device,
 	VkPipelineCache                             pipelineCache,
@@ -3829,9 +3963,16 @@ VkResult radv_CreateGraphicsPipelines(
 	const VkAllocationCallbacks*                pAllocator,
 	VkPipeline*                                 pPipelines)
 {
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	RADV_FROM_HANDLE(radv_pipeline_cache, cache, pipelineCache);
 	VkResult result = VK_SUCCESS;
 	unsigned i = 0;
 
+	if (radv_can_create_pipelines_in_parallel(device, cache, count))
+		return radv_create_pipelines_in_parallel(device, cache, count,
+							 pCreateInfos, NULL,
+							 pAllocator, pPipelines);
+
 	for (; i < count; i++) {
 		VkResult r;
 		r = radv_graphics_pipeline_create(_device,
@@ -3910,25 +4051,16 @@ radv_compute_generate_pm4(struct radv_pipeline *pipeline)
 	assert(pipeline->cs.cdw <= pipeline->cs.max_dw);
 }
 
-static VkResult radv_compute_pipeline_create(
-	VkDevice                                    _device,
-	VkPipelineCache                             _cache,
-	const VkComputePipelineCreateInfo*          pCreateInfo,
-	const VkAllocationCallbacks*                pAllocator,
-	VkPipeline*                                 pPipeline)
+static VkResult
+radv_compute_pipeline_init(struct radv_pipeline *pipeline,
+			   struct radv_device *device,
+			   struct radv_pipeline_cache *cache,
+			   const VkComputePipelineCreateInfo *pCreateInfo)
 {
-	RADV_FROM_HANDLE(radv_device, device, _device);
-	RADV_FROM_HANDLE(radv_pipeline_cache, cache, _cache);
 	const VkPipelineShaderStageCreateInfo *pStages[MESA_SHADER_STAGES] = { 0, };
 	VkPipelineCreationFeedbackEXT *stage_feedbacks[MESA_SHADER_STAGES] = { 0 };
-	struct radv_pipeline *pipeline;
 	VkResult result;
 
-	pipeline = vk_zalloc2(&device->alloc, pAllocator, sizeof(*pipeline), 8,
-			      VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
-	if (pipeline == NULL)
-		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
-
 	pipeline->device = device;
 	pipeline->layout = radv_pipeline_layout_from_handle(pCreateInfo->layout);
 	assert(pipeline->layout);
@@ -3947,13 +4079,36 @@ static VkResult radv_compute_pipeline_create(
 	pipeline->user_data_0[MESA_SHADER_COMPUTE] = radv_pipeline_stage_to_user_data_0(pipeline, MESA_SHADER_COMPUTE, device->physical_device->rad_info.chip_class);
 	pipeline->need_indirect_descriptor_sets |= pipeline->shaders[MESA_SHADER_COMPUTE]->info.need_indirect_descriptor_sets;
 	result = radv_pipeline_scratch_init(device, pipeline);
+	if (result != VK_SUCCESS)
+		return result;
+
+	radv_compute_generate_pm4(pipeline);
+	return VK_SUCCESS;
+}
+
+static VkResult radv_compute_pipeline_create(
+	VkDevice                                    _device,
+	VkPipelineCache                             _cache,
+	const VkComputePipelineCreateInfo*          pCreateInfo,
+	const VkAllocationCallbacks*                pAllocator,
+	VkPipeline*                                 pPipeline)
+{
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	RADV_FROM_HANDLE(radv_pipeline_cache, cache, _cache);
+	struct radv_pipeline *pipeline;
+	VkResult result;
+
+	pipeline = vk_zalloc2(&device->alloc, pAllocator, sizeof(*pipeline), 8,
+			      VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+	if (pipeline == NULL)
+		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+
+	result = radv_compute_pipeline_init(pipeline, device, cache, pCreateInfo);
 	if (result != VK_SUCCESS) {
 		radv_pipeline_destroy(device, pipeline, pAllocator);
 		return result;
 	}
 
-	radv_compute_generate_pm4(pipeline);
-
 	*pPipeline = radv_pipeline_to_handle(pipeline);
 
 	return VK_SUCCESS;
@@ -3967,8 +4122,15 @@ VkResult radv_CreateComputePipelines(
 	const VkAllocationCallbacks*                pAllocator,
 	VkPipeline*                                 pPipelines)
 {
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	RADV_FROM_HANDLE(radv_pipeline_cache, cache, pipelineCache);
 	VkResult result = VK_SUCCESS;
 
+	if (radv_can_create_pipelines_in_parallel(device, cache, count))
+		return radv_create_pipelines_in_parallel(device, cache, count,
+							 NULL, pCreateInfos,
+							 pAllocator, pPipelines);
+
 	unsigned i = 0;
 	for (; i < count; i++) {
 		VkResult r;
@@ -57,6 +57,7 @@ radv_pipeline_cache_init(struct radv_pipeline_cache *cache,
 	cache->modified = false;
 	cache->kernel_count = 0;
 	cache->total_size = 0;
+	cache->num_old_tables = 0;
 	cache->table_size = 1024;
 	const size_t byte_size = cache->table_size * sizeof(cache->hash_table[0]);
 	cache->hash_table = malloc(byte_size);
@@ -86,6 +87,8 @@ radv_pipeline_cache_finish(struct radv_pipeline_cache *cache)
 		}
 	pthread_mutex_destroy(&cache->mutex);
 	free(cache->hash_table);
+	for (unsigned i = 0; i < cache->num_old_tables; i++)
+		free(cache->old_tables[i]);
 }
 
 static uint32_t
@@ -132,19 +135,26 @@ radv_hash_shaders(unsigned char *hash,
 }
 
 
+/* Lookups don't need the mutex: entries are only published once they are
+ * complete, a new table is published before its size, and tables replaced
+ * by radv_pipeline_cache_grow are kept until the cache is destroyed.
+ * Seeing a new table with the old size can only make a lookup miss.
+ */
 static struct cache_entry *
-radv_pipeline_cache_search_unlocked(struct radv_pipeline_cache *cache,
-				    const unsigned char *sha1)
+radv_pipeline_cache_search(struct radv_pipeline_cache *cache,
+			   const unsigned char *sha1)
 {
-	const uint32_t mask = cache->table_size - 1;
+	const uint32_t table_size = p_atomic_read(&cache->table_size);
+	struct cache_entry **table = p_atomic_read(&cache->hash_table);
+	const uint32_t mask = table_size - 1;
 	const uint32_t start = (*(uint32_t *) sha1);
 
-	if (cache->table_size == 0)
+	if (table_size == 0)
 		return NULL;
 
-	for (uint32_t i = 0; i < cache->table_size; i++) {
+	for (uint32_t i = 0; i < table_size; i++) {
 		const uint32_t index = (start + i) & mask;
-		struct cache_entry *entry = cache->hash_table[index];
+		struct cache_entry *entry = p_atomic_read(&table[index]);
 
 		if (!entry)
 			return NULL;
@@ -157,38 +167,32 @@ radv_pipeline_cache_search_unlocked(struct radv_pipeline_cache *cache,
 	unreachable("hash table should never be full");
 }
 
-static struct cache_entry *
-radv_pipeline_cache_search(struct radv_pipeline_cache *cache,
-			   const unsigned char *sha1)
+static void
+radv_pipeline_cache_table_insert(struct cache_entry **table,
+				 uint32_t table_size,
+				 struct cache_entry *entry)
 {
-	struct cache_entry *entry;
-
-	pthread_mutex_lock(&cache->mutex);
-
-	entry = radv_pipeline_cache_search_unlocked(cache, sha1);
-
-	pthread_mutex_unlock(&cache->mutex);
+	const uint32_t mask = table_size - 1;
+	const uint32_t start = entry->sha1_dw[0];
 
-	return entry;
+	for (uint32_t i = 0; i < table_size; i++) {
+		const uint32_t index = (start + i) & mask;
+		if (!table[index]) {
+			p_atomic_set(&table[index], entry);
+			break;
+		}
+	}
 }
 
 static void
 radv_pipeline_cache_set_entry(struct radv_pipeline_cache *cache,
 			      struct cache_entry *entry)
 {
-	const uint32_t mask = cache->table_size - 1;
-	const uint32_t start = entry->sha1_dw[0];
-
 	/* We'll always be able to insert when we get here. */
 	assert(cache->kernel_count < cache->table_size / 2);
 
-	for (uint32_t i = 0; i < cache->table_size; i++) {
-		const uint32_t index = (start + i) & mask;
-		if (!cache->hash_table[index]) {
-			cache->hash_table[index] = entry;
-			break;
-		}
-	}
+	radv_pipeline_cache_table_insert(cache->hash_table, cache->table_size,
+					 entry);
 
 	cache->total_size += entry_size(entry);
 	cache->kernel_count++;
@@ -204,25 +208,27 @@ radv_pipeline_cache_grow(struct radv_pipeline_cache *cache)
 	struct cache_entry **table;
 	struct cache_entry **old_table = cache->hash_table;
 
+	/* The table size only ever doubles, so this can't overflow. */
+	assert(cache->num_old_tables < ARRAY_SIZE(cache->old_tables));
+
 	table = malloc(byte_size);
 	if (table == NULL)
 		return vk_error(cache->device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
 
-	cache->hash_table = table;
-	cache->table_size = table_size;
-	cache->kernel_count = 0;
-	cache->total_size = 0;
-
-	memset(cache->hash_table, 0, byte_size);
+	memset(table, 0, byte_size);
 	for (uint32_t i = 0; i < old_table_size; i++) {
 		struct cache_entry *entry = old_table[i];
 		if (!entry)
 			continue;
 
-		radv_pipeline_cache_set_entry(cache, entry);
+		radv_pipeline_cache_table_insert(table, table_size, entry);
 	}
 
-	free(old_table);
+	/* Lookups may still be using the old table. */
+	cache->old_tables[cache->num_old_tables++] = old_table;
+
+	p_atomic_set(&cache->hash_table, table);
+	p_atomic_set(&cache->table_size, table_size);
 
 	return VK_SUCCESS;
 }
@@ -251,6 +257,29 @@ radv_is_cache_disabled(struct radv_device *device)
 	       device->keep_shader_info;
 }
 
+/* Get references to the variants of an entry, if they were all created
+ * already.
+ */
+static bool
+radv_pipeline_cache_get_variants(struct cache_entry *entry,
+				 struct radv_shader_variant **variants)
+{
+	struct radv_shader_variant *entry_variants[MESA_SHADER_STAGES];
+
+	for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
+		entry_variants[i] = p_atomic_read(&entry->variants[i]);
+		if (entry->code_sizes[i] && !entry_variants[i])
+			return false;
+	}
+
+	for (int i = 0; i < MESA_SHADER_STAGES; ++i)
+		if (entry_variants[i])
+			p_atomic_inc(&entry_variants[i]->ref_count);
+
+	memcpy(variants, entry_variants, sizeof(entry_variants));
+	return true;
+}
+
 bool
 radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 					        struct radv_pipeline_cache *cache,
@@ -265,9 +294,14 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 		*found_in_application_cache = false;
 	}
 
+	/* Fast path without the mutex for entries that were used before. */
+	entry = radv_pipeline_cache_search(cache, sha1);
+	if (entry && radv_pipeline_cache_get_variants(entry, variants))
+		return true;
+
 	pthread_mutex_lock(&cache->mutex);
 
-	entry = radv_pipeline_cache_search_unlocked(cache, sha1);
+	entry = radv_pipeline_cache_search(cache, sha1);
 
 	if (!entry) {
 		*found_in_application_cache = false;
@@ -333,18 +367,14 @@ radv_create_shader_variants_from_pipeline_cache(struct radv_device *device,
 			memcpy(ptr, p, entry->code_sizes[i]);
 			p += entry->code_sizes[i];
 
-			entry->variants[i] = variant;
+			p_atomic_set(&entry->variants[i], variant);
 		} else if (entry->code_sizes[i]) {
 			p += sizeof(struct cache_entry_variant_info) + entry->code_sizes[i];
 		}
 
 	}
 
-	for (int i = 0; i < MESA_SHADER_STAGES; ++i)
-		if (entry->variants[i])
-			p_atomic_inc(&entry->variants[i]->ref_count);
-
-	memcpy(variants, entry->variants, sizeof(entry->variants));
+	radv_pipeline_cache_get_variants(entry, variants);
 	pthread_mutex_unlock(&cache->mutex);
 	return true;
 }
@@ -361,14 +391,14 @@ radv_pipeline_cache_insert_shaders(struct radv_device *device,
 		cache = device->mem_cache;
 
 	pthread_mutex_lock(&cache->mutex);
-	struct cache_entry *entry = radv_pipeline_cache_search_unlocked(cache, sha1);
+	struct cache_entry *entry = radv_pipeline_cache_search(cache, sha1);
 	if (entry) {
 		for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
 			if (entry->variants[i]) {
 				radv_shader_variant_destroy(cache->device, variants[i]);
 				variants[i] = entry->variants[i];
 			} else {
-				entry->variants[i] = variants[i];
+				p_atomic_set(&entry->variants[i], variants[i]);
 			}
 			if (variants[i])
 				p_atomic_inc(&variants[i]->ref_count);
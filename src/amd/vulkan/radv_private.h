@@ -48,6 +48,7 @@
 #include "compiler/shader_enums.h"
 #include "util/macros.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "util/xmlconfig.h"
 #include "main/macros.h"
 #include "vk_alloc.h"
@@ -365,6 +366,12 @@ struct radv_pipeline_cache {
 	struct cache_entry **                        hash_table;
 	bool                                         modified;
 
+	/* Tables replaced by a bigger one, freed with the cache since
+	 * lookups without the mutex may still use them.
+	 */
+	struct cache_entry **                        old_tables[32];
+	unsigned                                     num_old_tables;
+
 	VkAllocationCallbacks                        alloc;
 };
 
@@ -715,6 +722,9 @@ struct radv_device {
 	/* Backup in-memory cache to be used if the app doesn't provide one */
 	struct radv_pipeline_cache *                mem_cache;
 
+	/* Compiles the pipelines of a vkCreate*Pipelines call in parallel. */
+	struct util_queue                            pipeline_queue;
+
 	/*
 	 * use different counters so MSAA MRTs get consecutive surface indices,
 	 * even if MASK is allocated in between.
@@ -724,6 +734,10 @@ struct radv_device {
 	struct list_head shader_slabs;
 	mtx_t shader_slab_mutex;
 
+	/* Serialized NIR of the shader modules, see radv_shader_compile_to_nir */
+	struct hash_table *nir_cache;
+	mtx_t nir_cache_mutex;
+
 	/* For detecting VM faults reported by dmesg. */
 	uint64_t dmesg_timestamp;
 
@@ -789,6 +803,15 @@ struct radv_descriptor_pool {
 	uint8_t *host_memory_ptr;
 	uint8_t *host_memory_end;
 
+	/* For pools that can free sets: memory for the sets used linearly
+	 * until the next reset, and the number of sets that didn't fit and
+	 * were allocated separately.
+	 */
+	uint8_t *set_memory_base;
+	uint8_t *set_memory_ptr;
+	uint8_t *set_memory_end;
+	uint32_t allocated_set_count;
+
 	uint32_t entry_count;
 	uint32_t max_entry_count;
 	struct radv_descriptor_pool_entry entries[0];
@@ -997,6 +1020,9 @@ extern const struct radv_dynamic_state default_dynamic_state;
 const char *
 radv_get_debug_option_name(int id);
 
+bool
+radv_is_default_allocator(const VkAllocationCallbacks *alloc);
+
 const char *
 radv_get_perftest_option_name(int id);
 
@@ -25,6 +25,7 @@
  * IN THE SOFTWARE.
  */
 
+#include "util/hash_table.h"
 #include "util/mesa-sha1.h"
 #include "util/u_atomic.h"
 #include "radv_debug.h"
@@ -33,6 +34,7 @@
 #include "radv_shader_helper.h"
 #include "nir/nir.h"
 #include "nir/nir_builder.h"
+#include "nir/nir_serialize.h"
 #include "spirv/nir_spirv.h"
 
 #include <llvm-c/Core.h>
@@ -175,6 +177,131 @@ radv_optimize_nir(struct nir_shader *shader, bool optimize_conservatively,
         NIR_PASS(progress, shader, nir_opt_move_load_ubo);
 }
 
+/* Device-level cache of the NIR produced by radv_shader_compile_to_nir(),
+ * so that pipelines sharing a module, entrypoint and specialization don't
+ * go through spirv_to_nir and the initial lowering again.  Entries are
+ * serialized NIR and live until the device is destroyed.
+ */
+struct radv_serialized_nir {
+	unsigned char sha1[20];
+	size_t size;
+	char data[0];
+};
+
+static uint32_t
+sha1_hash_func(const void *sha1)
+{
+	return _mesa_hash_data(sha1, 20);
+}
+
+static bool
+sha1_compare_func(const void *sha1_a, const void *sha1_b)
+{
+	return memcmp(sha1_a, sha1_b, 20) == 0;
+}
+
+void
+radv_nir_cache_init(struct radv_device *device)
+{
+	mtx_init(&device->nir_cache_mutex, mtx_plain);
+	device->nir_cache = _mesa_hash_table_create(NULL, sha1_hash_func,
+						    sha1_compare_func);
+}
+
+void
+radv_nir_cache_finish(struct radv_device *device)
+{
+	/* The entries are ralloc'ed off the table. */
+	_mesa_hash_table_destroy(device->nir_cache, NULL);
+	mtx_destroy(&device->nir_cache_mutex);
+}
+
+static void
+radv_hash_nir(unsigned char *hash,
+	      const struct radv_shader_module *module,
+	      const char *entrypoint_name,
+	      gl_shader_stage stage,
+	      const VkSpecializationInfo *spec_info,
+	      const VkPipelineCreateFlags flags,
+	      const struct radv_pipeline_layout *layout)
+{
+	/* Only the flags that change the generated NIR. */
+	uint32_t nir_flags = flags & VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT;
+	struct mesa_sha1 ctx;
+
+	_mesa_sha1_init(&ctx);
+	_mesa_sha1_update(&ctx, module->sha1, sizeof(module->sha1));
+	_mesa_sha1_update(&ctx, entrypoint_name, strlen(entrypoint_name));
+	_mesa_sha1_update(&ctx, &stage, sizeof(stage));
+	if (spec_info) {
+		_mesa_sha1_update(&ctx, spec_info->pMapEntries,
+				  spec_info->mapEntryCount * sizeof spec_info->pMapEntries[0]);
+		_mesa_sha1_update(&ctx, spec_info->pData, spec_info->dataSize);
+	}
+	_mesa_sha1_update(&ctx, &nir_flags, sizeof(nir_flags));
+	/* For the immutable ycbcr samplers. */
+	if (layout)
+		_mesa_sha1_update(&ctx, layout->sha1, sizeof(layout->sha1));
+	_mesa_sha1_final(&ctx, hash);
+}
+
+static nir_shader *
+radv_nir_cache_search(struct radv_device *device, const unsigned char *sha1)
+{
+	const struct radv_serialized_nir *snir = NULL;
+
+	mtx_lock(&device->nir_cache_mutex);
+	struct hash_entry *entry =
+		_mesa_hash_table_search(device->nir_cache, sha1);
+	if (entry)
+		snir = entry->data;
+	mtx_unlock(&device->nir_cache_mutex);
+
+	if (!snir)
+		return NULL;
+
+	struct blob_reader blob;
+	blob_reader_init(&blob, snir->data, snir->size);
+
+	nir_shader *nir = nir_deserialize(NULL, &nir_options, &blob);
+	if (blob.overrun) {
+		ralloc_free(nir);
+		return NULL;
+	}
+	return nir;
+}
+
+static void
+radv_nir_cache_upload(struct radv_device *device, const unsigned char *sha1,
+		      const nir_shader *nir)
+{
+	struct blob blob;
+
+	blob_init(&blob);
+	nir_serialize(&blob, nir, false);
+	if (blob.out_of_memory) {
+		blob_finish(&blob);
+		return;
+	}
+
+	mtx_lock(&device->nir_cache_mutex);
+	/* Because ralloc isn't thread-safe, the entry is allocated with
+	 * the lock held. */
+	if (!_mesa_hash_table_search(device->nir_cache, sha1)) {
+		struct radv_serialized_nir *snir =
+			ralloc_size(device->nir_cache, sizeof(*snir) + blob.size);
+		if (snir) {
+			memcpy(snir->sha1, sha1, 20);
+			snir->size = blob.size;
+			memcpy(snir->data, blob.data, blob.size);
+			_mesa_hash_table_insert(device->nir_cache, snir->sha1, snir);
+		}
+	}
+	mtx_unlock(&device->nir_cache_mutex);
+
+	blob_finish(&blob);
+}
+
 nir_shader *
 radv_shader_compile_to_nir(struct radv_device *device,
 			   struct radv_shader_module *module,
@@ -184,8 +311,22 @@ radv_shader_compile_to_nir(struct radv_device *device,
 			   const VkPipelineCreateFlags flags,
 			   const struct radv_pipeline_layout *layout)
 {
+	unsigned char nir_sha1[20];
 	nir_shader *nir;
 	nir_function *entry_point;
+
+	bool use_nir_cache = !module->nir && device->nir_cache &&
+		!(device->instance->debug_flags & RADV_DEBUG_DUMP_SPIRV);
+	if (use_nir_cache) {
+		radv_hash_nir(nir_sha1, module, entrypoint_name, stage,
+			      spec_info, flags, layout);
+		nir = radv_nir_cache_search(device, nir_sha1);
+		if (nir) {
+			assert(nir->info.stage == stage);
+			return nir;
+		}
+	}
+
 	if (module->nir) {
 		/* Some things such as our meta clear/blit code will give us a NIR
 		 * shader directly.  In that case, we just ignore the SPIR-V entirely
@@ -370,6 +511,9 @@ radv_shader_compile_to_nir(struct radv_device *device,
 	ac_lower_indirect_derefs(nir, device->physical_device->rad_info.chip_class);
 	radv_optimize_nir(nir, flags & VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT, false);
 
+	if (use_nir_cache)
+		radv_nir_cache_upload(device, nir_sha1, nir);
+
 	return nir;
 }
 
@@ -623,6 +767,8 @@ shader_variant_create(struct radv_device *device,
 	if (options->check_ir)
 		tm_options |= AC_TM_CHECK_IR;
 
+	variant->compile_time = radv_get_current_time();
+
 	thread_compiler = !(device->instance->debug_flags & RADV_DEBUG_NOTHREADLLVM);
 	radv_init_llvm_once();
 	radv_init_llvm_compiler(&ac_llvm,
@@ -643,6 +789,8 @@ shader_variant_create(struct radv_device *device,
 
 	radv_fill_shader_variant(device, variant, &binary, stage);
 
+	variant->compile_time = radv_get_current_time() - variant->compile_time;
+
 	if (code_out) {
 		*code_out = binary.code;
 		*code_size_out = binary.code_size;
@@ -760,8 +908,10 @@ generate_shader_stats(struct radv_device *device,
 			       align(variant->info.fs.num_interp * 48,
 				     lds_increment);
 	} else if (stage == MESA_SHADER_COMPUTE) {
+		/* Not from the NIR, which is only kept with the shader info. */
+		const unsigned *block_size = variant->info.cs.block_size;
 		unsigned max_workgroup_size =
-				radv_nir_get_max_workgroup_size(chip_class, variant->nir);
+				block_size[0] * block_size[1] * block_size[2];
 		lds_per_wave = (conf->lds_size * lds_increment) /
 			       DIV_ROUND_UP(max_workgroup_size, 64);
 	}
@@ -799,12 +949,13 @@ generate_shader_stats(struct radv_device *device,
 				   "LDS: %d blocks\n"
 				   "Scratch: %d bytes per wave\n"
 				   "Max Waves: %d\n"
+				   "Compile Time: %"PRIu64" us\n"
 				   "********************\n\n\n",
 				   conf->num_sgprs, conf->num_vgprs,
 				   conf->spilled_sgprs, conf->spilled_vgprs,
 				   variant->info.private_mem_vgprs, variant->code_size,
 				   conf->lds_size, conf->scratch_bytes_per_wave,
-				   max_simd_waves);
+				   max_simd_waves, variant->compile_time / 1000);
 }
 
 void
@@ -858,7 +1009,7 @@ radv_GetShaderInfoAMD(VkDevice _device,
 			statistics.numAvailableSgprs = statistics.numPhysicalSgprs;
 
 			if (stage == MESA_SHADER_COMPUTE) {
-				unsigned *local_size = variant->nir->info.cs.local_size;
+				unsigned *local_size = variant->info.cs.block_size;
 				unsigned workgroup_size = local_size[0] * local_size[1] * local_size[2];
 
 				statistics.numAvailableVgprs = statistics.numPhysicalVgprs /
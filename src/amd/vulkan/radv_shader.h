@@ -316,6 +316,9 @@ struct radv_shader_variant {
 	unsigned rsrc1;
 	unsigned rsrc2;
 
+	/* In nanoseconds, 0 for variants loaded from a cache. */
+	uint64_t compile_time;
+
 	/* debug only */
 	uint32_t *spirv;
 	uint32_t spirv_size;
@@ -357,6 +360,12 @@ radv_alloc_shader_memory(struct radv_device *device,
 void
 radv_destroy_shader_slabs(struct radv_device *device);
 
+void
+radv_nir_cache_init(struct radv_device *device);
+
+void
+radv_nir_cache_finish(struct radv_device *device);
+
 struct radv_shader_variant *
 radv_shader_variant_create(struct radv_device *device,
 			   struct radv_shader_module *module,
@@ -64,14 +64,34 @@ radv_amdgpu_bo_va_op(struct radv_amdgpu_winsys *ws,
 				   flags, ops);
 }
 
+/* Unbound ranges of virtual buffers are mapped as PRT, so that the GPU
+ * doesn't fault on them, reads return 0 and writes are discarded. */
+static int
+radv_amdgpu_prt_va_op(struct radv_amdgpu_winsys *ws,
+		      uint64_t size,
+		      uint64_t addr,
+		      uint32_t ops)
+{
+	size = ALIGN(size, getpagesize());
+
+	return amdgpu_bo_va_op_raw(ws->dev, NULL, 0, size, addr,
+				   AMDGPU_VM_PAGE_PRT, ops);
+}
+
 static void
 radv_amdgpu_winsys_virtual_map(struct radv_amdgpu_winsys_bo *bo,
                                const struct radv_amdgpu_map_range *range)
 {
 	assert(range->size);
 
-	if (!range->bo)
-		return; /* TODO: PRT mapping */
+	if (!range->bo) {
+		if (bo->ws->info.has_sparse_vm_mappings &&
+		    radv_amdgpu_prt_va_op(bo->ws, range->size,
+					  range->offset + bo->base.va,
+					  AMDGPU_VA_OP_MAP))
+			abort();
+		return;
+	}
 
 	p_atomic_inc(&range->bo->ref_count);
 	int r = radv_amdgpu_bo_va_op(bo->ws, range->bo->bo, range->bo_offset,
@@ -87,8 +107,14 @@ radv_amdgpu_winsys_virtual_unmap(struct radv_amdgpu_winsys_bo *bo,
 {
 	assert(range->size);
 
-	if (!range->bo)
-		return; /* TODO: PRT mapping */
+	if (!range->bo) {
+		if (bo->ws->info.has_sparse_vm_mappings &&
+		    radv_amdgpu_prt_va_op(bo->ws, range->size,
+					  range->offset + bo->base.va,
+					  AMDGPU_VA_OP_UNMAP))
+			abort();
+		return;
+	}
 
 	int r = radv_amdgpu_bo_va_op(bo->ws, range->bo->bo, range->bo_offset,
 				     range->size, range->offset + bo->base.va,
@@ -33,6 +33,7 @@
 #include "radv_radeon_winsys.h"
 #include "radv_amdgpu_cs.h"
 #include "radv_amdgpu_bo.h"
+#include "radv_amdgpu_winsys_public.h"
 #include "sid.h"
 
 
@@ -70,6 +71,18 @@ struct radv_amdgpu_cs {
 	/* For chips that don't support chaining. */
 	struct radeon_cmdbuf     *old_cs_buffers;
 	unsigned                    num_old_cs_buffers;
+
+	/* The IB of the executed secondaries in old_cs_buffers, their buf is
+	 * NULL.  NULL for the parts of this CS.
+	 */
+	struct radeon_winsys_bo     **old_cs_bos;
+
+	/* The contents of a secondary, uploaded at its first execution
+	 * without IB BOs.
+	 */
+	struct radeon_winsys_bo     *sysmem_ib_bo;
+	unsigned                    sysmem_ib_size;
+	pthread_mutex_t             sysmem_ib_mutex;
 };
 
 static inline struct radv_amdgpu_cs *
@@ -262,7 +275,12 @@ static void radv_amdgpu_cs_destroy(struct radeon_cmdbuf *rcs)
 		free(rcs->buf);
 	}
 
+	if (cs->sysmem_ib_bo)
+		cs->ws->base.buffer_destroy(cs->sysmem_ib_bo);
+	pthread_mutex_destroy(&cs->sysmem_ib_mutex);
+
 	free(cs->old_cs_buffers);
+	free(cs->old_cs_bos);
 	free(cs->old_ib_buffers);
 	free(cs->virtual_buffers);
 	free(cs->virtual_buffer_hash_table);
@@ -327,9 +345,44 @@ radv_amdgpu_cs_create(struct radeon_winsys *ws,
 		}
 	}
 
+	pthread_mutex_init(&cs->sysmem_ib_mutex, NULL);
+
 	return &cs->base;
 }
 
+static bool radv_amdgpu_cs_reserve_old_cs_buffers(struct radv_amdgpu_cs *cs,
+						  unsigned count)
+{
+	unsigned num = cs->num_old_cs_buffers + count;
+	struct radeon_cmdbuf *old_cs_buffers;
+	struct radeon_winsys_bo **old_cs_bos;
+
+	old_cs_buffers = realloc(cs->old_cs_buffers,
+				 num * sizeof(*cs->old_cs_buffers));
+	if (!old_cs_buffers)
+		return false;
+	cs->old_cs_buffers = old_cs_buffers;
+
+	old_cs_bos = realloc(cs->old_cs_bos, num * sizeof(*cs->old_cs_bos));
+	if (!old_cs_bos)
+		return false;
+	cs->old_cs_bos = old_cs_bos;
+
+	return true;
+}
+
+static void radv_amdgpu_cs_push_old_cs_buffer(struct radv_amdgpu_cs *cs,
+					      uint32_t *buf, unsigned cdw,
+					      unsigned max_dw,
+					      struct radeon_winsys_bo *bo)
+{
+	cs->old_cs_buffers[cs->num_old_cs_buffers].cdw = cdw;
+	cs->old_cs_buffers[cs->num_old_cs_buffers].max_dw = max_dw;
+	cs->old_cs_buffers[cs->num_old_cs_buffers].buf = buf;
+	cs->old_cs_bos[cs->num_old_cs_buffers] = bo;
+	cs->num_old_cs_buffers++;
+}
+
 static void radv_amdgpu_cs_grow(struct radeon_cmdbuf *_cs, size_t min_size)
 {
 	struct radv_amdgpu_cs *cs = radv_amdgpu_cs(_cs);
@@ -350,20 +403,16 @@ static void radv_amdgpu_cs_grow(struct radeon_cmdbuf *_cs, size_t min_size)
 			/* The maximum size in dwords has been reached,
 			 * try to allocate a new one.
 			 */
-			cs->old_cs_buffers =
-				realloc(cs->old_cs_buffers,
-				        (cs->num_old_cs_buffers + 1) * sizeof(*cs->old_cs_buffers));
-			if (!cs->old_cs_buffers) {
+			if (!radv_amdgpu_cs_reserve_old_cs_buffers(cs, 1)) {
 				cs->failed = true;
 				cs->base.cdw = 0;
 				return;
 			}
 
 			/* Store the current one for submitting it later. */
-			cs->old_cs_buffers[cs->num_old_cs_buffers].cdw = cs->base.cdw;
-			cs->old_cs_buffers[cs->num_old_cs_buffers].max_dw = cs->base.max_dw;
-			cs->old_cs_buffers[cs->num_old_cs_buffers].buf = cs->base.buf;
-			cs->num_old_cs_buffers++;
+			radv_amdgpu_cs_push_old_cs_buffer(cs, cs->base.buf,
+							  cs->base.cdw,
+							  cs->base.max_dw, NULL);
 
 			/* Reset the cs, it will be re-allocated below. */
 			cs->base.cdw = 0;
@@ -498,8 +547,16 @@ static void radv_amdgpu_cs_reset(struct radeon_cmdbuf *_cs)
 		}
 
 		free(cs->old_cs_buffers);
+		free(cs->old_cs_bos);
 		cs->old_cs_buffers = NULL;
+		cs->old_cs_bos = NULL;
 		cs->num_old_cs_buffers = 0;
+
+		/* The secondary is being re-recorded. */
+		if (cs->sysmem_ib_bo) {
+			cs->ws->base.buffer_destroy(cs->sysmem_ib_bo);
+			cs->sysmem_ib_bo = NULL;
+		}
 	}
 }
 
@@ -604,6 +661,97 @@ static void radv_amdgpu_cs_add_buffer(struct radeon_cmdbuf *_cs,
 	radv_amdgpu_cs_add_buffer_internal(cs, bo->bo_handle, bo->priority);
 }
 
+static uint32_t radv_amdgpu_pad_word(struct radv_amdgpu_winsys *ws)
+{
+	return ws->info.chip_class == SI ? 0x80000000 : 0xffff1000U;
+}
+
+/* Upload the contents of a secondary the first time it's executed, it can
+ * then be submitted as its own IB by all the primaries executing it.
+ */
+static struct radeon_winsys_bo *
+radv_amdgpu_cs_get_sysmem_ib(struct radv_amdgpu_cs *cs)
+{
+	struct radeon_winsys *ws = &cs->ws->base;
+	struct radeon_winsys_bo *bo;
+
+	pthread_mutex_lock(&cs->sysmem_ib_mutex);
+	if (!cs->sysmem_ib_bo) {
+		unsigned size = cs->base.cdw;
+		uint32_t *ptr;
+
+		while (!size || (size & 7))
+			size++;
+
+		bo = ws->buffer_create(ws, 4 * size, 4096,
+				       RADEON_DOMAIN_GTT,
+				       RADEON_FLAG_CPU_ACCESS |
+				       RADEON_FLAG_NO_INTERPROCESS_SHARING |
+				       RADEON_FLAG_READ_ONLY,
+				       RADV_BO_PRIORITY_CS);
+		ptr = bo ? ws->buffer_map(bo) : NULL;
+		if (ptr) {
+			memcpy(ptr, cs->base.buf, 4 * cs->base.cdw);
+			for (unsigned i = cs->base.cdw; i < size; ++i)
+				ptr[i] = radv_amdgpu_pad_word(cs->ws);
+
+			cs->sysmem_ib_bo = bo;
+			cs->sysmem_ib_size = size;
+		} else if (bo) {
+			ws->buffer_destroy(bo);
+		}
+	}
+	bo = cs->sysmem_ib_bo;
+	pthread_mutex_unlock(&cs->sysmem_ib_mutex);
+
+	return bo;
+}
+
+/* Without IB BOs, executing a secondary splits the parent and the uploaded
+ * secondary becomes one of its IBs, so that it's not copied for every
+ * execution.  Small secondaries are cheaper to copy.
+ */
+static bool radv_amdgpu_cs_execute_sysmem_ib(struct radv_amdgpu_cs *parent,
+					     struct radv_amdgpu_cs *child)
+{
+	bool save_parent = parent->base.cdw || !parent->num_old_cs_buffers;
+	struct radeon_winsys_bo *bo;
+	uint32_t *new_buf = NULL;
+
+	if (child->base.cdw < 4096 || child->num_old_cs_buffers ||
+	    parent->num_old_cs_buffers + 3 > RADV_MAX_IBS_PER_SUBMIT)
+		return false;
+
+	bo = radv_amdgpu_cs_get_sysmem_ib(child);
+	if (!bo)
+		return false;
+
+	if (save_parent) {
+		new_buf = malloc(4 * parent->base.max_dw);
+		if (!new_buf)
+			return false;
+	}
+
+	if (!radv_amdgpu_cs_reserve_old_cs_buffers(parent, 2)) {
+		free(new_buf);
+		return false;
+	}
+
+	/* The first IB is always a part of the parent, for the preamble. */
+	if (save_parent) {
+		radv_amdgpu_cs_push_old_cs_buffer(parent, parent->base.buf,
+						  parent->base.cdw,
+						  parent->base.max_dw, NULL);
+		parent->base.buf = new_buf;
+		parent->base.cdw = 0;
+	}
+
+	radv_amdgpu_cs_push_old_cs_buffer(parent, NULL, child->sysmem_ib_size,
+					  0, bo);
+	radv_amdgpu_cs_add_buffer(&parent->base, bo);
+	return true;
+}
+
 static void radv_amdgpu_cs_execute_secondary(struct radeon_cmdbuf *_parent,
 					     struct radeon_cmdbuf *_child)
 {
@@ -628,7 +776,7 @@ static void radv_amdgpu_cs_execute_secondary(struct radeon_cmdbuf *_parent,
 		radeon_emit(&parent->base, child->ib.ib_mc_address);
 		radeon_emit(&parent->base, child->ib.ib_mc_address >> 32);
 		radeon_emit(&parent->base, child->ib.size);
-	} else {
+	} else if (!radv_amdgpu_cs_execute_sysmem_ib(parent, child)) {
 		if (parent->base.cdw + child->base.cdw > parent->base.max_dw)
 			radv_amdgpu_cs_grow(&parent->base, child->base.cdw);
 
@@ -1008,21 +1156,18 @@ static int radv_amdgpu_winsys_cs_submit_sysmem(struct radeon_winsys_ctx *_ctx,
 	struct radeon_winsys *ws = (struct radeon_winsys*)cs0->ws;
 	uint32_t bo_list;
 	struct radv_amdgpu_cs_request request;
-	uint32_t pad_word = 0xffff1000U;
+	uint32_t pad_word = radv_amdgpu_pad_word(cs0->ws);
 	bool emit_signal_sem = sem_info->cs_emit_signal;
 
-	if (radv_amdgpu_winsys(ws)->info.chip_class == SI)
-		pad_word = 0x80000000;
-
 	assert(cs_count);
 
 	for (unsigned i = 0; i < cs_count;) {
 		struct amdgpu_cs_ib_info *ibs;
-		struct radeon_winsys_bo **bos;
+		struct radeon_winsys_bo *bo;
 		struct radeon_cmdbuf *preamble_cs = i ? continue_preamble_cs : initial_preamble_cs;
 		struct radv_amdgpu_cs *cs = radv_amdgpu_cs(cs_array[i]);
 		unsigned number_of_ibs;
-		uint32_t *ptr;
+		uint32_t *ptr, *map;
 		unsigned cnt = 0;
 		unsigned size = 0;
 		unsigned pad_words = 0;
@@ -1030,57 +1175,56 @@ static int radv_amdgpu_winsys_cs_submit_sysmem(struct radeon_winsys_ctx *_ctx,
 		/* Compute the number of IBs for this submit. */
 		number_of_ibs = cs->num_old_cs_buffers + 1;
 
-		ibs = malloc(number_of_ibs * sizeof(*ibs));
+		ibs = calloc(number_of_ibs, sizeof(*ibs));
 		if (!ibs)
 			return -ENOMEM;
 
-		bos = malloc(number_of_ibs * sizeof(*bos));
-		if (!bos) {
-			free(ibs);
-			return -ENOMEM;
-		}
-
 		if (number_of_ibs > 1) {
-			/* Special path when the maximum size in dwords has
-			 * been reached because we need to handle more than one
-			 * IB per submit.
+			/* Special path when the CS is split in several IBs,
+			 * because the maximum size in dwords has been reached
+			 * or because it executes secondaries that are submitted
+			 * as their own IB.  The parts of the CS itself are
+			 * copied to the same BO.
 			 */
-			struct radeon_cmdbuf **new_cs_array;
-			unsigned idx = 0;
+			for (unsigned j = 0; j < number_of_ibs; j++) {
+				struct radeon_cmdbuf *rcs = j < cs->num_old_cs_buffers ?
+					&cs->old_cs_buffers[j] : &cs->base;
+				unsigned ib_size = rcs->cdw;
 
-			new_cs_array = malloc(cs->num_old_cs_buffers *
-					      sizeof(*new_cs_array));
-			assert(new_cs_array);
+				if (j < cs->num_old_cs_buffers && cs->old_cs_bos[j])
+					continue;
 
-			for (unsigned j = 0; j < cs->num_old_cs_buffers; j++)
-				new_cs_array[idx++] = &cs->old_cs_buffers[j];
-			new_cs_array[idx++] = cs_array[i];
+				if (preamble_cs && j == 0)
+					ib_size += preamble_cs->cdw;
 
-			for (unsigned j = 0; j < number_of_ibs; j++) {
-				struct radeon_cmdbuf *rcs = new_cs_array[j];
-				bool needs_preamble = preamble_cs && j == 0;
-				unsigned size = 0;
+				assert(ib_size < 0xffff8);
 
-				if (needs_preamble)
-					size += preamble_cs->cdw;
-				size += rcs->cdw;
+				while (!ib_size || (ib_size & 7))
+					ib_size++;
 
-				assert(size < 0xffff8);
+				size += ib_size;
+			}
 
-				while (!size || (size & 7)) {
-					size++;
-					pad_words++;
-				}
+			bo = ws->buffer_create(ws, 4 * size, 4096,
+					       RADEON_DOMAIN_GTT,
+					       RADEON_FLAG_CPU_ACCESS |
+					       RADEON_FLAG_NO_INTERPROCESS_SHARING |
+					       RADEON_FLAG_READ_ONLY,
+					       RADV_BO_PRIORITY_CS);
+			map = ptr = ws->buffer_map(bo);
 
-				bos[j] = ws->buffer_create(ws, 4 * size, 4096,
-							   RADEON_DOMAIN_GTT,
-							   RADEON_FLAG_CPU_ACCESS |
-							   RADEON_FLAG_NO_INTERPROCESS_SHARING |
-							   RADEON_FLAG_READ_ONLY,
-							   RADV_BO_PRIORITY_CS);
-				ptr = ws->buffer_map(bos[j]);
+			for (unsigned j = 0; j < number_of_ibs; j++) {
+				struct radeon_cmdbuf *rcs = j < cs->num_old_cs_buffers ?
+					&cs->old_cs_buffers[j] : &cs->base;
+				uint32_t *ib = ptr;
+
+				if (j < cs->num_old_cs_buffers && cs->old_cs_bos[j]) {
+					ibs[j].size = rcs->cdw;
+					ibs[j].ib_mc_address = radv_buffer_get_va(cs->old_cs_bos[j]);
+					continue;
+				}
 
-				if (needs_preamble) {
+				if (preamble_cs && j == 0) {
 					memcpy(ptr, preamble_cs->buf, preamble_cs->cdw * 4);
 					ptr += preamble_cs->cdw;
 				}
@@ -1088,20 +1232,22 @@ static int radv_amdgpu_winsys_cs_submit_sysmem(struct radeon_winsys_ctx *_ctx,
 				memcpy(ptr, rcs->buf, 4 * rcs->cdw);
 				ptr += rcs->cdw;
 
-				for (unsigned k = 0; k < pad_words; ++k)
+				while (ptr == ib || ((ptr - ib) & 7))
 					*ptr++ = pad_word;
 
-				ibs[j].size = size;
-				ibs[j].ib_mc_address = radv_buffer_get_va(bos[j]);
+				ibs[j].size = ptr - ib;
+				ibs[j].ib_mc_address = radv_buffer_get_va(bo) + 4 * (ib - map);
 			}
 
 			cnt++;
-			free(new_cs_array);
 		} else {
 			if (preamble_cs)
 				size += preamble_cs->cdw;
 
-			while (i + cnt < cs_count && 0xffff8 - size >= radv_amdgpu_cs(cs_array[i + cnt])->base.cdw) {
+			/* A CS split in several IBs is submitted on its own. */
+			while (i + cnt < cs_count &&
+			       !radv_amdgpu_cs(cs_array[i + cnt])->num_old_cs_buffers &&
+			       0xffff8 - size >= radv_amdgpu_cs(cs_array[i + cnt])->base.cdw) {
 				size += radv_amdgpu_cs(cs_array[i + cnt])->base.cdw;
 				++cnt;
 			}
@@ -1112,13 +1258,13 @@ static int radv_amdgpu_winsys_cs_submit_sysmem(struct radeon_winsys_ctx *_ctx,
 			}
 			assert(cnt);
 
-			bos[0] = ws->buffer_create(ws, 4 * size, 4096,
-						   RADEON_DOMAIN_GTT,
-						   RADEON_FLAG_CPU_ACCESS |
-						   RADEON_FLAG_NO_INTERPROCESS_SHARING |
-						   RADEON_FLAG_READ_ONLY,
-						   RADV_BO_PRIORITY_CS);
-			ptr = ws->buffer_map(bos[0]);
+			bo = ws->buffer_create(ws, 4 * size, 4096,
+					       RADEON_DOMAIN_GTT,
+					       RADEON_FLAG_CPU_ACCESS |
+					       RADEON_FLAG_NO_INTERPROCESS_SHARING |
+					       RADEON_FLAG_READ_ONLY,
+					       RADV_BO_PRIORITY_CS);
+			ptr = ws->buffer_map(bo);
 
 			if (preamble_cs) {
 				memcpy(ptr, preamble_cs->buf, preamble_cs->cdw * 4);
@@ -1136,18 +1282,18 @@ static int radv_amdgpu_winsys_cs_submit_sysmem(struct radeon_winsys_ctx *_ctx,
 				*ptr++ = pad_word;
 
 			ibs[0].size = size;
-			ibs[0].ib_mc_address = radv_buffer_get_va(bos[0]);
+			ibs[0].ib_mc_address = radv_buffer_get_va(bo);
 		}
 
 		r = radv_amdgpu_create_bo_list(cs0->ws, &cs_array[i], cnt,
-			                       (struct radv_amdgpu_winsys_bo **)bos,
-					       number_of_ibs, preamble_cs,
+			                       (struct radv_amdgpu_winsys_bo **)&bo,
+					       1, preamble_cs,
 					       radv_bo_list, &bo_list);
 		if (r) {
 			fprintf(stderr, "amdgpu: buffer list creation failed "
 					"for the sysmem submission (%d)\n", r);
+			ws->buffer_destroy(bo);
 			free(ibs);
-			free(bos);
 			return r;
 		}
 
@@ -1172,12 +1318,8 @@ static int radv_amdgpu_winsys_cs_submit_sysmem(struct radeon_winsys_ctx *_ctx,
 
 		amdgpu_bo_list_destroy_raw(ctx->ws->dev, bo_list);
 
-		for (unsigned j = 0; j < number_of_ibs; j++) {
-			ws->buffer_destroy(bos[j]);
-		}
-
+		ws->buffer_destroy(bo);
 		free(ibs);
-		free(bos);
 
 		if (r)
 			return r;
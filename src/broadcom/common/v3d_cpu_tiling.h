@@ -79,6 +79,22 @@ v3d_load_utile(void *cpu, uint32_t cpu_stride,
                           [cpu_stride]  "r"(cpu_stride)
                         : "q0", "q1", "q2", "q3");
                 return;
+        } else if (gpu_stride == 32) {
+                __asm__ volatile (
+                        /* Load from the GPU in one shot, no interleave, to
+                         * d0-d7.
+                         */
+                        "vldm %[gpu], {q0, q1, q2, q3}\n"
+                        /* Store each 32-byte line to cpu-side destination,
+                         * incrementing it by the stride each time.
+                         */
+                        "vst1.8 {d0, d1, d2, d3}, [%[cpu]], %[cpu_stride]\n"
+                        "vst1.8 {d4, d5, d6, d7}, [%[cpu]]\n"
+                        : [cpu]         "+r"(cpu)
+                        : [gpu]         "r"(gpu),
+                          [cpu_stride]  "r"(cpu_stride)
+                        : "q0", "q1", "q2", "q3");
+                return;
         }
 #elif defined (PIPE_ARCH_AARCH64)
         if (gpu_stride == 8) {
@@ -128,6 +144,22 @@ v3d_load_utile(void *cpu, uint32_t cpu_stride,
                           [cpu_stride]  "r"(cpu_stride)
                         : "v0", "v1", "v2", "v3");
                 return;
+        } else if (gpu_stride == 32) {
+                __asm__ volatile (
+                        /* Load from the GPU in one shot, no interleave, to
+                         * v0-v3.
+                         */
+                        "ld1 {v0.2d, v1.2d, v2.2d, v3.2d}, [%[gpu]]\n"
+                        /* Store each 32-byte line to cpu-side destination,
+                         * incrementing it by the stride each time.
+                         */
+                        "st1 {v0.2d, v1.2d}, [%[cpu]], %[cpu_stride]\n"
+                        "st1 {v2.2d, v3.2d}, [%[cpu]]\n"
+                        : [cpu]         "+r"(cpu)
+                        : [gpu]         "r"(gpu),
+                          [cpu_stride]  "r"(cpu_stride)
+                        : "v0", "v1", "v2", "v3");
+                return;
         }
 #endif
 
@@ -187,6 +219,20 @@ v3d_store_utile(void *gpu, uint32_t gpu_stride,
                           [cpu_stride]  "r"(cpu_stride)
                         : "q0", "q1", "q2", "q3");
                 return;
+        } else if (gpu_stride == 32) {
+                __asm__ volatile (
+                        /* Load each 32-byte line from cpu-side source,
+                         * incrementing it by the stride each time.
+                         */
+                        "vld1.8 {d0, d1, d2, d3}, [%[cpu]], %[cpu_stride]\n"
+                        "vld1.8 {d4, d5, d6, d7}, [%[cpu]]\n"
+                        /* Store to the GPU in one shot, no interleave. */
+                        "vstm %[gpu], {q0, q1, q2, q3}\n"
+                        : [cpu]         "+r"(cpu)
+                        : [gpu]         "r"(gpu),
+                          [cpu_stride]  "r"(cpu_stride)
+                        : "q0", "q1", "q2", "q3");
+                return;
         }
 #elif defined (PIPE_ARCH_AARCH64)
         if (gpu_stride == 8) {
@@ -232,6 +278,20 @@ v3d_store_utile(void *gpu, uint32_t gpu_stride,
                           [cpu_stride]  "r"(cpu_stride)
                         : "v0", "v1", "v2", "v3");
                 return;
+        } else if (gpu_stride == 32) {
+                __asm__ volatile (
+                        /* Load each 32-byte line from cpu-side source,
+                         * incrementing it by the stride each time.
+                         */
+                        "ld1 {v0.2d, v1.2d}, [%[cpu]], %[cpu_stride]\n"
+                        "ld1 {v2.2d, v3.2d}, [%[cpu]]\n"
+                        /* Store to the GPU in one shot, no interleave. */
+                        "st1 {v0.2d, v1.2d, v2.2d, v3.2d}, [%[gpu]]\n"
+                        : [cpu]         "+r"(cpu)
+                        : [gpu]         "r"(gpu),
+                          [cpu_stride]  "r"(cpu_stride)
+                        : "v0", "v1", "v2", "v3");
+                return;
         }
 #endif
 
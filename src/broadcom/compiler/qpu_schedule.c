@@ -693,7 +693,8 @@ qpu_merge_inst(const struct v3d_device_info *devinfo,
 static struct schedule_node *
 choose_instruction_to_schedule(const struct v3d_device_info *devinfo,
                                struct choose_scoreboard *scoreboard,
-                               struct schedule_node *prev_inst)
+                               struct schedule_node *prev_inst,
+                               uint32_t time)
 {
         struct schedule_node *chosen = NULL;
         int chosen_prio = 0;
@@ -800,6 +801,20 @@ choose_instruction_to_schedule(const struct v3d_device_info *devinfo,
                         continue;
                 }
 
+                /* Prefer an instruction whose sources are ready over one
+                 * that would stall waiting for the latency of its parents
+                 * (TMU and SFU results, mostly).
+                 */
+                bool stalls = n->unblocked_time > time;
+                bool chosen_stalls = chosen->unblocked_time > time;
+                if (chosen_stalls && !stalls) {
+                        chosen = n;
+                        chosen_prio = prio;
+                        continue;
+                } else if (stalls && !chosen_stalls) {
+                        continue;
+                }
+
                 if (n->delay > chosen->delay) {
                         chosen = n;
                         chosen_prio = prio;
@@ -1210,7 +1225,7 @@ schedule_instructions(struct v3d_compile *c,
                 struct schedule_node *chosen =
                         choose_instruction_to_schedule(devinfo,
                                                        scoreboard,
-                                                       NULL);
+                                                       NULL, time);
                 struct schedule_node *merge = NULL;
 
                 /* If there are no valid instructions to schedule, drop a NOP
@@ -1245,9 +1260,10 @@ schedule_instructions(struct v3d_compile *c,
                         while ((merge =
                                 choose_instruction_to_schedule(devinfo,
                                                                scoreboard,
-                                                               chosen))) {
+                                                               chosen,
+                                                               time))) {
                                 time = MAX2(merge->unblocked_time, time);
-                                pre_remove_head(scoreboard->dag, chosen);
+                                pre_remove_head(scoreboard->dag, merge);
                                 list_addtail(&merge->link, &merged_list);
                                 (void)qpu_merge_inst(devinfo, inst,
                                                      inst, &merge->inst->qpu);
@@ -1320,9 +1336,13 @@ schedule_instructions(struct v3d_compile *c,
                                  * instructions of the successors are (so we can
                                  * handle A/B register file write latency)
                                  */
-                                for (int i = 0; i < 3; i++)
+                                for (int i = 0; i < 3; i++) {
                                         emit_nop(c, block, scoreboard);
+                                        time++;
+                                }
                         }
+
+                        time++;
                 }
         }
 
@@ -837,7 +837,9 @@ namespace {
  * function module.
  *
  * It generates IR for every built-in function signature, and organizes them
- * into functions.
+ * into functions.  Only the names of the built-in functions are registered
+ * up front, the IR for their signatures is generated when a shader first
+ * looks them up.
  */
 class builtin_builder {
 public:
@@ -849,22 +851,52 @@ public:
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
 
+   /**
+    * Look up the built-in function \p name, generating its signatures if
+    * this is the first time it is used.
+    */
+   ir_function *find_function(const char *name);
+
    /**
     * A shader to hold all the built-in signatures; created by this module.
     *
-    * This includes signatures for every built-in, regardless of version or
-    * enabled extensions.  The availability predicate associated with each
-    * signature allows matching_signature() to filter out the irrelevant ones.
+    * This includes signatures for every built-in which has been looked up,
+    * regardless of version or enabled extensions.  The availability predicate
+    * associated with each signature allows matching_signature() to filter out
+    * the irrelevant ones.
     */
    gl_shader *shader;
 
 private:
    void *mem_ctx;
 
+   /**
+    * While true, create_builtins() only registers the name of every built-in
+    * function without generating any signatures.
+    */
+   bool registering_names;
+
+   /**
+    * If not NULL, create_builtins() only generates the signatures of the
+    * function with this name.
+    */
+   const char *populating_name;
+
    void create_shader();
    void create_intrinsics();
    void create_builtins();
 
+   /**
+    * Whether create_builtins() should generate the signatures of \p name,
+    * see registering_names and populating_name.
+    */
+   bool want_function(const char *name);
+
+   /**
+    * Return the function \p name, creating it if it doesn't exist yet.
+    */
+   ir_function *get_or_create_function(const char *name);
+
    /**
     * IR builder helpers:
     *
@@ -1219,6 +1251,8 @@ builtin_builder::builtin_builder()
    : shader(NULL)
 {
    mem_ctx = NULL;
+   registering_names = false;
+   populating_name = NULL;
 }
 
 builtin_builder::~builtin_builder()
@@ -1239,7 +1273,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = find_function(name);
    if (f == NULL)
       return NULL;
 
@@ -1251,6 +1285,20 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+ir_function *
+builtin_builder::find_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+   if (f == NULL || !f->signatures.is_empty())
+      return f;
+
+   populating_name = f->name;
+   create_builtins();
+   populating_name = NULL;
+
+   return f;
+}
+
 void
 builtin_builder::initialize()
 {
@@ -1260,8 +1308,15 @@ builtin_builder::initialize()
 
    mem_ctx = ralloc_context(NULL);
    create_shader();
+
+   /* Built-in functions call into the intrinsics, so those are generated
+    * right away.
+    */
    create_intrinsics();
+
+   registering_names = true;
    create_builtins();
+   registering_names = false;
 }
 
 void
@@ -1498,9 +1553,29 @@ builtin_builder::create_intrinsics()
  *
  * Contains a list of every available built-in.
  */
+bool
+builtin_builder::want_function(const char *name)
+{
+   if (registering_names) {
+      get_or_create_function(name);
+      return false;
+   }
+
+   return populating_name == NULL || strcmp(name, populating_name) == 0;
+}
+
 void
 builtin_builder::create_builtins()
 {
+   /* Don't even evaluate the signature generators of the functions we don't
+    * want this time.
+    */
+#define add_function(NAME, ...)                 \
+   do {                                         \
+      if (want_function(NAME))                  \
+         add_function(NAME, __VA_ARGS__);       \
+   } while (0)
+
 #define F(NAME)                                 \
    add_function(#NAME,                          \
                 _##NAME(glsl_type::float_type), \
@@ -4248,6 +4323,19 @@ builtin_builder::create_builtins()
 #undef FIUD_VEC
 #undef FIUBD_VEC
 #undef FIU2_MIXED
+#undef add_function
+}
+
+ir_function *
+builtin_builder::get_or_create_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+   if (f == NULL) {
+      f = new(mem_ctx) ir_function(name);
+      shader->symbols->add_function(f);
+   }
+
+   return f;
 }
 
 void
@@ -4255,7 +4343,10 @@ builtin_builder::add_function(const char *name, ...)
 {
    va_list ap;
 
-   ir_function *f = new(mem_ctx) ir_function(name);
+   /* The first definition of a function wins. */
+   ir_function *f = get_or_create_function(name);
+   if (!f->signatures.is_empty())
+      return;
 
    va_start(ap, name);
    while (true) {
@@ -4272,8 +4363,6 @@ builtin_builder::add_function(const char *name, ...)
       f->add_signature(sig);
    }
    va_end(ap);
-
-   shader->symbols->add_function(f);
 }
 
 void
@@ -4320,7 +4409,12 @@ builtin_builder::add_image_function(const char *name,
       glsl_type::uimage2DMSArray_type
    };
 
-   ir_function *f = new(mem_ctx) ir_function(name);
+   if (!want_function(name))
+      return;
+
+   ir_function *f = get_or_create_function(name);
+   if (!f->signatures.is_empty())
+      return;
 
    for (unsigned i = 0; i < ARRAY_SIZE(types); ++i) {
       if ((types[i]->sampled_type != GLSL_TYPE_FLOAT ||
@@ -4330,8 +4424,6 @@ builtin_builder::add_image_function(const char *name,
          f->add_signature(_image(prototype, types[i], intrinsic_name,
                                  num_arguments, flags, intrinsic_id));
    }
-
-   shader->symbols->add_function(f);
 }
 
 void
@@ -7281,7 +7373,7 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    ir_function *f;
    bool ret = false;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.find_function(name);
    if (f != NULL) {
       foreach_in_list(ir_function_signature, sig, &f->signatures) {
          if (sig->is_builtin_available(state)) {
@@ -321,6 +321,7 @@ control_line_success:
 		entry = _mesa_hash_table_search (parser->defines, $3);
 		if (entry) {
 			_mesa_hash_table_remove (parser->defines, entry);
+			parser->macro_generation++;
 		}
 	}
 |	HASH_TOKEN IF pp_tokens NEWLINE {
@@ -1367,6 +1368,7 @@ glcpp_parser_create(const struct gl_extensions *extension_list,
    glcpp_lex_init_extra (parser, &parser->scanner);
    parser->defines = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
                                              _mesa_key_string_equal);
+   parser->macro_generation = 1;
    parser->linalloc = linear_alloc_parent(parser, 0);
    parser->active = NULL;
    parser->lexing_directive = 0;
@@ -1818,6 +1820,87 @@ _glcpp_parser_expand_function(glcpp_parser_t *parser, token_node_t *node,
    return substituted;
 }
 
+/* Return the complete expansion of the object-like macro 'macro', or NULL
+ * if it cannot be memoized.
+ *
+ * The expansion is memoized when it cannot depend on where the macro is
+ * used: neither its replacement list nor those of the object-like macros
+ * it refers to may contain pastes, "defined", __LINE__, __FILE__, or
+ * function-like or recursive macros. The resulting tokens then need no
+ * further expansion, and they are reused until the next #define or #undef.
+ */
+static token_list_t *
+_glcpp_parser_expand_object_macro(glcpp_parser_t *parser, macro_t *macro)
+{
+   token_list_t *expansion;
+   token_node_t *node;
+
+   if (macro->expansion_generation == parser->macro_generation) {
+      if (macro->expansion_state == MACRO_EXPANSION_CACHED)
+         return macro->expansion;
+
+      /* Either not cacheable or referring to itself. */
+      return NULL;
+   }
+
+   macro->expansion_generation = parser->macro_generation;
+   macro->expansion_state = MACRO_EXPANSION_IN_PROGRESS;
+
+   expansion = _token_list_create(parser);
+
+   for (node = macro->replacements->head; node; node = node->next) {
+      token_t *token = node->token;
+      struct hash_entry *entry;
+      macro_t *other;
+      token_list_t *other_expansion;
+      token_node_t *n;
+
+      if (token->type == PASTE || token->type == DEFINED)
+         goto uncacheable;
+
+      if (token->type != IDENTIFIER) {
+         _token_list_append(parser, expansion, token);
+         continue;
+      }
+
+      if (strcmp(token->value.str, "__LINE__") == 0 ||
+          strcmp(token->value.str, "__FILE__") == 0)
+         goto uncacheable;
+
+      entry = _mesa_hash_table_search(parser->defines, token->value.str);
+      other = entry ? entry->data : NULL;
+
+      if (other == NULL) {
+         _token_list_append(parser, expansion, token);
+         continue;
+      }
+
+      if (other->is_function)
+         goto uncacheable;
+
+      if (other->replacements == NULL) {
+         _token_list_append(parser, expansion,
+                            _token_create_ival(parser, SPACE, SPACE));
+         continue;
+      }
+
+      other_expansion = _glcpp_parser_expand_object_macro(parser, other);
+      if (other_expansion == NULL)
+         goto uncacheable;
+
+      for (n = other_expansion->head; n; n = n->next)
+         _token_list_append(parser, expansion, n->token);
+   }
+
+   macro->expansion = expansion;
+   macro->expansion_state = MACRO_EXPANSION_CACHED;
+   return expansion;
+
+uncacheable:
+   macro->expansion_state = MACRO_EXPANSION_UNCACHEABLE;
+   return NULL;
+}
+
 /* Compute the complete expansion of node, (and subsequent nodes after
  * 'node' in the case that 'node' is a function-like macro and
  * subsequent nodes are arguments).
@@ -1833,12 +1916,16 @@ _glcpp_parser_expand_function(glcpp_parser_t *parser, token_node_t *node,
  *   As the token of the closing right parenthesis in the case of
  *   function-like macro expansion.
  *
+ * *fully_expanded is set when the returned tokens need no further
+ * expansion.
+ *
  * See the documentation of _glcpp_parser_expand_token_list for a description
  * of the "mode" parameter.
  */
 static token_list_t *
 _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
-                          token_node_t **last, expansion_mode_t mode)
+                          token_node_t **last, bool *fully_expanded,
+                          expansion_mode_t mode)
 {
    token_t *token = node->token;
    const char *identifier;
@@ -1851,6 +1938,7 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
    }
 
    *last = node;
+   *fully_expanded = false;
    identifier = token->value.str;
 
    /* Special handling for __LINE__ and __FILE__, (not through
@@ -1896,6 +1984,16 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
       if (macro->replacements == NULL)
          return _token_list_create_with_one_space(parser);
 
+      /* Outside of other expansions, no macro is kept from expanding, so
+       * the memoized expansion can be used. */
+      if (parser->active == NULL) {
+         replacement = _glcpp_parser_expand_object_macro(parser, macro);
+         if (replacement) {
+            *fully_expanded = true;
+            return _token_list_copy(parser, replacement);
+         }
+      }
+
       replacement = _token_list_copy(parser, macro->replacements);
       _glcpp_parser_apply_pastes(parser, replacement);
       return replacement;
@@ -1982,6 +2080,7 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
    token_node_t *node_prev;
    token_node_t *node, *last = NULL;
    token_list_t *expansion;
+   bool fully_expanded;
    active_list_t *active_initial = parser->active;
 
    if (list == NULL)
@@ -2000,7 +2099,8 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
       while (parser->active && parser->active->marker == node)
          _parser_active_list_pop (parser);
 
-      expansion = _glcpp_parser_expand_node (parser, node, &last, mode);
+      expansion = _glcpp_parser_expand_node (parser, node, &last,
+                                             &fully_expanded, mode);
       if (expansion) {
          token_node_t *n;
 
@@ -2026,6 +2126,10 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
             expansion->tail->next = last->next;
             if (last == list->tail)
                list->tail = expansion->tail;
+
+            /* Continue right after tokens that need no rescanning. */
+            if (fully_expanded)
+               node_prev = expansion->tail;
          } else {
             if (node_prev)
                node_prev->next = last->next;
@@ -2129,6 +2233,8 @@ _define_object_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    macro->parameters = NULL;
    macro->identifier = linear_strdup(parser->linalloc, identifier);
    macro->replacements = replacements;
+   macro->expansion = NULL;
+   macro->expansion_generation = 0;
 
    entry = _mesa_hash_table_search(parser->defines, identifier);
    previous = entry ? entry->data : NULL;
@@ -2140,6 +2246,7 @@ _define_object_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert (parser->defines, identifier, macro);
+   parser->macro_generation++;
 }
 
 void
@@ -2164,6 +2271,8 @@ _define_function_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    macro->parameters = parameters;
    macro->identifier = linear_strdup(parser->linalloc, identifier);
    macro->replacements = replacements;
+   macro->expansion = NULL;
+   macro->expansion_generation = 0;
 
    entry = _mesa_hash_table_search(parser->defines, identifier);
    previous = entry ? entry->data : NULL;
@@ -2175,6 +2284,7 @@ _define_function_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert(parser->defines, identifier, macro);
+   parser->macro_generation++;
 }
 
 static int
@@ -143,11 +143,24 @@ glcpp_parser_classify_token (glcpp_parser_t *parser,
 			     const char *identifier,
 			     int *parameter_index);
 
+typedef enum {
+	MACRO_EXPANSION_IN_PROGRESS,
+	MACRO_EXPANSION_CACHED,
+	MACRO_EXPANSION_UNCACHEABLE
+} macro_expansion_state_t;
+
 typedef struct {
 	int is_function;
 	string_list_t *parameters;
 	const char *identifier;
 	token_list_t *replacements;
+
+	/* Memoized complete expansion of an object-like macro, only
+	 * meaningful while expansion_generation matches the
+	 * macro_generation of the parser. */
+	token_list_t *expansion;
+	unsigned expansion_generation;
+	macro_expansion_state_t expansion_state;
 } macro_t;
 
 typedef struct expansion_node {
@@ -188,6 +201,7 @@ struct glcpp_parser {
 	void *linalloc;
 	yyscan_t scanner;
 	struct hash_table *defines;
+	unsigned macro_generation; /* bumped by each #define and #undef */
 	active_list_t *active;
 	int lexing_directive;
 	int lexing_version_directive;
@@ -0,0 +1,11 @@
+#define inner 1
+#define outer (inner + inner)
+outer
+#undef inner
+#define inner 2
+outer outer
+#define f(x) <x>
+#define g f
+g(outer)
+#define self self + inner
+self
@@ -2041,7 +2041,9 @@ opt_shader_and_create_symbol_table(struct gl_context *ctx,
    /* Do some optimization at compile time to reduce shader IR size
     * and reduce later work if the same shader is linked multiple times
     */
-   if (ctx->Const.GLSLOptimizeConservatively) {
+   if (options->SkipCompileTimeOptimizations) {
+      /* Everything is optimized after linking anyway. */
+   } else if (ctx->Const.GLSLOptimizeConservatively) {
       /* Run it just once. */
       do_common_optimization(shader->ir, false, false, options,
                              ctx->Const.NativeIntegers);
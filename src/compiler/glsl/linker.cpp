@@ -85,6 +85,7 @@
 #include "shader_cache.h"
 #include "util/u_string.h"
 #include "util/u_math.h"
+#include "util/u_queue.h"
 
 #include "main/imports.h"
 #include "main/shaderobj.h"
@@ -4806,6 +4807,143 @@ link_and_validate_uniforms(struct gl_context *ctx,
    link_check_atomic_counter_resources(ctx, prog);
 }
 
+/**
+ * Queue running the per-stage work of links requested with
+ * MESA_GLSL=parallel_link.
+ *
+ * It is shared by all contexts and created on first use.  The linking
+ * thread always handles one of the stages itself, so one thread less than
+ * the number of stages is enough.
+ */
+static struct util_queue link_queue;
+static bool link_queue_initialized;
+static once_flag link_queue_once_flag = ONCE_FLAG_INIT;
+
+static void
+init_link_queue(void)
+{
+   link_queue_initialized =
+      util_queue_init(&link_queue, "glsl_link", MESA_SHADER_STAGES,
+                      MESA_SHADER_STAGES - 1, 0);
+}
+
+typedef void (*link_stage_func)(struct gl_context *ctx,
+                                struct gl_shader_program *prog,
+                                unsigned stage);
+
+struct link_stage_job {
+   link_stage_func func;
+   struct gl_context *ctx;
+   struct gl_shader_program *prog;
+   unsigned stage;
+   struct util_queue_fence fence;
+};
+
+static void
+execute_link_stage_job(void *data, int thread_index)
+{
+   struct link_stage_job *job = (struct link_stage_job *) data;
+
+   job->func(job->ctx, job->prog, job->stage);
+}
+
+/**
+ * Call \p func for each linked stage of \p prog.
+ *
+ * With MESA_GLSL=parallel_link the stages are processed concurrently, unless
+ * the application asked for no extra compiler threads through
+ * GL_KHR_parallel_shader_compile.  \p func must therefore only modify the
+ * linked shader of the stage it is called for.
+ */
+static void
+foreach_linked_stage(struct gl_context *ctx, struct gl_shader_program *prog,
+                     link_stage_func func)
+{
+   unsigned num_stages = 0;
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         num_stages++;
+   }
+
+   bool parallel = num_stages > 1 &&
+                   ctx->_Shader && (ctx->_Shader->Flags & GLSL_PARALLEL_LINK) &&
+                   ctx->Hint.MaxShaderCompilerThreads != 0;
+
+   if (parallel) {
+      call_once(&link_queue_once_flag, init_link_queue);
+      parallel = link_queue_initialized;
+   }
+
+   if (!parallel) {
+      for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+         if (prog->_LinkedShaders[i] != NULL)
+            func(ctx, prog, i);
+      }
+      return;
+   }
+
+   struct link_stage_job jobs[MESA_SHADER_STAGES];
+   unsigned num_jobs = 0;
+   int local_stage = -1;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] == NULL)
+         continue;
+
+      if (local_stage < 0) {
+         local_stage = i;
+         continue;
+      }
+
+      struct link_stage_job *job = &jobs[num_jobs++];
+      job->func = func;
+      job->ctx = ctx;
+      job->prog = prog;
+      job->stage = i;
+      util_queue_fence_init(&job->fence);
+      util_queue_add_job(&link_queue, job, &job->fence,
+                         execute_link_stage_job, NULL);
+   }
+
+   func(ctx, prog, local_stage);
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      util_queue_fence_wait(&jobs[j].fence);
+      util_queue_fence_destroy(&jobs[j].fence);
+   }
+}
+
+/**
+ * Lowering done on each stage once varyings and uniforms are linked.
+ */
+static void
+lower_linked_stage(struct gl_context *ctx, struct gl_shader_program *prog,
+                   unsigned stage)
+{
+   struct gl_linked_shader *shader = prog->_LinkedShaders[stage];
+   const struct gl_shader_compiler_options *options =
+      &ctx->Const.ShaderCompilerOptions[stage];
+
+   if (options->LowerBufferInterfaceBlocks)
+      lower_ubo_reference(shader,
+                          options->ClampBlockIndicesToArrayBounds,
+                          ctx->Const.UseSTD430AsDefaultPacking);
+
+   /* This updates the program and may report link errors, which is fine as
+    * compute shaders are never linked with other stages.
+    */
+   if (stage == MESA_SHADER_COMPUTE)
+      lower_shared_reference(ctx, prog, shader);
+
+   lower_vector_derefs(shader);
+   do_vec_index_to_swizzle(shader->ir);
+
+   /* Linking varyings can cause some extra, useless swizzles to be generated
+    * due to packing and unpacking.
+    */
+   optimize_swizzles(shader->ir);
+}
+
 static bool
 link_varyings_and_uniforms(unsigned first, unsigned last,
                            struct gl_context *ctx,
@@ -4855,24 +4993,7 @@ link_varyings_and_uniforms(unsigned first, unsigned last,
    if (!prog->data->LinkStatus)
       return false;
 
-   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
-      if (prog->_LinkedShaders[i] == NULL)
-         continue;
-
-      const struct gl_shader_compiler_options *options =
-         &ctx->Const.ShaderCompilerOptions[i];
-
-      if (options->LowerBufferInterfaceBlocks)
-         lower_ubo_reference(prog->_LinkedShaders[i],
-                             options->ClampBlockIndicesToArrayBounds,
-                             ctx->Const.UseSTD430AsDefaultPacking);
-
-      if (i == MESA_SHADER_COMPUTE)
-         lower_shared_reference(ctx, prog, prog->_LinkedShaders[i]);
-
-      lower_vector_derefs(prog->_LinkedShaders[i]);
-      do_vec_index_to_swizzle(prog->_LinkedShaders[i]->ir);
-   }
+   foreach_linked_stage(ctx, prog, lower_linked_stage);
 
    return true;
 }
@@ -4895,6 +5016,24 @@ linker_optimisation_loop(struct gl_context *ctx, exec_list *ir,
       }
 }
 
+static void
+optimize_linked_stage(struct gl_context *ctx, struct gl_shader_program *prog,
+                      unsigned stage)
+{
+   exec_list *ir = prog->_LinkedShaders[stage]->ir;
+
+   /* Call opts before lowering const arrays to uniforms so we can const
+    * propagate any elements accessed directly.
+    */
+   linker_optimisation_loop(ctx, ir, stage);
+
+   /* Call opts after lowering const arrays to copy propagate things. */
+   if (lower_const_arrays_to_uniforms(ir, stage))
+      linker_optimisation_loop(ctx, ir, stage);
+
+   propagate_invariance(ir);
+}
+
 void
 link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 {
@@ -5230,19 +5369,10 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
             goto done;
          }
       }
-
-      /* Call opts before lowering const arrays to uniforms so we can const
-       * propagate any elements accessed directly.
-       */
-      linker_optimisation_loop(ctx, prog->_LinkedShaders[i]->ir, i);
-
-      /* Call opts after lowering const arrays to copy propagate things. */
-      if (lower_const_arrays_to_uniforms(prog->_LinkedShaders[i]->ir, i))
-         linker_optimisation_loop(ctx, prog->_LinkedShaders[i]->ir, i);
-
-      propagate_invariance(prog->_LinkedShaders[i]->ir);
    }
 
+   foreach_linked_stage(ctx, prog, optimize_linked_stage);
+
    /* Validation for special cases where we allow sampler array indexing
     * with loop induction variable. This check emits a warning or error
     * depending if backend can handle dynamic indexing.
@@ -5261,16 +5391,6 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
    if(!link_varyings_and_uniforms(first, last, ctx, prog, mem_ctx))
       goto done;
 
-   /* Linking varyings can cause some extra, useless swizzles to be generated
-    * due to packing and unpacking.
-    */
-   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
-      if (prog->_LinkedShaders[i] == NULL)
-         continue;
-
-      optimize_swizzles(prog->_LinkedShaders[i]->ir);
-   }
-
    /* OpenGL ES < 3.1 requires that a vertex shader and a fragment shader both
     * be present in a linked program. GL_ARB_ES2_compatibility doesn't say
     * anything about shader linking when one of the shaders (vertex or
@@ -297,6 +297,15 @@ test_put_and_get(void)
 
    free(result);
 
+   struct disk_cache_view view;
+   expect_true(disk_cache_get_view(cache, blob_key, &view),
+               "disk_cache_get_view of existing item");
+   expect_equal_str(blob, view.data, "disk_cache_get_view of existing item "
+                    "(pointer)");
+   expect_equal(view.size, sizeof(blob), "disk_cache_get_view of existing "
+                "item (size)");
+   disk_cache_release_view(cache, &view);
+
    /* Test put and get of a second item. */
    disk_cache_compute_key(cache, string, sizeof(string), string_key);
    disk_cache_put(cache, string_key, string, sizeof(string), NULL);
@@ -442,6 +451,238 @@ test_put_and_get(void)
    disk_cache_destroy(cache);
 }
 
+static void
+test_put_and_get_pack(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   uint8_t big_keys[5][20];
+   const unsigned big_size = 200 * 1024;
+   uint8_t *big;
+   char *result;
+   size_t size;
+
+   setenv("MESA_GLSL_CACHE_PACK", "true", 1);
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1M", 1);
+   cache = disk_cache_create("test", "make_check_pack", 0);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_null(result, "pack disk_cache_get with non-existent item (pointer)");
+   expect_equal(size, 0, "pack disk_cache_get with non-existent item (size)");
+
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   wait_until_file_written(cache, blob_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "pack disk_cache_get of existing item "
+                    "(pointer)");
+   expect_equal(size, sizeof(blob), "pack disk_cache_get of existing item "
+                "(size)");
+   free(result);
+
+   struct disk_cache_view view;
+   expect_true(disk_cache_get_view(cache, blob_key, &view),
+               "pack disk_cache_get_view of existing item");
+   expect_equal_str(blob, view.data, "pack disk_cache_get_view of existing "
+                    "item (pointer)");
+   expect_equal(view.size, sizeof(blob), "pack disk_cache_get_view of "
+                "existing item (size)");
+   expect_null(view.copy, "pack disk_cache_get_view is zero-copy");
+   disk_cache_release_view(cache, &view);
+
+   /* Entries written through one cache object must be visible to another
+    * one using the same pack files.
+    */
+   disk_cache_destroy(cache);
+   cache = disk_cache_create("test", "make_check_pack", 0);
+   expect_true(does_cache_contain(cache, blob_key),
+               "pack entry survives disk_cache_destroy");
+
+   disk_cache_remove(cache, blob_key);
+   expect_true(!does_cache_contain(cache, blob_key),
+               "pack disk_cache_remove");
+
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   wait_until_file_written(cache, blob_key);
+
+   /* Use incompressible data so that each of these lands in a pack file of
+    * its own, (each pack holds a quarter of the maximum size). The fifth
+    * one has to recycle the first pack, taking the small blob with it.
+    */
+   big = malloc(big_size);
+   uint64_t seed = 0x9e3779b97f4a7c15ull;
+   for (unsigned i = 0; i < big_size; i++) {
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      big[i] = seed >> 56;
+   }
+
+   for (unsigned i = 0; i < 5; i++) {
+      big[0] = i;
+      disk_cache_compute_key(cache, big, big_size, big_keys[i]);
+
+      /* A view must stay intact when its entry gets evicted. */
+      if (i == 4) {
+         expect_true(disk_cache_get_view(cache, big_keys[0], &view),
+                     "pack disk_cache_get_view before eviction");
+      }
+
+      disk_cache_put(cache, big_keys[i], big, big_size, NULL);
+      wait_until_file_written(cache, big_keys[i]);
+   }
+
+   big[0] = 0;
+   expect_true(view.size == big_size &&
+               memcmp(view.data, big, big_size) == 0,
+               "pack view contents survive eviction");
+   disk_cache_release_view(cache, &view);
+   free(big);
+
+   expect_true(!does_cache_contain(cache, blob_key),
+               "pack eviction of the oldest pack (small item)");
+   expect_true(!does_cache_contain(cache, big_keys[0]),
+               "pack eviction of the oldest pack (big item)");
+   for (unsigned i = 1; i < 5; i++) {
+      expect_true(does_cache_contain(cache, big_keys[i]),
+                  "pack entries in newer packs survive eviction");
+   }
+
+   /* Puts are write combined, destroying the cache must not lose the ones
+    * that are still pending.
+    */
+   uint8_t combined_keys[8][20];
+   for (unsigned i = 0; i < 8; i++) {
+      char data[32];
+      snprintf(data, sizeof(data), "write combined entry %u", i);
+      disk_cache_compute_key(cache, data, sizeof(data), combined_keys[i]);
+      disk_cache_put(cache, combined_keys[i], data, sizeof(data), NULL);
+   }
+
+   disk_cache_destroy(cache);
+   cache = disk_cache_create("test", "make_check_pack", 0);
+
+   for (unsigned i = 0; i < 8; i++) {
+      expect_true(does_cache_contain(cache, combined_keys[i]),
+                  "pack write combined entries survive disk_cache_destroy");
+   }
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_GLSL_CACHE_PACK");
+}
+
+static void
+test_put_and_get_codecs(void)
+{
+   static const char *const codecs[] = { "none", "deflate", "lz4", "zstd" };
+   char data[4][64];
+   uint8_t keys[4][20];
+   struct disk_cache *cache;
+   char *result;
+   size_t size;
+
+   /* Write each entry with a different codec. Codecs that were not built in
+    * fall back to the default, which must work just as well.
+    */
+   for (unsigned i = 0; i < 4; i++) {
+      snprintf(data[i], sizeof(data[i]), "entry compressed with %s, %s",
+               codecs[i], "padded to make it compress a little bit better");
+
+      setenv("MESA_GLSL_CACHE_COMPRESSION", codecs[i], 1);
+      cache = disk_cache_create("test", "make_check_codecs", 0);
+
+      disk_cache_compute_key(cache, data[i], sizeof(data[i]), keys[i]);
+      disk_cache_put(cache, keys[i], data[i], sizeof(data[i]), NULL);
+      wait_until_file_written(cache, keys[i]);
+
+      disk_cache_destroy(cache);
+   }
+
+   /* And read them all back through a single cache object. */
+   unsetenv("MESA_GLSL_CACHE_COMPRESSION");
+   cache = disk_cache_create("test", "make_check_codecs", 0);
+
+   for (unsigned i = 0; i < 4; i++) {
+      result = disk_cache_get(cache, keys[i], &size);
+      expect_equal_str(data[i], result, "disk_cache_get of entries written "
+                       "with another codec (pointer)");
+      expect_equal(size, sizeof(data[i]), "disk_cache_get of entries written "
+                   "with another codec (size)");
+      free(result);
+   }
+
+   disk_cache_destroy(cache);
+}
+
+static void
+test_export_and_import(void)
+{
+   const char *archive = CACHE_TEST_TMP "/archive";
+   char data[3][32];
+   uint8_t keys[3][20];
+   uint8_t other_key[20];
+   struct disk_cache *cache, *other;
+   int count;
+
+   cache = disk_cache_create("test", "make_check_export", 0);
+   other = disk_cache_create("test", "make_check_export_other", 0);
+
+   for (unsigned i = 0; i < 3; i++) {
+      snprintf(data[i], sizeof(data[i]), "exported entry %u", i);
+      disk_cache_compute_key(cache, data[i], sizeof(data[i]), keys[i]);
+      disk_cache_put(cache, keys[i], data[i], sizeof(data[i]), NULL);
+      wait_until_file_written(cache, keys[i]);
+   }
+
+   /* Entries of other driver builds must not end up in the archive. */
+   disk_cache_compute_key(other, data[0], sizeof(data[0]), other_key);
+   disk_cache_put(other, other_key, data[0], sizeof(data[0]), NULL);
+   wait_until_file_written(other, other_key);
+
+   count = disk_cache_export(cache, archive);
+   expect_equal(count, 3, "disk_cache_export");
+
+   count = disk_cache_import(other, archive);
+   expect_equal(count, -1, "disk_cache_import from another driver build");
+
+   for (unsigned i = 0; i < 3; i++)
+      disk_cache_remove(cache, keys[i]);
+
+   count = disk_cache_import(cache, archive);
+   expect_equal(count, 3, "disk_cache_import");
+
+   for (unsigned i = 0; i < 3; i++) {
+      char *result = disk_cache_get(cache, keys[i], NULL);
+      expect_equal_str(data[i], result, "disk_cache_get of imported entry");
+      free(result);
+   }
+
+   disk_cache_destroy(other);
+   disk_cache_destroy(cache);
+
+   /* Archives are independent of the storage backend. */
+   setenv("MESA_GLSL_CACHE_PACK", "true", 1);
+   cache = disk_cache_create("test", "make_check_export", 0);
+
+   count = disk_cache_import(cache, archive);
+   expect_equal(count, 3, "disk_cache_import into pack files");
+
+   for (unsigned i = 0; i < 3; i++) {
+      char *result = disk_cache_get(cache, keys[i], NULL);
+      expect_equal_str(data[i], result, "disk_cache_get of entry imported "
+                       "into pack files");
+      free(result);
+   }
+
+   count = disk_cache_export(cache, archive);
+   expect_equal(count, 3, "disk_cache_export from pack files");
+
+   disk_cache_destroy(cache);
+   unsetenv("MESA_GLSL_CACHE_PACK");
+}
+
 static void
 test_put_key_and_get_key(void)
 {
@@ -507,6 +748,12 @@ main(void)
 
    test_put_key_and_get_key();
 
+   test_put_and_get_pack();
+
+   test_put_and_get_codecs();
+
+   test_export_and_import();
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
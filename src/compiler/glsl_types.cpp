@@ -26,6 +26,7 @@
 #include "compiler/glsl/glsl_parser_extras.h"
 #include "glsl_types.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
 #include "util/u_string.h"
 
 
@@ -495,6 +496,17 @@ glsl_type_singleton_decref()
       return;
    }
 
+   /* The built-in types outlive the tables below, so drop their lists of
+    * array types before those get freed.  This has to happen before any
+    * table is destroyed as the element types live in them too.
+    */
+   if (glsl_type::array_types != NULL) {
+      hash_table_foreach(glsl_type::array_types, entry) {
+         const glsl_type *t = (const glsl_type *) entry->data;
+         t->fields.array->first_array_type = NULL;
+      }
+   }
+
    if (glsl_type::explicit_matrix_types != NULL) {
       _mesa_hash_table_destroy(glsl_type::explicit_matrix_types,
                                hash_free_type_function);
@@ -989,11 +1001,34 @@ glsl_type::get_image_instance(enum glsl_sampler_dim dim,
    unreachable("switch statement above should be complete");
 }
 
+const glsl_type *
+glsl_type::find_array_instance(const glsl_type *base,
+                               unsigned array_size,
+                               unsigned explicit_stride)
+{
+   for (const glsl_type *t = p_atomic_read(&base->first_array_type);
+        t != NULL; t = t->next_array_type) {
+      if (t->length == array_size && t->explicit_stride == explicit_stride)
+         return t;
+   }
+
+   return NULL;
+}
+
 const glsl_type *
 glsl_type::get_array_instance(const glsl_type *base,
                               unsigned array_size,
                               unsigned explicit_stride)
 {
+   /* Fast path: array types of a given element type are all linked from
+    * it, so an existing type can be found without locking or building a
+    * key string.
+    */
+   const glsl_type *existing =
+      find_array_instance(base, array_size, explicit_stride);
+   if (existing != NULL)
+      return existing;
+
    /* Generate a name using the base type pointer in the key.  This is
     * done because the name of the base type may not be unique across
     * shaders.  For example, two shaders may have different record types
@@ -1012,11 +1047,19 @@ glsl_type::get_array_instance(const glsl_type *base,
 
    const struct hash_entry *entry = _mesa_hash_table_search(array_types, key);
    if (entry == NULL) {
-      const glsl_type *t = new glsl_type(base, array_size, explicit_stride);
+      glsl_type *t = new glsl_type(base, array_size, explicit_stride);
 
       entry = _mesa_hash_table_insert(array_types,
                                       strdup(key),
                                       (void *) t);
+
+      /* Publish the fully constructed type to lock-free readers.  The
+       * compare-and-swap implies a full barrier and cannot fail since all
+       * writers hold hash_mutex.
+       */
+      t->next_array_type = base->first_array_type;
+      (void) p_atomic_cmpxchg(&base->first_array_type, t->next_array_type,
+                              (const glsl_type *) t);
    }
 
    assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_ARRAY);
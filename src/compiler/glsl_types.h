@@ -995,6 +995,23 @@ private:
     */
    void *mem_ctx;
 
+   /**
+    * Array types whose element type is this type, linked through
+    * \c next_array_type.
+    *
+    * Lets \c get_array_instance find existing array types without taking
+    * \c hash_mutex.  New entries are only ever pushed at the head, with the
+    * mutex held, so readers can walk the list at any time.
+    */
+   mutable const glsl_type *first_array_type = NULL;
+
+   /** Next array type sharing the element type of this one. */
+   const glsl_type *next_array_type = NULL;
+
+   static const glsl_type *find_array_instance(const glsl_type *base,
+                                               unsigned array_size,
+                                               unsigned explicit_stride);
+
    /** Constructor for vector and matrix types */
    glsl_type(GLenum gl_type,
              glsl_base_type base_type, unsigned vector_elements,
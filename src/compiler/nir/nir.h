@@ -42,9 +42,7 @@
 #include "compiler/shader_info.h"
 #include <stdio.h>
 
-#ifndef NDEBUG
 #include "util/debug.h"
-#endif /* NDEBUG */
 
 #include "nir_opcodes.h"
 
@@ -2331,6 +2329,12 @@ typedef struct nir_shader_compiler_options {
 
    unsigned max_unroll_iterations;
 
+   /**
+    * Loops that can't be unrolled completely are partially unrolled by up to
+    * this factor.  Zero or one disables partial unrolling.
+    */
+   unsigned partial_unroll_factor;
+
    nir_lower_int64_options lower_int64_options;
    nir_lower_doubles_options lower_doubles_options;
 } nir_shader_compiler_options;
@@ -2919,6 +2923,34 @@ static inline bool should_serialize_deserialize_nir(void) { return false; }
 static inline bool should_print_nir(void) { return false; }
 #endif /* NDEBUG */
 
+/* Per pass statistics: set NIR_PASS_STATS to have NIR_PASS and NIR_PASS_V
+ * collect the time, instruction count delta and bytes allocated of every
+ * pass, reported by nir_pass_stats_report().  Unlike the options above this
+ * also works in release builds.
+ */
+static inline bool
+should_collect_nir_pass_stats(void)
+{
+   static int collect = -1;
+   if (collect < 0)
+      collect = env_var_as_boolean("NIR_PASS_STATS", false);
+
+   return collect;
+}
+
+struct nir_pass_stats_sample {
+   int64_t start_ns;
+   unsigned num_instrs;
+   uint64_t alloc_bytes;
+};
+
+void nir_pass_stats_begin(nir_shader *shader,
+                          struct nir_pass_stats_sample *sample);
+void nir_pass_stats_end(nir_shader *shader, const char *pass_name,
+                        const struct nir_pass_stats_sample *sample,
+                        bool progress);
+void nir_pass_stats_report(void);
+
 #define _PASS(pass, nir, do_pass) do {                               \
    if (should_skip_nir(#pass)) {                                     \
       printf("skipping %s\n", #pass);                                \
@@ -2938,10 +2970,16 @@ static inline bool should_print_nir(void) { return false; }
 } while (0)
 
 #define NIR_PASS(progress, nir, pass, ...) _PASS(pass, nir,          \
+   struct nir_pass_stats_sample _stats;                              \
    nir_metadata_set_validation_flag(nir);                            \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
-   if (pass(nir, ##__VA_ARGS__)) {                                   \
+   if (should_collect_nir_pass_stats())                              \
+      nir_pass_stats_begin(nir, &_stats);                            \
+   bool _progress = pass(nir, ##__VA_ARGS__);                        \
+   if (should_collect_nir_pass_stats())                              \
+      nir_pass_stats_end(nir, #pass, &_stats, _progress);            \
+   if (_progress) {                                                  \
       progress = true;                                               \
       if (should_print_nir())                                        \
          nir_print_shader(nir, stdout);                              \
@@ -2950,9 +2988,14 @@ static inline bool should_print_nir(void) { return false; }
 )
 
 #define NIR_PASS_V(nir, pass, ...) _PASS(pass, nir,                  \
+   struct nir_pass_stats_sample _stats;                              \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
+   if (should_collect_nir_pass_stats())                              \
+      nir_pass_stats_begin(nir, &_stats);                            \
    pass(nir, ##__VA_ARGS__);                                         \
+   if (should_collect_nir_pass_stats())                              \
+      nir_pass_stats_end(nir, #pass, &_stats, false);                \
    if (should_print_nir())                                           \
       nir_print_shader(nir, stdout);                                 \
 )
@@ -3433,6 +3476,21 @@ void nir_live_ssa_defs_impl(nir_function_impl *impl);
 void nir_loop_analyze_impl(nir_function_impl *impl,
                            nir_variable_mode indirect_mask);
 
+typedef enum {
+   /* All invocations of a subgroup belong to the same primitive, so
+    * primitive_id and flat fragment shader inputs are uniform.
+    */
+   nir_divergence_single_prim_per_subgroup = (1 << 0),
+   /* All invocations of a tessellation evaluation subgroup belong to the
+    * same patch, so per-patch inputs are uniform.
+    */
+   nir_divergence_single_patch_per_tes_subgroup = (1 << 1),
+   nir_divergence_view_index_uniform = (1 << 2),
+} nir_divergence_options;
+
+bool *nir_divergence_analysis_impl(nir_function_impl *impl,
+                                   nir_divergence_options options);
+
 bool nir_ssa_defs_interfere(nir_ssa_def *a, nir_ssa_def *b);
 
 bool nir_repair_ssa_impl(nir_function_impl *impl);
@@ -3476,7 +3534,8 @@ bool nir_opt_deref(nir_shader *shader);
 
 bool nir_opt_find_array_copies(nir_shader *shader);
 
-bool nir_opt_gcm(nir_shader *shader, bool value_number);
+bool nir_opt_gcm(nir_shader *shader, bool value_number,
+                 unsigned max_pressure);
 
 bool nir_opt_idiv_const(nir_shader *shader, unsigned min_bit_size);
 
@@ -3488,6 +3547,15 @@ bool nir_opt_large_constants(nir_shader *shader,
                              glsl_type_size_align_func size_align,
                              unsigned threshold);
 
+typedef bool (*nir_should_vectorize_mem_func)(unsigned align, unsigned bit_size,
+                                              unsigned num_components,
+                                              unsigned high_offset,
+                                              nir_intrinsic_instr *low,
+                                              nir_intrinsic_instr *high);
+
+bool nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                                  nir_should_vectorize_mem_func callback);
+
 bool nir_opt_loop_unroll(nir_shader *shader, nir_variable_mode indirect_mask);
 
 bool nir_opt_move_comparisons(nir_shader *shader);
@@ -3511,6 +3579,11 @@ void nir_strip(nir_shader *shader);
 
 void nir_sweep(nir_shader *shader);
 
+typedef bool (*nir_impl_pass)(nir_function_impl *impl, void *data);
+
+bool nir_shader_run_impl_pass_parallel(nir_shader *shader, nir_impl_pass pass,
+                                       void *data, unsigned num_threads);
+
 void nir_remap_dual_slot_attributes(nir_shader *shader,
                                     uint64_t *dual_slot_inputs);
 uint64_t nir_get_single_slot_attribs_mask(uint64_t attribs, uint64_t dual_slot);
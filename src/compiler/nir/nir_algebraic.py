@@ -692,96 +692,302 @@ class SearchAndReplace(object):
 
       BitSizeValidator(varset).validate(self.search, self.replace)
 
+def _search_opcode(opcode):
+   """Returns the opcode the automaton uses for \p opcode.
+
+   All sized variants of the conversions in conv_opcode_types, like f2b32,
+   are folded into the unsized search opcode, like nir_search_op_f2b.  This
+   must agree with nir_search_op_for_nir_op() in nir_search.c.
+   """
+   stripped = opcode.rstrip('0123456789')
+   if stripped in conv_opcode_types:
+      return stripped
+   return opcode
+
+def _search_opcode_to_c(opcode):
+   if opcode in conv_opcode_types:
+      return 'nir_search_op_' + opcode
+   else:
+      return 'nir_op_' + opcode
+
+class TreeAutomaton(object):
+   """A bottom-up tree automaton matching the search expressions of a pass.
+
+   Every SSA value is assigned a state such that the state of an ALU
+   instruction only depends on its opcode and the states of its sources.
+   Each state comes with the list of transforms whose search expression
+   may match a value in that state, so at runtime the state of an
+   instruction is computed with one table lookup per source, and only those
+   transforms are tried instead of every transform for the opcode.
+
+   The automaton only looks at opcodes and at whether a value is a
+   constant.  It deliberately ignores constant values, variable identity,
+   bit sizes and conditions: the states are a filter, and nir_search still
+   runs the full match on the remaining candidates.
+
+   The construction is the usual subset construction generalized to trees:
+   a state is the set of pattern subtrees ("items") a value can match.  To
+   keep the tables small, the states of the sources are first projected
+   ("filtered") for each opcode onto the items that actually appear as a
+   source of that opcode, and the transition table of the opcode is indexed
+   by the filtered states.
+   """
+
+   class IndexMap(object):
+      """A list that can also map its entries back to their index."""
+
+      def __init__(self):
+         self.objects = []
+         self.map = {}
+
+      def __getitem__(self, i):
+         return self.objects[i]
+
+      def __contains__(self, obj):
+         return obj in self.map
+
+      def __len__(self):
+         return len(self.objects)
+
+      def __iter__(self):
+         return iter(self.objects)
+
+      def clear(self):
+         self.objects = []
+         self.map.clear()
+
+      def index(self, obj):
+         return self.map[obj]
+
+      def add(self, obj):
+         if obj in self.map:
+            return self.map[obj]
+
+         index = len(self.objects)
+         self.objects.append(obj)
+         self.map[obj] = index
+         return index
+
+   class Item(object):
+      """A subtree of one or more search expressions.
+
+      Identical subtrees are shared between patterns.  Constants and
+      variables are all collapsed into the two leaf items "const" and
+      "wildcard".
+      """
+
+      def __init__(self, opcode, children):
+         self.opcode = opcode
+         self.children = children
+         # The transforms for which this item is the whole search expression.
+         self.patterns = []
+         # The opcodes of the items that have this item as a source.
+         self.parent_ops = set()
+
+   def __init__(self, transforms):
+      self.patterns = [t.search for t in transforms]
+      self._compute_items()
+      self._build_table()
+
+   def _compute_items(self):
+      # Map from (opcode, children) to item.  Commutative operations get an
+      # entry for both orders of their first two sources.
+      self.items = {}
+
+      # All opcodes used by the patterns, in a stable order.  No tables are
+      # emitted for any other opcode.
+      self.opcodes = self.IndexMap()
+
+      def get_item(opcode, children, pattern=None):
+         key = (opcode, children)
+         if key not in self.items:
+            self.items[key] = self.Item(opcode, children)
+         item = self.items[key]
+
+         if len(children) >= 2 and opcode not in conv_opcode_types and \
+            "commutative" in opcodes[opcode].algebraic_properties:
+            swapped = (children[1], children[0]) + children[2:]
+            self.items.setdefault((opcode, swapped), item)
+
+         if pattern is not None:
+            item.patterns.append(pattern)
+         return item
+
+      self.wildcard = get_item("__wildcard", ())
+      self.const = get_item("__const", ())
+
+      def process_subpattern(src, pattern=None):
+         if isinstance(src, Constant):
+            return self.const
+         elif isinstance(src, Variable):
+            return self.const if src.is_constant else self.wildcard
+
+         assert isinstance(src, Expression)
+         opcode = _search_opcode(src.opcode)
+         self.opcodes.add(opcode)
+         children = tuple(process_subpattern(c) for c in src.sources)
+         item = get_item(opcode, children, pattern)
+         for child in children:
+            child.parent_ops.add(opcode)
+         return item
+
+      for i, pattern in enumerate(self.patterns):
+         process_subpattern(pattern, i)
+
+   def _num_srcs(self, opcode):
+      if opcode in conv_opcode_types:
+         return 1
+      return opcodes[opcode].num_inputs
+
+   def _build_table(self):
+      # All states found so far.  A state is a frozenset of items.
+      self.states = self.IndexMap()
+      # For each state, the sorted indices of the patterns it may match.
+      self.state_patterns = []
+      # For each opcode, the filtered state index of every state.
+      self.filter = defaultdict(list)
+      # For each opcode, all filtered states found so far.
+      self.rep = defaultdict(self.IndexMap)
+      # For each opcode, map from tuples of filtered source states to the
+      # resulting state.
+      self.table = defaultdict(dict)
+
+      # States and filtered states past these indices have not had their
+      # transitions computed yet.
+      state_worklist_index = [0]
+      rep_worklist_index = defaultdict(int)
+
+      # The opcodes that have filtered states on their worklist.
+      new_opcodes = self.IndexMap()
+
+      def process_new_states():
+         while state_worklist_index[0] < len(self.states):
+            state = self.states[state_worklist_index[0]]
+
+            # Each pattern only has one root item, so there are no
+            # duplicates.  Sorting keeps the transforms in source order.
+            self.state_patterns.append(
+               sorted(p for item in state for p in item.patterns))
+
+            for op in self.opcodes:
+               rep = self.rep[op]
+               filtered = frozenset(item for item in state
+                                    if op in item.parent_ops)
+               if filtered not in rep:
+                  new_opcodes.add(op)
+               self.filter[op].append(rep.add(filtered))
+
+            state_worklist_index[0] += 1
+
+      # The two initial states must match WILDCARD_STATE and CONST_STATE in
+      # nir_search.c: anything that isn't an ALU instruction or a constant,
+      # and load_const instructions.
+      self.states.add(frozenset((self.wildcard,)))
+      self.states.add(frozenset((self.const, self.wildcard)))
+      process_new_states()
+
+      while len(new_opcodes) > 0:
+         for op in new_opcodes:
+            rep = self.rep[op]
+            table = self.table[op]
+            old_reps = rep_worklist_index[op]
+
+            # Compute the transitions of every combination of sources that
+            # involves at least one new filtered state.
+            for src_indices in itertools.product(range(len(rep)),
+                                                 repeat=self._num_srcs(op)):
+               if all(i < old_reps for i in src_indices):
+                  continue
+
+               srcs = tuple(rep[i] for i in src_indices)
+               parent = set(self.items[op, item_srcs]
+                            for item_srcs in itertools.product(*srcs)
+                            if (op, item_srcs) in self.items)
+
+               # Any value can be the start of a match as a variable.
+               parent.add(self.wildcard)
+
+               table[src_indices] = self.states.add(frozenset(parent))
+
+            rep_worklist_index[op] = len(rep)
+
+         new_opcodes.clear()
+         process_new_states()
+
+   def table_values(self, opcode):
+      """Returns the transition table of \p opcode flattened in the order
+      nir_search.c indexes it: the first source is the most significant.
+      """
+      num_reps = len(self.rep[opcode])
+      return [self.table[opcode][indices] for indices in
+              itertools.product(range(num_reps),
+                                repeat=self._num_srcs(opcode))]
+
 _algebraic_pass_template = mako.template.Template("""
 #include "nir.h"
 #include "nir_builder.h"
 #include "nir_search.h"
 #include "nir_search_helpers.h"
 
-#ifndef NIR_OPT_ALGEBRAIC_STRUCT_DEFS
-#define NIR_OPT_ALGEBRAIC_STRUCT_DEFS
-
-struct transform {
-   const nir_search_expression *search;
-   const nir_search_value *replace;
-   unsigned condition_offset;
-};
-
-#endif
-
 <% cache = {} %>
 % for xform in xforms:
    ${xform.search.render(cache)}
    ${xform.replace.render(cache)}
 % endfor
 
-% for (opcode, xform_list) in sorted(opcode_xforms.items()):
-static const struct transform ${pass_name}_${opcode}_xforms[] = {
-% for xform in xform_list:
-   { ${xform.search.c_ptr(cache)}, ${xform.replace.c_value_ptr(cache)}, ${xform.condition_index} },
+% for state_id, state_xforms in enumerate(automaton.state_patterns):
+% if state_xforms:
+static const struct transform ${pass_name}_state${state_id}_xforms[] = {
+% for i in state_xforms:
+   { ${xforms[i].search.c_ptr(cache)}, ${xforms[i].replace.c_value_ptr(cache)}, ${xforms[i].condition_index} },
 % endfor
 };
+% endif
 % endfor
 
-static bool
-${pass_name}_block(nir_builder *build, nir_block *block,
-                   const bool *condition_flags)
-{
-   bool progress = false;
-
-   nir_foreach_instr_reverse_safe(instr, block) {
-      if (instr->type != nir_instr_type_alu)
-         continue;
-
-      nir_alu_instr *alu = nir_instr_as_alu(instr);
-      if (!alu->dest.dest.is_ssa)
-         continue;
-
-      switch (alu->op) {
-      % for opcode in sorted(opcode_xforms.keys()):
-      case nir_op_${opcode}:
-         for (unsigned i = 0; i < ARRAY_SIZE(${pass_name}_${opcode}_xforms); i++) {
-            const struct transform *xform = &${pass_name}_${opcode}_xforms[i];
-            if (condition_flags[xform->condition_offset] &&
-                nir_replace_instr(build, alu, xform->search, xform->replace)) {
-               progress = true;
-               break;
-            }
-         }
-         break;
-      % endfor
-      default:
-         break;
-      }
-   }
-
-   return progress;
-}
-
-static bool
-${pass_name}_impl(nir_function_impl *impl, const bool *condition_flags)
-{
-   bool progress = false;
-
-   nir_builder build;
-   nir_builder_init(&build, impl);
+static const struct transform *${pass_name}_transforms[] = {
+% for state_id, state_xforms in enumerate(automaton.state_patterns):
+% if state_xforms:
+   ${pass_name}_state${state_id}_xforms,
+% else:
+   NULL,
+% endif
+% endfor
+};
 
-   nir_foreach_block_reverse(block, impl) {
-      progress |= ${pass_name}_block(&build, block, condition_flags);
-   }
+static const uint16_t ${pass_name}_transform_counts[] = {
+% for state_id, state_xforms in enumerate(automaton.state_patterns):
+% if state_xforms:
+   (uint16_t)ARRAY_SIZE(${pass_name}_state${state_id}_xforms),
+% else:
+   0,
+% endif
+% endfor
+};
 
-   if (progress) {
-      nir_metadata_preserve(impl, nir_metadata_block_index |
-                                  nir_metadata_dominance);
-    } else {
-#ifndef NDEBUG
-      impl->valid_metadata &= ~nir_metadata_not_properly_reset;
-#endif
-    }
+% for op in automaton.opcodes:
+static const uint16_t ${pass_name}_${op}_filter[] = {
+% for e in automaton.filter[op]:
+   ${e},
+% endfor
+};
 
-   return progress;
-}
+static const uint16_t ${pass_name}_${op}_table[] = {
+% for e in automaton.table_values(op):
+   ${e},
+% endfor
+};
 
+% endfor
+static const struct per_op_table ${pass_name}_table[nir_num_search_ops] = {
+% for op in automaton.opcodes:
+   [${search_opcode_to_c(op)}] = {
+      .filter = ${pass_name}_${op}_filter,
+      .num_filtered_states = ${len(automaton.rep[op])},
+      .table = ${pass_name}_${op}_table,
+   },
+% endfor
+};
 
 bool
 ${pass_name}(nir_shader *shader)
@@ -799,7 +1005,10 @@ ${pass_name}(nir_shader *shader)
 
    nir_foreach_function(function, shader) {
       if (function->impl)
-         progress |= ${pass_name}_impl(function->impl, condition_flags);
+         progress |= nir_algebraic_impl(function->impl, condition_flags,
+                                        ${pass_name}_transforms,
+                                        ${pass_name}_transform_counts,
+                                        ${pass_name}_table);
    }
 
    return progress;
@@ -809,7 +1018,6 @@ ${pass_name}(nir_shader *shader)
 class AlgebraicPass(object):
    def __init__(self, pass_name, transforms):
       self.xforms = []
-      self.opcode_xforms = defaultdict(lambda : [])
       self.pass_name = pass_name
 
       error = False
@@ -827,20 +1035,16 @@ class AlgebraicPass(object):
                continue
 
          self.xforms.append(xform)
-         if xform.search.opcode in conv_opcode_types:
-            dst_type = conv_opcode_types[xform.search.opcode]
-            for size in type_sizes(dst_type):
-               sized_opcode = xform.search.opcode + str(size)
-               self.opcode_xforms[sized_opcode].append(xform)
-         else:
-            self.opcode_xforms[xform.search.opcode].append(xform)
 
       if error:
          sys.exit(1)
 
+      self.automaton = TreeAutomaton(self.xforms)
+
 
    def render(self):
       return _algebraic_pass_template.render(pass_name=self.pass_name,
                                              xforms=self.xforms,
-                                             opcode_xforms=self.opcode_xforms,
+                                             automaton=self.automaton,
+                                             search_opcode_to_c=_search_opcode_to_c,
                                              condition_list=condition_list)
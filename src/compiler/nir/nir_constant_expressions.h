@@ -34,4 +34,6 @@ void nir_eval_const_opcode(nir_op op, nir_const_value *dest,
                            unsigned num_components, unsigned bit_size,
                            nir_const_value **src);
 
+bool nir_eval_const_alu_instr(nir_alu_instr *instr, nir_const_value *dest);
+
 #endif /* NIR_CONSTANT_EXPRESSIONS_H */
@@ -0,0 +1,541 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+
+/*
+ * Divergence analysis.
+ *
+ * An SSA value is uniform if all invocations of a subgroup which are active
+ * where it is defined compute the same value for it, and divergent
+ * otherwise.  Values start out uniform and are marked divergent until a fixed
+ * point is reached; a value never becomes uniform again.
+ *
+ * Besides data flow, control flow makes values divergent:
+ *
+ *  - phis after an if with a divergent condition merge values computed by
+ *    different invocations;
+ *  - phis at the top of a loop are divergent if some invocations may
+ *    continue early, as they join back from a different iteration point;
+ *  - values used after a loop that invocations may leave at different
+ *    iterations are divergent.
+ *
+ * A break or continue is divergent if it is nested in an if with a divergent
+ * condition inside its loop, or follows such a jump in the same iteration.
+ */
+
+struct divergence_state {
+   bool *divergent;
+   const nir_shader *shader;
+   nir_divergence_options options;
+
+   /* Whether some if between the innermost loop and the current instruction
+    * has a divergent condition.
+    */
+   bool divergent_cf;
+
+   /* Whether some invocations may have left the current loop iteration. */
+   bool divergent_loop_cf;
+
+   /* Whether a jump was seen in divergent control flow in the current loop
+    * iteration.
+    */
+   bool divergent_jump;
+
+   /* Properties of the innermost loop */
+   bool divergent_continue;
+   bool divergent_break;
+
+   /* Whether the loop preceding the current block has divergent breaks */
+   bool prev_loop_divergent_break;
+};
+
+static bool visit_cf_list(struct exec_list *list,
+                          struct divergence_state *state);
+
+static bool
+src_divergent(nir_src src, struct divergence_state *state)
+{
+   /* Registers may be written in divergent control flow */
+   if (!src.is_ssa)
+      return true;
+
+   return state->divergent[src.ssa->index];
+}
+
+static bool
+set_divergent(nir_ssa_def *def, bool divergent, struct divergence_state *state)
+{
+   if (!divergent || state->divergent[def->index])
+      return false;
+
+   state->divergent[def->index] = true;
+   return true;
+}
+
+static bool
+visit_alu(nir_alu_instr *instr, struct divergence_state *state)
+{
+   if (!instr->dest.dest.is_ssa)
+      return false;
+
+   bool divergent = false;
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++)
+      divergent |= src_divergent(instr->src[i].src, state);
+
+   return set_divergent(&instr->dest.dest.ssa, divergent, state);
+}
+
+static bool
+intrinsic_srcs_divergent(nir_intrinsic_instr *instr,
+                         struct divergence_state *state)
+{
+   unsigned num_srcs = nir_intrinsic_infos[instr->intrinsic].num_srcs;
+   for (unsigned i = 0; i < num_srcs; i++) {
+      if (src_divergent(instr->src[i], state))
+         return true;
+   }
+
+   return false;
+}
+
+static bool
+intrinsic_is_divergent(nir_intrinsic_instr *instr,
+                       struct divergence_state *state)
+{
+   gl_shader_stage stage = state->shader->info.stage;
+
+   switch (instr->intrinsic) {
+   /* Values which are the same for the whole draw or dispatch, or at least
+    * for the subgroup.
+    */
+   case nir_intrinsic_load_subgroup_size:
+   case nir_intrinsic_load_num_subgroups:
+   case nir_intrinsic_load_subgroup_id:
+   case nir_intrinsic_load_work_group_id:
+   case nir_intrinsic_load_num_work_groups:
+   case nir_intrinsic_load_local_group_size:
+   case nir_intrinsic_load_work_dim:
+   case nir_intrinsic_load_base_instance:
+   case nir_intrinsic_load_base_vertex:
+   case nir_intrinsic_load_first_vertex:
+   case nir_intrinsic_load_draw_id:
+   case nir_intrinsic_load_is_indexed_draw:
+   case nir_intrinsic_load_patch_vertices_in:
+   case nir_intrinsic_load_user_clip_plane:
+   case nir_intrinsic_load_alpha_ref_float:
+   case nir_intrinsic_load_viewport_x_scale:
+   case nir_intrinsic_load_viewport_y_scale:
+   case nir_intrinsic_load_viewport_z_scale:
+   case nir_intrinsic_load_viewport_z_offset:
+   case nir_intrinsic_load_viewport_scale:
+   case nir_intrinsic_load_viewport_offset:
+   case nir_intrinsic_load_blend_const_color_r_float:
+   case nir_intrinsic_load_blend_const_color_g_float:
+   case nir_intrinsic_load_blend_const_color_b_float:
+   case nir_intrinsic_load_blend_const_color_a_float:
+   case nir_intrinsic_load_blend_const_color_rgba8888_unorm:
+   case nir_intrinsic_load_blend_const_color_aaaa8888_unorm:
+      return false;
+
+   case nir_intrinsic_load_primitive_id:
+   case nir_intrinsic_load_layer_id:
+      return !(state->options & nir_divergence_single_prim_per_subgroup);
+
+   case nir_intrinsic_load_view_index:
+      return !(state->options & nir_divergence_view_index_uniform);
+
+   case nir_intrinsic_load_input:
+      /* Fragment shader inputs are only loaded with load_input when they are
+       * flat if interpolated inputs use their own intrinsic.  Tessellation
+       * evaluation shaders load per-vertex inputs with load_per_vertex_input.
+       */
+      if (stage == MESA_SHADER_FRAGMENT) {
+         if (!state->shader->options->use_interpolated_input_intrinsics ||
+             !(state->options & nir_divergence_single_prim_per_subgroup))
+            return true;
+      } else if (stage == MESA_SHADER_TESS_EVAL) {
+         if (!(state->options & nir_divergence_single_patch_per_tes_subgroup))
+            return true;
+      } else {
+         return true;
+      }
+      return intrinsic_srcs_divergent(instr, state);
+
+   /* Loads from memory which can't be written by the shader and other values
+    * only depending on their sources.
+    */
+   case nir_intrinsic_load_uniform:
+   case nir_intrinsic_load_ubo:
+   case nir_intrinsic_load_push_constant:
+   case nir_intrinsic_load_constant:
+   case nir_intrinsic_load_kernel_input:
+   case nir_intrinsic_vulkan_resource_index:
+   case nir_intrinsic_vulkan_resource_reindex:
+   case nir_intrinsic_load_vulkan_descriptor:
+   case nir_intrinsic_get_buffer_size:
+   case nir_intrinsic_deref_buffer_array_length:
+   case nir_intrinsic_image_deref_size:
+   case nir_intrinsic_image_deref_samples:
+   case nir_intrinsic_image_size:
+   case nir_intrinsic_image_samples:
+   case nir_intrinsic_bindless_image_size:
+   case nir_intrinsic_bindless_image_samples:
+   case nir_intrinsic_ballot_bitfield_extract:
+   case nir_intrinsic_ballot_bit_count_reduce:
+   case nir_intrinsic_ballot_find_lsb:
+   case nir_intrinsic_ballot_find_msb:
+      return intrinsic_srcs_divergent(instr, state);
+
+   case nir_intrinsic_load_deref: {
+      nir_deref_instr *deref = nir_src_as_deref(instr->src[0]);
+      if (!(deref->mode & (nir_var_uniform | nir_var_mem_ubo)))
+         return true;
+      return intrinsic_srcs_divergent(instr, state);
+   }
+
+   /* Subgroup operations returning the same value to all invocations */
+   case nir_intrinsic_ballot:
+   case nir_intrinsic_read_first_invocation:
+   case nir_intrinsic_first_invocation:
+   case nir_intrinsic_vote_any:
+   case nir_intrinsic_vote_all:
+   case nir_intrinsic_vote_feq:
+   case nir_intrinsic_vote_ieq:
+      return false;
+
+   case nir_intrinsic_read_invocation:
+      return src_divergent(instr->src[0], state) &&
+             src_divergent(instr->src[1], state);
+
+   case nir_intrinsic_reduce:
+      if (nir_intrinsic_cluster_size(instr) == 0)
+         return false;
+      return src_divergent(instr->src[0], state);
+
+   /* Reading a uniform value from any other invocation gives the same
+    * result.
+    */
+   case nir_intrinsic_shuffle:
+   case nir_intrinsic_shuffle_xor:
+   case nir_intrinsic_shuffle_up:
+   case nir_intrinsic_shuffle_down:
+   case nir_intrinsic_quad_broadcast:
+   case nir_intrinsic_quad_swap_horizontal:
+   case nir_intrinsic_quad_swap_vertical:
+   case nir_intrinsic_quad_swap_diagonal:
+      return src_divergent(instr->src[0], state);
+
+   default:
+      return true;
+   }
+}
+
+static bool
+visit_intrinsic(nir_intrinsic_instr *instr, struct divergence_state *state)
+{
+   if (!nir_intrinsic_infos[instr->intrinsic].has_dest ||
+       !instr->dest.is_ssa)
+      return false;
+
+   return set_divergent(&instr->dest.ssa,
+                        intrinsic_is_divergent(instr, state), state);
+}
+
+static bool
+visit_tex(nir_tex_instr *instr, struct divergence_state *state)
+{
+   if (!instr->dest.is_ssa)
+      return false;
+
+   bool divergent = false;
+   for (unsigned i = 0; i < instr->num_srcs; i++)
+      divergent |= src_divergent(instr->src[i].src, state);
+
+   return set_divergent(&instr->dest.ssa, divergent, state);
+}
+
+static bool
+visit_deref(nir_deref_instr *deref, struct divergence_state *state)
+{
+   if (!deref->dest.is_ssa)
+      return false;
+
+   bool divergent = false;
+   if (deref->deref_type != nir_deref_type_var)
+      divergent |= src_divergent(deref->parent, state);
+
+   if (deref->deref_type == nir_deref_type_array ||
+       deref->deref_type == nir_deref_type_ptr_as_array)
+      divergent |= src_divergent(deref->arr.index, state);
+
+   return set_divergent(&deref->dest.ssa, divergent, state);
+}
+
+static bool
+visit_phi(nir_phi_instr *phi, struct divergence_state *state)
+{
+   if (!phi->dest.is_ssa)
+      return false;
+
+   bool divergent = false;
+   nir_foreach_phi_src(src, phi)
+      divergent |= src_divergent(src->src, state);
+
+   nir_cf_node *prev = nir_cf_node_prev(&phi->instr.block->cf_node);
+   if (prev == NULL) {
+      /* Invocations which continued early join the others at the top of
+       * the loop.
+       */
+      assert(phi->instr.block->cf_node.parent->type == nir_cf_node_loop);
+      divergent |= state->divergent_continue;
+   } else if (prev->type == nir_cf_node_if) {
+      divergent |= src_divergent(nir_cf_node_as_if(prev)->condition, state);
+   } else {
+      assert(prev->type == nir_cf_node_loop);
+      divergent |= state->prev_loop_divergent_break;
+   }
+
+   return set_divergent(&phi->dest.ssa, divergent, state);
+}
+
+static void
+visit_jump(nir_jump_instr *jump, struct divergence_state *state)
+{
+   if (!state->divergent_cf && !state->divergent_loop_cf)
+      return;
+
+   if (jump->type == nir_jump_continue)
+      state->divergent_continue = true;
+   else
+      state->divergent_break = true;
+
+   if (state->divergent_cf)
+      state->divergent_jump = true;
+}
+
+struct set_divergent_state {
+   struct divergence_state *state;
+   bool progress;
+};
+
+static bool
+set_def_divergent(nir_ssa_def *def, void *_sd)
+{
+   struct set_divergent_state *sd = _sd;
+   sd->progress |= set_divergent(def, true, sd->state);
+   return true;
+}
+
+static bool
+visit_block(nir_block *block, struct divergence_state *state)
+{
+   bool progress = false;
+
+   nir_foreach_instr(instr, block) {
+      switch (instr->type) {
+      case nir_instr_type_alu:
+         progress |= visit_alu(nir_instr_as_alu(instr), state);
+         break;
+      case nir_instr_type_intrinsic:
+         progress |= visit_intrinsic(nir_instr_as_intrinsic(instr), state);
+         break;
+      case nir_instr_type_tex:
+         progress |= visit_tex(nir_instr_as_tex(instr), state);
+         break;
+      case nir_instr_type_deref:
+         progress |= visit_deref(nir_instr_as_deref(instr), state);
+         break;
+      case nir_instr_type_phi:
+         progress |= visit_phi(nir_instr_as_phi(instr), state);
+         break;
+      case nir_instr_type_jump:
+         visit_jump(nir_instr_as_jump(instr), state);
+         break;
+      case nir_instr_type_load_const:
+      case nir_instr_type_ssa_undef:
+         break;
+      default: {
+         /* Be conservative about anything else */
+         struct set_divergent_state sd = { state, false };
+         nir_foreach_ssa_def(instr, set_def_divergent, &sd);
+         progress |= sd.progress;
+         break;
+      }
+      }
+   }
+
+   return progress;
+}
+
+static bool
+visit_if(nir_if *nif, struct divergence_state *state)
+{
+   bool progress = false;
+   bool divergent_cf = state->divergent_cf;
+
+   state->divergent_cf |= src_divergent(nif->condition, state);
+   progress |= visit_cf_list(&nif->then_list, state);
+   progress |= visit_cf_list(&nif->else_list, state);
+   state->divergent_cf = divergent_cf;
+
+   /* Only some invocations reach what follows the if anymore. */
+   if (state->divergent_jump)
+      state->divergent_loop_cf = true;
+
+   return progress;
+}
+
+struct live_out_state {
+   struct divergence_state *state;
+   unsigned first_block;
+   unsigned last_block;
+   bool progress;
+};
+
+static bool
+block_in_range(const nir_block *block, const struct live_out_state *lo)
+{
+   return block->index >= lo->first_block && block->index <= lo->last_block;
+}
+
+static bool
+mark_live_out_divergent(nir_ssa_def *def, void *_lo)
+{
+   struct live_out_state *lo = _lo;
+   bool live_out = false;
+
+   nir_foreach_use(use, def) {
+      if (!block_in_range(use->parent_instr->block, lo))
+         live_out = true;
+   }
+
+   nir_foreach_if_use(use, def) {
+      nir_block *block =
+         nir_cf_node_as_block(nir_cf_node_prev(&use->parent_if->cf_node));
+      if (!block_in_range(block, lo))
+         live_out = true;
+   }
+
+   lo->progress |= set_divergent(def, live_out, lo->state);
+   return true;
+}
+
+/* Invocations leave a loop with divergent breaks at different iterations, so
+ * values used after the loop differ between them.
+ */
+static bool
+mark_loop_live_outs_divergent(nir_loop *loop, struct divergence_state *state)
+{
+   struct live_out_state lo = {
+      .state = state,
+      .first_block = nir_loop_first_block(loop)->index,
+      .last_block = nir_loop_last_block(loop)->index,
+   };
+
+   nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, mark_live_out_divergent, &lo);
+   }
+
+   return lo.progress;
+}
+
+static bool
+visit_loop(nir_loop *loop, struct divergence_state *state)
+{
+   struct divergence_state loop_state = *state;
+   loop_state.divergent_cf = false;
+   loop_state.divergent_continue = false;
+   loop_state.divergent_break = false;
+
+   bool progress = false;
+   bool repeat;
+   do {
+      bool divergent_continue = loop_state.divergent_continue;
+
+      loop_state.divergent_loop_cf = false;
+      loop_state.divergent_jump = false;
+      repeat = visit_cf_list(&loop->body, &loop_state);
+
+      if (loop_state.divergent_break)
+         repeat |= mark_loop_live_outs_divergent(loop, &loop_state);
+
+      /* The phis at the top of the loop need another look */
+      repeat |= divergent_continue != loop_state.divergent_continue;
+      progress |= repeat;
+   } while (repeat);
+
+   state->prev_loop_divergent_break = loop_state.divergent_break;
+
+   return progress;
+}
+
+static bool
+visit_cf_list(struct exec_list *list, struct divergence_state *state)
+{
+   bool progress = false;
+
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         progress |= visit_block(nir_cf_node_as_block(node), state);
+         break;
+      case nir_cf_node_if:
+         progress |= visit_if(nir_cf_node_as_if(node), state);
+         break;
+      case nir_cf_node_loop:
+         progress |= visit_loop(nir_cf_node_as_loop(node), state);
+         break;
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return progress;
+}
+
+/**
+ * Computes which SSA values of \p impl are divergent.
+ *
+ * The SSA defs are re-indexed and the result is an array allocated on the
+ * impl, which is true for the index of every divergent def.  It is only
+ * valid until the impl is changed.
+ */
+bool *
+nir_divergence_analysis_impl(nir_function_impl *impl,
+                             nir_divergence_options options)
+{
+   nir_metadata_require(impl, nir_metadata_block_index);
+   nir_index_ssa_defs(impl);
+
+   struct divergence_state state = {
+      .divergent = rzalloc_array(impl, bool, impl->ssa_alloc),
+      .shader = impl->function->shader,
+      .options = options,
+   };
+
+   visit_cf_list(&impl->body, &state);
+
+   return state.divergent;
+}
@@ -125,16 +125,18 @@ calc_dom_frontier(nir_block *block)
 static void
 calc_dom_children(nir_function_impl* impl)
 {
-   void *mem_ctx = ralloc_parent(impl);
-
    nir_foreach_block(block, impl) {
       if (block->imm_dom)
          block->imm_dom->num_dom_children++;
    }
 
    nir_foreach_block(block, impl) {
-      block->dom_children = ralloc_array(mem_ctx, nir_block *,
-                                         block->num_dom_children);
+      /* Reuse the previous array so that recomputing dominance over and
+       * over in an optimization loop doesn't keep leaking memory until the
+       * next nir_sweep().
+       */
+      block->dom_children = reralloc(block, block->dom_children, nir_block *,
+                                     block->num_dom_children);
       block->num_dom_children = 0;
    }
 
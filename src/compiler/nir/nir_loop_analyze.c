@@ -1164,7 +1164,7 @@ process_loops(nir_cf_node *cf_node, nir_variable_mode indirect_mask)
 
    nir_loop *loop = nir_cf_node_as_loop(cf_node);
    nir_function_impl *impl = nir_cf_node_get_function(cf_node);
-   void *mem_ctx = ralloc_context(NULL);
+   void *mem_ctx = ralloc_arena_context(NULL);
 
    loop_info_state *state = initialize_loop_info_state(loop, mem_ctx, impl);
    state->indirect_mask = indirect_mask;
@@ -38,7 +38,8 @@ read_first_invocation(nir_builder *b, nir_ssa_def *x)
 }
 
 static bool
-lower_non_uniform_tex_access(nir_builder *b, nir_tex_instr *tex)
+lower_non_uniform_tex_access(nir_builder *b, nir_tex_instr *tex,
+                             const bool *divergent)
 {
    if (!tex->texture_non_uniform && !tex->sampler_non_uniform)
       return false;
@@ -66,6 +67,11 @@ lower_non_uniform_tex_access(nir_builder *b, nir_tex_instr *tex)
 
       assert(tex->src[i].src.is_ssa);
       assert(tex->src[i].src.ssa->num_components == 1);
+
+      /* Handles which are uniform across the subgroup need no loop */
+      if (!divergent[tex->src[i].src.ssa->index])
+         continue;
+
       assert(handle_count < 2);
       handles[handle_count++] = tex->src[i].src.ssa;
    }
@@ -94,20 +100,22 @@ lower_non_uniform_tex_access(nir_builder *b, nir_tex_instr *tex)
 
 static bool
 lower_non_uniform_access_intrin(nir_builder *b, nir_intrinsic_instr *intrin,
-                                unsigned handle_src)
+                                unsigned handle_src, const bool *divergent)
 {
    if (!(nir_intrinsic_access(intrin) & ACCESS_NON_UNIFORM))
       return false;
 
-   /* If it's constant, it's automatically uniform; don't bother. */
-   if (nir_src_is_const(intrin->src[handle_src]))
+   /* If it's uniform across the subgroup, for instance because it's
+    * constant, don't bother.
+    */
+   assert(intrin->src[handle_src].is_ssa);
+   if (!divergent[intrin->src[handle_src].ssa->index])
       return false;
 
    b->cursor = nir_instr_remove(&intrin->instr);
 
    nir_push_loop(b);
 
-   assert(intrin->src[handle_src].is_ssa);
    assert(intrin->src[handle_src].ssa->num_components == 1);
    nir_ssa_def *handle = intrin->src[handle_src].ssa;
 
@@ -128,13 +136,16 @@ nir_lower_non_uniform_access_impl(nir_function_impl *impl,
    nir_builder b;
    nir_builder_init(&b, impl);
 
+   /* Only looked up for values which exist before we start lowering */
+   bool *divergent = nir_divergence_analysis_impl(impl, 0);
+
    nir_foreach_block(block, impl) {
       nir_foreach_instr(instr, block) {
          switch (instr->type) {
          case nir_instr_type_tex: {
             nir_tex_instr *tex = nir_instr_as_tex(instr);
             if ((types & nir_lower_non_uniform_texture_access) &&
-                lower_non_uniform_tex_access(&b, tex))
+                lower_non_uniform_tex_access(&b, tex, divergent))
                progress = true;
             break;
          }
@@ -144,7 +155,8 @@ nir_lower_non_uniform_access_impl(nir_function_impl *impl,
             switch (intrin->intrinsic) {
             case nir_intrinsic_load_ubo:
                if ((types & nir_lower_non_uniform_ubo_access) &&
-                   lower_non_uniform_access_intrin(&b, intrin, 0))
+                   lower_non_uniform_access_intrin(&b, intrin, 0,
+                                                   divergent))
                   progress = true;
                break;
 
@@ -164,14 +176,16 @@ nir_lower_non_uniform_access_impl(nir_function_impl *impl,
             case nir_intrinsic_ssbo_atomic_fmax:
             case nir_intrinsic_ssbo_atomic_fcomp_swap:
                if ((types & nir_lower_non_uniform_ssbo_access) &&
-                   lower_non_uniform_access_intrin(&b, intrin, 0))
+                   lower_non_uniform_access_intrin(&b, intrin, 0,
+                                                   divergent))
                   progress = true;
                break;
 
             case nir_intrinsic_store_ssbo:
                /* SSBO Stores put the index in the second source */
                if ((types & nir_lower_non_uniform_ssbo_access) &&
-                   lower_non_uniform_access_intrin(&b, intrin, 1))
+                   lower_non_uniform_access_intrin(&b, intrin, 1,
+                                                   divergent))
                   progress = true;
                break;
 
@@ -202,7 +216,8 @@ nir_lower_non_uniform_access_impl(nir_function_impl *impl,
             case nir_intrinsic_bindless_image_size:
             case nir_intrinsic_bindless_image_samples:
                if ((types & nir_lower_non_uniform_image_access) &&
-                   lower_non_uniform_access_intrin(&b, intrin, 0))
+                   lower_non_uniform_access_intrin(&b, intrin, 0,
+                                                   divergent))
                   progress = true;
                break;
 
@@ -220,6 +235,8 @@ nir_lower_non_uniform_access_impl(nir_function_impl *impl,
       }
    }
 
+   ralloc_free(divergent);
+
    if (progress)
       nir_metadata_preserve(impl, nir_metadata_none);
 
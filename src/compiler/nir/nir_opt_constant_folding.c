@@ -38,12 +38,15 @@ struct constant_fold_state {
    bool progress;
 };
 
-static bool
-constant_fold_alu_instr(nir_alu_instr *instr, void *mem_ctx)
+/**
+ * Evaluate \p instr into \p dest if all of its sources are constants.
+ */
+bool
+nir_eval_const_alu_instr(nir_alu_instr *instr, nir_const_value *dest)
 {
    nir_const_value src[NIR_MAX_VEC_COMPONENTS][NIR_MAX_VEC_COMPONENTS];
 
-   if (!instr->dest.dest.is_ssa)
+   if (!instr->dest.dest.is_ssa || instr->dest.saturate)
       return false;
 
    /* In the case that any outputs/inputs have unsized types, then we need to
@@ -60,7 +63,8 @@ constant_fold_alu_instr(nir_alu_instr *instr, void *mem_ctx)
       bit_size = instr->dest.dest.ssa.bit_size;
 
    for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++) {
-      if (!instr->src[i].src.is_ssa)
+      if (!instr->src[i].src.is_ssa ||
+          instr->src[i].abs || instr->src[i].negate)
          return false;
 
       if (bit_size == 0 &&
@@ -77,25 +81,36 @@ constant_fold_alu_instr(nir_alu_instr *instr, void *mem_ctx)
            j++) {
          src[i][j] = load_const->value[instr->src[i].swizzle[j]];
       }
-
-      /* We shouldn't have any source modifiers in the optimization loop. */
-      assert(!instr->src[i].abs && !instr->src[i].negate);
    }
 
    if (bit_size == 0)
       bit_size = 32;
 
-   /* We shouldn't have any saturate modifiers in the optimization loop. */
-   assert(!instr->dest.saturate);
-
-   nir_const_value dest[NIR_MAX_VEC_COMPONENTS];
    nir_const_value *srcs[NIR_MAX_VEC_COMPONENTS];
-   memset(dest, 0, sizeof(dest));
+   memset(dest, 0, sizeof(*dest) * NIR_MAX_VEC_COMPONENTS);
    for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; ++i)
       srcs[i] = src[i];
    nir_eval_const_opcode(instr->op, dest, instr->dest.dest.ssa.num_components,
                          bit_size, srcs);
 
+   return true;
+}
+
+static bool
+constant_fold_alu_instr(nir_alu_instr *instr, void *mem_ctx)
+{
+   nir_const_value dest[NIR_MAX_VEC_COMPONENTS];
+
+#ifndef NDEBUG
+   /* We shouldn't have any modifiers in the optimization loop. */
+   assert(!instr->dest.saturate);
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++)
+      assert(!instr->src[i].abs && !instr->src[i].negate);
+#endif
+
+   if (!nir_eval_const_alu_instr(instr, dest))
+      return false;
+
    nir_load_const_instr *new_instr =
       nir_load_const_instr_create(mem_ctx,
                                   instr->dest.dest.ssa.num_components,
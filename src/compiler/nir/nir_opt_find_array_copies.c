@@ -356,7 +356,7 @@ opt_find_array_copies_impl(nir_function_impl *impl)
 
    bool progress = false;
 
-   void *mem_ctx = ralloc_context(NULL);
+   void *mem_ctx = ralloc_arena_context(NULL);
 
    /* We re-index the SSA defs as we go; it makes it easier to handle
     * resetting the state machine.
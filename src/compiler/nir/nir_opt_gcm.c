@@ -37,10 +37,23 @@
  * verify correcness.
  */
 
+struct gcm_loop_info {
+   /* The loop this loop is nested in or NULL */
+   struct gcm_loop_info *parent;
+
+   /* Maximum register pressure, in 32-bit components, of any block inside
+    * this loop, including the values we have already hoisted out of it.
+    */
+   unsigned pressure;
+};
+
 struct gcm_block_info {
    /* Number of loops this block is inside */
    unsigned loop_depth;
 
+   /* The innermost loop this block is inside or NULL */
+   struct gcm_loop_info *loop;
+
    /* The last instruction inserted into this block.  This is used as we
     * traverse the instructions and insert them back into the program to
     * put them in the right order.
@@ -68,29 +81,43 @@ struct gcm_state {
    struct exec_list instrs;
 
    struct gcm_block_info *blocks;
+
+   /* Maximum register pressure we allow a loop to reach when hoisting
+    * values out of it, or 0 if we hoist regardless of pressure.
+    */
+   unsigned max_pressure;
+
+   /* The block each SSA def was in before we started moving things around,
+    * indexed by live_index.  Only used when max_pressure is set.
+    */
+   nir_block **def_blocks;
 };
 
 /* Recursively walks the CFG and builds the block_info structure */
 static void
 gcm_build_block_info(struct exec_list *cf_list, struct gcm_state *state,
-                     unsigned loop_depth)
+                     struct gcm_loop_info *loop_info, unsigned loop_depth)
 {
    foreach_list_typed(nir_cf_node, node, node, cf_list) {
       switch (node->type) {
       case nir_cf_node_block: {
          nir_block *block = nir_cf_node_as_block(node);
          state->blocks[block->index].loop_depth = loop_depth;
+         state->blocks[block->index].loop = loop_info;
          break;
       }
       case nir_cf_node_if: {
          nir_if *if_stmt = nir_cf_node_as_if(node);
-         gcm_build_block_info(&if_stmt->then_list, state, loop_depth);
-         gcm_build_block_info(&if_stmt->else_list, state, loop_depth);
+         gcm_build_block_info(&if_stmt->then_list, state, loop_info, loop_depth);
+         gcm_build_block_info(&if_stmt->else_list, state, loop_info, loop_depth);
          break;
       }
       case nir_cf_node_loop: {
          nir_loop *loop = nir_cf_node_as_loop(node);
-         gcm_build_block_info(&loop->body, state, loop_depth + 1);
+         struct gcm_loop_info *inner =
+            rzalloc(state->blocks, struct gcm_loop_info);
+         inner->parent = loop_info;
+         gcm_build_block_info(&loop->body, state, inner, loop_depth + 1);
          break;
       }
       default:
@@ -99,6 +126,130 @@ gcm_build_block_info(struct exec_list *cf_list, struct gcm_state *state,
    }
 }
 
+static unsigned
+gcm_def_size(nir_ssa_def *def)
+{
+   return def->num_components * DIV_ROUND_UP(def->bit_size, 32);
+}
+
+struct gcm_pressure_state {
+   struct gcm_state *gcm;
+   BITSET_WORD *live;
+   unsigned *def_sizes;
+   unsigned num_defs;
+   unsigned max_live_index;
+   unsigned pressure;
+};
+
+static bool
+gcm_pressure_index_def(nir_ssa_def *def, void *void_state)
+{
+   struct gcm_pressure_state *state = void_state;
+
+   if (def->parent_instr->type == nir_instr_type_ssa_undef)
+      return true;
+
+   assert(def->live_index < state->num_defs);
+   state->def_sizes[def->live_index] = gcm_def_size(def);
+   state->max_live_index = MAX2(state->max_live_index, def->live_index);
+   state->gcm->def_blocks[def->live_index] = def->parent_instr->block;
+
+   return true;
+}
+
+static bool
+gcm_pressure_kill_def(nir_ssa_def *def, void *void_state)
+{
+   struct gcm_pressure_state *state = void_state;
+
+   if (def->parent_instr->type == nir_instr_type_ssa_undef)
+      return true;
+
+   if (BITSET_TEST(state->live, def->live_index)) {
+      BITSET_CLEAR(state->live, def->live_index);
+      state->pressure -= state->def_sizes[def->live_index];
+   }
+
+   return true;
+}
+
+static bool
+gcm_pressure_use_src(nir_src *src, void *void_state)
+{
+   struct gcm_pressure_state *state = void_state;
+
+   if (!src->is_ssa || src->ssa->live_index == 0)
+      return true;
+
+   if (!BITSET_TEST(state->live, src->ssa->live_index)) {
+      BITSET_SET(state->live, src->ssa->live_index);
+      state->pressure += state->def_sizes[src->ssa->live_index];
+   }
+
+   return true;
+}
+
+/* Computes the maximum register pressure inside each loop
+ *
+ * The pressure of a block is the largest number of 32-bit components live
+ * at any point in it.  We get it by walking the block backwards from its
+ * live-out set.  Phi sources live in the live-out of the predecessor and
+ * phi destinations in the live-in of the block, so phis need no special
+ * handling beyond not counting their sources as uses.
+ */
+static void
+gcm_compute_loop_pressure(nir_function_impl *impl, struct gcm_state *state)
+{
+   /* Liveness hands out live_index values densely starting at 1, with 0
+    * reserved for undefs, so there are at most ssa_alloc of them.
+    */
+   struct gcm_pressure_state pstate;
+   pstate.gcm = state;
+   pstate.num_defs = impl->ssa_alloc + 1;
+   pstate.max_live_index = 0;
+   pstate.def_sizes = rzalloc_array(state->blocks, unsigned, pstate.num_defs);
+   state->def_blocks = rzalloc_array(state->blocks, nir_block *,
+                                     pstate.num_defs);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, gcm_pressure_index_def, &pstate);
+   }
+   const unsigned max_live_index = pstate.max_live_index;
+
+   /* This matches the size nir_live_ssa_defs_impl uses for its sets */
+   const unsigned bitset_words = BITSET_WORDS(max_live_index + 1);
+   pstate.live = ralloc_array(state->blocks, BITSET_WORD, bitset_words);
+
+   nir_foreach_block(block, impl) {
+      memcpy(pstate.live, block->live_out,
+             bitset_words * sizeof(BITSET_WORD));
+
+      pstate.pressure = 0;
+      for (unsigned i = 0; i <= max_live_index; i++) {
+         if (BITSET_TEST(pstate.live, i))
+            pstate.pressure += pstate.def_sizes[i];
+      }
+
+      nir_if *following_if = nir_block_get_following_if(block);
+      if (following_if)
+         gcm_pressure_use_src(&following_if->condition, &pstate);
+
+      unsigned max_pressure = pstate.pressure;
+      nir_foreach_instr_reverse(instr, block) {
+         nir_foreach_ssa_def(instr, gcm_pressure_kill_def, &pstate);
+         if (instr->type != nir_instr_type_phi)
+            nir_foreach_src(instr, gcm_pressure_use_src, &pstate);
+
+         max_pressure = MAX2(max_pressure, pstate.pressure);
+      }
+
+      for (struct gcm_loop_info *loop = state->blocks[block->index].loop;
+           loop != NULL; loop = loop->parent)
+         loop->pressure = MAX2(loop->pressure, max_pressure);
+   }
+}
+
 /* Walks the instruction list and marks immovable instructions as pinned
  *
  * This function also serves to initialize the instr->pass_flags field.
@@ -268,6 +419,56 @@ gcm_schedule_early_instr(nir_instr *instr, struct gcm_state *state)
 static void
 gcm_schedule_late_instr(nir_instr *instr, struct gcm_state *state);
 
+static bool
+gcm_loop_contains_block(struct gcm_loop_info *loop, nir_block *block,
+                        struct gcm_state *state)
+{
+   for (struct gcm_loop_info *l = state->blocks[block->index].loop;
+        l != NULL; l = l->parent) {
+      if (l == loop)
+         return true;
+   }
+
+   return false;
+}
+
+/** Returns true if placing def in the given block keeps the register
+ * pressure of all the loops it is hoisted out of within the limit.
+ *
+ * A value defined outside a loop but used inside it is live throughout the
+ * loop.  We charge its full size to every loop that contains the LCA of its
+ * uses but not the block it is placed in, unless the value was already
+ * defined outside that loop to begin with, in which case the liveness we
+ * started from accounts for it.  If commit is set, the charge is recorded
+ * so later decisions take it into account.
+ */
+static bool
+gcm_hoist_fits_pressure(nir_ssa_def *def, nir_block *lca, nir_block *block,
+                        struct gcm_state *state, bool commit)
+{
+   if (state->max_pressure == 0)
+      return true;
+
+   nir_block *def_block = state->def_blocks[def->live_index];
+   if (def_block == NULL)
+      return true;
+
+   const unsigned size = gcm_def_size(def);
+   for (struct gcm_loop_info *loop = state->blocks[lca->index].loop;
+        loop != NULL && !gcm_loop_contains_block(loop, block, state);
+        loop = loop->parent) {
+      if (!gcm_loop_contains_block(loop, def_block, state))
+         continue;
+
+      if (commit)
+         loop->pressure += size;
+      else if (loop->pressure + size > state->max_pressure)
+         return false;
+   }
+
+   return true;
+}
+
 /** Schedules the instruction associated with the given SSA def late
  *
  * This function works by first walking all of the uses of the given SSA
@@ -327,17 +528,20 @@ gcm_schedule_late_def(nir_ssa_def *def, void *void_state)
    /* We now have the LCA of all of the uses.  If our invariants hold,
     * this is dominated by the block that we chose when scheduling early.
     * We now walk up the dominance tree and pick the lowest block that is
-    * as far outside loops as we can get.
+    * as far outside loops as we can get without pushing the register
+    * pressure of the loops we leave over the limit.
     */
    nir_block *best = lca;
    for (nir_block *block = lca; block != NULL; block = block->imm_dom) {
       if (state->blocks[block->index].loop_depth <
-          state->blocks[best->index].loop_depth)
+          state->blocks[best->index].loop_depth &&
+          gcm_hoist_fits_pressure(def, lca, block, state, false))
          best = block;
 
       if (block == def->parent_instr->block)
          break;
    }
+   gcm_hoist_fits_pressure(def, lca, best, state, true);
    def->parent_instr->block = best;
 
    return true;
@@ -458,10 +662,13 @@ gcm_place_instr(nir_instr *instr, struct gcm_state *state)
 }
 
 static bool
-opt_gcm_impl(nir_function_impl *impl, bool value_number)
+opt_gcm_impl(nir_function_impl *impl, bool value_number,
+             unsigned max_pressure)
 {
    nir_metadata_require(impl, nir_metadata_block_index |
                               nir_metadata_dominance);
+   if (max_pressure)
+      nir_metadata_require(impl, nir_metadata_live_ssa_defs);
 
    struct gcm_state state;
 
@@ -469,8 +676,16 @@ opt_gcm_impl(nir_function_impl *impl, bool value_number)
    state.instr = NULL;
    exec_list_make_empty(&state.instrs);
    state.blocks = rzalloc_array(NULL, struct gcm_block_info, impl->num_blocks);
+   state.max_pressure = max_pressure;
+   state.def_blocks = NULL;
+
+   gcm_build_block_info(&impl->body, &state, NULL, 0);
 
-   gcm_build_block_info(&impl->body, &state, 0);
+   /* This has to happen before pinning pulls the instructions out of their
+    * blocks.
+    */
+   if (max_pressure)
+      gcm_compute_loop_pressure(impl, &state);
 
    nir_foreach_block(block, impl) {
       gcm_pin_instructions_block(block, &state);
@@ -508,14 +723,20 @@ opt_gcm_impl(nir_function_impl *impl, bool value_number)
    return progress;
 }
 
+/** Runs global code motion, optionally with global value numbering
+ *
+ * If max_pressure is non-zero, values are only hoisted out of a loop as long
+ * as the estimated register pressure inside the loop, in 32-bit components,
+ * stays at or below max_pressure.  Zero hoists as far as possible.
+ */
 bool
-nir_opt_gcm(nir_shader *shader, bool value_number)
+nir_opt_gcm(nir_shader *shader, bool value_number, unsigned max_pressure)
 {
    bool progress = false;
 
    nir_foreach_function(function, shader) {
       if (function->impl)
-         progress |= opt_gcm_impl(function->impl, value_number);
+         progress |= opt_gcm_impl(function->impl, value_number, max_pressure);
    }
 
    return progress;
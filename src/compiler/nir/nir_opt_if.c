@@ -1430,9 +1430,11 @@ nir_opt_if(nir_shader *shader, bool aggressive_last_continue)
 
       nir_metadata_require(function->impl, nir_metadata_block_index |
                            nir_metadata_dominance);
-      progress = opt_if_safe_cf_list(&b, &function->impl->body);
-      nir_metadata_preserve(function->impl, nir_metadata_block_index |
-                            nir_metadata_dominance);
+      if (opt_if_safe_cf_list(&b, &function->impl->body)) {
+         nir_metadata_preserve(function->impl, nir_metadata_block_index |
+                               nir_metadata_dominance);
+         progress = true;
+      }
 
       if (opt_if_cf_list(&b, &function->impl->body,
                          aggressive_last_continue)) {
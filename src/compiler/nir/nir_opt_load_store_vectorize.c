@@ -0,0 +1,529 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "util/u_math.h"
+
+/*
+ * Combines loads and stores of adjacent memory within a block into wider
+ * ones.
+ *
+ * Offsets are split into an SSA base and a constant, so that for instance
+ * loads from (x + 4) and (x + 8) in the same buffer are known to be
+ * adjacent.  Two loads are combined into one at the position of the first,
+ * two stores into one at the position of the second, provided nothing in
+ * between may write (for loads) or access (for stores) the memory of the
+ * access being moved.  Combined accesses get the alignment of their lowest
+ * address.
+ *
+ * Only accesses of the same bit size are combined, and never into more than
+ * NIR_MAX_VEC_COMPONENTS components.  The driver callback gets the final say
+ * on every combination.
+ */
+
+/* How far back from an access we look for another one to combine it with */
+#define MAX_SCAN_DISTANCE 128
+
+/* How many same-resource stores or loads a store may be moved across */
+#define MAX_CROSSED_ENTRIES 8
+
+struct intrinsic_info {
+   nir_variable_mode mode;
+   nir_intrinsic_op op;
+   bool is_store;
+   /* Source indices, or -1 */
+   int resource_src;
+   int offset_src;
+   int value_src;
+};
+
+static const struct intrinsic_info infos[] = {
+   { nir_var_mem_ubo,    nir_intrinsic_load_ubo,     false,  0, 1, -1 },
+   { nir_var_mem_ssbo,   nir_intrinsic_load_ssbo,    false,  0, 1, -1 },
+   { nir_var_mem_ssbo,   nir_intrinsic_store_ssbo,   true,   1, 2,  0 },
+   { nir_var_mem_shared, nir_intrinsic_load_shared,  false, -1, 0, -1 },
+   { nir_var_mem_shared, nir_intrinsic_store_shared, true,  -1, 1,  0 },
+   { nir_var_mem_global, nir_intrinsic_load_global,  false, -1, 0, -1 },
+   { nir_var_mem_global, nir_intrinsic_store_global, true,  -1, 1,  0 },
+};
+
+struct entry {
+   nir_intrinsic_instr *intrin;
+   const struct intrinsic_info *info;
+
+   nir_ssa_def *resource;
+
+   /* The address is offset_base + offset, offset_base may be NULL */
+   nir_ssa_def *offset_base;
+   int64_t offset;
+
+   unsigned bit_size;
+   unsigned num_components;
+   enum gl_access_qualifier access;
+};
+
+struct vectorize_ctx {
+   nir_builder b;
+   nir_variable_mode modes;
+   nir_should_vectorize_mem_func callback;
+};
+
+static const struct intrinsic_info *
+get_info(nir_intrinsic_op op)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(infos); i++) {
+      if (infos[i].op == op)
+         return &infos[i];
+   }
+
+   return NULL;
+}
+
+/* Split an offset into an SSA base and a constant, looking through chains of
+ * additions of constants.
+ */
+static void
+parse_offset(nir_ssa_def *def, nir_ssa_def **base, int64_t *offset)
+{
+   *offset = 0;
+
+   while (true) {
+      if (def->parent_instr->type == nir_instr_type_load_const) {
+         *offset += nir_src_as_int(nir_src_for_ssa(def));
+         *base = NULL;
+         return;
+      }
+
+      if (def->parent_instr->type != nir_instr_type_alu)
+         break;
+
+      nir_alu_instr *alu = nir_instr_as_alu(def->parent_instr);
+      if (alu->op != nir_op_iadd)
+         break;
+
+      bool found = false;
+      for (unsigned i = 0; i < 2; i++) {
+         nir_alu_src *const_src = &alu->src[i];
+         nir_alu_src *other_src = &alu->src[1 - i];
+
+         if (!const_src->src.is_ssa || !other_src->src.is_ssa ||
+             !nir_src_is_const(const_src->src) ||
+             other_src->src.ssa->num_components != 1)
+            continue;
+
+         *offset += nir_src_comp_as_int(const_src->src,
+                                        const_src->swizzle[0]);
+         def = other_src->src.ssa;
+         found = true;
+         break;
+      }
+
+      if (!found)
+         break;
+   }
+
+   *base = def;
+}
+
+static bool
+create_entry(struct entry *entry, nir_intrinsic_instr *intrin)
+{
+   entry->info = get_info(intrin->intrinsic);
+   if (!entry->info)
+      return false;
+
+   const struct intrinsic_info *info = entry->info;
+
+   for (unsigned i = 0; i < nir_intrinsic_infos[intrin->intrinsic].num_srcs; i++) {
+      if (!intrin->src[i].is_ssa)
+         return false;
+   }
+
+   entry->intrin = intrin;
+   entry->resource = info->resource_src >= 0 ?
+                     intrin->src[info->resource_src].ssa : NULL;
+
+   parse_offset(intrin->src[info->offset_src].ssa,
+                &entry->offset_base, &entry->offset);
+   if (info->mode == nir_var_mem_shared)
+      entry->offset += nir_intrinsic_base(intrin);
+
+   if (info->is_store) {
+      entry->bit_size = intrin->src[info->value_src].ssa->bit_size;
+   } else {
+      if (!intrin->dest.is_ssa)
+         return false;
+      entry->bit_size = intrin->dest.ssa.bit_size;
+   }
+
+   entry->num_components = intrin->num_components;
+   entry->access = info->mode == nir_var_mem_shared ? 0 :
+                   nir_intrinsic_access(intrin);
+
+   return true;
+}
+
+static unsigned
+entry_size(const struct entry *entry)
+{
+   return entry->num_components * entry->bit_size / 8;
+}
+
+static bool
+same_address_space(const struct entry *a, const struct entry *b)
+{
+   return a->resource == b->resource && a->offset_base == b->offset_base;
+}
+
+static bool
+ranges_overlap(const struct entry *a, const struct entry *b)
+{
+   return a->offset < b->offset + entry_size(b) &&
+          b->offset < a->offset + entry_size(a);
+}
+
+/* Whether the two accesses may be to the same memory, not considering their
+ * offsets
+ */
+static bool
+may_share_memory(const struct entry *a, const struct entry *b)
+{
+   /* SSBOs and global memory may be the same memory */
+   nir_variable_mode global_modes = nir_var_mem_ssbo | nir_var_mem_global;
+   if (a->info->mode != b->info->mode &&
+       !((a->info->mode & global_modes) && (b->info->mode & global_modes)))
+      return false;
+
+   /* Nothing writes to UBOs */
+   if (a->info->mode == nir_var_mem_ubo)
+      return false;
+
+   if ((a->access & ACCESS_RESTRICT) && (b->access & ACCESS_RESTRICT) &&
+       a->resource && b->resource && a->resource != b->resource)
+      return false;
+
+   return true;
+}
+
+static bool
+may_alias(const struct entry *a, const struct entry *b)
+{
+   if (!may_share_memory(a, b))
+      return false;
+
+   if (same_address_space(a, b))
+      return ranges_overlap(a, b);
+
+   return true;
+}
+
+static unsigned
+entry_align(const struct entry *entry)
+{
+   if (nir_intrinsic_align_mul(entry->intrin) == 0)
+      return entry->bit_size / 8;
+
+   return nir_intrinsic_align(entry->intrin);
+}
+
+static bool
+can_combine(struct vectorize_ctx *ctx, const struct entry *first,
+            const struct entry *second,
+            const struct entry **low, const struct entry **high)
+{
+   if (first->info != second->info ||
+       !same_address_space(first, second) ||
+       first->bit_size != second->bit_size ||
+       first->access != second->access)
+      return false;
+
+   if (first->offset + entry_size(first) == second->offset) {
+      *low = first;
+      *high = second;
+   } else if (second->offset + entry_size(second) == first->offset) {
+      *low = second;
+      *high = first;
+   } else {
+      return false;
+   }
+
+   unsigned num_components = first->num_components + second->num_components;
+   if (num_components > NIR_MAX_VEC_COMPONENTS)
+      return false;
+
+   if (ctx->callback &&
+       !ctx->callback(entry_align(*low), first->bit_size, num_components,
+                      (*high)->offset - (*low)->offset,
+                      (*low)->intrin, (*high)->intrin))
+      return false;
+
+   return true;
+}
+
+static nir_intrinsic_instr *
+create_combined(struct vectorize_ctx *ctx, const struct entry *copy_from,
+                const struct entry *low, unsigned num_components)
+{
+   nir_intrinsic_instr *intrin =
+      nir_intrinsic_instr_create(ctx->b.shader, copy_from->info->op);
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+
+   for (unsigned i = 0; i < info->num_srcs; i++)
+      intrin->src[i] = nir_src_for_ssa(copy_from->intrin->src[i].ssa);
+
+   for (unsigned i = 0; i < info->num_indices; i++)
+      intrin->const_index[i] = copy_from->intrin->const_index[i];
+
+   intrin->num_components = num_components;
+   nir_intrinsic_set_align_mul(intrin, nir_intrinsic_align_mul(low->intrin));
+   nir_intrinsic_set_align_offset(intrin,
+                                  nir_intrinsic_align_offset(low->intrin));
+
+   return intrin;
+}
+
+/* The combined load goes where the first one was.  Its offset is derived
+ * from the one of the first load, as the offset of the second one need not
+ * be available there.
+ */
+static void
+combine_loads(struct vectorize_ctx *ctx, const struct entry *first,
+              const struct entry *second,
+              const struct entry *low, const struct entry *high)
+{
+   nir_builder *b = &ctx->b;
+   unsigned num_components = first->num_components + second->num_components;
+
+   b->cursor = nir_before_instr(&first->intrin->instr);
+
+   nir_intrinsic_instr *load = create_combined(ctx, first, low,
+                                               num_components);
+   if (low != first) {
+      nir_ssa_def *offset = first->intrin->src[first->info->offset_src].ssa;
+      offset = nir_iadd_imm(b, offset, low->offset - first->offset);
+      load->src[first->info->offset_src] = nir_src_for_ssa(offset);
+   }
+
+   nir_ssa_dest_init(&load->instr, &load->dest, num_components,
+                     first->bit_size, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+
+   nir_ssa_def *low_def =
+      nir_channels(b, &load->dest.ssa, BITFIELD_MASK(low->num_components));
+   nir_ssa_def *high_def =
+      nir_channels(b, &load->dest.ssa,
+                   BITFIELD_MASK(high->num_components) << low->num_components);
+
+   nir_ssa_def_rewrite_uses(&low->intrin->dest.ssa, nir_src_for_ssa(low_def));
+   nir_ssa_def_rewrite_uses(&high->intrin->dest.ssa,
+                            nir_src_for_ssa(high_def));
+
+   nir_instr_remove(&first->intrin->instr);
+   nir_instr_remove(&second->intrin->instr);
+}
+
+/* The combined store goes where the second one was, where the values and
+ * offsets of both are available.
+ */
+static void
+combine_stores(struct vectorize_ctx *ctx, const struct entry *first,
+               const struct entry *second,
+               const struct entry *low, const struct entry *high)
+{
+   nir_builder *b = &ctx->b;
+   unsigned num_components = first->num_components + second->num_components;
+   int value_src = first->info->value_src;
+
+   b->cursor = nir_before_instr(&second->intrin->instr);
+
+   nir_ssa_def *comps[NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < num_components; i++) {
+      if (i < low->num_components) {
+         comps[i] = nir_channel(b, low->intrin->src[value_src].ssa, i);
+      } else {
+         comps[i] = nir_channel(b, high->intrin->src[value_src].ssa,
+                                i - low->num_components);
+      }
+   }
+
+   nir_intrinsic_instr *store = create_combined(ctx, low, low,
+                                                num_components);
+   store->src[value_src] = nir_src_for_ssa(nir_vec(b, comps, num_components));
+   nir_intrinsic_set_write_mask(store,
+      nir_intrinsic_write_mask(low->intrin) |
+      (nir_intrinsic_write_mask(high->intrin) << low->num_components));
+   nir_builder_instr_insert(b, &store->instr);
+
+   nir_instr_remove(&first->intrin->instr);
+   nir_instr_remove(&second->intrin->instr);
+}
+
+/* Whether an intrinsic that isn't one of the accesses handled here stops
+ * \p entry from being moved across it.
+ */
+static bool
+is_barrier_for(const struct entry *entry, nir_intrinsic_instr *intrin)
+{
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+
+   /* Anything with side effects: barriers, other stores and atomics, but
+    * also discards which stores may not be moved across.
+    */
+   if (!(info->flags & NIR_INTRINSIC_CAN_ELIMINATE))
+      return true;
+
+   /* Loads whose result may depend on what a moved store writes */
+   if (entry->info->is_store && info->has_dest &&
+       !(info->flags & NIR_INTRINSIC_CAN_REORDER))
+      return true;
+
+   return false;
+}
+
+static bool
+vectorize_access(struct vectorize_ctx *ctx, nir_intrinsic_instr *intrin)
+{
+   struct entry second;
+   if (!create_entry(&second, intrin) ||
+       !(second.info->mode & ctx->modes) ||
+       (second.access & ACCESS_VOLATILE))
+      return false;
+
+   struct entry crossed[MAX_CROSSED_ENTRIES];
+   unsigned num_crossed = 0;
+
+   unsigned distance = 0;
+   for (nir_instr *instr = nir_instr_prev(&intrin->instr);
+        instr && distance < MAX_SCAN_DISTANCE;
+        instr = nir_instr_prev(instr), distance++) {
+      if (instr->type == nir_instr_type_call)
+         return false;
+
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      nir_intrinsic_instr *other = nir_instr_as_intrinsic(instr);
+      struct entry first;
+      if (!create_entry(&first, other)) {
+         if (is_barrier_for(&second, other))
+            return false;
+         continue;
+      }
+
+      const struct entry *low, *high;
+      if (!(first.access & ACCESS_VOLATILE) &&
+          can_combine(ctx, &first, &second, &low, &high)) {
+         bool crossed_alias = false;
+         for (unsigned i = 0; i < num_crossed; i++)
+            crossed_alias |= may_alias(&first, &crossed[i]);
+
+         if (!crossed_alias) {
+            if (second.info->is_store)
+               combine_stores(ctx, &first, &second, low, high);
+            else
+               combine_loads(ctx, &first, &second, low, high);
+            return true;
+         }
+      }
+
+      if (!may_share_memory(&first, &second))
+         continue;
+
+      if ((first.access & ACCESS_VOLATILE) ||
+          (second.info->is_store && num_crossed == MAX_CROSSED_ENTRIES))
+         return false;
+
+      if (second.info->is_store) {
+         /* The first store moves down across this access, which may not
+          * touch its memory.  That memory isn't known yet, so remember the
+          * access for later as long as its range is known.
+          */
+         if (!same_address_space(&first, &second))
+            return false;
+         crossed[num_crossed++] = first;
+      } else if (first.info->is_store && may_alias(&first, &second)) {
+         /* The second load moves up across this store */
+         return false;
+      }
+   }
+
+   return false;
+}
+
+static bool
+nir_opt_load_store_vectorize_impl(nir_function_impl *impl,
+                                  nir_variable_mode modes,
+                                  nir_should_vectorize_mem_func callback)
+{
+   bool progress = false;
+
+   struct vectorize_ctx ctx = {
+      .modes = modes,
+      .callback = callback,
+   };
+   nir_builder_init(&ctx.b, impl);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr_safe(instr, block) {
+         if (instr->type == nir_instr_type_intrinsic)
+            progress |= vectorize_access(&ctx, nir_instr_as_intrinsic(instr));
+      }
+   }
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   } else {
+#ifndef NDEBUG
+      impl->valid_metadata &= ~nir_metadata_not_properly_reset;
+#endif
+   }
+
+   return progress;
+}
+
+/**
+ * Combine adjacent loads and stores of the given modes, out of
+ * nir_var_mem_ubo, nir_var_mem_ssbo, nir_var_mem_shared and
+ * nir_var_mem_global.
+ *
+ * \p callback, if not NULL, decides whether a combined access with the given
+ * alignment in bytes, bit size and number of components is worth it.
+ * \p high_offset is the distance in bytes between the two original accesses.
+ */
+bool
+nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                             nir_should_vectorize_mem_func callback)
+{
+   bool progress = false;
+
+   nir_foreach_function(function, shader) {
+      if (function->impl) {
+         progress |= nir_opt_load_store_vectorize_impl(function->impl, modes,
+                                                       callback);
+      }
+   }
+
+   return progress;
+}
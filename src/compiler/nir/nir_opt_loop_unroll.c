@@ -770,6 +770,126 @@ partial_unroll(nir_shader *shader, nir_loop *loop, unsigned trip_count)
    _mesa_hash_table_destroy(remap_table, NULL);
 }
 
+/* Removes the copy of the limiting terminator from one unrolled iteration
+ * starting in \p block, keeping only its continue branch.
+ */
+static void
+remove_unrolled_terminator(nir_block *block, unsigned term_if_index,
+                           bool continue_from_then)
+{
+   nir_cf_node *node = &block->cf_node;
+   for (unsigned i = 0;; node = nir_cf_node_next(node)) {
+      if (node->type == nir_cf_node_if && i++ == term_if_index)
+         break;
+   }
+
+   nir_if *nif = nir_cf_node_as_if(node);
+   struct exec_list *continue_list =
+      continue_from_then ? &nif->then_list : &nif->else_list;
+
+   nir_cf_list lst;
+   nir_cf_list_extract(&lst, continue_list);
+   nir_cf_reinsert(&lst, nir_after_cf_node(&nif->cf_node));
+   nir_cf_node_remove(&nif->cf_node);
+}
+
+/* Partially unrolls a loop which is too large to be completely unrolled, or
+ * has an unknown trip count, by replacing its body with \p factor copies of
+ * it.  Each copy keeps its terminators so this is correct for any number of
+ * iterations.  When \p remove_checks is set the trip count is known to be a
+ * multiple of the factor, so the only terminator of the loop can only be
+ * taken in the first copy and is removed from the others.
+ */
+static void
+partial_unroll_by_factor(nir_loop *loop, unsigned factor, bool remove_checks)
+{
+   nir_loop_terminator *terminator = loop->info->limiting_terminator;
+   unsigned term_if_index = 0;
+   bool continue_from_then = false;
+
+   if (remove_checks) {
+      assert(list_length(&loop->info->loop_terminator_list) == 1);
+      continue_from_then = terminator->continue_from_then;
+
+      foreach_list_typed(nir_cf_node, node, node, &loop->body) {
+         if (node == &terminator->nif->cf_node)
+            break;
+         if (node->type == nir_cf_node_if)
+            term_if_index++;
+      }
+   }
+
+   loop_prepare_for_unroll(loop);
+
+   nir_cf_list lp_body;
+   nir_cf_list_extract(&lp_body, &loop->body);
+
+   struct hash_table *remap_table = _mesa_pointer_hash_table_create(NULL);
+
+   for (unsigned i = 0; i < factor; i++) {
+      nir_block *last_blk = nir_loop_last_block(loop);
+      nir_cf_list_clone_and_reinsert(&lp_body, &loop->cf_node,
+                                     nir_after_block(last_blk),
+                                     remap_table);
+
+      if (remove_checks && i > 0) {
+         remove_unrolled_terminator(last_blk, term_if_index,
+                                    continue_from_then);
+      }
+   }
+
+   nir_cf_delete(&lp_body);
+   _mesa_hash_table_destroy(remap_table, NULL);
+
+   loop->partially_unrolled = true;
+}
+
+/*
+ * Picks a partial unroll factor for a loop the other strategies could not
+ * handle and unrolls it.  Returns true if the loop was unrolled.
+ */
+static bool
+try_partial_unroll_by_factor(nir_shader *shader, nir_loop *loop)
+{
+   nir_loop_info *li = loop->info;
+   unsigned factor = shader->options->partial_unroll_factor;
+   unsigned max_iter = shader->options->max_unroll_iterations;
+
+   if (factor < 2 || li->complex_loop || loop->partially_unrolled)
+      return false;
+
+   /* Loops ending in a break only run once. */
+   if (nir_block_ends_in_break(nir_loop_last_block(loop)))
+      return false;
+
+   if (li->limiting_terminator)
+      factor = MIN2(factor, li->max_trip_count);
+
+   while (factor > 1 && li->instr_cost * factor > max_iter * LOOP_UNROLL_LIMIT)
+      factor--;
+
+   if (factor < 2)
+      return false;
+
+   /* If the trip count is known exactly we prefer a factor dividing it, which
+    * lets us drop the exit condition from all but the first copy.
+    */
+   bool remove_checks = false;
+   if (li->limiting_terminator && li->exact_trip_count_known &&
+       list_length(&li->loop_terminator_list) == 1) {
+      for (unsigned f = factor; f > 1; f--) {
+         if (li->max_trip_count % f == 0) {
+            factor = f;
+            remove_checks = true;
+            break;
+         }
+      }
+   }
+
+   partial_unroll_by_factor(loop, factor, remove_checks);
+   return true;
+}
+
 /*
  * Returns true if we should unroll the loop, otherwise false.
  */
@@ -911,6 +1031,11 @@ process_loops(nir_shader *sh, nir_cf_node *cf_node, bool *has_nested_loop_out)
    }
 
 exit:
+   /* Fall back to partially unrolling loops we couldn't unroll completely. */
+   if (!progress && !has_nested_loop &&
+       loop->control != nir_loop_control_dont_unroll)
+      progress = try_partial_unroll_by_factor(sh, loop);
+
    *has_nested_loop_out = true;
    return progress;
 }
@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "nir.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
+
+/*
+ * Runs a function-local pass over all the functions of a shader on a
+ * util_queue.
+ *
+ * Instructions and other IR objects are allocated out of the shader they
+ * belong to, and ralloc is not thread-safe, so each function temporarily
+ * gets its own scratch nir_shader with the same options and info.  While
+ * the pass runs, function->shader points at the scratch shader and
+ * everything the pass creates is allocated from it.  Once all jobs are done
+ * the functions are pointed back at the real shader, which adopts all the
+ * scratch allocations.
+ */
+
+struct parallel_job {
+   nir_function *function;
+   nir_shader *scratch;
+
+   nir_impl_pass pass;
+   void *data;
+
+   bool progress;
+
+   struct util_queue_fence fence;
+};
+
+static void
+run_parallel_job(void *data, int thread_index)
+{
+   struct parallel_job *job = data;
+
+   job->progress = job->pass(job->function->impl, job->data);
+}
+
+/**
+ * Call pass on the implementation of every function in the shader, in
+ * parallel on up to num_threads threads, or one per CPU if num_threads is 0.
+ *
+ * The pass must only touch the function_impl it is given: it may create
+ * instructions, registers and control flow in it, but must not create
+ * variables, modify the shader info or look at other functions.  Returns
+ * true if the pass made progress on any function.
+ */
+bool
+nir_shader_run_impl_pass_parallel(nir_shader *shader, nir_impl_pass pass,
+                                  void *data, unsigned num_threads)
+{
+   unsigned num_jobs = 0;
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         num_jobs++;
+   }
+
+   if (num_threads == 0) {
+      util_cpu_detect();
+      num_threads = MAX2(util_cpu_caps.nr_cpus, 1);
+   }
+   num_threads = MIN2(num_threads, num_jobs);
+
+   bool progress = false;
+
+   /* Not worth spinning up threads for a single function */
+   struct util_queue queue;
+   if (num_threads <= 1 ||
+       !util_queue_init(&queue, "nir", num_jobs, num_threads, 0)) {
+      nir_foreach_function(function, shader) {
+         if (function->impl)
+            progress |= pass(function->impl, data);
+      }
+      return progress;
+   }
+
+   struct parallel_job *jobs = rzalloc_array(NULL, struct parallel_job,
+                                             num_jobs);
+
+   unsigned i = 0;
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      struct parallel_job *job = &jobs[i++];
+      job->function = function;
+      job->scratch = nir_shader_create(NULL, shader->info.stage,
+                                       shader->options, &shader->info);
+      job->pass = pass;
+      job->data = data;
+      util_queue_fence_init(&job->fence);
+
+      function->shader = job->scratch;
+      util_queue_add_job(&queue, job, &job->fence, run_parallel_job, NULL);
+   }
+
+   for (i = 0; i < num_jobs; i++) {
+      struct parallel_job *job = &jobs[i];
+
+      util_queue_fence_wait(&job->fence);
+      util_queue_fence_destroy(&job->fence);
+
+      job->function->shader = shader;
+      ralloc_adopt(shader, job->scratch);
+      ralloc_free(job->scratch);
+
+      progress |= job->progress;
+   }
+
+   util_queue_destroy(&queue);
+   ralloc_free(jobs);
+
+   return progress;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "util/hash_table.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+
+/*
+ * Per pass statistics collected by NIR_PASS and NIR_PASS_V when NIR_PASS_STATS
+ * is set.  Samples are aggregated by pass name and shader stage in a global
+ * table until nir_pass_stats_report() prints and resets them.
+ */
+
+struct pass_stage_stats {
+   unsigned calls;
+   unsigned progress;
+   int64_t time_ns;
+   int64_t instr_delta;
+   uint64_t alloc_bytes;
+};
+
+struct pass_stats {
+   const char *name;
+   struct pass_stage_stats stage[MESA_ALL_SHADER_STAGES];
+};
+
+static simple_mtx_t stats_mutex = _SIMPLE_MTX_INITIALIZER_NP;
+static struct hash_table *stats_table;
+
+static unsigned
+count_instrs(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl)
+         count += exec_list_length(&block->instr_list);
+   }
+
+   return count;
+}
+
+void
+nir_pass_stats_begin(nir_shader *shader, struct nir_pass_stats_sample *sample)
+{
+   static bool counting_bytes = false;
+   if (!counting_bytes) {
+      ralloc_enable_byte_count();
+      counting_bytes = true;
+   }
+
+   sample->num_instrs = count_instrs(shader);
+   sample->alloc_bytes = ralloc_allocated_bytes();
+   sample->start_ns = os_time_get_nano();
+}
+
+void
+nir_pass_stats_end(nir_shader *shader, const char *pass_name,
+                   const struct nir_pass_stats_sample *sample, bool progress)
+{
+   int64_t time_ns = os_time_get_nano() - sample->start_ns;
+   uint64_t alloc_bytes = ralloc_allocated_bytes() - sample->alloc_bytes;
+   int64_t instr_delta = (int64_t) count_instrs(shader) - sample->num_instrs;
+
+   simple_mtx_lock(&stats_mutex);
+
+   if (stats_table == NULL) {
+      stats_table = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                            _mesa_key_string_equal);
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(stats_table, pass_name);
+   struct pass_stats *stats;
+   if (entry) {
+      stats = entry->data;
+   } else {
+      stats = rzalloc(stats_table, struct pass_stats);
+      stats->name = ralloc_strdup(stats, pass_name);
+      _mesa_hash_table_insert(stats_table, stats->name, stats);
+   }
+
+   assert(shader->info.stage < MESA_ALL_SHADER_STAGES);
+   struct pass_stage_stats *stage = &stats->stage[shader->info.stage];
+   stage->calls++;
+   stage->progress += progress;
+   stage->time_ns += time_ns;
+   stage->instr_delta += instr_delta;
+   stage->alloc_bytes += alloc_bytes;
+
+   simple_mtx_unlock(&stats_mutex);
+}
+
+static int
+compare_pass_time(const void *a, const void *b)
+{
+   const struct pass_stats *pa = *(const struct pass_stats **) a;
+   const struct pass_stats *pb = *(const struct pass_stats **) b;
+   int64_t ta = 0, tb = 0;
+
+   for (unsigned i = 0; i < MESA_ALL_SHADER_STAGES; i++) {
+      ta += pa->stage[i].time_ns;
+      tb += pb->stage[i].time_ns;
+   }
+
+   return ta < tb ? 1 : ta > tb ? -1 : 0;
+}
+
+/**
+ * Print the statistics collected since the last report to stderr, passes
+ * taking the most time first, and reset them.
+ */
+void
+nir_pass_stats_report(void)
+{
+   simple_mtx_lock(&stats_mutex);
+
+   if (stats_table == NULL) {
+      simple_mtx_unlock(&stats_mutex);
+      return;
+   }
+
+   unsigned num_passes = stats_table->entries;
+   struct pass_stats **passes = ralloc_array(stats_table, struct pass_stats *,
+                                             num_passes);
+   unsigned i = 0;
+   hash_table_foreach(stats_table, entry)
+      passes[i++] = entry->data;
+
+   qsort(passes, num_passes, sizeof(*passes), compare_pass_time);
+
+   fprintf(stderr, "NIR pass statistics:\n");
+   fprintf(stderr, "%-32s %-5s %8s %8s %12s %12s %12s\n", "pass", "stage",
+           "calls", "progress", "time (ms)", "instrs", "alloc (KB)");
+
+   for (i = 0; i < num_passes; i++) {
+      for (unsigned s = 0; s < MESA_ALL_SHADER_STAGES; s++) {
+         const struct pass_stage_stats *stage = &passes[i]->stage[s];
+         if (stage->calls == 0)
+            continue;
+
+         fprintf(stderr, "%-32s %-5s %8u %8u %12.3f %+12" PRId64 " %12.1f\n",
+                 passes[i]->name, _mesa_shader_stage_to_abbrev(s),
+                 stage->calls, stage->progress, stage->time_ns / 1000000.0,
+                 stage->instr_delta, stage->alloc_bytes / 1024.0);
+      }
+   }
+
+   ralloc_free(stats_table);
+   stats_table = NULL;
+
+   simple_mtx_unlock(&stats_mutex);
+}
@@ -28,7 +28,10 @@
 #include <inttypes.h>
 #include "nir_search.h"
 #include "nir_builder.h"
+#include "nir_constant_expressions.h"
 #include "util/half_float.h"
+#include "util/u_dynarray.h"
+#include "nir_worklist.h"
 
 #define NIR_SEARCH_MAX_COMM_OPS 4
 
@@ -136,6 +139,54 @@ nir_op_matches_search_op(nir_op nop, uint16_t sop)
 #undef MATCH_ICONV_CASE
 }
 
+/**
+ * Return the search opcode the automaton generated by nir_algebraic.py uses
+ * for \p nop: the generic one for sized conversions, \p nop itself
+ * otherwise.  This must agree with _search_opcode() in nir_algebraic.py.
+ */
+uint16_t
+nir_search_op_for_nir_op(nir_op nop)
+{
+#define SEARCH_OP_FCONV_CASE(op) \
+   case nir_op_##op##16: \
+   case nir_op_##op##32: \
+   case nir_op_##op##64: \
+      return nir_search_op_##op;
+
+#define SEARCH_OP_ICONV_CASE(op) \
+   case nir_op_##op##1: \
+   case nir_op_##op##8: \
+   case nir_op_##op##16: \
+   case nir_op_##op##32: \
+   case nir_op_##op##64: \
+      return nir_search_op_##op;
+
+#define SEARCH_OP_BCONV_CASE(op) \
+   case nir_op_##op##1: \
+   case nir_op_##op##32: \
+      return nir_search_op_##op;
+
+   switch (nop) {
+   SEARCH_OP_FCONV_CASE(i2f)
+   SEARCH_OP_FCONV_CASE(u2f)
+   SEARCH_OP_FCONV_CASE(f2f)
+   SEARCH_OP_ICONV_CASE(f2u)
+   SEARCH_OP_ICONV_CASE(f2i)
+   SEARCH_OP_ICONV_CASE(u2u)
+   SEARCH_OP_ICONV_CASE(i2i)
+   SEARCH_OP_FCONV_CASE(b2f)
+   SEARCH_OP_ICONV_CASE(b2i)
+   SEARCH_OP_BCONV_CASE(i2b)
+   SEARCH_OP_BCONV_CASE(f2b)
+   default:
+      return nop;
+   }
+
+#undef SEARCH_OP_FCONV_CASE
+#undef SEARCH_OP_ICONV_CASE
+#undef SEARCH_OP_BCONV_CASE
+}
+
 static nir_op
 nir_op_for_search_op(uint16_t sop, unsigned bit_size)
 {
@@ -425,10 +476,30 @@ construct_value(nir_builder *build,
                                        state, instr);
       }
 
-      nir_builder_instr_insert(build, &alu->instr);
-
       nir_alu_src val;
-      val.src = nir_src_for_ssa(&alu->dest.dest.ssa);
+
+      /* Fold the replacement right away if all of its sources are
+       * constants.  Constant folding doesn't get to run while the worklist
+       * of nir_algebraic_impl() is processed, and some pairs of transforms
+       * rely on it to not keep undoing each other.
+       */
+      nir_const_value dest[NIR_MAX_VEC_COMPONENTS];
+      if (nir_eval_const_alu_instr(alu, dest)) {
+         nir_load_const_instr *load =
+            nir_load_const_instr_create(build->shader,
+                                        alu->dest.dest.ssa.num_components,
+                                        alu->dest.dest.ssa.bit_size);
+         memcpy(load->value, dest,
+                sizeof(*load->value) * load->def.num_components);
+         nir_builder_instr_insert(build, &load->instr);
+         ralloc_free(alu);
+
+         val.src = nir_src_for_ssa(&load->def);
+      } else {
+         nir_builder_instr_insert(build, &alu->instr);
+         val.src = nir_src_for_ssa(&alu->dest.dest.ssa);
+      }
+
       val.negate = false;
       val.abs = false,
       memcpy(val.swizzle, identity_swizzle, sizeof val.swizzle);
@@ -545,3 +616,259 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
 
    return ssa_val;
 }
+
+/* These must match the first two states created by
+ * TreeAutomaton._build_table() in nir_algebraic.py.
+ */
+#define WILDCARD_STATE 0
+#define CONST_STATE 1
+
+struct algebraic_pass_state {
+   nir_builder build;
+
+   const bool *condition_flags;
+   const struct transform **transforms;
+   const uint16_t *transform_counts;
+   const struct per_op_table *pass_op_table;
+
+   /* Automaton state of every SSA def, indexed by SSA index */
+   struct util_dynarray states;
+
+   /* Instructions left to match.  pass_flags is set on the instructions
+    * currently sitting in it, so that each is queued at most once.
+    */
+   nir_instr_worklist *worklist;
+};
+
+static uint16_t *
+algebraic_state(struct algebraic_pass_state *state, nir_ssa_def *def)
+{
+   unsigned num_states = util_dynarray_num_elements(&state->states, uint16_t);
+
+   if (def->index >= num_states) {
+      util_dynarray_resize(&state->states,
+                           (def->index + 1) * sizeof(uint16_t));
+      memset(util_dynarray_element(&state->states, uint16_t, num_states), 0,
+             (def->index + 1 - num_states) * sizeof(uint16_t));
+   }
+
+   return util_dynarray_element(&state->states, uint16_t, def->index);
+}
+
+/** Recompute the automaton state of \p instr, returning true if it changed */
+static bool
+algebraic_update_state(struct algebraic_pass_state *state, nir_instr *instr)
+{
+   nir_ssa_def *def;
+   uint16_t new_state;
+
+   switch (instr->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      if (!alu->dest.dest.is_ssa)
+         return false;
+
+      def = &alu->dest.dest.ssa;
+
+      const struct per_op_table *tbl =
+         &state->pass_op_table[nir_search_op_for_nir_op(alu->op)];
+      if (tbl->num_filtered_states == 0) {
+         new_state = WILDCARD_STATE;
+         break;
+      }
+
+      /* This must match the order in which TreeAutomaton.table_values()
+       * flattens the table.
+       */
+      unsigned index = 0;
+      for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+         uint16_t src_state = alu->src[i].src.is_ssa ?
+            *algebraic_state(state, alu->src[i].src.ssa) : WILDCARD_STATE;
+         index = index * tbl->num_filtered_states + tbl->filter[src_state];
+      }
+      new_state = tbl->table[index];
+      break;
+   }
+
+   case nir_instr_type_load_const:
+      def = &nir_instr_as_load_const(instr)->def;
+      new_state = CONST_STATE;
+      break;
+
+   default:
+      return false;
+   }
+
+   uint16_t *old_state = algebraic_state(state, def);
+   if (*old_state == new_state)
+      return false;
+
+   *old_state = new_state;
+   return true;
+}
+
+static void
+algebraic_worklist_push(struct algebraic_pass_state *state, nir_instr *instr)
+{
+   if (instr->type != nir_instr_type_alu || instr->pass_flags)
+      return;
+
+   instr->pass_flags = 1;
+   nir_instr_worklist_push_tail(state->worklist, instr);
+}
+
+static bool
+algebraic_worklist_push_src(nir_src *src, void *state)
+{
+   if (src->is_ssa)
+      algebraic_worklist_push(state, src->ssa->parent_instr);
+
+   return true;
+}
+
+/* Queue the users of \p def and update their automaton states, following the
+ * uses further for as long as the states keep changing.
+ */
+static void
+algebraic_update_uses(struct algebraic_pass_state *state, nir_ssa_def *def)
+{
+   nir_instr_worklist *changed = nir_instr_worklist_create();
+
+   nir_foreach_use(use_src, def) {
+      algebraic_worklist_push(state, use_src->parent_instr);
+      if (algebraic_update_state(state, use_src->parent_instr))
+         nir_instr_worklist_push_tail(changed, use_src->parent_instr);
+   }
+
+   nir_foreach_instr_in_worklist(instr, changed) {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      nir_foreach_use(use_src, &alu->dest.dest.ssa) {
+         algebraic_worklist_push(state, use_src->parent_instr);
+         if (algebraic_update_state(state, use_src->parent_instr))
+            nir_instr_worklist_push_tail(changed, use_src->parent_instr);
+      }
+   }
+
+   nir_instr_worklist_destroy(changed);
+}
+
+static bool
+nir_algebraic_instr(struct algebraic_pass_state *state, nir_alu_instr *alu)
+{
+   if (!alu->dest.dest.is_ssa)
+      return false;
+
+   uint16_t automaton_state = *algebraic_state(state, &alu->dest.dest.ssa);
+   nir_block *block = alu->instr.block;
+   nir_instr *prev = nir_instr_prev(&alu->instr);
+
+   for (unsigned i = 0; i < state->transform_counts[automaton_state]; i++) {
+      const struct transform *xform =
+         &state->transforms[automaton_state][i];
+      if (!state->condition_flags[xform->condition_offset])
+         continue;
+
+      nir_ssa_def *ssa_val = nir_replace_instr(&state->build, alu,
+                                               xform->search,
+                                               xform->replace);
+      if (!ssa_val)
+         continue;
+
+      /* The replacement was built right where the instruction was, ending
+       * with the mov producing ssa_val.  Give the new instructions their
+       * states in order, and queue them.
+       */
+      nir_instr *new_instr = prev ? nir_instr_next(prev) :
+                                    nir_block_first_instr(block);
+      while (true) {
+         algebraic_update_state(state, new_instr);
+         algebraic_worklist_push(state, new_instr);
+         if (new_instr == ssa_val->parent_instr)
+            break;
+         new_instr = nir_instr_next(new_instr);
+      }
+
+      algebraic_update_uses(state, ssa_val);
+
+      /* The values the old instruction read lost a use, which may matter for
+       * conditions such as is_used_once.
+       */
+      nir_foreach_src(&alu->instr, algebraic_worklist_push_src, state);
+
+      return true;
+   }
+
+   return false;
+}
+
+/**
+ * Run a generated algebraic pass over \p impl.
+ *
+ * Instructions are matched using the tree automaton generated along with
+ * the pass: \p pass_op_table gives its transitions, and \p transforms and
+ * \p transform_counts, indexed by automaton state, the transforms that may
+ * match an instruction in a given state.
+ *
+ * Every ALU instruction is visited once, in reverse order.  After that only
+ * the instructions a replacement may have affected are revisited, so the
+ * pass stops as soon as nothing it knows about has changed rather than
+ * sweeping the whole function again.
+ */
+bool
+nir_algebraic_impl(nir_function_impl *impl,
+                   const bool *condition_flags,
+                   const struct transform **transforms,
+                   const uint16_t *transform_counts,
+                   const struct per_op_table *pass_op_table)
+{
+   bool progress = false;
+
+   struct algebraic_pass_state state = {
+      .condition_flags = condition_flags,
+      .transforms = transforms,
+      .transform_counts = transform_counts,
+      .pass_op_table = pass_op_table,
+   };
+
+   nir_builder_init(&state.build, impl);
+
+   /* Every SSA def starts out in the wildcard state, so only ALU
+    * instructions and constants need to be visited.
+    */
+   util_dynarray_init(&state.states, NULL);
+   util_dynarray_resize(&state.states, impl->ssa_alloc * sizeof(uint16_t));
+   memset(state.states.data, 0, state.states.size);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block) {
+         instr->pass_flags = 0;
+         algebraic_update_state(&state, instr);
+      }
+   }
+
+   state.worklist = nir_instr_worklist_create();
+
+   nir_foreach_block_reverse(block, impl) {
+      nir_foreach_instr_reverse(instr, block)
+         algebraic_worklist_push(&state, instr);
+   }
+
+   nir_foreach_instr_in_worklist(instr, state.worklist) {
+      instr->pass_flags = 0;
+      progress |= nir_algebraic_instr(&state, nir_instr_as_alu(instr));
+   }
+
+   nir_instr_worklist_destroy(state.worklist);
+   util_dynarray_fini(&state.states);
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   } else {
+#ifndef NDEBUG
+      impl->valid_metadata &= ~nir_metadata_not_properly_reset;
+#endif
+   }
+
+   return progress;
+}
@@ -25,8 +25,16 @@
 #include "nir_control_flow.h"
 #include "util/u_dynarray.h"
 
+/* Object, type and string references are stored as 32-bit indices.  The two
+ * low bits of a source reference are used for flags, see write_src().
+ */
+#define MAX_OBJECT_IDS (1 << 30)
+
+/* Marks a type or string reference that is followed by its definition */
+#define NEW_REF UINT32_MAX
+
 typedef struct {
-   size_t blob_offset;
+   intptr_t blob_offset;
    nir_ssa_def *src;
    nir_block *block;
 } write_phi_fixup;
@@ -40,12 +48,23 @@ typedef struct {
    struct hash_table *remap_table;
 
    /* the next index to assign to a NIR in-memory object */
-   uintptr_t next_idx;
+   uint32_t next_idx;
 
    /* Array of write_phi_fixup structs representing phi sources that need to
     * be resolved in the second pass.
     */
    struct util_dynarray phi_fixups;
+
+   /* Each distinct type and string is written once.  These map them to the
+    * index later references use.
+    */
+   struct hash_table *type_table;
+   uint32_t next_type_idx;
+   struct hash_table *string_table;
+   uint32_t next_string_idx;
+
+   /* Whether to drop variable, register and SSA value names */
+   bool strip;
 } write_ctx;
 
 typedef struct {
@@ -65,16 +84,22 @@ typedef struct {
    /* List of phi sources. */
    struct list_head phi_srcs;
 
+   /* Types and strings read so far, in the order they were written.  The
+    * strings point into the blob.
+    */
+   struct util_dynarray types;
+   struct util_dynarray strings;
 } read_ctx;
 
 static void
 write_add_object(write_ctx *ctx, const void *obj)
 {
    uintptr_t index = ctx->next_idx++;
+   assert(index < MAX_OBJECT_IDS);
    _mesa_hash_table_insert(ctx->remap_table, obj, (void *) index);
 }
 
-static uintptr_t
+static uint32_t
 write_lookup_object(write_ctx *ctx, const void *obj)
 {
    struct hash_entry *entry = _mesa_hash_table_search(ctx->remap_table, obj);
@@ -85,7 +110,7 @@ write_lookup_object(write_ctx *ctx, const void *obj)
 static void
 write_object(write_ctx *ctx, const void *obj)
 {
-   blob_write_intptr(ctx->blob, write_lookup_object(ctx, obj));
+   blob_write_uint32(ctx->blob, write_lookup_object(ctx, obj));
 }
 
 static void
@@ -105,7 +130,101 @@ read_lookup_object(read_ctx *ctx, uintptr_t idx)
 static void *
 read_object(read_ctx *ctx)
 {
-   return read_lookup_object(ctx, blob_read_intptr(ctx->blob));
+   return read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+}
+
+/* Types are written in full the first time they are seen and as an index
+ * into the types seen so far afterwards.  Struct and interface types in
+ * particular are big and every deref of a variable repeats its type, so
+ * this saves both space and the type lookups decode_type_from_blob does.
+ */
+static void
+write_type(write_ctx *ctx, const struct glsl_type *type)
+{
+   if (type == NULL) {
+      blob_write_uint32(ctx->blob, 0);
+      return;
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->type_table, type);
+   if (entry) {
+      blob_write_uint32(ctx->blob, (uintptr_t) entry->data);
+      return;
+   }
+
+   uintptr_t index = ++ctx->next_type_idx;
+   assert(index < NEW_REF);
+   _mesa_hash_table_insert(ctx->type_table, type, (void *) index);
+
+   blob_write_uint32(ctx->blob, NEW_REF);
+   encode_type_to_blob(ctx->blob, type);
+}
+
+static const struct glsl_type *
+read_type(read_ctx *ctx)
+{
+   uint32_t ref = blob_read_uint32(ctx->blob);
+   if (ref == 0)
+      return NULL;
+
+   if (ref == NEW_REF) {
+      const struct glsl_type *type = decode_type_from_blob(ctx->blob);
+      util_dynarray_append(&ctx->types, const struct glsl_type *, type);
+      return type;
+   }
+
+   assert(ref <= util_dynarray_num_elements(&ctx->types,
+                                            const struct glsl_type *));
+   return *util_dynarray_element(&ctx->types, const struct glsl_type *,
+                                 ref - 1);
+}
+
+/* Strings use the same scheme as types, with 0 standing for NULL */
+static void
+write_string(write_ctx *ctx, const char *str)
+{
+   if (str == NULL) {
+      blob_write_uint32(ctx->blob, 0);
+      return;
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->string_table, str);
+   if (entry) {
+      blob_write_uint32(ctx->blob, (uintptr_t) entry->data);
+      return;
+   }
+
+   uintptr_t index = ++ctx->next_string_idx;
+   assert(index < NEW_REF);
+   _mesa_hash_table_insert(ctx->string_table, str, (void *) index);
+
+   blob_write_uint32(ctx->blob, NEW_REF);
+   blob_write_string(ctx->blob, str);
+}
+
+static const char *
+read_string(read_ctx *ctx)
+{
+   uint32_t ref = blob_read_uint32(ctx->blob);
+   if (ref == 0)
+      return NULL;
+
+   if (ref == NEW_REF) {
+      const char *str = blob_read_string(ctx->blob);
+      util_dynarray_append(&ctx->strings, const char *, str);
+      return str;
+   }
+
+   assert(ref <= util_dynarray_num_elements(&ctx->strings, const char *));
+   return *util_dynarray_element(&ctx->strings, const char *, ref - 1);
+}
+
+/* Same as read_string() but returns a copy owned by mem_ctx */
+static char *
+read_string_dup(read_ctx *ctx, void *mem_ctx)
+{
+   const char *str = read_string(ctx);
+   return str ? ralloc_strdup(mem_ctx, str) : NULL;
 }
 
 static void
@@ -135,10 +254,8 @@ static void
 write_variable(write_ctx *ctx, const nir_variable *var)
 {
    write_add_object(ctx, var);
-   encode_type_to_blob(ctx->blob, var->type);
-   blob_write_uint32(ctx->blob, !!(var->name));
-   if (var->name)
-      blob_write_string(ctx->blob, var->name);
+   write_type(ctx, var->type);
+   write_string(ctx, ctx->strip ? NULL : var->name);
    blob_write_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
    blob_write_uint32(ctx->blob, var->num_state_slots);
    for (unsigned i = 0; i < var->num_state_slots; i++) {
@@ -149,9 +266,7 @@ write_variable(write_ctx *ctx, const nir_variable *var)
    blob_write_uint32(ctx->blob, !!(var->constant_initializer));
    if (var->constant_initializer)
       write_constant(ctx, var->constant_initializer);
-   blob_write_uint32(ctx->blob, !!(var->interface_type));
-   if (var->interface_type)
-      encode_type_to_blob(ctx->blob, var->interface_type);
+   write_type(ctx, var->interface_type);
    blob_write_uint32(ctx->blob, var->num_members);
    if (var->num_members > 0) {
       blob_write_bytes(ctx->blob, (uint8_t *) var->members,
@@ -165,14 +280,8 @@ read_variable(read_ctx *ctx)
    nir_variable *var = rzalloc(ctx->nir, nir_variable);
    read_add_object(ctx, var);
 
-   var->type = decode_type_from_blob(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
-   if (has_name) {
-      const char *name = blob_read_string(ctx->blob);
-      var->name = ralloc_strdup(var, name);
-   } else {
-      var->name = NULL;
-   }
+   var->type = read_type(ctx);
+   var->name = read_string_dup(ctx, var);
    blob_copy_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
    var->num_state_slots = blob_read_uint32(ctx->blob);
    if (var->num_state_slots != 0) {
@@ -189,11 +298,7 @@ read_variable(read_ctx *ctx)
       var->constant_initializer = read_constant(ctx, var);
    else
       var->constant_initializer = NULL;
-   bool has_interface_type = blob_read_uint32(ctx->blob);
-   if (has_interface_type)
-      var->interface_type = decode_type_from_blob(ctx->blob);
-   else
-      var->interface_type = NULL;
+   var->interface_type = read_type(ctx);
    var->num_members = blob_read_uint32(ctx->blob);
    if (var->num_members > 0) {
       var->members = ralloc_array(var, struct nir_variable_data,
@@ -233,9 +338,7 @@ write_register(write_ctx *ctx, const nir_register *reg)
    blob_write_uint32(ctx->blob, reg->bit_size);
    blob_write_uint32(ctx->blob, reg->num_array_elems);
    blob_write_uint32(ctx->blob, reg->index);
-   blob_write_uint32(ctx->blob, !!(reg->name));
-   if (reg->name)
-      blob_write_string(ctx->blob, reg->name);
+   write_string(ctx, ctx->strip ? NULL : reg->name);
 }
 
 static nir_register *
@@ -247,13 +350,7 @@ read_register(read_ctx *ctx)
    reg->bit_size = blob_read_uint32(ctx->blob);
    reg->num_array_elems = blob_read_uint32(ctx->blob);
    reg->index = blob_read_uint32(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
-   if (has_name) {
-      const char *name = blob_read_string(ctx->blob);
-      reg->name = ralloc_strdup(reg, name);
-   } else {
-      reg->name = NULL;
-   }
+   reg->name = read_string_dup(ctx, reg);
 
    list_inithead(&reg->uses);
    list_inithead(&reg->defs);
@@ -286,19 +383,18 @@ write_src(write_ctx *ctx, const nir_src *src)
 {
    /* Since sources are very frequent, we try to save some space when storing
     * them. In particular, we store whether the source is a register and
-    * whether the register has an indirect index in the low two bits. We can
-    * assume that the high two bits of the index are zero, since otherwise our
-    * address space would've been exhausted allocating the remap table!
+    * whether the register has an indirect index in the low two bits.
+    * write_add_object() makes sure indices fit in the remaining 30 bits.
     */
    if (src->is_ssa) {
-      uintptr_t idx = write_lookup_object(ctx, src->ssa) << 2;
+      uint32_t idx = write_lookup_object(ctx, src->ssa) << 2;
       idx |= 1;
-      blob_write_intptr(ctx->blob, idx);
+      blob_write_uint32(ctx->blob, idx);
    } else {
-      uintptr_t idx = write_lookup_object(ctx, src->reg.reg) << 2;
+      uint32_t idx = write_lookup_object(ctx, src->reg.reg) << 2;
       if (src->reg.indirect)
          idx |= 2;
-      blob_write_intptr(ctx->blob, idx);
+      blob_write_uint32(ctx->blob, idx);
       blob_write_uint32(ctx->blob, src->reg.base_offset);
       if (src->reg.indirect) {
          write_src(ctx, src->reg.indirect);
@@ -309,8 +405,8 @@ write_src(write_ctx *ctx, const nir_src *src)
 static void
 read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
 {
-   uintptr_t val = blob_read_intptr(ctx->blob);
-   uintptr_t idx = val >> 2;
+   uint32_t val = blob_read_uint32(ctx->blob);
+   uint32_t idx = val >> 2;
    src->is_ssa = val & 0x1;
    if (src->is_ssa) {
       src->ssa = read_lookup_object(ctx, idx);
@@ -331,8 +427,9 @@ static void
 write_dest(write_ctx *ctx, const nir_dest *dst)
 {
    uint32_t val = dst->is_ssa;
+   const char *name = ctx->strip ? NULL : dst->ssa.name;
    if (dst->is_ssa) {
-      val |= !!(dst->ssa.name) << 1;
+      val |= !!name << 1;
       val |= dst->ssa.num_components << 2;
       val |= dst->ssa.bit_size << 5;
    } else {
@@ -341,10 +438,10 @@ write_dest(write_ctx *ctx, const nir_dest *dst)
    blob_write_uint32(ctx->blob, val);
    if (dst->is_ssa) {
       write_add_object(ctx, &dst->ssa);
-      if (dst->ssa.name)
-         blob_write_string(ctx->blob, dst->ssa.name);
+      if (name)
+         write_string(ctx, name);
    } else {
-      blob_write_intptr(ctx->blob, write_lookup_object(ctx, dst->reg.reg));
+      write_object(ctx, dst->reg.reg);
       blob_write_uint32(ctx->blob, dst->reg.base_offset);
       if (dst->reg.indirect)
          write_src(ctx, dst->reg.indirect);
@@ -360,7 +457,7 @@ read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr)
       bool has_name = val & 0x2;
       unsigned num_components = (val >> 2) & 0x7;
       unsigned bit_size = val >> 5;
-      char *name = has_name ? blob_read_string(ctx->blob) : NULL;
+      const char *name = has_name ? read_string(ctx) : NULL;
       nir_ssa_dest_init(instr, dst, num_components, bit_size, name);
       read_add_object(ctx, &dst->ssa);
    } else {
@@ -374,20 +471,106 @@ read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr)
    }
 }
 
+/* Every instruction starts with one of these, packing the instruction type
+ * together with the fields that are almost always small.
+ */
+union packed_instr {
+   uint32_t u32;
+   struct {
+      unsigned instr_type:4;
+      unsigned _pad:28;
+   } any;
+   struct {
+      unsigned instr_type:4;
+      unsigned exact:1;
+      unsigned saturate:1;
+      unsigned write_mask:4;
+      /* Set if no source has modifiers or a non-identity swizzle, in which
+       * case the per-source flags are omitted.
+       */
+      unsigned plain_srcs:1;
+      unsigned op:16;
+      unsigned _pad:5;
+   } alu;
+   struct {
+      unsigned instr_type:4;
+      unsigned deref_type:3;
+      unsigned mode:16;
+      unsigned _pad:9;
+   } deref;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:4;
+      unsigned intrinsic:16;
+      unsigned _pad:8;
+   } intrinsic;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:4;
+      unsigned bit_size:7;
+      unsigned _pad:17;
+   } load_const;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:4;
+      unsigned bit_size:7;
+      unsigned _pad:17;
+   } undef;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_srcs:8;
+      unsigned op:4;
+      unsigned _pad:16;
+   } tex;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_srcs:28;
+   } phi;
+   struct {
+      unsigned instr_type:4;
+      unsigned type:2;
+      unsigned _pad:26;
+   } jump;
+};
+
+static bool
+alu_src_is_plain(const nir_alu_src *src)
+{
+   if (src->negate || src->abs)
+      return false;
+
+   for (unsigned i = 0; i < 4; i++) {
+      if (src->swizzle[i] != i)
+         return false;
+   }
+
+   return true;
+}
+
 static void
-write_alu(write_ctx *ctx, const nir_alu_instr *alu)
+write_alu(write_ctx *ctx, const nir_alu_instr *alu, union packed_instr header)
 {
-   blob_write_uint32(ctx->blob, alu->op);
-   uint32_t flags = alu->exact;
-   flags |= alu->dest.saturate << 1;
-   flags |= alu->dest.write_mask << 2;
-   blob_write_uint32(ctx->blob, flags);
+   const unsigned num_inputs = nir_op_infos[alu->op].num_inputs;
+
+   bool plain_srcs = true;
+   for (unsigned i = 0; i < num_inputs; i++)
+      plain_srcs &= alu_src_is_plain(&alu->src[i]);
+
+   header.alu.exact = alu->exact;
+   header.alu.saturate = alu->dest.saturate;
+   header.alu.write_mask = alu->dest.write_mask;
+   header.alu.plain_srcs = plain_srcs;
+   header.alu.op = alu->op;
+   blob_write_uint32(ctx->blob, header.u32);
 
    write_dest(ctx, &alu->dest.dest);
 
-   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+   for (unsigned i = 0; i < num_inputs; i++) {
       write_src(ctx, &alu->src[i].src);
-      flags = alu->src[i].negate;
+      if (plain_srcs)
+         continue;
+
+      uint32_t flags = alu->src[i].negate;
       flags |= alu->src[i].abs << 1;
       for (unsigned j = 0; j < 4; j++)
          flags |= alu->src[i].swizzle[j] << (2 + 2 * j);
@@ -396,21 +579,27 @@ write_alu(write_ctx *ctx, const nir_alu_instr *alu)
 }
 
 static nir_alu_instr *
-read_alu(read_ctx *ctx)
+read_alu(read_ctx *ctx, union packed_instr header)
 {
-   nir_op op = blob_read_uint32(ctx->blob);
+   nir_op op = header.alu.op;
    nir_alu_instr *alu = nir_alu_instr_create(ctx->nir, op);
 
-   uint32_t flags = blob_read_uint32(ctx->blob);
-   alu->exact = flags & 1;
-   alu->dest.saturate = flags & 2;
-   alu->dest.write_mask = flags >> 2;
+   alu->exact = header.alu.exact;
+   alu->dest.saturate = header.alu.saturate;
+   alu->dest.write_mask = header.alu.write_mask;
 
    read_dest(ctx, &alu->dest.dest, &alu->instr);
 
    for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
       read_src(ctx, &alu->src[i].src, &alu->instr);
-      flags = blob_read_uint32(ctx->blob);
+
+      /* nir_alu_instr_create() already set up identity swizzles and no
+       * modifiers.
+       */
+      if (header.alu.plain_srcs)
+         continue;
+
+      uint32_t flags = blob_read_uint32(ctx->blob);
       alu->src[i].negate = flags & 1;
       alu->src[i].abs = flags & 2;
       for (unsigned j = 0; j < 4; j++)
@@ -421,12 +610,15 @@ read_alu(read_ctx *ctx)
 }
 
 static void
-write_deref(write_ctx *ctx, const nir_deref_instr *deref)
+write_deref(write_ctx *ctx, const nir_deref_instr *deref,
+            union packed_instr header)
 {
-   blob_write_uint32(ctx->blob, deref->deref_type);
+   assert(deref->mode < (1 << 16));
+   header.deref.deref_type = deref->deref_type;
+   header.deref.mode = deref->mode;
+   blob_write_uint32(ctx->blob, header.u32);
 
-   blob_write_uint32(ctx->blob, deref->mode);
-   encode_type_to_blob(ctx->blob, deref->type);
+   write_type(ctx, deref->type);
 
    write_dest(ctx, &deref->dest);
 
@@ -461,13 +653,13 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 }
 
 static nir_deref_instr *
-read_deref(read_ctx *ctx)
+read_deref(read_ctx *ctx, union packed_instr header)
 {
-   nir_deref_type deref_type = blob_read_uint32(ctx->blob);
+   nir_deref_type deref_type = header.deref.deref_type;
    nir_deref_instr *deref = nir_deref_instr_create(ctx->nir, deref_type);
 
-   deref->mode = blob_read_uint32(ctx->blob);
-   deref->type = decode_type_from_blob(ctx->blob);
+   deref->mode = header.deref.mode;
+   deref->type = read_type(ctx);
 
    read_dest(ctx, &deref->dest, &deref->instr);
 
@@ -504,14 +696,15 @@ read_deref(read_ctx *ctx)
 }
 
 static void
-write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
+write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin,
+                union packed_instr header)
 {
-   blob_write_uint32(ctx->blob, intrin->intrinsic);
-
    unsigned num_srcs = nir_intrinsic_infos[intrin->intrinsic].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[intrin->intrinsic].num_indices;
 
-   blob_write_uint32(ctx->blob, intrin->num_components);
+   header.intrinsic.num_components = intrin->num_components;
+   header.intrinsic.intrinsic = intrin->intrinsic;
+   blob_write_uint32(ctx->blob, header.u32);
 
    if (nir_intrinsic_infos[intrin->intrinsic].has_dest)
       write_dest(ctx, &intrin->dest);
@@ -524,16 +717,16 @@ write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
 }
 
 static nir_intrinsic_instr *
-read_intrinsic(read_ctx *ctx)
+read_intrinsic(read_ctx *ctx, union packed_instr header)
 {
-   nir_intrinsic_op op = blob_read_uint32(ctx->blob);
+   nir_intrinsic_op op = header.intrinsic.intrinsic;
 
    nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(ctx->nir, op);
 
    unsigned num_srcs = nir_intrinsic_infos[op].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[op].num_indices;
 
-   intrin->num_components = blob_read_uint32(ctx->blob);
+   intrin->num_components = header.intrinsic.num_components;
 
    if (nir_intrinsic_infos[op].has_dest)
       read_dest(ctx, &intrin->dest, &intrin->instr);
@@ -548,44 +741,56 @@ read_intrinsic(read_ctx *ctx)
 }
 
 static void
-write_load_const(write_ctx *ctx, const nir_load_const_instr *lc)
+write_load_const(write_ctx *ctx, const nir_load_const_instr *lc,
+                 union packed_instr header)
 {
-   uint32_t val = lc->def.num_components;
-   val |= lc->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
-   blob_write_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
+   header.load_const.num_components = lc->def.num_components;
+   header.load_const.bit_size = lc->def.bit_size;
+   blob_write_uint32(ctx->blob, header.u32);
+
+   /* Only write as many bytes per component as the bit size needs */
+   for (unsigned i = 0; i < lc->def.num_components; i++) {
+      if (lc->def.bit_size == 64)
+         blob_write_uint64(ctx->blob, lc->value[i].u64);
+      else
+         blob_write_uint32(ctx->blob, lc->value[i].u32);
+   }
    write_add_object(ctx, &lc->def);
 }
 
 static nir_load_const_instr *
-read_load_const(read_ctx *ctx)
+read_load_const(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
    nir_load_const_instr *lc =
-      nir_load_const_instr_create(ctx->nir, val & 0x7, val >> 3);
-
-   blob_copy_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
+      nir_load_const_instr_create(ctx->nir, header.load_const.num_components,
+                                  header.load_const.bit_size);
+
+   for (unsigned i = 0; i < lc->def.num_components; i++) {
+      if (lc->def.bit_size == 64)
+         lc->value[i].u64 = blob_read_uint64(ctx->blob);
+      else
+         lc->value[i].u32 = blob_read_uint32(ctx->blob);
+   }
    read_add_object(ctx, &lc->def);
    return lc;
 }
 
 static void
-write_ssa_undef(write_ctx *ctx, const nir_ssa_undef_instr *undef)
+write_ssa_undef(write_ctx *ctx, const nir_ssa_undef_instr *undef,
+                union packed_instr header)
 {
-   uint32_t val = undef->def.num_components;
-   val |= undef->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
+   header.undef.num_components = undef->def.num_components;
+   header.undef.bit_size = undef->def.bit_size;
+   blob_write_uint32(ctx->blob, header.u32);
    write_add_object(ctx, &undef->def);
 }
 
 static nir_ssa_undef_instr *
-read_ssa_undef(read_ctx *ctx)
+read_ssa_undef(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
    nir_ssa_undef_instr *undef =
-      nir_ssa_undef_instr_create(ctx->nir, val & 0x7, val >> 3);
+      nir_ssa_undef_instr_create(ctx->nir, header.undef.num_components,
+                                 header.undef.bit_size);
 
    read_add_object(ctx, &undef->def);
    return undef;
@@ -606,10 +811,13 @@ union packed_tex_data {
 };
 
 static void
-write_tex(write_ctx *ctx, const nir_tex_instr *tex)
+write_tex(write_ctx *ctx, const nir_tex_instr *tex, union packed_instr header)
 {
-   blob_write_uint32(ctx->blob, tex->num_srcs);
-   blob_write_uint32(ctx->blob, tex->op);
+   assert(tex->num_srcs < (1 << 8));
+   header.tex.num_srcs = tex->num_srcs;
+   header.tex.op = tex->op;
+   blob_write_uint32(ctx->blob, header.u32);
+
    blob_write_uint32(ctx->blob, tex->texture_index);
    blob_write_uint32(ctx->blob, tex->texture_array_size);
    blob_write_uint32(ctx->blob, tex->sampler_index);
@@ -635,12 +843,11 @@ write_tex(write_ctx *ctx, const nir_tex_instr *tex)
 }
 
 static nir_tex_instr *
-read_tex(read_ctx *ctx)
+read_tex(read_ctx *ctx, union packed_instr header)
 {
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
-   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, num_srcs);
+   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, header.tex.num_srcs);
 
-   tex->op = blob_read_uint32(ctx->blob);
+   tex->op = header.tex.op;
    tex->texture_index = blob_read_uint32(ctx->blob);
    tex->texture_array_size = blob_read_uint32(ctx->blob);
    tex->sampler_index = blob_read_uint32(ctx->blob);
@@ -666,22 +873,23 @@ read_tex(read_ctx *ctx)
 }
 
 static void
-write_phi(write_ctx *ctx, const nir_phi_instr *phi)
+write_phi(write_ctx *ctx, const nir_phi_instr *phi, union packed_instr header)
 {
    /* Phi nodes are special, since they may reference SSA definitions and
-    * basic blocks that don't exist yet. We leave two empty uintptr_t's here,
+    * basic blocks that don't exist yet. We leave two empty uint32_t's here,
     * and then store enough information so that a later fixup pass can fill
     * them in correctly.
     */
-   write_dest(ctx, &phi->dest);
+   header.phi.num_srcs = exec_list_length(&phi->srcs);
+   blob_write_uint32(ctx->blob, header.u32);
 
-   blob_write_uint32(ctx->blob, exec_list_length(&phi->srcs));
+   write_dest(ctx, &phi->dest);
 
    nir_foreach_phi_src(src, phi) {
       assert(src->src.is_ssa);
-      size_t blob_offset = blob_reserve_intptr(ctx->blob);
-      MAYBE_UNUSED size_t blob_offset2 = blob_reserve_intptr(ctx->blob);
-      assert(blob_offset + sizeof(uintptr_t) == blob_offset2);
+      intptr_t blob_offset = blob_reserve_uint32(ctx->blob);
+      MAYBE_UNUSED intptr_t blob_offset2 = blob_reserve_uint32(ctx->blob);
+      assert(blob_offset + sizeof(uint32_t) == blob_offset2);
       write_phi_fixup fixup = {
          .blob_offset = blob_offset,
          .src = src->src.ssa,
@@ -695,22 +903,23 @@ static void
 write_fixup_phis(write_ctx *ctx)
 {
    util_dynarray_foreach(&ctx->phi_fixups, write_phi_fixup, fixup) {
-      uintptr_t *blob_ptr = (uintptr_t *)(ctx->blob->data + fixup->blob_offset);
-      blob_ptr[0] = write_lookup_object(ctx, fixup->src);
-      blob_ptr[1] = write_lookup_object(ctx, fixup->block);
+      blob_overwrite_uint32(ctx->blob, fixup->blob_offset,
+                            write_lookup_object(ctx, fixup->src));
+      blob_overwrite_uint32(ctx->blob, fixup->blob_offset + sizeof(uint32_t),
+                            write_lookup_object(ctx, fixup->block));
    }
 
    util_dynarray_clear(&ctx->phi_fixups);
 }
 
 static nir_phi_instr *
-read_phi(read_ctx *ctx, nir_block *blk)
+read_phi(read_ctx *ctx, nir_block *blk, union packed_instr header)
 {
    nir_phi_instr *phi = nir_phi_instr_create(ctx->nir);
 
    read_dest(ctx, &phi->dest, &phi->instr);
 
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
+   unsigned num_srcs = header.phi.num_srcs;
 
    /* For similar reasons as before, we just store the index directly into the
     * pointer, and let a later pass resolve the phi sources.
@@ -726,8 +935,8 @@ read_phi(read_ctx *ctx, nir_block *blk)
       nir_phi_src *src = ralloc(phi, nir_phi_src);
 
       src->src.is_ssa = true;
-      src->src.ssa = (nir_ssa_def *) blob_read_intptr(ctx->blob);
-      src->pred = (nir_block *) blob_read_intptr(ctx->blob);
+      src->src.ssa = (nir_ssa_def *) (uintptr_t) blob_read_uint32(ctx->blob);
+      src->pred = (nir_block *) (uintptr_t) blob_read_uint32(ctx->blob);
 
       /* Since we're not letting nir_insert_instr handle use/def stuff for us,
        * we have to set the parent_instr manually.  It doesn't really matter
@@ -762,23 +971,24 @@ read_fixup_phis(read_ctx *ctx)
 }
 
 static void
-write_jump(write_ctx *ctx, const nir_jump_instr *jmp)
+write_jump(write_ctx *ctx, const nir_jump_instr *jmp, union packed_instr header)
 {
-   blob_write_uint32(ctx->blob, jmp->type);
+   header.jump.type = jmp->type;
+   blob_write_uint32(ctx->blob, header.u32);
 }
 
 static nir_jump_instr *
-read_jump(read_ctx *ctx)
+read_jump(read_ctx *ctx, union packed_instr header)
 {
-   nir_jump_type type = blob_read_uint32(ctx->blob);
-   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir, type);
+   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir, header.jump.type);
    return jmp;
 }
 
 static void
-write_call(write_ctx *ctx, const nir_call_instr *call)
+write_call(write_ctx *ctx, const nir_call_instr *call, union packed_instr header)
 {
-   blob_write_intptr(ctx->blob, write_lookup_object(ctx, call->callee));
+   blob_write_uint32(ctx->blob, header.u32);
+   write_object(ctx, call->callee);
 
    for (unsigned i = 0; i < call->num_params; i++)
       write_src(ctx, &call->params[i]);
@@ -799,34 +1009,41 @@ read_call(read_ctx *ctx)
 static void
 write_instr(write_ctx *ctx, const nir_instr *instr)
 {
-   blob_write_uint32(ctx->blob, instr->type);
+   STATIC_ASSERT(sizeof(union packed_instr) == sizeof(uint32_t));
+   STATIC_ASSERT(nir_num_opcodes <= (1 << 16));
+   STATIC_ASSERT(nir_num_intrinsics <= (1 << 16));
+   STATIC_ASSERT(NIR_MAX_VEC_COMPONENTS < (1 << 4));
+
+   union packed_instr header = { .u32 = 0 };
+   header.any.instr_type = instr->type;
+
    switch (instr->type) {
    case nir_instr_type_alu:
-      write_alu(ctx, nir_instr_as_alu(instr));
+      write_alu(ctx, nir_instr_as_alu(instr), header);
       break;
    case nir_instr_type_deref:
-      write_deref(ctx, nir_instr_as_deref(instr));
+      write_deref(ctx, nir_instr_as_deref(instr), header);
       break;
    case nir_instr_type_intrinsic:
-      write_intrinsic(ctx, nir_instr_as_intrinsic(instr));
+      write_intrinsic(ctx, nir_instr_as_intrinsic(instr), header);
       break;
    case nir_instr_type_load_const:
-      write_load_const(ctx, nir_instr_as_load_const(instr));
+      write_load_const(ctx, nir_instr_as_load_const(instr), header);
       break;
    case nir_instr_type_ssa_undef:
-      write_ssa_undef(ctx, nir_instr_as_ssa_undef(instr));
+      write_ssa_undef(ctx, nir_instr_as_ssa_undef(instr), header);
       break;
    case nir_instr_type_tex:
-      write_tex(ctx, nir_instr_as_tex(instr));
+      write_tex(ctx, nir_instr_as_tex(instr), header);
       break;
    case nir_instr_type_phi:
-      write_phi(ctx, nir_instr_as_phi(instr));
+      write_phi(ctx, nir_instr_as_phi(instr), header);
       break;
    case nir_instr_type_jump:
-      write_jump(ctx, nir_instr_as_jump(instr));
+      write_jump(ctx, nir_instr_as_jump(instr), header);
       break;
    case nir_instr_type_call:
-      write_call(ctx, nir_instr_as_call(instr));
+      write_call(ctx, nir_instr_as_call(instr), header);
       break;
    case nir_instr_type_parallel_copy:
       unreachable("Cannot write parallel copies");
@@ -838,26 +1055,28 @@ write_instr(write_ctx *ctx, const nir_instr *instr)
 static void
 read_instr(read_ctx *ctx, nir_block *block)
 {
-   nir_instr_type type = blob_read_uint32(ctx->blob);
+   union packed_instr header;
+   header.u32 = blob_read_uint32(ctx->blob);
+
    nir_instr *instr;
-   switch (type) {
+   switch (header.any.instr_type) {
    case nir_instr_type_alu:
-      instr = &read_alu(ctx)->instr;
+      instr = &read_alu(ctx, header)->instr;
       break;
    case nir_instr_type_deref:
-      instr = &read_deref(ctx)->instr;
+      instr = &read_deref(ctx, header)->instr;
       break;
    case nir_instr_type_intrinsic:
-      instr = &read_intrinsic(ctx)->instr;
+      instr = &read_intrinsic(ctx, header)->instr;
       break;
    case nir_instr_type_load_const:
-      instr = &read_load_const(ctx)->instr;
+      instr = &read_load_const(ctx, header)->instr;
       break;
    case nir_instr_type_ssa_undef:
-      instr = &read_ssa_undef(ctx)->instr;
+      instr = &read_ssa_undef(ctx, header)->instr;
       break;
    case nir_instr_type_tex:
-      instr = &read_tex(ctx)->instr;
+      instr = &read_tex(ctx, header)->instr;
       break;
    case nir_instr_type_phi:
       /* Phi instructions are a bit of a special case when reading because we
@@ -865,10 +1084,10 @@ read_instr(read_ctx *ctx, nir_block *block)
        * for us.  Instead, we need to wait until all the blocks/instructions
        * are read so that we can set their sources up.
        */
-      read_phi(ctx, block);
+      read_phi(ctx, block, header);
       return;
    case nir_instr_type_jump:
-      instr = &read_jump(ctx)->instr;
+      instr = &read_jump(ctx, header)->instr;
       break;
    case nir_instr_type_call:
       instr = &read_call(ctx)->instr;
@@ -1041,9 +1260,7 @@ read_function_impl(read_ctx *ctx, nir_function *fxn)
 static void
 write_function(write_ctx *ctx, const nir_function *fxn)
 {
-   blob_write_uint32(ctx->blob, !!(fxn->name));
-   if (fxn->name)
-      blob_write_string(ctx->blob, fxn->name);
+   write_string(ctx, fxn->name);
 
    write_add_object(ctx, fxn);
 
@@ -1067,8 +1284,7 @@ write_function(write_ctx *ctx, const nir_function *fxn)
 static void
 read_function(read_ctx *ctx)
 {
-   bool has_name = blob_read_uint32(ctx->blob);
-   char *name = has_name ? blob_read_string(ctx->blob) : NULL;
+   const char *name = read_string(ctx);
 
    nir_function *fxn = nir_function_create(ctx->nir, name);
 
@@ -1085,8 +1301,15 @@ read_function(read_ctx *ctx)
    fxn->is_entrypoint = blob_read_uint32(ctx->blob);
 }
 
+/**
+ * Serialize the shader into the blob.
+ *
+ * If strip is set, the names of the shader, its variables, registers and SSA
+ * values are left out.  They are only used for debugging and make up a good
+ * part of the blob for shaders coming from GLSL.
+ */
 void
-nir_serialize(struct blob *blob, const nir_shader *nir)
+nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
 {
    write_ctx ctx;
    ctx.remap_table = _mesa_pointer_hash_table_create(NULL);
@@ -1094,20 +1317,18 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
    ctx.blob = blob;
    ctx.nir = nir;
    util_dynarray_init(&ctx.phi_fixups, NULL);
+   ctx.type_table = _mesa_pointer_hash_table_create(NULL);
+   ctx.next_type_idx = 0;
+   ctx.string_table = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                              _mesa_key_string_equal);
+   ctx.next_string_idx = 0;
+   ctx.strip = strip;
 
-   size_t idx_size_offset = blob_reserve_intptr(blob);
+   intptr_t idx_size_offset = blob_reserve_uint32(blob);
 
    struct shader_info info = nir->info;
-   uint32_t strings = 0;
-   if (info.name)
-      strings |= 0x1;
-   if (info.label)
-      strings |= 0x2;
-   blob_write_uint32(blob, strings);
-   if (info.name)
-      blob_write_string(blob, info.name);
-   if (info.label)
-      blob_write_string(blob, info.label);
+   write_string(&ctx, strip ? NULL : info.name);
+   write_string(&ctx, strip ? NULL : info.label);
    info.name = info.label = NULL;
    blob_write_bytes(blob, (uint8_t *) &info, sizeof(info));
 
@@ -1137,9 +1358,11 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
    if (nir->constant_data_size > 0)
       blob_write_bytes(blob, nir->constant_data, nir->constant_data_size);
 
-   *(uintptr_t *)(blob->data + idx_size_offset) = ctx.next_idx;
+   blob_overwrite_uint32(blob, idx_size_offset, ctx.next_idx);
 
    _mesa_hash_table_destroy(ctx.remap_table, NULL);
+   _mesa_hash_table_destroy(ctx.type_table, NULL);
+   _mesa_hash_table_destroy(ctx.string_table, NULL);
    util_dynarray_fini(&ctx.phi_fixups);
 }
 
@@ -1151,13 +1374,14 @@ nir_deserialize(void *mem_ctx,
    read_ctx ctx;
    ctx.blob = blob;
    list_inithead(&ctx.phi_srcs);
-   ctx.idx_table_len = blob_read_intptr(blob);
+   ctx.idx_table_len = blob_read_uint32(blob);
    ctx.idx_table = calloc(ctx.idx_table_len, sizeof(uintptr_t));
    ctx.next_idx = 0;
+   util_dynarray_init(&ctx.types, NULL);
+   util_dynarray_init(&ctx.strings, NULL);
 
-   uint32_t strings = blob_read_uint32(blob);
-   char *name = (strings & 0x1) ? blob_read_string(blob) : NULL;
-   char *label = (strings & 0x2) ? blob_read_string(blob) : NULL;
+   const char *name = read_string(&ctx);
+   const char *label = read_string(&ctx);
 
    struct shader_info info;
    blob_copy_bytes(blob, (uint8_t *) &info, sizeof(info));
@@ -1198,6 +1422,8 @@ nir_deserialize(void *mem_ctx,
    }
 
    free(ctx.idx_table);
+   util_dynarray_fini(&ctx.types);
+   util_dynarray_fini(&ctx.strings);
 
    return ctx.nir;
 }
@@ -1209,7 +1435,7 @@ nir_shader_serialize_deserialize(void *mem_ctx, nir_shader *s)
 
    struct blob writer;
    blob_init(&writer);
-   nir_serialize(&writer, s);
+   nir_serialize(&writer, s, false);
    ralloc_free(s);
 
    struct blob_reader reader;
@@ -0,0 +1,306 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_load_store_vectorize_test : public ::testing::Test {
+protected:
+   nir_load_store_vectorize_test();
+   ~nir_load_store_vectorize_test();
+
+   nir_intrinsic_instr *create_load(nir_intrinsic_op op, nir_ssa_def *resource,
+                                    uint32_t offset, unsigned num_components = 1);
+   void create_store(nir_ssa_def *resource, uint32_t offset,
+                     nir_ssa_def *value, unsigned wrmask = 0x1);
+
+   unsigned count_intrinsics(nir_intrinsic_op intrinsic);
+
+   nir_intrinsic_instr *get_intrinsic(nir_intrinsic_op intrinsic,
+                                      unsigned index);
+
+   void *mem_ctx;
+
+   nir_builder *b;
+   nir_ssa_def *resource;
+};
+
+nir_load_store_vectorize_test::nir_load_store_vectorize_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+   resource = nir_imm_int(b, 0);
+}
+
+nir_load_store_vectorize_test::~nir_load_store_vectorize_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::create_load(nir_intrinsic_op op,
+                                           nir_ssa_def *resource,
+                                           uint32_t offset,
+                                           unsigned num_components)
+{
+   nir_intrinsic_instr *load = nir_intrinsic_instr_create(b->shader, op);
+   load->num_components = num_components;
+   unsigned src = 0;
+   if (resource)
+      load->src[src++] = nir_src_for_ssa(resource);
+   load->src[src++] = nir_src_for_ssa(nir_imm_int(b, offset));
+   nir_ssa_dest_init(&load->instr, &load->dest, num_components, 32, NULL);
+   if (op == nir_intrinsic_load_shared)
+      nir_intrinsic_set_base(load, 0);
+   else
+      nir_intrinsic_set_access(load, (gl_access_qualifier)0);
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_builder_instr_insert(b, &load->instr);
+   return load;
+}
+
+void
+nir_load_store_vectorize_test::create_store(nir_ssa_def *resource,
+                                            uint32_t offset,
+                                            nir_ssa_def *value,
+                                            unsigned wrmask)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_ssbo);
+   store->num_components = value->num_components;
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(resource);
+   store->src[2] = nir_src_for_ssa(nir_imm_int(b, offset));
+   nir_intrinsic_set_write_mask(store, wrmask);
+   nir_intrinsic_set_access(store, (gl_access_qualifier)0);
+   nir_intrinsic_set_align(store, 4, 0);
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+unsigned
+nir_load_store_vectorize_test::count_intrinsics(nir_intrinsic_op intrinsic)
+{
+   unsigned count = 0;
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (intrin->intrinsic == intrinsic)
+            count++;
+      }
+   }
+   return count;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::get_intrinsic(nir_intrinsic_op intrinsic,
+                                             unsigned index)
+{
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (intrin->intrinsic == intrinsic) {
+            if (index == 0)
+               return intrin;
+            index--;
+         }
+      }
+   }
+   return NULL;
+}
+
+static bool
+only_vec2(unsigned align, unsigned bit_size, unsigned num_components,
+          unsigned high_offset, nir_intrinsic_instr *low,
+          nir_intrinsic_instr *high)
+{
+   return num_components <= 2;
+}
+
+} // namespace
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_adjacent)
+{
+   create_load(nir_intrinsic_load_ssbo, resource, 0);
+   create_load(nir_intrinsic_load_ssbo, resource, 4);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_TRUE(progress);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ssbo, 0);
+   EXPECT_EQ(load->num_components, 2);
+   EXPECT_EQ(nir_src_as_uint(load->src[1]), 0);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_reversed)
+{
+   create_load(nir_intrinsic_load_ssbo, resource, 4);
+   create_load(nir_intrinsic_load_ssbo, resource, 0);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_TRUE(progress);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ssbo, 0);
+   EXPECT_EQ(load->num_components, 2);
+   EXPECT_EQ(nir_intrinsic_align_mul(load), 4);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_gap)
+{
+   create_load(nir_intrinsic_load_ssbo, resource, 0);
+   create_load(nir_intrinsic_load_ssbo, resource, 8);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_FALSE(progress);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_different_resource)
+{
+   create_load(nir_intrinsic_load_ssbo, resource, 0);
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 1), 4);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_FALSE(progress);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_intervening_store)
+{
+   nir_intrinsic_instr *load = create_load(nir_intrinsic_load_ssbo, resource, 0);
+   create_store(resource, 4, &load->dest.ssa);
+   create_load(nir_intrinsic_load_ssbo, resource, 4);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_FALSE(progress);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_unrelated_store)
+{
+   nir_intrinsic_instr *load = create_load(nir_intrinsic_load_ssbo, resource, 0);
+   create_store(resource, 16, &load->dest.ssa);
+   create_load(nir_intrinsic_load_ssbo, resource, 4);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_TRUE(progress);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_adjacent)
+{
+   create_store(resource, 0, nir_imm_int(b, 1));
+   create_store(resource, 4, nir_imm_int(b, 2));
+   create_store(resource, 8, nir_imm_int(b, 3));
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_TRUE(progress);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+
+   nir_intrinsic_instr *store = get_intrinsic(nir_intrinsic_store_ssbo, 0);
+   EXPECT_EQ(store->num_components, 3);
+   EXPECT_EQ(nir_intrinsic_write_mask(store), 0x7);
+   EXPECT_EQ(nir_src_as_uint(store->src[2]), 0);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_intervening_load)
+{
+   create_store(resource, 0, nir_imm_int(b, 1));
+   create_load(nir_intrinsic_load_ssbo, resource, 0);
+   create_store(resource, 4, nir_imm_int(b, 2));
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_FALSE(progress);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, shared_load_adjacent)
+{
+   create_load(nir_intrinsic_load_shared, NULL, 8);
+   create_load(nir_intrinsic_load_shared, NULL, 12);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_shared,
+                                                NULL);
+   EXPECT_TRUE(progress);
+
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_shared), 1);
+
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_shared, 0);
+   EXPECT_EQ(load->num_components, 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, mode_not_requested)
+{
+   create_load(nir_intrinsic_load_shared, NULL, 0);
+   create_load(nir_intrinsic_load_shared, NULL, 4);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                NULL);
+   EXPECT_FALSE(progress);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_shared), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, callback_rejects)
+{
+   create_load(nir_intrinsic_load_ssbo, resource, 0, 2);
+   create_load(nir_intrinsic_load_ssbo, resource, 8);
+
+   bool progress = nir_opt_load_store_vectorize(b->shader, nir_var_mem_ssbo,
+                                                only_vec2);
+   EXPECT_FALSE(progress);
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+/* Each copy of the loop body adds the counter to the sum and increments it. */
+#define IADDS_PER_ITERATION 2
+
+class nir_loop_unroll_test : public ::testing::Test {
+protected:
+   nir_loop_unroll_test();
+   ~nir_loop_unroll_test();
+
+   nir_loop *create_loop(nir_ssa_def *limit);
+   nir_loop *create_loop(int trip_count);
+
+   bool run_pass();
+
+   nir_loop *get_loop();
+   unsigned count_loop_ifs(nir_loop *loop);
+   unsigned count_loop_alus(nir_loop *loop, nir_op op);
+
+   void *mem_ctx;
+
+   nir_shader_compiler_options options;
+   nir_builder *b;
+};
+
+nir_loop_unroll_test::nir_loop_unroll_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+
+   /* Small enough that none of the loops below are unrolled completely. */
+   memset(&options, 0, sizeof(options));
+   options.max_unroll_iterations = 4;
+   options.partial_unroll_factor = 4;
+
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_FRAGMENT, &options);
+}
+
+nir_loop_unroll_test::~nir_loop_unroll_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+/*
+ * Builds
+ *
+ *    int i = 0, sum = 0;
+ *    loop {
+ *       if (i >= limit)
+ *          break;
+ *       sum += i;
+ *       i++;
+ *    }
+ *    out = sum;
+ */
+nir_loop *
+nir_loop_unroll_test::create_loop(nir_ssa_def *limit)
+{
+   nir_variable *i =
+      nir_local_variable_create(b->impl, glsl_int_type(), "i");
+   nir_variable *sum =
+      nir_local_variable_create(b->impl, glsl_int_type(), "sum");
+   nir_variable *out =
+      nir_variable_create(b->shader, nir_var_shader_out, glsl_int_type(),
+                          "out");
+
+   nir_store_var(b, i, nir_imm_int(b, 0), 1);
+   nir_store_var(b, sum, nir_imm_int(b, 0), 1);
+
+   nir_loop *loop = nir_push_loop(b);
+   {
+      nir_ssa_def *iv = nir_load_var(b, i);
+
+      nir_push_if(b, nir_ige(b, iv, limit));
+      {
+         nir_jump(b, nir_jump_break);
+      }
+      nir_pop_if(b, NULL);
+
+      nir_store_var(b, sum, nir_iadd(b, nir_load_var(b, sum), iv), 1);
+      nir_store_var(b, i, nir_iadd(b, iv, nir_imm_int(b, 1)), 1);
+   }
+   nir_pop_loop(b, loop);
+
+   nir_store_var(b, out, nir_load_var(b, sum), 1);
+
+   nir_validate_shader(b->shader, NULL);
+   nir_lower_vars_to_ssa(b->shader);
+   nir_copy_prop(b->shader);
+   nir_opt_dce(b->shader);
+
+   return loop;
+}
+
+nir_loop *
+nir_loop_unroll_test::create_loop(int trip_count)
+{
+   return create_loop(nir_imm_int(b, trip_count));
+}
+
+bool
+nir_loop_unroll_test::run_pass()
+{
+   bool progress = nir_opt_loop_unroll(b->shader, (nir_variable_mode)0);
+   nir_validate_shader(b->shader, NULL);
+   return progress;
+}
+
+nir_loop *
+nir_loop_unroll_test::get_loop()
+{
+   foreach_list_typed(nir_cf_node, node, node, &b->impl->body) {
+      if (node->type == nir_cf_node_loop)
+         return nir_cf_node_as_loop(node);
+   }
+   return NULL;
+}
+
+unsigned
+nir_loop_unroll_test::count_loop_ifs(nir_loop *loop)
+{
+   unsigned count = 0;
+   foreach_list_typed(nir_cf_node, node, node, &loop->body) {
+      if (node->type == nir_cf_node_if)
+         count++;
+   }
+   return count;
+}
+
+unsigned
+nir_loop_unroll_test::count_loop_alus(nir_loop *loop, nir_op op)
+{
+   unsigned count = 0;
+   nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_alu &&
+             nir_instr_as_alu(instr)->op == op)
+            count++;
+      }
+   }
+   return count;
+}
+
+} // namespace
+
+TEST_F(nir_loop_unroll_test, disabled)
+{
+   options.partial_unroll_factor = 0;
+   create_loop(64);
+
+   EXPECT_FALSE(run_pass());
+
+   nir_loop *loop = get_loop();
+   ASSERT_TRUE(loop);
+   EXPECT_FALSE(loop->partially_unrolled);
+   EXPECT_EQ(count_loop_ifs(loop), 1);
+   EXPECT_EQ(count_loop_alus(loop, nir_op_iadd), IADDS_PER_ITERATION);
+}
+
+TEST_F(nir_loop_unroll_test, known_trip_count)
+{
+   create_loop(64);
+
+   EXPECT_TRUE(run_pass());
+
+   /* 64 is a multiple of the factor, so only the first copy can exit. */
+   nir_loop *loop = get_loop();
+   ASSERT_TRUE(loop);
+   EXPECT_TRUE(loop->partially_unrolled);
+   EXPECT_EQ(count_loop_ifs(loop), 1);
+   EXPECT_EQ(count_loop_alus(loop, nir_op_iadd), 4 * IADDS_PER_ITERATION);
+   EXPECT_EQ(nir_cf_node_next(&nir_loop_first_block(loop)->cf_node)->type,
+             nir_cf_node_if);
+}
+
+TEST_F(nir_loop_unroll_test, known_trip_count_divisor)
+{
+   create_loop(63);
+
+   EXPECT_TRUE(run_pass());
+
+   /* The factor is lowered to 3, which divides the trip count. */
+   nir_loop *loop = get_loop();
+   ASSERT_TRUE(loop);
+   EXPECT_TRUE(loop->partially_unrolled);
+   EXPECT_EQ(count_loop_ifs(loop), 1);
+   EXPECT_EQ(count_loop_alus(loop, nir_op_iadd), 3 * IADDS_PER_ITERATION);
+}
+
+TEST_F(nir_loop_unroll_test, known_trip_count_no_divisor)
+{
+   create_loop(67);
+
+   EXPECT_TRUE(run_pass());
+
+   /* No factor divides the trip count so every copy keeps its check. */
+   nir_loop *loop = get_loop();
+   ASSERT_TRUE(loop);
+   EXPECT_TRUE(loop->partially_unrolled);
+   EXPECT_EQ(count_loop_ifs(loop), 4);
+   EXPECT_EQ(count_loop_alus(loop, nir_op_iadd), 4 * IADDS_PER_ITERATION);
+}
+
+TEST_F(nir_loop_unroll_test, unknown_trip_count)
+{
+   nir_variable *limit =
+      nir_variable_create(b->shader, nir_var_uniform, glsl_int_type(),
+                          "limit");
+   create_loop(nir_load_var(b, limit));
+
+   EXPECT_TRUE(run_pass());
+
+   nir_loop *loop = get_loop();
+   ASSERT_TRUE(loop);
+   EXPECT_TRUE(loop->partially_unrolled);
+   EXPECT_EQ(count_loop_ifs(loop), 4);
+   EXPECT_EQ(count_loop_alus(loop, nir_op_iadd), 4 * IADDS_PER_ITERATION);
+}
+
+TEST_F(nir_loop_unroll_test, unrolled_once)
+{
+   create_loop(64);
+
+   EXPECT_TRUE(run_pass());
+   EXPECT_FALSE(run_pass());
+
+   nir_loop *loop = get_loop();
+   ASSERT_TRUE(loop);
+   EXPECT_EQ(count_loop_alus(loop, nir_op_iadd), 4 * IADDS_PER_ITERATION);
+}
+
+TEST_F(nir_loop_unroll_test, trip_count_below_factor_unrolls_completely)
+{
+   options.max_unroll_iterations = 32;
+   create_loop(3);
+
+   EXPECT_TRUE(run_pass());
+
+   EXPECT_FALSE(get_loop());
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * An executable that replays a corpus of SPIR-V shaders through
+ * spirv_to_nir and a generic NIR lowering and optimization pipeline, and
+ * reports the time spent in each phase along with the size of the
+ * resulting NIR.  This is meant to catch compile-time regressions in the
+ * frontend and the shared NIR passes.
+ *
+ * The stage of each shader is taken from its file name, using the glslang
+ * convention (foo.frag.spv, foo.comp.spv, ...).  Timings are averaged over
+ * the number of iterations given with -n.
+ */
+
+#include "spirv/nir_spirv.h"
+#include "compiler/glsl_types.h"
+#include "util/os_time.h"
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+#define WORD_SIZE 4
+
+enum phase {
+   PHASE_SPIRV_TO_NIR,
+   PHASE_LOWER,
+   PHASE_OPTIMIZE,
+   PHASE_COUNT,
+};
+
+static const char *phase_names[PHASE_COUNT] = {
+   [PHASE_SPIRV_TO_NIR] = "spirv_to_nir",
+   [PHASE_LOWER] = "lower",
+   [PHASE_OPTIMIZE] = "optimize",
+};
+
+static const nir_shader_compiler_options nir_options = {
+   .max_unroll_iterations = 32,
+};
+
+static gl_shader_stage
+stage_from_filename(const char *filename)
+{
+   static const struct {
+      const char *ext;
+      gl_shader_stage stage;
+   } exts[] = {
+      { ".vert.spv", MESA_SHADER_VERTEX },
+      { ".tesc.spv", MESA_SHADER_TESS_CTRL },
+      { ".tese.spv", MESA_SHADER_TESS_EVAL },
+      { ".geom.spv", MESA_SHADER_GEOMETRY },
+      { ".frag.spv", MESA_SHADER_FRAGMENT },
+      { ".comp.spv", MESA_SHADER_COMPUTE },
+   };
+   size_t len = strlen(filename);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(exts); i++) {
+      size_t ext_len = strlen(exts[i].ext);
+      if (len >= ext_len && !strcmp(filename + len - ext_len, exts[i].ext))
+         return exts[i].stage;
+   }
+
+   return MESA_SHADER_NONE;
+}
+
+static void
+lower_shader(nir_shader *nir)
+{
+   NIR_PASS_V(nir, nir_lower_constant_initializers, nir_var_function_temp);
+   NIR_PASS_V(nir, nir_lower_returns);
+   NIR_PASS_V(nir, nir_inline_functions);
+   NIR_PASS_V(nir, nir_opt_deref);
+
+   /* Pick off the single entrypoint that we want */
+   foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
+      if (!func->is_entrypoint)
+         exec_node_remove(&func->node);
+   }
+
+   NIR_PASS_V(nir, nir_lower_constant_initializers, ~0);
+   NIR_PASS_V(nir, nir_split_var_copies);
+   NIR_PASS_V(nir, nir_split_per_member_structs);
+   NIR_PASS_V(nir, nir_remove_dead_variables,
+              nir_var_shader_in | nir_var_shader_out | nir_var_system_value);
+   NIR_PASS_V(nir, nir_propagate_invariant);
+   NIR_PASS_V(nir, nir_lower_var_copies);
+}
+
+static void
+optimize_shader(nir_shader *nir)
+{
+   bool progress;
+
+   do {
+      progress = false;
+
+      NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+      NIR_PASS(progress, nir, nir_opt_copy_prop_vars);
+      NIR_PASS(progress, nir, nir_opt_dead_write_vars);
+      NIR_PASS(progress, nir, nir_copy_prop);
+      NIR_PASS(progress, nir, nir_opt_remove_phis);
+      NIR_PASS(progress, nir, nir_opt_dce);
+      NIR_PASS(progress, nir, nir_opt_if, false);
+      NIR_PASS(progress, nir, nir_opt_dead_cf);
+      NIR_PASS(progress, nir, nir_opt_cse);
+      NIR_PASS(progress, nir, nir_opt_peephole_select, 8, true, true);
+      NIR_PASS(progress, nir, nir_opt_algebraic);
+      NIR_PASS(progress, nir, nir_opt_constant_folding);
+      NIR_PASS(progress, nir, nir_opt_undef);
+      NIR_PASS(progress, nir, nir_opt_loop_unroll, 0);
+   } while (progress);
+}
+
+static unsigned
+count_instrs(nir_shader *nir)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(func, nir) {
+      if (!func->impl)
+         continue;
+
+      nir_foreach_block(block, func->impl) {
+         nir_foreach_instr(instr, block)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+static long
+peak_rss_kb(void)
+{
+   struct rusage usage;
+
+   if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+
+   return usage.ru_maxrss;
+}
+
+/**
+ * Compile the shader iterations times, adding the time spent in each
+ * phase to times.  Returns the NIR instruction count of the last
+ * compile, or -1 on failure.
+ */
+static int
+compile_shader(const uint32_t *words, size_t word_count,
+               gl_shader_stage stage, unsigned iterations,
+               int64_t times[PHASE_COUNT])
+{
+   const struct spirv_to_nir_options spirv_opts = {
+      .lower_workgroup_access_to_offsets = true,
+      .caps = {
+         .float64 = true,
+         .image_write_without_format = true,
+         .int64 = true,
+         .multiview = true,
+         .variable_pointers = true,
+      },
+      .ubo_ptr_type = glsl_vector_type(GLSL_TYPE_UINT, 2),
+      .ssbo_ptr_type = glsl_vector_type(GLSL_TYPE_UINT, 2),
+      .phys_ssbo_ptr_type = glsl_vector_type(GLSL_TYPE_UINT64, 1),
+      .push_const_ptr_type = glsl_uint_type(),
+      .shared_ptr_type = glsl_uint_type(),
+   };
+   int instrs = -1;
+
+   for (unsigned i = 0; i < iterations; i++) {
+      int64_t start = os_time_get_nano();
+      nir_function *entry = spirv_to_nir(words, word_count, NULL, 0,
+                                         stage, "main", &spirv_opts,
+                                         &nir_options);
+      int64_t end = os_time_get_nano();
+      if (!entry)
+         return -1;
+
+      nir_shader *nir = entry->shader;
+      times[PHASE_SPIRV_TO_NIR] += end - start;
+
+      start = end;
+      lower_shader(nir);
+      end = os_time_get_nano();
+      times[PHASE_LOWER] += end - start;
+
+      start = end;
+      optimize_shader(nir);
+      end = os_time_get_nano();
+      times[PHASE_OPTIMIZE] += end - start;
+
+      instrs = count_instrs(nir);
+      ralloc_free(nir);
+   }
+
+   return instrs;
+}
+
+static void
+print_usage(const char *prog)
+{
+   fprintf(stderr, "Usage: %s [-n iterations] shader.<stage>.spv...\n",
+           prog);
+}
+
+int main(int argc, char **argv)
+{
+   int64_t total_times[PHASE_COUNT] = { 0 };
+   unsigned iterations = 1;
+   unsigned compiled = 0;
+   int opt, ret = 0;
+
+   while ((opt = getopt(argc, argv, "n:")) != -1) {
+      switch (opt) {
+      case 'n':
+         iterations = MAX2(atoi(optarg), 1);
+         break;
+      default:
+         print_usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (optind >= argc) {
+      print_usage(argv[0]);
+      return 1;
+   }
+
+   glsl_type_singleton_init_or_ref();
+
+   printf("%-40s", "shader");
+   for (unsigned p = 0; p < PHASE_COUNT; p++)
+      printf(" %14s", phase_names[p]);
+   printf(" %8s\n", "instrs");
+
+   for (int i = optind; i < argc; i++) {
+      const char *filename = argv[i];
+      gl_shader_stage stage = stage_from_filename(filename);
+      if (stage == MESA_SHADER_NONE) {
+         fprintf(stderr, "%s: unknown shader stage\n", filename);
+         ret = 1;
+         continue;
+      }
+
+      int fd = open(filename, O_RDONLY);
+      if (fd < 0) {
+         fprintf(stderr, "Failed to open %s\n", filename);
+         ret = 1;
+         continue;
+      }
+
+      off_t len = lseek(fd, 0, SEEK_END);
+      if (len <= 0 || len % WORD_SIZE != 0) {
+         fprintf(stderr, "%s: not a valid SPIR-V shader\n", filename);
+         close(fd);
+         ret = 1;
+         continue;
+      }
+
+      const void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (map == MAP_FAILED) {
+         fprintf(stderr, "Failed to mmap %s: errno=%d, %s\n",
+                 filename, errno, strerror(errno));
+         ret = 1;
+         continue;
+      }
+
+      int64_t times[PHASE_COUNT] = { 0 };
+      int instrs = compile_shader(map, len / WORD_SIZE, stage,
+                                  iterations, times);
+      munmap((void *)map, len);
+
+      if (instrs < 0) {
+         fprintf(stderr, "%s: failed to compile\n", filename);
+         ret = 1;
+         continue;
+      }
+
+      printf("%-40s", filename);
+      for (unsigned p = 0; p < PHASE_COUNT; p++) {
+         printf(" %11.3f ms", times[p] / iterations / 1e6);
+         total_times[p] += times[p];
+      }
+      printf(" %8d\n", instrs);
+      compiled++;
+   }
+
+   if (compiled) {
+      printf("%-40s", "total");
+      for (unsigned p = 0; p < PHASE_COUNT; p++)
+         printf(" %11.3f ms", total_times[p] / iterations / 1e6);
+      printf("\n");
+   }
+   printf("peak RSS: %ld kB\n", peak_rss_kb());
+
+   glsl_type_singleton_decref();
+
+   return ret;
+}
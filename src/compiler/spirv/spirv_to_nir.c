@@ -173,7 +173,7 @@ struct spec_constant_value {
 static struct vtn_ssa_value *
 vtn_undef_ssa_value(struct vtn_builder *b, const struct glsl_type *type)
 {
-   struct vtn_ssa_value *val = rzalloc(b, struct vtn_ssa_value);
+   struct vtn_ssa_value *val = vtn_zalloc(b, struct vtn_ssa_value);
    val->type = type;
 
    if (glsl_type_is_vector_or_scalar(type)) {
@@ -182,7 +182,7 @@ vtn_undef_ssa_value(struct vtn_builder *b, const struct glsl_type *type)
       val->def = nir_ssa_undef(&b->nb, num_components, bit_size);
    } else {
       unsigned elems = glsl_get_length(val->type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       if (glsl_type_is_matrix(type)) {
          const struct glsl_type *elem_type =
             glsl_vector_type(glsl_get_base_type(type),
@@ -214,7 +214,7 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
    if (entry)
       return entry->data;
 
-   struct vtn_ssa_value *val = rzalloc(b, struct vtn_ssa_value);
+   struct vtn_ssa_value *val = vtn_zalloc(b, struct vtn_ssa_value);
    val->type = type;
 
    switch (glsl_get_base_type(type)) {
@@ -245,10 +245,10 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
          assert(glsl_type_is_matrix(type));
          unsigned rows = glsl_get_vector_elements(val->type);
          unsigned columns = glsl_get_matrix_columns(val->type);
-         val->elems = ralloc_array(b, struct vtn_ssa_value *, columns);
+         val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, columns);
 
          for (unsigned i = 0; i < columns; i++) {
-            struct vtn_ssa_value *col_val = rzalloc(b, struct vtn_ssa_value);
+            struct vtn_ssa_value *col_val = vtn_zalloc(b, struct vtn_ssa_value);
             col_val->type = glsl_get_column_type(val->type);
             nir_load_const_instr *load =
                nir_load_const_instr_create(b->shader, rows, bit_size);
@@ -267,7 +267,7 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
 
    case GLSL_TYPE_ARRAY: {
       unsigned elems = glsl_get_length(val->type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       const struct glsl_type *elem_type = glsl_get_array_element(val->type);
       for (unsigned i = 0; i < elems; i++)
          val->elems[i] = vtn_const_ssa_value(b, constant->elements[i],
@@ -277,7 +277,7 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
 
    case GLSL_TYPE_STRUCT: {
       unsigned elems = glsl_get_length(val->type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       for (unsigned i = 0; i < elems; i++) {
          const struct glsl_type *elem_type =
             glsl_get_struct_field(val->type, i);
@@ -2022,12 +2022,12 @@ vtn_handle_constant(struct vtn_builder *b, SpvOp opcode,
 struct vtn_ssa_value *
 vtn_create_ssa_value(struct vtn_builder *b, const struct glsl_type *type)
 {
-   struct vtn_ssa_value *val = rzalloc(b, struct vtn_ssa_value);
+   struct vtn_ssa_value *val = vtn_zalloc(b, struct vtn_ssa_value);
    val->type = type;
 
    if (!glsl_type_is_vector_or_scalar(type)) {
       unsigned elems = glsl_get_length(type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       for (unsigned i = 0; i < elems; i++) {
          const struct glsl_type *child_type;
 
@@ -2963,7 +2963,7 @@ vtn_handle_atomics(struct vtn_builder *b, SpvOp opcode,
                         glsl_get_bit_size(type->type), NULL);
 
       struct vtn_value *val = vtn_push_value(b, w[2], vtn_value_type_ssa);
-      val->ssa = rzalloc(b, struct vtn_ssa_value);
+      val->ssa = vtn_zalloc(b, struct vtn_ssa_value);
       val->ssa->def = &atomic->dest.ssa;
       val->ssa->type = type->type;
    }
@@ -3197,7 +3197,7 @@ vtn_composite_extract(struct vtn_builder *b, struct vtn_ssa_value *src,
           * vector to extract.
           */
 
-         struct vtn_ssa_value *ret = rzalloc(b, struct vtn_ssa_value);
+         struct vtn_ssa_value *ret = vtn_zalloc(b, struct vtn_ssa_value);
          ret->type = glsl_scalar_type(glsl_get_base_type(cur->type));
          ret->def = vtn_vector_extract(b, cur->def, indices[i]);
          return ret;
@@ -3248,7 +3248,7 @@ vtn_handle_composite(struct vtn_builder *b, SpvOp opcode,
             vtn_vector_construct(b, glsl_get_vector_elements(type),
                                  elems, srcs);
       } else {
-         val->ssa->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+         val->ssa->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
          for (unsigned i = 0; i < elems; i++)
             val->ssa->elems[i] = vtn_ssa_value(b, w[3 + i]);
       }
@@ -4479,6 +4479,7 @@ vtn_create_builder(const uint32_t *words, size_t word_count,
 
    b->value_id_bound = value_id_bound;
    b->values = rzalloc_array(b, struct vtn_value, value_id_bound);
+   b->lin_ctx = linear_zalloc_parent(b, 0);
 
    return b;
  fail:
@@ -607,6 +607,12 @@ struct vtn_builder {
    unsigned value_id_bound;
    struct vtn_value *values;
 
+   /* Linear allocator for the access chains, pointers and SSA values that
+    * get created for nearly every instruction and only go away with the
+    * builder.  See vtn_zalloc().
+    */
+   void *lin_ctx;
+
    /* True if we should watch out for GLSLang issue #179 */
    bool wa_glslang_179;
 
@@ -631,6 +637,13 @@ struct vtn_builder {
    bool physical_ptrs;
 };
 
+#define vtn_zalloc(b, type) \
+   ((type *)linear_zalloc_child((b)->lin_ctx, sizeof(type)))
+#define vtn_alloc_array(b, type, count) \
+   ((type *)linear_alloc_child((b)->lin_ctx, sizeof(type) * (count)))
+#define vtn_zalloc_array(b, type, count) \
+   ((type *)linear_zalloc_child((b)->lin_ctx, sizeof(type) * (count)))
+
 nir_ssa_def *
 vtn_pointer_to_ssa(struct vtn_builder *b, struct vtn_pointer *ptr);
 struct vtn_pointer *
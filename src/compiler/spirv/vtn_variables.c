@@ -38,7 +38,7 @@ vtn_access_chain_create(struct vtn_builder *b, unsigned length)
    /* Subtract 1 from the length since there's already one built in */
    size_t size = sizeof(*chain) +
                  (MAX2(length, 1) - 1) * sizeof(chain->link[0]);
-   chain = rzalloc_size(b, size);
+   chain = linear_zalloc_child(b->lin_ctx, size);
    chain->length = length;
 
    return chain;
@@ -268,7 +268,7 @@ vtn_nir_deref_pointer_dereference(struct vtn_builder *b,
           * a pointer which just has a block index and a later access chain
           * will dereference deeper.
           */
-         struct vtn_pointer *ptr = rzalloc(b, struct vtn_pointer);
+         struct vtn_pointer *ptr = vtn_zalloc(b, struct vtn_pointer);
          ptr->mode = base->mode;
          ptr->type = type;
          ptr->block_index = block_index;
@@ -329,7 +329,7 @@ vtn_nir_deref_pointer_dereference(struct vtn_builder *b,
       access |= type->access;
    }
 
-   struct vtn_pointer *ptr = rzalloc(b, struct vtn_pointer);
+   struct vtn_pointer *ptr = vtn_zalloc(b, struct vtn_pointer);
    ptr->mode = base->mode;
    ptr->type = type;
    ptr->var = base->var;
@@ -505,7 +505,7 @@ vtn_ssa_offset_pointer_dereference(struct vtn_builder *b,
       }
    }
 
-   struct vtn_pointer *ptr = rzalloc(b, struct vtn_pointer);
+   struct vtn_pointer *ptr = vtn_zalloc(b, struct vtn_pointer);
    ptr->mode = base->mode;
    ptr->type = type;
    ptr->block_index = block_index;
@@ -532,7 +532,7 @@ struct vtn_pointer *
 vtn_pointer_for_variable(struct vtn_builder *b,
                          struct vtn_variable *var, struct vtn_type *ptr_type)
 {
-   struct vtn_pointer *pointer = rzalloc(b, struct vtn_pointer);
+   struct vtn_pointer *pointer = vtn_zalloc(b, struct vtn_pointer);
 
    pointer->mode = var->mode;
    pointer->type = var->type;
@@ -1072,9 +1072,9 @@ _vtn_variable_load_store(struct vtn_builder *b, bool load,
       unsigned elems = glsl_get_length(ptr->type->type);
       if (load) {
          vtn_assert(*inout == NULL);
-         *inout = rzalloc(b, struct vtn_ssa_value);
+         *inout = vtn_zalloc(b, struct vtn_ssa_value);
          (*inout)->type = ptr->type->type;
-         (*inout)->elems = rzalloc_array(b, struct vtn_ssa_value *, elems);
+         (*inout)->elems = vtn_zalloc_array(b, struct vtn_ssa_value *, elems);
       }
 
       struct vtn_access_chain chain = {
@@ -1864,7 +1864,7 @@ vtn_pointer_from_ssa(struct vtn_builder *b, nir_ssa_def *ssa,
    while (interface_type->base_type == vtn_base_type_array)
       interface_type = interface_type->array_element;
 
-   struct vtn_pointer *ptr = rzalloc(b, struct vtn_pointer);
+   struct vtn_pointer *ptr = vtn_zalloc(b, struct vtn_pointer);
    nir_variable_mode nir_mode;
    ptr->mode = vtn_storage_class_to_mode(b, ptr_type->storage_class,
                                          interface_type, &nir_mode);
@@ -1005,6 +1005,7 @@ void ir3_print_instr(struct ir3_instruction *instr);
 int ir3_delayslots(struct ir3_instruction *assigner,
 		struct ir3_instruction *consumer, unsigned n);
 void ir3_insert_by_depth(struct ir3_instruction *instr, struct list_head *list);
+void ir3_sort_by_depth(struct list_head *list);
 void ir3_depth(struct ir3 *ir);
 
 /* copy-propagate: */
@@ -28,6 +28,8 @@
 
 #include "ir3_compiler.h"
 
+#include "util/disk_cache.h"
+
 static const struct debug_named_value shader_debug_options[] = {
 	{"vs",         IR3_DBG_SHADER_VS,  "Print shader disasm for vertex shaders"},
 	{"fs",         IR3_DBG_SHADER_FS,  "Print shader disasm for fragment shaders"},
@@ -35,6 +37,7 @@ static const struct debug_named_value shader_debug_options[] = {
 	{"disasm",     IR3_DBG_DISASM,     "Dump NIR and adreno shader disassembly"},
 	{"optmsgs",    IR3_DBG_OPTMSGS,    "Enable optimizer debug messages"},
 	{"forces2en",  IR3_DBG_FORCES2EN,  "Force s2en mode for tex sampler instructions"},
+	{"nocache",    IR3_DBG_NOCACHE,    "Disable the shader disk cache"},
 	DEBUG_NAMED_VALUE_END
 };
 
@@ -74,3 +77,9 @@ struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id
 
 	return compiler;
 }
+
+void ir3_compiler_destroy(struct ir3_compiler *compiler)
+{
+	disk_cache_destroy(compiler->disk_cache);
+	ralloc_free(compiler);
+}
@@ -30,6 +30,7 @@
 #include "ir3_shader.h"
 
 struct ir3_ra_reg_set;
+struct disk_cache;
 
 struct ir3_compiler {
 	struct fd_device *dev;
@@ -37,6 +38,11 @@ struct ir3_compiler {
 	struct ir3_ra_reg_set *set;
 	uint32_t shader_count;
 
+	/* cache of compiled variants, NULL unless ir3_disk_cache_init() was
+	 * called and the cache is enabled:
+	 */
+	struct disk_cache *disk_cache;
+
 	/*
 	 * Configuration options for things that are handled differently on
 	 * different generations:
@@ -70,6 +76,13 @@ struct ir3_compiler {
 };
 
 struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id);
+void ir3_compiler_destroy(struct ir3_compiler *compiler);
+
+void ir3_disk_cache_init(struct ir3_compiler *compiler);
+uint32_t * ir3_disk_cache_retrieve(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v);
+void ir3_disk_cache_store(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, const uint32_t *bin);
 
 int ir3_compile_shader_nir(struct ir3_compiler *compiler,
 		struct ir3_shader_variant *so);
@@ -81,6 +94,7 @@ enum ir3_shader_debug {
 	IR3_DBG_DISASM    = 0x08,
 	IR3_DBG_OPTMSGS   = 0x10,
 	IR3_DBG_FORCES2EN = 0x20,
+	IR3_DBG_NOCACHE   = 0x40,
 };
 
 extern enum ir3_shader_debug ir3_shader_debug;
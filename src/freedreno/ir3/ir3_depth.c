@@ -43,8 +43,10 @@
  *     return d + 1;
  *   }
  *
- * After an instruction's depth is calculated, it is inserted into the
- * blocks depth sorted list, which is used by the scheduling pass.
+ * After an instruction's depth is calculated, it is moved to the end of
+ * its block, and once all the depths are known each block is sorted by
+ * depth (keeping the visit order for equal depths).  The depth sorted list
+ * is used by the scheduling pass.
  */
 
 /* generally don't count false dependencies, since this can just be
@@ -122,7 +124,7 @@ ir3_insert_by_depth(struct ir3_instruction *instr, struct list_head *list)
 	/* find where to re-insert instruction: */
 	list_for_each_entry (struct ir3_instruction, pos, list, node) {
 		if (pos->depth > instr->depth) {
-			list_add(&instr->node, &pos->node);
+			list_addtail(&instr->node, &pos->node);
 			return;
 		}
 	}
@@ -130,6 +132,55 @@ ir3_insert_by_depth(struct ir3_instruction *instr, struct list_head *list)
 	list_addtail(&instr->node, list);
 }
 
+/* merge the depth sorted list b into the depth sorted list a, entries of a
+ * going first for equal depths:
+ */
+static void
+merge_by_depth(struct list_head *a, struct list_head *b)
+{
+	struct list_head *pos = a->next;
+
+	list_for_each_entry_safe (struct ir3_instruction, instr, b, node) {
+		while ((pos != a) &&
+				(LIST_ENTRY(struct ir3_instruction, pos, node)->depth <= instr->depth))
+			pos = pos->next;
+
+		/* insert before pos: */
+		list_del(&instr->node);
+		list_addtail(&instr->node, pos);
+	}
+}
+
+/* Stable sort of a list of instructions by depth.  Gives the same order as
+ * ir3_insert_by_depth()'ing each instruction in turn into an empty list,
+ * without the quadratic cost.
+ */
+void
+ir3_sort_by_depth(struct list_head *list)
+{
+	unsigned n = list_length(list);
+	struct list_head second, *pos;
+
+	if (n < 2)
+		return;
+
+	pos = list->next;
+	for (unsigned i = 0; i < n / 2; i++)
+		pos = pos->next;
+
+	/* move the second half of the list, starting at pos, to second: */
+	second.next = pos;
+	second.prev = list->prev;
+	list->prev = pos->prev;
+	list->prev->next = list;
+	pos->prev = &second;
+	second.prev->next = &second;
+
+	ir3_sort_by_depth(list);
+	ir3_sort_by_depth(&second);
+	merge_by_depth(list, &second);
+}
+
 static void
 ir3_instr_depth(struct ir3_instruction *instr, unsigned boost, bool falsedep)
 {
@@ -163,7 +214,9 @@ ir3_instr_depth(struct ir3_instruction *instr, unsigned boost, bool falsedep)
 	if (!is_meta(instr))
 		instr->depth++;
 
-	ir3_insert_by_depth(instr, &instr->block->instr_list);
+	/* sorted by depth in compute_depth_and_remove_unused(): */
+	list_delinit(&instr->node);
+	list_addtail(&instr->node, &instr->block->instr_list);
 }
 
 static bool
@@ -241,6 +294,7 @@ compute_depth_and_remove_unused(struct ir3 *ir)
 	/* mark un-used instructions: */
 	list_for_each_entry (struct ir3_block, block, &ir->block_list, node) {
 		progress |= remove_unused_by_block(block);
+		ir3_sort_by_depth(&block->instr_list);
 	}
 
 	/* note that we can end up with unused indirects, but we should
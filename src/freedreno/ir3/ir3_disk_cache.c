@@ -0,0 +1,232 @@
+/*
+ * Copyright © 2019 Google, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "compiler/blob.h"
+#include "nir_serialize.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+
+#include "ir3_compiler.h"
+#include "ir3_shader.h"
+
+/*
+ * Shader disk cache:
+ *
+ * The variants are cached by the hash of the (already optimized) NIR
+ * of the shader plus the variant key.  The cache entry contains the
+ * plain-data part of ir3_shader_variant, the binary and the immediates,
+ * which is everything needed to emit the variant without going through
+ * ir3 again.
+ */
+
+#define VARIANT_CACHE_START  offsetof(struct ir3_shader_variant, const_layout)
+#define VARIANT_CACHE_SIZE   (offsetof(struct ir3_shader_variant, immediates_size) - \
+		VARIANT_CACHE_START)
+
+#define VARIANT_CACHE_PTR(v) (((char *)(v)) + VARIANT_CACHE_START)
+
+void
+ir3_disk_cache_init(struct ir3_compiler *compiler)
+{
+#ifdef HAVE_DLFCN_H
+	struct mesa_sha1 ctx;
+	unsigned char sha1[20];
+	char cache_id[20 * 2 + 1];
+	char renderer[16];
+
+	if (ir3_shader_debug & IR3_DBG_NOCACHE)
+		return;
+
+	_mesa_sha1_init(&ctx);
+
+	if (!disk_cache_get_function_identifier(ir3_disk_cache_init, &ctx))
+		return;
+
+	/* some debug options change the generated code: */
+	enum ir3_shader_debug debug = ir3_shader_debug & IR3_DBG_FORCES2EN;
+	_mesa_sha1_update(&ctx, &debug, sizeof(debug));
+
+	_mesa_sha1_final(&ctx, sha1);
+	disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+	snprintf(renderer, sizeof(renderer), "FD%03u", compiler->gpu_id);
+
+	compiler->disk_cache = disk_cache_create(renderer, cache_id, 0);
+#endif
+}
+
+static void
+compute_shader_key(struct ir3_shader *shader)
+{
+	struct mesa_sha1 ctx;
+	struct blob blob;
+
+	blob_init(&blob);
+	nir_serialize(&blob, shader->nir, true);
+
+	_mesa_sha1_init(&ctx);
+	_mesa_sha1_update(&ctx, blob.data, blob.size);
+	_mesa_sha1_update(&ctx, &shader->stream_output,
+			sizeof(shader->stream_output));
+	_mesa_sha1_update(&ctx, &shader->from_tgsi, sizeof(shader->from_tgsi));
+	_mesa_sha1_final(&ctx, shader->cache_key);
+
+	blob_finish(&blob);
+
+	shader->cache_key_valid = true;
+}
+
+static void
+compute_variant_key(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, cache_key cache_key)
+{
+	struct ir3_shader *shader = v->shader;
+	struct blob blob;
+
+	if (!shader->cache_key_valid)
+		compute_shader_key(shader);
+
+	blob_init(&blob);
+	blob_write_bytes(&blob, shader->cache_key, sizeof(shader->cache_key));
+
+	/* only hash what ir3_shader_key_equal() compares: */
+	if (v->key.has_per_samp)
+		blob_write_bytes(&blob, &v->key, sizeof(v->key));
+	else
+		blob_write_uint32(&blob, v->key.global);
+
+	blob_write_uint32(&blob, v->binning_pass);
+
+	disk_cache_compute_key(compiler->disk_cache, blob.data, blob.size,
+			cache_key);
+
+	blob_finish(&blob);
+}
+
+static bool
+use_cache(struct ir3_compiler *compiler, struct ir3_shader_variant *v)
+{
+	if (!compiler->disk_cache)
+		return false;
+
+	/* the disassembly needs the ir, so compile when it is asked for: */
+	if ((ir3_shader_debug & IR3_DBG_DISASM) ||
+			shader_debug_enabled(v->shader->type))
+		return false;
+
+	return true;
+}
+
+/**
+ * Look up the variant in the disk cache.  On a hit, the compiled state
+ * is copied into v and the binary returned (to be free()'d by the
+ * caller), otherwise NULL is returned and the variant needs compiling.
+ */
+uint32_t *
+ir3_disk_cache_retrieve(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v)
+{
+	cache_key cache_key;
+	size_t size;
+
+	if (!use_cache(compiler, v))
+		return NULL;
+
+	compute_variant_key(compiler, v, cache_key);
+
+	void *buffer = disk_cache_get(compiler->disk_cache, cache_key, &size);
+	if (!buffer)
+		return NULL;
+
+	struct blob_reader blob;
+	uint32_t *bin = NULL;
+
+	blob_reader_init(&blob, buffer, size);
+
+	if (blob_read_uint32(&blob) != VARIANT_CACHE_SIZE)
+		goto fail;
+	blob_copy_bytes(&blob, VARIANT_CACHE_PTR(v), VARIANT_CACHE_SIZE);
+	if (blob.overrun)
+		goto fail;
+
+	uint32_t bin_size = v->info.sizedwords * 4;
+	bin = malloc(bin_size);
+	if (!bin)
+		goto fail;
+	blob_copy_bytes(&blob, bin, bin_size);
+
+	if (v->immediates_count) {
+		v->immediates_size = v->immediates_count;
+		v->immediates = malloc(v->immediates_count * sizeof(v->immediates[0]));
+		if (!v->immediates)
+			goto fail;
+		blob_copy_bytes(&blob, v->immediates,
+				v->immediates_count * sizeof(v->immediates[0]));
+	}
+
+	if (blob.overrun || blob.current != blob.end)
+		goto fail;
+
+	free(buffer);
+	return bin;
+
+fail:
+	/* leave the variant as if nothing was found: */
+	memset(VARIANT_CACHE_PTR(v), 0, VARIANT_CACHE_SIZE);
+	free(v->immediates);
+	v->immediates = NULL;
+	v->immediates_size = 0;
+	free(bin);
+	free(buffer);
+	return NULL;
+}
+
+/**
+ * Store a freshly compiled variant, and its binary, in the disk cache.
+ */
+void
+ir3_disk_cache_store(struct ir3_compiler *compiler,
+		struct ir3_shader_variant *v, const uint32_t *bin)
+{
+	cache_key cache_key;
+	struct blob blob;
+
+	if (!use_cache(compiler, v))
+		return;
+
+	compute_variant_key(compiler, v, cache_key);
+
+	blob_init(&blob);
+	blob_write_uint32(&blob, VARIANT_CACHE_SIZE);
+	blob_write_bytes(&blob, VARIANT_CACHE_PTR(v), VARIANT_CACHE_SIZE);
+	blob_write_bytes(&blob, bin, v->info.sizedwords * 4);
+	if (v->immediates_count) {
+		blob_write_bytes(&blob, v->immediates,
+				v->immediates_count * sizeof(v->immediates[0]));
+	}
+
+	if (!blob.out_of_memory)
+		disk_cache_put(compiler->disk_cache, cache_key, blob.data, blob.size, NULL);
+
+	blob_finish(&blob);
+}
@@ -130,9 +130,9 @@ ir3_optimize_loop(nir_shader *s)
 		if (gcm == -1)
 			gcm = env_var_as_unsigned("GCM", 0);
 		if (gcm == 1)
-			progress |= OPT(s, nir_opt_gcm, true);
+			progress |= OPT(s, nir_opt_gcm, true, 0);
 		else if (gcm == 2)
-			progress |= OPT(s, nir_opt_gcm, false);
+			progress |= OPT(s, nir_opt_gcm, false, 0);
 		progress |= OPT(s, nir_opt_peephole_select, 16, true, true);
 		progress |= OPT(s, nir_opt_intrinsics);
 		progress |= OPT(s, nir_opt_algebraic);
@@ -228,8 +228,12 @@ ir3_optimize_nir(struct ir3_shader *shader, nir_shader *s,
 	/* do ubo load and idiv lowering after first opt loop to get a chance to
 	 * propagate constants for divide by immed power-of-two and constant ubo
 	 * block/offsets:
+	 *
+	 * The pushed ranges are per shader, not per variant, so they are only
+	 * chosen in the first pass.  The variants are compiled from the result
+	 * of it, with the ubo loads already lowered.
 	 */
-	const bool ubo_progress = OPT(s, ir3_nir_analyze_ubo_ranges, shader);
+	const bool ubo_progress = !key && OPT(s, ir3_nir_analyze_ubo_ranges, shader);
 	const bool idiv_progress = OPT(s, nir_lower_idiv);
 	if (ubo_progress || idiv_progress)
 		ir3_optimize_loop(s);
@@ -27,6 +27,11 @@
 #include "util/u_dynarray.h"
 #include "mesa/main/macros.h"
 
+/* ranges closer than this are merged, since each range costs a separate
+ * upload, which isn't worth it to save just a few vec4's:
+ */
+#define UBO_RANGE_MERGE_GAP (16 * 4)
+
 static inline struct ir3_ubo_range
 get_ubo_load_range(nir_intrinsic_instr *instr)
 {
@@ -35,12 +40,21 @@ get_ubo_load_range(nir_intrinsic_instr *instr)
 	const int bytes = nir_intrinsic_dest_components(instr) *
 		(nir_dest_bit_size(instr->dest) / 8);
 
+	r.block = nir_src_as_uint(instr->src[0]);
 	r.start = ROUND_DOWN_TO(nir_src_as_uint(instr->src[1]), 16 * 4);
 	r.end = ALIGN(r.start + bytes, 16 * 4);
 
 	return r;
 }
 
+static bool
+ranges_close(const struct ir3_ubo_range *a, const struct ir3_ubo_range *b)
+{
+	return (a->block == b->block) &&
+		(a->start <= b->end + UBO_RANGE_MERGE_GAP) &&
+		(b->start <= a->end + UBO_RANGE_MERGE_GAP);
+}
+
 static void
 gather_ubo_ranges(nir_intrinsic_instr *instr,
 				  struct ir3_ubo_analysis_state *state)
@@ -51,13 +65,59 @@ gather_ubo_ranges(nir_intrinsic_instr *instr,
 	if (!nir_src_is_const(instr->src[1]))
 		return;
 
-	const struct ir3_ubo_range r = get_ubo_load_range(instr);
-	const uint32_t block = nir_src_as_uint(instr->src[0]);
+	struct ir3_ubo_range r = get_ubo_load_range(instr);
+
+	/* block 0 is the user consts, which are always pushed: */
+	if (r.block == 0)
+		return;
 
-	if (r.start < state->range[block].start)
-		state->range[block].start = r.start;
-	if (state->range[block].end < r.end)
-		state->range[block].end = r.end;
+	/* merge with any overlapping, adjacent or nearby ranges, which then
+	 * get replaced by the merged range:
+	 */
+	for (uint32_t i = 0; i < state->num_enabled; ) {
+		struct ir3_ubo_range *range = &state->range[i];
+
+		if (!ranges_close(range, &r)) {
+			i++;
+			continue;
+		}
+
+		r.start = MIN2(r.start, range->start);
+		r.end = MAX2(r.end, range->end);
+		*range = state->range[--state->num_enabled];
+	}
+
+	/* if we run out of ranges, the load just doesn't get lowered: */
+	if (state->num_enabled < ARRAY_SIZE(state->range))
+		state->range[state->num_enabled++] = r;
+}
+
+static int
+range_size_compare(const void *a, const void *b)
+{
+	const struct ir3_ubo_range *ra = a, *rb = b;
+	uint32_t sa = ra->end - ra->start, sb = rb->end - rb->start;
+
+	if (sa != sb)
+		return sa < sb ? -1 : 1;
+	if (ra->block != rb->block)
+		return ra->block < rb->block ? -1 : 1;
+	return ra->start < rb->start ? -1 : (ra->start > rb->start);
+}
+
+static const struct ir3_ubo_range *
+find_range(const struct ir3_ubo_analysis_state *state,
+		   const struct ir3_ubo_range *r)
+{
+	for (uint32_t i = 0; i < state->num_enabled; i++) {
+		const struct ir3_ubo_range *range = &state->range[i];
+
+		if ((range->block == r->block) &&
+			(range->start <= r->start) && (r->end <= range->end))
+			return range;
+	}
+
+	return NULL;
 }
 
 static void
@@ -72,6 +132,7 @@ lower_ubo_load_to_uniform(nir_intrinsic_instr *instr, nir_builder *b,
 		return;
 
 	const uint32_t block = nir_src_as_uint(instr->src[0]);
+	int range_offset = 0;
 
 	if (block > 0) {
 		/* We don't lower dynamic array indexing either, but we definitely should.
@@ -82,12 +143,14 @@ lower_ubo_load_to_uniform(nir_intrinsic_instr *instr, nir_builder *b,
 			return;
 
 		/* After gathering the UBO access ranges, we limit the total
-		 * upload. Reject if we're now outside the range.
+		 * upload. Reject if we're now outside the pushed ranges.
 		 */
 		const struct ir3_ubo_range r = get_ubo_load_range(instr);
-		if (!(state->range[block].start <= r.start &&
-			  r.end <= state->range[block].end))
+		const struct ir3_ubo_range *range = find_range(state, &r);
+		if (!range)
 			return;
+
+		range_offset = (range->offset - range->start) / 4;
 	}
 
 	b->cursor = nir_before_instr(&instr->instr);
@@ -99,8 +162,6 @@ lower_ubo_load_to_uniform(nir_intrinsic_instr *instr, nir_builder *b,
 	else
 		ubo_offset = nir_ushr(b, ubo_offset, nir_imm_int(b, 2));
 
-	const int range_offset =
-		(state->range[block].offset - state->range[block].start) / 4;
 	nir_ssa_def *uniform_offset =
 		nir_iadd(b, ubo_offset, nir_imm_int(b, range_offset));
 
@@ -126,7 +187,6 @@ ir3_nir_analyze_ubo_ranges(nir_shader *nir, struct ir3_shader *shader)
 	struct ir3_ubo_analysis_state *state = &shader->ubo_state;
 
 	memset(state, 0, sizeof(*state));
-	state->range[0].end = nir->num_uniforms * 16;
 
 	nir_foreach_function(function, nir) {
 		if (function->impl) {
@@ -143,24 +203,32 @@ ir3_nir_analyze_ubo_ranges(nir_shader *nir, struct ir3_shader *shader)
 	/* For now, everything we upload is accessed statically and thus will be
 	 * used by the shader. Once we can upload dynamically indexed data, we may
 	 * upload sparsely accessed arrays, at which point we probably want to
-	 * give priority to smaller UBOs, on the assumption that big UBOs will be
-	 * accessed dynamically.  Alternatively, we can track statically and
-	 * dynamically accessed ranges separately and upload static rangtes
-	 * first.
+	 * track statically and dynamically accessed ranges separately and upload
+	 * static ranges first.
+	 *
+	 * Until then, give priority to the smaller ranges, on the assumption that
+	 * the big ones are more likely to be arrays of which only a few elements
+	 * are used per invocation, and push each range fully or not at all.
 	 */
 	const uint32_t max_upload = 16 * 1024;
-	uint32_t offset = 0;
-	for (uint32_t i = 0; i < ARRAY_SIZE(state->range); i++) {
-		uint32_t range_size = state->range[i].end - state->range[i].start;
-
-		debug_assert(offset <= max_upload);
-		state->range[i].offset = offset;
-		if (offset + range_size > max_upload) {
-			range_size = max_upload - offset;
-			state->range[i].end = state->range[i].start + range_size;
-		}
+	uint32_t offset = nir->num_uniforms * 16;
+	uint32_t n = 0;
+
+	qsort(state->range, state->num_enabled, sizeof(state->range[0]),
+		  range_size_compare);
+
+	for (uint32_t i = 0; i < state->num_enabled; i++) {
+		struct ir3_ubo_range *range = &state->range[i];
+		uint32_t range_size = range->end - range->start;
+
+		if (offset + range_size > max_upload)
+			continue;
+
+		range->offset = offset;
 		offset += range_size;
+		state->range[n++] = *range;
 	}
+	state->num_enabled = n;
 	state->size = offset;
 
 	nir_foreach_function(function, nir) {
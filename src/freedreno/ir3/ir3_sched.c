@@ -26,6 +26,7 @@
 
 
 #include "util/u_math.h"
+#include "util/u_dynarray.h"
 
 #include "ir3.h"
 
@@ -37,7 +38,11 @@
  * it's unscheduled src instructions).  Normally this would result in a
  * lot of re-traversal of the same instructions, so we cache results in
  * instr->data (and clear cached results that would be no longer valid
- * after scheduling an instruction).
+ * after scheduling an instruction).  A cached candidate that has been
+ * scheduled since is simply ignored on lookup, so only the cached
+ * "nothing eligible" results need to be cleared after each instruction,
+ * which keeps the cost of scheduling an instruction independent of the
+ * size of the block.
  *
  * There are a few special cases that need to be handled, since sched
  * is currently independent of register allocation.  Usages of address
@@ -56,6 +61,7 @@ struct ir3_sched_ctx {
 	struct ir3_instruction *addr;      /* current a0.x user, if any */
 	struct ir3_instruction *pred;      /* current p0.x user, if any */
 	int live_values;                   /* estimate of current live values */
+	struct util_dynarray blocked;      /* instrs w/ NULL_INSTR cached */
 	bool error;
 };
 
@@ -137,11 +143,20 @@ update_use_count(struct ir3_block *block)
 
 #define NULL_INSTR ((void *)~0)
 
+/* Clear the cached results which could change after scheduling instr, or
+ * all of them if instr is NULL.  Entries caching instr itself as candidate
+ * are ignored by find_instr_recursive() once it is scheduled, so only the
+ * entries which found nothing eligible need to be cleared here:
+ */
 static void
 clear_cache(struct ir3_sched_ctx *ctx, struct ir3_instruction *instr)
 {
-	list_for_each_entry (struct ir3_instruction, instr2, &ctx->depth_list, node) {
-		if ((instr2->data == instr) || (instr2->data == NULL_INSTR) || !instr)
+	util_dynarray_foreach(&ctx->blocked, struct ir3_instruction *, blocked)
+		(*blocked)->data = NULL;
+	util_dynarray_clear(&ctx->blocked);
+
+	if (!instr) {
+		list_for_each_entry (struct ir3_instruction, instr2, &ctx->depth_list, node)
 			instr2->data = NULL;
 	}
 }
@@ -447,7 +462,10 @@ find_instr_recursive(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes,
 	if (instr->data) {
 		if (instr->data == NULL_INSTR)
 			return NULL;
-		return instr->data;
+		if (!is_scheduled(instr->data))
+			return instr->data;
+		/* the cached candidate has been scheduled since: */
+		instr->data = NULL;
 	}
 
 	/* find unscheduled srcs: */
@@ -481,6 +499,7 @@ find_instr_recursive(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes,
 	}
 
 	instr->data = NULL_INSTR;
+	util_dynarray_append(&ctx->blocked, struct ir3_instruction *, instr);
 	return NULL;
 }
 
@@ -638,10 +657,13 @@ sched_block(struct ir3_sched_ctx *ctx, struct ir3_block *block)
 		if (instr->opc == OPC_META_INPUT) {
 			schedule(ctx, instr);
 		} else {
-			ir3_insert_by_depth(instr, &ctx->depth_list);
+			list_delinit(&instr->node);
+			list_addtail(&instr->node, &ctx->depth_list);
 		}
 	}
 
+	ir3_sort_by_depth(&ctx->depth_list);
+
 	while (!list_empty(&ctx->depth_list)) {
 		struct ir3_sched_notes notes = {0};
 		struct ir3_instruction *instr;
@@ -790,6 +812,7 @@ int ir3_sched(struct ir3 *ir)
 	struct ir3_sched_ctx ctx = {0};
 
 	ir3_clear_mark(ir);
+	util_dynarray_init(&ctx.blocked, NULL);
 
 	list_for_each_entry (struct ir3_block, block, &ir->block_list, node) {
 		ctx.live_values = 0;
@@ -801,6 +824,8 @@ int ir3_sched(struct ir3 *ir)
 		sched_intra_block(&ctx, block);
 	}
 
+	util_dynarray_fini(&ctx.blocked);
+
 	if (ctx.error)
 		return -1;
 
@@ -123,15 +123,11 @@ void * ir3_shader_assemble(struct ir3_shader_variant *v, uint32_t gpu_id)
 }
 
 static void
-assemble_variant(struct ir3_shader_variant *v)
+upload_variant(struct ir3_shader_variant *v, const uint32_t *bin)
 {
 	struct ir3_compiler *compiler = v->shader->compiler;
 	struct shader_info *info = &v->shader->nir->info;
-	uint32_t gpu_id = compiler->gpu_id;
-	uint32_t sz, *bin;
-
-	bin = ir3_shader_assemble(v, gpu_id);
-	sz = v->info.sizedwords * 4;
+	uint32_t sz = v->info.sizedwords * 4;
 
 	v->bo = fd_bo_new(compiler->dev, sz,
 			DRM_FREEDRENO_GEM_CACHE_WCOMBINE |
@@ -139,6 +135,21 @@ assemble_variant(struct ir3_shader_variant *v)
 			"%s:%s", ir3_shader_stage(v->shader), info->name);
 
 	memcpy(fd_bo_map(v->bo), bin, sz);
+}
+
+static void
+assemble_variant(struct ir3_shader_variant *v)
+{
+	struct ir3_compiler *compiler = v->shader->compiler;
+	uint32_t gpu_id = compiler->gpu_id;
+	uint32_t *bin;
+
+	bin = ir3_shader_assemble(v, gpu_id);
+	if (!bin)
+		return;
+
+	upload_variant(v, bin);
+	ir3_disk_cache_store(compiler, v, bin);
 
 	if (ir3_shader_debug & IR3_DBG_DISASM) {
 		struct ir3_shader_key key = v->key;
@@ -179,6 +190,13 @@ create_variant(struct ir3_shader *shader, struct ir3_shader_key *key,
 	v->key = *key;
 	v->type = shader->type;
 
+	uint32_t *bin = ir3_disk_cache_retrieve(shader->compiler, v);
+	if (bin) {
+		upload_variant(v, bin);
+		free(bin);
+		return v;
+	}
+
 	ret = ir3_compile_shader_nir(shader->compiler, v);
 	if (ret) {
 		debug_error("compile failed!");
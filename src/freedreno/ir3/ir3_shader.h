@@ -340,9 +340,15 @@ struct ir3_shader_variant {
 	bool binning_pass;
 	struct ir3_shader_variant *binning;
 
+	struct ir3 *ir;
+
+	/* Everything from const_layout up to (but not including)
+	 * immediates_size is plain data describing the compiled shader,
+	 * which is stored as-is in the disk cache (see ir3_disk_cache.c),
+	 * so no pointers in there:
+	 */
 	struct ir3_driver_const_layout const_layout;
 	struct ir3_info info;
-	struct ir3 *ir;
 
 	/* Levels of nesting of flow control:
 	 */
@@ -459,10 +465,6 @@ struct ir3_shader_variant {
 	} constbase;
 
 	unsigned immediates_count;
-	unsigned immediates_size;
-	struct {
-		uint32_t val[4];
-	} *immediates;
 
 	/* for astc srgb workaround, the number/base of additional
 	 * alpha tex states we need, and index of original tex states
@@ -472,6 +474,11 @@ struct ir3_shader_variant {
 		unsigned orig_idx[16];
 	} astc_srgb;
 
+	unsigned immediates_size;
+	struct {
+		uint32_t val[4];
+	} *immediates;
+
 	/* shader variants form a linked list: */
 	struct ir3_shader_variant *next;
 
@@ -481,13 +488,21 @@ struct ir3_shader_variant {
 };
 
 struct ir3_ubo_range {
-	uint32_t offset; /* start offset of this block in const register file */
+	uint32_t offset; /* start offset of this range in const register file */
+	uint32_t block;  /* UBO the range belongs to (never 0) */
 	uint32_t start, end; /* range of block that's actually used */
 };
 
+#define IR3_MAX_UBO_PUSH_RANGES 32
+
+/* The UBO ranges pushed to the const file.  The user consts (block 0)
+ * always come first, at offset zero, followed by num_enabled ranges of
+ * the other UBOs:
+ */
 struct ir3_ubo_analysis_state
 {
-	struct ir3_ubo_range range[IR3_MAX_CONSTANT_BUFFERS];
+	struct ir3_ubo_range range[IR3_MAX_UBO_PUSH_RANGES];
+	uint32_t num_enabled;
 	uint32_t size;
 	uint32_t lower_count;
 };
@@ -511,6 +526,12 @@ struct ir3_shader {
 	struct ir3_stream_output_info stream_output;
 
 	struct ir3_shader_variant *variants;
+
+	/* hash of the NIR and stream output info, to which the variant key
+	 * is added to look up variants in the disk cache:
+	 */
+	bool cache_key_valid;
+	uint8_t cache_key[20];
 };
 
 void * ir3_shader_assemble(struct ir3_shader_variant *v, uint32_t gpu_id);
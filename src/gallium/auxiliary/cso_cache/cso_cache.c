@@ -39,6 +39,7 @@
 struct cso_cache {
    struct cso_hash *hashes[CSO_CACHE_MAX];
    int    max_size;
+   unsigned age;           /* Incremented for every lookup hit and insert. */
 
    cso_sanitize_callback sanitize_cb;
    void                 *sanitize_data;
@@ -170,16 +171,28 @@ static inline void sanitize_cb(struct cso_hash *hash, enum cso_cache_type type,
    int hash_size = cso_hash_size(hash);
    int max_entries = (max_size > hash_size) ? max_size : hash_size;
    int to_remove =  (max_size < max_entries) * max_entries/4;
+   struct cso_node **nodes;
+   int i;
+
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
-   while (to_remove) {
-      /*remove elements until we're good */
-      /*fixme: currently we pick the nodes to remove at random*/
-      struct cso_hash_iter iter = cso_hash_first_node(hash);
-      void  *cso = cso_hash_take(hash, cso_hash_iter_key(iter));
+   if (to_remove == 0)
+      return;
+
+   /* remove the least recently used elements */
+   nodes = cso_hash_nodes_by_age(hash);
+   if (!nodes)
+      return;
+
+   for (i = 0; i < to_remove && i < hash_size; i++) {
+      struct cso_hash_iter iter = {hash, nodes[i]};
+      void *cso = cso_hash_iter_data(iter);
+
+      cso_hash_erase(hash, iter);
       delete_cso(cso, type);
-      --to_remove;
    }
+
+   FREE(nodes);
 }
 
 struct cso_hash_iter
@@ -188,9 +201,14 @@ cso_insert_state(struct cso_cache *sc,
                  void *state)
 {
    struct cso_hash *hash = _cso_hash_for_type(sc, type);
+   struct cso_hash_iter iter;
+
    sanitize_hash(sc, hash, type, sc->max_size);
 
-   return cso_hash_insert(hash, hash_key, state);
+   iter = cso_hash_insert(hash, hash_key, state);
+   if (!cso_hash_iter_is_null(iter))
+      iter.node->last_used = ++sc->age;
+   return iter;
 }
 
 struct cso_hash_iter
@@ -229,8 +247,10 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
    struct cso_hash_iter iter = cso_find_state(sc, hash_key, type);
    while (!cso_hash_iter_is_null(iter)) {
       void *iter_data = cso_hash_iter_data(iter);
-      if (!memcmp(iter_data, templ, size))
+      if (!memcmp(iter_data, templ, size)) {
+         iter.node->last_used = ++sc->age;
          return iter;
+      }
       iter = cso_hash_iter_next(iter);
    }
    return iter;
@@ -251,6 +271,7 @@ struct cso_cache *cso_cache_create(void)
       return NULL;
 
    sc->max_size           = 4096;
+   sc->age                = 0;
    for (i = 0; i < CSO_CACHE_MAX; i++)
       sc->hashes[i] = cso_hash_create();
 
@@ -227,9 +227,11 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
    int hash_size = cso_hash_size(hash);
    int max_entries = (max_size > hash_size) ? max_size : hash_size;
    int to_remove =  (max_size < max_entries) * max_entries/4;
-   struct cso_hash_iter iter;
+   struct cso_node **nodes;
    struct cso_sampler **samplers_to_restore = NULL;
    unsigned to_restore = 0;
+   unsigned newest;
+   int i;
 
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
@@ -238,7 +240,7 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
       return;
 
    if (type == CSO_SAMPLER) {
-      int i, j;
+      int j;
 
       samplers_to_restore = MALLOC(PIPE_SHADER_TYPES * PIPE_MAX_SAMPLERS *
                                    sizeof(*samplers_to_restore));
@@ -256,28 +258,32 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
       }
    }
 
-   iter = cso_hash_first_node(hash);
-   while (to_remove) {
-      /*remove elements until we're good */
-      /*fixme: currently we pick the nodes to remove at random*/
-      void *cso = cso_hash_iter_data(iter);
+   /* remove the least recently used elements that aren't bound */
+   nodes = cso_hash_nodes_by_age(hash);
+   hash_size = cso_hash_size(hash);
+   newest = nodes ? nodes[hash_size - 1]->last_used : 0;
 
-      if (!cso)
-         break;
+   for (i = 0; nodes && to_remove && i < hash_size; i++) {
+      struct cso_hash_iter iter = {hash, nodes[i]};
 
-      if (delete_cso(ctx, cso, type)) {
-         iter = cso_hash_erase(hash, iter);
+      if (delete_cso(ctx, cso_hash_iter_data(iter), type)) {
+         cso_hash_erase(hash, iter);
          --to_remove;
-      } else
-         iter = cso_hash_iter_next(iter);
+      }
    }
 
+   FREE(nodes);
+
    if (type == CSO_SAMPLER) {
       /* Put currently bound sampler states back into the hash table */
       while (to_restore--) {
          struct cso_sampler *sampler = samplers_to_restore[to_restore];
+         struct cso_hash_iter iter =
+            cso_hash_insert(hash, sampler->hash_key, sampler);
 
-         cso_hash_insert(hash, sampler->hash_key, sampler);
+         /* They are in use, so treat them as the most recently used. */
+         if (!cso_hash_iter_is_null(iter))
+            iter.node->last_used = newest;
       }
 
       FREE(samplers_to_restore);
@@ -291,6 +297,9 @@ static void cso_init_vbuf(struct cso_context *cso, unsigned flags)
    /* Install u_vbuf if there is anything unsupported. */
    if (u_vbuf_get_caps(cso->pipe->screen, &caps, flags)) {
       cso->vbuf = u_vbuf_create(cso->pipe, &caps);
+
+      if (cso->vbuf && flags & U_VBUF_FLAG_CACHE_TRANSLATIONS)
+         u_vbuf_enable_translation_cache(cso->vbuf);
    }
 }
 
@@ -1142,6 +1151,17 @@ cso_restore_vertex_elements(struct cso_context *ctx)
 
 /* vertex buffers */
 
+/**
+ * Notify u_vbuf that the contents of \p buffer changed, or of any buffer if
+ * it's NULL.  Only needed with U_VBUF_FLAG_CACHE_TRANSLATIONS.
+ */
+void cso_invalidate_vertex_buffer(struct cso_context *ctx,
+                                  struct pipe_resource *buffer)
+{
+   if (ctx->vbuf)
+      u_vbuf_invalidate_buffer(ctx->vbuf, buffer);
+}
+
 void cso_set_vertex_buffers(struct cso_context *ctx,
                             unsigned start_slot, unsigned count,
                             const struct pipe_vertex_buffer *buffers)
@@ -1709,6 +1729,45 @@ cso_draw_vbo(struct cso_context *cso,
    }
 }
 
+/**
+ * Perform several draws sharing everything but their start, count and
+ * index bias, see pipe_context::multi_draw.  Drivers without the hook, and
+ * u_vbuf which may have to translate each draw, get one draw_vbo per draw.
+ */
+void
+cso_multi_draw(struct cso_context *cso,
+               const struct pipe_draw_info *info,
+               const struct pipe_draw_start_count *draws,
+               unsigned num_draws)
+{
+   struct pipe_context *pipe = cso->pipe;
+
+   assert(info->indirect == NULL && info->count_from_stream_output == NULL);
+   assert(!info->has_user_indices);
+
+   if (!cso->vbuf && pipe->multi_draw) {
+      pipe->multi_draw(pipe, info, draws, num_draws);
+      return;
+   }
+
+   struct pipe_draw_info draw = *info;
+
+   for (unsigned i = 0; i < num_draws; i++) {
+      if (draws[i].count == 0)
+         continue;
+
+      draw.start = draws[i].start;
+      draw.count = draws[i].count;
+      draw.index_bias = draws[i].index_bias;
+      draw.drawid = info->drawid + i;
+      if (!info->index_size) {
+         draw.min_index = draw.start;
+         draw.max_index = draw.start + draw.count - 1;
+      }
+      cso_draw_vbo(cso, &draw);
+   }
+}
+
 void
 cso_draw_arrays(struct cso_context *cso, uint mode, uint start, uint count)
 {
@@ -83,6 +83,9 @@ enum pipe_error cso_set_vertex_elements(struct cso_context *ctx,
                                         unsigned count,
                                         const struct pipe_vertex_element *states);
 
+void cso_invalidate_vertex_buffer(struct cso_context *ctx,
+                                  struct pipe_resource *buffer);
+
 void cso_set_vertex_buffers(struct cso_context *ctx,
                             unsigned start_slot, unsigned count,
                             const struct pipe_vertex_buffer *buffers);
@@ -224,6 +227,12 @@ void
 cso_draw_vbo(struct cso_context *cso,
              const struct pipe_draw_info *info);
 
+void
+cso_multi_draw(struct cso_context *cso,
+               const struct pipe_draw_info *info,
+               const struct pipe_draw_start_count *draws,
+               unsigned num_draws);
+
 void
 cso_draw_arrays_instanced(struct cso_context *cso, uint mode,
                           uint start, uint count,
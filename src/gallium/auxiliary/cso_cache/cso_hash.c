@@ -104,6 +104,7 @@ cso_hash_create_node(struct cso_hash *hash,
       return NULL;
 
    node->key = akey;
+   node->last_used = 0;
    node->value = avalue;
 
    node->next = (struct cso_node*)(*anextNode);
@@ -412,3 +413,35 @@ boolean cso_hash_contains(struct cso_hash *hash, unsigned key)
    struct cso_node **node = cso_hash_find_node(hash, key);
    return (*node != hash->data.e);
 }
+
+static int compare_node_age(const void *a, const void *b)
+{
+   const struct cso_node *na = *(const struct cso_node **)a;
+   const struct cso_node *nb = *(const struct cso_node **)b;
+
+   return na->last_used < nb->last_used ? -1 :
+          na->last_used > nb->last_used ? 1 : 0;
+}
+
+struct cso_node **cso_hash_nodes_by_age(struct cso_hash *hash)
+{
+   int size = cso_hash_size(hash);
+   struct cso_node **nodes;
+   struct cso_hash_iter iter;
+   int i = 0;
+
+   if (!size)
+      return NULL;
+
+   nodes = MALLOC(size * sizeof(*nodes));
+   if (!nodes)
+      return NULL;
+
+   for (iter = cso_hash_first_node(hash); !cso_hash_iter_is_null(iter);
+        iter = cso_hash_iter_next(iter))
+      nodes[i++] = iter.node;
+   assert(i == size);
+
+   qsort(nodes, size, sizeof(*nodes), compare_node_age);
+   return nodes;
+}
@@ -54,6 +54,7 @@ extern "C" {
 struct cso_node {
    struct cso_node *next;
    unsigned key;
+   unsigned last_used; /* Stamp for LRU eviction, maintained by the user. */
    void *value;
 };
 
@@ -118,6 +119,14 @@ struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter);
 struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter);
 
 
+/**
+ * Return a MALLOC'ed array of all nodes in the hash, sorted by increasing
+ * last_used, i.e. least recently used first, or NULL if it is empty.
+ * Erasing the listed nodes by iterator doesn't invalidate the others.
+ */
+struct cso_node **cso_hash_nodes_by_age(struct cso_hash *hash);
+
+
 /**
  * Convenience routine to iterate over the collision list while doing a memory
  * comparison to see which entry in the list is a direct copy of our template
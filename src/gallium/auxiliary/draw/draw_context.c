@@ -530,6 +530,26 @@ draw_set_force_passthrough( struct draw_context *draw, boolean enable )
 }
 
 
+/**
+ * Let the driver look up and store the machine code of LLVM vertex shader
+ * variants in a disk cache, keyed by a hash of the variant.
+ */
+void
+draw_set_disk_cache_callbacks(struct draw_context *draw,
+                              void *data_cookie,
+                              void (*find_shader)(void *cookie,
+                                                  struct lp_cached_code *cache,
+                                                  const unsigned char ir_sha1_cache_key[20]),
+                              void (*insert_shader)(void *cookie,
+                                                    struct lp_cached_code *cache,
+                                                    const unsigned char ir_sha1_cache_key[20]))
+{
+   draw->disk_cache_find_shader = find_shader;
+   draw->disk_cache_insert_shader = insert_shader;
+   draw->disk_cache_cookie = data_cookie;
+}
+
+
 
 /**
  * Allocate an extra vertex/geometry shader vertex attribute, if it doesn't
@@ -49,6 +49,7 @@ struct draw_fragment_shader;
 struct tgsi_sampler;
 struct tgsi_image;
 struct tgsi_buffer;
+struct lp_cached_code;
 
 /*
  * structure to contain driver internal information 
@@ -284,6 +285,16 @@ void draw_set_driver_clipping( struct draw_context *draw,
 void draw_set_force_passthrough( struct draw_context *draw, 
                                  boolean enable );
 
+void
+draw_set_disk_cache_callbacks(struct draw_context *draw,
+                              void *data_cookie,
+                              void (*find_shader)(void *cookie,
+                                                  struct lp_cached_code *cache,
+                                                  const unsigned char ir_sha1_cache_key[20]),
+                              void (*insert_shader)(void *cookie,
+                                                    struct lp_cached_code *cache,
+                                                    const unsigned char ir_sha1_cache_key[20]));
+
 
 /*******************************************************************************
  * Draw statistics
@@ -52,7 +52,9 @@
 
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 
+#include "util/mesa-sha1.h"
 #include "util/u_math.h"
 #include "util/u_pointer.h"
 #include "util/u_string.h"
@@ -539,6 +541,24 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 }
 
 
+static void
+draw_get_ir_cache_key(struct draw_vertex_shader *shader,
+                      const void *key, size_t key_size,
+                      unsigned num_inputs,
+                      unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, key, key_size);
+   _mesa_sha1_update(&ctx, &num_inputs, sizeof(num_inputs));
+   _mesa_sha1_update(&ctx, shader->state.tokens,
+                     tgsi_num_tokens(shader->state.tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
+
 /**
  * Create LLVM-generated code for a vertex shader.
  */
@@ -550,8 +570,12 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    struct draw_llvm_variant *variant;
    struct llvm_vertex_shader *shader =
       llvm_vertex_shader(llvm->draw->vs.vertex_shader);
+   struct draw_context *draw = llvm->draw;
    LLVMTypeRef vertex_header;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
 
    variant = MALLOC(sizeof *variant +
                     shader->variant_key_size -
@@ -565,7 +589,15 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    util_snprintf(module_name, sizeof(module_name), "draw_llvm_vs_variant%u",
                  variant->shader->variants_cached);
 
-   variant->gallivm = gallivm_create(module_name, llvm->context);
+   if (draw->disk_cache_find_shader) {
+      draw_get_ir_cache_key(&shader->base, key, shader->variant_key_size,
+                            num_inputs, ir_sha1_cache_key);
+      draw->disk_cache_find_shader(draw->disk_cache_cookie, &cached,
+                                   ir_sha1_cache_key);
+      needs_caching = !cached.data_size;
+   }
+
+   variant->gallivm = gallivm_create(module_name, llvm->context, &cached);
 
    create_jit_types(variant);
 
@@ -587,7 +619,12 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_jit_vert_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching && draw->disk_cache_insert_shader)
+      draw->disk_cache_insert_shader(draw->disk_cache_cookie, &cached,
+                                     ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -622,6 +659,7 @@ generate_vs(struct draw_llvm_variant *variant,
                      NULL /*struct lp_build_mask_context *mask*/,
                      consts_ptr,
                      num_consts_ptr,
+                     NULL, NULL,
                      system_values,
                      inputs,
                      outputs,
@@ -629,7 +667,7 @@ generate_vs(struct draw_llvm_variant *variant,
                      NULL,
                      draw_sampler,
                      &llvm->draw->vs.vertex_shader->info,
-                     NULL);
+                     NULL, NULL);
 
    {
       LLVMValueRef out;
@@ -1574,8 +1612,8 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
 
    memset(&system_values, 0, sizeof(system_values));
 
-   util_snprintf(func_name, sizeof(func_name), "draw_llvm_vs_variant%u",
-                 variant->shader->variants_cached);
+   /* Not numbered, as the name must match the one in cached object code. */
+   util_snprintf(func_name, sizeof(func_name), "draw_llvm_vs_variant");
 
    i = 0;
    arg_types[i++] = get_context_ptr_type(variant);       /* context */
@@ -2349,6 +2387,7 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      &mask,
                      consts_ptr,
                      num_consts_ptr,
+                     NULL, NULL,
                      &system_values,
                      NULL,
                      outputs,
@@ -2356,7 +2395,8 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      NULL,
                      sampler,
                      &llvm->draw->gs.geometry_shader->info,
-                     (const struct lp_build_tgsi_gs_iface *)&gs_iface);
+                     (const struct lp_build_tgsi_gs_iface *)&gs_iface,
+                     NULL);
 
    sampler->destroy(sampler);
 
@@ -2391,7 +2431,7 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    util_snprintf(module_name, sizeof(module_name), "draw_llvm_gs_variant%u",
                  variant->shader->variants_cached);
 
-   variant->gallivm = gallivm_create(module_name, llvm->context);
+   variant->gallivm = gallivm_create(module_name, llvm->context, NULL);
 
    create_gs_jit_types(variant);
 
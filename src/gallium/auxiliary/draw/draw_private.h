@@ -68,6 +68,7 @@ struct tgsi_exec_machine;
 struct tgsi_sampler;
 struct tgsi_image;
 struct tgsi_buffer;
+struct lp_cached_code;
 struct draw_pt_front_end;
 struct draw_assembler;
 struct draw_llvm;
@@ -326,6 +327,15 @@ struct draw_context
 
    struct draw_llvm *llvm;
 
+   /** Disk cache for the LLVM vertex shader variants, set by the driver */
+   void *disk_cache_cookie;
+   void (*disk_cache_find_shader)(void *cookie,
+                                  struct lp_cached_code *cache,
+                                  const unsigned char ir_sha1_cache_key[20]);
+   void (*disk_cache_insert_shader)(void *cookie,
+                                    struct lp_cached_code *cache,
+                                    const unsigned char ir_sha1_cache_key[20]);
+
    /** Texture sampler and sampler view state.
     * Note that we have arrays indexed by shader type.  At this time
     * we only handle vertex and geometry shaders in the draw module, but
@@ -25,9 +25,12 @@
  *
  **************************************************************************/
 
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -40,6 +43,34 @@
 #include "gallivm/lp_bld_debug.h"
 
 
+/**
+ * Fetch and vertex shading of big enough runs is split in jobs of at least
+ * this many vertices, executed by the vs_queue threads and the calling
+ * thread, at most DRAW_LLVM_MAX_VS_JOBS of them.
+ */
+#define DRAW_LLVM_VS_JOB_SIZE 512
+#define DRAW_LLVM_MAX_VS_JOBS 8
+
+DEBUG_GET_ONCE_NUM_OPTION(draw_num_threads, "DRAW_NUM_THREADS",
+                          MIN2(util_cpu_caps.nr_cpus,
+                               DRAW_LLVM_MAX_VS_JOBS) - 1)
+
+struct llvm_middle_end;
+
+struct llvm_vs_job {
+   struct llvm_middle_end *fpme;
+   struct util_queue_fence fence;
+
+   struct vertex_header *verts;
+   unsigned count;
+   unsigned start_or_maxelt;
+   unsigned vid_base;
+   const unsigned *elts;
+
+   boolean clipped;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -57,6 +88,12 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /* Worker threads for fetch and vertex shading, created on first use. */
+   struct util_queue vs_queue;
+   unsigned num_vs_threads;
+   boolean vs_queue_initialized;
+   struct llvm_vs_job vs_jobs[DRAW_LLVM_MAX_VS_JOBS];
 };
 
 
@@ -347,6 +384,115 @@ emit(struct pt_emit *emit,
 }
 
 
+static void
+llvm_vs_job_run(struct llvm_vs_job *job)
+{
+   struct llvm_middle_end *fpme = job->fpme;
+   struct draw_context *draw = fpme->draw;
+
+   job->clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
+                                                  job->verts,
+                                                  draw->pt.user.vbuffer,
+                                                  job->count,
+                                                  job->start_or_maxelt,
+                                                  fpme->vertex_size,
+                                                  draw->pt.vertex_buffer,
+                                                  draw->instance_id,
+                                                  job->vid_base,
+                                                  draw->start_instance,
+                                                  job->elts);
+}
+
+
+static void
+llvm_vs_job_execute(void *data, int thread_index)
+{
+   llvm_vs_job_run((struct llvm_vs_job *) data);
+}
+
+
+/**
+ * Number of jobs to split fetch and shading of \p count vertices in,
+ * starting the worker threads if needed.
+ */
+static unsigned
+llvm_vs_num_jobs(struct llvm_middle_end *fpme, unsigned count)
+{
+   unsigned num_jobs = MIN2(count / DRAW_LLVM_VS_JOB_SIZE,
+                            fpme->num_vs_threads + 1);
+
+   if (num_jobs <= 1)
+      return 1;
+
+   if (!fpme->vs_queue_initialized) {
+      if (!util_queue_init(&fpme->vs_queue, "drawvs", DRAW_LLVM_MAX_VS_JOBS,
+                           fpme->num_vs_threads, 0)) {
+         fpme->num_vs_threads = 0;
+         return 1;
+      }
+      fpme->vs_queue_initialized = TRUE;
+   }
+
+   return num_jobs;
+}
+
+
+/**
+ * Run fetch and the vertex shader on \p count vertices.  Large runs are
+ * split in contiguous ranges shaded in parallel, each writing its own part
+ * of \p verts, so the output is in the same order as with a single call.
+ */
+static boolean
+llvm_vs_run(struct llvm_middle_end *fpme, struct vertex_header *verts,
+            unsigned count, unsigned start_or_maxelt, unsigned vid_base,
+            const unsigned *elts)
+{
+   unsigned num_jobs = llvm_vs_num_jobs(fpme, count);
+   /* Keep all but the last job a multiple of the vector width, as the jit
+    * function writes whole vectors of vertices.
+    */
+   unsigned job_count = align(DIV_ROUND_UP(count, num_jobs),
+                              lp_native_vector_width / 32);
+   unsigned start = 0;
+   unsigned i;
+   boolean clipped = FALSE;
+
+   for (i = 0; i < num_jobs && start < count; i++) {
+      struct llvm_vs_job *job = &fpme->vs_jobs[i];
+
+      job->fpme = fpme;
+      job->verts = (struct vertex_header *)
+         ((char *) verts + start * fpme->vertex_size);
+      job->count = MIN2(job_count, count - start);
+      job->vid_base = vid_base;
+      if (elts) {
+         job->start_or_maxelt = start_or_maxelt;
+         job->elts = elts + start;
+      } else {
+         job->start_or_maxelt = start_or_maxelt + start;
+         job->elts = NULL;
+      }
+      start += job->count;
+
+      /* The calling thread does the last job itself. */
+      if (start < count) {
+         util_queue_add_job(&fpme->vs_queue, job, &job->fence,
+                            llvm_vs_job_execute, NULL);
+      } else {
+         llvm_vs_job_run(job);
+      }
+   }
+
+   num_jobs = i;
+   for (i = 0; i < num_jobs; i++) {
+      util_queue_fence_wait(&fpme->vs_jobs[i].fence);
+      clipped |= fpme->vs_jobs[i].clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -397,17 +543,8 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       vid_base = draw->pt.user.eltBias;
       elts = fetch_info->elts;
    }
-   clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                             llvm_vert_info.verts,
-                                             draw->pt.user.vbuffer,
-                                             fetch_info->count,
-                                             start_or_maxelt,
-                                             fpme->vertex_size,
-                                             draw->pt.vertex_buffer,
-                                             draw->instance_id,
-                                             vid_base,
-                                             draw->start_instance,
-                                             elts);
+   clipped = llvm_vs_run(fpme, llvm_vert_info.verts, fetch_info->count,
+                         start_or_maxelt, vid_base, elts);
 
    /* Finished with fetch and vs:
     */
@@ -606,6 +743,13 @@ static void
 llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
 {
    struct llvm_middle_end *fpme = llvm_middle_end(middle);
+   unsigned i;
+
+   if (fpme->vs_queue_initialized)
+      util_queue_destroy(&fpme->vs_queue);
+
+   for (i = 0; i < DRAW_LLVM_MAX_VS_JOBS; i++)
+      util_queue_fence_destroy(&fpme->vs_jobs[i].fence);
 
    if (fpme->fetch)
       draw_pt_fetch_destroy( fpme->fetch );
@@ -627,6 +771,7 @@ struct draw_pt_middle_end *
 draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 {
    struct llvm_middle_end *fpme = 0;
+   unsigned i;
 
    if (!draw->llvm)
       return NULL;
@@ -635,6 +780,9 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
    if (!fpme)
       goto fail;
 
+   for (i = 0; i < DRAW_LLVM_MAX_VS_JOBS; i++)
+      util_queue_fence_init(&fpme->vs_jobs[i].fence);
+
    fpme->base.prepare         = llvm_middle_end_prepare;
    fpme->base.bind_parameters = llvm_middle_end_bind_parameters;
    fpme->base.run             = llvm_middle_end_run;
@@ -667,6 +815,9 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   fpme->num_vs_threads = CLAMP(debug_get_option_draw_num_threads(),
+                                0, DRAW_LLVM_MAX_VS_JOBS - 1);
+
    return &fpme->base;
 
  fail:
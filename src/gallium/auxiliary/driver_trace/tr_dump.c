@@ -30,10 +30,11 @@
  * @file
  * Trace dumping functions.
  *
- * For now we just use standard XML for dumping the trace calls, as this is
- * simple to write, parse, and visually inspect, but the actual representation
- * is abstracted out of this file, so that we can switch to a binary
- * representation if/when it becomes justified.
+ * By default we use standard XML for dumping the trace calls, as this is
+ * simple to write, parse, and visually inspect.  GALLIUM_TRACE_FORMAT=binary
+ * selects a compact binary representation of the same calls instead, for
+ * capturing real workloads: names are written once, and each distinct blob
+ * of data once too, see trace_bin_*() below.
  *
  * @author Jose Fonseca <jfonseca@vmware.com>
  */
@@ -51,6 +52,8 @@
 #include "util/u_string.h"
 #include "util/u_math.h"
 #include "util/u_format.h"
+#include "util/hash_table.h"
+#include "util/mesa-sha1.h"
 
 #include "tr_dump.h"
 #include "tr_screen.h"
@@ -62,6 +65,7 @@ static FILE *stream = NULL;
 static mtx_t call_mutex = _MTX_INITIALIZER_NP;
 static long unsigned call_no = 0;
 static boolean dumping = FALSE;
+static boolean binary = FALSE;
 
 
 static inline void
@@ -163,6 +167,175 @@ trace_dump_tag_end(const char *name)
    trace_dump_writes(">");
 }
 
+/*
+ * Binary format.
+ *
+ * The file starts with TRACE_BIN_MAGIC followed by a sequence of tokens:
+ * a token byte, and its operands.  Integer operands are LEB128 varints,
+ * signed integers zigzag encoded, floats are little endian doubles.
+ *
+ * Names (classes, methods, args, members, structs and enums) are varint
+ * indices in a table built along the trace: an index equal to the table
+ * size adds a new entry, and is followed by the length and the characters.
+ *
+ * Blobs are written with TRACE_BIN_BLOB followed by their index, the same
+ * way: a new index is followed by the size and the data.  Blobs are found
+ * by the SHA-1 of their content, so the same data uploaded again, e.g. the
+ * same vertex buffer each frame, only costs a few bytes.
+ *
+ * Args, rets, elems and members don't have an end token, they are followed
+ * by exactly one value.
+ */
+
+#define TRACE_BIN_MAGIC "GTRB\x01\0\0\0"
+
+enum trace_bin_token {
+   TRACE_BIN_CALL = 1,      /* no, class name, method name */
+   TRACE_BIN_CALL_END,      /* time in microseconds */
+   TRACE_BIN_ARG,           /* name, value */
+   TRACE_BIN_RET,           /* value */
+   TRACE_BIN_NULL,
+   TRACE_BIN_BOOL,          /* u8 */
+   TRACE_BIN_INT,           /* zigzag varint */
+   TRACE_BIN_UINT,          /* varint */
+   TRACE_BIN_FLOAT,         /* double */
+   TRACE_BIN_BLOB,          /* blob */
+   TRACE_BIN_STRING,        /* length, characters */
+   TRACE_BIN_ENUM,          /* name */
+   TRACE_BIN_ARRAY,         /* values... */
+   TRACE_BIN_ARRAY_END,
+   TRACE_BIN_STRUCT,        /* name, members... */
+   TRACE_BIN_MEMBER,        /* name, value */
+   TRACE_BIN_STRUCT_END,
+   TRACE_BIN_PTR,           /* varint */
+};
+
+static struct hash_table *bin_names = NULL;
+static struct hash_table *bin_blobs = NULL;
+static unsigned bin_num_names = 0;
+static unsigned bin_num_blobs = 0;
+
+static inline void
+trace_bin_byte(uint8_t value)
+{
+   if (stream)
+      putc(value, stream);
+}
+
+static inline void
+trace_bin_varint(uint64_t value)
+{
+   while (value >= 0x80) {
+      trace_bin_byte((value & 0x7f) | 0x80);
+      value >>= 7;
+   }
+   trace_bin_byte(value);
+}
+
+static void
+trace_bin_name(const char *name)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(bin_names, name);
+   size_t len;
+   char *key;
+
+   if (entry) {
+      trace_bin_varint((uintptr_t) entry->data - 1);
+      return;
+   }
+
+   len = strlen(name);
+   key = MALLOC(len + 1);
+   if (key) {
+      memcpy(key, name, len + 1);
+      _mesa_hash_table_insert(bin_names, key,
+                              (void *) (uintptr_t) (bin_num_names + 1));
+   }
+
+   /* a new index, even without memory to remember it */
+   trace_bin_varint(bin_num_names++);
+   trace_bin_varint(len);
+   trace_dump_write(name, len);
+}
+
+static uint32_t
+trace_bin_blob_hash(const void *key)
+{
+   uint32_t hash;
+
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+trace_bin_blob_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, 20) == 0;
+}
+
+static void
+trace_bin_blob(const void *data, size_t size)
+{
+   struct hash_entry *entry;
+   uint8_t sha1[20];
+   uint8_t *key;
+
+   _mesa_sha1_compute(data, size, sha1);
+
+   trace_bin_byte(TRACE_BIN_BLOB);
+
+   entry = _mesa_hash_table_search(bin_blobs, sha1);
+   if (entry) {
+      trace_bin_varint((uintptr_t) entry->data - 1);
+      return;
+   }
+
+   key = MALLOC(sizeof(sha1));
+   if (key) {
+      memcpy(key, sha1, sizeof(sha1));
+      _mesa_hash_table_insert(bin_blobs, key,
+                              (void *) (uintptr_t) (bin_num_blobs + 1));
+   }
+
+   trace_bin_varint(bin_num_blobs++);
+   trace_bin_varint(size);
+   trace_dump_write(data, size);
+}
+
+static void
+trace_bin_free_key(struct hash_entry *entry)
+{
+   FREE((void *) entry->key);
+}
+
+static boolean
+trace_bin_begin(void)
+{
+   bin_names = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                       _mesa_key_string_equal);
+   bin_blobs = _mesa_hash_table_create(NULL, trace_bin_blob_hash,
+                                       trace_bin_blob_equal);
+   if (!bin_names || !bin_blobs) {
+      _mesa_hash_table_destroy(bin_names, NULL);
+      _mesa_hash_table_destroy(bin_blobs, NULL);
+      return FALSE;
+   }
+
+   trace_dump_write(TRACE_BIN_MAGIC, 8);
+   return TRUE;
+}
+
+static void
+trace_bin_end(void)
+{
+   _mesa_hash_table_destroy(bin_names, trace_bin_free_key);
+   _mesa_hash_table_destroy(bin_blobs, trace_bin_free_key);
+   bin_names = NULL;
+   bin_blobs = NULL;
+   bin_num_names = 0;
+   bin_num_blobs = 0;
+}
+
 void
 trace_dump_trace_flush(void)
 {
@@ -175,7 +348,10 @@ static void
 trace_dump_trace_close(void)
 {
    if (stream) {
-      trace_dump_writes("</trace>\n");
+      if (binary)
+         trace_bin_end();
+      else
+         trace_dump_writes("</trace>\n");
       if (close_stream) {
          fclose(stream);
          close_stream = FALSE;
@@ -209,6 +385,8 @@ trace_dump_trace_begin(void)
       return FALSE;
 
    if (!stream) {
+      binary = strcmp(debug_get_option("GALLIUM_TRACE_FORMAT", "xml"),
+                      "binary") == 0;
 
       if (strcmp(filename, "stderr") == 0) {
          close_stream = FALSE;
@@ -220,11 +398,22 @@ trace_dump_trace_begin(void)
       }
       else {
          close_stream = TRUE;
-         stream = fopen(filename, "wt");
+         stream = fopen(filename, binary ? "wb" : "wt");
          if (!stream)
             return FALSE;
       }
 
+      if (binary) {
+         if (!trace_bin_begin()) {
+            if (close_stream)
+               fclose(stream);
+            stream = NULL;
+            return FALSE;
+         }
+         atexit(trace_dump_trace_close);
+         return TRUE;
+      }
+
       trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
       trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
       trace_dump_writes("<trace version='0.1'>\n");
@@ -312,6 +501,16 @@ void trace_dump_call_begin_locked(const char *klass, const char *method)
       return;
 
    ++call_no;
+
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_CALL);
+      trace_bin_varint(call_no);
+      trace_bin_name(klass);
+      trace_bin_name(method);
+      call_start_time = os_time_get();
+      return;
+   }
+
    trace_dump_indent(1);
    trace_dump_writes("<call no=\'");
    trace_dump_writef("%lu", call_no);
@@ -334,6 +533,13 @@ void trace_dump_call_end_locked(void)
 
    call_end_time = os_time_get();
 
+   /* don't flush after each call, the trace is flushed at every swap */
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_CALL_END);
+      trace_bin_varint(call_end_time - call_start_time);
+      return;
+   }
+
    trace_dump_call_time(call_end_time - call_start_time);
    trace_dump_indent(1);
    trace_dump_tag_end("call");
@@ -358,13 +564,19 @@ void trace_dump_arg_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_ARG);
+      trace_bin_name(name);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin1("arg", "name", name);
 }
 
 void trace_dump_arg_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("arg");
@@ -376,13 +588,18 @@ void trace_dump_ret_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_RET);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin("ret");
 }
 
 void trace_dump_ret_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("ret");
@@ -394,6 +611,12 @@ void trace_dump_bool(int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_BOOL);
+      trace_bin_byte(value ? 1 : 0);
+      return;
+   }
+
    trace_dump_writef("<bool>%c</bool>", value ? '1' : '0');
 }
 
@@ -402,6 +625,12 @@ void trace_dump_int(long long int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_INT);
+      trace_bin_varint(((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+      return;
+   }
+
    trace_dump_writef("<int>%lli</int>", value);
 }
 
@@ -410,6 +639,12 @@ void trace_dump_uint(long long unsigned value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_UINT);
+      trace_bin_varint(value);
+      return;
+   }
+
    trace_dump_writef("<uint>%llu</uint>", value);
 }
 
@@ -418,6 +653,17 @@ void trace_dump_float(double value)
    if (!dumping)
       return;
 
+   if (binary) {
+      union { double f; uint64_t u; } bits;
+
+      /* the file is little endian */
+      bits.f = value;
+      bits.u = util_cpu_to_le64(bits.u);
+      trace_bin_byte(TRACE_BIN_FLOAT);
+      trace_dump_write((const char *) &bits.u, sizeof(bits.u));
+      return;
+   }
+
    trace_dump_writef("<float>%g</float>", value);
 }
 
@@ -431,6 +677,11 @@ void trace_dump_bytes(const void *data,
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_blob(data, size);
+      return;
+   }
+
    trace_dump_writes("<bytes>");
    for(i = 0; i < size; ++i) {
       uint8_t byte = *p++;
@@ -459,10 +710,11 @@ void trace_dump_box_bytes(const void *data,
         +                                  (box->depth   - 1) * slice_stride;
 
    /*
-    * Only dump buffer transfers to avoid huge files.
+    * Only dump buffer transfers to avoid huge files, unless the contents are
+    * deduplicated by the binary format.
     * TODO: Make this run-time configurable
     */
-   if (resource->target != PIPE_BUFFER) {
+   if (resource->target != PIPE_BUFFER && !binary) {
       size = 0;
    }
 
@@ -474,6 +726,15 @@ void trace_dump_string(const char *str)
    if (!dumping)
       return;
 
+   if (binary) {
+      size_t len = strlen(str);
+
+      trace_bin_byte(TRACE_BIN_STRING);
+      trace_bin_varint(len);
+      trace_dump_write(str, len);
+      return;
+   }
+
    trace_dump_writes("<string>");
    trace_dump_escape(str);
    trace_dump_writes("</string>");
@@ -484,6 +745,12 @@ void trace_dump_enum(const char *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_ENUM);
+      trace_bin_name(value);
+      return;
+   }
+
    trace_dump_writes("<enum>");
    trace_dump_escape(value);
    trace_dump_writes("</enum>");
@@ -494,6 +761,11 @@ void trace_dump_array_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_ARRAY);
+      return;
+   }
+
    trace_dump_writes("<array>");
 }
 
@@ -502,12 +774,17 @@ void trace_dump_array_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_ARRAY_END);
+      return;
+   }
+
    trace_dump_writes("</array>");
 }
 
 void trace_dump_elem_begin(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("<elem>");
@@ -515,7 +792,7 @@ void trace_dump_elem_begin(void)
 
 void trace_dump_elem_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</elem>");
@@ -526,6 +803,12 @@ void trace_dump_struct_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_STRUCT);
+      trace_bin_name(name);
+      return;
+   }
+
    trace_dump_writef("<struct name='%s'>", name);
 }
 
@@ -534,6 +817,11 @@ void trace_dump_struct_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_STRUCT_END);
+      return;
+   }
+
    trace_dump_writes("</struct>");
 }
 
@@ -542,12 +830,18 @@ void trace_dump_member_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_MEMBER);
+      trace_bin_name(name);
+      return;
+   }
+
    trace_dump_writef("<member name='%s'>", name);
 }
 
 void trace_dump_member_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</member>");
@@ -558,6 +852,11 @@ void trace_dump_null(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_byte(TRACE_BIN_NULL);
+      return;
+   }
+
    trace_dump_writes("<null/>");
 }
 
@@ -566,6 +865,12 @@ void trace_dump_ptr(const void *value)
    if (!dumping)
       return;
 
+   if (binary && value) {
+      trace_bin_byte(TRACE_BIN_PTR);
+      trace_bin_varint((uintptr_t) value);
+      return;
+   }
+
    if(value)
       trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
    else
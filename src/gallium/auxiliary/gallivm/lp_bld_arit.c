@@ -1536,6 +1536,77 @@ lp_build_lerp_simple(struct lp_build_context *bld,
 }
 
 
+/**
+ * Multilinear interpolation of normalized values.
+ *
+ * The values are unpacked to the double wide type only once, all the
+ * 1-D lerps happen on the wide intermediates, and the result is packed
+ * back at the end. Since every wide intermediate keeps its upper half
+ * zero this gives exactly the same result as lerping (and packing) one
+ * dimension at a time.
+ *
+ * Weights are in w[dim], values in v[] with the x index varying fastest.
+ */
+static LLVMValueRef
+lp_build_lerp_norm(struct lp_build_context *bld,
+                   unsigned dims,
+                   const LLVMValueRef *w,
+                   const LLVMValueRef *v,
+                   unsigned flags)
+{
+   const struct lp_type type = bld->type;
+   struct lp_type wide_type;
+   struct lp_build_context wide_bld;
+   LLVMValueRef wl[3], wh[3], vl[8], vh[8];
+   unsigned num_values = 1 << dims;
+   unsigned d, i;
+
+   assert(type.norm);
+   assert(type.length >= 2);
+   assert(dims >= 1 && dims <= 3);
+
+   /*
+    * Create a wider integer type, enough to hold the
+    * intermediate result of the multiplication.
+    */
+   memset(&wide_type, 0, sizeof wide_type);
+   wide_type.sign   = type.sign;
+   wide_type.width  = type.width*2;
+   wide_type.length = type.length/2;
+
+   lp_build_context_init(&wide_bld, bld->gallivm, wide_type);
+
+   for (d = 0; d < dims; d++) {
+      assert(lp_check_value(type, w[d]));
+      lp_build_unpack2_native(bld->gallivm, type, wide_type, w[d],
+                              &wl[d], &wh[d]);
+   }
+   for (i = 0; i < num_values; i++) {
+      assert(lp_check_value(type, v[i]));
+      lp_build_unpack2_native(bld->gallivm, type, wide_type, v[i],
+                              &vl[i], &vh[i]);
+   }
+
+   /*
+    * Lerp both halves, one dimension at a time.
+    */
+
+   flags |= LP_BLD_LERP_WIDE_NORMALIZED;
+
+   for (d = 0; d < dims; d++) {
+      num_values /= 2;
+      for (i = 0; i < num_values; i++) {
+         vl[i] = lp_build_lerp_simple(&wide_bld, wl[d],
+                                      vl[2*i], vl[2*i + 1], flags);
+         vh[i] = lp_build_lerp_simple(&wide_bld, wh[d],
+                                      vh[2*i], vh[2*i + 1], flags);
+      }
+   }
+
+   return lp_build_pack2_native(bld->gallivm, wide_type, type, vl[0], vh[0]);
+}
+
+
 /**
  * Linear interpolation.
  */
@@ -1547,7 +1618,6 @@ lp_build_lerp(struct lp_build_context *bld,
               unsigned flags)
 {
    const struct lp_type type = bld->type;
-   LLVMValueRef res;
 
    assert(lp_check_value(type, x));
    assert(lp_check_value(type, v0));
@@ -1556,42 +1626,11 @@ lp_build_lerp(struct lp_build_context *bld,
    assert(!(flags & LP_BLD_LERP_WIDE_NORMALIZED));
 
    if (type.norm) {
-      struct lp_type wide_type;
-      struct lp_build_context wide_bld;
-      LLVMValueRef xl, xh, v0l, v0h, v1l, v1h, resl, resh;
-
-      assert(type.length >= 2);
-
-      /*
-       * Create a wider integer type, enough to hold the
-       * intermediate result of the multiplication.
-       */
-      memset(&wide_type, 0, sizeof wide_type);
-      wide_type.sign   = type.sign;
-      wide_type.width  = type.width*2;
-      wide_type.length = type.length/2;
-
-      lp_build_context_init(&wide_bld, bld->gallivm, wide_type);
-
-      lp_build_unpack2_native(bld->gallivm, type, wide_type, x,  &xl,  &xh);
-      lp_build_unpack2_native(bld->gallivm, type, wide_type, v0, &v0l, &v0h);
-      lp_build_unpack2_native(bld->gallivm, type, wide_type, v1, &v1l, &v1h);
-
-      /*
-       * Lerp both halves.
-       */
-
-      flags |= LP_BLD_LERP_WIDE_NORMALIZED;
-
-      resl = lp_build_lerp_simple(&wide_bld, xl, v0l, v1l, flags);
-      resh = lp_build_lerp_simple(&wide_bld, xh, v0h, v1h, flags);
-
-      res = lp_build_pack2_native(bld->gallivm, wide_type, type, resl, resh);
-   } else {
-      res = lp_build_lerp_simple(bld, x, v0, v1, flags);
+      LLVMValueRef v[2] = { v0, v1 };
+      return lp_build_lerp_norm(bld, 1, &x, v, flags);
    }
 
-   return res;
+   return lp_build_lerp_simple(bld, x, v0, v1, flags);
 }
 
 
@@ -1610,8 +1649,16 @@ lp_build_lerp_2d(struct lp_build_context *bld,
                  LLVMValueRef v11,
                  unsigned flags)
 {
-   LLVMValueRef v0 = lp_build_lerp(bld, x, v00, v01, flags);
-   LLVMValueRef v1 = lp_build_lerp(bld, x, v10, v11, flags);
+   LLVMValueRef v0, v1;
+
+   if (bld->type.norm) {
+      LLVMValueRef w[2] = { x, y };
+      LLVMValueRef v[4] = { v00, v01, v10, v11 };
+      return lp_build_lerp_norm(bld, 2, w, v, flags);
+   }
+
+   v0 = lp_build_lerp(bld, x, v00, v01, flags);
+   v1 = lp_build_lerp(bld, x, v10, v11, flags);
    return lp_build_lerp(bld, y, v0, v1, flags);
 }
 
@@ -1631,8 +1678,17 @@ lp_build_lerp_3d(struct lp_build_context *bld,
                  LLVMValueRef v111,
                  unsigned flags)
 {
-   LLVMValueRef v0 = lp_build_lerp_2d(bld, x, y, v000, v001, v010, v011, flags);
-   LLVMValueRef v1 = lp_build_lerp_2d(bld, x, y, v100, v101, v110, v111, flags);
+   LLVMValueRef v0, v1;
+
+   if (bld->type.norm) {
+      LLVMValueRef w[3] = { x, y, z };
+      LLVMValueRef v[8] = { v000, v001, v010, v011,
+                            v100, v101, v110, v111 };
+      return lp_build_lerp_norm(bld, 3, w, v, flags);
+   }
+
+   v0 = lp_build_lerp_2d(bld, x, y, v000, v001, v010, v011, flags);
+   v1 = lp_build_lerp_2d(bld, x, y, v100, v101, v110, v111, flags);
    return lp_build_lerp(bld, z, v0, v1, flags);
 }
 
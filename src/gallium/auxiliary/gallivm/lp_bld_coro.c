@@ -0,0 +1,195 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include "util/u_memory.h"
+#include "lp_bld_coro.h"
+#include "lp_bld_const.h"
+#include "lp_bld_flow.h"
+#include "lp_bld_intr.h"
+#include "lp_bld_type.h"
+
+
+#if HAVE_LLVM >= 0x0800
+
+
+/**
+ * The coroutine frames hold spilled vectors, so align them for the widest
+ * vector type.
+ */
+static void *
+coro_malloc(unsigned size)
+{
+   return os_malloc_aligned(size, LP_MIN_VECTOR_ALIGN);
+}
+
+
+static void
+coro_free(void *ptr)
+{
+   os_free_aligned(ptr);
+}
+
+
+static LLVMTypeRef
+i8_ptr_type(struct gallivm_state *gallivm)
+{
+   return LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+}
+
+
+void
+lp_build_coro_begin(struct gallivm_state *gallivm,
+                    struct lp_build_coro *coro)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef i8_ptr = i8_ptr_type(gallivm);
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(lc);
+   LLVMBasicBlockRef block = LLVMGetInsertBlock(builder);
+   LLVMValueRef function = LLVMGetBasicBlockParent(block);
+   LLVMValueRef args[4], size, mem, func, end_args[2];
+
+#if HAVE_LLVM < 0x0f00
+   /* Coroutines must be marked as such until they are split */
+   LLVMAddTargetDependentFunctionAttr(function, "coroutine.presplit", "0");
+#endif
+
+   args[0] = lp_build_const_int32(gallivm, 0);
+   args[1] = LLVMConstPointerNull(i8_ptr);
+   args[2] = args[1];
+   args[3] = args[1];
+   coro->id = lp_build_intrinsic(builder, "llvm.coro.id",
+                                 LLVMTokenTypeInContext(lc), args, 4, 0);
+
+   size = lp_build_intrinsic(builder, "llvm.coro.size.i32", int32_type,
+                             NULL, 0, 0);
+   func = lp_build_const_func_pointer(gallivm,
+                                      func_to_pointer((func_pointer)coro_malloc),
+                                      i8_ptr, &int32_type, 1, "coro_malloc");
+   mem = LLVMBuildCall(builder, func, &size, 1, "");
+
+   args[0] = coro->id;
+   args[1] = mem;
+   coro->hdl = lp_build_intrinsic(builder, "llvm.coro.begin", i8_ptr,
+                                  args, 2, 0);
+
+   coro->suspend_block = LLVMAppendBasicBlockInContext(lc, function,
+                                                       "coro_suspend");
+   coro->cleanup_block = LLVMAppendBasicBlockInContext(lc, function,
+                                                       "coro_cleanup");
+
+   LLVMPositionBuilderAtEnd(builder, coro->cleanup_block);
+   args[0] = coro->id;
+   args[1] = coro->hdl;
+   mem = lp_build_intrinsic(builder, "llvm.coro.free", i8_ptr, args, 2, 0);
+   func = lp_build_const_func_pointer(gallivm,
+                                      func_to_pointer((func_pointer)coro_free),
+                                      LLVMVoidTypeInContext(lc), &i8_ptr, 1,
+                                      "coro_free");
+   LLVMBuildCall(builder, func, &mem, 1, "");
+   LLVMBuildBr(builder, coro->suspend_block);
+
+   LLVMPositionBuilderAtEnd(builder, coro->suspend_block);
+   end_args[0] = coro->hdl;
+   end_args[1] = LLVMConstInt(LLVMInt1TypeInContext(lc), 0, 0);
+   lp_build_intrinsic(builder, "llvm.coro.end", LLVMInt1TypeInContext(lc),
+                      end_args, 2, 0);
+   LLVMBuildRet(builder, coro->hdl);
+
+   LLVMPositionBuilderAtEnd(builder, block);
+}
+
+
+static void
+build_suspend(struct gallivm_state *gallivm,
+              const struct lp_build_coro *coro,
+              boolean final)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef int8_type = LLVMInt8TypeInContext(lc);
+   LLVMValueRef args[2], result, sw;
+   LLVMBasicBlockRef resume_block = NULL;
+
+   args[0] = LLVMConstNull(LLVMTokenTypeInContext(lc));
+   args[1] = LLVMConstInt(LLVMInt1TypeInContext(lc), final, 0);
+   result = lp_build_intrinsic(builder, "llvm.coro.suspend", int8_type,
+                               args, 2, 0);
+
+   /* 0 when resumed, 1 when destroyed, -1 when suspended */
+   sw = LLVMBuildSwitch(builder, result, coro->suspend_block, final ? 1 : 2);
+   LLVMAddCase(sw, LLVMConstInt(int8_type, 1, 0), coro->cleanup_block);
+   if (!final) {
+      resume_block = lp_build_insert_new_block(gallivm, "coro_resume");
+      LLVMAddCase(sw, LLVMConstInt(int8_type, 0, 0), resume_block);
+      LLVMPositionBuilderAtEnd(builder, resume_block);
+   }
+}
+
+
+void
+lp_build_coro_suspend(struct gallivm_state *gallivm,
+                      const struct lp_build_coro *coro)
+{
+   build_suspend(gallivm, coro, FALSE);
+}
+
+
+void
+lp_build_coro_end(struct gallivm_state *gallivm,
+                  const struct lp_build_coro *coro)
+{
+   build_suspend(gallivm, coro, TRUE);
+}
+
+
+void
+lp_build_coro_resume(struct gallivm_state *gallivm, LLVMValueRef hdl)
+{
+   lp_build_intrinsic(gallivm->builder, "llvm.coro.resume",
+                      LLVMVoidTypeInContext(gallivm->context), &hdl, 1, 0);
+}
+
+
+void
+lp_build_coro_destroy(struct gallivm_state *gallivm, LLVMValueRef hdl)
+{
+   lp_build_intrinsic(gallivm->builder, "llvm.coro.destroy",
+                      LLVMVoidTypeInContext(gallivm->context), &hdl, 1, 0);
+}
+
+
+LLVMValueRef
+lp_build_coro_done(struct gallivm_state *gallivm, LLVMValueRef hdl)
+{
+   return lp_build_intrinsic(gallivm->builder, "llvm.coro.done",
+                             LLVMInt1TypeInContext(gallivm->context),
+                             &hdl, 1, 0);
+}
+
+#endif /* HAVE_LLVM >= 0x0800 */
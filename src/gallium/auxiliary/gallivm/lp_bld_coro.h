@@ -0,0 +1,101 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Helpers to build coroutines, functions which can be suspended and resumed
+ * later.  They are used to run the invocations of a compute shader work
+ * group up to a barrier, one vector at a time.
+ *
+ * A coroutine function must return an i8 pointer, the handle which is passed
+ * to lp_build_coro_resume(), lp_build_coro_done() and
+ * lp_build_coro_destroy().  Coroutines are lowered by LLVM passes, which
+ * need LLVM 8 or later.
+ */
+
+
+#ifndef LP_BLD_CORO_H
+#define LP_BLD_CORO_H
+
+
+#include "lp_bld.h"
+#include "lp_bld_init.h"
+
+
+struct lp_build_coro
+{
+   LLVMValueRef id;
+   LLVMValueRef hdl;
+
+   /** Returns the handle to the caller of the coroutine, or the resumer */
+   LLVMBasicBlockRef suspend_block;
+
+   /** Frees the coroutine frame, reached when destroying the coroutine */
+   LLVMBasicBlockRef cleanup_block;
+};
+
+
+/**
+ * Make the function being built a coroutine.  Must be called at the
+ * beginning of the function, after the allocas.
+ */
+void
+lp_build_coro_begin(struct gallivm_state *gallivm,
+                    struct lp_build_coro *coro);
+
+/**
+ * Return to the caller, building continues in the code run when the
+ * coroutine is resumed.
+ */
+void
+lp_build_coro_suspend(struct gallivm_state *gallivm,
+                      const struct lp_build_coro *coro);
+
+/**
+ * End the coroutine body with a final suspension point.  The coroutine is
+ * then done, and must be destroyed.
+ */
+void
+lp_build_coro_end(struct gallivm_state *gallivm,
+                  const struct lp_build_coro *coro);
+
+void
+lp_build_coro_resume(struct gallivm_state *gallivm, LLVMValueRef hdl);
+
+void
+lp_build_coro_destroy(struct gallivm_state *gallivm, LLVMValueRef hdl);
+
+/**
+ * Whether the coroutine is suspended at its final suspension point, as an
+ * i1 value.
+ */
+LLVMValueRef
+lp_build_coro_done(struct gallivm_state *gallivm, LLVMValueRef hdl);
+
+
+#endif /* LP_BLD_CORO_H */
@@ -33,6 +33,7 @@
 #include "util/u_memory.h"
 #include "util/simple_list.h"
 #include "util/os_time.h"
+#include "os/os_thread.h"
 #include "lp_bld.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_misc.h"
@@ -43,6 +44,9 @@
 #if HAVE_LLVM >= 0x0700
 #include <llvm-c/Transforms/Utils.h>
 #endif
+#if HAVE_LLVM >= 0x0800
+#include <llvm-c/Transforms/Coroutines.h>
+#endif
 #include <llvm-c/BitWriter.h>
 
 
@@ -111,6 +115,180 @@ enum LLVM_CodeGenOpt_Level {
 };
 
 
+/**
+ * Add the coroutine lowering passes, which need a module pass manager.
+ */
+static void
+add_coro_passes(LLVMPassManagerRef passmgr)
+{
+#if HAVE_LLVM >= 0x0800
+   LLVMAddCoroEarlyPass(passmgr);
+   LLVMAddCoroSplitPass(passmgr);
+   LLVMAddCoroElidePass(passmgr);
+#endif
+}
+
+
+/**
+ * Add the optimization passes run on every function, or only the bare
+ * minimum with fast set.
+ */
+static void
+add_optimization_passes(LLVMPassManagerRef passmgr, boolean fast)
+{
+   if (!fast && (gallivm_perf & GALLIVM_PERF_NO_OPT) == 0) {
+      /*
+       * TODO: Evaluate passes some more - keeping in mind
+       * both quality of generated code and compile times.
+       */
+      /*
+       * NOTE: if you change this, don't forget to change the output
+       * with GALLIVM_DEBUG_DUMP_BC in gallivm_compile_module.
+       */
+      LLVMAddScalarReplAggregatesPass(passmgr);
+      LLVMAddEarlyCSEPass(passmgr);
+      LLVMAddCFGSimplificationPass(passmgr);
+      /*
+       * FIXME: LICM is potentially quite useful. However, for some
+       * rather crazy shaders the compile time can reach _hours_ per shader,
+       * due to licm implying lcssa (since llvm 3.5), which can take forever.
+       * Even for sane shaders, the cost of licm is rather high (and not just
+       * due to lcssa, licm itself too), though mostly only in cases when it
+       * can actually move things, so having to disable it is a pity.
+       * LLVMAddLICMPass(passmgr);
+       */
+      LLVMAddReassociatePass(passmgr);
+      LLVMAddPromoteMemoryToRegisterPass(passmgr);
+      LLVMAddConstantPropagationPass(passmgr);
+      LLVMAddInstructionCombiningPass(passmgr);
+      LLVMAddGVNPass(passmgr);
+   }
+   else {
+      /* We need at least this pass to prevent the backends to fail in
+       * unexpected ways.
+       */
+      LLVMAddPromoteMemoryToRegisterPass(passmgr);
+   }
+
+#if HAVE_LLVM >= 0x0800
+   LLVMAddCoroCleanupPass(passmgr);
+#endif
+}
+
+
+static enum LLVM_CodeGenOpt_Level
+get_optlevel(boolean fast)
+{
+   if (fast || (gallivm_perf & GALLIVM_PERF_NO_OPT))
+      return None;
+   else
+      return Default;
+}
+
+
+#if GALLIVM_REUSE_COMPILERS
+/**
+ * Everything needed to compile a module which doesn't depend on the module
+ * itself.  Setting these up takes longer than compiling most shaders, so
+ * they are kept around and handed to one gallivm at a time.
+ */
+struct gallivm_compiler
+{
+   boolean fast;
+   LLVMPassManagerRef passmgr;
+   LLVMPassManagerRef coro_passmgr;
+   struct lp_compiler *codegen;
+};
+
+#define GALLIVM_MAX_IDLE_COMPILERS 8
+
+static mtx_t idle_compilers_mutex = _MTX_INITIALIZER_NP;
+/* Indexed by fast */
+static struct gallivm_compiler *idle_compilers[2][GALLIVM_MAX_IDLE_COMPILERS];
+static unsigned num_idle_compilers[2];
+
+
+static void
+destroy_compiler(struct gallivm_compiler *compiler)
+{
+   if (compiler->passmgr)
+      LLVMDisposePassManager(compiler->passmgr);
+   if (compiler->coro_passmgr)
+      LLVMDisposePassManager(compiler->coro_passmgr);
+   if (compiler->codegen)
+      lp_destroy_compiler(compiler->codegen);
+   FREE(compiler);
+}
+
+
+static struct gallivm_compiler *
+create_compiler(boolean fast)
+{
+   struct gallivm_compiler *compiler;
+   char *error = NULL;
+
+   compiler = CALLOC_STRUCT(gallivm_compiler);
+   if (!compiler)
+      return NULL;
+
+   compiler->fast = fast;
+
+   compiler->passmgr = LLVMCreatePassManager();
+   compiler->coro_passmgr = LLVMCreatePassManager();
+   if (!compiler->passmgr || !compiler->coro_passmgr)
+      goto fail;
+   add_optimization_passes(compiler->passmgr, fast);
+   add_coro_passes(compiler->coro_passmgr);
+
+   compiler->codegen = lp_create_compiler((unsigned) get_optlevel(fast),
+                                          &error);
+   if (!compiler->codegen) {
+      _debug_printf("%s\n", error);
+      free(error);
+      goto fail;
+   }
+
+   return compiler;
+
+fail:
+   destroy_compiler(compiler);
+   return NULL;
+}
+
+
+static struct gallivm_compiler *
+acquire_compiler(boolean fast)
+{
+   struct gallivm_compiler *compiler = NULL;
+
+   mtx_lock(&idle_compilers_mutex);
+   if (num_idle_compilers[fast])
+      compiler = idle_compilers[fast][--num_idle_compilers[fast]];
+   mtx_unlock(&idle_compilers_mutex);
+
+   if (!compiler)
+      compiler = create_compiler(fast);
+   return compiler;
+}
+
+
+static void
+release_compiler(struct gallivm_compiler *compiler)
+{
+   mtx_lock(&idle_compilers_mutex);
+   if (num_idle_compilers[compiler->fast] < GALLIVM_MAX_IDLE_COMPILERS) {
+      idle_compilers[compiler->fast][num_idle_compilers[compiler->fast]++] =
+         compiler;
+      compiler = NULL;
+   }
+   mtx_unlock(&idle_compilers_mutex);
+
+   if (compiler)
+      destroy_compiler(compiler);
+}
+#endif /* GALLIVM_REUSE_COMPILERS */
+
+
 /**
  * Create the LLVM (optimization) pass manager and install
  * relevant optimization passes.
@@ -122,9 +300,23 @@ create_pass_manager(struct gallivm_state *gallivm)
    assert(!gallivm->passmgr);
    assert(gallivm->target);
 
+#if GALLIVM_REUSE_COMPILERS
+   /* The passes are run by the compiler the module is handed to. */
+#else
    gallivm->passmgr = LLVMCreateFunctionPassManagerForModule(gallivm->module);
    if (!gallivm->passmgr)
       return FALSE;
+
+#if HAVE_LLVM >= 0x0800
+   /* Coroutines, used for compute shader barriers, are lowered by passes
+    * which need a module pass manager.  It is only run on the modules which
+    * use coroutines.
+    */
+   gallivm->coro_passmgr = LLVMCreatePassManager();
+   if (!gallivm->coro_passmgr)
+      return FALSE;
+   add_coro_passes(gallivm->coro_passmgr);
+#endif
    /*
     * TODO: some per module pass manager with IPO passes might be helpful -
     * the generated texture functions may benefit from inlining if they are
@@ -134,6 +326,7 @@ create_pass_manager(struct gallivm_state *gallivm)
 #if HAVE_LLVM < 0x0309
    // Old versions of LLVM get the DataLayout from the pass manager.
    LLVMAddTargetData(gallivm->target, gallivm->passmgr);
+#endif
 #endif
 
    {
@@ -144,39 +337,9 @@ create_pass_manager(struct gallivm_state *gallivm)
       free(td_str);
    }
 
-   if ((gallivm_perf & GALLIVM_PERF_NO_OPT) == 0) {
-      /*
-       * TODO: Evaluate passes some more - keeping in mind
-       * both quality of generated code and compile times.
-       */
-      /*
-       * NOTE: if you change this, don't forget to change the output
-       * with GALLIVM_DEBUG_DUMP_BC in gallivm_compile_module.
-       */
-      LLVMAddScalarReplAggregatesPass(gallivm->passmgr);
-      LLVMAddEarlyCSEPass(gallivm->passmgr);
-      LLVMAddCFGSimplificationPass(gallivm->passmgr);
-      /*
-       * FIXME: LICM is potentially quite useful. However, for some
-       * rather crazy shaders the compile time can reach _hours_ per shader,
-       * due to licm implying lcssa (since llvm 3.5), which can take forever.
-       * Even for sane shaders, the cost of licm is rather high (and not just
-       * due to lcssa, licm itself too), though mostly only in cases when it
-       * can actually move things, so having to disable it is a pity.
-       * LLVMAddLICMPass(gallivm->passmgr);
-       */
-      LLVMAddReassociatePass(gallivm->passmgr);
-      LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
-      LLVMAddConstantPropagationPass(gallivm->passmgr);
-      LLVMAddInstructionCombiningPass(gallivm->passmgr);
-      LLVMAddGVNPass(gallivm->passmgr);
-   }
-   else {
-      /* We need at least this pass to prevent the backends to fail in
-       * unexpected ways.
-       */
-      LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
-   }
+#if !GALLIVM_REUSE_COMPILERS
+   add_optimization_passes(gallivm->passmgr, FALSE);
+#endif
 
    return TRUE;
 }
@@ -193,6 +356,17 @@ gallivm_free_ir(struct gallivm_state *gallivm)
       LLVMDisposePassManager(gallivm->passmgr);
    }
 
+   if (gallivm->coro_passmgr) {
+      LLVMDisposePassManager(gallivm->coro_passmgr);
+   }
+
+#if GALLIVM_REUSE_COMPILERS
+   if (gallivm->loaded) {
+      lp_free_loaded_code(gallivm->loaded);
+      gallivm->loaded = NULL;
+   }
+#endif
+
    if (gallivm->engine) {
       /* This will already destroy any associated module */
       LLVMDisposeExecutionEngine(gallivm->engine);
@@ -200,6 +374,11 @@ gallivm_free_ir(struct gallivm_state *gallivm)
       LLVMDisposeModule(gallivm->module);
    }
 
+   if (gallivm->cache) {
+      lp_free_objcache(gallivm->cache->jit_obj_cache);
+      gallivm->cache->jit_obj_cache = NULL;
+   }
+
    FREE(gallivm->module_name);
 
    if (!use_mcjit) {
@@ -220,8 +399,10 @@ gallivm_free_ir(struct gallivm_state *gallivm)
    gallivm->module = NULL;
    gallivm->module_name = NULL;
    gallivm->passmgr = NULL;
+   gallivm->coro_passmgr = NULL;
    gallivm->context = NULL;
    gallivm->builder = NULL;
+   gallivm->cache = NULL;
 }
 
 
@@ -233,6 +414,7 @@ gallivm_free_code(struct gallivm_state *gallivm)
 {
    assert(!gallivm->module);
    assert(!gallivm->engine);
+   assert(!gallivm->loaded);
    lp_free_generated_code(gallivm->code);
    gallivm->code = NULL;
    lp_free_memory_manager(gallivm->memorymgr);
@@ -244,21 +426,15 @@ static boolean
 init_gallivm_engine(struct gallivm_state *gallivm)
 {
    if (1) {
-      enum LLVM_CodeGenOpt_Level optlevel;
+      enum LLVM_CodeGenOpt_Level optlevel = get_optlevel(gallivm->fast);
       char *error = NULL;
       int ret;
 
-      if (gallivm_perf & GALLIVM_PERF_NO_OPT) {
-         optlevel = None;
-      }
-      else {
-         optlevel = Default;
-      }
-
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
                                                     gallivm->module,
                                                     gallivm->memorymgr,
+                                                    gallivm->cache,
                                                     (unsigned) optlevel,
                                                     use_mcjit,
                                                     &error);
@@ -309,7 +485,7 @@ fail:
  */
 static boolean
 init_gallivm_state(struct gallivm_state *gallivm, const char *name,
-                   LLVMContextRef context)
+                   LLVMContextRef context, struct lp_cached_code *cache)
 {
    assert(!gallivm->context);
    assert(!gallivm->module);
@@ -318,6 +494,11 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
       return FALSE;
 
    gallivm->context = context;
+#if HAVE_LLVM >= 0x0306
+   /* Object caching is only implemented for MC-JIT. */
+   if (use_mcjit)
+      gallivm->cache = cache;
+#endif
 
    if (!gallivm->context)
       goto fail;
@@ -446,6 +627,7 @@ lp_build_init(void)
       util_cpu_caps.has_avx2 = 0;
       util_cpu_caps.has_f16c = 0;
       util_cpu_caps.has_fma = 0;
+      util_cpu_caps.has_avx512f = 0;
    }
 #endif
 
@@ -466,9 +648,23 @@ lp_build_init(void)
       lp_native_vector_width = 128;
    }
  
+   /* 512-bit vectors are opt-in (LP_NATIVE_VECTOR_WIDTH=512): wide zmm code
+    * lowers the core clock on many AVX-512 parts, which only pays off for
+    * shader-heavy workloads.
+    */
    lp_native_vector_width = debug_get_num_option("LP_NATIVE_VECTOR_WIDTH",
                                                  lp_native_vector_width);
 
+   if (lp_native_vector_width <= 256) {
+      /* As for AVX below, only take the AVX-512 paths (intrinsics, llc
+       * attributes) when 16-wide vectors were asked for.
+       */
+      util_cpu_caps.has_avx512f = 0;
+      util_cpu_caps.has_avx512dq = 0;
+      util_cpu_caps.has_avx512bw = 0;
+      util_cpu_caps.has_avx512vl = 0;
+   }
+
    if (lp_native_vector_width <= 128) {
       /* Hide AVX support, as often LLVM AVX intrinsics are only guarded by
        * "util_cpu_caps.has_avx" predicate, and lack the
@@ -519,15 +715,20 @@ lp_build_init(void)
 
 /**
  * Create a new gallivm_state object.
+ *
+ * If cache is not NULL, the machine code of the module is loaded from or
+ * stored to it when the module is compiled, see lp_cached_code.  It must
+ * stay valid until gallivm_free_ir() is called.
  */
 struct gallivm_state *
-gallivm_create(const char *name, LLVMContextRef context)
+gallivm_create(const char *name, LLVMContextRef context,
+               struct lp_cached_code *cache)
 {
    struct gallivm_state *gallivm;
 
    gallivm = CALLOC_STRUCT(gallivm_state);
    if (gallivm) {
-      if (!init_gallivm_state(gallivm, name, context)) {
+      if (!init_gallivm_state(gallivm, name, context, cache)) {
          FREE(gallivm);
          gallivm = NULL;
       }
@@ -574,6 +775,22 @@ gallivm_verify_function(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Address of the machine code of a function of a compiled module.
+ */
+static void *
+get_function_code(struct gallivm_state *gallivm, LLVMValueRef func)
+{
+#if GALLIVM_REUSE_COMPILERS
+   assert(gallivm->loaded);
+   return lp_get_loaded_function(gallivm->loaded, func);
+#else
+   assert(gallivm->engine);
+   return LLVMGetPointerToGlobal(gallivm->engine, func);
+#endif
+}
+
+
 /**
  * Compile a module.
  * This does IR optimization on all functions in the module.
@@ -583,6 +800,9 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 {
    LLVMValueRef func;
    int64_t time_begin = 0;
+#if GALLIVM_REUSE_COMPILERS
+   struct gallivm_compiler *compiler;
+#endif
 
    assert(!gallivm->compiled);
 
@@ -610,27 +830,58 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
-   /* Run optimization passes */
-   LLVMInitializeFunctionPassManager(gallivm->passmgr);
-   func = LLVMGetFirstFunction(gallivm->module);
-   while (func) {
-      if (0) {
-         debug_printf("optimizing func %s...\n", LLVMGetValueName(func));
+#if GALLIVM_REUSE_COMPILERS
+   compiler = acquire_compiler(!!gallivm->fast);
+   if (!compiler) {
+      assert(0);
+      return;
+   }
+
+   /* The passes need the real data layout, see below. */
+   lp_compiler_set_module_target(compiler->codegen, gallivm->module);
+#endif
+
+   /* Run optimization passes, unless the code is loaded from the cache */
+   if (!(gallivm->cache && gallivm->cache->data_size)) {
+#if GALLIVM_REUSE_COMPILERS
+      LLVMPassManagerRef coro_passmgr = compiler->coro_passmgr;
+#else
+      LLVMPassManagerRef coro_passmgr = gallivm->coro_passmgr;
+#endif
+
+      if (coro_passmgr &&
+          LLVMGetNamedFunction(gallivm->module, "llvm.coro.id")) {
+         LLVMRunPassManager(coro_passmgr, gallivm->module);
       }
 
-   /* Disable frame pointer omission on debug/profile builds */
-   /* XXX: And workaround http://llvm.org/PR21435 */
+      if (gallivm->passmgr)
+         LLVMInitializeFunctionPassManager(gallivm->passmgr);
+      func = LLVMGetFirstFunction(gallivm->module);
+      while (func) {
+         if (0) {
+            debug_printf("optimizing func %s...\n", LLVMGetValueName(func));
+         }
+
+      /* Disable frame pointer omission on debug/profile builds */
+      /* XXX: And workaround http://llvm.org/PR21435 */
 #if HAVE_LLVM >= 0x0307 && \
     (defined(DEBUG) || defined(PROFILE) || \
      defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64))
-      LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim", "true");
-      LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim-non-leaf", "true");
+         LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim", "true");
+         LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim-non-leaf", "true");
 #endif
 
-      LLVMRunFunctionPassManager(gallivm->passmgr, func);
-      func = LLVMGetNextFunction(func);
+         if (gallivm->passmgr)
+            LLVMRunFunctionPassManager(gallivm->passmgr, func);
+         func = LLVMGetNextFunction(func);
+      }
+      if (gallivm->passmgr)
+         LLVMFinalizeFunctionPassManager(gallivm->passmgr);
+
+#if GALLIVM_REUSE_COMPILERS
+      LLVMRunPassManager(compiler->passmgr, gallivm->module);
+#endif
    }
-   LLVMFinalizeFunctionPassManager(gallivm->passmgr);
 
    if (gallivm_debug & GALLIVM_DEBUG_PERF) {
       int64_t time_end = os_time_get();
@@ -640,6 +891,25 @@ gallivm_compile_module(struct gallivm_state *gallivm)
                    gallivm->module_name, time_msec);
    }
 
+#if GALLIVM_REUSE_COMPILERS
+   {
+      char *error = NULL;
+
+      if (lp_compile_and_load_module(compiler->codegen,
+                                     gallivm->module,
+                                     gallivm->memorymgr,
+                                     gallivm->cache,
+                                     &gallivm->loaded,
+                                     &gallivm->code,
+                                     &error)) {
+         _debug_printf("%s\n", error);
+         free(error);
+         assert(0);
+      }
+   }
+   release_compiler(compiler);
+   assert(gallivm->loaded);
+#else
    if (use_mcjit) {
       /* Setting the module's DataLayout to an empty string will cause the
        * ExecutionEngine to copy to the DataLayout string from its target
@@ -665,6 +935,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       }
    }
    assert(gallivm->engine);
+#endif
 
    ++gallivm->compiled;
 
@@ -678,7 +949,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
           * LLVMGetPointerToGlobal() will abort otherwise.
           */
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
+            void *func_code = get_function_code(gallivm, llvm_func);
             lp_disassemble(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
@@ -691,7 +962,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 
       while (llvm_func) {
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
+            void *func_code = get_function_code(gallivm, llvm_func);
             lp_profile(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
@@ -711,12 +982,11 @@ gallivm_jit_function(struct gallivm_state *gallivm,
    int64_t time_begin = 0;
 
    assert(gallivm->compiled);
-   assert(gallivm->engine);
 
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
-   code = LLVMGetPointerToGlobal(gallivm->engine, func);
+   code = get_function_code(gallivm, func);
    assert(code);
    jit_func = pointer_to_func(code);
 
@@ -39,18 +39,40 @@
 extern "C" {
 #endif
 
+/**
+ * Machine code of a module, used to cache it across processes.
+ *
+ * If data_size is not zero when the module is compiled, the code in data is
+ * loaded instead of generating it, otherwise the generated code is copied
+ * into data.  dont_cache is set when the code embeds process specific
+ * addresses and must not be reused.
+ */
+struct lp_cached_code {
+   void *data;
+   size_t data_size;
+   boolean dont_cache;
+   void *jit_obj_cache;
+};
+
+
 struct gallivm_state
 {
    char *module_name;
    LLVMModuleRef module;
    LLVMExecutionEngineRef engine;
+   struct lp_loaded_code *loaded; /**< instead of engine with pooled compilers */
    LLVMTargetDataRef target;
    LLVMPassManagerRef passmgr;
+   LLVMPassManagerRef coro_passmgr; /**< NULL if coroutines aren't supported */
    LLVMContextRef context;
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_cached_code *cache;
    unsigned compiled;
+   /** Compile quickly at the expense of the generated code, if set before
+    * gallivm_compile_module() */
+   boolean fast;
 };
 
 
@@ -59,7 +81,8 @@ lp_build_init(void);
 
 
 struct gallivm_state *
-gallivm_create(const char *name, LLVMContextRef context);
+gallivm_create(const char *name, LLVMContextRef context,
+               struct lp_cached_code *cache);
 
 void
 gallivm_destroy(struct gallivm_state *gallivm);
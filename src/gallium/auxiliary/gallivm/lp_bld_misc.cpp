@@ -65,6 +65,7 @@
 #include <llvm/ExecutionEngine/JITMemoryManager.h>
 #else
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #endif
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
@@ -83,6 +84,20 @@
 #if LLVM_USE_INTEL_JITEVENTS
 #include <llvm/ExecutionEngine/JITEventListener.h>
 #endif
+#if HAVE_LLVM >= 0x0800 /* GALLIVM_REUSE_COMPILERS */
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ExecutionEngine/RuntimeDyld.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Mangler.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Support/raw_ostream.h>
+#if HAVE_LLVM >= 0x0e00
+#include <llvm/MC/TargetRegistry.h>
+#else
+#include <llvm/Support/TargetRegistry.h>
+#endif
+#include <llvm/Target/TargetMachine.h>
+#endif
 
 // Workaround http://llvm.org/PR23628
 #if HAVE_LLVM >= 0x0307
@@ -97,6 +112,7 @@
 
 #include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
+#include "lp_bld_init.h"
 
 namespace {
 
@@ -473,88 +489,50 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
 };
 
 
-/**
- * Same as LLVMCreateJITCompilerForModule, but:
- * - allows using MCJIT and enabling AVX feature where available.
- * - set target options
- *
- * See also:
- * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
- * - llvm/tools/lli/lli.cpp
- * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
- */
-extern "C"
-LLVMBool
-lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
-                                        lp_generated_code **OutCode,
-                                        LLVMModuleRef M,
-                                        LLVMMCJITMemoryManagerRef CMM,
-                                        unsigned OptLevel,
-                                        int useMCJIT,
-                                        char **OutError)
-{
-   using namespace llvm;
-
-   std::string Error;
 #if HAVE_LLVM >= 0x0306
-   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
-#else
-   EngineBuilder builder(unwrap(M));
-#endif
+/*
+ * Hand the object code MC-JIT compiles over to a lp_cached_code, or make
+ * it load the object code found there instead of compiling the module.
+ */
+class LPObjectCache : public llvm::ObjectCache {
+   struct lp_cached_code *cache_out;
 
-   /**
-    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
-    * friends for configuring code generation options, like stack alignment.
-    */
-   TargetOptions options;
-#if defined(PIPE_ARCH_X86)
-   options.StackAlignmentOverride = 4;
-#if HAVE_LLVM < 0x0304
-   options.RealignStack = true;
-#endif
-#endif
+   public:
+      LPObjectCache(struct lp_cached_code *cache) {
+         cache_out = cache;
+      }
 
-#if defined(DEBUG) && HAVE_LLVM < 0x0307
-   options.JITEmitDebugInfo = true;
-#endif
+      virtual void notifyObjectCompiled(const llvm::Module *M,
+                                        llvm::MemoryBufferRef Obj) {
+         if (cache_out->data_size)
+            return;
 
-   /* XXX: Workaround http://llvm.org/PR21435 */
-#if defined(DEBUG) || defined(PROFILE) || \
-    (HAVE_LLVM >= 0x0303 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)))
-#if HAVE_LLVM < 0x0304
-   options.NoFramePointerElimNonLeaf = true;
-#endif
-#if HAVE_LLVM < 0x0307
-   options.NoFramePointerElim = true;
-#endif
-#endif
+         cache_out->data = malloc(Obj.getBufferSize());
+         if (!cache_out->data)
+            return;
+         memcpy(cache_out->data, Obj.getBufferStart(), Obj.getBufferSize());
+         cache_out->data_size = Obj.getBufferSize();
+      }
 
-   builder.setEngineKind(EngineKind::JIT)
-          .setErrorStr(&Error)
-          .setTargetOptions(options)
-          .setOptLevel((CodeGenOpt::Level)OptLevel);
+      virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M) {
+         if (!cache_out->data_size)
+            return NULL;
 
-   if (useMCJIT) {
-#if HAVE_LLVM < 0x0306
-       builder.setUseMCJIT(true);
-#endif
-#ifdef _WIN32
-       /*
-        * MCJIT works on Windows, but currently only through ELF object format.
-        *
-        * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
-        * different strings for MinGW/MSVC, so better play it safe and be
-        * explicit.
-        */
-#  ifdef _WIN64
-       LLVMSetTarget(M, "x86_64-pc-win32-elf");
-#  else
-       LLVMSetTarget(M, "i686-pc-win32-elf");
-#  endif
+         return llvm::MemoryBuffer::getMemBuffer(
+                   llvm::StringRef((const char *)cache_out->data,
+                                   cache_out->data_size), "", false);
+      }
+};
 #endif
-   }
 
-   llvm::SmallVector<std::string, 16> MAttrs;
+
+/**
+ * The -mattr options for the host, after any overrides of util_cpu_caps.
+ */
+static void
+lp_get_mattrs(llvm::SmallVector<std::string, 16> &MAttrs)
+{
+   using namespace llvm;
 
 #if HAVE_LLVM >= 0x0400 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64) || defined(PIPE_ARCH_ARM))
    /* llvm-3.3+ implements sys::getHostCPUFeatures for Arm
@@ -612,17 +590,17 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       MAttrs.push_back("-fma");
    }
    MAttrs.push_back(util_cpu_caps.has_avx2 ? "+avx2" : "-avx2");
-   /* disable avx512 and all subvariants */
+   /* avx512 only when 512-bit vectors were asked for, see lp_build_init */
 #if HAVE_LLVM >= 0x0304
    MAttrs.push_back("-avx512cd");
    MAttrs.push_back("-avx512er");
-   MAttrs.push_back("-avx512f");
+   MAttrs.push_back(util_cpu_caps.has_avx512f ? "+avx512f" : "-avx512f");
    MAttrs.push_back("-avx512pf");
 #endif
 #if HAVE_LLVM >= 0x0305
-   MAttrs.push_back("-avx512bw");
-   MAttrs.push_back("-avx512dq");
-   MAttrs.push_back("-avx512vl");
+   MAttrs.push_back(util_cpu_caps.has_avx512bw ? "+avx512bw" : "-avx512bw");
+   MAttrs.push_back(util_cpu_caps.has_avx512dq ? "+avx512dq" : "-avx512dq");
+   MAttrs.push_back(util_cpu_caps.has_avx512vl ? "+avx512vl" : "-avx512vl");
 #endif
 #endif
 #if defined(PIPE_ARCH_ARM)
@@ -666,8 +644,6 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 #endif
 #endif
 
-   builder.setMAttrs(MAttrs);
-
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
       int n = MAttrs.size();
       if (n > 0) {
@@ -677,9 +653,17 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
          debug_printf("\n");
       }
    }
+}
+
 
 #if HAVE_LLVM >= 0x0305
-   StringRef MCPU = llvm::sys::getHostCPUName();
+/**
+ * The -mcpu option for the host.
+ */
+static std::string
+lp_get_mcpu(void)
+{
+   std::string MCPU = llvm::sys::getHostCPUName().str();
    /*
     * The cpu bits are no longer set automatically, so need to set mcpu manually.
     * Note that the MAttrs set above will be sort of ignored (since we should
@@ -705,10 +689,113 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    if (MCPU == "generic")
       MCPU = "pwr8";
 #endif
-   builder.setMCPU(MCPU);
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
-      debug_printf("llc -mcpu option: %s\n", MCPU.str().c_str());
+      debug_printf("llc -mcpu option: %s\n", MCPU.c_str());
    }
+   return MCPU;
+}
+#endif
+
+
+/**
+ * Code generation options for the host.
+ */
+static llvm::TargetOptions
+lp_get_target_options(void)
+{
+   /**
+    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
+    * friends for configuring code generation options, like stack alignment.
+    */
+   llvm::TargetOptions options;
+#if defined(PIPE_ARCH_X86)
+   options.StackAlignmentOverride = 4;
+#if HAVE_LLVM < 0x0304
+   options.RealignStack = true;
+#endif
+#endif
+
+#if defined(DEBUG) && HAVE_LLVM < 0x0307
+   options.JITEmitDebugInfo = true;
+#endif
+
+   /* XXX: Workaround http://llvm.org/PR21435 */
+#if defined(DEBUG) || defined(PROFILE) || \
+    (HAVE_LLVM >= 0x0303 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)))
+#if HAVE_LLVM < 0x0304
+   options.NoFramePointerElimNonLeaf = true;
+#endif
+#if HAVE_LLVM < 0x0307
+   options.NoFramePointerElim = true;
+#endif
+#endif
+
+   return options;
+}
+
+
+/**
+ * Same as LLVMCreateJITCompilerForModule, but:
+ * - allows using MCJIT and enabling AVX feature where available.
+ * - set target options
+ * - loads/stores the object code from/to cache, if not NULL
+ *
+ * See also:
+ * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
+ * - llvm/tools/lli/lli.cpp
+ * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ */
+extern "C"
+LLVMBool
+lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        lp_generated_code **OutCode,
+                                        LLVMModuleRef M,
+                                        LLVMMCJITMemoryManagerRef CMM,
+                                        struct lp_cached_code *cache,
+                                        unsigned OptLevel,
+                                        int useMCJIT,
+                                        char **OutError)
+{
+   using namespace llvm;
+
+   std::string Error;
+#if HAVE_LLVM >= 0x0306
+   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
+#else
+   EngineBuilder builder(unwrap(M));
+#endif
+
+   builder.setEngineKind(EngineKind::JIT)
+          .setErrorStr(&Error)
+          .setTargetOptions(lp_get_target_options())
+          .setOptLevel((CodeGenOpt::Level)OptLevel);
+
+   if (useMCJIT) {
+#if HAVE_LLVM < 0x0306
+       builder.setUseMCJIT(true);
+#endif
+#ifdef _WIN32
+       /*
+        * MCJIT works on Windows, but currently only through ELF object format.
+        *
+        * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
+        * different strings for MinGW/MSVC, so better play it safe and be
+        * explicit.
+        */
+#  ifdef _WIN64
+       LLVMSetTarget(M, "x86_64-pc-win32-elf");
+#  else
+       LLVMSetTarget(M, "i686-pc-win32-elf");
+#  endif
+#endif
+   }
+
+   llvm::SmallVector<std::string, 16> MAttrs;
+   lp_get_mattrs(MAttrs);
+   builder.setMAttrs(MAttrs);
+
+#if HAVE_LLVM >= 0x0305
+   builder.setMCPU(lp_get_mcpu());
 #endif
 
    ShaderMemoryManager *MM = NULL;
@@ -745,6 +832,13 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT->RegisterJITEventListener(JEL);
 #endif
    if (JIT) {
+#if HAVE_LLVM >= 0x0306
+      if (cache) {
+         LPObjectCache *objcache = new LPObjectCache(cache);
+         cache->jit_obj_cache = (void *)objcache;
+         JIT->setObjectCache(objcache);
+      }
+#endif
       *OutJIT = wrap(JIT);
       return 0;
    }
@@ -763,6 +857,252 @@ lp_free_generated_code(struct lp_generated_code *code)
    ShaderMemoryManager::freeGeneratedCode(code);
 }
 
+#if GALLIVM_REUSE_COMPILERS
+/*
+ * Target machine and code generation passes for the host.  Both are
+ * independent of the modules they compile, which are handed to them
+ * one at a time.
+ */
+struct lp_compiler {
+   llvm::TargetMachine *TM;
+   llvm::legacy::PassManager *CodeGenPasses;
+   llvm::SmallVector<char, 0> Obj;
+   llvm::raw_svector_ostream ObjStream;
+   std::string DataLayout;
+   std::string Triple;
+
+   lp_compiler() : TM(NULL), CodeGenPasses(NULL), ObjStream(Obj) {}
+
+   ~lp_compiler() {
+      /* The passes reference the target machine. */
+      delete CodeGenPasses;
+      delete TM;
+   }
+};
+
+
+/*
+ * Object code loaded into memory, with its symbols resolved.
+ */
+struct lp_loaded_code {
+   ShaderMemoryManager *MM;
+   llvm::RuntimeDyld *Dyld;
+};
+
+
+#if LLVM_USE_INTEL_JITEVENTS
+static llvm::JITEventListener *
+lp_get_jit_event_listener(void)
+{
+   static llvm::JITEventListener *JEL =
+      llvm::JITEventListener::createIntelJITEventListener();
+   return JEL;
+}
+#endif
+
+
+/**
+ * Set up everything needed to compile modules to object code for the host.
+ */
+extern "C"
+struct lp_compiler *
+lp_create_compiler(unsigned OptLevel, char **OutError)
+{
+   using namespace llvm;
+
+   std::string Error;
+#ifdef _WIN32
+   /* See lp_build_create_jit_compiler_for_module. */
+#  ifdef _WIN64
+   std::string TripleStr = "x86_64-pc-win32-elf";
+#  else
+   std::string TripleStr = "i686-pc-win32-elf";
+#  endif
+#else
+   std::string TripleStr = sys::getProcessTriple();
+#endif
+
+   const Target *T = TargetRegistry::lookupTarget(TripleStr, Error);
+   if (!T) {
+      *OutError = strdup(Error.c_str());
+      return NULL;
+   }
+
+   SmallVector<std::string, 16> MAttrs;
+   lp_get_mattrs(MAttrs);
+
+   lp_compiler *compiler = new lp_compiler();
+
+   /* JIT so that the code model suits code loaded anywhere in memory. */
+   compiler->TM = T->createTargetMachine(TripleStr, lp_get_mcpu(),
+                                         join(MAttrs, ","),
+                                         lp_get_target_options(),
+                                         None, None,
+                                         (CodeGenOpt::Level)OptLevel,
+                                         true);
+   if (!compiler->TM) {
+      delete compiler;
+      *OutError = strdup("couldn't create target machine");
+      return NULL;
+   }
+
+   compiler->CodeGenPasses = new legacy::PassManager();
+   MCContext *Ctx;
+   if (compiler->TM->addPassesToEmitMC(*compiler->CodeGenPasses, Ctx,
+                                       compiler->ObjStream, false)) {
+      delete compiler;
+      *OutError = strdup("target can't emit object code");
+      return NULL;
+   }
+
+   compiler->DataLayout =
+      compiler->TM->createDataLayout().getStringRepresentation();
+   compiler->Triple = TripleStr;
+
+   return compiler;
+}
+
+
+extern "C"
+void
+lp_destroy_compiler(struct lp_compiler *compiler)
+{
+   delete compiler;
+}
+
+
+/**
+ * Give the module the data layout and triple of the compiler, which the
+ * optimization passes should see too.
+ */
+extern "C"
+void
+lp_compiler_set_module_target(struct lp_compiler *compiler, LLVMModuleRef M)
+{
+   LLVMSetDataLayout(M, compiler->DataLayout.c_str());
+   LLVMSetTarget(M, compiler->Triple.c_str());
+}
+
+
+/**
+ * Compile an (already optimized) module and load the object code, or load
+ * the object code found in the cache instead if there is any.
+ *
+ * Newly compiled object code is copied into the cache, if not NULL.
+ */
+extern "C"
+LLVMBool
+lp_compile_and_load_module(struct lp_compiler *compiler,
+                           LLVMModuleRef M,
+                           LLVMMCJITMemoryManagerRef CMM,
+                           struct lp_cached_code *cache,
+                           struct lp_loaded_code **OutLoaded,
+                           struct lp_generated_code **OutCode,
+                           char **OutError)
+{
+   using namespace llvm;
+
+   StringRef ObjData;
+   if (cache && cache->data_size) {
+      ObjData = StringRef((const char *)cache->data, cache->data_size);
+   } else {
+      compiler->Obj.clear();
+      compiler->CodeGenPasses->run(*unwrap(M));
+      ObjData = StringRef(compiler->Obj.data(), compiler->Obj.size());
+
+      if (cache) {
+         cache->data = malloc(ObjData.size());
+         if (cache->data) {
+            memcpy(cache->data, ObjData.data(), ObjData.size());
+            cache->data_size = ObjData.size();
+         }
+      }
+   }
+
+   Expected<std::unique_ptr<object::ObjectFile>> ObjFile =
+      object::ObjectFile::createObjectFile(MemoryBufferRef(ObjData, ""));
+   if (!ObjFile) {
+      *OutError = strdup(toString(ObjFile.takeError()).c_str());
+      return 1;
+   }
+
+   BaseMemoryManager* JMM = reinterpret_cast<BaseMemoryManager*>(CMM);
+   lp_loaded_code *loaded = new lp_loaded_code;
+   loaded->MM = new ShaderMemoryManager(JMM);
+   loaded->Dyld = new RuntimeDyld(*loaded->MM, *loaded->MM);
+
+   std::unique_ptr<RuntimeDyld::LoadedObjectInfo> Info =
+      loaded->Dyld->loadObject(**ObjFile);
+   if (loaded->Dyld->hasError()) {
+      *OutError = strdup(loaded->Dyld->getErrorString().str().c_str());
+      delete loaded->Dyld;
+      delete loaded->MM;
+      delete loaded;
+      return 1;
+   }
+
+   loaded->Dyld->resolveRelocations();
+   loaded->Dyld->registerEHFrames();
+   loaded->MM->finalizeMemory();
+
+#if LLVM_USE_INTEL_JITEVENTS
+   lp_get_jit_event_listener()->notifyObjectLoaded(
+      (JITEventListener::ObjectKey)loaded, **ObjFile, *Info);
+#endif
+
+   *OutLoaded = loaded;
+   *OutCode = loaded->MM->getGeneratedCode();
+   return 0;
+}
+
+
+/**
+ * Address of the loaded code of a function of the compiled module.
+ */
+extern "C"
+void *
+lp_get_loaded_function(struct lp_loaded_code *loaded, LLVMValueRef func)
+{
+   using namespace llvm;
+
+   GlobalValue *GV = unwrap<GlobalValue>(func);
+   SmallString<128> Name;
+   Mangler::getNameWithPrefix(Name, GV->getName(),
+                              GV->getParent()->getDataLayout());
+   return (void *)(uintptr_t)loaded->Dyld->getSymbol(Name).getAddress();
+}
+
+
+/**
+ * Forget about loaded code.  The memory holding it is released with the
+ * lp_generated_code.
+ */
+extern "C"
+void
+lp_free_loaded_code(struct lp_loaded_code *loaded)
+{
+#if LLVM_USE_INTEL_JITEVENTS
+   lp_get_jit_event_listener()->notifyFreeingObject(
+      (llvm::JITEventListener::ObjectKey)loaded);
+#endif
+   loaded->Dyld->deregisterEHFrames();
+   delete loaded->Dyld;
+   delete loaded->MM;
+   delete loaded;
+}
+#endif /* GALLIVM_REUSE_COMPILERS */
+
+
+extern "C"
+void
+lp_free_objcache(void *objcache_ptr)
+{
+#if HAVE_LLVM >= 0x0306
+   LPObjectCache *objcache = (LPObjectCache *)objcache_ptr;
+   delete objcache;
+#endif
+}
+
 extern "C"
 LLVMMCJITMemoryManagerRef
 lp_get_default_memory_manager()
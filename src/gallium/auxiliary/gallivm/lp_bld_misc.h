@@ -40,7 +40,18 @@ extern "C" {
 #endif
 
 
+/*
+ * With newer LLVM, modules are compiled by pooled compilers and the object
+ * code is loaded separately, instead of setting up an MC-JIT execution
+ * engine (and with it a target machine and code generation passes) for
+ * each module.
+ */
+#define GALLIVM_REUSE_COMPILERS (HAVE_LLVM >= 0x0800)
+
 struct lp_generated_code;
+struct lp_cached_code;
+struct lp_compiler;
+struct lp_loaded_code;
 
 extern LLVMTargetLibraryInfoRef
 gallivm_create_target_library_info(const char *triple);
@@ -57,6 +68,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         struct lp_generated_code **OutCode,
                                         LLVMModuleRef M,
                                         LLVMMCJITMemoryManagerRef MM,
+                                        struct lp_cached_code *cache,
                                         unsigned OptLevel,
                                         int useMCJIT,
                                         char **OutError);
@@ -64,6 +76,35 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 extern void
 lp_free_generated_code(struct lp_generated_code *code);
 
+extern void
+lp_free_objcache(void *objcache);
+
+#if GALLIVM_REUSE_COMPILERS
+extern struct lp_compiler *
+lp_create_compiler(unsigned OptLevel, char **OutError);
+
+extern void
+lp_destroy_compiler(struct lp_compiler *compiler);
+
+extern void
+lp_compiler_set_module_target(struct lp_compiler *compiler, LLVMModuleRef M);
+
+extern LLVMBool
+lp_compile_and_load_module(struct lp_compiler *compiler,
+                           LLVMModuleRef M,
+                           LLVMMCJITMemoryManagerRef MM,
+                           struct lp_cached_code *cache,
+                           struct lp_loaded_code **OutLoaded,
+                           struct lp_generated_code **OutCode,
+                           char **OutError);
+
+extern void *
+lp_get_loaded_function(struct lp_loaded_code *loaded, LLVMValueRef func);
+
+extern void
+lp_free_loaded_code(struct lp_loaded_code *loaded);
+#endif
+
 extern LLVMMCJITMemoryManagerRef
 lp_get_default_memory_manager();
 
@@ -67,6 +67,7 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_cs_iface;
 
 
 enum lp_build_tex_modifier {
@@ -170,6 +171,11 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef prim_id;
    LLVMValueRef basevertex;
    LLVMValueRef invocation_id;
+   /* Compute shaders only.  thread_id holds vectors, the others scalars. */
+   LLVMValueRef thread_id[3];
+   LLVMValueRef block_id[3];
+   LLVMValueRef block_size[3];
+   LLVMValueRef grid_size[3];
 };
 
 
@@ -223,6 +229,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   struct lp_build_mask_context *mask,
                   LLVMValueRef consts_ptr,
                   LLVMValueRef const_sizes_ptr,
+                  LLVMValueRef ssbo_ptr,
+                  LLVMValueRef ssbo_sizes_ptr,
                   const struct lp_bld_tgsi_system_values *system_values,
                   const LLVMValueRef (*inputs)[4],
                   LLVMValueRef (*outputs)[4],
@@ -230,7 +238,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   const struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface);
 
 
 void
@@ -430,6 +439,25 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * Compute shader interface: the memory shared by the invocations of a
+ * workgroup and the synchronization between them.
+ */
+struct lp_build_tgsi_cs_iface
+{
+   /** Shared memory accessed through MEMORY[] SHARED, and its size in bytes */
+   LLVMValueRef shared_ptr;
+   LLVMValueRef shared_size;
+
+   /**
+    * Wait until all the invocations of the workgroup reached the barrier.
+    * Can be NULL if the whole workgroup is run by a single invocation
+    * of the shader code.
+    */
+   void (*emit_barrier)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                        struct lp_build_tgsi_context * bld_base);
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -438,6 +466,7 @@ struct lp_build_tgsi_soa_context
    struct lp_build_context elem_bld;
 
    const struct lp_build_tgsi_gs_iface *gs_iface;
+   const struct lp_build_tgsi_cs_iface *cs_iface;
    LLVMValueRef emitted_prims_vec_ptr;
    LLVMValueRef total_emitted_vertices_vec_ptr;
    LLVMValueRef emitted_vertices_vec_ptr;
@@ -447,6 +476,10 @@ struct lp_build_tgsi_soa_context
    LLVMValueRef const_sizes_ptr;
    LLVMValueRef consts[LP_MAX_TGSI_CONST_BUFFERS];
    LLVMValueRef consts_sizes[LP_MAX_TGSI_CONST_BUFFERS];
+   LLVMValueRef ssbo_ptr;
+   LLVMValueRef ssbo_sizes_ptr;
+   LLVMValueRef ssbos[LP_MAX_TGSI_SHADER_BUFFERS];
+   LLVMValueRef ssbo_sizes[LP_MAX_TGSI_SHADER_BUFFERS];
    const LLVMValueRef (*inputs)[TGSI_NUM_CHANNELS];
    LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS];
    LLVMValueRef context_ptr;
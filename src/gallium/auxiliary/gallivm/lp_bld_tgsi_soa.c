@@ -1704,6 +1704,39 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      if ((swizzle_in & 0xffff) < 3)
+         res = bld->system_values.thread_id[swizzle_in & 0xffff];
+      else
+         res = bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+   case TGSI_SEMANTIC_GRID_SIZE:
+   {
+      const LLVMValueRef *values;
+      switch (info->system_value_semantic_name[reg->Register.Index]) {
+      case TGSI_SEMANTIC_BLOCK_ID:
+         values = bld->system_values.block_id;
+         break;
+      case TGSI_SEMANTIC_BLOCK_SIZE:
+         values = bld->system_values.block_size;
+         break;
+      default:
+         values = bld->system_values.grid_size;
+         break;
+      }
+      if ((swizzle_in & 0xffff) < 3)
+         res = lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                         values[swizzle_in & 0xffff]);
+      else
+         res = bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+   }
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -2962,6 +2995,17 @@ lp_emit_declaration_soa(
    }
       break;
 
+   case TGSI_FILE_BUFFER:
+      assert(last < LP_MAX_TGSI_SHADER_BUFFERS);
+      for (idx = first; idx <= last; ++idx) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, idx);
+         bld->ssbos[idx] =
+            lp_build_array_get(gallivm, bld->ssbo_ptr, index);
+         bld->ssbo_sizes[idx] =
+            lp_build_array_get(gallivm, bld->ssbo_sizes_ptr, index);
+      }
+      break;
+
    default:
       /* don't need to declare other vars */
       break;
@@ -3362,12 +3406,339 @@ mask_vec(struct lp_build_tgsi_context *bld_base)
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
    LLVMBuilderRef builder = bld->bld_base.base.gallivm->builder;
    struct lp_exec_mask *exec_mask = &bld->exec_mask;
+   LLVMValueRef bld_mask = bld->mask ? lp_build_mask_value(bld->mask) : NULL;
 
    if (!exec_mask->has_mask) {
-      return lp_build_mask_value(bld->mask);
+      if (!bld_mask)
+         return lp_build_const_int_vec(bld->bld_base.base.gallivm,
+                                       bld->bld_base.int_bld.type, -1);
+      return bld_mask;
+   }
+   if (!bld_mask)
+      return exec_mask->exec_mask;
+   return LLVMBuildAnd(builder, bld_mask, exec_mask->exec_mask, "");
+}
+
+/**
+ * Get the memory accessed by a LOAD, STORE, RESQ or atomic instruction:
+ * a shader buffer or the compute shader's shared memory.
+ * \param base_ptr  returns a pointer to 32-bit words
+ * \param size  returns the size in bytes
+ */
+static void
+get_mem_base(struct lp_build_tgsi_soa_context *bld,
+             unsigned file,
+             unsigned index,
+             LLVMValueRef *base_ptr,
+             LLVMValueRef *size)
+{
+   if (file == TGSI_FILE_MEMORY) {
+      assert(bld->cs_iface);
+      *base_ptr = bld->cs_iface->shared_ptr;
+      *size = bld->cs_iface->shared_size;
+   }
+   else {
+      assert(file == TGSI_FILE_BUFFER);
+      assert(index < LP_MAX_TGSI_SHADER_BUFFERS);
+      *base_ptr = bld->ssbos[index];
+      *size = bld->ssbo_sizes[index];
    }
-   return LLVMBuildAnd(builder, lp_build_mask_value(bld->mask),
-                       exec_mask->exec_mask, "");
+}
+
+/**
+ * Convert the byte offsets of an instruction source to indices of 32-bit
+ * words.
+ */
+static LLVMValueRef
+fetch_mem_index(struct lp_build_tgsi_context *bld_base,
+                const struct tgsi_full_instruction *inst,
+                unsigned src_op)
+{
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMValueRef offset;
+
+   offset = lp_build_emit_fetch(bld_base, inst, src_op, TGSI_CHAN_X);
+   offset = LLVMBuildBitCast(builder, offset, uint_bld->vec_type, "");
+   return lp_build_shr_imm(uint_bld, offset, 2);
+}
+
+/**
+ * Load 32-bit words from a shader buffer or shared memory.
+ * Out of bounds reads return 0.
+ */
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef base_ptr, size, num_words, index;
+   unsigned chan;
+
+   get_mem_base(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                &base_ptr, &size);
+
+   /* build_gather() only fetches floats */
+   base_ptr = LLVMBuildBitCast(builder, base_ptr,
+                               LLVMPointerType(bld_base->base.elem_type, 0), "");
+   num_words = LLVMBuildLShr(builder, size,
+                             lp_build_const_int32(gallivm, 2), "");
+   num_words = lp_build_broadcast_scalar(uint_bld, num_words);
+
+   index = fetch_mem_index(bld_base, inst, 1);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef chan_index, overflow_mask;
+
+      chan_index = lp_build_add(uint_bld, index,
+                                lp_build_const_int_vec(gallivm, uint_bld->type,
+                                                       chan));
+      overflow_mask = lp_build_compare(gallivm, uint_bld->type,
+                                       PIPE_FUNC_GEQUAL, chan_index, num_words);
+      emit_data->output[chan] = build_gather(bld_base, base_ptr, chan_index,
+                                             overflow_mask, NULL);
+   }
+}
+
+/**
+ * Store 32-bit words to a shader buffer or shared memory, for the active
+ * invocations.  Out of bounds writes are discarded.
+ */
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef base_ptr, size, num_words, index, exec_mask;
+   LLVMValueRef values[TGSI_NUM_CHANNELS];
+   struct lp_build_loop_state loop;
+   struct lp_build_if_state ifthen;
+   LLVMValueRef lane, active, lane_index;
+   unsigned chan;
+
+   get_mem_base(bld, inst->Dst[0].Register.File, inst->Dst[0].Register.Index,
+                &base_ptr, &size);
+   num_words = LLVMBuildLShr(builder, size,
+                             lp_build_const_int32(gallivm, 2), "");
+
+   index = fetch_mem_index(bld_base, inst, 0);
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      values[chan] = lp_build_emit_fetch(bld_base, inst, 1, chan);
+      values[chan] = LLVMBuildBitCast(builder, values[chan],
+                                      uint_bld->vec_type, "");
+   }
+   exec_mask = mask_vec(bld_base);
+
+   /* Scatter the values of the active lanes, one lane at a time */
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+   lane = loop.counter;
+
+   active = LLVMBuildExtractElement(builder, exec_mask, lane, "");
+   active = LLVMBuildICmp(builder, LLVMIntNE, active,
+                          lp_build_const_int32(gallivm, 0), "");
+   lp_build_if(&ifthen, gallivm, active);
+   lane_index = LLVMBuildExtractElement(builder, index, lane, "");
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      struct lp_build_if_state ifbounds;
+      LLVMValueRef chan_index, in_bounds, ptr, value;
+
+      chan_index = LLVMBuildAdd(builder, lane_index,
+                                lp_build_const_int32(gallivm, chan), "");
+      in_bounds = LLVMBuildICmp(builder, LLVMIntULT, chan_index, num_words, "");
+      lp_build_if(&ifbounds, gallivm, in_bounds);
+      ptr = LLVMBuildGEP(builder, base_ptr, &chan_index, 1, "");
+      value = LLVMBuildExtractElement(builder, values[chan], lane, "");
+      LLVMBuildStore(builder, value, ptr);
+      lp_build_endif(&ifbounds);
+   }
+   lp_build_endif(&ifthen);
+
+   lp_build_loop_end_cond(&loop,
+                          lp_build_const_int32(gallivm, uint_bld->type.length),
+                          NULL, LLVMIntUGE);
+}
+
+/**
+ * Atomic operations on a shader buffer or shared memory, for the active
+ * invocations.  Out of bounds operations are discarded and return 0.
+ */
+static void
+atomic_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef base_ptr, size, num_words, index, exec_mask;
+   LLVMValueRef value, cmp_value = NULL, result_ptr, result;
+   struct lp_build_loop_state loop;
+   struct lp_build_if_state ifthen;
+   LLVMValueRef lane, cond, ptr, lane_value, old;
+   LLVMAtomicRMWBinOp op = LLVMAtomicRMWBinOpAdd;
+   unsigned chan;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_ATOMUADD:
+      op = LLVMAtomicRMWBinOpAdd;
+      break;
+   case TGSI_OPCODE_ATOMXCHG:
+      op = LLVMAtomicRMWBinOpXchg;
+      break;
+   case TGSI_OPCODE_ATOMAND:
+      op = LLVMAtomicRMWBinOpAnd;
+      break;
+   case TGSI_OPCODE_ATOMOR:
+      op = LLVMAtomicRMWBinOpOr;
+      break;
+   case TGSI_OPCODE_ATOMXOR:
+      op = LLVMAtomicRMWBinOpXor;
+      break;
+   case TGSI_OPCODE_ATOMUMIN:
+      op = LLVMAtomicRMWBinOpUMin;
+      break;
+   case TGSI_OPCODE_ATOMUMAX:
+      op = LLVMAtomicRMWBinOpUMax;
+      break;
+   case TGSI_OPCODE_ATOMIMIN:
+      op = LLVMAtomicRMWBinOpMin;
+      break;
+   case TGSI_OPCODE_ATOMIMAX:
+      op = LLVMAtomicRMWBinOpMax;
+      break;
+   case TGSI_OPCODE_ATOMCAS:
+      break;
+   default:
+      assert(0);
+      break;
+   }
+
+   get_mem_base(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                &base_ptr, &size);
+   num_words = LLVMBuildLShr(builder, size,
+                             lp_build_const_int32(gallivm, 2), "");
+
+   index = fetch_mem_index(bld_base, inst, 1);
+   value = lp_build_emit_fetch(bld_base, inst, 2, TGSI_CHAN_X);
+   value = LLVMBuildBitCast(builder, value, uint_bld->vec_type, "");
+   if (inst->Instruction.Opcode == TGSI_OPCODE_ATOMCAS) {
+      cmp_value = value;
+      value = lp_build_emit_fetch(bld_base, inst, 3, TGSI_CHAN_X);
+      value = LLVMBuildBitCast(builder, value, uint_bld->vec_type, "");
+   }
+   exec_mask = mask_vec(bld_base);
+
+   result_ptr = lp_build_alloca(gallivm, uint_bld->vec_type, "atomic_result");
+   LLVMBuildStore(builder, uint_bld->zero, result_ptr);
+
+   /* Atomics of different lanes may hit the same word, do them in order */
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+   lane = loop.counter;
+
+   index = LLVMBuildExtractElement(builder, index, lane, "");
+   cond = LLVMBuildExtractElement(builder, exec_mask, lane, "");
+   cond = LLVMBuildICmp(builder, LLVMIntNE, cond,
+                        lp_build_const_int32(gallivm, 0), "");
+   cond = LLVMBuildAnd(builder, cond,
+                       LLVMBuildICmp(builder, LLVMIntULT, index, num_words, ""),
+                       "");
+   lp_build_if(&ifthen, gallivm, cond);
+   ptr = LLVMBuildGEP(builder, base_ptr, &index, 1, "");
+   lane_value = LLVMBuildExtractElement(builder, value, lane, "");
+   if (cmp_value) {
+#if HAVE_LLVM >= 0x0307
+      LLVMValueRef lane_cmp = LLVMBuildExtractElement(builder, cmp_value,
+                                                      lane, "");
+      old = LLVMBuildAtomicCmpXchg(builder, ptr, lane_cmp, lane_value,
+                                   LLVMAtomicOrderingSequentiallyConsistent,
+                                   LLVMAtomicOrderingSequentiallyConsistent,
+                                   FALSE);
+      old = LLVMBuildExtractValue(builder, old, 0, "");
+#else
+      assert(0);
+      old = lp_build_const_int32(gallivm, 0);
+#endif
+   }
+   else {
+      old = LLVMBuildAtomicRMW(builder, op, ptr, lane_value,
+                               LLVMAtomicOrderingSequentiallyConsistent,
+                               FALSE);
+   }
+   result = LLVMBuildLoad(builder, result_ptr, "");
+   result = LLVMBuildInsertElement(builder, result, old, lane, "");
+   LLVMBuildStore(builder, result, result_ptr);
+   lp_build_endif(&ifthen);
+
+   lp_build_loop_end_cond(&loop,
+                          lp_build_const_int32(gallivm, uint_bld->type.length),
+                          NULL, LLVMIntUGE);
+
+   result = LLVMBuildLoad(builder, result_ptr, "");
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = result;
+   }
+}
+
+/**
+ * Query the size in bytes of a shader buffer.
+ */
+static void
+resq_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef base_ptr, size;
+   unsigned chan;
+
+   get_mem_base(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                &base_ptr, &size);
+   size = lp_build_broadcast_scalar(&bld_base->uint_bld, size);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = size;
+   }
+}
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+
+   if (bld->cs_iface && bld->cs_iface->emit_barrier)
+      bld->cs_iface->emit_barrier(bld->cs_iface, bld_base);
+}
+
+static void
+membar_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+#if HAVE_LLVM >= 0x0307
+   LLVMBuildFence(bld_base->base.gallivm->builder,
+                  LLVMAtomicOrderingSequentiallyConsistent, FALSE, "");
+#endif
 }
 
 static void
@@ -3831,6 +4202,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   struct lp_build_mask_context *mask,
                   LLVMValueRef consts_ptr,
                   LLVMValueRef const_sizes_ptr,
+                  LLVMValueRef ssbo_ptr,
+                  LLVMValueRef ssbo_sizes_ptr,
                   const struct lp_bld_tgsi_system_values *system_values,
                   const LLVMValueRef (*inputs)[TGSI_NUM_CHANNELS],
                   LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
@@ -3838,7 +4211,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   const struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3879,6 +4253,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
    bld.outputs = outputs;
    bld.consts_ptr = consts_ptr;
    bld.const_sizes_ptr = const_sizes_ptr;
+   bld.ssbo_ptr = ssbo_ptr;
+   bld.ssbo_sizes_ptr = ssbo_sizes_ptr;
    bld.sampler = sampler;
    bld.bld_base.info = info;
    bld.indirect_files = info->indirect_files;
@@ -3967,6 +4343,22 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
    bld.bld_base.op_actions[TGSI_OPCODE_GATHER4].emit = gather4_emit;
    bld.bld_base.op_actions[TGSI_OPCODE_SVIEWINFO].emit = sviewinfo_emit;
    bld.bld_base.op_actions[TGSI_OPCODE_LOD].emit = lod_emit;
+   /* shader buffer and shared memory ops */
+   bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_RESQ].emit = resq_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMUADD].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMXCHG].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMCAS].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMAND].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMOR].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMXOR].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMIN].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMAX].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMIN].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMAX].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_MEMBAR].emit = membar_emit;
 
 
    if (gs_iface) {
@@ -3994,6 +4386,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   bld.cs_iface = cs_iface;
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
    bld.system_values = *system_values;
@@ -639,6 +639,21 @@ hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
    struct hud_pane *pane;
    struct hud_graph *gr, *next;
 
+   /* headless: only query the results, there is nothing to draw */
+   if (hud->headless) {
+      hud_batch_query_update(hud->batch_query, pipe);
+
+      LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head) {
+         LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+            gr->query_new_value(gr, pipe);
+         }
+      }
+
+      if (hud->stream)
+         hud_stream_end_sample(hud->stream);
+      return;
+   }
+
    /* prepare vertex buffers */
    hud_prepare_vertices(hud, &hud->bg, 16 * 256, 2 * sizeof(float));
    hud_prepare_vertices(hud, &hud->whitelines, 4 * 256, 2 * sizeof(float));
@@ -708,6 +723,9 @@ hud_stop_queries(struct hud_context *hud, struct pipe_context *pipe)
          hud_pane_accumulate_vertices(hud, pane);
    }
 
+   if (hud->stream)
+      hud_stream_end_sample(hud->stream);
+
    /* unmap the uploader's vertex buffer before drawing */
    u_upload_unmap(pipe->stream_uploader);
 }
@@ -746,8 +764,11 @@ hud_record_only(struct hud_context *hud, struct pipe_context *pipe)
 {
    assert(pipe);
 
-   /* If it's a drawing context, only hud_run() records query results. */
-   if (pipe == hud->pipe || pipe != hud->record_pipe)
+   /* If it's a drawing context, only hud_run() records query results.
+    * A headless HUD has no drawing context and records in hud_run() too,
+    * once per frame.
+    */
+   if (pipe == hud->pipe || hud->headless || pipe != hud->record_pipe)
       return;
 
    hud_stop_queries(hud, hud->record_pipe);
@@ -955,6 +976,10 @@ void
 hud_graph_add_value(struct hud_graph *gr, double value)
 {
    gr->current_value = value;
+
+   if (gr->pane->hud->stream)
+      hud_stream_set_value(gr->pane->hud->stream, gr->stream_column, value);
+
    value = value > gr->pane->ceiling ? gr->pane->ceiling : value;
 
    if (gr->fd) {
@@ -1030,6 +1055,55 @@ access(const char *pathname, int mode)
 #endif
 
 
+/**
+ * If the GALLIUM_HUD_STREAM env var is set, the values of all the graphs
+ * are written to the given file, or to the UNIX socket "unix:<path>", one
+ * line per period.  GALLIUM_HUD_STREAM_FORMAT selects JSON lines (default)
+ * or CSV.
+ */
+static void
+hud_set_stream(struct hud_context *hud)
+{
+   const char *path = debug_get_option("GALLIUM_HUD_STREAM", NULL);
+   const char *format_env = debug_get_option("GALLIUM_HUD_STREAM_FORMAT",
+                                             "json");
+   enum hud_stream_format format = HUD_STREAM_FORMAT_JSON;
+   struct hud_pane *pane;
+   struct hud_graph *gr;
+   const char **names;
+   unsigned num = 0;
+
+   if (!path || !*path)
+      return;
+
+   if (strcmp(format_env, "csv") == 0)
+      format = HUD_STREAM_FORMAT_CSV;
+   else if (strcmp(format_env, "json") != 0)
+      fprintf(stderr, "gallium_hud: unknown stream format '%s', "
+              "using json\n", format_env);
+
+   LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head) {
+      num += pane->num_graphs;
+   }
+   if (!num)
+      return;
+
+   names = MALLOC(num * sizeof(*names));
+   if (!names)
+      return;
+
+   num = 0;
+   LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head) {
+      LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+         gr->stream_column = num;
+         names[num++] = gr->name;
+      }
+   }
+
+   hud->stream = hud_stream_create(path, format, names, num);
+   FREE(names);
+}
+
 /**
  * If the GALLIUM_HUD_DUMP_DIR env var is set, we'll write the raw
  * HUD values to files at ${GALLIUM_HUD_DUMP_DIR}/<stat> where <stat>
@@ -1177,6 +1251,13 @@ has_pipeline_stats_query(struct pipe_screen *screen)
    return screen->get_param(screen, PIPE_CAP_QUERY_PIPELINE_STATISTICS) != 0;
 }
 
+static boolean
+has_timestamp_query(struct pipe_screen *screen)
+{
+   return screen->get_param(screen, PIPE_CAP_QUERY_TIMESTAMP) != 0 &&
+          screen->get_timestamp;
+}
+
 static void
 hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
                   const char *env)
@@ -1242,9 +1323,7 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
       }
 
       /* Add a graph. */
-#if defined(HAVE_GALLIUM_EXTRA_HUD) || defined(HAVE_LIBSENSORS)
       char arg_name[64];
-#endif
       /* IF YOU CHANGE THIS, UPDATE print_help! */
       if (strcmp(name, "fps") == 0) {
          hud_fps_graph_install(pane);
@@ -1252,6 +1331,19 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
       else if (strcmp(name, "frametime") == 0) {
          hud_frametime_graph_install(pane);
       }
+      else if (strcmp(name, "gpu-frametime") == 0 &&
+               has_timestamp_query(screen)) {
+         hud_frame_timing_graph_install(pane, HUD_FRAME_TIMING_GPU_FRAMETIME);
+      }
+      else if (strcmp(name, "gpu-start-latency") == 0 &&
+               has_timestamp_query(screen)) {
+         hud_frame_timing_graph_install(pane, HUD_FRAME_TIMING_START_LATENCY);
+      }
+      else if (strcmp(name, "present-latency") == 0 &&
+               has_timestamp_query(screen)) {
+         hud_frame_timing_graph_install(pane,
+                                        HUD_FRAME_TIMING_PRESENT_LATENCY);
+      }
       else if (strcmp(name, "cpu") == 0) {
          hud_cpu_graph_install(pane, ALL_CPUS);
       }
@@ -1270,9 +1362,18 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
       else if (strcmp(name, "API-thread-num-syncs") == 0) {
          hud_thread_counter_install(pane, name, HUD_COUNTER_SYNCS);
       }
+      else if (strcmp(name, "API-thread-num-batches") == 0) {
+         hud_thread_counter_install(pane, name, HUD_COUNTER_BATCHES);
+      }
+      else if (strcmp(name, "API-thread-num-repins") == 0) {
+         hud_thread_counter_install(pane, name, HUD_COUNTER_REPINS);
+      }
       else if (strcmp(name, "main-thread-busy") == 0) {
          hud_thread_busy_install(pane, name, true);
       }
+      else if (sscanf(name, "ring-%s", arg_name) == 1) {
+         hud_metric_ring_graph_install(pane, arg_name);
+      }
 #ifdef HAVE_GALLIUM_EXTRA_HUD
       else if (sscanf(name, "nic-rx-%s", arg_name) == 1) {
          hud_nic_graph_install(pane, arg_name, NIC_DIRECTION_RX);
@@ -1508,6 +1609,8 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
          hud_graph_set_dump_file(gr);
       }
    }
+
+   hud_set_stream(hud);
 }
 
 static void
@@ -1558,12 +1661,26 @@ print_help(struct pipe_screen *screen)
    puts("  You can change behavior of the whole HUD by adding these options at");
    puts("  the beginning of the environment variable:");
    puts("  'simple,' disables all the fancy stuff and only draws text.");
+   puts("  'headless,' draws nothing and only records the values, for");
+   puts("             GALLIUM_HUD_STREAM or GALLIUM_HUD_DUMP_DIR.");
+   puts("");
+   puts("  GALLIUM_HUD_STREAM=file or unix:socket-path writes the values of");
+   puts("  all graphs there each period, from a separate thread, as JSON lines");
+   puts("  or, with GALLIUM_HUD_STREAM_FORMAT=csv, as CSV.");
+   puts("");
+   puts("  GALLIUM_HUD_METRIC_RING=path makes the metrics written to that ring");
+   puts("  by another process available as ring-<name>.");
    puts("");
    puts("  Example: GALLIUM_HUD=\".w256.h64.x1600.y520.d.c1000fps+cpu,.datom-count\"");
    puts("");
    puts("  Available names:");
    puts("    fps");
    puts("    frametime");
+   if (has_timestamp_query(screen)) {
+      puts("    gpu-frametime");
+      puts("    gpu-start-latency");
+      puts("    present-latency");
+   }
    puts("    cpu");
 
    for (i = 0; i < num_cpus; i++)
@@ -1588,6 +1705,8 @@ print_help(struct pipe_screen *screen)
       puts("    cs-invocations");
    }
 
+   hud_metric_ring_print_names();
+
 #ifdef HAVE_GALLIUM_EXTRA_HUD
    hud_get_num_disks(1);
    hud_get_num_nics(1);
@@ -1761,6 +1880,11 @@ hud_unset_record_context(struct hud_context *hud)
 
    hud_batch_query_cleanup(&hud->batch_query, pipe);
    hud->record_pipe = NULL;
+
+   if (hud->stream) {
+      hud_stream_destroy(hud->stream);
+      hud->stream = NULL;
+   }
 }
 
 static void
@@ -1801,7 +1925,7 @@ hud_create(struct cso_context *cso, struct hud_context *share)
          hud_set_record_context(share, cso_get_pipe_context(cso));
       }
 
-      if (context_id == draw_ctx) {
+      if (context_id == draw_ctx && !share->headless) {
          assert(!share->pipe);
          hud_set_draw_context(share, cso);
       }
@@ -1832,8 +1956,14 @@ hud_create(struct cso_context *cso, struct hud_context *share)
    if (!hud)
       return NULL;
 
+   if (util_strncmp(env, "headless,", 9) == 0) {
+      hud->headless = true;
+      env += 9;
+   }
+
    /* font (the context is only used for the texture upload) */
-   if (!util_font_create(cso_get_pipe_context(cso),
+   if (!hud->headless &&
+       !util_font_create(cso_get_pipe_context(cso),
                          UTIL_FONT_FIXED_8X13, &hud->font)) {
       FREE(hud);
       return NULL;
@@ -1905,7 +2035,7 @@ hud_create(struct cso_context *cso, struct hud_context *share)
 
    if (record_ctx == 0)
       hud_set_record_context(hud, cso_get_pipe_context(cso));
-   if (draw_ctx == 0)
+   if (draw_ctx == 0 && !hud->headless)
       hud_set_draw_context(hud, cso);
 
    hud_parse_env_var(hud, screen, env);
@@ -1926,6 +2056,8 @@ hud_destroy(struct hud_context *hud, struct cso_context *cso)
       hud_unset_draw_context(hud);
 
    if (p_atomic_dec_zero(&hud->refcount)) {
+      if (hud->stream)
+         hud_stream_destroy(hud->stream);
       pipe_resource_reference(&hud->font.texture, NULL);
       FREE(hud);
    }
@@ -374,6 +374,10 @@ static unsigned get_counter(struct hud_graph *gr, enum hud_counter counter)
       return mon->num_direct_items;
    case HUD_COUNTER_SYNCS:
       return mon->num_syncs;
+   case HUD_COUNTER_BATCHES:
+      return mon->num_batches;
+   case HUD_COUNTER_REPINS:
+      return mon->num_repins;
    default:
       assert(0);
       return 0;
@@ -25,10 +25,12 @@
  *
  **************************************************************************/
 
-/* This file contains code for calculating framerate for displaying on the HUD.
+/* This file contains code for calculating framerate for displaying on the HUD,
+ * and the GPU frame timing based on timestamp queries.
  */
 
 #include "hud/hud_private.h"
+#include "pipe/p_screen.h"
 #include "util/os_time.h"
 #include "util/u_memory.h"
 
@@ -122,3 +124,182 @@ hud_frametime_graph_install(struct hud_pane *pane)
 
    hud_pane_add_graph(pane, gr);
 }
+
+
+/* Frames whose timestamps haven't been read back yet. */
+#define NUM_TIMED_FRAMES 8
+
+struct frame_timing_info {
+   enum hud_frame_timing timing;
+
+   struct {
+      struct pipe_query *start, *end; /* GPU timestamps */
+      uint64_t cpu_start, cpu_end;    /* screen->get_timestamp() */
+   } frames[NUM_TIMED_FRAMES];
+   unsigned head, tail;               /* frames[tail..head-1] are pending */
+   boolean recording;                 /* frames[head] */
+
+   double results_cumulative;         /* in nanoseconds */
+   unsigned num_results;
+   uint64_t last_time;
+};
+
+static void
+begin_frame_timing(struct hud_graph *gr, struct pipe_context *pipe)
+{
+   struct frame_timing_info *info = gr->query_data;
+   unsigned index = info->head % NUM_TIMED_FRAMES;
+
+   /* If all the frames are still pending, this one isn't timed. */
+   if (info->head - info->tail == NUM_TIMED_FRAMES)
+      return;
+
+   if (!info->frames[index].start) {
+      info->frames[index].start =
+         pipe->create_query(pipe, PIPE_QUERY_TIMESTAMP, 0);
+      info->frames[index].end =
+         pipe->create_query(pipe, PIPE_QUERY_TIMESTAMP, 0);
+      if (!info->frames[index].start || !info->frames[index].end)
+         return;
+   }
+
+   info->frames[index].cpu_start = pipe->screen->get_timestamp(pipe->screen);
+   pipe->end_query(pipe, info->frames[index].start);
+   info->recording = TRUE;
+}
+
+static double
+frame_timing_value(enum hud_frame_timing timing, uint64_t gpu_start,
+                   uint64_t gpu_end, uint64_t cpu_start, uint64_t cpu_end)
+{
+   int64_t value;
+
+   switch (timing) {
+   default:
+   case HUD_FRAME_TIMING_GPU_FRAMETIME:
+      value = gpu_end - gpu_start;
+      break;
+   case HUD_FRAME_TIMING_START_LATENCY:
+      value = gpu_start - cpu_start;
+      break;
+   case HUD_FRAME_TIMING_PRESENT_LATENCY:
+      value = gpu_end - cpu_end;
+      break;
+   }
+
+   /* The GPU may be a bit ahead if the clocks drift. */
+   return MAX2(value, 0);
+}
+
+static void
+query_frame_timing(struct hud_graph *gr, struct pipe_context *pipe)
+{
+   struct frame_timing_info *info = gr->query_data;
+   uint64_t now = os_time_get();
+
+   if (info->recording) {
+      unsigned index = info->head % NUM_TIMED_FRAMES;
+
+      info->frames[index].cpu_end = pipe->screen->get_timestamp(pipe->screen);
+      pipe->end_query(pipe, info->frames[index].end);
+      info->recording = FALSE;
+      info->head++;
+   }
+
+   /* read the timestamps of finished frames */
+   while (info->tail != info->head) {
+      unsigned index = info->tail % NUM_TIMED_FRAMES;
+      union pipe_query_result start, end;
+
+      if (!pipe->get_query_result(pipe, info->frames[index].start, FALSE,
+                                  &start) ||
+          !pipe->get_query_result(pipe, info->frames[index].end, FALSE,
+                                  &end))
+         break;
+
+      info->results_cumulative +=
+         frame_timing_value(info->timing, start.u64, end.u64,
+                            info->frames[index].cpu_start,
+                            info->frames[index].cpu_end);
+      info->num_results++;
+      info->tail++;
+   }
+
+   if (!info->last_time) {
+      info->last_time = now;
+      return;
+   }
+
+   if (info->num_results && info->last_time + gr->pane->period <= now) {
+      /* in milliseconds, like frametime */
+      hud_graph_add_value(gr, info->results_cumulative / info->num_results /
+                              1000000.0);
+
+      info->last_time = now;
+      info->results_cumulative = 0;
+      info->num_results = 0;
+   }
+}
+
+static void
+free_frame_timing_info(void *p, struct pipe_context *pipe)
+{
+   struct frame_timing_info *info = p;
+   unsigned i;
+
+   for (i = 0; i < NUM_TIMED_FRAMES; i++) {
+      if (info->frames[i].start)
+         pipe->destroy_query(pipe, info->frames[i].start);
+      if (info->frames[i].end)
+         pipe->destroy_query(pipe, info->frames[i].end);
+   }
+   FREE(info);
+}
+
+/**
+ * Graph the GPU side of frames, from timestamp queries at the beginning and
+ * the end of each frame, i.e. at the previous and the current swap.
+ *
+ * HUD_FRAME_TIMING_GPU_FRAMETIME: from the GPU starting the frame to the GPU
+ *    finishing it.
+ * HUD_FRAME_TIMING_START_LATENCY: from the CPU submitting the start of the
+ *    frame to the GPU starting it.
+ * HUD_FRAME_TIMING_PRESENT_LATENCY: from the CPU presenting the frame to the
+ *    GPU finishing it.
+ */
+void
+hud_frame_timing_graph_install(struct hud_pane *pane,
+                               enum hud_frame_timing timing)
+{
+   struct hud_graph *gr = CALLOC_STRUCT(hud_graph);
+   struct frame_timing_info *info;
+
+   if (!gr)
+      return;
+
+   switch (timing) {
+   case HUD_FRAME_TIMING_GPU_FRAMETIME:
+      strcpy(gr->name, "gpu-frametime (ms)");
+      break;
+   case HUD_FRAME_TIMING_START_LATENCY:
+      strcpy(gr->name, "gpu-start-latency (ms)");
+      break;
+   case HUD_FRAME_TIMING_PRESENT_LATENCY:
+      strcpy(gr->name, "present-latency (ms)");
+      break;
+   }
+
+   gr->query_data = CALLOC_STRUCT(frame_timing_info);
+   if (!gr->query_data) {
+      FREE(gr);
+      return;
+   }
+   info = gr->query_data;
+   info->timing = timing;
+
+   gr->begin_query = begin_frame_timing;
+   gr->query_new_value = query_frame_timing;
+   gr->free_query_data = free_frame_timing_info;
+
+   hud_pane_add_graph(pane, gr);
+}
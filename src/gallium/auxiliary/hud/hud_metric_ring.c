@@ -0,0 +1,137 @@
+/**************************************************************************
+ *
+ * Copyright 2019 Intel Corporation
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/* Graphs of the metrics written by another component, possibly in another
+ * process, to the u_metric_ring at GALLIUM_HUD_METRIC_RING, for example
+ * the OA metrics sampled by i965 with INTEL_PERF_SAMPLE_RING.
+ */
+
+#include "hud/hud_private.h"
+#include "os/os_thread.h"
+#include "util/os_time.h"
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+#include "util/u_metric_ring.h"
+
+#include <stdio.h>
+
+struct metric_ring_info {
+   int column;
+   uint64_t last_time;
+};
+
+static struct u_metric_ring *gring;
+static mtx_t gring_mutex = _MTX_INITIALIZER_NP;
+
+static struct u_metric_ring *
+get_ring(void)
+{
+   mtx_lock(&gring_mutex);
+   if (!gring) {
+      const char *path = debug_get_option("GALLIUM_HUD_METRIC_RING", NULL);
+      if (path)
+         gring = u_metric_ring_open(path);
+   }
+   mtx_unlock(&gring_mutex);
+
+   return gring;
+}
+
+static void
+query_metric_ring(struct hud_graph *gr, struct pipe_context *pipe)
+{
+   struct metric_ring_info *info = gr->query_data;
+   uint64_t now = os_time_get();
+
+   if (info->last_time + gr->pane->period > now)
+      return;
+
+   struct u_metric_ring_sample sample;
+   if (u_metric_ring_read_latest(gring, &sample))
+      hud_graph_add_value(gr, sample.values[info->column]);
+
+   info->last_time = now;
+}
+
+static void
+free_metric_ring_info(void *ptr, struct pipe_context *pipe)
+{
+   FREE(ptr);
+}
+
+/**
+  * Create a graph of the column \p name of the metric ring.
+  */
+void
+hud_metric_ring_graph_install(struct hud_pane *pane, const char *name)
+{
+   struct u_metric_ring *ring = get_ring();
+   if (!ring) {
+      fprintf(stderr, "gallium_hud: no metric ring, "
+              "set GALLIUM_HUD_METRIC_RING to the ring path\n");
+      return;
+   }
+
+   int column = u_metric_ring_find_column(ring, name);
+   if (column < 0) {
+      fprintf(stderr, "gallium_hud: no metric '%s' in the metric ring\n",
+              name);
+      return;
+   }
+
+   struct hud_graph *gr = CALLOC_STRUCT(hud_graph);
+   struct metric_ring_info *info = CALLOC_STRUCT(metric_ring_info);
+   if (!gr || !info) {
+      FREE(gr);
+      FREE(info);
+      return;
+   }
+
+   info->column = column;
+
+   snprintf(gr->name, sizeof(gr->name), "%s", name);
+   gr->query_data = info;
+   gr->query_new_value = query_metric_ring;
+   gr->free_query_data = free_metric_ring_info;
+
+   hud_pane_add_graph(pane, gr);
+}
+
+/**
+  * Print the names of the columns of the metric ring, if there is one.
+  */
+void
+hud_metric_ring_print_names(void)
+{
+   struct u_metric_ring *ring = get_ring();
+   if (!ring)
+      return;
+
+   for (unsigned i = 0; i < ring->header->num_columns; i++)
+      printf("    ring-%s\n", ring->header->names[i]);
+}
@@ -33,15 +33,27 @@
 #include "util/list.h"
 #include "hud/font.h"
 
+enum hud_frame_timing {
+   HUD_FRAME_TIMING_GPU_FRAMETIME,
+   HUD_FRAME_TIMING_START_LATENCY,
+   HUD_FRAME_TIMING_PRESENT_LATENCY,
+};
+
 enum hud_counter {
    HUD_COUNTER_OFFLOADED,
    HUD_COUNTER_DIRECT,
    HUD_COUNTER_SYNCS,
+   HUD_COUNTER_BATCHES,
+   HUD_COUNTER_REPINS,
 };
 
 struct hud_context {
    int refcount;
    bool simple;
+   bool headless; /* only record, nothing is drawn */
+
+   /* values written by a background thread, see hud_stream.c */
+   struct hud_stream *stream;
 
    /* Context where queries are executed. */
    struct pipe_context *record_pipe;
@@ -114,6 +126,7 @@ struct hud_graph {
    unsigned index; /* vertex index being updated */
    double current_value;
    FILE *fd;
+   unsigned stream_column;
 };
 
 struct hud_pane {
@@ -149,6 +162,22 @@ void hud_pane_add_graph(struct hud_pane *pane, struct hud_graph *gr);
 void hud_pane_set_max_value(struct hud_pane *pane, uint64_t value);
 void hud_graph_add_value(struct hud_graph *gr, double value);
 
+/* streaming output */
+enum hud_stream_format {
+   HUD_STREAM_FORMAT_JSON,
+   HUD_STREAM_FORMAT_CSV,
+};
+
+struct hud_stream;
+
+struct hud_stream *hud_stream_create(const char *path,
+                                     enum hud_stream_format format,
+                                     const char **names, unsigned num_columns);
+void hud_stream_destroy(struct hud_stream *stream);
+void hud_stream_set_value(struct hud_stream *stream, unsigned column,
+                          double value);
+void hud_stream_end_sample(struct hud_stream *stream);
+
 /* graphs/queries */
 struct hud_batch_query_context;
 
@@ -158,6 +187,8 @@ int hud_get_num_cpus(void);
 
 void hud_fps_graph_install(struct hud_pane *pane);
 void hud_frametime_graph_install(struct hud_pane *pane);
+void hud_frame_timing_graph_install(struct hud_pane *pane,
+                                    enum hud_frame_timing timing);
 void hud_cpu_graph_install(struct hud_pane *pane, unsigned cpu_index);
 void hud_thread_busy_install(struct hud_pane *pane, const char *name, bool main);
 void hud_thread_counter_install(struct hud_pane *pane, const char *name,
@@ -181,6 +212,9 @@ void hud_batch_query_update(struct hud_batch_query_context *bq,
 void hud_batch_query_cleanup(struct hud_batch_query_context **pbq,
                              struct pipe_context *pipe);
 
+void hud_metric_ring_graph_install(struct hud_pane *pane, const char *name);
+void hud_metric_ring_print_names(void);
+
 #ifdef HAVE_GALLIUM_EXTRA_HUD
 int hud_get_num_nics(bool displayhelp);
 #define NIC_DIRECTION_RX 1
@@ -0,0 +1,320 @@
+/**************************************************************************
+ *
+ * Copyright 2013 Marek Olšák <maraeo@gmail.com>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* Streaming of the HUD values to a file or a socket.
+ *
+ * The thread recording the queries only copies each sample, i.e. the values
+ * of all the graphs at the end of a period, to a ring buffer.  A writer
+ * thread formats the samples as JSON lines or CSV rows and writes them out,
+ * so that slow I/O never stalls rendering.  If the writer can't keep up,
+ * samples are dropped and the number of dropped samples is reported in the
+ * next one.
+ */
+
+#include "hud/hud_private.h"
+#include "util/os_time.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/u_thread.h"
+
+#include <float.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef PIPE_OS_UNIX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define HUD_STREAM_NUM_SAMPLES 256
+
+struct hud_stream {
+   FILE *file;
+   enum hud_stream_format format;
+
+   unsigned num_columns;
+   char **names;
+
+   /* Sample being recorded, values are NAN until set. */
+   double *current;
+   bool current_valid;
+
+   /* Ring buffer of samples: a timestamp, a dropped count and the values. */
+   mtx_t mutex;
+   cnd_t cond;
+   double *samples;
+   unsigned head, tail;
+   unsigned dropped;
+   bool quit;
+
+   thrd_t thread;
+};
+
+
+static unsigned
+sample_size(const struct hud_stream *stream)
+{
+   return stream->num_columns + 2;
+}
+
+static void
+write_number(FILE *file, double value)
+{
+   if (fabs(value - lround(value)) > FLT_EPSILON)
+      fprintf(file, "%f", value);
+   else
+      fprintf(file, "%" PRIu64, (uint64_t) lround(value));
+}
+
+static void
+write_sample(struct hud_stream *stream, const double *sample)
+{
+   FILE *file = stream->file;
+   unsigned i;
+
+   if (stream->format == HUD_STREAM_FORMAT_CSV) {
+      fprintf(file, "%" PRIu64 ",%u", (uint64_t) sample[0],
+              (unsigned) sample[1]);
+      for (i = 0; i < stream->num_columns; i++) {
+         fputc(',', file);
+         if (!isnan(sample[i + 2]))
+            write_number(file, sample[i + 2]);
+      }
+   } else {
+      fprintf(file, "{\"time_us\":%" PRIu64, (uint64_t) sample[0]);
+      if (sample[1])
+         fprintf(file, ",\"dropped\":%u", (unsigned) sample[1]);
+      for (i = 0; i < stream->num_columns; i++) {
+         if (isnan(sample[i + 2]))
+            continue;
+         fprintf(file, ",\"%s\":", stream->names[i]);
+         write_number(file, sample[i + 2]);
+      }
+      fputc('}', file);
+   }
+   fputc('\n', file);
+   fflush(file);
+}
+
+static int
+hud_stream_thread(void *data)
+{
+   struct hud_stream *stream = (struct hud_stream *) data;
+   double *sample = MALLOC(sample_size(stream) * sizeof(double));
+   unsigned i;
+
+   u_thread_setname("hud_stream");
+
+   if (!sample)
+      return 0;
+
+   if (stream->format == HUD_STREAM_FORMAT_CSV) {
+      fprintf(stream->file, "time_us,dropped");
+      for (i = 0; i < stream->num_columns; i++)
+         fprintf(stream->file, ",%s", stream->names[i]);
+      fputc('\n', stream->file);
+   }
+
+   mtx_lock(&stream->mutex);
+   while (1) {
+      while (stream->head == stream->tail && !stream->quit)
+         cnd_wait(&stream->cond, &stream->mutex);
+
+      if (stream->head == stream->tail)
+         break; /* quit, all samples written */
+
+      memcpy(sample, stream->samples +
+             (stream->tail % HUD_STREAM_NUM_SAMPLES) * sample_size(stream),
+             sample_size(stream) * sizeof(double));
+      stream->tail++;
+
+      mtx_unlock(&stream->mutex);
+      write_sample(stream, sample);
+      mtx_lock(&stream->mutex);
+   }
+   mtx_unlock(&stream->mutex);
+
+   FREE(sample);
+   return 0;
+}
+
+static FILE *
+open_output(const char *path)
+{
+#ifdef PIPE_OS_UNIX
+   if (util_strncmp(path, "unix:", 5) == 0) {
+      struct sockaddr_un addr;
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      FILE *file;
+
+      if (fd < 0)
+         return NULL;
+
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      strncpy(addr.sun_path, path + 5, sizeof(addr.sun_path) - 1);
+
+      if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+         close(fd);
+         return NULL;
+      }
+
+      file = fdopen(fd, "w");
+      if (!file)
+         close(fd);
+      return file;
+   }
+#endif
+
+   return fopen(path, "w");
+}
+
+/**
+ * Start streaming the values of the given columns to \p path, which is a
+ * file name or "unix:<socket path>".
+ */
+struct hud_stream *
+hud_stream_create(const char *path, enum hud_stream_format format,
+                  const char **names, unsigned num_columns)
+{
+   struct hud_stream *stream = CALLOC_STRUCT(hud_stream);
+   unsigned i;
+
+   if (!stream)
+      return NULL;
+
+   stream->format = format;
+   stream->num_columns = num_columns;
+   stream->names = CALLOC(num_columns, sizeof(char *));
+   stream->current = MALLOC(num_columns * sizeof(double));
+   stream->samples = MALLOC(HUD_STREAM_NUM_SAMPLES * sample_size(stream) *
+                            sizeof(double));
+   if (!stream->names || !stream->current || !stream->samples)
+      goto fail;
+
+   for (i = 0; i < num_columns; i++) {
+      stream->names[i] = strdup(names[i]);
+      if (!stream->names[i])
+         goto fail;
+      stream->current[i] = NAN;
+   }
+
+   stream->file = open_output(path);
+   if (!stream->file) {
+      fprintf(stderr, "gallium_hud: can't open the stream output %s\n", path);
+      goto fail;
+   }
+
+   (void) mtx_init(&stream->mutex, mtx_plain);
+   cnd_init(&stream->cond);
+   stream->thread = u_thread_create(hud_stream_thread, stream);
+   return stream;
+
+fail:
+   if (stream->file)
+      fclose(stream->file);
+   if (stream->names) {
+      for (i = 0; i < num_columns; i++)
+         free(stream->names[i]);
+   }
+   FREE(stream->names);
+   FREE(stream->current);
+   FREE(stream->samples);
+   FREE(stream);
+   return NULL;
+}
+
+/**
+ * Write the remaining samples and stop streaming.
+ */
+void
+hud_stream_destroy(struct hud_stream *stream)
+{
+   unsigned i;
+
+   mtx_lock(&stream->mutex);
+   stream->quit = true;
+   cnd_signal(&stream->cond);
+   mtx_unlock(&stream->mutex);
+
+   thrd_join(stream->thread, NULL);
+
+   mtx_destroy(&stream->mutex);
+   cnd_destroy(&stream->cond);
+   fclose(stream->file);
+
+   for (i = 0; i < stream->num_columns; i++)
+      free(stream->names[i]);
+   FREE(stream->names);
+   FREE(stream->current);
+   FREE(stream->samples);
+   FREE(stream);
+}
+
+void
+hud_stream_set_value(struct hud_stream *stream, unsigned column, double value)
+{
+   assert(column < stream->num_columns);
+   stream->current[column] = value;
+   stream->current_valid = true;
+}
+
+/**
+ * Queue the values set since the last call as one sample.
+ */
+void
+hud_stream_end_sample(struct hud_stream *stream)
+{
+   unsigned i;
+
+   if (!stream->current_valid)
+      return;
+
+   mtx_lock(&stream->mutex);
+   if (stream->head - stream->tail == HUD_STREAM_NUM_SAMPLES) {
+      stream->dropped++;
+   } else {
+      double *sample = stream->samples +
+         (stream->head % HUD_STREAM_NUM_SAMPLES) * sample_size(stream);
+
+      sample[0] = (double) (os_time_get_nano() / 1000);
+      sample[1] = stream->dropped;
+      memcpy(sample + 2, stream->current,
+             stream->num_columns * sizeof(double));
+      stream->head++;
+      stream->dropped = 0;
+      cnd_signal(&stream->cond);
+   }
+   mtx_unlock(&stream->mutex);
+
+   for (i = 0; i < stream->num_columns; i++)
+      stream->current[i] = NAN;
+   stream->current_valid = false;
+}
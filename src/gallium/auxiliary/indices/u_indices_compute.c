@@ -0,0 +1,173 @@
+/*
+ * Copyright 2019 Collabora Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_math.h"
+
+#include "indices/u_indices_compute.h"
+
+static void *
+index_compute_shader(struct pipe_context *pipe)
+{
+   /* Each thread writes one index.  The 1 and 2-byte positions and indices
+    * are extracted from the dword containing them.
+    *
+    * CONST[0][0]: src offset, src index size, count, restart index
+    * CONST[0][1]: src index mask, restart enabled, map index size,
+    *              map index mask
+    */
+   static const char text[] =
+      "COMP\n"
+      "PROPERTY CS_FIXED_BLOCK_WIDTH 64\n"
+      "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+      "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+      "DCL SV[0], THREAD_ID\n"
+      "DCL SV[1], BLOCK_ID\n"
+      "DCL BUFFER[0]\n" /* src */
+      "DCL BUFFER[1]\n" /* map */
+      "DCL BUFFER[2]\n" /* dst */
+      "DCL CONST[0][0..1]\n"
+      "DCL TEMP[0..3], LOCAL\n"
+      "IMM[0] UINT32 {64, 3, 4294967292, 4294967295}\n"
+      "IMM[1] UINT32 {8, 4, 0, 0}\n"
+
+      "UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+      "USLT TEMP[1].x, TEMP[0].xxxx, CONST[0][0].zzzz\n"
+      "UIF TEMP[1].xxxx\n"
+         "MOV TEMP[0].y, TEMP[0].xxxx\n"
+         "UIF CONST[0][1].zzzz\n"
+            "UMUL TEMP[1].x, TEMP[0].xxxx, CONST[0][1].zzzz\n"
+            "AND TEMP[1].y, TEMP[1].xxxx, IMM[0].zzzz\n"
+            "LOAD TEMP[2].x, BUFFER[1], TEMP[1].yyyy\n"
+            "AND TEMP[1].x, TEMP[1].xxxx, IMM[0].yyyy\n"
+            "UMUL TEMP[1].x, TEMP[1].xxxx, IMM[1].xxxx\n"
+            "USHR TEMP[2].x, TEMP[2].xxxx, TEMP[1].xxxx\n"
+            "AND TEMP[0].y, TEMP[2].xxxx, CONST[0][1].wwww\n"
+         "ENDIF\n"
+         "UMAD TEMP[1].x, TEMP[0].yyyy, CONST[0][0].yyyy, CONST[0][0].xxxx\n"
+         "AND TEMP[1].y, TEMP[1].xxxx, IMM[0].zzzz\n"
+         "LOAD TEMP[2].x, BUFFER[0], TEMP[1].yyyy\n"
+         "AND TEMP[1].x, TEMP[1].xxxx, IMM[0].yyyy\n"
+         "UMUL TEMP[1].x, TEMP[1].xxxx, IMM[1].xxxx\n"
+         "USHR TEMP[2].x, TEMP[2].xxxx, TEMP[1].xxxx\n"
+         "AND TEMP[2].x, TEMP[2].xxxx, CONST[0][1].xxxx\n"
+         "USEQ TEMP[3].x, TEMP[2].xxxx, CONST[0][0].wwww\n"
+         "AND TEMP[3].x, TEMP[3].xxxx, CONST[0][1].yyyy\n"
+         "UCMP TEMP[2].x, TEMP[3].xxxx, IMM[0].wwww, TEMP[2].xxxx\n"
+         "UMUL TEMP[1].x, TEMP[0].xxxx, IMM[1].yyyy\n"
+         "STORE BUFFER[2].x, TEMP[1].xxxx, TEMP[2].xxxx\n"
+      "ENDIF\n"
+      "END\n";
+
+   struct tgsi_token tokens[1024];
+   struct pipe_compute_state state = {0};
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      assert(false);
+      return NULL;
+   }
+
+   state.ir_type = PIPE_SHADER_IR_TGSI;
+   state.prog = tokens;
+
+   return pipe->create_compute_state(pipe, &state);
+}
+
+static unsigned
+index_mask(unsigned index_size)
+{
+   return index_size == 4 ? 0xffffffff : (1u << (index_size * 8)) - 1;
+}
+
+boolean
+u_index_compute_supported(struct pipe_screen *screen)
+{
+   return screen->get_param(screen, PIPE_CAP_COMPUTE) &&
+          screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                   PIPE_SHADER_CAP_MAX_SHADER_BUFFERS) >= 3 &&
+          (screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                    PIPE_SHADER_CAP_SUPPORTED_IRS) &
+           (1 << PIPE_SHADER_IR_TGSI));
+}
+
+void
+u_index_translate_compute(struct pipe_context *pipe, void **compute_state,
+                          struct pipe_resource *src, unsigned src_offset,
+                          unsigned src_index_size,
+                          struct pipe_resource *map, unsigned map_index_size,
+                          boolean restart, unsigned restart_index,
+                          struct pipe_resource *dst, unsigned count)
+{
+   if (!count)
+      return;
+
+   if (!*compute_state)
+      *compute_state = index_compute_shader(pipe);
+   if (!*compute_state)
+      return;
+
+   unsigned data[] = {src_offset,
+                      src_index_size,
+                      count,
+                      restart_index,
+                      index_mask(src_index_size),
+                      restart ? 0xffffffff : 0,
+                      map ? map_index_size : 0,
+                      map ? index_mask(map_index_size) : 0};
+
+   struct pipe_constant_buffer cb = {0};
+   cb.buffer_size = sizeof(data);
+   cb.user_buffer = data;
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_COMPUTE, 0, &cb);
+
+   struct pipe_shader_buffer sb[3] = {0};
+   sb[0].buffer = src;
+   sb[0].buffer_size = src->width0;
+   sb[1].buffer = map;
+   sb[1].buffer_size = map ? map->width0 : 0;
+   sb[2].buffer = dst;
+   sb[2].buffer_size = count * 4;
+   pipe->set_shader_buffers(pipe, PIPE_SHADER_COMPUTE, 0, 3, sb, 1 << 2);
+
+   pipe->bind_compute_state(pipe, *compute_state);
+
+   struct pipe_grid_info grid_info = {0};
+   grid_info.block[0] = 64;
+   grid_info.block[1] = 1;
+   grid_info.block[2] = 1;
+   grid_info.grid[0] = DIV_ROUND_UP(count, 64);
+   grid_info.grid[1] = 1;
+   grid_info.grid[2] = 1;
+
+   pipe->launch_grid(pipe, &grid_info);
+
+   pipe->memory_barrier(pipe, PIPE_BARRIER_INDEX_BUFFER);
+
+   pipe->set_shader_buffers(pipe, PIPE_SHADER_COMPUTE, 0, 3, NULL, 0);
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_COMPUTE, 0, NULL);
+   pipe->bind_compute_state(pipe, NULL);
+}
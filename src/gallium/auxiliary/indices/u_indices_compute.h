@@ -0,0 +1,61 @@
+/*
+ * Copyright 2019 Collabora Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef U_INDICES_COMPUTE_H
+#define U_INDICES_COMPUTE_H
+
+#include "pipe/p_compiler.h"
+
+struct pipe_context;
+struct pipe_resource;
+struct pipe_screen;
+
+/**
+ * Translate indices with a compute shader, without mapping the index buffer.
+ *
+ * Writes \p count 32-bit indices to the start of \p dst, the i-th being
+ * the index of \p src at position map[i], or i if \p map is NULL.  \p map
+ * holds positions of \p map_index_size bytes, typically produced by a
+ * u_index_generator function, which makes this apply the same conversion
+ * as the matching u_index_translator function.  If \p restart is set, the
+ * indices equal to \p restart_index are replaced by 0xffffffff.
+ *
+ * This binds a compute shader, cached in \p compute_state, constant buffer
+ * 0 and shader buffers 0 to 2 of PIPE_SHADER_COMPUTE, which are left
+ * unbound.  The caller is responsible for saving and restoring them.
+ */
+void
+u_index_translate_compute(struct pipe_context *pipe, void **compute_state,
+                          struct pipe_resource *src, unsigned src_offset,
+                          unsigned src_index_size,
+                          struct pipe_resource *map, unsigned map_index_size,
+                          boolean restart, unsigned restart_index,
+                          struct pipe_resource *dst, unsigned count);
+
+/**
+ * Whether \p screen can run u_index_translate_compute().
+ */
+boolean
+u_index_compute_supported(struct pipe_screen *screen);
+
+#endif
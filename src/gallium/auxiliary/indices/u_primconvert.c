@@ -38,6 +38,10 @@
  *       return;
  *    }
  *
+ * Drivers supporting compute shaders can also save their compute state with
+ * util_primconvert_save_compute_state() before the draw.  Indices are then
+ * translated on the GPU whenever the translation does not depend on their
+ * values, which saves mapping the index buffer and waiting for the GPU.
  */
 
 #include "pipe/p_state.h"
@@ -47,6 +51,7 @@
 #include "util/u_upload_mgr.h"
 
 #include "indices/u_indices.h"
+#include "indices/u_indices_compute.h"
 #include "indices/u_primconvert.h"
 
 struct primconvert_context
@@ -54,6 +59,28 @@ struct primconvert_context
    struct pipe_context *pipe;
    uint32_t primtypes_mask;
    unsigned api_pv;
+
+   /* Compute state saved by the driver for the next draw, restored after
+    * translating indices on the GPU.
+    */
+   boolean compute_saved;
+   void *saved_cs;
+   struct pipe_constant_buffer saved_cb0;
+   struct pipe_shader_buffer saved_buffers[3];
+   unsigned saved_writable_bitmask;
+
+   void *index_cs;
+
+   /* The positions of the last indices translated on the GPU, which are
+    * the same for every draw of the same primitive and count.
+    */
+   struct {
+      struct pipe_resource *buffer;
+      enum pipe_prim_type prim;
+      unsigned count;
+      unsigned pv;
+      unsigned index_size;
+   } map;
 };
 
 
@@ -68,9 +95,24 @@ util_primconvert_create(struct pipe_context *pipe, uint32_t primtypes_mask)
    return pc;
 }
 
+static void
+release_saved_compute_state(struct primconvert_context *pc)
+{
+   unsigned i;
+
+   pipe_resource_reference(&pc->saved_cb0.buffer, NULL);
+   for (i = 0; i < ARRAY_SIZE(pc->saved_buffers); i++)
+      pipe_resource_reference(&pc->saved_buffers[i].buffer, NULL);
+   pc->compute_saved = FALSE;
+}
+
 void
 util_primconvert_destroy(struct primconvert_context *pc)
 {
+   release_saved_compute_state(pc);
+   pipe_resource_reference(&pc->map.buffer, NULL);
+   if (pc->index_cs)
+      pc->pipe->delete_compute_state(pc->pipe, pc->index_cs);
    FREE(pc);
 }
 
@@ -86,6 +128,164 @@ util_primconvert_save_rasterizer_state(struct primconvert_context *pc,
    pc->api_pv = rast->flatshade_first ? PV_FIRST : PV_LAST;
 }
 
+/**
+ * Save the compute shader, constant buffer 0 and shader buffers 0 to 2 of
+ * PIPE_SHADER_COMPUTE, allowing the next util_primconvert_draw_vbo() to
+ * translate indices on the GPU.  \p buffers may be NULL if none are bound.
+ */
+void
+util_primconvert_save_compute_state(struct primconvert_context *pc,
+                                    void *cs,
+                                    const struct pipe_constant_buffer *cb0,
+                                    const struct pipe_shader_buffer *buffers,
+                                    unsigned writable_bitmask)
+{
+   unsigned i;
+
+   release_saved_compute_state(pc);
+
+   if (!u_index_compute_supported(pc->pipe->screen))
+      return;
+
+   pc->compute_saved = TRUE;
+   pc->saved_cs = cs;
+
+   if (cb0) {
+      pc->saved_cb0 = *cb0;
+      pc->saved_cb0.buffer = NULL;
+      pipe_resource_reference(&pc->saved_cb0.buffer, cb0->buffer);
+   } else {
+      memset(&pc->saved_cb0, 0, sizeof(pc->saved_cb0));
+   }
+
+   for (i = 0; i < ARRAY_SIZE(pc->saved_buffers); i++) {
+      if (buffers) {
+         pc->saved_buffers[i] = buffers[i];
+         pc->saved_buffers[i].buffer = NULL;
+         pipe_resource_reference(&pc->saved_buffers[i].buffer,
+                                 buffers[i].buffer);
+      } else {
+         memset(&pc->saved_buffers[i], 0, sizeof(pc->saved_buffers[i]));
+      }
+   }
+   pc->saved_writable_bitmask = writable_bitmask & 0x7;
+}
+
+static void
+restore_compute_state(struct primconvert_context *pc)
+{
+   struct pipe_context *pipe = pc->pipe;
+
+   pipe->bind_compute_state(pipe, pc->saved_cs);
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_COMPUTE, 0,
+                             pc->saved_cb0.buffer || pc->saved_cb0.user_buffer ?
+                             &pc->saved_cb0 : NULL);
+   pipe->set_shader_buffers(pipe, PIPE_SHADER_COMPUTE, 0,
+                            ARRAY_SIZE(pc->saved_buffers), pc->saved_buffers,
+                            pc->saved_writable_bitmask);
+}
+
+/**
+ * Translate the indices of \p info with a compute shader and draw them.
+ * \return false if the translation depends on the index values.
+ */
+static boolean
+primconvert_draw_vbo_compute(struct primconvert_context *pc,
+                             const struct pipe_draw_info *info)
+{
+   struct pipe_context *pipe = pc->pipe;
+   struct pipe_draw_info new_info;
+   enum pipe_prim_type mode, gen_mode;
+   unsigned index_size, count, gen_count;
+   u_translate_func trans_func;
+   u_generate_func gen_func;
+   enum indices_mode trans_mode, gen;
+
+   if (!info->index_size || info->has_user_indices ||
+       info->primitive_restart)
+      return FALSE;
+
+   trans_mode = u_index_translator(pc->primtypes_mask,
+                                   info->mode, info->index_size, info->count,
+                                   pc->api_pv, pc->api_pv, PR_DISABLE,
+                                   &mode, &index_size, &count, &trans_func);
+   if (trans_mode == U_TRANSLATE_ERROR || !count)
+      return FALSE;
+
+   /* The indices the translator would pick are those at the positions the
+    * generator emits for a non-indexed draw from 0.
+    */
+   gen = u_index_generator(pc->primtypes_mask, info->mode, 0, info->count,
+                           pc->api_pv, pc->api_pv,
+                           &gen_mode, &index_size, &gen_count, &gen_func);
+   if (gen_mode != mode || gen_count != count)
+      return FALSE;
+
+   if (gen != U_GENERATE_LINEAR &&
+       (!pc->map.buffer || pc->map.prim != info->mode ||
+        pc->map.count != info->count || pc->map.pv != pc->api_pv)) {
+      struct pipe_transfer *transfer;
+      void *ptr;
+
+      pipe_resource_reference(&pc->map.buffer, NULL);
+      pc->map.buffer = pipe_buffer_create(pipe->screen,
+                                          PIPE_BIND_SHADER_BUFFER,
+                                          PIPE_USAGE_IMMUTABLE,
+                                          align(count * index_size, 4));
+      if (!pc->map.buffer)
+         return FALSE;
+
+      ptr = pipe_buffer_map(pipe, pc->map.buffer,
+                            PIPE_TRANSFER_WRITE |
+                            PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE, &transfer);
+      if (!ptr) {
+         pipe_resource_reference(&pc->map.buffer, NULL);
+         return FALSE;
+      }
+      gen_func(0, count, ptr);
+      pipe_buffer_unmap(pipe, transfer);
+
+      pc->map.prim = info->mode;
+      pc->map.count = info->count;
+      pc->map.pv = pc->api_pv;
+      pc->map.index_size = index_size;
+   }
+
+   util_draw_init_info(&new_info);
+   new_info.mode = mode;
+   new_info.index_size = 4;
+   new_info.count = count;
+   new_info.min_index = info->min_index;
+   new_info.max_index = info->max_index;
+   new_info.index_bias = info->index_bias;
+   new_info.start_instance = info->start_instance;
+   new_info.instance_count = info->instance_count;
+   new_info.index.resource = pipe_buffer_create(pipe->screen,
+                                                PIPE_BIND_INDEX_BUFFER |
+                                                PIPE_BIND_SHADER_BUFFER,
+                                                PIPE_USAGE_DEFAULT,
+                                                count * 4);
+   if (!new_info.index.resource)
+      return FALSE;
+
+   u_index_translate_compute(pipe, &pc->index_cs, info->index.resource,
+                             info->start * info->index_size, info->index_size,
+                             gen != U_GENERATE_LINEAR ? pc->map.buffer : NULL,
+                             pc->map.index_size, FALSE, 0,
+                             new_info.index.resource, count);
+   restore_compute_state(pc);
+
+   if (!pc->index_cs) {
+      pipe_resource_reference(&new_info.index.resource, NULL);
+      return FALSE;
+   }
+
+   pipe->draw_vbo(pipe, &new_info);
+
+   pipe_resource_reference(&new_info.index.resource, NULL);
+   return TRUE;
+}
+
 void
 util_primconvert_draw_vbo(struct primconvert_context *pc,
                           const struct pipe_draw_info *info)
@@ -98,6 +298,14 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
    void *dst;
    unsigned ib_offset;
 
+   if (pc->compute_saved) {
+      boolean done = primconvert_draw_vbo_compute(pc, info);
+
+      release_saved_compute_state(pc);
+      if (done)
+         return;
+   }
+
    util_draw_init_info(&new_info);
    new_info.min_index = info->min_index;
    new_info.max_index = info->max_index;
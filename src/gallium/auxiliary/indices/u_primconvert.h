@@ -37,6 +37,11 @@ void util_primconvert_destroy(struct primconvert_context *pc);
 void util_primconvert_save_rasterizer_state(struct primconvert_context *pc,
                                             const struct pipe_rasterizer_state
                                             *rast);
+void util_primconvert_save_compute_state(struct primconvert_context *pc,
+                                         void *cs,
+                                         const struct pipe_constant_buffer *cb0,
+                                         const struct pipe_shader_buffer *buffers,
+                                         unsigned writable_bitmask);
 void util_primconvert_draw_vbo(struct primconvert_context *pc,
                                const struct pipe_draw_info *info);
 
@@ -128,35 +128,67 @@ pipe_loader_create_screen(struct pipe_loader_device *dev)
    return dev->ops->create_screen(dev, &config);
 }
 
-struct util_dl_library *
-pipe_loader_find_module(const char *driver_name,
-                        const char *library_paths)
+/**
+ * Get the path of the next candidate module in the colon separated
+ * *library_paths, which is advanced past it and set to NULL after the last
+ * one.  Returns false once all the paths have been tried.
+ */
+static bool
+next_module_path(const char *driver_name, const char **library_paths,
+                 char *path, size_t size)
 {
-   struct util_dl_library *lib;
-   const char *next;
-   char path[PATH_MAX];
-   int len, ret;
+   while (*library_paths) {
+      const char *dir = *library_paths;
+      const char *next = util_strchrnul(dir, ':');
+      int len = next - dir;
+      int ret;
 
-   for (next = library_paths; *next; library_paths = next + 1) {
-      next = util_strchrnul(library_paths, ':');
-      len = next - library_paths;
+      *library_paths = *next ? next + 1 : NULL;
 
       if (len)
-         ret = util_snprintf(path, sizeof(path), "%.*s/%s%s%s",
-                             len, library_paths,
+         ret = util_snprintf(path, size, "%.*s/%s%s%s",
+                             len, dir,
                              MODULE_PREFIX, driver_name, UTIL_DL_EXT);
       else
-         ret = util_snprintf(path, sizeof(path), "%s%s%s",
+         ret = util_snprintf(path, size, "%s%s%s",
                              MODULE_PREFIX, driver_name, UTIL_DL_EXT);
 
-      if (ret > 0 && ret < sizeof(path) && u_file_access(path, 0) != -1) {
-         lib = util_dl_open(path);
-         if (lib) {
-            return lib;
-         }
-         fprintf(stderr, "ERROR: Failed to load pipe driver at `%s': %s\n",
-                         path, util_dl_error());
+      if (ret > 0 && ret < size && u_file_access(path, 0) != -1)
+         return true;
+   }
+
+   return false;
+}
+
+bool
+pipe_loader_has_module(const char *driver_name,
+                       const char *library_paths)
+{
+   char path[PATH_MAX];
+
+   if (!*library_paths)
+      return false;
+
+   return next_module_path(driver_name, &library_paths, path, sizeof(path));
+}
+
+struct util_dl_library *
+pipe_loader_find_module(const char *driver_name,
+                        const char *library_paths)
+{
+   struct util_dl_library *lib;
+   char path[PATH_MAX];
+
+   if (!*library_paths)
+      return NULL;
+
+   while (next_module_path(driver_name, &library_paths, path, sizeof(path))) {
+      lib = util_dl_open(path);
+      if (lib) {
+         return lib;
       }
+      fprintf(stderr, "ERROR: Failed to load pipe driver at `%s': %s\n",
+                      path, util_dl_error());
    }
 
    return NULL;
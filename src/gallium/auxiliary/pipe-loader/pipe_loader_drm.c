@@ -167,6 +167,16 @@ get_driver_descriptor(const char *driver_name, struct util_dl_library **plib)
    return NULL;
 }
 
+static const struct drm_driver_descriptor *
+pipe_loader_drm_get_dd(struct pipe_loader_drm_device *ddev)
+{
+#ifndef GALLIUM_STATIC_TARGETS
+   if (!ddev->dd && !ddev->lib)
+      ddev->dd = get_driver_descriptor(ddev->base.driver_name, &ddev->lib);
+#endif
+   return ddev->dd;
+}
+
 static bool
 pipe_loader_drm_probe_fd_nodup(struct pipe_loader_device **dev, int fd)
 {
@@ -190,22 +200,22 @@ pipe_loader_drm_probe_fd_nodup(struct pipe_loader_device **dev, int fd)
    if (!ddev->base.driver_name)
       goto fail;
 
-   struct util_dl_library **plib = NULL;
-#ifndef GALLIUM_STATIC_TARGETS
-   plib = &ddev->lib;
-#endif
-   ddev->dd = get_driver_descriptor(ddev->base.driver_name, plib);
+#ifdef GALLIUM_STATIC_TARGETS
+   ddev->dd = get_driver_descriptor(ddev->base.driver_name, NULL);
    if (!ddev->dd)
       goto fail;
+#else
+   /* The module is only loaded once the device is actually used, probing
+    * all the devices shouldn't dlopen all their drivers.
+    */
+   if (!pipe_loader_has_module(ddev->base.driver_name, PIPE_SEARCH_DIR))
+      goto fail;
+#endif
 
    *dev = &ddev->base;
    return true;
 
   fail:
-#ifndef GALLIUM_STATIC_TARGETS
-   if (ddev->lib)
-      util_dl_close(ddev->lib);
-#endif
    FREE(ddev->base.driver_name);
    FREE(ddev);
    return false;
@@ -284,12 +294,13 @@ pipe_loader_drm_release(struct pipe_loader_device **dev)
 static const char *
 pipe_loader_drm_get_driconf_xml(struct pipe_loader_device *dev)
 {
-   struct pipe_loader_drm_device *ddev = pipe_loader_drm_device(dev);
+   const struct drm_driver_descriptor *dd =
+      pipe_loader_drm_get_dd(pipe_loader_drm_device(dev));
 
-   if (!ddev->dd->driconf_xml)
+   if (!dd || !dd->driconf_xml)
       return NULL;
 
-   return *ddev->dd->driconf_xml;
+   return *dd->driconf_xml;
 }
 
 static struct pipe_screen *
@@ -297,8 +308,12 @@ pipe_loader_drm_create_screen(struct pipe_loader_device *dev,
                               const struct pipe_screen_config *config)
 {
    struct pipe_loader_drm_device *ddev = pipe_loader_drm_device(dev);
+   const struct drm_driver_descriptor *dd = pipe_loader_drm_get_dd(ddev);
+
+   if (!dd)
+      return NULL;
 
-   return ddev->dd->create_screen(ddev->fd, config);
+   return dd->create_screen(ddev->fd, config);
 }
 
 char *
@@ -46,6 +46,14 @@ struct util_dl_library *
 pipe_loader_find_module(const char *driver_name,
                         const char *library_paths);
 
+/**
+ * Check whether a pipe driver module for the driver can be found, without
+ * loading it.
+ */
+bool
+pipe_loader_has_module(const char *driver_name,
+                       const char *library_paths);
+
 /**
  * Free the base device structure.
  *
@@ -27,10 +27,28 @@
  **************************************************************************/
 
 #include "pb_cache.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/os_time.h"
 
 
+/**
+ * Return the size class of a buffer size.  Classes are ordered by size.
+ */
+static unsigned
+pb_cache_size_class(pb_size size)
+{
+   const unsigned sub_bits = util_logbase2(PB_CACHE_SIZE_CLASSES_PER_POT);
+   unsigned log2;
+
+   if (size < PB_CACHE_SIZE_CLASSES_PER_POT)
+      return size;
+
+   log2 = util_logbase2_64(size);
+   return log2 * PB_CACHE_SIZE_CLASSES_PER_POT +
+          ((size >> (log2 - sub_bits)) & (PB_CACHE_SIZE_CLASSES_PER_POT - 1));
+}
+
 /**
  * Actually destroy the buffer.
  */
@@ -42,10 +60,16 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
 
    assert(!pipe_is_referenced(&buf->reference));
    if (entry->head.next) {
+      struct pb_cache_stats *stats = &mgr->buckets[entry->bucket_index].stats;
+
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       assert(mgr->num_buffers);
       --mgr->num_buffers;
       mgr->cache_size -= buf->size;
+      --stats->num_buffers;
+      stats->cache_size -= buf->size;
+      ++stats->evictions;
    }
    mgr->destroy_buffer(buf);
 }
@@ -54,24 +78,16 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
  * Free as many cache buffers from the list head as possible.
  */
 static void
-release_expired_buffers_locked(struct list_head *cache,
+release_expired_buffers_locked(struct pb_cache_bucket *bucket,
                                int64_t current_time)
 {
-   struct list_head *curr, *next;
-   struct pb_cache_entry *entry;
-
-   curr = cache->next;
-   next = curr->next;
-   while (curr != cache) {
-      entry = LIST_ENTRY(struct pb_cache_entry, curr, head);
+   struct pb_cache_entry *entry, *next;
 
+   LIST_FOR_EACH_ENTRY_SAFE(entry, next, &bucket->lru, lru) {
       if (!os_time_timeout(entry->start, entry->end, current_time))
          break;
 
       destroy_buffer_locked(entry);
-
-      curr = next;
-      next = curr->next;
    }
 }
 
@@ -83,7 +99,7 @@ void
 pb_cache_add_buffer(struct pb_cache_entry *entry)
 {
    struct pb_cache *mgr = entry->mgr;
-   struct list_head *cache = &mgr->buckets[entry->bucket_index];
+   struct pb_cache_bucket *bucket = &mgr->buckets[entry->bucket_index];
    struct pb_buffer *buf = entry->buffer;
    unsigned i;
 
@@ -97,6 +113,7 @@ pb_cache_add_buffer(struct pb_cache_entry *entry)
 
    /* Directly release any buffer that exceeds the limit. */
    if (mgr->cache_size + buf->size > mgr->max_cache_size) {
+      ++bucket->stats.evictions;
       mgr->destroy_buffer(buf);
       mtx_unlock(&mgr->mutex);
       return;
@@ -104,9 +121,12 @@ pb_cache_add_buffer(struct pb_cache_entry *entry)
 
    entry->start = os_time_get();
    entry->end = entry->start + mgr->usecs;
-   LIST_ADDTAIL(&entry->head, cache);
+   LIST_ADDTAIL(&entry->head, &bucket->size_classes[entry->size_class]);
+   LIST_ADDTAIL(&entry->lru, &bucket->lru);
    ++mgr->num_buffers;
    mgr->cache_size += buf->size;
+   ++bucket->stats.num_buffers;
+   bucket->stats.cache_size += buf->size;
    mtx_unlock(&mgr->mutex);
 }
 
@@ -142,64 +162,49 @@ pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
 /**
  * Find a compatible buffer in the cache, return it, and remove it
  * from the cache.
+ *
+ * Only the size classes which can hold compatible buffers are searched,
+ * smallest first.  Within a class, buffers are sorted by age, so the
+ * search of a class stops at the first busy compatible buffer.
  */
 struct pb_buffer *
 pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
                         unsigned alignment, unsigned usage,
                         unsigned bucket_index)
 {
-   struct pb_cache_entry *entry;
-   struct pb_cache_entry *cur_entry;
-   struct list_head *cur, *next;
+   struct pb_cache_entry *entry = NULL;
+   struct pb_cache_entry *cur_entry, *next_entry;
+   unsigned first_class, last_class, c;
    int64_t now;
-   int ret = 0;
 
    assert(bucket_index < mgr->num_heaps);
-   struct list_head *cache = &mgr->buckets[bucket_index];
+   struct pb_cache_bucket *bucket = &mgr->buckets[bucket_index];
 
-   mtx_lock(&mgr->mutex);
+   first_class = pb_cache_size_class(size);
+   last_class = pb_cache_size_class(MAX2((pb_size)(mgr->size_factor * size),
+                                         size));
 
-   entry = NULL;
-   cur = cache->next;
-   next = cur->next;
+   mtx_lock(&mgr->mutex);
 
-   /* search in the expired buffers, freeing them in the process */
    now = os_time_get();
-   while (cur != cache) {
-      cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-
-      if (!entry && (ret = pb_cache_is_buffer_compat(cur_entry, size,
-                                                     alignment, usage)) > 0)
-         entry = cur_entry;
-      else if (os_time_timeout(cur_entry->start, cur_entry->end, now))
-         destroy_buffer_locked(cur_entry);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
-
-      /* the buffer is busy (and probably all remaining ones too) */
-      if (ret == -1)
-         break;
-
-      cur = next;
-      next = cur->next;
-   }
-
-   /* keep searching in the hot buffers */
-   if (!entry && ret != -1) {
-      while (cur != cache) {
-         cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-         ret = pb_cache_is_buffer_compat(cur_entry, size, alignment, usage);
+   for (c = first_class; c <= last_class && !entry; c++) {
+      LIST_FOR_EACH_ENTRY_SAFE(cur_entry, next_entry,
+                               &bucket->size_classes[c], head) {
+         int ret = pb_cache_is_buffer_compat(cur_entry, size, alignment,
+                                             usage);
 
          if (ret > 0) {
             entry = cur_entry;
             break;
          }
+
+         /* the buffer is busy (and probably all remaining ones too) */
          if (ret == -1)
             break;
-         /* no need to check the timeout here */
-         cur = next;
-         next = cur->next;
+
+         /* free the expired buffers in the process */
+         if (os_time_timeout(cur_entry->start, cur_entry->end, now))
+            destroy_buffer_locked(cur_entry);
       }
    }
 
@@ -209,13 +214,18 @@ pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
 
       mgr->cache_size -= buf->size;
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       --mgr->num_buffers;
+      --bucket->stats.num_buffers;
+      bucket->stats.cache_size -= buf->size;
+      ++bucket->stats.hits;
       mtx_unlock(&mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->reference, 1);
       return buf;
    }
 
+   ++bucket->stats.misses;
    mtx_unlock(&mgr->mutex);
    return NULL;
 }
@@ -226,22 +236,13 @@ pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
 void
 pb_cache_release_all_buffers(struct pb_cache *mgr)
 {
-   struct list_head *curr, *next;
-   struct pb_cache_entry *buf;
+   struct pb_cache_entry *buf, *next;
    unsigned i;
 
    mtx_lock(&mgr->mutex);
    for (i = 0; i < mgr->num_heaps; i++) {
-      struct list_head *cache = &mgr->buckets[i];
-
-      curr = cache->next;
-      next = curr->next;
-      while (curr != cache) {
-         buf = LIST_ENTRY(struct pb_cache_entry, curr, head);
+      LIST_FOR_EACH_ENTRY_SAFE(buf, next, &mgr->buckets[i].lru, lru)
          destroy_buffer_locked(buf);
-         curr = next;
-         next = curr->next;
-      }
    }
    mtx_unlock(&mgr->mutex);
 }
@@ -256,6 +257,7 @@ pb_cache_init_entry(struct pb_cache *mgr, struct pb_cache_entry *entry,
    entry->buffer = buf;
    entry->mgr = mgr;
    entry->bucket_index = bucket_index;
+   entry->size_class = pb_cache_size_class(buf->size);
 }
 
 /**
@@ -283,14 +285,17 @@ pb_cache_init(struct pb_cache *mgr, uint num_heaps,
               void (*destroy_buffer)(struct pb_buffer *buf),
               bool (*can_reclaim)(struct pb_buffer *buf))
 {
-   unsigned i;
+   unsigned i, j;
 
-   mgr->buckets = CALLOC(num_heaps, sizeof(struct list_head));
+   mgr->buckets = CALLOC(num_heaps, sizeof(struct pb_cache_bucket));
    if (!mgr->buckets)
       return;
 
-   for (i = 0; i < num_heaps; i++)
-      LIST_INITHEAD(&mgr->buckets[i]);
+   for (i = 0; i < num_heaps; i++) {
+      LIST_INITHEAD(&mgr->buckets[i].lru);
+      for (j = 0; j < PB_CACHE_NUM_SIZE_CLASSES; j++)
+         LIST_INITHEAD(&mgr->buckets[i].size_classes[j]);
+   }
 
    (void) mtx_init(&mgr->mutex, mtx_plain);
    mgr->cache_size = 0;
@@ -315,3 +320,40 @@ pb_cache_deinit(struct pb_cache *mgr)
    FREE(mgr->buckets);
    mgr->buckets = NULL;
 }
+
+/**
+ * Return the counters of one bucket.
+ */
+void
+pb_cache_get_stats(struct pb_cache *mgr, unsigned bucket_index,
+                   struct pb_cache_stats *stats)
+{
+   assert(bucket_index < mgr->num_heaps);
+
+   mtx_lock(&mgr->mutex);
+   *stats = mgr->buckets[bucket_index].stats;
+   mtx_unlock(&mgr->mutex);
+}
+
+/**
+ * Return the counters of all buckets summed up.
+ */
+void
+pb_cache_get_total_stats(struct pb_cache *mgr, struct pb_cache_stats *stats)
+{
+   unsigned i;
+
+   memset(stats, 0, sizeof(*stats));
+
+   mtx_lock(&mgr->mutex);
+   for (i = 0; i < mgr->num_heaps; i++) {
+      const struct pb_cache_stats *bucket = &mgr->buckets[i].stats;
+
+      stats->hits += bucket->hits;
+      stats->misses += bucket->misses;
+      stats->evictions += bucket->evictions;
+      stats->cache_size += bucket->cache_size;
+      stats->num_buffers += bucket->num_buffers;
+   }
+   mtx_unlock(&mgr->mutex);
+}
@@ -38,11 +38,41 @@
  */
 struct pb_cache_entry
 {
-   struct list_head head;
+   struct list_head head; /**< In the list of its size class */
+   struct list_head lru; /**< In the list of all buffers of its bucket */
    struct pb_buffer *buffer; /**< Pointer to the structure this is part of. */
    struct pb_cache *mgr;
    int64_t start, end; /**< Caching time interval */
    unsigned bucket_index;
+   unsigned size_class;
+};
+
+/**
+ * Buffers of each bucket are sorted into size classes, four per power of
+ * two, so that a lookup only walks buffers of nearly the requested size.
+ */
+#define PB_CACHE_SIZE_CLASSES_PER_POT 4
+#define PB_CACHE_NUM_SIZE_CLASSES (64 * PB_CACHE_SIZE_CLASSES_PER_POT)
+
+/**
+ * Counters of one bucket, for tuning the cache parameters.
+ */
+struct pb_cache_stats
+{
+   uint64_t hits; /**< Reclaims returning a cached buffer */
+   uint64_t misses; /**< Reclaims finding no compatible idle buffer */
+   uint64_t evictions; /**< Buffers destroyed instead of being reused */
+   uint64_t cache_size; /**< Total size of the cached buffers */
+   unsigned num_buffers; /**< Number of cached buffers */
+};
+
+struct pb_cache_bucket
+{
+   /* All buffers, oldest first, for releasing the expired ones. */
+   struct list_head lru;
+   /* The same buffers by size class, also oldest first. */
+   struct list_head size_classes[PB_CACHE_NUM_SIZE_CLASSES];
+   struct pb_cache_stats stats;
 };
 
 struct pb_cache
@@ -50,7 +80,7 @@ struct pb_cache
    /* The cache is divided into buckets for minimizing cache misses.
     * The driver controls which buffer goes into which bucket.
     */
-   struct list_head *buckets;
+   struct pb_cache_bucket *buckets;
 
    mtx_t mutex;
    uint64_t cache_size;
@@ -78,5 +108,9 @@ void pb_cache_init(struct pb_cache *mgr, uint num_heaps,
                    void (*destroy_buffer)(struct pb_buffer *buf),
                    bool (*can_reclaim)(struct pb_buffer *buf));
 void pb_cache_deinit(struct pb_cache *mgr);
+void pb_cache_get_stats(struct pb_cache *mgr, unsigned bucket_index,
+                        struct pb_cache_stats *stats);
+void pb_cache_get_total_stats(struct pb_cache *mgr,
+                              struct pb_cache_stats *stats);
 
 #endif
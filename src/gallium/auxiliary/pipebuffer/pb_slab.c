@@ -27,6 +27,7 @@
 
 #include "pb_slab.h"
 
+#include "util/u_atomic.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
@@ -55,7 +56,7 @@ pb_slab_reclaim(struct pb_slabs *slabs, struct pb_slab_entry *entry)
 {
    struct pb_slab *slab = entry->slab;
 
-   LIST_DEL(&entry->head); /* remove from reclaim list */
+   LIST_DEL(&entry->head); /* remove from the reclaim list or a cache */
    LIST_ADD(&entry->head, &slab->free);
    slab->num_free++;
 
@@ -67,6 +68,7 @@ pb_slab_reclaim(struct pb_slabs *slabs, struct pb_slab_entry *entry)
 
    if (slab->num_free >= slab->num_entries) {
       LIST_DEL(&slab->head);
+      slabs->num_slabs--;
       slabs->slab_free(slabs->priv, slab);
    }
 }
@@ -85,6 +87,96 @@ pb_slabs_reclaim_locked(struct pb_slabs *slabs)
    }
 }
 
+/* Number of entries a per-thread cache takes from the slabs at once, and up
+ * to how many bytes of entries it may hold this way, so that big entries
+ * aren't hoarded by threads.
+ */
+#define PB_SLAB_CACHE_BATCH 8
+#define PB_SLAB_CACHE_BATCH_SIZE (64 * 1024)
+
+/* Number of freed entries a per-thread cache collects before it moves them
+ * to the reclaim list.
+ */
+#define PB_SLAB_FREE_BATCH 16
+
+static once_flag pb_slab_thread_once = ONCE_FLAG_INIT;
+static tss_t pb_slab_thread_key;
+static unsigned pb_slab_num_threads;
+
+static void
+pb_slab_thread_key_init(void)
+{
+   (void) tss_create(&pb_slab_thread_key, NULL);
+}
+
+static struct pb_slab_cache *
+pb_slab_get_cache(struct pb_slabs *slabs)
+{
+   uintptr_t index;
+
+   call_once(&pb_slab_thread_once, pb_slab_thread_key_init);
+
+   /* The index is stored plus one, so that 0 means "not assigned yet". */
+   index = (uintptr_t)tss_get(pb_slab_thread_key);
+   if (!index) {
+      index = p_atomic_inc_return(&pb_slab_num_threads);
+      (void) tss_set(pb_slab_thread_key, (void *)index);
+   }
+
+   return &slabs->caches[(index - 1) % PB_SLAB_NUM_CACHES];
+}
+
+/* Move the entries freed by a thread to the reclaim list.
+ *
+ * The caller must hold the mutexes of the cache and of the manager.
+ */
+static void
+pb_slab_cache_flush_freed_locked(struct pb_slabs *slabs,
+                                 struct pb_slab_cache *cache)
+{
+   if (!cache->num_freed)
+      return;
+
+   list_splicetail(&cache->freed, &slabs->reclaim);
+   LIST_INITHEAD(&cache->freed);
+   cache->num_freed = 0;
+}
+
+/* Take a free entry from the group, allocating nothing.
+ *
+ * The caller must hold the mutex of the manager.
+ */
+static struct pb_slab_entry *
+pb_slab_take_locked(struct pb_slabs *slabs, struct pb_slab_group *group)
+{
+   struct pb_slab *slab;
+   struct pb_slab_entry *entry;
+
+   /* If there is no candidate slab at all, or the first slab has no free
+    * entries, try reclaiming entries.
+    */
+   if (LIST_IS_EMPTY(&group->slabs) ||
+       LIST_IS_EMPTY(&LIST_ENTRY(struct pb_slab, group->slabs.next, head)->free))
+      pb_slabs_reclaim_locked(slabs);
+
+   /* Remove slabs without free entries. */
+   while (!LIST_IS_EMPTY(&group->slabs)) {
+      slab = LIST_ENTRY(struct pb_slab, group->slabs.next, head);
+      if (!LIST_IS_EMPTY(&slab->free))
+         break;
+
+      LIST_DEL(&slab->head);
+   }
+
+   if (LIST_IS_EMPTY(&group->slabs))
+      return NULL;
+
+   entry = LIST_ENTRY(struct pb_slab_entry, slab->free.next, head);
+   LIST_DEL(&entry->head);
+   slab->num_free--;
+   return entry;
+}
+
 /* Allocate a slab entry of the given size from the given heap.
  *
  * This will try to re-use entries that have previously been freed. However,
@@ -92,42 +184,48 @@ pb_slabs_reclaim_locked(struct pb_slabs *slabs)
  * determined by the can_reclaim fallback function), a new slab will be
  * requested via the slab_alloc callback.
  *
+ * Most allocations are served by the cache of the calling thread. When it
+ * is empty, a batch of entries is taken from the first slab of the group,
+ * which is also when the entries freed by the thread are moved to the
+ * reclaim list.
+ *
  * Note that slab_free can also be called by this function.
  */
 struct pb_slab_entry *
 pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap)
 {
    unsigned order = MAX2(slabs->min_order, util_logbase2_ceil(size));
-   unsigned group_index;
+   unsigned group_index, batch, i;
+   struct pb_slab_cache *cache;
    struct pb_slab_group *group;
    struct pb_slab *slab;
    struct pb_slab_entry *entry;
+   struct list_head taken;
 
    assert(order < slabs->min_order + slabs->num_orders);
    assert(heap < slabs->num_heaps);
 
    group_index = heap * slabs->num_orders + (order - slabs->min_order);
    group = &slabs->groups[group_index];
+   cache = pb_slab_get_cache(slabs);
+
+   simple_mtx_lock(&cache->mutex);
+   if (!LIST_IS_EMPTY(&cache->entries[group_index])) {
+      entry = LIST_ENTRY(struct pb_slab_entry,
+                         cache->entries[group_index].next, head);
+      LIST_DEL(&entry->head);
+      cache->hits++;
+      simple_mtx_unlock(&cache->mutex);
+      return entry;
+   }
+   cache->misses++;
 
    mtx_lock(&slabs->mutex);
+   pb_slab_cache_flush_freed_locked(slabs, cache);
+   simple_mtx_unlock(&cache->mutex);
 
-   /* If there is no candidate slab at all, or the first slab has no free
-    * entries, try reclaiming entries.
-    */
-   if (LIST_IS_EMPTY(&group->slabs) ||
-       LIST_IS_EMPTY(&LIST_ENTRY(struct pb_slab, group->slabs.next, head)->free))
-      pb_slabs_reclaim_locked(slabs);
-
-   /* Remove slabs without free entries. */
-   while (!LIST_IS_EMPTY(&group->slabs)) {
-      slab = LIST_ENTRY(struct pb_slab, group->slabs.next, head);
-      if (!LIST_IS_EMPTY(&slab->free))
-         break;
-
-      LIST_DEL(&slab->head);
-   }
-
-   if (LIST_IS_EMPTY(&group->slabs)) {
+   entry = pb_slab_take_locked(slabs, group);
+   if (!entry) {
       /* Drop the mutex temporarily to prevent a deadlock where the allocation
        * calls back into slab functions (most likely to happen for
        * pb_slab_reclaim if memory is low).
@@ -142,14 +240,35 @@ pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap)
       mtx_lock(&slabs->mutex);
 
       LIST_ADD(&slab->head, &group->slabs);
+      slabs->num_slabs++;
+
+      entry = LIST_ENTRY(struct pb_slab_entry, slab->free.next, head);
+      LIST_DEL(&entry->head);
+      slab->num_free--;
    }
 
-   entry = LIST_ENTRY(struct pb_slab_entry, slab->free.next, head);
-   LIST_DEL(&entry->head);
-   slab->num_free--;
+   /* Take more entries for the cache, from the same slab for locality. */
+   batch = CLAMP(PB_SLAB_CACHE_BATCH_SIZE >> order, 1, PB_SLAB_CACHE_BATCH);
+   slab = entry->slab;
+   LIST_INITHEAD(&taken);
+
+   for (i = 1; i < batch && !LIST_IS_EMPTY(&slab->free); i++) {
+      struct pb_slab_entry *extra =
+         LIST_ENTRY(struct pb_slab_entry, slab->free.next, head);
+
+      LIST_DEL(&extra->head);
+      LIST_ADDTAIL(&extra->head, &taken);
+      slab->num_free--;
+   }
 
    mtx_unlock(&slabs->mutex);
 
+   if (!LIST_IS_EMPTY(&taken)) {
+      simple_mtx_lock(&cache->mutex);
+      list_splicetail(&taken, &cache->entries[group_index]);
+      simple_mtx_unlock(&cache->mutex);
+   }
+
    return entry;
 }
 
@@ -158,13 +277,50 @@ pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap)
  * The entry may still be in use e.g. by in-flight command submissions. The
  * can_reclaim callback function will be called to determine whether the entry
  * can be handed out again by pb_slab_alloc.
+ *
+ * The entry is only added to the cache of the calling thread, and moved to
+ * the reclaim list with others in a batch.
  */
 void
 pb_slab_free(struct pb_slabs* slabs, struct pb_slab_entry *entry)
 {
-   mtx_lock(&slabs->mutex);
-   LIST_ADDTAIL(&entry->head, &slabs->reclaim);
-   mtx_unlock(&slabs->mutex);
+   struct pb_slab_cache *cache = pb_slab_get_cache(slabs);
+
+   simple_mtx_lock(&cache->mutex);
+   LIST_ADDTAIL(&entry->head, &cache->freed);
+   if (++cache->num_freed >= PB_SLAB_FREE_BATCH) {
+      mtx_lock(&slabs->mutex);
+      pb_slab_cache_flush_freed_locked(slabs, cache);
+      mtx_unlock(&slabs->mutex);
+   }
+   simple_mtx_unlock(&cache->mutex);
+}
+
+/* Return everything the per-thread caches hold: freed entries are moved to
+ * the reclaim list, and entries that were not handed out yet go back to
+ * their slabs.
+ *
+ * The caller must hold the mutex of the manager, and the mutexes of all
+ * caches if any other thread can use the manager.
+ */
+static void
+pb_slabs_flush_caches_locked(struct pb_slabs *slabs)
+{
+   unsigned num_groups = slabs->num_orders * slabs->num_heaps;
+
+   for (unsigned i = 0; i < PB_SLAB_NUM_CACHES; i++) {
+      struct pb_slab_cache *cache = &slabs->caches[i];
+
+      pb_slab_cache_flush_freed_locked(slabs, cache);
+
+      for (unsigned j = 0; j < num_groups; j++) {
+         while (!LIST_IS_EMPTY(&cache->entries[j])) {
+            struct pb_slab_entry *entry =
+               LIST_ENTRY(struct pb_slab_entry, cache->entries[j].next, head);
+            pb_slab_reclaim(slabs, entry);
+         }
+      }
+   }
 }
 
 /* Check if any of the entries handed to pb_slab_free are ready to be re-used.
@@ -172,13 +328,44 @@ pb_slab_free(struct pb_slabs* slabs, struct pb_slab_entry *entry)
  * This may end up freeing some slabs and is therefore useful to try to reclaim
  * some no longer used memory. However, calling this function is not strictly
  * required since pb_slab_alloc will eventually do the same thing.
+ *
+ * This also empties the per-thread caches, so that their entries don't keep
+ * slabs alive.
  */
 void
 pb_slabs_reclaim(struct pb_slabs *slabs)
 {
+   unsigned i;
+
+   for (i = 0; i < PB_SLAB_NUM_CACHES; i++)
+      simple_mtx_lock(&slabs->caches[i].mutex);
+
    mtx_lock(&slabs->mutex);
+   pb_slabs_flush_caches_locked(slabs);
    pb_slabs_reclaim_locked(slabs);
    mtx_unlock(&slabs->mutex);
+
+   for (i = 0; i < PB_SLAB_NUM_CACHES; i++)
+      simple_mtx_unlock(&slabs->caches[i].mutex);
+}
+
+void
+pb_slabs_get_stats(struct pb_slabs *slabs, struct pb_slabs_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+
+   for (unsigned i = 0; i < PB_SLAB_NUM_CACHES; i++) {
+      struct pb_slab_cache *cache = &slabs->caches[i];
+
+      simple_mtx_lock(&cache->mutex);
+      stats->cache_hits += cache->hits;
+      stats->cache_misses += cache->misses;
+      simple_mtx_unlock(&cache->mutex);
+   }
+
+   mtx_lock(&slabs->mutex);
+   stats->num_slabs = slabs->num_slabs;
+   mtx_unlock(&slabs->mutex);
 }
 
 /* Initialize the slabs manager.
@@ -224,6 +411,27 @@ pb_slabs_init(struct pb_slabs *slabs,
       LIST_INITHEAD(&group->slabs);
    }
 
+   slabs->caches[0].entries =
+      CALLOC(PB_SLAB_NUM_CACHES * num_groups, sizeof(struct list_head));
+   if (!slabs->caches[0].entries) {
+      FREE(slabs->groups);
+      return false;
+   }
+
+   for (i = 0; i < PB_SLAB_NUM_CACHES; ++i) {
+      struct pb_slab_cache *cache = &slabs->caches[i];
+
+      simple_mtx_init(&cache->mutex, mtx_plain);
+      cache->entries = slabs->caches[0].entries + i * num_groups;
+      for (unsigned j = 0; j < num_groups; ++j)
+         LIST_INITHEAD(&cache->entries[j]);
+      LIST_INITHEAD(&cache->freed);
+      cache->num_freed = 0;
+      cache->hits = 0;
+      cache->misses = 0;
+   }
+   slabs->num_slabs = 0;
+
    (void) mtx_init(&slabs->mutex, mtx_plain);
 
    return true;
@@ -241,12 +449,18 @@ pb_slabs_deinit(struct pb_slabs *slabs)
    /* Reclaim all slab entries (even those that are still in flight). This
     * implicitly calls slab_free for everything.
     */
+   pb_slabs_flush_caches_locked(slabs);
+
    while (!LIST_IS_EMPTY(&slabs->reclaim)) {
       struct pb_slab_entry *entry =
          LIST_ENTRY(struct pb_slab_entry, slabs->reclaim.next, head);
       pb_slab_reclaim(slabs, entry);
    }
 
+   for (unsigned i = 0; i < PB_SLAB_NUM_CACHES; i++)
+      simple_mtx_destroy(&slabs->caches[i].mutex);
+   FREE(slabs->caches[0].entries);
+
    FREE(slabs->groups);
    mtx_destroy(&slabs->mutex);
 }
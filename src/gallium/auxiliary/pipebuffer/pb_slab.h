@@ -46,6 +46,7 @@
 
 #include "pb_buffer.h"
 #include "util/list.h"
+#include "util/simple_mtx.h"
 #include "os/os_thread.h"
 
 struct pb_slab;
@@ -104,6 +105,39 @@ typedef void (slab_free_fn)(void *priv, struct pb_slab *);
  */
 typedef bool (slab_can_reclaim_fn)(void *priv, struct pb_slab_entry *);
 
+/* Number of per-thread entry caches. Threads are assigned to them in a
+ * round-robin fashion, so with more threads than caches some share one.
+ */
+#define PB_SLAB_NUM_CACHES 8
+
+/* Entries cached by a thread, so that most allocations and frees only take
+ * the lock of the cache, which is practically never contended, instead of
+ * the lock of the whole manager.
+ */
+struct pb_slab_cache
+{
+   simple_mtx_t mutex;
+
+   /* Entries taken from the slabs in a batch and not handed out yet, one
+    * list per group.
+    */
+   struct list_head *entries;
+
+   /* Entries passed to pb_slab_free, moved to pb_slabs::reclaim in a batch. */
+   struct list_head freed;
+   unsigned num_freed;
+
+   uint64_t hits;
+   uint64_t misses;
+};
+
+struct pb_slabs_stats
+{
+   uint64_t cache_hits; /* allocations served by a per-thread cache */
+   uint64_t cache_misses; /* allocations that had to take the manager lock */
+   unsigned num_slabs; /* currently allocated slabs */
+};
+
 /* Manager of slab allocations. The user of this utility library should embed
  * this in a structure somewhere and call pb_slab_init/deinit at init/shutdown
  * time.
@@ -125,6 +159,10 @@ struct pb_slabs
     */
    struct list_head reclaim;
 
+   unsigned num_slabs;
+
+   struct pb_slab_cache caches[PB_SLAB_NUM_CACHES];
+
    void *priv;
    slab_can_reclaim_fn *can_reclaim;
    slab_alloc_fn *slab_alloc;
@@ -140,6 +178,9 @@ pb_slab_free(struct pb_slabs* slabs, struct pb_slab_entry *entry);
 void
 pb_slabs_reclaim(struct pb_slabs *slabs);
 
+void
+pb_slabs_get_stats(struct pb_slabs *slabs, struct pb_slabs_stats *stats);
+
 bool
 pb_slabs_init(struct pb_slabs *slabs,
               unsigned min_order, unsigned max_order,
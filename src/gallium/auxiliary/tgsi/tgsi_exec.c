@@ -63,6 +63,12 @@
 #include "util/u_math.h"
 #include "util/rounding.h"
 
+#if defined(PIPE_ARCH_SSE)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 
 #define DEBUG_EXECUTION 0
 
@@ -74,6 +80,128 @@
 #define TILE_BOTTOM_LEFT  2
 #define TILE_BOTTOM_RIGHT 3
 
+/*
+ * Four-wide float operations on whole channels, with SSE or NEON.  They
+ * give the same results as the scalar code, including for NaNs and
+ * signed zeros.
+ */
+#if defined(PIPE_ARCH_SSE)
+
+#define TGSI_EXEC_SIMD 1
+
+typedef __m128 simd_chan;
+
+static inline simd_chan
+simd_load(const union tgsi_exec_channel *c)
+{
+   return _mm_loadu_ps(c->f);
+}
+
+static inline void
+simd_store(union tgsi_exec_channel *c, simd_chan v)
+{
+   _mm_storeu_ps(c->f, v);
+}
+
+static inline simd_chan
+simd_splat(float f)
+{
+   return _mm_set1_ps(f);
+}
+
+static inline simd_chan
+simd_add(simd_chan a, simd_chan b)
+{
+   return _mm_add_ps(a, b);
+}
+
+static inline simd_chan
+simd_sub(simd_chan a, simd_chan b)
+{
+   return _mm_sub_ps(a, b);
+}
+
+static inline simd_chan
+simd_mul(simd_chan a, simd_chan b)
+{
+   return _mm_mul_ps(a, b);
+}
+
+/* a > b ? a : b, and a < b ? a : b */
+static inline simd_chan
+simd_max(simd_chan a, simd_chan b)
+{
+   return _mm_max_ps(a, b);
+}
+
+static inline simd_chan
+simd_min(simd_chan a, simd_chan b)
+{
+   return _mm_min_ps(a, b);
+}
+
+#elif defined(__ARM_NEON)
+
+#define TGSI_EXEC_SIMD 1
+
+typedef float32x4_t simd_chan;
+
+static inline simd_chan
+simd_load(const union tgsi_exec_channel *c)
+{
+   return vld1q_f32(c->f);
+}
+
+static inline void
+simd_store(union tgsi_exec_channel *c, simd_chan v)
+{
+   vst1q_f32(c->f, v);
+}
+
+static inline simd_chan
+simd_splat(float f)
+{
+   return vdupq_n_f32(f);
+}
+
+static inline simd_chan
+simd_add(simd_chan a, simd_chan b)
+{
+   return vaddq_f32(a, b);
+}
+
+static inline simd_chan
+simd_sub(simd_chan a, simd_chan b)
+{
+   return vsubq_f32(a, b);
+}
+
+static inline simd_chan
+simd_mul(simd_chan a, simd_chan b)
+{
+   return vmulq_f32(a, b);
+}
+
+/* not vmaxq/vminq, which return NaN if either operand is NaN */
+static inline simd_chan
+simd_max(simd_chan a, simd_chan b)
+{
+   return vbslq_f32(vcgtq_f32(a, b), a, b);
+}
+
+static inline simd_chan
+simd_min(simd_chan a, simd_chan b)
+{
+   return vbslq_f32(vcltq_f32(a, b), a, b);
+}
+
+#else
+
+#define TGSI_EXEC_SIMD 0
+
+#endif
+
+
 union tgsi_double_channel {
    double d[TGSI_QUAD_SIZE];
    unsigned u[TGSI_QUAD_SIZE][2];
@@ -508,10 +636,15 @@ micro_mad(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_add(simd_mul(simd_load(src0), simd_load(src1)),
+                            simd_load(src2)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0] + src2->f[0];
    dst->f[1] = src0->f[1] * src1->f[1] + src2->f[1];
    dst->f[2] = src0->f[2] * src1->f[2] + src2->f[2];
    dst->f[3] = src0->f[3] * src1->f[3] + src2->f[3];
+#endif
 }
 
 static void
@@ -1376,10 +1509,14 @@ micro_add(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_add(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] + src1->f[0];
    dst->f[1] = src0->f[1] + src1->f[1];
    dst->f[2] = src0->f[2] + src1->f[2];
    dst->f[3] = src0->f[3] + src1->f[3];
+#endif
 }
 
 static void
@@ -1421,10 +1558,14 @@ micro_max(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_max(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] > src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] > src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] > src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -1432,10 +1573,14 @@ micro_min(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_min(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] < src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] < src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] < src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -1443,10 +1588,14 @@ micro_mul(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_mul(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0];
    dst->f[1] = src0->f[1] * src1->f[1];
    dst->f[2] = src0->f[2] * src1->f[2];
    dst->f[3] = src0->f[3] * src1->f[3];
+#endif
 }
 
 static void
@@ -1495,10 +1644,14 @@ micro_sub(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_sub(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] - src1->f[0];
    dst->f[1] = src0->f[1] - src1->f[1];
    dst->f[2] = src0->f[2] - src1->f[2];
    dst->f[3] = src0->f[3] - src1->f[3];
+#endif
 }
 
 static void
@@ -1612,6 +1765,67 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
    }
 }
 
+/**
+ * Fetch from a directly addressed register: the same register for the
+ * four channels.
+ * \return FALSE if the file isn't handled here
+ */
+static inline boolean
+fetch_src_file_channel_direct(const struct tgsi_exec_machine *mach,
+                              const uint file,
+                              const uint swizzle,
+                              const int index,
+                              const int index2D,
+                              union tgsi_exec_channel *chan)
+{
+   switch (file) {
+   case TGSI_FILE_CONSTANT: {
+      const uint *buf = (const uint *)mach->Consts[index2D];
+      const int pos = index * 4 + swizzle;
+
+      assert(index2D >= 0 && index2D < PIPE_MAX_CONSTANT_BUFFERS);
+      assert(buf);
+
+      /* const buffer bounds check */
+      if (index < 0 || pos < 0 || pos >= (int) mach->ConstsSize[index2D])
+         chan->u[0] = chan->u[1] = chan->u[2] = chan->u[3] = 0;
+      else
+         chan->u[0] = chan->u[1] = chan->u[2] = chan->u[3] = buf[pos];
+      return TRUE;
+   }
+
+   case TGSI_FILE_INPUT: {
+      const int pos = index2D * TGSI_EXEC_MAX_INPUT_ATTRIBS + index;
+      assert(pos >= 0);
+      assert(pos < TGSI_MAX_PRIM_VERTICES * PIPE_MAX_ATTRIBS);
+      *chan = mach->Inputs[pos].xyzw[swizzle];
+      return TRUE;
+   }
+
+   case TGSI_FILE_TEMPORARY:
+      assert(index < TGSI_EXEC_NUM_TEMPS);
+      assert(index2D == 0);
+      *chan = mach->Temps[index].xyzw[swizzle];
+      return TRUE;
+
+   case TGSI_FILE_IMMEDIATE:
+      assert(index >= 0 && index < (int)mach->ImmLimit);
+      assert(index2D == 0);
+      chan->f[0] = chan->f[1] = chan->f[2] = chan->f[3] =
+         mach->Imms[index][swizzle];
+      return TRUE;
+
+   case TGSI_FILE_OUTPUT:
+      assert(index >= 0);
+      assert(index2D == 0);
+      *chan = mach->Outputs[index].xyzw[swizzle];
+      return TRUE;
+
+   default:
+      return FALSE;
+   }
+}
+
 static void
 fetch_source_d(const struct tgsi_exec_machine *mach,
                union tgsi_exec_channel *chan,
@@ -1622,6 +1836,20 @@ fetch_source_d(const struct tgsi_exec_machine *mach,
    union tgsi_exec_channel index2D;
    uint swizzle;
 
+   /* Common case: no indirect addressing, skip the per-channel indices */
+   if (!reg->Register.Indirect &&
+       !(reg->Register.Dimension && reg->Dimension.Indirect)) {
+      swizzle = tgsi_util_get_full_src_register_swizzle( reg, chan_index );
+      if (fetch_src_file_channel_direct(mach,
+                                        reg->Register.File,
+                                        swizzle,
+                                        reg->Register.Index,
+                                        reg->Register.Dimension ?
+                                           reg->Dimension.Index : 0,
+                                        chan))
+         return;
+   }
+
    /* We start with a direct index into a register file.
     *
     *    file[1],
@@ -1988,6 +2216,19 @@ store_dest(struct tgsi_exec_machine *mach,
    if (!dst)
       return;
 
+#if TGSI_EXEC_SIMD
+   /* all channels enabled, no masking */
+   if ((execmask & 0xf) == 0xf) {
+      if (!inst->Instruction.Saturate)
+         *dst = *chan;
+      else
+         simd_store(dst, simd_min(simd_splat(1.0f),
+                                  simd_max(simd_splat(0.0f),
+                                           simd_load(chan))));
+      return;
+   }
+#endif
+
    if (!inst->Instruction.Saturate) {
       for (i = 0; i < TGSI_QUAD_SIZE; i++)
          if (execmask & (1 << i))
@@ -0,0 +1,572 @@
+/*
+ * Copyright 2019 Collabora Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Vertex translation using NEON intrinsics, for ARM64.
+ *
+ * Unlike translate_generic, which fetches every attribute of a vertex
+ * through the u_format fetch functions into a float[4] and emits it again
+ * through a second function pointer, this walks the vertices one attribute
+ * at a time, with the conversion for that attribute selected once per run
+ * and inlined in the loop.  Attributes with an instance divisor are the
+ * same for every vertex of a run and are converted only once.
+ *
+ * Only the conversions vertex buffers commonly need are handled: copies
+ * of identical formats and plain 8, 16 and 32-bit float, normalized and
+ * scaled array formats converted to 32-bit floats.  Keys with anything
+ * else fall back to translate_generic.  The results are bit-identical to
+ * the u_format conversions used there.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/u_format.h"
+
+#include "translate.h"
+
+
+#if defined(PIPE_ARCH_AARCH64)
+
+#include <arm_neon.h>
+
+
+enum neon_fetch {
+   NEON_FETCH_COPY,
+   NEON_FETCH_FLOAT32,
+   NEON_FETCH_FLOAT16,
+   NEON_FETCH_UINT8,
+   NEON_FETCH_SINT8,
+   NEON_FETCH_UINT16,
+   NEON_FETCH_SINT16,
+   NEON_FETCH_INSTANCE_ID,
+};
+
+struct translate_neon_attrib {
+   enum neon_fetch fetch;
+
+   /* Number of channels of the input format, and the factor the
+    * integer values are multiplied with to normalize them.
+    */
+   unsigned nr_channels;
+   float scale;
+
+   /* Bytes copied for NEON_FETCH_COPY, floats stored otherwise. */
+   unsigned output_size;
+
+   unsigned buffer;
+   unsigned input_offset;
+   unsigned instance_divisor;
+   unsigned output_offset;
+
+   const uint8_t *input_ptr;
+   unsigned input_stride;
+   unsigned max_index;
+};
+
+struct translate_neon {
+   struct translate translate;
+   struct translate_neon_attrib attrib[TRANSLATE_MAX_ATTRIBS];
+
+   unsigned nr_attrib;
+};
+
+
+static struct translate_neon *
+translate_neon(struct translate *translate)
+{
+   return (struct translate_neon *)translate;
+}
+
+
+/**
+ * Fetch one attribute as a float[4], the missing channels being (0, 0, 1).
+ *
+ * The inputs shorter than a vector are first copied to a zeroed temporary,
+ * so that nothing is read past the end of the attribute.
+ */
+static ALWAYS_INLINE float32x4_t
+neon_fetch_float(enum neon_fetch fetch, unsigned nr_channels, float scale,
+                 const uint8_t *src)
+{
+   float32x4_t v;
+
+   switch (fetch) {
+   case NEON_FETCH_FLOAT32:
+      if (nr_channels == 4)
+         return vld1q_f32((const float *)src);
+      else {
+         float tmp[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+         memcpy(tmp, src, nr_channels * 4);
+         return vld1q_f32(tmp);
+      }
+
+   case NEON_FETCH_FLOAT16:
+      if (nr_channels == 4) {
+         v = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16((const uint16_t *)src)));
+      } else {
+         uint16_t tmp[4] = { 0 };
+         memcpy(tmp, src, nr_channels * 2);
+         v = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(tmp)));
+      }
+      break;
+
+   case NEON_FETCH_UINT8:
+   case NEON_FETCH_SINT8: {
+      uint8_t tmp[8] = { 0 };
+      memcpy(tmp, src, nr_channels);
+      if (fetch == NEON_FETCH_UINT8) {
+         uint16x8_t w = vmovl_u8(vld1_u8(tmp));
+         v = vcvtq_f32_u32(vmovl_u16(vget_low_u16(w)));
+      } else {
+         int16x8_t w = vmovl_s8(vld1_s8((const int8_t *)tmp));
+         v = vcvtq_f32_s32(vmovl_s16(vget_low_s16(w)));
+      }
+      v = vmulq_n_f32(v, scale);
+      break;
+   }
+
+   case NEON_FETCH_UINT16:
+   case NEON_FETCH_SINT16: {
+      uint16_t tmp[4] = { 0 };
+      const uint16_t *ptr = (const uint16_t *)src;
+      if (nr_channels != 4) {
+         memcpy(tmp, src, nr_channels * 2);
+         ptr = tmp;
+      }
+      if (fetch == NEON_FETCH_UINT16)
+         v = vcvtq_f32_u32(vmovl_u16(vld1_u16(ptr)));
+      else
+         v = vcvtq_f32_s32(vmovl_s16(vld1_s16((const int16_t *)ptr)));
+      v = vmulq_n_f32(v, scale);
+      break;
+   }
+
+   default:
+      unreachable("unexpected fetch");
+   }
+
+   if (nr_channels < 4)
+      v = vsetq_lane_f32(1.0f, v, 3);
+
+   return v;
+}
+
+static ALWAYS_INLINE void
+neon_store_float(unsigned nr_floats, uint8_t *dst, float32x4_t v)
+{
+   float *out = (float *)dst;
+
+   switch (nr_floats) {
+   case 4:
+      vst1q_f32(out, v);
+      break;
+   case 3:
+      vst1_f32(out, vget_low_f32(v));
+      vst1q_lane_f32(out + 2, v, 2);
+      break;
+   case 2:
+      vst1_f32(out, vget_low_f32(v));
+      break;
+   default:
+      vst1q_lane_f32(out, v, 0);
+      break;
+   }
+}
+
+/**
+ * Copy an attribute of identical input and output formats.  The common
+ * sizes are spelled out so that the copies get inlined.
+ */
+static ALWAYS_INLINE void
+neon_copy(unsigned size, uint8_t *dst, const uint8_t *src)
+{
+   switch (size) {
+   case 16:
+      vst1q_u8(dst, vld1q_u8(src));
+      break;
+   case 8:
+      memcpy(dst, src, 8);
+      break;
+   case 4:
+      memcpy(dst, src, 4);
+      break;
+   default:
+      memcpy(dst, src, size);
+      break;
+   }
+}
+
+static ALWAYS_INLINE unsigned
+neon_elt(const void *elts, unsigned elt_size, unsigned start, unsigned i)
+{
+   switch (elt_size) {
+   case 1:
+      return ((const uint8_t *)elts)[i];
+   case 2:
+      return ((const uint16_t *)elts)[i];
+   case 4:
+      return ((const unsigned *)elts)[i];
+   default:
+      return start + i;
+   }
+}
+
+#define NEON_LOOP(BODY)                                                  \
+   do {                                                                  \
+      for (i = 0; i < count; i++) {                                      \
+         unsigned index = MIN2(neon_elt(elts, elt_size, start, i),       \
+                               a->max_index);                            \
+         const uint8_t *src = a->input_ptr +                             \
+                              (ptrdiff_t)a->input_stride * index;        \
+         BODY;                                                           \
+         dst += stride;                                                  \
+      }                                                                  \
+   } while (0)
+
+#define NEON_FETCH_LOOP(FETCH)                                           \
+   NEON_LOOP(neon_store_float(a->output_size, dst,                       \
+                              neon_fetch_float(FETCH, a->nr_channels,    \
+                                               a->scale, src)))
+
+/**
+ * Translate one attribute of \p count vertices.  With \p elt_size 0 the
+ * vertices are consecutive from \p start, otherwise \p elts holds indices
+ * of that size.
+ */
+static ALWAYS_INLINE void
+neon_run_attrib(const struct translate_neon *tn, unsigned attr,
+                const void *elts, unsigned elt_size, unsigned start,
+                unsigned count, unsigned start_instance,
+                unsigned instance_id, uint8_t *vert)
+{
+   const unsigned stride = tn->translate.key.output_stride;
+   uint8_t *dst = vert + tn->attrib[attr].output_offset;
+   const struct translate_neon_attrib *a = &tn->attrib[attr];
+   unsigned i;
+
+   if (a->fetch == NEON_FETCH_INSTANCE_ID) {
+      for (i = 0; i < count; i++) {
+         if (a->output_size)
+            *(float *)dst = (float)instance_id;
+         else
+            memcpy(dst, &instance_id, 4);
+         dst += stride;
+      }
+      return;
+   }
+
+   if (a->instance_divisor) {
+      /* XXX we need to clamp the index here too, but to a per-array max
+       * value, like translate_generic.
+       */
+      unsigned index = start_instance + instance_id / a->instance_divisor;
+      const uint8_t *src = a->input_ptr + (ptrdiff_t)a->input_stride * index;
+
+      if (a->fetch == NEON_FETCH_COPY) {
+         for (i = 0; i < count; i++) {
+            neon_copy(a->output_size, dst, src);
+            dst += stride;
+         }
+      } else {
+         float32x4_t v = neon_fetch_float(a->fetch, a->nr_channels, a->scale,
+                                          src);
+         for (i = 0; i < count; i++) {
+            neon_store_float(a->output_size, dst, v);
+            dst += stride;
+         }
+      }
+      return;
+   }
+
+   switch (a->fetch) {
+   case NEON_FETCH_COPY:
+      NEON_LOOP(neon_copy(a->output_size, dst, src));
+      break;
+   case NEON_FETCH_FLOAT32:
+      NEON_FETCH_LOOP(NEON_FETCH_FLOAT32);
+      break;
+   case NEON_FETCH_FLOAT16:
+      NEON_FETCH_LOOP(NEON_FETCH_FLOAT16);
+      break;
+   case NEON_FETCH_UINT8:
+      NEON_FETCH_LOOP(NEON_FETCH_UINT8);
+      break;
+   case NEON_FETCH_SINT8:
+      NEON_FETCH_LOOP(NEON_FETCH_SINT8);
+      break;
+   case NEON_FETCH_UINT16:
+      NEON_FETCH_LOOP(NEON_FETCH_UINT16);
+      break;
+   case NEON_FETCH_SINT16:
+      NEON_FETCH_LOOP(NEON_FETCH_SINT16);
+      break;
+   default:
+      unreachable("unexpected fetch");
+   }
+}
+
+static ALWAYS_INLINE void
+neon_run(struct translate *translate, const void *elts, unsigned elt_size,
+         unsigned start, unsigned count, unsigned start_instance,
+         unsigned instance_id, void *output_buffer)
+{
+   struct translate_neon *tn = translate_neon(translate);
+   unsigned attr;
+
+   for (attr = 0; attr < tn->nr_attrib; attr++) {
+      neon_run_attrib(tn, attr, elts, elt_size, start, count,
+                      start_instance, instance_id, output_buffer);
+   }
+}
+
+static void PIPE_CDECL
+neon_run_elts(struct translate *translate,
+              const unsigned *elts,
+              unsigned count,
+              unsigned start_instance,
+              unsigned instance_id,
+              void *output_buffer)
+{
+   neon_run(translate, elts, 4, 0, count, start_instance, instance_id,
+            output_buffer);
+}
+
+static void PIPE_CDECL
+neon_run_elts16(struct translate *translate,
+                const uint16_t *elts,
+                unsigned count,
+                unsigned start_instance,
+                unsigned instance_id,
+                void *output_buffer)
+{
+   neon_run(translate, elts, 2, 0, count, start_instance, instance_id,
+            output_buffer);
+}
+
+static void PIPE_CDECL
+neon_run_elts8(struct translate *translate,
+               const uint8_t *elts,
+               unsigned count,
+               unsigned start_instance,
+               unsigned instance_id,
+               void *output_buffer)
+{
+   neon_run(translate, elts, 1, 0, count, start_instance, instance_id,
+            output_buffer);
+}
+
+static void PIPE_CDECL
+neon_run_linear(struct translate *translate,
+                unsigned start,
+                unsigned count,
+                unsigned start_instance,
+                unsigned instance_id,
+                void *output_buffer)
+{
+   neon_run(translate, NULL, 0, start, count, start_instance, instance_id,
+            output_buffer);
+}
+
+
+static void
+neon_set_buffer(struct translate *translate,
+                unsigned buf,
+                const void *ptr,
+                unsigned stride,
+                unsigned max_index)
+{
+   struct translate_neon *tn = translate_neon(translate);
+   unsigned i;
+
+   for (i = 0; i < tn->nr_attrib; i++) {
+      if (tn->attrib[i].buffer == buf) {
+         tn->attrib[i].input_ptr = ((const uint8_t *)ptr +
+                                    tn->attrib[i].input_offset);
+         tn->attrib[i].input_stride = stride;
+         tn->attrib[i].max_index = max_index;
+      }
+   }
+}
+
+
+static void
+neon_release(struct translate *translate)
+{
+   FREE(translate);
+}
+
+
+/**
+ * Pick the conversion of a plain array format to float, or return false if
+ * there is none.
+ */
+static boolean
+neon_get_float_fetch(const struct util_format_description *desc,
+                     enum neon_fetch *fetch, float *scale)
+{
+   const struct util_format_channel_description *chan = &desc->channel[0];
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       !desc->is_array || desc->nr_channels > 4)
+      return FALSE;
+
+   for (i = 0; i < 4; i++) {
+      if (i < desc->nr_channels) {
+         if (desc->swizzle[i] != i ||
+             desc->channel[i].type != chan->type ||
+             desc->channel[i].size != chan->size ||
+             desc->channel[i].normalized != chan->normalized ||
+             desc->channel[i].pure_integer)
+            return FALSE;
+      } else if (desc->swizzle[i] != (i == 3 ? PIPE_SWIZZLE_1 :
+                                               PIPE_SWIZZLE_0)) {
+         return FALSE;
+      }
+   }
+
+   switch (chan->type) {
+   case UTIL_FORMAT_TYPE_FLOAT:
+      if (chan->size == 32)
+         *fetch = NEON_FETCH_FLOAT32;
+      else if (chan->size == 16)
+         *fetch = NEON_FETCH_FLOAT16;
+      else
+         return FALSE;
+      *scale = 1.0f;
+      return TRUE;
+
+   case UTIL_FORMAT_TYPE_UNSIGNED:
+      if (chan->size == 8)
+         *fetch = NEON_FETCH_UINT8;
+      else if (chan->size == 16)
+         *fetch = NEON_FETCH_UINT16;
+      else
+         return FALSE;
+      *scale = !chan->normalized ? 1.0f :
+               chan->size == 8 ? 1.0f / 0xff : 1.0f / 0xffff;
+      return TRUE;
+
+   case UTIL_FORMAT_TYPE_SIGNED:
+      if (chan->size == 8)
+         *fetch = NEON_FETCH_SINT8;
+      else if (chan->size == 16)
+         *fetch = NEON_FETCH_SINT16;
+      else
+         return FALSE;
+      *scale = !chan->normalized ? 1.0f :
+               chan->size == 8 ? 1.0f / 0x7f : 1.0f / 0x7fff;
+      return TRUE;
+
+   default:
+      return FALSE;
+   }
+}
+
+static unsigned
+neon_get_float_output_size(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_R32G32B32A32_FLOAT: return 4;
+   case PIPE_FORMAT_R32G32B32_FLOAT: return 3;
+   case PIPE_FORMAT_R32G32_FLOAT: return 2;
+   case PIPE_FORMAT_R32_FLOAT: return 1;
+   default: return 0;
+   }
+}
+
+struct translate *
+translate_neon_create(const struct translate_key *key)
+{
+   struct translate_neon *tn = CALLOC_STRUCT(translate_neon);
+   unsigned i;
+
+   if (!tn)
+      return NULL;
+
+   assert(key->nr_elements <= TRANSLATE_MAX_ATTRIBS);
+
+   tn->translate.key = *key;
+   tn->translate.release = neon_release;
+   tn->translate.set_buffer = neon_set_buffer;
+   tn->translate.run_elts = neon_run_elts;
+   tn->translate.run_elts16 = neon_run_elts16;
+   tn->translate.run_elts8 = neon_run_elts8;
+   tn->translate.run = neon_run_linear;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *elem = &key->element[i];
+      const struct util_format_description *format_desc =
+            util_format_description(elem->input_format);
+      unsigned output_size = neon_get_float_output_size(elem->output_format);
+
+      tn->attrib[i].buffer = elem->input_buffer;
+      tn->attrib[i].input_offset = elem->input_offset;
+      tn->attrib[i].instance_divisor = elem->instance_divisor;
+      tn->attrib[i].output_offset = elem->output_offset;
+
+      if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+         tn->attrib[i].fetch = NEON_FETCH_INSTANCE_ID;
+         if (elem->output_format == PIPE_FORMAT_R32_FLOAT)
+            tn->attrib[i].output_size = 1;
+         else if (elem->output_format != PIPE_FORMAT_R32_USCALED &&
+                  elem->output_format != PIPE_FORMAT_R32_SSCALED)
+            goto fail;
+      } else if (elem->input_format == elem->output_format &&
+                 format_desc->block.width == 1 &&
+                 format_desc->block.height == 1 &&
+                 !(format_desc->block.bits & 7)) {
+         tn->attrib[i].fetch = NEON_FETCH_COPY;
+         tn->attrib[i].output_size = format_desc->block.bits >> 3;
+      } else if (output_size &&
+                 neon_get_float_fetch(format_desc, &tn->attrib[i].fetch,
+                                      &tn->attrib[i].scale)) {
+         tn->attrib[i].nr_channels = format_desc->nr_channels;
+         tn->attrib[i].output_size = output_size;
+      } else {
+         goto fail;
+      }
+   }
+
+   tn->nr_attrib = key->nr_elements;
+
+   return &tn->translate;
+
+fail:
+   FREE(tn);
+   return NULL;
+}
+
+
+#else
+
+struct translate *
+translate_neon_create(const struct translate_key *key)
+{
+   return NULL;
+}
+
+#endif
@@ -164,3 +164,203 @@ void util_compute_blit(struct pipe_context *ctx, struct pipe_blit_info *blit_inf
    ctx->delete_sampler_state(ctx, sampler_state_p);
    ctx->bind_compute_state(ctx, NULL);
 }
+
+static void *gen_mipmap_compute_shader(struct pipe_context *ctx)
+{
+   /* Each thread writes one texel of the first level and the threads of
+    * each 2x2 quad then combine their results through shared memory into
+    * one texel of the second level, if CONST[0][1].w is set.
+    */
+   static const char text[] =
+      "COMP\n"
+      "PROPERTY CS_FIXED_BLOCK_WIDTH 8\n"
+      "PROPERTY CS_FIXED_BLOCK_HEIGHT 8\n"
+      "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+      "DCL SV[0], THREAD_ID\n"
+      "DCL SV[1], BLOCK_ID\n"
+      "DCL IMAGE[0], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT, WR\n"
+      "DCL IMAGE[1], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT, WR\n"
+      "DCL SAMP[0]\n"
+      "DCL SVIEW[0], 2D_ARRAY, FLOAT\n"
+      "DCL CONST[0][0..1]\n" // 0:1/width 1/height  1:width height layer two_levels
+      "DCL MEMORY[0], SHARED\n"
+      "DCL TEMP[0..6], LOCAL\n"
+      "IMM[0] UINT32 {8, 1, 0, 16}\n"
+      "IMM[1] FLT32 {0.5, 0.25, 0, 0}\n"
+      "IMM[2] UINT32 {16, 128, 144, 0}\n"
+
+      "UMAD TEMP[0].xyz, SV[1].xyzz, IMM[0].xxyy, SV[0].xyzz\n"
+      "UADD TEMP[0].z, TEMP[0].zzzz, CONST[0][1].zzzz\n"
+      "U2F TEMP[1].xyz, TEMP[0]\n"
+      "ADD TEMP[1].xy, TEMP[1], IMM[1].xxxx\n"
+      "MUL TEMP[1].xy, TEMP[1], CONST[0][0]\n"
+      "TEX_LZ TEMP[2], TEMP[1], SAMP[0], 2D_ARRAY\n"
+      "USLT TEMP[3].xy, TEMP[0], CONST[0][1]\n"
+      "AND TEMP[3].x, TEMP[3].xxxx, TEMP[3].yyyy\n"
+      "UIF TEMP[3].xxxx\n"
+      "  STORE IMAGE[0], TEMP[0], TEMP[2], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT\n"
+      "ENDIF\n"
+
+      "UIF CONST[0][1].wwww\n"
+      "  UMAD TEMP[3].x, SV[0].yyyy, IMM[0].xxxx, SV[0].xxxx\n"
+      "  UMUL TEMP[3].x, TEMP[3].xxxx, IMM[0].wwww\n"
+      "  STORE MEMORY[0].xyzw, TEMP[3].xxxx, TEMP[2]\n"
+      "  BARRIER\n"
+      "  OR TEMP[4].x, SV[0].xxxx, SV[0].yyyy\n"
+      "  AND TEMP[4].x, TEMP[4].xxxx, IMM[0].yyyy\n"
+      "  USEQ TEMP[4].x, TEMP[4].xxxx, IMM[0].zzzz\n"
+      "  UIF TEMP[4].xxxx\n"
+      "    UADD TEMP[6].xyz, TEMP[3].xxxx, IMM[2].xyzz\n"
+      "    LOAD TEMP[4], MEMORY[0], TEMP[6].xxxx\n"
+      "    ADD TEMP[2], TEMP[2], TEMP[4]\n"
+      "    LOAD TEMP[4], MEMORY[0], TEMP[6].yyyy\n"
+      "    ADD TEMP[2], TEMP[2], TEMP[4]\n"
+      "    LOAD TEMP[4], MEMORY[0], TEMP[6].zzzz\n"
+      "    ADD TEMP[2], TEMP[2], TEMP[4]\n"
+      "    MUL TEMP[2], TEMP[2], IMM[1].yyyy\n"
+      "    USHR TEMP[5].xy, TEMP[0], IMM[0].yyyy\n"
+      "    MOV TEMP[5].z, TEMP[0].zzzz\n"
+      "    USHR TEMP[6].xy, CONST[0][1], IMM[0].yyyy\n"
+      "    USLT TEMP[6].xy, TEMP[5], TEMP[6]\n"
+      "    AND TEMP[6].x, TEMP[6].xxxx, TEMP[6].yyyy\n"
+      "    UIF TEMP[6].xxxx\n"
+      "      STORE IMAGE[1], TEMP[5], TEMP[2], 2D_ARRAY, PIPE_FORMAT_R32G32B32A32_FLOAT\n"
+      "    ENDIF\n"
+      "  ENDIF\n"
+      "ENDIF\n"
+      "END\n";
+
+   struct tgsi_token tokens[1024];
+   struct pipe_compute_state state = {0};
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      assert(false);
+      return NULL;
+   }
+
+   state.ir_type = PIPE_SHADER_IR_TGSI;
+   state.prog = tokens;
+   state.req_local_mem = 8 * 8 * 16;
+
+   return ctx->create_compute_state(ctx, &state);
+}
+
+/**
+ * Generate mipmap levels of a 2D or 2D array texture with a compute
+ * shader, which writes two levels per dispatch where the size of the
+ * first one allows box-filtering it into the second one.
+ *
+ * The parameters are the same as for util_gen_mipmap(), always with linear
+ * filtering.  The compute shader, sampler view, sampler, image and
+ * constant buffer 0 bindings of the compute stage are left unbound.
+ *
+ * \param compute_state  cached compute shader, created on first use and to
+ *                       be deleted by the caller
+ * \return false if the texture or the driver isn't supported, in which case
+ *         nothing has been done
+ */
+bool util_compute_gen_mipmap(struct pipe_context *ctx, struct pipe_resource *pt,
+                             enum pipe_format format, unsigned base_level,
+                             unsigned last_level, unsigned first_layer,
+                             unsigned last_layer, void **compute_state)
+{
+   struct pipe_screen *screen = ctx->screen;
+
+   if ((pt->target != PIPE_TEXTURE_2D &&
+        pt->target != PIPE_TEXTURE_2D_ARRAY) ||
+       pt->nr_samples > 1 ||
+       util_format_is_depth_or_stencil(format) ||
+       util_format_is_pure_integer(format) ||
+       /* image stores don't encode sRGB */
+       util_format_is_srgb(format) ||
+       !screen->get_param(screen, PIPE_CAP_COMPUTE) ||
+       !(screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                  PIPE_SHADER_CAP_SUPPORTED_IRS) &
+         (1 << PIPE_SHADER_IR_TGSI)) ||
+       screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                PIPE_SHADER_CAP_MAX_SHADER_IMAGES) < 2 ||
+       !screen->is_format_supported(screen, format, pt->target, 0, 0,
+                                    PIPE_BIND_SAMPLER_VIEW |
+                                    PIPE_BIND_SHADER_IMAGE))
+      return false;
+
+   assert(last_level <= pt->last_level);
+   assert(last_level > base_level);
+
+   if (!*compute_state)
+      *compute_state = gen_mipmap_compute_shader(ctx);
+   if (!*compute_state)
+      return false;
+
+   struct pipe_sampler_state sampler_state = {0};
+   sampler_state.wrap_s = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler_state.wrap_t = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler_state.wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler_state.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler_state.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler_state.normalized_coords = 1;
+
+   void *sampler_state_p = ctx->create_sampler_state(ctx, &sampler_state);
+   ctx->bind_sampler_states(ctx, PIPE_SHADER_COMPUTE, 0, 1, &sampler_state_p);
+   ctx->bind_compute_state(ctx, *compute_state);
+
+   for (unsigned level = base_level; level < last_level;) {
+      unsigned width = u_minify(pt->width0, level + 1);
+      unsigned height = u_minify(pt->height0, level + 1);
+      bool two_levels = level + 2 <= last_level &&
+                        width % 2 == 0 && height % 2 == 0;
+
+      unsigned data[] = {u_bitcast_f2u(1.0f / width),
+                         u_bitcast_f2u(1.0f / height),
+                         0, 0,
+                         width, height, first_layer, two_levels};
+
+      struct pipe_constant_buffer cb = {0};
+      cb.buffer_size = sizeof(data);
+      cb.user_buffer = data;
+      ctx->set_constant_buffer(ctx, PIPE_SHADER_COMPUTE, 0, &cb);
+
+      struct pipe_sampler_view src_templ = {0}, *src_view;
+      u_sampler_view_default_template(&src_templ, pt, format);
+      src_templ.target = PIPE_TEXTURE_2D_ARRAY;
+      src_templ.u.tex.first_level = src_templ.u.tex.last_level = level;
+      src_view = ctx->create_sampler_view(ctx, pt, &src_templ);
+      ctx->set_sampler_views(ctx, PIPE_SHADER_COMPUTE, 0, 1, &src_view);
+
+      struct pipe_image_view images[2] = {{0}};
+      for (unsigned i = 0; i < 1 + two_levels; i++) {
+         images[i].resource = pt;
+         images[i].shader_access = images[i].access = PIPE_IMAGE_ACCESS_WRITE;
+         images[i].format = format;
+         images[i].u.tex.level = level + 1 + i;
+         images[i].u.tex.first_layer = 0;
+         images[i].u.tex.last_layer = pt->array_size - 1;
+      }
+      ctx->set_shader_images(ctx, PIPE_SHADER_COMPUTE, 0, 2, images);
+
+      struct pipe_grid_info grid_info = {0};
+      grid_info.block[0] = 8;
+      grid_info.block[1] = 8;
+      grid_info.block[2] = 1;
+      grid_info.grid[0] = DIV_ROUND_UP(width, 8);
+      grid_info.grid[1] = DIV_ROUND_UP(height, 8);
+      grid_info.grid[2] = last_layer + 1 - first_layer;
+
+      ctx->launch_grid(ctx, &grid_info);
+
+      /* The next dispatch samples what this one wrote. */
+      ctx->memory_barrier(ctx, PIPE_BARRIER_TEXTURE | PIPE_BARRIER_IMAGE);
+
+      ctx->set_sampler_views(ctx, PIPE_SHADER_COMPUTE, 0, 1, NULL);
+      pipe_sampler_view_reference(&src_view, NULL);
+
+      level += 1 + two_levels;
+   }
+
+   ctx->set_shader_images(ctx, PIPE_SHADER_COMPUTE, 0, 2, NULL);
+   ctx->set_constant_buffer(ctx, PIPE_SHADER_COMPUTE, 0, NULL);
+   ctx->delete_sampler_state(ctx, sampler_state_p);
+   ctx->bind_compute_state(ctx, NULL);
+
+   return true;
+}
@@ -621,6 +621,100 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print_channels(format, pack_into_union)
 
 
+def is_sse2_rgba8_unorm(format):
+    '''Whether the format is made of four 8-bit UNORM channels which are
+    only shuffled to get RGBA, in which case rows can be converted four
+    pixels at a time with SSE2.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1:
+        return False
+    if format.block_size() != 32:
+        return False
+    for channel in format.le_channels:
+        if channel.type != UNSIGNED or not channel.norm or channel.size != 8:
+            return False
+    return sorted(format.le_swizzles) == [SWIZZLE_X, SWIZZLE_Y, SWIZZLE_Z, SWIZZLE_W]
+
+
+def generate_sse2_byte_shuffle(dst, src, positions):
+    '''Generate the code moving byte positions[i] of each 32-bit lane of src
+    to byte i of dst.'''
+
+    if positions == [0, 1, 2, 3]:
+        print('         __m128i %s = %s;' % (dst, src))
+        return
+
+    # Bytes moving by the same amount share a shift and a mask
+    masks = {}
+    for i in range(4):
+        shift = 8*(i - positions[i])
+        masks[shift] = masks.get(shift, 0) | (0xff << 8*i)
+
+    terms = []
+    for shift, mask in sorted(masks.items()):
+        if shift > 0:
+            value = '_mm_slli_epi32(%s, %u)' % (src, shift)
+        elif shift < 0:
+            value = '_mm_srli_epi32(%s, %u)' % (src, -shift)
+        else:
+            value = src
+        terms.append('_mm_and_si128(%s, _mm_set1_epi32(0x%08x))' % (value, mask))
+
+    value = terms[0]
+    for term in terms[1:]:
+        value = '_mm_or_si128(%s, %s)' % (value, term)
+    print('         __m128i %s = %s;' % (dst, value))
+
+
+def generate_sse2_unpack_rows(format, dst_native_type):
+    '''Generate the SSE2 loop unpacking four pixels at a time, leaving the
+    remaining pixels to the scalar loop.'''
+
+    swizzles = format.le_swizzles
+
+    print('#if defined(PIPE_ARCH_SSE) && !defined(PIPE_ARCH_BIG_ENDIAN)')
+    print('      for(; x + 4 <= width; x += 4) {')
+    print('         __m128i pixels = _mm_loadu_si128((const __m128i *)src);')
+    generate_sse2_byte_shuffle('rgba', 'pixels', swizzles[0:4])
+    if dst_native_type == 'uint8_t':
+        print('         _mm_storeu_si128((__m128i *)dst, rgba);')
+    else:
+        assert dst_native_type == 'float'
+        print('         const __m128i zero = _mm_setzero_si128();')
+        print('         const __m128 scale = _mm_set1_ps(1.0f / 255.0f);')
+        print('         __m128i lo = _mm_unpacklo_epi8(rgba, zero);')
+        print('         __m128i hi = _mm_unpackhi_epi8(rgba, zero);')
+        print('         _mm_storeu_ps(dst + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));')
+        print('         _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));')
+        print('         _mm_storeu_ps(dst + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));')
+        print('         _mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));')
+    print('         src += 16;')
+    print('         dst += 16;')
+    print('      }')
+    print('#endif')
+
+
+def generate_sse2_pack_rows(format):
+    '''Generate the SSE2 loop packing four RGBA8 pixels at a time, leaving
+    the remaining pixels to the scalar loop.'''
+
+    positions = [0, 1, 2, 3]
+    for i in range(4):
+        positions[format.le_swizzles[i]] = i
+
+    print('#if defined(PIPE_ARCH_SSE) && !defined(PIPE_ARCH_BIG_ENDIAN)')
+    print('      for(; x + 4 <= width; x += 4) {')
+    print('         __m128i rgba = _mm_loadu_si128((const __m128i *)src);')
+    generate_sse2_byte_shuffle('pixels', 'rgba', positions)
+    print('         _mm_storeu_si128((__m128i *)dst, pixels);')
+    print('         src += 16;')
+    print('         dst += 16;')
+    print('      }')
+    print('#endif')
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
@@ -635,7 +729,12 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      %s *dst = dst_row;' % (dst_native_type))
         print('      const uint8_t *src = src_row;')
-        print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
+        if is_sse2_rgba8_unorm(format) and dst_native_type in ('float', 'uint8_t'):
+            print('      x = 0;')
+            generate_sse2_unpack_rows(format, dst_native_type)
+            print('      for(; x < width; x += %u) {' % (format.block_width,))
+        else:
+            print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
         
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
@@ -664,7 +763,12 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      const %s *src = src_row;' % (src_native_type))
         print('      uint8_t *dst = dst_row;')
-        print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
+        if is_sse2_rgba8_unorm(format) and src_native_type == 'uint8_t':
+            print('      x = 0;')
+            generate_sse2_pack_rows(format)
+            print('      for(; x < width; x += %u) {' % (format.block_width,))
+        else:
+            print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
     
         generate_pack_kernel(format, src_channel, src_native_type)
             
@@ -709,6 +813,7 @@ def generate(formats):
     print('#include "util/format_srgb.h"')
     print('#include "u_format_yuv.h"')
     print('#include "u_format_zs.h"')
+    print('#include "u_sse.h"')
     print()
 
     for format in formats:
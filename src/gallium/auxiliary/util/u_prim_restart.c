@@ -27,6 +27,7 @@
 
 #include "u_inlines.h"
 #include "util/u_memory.h"
+#include "indices/u_indices_compute.h"
 #include "u_prim_restart.h"
 
 
@@ -120,6 +121,41 @@ error:
 }
 
 
+/**
+ * Like util_translate_prim_restart_ib(), but translating the indices with
+ * a compute shader instead of mapping the index buffer, see
+ * u_index_translate_compute().  The new index buffer always has 4-byte
+ * indexes, with restart_index converted to 0xffffffff.
+ */
+enum pipe_error
+util_translate_prim_restart_ib_compute(struct pipe_context *context,
+                                       const struct pipe_draw_info *info,
+                                       void **compute_state,
+                                       struct pipe_resource **dst_buffer)
+{
+   assert(!info->has_user_indices);
+
+   *dst_buffer = pipe_buffer_create(context->screen,
+                                    PIPE_BIND_INDEX_BUFFER |
+                                    PIPE_BIND_SHADER_BUFFER,
+                                    PIPE_USAGE_DEFAULT,
+                                    info->count * 4);
+   if (!*dst_buffer)
+      return PIPE_ERROR_OUT_OF_MEMORY;
+
+   u_index_translate_compute(context, compute_state, info->index.resource,
+                             info->start * info->index_size, info->index_size,
+                             NULL, 0, TRUE, info->restart_index,
+                             *dst_buffer, info->count);
+   if (!*compute_state) {
+      pipe_resource_reference(dst_buffer, NULL);
+      return PIPE_ERROR;
+   }
+
+   return PIPE_OK;
+}
+
+
 /** Helper structs for util_draw_vbo_without_prim_restart() */
 
 struct range {
@@ -47,6 +47,12 @@ util_translate_prim_restart_ib(struct pipe_context *context,
                                const struct pipe_draw_info *info,
                                struct pipe_resource **dst_buffer);
 
+enum pipe_error
+util_translate_prim_restart_ib_compute(struct pipe_context *context,
+                                       const struct pipe_draw_info *info,
+                                       void **compute_state,
+                                       struct pipe_resource **dst_buffer);
+
 enum pipe_error
 util_draw_vbo_without_prim_restart(struct pipe_context *context,
                                    const struct pipe_draw_info *info);
@@ -30,6 +30,7 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
+#include "util/os_time.h"
 
 /* 0 = disabled, 1 = assertions, 2 = printfs */
 #define TC_DEBUG 0
@@ -79,6 +80,30 @@ tc_debug_check(struct threaded_context *tc)
    }
 }
 
+static void
+tc_begin_batch(struct threaded_context *tc, struct tc_batch *batch)
+{
+   unsigned size = batch->num_total_call_slots * sizeof(struct tc_call);
+   bool replay = tc->prev_calls &&
+                 tc->prev_num_call_slots == batch->num_total_call_slots &&
+                 !memcmp(tc->prev_calls, batch->call, size);
+
+   /* Executing the calls releases the references they hold, which
+    * changes them, so keep a copy.
+    */
+   if (!replay) {
+      if (!tc->prev_calls)
+         tc->prev_calls = MALLOC(sizeof(batch->call));
+
+      if (tc->prev_calls) {
+         memcpy(tc->prev_calls, batch->call, size);
+         tc->prev_num_call_slots = batch->num_total_call_slots;
+      }
+   }
+
+   tc->begin_batch(batch->pipe, replay);
+}
+
 static void
 tc_batch_execute(void *job, UNUSED int thread_index)
 {
@@ -90,6 +115,9 @@ tc_batch_execute(void *job, UNUSED int thread_index)
 
    assert(!batch->token);
 
+   if (batch->tc->begin_batch)
+      tc_begin_batch(batch->tc, batch);
+
    for (struct tc_call *iter = batch->call; iter != last;
         iter += iter->num_call_slots) {
       tc_assert(iter->sentinel == TC_SENTINEL);
@@ -109,6 +137,7 @@ tc_batch_flush(struct threaded_context *tc)
    tc_batch_check(next);
    tc_debug_check(tc);
    p_atomic_add(&tc->num_offloaded_slots, next->num_total_call_slots);
+   p_atomic_inc(&tc->num_batches);
 
    if (next->token) {
       next->token->tc = NULL;
@@ -180,18 +209,19 @@ tc_is_sync(struct threaded_context *tc)
 }
 
 static void
-_tc_sync(struct threaded_context *tc, MAYBE_UNUSED const char *info, MAYBE_UNUSED const char *func)
+_tc_sync(struct threaded_context *tc, enum tc_sync_reason reason,
+         MAYBE_UNUSED const char *info, MAYBE_UNUSED const char *func)
 {
    struct tc_batch *last = &tc->batch_slots[tc->last];
    struct tc_batch *next = &tc->batch_slots[tc->next];
-   bool synced = false;
+   int64_t start = 0;
 
    tc_debug_check(tc);
 
    /* Only wait for queued calls... */
    if (!util_queue_fence_is_signalled(&last->fence)) {
+      start = os_time_get_nano();
       util_queue_fence_wait(&last->fence);
-      synced = true;
    }
 
    tc_debug_check(tc);
@@ -203,13 +233,18 @@ _tc_sync(struct threaded_context *tc, MAYBE_UNUSED const char *info, MAYBE_UNUSE
 
    /* .. and execute unflushed calls directly. */
    if (next->num_total_call_slots) {
+      if (!start)
+         start = os_time_get_nano();
+
       p_atomic_add(&tc->num_direct_slots, next->num_total_call_slots);
       tc_batch_execute(next, 0);
-      synced = true;
    }
 
-   if (synced) {
+   if (start) {
       p_atomic_inc(&tc->num_syncs);
+      p_atomic_inc(&tc->num_syncs_by_reason[reason]);
+      /* Only the application thread updates this. */
+      tc->sync_time_ns += os_time_get_nano() - start;
 
       if (tc_strcmp(func, "tc_destroy") != 0) {
          tc_printf("sync %s %s\n", func, info);
@@ -219,8 +254,8 @@ _tc_sync(struct threaded_context *tc, MAYBE_UNUSED const char *info, MAYBE_UNUSE
    tc_debug_check(tc);
 }
 
-#define tc_sync(tc) _tc_sync(tc, "", __func__)
-#define tc_sync_msg(tc, info) _tc_sync(tc, info, __func__)
+#define tc_sync(tc) _tc_sync(tc, TC_SYNC_OTHER, "", __func__)
+#define tc_sync_msg(tc, reason, info) _tc_sync(tc, reason, info, __func__)
 
 /**
  * Call this from fence_finish for same-context fence waits of deferred fences
@@ -424,7 +459,7 @@ tc_get_query_result(struct pipe_context *_pipe,
    struct pipe_context *pipe = tc->pipe;
 
    if (!tq->flushed)
-      tc_sync_msg(tc, wait ? "wait" : "nowait");
+      tc_sync_msg(tc, TC_SYNC_QUERY, wait ? "wait" : "nowait");
 
    bool success = pipe->get_query_result(pipe, query, wait, result);
 
@@ -1480,7 +1515,8 @@ tc_transfer_map(struct pipe_context *_pipe,
 
    /* Unsychronized buffer mappings don't have to synchronize the thread. */
    if (!(usage & TC_TRANSFER_MAP_THREADED_UNSYNC))
-      tc_sync_msg(tc, resource->target != PIPE_BUFFER ? "  texture" :
+      tc_sync_msg(tc, TC_SYNC_TRANSFER,
+                  resource->target != PIPE_BUFFER ? "  texture" :
                       usage & PIPE_TRANSFER_DISCARD_RANGE ? "  discard_range" :
                       usage & PIPE_TRANSFER_READ ? "  read" : "  ??");
 
@@ -1720,7 +1756,7 @@ tc_texture_subdata(struct pipe_context *_pipe,
    } else {
       struct pipe_context *pipe = tc->pipe;
 
-      tc_sync(tc);
+      tc_sync_msg(tc, TC_SYNC_TRANSFER, "  texture_subdata");
       pipe->texture_subdata(pipe, resource, level, usage, box, data,
                             stride, layer_stride);
    }
@@ -2033,7 +2069,8 @@ tc_flush(struct pipe_context *_pipe, struct pipe_fence_handle **fence,
    }
 
 out_of_memory:
-   tc_sync_msg(tc, flags & PIPE_FLUSH_END_OF_FRAME ? "end of frame" :
+   tc_sync_msg(tc, TC_SYNC_FLUSH,
+               flags & PIPE_FLUSH_END_OF_FRAME ? "end of frame" :
                    flags & PIPE_FLUSH_DEFERRED ? "deferred fence" : "normal");
 
    if (!(flags & PIPE_FLUSH_DEFERRED))
@@ -2126,6 +2163,41 @@ tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
    }
 }
 
+struct tc_multi_draw {
+   struct pipe_draw_info info;
+   unsigned num_draws;
+   struct pipe_draw_start_count slot[0]; /* more will be allocated if needed */
+};
+
+static void
+tc_call_multi_draw(struct pipe_context *pipe, union tc_payload *payload)
+{
+   struct tc_multi_draw *p = (struct tc_multi_draw *)payload;
+
+   pipe->multi_draw(pipe, &p->info, p->slot, p->num_draws);
+   if (p->info.index_size)
+      pipe_resource_reference(&p->info.index.resource, NULL);
+}
+
+static void
+tc_multi_draw(struct pipe_context *_pipe, const struct pipe_draw_info *info,
+              const struct pipe_draw_start_count *draws, unsigned num_draws)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_assert(!info->indirect && !info->count_from_stream_output);
+   tc_assert(!info->has_user_indices);
+
+   struct tc_multi_draw *p =
+      tc_add_slot_based_call(tc, TC_CALL_multi_draw, tc_multi_draw,
+                             num_draws);
+   if (info->index_size)
+      tc_set_resource_reference(&p->info.index.resource, info->index.resource);
+   memcpy(&p->info, info, sizeof(*info));
+   p->num_draws = num_draws;
+   memcpy(p->slot, draws, sizeof(draws[0]) * num_draws);
+}
+
 static void
 tc_call_launch_grid(struct pipe_context *pipe, union tc_payload *payload)
 {
@@ -2529,6 +2601,7 @@ tc_destroy(struct pipe_context *_pipe)
 
    slab_destroy_child(&tc->pool_transfers);
    assert(tc->batch_slots[tc->next].num_total_call_slots == 0);
+   FREE(tc->prev_calls);
    pipe->destroy(pipe);
    os_free_aligned(tc);
 }
@@ -2617,6 +2690,7 @@ threaded_context_create(struct pipe_context *pipe,
    for (unsigned i = 0; i < TC_MAX_BATCHES; i++) {
       tc->batch_slots[i].sentinel = TC_SENTINEL;
       tc->batch_slots[i].pipe = pipe;
+      tc->batch_slots[i].tc = tc;
       util_queue_fence_init(&tc->batch_slots[i].fence);
    }
 
@@ -2631,6 +2705,7 @@ threaded_context_create(struct pipe_context *pipe,
 
    CTX_INIT(flush);
    CTX_INIT(draw_vbo);
+   CTX_INIT(multi_draw);
    CTX_INIT(launch_grid);
    CTX_INIT(resource_copy_region);
    CTX_INIT(blit);
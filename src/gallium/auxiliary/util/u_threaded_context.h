@@ -238,6 +238,24 @@ typedef void (*tc_replace_buffer_storage_func)(struct pipe_context *ctx,
 typedef struct pipe_fence_handle *(*tc_create_fence_func)(struct pipe_context *ctx,
                                                           struct tc_unflushed_batch_token *token);
 
+/* Called in the driver thread before the calls of a batch are executed.
+ * "replay" is true if they are bytewise identical to the calls of the
+ * previous batch, which is common for static scenes where every frame
+ * submits the same sequence. The calls still get executed, but the driver
+ * may skip state validation that only depends on them. Note that the calls
+ * only record pointers, so the contents of resources may have changed.
+ */
+typedef void (*tc_begin_batch_func)(struct pipe_context *ctx, bool replay);
+
+/* Why the application thread had to wait for the driver thread. */
+enum tc_sync_reason {
+   TC_SYNC_FLUSH,
+   TC_SYNC_QUERY,
+   TC_SYNC_TRANSFER,
+   TC_SYNC_OTHER,
+   TC_NUM_SYNC_REASONS,
+};
+
 struct threaded_resource {
    struct pipe_resource b;
    const struct u_resource_vtbl *vtbl;
@@ -339,6 +357,7 @@ struct tc_unflushed_batch_token {
 
 struct tc_batch {
    struct pipe_context *pipe;
+   struct threaded_context *tc;
    unsigned sentinel;
    unsigned num_total_call_slots;
    struct tc_unflushed_batch_token *token;
@@ -354,12 +373,22 @@ struct threaded_context {
    tc_create_fence_func create_fence;
    unsigned map_buffer_alignment;
 
+   /* Optional, set by the driver after creation. The calls of the last
+    * executed batch are kept for it.
+    */
+   tc_begin_batch_func begin_batch;
+   struct tc_call *prev_calls;
+   unsigned prev_num_call_slots;
+
    struct list_head unflushed_queries;
 
    /* Counters for the HUD. */
    unsigned num_offloaded_slots;
    unsigned num_direct_slots;
    unsigned num_syncs;
+   unsigned num_syncs_by_reason[TC_NUM_SYNC_REASONS];
+   unsigned num_batches;
+   uint64_t sync_time_ns;
 
    struct util_queue queue;
    struct util_queue_fence *fence;
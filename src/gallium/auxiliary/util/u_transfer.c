@@ -2,6 +2,7 @@
 #include "util/u_surface.h"
 #include "util/u_inlines.h"
 #include "util/u_transfer.h"
+#include "util/u_upload_mgr.h"
 #include "util/u_memory.h"
 
 void u_default_buffer_subdata(struct pipe_context *pipe,
@@ -27,7 +28,36 @@ void u_default_buffer_subdata(struct pipe_context *pipe,
 
    u_box_1d(offset, size, &box);
 
-   map = pipe->transfer_map(pipe, resource, 0, usage, &box, &transfer);
+   /* If the range is still in use by the GPU, copy the data through the
+    * stream uploader instead of waiting.
+    */
+   if (!(usage & (PIPE_TRANSFER_UNSYNCHRONIZED |
+                  PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE)) &&
+       pipe->stream_uploader) {
+      map = pipe->transfer_map(pipe, resource, 0,
+                               usage | PIPE_TRANSFER_DONTBLOCK,
+                               &box, &transfer);
+      if (!map) {
+         struct pipe_resource *staging = NULL;
+         unsigned staging_offset;
+
+         u_upload_data(pipe->stream_uploader, 0, size, 4, data,
+                       &staging_offset, &staging);
+         if (staging) {
+            u_upload_unmap(pipe->stream_uploader);
+            u_box_1d(staging_offset, size, &box);
+            pipe->resource_copy_region(pipe, resource, 0, offset, 0, 0,
+                                       staging, 0, &box);
+            pipe_resource_reference(&staging, NULL);
+            return;
+         }
+
+         u_box_1d(offset, size, &box);
+      }
+   }
+
+   if (!map)
+      map = pipe->transfer_map(pipe, resource, 0, usage, &box, &transfer);
    if (!map)
       return;
 
@@ -32,6 +32,7 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
@@ -54,6 +55,18 @@ struct u_upload_mgr {
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
    unsigned flushed_size; /* Size we have flushed by transfer_flush_region. */
+
+   /* Ring mode: exhausted buffers stay mapped and are reused once the fence
+    * of the last flush that can reference them has signalled.
+    */
+   unsigned ring_size;     /* Maximum number of retired buffers, 0 = off. */
+   unsigned num_retired;
+   struct u_upload_retired_buffer {
+      struct pipe_resource *buffer;
+      struct pipe_transfer *transfer;
+      uint8_t *map;
+      struct pipe_fence_handle *fence;
+   } *retired;             /* Oldest first. */
 };
 
 
@@ -109,6 +122,8 @@ u_upload_clone(struct pipe_context *pipe, struct u_upload_mgr *upload)
    if (upload->map_persistent &&
        upload->map_flags & PIPE_TRANSFER_FLUSH_EXPLICIT)
       u_upload_enable_flush_explicit(result);
+   if (upload->ring_size)
+      u_upload_enable_ring(result, upload->ring_size);
 
    return result;
 }
@@ -121,6 +136,20 @@ u_upload_enable_flush_explicit(struct u_upload_mgr *upload)
    upload->map_flags |= PIPE_TRANSFER_FLUSH_EXPLICIT;
 }
 
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers)
+{
+   assert(!upload->ring_size && num_buffers);
+
+   /* Buffers are only kept mapped with persistent mappings. */
+   if (!upload->map_persistent)
+      return;
+
+   upload->retired = CALLOC(num_buffers, sizeof(*upload->retired));
+   if (upload->retired)
+      upload->ring_size = num_buffers;
+}
+
 static void
 upload_unmap_internal(struct u_upload_mgr *upload, boolean destroying)
 {
@@ -164,14 +193,102 @@ u_upload_release_buffer(struct u_upload_mgr *upload)
 }
 
 
+static void
+u_upload_release_retired(struct u_upload_mgr *upload, unsigned index)
+{
+   struct u_upload_retired_buffer *retired = &upload->retired[index];
+   struct pipe_screen *screen = upload->pipe->screen;
+
+   pipe_transfer_unmap(upload->pipe, retired->transfer);
+   pipe_resource_reference(&retired->buffer, NULL);
+   screen->fence_reference(screen, &retired->fence, NULL);
+}
+
+
 void
 u_upload_destroy(struct u_upload_mgr *upload)
 {
    u_upload_release_buffer(upload);
+
+   for (unsigned i = 0; i < upload->num_retired; i++)
+      u_upload_release_retired(upload, i);
+   FREE(upload->retired);
+
    FREE(upload);
 }
 
 
+/**
+ * Put the current buffer at the end of the ring, keeping it mapped.
+ *
+ * A deferred flush provides the fence, which doesn't submit anything on
+ * drivers that support it.
+ */
+static void
+u_upload_retire_buffer(struct u_upload_mgr *upload)
+{
+   struct pipe_fence_handle *fence = NULL;
+
+   /* Flush the written range for FLUSH_EXPLICIT mappings. */
+   upload_unmap_internal(upload, FALSE);
+
+   upload->pipe->flush(upload->pipe, &fence, PIPE_FLUSH_DEFERRED);
+   if (!fence) {
+      u_upload_release_buffer(upload);
+      return;
+   }
+
+   if (upload->num_retired == upload->ring_size) {
+      u_upload_release_retired(upload, 0);
+      memmove(&upload->retired[0], &upload->retired[1],
+              (upload->num_retired - 1) * sizeof(*upload->retired));
+      upload->num_retired--;
+   }
+
+   struct u_upload_retired_buffer *retired =
+      &upload->retired[upload->num_retired++];
+   retired->buffer = upload->buffer;
+   retired->transfer = upload->transfer;
+   retired->map = upload->map;
+   retired->fence = fence;
+
+   upload->buffer = NULL;
+   upload->transfer = NULL;
+   upload->map = NULL;
+   upload->flushed_size = 0;
+}
+
+
+/**
+ * Make the oldest retired buffer current if the GPU is done with it.
+ */
+static boolean
+u_upload_reuse_buffer(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+
+   if (!upload->num_retired)
+      return FALSE;
+
+   /* Don't pass the context, so that this never flushes. */
+   struct u_upload_retired_buffer *retired = &upload->retired[0];
+   if (!screen->fence_finish(screen, NULL, retired->fence, 0))
+      return FALSE;
+
+   screen->fence_reference(screen, &retired->fence, NULL);
+   upload->buffer = retired->buffer;
+   upload->transfer = retired->transfer;
+   upload->map = retired->map;
+   upload->offset = 0;
+   upload->flushed_size = 0;
+
+   upload->num_retired--;
+   memmove(&upload->retired[0], &upload->retired[1],
+           upload->num_retired * sizeof(*upload->retired));
+   return TRUE;
+}
+
+
 static void
 u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
 {
@@ -179,13 +296,26 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
    struct pipe_resource buffer;
    unsigned size;
 
+   size = align(MAX2(upload->default_size, min_size), 4096);
+
+   if (upload->ring_size) {
+      unsigned ring_buffer_size = align(upload->default_size, 4096);
+
+      /* Only buffers of the default size are recycled. */
+      if (upload->buffer && upload->transfer &&
+          upload->buffer->width0 == ring_buffer_size)
+         u_upload_retire_buffer(upload);
+
+      if (size == ring_buffer_size && u_upload_reuse_buffer(upload))
+         return;
+   }
+
    /* Release the old buffer, if present:
     */
    u_upload_release_buffer(upload);
 
    /* Allocate a new one:
     */
-   size = align(MAX2(upload->default_size, min_size), 4096);
 
    memset(&buffer, 0, sizeof buffer);
    buffer.target = PIPE_BUFFER;
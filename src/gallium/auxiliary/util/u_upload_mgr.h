@@ -73,6 +73,18 @@ u_upload_clone(struct pipe_context *pipe, struct u_upload_mgr *upload);
 void
 u_upload_enable_flush_explicit(struct u_upload_mgr *upload);
 
+/**
+ * Keep up to \p num_buffers exhausted upload buffers persistently mapped and
+ * reuse them once the GPU is done with them, instead of allocating and
+ * mapping a new buffer every time.
+ *
+ * This needs persistent mappings and is a no-op otherwise. Retiring a
+ * buffer does a deferred flush of the context to get a fence, so it should
+ * only be enabled for drivers that can defer flushes.
+ */
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers);
+
 /**
  * Destroy the upload manager.
  */
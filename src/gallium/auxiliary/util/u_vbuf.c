@@ -81,6 +81,13 @@
  * rate down.
  *
  *
+ * If enabled, translated vertices read from real buffers (as opposed to user
+ * buffers) are kept in a small cache of their own buffers, so that static
+ * vertex data in unsupported formats isn't translated again every draw.
+ * The user must call u_vbuf_invalidate_buffer when the contents of a vertex
+ * buffer change.
+ *
+ *
  * If there is nothing to do, it forwards every command to the driver.
  * The module also has its own CSO cache of vertex element states.
  */
@@ -140,6 +147,26 @@ enum {
    VB_NUM = 3
 };
 
+#define U_VBUF_TRANSLATION_CACHE_SIZE 16
+
+/* Vertices translated from real buffers, see u_vbuf_translate_buffers. */
+struct u_vbuf_translation {
+   struct translate_key key;
+   uint32_t vb_mask;
+   struct {
+      struct pipe_resource *resource;
+      unsigned buffer_offset;
+      unsigned stride;
+   } src[PIPE_MAX_ATTRIBS];
+   int start;
+   unsigned count;
+
+   struct pipe_resource *buffer;
+   unsigned buffer_offset;
+   unsigned last_used;
+   unsigned hits;
+};
+
 struct u_vbuf {
    struct u_vbuf_caps caps;
    bool has_signed_vb_offset;
@@ -180,6 +207,12 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Cache of translated vertices, NULL if disabled. */
+   struct u_vbuf_translation *translations;
+   unsigned translation_age;
+   unsigned translation_hits;
+   unsigned translations_wasted; /* dropped without ever being reused */
 };
 
 static void *
@@ -364,6 +397,127 @@ void u_vbuf_set_vertex_elements(struct u_vbuf *mgr, unsigned count,
    mgr->ve = u_vbuf_set_vertex_elements_internal(mgr, count, states);
 }
 
+/**
+ * Keep the vertices translated from real buffers and reuse them as long as
+ * the draw parameters match.  u_vbuf_invalidate_buffer must be called when
+ * the contents of the vertex buffers change.
+ */
+void u_vbuf_enable_translation_cache(struct u_vbuf *mgr)
+{
+   if (!mgr->translations)
+      mgr->translations = CALLOC(U_VBUF_TRANSLATION_CACHE_SIZE,
+                                 sizeof(*mgr->translations));
+}
+
+static void
+u_vbuf_release_translation(struct u_vbuf *mgr, struct u_vbuf_translation *t)
+{
+   unsigned mask = t->vb_mask;
+
+   if (t->buffer && !t->hits)
+      mgr->translations_wasted++;
+
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      pipe_resource_reference(&t->src[i].resource, NULL);
+   }
+   pipe_resource_reference(&t->buffer, NULL);
+   memset(t, 0, sizeof(*t));
+}
+
+/**
+ * Drop the translated vertices read from \p buffer, or all of them if it's
+ * NULL.
+ */
+void u_vbuf_invalidate_buffer(struct u_vbuf *mgr, struct pipe_resource *buffer)
+{
+   if (!mgr->translations)
+      return;
+
+   for (unsigned i = 0; i < U_VBUF_TRANSLATION_CACHE_SIZE; i++) {
+      struct u_vbuf_translation *t = &mgr->translations[i];
+      unsigned mask = t->vb_mask;
+      bool reads_buffer = !buffer;
+
+      while (mask && !reads_buffer)
+         reads_buffer = t->src[u_bit_scan(&mask)].resource == buffer;
+
+      if (t->buffer && reads_buffer)
+         u_vbuf_release_translation(mgr, t);
+   }
+}
+
+/* Give up if translated vertices keep changing before they are used again,
+ * e.g. because they are streamed, allocating a buffer for each of them is
+ * slower than uploading.
+ */
+static void
+u_vbuf_check_translation_cache(struct u_vbuf *mgr)
+{
+   if (mgr->translations &&
+       mgr->translations_wasted > 4 * U_VBUF_TRANSLATION_CACHE_SIZE &&
+       mgr->translations_wasted > mgr->translation_hits) {
+      u_vbuf_invalidate_buffer(mgr, NULL);
+      FREE(mgr->translations);
+      mgr->translations = NULL;
+   }
+}
+
+/* Persistently mapped buffers can change at any time. */
+static bool
+u_vbuf_can_cache_translation(struct u_vbuf *mgr, unsigned vb_mask)
+{
+   if (vb_mask & mgr->user_vb_mask)
+      return false;
+
+   while (vb_mask) {
+      struct pipe_resource *res =
+         mgr->vertex_buffer[u_bit_scan(&vb_mask)].buffer.resource;
+
+      if (!res || res->flags & PIPE_RESOURCE_FLAG_MAP_PERSISTENT)
+         return false;
+   }
+   return true;
+}
+
+static struct u_vbuf_translation *
+u_vbuf_find_translation(struct u_vbuf *mgr, const struct translate_key *key,
+                        unsigned vb_mask, int start, unsigned count)
+{
+   struct u_vbuf_translation *lru = &mgr->translations[0];
+
+   for (unsigned i = 0; i < U_VBUF_TRANSLATION_CACHE_SIZE; i++) {
+      struct u_vbuf_translation *t = &mgr->translations[i];
+      unsigned mask = vb_mask;
+      bool match = t->buffer && t->vb_mask == vb_mask &&
+                   t->start == start && t->count == count &&
+                   translate_key_compare(&t->key, key) == 0;
+
+      while (mask && match) {
+         unsigned vb_index = u_bit_scan(&mask);
+         const struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[vb_index];
+
+         match = t->src[vb_index].resource == vb->buffer.resource &&
+                 t->src[vb_index].buffer_offset == vb->buffer_offset &&
+                 t->src[vb_index].stride == vb->stride;
+      }
+
+      if (match) {
+         t->last_used = ++mgr->translation_age;
+         t->hits++;
+         mgr->translation_hits++;
+         return t;
+      }
+
+      if (t->last_used < lru->last_used)
+         lru = t;
+   }
+
+   /* Not found, return the entry to replace. */
+   u_vbuf_release_translation(mgr, lru);
+   return lru;
+}
+
 void u_vbuf_destroy(struct u_vbuf *mgr)
 {
    struct pipe_screen *screen = mgr->pipe->screen;
@@ -380,6 +534,11 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
 
    pipe_vertex_buffer_unreference(&mgr->vertex_buffer0_saved);
 
+   if (mgr->translations) {
+      u_vbuf_invalidate_buffer(mgr, NULL);
+      FREE(mgr->translations);
+   }
+
    translate_cache_destroy(mgr->translate_cache);
    cso_cache_delete(mgr->cso_cache);
    FREE(mgr);
@@ -395,9 +554,28 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
    struct translate *tr;
    struct pipe_transfer *vb_transfer[PIPE_MAX_ATTRIBS] = {0};
    struct pipe_resource *out_buffer = NULL;
+   struct u_vbuf_translation *cached = NULL;
+   const unsigned cached_count = num_vertices;
    uint8_t *out_map;
    unsigned out_offset, mask;
 
+   u_vbuf_check_translation_cache(mgr);
+
+   /* Without signed offsets, the vertices before start_vertex have to be
+    * allocated too, so don't cache those with a large start.
+    */
+   if (mgr->translations && !unroll_indices &&
+       u_vbuf_can_cache_translation(mgr, vb_mask) &&
+       (mgr->has_signed_vb_offset || start_vertex <= (int)num_vertices)) {
+      cached = u_vbuf_find_translation(mgr, key, vb_mask, start_vertex,
+                                       num_vertices);
+      if (cached->buffer) {
+         pipe_resource_reference(&out_buffer, cached->buffer);
+         out_offset = cached->buffer_offset;
+         goto done;
+      }
+   }
+
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
 
@@ -485,6 +663,50 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
       if (transfer) {
          pipe_buffer_unmap(mgr->pipe, transfer);
       }
+   } else if (cached) {
+      struct pipe_transfer *transfer = NULL;
+      unsigned start_offset = mgr->has_signed_vb_offset ?
+                                 0 : key->output_stride * start_vertex;
+      unsigned size = start_offset + key->output_stride * num_vertices;
+
+      /* Use a buffer of its own, upload buffers get recycled. */
+      out_buffer = pipe_buffer_create(mgr->pipe->screen,
+                                      PIPE_BIND_VERTEX_BUFFER,
+                                      PIPE_USAGE_IMMUTABLE, size);
+      if (out_buffer)
+         out_map = pipe_buffer_map_range(mgr->pipe, out_buffer, start_offset,
+                                         size - start_offset,
+                                         PIPE_TRANSFER_WRITE |
+                                         PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                                         &transfer);
+      if (!out_buffer || !out_map) {
+         pipe_resource_reference(&out_buffer, NULL);
+         cached = NULL;
+         goto unmap;
+      }
+
+      out_offset = start_offset - key->output_stride * start_vertex;
+
+      tr->run(tr, 0, num_vertices, 0, 0, out_map);
+      pipe_buffer_unmap(mgr->pipe, transfer);
+
+      memcpy(&cached->key, key, translate_keysize(key));
+      cached->vb_mask = vb_mask;
+      mask = vb_mask;
+      while (mask) {
+         unsigned i = u_bit_scan(&mask);
+         struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[i];
+
+         pipe_resource_reference(&cached->src[i].resource,
+                                 vb->buffer.resource);
+         cached->src[i].buffer_offset = vb->buffer_offset;
+         cached->src[i].stride = vb->stride;
+      }
+      cached->start = start_vertex;
+      cached->count = cached_count;
+      pipe_resource_reference(&cached->buffer, out_buffer);
+      cached->buffer_offset = out_offset;
+      cached->last_used = ++mgr->translation_age;
    } else {
       /* Create and map the output buffer. */
       u_upload_alloc(mgr->pipe->stream_uploader,
@@ -501,6 +723,8 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
       tr->run(tr, 0, num_vertices, 0, 0, out_map);
    }
 
+unmap:
+
    /* Unmap all buffers. */
    mask = vb_mask;
    while (mask) {
@@ -511,6 +735,10 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
       }
    }
 
+   if (!out_buffer)
+      return PIPE_ERROR_OUT_OF_MEMORY;
+
+done:
    /* Setup the new vertex buffer. */
    mgr->real_vertex_buffer[out_vb].buffer_offset = out_offset;
    mgr->real_vertex_buffer[out_vb].stride = key->output_stride;
@@ -41,6 +41,8 @@ struct cso_context;
 struct u_vbuf;
 
 #define U_VBUF_FLAG_NO_USER_VBOS (1 << 0)
+/* The user calls u_vbuf_invalidate_buffer when vertex buffers change. */
+#define U_VBUF_FLAG_CACHE_TRANSLATIONS (1 << 1)
 
 /* Hardware vertex fetcher limitations can be described by this structure. */
 struct u_vbuf_caps {
@@ -64,6 +66,8 @@ struct u_vbuf *
 u_vbuf_create(struct pipe_context *pipe, struct u_vbuf_caps *caps);
 
 void u_vbuf_destroy(struct u_vbuf *mgr);
+void u_vbuf_enable_translation_cache(struct u_vbuf *mgr);
+void u_vbuf_invalidate_buffer(struct u_vbuf *mgr, struct pipe_resource *buffer);
 
 /* State and draw functions. */
 void u_vbuf_set_vertex_elements(struct u_vbuf *mgr, unsigned count,
@@ -174,6 +174,11 @@ etna_copy_resource(struct pipe_context *pctx, struct pipe_resource *dst,
 
    /* Copy each level and each layer */
    for (int level = first_level; level <= last_level; level++) {
+      /* A resolve-in-place only has to write back the tiles the TS holds,
+       * levels without a valid TS are already up to date in memory. */
+      if (src == dst && !src_priv->levels[level].ts_valid)
+         continue;
+
       blit.src.level = blit.dst.level = level;
       blit.src.box.width = blit.dst.box.width =
          MIN2(src_priv->levels[level].padded_width, dst_priv->levels[level].padded_width);
@@ -2138,8 +2138,8 @@ fill_in_vs_inputs(struct etna_shader_variant *sobj, struct etna_compile *c)
 }
 
 /* build two-level output index [Semantic][Index] for fast linking */
-static void
-build_output_index(struct etna_shader_variant *sobj)
+void
+etna_build_output_index(struct etna_shader_variant *sobj)
 {
    int total = 0;
    int offset = 0;
@@ -2191,7 +2191,7 @@ fill_in_vs_outputs(struct etna_shader_variant *sobj, struct etna_compile *c)
    }
 
    /* build two-level index for linking */
-   build_output_index(sobj);
+   etna_build_output_index(sobj);
 
    /* fill in "mystery meat" load balancing value. This value determines how
     * work is scheduled between VS and PS
@@ -53,6 +53,7 @@
 #define ETNA_DBG_DRAW_STALL      0x400000 /* Stall FE/PE after every draw op */
 #define ETNA_DBG_SHADERDB        0x800000 /* dump program compile information */
 #define ETNA_DBG_NO_SINGLEBUF    0x1000000 /* disable single buffer feature */
+#define ETNA_DBG_NOCACHE         0x2000000 /* disable the shader disk cache */
 
 extern int etna_mesa_debug; /* set in etna_screen.c from ETNA_DEBUG */
 
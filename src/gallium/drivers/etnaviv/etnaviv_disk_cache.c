@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2019 Etnaviv Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sub license,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "etnaviv_disk_cache.h"
+
+#include "etnaviv_compiler.h"
+#include "etnaviv_debug.h"
+#include "etnaviv_screen.h"
+#include "etnaviv_uniforms.h"
+
+#include "compiler/blob.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+#include "util/u_memory.h"
+
+/*
+ * Shader disk cache:
+ *
+ * Compiled variants are cached by the hash of the TGSI tokens of the shader
+ * plus the variant key.  The cache entry holds everything the compiler fills
+ * in the variant, so a hit skips the TGSI lowering and translation entirely.
+ */
+
+void
+etna_disk_cache_init(struct etna_screen *screen)
+{
+#ifdef HAVE_DLFCN_H
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char cache_id[20 * 2 + 1];
+   char renderer[32];
+
+   if (DBG_ENABLED(ETNA_DBG_NOCACHE))
+      return;
+
+   _mesa_sha1_init(&ctx);
+
+   if (!disk_cache_get_function_identifier(etna_disk_cache_init, &ctx))
+      return;
+
+   /* the compiler output depends on the specs, which also include the
+    * effect of the debug options:
+    */
+   _mesa_sha1_update(&ctx, &screen->specs, sizeof(screen->specs));
+   _mesa_sha1_final(&ctx, sha1);
+   disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+   snprintf(renderer, sizeof(renderer), "GC%x_%04x", screen->model,
+            screen->revision);
+
+   screen->disk_cache = disk_cache_create(renderer, cache_id, 0);
+#endif
+}
+
+static void
+compute_shader_key(struct etna_shader *shader)
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, shader->tokens,
+                     tgsi_num_tokens(shader->tokens) * sizeof(struct tgsi_token));
+   _mesa_sha1_final(&ctx, shader->cache_key);
+
+   shader->cache_key_valid = true;
+}
+
+static void
+compute_variant_key(struct etna_screen *screen,
+                    const struct etna_shader_variant *v, cache_key cache_key)
+{
+   struct etna_shader *shader = v->shader;
+   struct blob blob;
+
+   if (!shader->cache_key_valid)
+      compute_shader_key(shader);
+
+   blob_init(&blob);
+   blob_write_bytes(&blob, shader->cache_key, sizeof(shader->cache_key));
+   blob_write_uint32(&blob, v->key.global);
+
+   disk_cache_compute_key(screen->disk_cache, blob.data, blob.size, cache_key);
+
+   blob_finish(&blob);
+}
+
+static bool
+use_cache(struct etna_screen *screen)
+{
+   if (!screen || !screen->disk_cache)
+      return false;
+
+   /* the compiler messages are only printed when actually compiling: */
+   if (DBG_ENABLED(ETNA_DBG_COMPILER_MSGS))
+      return false;
+
+   return true;
+}
+
+static void
+write_variant(struct blob *blob, const struct etna_shader_variant *v)
+{
+   blob_write_uint32(blob, v->processor);
+   blob_write_uint32(blob, v->code_size);
+   blob_write_bytes(blob, v->code, v->code_size * 4);
+   blob_write_uint32(blob, v->num_loops);
+   blob_write_uint32(blob, v->num_temps);
+
+   blob_write_uint32(blob, v->uniforms.const_count);
+   blob_write_uint32(blob, v->uniforms.imm_count);
+   blob_write_bytes(blob, v->uniforms.imm_data,
+                    v->uniforms.imm_count * sizeof(*v->uniforms.imm_data));
+   blob_write_bytes(blob, v->uniforms.imm_contents,
+                    v->uniforms.imm_count * sizeof(*v->uniforms.imm_contents));
+
+   blob_write_bytes(blob, &v->infile, sizeof(v->infile));
+   blob_write_bytes(blob, &v->outfile, sizeof(v->outfile));
+   blob_write_bytes(blob, v->output_count_per_semantic,
+                    sizeof(v->output_count_per_semantic));
+
+   blob_write_uint32(blob, v->vs_pos_out_reg);
+   blob_write_uint32(blob, v->vs_pointsize_out_reg);
+   blob_write_uint32(blob, v->vs_load_balancing);
+   blob_write_uint32(blob, v->ps_color_out_reg);
+   blob_write_uint32(blob, v->ps_depth_out_reg);
+   blob_write_uint32(blob, v->input_count_unk8);
+   blob_write_uint32(blob, v->needs_icache);
+}
+
+static bool
+read_variant(struct blob_reader *blob, struct etna_shader_variant *v)
+{
+   v->processor = blob_read_uint32(blob);
+   v->code_size = blob_read_uint32(blob);
+   v->code = MALLOC(v->code_size * 4);
+   if (!v->code)
+      return false;
+   blob_copy_bytes(blob, v->code, v->code_size * 4);
+   v->num_loops = blob_read_uint32(blob);
+   v->num_temps = blob_read_uint32(blob);
+
+   v->uniforms.const_count = blob_read_uint32(blob);
+   v->uniforms.imm_count = blob_read_uint32(blob);
+   if (blob->overrun)
+      return false;
+   v->uniforms.imm_data =
+      MALLOC(v->uniforms.imm_count * sizeof(*v->uniforms.imm_data));
+   v->uniforms.imm_contents =
+      MALLOC(v->uniforms.imm_count * sizeof(*v->uniforms.imm_contents));
+   if (v->uniforms.imm_count &&
+       (!v->uniforms.imm_data || !v->uniforms.imm_contents))
+      return false;
+   blob_copy_bytes(blob, v->uniforms.imm_data,
+                   v->uniforms.imm_count * sizeof(*v->uniforms.imm_data));
+   blob_copy_bytes(blob, v->uniforms.imm_contents,
+                   v->uniforms.imm_count * sizeof(*v->uniforms.imm_contents));
+
+   blob_copy_bytes(blob, &v->infile, sizeof(v->infile));
+   blob_copy_bytes(blob, &v->outfile, sizeof(v->outfile));
+   blob_copy_bytes(blob, v->output_count_per_semantic,
+                   sizeof(v->output_count_per_semantic));
+
+   v->vs_pos_out_reg = blob_read_uint32(blob);
+   v->vs_pointsize_out_reg = blob_read_uint32(blob);
+   v->vs_load_balancing = blob_read_uint32(blob);
+   v->ps_color_out_reg = blob_read_uint32(blob);
+   v->ps_depth_out_reg = blob_read_uint32(blob);
+   v->input_count_unk8 = blob_read_uint32(blob);
+   v->needs_icache = blob_read_uint32(blob);
+
+   if (blob->overrun || blob->current != blob->end)
+      return false;
+
+   if (v->processor == PIPE_SHADER_VERTEX)
+      etna_build_output_index(v);
+   etna_set_shader_uniforms_dirty_flags(v);
+
+   return true;
+}
+
+/**
+ * Look up the variant in the disk cache.  On a hit, the compiled state is
+ * filled in v and true returned, otherwise the variant needs compiling.
+ */
+bool
+etna_disk_cache_retrieve(struct etna_screen *screen,
+                         struct etna_shader_variant *v)
+{
+   cache_key cache_key;
+   size_t size;
+
+   if (!use_cache(screen))
+      return false;
+
+   compute_variant_key(screen, v, cache_key);
+
+   void *buffer = disk_cache_get(screen->disk_cache, cache_key, &size);
+   if (!buffer)
+      return false;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, buffer, size);
+
+   bool found = read_variant(&blob, v);
+   if (!found) {
+      /* leave the variant as if nothing was found: */
+      FREE(v->code);
+      FREE(v->uniforms.imm_data);
+      FREE(v->uniforms.imm_contents);
+      FREE(v->output_per_semantic_list);
+      v->code = NULL;
+      v->uniforms.imm_data = NULL;
+      v->uniforms.imm_contents = NULL;
+      v->output_per_semantic_list = NULL;
+   }
+
+   free(buffer);
+   return found;
+}
+
+/**
+ * Store a freshly compiled variant in the disk cache.
+ */
+void
+etna_disk_cache_store(struct etna_screen *screen,
+                      const struct etna_shader_variant *v)
+{
+   cache_key cache_key;
+   struct blob blob;
+
+   if (!use_cache(screen))
+      return;
+
+   compute_variant_key(screen, v, cache_key);
+
+   blob_init(&blob);
+   write_variant(&blob, v);
+
+   if (!blob.out_of_memory)
+      disk_cache_put(screen->disk_cache, cache_key, blob.data, blob.size, NULL);
+
+   blob_finish(&blob);
+}
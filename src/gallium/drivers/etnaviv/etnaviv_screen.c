@@ -32,12 +32,14 @@
 #include "etnaviv_compiler.h"
 #include "etnaviv_context.h"
 #include "etnaviv_debug.h"
+#include "etnaviv_disk_cache.h"
 #include "etnaviv_fence.h"
 #include "etnaviv_format.h"
 #include "etnaviv_query.h"
 #include "etnaviv_resource.h"
 #include "etnaviv_translate.h"
 
+#include "util/disk_cache.h"
 #include "util/hash_table.h"
 #include "util/os_time.h"
 #include "util/u_math.h"
@@ -72,6 +74,7 @@ static const struct debug_named_value debug_options[] = {
    {"draw_stall",     ETNA_DBG_DRAW_STALL, "Stall FE/PE after each rendered primitive"},
    {"shaderdb",       ETNA_DBG_SHADERDB, "Enable shaderdb output"},
    {"no_singlebuffer",ETNA_DBG_NO_SINGLEBUF, "Disable single buffer feature"},
+   {"nocache",        ETNA_DBG_NOCACHE, "Disable the shader disk cache"},
    DEBUG_NAMED_VALUE_END
 };
 
@@ -86,6 +89,8 @@ etna_screen_destroy(struct pipe_screen *pscreen)
    _mesa_set_destroy(screen->used_resources, NULL);
    mtx_destroy(&screen->lock);
 
+   disk_cache_destroy(screen->disk_cache);
+
    if (screen->perfmon)
       etna_perfmon_del(screen->perfmon);
 
@@ -104,6 +109,14 @@ etna_screen_destroy(struct pipe_screen *pscreen)
    FREE(screen);
 }
 
+static struct disk_cache *
+etna_screen_get_disk_shader_cache(struct pipe_screen *pscreen)
+{
+   struct etna_screen *screen = etna_screen(pscreen);
+
+   return screen->disk_cache;
+}
+
 static const char *
 etna_screen_get_name(struct pipe_screen *pscreen)
 {
@@ -999,6 +1012,8 @@ etna_screen_create(struct etna_device *dev, struct etna_gpu *gpu,
    if (DBG_ENABLED(ETNA_DBG_NO_SINGLEBUF))
       screen->specs.single_buffer = 0;
 
+   etna_disk_cache_init(screen);
+
    pscreen->destroy = etna_screen_destroy;
    pscreen->get_param = etna_screen_get_param;
    pscreen->get_paramf = etna_screen_get_paramf;
@@ -1009,6 +1024,7 @@ etna_screen_create(struct etna_device *dev, struct etna_gpu *gpu,
    pscreen->get_device_vendor = etna_screen_get_device_vendor;
 
    pscreen->get_timestamp = etna_screen_get_timestamp;
+   pscreen->get_disk_shader_cache = etna_screen_get_disk_shader_cache;
    pscreen->context_create = etna_context_create;
    pscreen->is_format_supported = etna_screen_is_format_supported;
    pscreen->query_dmabuf_modifiers = etna_screen_query_dmabuf_modifiers;
@@ -81,6 +81,8 @@ struct etna_screen {
 
    struct etna_specs specs;
 
+   struct disk_cache *disk_cache;
+
    uint32_t drm_version;
 
    /* set of resources used by currently-unsubmitted renders */
@@ -29,6 +29,7 @@
 #include "etnaviv_compiler.h"
 #include "etnaviv_context.h"
 #include "etnaviv_debug.h"
+#include "etnaviv_disk_cache.h"
 #include "etnaviv_screen.h"
 #include "etnaviv_util.h"
 
@@ -327,10 +328,14 @@ create_variant(struct etna_shader *shader, struct etna_shader_key key)
    v->shader = shader;
    v->key = key;
 
-   ret = etna_compile_shader(v);
-   if (!ret) {
-      debug_error("compile failed!");
-      goto fail;
+   if (!etna_disk_cache_retrieve(shader->screen, v)) {
+      ret = etna_compile_shader(v);
+      if (!ret) {
+         debug_error("compile failed!");
+         goto fail;
+      }
+
+      etna_disk_cache_store(shader->screen, v);
    }
 
    v->id = ++shader->variant_count;
@@ -376,6 +381,7 @@ etna_create_shader_state(struct pipe_context *pctx,
    static uint32_t id;
    shader->id = id++;
    shader->specs = &ctx->specs;
+   shader->screen = ctx->screen;
    shader->tokens = tgsi_dup_tokens(pss->tokens);
 
    if (etna_mesa_debug & ETNA_DBG_SHADERDB) {
@@ -30,6 +30,7 @@
 #include "pipe/p_state.h"
 
 struct etna_context;
+struct etna_screen;
 struct etna_shader_variant;
 
 struct etna_shader_key
@@ -62,6 +63,11 @@ struct etna_shader {
 
     struct tgsi_token *tokens;
     const struct etna_specs *specs;
+    struct etna_screen *screen;
+
+    /* hash of the tokens, for the disk cache: */
+    bool cache_key_valid;
+    uint8_t cache_key[20];
 
     struct etna_shader_variant *variants;
 };
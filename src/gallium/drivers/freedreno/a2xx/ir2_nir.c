@@ -66,7 +66,7 @@ ir2_optimize_loop(nir_shader *s)
 		progress |= OPT(s, nir_copy_prop);
 		progress |= OPT(s, nir_opt_dce);
 		progress |= OPT(s, nir_opt_cse);
-		/* progress |= OPT(s, nir_opt_gcm, true); */
+		/* progress |= OPT(s, nir_opt_gcm, true, 0); */
 		progress |= OPT(s, nir_opt_peephole_select, UINT_MAX, true, true);
 		progress |= OPT(s, nir_opt_intrinsics);
 		progress |= OPT(s, nir_opt_algebraic);
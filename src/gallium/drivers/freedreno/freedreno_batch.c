@@ -84,6 +84,7 @@ batch_init(struct fd_batch *batch)
 	batch->gmem_reason = 0;
 	batch->num_draws = 0;
 	batch->num_vertices = 0;
+	batch->num_draw_bounds = 0;
 	batch->stage = FD_STAGE_NULL;
 
 	fd_reset_wfi(batch);
@@ -443,8 +444,11 @@ flush_write_batch(struct fd_resource *rsc)
 	fd_batch_reference_locked(&b, NULL);
 }
 
+/* slow-path of fd_batch_resource_used(), for the first use of the resource
+ * in the batch, a write after a read, or a resource with separate stencil:
+ */
 void
-fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc, bool write)
+__fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc, bool write)
 {
 	pipe_mutex_assert_locked(batch->ctx->screen->lock);
 
@@ -132,6 +132,15 @@ struct fd_batch {
 	 */
 	struct pipe_scissor_state max_scissor;
 
+	/* Bounds of the draws within the batch, so that tiles which none of
+	 * the draws touch can be skipped entirely.  Consecutive draws with the
+	 * same scissor share an entry, and once the array is full the last
+	 * entry grows to cover the remaining draws.
+	 */
+#define FD_MAX_DRAW_BOUNDS 16
+	struct pipe_scissor_state draw_bounds[FD_MAX_DRAW_BOUNDS];
+	unsigned num_draw_bounds;
+
 	/* Keep track of DRAW initiators that need to be patched up depending
 	 * on whether we using binning or not:
 	 */
@@ -227,12 +236,12 @@ void fd_batch_reset(struct fd_batch *batch);
 void fd_batch_sync(struct fd_batch *batch);
 void fd_batch_flush(struct fd_batch *batch, bool sync, bool force);
 void fd_batch_add_dep(struct fd_batch *batch, struct fd_batch *dep);
-void fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc, bool write);
 void fd_batch_check_size(struct fd_batch *batch);
 
 /* not called directly: */
 void __fd_batch_describe(char* buf, const struct fd_batch *batch);
 void __fd_batch_destroy(struct fd_batch *batch);
+void __fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc, bool write);
 
 /*
  * NOTE the rule is, you need to hold the screen->lock when destroying
@@ -178,6 +178,9 @@ fd_context_destroy(struct pipe_context *pctx)
 
 	slab_destroy_child(&ctx->transfer_pool);
 
+	for (i = 0; i < ARRAY_SIZE(ctx->constbuf); i++)
+		free(ctx->constbuf[i].user_data);
+
 	for (i = 0; i < ARRAY_SIZE(ctx->vsc_pipe); i++) {
 		struct fd_vsc_pipe *pipe = &ctx->vsc_pipe[i];
 		if (!pipe->bo)
@@ -61,6 +61,12 @@ struct fd_program_stateobj {
 struct fd_constbuf_stateobj {
 	struct pipe_constant_buffer cb[PIPE_MAX_CONSTANT_BUFFERS];
 	uint32_t enabled_mask;
+
+	/* copy of the last user consts bound to cb[0], to skip re-emitting
+	 * them when the state tracker rebinds the same values:
+	 */
+	void *user_data;
+	unsigned user_data_size;
 };
 
 struct fd_shaderbuf_stateobj {
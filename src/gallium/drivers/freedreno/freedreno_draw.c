@@ -58,6 +58,41 @@ resource_written(struct fd_batch *batch, struct pipe_resource *prsc)
 	fd_batch_resource_used(batch, fd_resource(prsc), true);
 }
 
+static void
+add_draw_bounds(struct fd_batch *batch, const struct pipe_scissor_state *bounds)
+{
+	if (batch->num_draw_bounds > 0) {
+		struct pipe_scissor_state *last =
+			&batch->draw_bounds[batch->num_draw_bounds - 1];
+
+		if (!memcmp(last, bounds, sizeof(*last)))
+			return;
+
+		if (batch->num_draw_bounds == FD_MAX_DRAW_BOUNDS) {
+			last->minx = MIN2(last->minx, bounds->minx);
+			last->miny = MIN2(last->miny, bounds->miny);
+			last->maxx = MAX2(last->maxx, bounds->maxx);
+			last->maxy = MAX2(last->maxy, bounds->maxy);
+			return;
+		}
+	}
+
+	batch->draw_bounds[batch->num_draw_bounds++] = *bounds;
+}
+
+static void
+add_fb_bounds(struct fd_batch *batch)
+{
+	struct pipe_scissor_state bounds = {
+		.minx = 0,
+		.miny = 0,
+		.maxx = batch->framebuffer.width,
+		.maxy = batch->framebuffer.height,
+	};
+
+	add_draw_bounds(batch, &bounds);
+}
+
 static void
 fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 {
@@ -96,6 +131,13 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 		if (ctx->streamout.num_targets > 0)
 			debug_error("stream-out with emulated prims");
 		util_primconvert_save_rasterizer_state(ctx->primconvert, ctx->rasterizer);
+		if (has_compute(ctx->screen)) {
+			struct fd_constbuf_stateobj *cb = &ctx->constbuf[PIPE_SHADER_COMPUTE];
+			struct fd_shaderbuf_stateobj *sb = &ctx->shaderbuf[PIPE_SHADER_COMPUTE];
+
+			util_primconvert_save_compute_state(ctx->primconvert, ctx->compute,
+					(cb->enabled_mask & 1) ? &cb->cb[0] : NULL, sb->sb, 0x7);
+		}
 		util_primconvert_draw_vbo(ctx->primconvert, info);
 		return;
 	}
@@ -282,6 +324,15 @@ fd_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
 	/* and any buffers used, need to be resolved: */
 	batch->resolve |= buffers;
 
+	/* the draw can't touch anything outside of the scissor, but streamout
+	 * and queries have to see it in every tile:
+	 */
+	if (ctx->streamout.num_targets > 0 ||
+			!list_empty(&ctx->acc_active_queries))
+		add_fb_bounds(batch);
+	else
+		add_draw_bounds(batch, fd_context_get_scissor(ctx));
+
 	DBG("%p: %x %ux%u num_draws=%u (%s/%s)", batch, buffers,
 		pfb->width, pfb->height, batch->num_draws,
 		util_format_short_name(pipe_surface_format(pfb->cbufs[0])),
@@ -332,6 +383,7 @@ fd_clear(struct pipe_context *pctx, unsigned buffers,
 	batch->max_scissor.miny = 0;
 	batch->max_scissor.maxx = pfb->width;
 	batch->max_scissor.maxy = pfb->height;
+	add_fb_bounds(batch);
 
 	/* for bookkeeping about which buffers have been cleared (and thus
 	 * can fully or partially skip mem2gmem) we need to ignore buffers
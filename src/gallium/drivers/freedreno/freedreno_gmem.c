@@ -173,7 +173,7 @@ calculate_tiles(struct fd_batch *batch)
 	 */
 	while (bin_w > max_width) {
 		nbins_x++;
-		bin_w = align(width / nbins_x, gmem_alignw);
+		bin_w = align(DIV_ROUND_UP(width, nbins_x), gmem_alignw);
 	}
 
 	if (fd_mesa_debug & FD_DBG_MSGS) {
@@ -198,13 +198,22 @@ calculate_tiles(struct fd_batch *batch)
 		   gmem_size) {
 		if (bin_w > bin_h) {
 			nbins_x++;
-			bin_w = align(width / nbins_x, gmem_alignw);
+			bin_w = align(DIV_ROUND_UP(width, nbins_x), gmem_alignw);
 		} else {
 			nbins_y++;
-			bin_h = align(height / nbins_y, gmem_alignh);
+			bin_h = align(DIV_ROUND_UP(height, nbins_y), gmem_alignh);
 		}
 	}
 
+	/* rounding the bin size up to the alignment can leave the last row or
+	 * column of bins empty, so recompute the number of bins actually needed
+	 * with the final size:
+	 */
+	if (bin_w && bin_h) {
+		nbins_x = DIV_ROUND_UP(width, bin_w);
+		nbins_y = DIV_ROUND_UP(height, bin_h);
+	}
+
 	DBG("using %d bins of size %dx%d", nbins_x*nbins_y, bin_w, bin_h);
 
 	gmem->scissor = *scissor;
@@ -339,11 +348,35 @@ calculate_tiles(struct fd_batch *batch)
 #endif
 }
 
+/* Can the tile be skipped entirely, because none of the draws (or clears)
+ * in the batch touch it?
+ */
+static bool
+skip_tile(struct fd_batch *batch, struct fd_tile *tile)
+{
+	/* hw queries sample each tile into their own slot: */
+	if (batch->query_tile_stride)
+		return false;
+
+	for (unsigned i = 0; i < batch->num_draw_bounds; i++) {
+		const struct pipe_scissor_state *bounds = &batch->draw_bounds[i];
+
+		if ((bounds->minx < tile->xoff + tile->bin_w) &&
+				(bounds->maxx > tile->xoff) &&
+				(bounds->miny < tile->yoff + tile->bin_h) &&
+				(bounds->maxy > tile->yoff))
+			return false;
+	}
+
+	return true;
+}
+
 static void
 render_tiles(struct fd_batch *batch)
 {
 	struct fd_context *ctx = batch->ctx;
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
+	bool no_skip = !!(fd_mesa_debug & FD_DBG_NOSCIS);
 	int i;
 
 	ctx->emit_tile_init(batch);
@@ -354,6 +387,12 @@ render_tiles(struct fd_batch *batch)
 	for (i = 0; i < (gmem->nbins_x * gmem->nbins_y); i++) {
 		struct fd_tile *tile = &ctx->tile[i];
 
+		if (!no_skip && skip_tile(batch, tile)) {
+			DBG("skipping bin_h=%d, yoff=%d, bin_w=%d, xoff=%d",
+				tile->bin_h, tile->yoff, tile->bin_w, tile->xoff);
+			continue;
+		}
+
 		DBG("bin_h=%d, yoff=%d, bin_w=%d, xoff=%d",
 			tile->bin_h, tile->yoff, tile->bin_w, tile->xoff);
 
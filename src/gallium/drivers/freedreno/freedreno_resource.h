@@ -139,6 +139,30 @@ pending(struct fd_resource *rsc, bool write)
 	return false;
 }
 
+/* Track the use of a resource by a batch.  Resources are usually referenced
+ * by many draws in the same batch, so the common case of a resource already
+ * used the same way by this batch is just a check of rsc->batch_mask, and
+ * the dependency tracking is left to __fd_batch_resource_used().
+ */
+static inline void
+fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc, bool write)
+{
+	pipe_mutex_assert_locked(batch->ctx->screen->lock);
+
+	if (likely(!rsc->stencil && (rsc->batch_mask & (1 << batch->idx)))) {
+		if (write) {
+			if (rsc->write_batch == batch) {
+				rsc->valid = true;
+				return;
+			}
+		} else if (!rsc->write_batch || rsc->write_batch == batch) {
+			return;
+		}
+	}
+
+	__fd_batch_resource_used(batch, rsc, write);
+}
+
 struct fd_transfer {
 	struct pipe_transfer base;
 	struct pipe_resource *staging_prsc;
@@ -58,6 +58,7 @@
 #include "a6xx/fd6_screen.h"
 
 
+#include "ir3/ir3_compiler.h"
 #include "ir3/ir3_nir.h"
 #include "a2xx/ir2.h"
 
@@ -157,7 +158,8 @@ fd_screen_destroy(struct pipe_screen *pscreen)
 
 	mtx_destroy(&screen->lock);
 
-	ralloc_free(screen->compiler);
+	if (screen->compiler)
+		ir3_compiler_destroy(screen->compiler);
 
 	free(screen->perfcntr_queries);
 	free(screen);
@@ -659,6 +661,17 @@ fd_get_compiler_options(struct pipe_screen *pscreen,
 	return ir2_get_compiler_options();
 }
 
+static struct disk_cache *
+fd_get_disk_shader_cache(struct pipe_screen *pscreen)
+{
+	struct fd_screen *screen = fd_screen(pscreen);
+
+	if (is_ir3(screen))
+		return screen->compiler->disk_cache;
+
+	return NULL;
+}
+
 boolean
 fd_screen_bo_get_handle(struct pipe_screen *pscreen,
 		struct fd_bo *bo,
@@ -880,6 +893,9 @@ fd_screen_create(struct fd_device *dev, struct renderonly *ro)
 		goto fail;
 	}
 
+	if (is_ir3(screen))
+		ir3_disk_cache_init(screen->compiler);
+
 	if (screen->gpu_id >= 600) {
 		screen->gmem_alignw = 32;
 		screen->gmem_alignh = 32;
@@ -911,6 +927,7 @@ fd_screen_create(struct fd_device *dev, struct renderonly *ro)
 	pscreen->get_shader_param = fd_screen_get_shader_param;
 	pscreen->get_compute_param = fd_get_compute_param;
 	pscreen->get_compiler_options = fd_get_compiler_options;
+	pscreen->get_disk_shader_cache = fd_get_disk_shader_cache;
 
 	fd_resource_screen_init(pscreen);
 	fd_query_screen_init(pscreen);
@@ -109,9 +109,33 @@ fd_set_constant_buffer(struct pipe_context *pctx,
 	 */
 	if (unlikely(!cb)) {
 		so->enabled_mask &= ~(1 << index);
+		if (index == 0)
+			so->user_data_size = 0;
 		return;
 	}
 
+	/* The state tracker uploads the user consts on every draw that
+	 * something changed in, even if that something isn't the consts of
+	 * this stage.  Since the consts get emitted in full whenever they
+	 * are dirty, skip that if the values are the same as last time:
+	 */
+	if (index == 0 && cb->user_buffer) {
+		if ((so->enabled_mask & 1) &&
+				(so->user_data_size == cb->buffer_size) &&
+				!memcmp(so->user_data, cb->user_buffer, cb->buffer_size))
+			return;
+
+		so->user_data = realloc(so->user_data, cb->buffer_size);
+		if (so->user_data) {
+			memcpy(so->user_data, cb->user_buffer, cb->buffer_size);
+			so->user_data_size = cb->buffer_size;
+		} else {
+			so->user_data_size = 0;
+		}
+	} else if (index == 0) {
+		so->user_data_size = 0;
+	}
+
 	so->enabled_mask |= 1 << index;
 	ctx->dirty_shader[shader] |= FD_DIRTY_SHADER_CONST;
 	ctx->dirty |= FD_DIRTY_CONST;
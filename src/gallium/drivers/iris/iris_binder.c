@@ -45,6 +45,12 @@
  *
  * This does mean that we have to emit STATE_BASE_ADDRESS and stall when
  * we run out of space in the binder, which hopefully won't happen too often.
+ *
+ * Binding changes often leave a stage with the same surfaces as before (say,
+ * rebinding the same textures, or a resolve which didn't change anything).
+ * New tables are compared against the one the hardware already points at,
+ * and if they match we keep using the old table, give the space back if
+ * possible, and skip re-emitting the binding table pointer.
  */
 
 #include <stdlib.h>
@@ -91,6 +97,9 @@ binder_realloc(struct iris_context *ice)
    binder->map = iris_bo_map(NULL, binder->bo, MAP_WRITE);
    binder->insert_point = INIT_INSERT_POINT;
 
+   /* The old tables are gone along with the old binder. */
+   iris_binder_forget_tables(binder);
+
    /* Allocating a new binder requires changing Surface State Base Address,
     * which also invalidates all our previous binding tables - each entry
     * in those tables is an offset from the old base.
@@ -185,6 +194,7 @@ iris_binder_reserve_3d(struct iris_context *ice)
 
    for (int stage = 0; stage <= MESA_SHADER_FRAGMENT; stage++) {
       if (ice->state.dirty & (IRIS_DIRTY_BINDINGS_VS << stage)) {
+         binder->prev_bt_offset[stage] = binder->bt_offset[stage];
          binder->bt_offset[stage] = sizes[stage] > 0 ? offset : 0;
          offset += sizes[stage];
       }
@@ -206,7 +216,56 @@ iris_binder_reserve_compute(struct iris_context *ice)
    if (size == 0)
       return;
 
-   binder->bt_offset[MESA_SHADER_COMPUTE] = iris_binder_reserve(ice, size);
+   uint32_t offset = iris_binder_reserve(ice, size);
+
+   binder->prev_bt_offset[MESA_SHADER_COMPUTE] =
+      binder->bt_offset[MESA_SHADER_COMPUTE];
+   binder->bt_offset[MESA_SHADER_COMPUTE] = offset;
+}
+
+/**
+ * Check whether the binding table just populated for a shader stage is
+ * identical to the one the hardware is already pointing at.  If so, switch
+ * back to the previous table, and return the new table's space if it was
+ * the last allocation in the binder.
+ *
+ * Returns true if the previous table was reused, in which case the binding
+ * table pointer doesn't need to be re-emitted.
+ */
+bool
+iris_binder_reuse_table(struct iris_binder *binder,
+                        gl_shader_stage stage, unsigned size)
+{
+   uint32_t offset = binder->bt_offset[stage];
+   uint32_t prev_offset = binder->prev_bt_offset[stage];
+   uint32_t prev_size = binder->bt_size[stage];
+
+   binder->bt_size[stage] = size;
+
+   if (size == 0 || offset == 0 || prev_offset == 0 || prev_size != size ||
+       prev_offset == offset)
+      return false;
+
+   if (memcmp(binder->map + offset, binder->map + prev_offset, size) != 0)
+      return false;
+
+   if (offset + align(size, BTP_ALIGNMENT) == binder->insert_point)
+      binder->insert_point = offset;
+
+   binder->bt_offset[stage] = prev_offset;
+   return true;
+}
+
+/**
+ * Forget which binding tables the hardware is pointing at, after they've
+ * been replaced by something else (i.e. BLORP) or freed along with the
+ * binder.
+ */
+void
+iris_binder_forget_tables(struct iris_binder *binder)
+{
+   memset(binder->prev_bt_offset, 0, sizeof(binder->prev_bt_offset));
+   memset(binder->bt_size, 0, sizeof(binder->bt_size));
 }
 
 void
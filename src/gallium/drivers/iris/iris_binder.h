@@ -47,6 +47,18 @@ struct iris_binder
     * Zero is considered invalid and means there's no binding table.
     */
    uint32_t bt_offset[MESA_SHADER_STAGES];
+
+   /**
+    * The binding table offset each shader stage had before its last
+    * reservation, which the hardware still points at.
+    */
+   uint32_t prev_bt_offset[MESA_SHADER_STAGES];
+
+   /**
+    * Size in bytes of the binding table the hardware points at for each
+    * shader stage.  Zero means it can't be reused.
+    */
+   uint32_t bt_size[MESA_SHADER_STAGES];
 };
 
 void iris_init_binder(struct iris_context *ice);
@@ -54,5 +66,8 @@ void iris_destroy_binder(struct iris_binder *binder);
 uint32_t iris_binder_reserve(struct iris_context *ice, unsigned size);
 void iris_binder_reserve_3d(struct iris_context *ice);
 void iris_binder_reserve_compute(struct iris_context *ice);
+bool iris_binder_reuse_table(struct iris_binder *binder,
+                             gl_shader_stage stage, unsigned size);
+void iris_binder_forget_tables(struct iris_binder *binder);
 
 #endif
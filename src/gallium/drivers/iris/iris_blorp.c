@@ -156,6 +156,9 @@ blorp_alloc_binding_table(struct blorp_batch *blorp_batch,
    struct iris_batch *batch = blorp_batch->driver_batch;
 
    *bt_offset = iris_binder_reserve(ice, num_entries * sizeof(uint32_t));
+
+   /* BLORP points the hardware at its own tables. */
+   iris_binder_forget_tables(binder);
    uint32_t *bt_map = binder->map + *bt_offset;
 
    for (unsigned i = 0; i < num_entries; i++) {
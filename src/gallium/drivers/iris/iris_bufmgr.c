@@ -48,6 +48,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include <time.h>
 
 #include "errno.h"
@@ -184,6 +185,20 @@ struct iris_bufmgr {
 
    struct util_vma_heap vma_allocator[IRIS_MEMZONE_COUNT];
 
+   /** BO cache statistics, reported with INTEL_DEBUG=bufmgr */
+   struct {
+      /** Allocations satisfied from the cache */
+      uint64_t hits;
+      /** Cacheable allocations which needed a new BO */
+      uint64_t misses;
+      /** Lookups which found only busy BOs in the right memory zone */
+      uint64_t busy;
+      /** Cache hits which had to move their BO to another memory zone */
+      uint64_t moved;
+      /** Cached BOs which the kernel had purged */
+      uint64_t purged;
+   } stats;
+
    bool has_llc:1;
    bool bo_reuse:1;
 };
@@ -516,6 +531,87 @@ bo_calloc(void)
    return bo;
 }
 
+/**
+ * Take an idle buffer of the right size out of the bucket's cache.
+ *
+ * Buffers already in the requested memory zone are preferred, so that they
+ * keep their address and we don't have to churn the VMA allocator (and the
+ * kernel's page tables) for them.  The cache is ordered from least to most
+ * recently freed, so the first busy buffer of a zone ends the search.
+ *
+ * Must be called with the bufmgr lock held.
+ */
+static struct iris_bo *
+alloc_bo_from_cache(struct iris_bufmgr *bufmgr,
+                    struct bo_cache_bucket *bucket,
+                    enum iris_memory_zone memzone,
+                    uint32_t tiling_mode,
+                    uint32_t stride)
+{
+   if (!bucket)
+      return NULL;
+
+   struct iris_bo *bo;
+
+retry:
+   bo = NULL;
+
+   list_for_each_entry(struct iris_bo, cur, &bucket->head, head) {
+      if (iris_memzone_for_address(cur->gtt_offset) != memzone)
+         continue;
+
+      if (!iris_bo_busy(cur))
+         bo = cur;
+      else
+         bufmgr->stats.busy++;
+      break;
+   }
+
+   /* Otherwise, recycle the oldest buffer in another zone, if it's idle. */
+   if (!bo && !list_empty(&bucket->head)) {
+      struct iris_bo *oldest =
+         LIST_ENTRY(struct iris_bo, bucket->head.next, head);
+
+      if (iris_memzone_for_address(oldest->gtt_offset) != memzone &&
+          !iris_bo_busy(oldest))
+         bo = oldest;
+   }
+
+   if (!bo)
+      return NULL;
+
+   list_del(&bo->head);
+
+   if (!iris_bo_madvise(bo, I915_MADV_WILLNEED)) {
+      bufmgr->stats.purged++;
+      bo_free(bo);
+      iris_bo_cache_purge_bucket(bufmgr, bucket);
+      goto retry;
+   }
+
+   if (bo_set_tiling_internal(bo, tiling_mode, stride)) {
+      bo_free(bo);
+      goto retry;
+   }
+
+   /* If the cached BO isn't in the right memory zone, free the old
+    * memory and assign it a new address.
+    */
+   if (memzone != iris_memzone_for_address(bo->gtt_offset)) {
+      bufmgr->stats.moved++;
+      vma_free(bufmgr, bo->gtt_offset, bo->size);
+      bo->gtt_offset = vma_alloc(bufmgr, memzone, bo->size, 1);
+
+      if (bo->gtt_offset == 0ull) {
+         bo_free(bo);
+         return NULL;
+      }
+   }
+
+   bufmgr->stats.hits++;
+   return bo;
+}
+
 static struct iris_bo *
 bo_alloc_internal(struct iris_bufmgr *bufmgr,
                   const char *name,
@@ -525,85 +621,51 @@ bo_alloc_internal(struct iris_bufmgr *bufmgr,
                   uint32_t tiling_mode,
                   uint32_t stride)
 {
-   struct iris_bo *bo;
+   struct iris_bo *bo = NULL;
    unsigned int page_size = getpagesize();
    int ret;
-   struct bo_cache_bucket *bucket;
-   bool alloc_from_cache;
+   struct bo_cache_bucket *bucket = NULL;
    uint64_t bo_size;
-   bool zeroed = false;
-
-   if (flags & BO_ALLOC_ZEROED)
-      zeroed = true;
 
    if ((flags & BO_ALLOC_COHERENT) && !bufmgr->has_llc) {
       bo_size = MAX2(ALIGN(size, page_size), page_size);
-      bucket = NULL;
-      goto skip_cache;
-   }
-
-   /* Round the allocated size up to a power of two number of pages. */
-   bucket = bucket_for_size(bufmgr, size);
-
-   /* If we don't have caching at this size, don't actually round the
-    * allocation up.
-    */
-   if (bucket == NULL) {
-      bo_size = MAX2(ALIGN(size, page_size), page_size);
    } else {
-      bo_size = bucket->size;
-   }
+      /* Round the allocated size up to a power of two number of pages. */
+      bucket = bucket_for_size(bufmgr, size);
 
-   mtx_lock(&bufmgr->lock);
-   /* Get a buffer out of the cache if available */
-retry:
-   alloc_from_cache = false;
-   if (bucket != NULL && !list_empty(&bucket->head)) {
-      /* If the last BO in the cache is idle, then reuse it.  Otherwise,
-       * allocate a fresh buffer to avoid stalling.
+      /* If we don't have caching at this size, don't actually round the
+       * allocation up.
        */
-      bo = LIST_ENTRY(struct iris_bo, bucket->head.next, head);
-      if (!iris_bo_busy(bo)) {
-         alloc_from_cache = true;
-         list_del(&bo->head);
+      if (bucket == NULL) {
+         bo_size = MAX2(ALIGN(size, page_size), page_size);
+      } else {
+         bo_size = bucket->size;
       }
 
-      if (alloc_from_cache) {
-         if (!iris_bo_madvise(bo, I915_MADV_WILLNEED)) {
-            bo_free(bo);
-            iris_bo_cache_purge_bucket(bufmgr, bucket);
-            goto retry;
-         }
-
-         if (bo_set_tiling_internal(bo, tiling_mode, stride)) {
-            bo_free(bo);
-            goto retry;
-         }
-
-         if (zeroed) {
-            void *map = iris_bo_map(NULL, bo, MAP_WRITE | MAP_RAW);
-            if (!map) {
-               bo_free(bo);
-               goto retry;
-            }
-            memset(map, 0, bo_size);
-         }
-      }
+      /* Get a buffer out of the cache if available.  Only the cache and
+       * the VMA allocators need the lock; mapping, clearing and creating
+       * buffers happen outside of it, so that other threads allocating
+       * at the same time aren't held up.
+       */
+      mtx_lock(&bufmgr->lock);
+      bo = alloc_bo_from_cache(bufmgr, bucket, memzone, tiling_mode, stride);
+      if (!bo && bucket)
+         bufmgr->stats.misses++;
+      mtx_unlock(&bufmgr->lock);
    }
 
-   if (alloc_from_cache) {
-      /* If the cached BO isn't in the right memory zone, free the old
-       * memory and assign it a new address.
-       */
-      if (memzone != iris_memzone_for_address(bo->gtt_offset)) {
-         vma_free(bufmgr, bo->gtt_offset, bo->size);
-         bo->gtt_offset = 0ull;
+   if (bo) {
+      if (flags & BO_ALLOC_ZEROED) {
+         void *map = iris_bo_map(NULL, bo, MAP_WRITE | MAP_RAW);
+         if (!map)
+            goto err_free;
+
+         memset(map, 0, bo_size);
       }
    } else {
-skip_cache:
       bo = bo_calloc();
       if (!bo)
-         goto err;
+         return NULL;
 
       bo->size = bo_size;
       bo->idle = true;
@@ -616,7 +678,7 @@ skip_cache:
       ret = drm_ioctl(bufmgr->fd, DRM_IOCTL_I915_GEM_CREATE, &create);
       if (ret != 0) {
          free(bo);
-         goto err;
+         return NULL;
       }
 
       bo->gem_handle = create.handle;
@@ -642,6 +704,13 @@ skip_cache:
 
       if (drm_ioctl(bo->bufmgr->fd, DRM_IOCTL_I915_GEM_SET_DOMAIN, &sd) != 0)
          goto err_free;
+
+      mtx_lock(&bufmgr->lock);
+      bo->gtt_offset = vma_alloc(bufmgr, memzone, bo->size, 1);
+      mtx_unlock(&bufmgr->lock);
+
+      if (bo->gtt_offset == 0ull)
+         goto err_free;
    }
 
    bo->name = name;
@@ -657,15 +726,6 @@ skip_cache:
    if (memzone < IRIS_MEMZONE_OTHER)
       bo->kflags |= EXEC_OBJECT_CAPTURE;
 
-   if (bo->gtt_offset == 0ull) {
-      bo->gtt_offset = vma_alloc(bufmgr, memzone, bo->size, 1);
-
-      if (bo->gtt_offset == 0ull)
-         goto err_free;
-   }
-
-   mtx_unlock(&bufmgr->lock);
-
    if ((flags & BO_ALLOC_COHERENT) && !bo->cache_coherent) {
       struct drm_i915_gem_caching arg = {
          .handle = bo->gem_handle,
@@ -683,8 +743,8 @@ skip_cache:
    return bo;
 
 err_free:
+   mtx_lock(&bufmgr->lock);
    bo_free(bo);
-err:
    mtx_unlock(&bufmgr->lock);
    return NULL;
 }
@@ -1307,6 +1367,11 @@ iris_bo_wait(struct iris_bo *bo, int64_t timeout_ns)
 void
 iris_bufmgr_destroy(struct iris_bufmgr *bufmgr)
 {
+   DBG("BO cache: %"PRIu64" hits, %"PRIu64" misses, %"PRIu64" busy, "
+       "%"PRIu64" moved to another memzone, %"PRIu64" purged\n",
+       bufmgr->stats.hits, bufmgr->stats.misses, bufmgr->stats.busy,
+       bufmgr->stats.moved, bufmgr->stats.purged);
+
    mtx_destroy(&bufmgr->lock);
 
    /* Free any cached buffer objects we were going to reuse */
@@ -25,6 +25,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_state.h"
 #include "util/ralloc.h"
+#include "util/u_debug.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_upload_mgr.h"
@@ -117,6 +118,7 @@ iris_destroy_context(struct pipe_context *ctx)
    u_upload_destroy(ice->query_buffer_uploader);
 
    slab_destroy_child(&ice->transfer_pool);
+   slab_destroy_child(&ice->transfer_pool_unsync);
 
    iris_batch_free(&ice->batches[IRIS_BATCH_RENDER]);
    iris_batch_free(&ice->batches[IRIS_BATCH_COMPUTE]);
@@ -189,6 +191,7 @@ iris_create_context(struct pipe_screen *pscreen, void *priv, unsigned flags)
    iris_init_binder(ice);
 
    slab_create_child(&ice->transfer_pool, &screen->transfer_pool);
+   slab_create_child(&ice->transfer_pool_unsync, &screen->transfer_pool);
 
    ice->state.surface_uploader =
       u_upload_create(ctx, 16384, PIPE_BIND_CUSTOM, PIPE_USAGE_IMMUTABLE,
@@ -221,5 +224,14 @@ iris_create_context(struct pipe_screen *pscreen, void *priv, unsigned flags)
    ice->vtbl.init_compute_context(screen, &ice->batches[IRIS_BATCH_COMPUTE],
                                   &ice->vtbl, &ice->dbg);
 
-   return ctx;
+   /* The threaded context is opt-in for now. */
+   if (!(flags & PIPE_CONTEXT_PREFER_THREADED) ||
+       (flags & PIPE_CONTEXT_COMPUTE_ONLY) ||
+       !debug_get_bool_option("IRIS_THREADED_CONTEXT", false))
+      return ctx;
+
+   return threaded_context_create(ctx, &screen->transfer_pool,
+                                  iris_replace_buffer_storage,
+                                  NULL, /* flushes are synchronous */
+                                  NULL);
 }
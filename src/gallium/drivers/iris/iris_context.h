@@ -246,6 +246,40 @@ enum iris_predicate_state {
 
 /** @} */
 
+/**
+ * An uncompiled, API-facing shader.  This is the Gallium CSO for shaders.
+ * It primarily contains the NIR for the shader.
+ *
+ * Each API-facing shader can be compiled into multiple shader variants,
+ * based on non-orthogonal state dependencies, recorded in the shader key.
+ *
+ * See iris_compiled_shader, which represents a compiled shader variant.
+ */
+struct iris_uncompiled_shader {
+   struct nir_shader *nir;
+
+   struct pipe_stream_output_info stream_output;
+
+   unsigned program_id;
+
+   /** SHA1 of the serialized NIR, for the on-disk shader cache */
+   unsigned char nir_sha1[20];
+
+   /** Bitfield of (1 << IRIS_NOS_*) flags. */
+   unsigned nos;
+
+   /** Have any shader variants been compiled yet? */
+   bool compiled_once;
+
+   /**
+    * Variant being precompiled on the shader compiler queue, until a
+    * context takes it.  Its results are valid once precompile_fence is
+    * signalled.
+    */
+   struct iris_precompiled_shader *precompiled;
+   struct util_queue_fence precompile_fence;
+};
+
 /**
  * A compiled shader variant, containing a pointer to the GPU assembly,
  * as well as program data and other packets needed by state upload.
@@ -440,6 +474,12 @@ struct iris_context {
    /** Slab allocator for iris_transfer_map objects. */
    struct slab_child_pool transfer_pool;
 
+   /**
+    * Slab allocator for unsynchronized maps done by the threaded context in
+    * the application thread.
+    */
+   struct slab_child_pool transfer_pool_unsync;
+
    struct iris_vtable vtbl;
 
    struct blorp_context blorp;
@@ -685,6 +725,10 @@ void iris_copy_region(struct blorp_context *blorp,
 /* iris_draw.c */
 
 void iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info);
+void iris_multi_draw(struct pipe_context *ctx,
+                     const struct pipe_draw_info *info,
+                     const struct pipe_draw_start_count *draws,
+                     unsigned num_draws);
 void iris_launch_grid(struct pipe_context *, const struct pipe_grid_info *);
 
 /* iris_pipe_control.c */
@@ -742,6 +786,20 @@ struct iris_bo *iris_get_scratch_space(struct iris_context *ice,
                                        unsigned per_thread_scratch,
                                        gl_shader_stage stage);
 
+/* iris_disk_cache.c */
+
+void iris_disk_cache_store(struct disk_cache *cache,
+                           const struct iris_uncompiled_shader *ish,
+                           const struct iris_compiled_shader *shader,
+                           const void *prog_key,
+                           uint32_t prog_key_size);
+struct iris_compiled_shader *
+iris_disk_cache_retrieve(struct iris_context *ice,
+                         const struct iris_uncompiled_shader *ish,
+                         const void *prog_key,
+                         uint32_t prog_key_size);
+void iris_disk_cache_init(struct iris_screen *screen);
+
 /* iris_program_cache.c */
 
 void iris_init_program_cache(struct iris_context *ice);
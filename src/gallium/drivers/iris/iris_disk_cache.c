@@ -0,0 +1,305 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file iris_disk_cache.c
+ *
+ * Functions for interacting with the on-disk shader cache.
+ *
+ * Compiled shader variants are stored under a hash of the serialized NIR
+ * and the program key, so they can be found again across runs of the same
+ * application, without compiling the NIR at all.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+
+#include "compiler/blob.h"
+#include "compiler/nir/nir.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+
+#include "iris_context.h"
+
+static bool debug = false;
+
+/**
+ * Set the program string id of a program key.
+ */
+static void
+set_program_string_id(union brw_any_prog_key *key, gl_shader_stage stage,
+                      unsigned id)
+{
+   switch (stage) {
+   case MESA_SHADER_VERTEX:
+      key->vs.program_string_id = id;
+      break;
+   case MESA_SHADER_TESS_CTRL:
+      key->tcs.program_string_id = id;
+      break;
+   case MESA_SHADER_TESS_EVAL:
+      key->tes.program_string_id = id;
+      break;
+   case MESA_SHADER_GEOMETRY:
+      key->gs.program_string_id = id;
+      break;
+   case MESA_SHADER_FRAGMENT:
+      key->wm.program_string_id = id;
+      break;
+   case MESA_SHADER_COMPUTE:
+      key->cs.program_string_id = id;
+      break;
+   default:
+      unreachable("Unsupported stage!");
+   }
+}
+
+/**
+ * Compute a disk cache key for the given uncompiled shader and NOS key.
+ */
+static void
+iris_disk_cache_compute_key(struct disk_cache *cache,
+                            const struct iris_uncompiled_shader *ish,
+                            const void *orig_prog_key,
+                            uint32_t prog_key_size,
+                            cache_key cache_key)
+{
+   /* Create a copy of the program key with program_string_id zeroed out.
+    * It's essentially random data which we don't want to include in our
+    * hashing and comparisons.  We'll set a proper value on a cache hit.
+    */
+   union brw_any_prog_key prog_key;
+   assert(prog_key_size <= sizeof(prog_key));
+   memcpy(&prog_key, orig_prog_key, prog_key_size);
+   set_program_string_id(&prog_key, ish->nir->info.stage, 0);
+
+   uint8_t data[sizeof(prog_key) + sizeof(ish->nir_sha1)];
+   uint32_t data_size = prog_key_size + sizeof(ish->nir_sha1);
+
+   memcpy(data, ish->nir_sha1, sizeof(ish->nir_sha1));
+   memcpy(data + sizeof(ish->nir_sha1), &prog_key, prog_key_size);
+
+   disk_cache_compute_key(cache, data, data_size, cache_key);
+}
+
+/**
+ * Store the given compiled shader in the disk cache.
+ *
+ * This should only be called on newly compiled shaders.  No checking is
+ * done to prevent repeated stores of the same shader.
+ */
+void
+iris_disk_cache_store(struct disk_cache *cache,
+                      const struct iris_uncompiled_shader *ish,
+                      const struct iris_compiled_shader *shader,
+                      const void *prog_key,
+                      uint32_t prog_key_size)
+{
+   if (!cache)
+      return;
+
+   gl_shader_stage stage = ish->nir->info.stage;
+   const struct brw_stage_prog_data *prog_data = shader->prog_data;
+
+   cache_key cache_key;
+   iris_disk_cache_compute_key(cache, ish, prog_key, prog_key_size, cache_key);
+
+   if (debug) {
+      char sha1[41];
+      _mesa_sha1_format(sha1, cache_key);
+      fprintf(stderr, "[mesa disk cache] storing %s\n", sha1);
+   }
+
+   struct blob blob;
+   blob_init(&blob);
+
+   /* We write the following data to the cache blob:
+    *
+    * 1. Prog data (must come first because it has the assembly size)
+    * 2. Assembly code
+    * 3. Number of entries in the system value array
+    * 4. System value array
+    * 5. Push and pull parameters
+    * 6. Number of constant buffers
+    *
+    * The streamout packets are derived from the VUE map and the stream
+    * output info of the uncompiled shader on retrieval.
+    */
+   blob_write_bytes(&blob, shader->prog_data, brw_prog_data_size(stage));
+   blob_write_bytes(&blob, shader->map, prog_data->program_size);
+   blob_write_uint32(&blob, shader->num_system_values);
+   blob_write_bytes(&blob, shader->system_values,
+                    shader->num_system_values * sizeof(enum brw_param_builtin));
+   blob_write_bytes(&blob, prog_data->param,
+                    prog_data->nr_params * sizeof(uint32_t));
+   blob_write_bytes(&blob, prog_data->pull_param,
+                    prog_data->nr_pull_params * sizeof(uint32_t));
+   blob_write_uint32(&blob, shader->num_cbufs);
+
+   if (!blob.out_of_memory)
+      disk_cache_put(cache, cache_key, blob.data, blob.size, NULL);
+
+   blob_finish(&blob);
+}
+
+/**
+ * Search for a compiled shader in the disk cache.  If found, upload it
+ * to the in-memory program cache so we can use it.
+ */
+struct iris_compiled_shader *
+iris_disk_cache_retrieve(struct iris_context *ice,
+                         const struct iris_uncompiled_shader *ish,
+                         const void *prog_key,
+                         uint32_t key_size)
+{
+   struct iris_screen *screen = (void *) ice->ctx.screen;
+   struct disk_cache *cache = screen->disk_cache;
+   gl_shader_stage stage = ish->nir->info.stage;
+
+   if (!cache)
+      return NULL;
+
+   cache_key cache_key;
+   iris_disk_cache_compute_key(cache, ish, prog_key, key_size, cache_key);
+
+   if (debug) {
+      char sha1[41];
+      _mesa_sha1_format(sha1, cache_key);
+      fprintf(stderr, "[mesa disk cache] retrieving %s: ", sha1);
+   }
+
+   struct disk_cache_view buffer;
+   if (!disk_cache_get_view(cache, cache_key, &buffer)) {
+      if (debug)
+         fprintf(stderr, "not found\n");
+      return NULL;
+   }
+
+   if (debug)
+      fprintf(stderr, "found\n");
+
+   const uint32_t prog_data_size = brw_prog_data_size(stage);
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, buffer.data, buffer.size);
+
+   struct brw_stage_prog_data *prog_data = ralloc_size(NULL, prog_data_size);
+   blob_copy_bytes(&blob, prog_data, prog_data_size);
+
+   const void *assembly = blob_read_bytes(&blob, prog_data->program_size);
+
+   enum brw_param_builtin *system_values = NULL;
+   uint32_t num_system_values = blob_read_uint32(&blob);
+   if (num_system_values) {
+      system_values =
+         ralloc_array(NULL, enum brw_param_builtin, num_system_values);
+      blob_copy_bytes(&blob, system_values,
+                      num_system_values * sizeof(enum brw_param_builtin));
+   }
+
+   prog_data->param = NULL;
+   prog_data->pull_param = NULL;
+   if (prog_data->nr_params) {
+      prog_data->param = ralloc_array(NULL, uint32_t, prog_data->nr_params);
+      blob_copy_bytes(&blob, prog_data->param,
+                      prog_data->nr_params * sizeof(uint32_t));
+   }
+   if (prog_data->nr_pull_params) {
+      prog_data->pull_param =
+         ralloc_array(NULL, uint32_t, prog_data->nr_pull_params);
+      blob_copy_bytes(&blob, prog_data->pull_param,
+                      prog_data->nr_pull_params * sizeof(uint32_t));
+   }
+
+   uint32_t num_cbufs = blob_read_uint32(&blob);
+
+   if (blob.overrun || blob.current != blob.end) {
+      /* The item is corrupt, drop it and compile from NIR instead. */
+      if (debug)
+         fprintf(stderr, "[mesa disk cache] invalid iris cache item\n");
+
+      ralloc_free(prog_data->param);
+      ralloc_free(prog_data->pull_param);
+      ralloc_free(prog_data);
+      ralloc_free(system_values);
+      disk_cache_release_view(cache, &buffer);
+      disk_cache_remove(cache, cache_key);
+      return NULL;
+   }
+
+   uint32_t *so_decls = NULL;
+   if (stage == MESA_SHADER_VERTEX ||
+       stage == MESA_SHADER_TESS_EVAL ||
+       stage == MESA_SHADER_GEOMETRY) {
+      struct brw_vue_prog_data *vue_prog_data = (void *) prog_data;
+      so_decls = ice->vtbl.create_so_decl_list(&ish->stream_output,
+                                               &vue_prog_data->vue_map);
+   }
+
+   /* The key was hashed with a zero program_string_id, but the in-memory
+    * cache needs the real one, which the caller's key already has.
+    */
+   struct iris_compiled_shader *shader =
+      iris_upload_shader(ice, stage, key_size, prog_key, assembly,
+                         prog_data, so_decls, system_values, num_system_values,
+                         num_cbufs);
+
+   disk_cache_release_view(cache, &buffer);
+   return shader;
+}
+
+/**
+ * Initialize the on-disk shader cache.
+ */
+void
+iris_disk_cache_init(struct iris_screen *screen)
+{
+#ifdef ENABLE_SHADER_CACHE
+   if (INTEL_DEBUG & DEBUG_DISK_CACHE_DISABLE_MASK)
+      return;
+
+   /* array length = print length + nul char + 1 extra to verify it's unused */
+   char renderer[11];
+   MAYBE_UNUSED int len =
+      snprintf(renderer, sizeof(renderer), "iris_%04x", screen->pci_id);
+   assert(len == sizeof(renderer) - 2);
+
+   /* The gallium targets aren't linked with a build-id, so identify the
+    * driver build by the library containing this function instead.
+    */
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char timestamp[41];
+
+   _mesa_sha1_init(&ctx);
+   if (!disk_cache_get_function_identifier(iris_disk_cache_init, &ctx))
+      return;
+   _mesa_sha1_final(&ctx, sha1);
+   _mesa_sha1_format(timestamp, sha1);
+
+   const uint64_t driver_flags =
+      brw_get_compiler_config_value(screen->compiler);
+   screen->disk_cache = disk_cache_create(renderer, timestamp, driver_flags);
+#endif
+}
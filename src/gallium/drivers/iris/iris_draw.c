@@ -110,24 +110,14 @@ iris_update_draw_info(struct iris_context *ice,
 }
 
 /**
- * The pipe->draw_vbo() driver hook.  Performs a draw on the GPU.
+ * Emit the state and the 3DPRIMITIVE of one draw.
  */
-void
-iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+static void
+iris_draw_one(struct iris_context *ice, struct iris_batch *batch,
+              const struct pipe_draw_info *info)
 {
-   struct iris_context *ice = (struct iris_context *) ctx;
    struct iris_screen *screen = (struct iris_screen*)ice->ctx.screen;
    const struct gen_device_info *devinfo = &screen->devinfo;
-   struct iris_batch *batch = &ice->batches[IRIS_BATCH_RENDER];
-
-   if (ice->state.predicate == IRIS_PREDICATE_STATE_DONT_RENDER)
-      return;
-
-   /* We can't safely re-emit 3DSTATE_SO_BUFFERS because it may zero the
-    * write offsets, changing the behavior.
-    */
-   if (unlikely(INTEL_DEBUG & DEBUG_REEMIT))
-      ice->state.dirty |= IRIS_ALL_DIRTY_FOR_RENDER & ~IRIS_DIRTY_SO_BUFFERS;
 
    iris_batch_maybe_flush(batch, 1500);
 
@@ -158,6 +148,73 @@ iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
    ice->state.dirty &= ~IRIS_ALL_DIRTY_FOR_RENDER;
 }
 
+/**
+ * Common checks of the draw hooks.  Returns false if nothing must be drawn.
+ */
+static bool
+iris_prepare_draw(struct iris_context *ice)
+{
+   if (ice->state.predicate == IRIS_PREDICATE_STATE_DONT_RENDER)
+      return false;
+
+   /* We can't safely re-emit 3DSTATE_SO_BUFFERS because it may zero the
+    * write offsets, changing the behavior.
+    */
+   if (unlikely(INTEL_DEBUG & DEBUG_REEMIT)) {
+      ice->state.dirty |= IRIS_ALL_DIRTY_FOR_RENDER & ~IRIS_DIRTY_SO_BUFFERS;
+      iris_binder_forget_tables(&ice->state.binder);
+   }
+
+   return true;
+}
+
+/**
+ * The pipe->draw_vbo() driver hook.  Performs a draw on the GPU.
+ */
+void
+iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct iris_batch *batch = &ice->batches[IRIS_BATCH_RENDER];
+
+   if (!iris_prepare_draw(ice))
+      return;
+
+   iris_draw_one(ice, batch, info);
+}
+
+/**
+ * The pipe->multi_draw() driver hook.
+ *
+ * All the state is validated and emitted for the first draw.  The later
+ * draws only re-emit what depends on the draw parameters (the vertex
+ * buffers holding gl_BaseVertex and gl_DrawID, if the shaders use them)
+ * and whatever a batch flush in between invalidated.
+ */
+void
+iris_multi_draw(struct pipe_context *ctx, const struct pipe_draw_info *info,
+                const struct pipe_draw_start_count *draws, unsigned num_draws)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct iris_batch *batch = &ice->batches[IRIS_BATCH_RENDER];
+
+   if (!iris_prepare_draw(ice))
+      return;
+
+   struct pipe_draw_info draw = *info;
+
+   for (unsigned i = 0; i < num_draws; i++) {
+      if (!draws[i].count)
+         continue;
+
+      draw.start = draws[i].start;
+      draw.count = draws[i].count;
+      draw.index_bias = draws[i].index_bias;
+      draw.drawid = info->drawid + i;
+      iris_draw_one(ice, batch, &draw);
+   }
+}
+
 static void
 iris_update_grid_size_resource(struct iris_context *ice,
                                const struct pipe_grid_info *grid)
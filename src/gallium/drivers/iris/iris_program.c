@@ -36,8 +36,11 @@
 #include "pipe/p_context.h"
 #include "pipe/p_screen.h"
 #include "util/u_atomic.h"
+#include "util/mesa-sha1.h"
+#include "compiler/blob.h"
 #include "compiler/nir/nir.h"
 #include "compiler/nir/nir_builder.h"
+#include "compiler/nir/nir_serialize.h"
 #include "intel/compiler/brw_compiler.h"
 #include "intel/compiler/brw_nir.h"
 #include "iris_context.h"
@@ -56,28 +59,62 @@ get_new_program_id(struct iris_screen *screen)
 }
 
 /**
- * An uncompiled, API-facing shader.  This is the Gallium CSO for shaders.
- * It primarily contains the NIR for the shader.
+ * Where a shader variant is compiled.
  *
- * Each API-facing shader can be compiled into multiple shader variants,
- * based on non-orthogonal state dependencies, recorded in the shader key.
- *
- * See iris_compiled_shader, which represents a compiled shader variant.
+ * Variants are normally compiled on a context's thread, and uploaded to its
+ * program cache right away.  Precompiles run on the screen's shader compiler
+ * queue instead, without a context: the variant stays in the uncompiled
+ * shader until a draw needs it, see iris_use_precompiled_shader().
  */
-struct iris_uncompiled_shader {
-   nir_shader *nir;
+struct iris_compile_env {
+   struct iris_screen *screen;
 
-   struct pipe_stream_output_info stream_output;
+   /** The context to upload the variant to, NULL on the compiler queue */
+   struct iris_context *ice;
 
-   unsigned program_id;
+   struct pipe_debug_callback *dbg;
 
-   /** Bitfield of (1 << IRIS_NOS_*) flags. */
-   unsigned nos;
+   uint32_t *(*create_so_decl_list)(const struct pipe_stream_output_info *sol,
+                                    const struct brw_vue_map *vue_map);
 
-   /** Have any shader variants been compiled yet? */
-   bool compiled_once;
+   /** Where to keep the variant when there is no context */
+   struct iris_precompiled_shader *precompiled;
 };
 
+/**
+ * A variant compiled on the shader compiler queue with a guessed key, not
+ * uploaded to a program cache yet.
+ */
+struct iris_precompiled_shader {
+   struct iris_uncompiled_shader *ish;
+   struct iris_compile_env env;
+   struct pipe_debug_callback dbg;
+
+   union brw_any_prog_key key;
+
+   /** The result of the compile, NULL if it failed */
+   const unsigned *program;
+
+   /** ralloc context owning the compile's results */
+   void *mem_ctx;
+   struct brw_stage_prog_data *prog_data;
+   uint32_t *so_decls;
+   enum brw_param_builtin *system_values;
+   unsigned num_system_values;
+   unsigned num_cbufs;
+};
+
+static struct iris_compile_env
+context_compile_env(struct iris_context *ice)
+{
+   return (struct iris_compile_env) {
+      .screen = (struct iris_screen *) ice->ctx.screen,
+      .ice = ice,
+      .dbg = &ice->dbg,
+      .create_so_decl_list = ice->vtbl.create_so_decl_list,
+   };
+}
+
 static nir_ssa_def *
 get_aoa_deref_offset(nir_builder *b,
                      nir_deref_instr *deref,
@@ -511,15 +548,15 @@ iris_setup_uniforms(const struct brw_compiler *compiler,
 }
 
 static void
-iris_debug_recompile(struct iris_context *ice,
+iris_debug_recompile(const struct iris_compile_env *env,
                      struct shader_info *info,
                      unsigned program_string_id,
                      const void *key)
 {
-   struct iris_screen *screen = (struct iris_screen *) ice->ctx.screen;
-   const struct brw_compiler *c = screen->compiler;
+   struct iris_context *ice = env->ice;
+   const struct brw_compiler *c = env->screen->compiler;
 
-   if (!info)
+   if (!info || !ice)
       return;
 
    c->shader_perf_log(&ice->dbg, "Recompiling %s shader for program %s: %s\n",
@@ -534,15 +571,97 @@ iris_debug_recompile(struct iris_context *ice,
 }
 
 
+/**
+ * Upload a newly compiled variant to the context's program cache and to
+ * the disk cache, or keep it for later when compiling without a context.
+ * Takes ownership of mem_ctx, which holds the compile's results.
+ */
+static struct iris_compiled_shader *
+iris_finish_compile(const struct iris_compile_env *env,
+                    const struct iris_uncompiled_shader *ish,
+                    enum iris_program_cache_id cache_id,
+                    uint32_t key_size,
+                    const void *key,
+                    void *mem_ctx,
+                    const unsigned *program,
+                    struct brw_stage_prog_data *prog_data,
+                    uint32_t *so_decls,
+                    enum brw_param_builtin *system_values,
+                    unsigned num_system_values,
+                    unsigned num_cbufs)
+{
+   if (!env->ice) {
+      struct iris_precompiled_shader *pre = env->precompiled;
+
+      pre->mem_ctx = mem_ctx;
+      pre->program = program;
+      pre->prog_data = prog_data;
+      pre->so_decls = so_decls;
+      pre->system_values = system_values;
+      pre->num_system_values = num_system_values;
+      pre->num_cbufs = num_cbufs;
+      return NULL;
+   }
+
+   struct iris_compiled_shader *shader =
+      iris_upload_shader(env->ice, cache_id, key_size, key, program,
+                         prog_data, so_decls, system_values, num_system_values,
+                         num_cbufs);
+
+   if (ish)
+      iris_disk_cache_store(env->screen->disk_cache, ish, shader, key,
+                            key_size);
+
+   ralloc_free(mem_ctx);
+   return shader;
+}
+
+/**
+ * Upload the variant precompiled on the shader compiler queue, if its key
+ * is the one needed, waiting for the compile to finish.
+ */
+static struct iris_compiled_shader *
+iris_use_precompiled_shader(struct iris_context *ice,
+                            struct iris_uncompiled_shader *ish,
+                            enum iris_program_cache_id cache_id,
+                            uint32_t key_size,
+                            const void *key)
+{
+   if (!ish)
+      return NULL;
+
+   /* The key is set before the job is queued, so it can be compared
+    * without waiting.  The first context needing the variant takes it.
+    */
+   struct iris_precompiled_shader *pre = p_atomic_read(&ish->precompiled);
+   if (!pre || memcmp(&pre->key, key, key_size) != 0 ||
+       p_atomic_cmpxchg(&ish->precompiled, pre, NULL) != pre)
+      return NULL;
+
+   util_queue_fence_wait(&ish->precompile_fence);
+
+   struct iris_compiled_shader *shader = NULL;
+   if (pre->program) {
+      const struct iris_compile_env env = context_compile_env(ice);
+      shader = iris_finish_compile(&env, ish, cache_id, key_size, key,
+                                   pre->mem_ctx, pre->program, pre->prog_data,
+                                   pre->so_decls, pre->system_values,
+                                   pre->num_system_values, pre->num_cbufs);
+   }
+
+   free(pre);
+   return shader;
+}
+
 /**
  * Compile a vertex shader, and upload the assembly.
  */
 static struct iris_compiled_shader *
-iris_compile_vs(struct iris_context *ice,
+iris_compile_vs(const struct iris_compile_env *env,
                 struct iris_uncompiled_shader *ish,
                 const struct brw_vs_prog_key *key)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_screen *screen = env->screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct gen_device_info *devinfo = &screen->devinfo;
    void *mem_ctx = ralloc_context(NULL);
@@ -586,7 +705,7 @@ iris_compile_vs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_vs(compiler, &ice->dbg, mem_ctx, &key_no_ucp, vs_prog_data,
+      brw_compile_vs(compiler, env->dbg, mem_ctx, &key_no_ucp, vs_prog_data,
                      nir, -1, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile vertex shader: %s\n", error_str);
@@ -595,22 +714,18 @@ iris_compile_vs(struct iris_context *ice,
    }
 
    if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, key->program_string_id, key);
+      iris_debug_recompile(env, &nir->info, key->program_string_id, key);
    } else {
       ish->compiled_once = true;
    }
 
    uint32_t *so_decls =
-      ice->vtbl.create_so_decl_list(&ish->stream_output,
-                                    &vue_prog_data->vue_map);
-
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_VS, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs);
+      env->create_so_decl_list(&ish->stream_output,
+                               &vue_prog_data->vue_map);
 
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(env, ish, IRIS_CACHE_VS, sizeof(*key), key,
+                              mem_ctx, program, prog_data, so_decls,
+                              system_values, num_system_values, num_cbufs);
 }
 
 /**
@@ -634,7 +749,16 @@ iris_update_compiled_vs(struct iris_context *ice)
       iris_find_cached_shader(ice, IRIS_CACHE_VS, sizeof(key), &key);
 
    if (!shader)
-      shader = iris_compile_vs(ice, ish, &key);
+      shader = iris_use_precompiled_shader(ice, ish, IRIS_CACHE_VS,
+                                           sizeof(key), &key);
+
+   if (!shader)
+      shader = iris_disk_cache_retrieve(ice, ish, &key, sizeof(key));
+
+   if (!shader) {
+      const struct iris_compile_env env = context_compile_env(ice);
+      shader = iris_compile_vs(&env, ish, &key);
+   }
 
    if (old != shader) {
       ice->shaders.prog[IRIS_CACHE_VS] = shader;
@@ -720,11 +844,11 @@ get_unified_tess_slots(const struct iris_context *ice,
  * Compile a tessellation control shader, and upload the assembly.
  */
 static struct iris_compiled_shader *
-iris_compile_tcs(struct iris_context *ice,
+iris_compile_tcs(const struct iris_compile_env *env,
                  struct iris_uncompiled_shader *ish,
                  const struct brw_tcs_prog_key *key)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_screen *screen = env->screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct nir_shader_compiler_options *options =
       compiler->glsl_compiler_options[MESA_SHADER_TESS_CTRL].NirOptions;
@@ -779,7 +903,7 @@ iris_compile_tcs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_tcs(compiler, &ice->dbg, mem_ctx, key, tcs_prog_data, nir,
+      brw_compile_tcs(compiler, env->dbg, mem_ctx, key, tcs_prog_data, nir,
                       -1, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile control shader: %s\n", error_str);
@@ -789,19 +913,15 @@ iris_compile_tcs(struct iris_context *ice,
 
    if (ish) {
       if (ish->compiled_once) {
-         iris_debug_recompile(ice, &nir->info, key->program_string_id, key);
+         iris_debug_recompile(env, &nir->info, key->program_string_id, key);
       } else {
          ish->compiled_once = true;
       }
    }
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_TCS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs);
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(env, ish, IRIS_CACHE_TCS, sizeof(*key), key,
+                              mem_ctx, program, prog_data, NULL,
+                              system_values, num_system_values, num_cbufs);
 }
 
 /**
@@ -834,7 +954,16 @@ iris_update_compiled_tcs(struct iris_context *ice)
       iris_find_cached_shader(ice, IRIS_CACHE_TCS, sizeof(key), &key);
 
    if (!shader)
-      shader = iris_compile_tcs(ice, tcs, &key);
+      shader = iris_use_precompiled_shader(ice, tcs, IRIS_CACHE_TCS,
+                                           sizeof(key), &key);
+
+   if (tcs && !shader)
+      shader = iris_disk_cache_retrieve(ice, tcs, &key, sizeof(key));
+
+   if (!shader) {
+      const struct iris_compile_env env = context_compile_env(ice);
+      shader = iris_compile_tcs(&env, tcs, &key);
+   }
 
    if (old != shader) {
       ice->shaders.prog[IRIS_CACHE_TCS] = shader;
@@ -848,11 +977,11 @@ iris_update_compiled_tcs(struct iris_context *ice)
  * Compile a tessellation evaluation shader, and upload the assembly.
  */
 static struct iris_compiled_shader *
-iris_compile_tes(struct iris_context *ice,
+iris_compile_tes(const struct iris_compile_env *env,
                  struct iris_uncompiled_shader *ish,
                  const struct brw_tes_prog_key *key)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_screen *screen = env->screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct gen_device_info *devinfo = &screen->devinfo;
    void *mem_ctx = ralloc_context(NULL);
@@ -878,7 +1007,7 @@ iris_compile_tes(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_tes(compiler, &ice->dbg, mem_ctx, key, &input_vue_map,
+      brw_compile_tes(compiler, env->dbg, mem_ctx, key, &input_vue_map,
                       tes_prog_data, nir, NULL, -1, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile evaluation shader: %s\n", error_str);
@@ -887,23 +1016,19 @@ iris_compile_tes(struct iris_context *ice,
    }
 
    if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, key->program_string_id, key);
+      iris_debug_recompile(env, &nir->info, key->program_string_id, key);
    } else {
       ish->compiled_once = true;
    }
 
    uint32_t *so_decls =
-      ice->vtbl.create_so_decl_list(&ish->stream_output,
-                                    &vue_prog_data->vue_map);
+      env->create_so_decl_list(&ish->stream_output,
+                               &vue_prog_data->vue_map);
 
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_TES, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs);
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(env, ish, IRIS_CACHE_TES, sizeof(*key), key,
+                              mem_ctx, program, prog_data, so_decls,
+                              system_values, num_system_values, num_cbufs);
 }
 
 /**
@@ -928,7 +1053,16 @@ iris_update_compiled_tes(struct iris_context *ice)
       iris_find_cached_shader(ice, IRIS_CACHE_TES, sizeof(key), &key);
 
    if (!shader)
-      shader = iris_compile_tes(ice, ish, &key);
+      shader = iris_use_precompiled_shader(ice, ish, IRIS_CACHE_TES,
+                                           sizeof(key), &key);
+
+   if (!shader)
+      shader = iris_disk_cache_retrieve(ice, ish, &key, sizeof(key));
+
+   if (!shader) {
+      const struct iris_compile_env env = context_compile_env(ice);
+      shader = iris_compile_tes(&env, ish, &key);
+   }
 
    if (old != shader) {
       ice->shaders.prog[IRIS_CACHE_TES] = shader;
@@ -949,11 +1083,11 @@ iris_update_compiled_tes(struct iris_context *ice)
  * Compile a geometry shader, and upload the assembly.
  */
 static struct iris_compiled_shader *
-iris_compile_gs(struct iris_context *ice,
+iris_compile_gs(const struct iris_compile_env *env,
                 struct iris_uncompiled_shader *ish,
                 const struct brw_gs_prog_key *key)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_screen *screen = env->screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct gen_device_info *devinfo = &screen->devinfo;
    void *mem_ctx = ralloc_context(NULL);
@@ -979,7 +1113,7 @@ iris_compile_gs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_gs(compiler, &ice->dbg, mem_ctx, key, gs_prog_data, nir,
+      brw_compile_gs(compiler, env->dbg, mem_ctx, key, gs_prog_data, nir,
                      NULL, -1, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile geometry shader: %s\n", error_str);
@@ -988,22 +1122,18 @@ iris_compile_gs(struct iris_context *ice,
    }
 
    if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, key->program_string_id, key);
+      iris_debug_recompile(env, &nir->info, key->program_string_id, key);
    } else {
       ish->compiled_once = true;
    }
 
    uint32_t *so_decls =
-      ice->vtbl.create_so_decl_list(&ish->stream_output,
-                                    &vue_prog_data->vue_map);
+      env->create_so_decl_list(&ish->stream_output,
+                               &vue_prog_data->vue_map);
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_GS, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs);
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(env, ish, IRIS_CACHE_GS, sizeof(*key), key,
+                              mem_ctx, program, prog_data, so_decls,
+                              system_values, num_system_values, num_cbufs);
 }
 
 /**
@@ -1029,7 +1159,16 @@ iris_update_compiled_gs(struct iris_context *ice)
          iris_find_cached_shader(ice, IRIS_CACHE_GS, sizeof(key), &key);
 
       if (!shader)
-         shader = iris_compile_gs(ice, ish, &key);
+         shader = iris_use_precompiled_shader(ice, ish, IRIS_CACHE_GS,
+                                              sizeof(key), &key);
+
+      if (!shader)
+         shader = iris_disk_cache_retrieve(ice, ish, &key, sizeof(key));
+
+      if (!shader) {
+         const struct iris_compile_env env = context_compile_env(ice);
+         shader = iris_compile_gs(&env, ish, &key);
+      }
    }
 
    if (old != shader) {
@@ -1044,12 +1183,12 @@ iris_update_compiled_gs(struct iris_context *ice)
  * Compile a fragment (pixel) shader, and upload the assembly.
  */
 static struct iris_compiled_shader *
-iris_compile_fs(struct iris_context *ice,
+iris_compile_fs(const struct iris_compile_env *env,
                 struct iris_uncompiled_shader *ish,
                 const struct brw_wm_prog_key *key,
                 struct brw_vue_map *vue_map)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_screen *screen = env->screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct gen_device_info *devinfo = &screen->devinfo;
    void *mem_ctx = ralloc_context(NULL);
@@ -1073,7 +1212,7 @@ iris_compile_fs(struct iris_context *ice,
                                        num_system_values, num_cbufs);
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_fs(compiler, &ice->dbg, mem_ctx, key, fs_prog_data,
+      brw_compile_fs(compiler, env->dbg, mem_ctx, key, fs_prog_data,
                      nir, NULL, -1, -1, -1, true, false, vue_map, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile fragment shader: %s\n", error_str);
@@ -1082,18 +1221,14 @@ iris_compile_fs(struct iris_context *ice,
    }
 
    if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, key->program_string_id, key);
+      iris_debug_recompile(env, &nir->info, key->program_string_id, key);
    } else {
       ish->compiled_once = true;
    }
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_FS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs);
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(env, ish, IRIS_CACHE_FS, sizeof(*key), key,
+                              mem_ctx, program, prog_data, NULL,
+                              system_values, num_system_values, num_cbufs);
 }
 
 /**
@@ -1119,7 +1254,16 @@ iris_update_compiled_fs(struct iris_context *ice)
       iris_find_cached_shader(ice, IRIS_CACHE_FS, sizeof(key), &key);
 
    if (!shader)
-      shader = iris_compile_fs(ice, ish, &key, ice->shaders.last_vue_map);
+      shader = iris_use_precompiled_shader(ice, ish, IRIS_CACHE_FS,
+                                           sizeof(key), &key);
+
+   if (!shader)
+      shader = iris_disk_cache_retrieve(ice, ish, &key, sizeof(key));
+
+   if (!shader) {
+      const struct iris_compile_env env = context_compile_env(ice);
+      shader = iris_compile_fs(&env, ish, &key, ice->shaders.last_vue_map);
+   }
 
    if (old != shader) {
       // XXX: only need to flag CLIP if barycentric has NONPERSPECTIVE
@@ -1278,11 +1422,11 @@ iris_update_compiled_shaders(struct iris_context *ice)
 }
 
 static struct iris_compiled_shader *
-iris_compile_cs(struct iris_context *ice,
+iris_compile_cs(const struct iris_compile_env *env,
                 struct iris_uncompiled_shader *ish,
                 const struct brw_cs_prog_key *key)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_screen *screen = env->screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct gen_device_info *devinfo = &screen->devinfo;
    void *mem_ctx = ralloc_context(NULL);
@@ -1307,7 +1451,7 @@ iris_compile_cs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_cs(compiler, &ice->dbg, mem_ctx, key, cs_prog_data,
+      brw_compile_cs(compiler, env->dbg, mem_ctx, key, cs_prog_data,
                      nir, -1, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile compute shader: %s\n", error_str);
@@ -1316,18 +1460,14 @@ iris_compile_cs(struct iris_context *ice,
    }
 
    if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, key->program_string_id, key);
+      iris_debug_recompile(env, &nir->info, key->program_string_id, key);
    } else {
       ish->compiled_once = true;
    }
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_CS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs);
-
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_finish_compile(env, ish, IRIS_CACHE_CS, sizeof(*key), key,
+                              mem_ctx, program, prog_data, NULL,
+                              system_values, num_system_values, num_cbufs);
 }
 
 void
@@ -1346,7 +1486,16 @@ iris_update_compiled_compute_shader(struct iris_context *ice)
       iris_find_cached_shader(ice, IRIS_CACHE_CS, sizeof(key), &key);
 
    if (!shader)
-      shader = iris_compile_cs(ice, ish, &key);
+      shader = iris_use_precompiled_shader(ice, ish, IRIS_CACHE_CS,
+                                           sizeof(key), &key);
+
+   if (!shader)
+      shader = iris_disk_cache_retrieve(ice, ish, &key, sizeof(key));
+
+   if (!shader) {
+      const struct iris_compile_env env = context_compile_env(ice);
+      shader = iris_compile_cs(&env, ish, &key);
+   }
 
    if (old != shader) {
       ice->shaders.prog[IRIS_CACHE_CS] = shader;
@@ -1422,6 +1571,105 @@ iris_get_scratch_space(struct iris_context *ice,
 
 /* ------------------------------------------------------------------- */
 
+static void
+iris_precompile_job(void *job, int thread_index)
+{
+   struct iris_precompiled_shader *pre = job;
+   struct iris_uncompiled_shader *ish = pre->ish;
+
+   switch (ish->nir->info.stage) {
+   case MESA_SHADER_VERTEX:
+      iris_compile_vs(&pre->env, ish, &pre->key.vs);
+      break;
+   case MESA_SHADER_TESS_CTRL:
+      iris_compile_tcs(&pre->env, ish, &pre->key.tcs);
+      break;
+   case MESA_SHADER_TESS_EVAL:
+      iris_compile_tes(&pre->env, ish, &pre->key.tes);
+      break;
+   case MESA_SHADER_GEOMETRY:
+      iris_compile_gs(&pre->env, ish, &pre->key.gs);
+      break;
+   case MESA_SHADER_FRAGMENT:
+      iris_compile_fs(&pre->env, ish, &pre->key.wm, NULL);
+      break;
+   case MESA_SHADER_COMPUTE:
+      iris_compile_cs(&pre->env, ish, &pre->key.cs);
+      break;
+   default:
+      unreachable("Invalid shader stage.");
+   }
+}
+
+/**
+ * Precompile a variant with a guessed key at link time.
+ *
+ * The compile runs on the screen's shader compiler queue, so that creating
+ * the shader doesn't wait for it.  A draw only waits for it when it needs
+ * that variant, see iris_use_precompiled_shader().
+ */
+static void
+iris_schedule_precompile(struct iris_context *ice,
+                         struct iris_uncompiled_shader *ish,
+                         const void *key,
+                         uint32_t key_size)
+{
+   struct iris_screen *screen = (struct iris_screen *) ice->ctx.screen;
+
+   if (iris_disk_cache_retrieve(ice, ish, key, key_size))
+      return;
+
+   struct iris_precompiled_shader *pre = NULL;
+   if (util_queue_is_initialized(&screen->shader_compiler_queue))
+      pre = calloc(1, sizeof(*pre));
+
+   if (!pre) {
+      const struct iris_compile_env env = context_compile_env(ice);
+
+      switch (ish->nir->info.stage) {
+      case MESA_SHADER_VERTEX:
+         iris_compile_vs(&env, ish, key);
+         break;
+      case MESA_SHADER_TESS_CTRL:
+         iris_compile_tcs(&env, ish, key);
+         break;
+      case MESA_SHADER_TESS_EVAL:
+         iris_compile_tes(&env, ish, key);
+         break;
+      case MESA_SHADER_GEOMETRY:
+         iris_compile_gs(&env, ish, key);
+         break;
+      case MESA_SHADER_FRAGMENT:
+         iris_compile_fs(&env, ish, key, NULL);
+         break;
+      case MESA_SHADER_COMPUTE:
+         iris_compile_cs(&env, ish, key);
+         break;
+      default:
+         unreachable("Invalid shader stage.");
+      }
+      return;
+   }
+
+   pre->ish = ish;
+   pre->env = (struct iris_compile_env) {
+      .screen = screen,
+      .dbg = &pre->dbg,
+      .create_so_decl_list = ice->vtbl.create_so_decl_list,
+      .precompiled = pre,
+   };
+   memcpy(&pre->key, key, key_size);
+
+   /* This is the first compile of the shader, later ones are recompiles.
+    * Set it here, the job must not write to the shader.
+    */
+   ish->compiled_once = true;
+   ish->precompiled = pre;
+
+   util_queue_add_job(&screen->shader_compiler_queue, pre,
+                      &ish->precompile_fence, iris_precompile_job, NULL);
+}
+
 /**
  * The pipe->create_[stage]_state() driver hooks.
  *
@@ -1450,6 +1698,19 @@ iris_create_uncompiled_shader(struct pipe_context *ctx,
 
    ish->program_id = get_new_program_id(screen);
    ish->nir = nir;
+   util_queue_fence_init(&ish->precompile_fence);
+
+   if (screen->disk_cache) {
+      /* Serialize the NIR to a binary blob that we can hash for the disk
+       * cache.  Strip unnecessary information (like variable names) so
+       * that isomorphic shaders hash the same, increasing cache hits.
+       */
+      struct blob blob;
+      blob_init(&blob);
+      nir_serialize(&blob, nir, true);
+      _mesa_sha1_compute(blob.data, blob.size, ish->nir_sha1);
+      blob_finish(&blob);
+   }
    if (so_info) {
       memcpy(&ish->stream_output, so_info, sizeof(*so_info));
       update_so_info(&ish->stream_output, nir->info.outputs_written);
@@ -1488,7 +1749,7 @@ iris_create_vs_state(struct pipe_context *ctx,
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_vs_prog_key key = { KEY_INIT(devinfo->gen) };
 
-      iris_compile_vs(ice, ish, &key);
+      iris_schedule_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -1518,7 +1779,7 @@ iris_create_tcs_state(struct pipe_context *ctx,
          .patch_outputs_written = info->patch_outputs_written,
       };
 
-      iris_compile_tcs(ice, ish, &key);
+      iris_schedule_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -1544,7 +1805,7 @@ iris_create_tes_state(struct pipe_context *ctx,
          .patch_inputs_read = info->patch_inputs_read,
       };
 
-      iris_compile_tes(ice, ish, &key);
+      iris_schedule_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -1564,7 +1825,7 @@ iris_create_gs_state(struct pipe_context *ctx,
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_gs_prog_key key = { KEY_INIT(devinfo->gen) };
 
-      iris_compile_gs(ice, ish, &key);
+      iris_schedule_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -1608,7 +1869,7 @@ iris_create_fs_state(struct pipe_context *ctx,
             can_rearrange_varyings ? 0 : info->inputs_read | VARYING_BIT_POS,
       };
 
-      iris_compile_fs(ice, ish, &key, NULL);
+      iris_schedule_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -1631,7 +1892,7 @@ iris_create_compute_state(struct pipe_context *ctx,
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_cs_prog_key key = { KEY_INIT(devinfo->gen) };
 
-      iris_compile_cs(ice, ish, &key);
+      iris_schedule_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -1647,12 +1908,21 @@ iris_delete_shader_state(struct pipe_context *ctx, void *state, gl_shader_stage
 {
    struct iris_uncompiled_shader *ish = state;
    struct iris_context *ice = (void *) ctx;
+   struct iris_screen *screen = (struct iris_screen *) ctx->screen;
 
    if (ice->shaders.uncompiled[stage] == ish) {
       ice->shaders.uncompiled[stage] = NULL;
       ice->state.dirty |= IRIS_DIRTY_UNCOMPILED_VS << stage;
    }
 
+   if (ish->precompiled) {
+      util_queue_drop_job(&screen->shader_compiler_queue,
+                          &ish->precompile_fence);
+      ralloc_free(ish->precompiled->mem_ctx);
+      free(ish->precompiled);
+   }
+   util_queue_fence_destroy(&ish->precompile_fence);
+
    ralloc_free(ish->nir);
    free(ish);
 }
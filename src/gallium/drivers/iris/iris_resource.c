@@ -260,6 +260,7 @@ iris_resource_destroy(struct pipe_screen *screen,
    if (resource->target == PIPE_BUFFER)
       util_range_destroy(&res->valid_buffer_range);
 
+   threaded_resource_deinit(resource);
    iris_resource_disable_aux(res);
 
    iris_bo_unreference(res->bo);
@@ -277,6 +278,7 @@ iris_alloc_resource(struct pipe_screen *pscreen,
    res->base = *templ;
    res->base.screen = pscreen;
    pipe_reference_init(&res->base.reference, 1);
+   threaded_resource_init(&res->base);
 
    res->aux.possible_usages = 1 << ISL_AUX_USAGE_NONE;
    res->aux.sampler_usages = 1 << ISL_AUX_USAGE_NONE;
@@ -742,6 +744,8 @@ iris_resource_from_user_memory(struct pipe_screen *pscreen,
    }
 
    util_range_add(&res->valid_buffer_range, 0, templ->width0);
+   res->tres.is_user_ptr = true;
+   util_range_add(&res->tres.valid_buffer_range, 0, templ->width0);
 
    return &res->base;
 }
@@ -817,6 +821,8 @@ iris_resource_from_handle(struct pipe_screen *pscreen,
          goto fail;
    }
 
+   res->tres.is_shared = true;
+
    return &res->base;
 
 fail:
@@ -873,6 +879,9 @@ iris_resource_get_handle(struct pipe_screen *pscreen,
    }
 #endif
 
+   /* The threaded context must not reallocate exported buffers. */
+   res->tres.is_shared = true;
+
    switch (whandle->type) {
    case WINSYS_HANDLE_TYPE_SHARED:
       return iris_bo_flink(res->bo, &whandle->handle) == 0;
@@ -947,6 +956,36 @@ iris_invalidate_resource(struct pipe_context *ctx,
    iris_bo_unreference(old_bo);
 }
 
+/**
+ * Make a buffer use the storage of another buffer, which the threaded
+ * context allocated to invalidate it.  Called via tc_replace_buffer_storage.
+ */
+void
+iris_replace_buffer_storage(struct pipe_context *ctx,
+                            struct pipe_resource *p_dst,
+                            struct pipe_resource *p_src)
+{
+   struct iris_context *ice = (void *) ctx;
+   struct iris_resource *dst = (void *) p_dst;
+   struct iris_resource *src = (void *) p_src;
+   struct iris_bo *old_bo = dst->bo;
+
+   assert(dst->base.target == PIPE_BUFFER);
+
+   /* Swap out the backing storage */
+   iris_bo_reference(src->bo);
+   dst->bo = src->bo;
+
+   /* Rebind the buffer, replacing any state referring to the old BO's
+    * address, and marking state dirty so it's reemitted.
+    */
+   ice->vtbl.rebind_buffer(ice, dst, old_bo->gtt_offset);
+
+   util_range_set_empty(&dst->valid_buffer_range);
+
+   iris_bo_unreference(old_bo);
+}
+
 static void
 iris_flush_staging_region(struct pipe_transfer *xfer,
                           const struct pipe_box *flush_box)
@@ -1068,146 +1107,6 @@ get_image_offset_el(const struct isl_surf *surf, unsigned level, unsigned z,
    }
 }
 
-/**
- * Get pointer offset into stencil buffer.
- *
- * The stencil buffer is W tiled. Since the GTT is incapable of W fencing, we
- * must decode the tile's layout in software.
- *
- * See
- *   - PRM, 2011 Sandy Bridge, Volume 1, Part 2, Section 4.5.2.1 W-Major Tile
- *     Format.
- *   - PRM, 2011 Sandy Bridge, Volume 1, Part 2, Section 4.5.3 Tiling Algorithm
- *
- * Even though the returned offset is always positive, the return type is
- * signed due to
- *    commit e8b1c6d6f55f5be3bef25084fdd8b6127517e137
- *    mesa: Fix return type of  _mesa_get_format_bytes() (#37351)
- */
-static intptr_t
-s8_offset(uint32_t stride, uint32_t x, uint32_t y, bool swizzled)
-{
-   uint32_t tile_size = 4096;
-   uint32_t tile_width = 64;
-   uint32_t tile_height = 64;
-   uint32_t row_size = 64 * stride / 2; /* Two rows are interleaved. */
-
-   uint32_t tile_x = x / tile_width;
-   uint32_t tile_y = y / tile_height;
-
-   /* The byte's address relative to the tile's base addres. */
-   uint32_t byte_x = x % tile_width;
-   uint32_t byte_y = y % tile_height;
-
-   uintptr_t u = tile_y * row_size
-               + tile_x * tile_size
-               + 512 * (byte_x / 8)
-               +  64 * (byte_y / 8)
-               +  32 * ((byte_y / 4) % 2)
-               +  16 * ((byte_x / 4) % 2)
-               +   8 * ((byte_y / 2) % 2)
-               +   4 * ((byte_x / 2) % 2)
-               +   2 * (byte_y % 2)
-               +   1 * (byte_x % 2);
-
-   if (swizzled) {
-      /* adjust for bit6 swizzling */
-      if (((byte_x / 8) % 2) == 1) {
-         if (((byte_y / 8) % 2) == 0) {
-            u += 64;
-         } else {
-            u -= 64;
-         }
-      }
-   }
-
-   return u;
-}
-
-static void
-iris_unmap_s8(struct iris_transfer *map)
-{
-   struct pipe_transfer *xfer = &map->base;
-   const struct pipe_box *box = &xfer->box;
-   struct iris_resource *res = (struct iris_resource *) xfer->resource;
-   struct isl_surf *surf = &res->surf;
-   const bool has_swizzling = false;
-
-   if (xfer->usage & PIPE_TRANSFER_WRITE) {
-      uint8_t *untiled_s8_map = map->ptr;
-      uint8_t *tiled_s8_map =
-         iris_bo_map(map->dbg, res->bo, (xfer->usage | MAP_RAW) & MAP_FLAGS);
-
-      for (int s = 0; s < box->depth; s++) {
-         unsigned x0_el, y0_el;
-         get_image_offset_el(surf, xfer->level, box->z + s, &x0_el, &y0_el);
-
-         for (uint32_t y = 0; y < box->height; y++) {
-            for (uint32_t x = 0; x < box->width; x++) {
-               ptrdiff_t offset = s8_offset(surf->row_pitch_B,
-                                            x0_el + box->x + x,
-                                            y0_el + box->y + y,
-                                            has_swizzling);
-               tiled_s8_map[offset] =
-                  untiled_s8_map[s * xfer->layer_stride + y * xfer->stride + x];
-            }
-         }
-      }
-   }
-
-   free(map->buffer);
-}
-
-static void
-iris_map_s8(struct iris_transfer *map)
-{
-   struct pipe_transfer *xfer = &map->base;
-   const struct pipe_box *box = &xfer->box;
-   struct iris_resource *res = (struct iris_resource *) xfer->resource;
-   struct isl_surf *surf = &res->surf;
-
-   xfer->stride = surf->row_pitch_B;
-   xfer->layer_stride = xfer->stride * box->height;
-
-   /* The tiling and detiling functions require that the linear buffer has
-    * a 16-byte alignment (that is, its `x0` is 16-byte aligned).  Here we
-    * over-allocate the linear buffer to get the proper alignment.
-    */
-   map->buffer = map->ptr = malloc(xfer->layer_stride * box->depth);
-   assert(map->buffer);
-
-   const bool has_swizzling = false;
-
-   /* One of either READ_BIT or WRITE_BIT or both is set.  READ_BIT implies no
-    * INVALIDATE_RANGE_BIT.  WRITE_BIT needs the original values read in unless
-    * invalidate is set, since we'll be writing the whole rectangle from our
-    * temporary buffer back out.
-    */
-   if (!(xfer->usage & PIPE_TRANSFER_DISCARD_RANGE)) {
-      uint8_t *untiled_s8_map = map->ptr;
-      uint8_t *tiled_s8_map =
-         iris_bo_map(map->dbg, res->bo, (xfer->usage | MAP_RAW) & MAP_FLAGS);
-
-      for (int s = 0; s < box->depth; s++) {
-         unsigned x0_el, y0_el;
-         get_image_offset_el(surf, xfer->level, box->z + s, &x0_el, &y0_el);
-
-         for (uint32_t y = 0; y < box->height; y++) {
-            for (uint32_t x = 0; x < box->width; x++) {
-               ptrdiff_t offset = s8_offset(surf->row_pitch_B,
-                                            x0_el + box->x + x,
-                                            y0_el + box->y + y,
-                                            has_swizzling);
-               untiled_s8_map[s * xfer->layer_stride + y * xfer->stride + x] =
-                  tiled_s8_map[offset];
-            }
-         }
-      }
-   }
-
-   map->unmap = iris_unmap_s8;
-}
-
 /* Compute extent parameters for use with tiled_memcpy functions.
  * xs are in units of bytes and ys are in units of strides.
  */
@@ -1400,7 +1299,16 @@ iris_transfer_map(struct pipe_context *ctx,
        (usage & PIPE_TRANSFER_MAP_DIRECTLY))
       return NULL;
 
-   struct iris_transfer *map = slab_alloc(&ice->transfer_pool);
+   /* Unsynchronized maps of the threaded context come from the application
+    * thread, which mustn't use the transfer pool of the driver thread.
+    */
+   struct iris_transfer *map;
+   if (usage & TC_TRANSFER_MAP_THREADED_UNSYNC) {
+      assert(usage & PIPE_TRANSFER_UNSYNCHRONIZED);
+      map = slab_alloc(&ice->transfer_pool_unsync);
+   } else {
+      map = slab_alloc(&ice->transfer_pool);
+   }
    struct pipe_transfer *xfer = &map->base;
 
    if (!map)
@@ -1459,10 +1367,7 @@ iris_transfer_map(struct pipe_context *ctx,
          }
       }
 
-      if (surf->tiling == ISL_TILING_W) {
-         /* TODO: Teach iris_map_tiled_memcpy about W-tiling... */
-         iris_map_s8(map);
-      } else if (surf->tiling != ISL_TILING_LINEAR) {
+      if (surf->tiling != ISL_TILING_LINEAR) {
          iris_map_tiled_memcpy(map);
       } else {
          iris_map_direct(map);
@@ -26,6 +26,7 @@
 #include "pipe/p_state.h"
 #include "util/u_inlines.h"
 #include "util/u_range.h"
+#include "util/u_threaded_context.h"
 #include "intel/isl/isl.h"
 
 struct iris_batch;
@@ -53,7 +54,11 @@ enum gen9_astc5x5_wa_tex_type {
  * They contain the storage (BO) and layout information (ISL surface).
  */
 struct iris_resource {
-   struct pipe_resource base;
+   /** The threaded context needs all resources to be threaded_resources. */
+   union {
+      struct pipe_resource base;
+      struct threaded_resource tres;
+   };
    enum pipe_format internal_format;
 
    /**
@@ -258,6 +263,10 @@ iris_resource_get_clear_color(const struct iris_resource *res,
 
 void iris_init_screen_resource_functions(struct pipe_screen *pscreen);
 
+void iris_replace_buffer_storage(struct pipe_context *ctx,
+                                 struct pipe_resource *dst,
+                                 struct pipe_resource *src);
+
 void iris_dirty_for_history(struct iris_context *ice,
                             struct iris_resource *res);
 uint32_t iris_flush_bits_for_history(struct iris_resource *res);
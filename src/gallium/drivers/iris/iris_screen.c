@@ -38,7 +38,9 @@
 #include "pipe/p_context.h"
 #include "pipe/p_screen.h"
 #include "util/debug.h"
+#include "util/disk_cache.h"
 #include "util/u_inlines.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_format.h"
 #include "util/u_transfer_helper.h"
 #include "util/u_upload_mgr.h"
@@ -474,10 +476,21 @@ iris_destroy_screen(struct pipe_screen *pscreen)
    struct iris_screen *screen = (struct iris_screen *) pscreen;
    iris_bo_unreference(screen->workaround_bo);
    u_transfer_helper_destroy(pscreen->transfer_helper);
+   if (util_queue_is_initialized(&screen->shader_compiler_queue))
+      util_queue_destroy(&screen->shader_compiler_queue);
    iris_bufmgr_destroy(screen->bufmgr);
+   disk_cache_destroy(screen->disk_cache);
+   isl_device_finish(&screen->isl_dev);
    ralloc_free(screen);
 }
 
+static struct disk_cache *
+iris_get_disk_shader_cache(struct pipe_screen *pscreen)
+{
+   struct iris_screen *screen = (struct iris_screen *) pscreen;
+   return screen->disk_cache;
+}
+
 static void
 iris_query_memory_info(struct pipe_screen *pscreen,
                        struct pipe_memory_info *info)
@@ -600,6 +613,17 @@ iris_screen_create(int fd, const struct pipe_screen_config *config)
    screen->compiler->shader_perf_log = iris_shader_perf_log;
    screen->compiler->supports_pull_constants = false;
 
+   iris_disk_cache_init(screen);
+
+   if (screen->precompile) {
+      /* Leave a core for the application's own thread. */
+      util_cpu_detect();
+      unsigned num_threads = CLAMP(util_cpu_caps.nr_cpus - 1, 1, 4);
+
+      util_queue_init(&screen->shader_compiler_queue, "iris_compile", 64,
+                      num_threads, UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+
    slab_create_parent(&screen->transfer_pool,
                       sizeof(struct iris_transfer), 64);
 
@@ -625,6 +649,7 @@ iris_screen_create(int fd, const struct pipe_screen_config *config)
    pscreen->context_create = iris_create_context;
    pscreen->flush_frontbuffer = iris_flush_frontbuffer;
    pscreen->get_timestamp = iris_get_timestamp;
+   pscreen->get_disk_shader_cache = iris_get_disk_shader_cache;
    pscreen->query_memory_info = iris_query_memory_info;
 
    return pscreen;
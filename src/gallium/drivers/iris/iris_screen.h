@@ -29,9 +29,11 @@
 #include "util/u_screen.h"
 #include "intel/dev/gen_device_info.h"
 #include "intel/isl/isl.h"
+#include "util/u_queue.h"
 #include "iris_bufmgr.h"
 
 struct iris_bo;
+struct disk_cache;
 
 #define READ_ONCE(x) (*(volatile __typeof__(x) *)&(x))
 #define WRITE_ONCE(x, v) *(volatile __typeof__(x) *)&(x) = (v)
@@ -60,6 +62,9 @@ struct iris_screen {
    /** Precompile shaders at link time?  (Can be disabled for debugging.) */
    bool precompile;
 
+   /** Runs the precompiles, so that linking doesn't wait for them */
+   struct util_queue shader_compiler_queue;
+
    /** driconf options and application workarounds */
    struct {
       /** Dual color blend by location instead of index (for broken apps) */
@@ -73,6 +78,9 @@ struct iris_screen {
    struct iris_bufmgr *bufmgr;
    struct brw_compiler *compiler;
 
+   /** On-disk cache of compiled shader assembly, NULL if disabled */
+   struct disk_cache *disk_cache;
+
    /**
     * A buffer containing nothing useful, for hardware workarounds that
     * require scratch writes or reads from some unimportant memory.
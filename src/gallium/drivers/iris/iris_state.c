@@ -1024,13 +1024,23 @@ static void
 iris_bind_blend_state(struct pipe_context *ctx, void *state)
 {
    struct iris_context *ice = (struct iris_context *) ctx;
-   struct iris_blend_state *cso = state;
+   struct iris_blend_state *old_cso = ice->state.cso_blend;
+   struct iris_blend_state *new_cso = state;
 
-   ice->state.cso_blend = cso;
-   ice->state.blend_enables = cso ? cso->blend_enables : 0;
+   /* Many distinct blend CSOs pack to the same commands, so only flag the
+    * packets whose contents actually differ from the currently bound ones.
+    */
+   if (new_cso) {
+      if (cso_changed_memcmp(ps_blend) || cso_changed(color_write_enables))
+         ice->state.dirty |= IRIS_DIRTY_PS_BLEND;
+
+      if (cso_changed_memcmp(blend_state))
+         ice->state.dirty |= IRIS_DIRTY_BLEND_STATE;
+   }
+
+   ice->state.cso_blend = new_cso;
+   ice->state.blend_enables = new_cso ? new_cso->blend_enables : 0;
 
-   ice->state.dirty |= IRIS_DIRTY_PS_BLEND;
-   ice->state.dirty |= IRIS_DIRTY_BLEND_STATE;
    ice->state.dirty |= IRIS_DIRTY_RENDER_RESOLVES_AND_FLUSHES;
    ice->state.dirty |= ice->state.dirty_for_nos[IRIS_NOS_BLEND];
 }
@@ -1147,13 +1157,14 @@ iris_bind_zsa_state(struct pipe_context *ctx, void *state)
       if (cso_changed(depth_writes_enabled))
          ice->state.dirty |= IRIS_DIRTY_RENDER_RESOLVES_AND_FLUSHES;
 
+      if (cso_changed_memcmp(wmds))
+         ice->state.dirty |= IRIS_DIRTY_WM_DEPTH_STENCIL;
+
       ice->state.depth_writes_enabled = new_cso->depth_writes_enabled;
       ice->state.stencil_writes_enabled = new_cso->stencil_writes_enabled;
    }
 
    ice->state.cso_zsa = new_cso;
-   ice->state.dirty |= IRIS_DIRTY_CC_VIEWPORT;
-   ice->state.dirty |= IRIS_DIRTY_WM_DEPTH_STENCIL;
    ice->state.dirty |= ice->state.dirty_for_nos[IRIS_NOS_DEPTH_STENCIL_ALPHA];
 }
 
@@ -1364,7 +1375,18 @@ iris_bind_rasterizer_state(struct pipe_context *ctx, void *state)
       if (cso_changed(half_pixel_center))
          ice->state.dirty |= IRIS_DIRTY_MULTISAMPLE;
 
-      if (cso_changed(line_stipple_enable) || cso_changed(poly_stipple_enable))
+      /* 3DSTATE_CLIP, 3DSTATE_RASTER, 3DSTATE_SF and 3DSTATE_WM are fully
+       * packed in the CSO, other than the bits which come from other state
+       * and are flagged by whoever changes that.  Skip re-emitting them if
+       * the new CSO packed to the same dwords as the old one.
+       */
+      if (cso_changed_memcmp(raster) || cso_changed_memcmp(sf))
+         ice->state.dirty |= IRIS_DIRTY_RASTER;
+
+      if (cso_changed_memcmp(clip))
+         ice->state.dirty |= IRIS_DIRTY_CLIP;
+
+      if (cso_changed_memcmp(wm))
          ice->state.dirty |= IRIS_DIRTY_WM;
 
       if (cso_changed(rasterizer_discard))
@@ -1387,8 +1409,6 @@ iris_bind_rasterizer_state(struct pipe_context *ctx, void *state)
    }
 
    ice->state.cso_rast = new_cso;
-   ice->state.dirty |= IRIS_DIRTY_RASTER;
-   ice->state.dirty |= IRIS_DIRTY_CLIP;
    ice->state.dirty |= ice->state.dirty_for_nos[IRIS_NOS_RASTERIZER];
 }
 
@@ -4605,18 +4625,25 @@ iris_upload_dirty_render_state(struct iris_context *ice,
       }
    }
 
-   for (int stage = 0; stage <= MESA_SHADER_FRAGMENT; stage++) {
-      if (dirty & (IRIS_DIRTY_BINDINGS_VS << stage)) {
-         iris_emit_cmd(batch, GENX(3DSTATE_BINDING_TABLE_POINTERS_VS), ptr) {
-            ptr._3DCommandSubOpcode = 38 + stage;
-            ptr.PointertoVSBindingTable = binder->bt_offset[stage];
-         }
-      }
-   }
+   /* Walk the stages backwards, so that identical tables are found from
+    * the end of the binder, where their space can be given back.
+    */
+   for (int stage = MESA_SHADER_FRAGMENT; stage >= 0; stage--) {
+      if (!(dirty & (IRIS_DIRTY_BINDINGS_VS << stage)))
+         continue;
 
-   for (int stage = 0; stage <= MESA_SHADER_FRAGMENT; stage++) {
-      if (dirty & (IRIS_DIRTY_BINDINGS_VS << stage)) {
-         iris_populate_binding_table(ice, batch, stage, false);
+      iris_populate_binding_table(ice, batch, stage, false);
+
+      const struct iris_compiled_shader *shader = ice->shaders.prog[stage];
+      const struct brw_stage_prog_data *prog_data =
+         shader ? shader->prog_data : NULL;
+      if (iris_binder_reuse_table(binder, stage, prog_data ?
+                                  prog_data->binding_table.size_bytes : 0))
+         continue;
+
+      iris_emit_cmd(batch, GENX(3DSTATE_BINDING_TABLE_POINTERS_VS), ptr) {
+         ptr._3DCommandSubOpcode = 38 + stage;
+         ptr.PointertoVSBindingTable = binder->bt_offset[stage];
       }
    }
 
@@ -5320,8 +5347,11 @@ iris_upload_compute_state(struct iris_context *ice,
    if ((dirty & IRIS_DIRTY_CONSTANTS_CS) && shs->cbuf0_needs_upload)
       upload_uniforms(ice, MESA_SHADER_COMPUTE);
 
-   if (dirty & IRIS_DIRTY_BINDINGS_CS)
+   if (dirty & IRIS_DIRTY_BINDINGS_CS) {
       iris_populate_binding_table(ice, batch, MESA_SHADER_COMPUTE, false);
+      iris_binder_reuse_table(binder, MESA_SHADER_COMPUTE,
+                              prog_data->binding_table.size_bytes);
+   }
 
    if (dirty & IRIS_DIRTY_SAMPLER_STATES_CS)
       iris_upload_sampler_states(ice, MESA_SHADER_COMPUTE);
@@ -5572,9 +5602,35 @@ iris_rebind_buffer(struct iris_context *ice,
     * - PIPE_BIND_QUERY_BUFFER (no persistent state references)
     */
 
-   if (res->bind_history & PIPE_BIND_STREAM_OUTPUT) {
-      /* XXX: be careful about resetting vs appending... */
-      assert(false);
+   /* 3DSTATE_SO_BUFFER is only packed while streamout is active, so patch
+    * the address in place.  The packet is emitted again for the new address,
+    * make it continue appending rather than restart at the original offset.
+    */
+   if ((res->bind_history & PIPE_BIND_STREAM_OUTPUT) &&
+       ice->state.streamout_active) {
+      uint32_t *so_buffers = genx->so_buffers;
+
+      for (unsigned i = 0; i < 4; i++,
+           so_buffers += GENX(3DSTATE_SO_BUFFER_length)) {
+         struct iris_stream_output_target *tgt =
+            (void *) ice->state.so_target[i];
+
+         if (!tgt || tgt->base.buffer != &res->base)
+            continue;
+
+         STATIC_ASSERT(GENX(3DSTATE_SO_BUFFER_SurfaceBaseAddress_start) == 66);
+         STATIC_ASSERT(GENX(3DSTATE_SO_BUFFER_SurfaceBaseAddress_bits) == 46);
+         uint64_t *addr = (uint64_t *) &so_buffers[2];
+         const uint64_t old_start = old_address + tgt->base.buffer_offset;
+
+         if ((*addr & ~3ull) == old_start) {
+            *addr = (*addr & 3ull) | (res->bo->gtt_offset +
+                                      tgt->base.buffer_offset);
+            STATIC_ASSERT(GENX(3DSTATE_SO_BUFFER_StreamOffset_start) == 224);
+            so_buffers[7] = 0xFFFFFFFF;
+            ice->state.dirty |= IRIS_DIRTY_SO_BUFFERS;
+         }
+      }
    }
 
    for (int s = MESA_SHADER_VERTEX; s < MESA_SHADER_STAGES; s++) {
@@ -6321,6 +6377,7 @@ genX(init_state)(struct iris_context *ice)
    ctx->sampler_view_destroy = iris_sampler_view_destroy;
    ctx->surface_destroy = iris_surface_destroy;
    ctx->draw_vbo = iris_draw_vbo;
+   ctx->multi_draw = iris_multi_draw;
    ctx->launch_grid = iris_launch_grid;
    ctx->create_stream_output_target = iris_create_stream_output_target;
    ctx->stream_output_target_destroy = iris_stream_output_target_destroy;
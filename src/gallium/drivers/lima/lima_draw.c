@@ -537,6 +537,13 @@ lima_update_pp_stream(struct lima_context *ctx, int off_x, int off_y,
     * 1D for pp stream index and 2D for plb block x/y on framebuffer.
     * if multi pp, interleave the 1D index to make each pp's render target
     * close enough which should result close workload
+    *
+    * the interleave is also the only balancing we can do: the per tile
+    * workload is only known once GP has filled the plb, and GP and PP jobs
+    * are submitted together, so reading the plb back here would stall on GP.
+    * Neighbouring tiles on the curve tend to cost about the same, so giving
+    * every pp one tile of each num_pp consecutive ones spreads a heavy
+    * region of the frame over all of them.
     */
    int max = MAX2(tiled_w, tiled_h);
    int dim = util_logbase2_ceil(max);
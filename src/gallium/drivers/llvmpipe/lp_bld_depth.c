@@ -457,6 +457,16 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
                                        LLVMInt32TypeInContext(context), bits);
       count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
    }
+   else if(util_cpu_caps.has_avx512f && type.length == 16) {
+      /* The sign compare becomes a k register, count its bits directly. */
+      const char *popcntintr = "llvm.ctpop.i16";
+      LLVMTypeRef i16t = LLVMInt16TypeInContext(context);
+      LLVMValueRef bits = LLVMBuildICmp(builder, LLVMIntSLT, maskvalue,
+                                        LLVMConstNull(LLVMTypeOf(maskvalue)), "");
+      bits = LLVMBuildBitCast(builder, bits, i16t, "");
+      count = lp_build_intrinsic_unary(builder, popcntintr, i16t, bits);
+      count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
+   }
    else {
       unsigned i;
       LLVMValueRef countv = LLVMBuildAnd(builder, maskvalue, countmask, "countv");
@@ -545,6 +555,43 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
    struct lp_type zs_type = lp_depth_type(format_desc, z_src_type.length);
    struct lp_type zs_load_type = zs_type;
 
+   if (z_src_type.length == 16) {
+      /*
+       * 16 wide the vector is the whole 4x4 block: load the two 2x4 halves
+       * the 8-wide path uses and put them back together.
+       */
+      struct lp_type half_type = z_src_type;
+      LLVMValueRef first_half = LLVMBuildShl(builder, loop_counter,
+                                             lp_build_const_int32(gallivm, 1), "");
+      LLVMValueRef z_half[2], s_half[2];
+      unsigned i;
+
+      half_type.length = 8;
+      lp_build_depth_stencil_load_swizzled(gallivm, half_type, format_desc,
+                                           is_1d, depth_ptr, depth_stride,
+                                           &z_half[0], &s_half[0], first_half);
+      if (is_1d) {
+         z_half[1] = LLVMGetUndef(LLVMTypeOf(z_half[0]));
+         s_half[1] = LLVMGetUndef(LLVMTypeOf(s_half[0]));
+      }
+      else {
+         LLVMValueRef second_half =
+            LLVMBuildAdd(builder, first_half, lp_build_const_int32(gallivm, 1), "");
+         lp_build_depth_stencil_load_swizzled(gallivm, half_type, format_desc,
+                                              is_1d, depth_ptr, depth_stride,
+                                              &z_half[1], &s_half[1], second_half);
+      }
+
+      for (i = 0; i < 16; i++) {
+         shuffles[i] = lp_build_const_int32(gallivm, i);
+      }
+      *z_fb = LLVMBuildShuffleVector(builder, z_half[0], z_half[1],
+                                     LLVMConstVector(shuffles, 16), "z_dst");
+      *s_fb = LLVMBuildShuffleVector(builder, s_half[0], s_half[1],
+                                     LLVMConstVector(shuffles, 16), "s_dst");
+      return;
+   }
+
    zs_load_type.length = zs_load_type.length / 2;
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
@@ -691,6 +738,42 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
 
    lp_build_context_init(&z_bld, gallivm, z_type);
 
+   if (z_src_type.length == 16) {
+      /* As for the load: mask the whole block, then store the 2x4 halves. */
+      struct lp_type half_type = z_src_type;
+      LLVMValueRef first_half = LLVMBuildShl(builder, loop_counter,
+                                             lp_build_const_int32(gallivm, 1), "");
+      unsigned i;
+
+      if (format_desc->block.bits > 32) {
+         s_value = LLVMBuildBitCast(builder, s_value, z_bld.vec_type, "");
+      }
+      if (mask) {
+         mask_value = lp_build_mask_value(mask);
+         z_value = lp_build_select(&z_bld, mask_value, z_value, z_fb);
+         if (format_desc->block.bits > 32) {
+            s_fb = LLVMBuildBitCast(builder, s_fb, z_bld.vec_type, "");
+            s_value = lp_build_select(&z_bld, mask_value, s_value, s_fb);
+         }
+      }
+
+      half_type.length = 8;
+      for (i = 0; i < (is_1d ? 1 : 2); i++) {
+         LLVMValueRef half =
+            LLVMBuildAdd(builder, first_half, lp_build_const_int32(gallivm, i), "");
+         LLVMValueRef s_half = NULL;
+         if (s_value) {
+            s_half = lp_build_extract_range(gallivm, s_value, i * 8, 8);
+         }
+         lp_build_depth_stencil_write_swizzled(gallivm, half_type, format_desc,
+                                               is_1d, NULL, NULL, NULL, half,
+                                               depth_ptr, depth_stride,
+                                               lp_build_extract_range(gallivm, z_value, i * 8, 8),
+                                               s_half);
+      }
+      return;
+   }
+
    /*
     * This is far from ideal, at least for late depth write we should do this
     * outside the fs loop to avoid all the swizzle stuff.
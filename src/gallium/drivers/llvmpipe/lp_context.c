@@ -43,8 +43,10 @@
 #include "lp_flush.h"
 #include "lp_perf.h"
 #include "lp_state.h"
+#include "lp_state_cs.h"
 #include "lp_surface.h"
 #include "lp_query.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
 
 /* This is only safe if there's just one concurrent context */
@@ -89,6 +91,12 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       pipe_sampler_view_reference(&llvmpipe->sampler_views[PIPE_SHADER_GEOMETRY][i], NULL);
    }
 
+   for (i = 0; i < ARRAY_SIZE(llvmpipe->sampler_views[0]); i++) {
+      pipe_sampler_view_reference(&llvmpipe->sampler_views[PIPE_SHADER_COMPUTE][i], NULL);
+   }
+
+   llvmpipe_cleanup_compute(llvmpipe);
+
    for (i = 0; i < ARRAY_SIZE(llvmpipe->constants); i++) {
       for (j = 0; j < ARRAY_SIZE(llvmpipe->constants[i]); j++) {
          pipe_resource_reference(&llvmpipe->constants[i][j].buffer, NULL);
@@ -101,6 +109,8 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
 
    lp_delete_setup_variants(llvmpipe);
 
+   llvmpipe_cancel_fs_optimization(llvmpipe);
+
 #ifndef USE_GLOBAL_LLVM_CONTEXT
    LLVMContextDispose(llvmpipe->context);
 #endif
@@ -131,6 +141,22 @@ llvmpipe_render_condition(struct pipe_context *pipe,
    llvmpipe->render_cond_cond = condition;
 }
 
+static void
+lp_draw_disk_cache_find_shader(void *cookie,
+                               struct lp_cached_code *cache,
+                               const unsigned char ir_sha1_cache_key[20])
+{
+   lp_disk_cache_find_shader(cookie, cache, ir_sha1_cache_key);
+}
+
+static void
+lp_draw_disk_cache_insert_shader(void *cookie,
+                                 struct lp_cached_code *cache,
+                                 const unsigned char ir_sha1_cache_key[20])
+{
+   lp_disk_cache_insert_shader(cookie, cache, ir_sha1_cache_key);
+}
+
 struct pipe_context *
 llvmpipe_create_context(struct pipe_screen *screen, void *priv,
                         unsigned flags)
@@ -169,6 +195,7 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    llvmpipe_init_vertex_funcs(llvmpipe);
    llvmpipe_init_so_funcs(llvmpipe);
    llvmpipe_init_fs_funcs(llvmpipe);
+   llvmpipe_init_compute_funcs(llvmpipe);
    llvmpipe_init_vs_funcs(llvmpipe);
    llvmpipe_init_gs_funcs(llvmpipe);
    llvmpipe_init_rasterizer_funcs(llvmpipe);
@@ -192,6 +219,13 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    if (!llvmpipe->draw)
       goto fail;
 
+   if (llvmpipe_screen(screen)->disk_shader_cache) {
+      draw_set_disk_cache_callbacks(llvmpipe->draw,
+                                    llvmpipe_screen(screen),
+                                    lp_draw_disk_cache_find_shader,
+                                    lp_draw_disk_cache_insert_shader);
+   }
+
    /* FIXME: devise alternative to draw_texture_samplers */
 
    llvmpipe->setup = lp_setup_create( &llvmpipe->pipe,
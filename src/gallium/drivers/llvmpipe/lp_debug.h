@@ -59,6 +59,11 @@ st_print_current(void);
 #define PERF_NO_BLEND       0x20  	/* disable blending */
 #define PERF_NO_DEPTH       0x40  	/* disable depth buffering entirely */
 #define PERF_NO_ALPHATEST   0x80  	/* disable alpha testing */
+#define PERF_NO_RECT        0x100 	/* bin rectangles as triangles */
+#define PERF_NO_BLIT        0x200 	/* run blit shaders on rectangles */
+#define PERF_NO_TIERED      0x400 	/* optimize shaders before first use */
+#define PERF_NO_MT_SETUP    0x800 	/* set up all triangles on one thread */
+#define PERF_NO_HIZ         0x1000	/* bin occluded primitives anyway */
 
 
 extern int LP_PERF;
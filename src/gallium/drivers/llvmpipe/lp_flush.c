@@ -114,12 +114,14 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
 
       if (cpu_access) {
          /*
-          * Flush and wait.
+          * Flush and wait for the scenes using the resource, leaving the
+          * others running.
           */
          if (do_not_block)
             return FALSE;
 
-         llvmpipe_finish(pipe, reason);
+         llvmpipe_flush(pipe, NULL, reason);
+         lp_setup_wait_resource(llvmpipe_context(pipe)->setup, resource);
       } else {
          /*
           * Just flush.
@@ -33,18 +33,25 @@
  */
 
 
+#include "util/u_format.h"
 #include "util/u_memory.h"
+#include "state_tracker/sw_winsys.h"
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_format.h"
 #include "lp_context.h"
+#include "lp_debug.h"
 #include "lp_jit.h"
+#include "lp_memory.h"
+#include "lp_screen.h"
+#include "lp_state_cs.h"
 
 
 static void
-lp_jit_create_types(struct lp_fragment_shader_variant *lp)
+lp_jit_create_types(struct gallivm_state *gallivm,
+                    LLVMTypeRef *context_ptr_type,
+                    LLVMTypeRef *thread_data_ptr_type)
 {
-   struct gallivm_state *gallivm = lp->gallivm;
    LLVMContextRef lc = gallivm->context;
    LLVMTypeRef viewport_type, texture_type, sampler_type;
 
@@ -164,6 +171,11 @@ lp_jit_create_types(struct lp_fragment_shader_variant *lp)
                                                       PIPE_MAX_SHADER_SAMPLER_VIEWS);
       elem_types[LP_JIT_CTX_SAMPLERS] = LLVMArrayType(sampler_type,
                                                       PIPE_MAX_SAMPLERS);
+      elem_types[LP_JIT_CTX_SSBOS] =
+         LLVMArrayType(LLVMPointerType(LLVMInt32TypeInContext(lc), 0),
+                       LP_MAX_TGSI_SHADER_BUFFERS);
+      elem_types[LP_JIT_CTX_NUM_SSBOS] =
+         LLVMArrayType(LLVMInt32TypeInContext(lc), LP_MAX_TGSI_SHADER_BUFFERS);
 
       context_type = LLVMStructTypeInContext(lc, elem_types,
                                              ARRAY_SIZE(elem_types), 0);
@@ -198,10 +210,16 @@ lp_jit_create_types(struct lp_fragment_shader_variant *lp)
       LP_CHECK_MEMBER_OFFSET(struct lp_jit_context, samplers,
                              gallivm->target, context_type,
                              LP_JIT_CTX_SAMPLERS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_context, ssbos,
+                             gallivm->target, context_type,
+                             LP_JIT_CTX_SSBOS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_context, num_ssbos,
+                             gallivm->target, context_type,
+                             LP_JIT_CTX_NUM_SSBOS);
       LP_CHECK_STRUCT_SIZE(struct lp_jit_context,
                            gallivm->target, context_type);
 
-      lp->jit_context_ptr_type = LLVMPointerType(context_type, 0);
+      *context_ptr_type = LLVMPointerType(context_type, 0);
    }
 
    /* struct lp_jit_thread_data */
@@ -219,7 +237,7 @@ lp_jit_create_types(struct lp_fragment_shader_variant *lp)
       thread_data_type = LLVMStructTypeInContext(lc, elem_types,
                                                  ARRAY_SIZE(elem_types), 0);
 
-      lp->jit_thread_data_ptr_type = LLVMPointerType(thread_data_type, 0);
+      *thread_data_ptr_type = LLVMPointerType(thread_data_type, 0);
    }
 
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
@@ -234,6 +252,123 @@ lp_jit_create_types(struct lp_fragment_shader_variant *lp)
 }
 
 
+/**
+ * Set up the JIT texture for a sampler view.  The caller must hold a
+ * reference to the view's texture as long as the JIT texture is used.
+ */
+void
+lp_jit_texture_from_view(struct lp_jit_texture *jit_tex,
+                         const struct pipe_sampler_view *view)
+{
+   struct pipe_resource *res = view->texture;
+   struct llvmpipe_resource *lp_tex = llvmpipe_resource(res);
+
+   if (!lp_tex->dt) {
+      /* regular texture - setup array of mipmap level offsets */
+      int j;
+      unsigned first_level = 0;
+      unsigned last_level = 0;
+
+      if (llvmpipe_resource_is_texture(res)) {
+         first_level = view->u.tex.first_level;
+         last_level = view->u.tex.last_level;
+         assert(first_level <= last_level);
+         assert(last_level <= res->last_level);
+         jit_tex->base = lp_tex->tex_data;
+      }
+      else {
+        jit_tex->base = lp_tex->data;
+      }
+
+      if (LP_PERF & PERF_TEX_MEM) {
+         /* use dummy tile memory */
+         jit_tex->base = lp_dummy_tile;
+         jit_tex->width = TILE_SIZE/8;
+         jit_tex->height = TILE_SIZE/8;
+         jit_tex->depth = 1;
+         jit_tex->first_level = 0;
+         jit_tex->last_level = 0;
+         jit_tex->mip_offsets[0] = 0;
+         jit_tex->row_stride[0] = 0;
+         jit_tex->img_stride[0] = 0;
+      }
+      else {
+         jit_tex->width = res->width0;
+         jit_tex->height = res->height0;
+         jit_tex->depth = res->depth0;
+         jit_tex->first_level = first_level;
+         jit_tex->last_level = last_level;
+
+         if (llvmpipe_resource_is_texture(res)) {
+            for (j = first_level; j <= last_level; j++) {
+               jit_tex->mip_offsets[j] = lp_tex->mip_offsets[j];
+               jit_tex->row_stride[j] = lp_tex->row_stride[j];
+               jit_tex->img_stride[j] = lp_tex->img_stride[j];
+            }
+
+            if (res->target == PIPE_TEXTURE_1D_ARRAY ||
+                res->target == PIPE_TEXTURE_2D_ARRAY ||
+                res->target == PIPE_TEXTURE_CUBE ||
+                res->target == PIPE_TEXTURE_CUBE_ARRAY) {
+               /*
+                * For array textures, we don't have first_layer, instead
+                * adjust last_layer (stored as depth) plus the mip level offsets
+                * (as we have mip-first layout can't just adjust base ptr).
+                * XXX For mip levels, could do something similar.
+                */
+               jit_tex->depth = view->u.tex.last_layer - view->u.tex.first_layer + 1;
+               for (j = first_level; j <= last_level; j++) {
+                  jit_tex->mip_offsets[j] += view->u.tex.first_layer *
+                                             lp_tex->img_stride[j];
+               }
+               if (view->target == PIPE_TEXTURE_CUBE ||
+                   view->target == PIPE_TEXTURE_CUBE_ARRAY) {
+                  assert(jit_tex->depth % 6 == 0);
+               }
+               assert(view->u.tex.first_layer <= view->u.tex.last_layer);
+               assert(view->u.tex.last_layer < res->array_size);
+            }
+         }
+         else {
+            /*
+             * For buffers, we don't have "offset", instead adjust
+             * the size (stored as width) plus the base pointer.
+             */
+            unsigned view_blocksize = util_format_get_blocksize(view->format);
+            /* probably don't really need to fill that out */
+            jit_tex->mip_offsets[0] = 0;
+            jit_tex->row_stride[0] = 0;
+            jit_tex->img_stride[0] = 0;
+
+            /* everything specified in number of elements here. */
+            jit_tex->width = view->u.buf.size / view_blocksize;
+            jit_tex->base = (uint8_t *)jit_tex->base + view->u.buf.offset;
+            /* XXX Unsure if we need to sanitize parameters? */
+            assert(view->u.buf.offset + view->u.buf.size <= res->width0);
+         }
+      }
+   }
+   else {
+      /* display target texture/surface */
+      /*
+       * XXX: Where should this be unmapped?
+       */
+      struct llvmpipe_screen *screen = llvmpipe_screen(res->screen);
+      struct sw_winsys *winsys = screen->winsys;
+      jit_tex->base = winsys->displaytarget_map(winsys, lp_tex->dt,
+                                                PIPE_TRANSFER_READ);
+      jit_tex->row_stride[0] = lp_tex->row_stride[0];
+      jit_tex->img_stride[0] = lp_tex->img_stride[0];
+      jit_tex->mip_offsets[0] = 0;
+      jit_tex->width = res->width0;
+      jit_tex->height = res->height0;
+      jit_tex->depth = res->depth0;
+      jit_tex->first_level = jit_tex->last_level = 0;
+      assert(jit_tex->base);
+   }
+}
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen)
 {
@@ -252,5 +387,15 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp)
 {
    if (!lp->jit_context_ptr_type)
-      lp_jit_create_types(lp);
+      lp_jit_create_types(lp->gallivm, &lp->jit_context_ptr_type,
+                          &lp->jit_thread_data_ptr_type);
+}
+
+
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp)
+{
+   if (!lp->jit_context_ptr_type)
+      lp_jit_create_types(lp->gallivm, &lp->jit_context_ptr_type,
+                          &lp->jit_thread_data_ptr_type);
 }
@@ -45,6 +45,7 @@
 
 struct lp_build_format_cache;
 struct lp_fragment_shader_variant;
+struct lp_compute_shader_variant;
 struct llvmpipe_screen;
 
 
@@ -109,7 +110,8 @@ enum {
 
 
 /**
- * This structure is passed directly to the generated fragment shader.
+ * This structure is passed directly to the generated fragment and compute
+ * shaders.
  *
  * It contains the derived state.
  *
@@ -135,6 +137,10 @@ struct lp_jit_context
 
    struct lp_jit_texture textures[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    struct lp_jit_sampler samplers[PIPE_MAX_SAMPLERS];
+
+   /** Shader buffers, only used by compute shaders */
+   const uint32_t *ssbos[LP_MAX_TGSI_SHADER_BUFFERS];
+   int num_ssbos[LP_MAX_TGSI_SHADER_BUFFERS];
 };
 
 
@@ -153,6 +159,8 @@ enum {
    LP_JIT_CTX_VIEWPORTS,
    LP_JIT_CTX_TEXTURES,
    LP_JIT_CTX_SAMPLERS,
+   LP_JIT_CTX_SSBOS,
+   LP_JIT_CTX_NUM_SSBOS,
    LP_JIT_CTX_COUNT
 };
 
@@ -187,6 +195,12 @@ enum {
 #define lp_jit_context_samplers(_gallivm, _ptr) \
    lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CTX_SAMPLERS, "samplers")
 
+#define lp_jit_context_ssbos(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CTX_SSBOS, "ssbos")
+
+#define lp_jit_context_num_ssbos(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CTX_NUM_SSBOS, "num_ssbos")
+
 
 struct lp_jit_thread_data
 {
@@ -259,6 +273,36 @@ typedef void
                     unsigned depth_stride);
 
 
+/**
+ * typedef for compute shader function, which runs a whole work group
+ *
+ * @param context       jit context
+ * @param block_x/y/z   position of the work group in the grid
+ * @param grid_x/y/z    number of work groups in the grid
+ * @param size_x/y/z    number of invocations in the work group
+ * @param shared        shared memory of the work group
+ * @param thread_data   task thread data
+ */
+typedef void
+(*lp_jit_cs_func)(const struct lp_jit_context *context,
+                  uint32_t block_x,
+                  uint32_t block_y,
+                  uint32_t block_z,
+                  uint32_t grid_x,
+                  uint32_t grid_y,
+                  uint32_t grid_z,
+                  uint32_t size_x,
+                  uint32_t size_y,
+                  uint32_t size_z,
+                  void *shared,
+                  struct lp_jit_thread_data *thread_data);
+
+
+void
+lp_jit_texture_from_view(struct lp_jit_texture *jit_tex,
+                         const struct pipe_sampler_view *view);
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen);
 
@@ -271,4 +315,8 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp);
 
 
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp);
+
+
 #endif /* LP_JIT_H */
@@ -61,7 +61,16 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Max number of rasterizer threads, LP_NUM_THREADS is clamped to this.
+ */
+#define LP_MAX_THREADS 64
+
+/**
+ * Max number of threads setting up the triangles of a draw, including
+ * the one calling into the draw module.
+ */
+#define LP_MAX_SETUP_THREADS 8
 
 
 /**
@@ -42,9 +42,12 @@ struct lp_counters
 {
    unsigned nr_tris;
    unsigned nr_culled_tris;
+   unsigned nr_rects;
+   unsigned nr_blit_rects;
    unsigned nr_empty_64;
    unsigned nr_fully_covered_64;
    unsigned nr_partially_covered_64;
+   unsigned nr_hiz_culled_64;
    unsigned nr_pure_shade_opaque_64;
    unsigned nr_pure_shade_64;
    unsigned nr_shade_64;
@@ -33,6 +33,7 @@
 #include "util/u_pack_color.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
+#include "util/u_cpu_detect.h"
 
 #include "util/os_time.h"
 
@@ -70,15 +71,18 @@ lp_rast_begin( struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, rast->num_nodes );
 }
 
 
+/**
+ * The scene itself is freed by the setup module once its fence has
+ * signalled, so that scenes of a context can be rasterized while others
+ * are being binned.
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
-
    rast->curr_scene = NULL;
 }
 
@@ -588,7 +592,8 @@ static lp_rast_cmd_func dispatch[LP_RAST_OP_MAX] =
    lp_rast_triangle_32_8,
    lp_rast_triangle_32_3_4,
    lp_rast_triangle_32_3_16,
-   lp_rast_triangle_32_4_16
+   lp_rast_triangle_32_4_16,
+   lp_rast_rectangle
 };
 
 
@@ -675,14 +680,17 @@ rasterize_scene(struct lp_rasterizer_task *task,
 #endif
 #endif
 
-   if (!task->rast->no_rast) {
+   if (scene->job) {
+      scene->job->run(scene->job, task->thread_index, &task->thread_data);
+   }
+   else if (!task->rast->no_rast) {
       /* loop over scene bins, rasterize each */
       {
          struct cmd_bin *bin;
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->node, &i, &j))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
          }
@@ -756,23 +764,6 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
-void
-lp_rast_finish( struct lp_rasterizer *rast )
-{
-   if (rast->num_threads == 0) {
-      /* nothing to do */
-   }
-   else {
-      int i;
-
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
-   }
-}
-
-
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
@@ -837,11 +828,8 @@ thread_function(void *init_data)
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
 #ifdef _WIN32
@@ -866,6 +854,10 @@ create_rast_threads(struct lp_rasterizer *rast)
       pipe_semaphore_init(&rast->tasks[i].work_done, 0);
       rast->threads[i] = u_thread_create(thread_function,
                                             (void *) &rast->tasks[i]);
+      if (rast->num_nodes > 1) {
+         util_pin_thread_to_L3(rast->threads[i], rast->tasks[i].node,
+                               rast->cores_per_node);
+      }
    }
 }
 
@@ -892,10 +884,24 @@ lp_rast_create( unsigned num_threads )
       goto no_full_scenes;
    }
 
+   /* Spread the threads over the groups of CPUs sharing a L3 cache, or
+    * over the nodes given by LP_CORES_PER_NODE, e.g. the NUMA nodes.
+    */
+   rast->cores_per_node = debug_get_num_option("LP_CORES_PER_NODE",
+                                               util_cpu_caps.cores_per_L3);
+   rast->num_nodes = 1;
+   if (num_threads > 1 && rast->cores_per_node &&
+       rast->cores_per_node < util_cpu_caps.nr_cpus) {
+      rast->num_nodes = MIN2(DIV_ROUND_UP(util_cpu_caps.nr_cpus,
+                                          rast->cores_per_node),
+                             num_threads);
+   }
+
    for (i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
       task->thread_index = i;
+      task->node = i * rast->num_nodes / MAX2(1, num_threads);
       task->thread_data.cache = align_malloc(sizeof(struct lp_build_format_cache),
                                              16);
       if (!task->thread_data.cache) {
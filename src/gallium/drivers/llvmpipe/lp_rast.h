@@ -39,6 +39,7 @@
 
 #include "pipe/p_compiler.h"
 #include "util/u_pack_color.h"
+#include "util/u_rect.h"
 #include "lp_jit.h"
 
 
@@ -143,6 +144,31 @@ struct lp_rast_triangle {
 };
 
 
+/**
+ * Rasterization information for an axis-aligned rectangle, which doesn't
+ * need any edge plane.  Allocated like lp_rast_triangle.
+ */
+struct lp_rast_rectangle {
+   /* the covered pixels, inclusive, already clipped to the draw region */
+   struct u_rect box;
+
+   /*
+    * For blit shader variants, the rectangle is drawn by copying or
+    * blending the texels of texture 0 directly: texel (x + blit_dx,
+    * blit_dy + y * blit_dy_step) for pixel (x, y).  blit_dy_step is zero
+    * when the shader has to be run instead.
+    */
+   int blit_dx;
+   int blit_dy;
+   int blit_dy_step;
+   int pad0;
+
+   /* inputs for the shader */
+   struct lp_rast_shader_inputs inputs;
+   /* a0, dadx and dady are also allocated here */
+};
+
+
 struct lp_rast_clear_rb {
    union util_color color_val;
    unsigned cbuf;
@@ -156,6 +182,20 @@ struct lp_rast_clear_rb {
 
 
 
+/**
+ * Work for the rasterizer threads other than rendering bins, such as
+ * compute shader work groups.  It is queued as a scene which only holds
+ * the job, and run() is called by every thread, which must share the work
+ * among themselves.  The scene's fence signals once all of them returned.
+ */
+struct lp_rast_job
+{
+   void (*run)(struct lp_rast_job *job,
+               unsigned thread_index,
+               struct lp_jit_thread_data *thread_data);
+};
+
+
 struct lp_rasterizer *
 lp_rast_create( unsigned num_threads );
 
@@ -166,9 +206,6 @@ void
 lp_rast_queue_scene( struct lp_rasterizer *rast,
                      struct lp_scene *scene );
 
-void
-lp_rast_finish( struct lp_rasterizer *rast );
-
 
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
@@ -176,6 +213,7 @@ union lp_rast_cmd_arg {
       const struct lp_rast_triangle *tri;
       unsigned plane_mask;
    } triangle;
+   const struct lp_rast_rectangle *rectangle;
    const struct lp_rast_state *set_state;
    const struct lp_rast_clear_rb *clear_rb;
    struct {
@@ -198,6 +236,14 @@ lp_rast_arg_inputs( const struct lp_rast_shader_inputs *shade_tile )
    return arg;
 }
 
+static inline union lp_rast_cmd_arg
+lp_rast_arg_rectangle( const struct lp_rast_rectangle *rectangle )
+{
+   union lp_rast_cmd_arg arg;
+   arg.rectangle = rectangle;
+   return arg;
+}
+
 static inline union lp_rast_cmd_arg
 lp_rast_arg_triangle( const struct lp_rast_triangle *triangle,
                       unsigned plane_mask)
@@ -302,8 +348,9 @@ lp_rast_arg_null( void )
 #define LP_RAST_OP_TRIANGLE_32_3_4   0x1a
 #define LP_RAST_OP_TRIANGLE_32_3_16  0x1b
 #define LP_RAST_OP_TRIANGLE_32_4_16  0x1c
+#define LP_RAST_OP_RECTANGLE         0x1d
 
-#define LP_RAST_OP_MAX               0x1d
+#define LP_RAST_OP_MAX               0x1e
 #define LP_RAST_OP_MASK              0xff
 
 void
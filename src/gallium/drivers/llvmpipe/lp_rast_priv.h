@@ -97,6 +97,9 @@ struct lp_rasterizer_task
    /** "my" index */
    unsigned thread_index;
 
+   /** Group of CPUs this thread runs on, and band of tiles it starts with */
+   unsigned node;
+
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
@@ -127,6 +130,10 @@ struct lp_rasterizer
    unsigned num_threads;
    thrd_t threads[LP_MAX_THREADS];
 
+   /** Threads are spread over num_nodes groups of cores_per_node CPUs */
+   unsigned num_nodes;
+   unsigned cores_per_node;
+
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
 };
@@ -331,6 +338,9 @@ void lp_rast_triangle_32_3_16( struct lp_rasterizer_task *,
 void lp_rast_triangle_32_4_16( struct lp_rasterizer_task *, 
                             const union lp_rast_cmd_arg );
 
+void lp_rast_rectangle( struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg );
+
 void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg);
@@ -0,0 +1,181 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/*
+ * Rasterization for binned axis-aligned rectangles within a tile
+ */
+
+#include "util/u_math.h"
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_rast_priv.h"
+#include "lp_state_fs.h"
+
+
+/**
+ * Multiply two 8-bit unorm values, rounding to nearest.
+ */
+static inline unsigned
+mul_unorm8(unsigned a, unsigned b)
+{
+   unsigned t = a * b + 0x80;
+   return (t + (t >> 8)) >> 8;
+}
+
+
+/**
+ * Draw the rectangle part inside the tile by copying or blending the
+ * texels of texture 0 directly, for blit shader variants.  The setup code
+ * made sure these texels are all inside the texture.
+ */
+static void
+blit_rect(struct lp_rasterizer_task *task,
+          const struct lp_rast_rectangle *rect,
+          const struct u_rect *box)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct lp_rast_state *state = task->state;
+   const struct lp_jit_texture *tex = &state->jit_context.textures[0];
+   const unsigned dst_stride = scene->cbufs[0].stride;
+   const unsigned width = box->x1 - box->x0 + 1;
+   uint8_t *dst;
+   int y;
+
+   dst = task->color_tiles[0] +
+         (box->x0 % TILE_SIZE) * 4 +
+         (box->y0 % TILE_SIZE) * dst_stride;
+
+   for (y = box->y0; y <= box->y1; y++) {
+      const uint8_t *src = (const uint8_t *)tex->base +
+                           tex->mip_offsets[0] +
+                           (rect->blit_dy + y * rect->blit_dy_step) *
+                           tex->row_stride[0] +
+                           (box->x0 + rect->blit_dx) * 4;
+
+      if (state->variant->blit == LP_BLIT_COPY) {
+         memcpy(dst, src, width * 4);
+      }
+      else {
+         unsigned i, c;
+
+         assert(state->variant->blit == LP_BLIT_OVER);
+
+         /* premultiplied alpha: dst = src + dst * (1 - src.a) */
+         for (i = 0; i < width; i++) {
+            const uint8_t *s = src + i * 4;
+            uint8_t *d = dst + i * 4;
+            const unsigned inv_alpha = 255 - s[3];
+
+            if (inv_alpha == 0) {
+               memcpy(d, s, 4);
+            }
+            else if (inv_alpha != 255) {
+               for (c = 0; c < 4; c++)
+                  d[c] = MIN2(s[c] + mul_unorm8(d[c], inv_alpha), 255);
+            }
+            else if (s[0] | s[1] | s[2]) {
+               for (c = 0; c < 3; c++)
+                  d[c] = MIN2(s[c] + d[c], 255);
+            }
+         }
+      }
+
+      dst += dst_stride;
+   }
+}
+
+
+/**
+ * Shade the part of a rectangle inside the current tile.
+ * This is a bin command called during bin processing.
+ */
+void
+lp_rast_rectangle(struct lp_rasterizer_task *task,
+                  const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_rectangle *rect = arg.rectangle;
+   const struct lp_rast_shader_inputs *inputs = &rect->inputs;
+   struct u_rect box;
+   int x, y;
+
+   if (inputs->disable) {
+      /* This command was partially binned and has been disabled */
+      return;
+   }
+
+   LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
+
+   assert(task->state);
+   if (!task->state) {
+      return;
+   }
+
+   /* Clip to the tile */
+   box.x0 = MAX2(rect->box.x0, (int)task->x);
+   box.y0 = MAX2(rect->box.y0, (int)task->y);
+   box.x1 = MIN2(rect->box.x1, (int)(task->x + task->width) - 1);
+   box.y1 = MIN2(rect->box.y1, (int)(task->y + task->height) - 1);
+   if (box.x1 < box.x0 || box.y1 < box.y0) {
+      return;
+   }
+
+   if (rect->blit_dy_step) {
+      blit_rect(task, rect, &box);
+      return;
+   }
+
+   /* Shade the 4x4 blocks, masking out the pixels outside the box */
+   for (y = box.y0 & ~3; y <= box.y1; y += 4) {
+      unsigned row_mask = 0xf;
+
+      if (y < box.y0)
+         row_mask &= 0xf << (box.y0 - y);
+      if (y + 3 > box.y1)
+         row_mask &= 0xf >> (y + 3 - box.y1);
+
+      for (x = box.x0 & ~3; x <= box.x1; x += 4) {
+         unsigned col_mask = 0xf;
+         unsigned mask;
+
+         if (x < box.x0)
+            col_mask &= 0xf << (box.x0 - x);
+         if (x + 3 > box.x1)
+            col_mask &= 0xf >> (x + 3 - box.x1);
+
+         /* bit (4 * row + column) of the mask covers that pixel */
+         mask = col_mask * ((row_mask & 1) |
+                            ((row_mask & 2) << 3) |
+                            ((row_mask & 4) << 6) |
+                            ((row_mask & 8) << 9));
+
+         if (mask == 0xffff)
+            lp_rast_shade_quads_all(task, inputs, x, y);
+         else
+            lp_rast_shade_quads_mask(task, inputs, x, y, mask);
+      }
+   }
+}
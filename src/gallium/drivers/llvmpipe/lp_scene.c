@@ -31,6 +31,7 @@
 #include "util/u_inlines.h"
 #include "util/simple_list.h"
 #include "util/u_format.h"
+#include "util/u_atomic.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
@@ -351,6 +352,37 @@ lp_scene_new_data_block( struct lp_scene *scene )
 }
 
 
+/**
+ * Allocate a data block for lp_scene_thread_alloc_aligned().  It goes
+ * right after the current block so lp_scene_alloc() never uses it.
+ */
+struct data_block *
+lp_scene_new_thread_block( struct lp_scene *scene )
+{
+   struct data_block *block = NULL;
+
+   mtx_lock(&scene->mutex);
+
+   if (scene->scene_size + DATA_BLOCK_SIZE > LP_SCENE_MAX_SIZE) {
+      scene->alloc_failed = TRUE;
+   }
+   else {
+      block = MALLOC_STRUCT(data_block);
+      if (block) {
+         scene->scene_size += sizeof *block;
+
+         block->used = 0;
+         block->next = scene->data.head->next;
+         scene->data.head->next = block;
+      }
+   }
+
+   mtx_unlock(&scene->mutex);
+
+   return block;
+}
+
+
 /**
  * Return number of bytes used for all bin data within a scene.
  * This does not include resources (textures) referenced by the scene.
@@ -449,68 +481,117 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Estimate the time to rasterize a bin from its number of commands.
+ */
+static unsigned
+bin_cost(const struct cmd_bin *bin)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
+   const struct cmd_block *block;
+   unsigned cost = 0;
+
+   for (block = bin->head; block; block = block->next)
+      cost += block->count;
+
+   return cost;
+}
+
+
+static int
+compare_bin_cost(const void *a, const void *b)
+{
+   unsigned cost_a = *(const unsigned *) a;
+   unsigned cost_b = *(const unsigned *) b;
+
+   return cost_a < cost_b ? 1 : cost_a > cost_b ? -1 : 0;
 }
 
 
+/**
+ * Prepare iterating over the non-empty bins with lp_scene_bin_iter_next().
+ *
+ * The tile rows are split in num_bands bands of consecutive rows.  Each
+ * group of rasterizer threads starts with the bins of its own band, so a
+ * given tile tends to be rendered on the same CPUs scene after scene.
+ * The bins of a band are handed out most expensive first, so that no
+ * thread is left with a big bin while the others are done.
+ */
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_bands )
 {
-   scene->curr_x = scene->curr_y = -1;
+   unsigned i, x, y;
+   unsigned n = 0;
+
+   num_bands = MAX2(1, MIN2(num_bands, scene->tiles_y));
+   num_bands = MIN2(num_bands, LP_MAX_THREADS);
+
+   for (i = 0; i < num_bands; i++) {
+      unsigned start_y = i * scene->tiles_y / num_bands;
+      unsigned end_y = (i + 1) * scene->tiles_y / num_bands;
+
+      scene->band[i].start = n;
+
+      for (y = start_y; y < end_y; y++) {
+         for (x = 0; x < scene->tiles_x; x++) {
+            const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+
+            if (!bin->head)
+               continue;
+
+            scene->bin_order[n].cost = bin_cost(bin);
+            scene->bin_order[n].x = x;
+            scene->bin_order[n].y = y;
+            n++;
+         }
+      }
+
+      scene->band[i].end = n;
+      scene->band[i].next = scene->band[i].start;
+
+      qsort(&scene->bin_order[scene->band[i].start],
+            scene->band[i].end - scene->band[i].start,
+            sizeof(scene->bin_order[0]), compare_bin_cost);
+   }
+   scene->num_bands = num_bands;
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
+ * Return pointer to next bin to be rendered, or NULL when all its bins
+ * were handed out.
+ * The bins of \p band come first, then the ones left in the other bands.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  This is lock free.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned band,
+                        int *x, int *y )
 {
-   struct cmd_bin *bin = NULL;
+   unsigned i;
 
-   mtx_lock(&scene->mutex);
+   for (i = 0; i < scene->num_bands; i++) {
+      unsigned b = (band + i) % scene->num_bands;
+      int index;
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
-   }
+      if (p_atomic_read(&scene->band[b].next) >= scene->band[b].end)
+         continue;
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+      index = p_atomic_inc_return(&scene->band[b].next) - 1;
+      if (index < scene->band[b].end) {
+         *x = scene->bin_order[index].x;
+         *y = scene->bin_order[index].y;
+         return lp_scene_get_bin(scene, *x, *y);
+      }
+   }
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   mtx_unlock(&scene->mutex);
-   return bin;
+   return NULL;
 }
 
 
 void lp_scene_begin_binning(struct lp_scene *scene,
                             struct pipe_framebuffer_state *fb)
 {
-   int i;
+   int i, j;
    unsigned max_layer = ~0;
 
    assert(lp_scene_is_empty(scene));
@@ -545,6 +626,19 @@ void lp_scene_begin_binning(struct lp_scene *scene,
       max_layer = MIN2(max_layer, zsbuf->u.tex.last_layer - zsbuf->u.tex.first_layer);
    }
    scene->fb_max_layer = max_layer;
+
+   /*
+    * The depth bounds are only known from the commands binned so far, and
+    * can't tell layers apart.
+    */
+   scene->hiz = fb->zsbuf && max_layer == 0 && !(LP_PERF & PERF_NO_HIZ);
+   if (scene->hiz) {
+      for (i = 0; i < scene->tiles_x; i++) {
+         for (j = 0; j < scene->tiles_y; j++) {
+            scene->tile[i][j].zmax = FLT_MAX;
+         }
+      }
+   }
 }
 
 
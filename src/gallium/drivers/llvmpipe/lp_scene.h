@@ -38,9 +38,11 @@
 #include "os/os_thread.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
+#include "lp_limits.h"
 
 struct lp_scene_queue;
 struct lp_rast_state;
+struct lp_rast_job;
 
 /* We're limited to 2K by 2K for 32bit fixed point rasterization.
  * Will need a 64-bit version for larger framebuffers.
@@ -97,6 +99,7 @@ struct cmd_bin {
    const struct lp_rast_state *last_state;       /* most recent state set in bin */
    struct cmd_block *head;
    struct cmd_block *tail;
+   float zmax;             /* upper bound of the tile's depth, see lp_setup_hiz_occluded() */
 };
    
 
@@ -129,6 +132,9 @@ struct lp_scene {
    struct pipe_context *pipe;
    struct lp_fence *fence;
 
+   /** If not NULL, run by the rasterizer threads instead of the bins */
+   struct lp_rast_job *job;
+
    /* The queries still active at end of scene */
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
    unsigned num_active_queries;
@@ -148,6 +154,9 @@ struct lp_scene {
    /* The amount of layers in the fb (minimum of all attachments) */
    unsigned fb_max_layer;
 
+   /* Whether the bins' zmax bounds are kept, see lp_setup_hiz_occluded() */
+   boolean hiz;
+
    /** the framebuffer to render the scene into */
    struct pipe_framebuffer_state fb;
 
@@ -172,11 +181,28 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   mtx_t mutex;
+   /**
+    * For iterating over bins, see lp_scene_bin_iter_begin().  The
+    * non-empty bins of each band of tile rows are in
+    * bin_order[band[i].start..band[i].end), most expensive first, and
+    * band[i].next is the next one to render.
+    */
+   struct {
+      int next;
+      int start, end;
+   } band[LP_MAX_THREADS];
+   unsigned num_bands;
+
+   struct {
+      unsigned cost;
+      ushort x, y;
+   } bin_order[TILES_X * TILES_Y];
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
+
+   /** Protects the data list and scene_size in lp_scene_new_thread_block() */
+   mtx_t mutex;
 };
 
 
@@ -191,6 +217,8 @@ boolean lp_scene_is_oom(struct lp_scene *scene );
 
 struct data_block *lp_scene_new_data_block( struct lp_scene *scene );
 
+struct data_block *lp_scene_new_thread_block( struct lp_scene *scene );
+
 struct cmd_block *lp_scene_new_cmd_block( struct lp_scene *scene,
                                           struct cmd_bin *bin );
 
@@ -269,6 +297,38 @@ lp_scene_alloc_aligned( struct lp_scene *scene, unsigned size,
 }
 
 
+/**
+ * As above, but for threads binning in parallel.  Each thread allocates
+ * from its own data block, which is linked into the scene but isn't the
+ * scene's current block, so only getting a new block needs a lock.
+ * The block must be reset to NULL when the scene is.
+ */
+static inline void *
+lp_scene_thread_alloc_aligned( struct lp_scene *scene,
+                               struct data_block **thread_block,
+                               unsigned size,
+                               unsigned alignment )
+{
+   struct data_block *block = *thread_block;
+
+   assert(size + alignment - 1 <= DATA_BLOCK_SIZE);
+
+   if (!block || block->used + size + alignment - 1 > DATA_BLOCK_SIZE) {
+      block = lp_scene_new_thread_block( scene );
+      *thread_block = block;
+      if (!block)
+         return NULL;
+   }
+
+   {
+      ubyte *data = block->data + block->used;
+      unsigned offset = (((uintptr_t)data + alignment - 1) & ~(alignment - 1)) - (uintptr_t)data;
+      block->used += offset + size;
+      return data + offset;
+   }
+}
+
+
 /* Put back data if we decide not to use it, eg. culled triangles.
  */
 static inline void
@@ -378,10 +438,11 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_bands );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned band,
+                        int *x, int *y );
 
 
 
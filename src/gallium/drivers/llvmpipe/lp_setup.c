@@ -36,6 +36,7 @@
 
 #include "pipe/p_defines.h"
 #include "util/u_framebuffer.h"
+#include "util/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_pack_color.h"
@@ -80,6 +81,7 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
                       __FUNCTION__, setup->scene->fence->id);
 
       lp_fence_wait(setup->scene->fence);
+      lp_scene_end_rasterization(setup->scene);
    }
 
    lp_scene_begin_binning(setup->scene, &setup->fb);
@@ -133,6 +135,7 @@ void lp_setup_reset( struct lp_setup_context *setup )
 
    /* no current bin */
    setup->scene = NULL;
+   lp_setup_reset_threads( setup );
 
    /* Reset some state:
     */
@@ -165,23 +168,15 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    if (setup->last_fence)
       setup->last_fence->issued = TRUE;
 
-   mtx_lock(&screen->rast_mutex);
-
-   /* FIXME: We enqueue the scene then wait on the rasterizer to finish.
-    * This means we never actually run any vertex stuff in parallel to
-    * rasterization (not in the same context at least) which is what the
-    * multiple scenes per setup is about - when we get a new empty scene
-    * any old one is already empty again because we waited here for
-    * raster tasks to be finished. Ideally, we shouldn't need to wait here
-    * and rely on fences elsewhere when waiting is necessary.
-    * Certainly, lp_scene_end_rasterization() would need to be deferred too
-    * and there's probably other bits why this doesn't actually work.
+   /* Don't wait for the rasterizer here: binning of the next scene
+    * overlaps with rasterization of this one.  The scene is only freed
+    * once its fence has signalled, when it is picked again by
+    * lp_setup_get_empty_scene().
     */
+   mtx_lock(&screen->rast_mutex);
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
    mtx_unlock(&screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -189,6 +184,23 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
 
 
 
+/** After a depth clear, the depth of every tile is known */
+static void
+hiz_clear( struct lp_scene *scene, float depth )
+{
+   unsigned x, y;
+
+   if (!scene->hiz)
+      return;
+
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         lp_scene_get_bin(scene, x, y)->zmax = depth;
+      }
+   }
+}
+
+
 static boolean
 begin_binning( struct lp_setup_context *setup )
 {
@@ -253,6 +265,9 @@ begin_binning( struct lp_setup_context *setup )
                                           setup->clear.zsmask));
          if (!ok)
             return FALSE;
+
+         if (setup->clear.flags & PIPE_CLEAR_DEPTH)
+            hiz_clear(scene, setup->clear.depth);
       }
    }
 
@@ -514,6 +529,9 @@ lp_setup_try_clear_zs(struct lp_setup_context *setup,
                                    LP_RAST_OP_CLEAR_ZSTENCIL,
                                    lp_rast_arg_clearzs(zsvalue, zsmask)))
          return FALSE;
+
+      if (flags & PIPE_CLEAR_DEPTH)
+         hiz_clear(scene, (float)depth);
    }
    else {
       /* Put ourselves into the 'pre-clear' state, specifically to try
@@ -524,6 +542,8 @@ lp_setup_try_clear_zs(struct lp_setup_context *setup,
       set_scene_state( setup, SETUP_CLEARED, __FUNCTION__ );
 
       setup->clear.flags |= flags;
+      if (flags & PIPE_CLEAR_DEPTH)
+         setup->clear.depth = (float)depth;
 
       setup->clear.zsmask |= zsmask;
       setup->clear.zsvalue =
@@ -630,6 +650,58 @@ lp_setup_set_setup_variant( struct lp_setup_context *setup,
    setup->setup.variant = variant;
 }
 
+/**
+ * How primitives drawn with the variant use and affect the bins' depth
+ * bounds, see lp_setup_hiz_occluded().
+ */
+static unsigned
+hiz_flags( const struct lp_fragment_shader_variant *variant )
+{
+   const struct lp_fragment_shader_variant_key *key = &variant->key;
+   const struct tgsi_shader_info *info = &variant->shader->info.base;
+   unsigned flags = 0;
+
+   if (!key->depth.enabled)
+      return 0;
+
+   switch (key->depth.func) {
+   case PIPE_FUNC_NEVER:
+      return 0;
+   case PIPE_FUNC_LESS:
+   case PIPE_FUNC_LEQUAL:
+   case PIPE_FUNC_EQUAL:
+      /* Stencil ops apply to fragments failing the depth test */
+      if (!key->stencil[0].enabled && !info->writes_z)
+         flags |= LP_SETUP_HIZ_TEST;
+      if (key->depth.func != PIPE_FUNC_EQUAL &&
+          key->depth.writemask &&
+          !key->stencil[0].enabled &&
+          !key->alpha.enabled &&
+          !key->blend.alpha_to_coverage &&
+          !info->writes_z &&
+          !info->uses_kill &&
+          !info->writes_samplemask)
+         flags |= LP_SETUP_HIZ_WRITE;
+      if (key->depth.func != PIPE_FUNC_EQUAL &&
+          key->depth.writemask &&
+          !util_format_is_float(key->zsbuf_format))
+         flags |= LP_SETUP_HIZ_UNORM_WRITE;
+      break;
+   default:
+      if (key->depth.writemask)
+         flags |= LP_SETUP_HIZ_RAISE;
+      break;
+   }
+
+   if (key->depth_clamp)
+      flags |= LP_SETUP_HIZ_CLAMP;
+   if (!util_format_is_float(key->zsbuf_format))
+      flags |= LP_SETUP_HIZ_UNORM;
+
+   return flags;
+}
+
+
 void
 lp_setup_set_fs_variant( struct lp_setup_context *setup,
                          struct lp_fragment_shader_variant *variant)
@@ -639,6 +711,7 @@ lp_setup_set_fs_variant( struct lp_setup_context *setup,
    /* FIXME: reference count */
 
    setup->fs.current.variant = variant;
+   setup->fs.hiz = hiz_flags(variant);
    setup->dirty |= LP_SETUP_NEW_FS;
 }
 
@@ -808,118 +881,14 @@ lp_setup_set_fragment_sampler_views(struct lp_setup_context *setup,
 
       if (view) {
          struct pipe_resource *res = view->texture;
-         struct llvmpipe_resource *lp_tex = llvmpipe_resource(res);
-         struct lp_jit_texture *jit_tex;
-         jit_tex = &setup->fs.current.jit_context.textures[i];
 
          /* We're referencing the texture's internal data, so save a
           * reference to it.
           */
          pipe_resource_reference(&setup->fs.current_tex[i], res);
 
-         if (!lp_tex->dt) {
-            /* regular texture - setup array of mipmap level offsets */
-            int j;
-            unsigned first_level = 0;
-            unsigned last_level = 0;
-
-            if (llvmpipe_resource_is_texture(res)) {
-               first_level = view->u.tex.first_level;
-               last_level = view->u.tex.last_level;
-               assert(first_level <= last_level);
-               assert(last_level <= res->last_level);
-               jit_tex->base = lp_tex->tex_data;
-            }
-            else {
-              jit_tex->base = lp_tex->data;
-            }
-
-            if (LP_PERF & PERF_TEX_MEM) {
-               /* use dummy tile memory */
-               jit_tex->base = lp_dummy_tile;
-               jit_tex->width = TILE_SIZE/8;
-               jit_tex->height = TILE_SIZE/8;
-               jit_tex->depth = 1;
-               jit_tex->first_level = 0;
-               jit_tex->last_level = 0;
-               jit_tex->mip_offsets[0] = 0;
-               jit_tex->row_stride[0] = 0;
-               jit_tex->img_stride[0] = 0;
-            }
-            else {
-               jit_tex->width = res->width0;
-               jit_tex->height = res->height0;
-               jit_tex->depth = res->depth0;
-               jit_tex->first_level = first_level;
-               jit_tex->last_level = last_level;
-
-               if (llvmpipe_resource_is_texture(res)) {
-                  for (j = first_level; j <= last_level; j++) {
-                     jit_tex->mip_offsets[j] = lp_tex->mip_offsets[j];
-                     jit_tex->row_stride[j] = lp_tex->row_stride[j];
-                     jit_tex->img_stride[j] = lp_tex->img_stride[j];
-                  }
-
-                  if (res->target == PIPE_TEXTURE_1D_ARRAY ||
-                      res->target == PIPE_TEXTURE_2D_ARRAY ||
-                      res->target == PIPE_TEXTURE_CUBE ||
-                      res->target == PIPE_TEXTURE_CUBE_ARRAY) {
-                     /*
-                      * For array textures, we don't have first_layer, instead
-                      * adjust last_layer (stored as depth) plus the mip level offsets
-                      * (as we have mip-first layout can't just adjust base ptr).
-                      * XXX For mip levels, could do something similar.
-                      */
-                     jit_tex->depth = view->u.tex.last_layer - view->u.tex.first_layer + 1;
-                     for (j = first_level; j <= last_level; j++) {
-                        jit_tex->mip_offsets[j] += view->u.tex.first_layer *
-                                                   lp_tex->img_stride[j];
-                     }
-                     if (view->target == PIPE_TEXTURE_CUBE ||
-                         view->target == PIPE_TEXTURE_CUBE_ARRAY) {
-                        assert(jit_tex->depth % 6 == 0);
-                     }
-                     assert(view->u.tex.first_layer <= view->u.tex.last_layer);
-                     assert(view->u.tex.last_layer < res->array_size);
-                  }
-               }
-               else {
-                  /*
-                   * For buffers, we don't have "offset", instead adjust
-                   * the size (stored as width) plus the base pointer.
-                   */
-                  unsigned view_blocksize = util_format_get_blocksize(view->format);
-                  /* probably don't really need to fill that out */
-                  jit_tex->mip_offsets[0] = 0;
-                  jit_tex->row_stride[0] = 0;
-                  jit_tex->img_stride[0] = 0;
-
-                  /* everything specified in number of elements here. */
-                  jit_tex->width = view->u.buf.size / view_blocksize;
-                  jit_tex->base = (uint8_t *)jit_tex->base + view->u.buf.offset;
-                  /* XXX Unsure if we need to sanitize parameters? */
-                  assert(view->u.buf.offset + view->u.buf.size <= res->width0);
-               }
-            }
-         }
-         else {
-            /* display target texture/surface */
-            /*
-             * XXX: Where should this be unmapped?
-             */
-            struct llvmpipe_screen *screen = llvmpipe_screen(res->screen);
-            struct sw_winsys *winsys = screen->winsys;
-            jit_tex->base = winsys->displaytarget_map(winsys, lp_tex->dt,
-                                                         PIPE_TRANSFER_READ);
-            jit_tex->row_stride[0] = lp_tex->row_stride[0];
-            jit_tex->img_stride[0] = lp_tex->img_stride[0];
-            jit_tex->mip_offsets[0] = 0;
-            jit_tex->width = res->width0;
-            jit_tex->height = res->height0;
-            jit_tex->depth = res->depth0;
-            jit_tex->first_level = jit_tex->last_level = 0;
-            assert(jit_tex->base);
-         }
+         lp_jit_texture_from_view(&setup->fs.current.jit_context.textures[i],
+                                  view);
       }
       else {
          pipe_resource_reference(&setup->fs.current_tex[i], NULL);
@@ -968,6 +937,35 @@ lp_setup_set_fragment_sampler_state(struct lp_setup_context *setup,
  * Note: we have to check all scenes including any scenes currently
  * being rendered and the current scene being built.
  */
+/**
+ * How \p scene references \p texture, if it isn't done with it yet.
+ * Scenes whose fence has signalled still hold their references until they
+ * are reused, but no longer access their resources.
+ */
+static unsigned
+scene_references( const struct lp_scene *scene,
+                  const struct pipe_resource *texture )
+{
+   unsigned i;
+
+   if (scene->fence && scene->fence->issued &&
+       lp_fence_signalled(scene->fence))
+      return LP_UNREFERENCED;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i] && scene->fb.cbufs[i]->texture == texture)
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+   }
+   if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture)
+      return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+
+   if (lp_scene_is_resource_referenced(scene, texture))
+      return LP_REFERENCED_FOR_READ;
+
+   return LP_UNREFERENCED;
+}
+
+
 unsigned
 lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
                                 const struct pipe_resource *texture )
@@ -983,17 +981,38 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
       return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
    }
 
-   /* check textures referenced by the scene */
+   /* check the scenes still being binned or rasterized */
    for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
-         return LP_REFERENCED_FOR_READ;
-      }
+      unsigned referenced = scene_references(setup->scenes[i], texture);
+      if (referenced)
+         return referenced;
    }
 
    return LP_UNREFERENCED;
 }
 
 
+/**
+ * Wait until the scenes already queued for rasterization are done with
+ * \p texture.  Unlike waiting on the last fence, this leaves the scenes
+ * which don't use it running.
+ */
+void
+lp_setup_wait_resource( struct lp_setup_context *setup,
+                        const struct pipe_resource *texture )
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
+      struct lp_scene *scene = setup->scenes[i];
+
+      if (scene != setup->scene && scene->fence &&
+          scene_references(scene, texture))
+         lp_fence_wait(scene->fence);
+   }
+}
+
+
 /**
  * Called by vbuf code when we're about to draw something.
  *
@@ -1184,6 +1203,10 @@ try_update_scene_state( struct lp_setup_context *setup )
       }
    }
 
+   /* The bins' depth bounds no longer hold */
+   if (setup->fs.hiz & LP_SETUP_HIZ_RAISE)
+      scene->hiz = FALSE;
+
    setup->dirty = 0;
 
    assert(setup->fs.stored);
@@ -1275,6 +1298,8 @@ lp_setup_destroy( struct lp_setup_context *setup )
 
    lp_setup_reset( setup );
 
+   lp_setup_destroy_threads( setup );
+
    util_unreference_framebuffer_state(&setup->fb);
 
    for (i = 0; i < ARRAY_SIZE(setup->fs.current_tex); i++) {
@@ -1289,8 +1314,10 @@ lp_setup_destroy( struct lp_setup_context *setup )
    for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
       struct lp_scene *scene = setup->scenes[i];
 
-      if (scene->fence)
+      if (scene->fence) {
          lp_fence_wait(scene->fence);
+         lp_scene_end_rasterization(scene);
+      }
 
       lp_scene_destroy(scene);
    }
@@ -1319,14 +1346,19 @@ lp_setup_create( struct pipe_context *pipe,
       goto no_setup;
    }
 
-   lp_setup_init_vbuf(setup);
-   
    /* Used only in update_state():
     */
    setup->pipe = pipe;
 
 
    setup->num_threads = screen->num_threads;
+
+   if (!lp_setup_init_threads(setup)) {
+      goto no_threads;
+   }
+
+   lp_setup_init_vbuf(setup);
+
    setup->vbuf = draw_vbuf_stage(draw, &setup->base);
    if (!setup->vbuf) {
       goto no_vbuf;
@@ -1364,6 +1396,8 @@ no_scenes:
 
    setup->vbuf->destroy(setup->vbuf);
 no_vbuf:
+   lp_setup_destroy_threads(setup);
+no_threads:
    FREE(setup);
 no_setup:
    return NULL;
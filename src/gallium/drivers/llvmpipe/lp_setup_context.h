@@ -43,6 +43,7 @@
 #include "draw/draw_vbuf.h"
 #include "util/u_rect.h"
 #include "util/u_pack_color.h"
+#include "util/u_queue.h"
 
 #define LP_SETUP_NEW_FS          0x01
 #define LP_SETUP_NEW_CONSTANTS   0x02
@@ -50,13 +51,59 @@
 #define LP_SETUP_NEW_SCISSOR     0x08
 #define LP_SETUP_NEW_VIEWPORTS   0x10
 
+/* How the fragment shader variant relates to the bins' depth bounds */
+#define LP_SETUP_HIZ_TEST        0x1   /**< fragments failing the depth test do nothing */
+#define LP_SETUP_HIZ_WRITE       0x2   /**< depth becomes min(depth, fragment z) */
+#define LP_SETUP_HIZ_RAISE       0x4   /**< depth values may rise */
+#define LP_SETUP_HIZ_CLAMP       0x8   /**< fragment z clamped to the depth range */
+#define LP_SETUP_HIZ_UNORM       0x10  /**< unorm depth buffer */
+#define LP_SETUP_HIZ_UNORM_WRITE 0x20  /**< see lp_setup_hiz_write() */
+
+/** Margin for the rounding of depth values to the depth buffer format */
+#define LP_SETUP_HIZ_EPSILON (1.0f / (1 << 15))
+
 
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+/** Max number of scenes in flight, so that binning of a scene can overlap
+ * with rasterization of the previous ones.
+ */
+#define MAX_SCENES 4
+
+/** Max number of triangles collected for threaded setup, see lp_setup_tri.c */
+#define LP_SETUP_MAX_DEFERRED_TRIS 8192
+
+/** Draws with fewer triangles are set up on the calling thread only */
+#define LP_SETUP_MIN_THREADED_TRIS 256
+
+
+/**
+ * A triangle of a large draw, set up by one of the setup threads and
+ * waiting to be binned in primitive order.
+ */
+struct lp_setup_deferred_tri {
+   const float (*v[3])[4];        /**< counter-clockwise after setup */
+   struct lp_rast_triangle *tri;  /**< NULL if culled or out of memory */
+   struct u_rect bbox;
+   struct u_rect bboxpos;
+   int nr_planes;
+   unsigned viewport_index;
+   boolean frontfacing;
+   boolean culled;
+};
+
+
+/**
+ * A range of deferred triangles for one setup thread, and the thread's
+ * data block in the current scene (see lp_scene_thread_alloc_aligned()).
+ */
+struct lp_setup_thread_job {
+   struct lp_setup_context *setup;
+   struct util_queue_fence fence;
+   struct data_block *block;
+   unsigned start, end;
+};
 
 
 
@@ -121,6 +168,7 @@ struct lp_setup_context
       union util_color color_val[PIPE_MAX_COLOR_BUFS];
       uint64_t zsmask;
       uint64_t zsvalue;               /**< lp_rast_clear_zstencil() cmd */
+      float depth;                    /**< the bins' zmax after the clear */
    } clear;
 
    enum setup_state {
@@ -134,6 +182,7 @@ struct lp_setup_context
       struct lp_rast_state current;  /**< currently set state */
       struct pipe_resource *current_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
       unsigned current_tex_num;
+      unsigned hiz;                  /**< LP_SETUP_HIZ_x flags of the variant */
    } fs;
 
    /** fragment shader constants */
@@ -166,6 +215,23 @@ struct lp_setup_context
                      const float (*v0)[4],
                      const float (*v1)[4],
                      const float (*v2)[4]);
+
+   /** Threaded triangle setup of large draws, see lp_setup_tri.c */
+   struct {
+      unsigned num_threads;   /**< 0 if disabled */
+      struct util_queue queue;
+      boolean queue_initialized;
+      struct lp_setup_thread_job jobs[LP_MAX_SETUP_THREADS];
+
+      struct lp_setup_deferred_tri *tris;
+      unsigned num_tris;
+
+      /** setup->triangle to restore when done deferring */
+      void (*triangle)( struct lp_setup_context *,
+                        const float (*v0)[4],
+                        const float (*v1)[4],
+                        const float (*v2)[4]);
+   } mt;
 };
 
 static inline void
@@ -183,7 +249,28 @@ scissor_planes_needed(boolean scis_planes[4], const struct u_rect *bbox,
 }
 
 
+/**
+ * Whether primitives may be culled per tile with lp_setup_hiz_occluded().
+ * Not with binned queries, which count fragment shader invocations.
+ */
+static inline boolean
+lp_setup_hiz_enabled(const struct lp_setup_context *setup)
+{
+   return setup->scene->hiz &&
+          (setup->fs.hiz & LP_SETUP_HIZ_TEST) &&
+          !setup->active_binned_queries;
+}
+
+
 void lp_setup_choose_triangle( struct lp_setup_context *setup );
+
+boolean lp_setup_init_threads( struct lp_setup_context *setup );
+void lp_setup_destroy_threads( struct lp_setup_context *setup );
+void lp_setup_reset_threads( struct lp_setup_context *setup );
+boolean lp_setup_begin_triangles( struct lp_setup_context *setup,
+                                  unsigned count );
+void lp_setup_flush_triangles( struct lp_setup_context *setup );
+void lp_setup_end_triangles( struct lp_setup_context *setup );
 void lp_setup_choose_line( struct lp_setup_context *setup );
 void lp_setup_choose_point( struct lp_setup_context *setup );
 
@@ -222,4 +309,29 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                       int nr_planes,
                       unsigned scissor_index);
 
+boolean
+lp_setup_whole_tile(struct lp_setup_context *setup,
+                    const struct lp_rast_shader_inputs *inputs,
+                    int tx, int ty);
+
+boolean
+lp_setup_hiz_occluded(const struct lp_setup_context *setup,
+                      const struct lp_rast_shader_inputs *inputs,
+                      const struct u_rect *bbox,
+                      int tx, int ty);
+
+void
+lp_setup_hiz_write(struct lp_setup_context *setup,
+                   const struct lp_rast_shader_inputs *inputs,
+                   const struct u_rect *bbox);
+
+void
+lp_setup_triangle_pair(struct lp_setup_context *setup,
+                       const float (*v0)[4],
+                       const float (*v1)[4],
+                       const float (*v2)[4],
+                       const float (*v3)[4],
+                       const float (*v4)[4],
+                       const float (*v5)[4]);
+
 #endif
@@ -0,0 +1,484 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/*
+ * Binning code for axis-aligned rectangles
+ */
+
+#include "util/u_math.h"
+#include "util/u_rect.h"
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_setup_context.h"
+#include "lp_rast.h"
+#include "lp_state_fs.h"
+#include "lp_state_setup.h"
+#include "lp_context.h"
+
+#define NUM_CHANNELS 4
+
+
+static inline int
+subpixel_snap(float a)
+{
+   return util_iround(FIXED_ONE * a);
+}
+
+
+/**
+ * Alloc space for a new rectangle plus the input.a0/dadx/dady arrays
+ * immediately after it, from the per-scene pool.
+ */
+static struct lp_rast_rectangle *
+alloc_rectangle(struct lp_scene *scene, unsigned nr_inputs)
+{
+   unsigned input_array_sz = NUM_CHANNELS * (nr_inputs + 1) * sizeof(float);
+   struct lp_rast_rectangle *rect;
+
+   rect = lp_scene_alloc_aligned(scene,
+                                 sizeof(struct lp_rast_rectangle) +
+                                 3 * input_array_sz,
+                                 16);
+   if (!rect)
+      return NULL;
+
+   rect->inputs.stride = input_array_sz;
+   return rect;
+}
+
+
+static inline boolean
+same_attrib(const float (*a)[4], const float (*b)[4], unsigned slot)
+{
+   return memcmp(a[slot], b[slot], sizeof a[slot]) == 0;
+}
+
+
+/**
+ * Whether the attribute values at the 4 corners lie in a plane, so that
+ * the coefficients of one triangle give the values of the other as well.
+ */
+static boolean
+planar_attrib(const float (*corner[4])[4], unsigned slot, unsigned chan)
+{
+   float a = corner[0][slot][chan] + corner[3][slot][chan];
+   float b = corner[1][slot][chan] + corner[2][slot][chan];
+
+   return fabsf(a - b) <= 1e-6f * (fabsf(a) + fabsf(b));
+}
+
+
+/**
+ * Work out the texels to copy for a blit shader variant, see
+ * lp_rast_rectangle().  Only 1:1 mappings of pixels to texels inside the
+ * texture qualify, with texture coordinates far enough from the texel
+ * edges for the shader to fetch the same texels whatever the rounding.
+ */
+static boolean
+setup_blit(struct lp_setup_context *setup,
+           struct lp_rast_rectangle *rect)
+{
+   const struct lp_fragment_shader_variant *variant =
+      setup->fs.current.variant;
+   const struct lp_jit_texture *tex =
+      &setup->fs.current.jit_context.textures[0];
+   const unsigned slot = variant->shader->blit_input + 1;
+   const float (*a0)[4] = (const float (*)[4])GET_A0(&rect->inputs);
+   const float (*dadx)[4] = (const float (*)[4])GET_DADX(&rect->inputs);
+   const float (*dady)[4] = (const float (*)[4])GET_DADY(&rect->inputs);
+   const struct u_rect *box = &rect->box;
+   const float eps = 1e-5f;
+   float scale_s = 1.0f, scale_t = 1.0f;
+   float s0, s1, t0, t1;
+   int step, x0, y0;
+
+   if (!tex->base || tex->first_level != 0)
+      return FALSE;
+
+   if (variant->key.state[0].sampler_state.normalized_coords) {
+      scale_s = (float)tex->width;
+      scale_t = (float)tex->height;
+   }
+
+   if (fabsf(dadx[slot][0] * scale_s - 1.0f) > eps ||
+       fabsf(dady[slot][0] * scale_s) > eps ||
+       fabsf(dadx[slot][1] * scale_t) > eps)
+      return FALSE;
+
+   if (fabsf(dady[slot][1] * scale_t - 1.0f) <= eps)
+      step = 1;
+   else if (fabsf(dady[slot][1] * scale_t + 1.0f) <= eps)
+      step = -1;
+   else
+      return FALSE;
+
+   /* texel coordinates at the box corners */
+   s0 = (a0[slot][0] + dadx[slot][0] * box->x0 + dady[slot][0] * box->y0) * scale_s;
+   s1 = (a0[slot][0] + dadx[slot][0] * box->x1 + dady[slot][0] * box->y0) * scale_s;
+   t0 = (a0[slot][1] + dadx[slot][1] * box->x0 + dady[slot][1] * box->y0) * scale_t;
+   t1 = (a0[slot][1] + dadx[slot][1] * box->x0 + dady[slot][1] * box->y1) * scale_t;
+
+   x0 = (int)floorf(s0);
+   y0 = (int)floorf(t0);
+   if (s0 - x0 < 0.05f || s0 - x0 > 0.95f ||
+       t0 - y0 < 0.05f || t0 - y0 > 0.95f ||
+       (int)floorf(s1) != x0 + box->x1 - box->x0 ||
+       (int)floorf(t1) != y0 + step * (box->y1 - box->y0) ||
+       s1 - floorf(s1) < 0.05f || s1 - floorf(s1) > 0.95f ||
+       t1 - floorf(t1) < 0.05f || t1 - floorf(t1) > 0.95f)
+      return FALSE;
+
+   if (x0 < 0 || x0 + box->x1 - box->x0 >= (int)tex->width ||
+       MIN2(y0, (int)floorf(t1)) < 0 ||
+       MAX2(y0, (int)floorf(t1)) >= (int)tex->height)
+      return FALSE;
+
+   rect->blit_dx = x0 - box->x0;
+   rect->blit_dy = y0 - step * box->y0;
+   rect->blit_dy_step = step;
+   return TRUE;
+}
+
+
+/**
+ * Put the rectangle in the scene's bins for the tiles which it overlaps.
+ * Tiles fully covered are shaded as usual, unless the texels are copied.
+ */
+static boolean
+bin_rectangle(struct lp_setup_context *setup,
+              struct lp_rast_rectangle *rect)
+{
+   struct lp_scene *scene = setup->scene;
+   const struct u_rect *box = &rect->box;
+   int ix0 = box->x0 / TILE_SIZE;
+   int iy0 = box->y0 / TILE_SIZE;
+   int ix1 = box->x1 / TILE_SIZE;
+   int iy1 = box->y1 / TILE_SIZE;
+   boolean hiz = lp_setup_hiz_enabled(setup);
+   int x, y;
+
+   if (scene->hiz && (setup->fs.hiz & LP_SETUP_HIZ_UNORM_WRITE))
+      lp_setup_hiz_write(setup, &rect->inputs, box);
+
+   for (y = iy0; y <= iy1; y++) {
+      for (x = ix0; x <= ix1; x++) {
+         boolean full = box->x0 <= x * TILE_SIZE &&
+                        box->y0 <= y * TILE_SIZE &&
+                        box->x1 >= (x + 1) * TILE_SIZE - 1 &&
+                        box->y1 >= (y + 1) * TILE_SIZE - 1;
+
+         if (hiz && lp_setup_hiz_occluded(setup, &rect->inputs, box, x, y))
+            continue;
+
+         if (full && !rect->blit_dy_step) {
+            if (!lp_setup_whole_tile(setup, &rect->inputs, x, y))
+               goto fail;
+            continue;
+         }
+
+         if (full && rect->inputs.opaque &&
+             !scene->fb.zsbuf && scene->fb_max_layer == 0 &&
+             !scene->had_queries) {
+            /* All previous rendering will be overwritten, as in
+             * lp_setup_whole_tile().
+             */
+            lp_scene_bin_reset(scene, x, y);
+         }
+
+         if (full)
+            LP_COUNT(nr_fully_covered_64);
+         else
+            LP_COUNT(nr_partially_covered_64);
+
+         if (!lp_scene_bin_cmd_with_state(scene, x, y,
+                                          setup->fs.stored,
+                                          LP_RAST_OP_RECTANGLE,
+                                          lp_rast_arg_rectangle(rect)))
+            goto fail;
+      }
+   }
+
+   return TRUE;
+
+fail:
+   /* As in lp_setup_bin_triangle() */
+   scene->hiz = FALSE;
+   return FALSE;
+}
+
+
+static boolean
+do_rect(struct lp_setup_context *setup,
+        const struct u_rect *bbox,
+        const float (*v0)[4],
+        const float (*v1)[4],
+        const float (*v2)[4],
+        boolean frontfacing)
+{
+   const struct lp_setup_variant_key *key = &setup->setup.variant->key;
+   const struct lp_fragment_shader_variant *variant =
+      setup->fs.current.variant;
+   struct lp_rast_rectangle *rect;
+
+   rect = alloc_rectangle(setup->scene, key->num_inputs);
+   if (!rect)
+      return FALSE;
+
+   LP_COUNT(nr_rects);
+
+   setup->setup.variant->jit_function(v0, v1, v2,
+                                      frontfacing,
+                                      GET_A0(&rect->inputs),
+                                      GET_DADX(&rect->inputs),
+                                      GET_DADY(&rect->inputs));
+
+   rect->box = *bbox;
+   rect->blit_dx = 0;
+   rect->blit_dy = 0;
+   rect->blit_dy_step = 0;
+   rect->inputs.frontfacing = frontfacing;
+   rect->inputs.disable = FALSE;
+   rect->inputs.opaque = variant->opaque;
+   rect->inputs.layer = 0;
+   rect->inputs.viewport_index = 0;
+
+   if (variant->blit != LP_BLIT_NONE &&
+       !setup->active_binned_queries &&
+       !(LP_PERF & PERF_NO_BLIT) &&
+       setup_blit(setup, rect)) {
+      LP_COUNT(nr_blit_rects);
+   }
+
+   if (!bin_rectangle(setup, rect)) {
+      /* Need to disable the partially binned rectangle */
+      rect->inputs.disable = TRUE;
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Try to draw the triangles (v0, v1, v2) and (v3, v4, v5) as a single
+ * axis-aligned rectangle, as the quads of 2D and compositing clients are.
+ * Such rectangles need no edge plane and, with blit shaders, may even be
+ * drawn without running the shader.
+ *
+ * \return FALSE if the triangles don't make such a rectangle, in which case
+ * nothing was drawn.
+ */
+static boolean
+try_rect(struct lp_setup_context *setup,
+         const float (*v[6])[4])
+{
+   const struct lp_setup_variant_key *key = &setup->setup.variant->key;
+   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
+   const float (*corner[4])[4] = { NULL, NULL, NULL, NULL };
+   const float (*pv_a)[4], (*pv_b)[4];
+   const float (*t0)[4], (*t1)[4], (*t2)[4];
+   float minx, miny, maxx, maxy;
+   unsigned mask_a = 0, mask_b = 0, missing;
+   int64_t area, area_b;
+   int x[6], y[6];
+   struct u_rect bbox;
+   boolean frontfacing;
+   unsigned i, slot, chan;
+   int adj;
+
+   if (setup->viewport_index_slot > 0 ||
+       setup->layer_slot > 0 ||
+       key->twoside)
+      return FALSE;
+
+   minx = maxx = v[0][0][0];
+   miny = maxy = v[0][0][1];
+   for (i = 1; i < 6; i++) {
+      minx = MIN2(minx, v[i][0][0]);
+      maxx = MAX2(maxx, v[i][0][0]);
+      miny = MIN2(miny, v[i][0][1]);
+      maxy = MAX2(maxy, v[i][0][1]);
+   }
+
+   /* Sort the vertices to the corners, indexed by (bottom << 1) | right */
+   for (i = 0; i < 6; i++) {
+      const float (*vert)[4] = v[i];
+      unsigned c;
+
+      if ((vert[0][0] != minx && vert[0][0] != maxx) ||
+          (vert[0][1] != miny && vert[0][1] != maxy))
+         return FALSE;
+
+      c = (vert[0][0] == maxx) | ((vert[0][1] == maxy) << 1);
+
+      if (corner[c]) {
+         /* Shared vertices must be the same */
+         if (corner[c] != vert) {
+            if (!same_attrib(corner[c], vert, 0))
+               return FALSE;
+            for (slot = 0; slot < key->num_inputs; slot++) {
+               if (!same_attrib(corner[c], vert,
+                                key->inputs[slot].src_index))
+                  return FALSE;
+            }
+         }
+      }
+      else {
+         corner[c] = vert;
+      }
+
+      if (i < 3)
+         mask_a |= 1 << c;
+      else
+         mask_b |= 1 << c;
+   }
+
+   /* Each triangle must cover a different half of the rectangle */
+   if (util_bitcount(mask_a) != 3 || util_bitcount(mask_b) != 3)
+      return FALSE;
+   missing = util_logbase2(~mask_a & 0xf);
+   if (mask_b != (0xf & ~(1 << (missing ^ 3))))
+      return FALSE;
+
+   /* The other triangle's values must match the first triangle's planes */
+   if (corner[0][0][3] != corner[1][0][3] ||
+       corner[0][0][3] != corner[2][0][3] ||
+       corner[0][0][3] != corner[3][0][3] ||
+       !planar_attrib(corner, 0, 2))
+      return FALSE;
+
+   pv_a = setup->flatshade_first ? v[0] : v[2];
+   pv_b = setup->flatshade_first ? v[3] : v[5];
+   for (slot = 0; slot < key->num_inputs; slot++) {
+      const struct lp_shader_input *input = &key->inputs[slot];
+
+      if (input->cyl_wrap)
+         return FALSE;
+
+      switch (input->interp) {
+      case LP_INTERP_CONSTANT:
+         if (!same_attrib(pv_a, pv_b, input->src_index))
+            return FALSE;
+         break;
+      case LP_INTERP_LINEAR:
+      case LP_INTERP_PERSPECTIVE:
+         for (chan = 0; chan < 4; chan++) {
+            if ((input->usage_mask & (1 << chan)) &&
+                !planar_attrib(corner, input->src_index, chan))
+               return FALSE;
+         }
+         break;
+      default:
+         break;
+      }
+   }
+
+   /* Orientation, in the fixed point coordinates of triangle setup */
+   for (i = 0; i < 6; i++) {
+      x[i] = subpixel_snap(v[i][0][0] - setup->pixel_offset);
+      y[i] = subpixel_snap(v[i][0][1] - setup->pixel_offset);
+   }
+   area = IMUL64(x[0] - x[1], y[2] - y[0]) - IMUL64(x[2] - x[0], y[0] - y[1]);
+   area_b = IMUL64(x[3] - x[4], y[5] - y[3]) - IMUL64(x[5] - x[3], y[3] - y[4]);
+   if (area == 0 || (area > 0) != (area_b > 0) || area_b == 0)
+      return FALSE;
+
+   if (lp_context->active_statistics_queries) {
+      lp_context->pipeline_statistics.c_primitives += 2;
+   }
+
+   frontfacing = (area > 0) == setup->ccw_is_frontface;
+   if (setup->cullmode & (frontfacing ? PIPE_FACE_FRONT : PIPE_FACE_BACK))
+      return TRUE;
+
+   /* Make the first triangle counter-clockwise, keeping the provoking
+    * vertex, as triangle_both() does.
+    */
+   t0 = v[0];
+   t1 = v[1];
+   t2 = v[2];
+   if (area < 0) {
+      if (setup->flatshade_first) {
+         t1 = v[2];
+         t2 = v[1];
+      }
+      else {
+         t0 = v[1];
+         t1 = v[0];
+      }
+   }
+
+   /* The covered pixels, following the fill convention of the triangle
+    * rasterizer (see the bounding box in setup_triangle_ccw()).
+    */
+   adj = (setup->bottom_edge_rule != 0) ? 1 : 0;
+   bbox.x0 = (subpixel_snap(minx - setup->pixel_offset) + FIXED_ONE - 1) >> FIXED_ORDER;
+   bbox.x1 = (subpixel_snap(maxx - setup->pixel_offset) - 1) >> FIXED_ORDER;
+   bbox.y0 = (subpixel_snap(miny - setup->pixel_offset) + FIXED_ONE - 1 + adj) >> FIXED_ORDER;
+   bbox.y1 = (subpixel_snap(maxy - setup->pixel_offset) - 1 + adj) >> FIXED_ORDER;
+
+   if (!u_rect_test_intersection(&setup->draw_regions[0], &bbox)) {
+      LP_COUNT(nr_culled_tris);
+      return TRUE;
+   }
+   u_rect_find_intersection(&setup->draw_regions[0], &bbox);
+
+   /* Bin after the triangles deferred for threaded setup */
+   lp_setup_flush_triangles(setup);
+
+   if (!do_rect(setup, &bbox, t0, t1, t2, frontfacing)) {
+      if (!lp_setup_flush_and_restart(setup))
+         return TRUE;
+
+      do_rect(setup, &bbox, t0, t1, t2, frontfacing);
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Draw two triangles, as a rectangle when they make one.
+ */
+void
+lp_setup_triangle_pair(struct lp_setup_context *setup,
+                       const float (*v0)[4],
+                       const float (*v1)[4],
+                       const float (*v2)[4],
+                       const float (*v3)[4],
+                       const float (*v4)[4],
+                       const float (*v5)[4])
+{
+   const float (*v[6])[4] = { v0, v1, v2, v3, v4, v5 };
+
+   if (setup->rasterizer_discard ||
+       (LP_PERF & PERF_NO_RECT) ||
+       !try_rect(setup, v)) {
+      setup->triangle(setup, v0, v1, v2);
+      setup->triangle(setup, v3, v4, v5);
+   }
+}
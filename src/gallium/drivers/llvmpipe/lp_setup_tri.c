@@ -33,6 +33,7 @@
 #include "util/u_memory.h"
 #include "util/u_rect.h"
 #include "util/u_sse.h"
+#include "lp_debug.h"
 #include "lp_perf.h"
 #include "lp_setup_context.h"
 #include "lp_rast.h"
@@ -81,11 +82,12 @@ struct fixed_position {
  * \param num_inputs  number of fragment shader inputs
  * \return pointer to triangle space
  */
-struct lp_rast_triangle *
-lp_setup_alloc_triangle(struct lp_scene *scene,
-                        unsigned nr_inputs,
-                        unsigned nr_planes,
-                        unsigned *tri_size)
+static struct lp_rast_triangle *
+alloc_triangle(struct lp_scene *scene,
+               struct data_block **thread_block,
+               unsigned nr_inputs,
+               unsigned nr_planes,
+               unsigned *tri_size)
 {
    unsigned input_array_sz = NUM_CHANNELS * (nr_inputs + 1) * sizeof(float);
    unsigned plane_sz = nr_planes * sizeof(struct lp_rast_plane);
@@ -97,7 +99,10 @@ lp_setup_alloc_triangle(struct lp_scene *scene,
                 3 * input_array_sz +
                 plane_sz);
 
-   tri = lp_scene_alloc_aligned( scene, *tri_size, 16 );
+   if (thread_block)
+      tri = lp_scene_thread_alloc_aligned( scene, thread_block, *tri_size, 16 );
+   else
+      tri = lp_scene_alloc_aligned( scene, *tri_size, 16 );
    if (!tri)
       return NULL;
 
@@ -112,6 +117,15 @@ lp_setup_alloc_triangle(struct lp_scene *scene,
    return tri;
 }
 
+struct lp_rast_triangle *
+lp_setup_alloc_triangle(struct lp_scene *scene,
+                        unsigned nr_inputs,
+                        unsigned nr_planes,
+                        unsigned *tri_size)
+{
+   return alloc_triangle(scene, NULL, nr_inputs, nr_planes, tri_size);
+}
+
 void
 lp_setup_print_vertex(struct lp_setup_context *setup,
                       const char *name,
@@ -206,12 +220,118 @@ lp_rast_32_tri_tab[MAX_PLANES+1] = {
 
 
 
+/**
+ * Bound the fragment depth of a primitive over the pixels [x0, x1] x
+ * [y0, y1] from its z plane, including the worst case rounding error of
+ * the interpolation in the fragment shader, and the depth clamp.
+ * \return FALSE if the bounds are no use, as unorm depth values outside
+ *         [0, 1] wrap around when converted
+ */
+static boolean
+hiz_depth_range(const struct lp_setup_context *setup,
+                const struct lp_rast_shader_inputs *inputs,
+                int x0, int y0, int x1, int y1,
+                float *zmin, float *zmax)
+{
+   const double a0 = GET_A0(inputs)[0][2];
+   const double dzdx = GET_DADX(inputs)[0][2];
+   const double dzdy = GET_DADY(inputs)[0][2];
+   double zx0 = dzdx * x0, zx1 = dzdx * (x1 + 1);
+   double zy0 = dzdy * y0, zy1 = dzdy * (y1 + 1);
+   double err = (fabs(a0) +
+                 MAX2(fabs(zx0), fabs(zx1)) +
+                 MAX2(fabs(zy0), fabs(zy1))) * (1.0 / (1 << 21));
+   double lo = a0 + MIN2(zx0, zx1) + MIN2(zy0, zy1) - err;
+   double hi = a0 + MAX2(zx0, zx1) + MAX2(zy0, zy1) + err;
+
+   if (setup->fs.hiz & LP_SETUP_HIZ_CLAMP) {
+      const struct lp_jit_viewport *vp = &setup->viewports[inputs->viewport_index];
+      lo = CLAMP(lo, vp->min_depth, vp->max_depth);
+      hi = CLAMP(hi, vp->min_depth, vp->max_depth);
+   }
+
+   if (setup->fs.hiz & LP_SETUP_HIZ_UNORM) {
+      if (!(lo >= 0.0 && hi <= 1.0))
+         return FALSE;
+   }
+   else if (!(lo <= hi)) {
+      return FALSE;
+   }
+
+   *zmin = (float)lo;
+   *zmax = (float)hi;
+   return TRUE;
+}
+
+
+/**
+ * Hierarchical depth test: whether all the fragments of the primitive
+ * within \p bbox in tile (tx, ty) fail the depth test.
+ *
+ * Each bin of the scene keeps an upper bound of its depth values, from
+ * the clears and the primitives covering the whole tile binned before.
+ * It is only valid for LESS/LEQUAL depth writes, see lp_setup_set_fs_variant().
+ * Those only happen in primitive order in the tile, so this gives the same
+ * image as rasterizing the primitive, without any rasterizer feedback.
+ */
+boolean
+lp_setup_hiz_occluded(const struct lp_setup_context *setup,
+                      const struct lp_rast_shader_inputs *inputs,
+                      const struct u_rect *bbox,
+                      int tx, int ty)
+{
+   const struct cmd_bin *bin = &setup->scene->tile[tx][ty];
+   int x0 = MAX2(bbox->x0, tx * TILE_SIZE);
+   int y0 = MAX2(bbox->y0, ty * TILE_SIZE);
+   int x1 = MIN2(bbox->x1, tx * TILE_SIZE + TILE_SIZE - 1);
+   int y1 = MIN2(bbox->y1, ty * TILE_SIZE + TILE_SIZE - 1);
+   float zmin, zmax;
+
+   if (bin->zmax == FLT_MAX ||
+       !hiz_depth_range(setup, inputs, x0, y0, x1, y1, &zmin, &zmax))
+      return FALSE;
+
+   if (zmin > bin->zmax + LP_SETUP_HIZ_EPSILON) {
+      LP_COUNT(nr_hiz_culled_64);
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Fragment z below 0 passes LESS/LEQUAL tests of unorm depth buffers,
+ * and isn't clamped when converted, so forget the depth bounds of the
+ * tiles within \p bbox if the primitive's depth may be out of range.
+ */
+void
+lp_setup_hiz_write(struct lp_setup_context *setup,
+                   const struct lp_rast_shader_inputs *inputs,
+                   const struct u_rect *bbox)
+{
+   struct lp_scene *scene = setup->scene;
+   float zmin, zmax;
+   int x, y;
+
+   if (hiz_depth_range(setup, inputs, bbox->x0, bbox->y0, bbox->x1, bbox->y1,
+                       &zmin, &zmax))
+      return;
+
+   for (y = bbox->y0 / TILE_SIZE; y <= bbox->y1 / TILE_SIZE; y++) {
+      for (x = bbox->x0 / TILE_SIZE; x <= bbox->x1 / TILE_SIZE; x++) {
+         lp_scene_get_bin(scene, x, y)->zmax = FLT_MAX;
+      }
+   }
+}
+
+
 /**
  * The primitive covers the whole tile- shade whole tile.
  *
  * \param tx, ty  the tile position in tiles, not pixels
  */
-static boolean
+boolean
 lp_setup_whole_tile(struct lp_setup_context *setup,
                     const struct lp_rast_shader_inputs *inputs,
                     int tx, int ty)
@@ -220,6 +340,20 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
 
    LP_COUNT(nr_fully_covered_64);
 
+   /* Every pixel ends up no deeper than the primitive */
+   if (scene->hiz && (setup->fs.hiz & LP_SETUP_HIZ_WRITE)) {
+      struct cmd_bin *bin = lp_scene_get_bin(scene, tx, ty);
+      float zmin, zmax;
+
+      if (hiz_depth_range(setup, inputs,
+                          tx * TILE_SIZE, ty * TILE_SIZE,
+                          tx * TILE_SIZE + TILE_SIZE - 1,
+                          ty * TILE_SIZE + TILE_SIZE - 1,
+                          &zmin, &zmax) &&
+          zmax < bin->zmax)
+         bin->zmax = zmax;
+   }
+
    /* if variant is opaque and scissor doesn't effect the tile */
    if (inputs->opaque) {
       /* Several things prevent this optimization from working:
@@ -258,16 +392,22 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
 
 /**
  * Do basic setup for triangle rasterization and determine which
- * framebuffer tiles are touched.  Put the triangle in the scene's
- * bins for the tiles which we overlap.
+ * framebuffer tiles are touched, without binning it yet.
+ * \param thread_block  the calling setup thread's data block, NULL when
+ *                      setting up on the binning thread
+ * \param out  where to put the triangle and its bounding boxes, out->tri
+ *             is NULL if the triangle was culled
+ * \return FALSE if out of memory
  */
 static boolean
-do_triangle_ccw(struct lp_setup_context *setup,
-                struct fixed_position* position,
-                const float (*v0)[4],
-                const float (*v1)[4],
-                const float (*v2)[4],
-                boolean frontfacing )
+setup_triangle_ccw(struct lp_setup_context *setup,
+                   struct data_block **thread_block,
+                   struct fixed_position* position,
+                   const float (*v0)[4],
+                   const float (*v1)[4],
+                   const float (*v2)[4],
+                   boolean frontfacing,
+                   struct lp_setup_deferred_tri *out)
 {
    struct lp_scene *scene = setup->scene;
    const struct lp_setup_variant_key *key = &setup->setup.variant->key;
@@ -285,6 +425,8 @@ do_triangle_ccw(struct lp_setup_context *setup,
    /* Area should always be positive here */
    assert(position->area > 0);
 
+   out->tri = NULL;
+
    if (0)
       lp_setup_print_triangle(setup, v0, v1, v2);
 
@@ -355,10 +497,11 @@ do_triangle_ccw(struct lp_setup_context *setup,
       nr_planes += s_planes[0] + s_planes[1] + s_planes[2] + s_planes[3];
    }
 
-   tri = lp_setup_alloc_triangle(scene,
-                                 key->num_inputs,
-                                 nr_planes,
-                                 &tri_bytes);
+   tri = alloc_triangle(scene,
+                        thread_block,
+                        key->num_inputs,
+                        nr_planes,
+                        &tri_bytes);
    if (!tri)
       return FALSE;
 
@@ -717,7 +860,38 @@ do_triangle_ccw(struct lp_setup_context *setup,
       assert(plane_s == &plane[nr_planes]);
    }
 
-   return lp_setup_bin_triangle(setup, tri, &bbox, &bboxpos, nr_planes, viewport_index);
+   out->tri = tri;
+   out->bbox = bbox;
+   out->bboxpos = bboxpos;
+   out->nr_planes = nr_planes;
+   out->viewport_index = viewport_index;
+   return TRUE;
+}
+
+
+/**
+ * Set up the triangle and put it in the scene's bins for the tiles
+ * which we overlap.
+ */
+static boolean
+do_triangle_ccw(struct lp_setup_context *setup,
+                struct fixed_position* position,
+                const float (*v0)[4],
+                const float (*v1)[4],
+                const float (*v2)[4],
+                boolean frontfacing )
+{
+   struct lp_setup_deferred_tri out;
+
+   if (!setup_triangle_ccw(setup, NULL, position, v0, v1, v2, frontfacing,
+                           &out))
+      return FALSE;
+
+   if (!out.tri)
+      return TRUE;
+
+   return lp_setup_bin_triangle(setup, out.tri, &out.bbox, &out.bboxpos,
+                                out.nr_planes, out.viewport_index);
 }
 
 /*
@@ -758,6 +932,7 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
 {
    struct lp_scene *scene = setup->scene;
    struct u_rect trimmed_box = *bbox;   
+   boolean hiz = lp_setup_hiz_enabled(setup);
    int i;
    /* What is the largest power-of-two boundary this triangle crosses:
     */
@@ -789,6 +964,9 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
    u_rect_find_intersection(&setup->draw_regions[viewport_index],
                             &trimmed_box);
 
+   if (scene->hiz && (setup->fs.hiz & LP_SETUP_HIZ_UNORM_WRITE))
+      lp_setup_hiz_write(setup, &tri->inputs, &trimmed_box);
+
    /* Determine which tile(s) intersect the triangle's bounding box
     */
    if (dx < TILE_SIZE)
@@ -801,6 +979,9 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
       assert(iy0 == bbox->y1 / TILE_SIZE &&
 	     ix0 == bbox->x1 / TILE_SIZE);
 
+      if (hiz && lp_setup_hiz_occluded(setup, &tri->inputs, bbox, ix0, iy0))
+         return TRUE;
+
       if (nr_planes == 3) {
          if (sz < 4)
          {
@@ -927,6 +1108,10 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                   break;  /* exiting triangle, all done with this row */
                LP_COUNT(nr_empty_64);
             }
+            else if (hiz && lp_setup_hiz_occluded(setup, &tri->inputs,
+                                                  &trimmed_box, x, y)) {
+               in = TRUE;
+            }
             else if (partial) {
                /* Not trivially accepted by at least one plane -
                 * rasterize/shade partial tile
@@ -969,8 +1154,10 @@ fail:
    /* Need to disable any partially binned triangle.  This is easier
     * than trying to locate all the triangle, shade-tile, etc,
     * commands which may have been binned.
+    * The depth bounds may count the disabled commands.
     */
    tri->inputs.disable = TRUE;
+   scene->hiz = FALSE;
    return FALSE;
 }
 
@@ -1236,3 +1423,288 @@ lp_setup_choose_triangle(struct lp_setup_context *setup)
       break;
    }
 }
+
+
+/*
+ * Threaded triangle setup.
+ *
+ * The triangles of large draws are collected by triangle_deferred() and
+ * set up in parallel, each setup thread taking a contiguous range and
+ * allocating from its own data block in the scene.  The triangles are
+ * then binned by the calling thread in primitive order, so the scene is
+ * the same as with serial setup.
+ */
+
+
+/**
+ * Cull a triangle and make it counter-clockwise, as triangle_cw(),
+ * triangle_ccw() and triangle_both() do.
+ * \return FALSE if the triangle is culled
+ */
+static inline boolean
+orient_triangle(const struct lp_setup_context *setup,
+                struct fixed_position *position,
+                struct lp_setup_deferred_tri *d)
+{
+   const float (*v)[4];
+   boolean front;
+
+   if (position->area > 0) {
+      front = setup->ccw_is_frontface;
+   }
+   else if (position->area < 0) {
+      if (setup->flatshade_first) {
+         rotate_fixed_position_12(position);
+         v = d->v[1];
+         d->v[1] = d->v[2];
+         d->v[2] = v;
+      } else {
+         rotate_fixed_position_01(position);
+         v = d->v[0];
+         d->v[0] = d->v[1];
+         d->v[1] = v;
+      }
+      front = !setup->ccw_is_frontface;
+   }
+   else {
+      return FALSE;
+   }
+
+   if (setup->cullmode & (front ? PIPE_FACE_FRONT : PIPE_FACE_BACK))
+      return FALSE;
+
+   d->frontfacing = front;
+   return TRUE;
+}
+
+
+static void
+setup_thread_job_run(struct lp_setup_thread_job *job)
+{
+   struct lp_setup_context *setup = job->setup;
+   unsigned i;
+
+   for (i = job->start; i < job->end; i++) {
+      struct lp_setup_deferred_tri *d = &setup->mt.tris[i];
+      PIPE_ALIGN_VAR(16) struct fixed_position position;
+
+      calc_fixed_position(setup, &position, d->v[0], d->v[1], d->v[2]);
+
+      d->tri = NULL;
+      d->culled = !orient_triangle(setup, &position, d);
+      if (d->culled)
+         continue;
+
+      /* Out of memory leaves tri NULL, and the triangle is set up again
+       * by lp_setup_flush_triangles().
+       */
+      if (setup_triangle_ccw(setup, &job->block, &position,
+                             d->v[0], d->v[1], d->v[2],
+                             d->frontfacing, d))
+         d->culled = d->tri == NULL;
+   }
+}
+
+
+static void
+setup_thread_job_execute(void *data, int thread_index)
+{
+   setup_thread_job_run((struct lp_setup_thread_job *)data);
+}
+
+
+static void
+triangle_deferred(struct lp_setup_context *setup,
+                  const float (*v0)[4],
+                  const float (*v1)[4],
+                  const float (*v2)[4])
+{
+   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
+   struct lp_setup_deferred_tri *d = &setup->mt.tris[setup->mt.num_tris++];
+
+   if (lp_context->active_statistics_queries) {
+      lp_context->pipeline_statistics.c_primitives++;
+   }
+
+   d->v[0] = v0;
+   d->v[1] = v1;
+   d->v[2] = v2;
+
+   if (setup->mt.num_tris == LP_SETUP_MAX_DEFERRED_TRIS) {
+      lp_setup_flush_triangles(setup);
+
+      /* A scene flush while binning reset setup->triangle, keep
+       * deferring the rest of the draw.
+       */
+      if (setup->triangle != triangle_deferred) {
+         setup->mt.triangle = setup->triangle;
+         setup->triangle = triangle_deferred;
+      }
+   }
+}
+
+
+boolean
+lp_setup_init_threads(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   if (setup->num_threads <= 1 || (LP_PERF & PERF_NO_MT_SETUP))
+      return TRUE;
+
+   setup->mt.tris = MALLOC(LP_SETUP_MAX_DEFERRED_TRIS *
+                           sizeof setup->mt.tris[0]);
+   if (!setup->mt.tris)
+      return FALSE;
+
+   setup->mt.num_threads = MIN2(setup->num_threads, LP_MAX_SETUP_THREADS);
+
+   for (i = 0; i < setup->mt.num_threads; i++) {
+      setup->mt.jobs[i].setup = setup;
+      util_queue_fence_init(&setup->mt.jobs[i].fence);
+   }
+
+   return TRUE;
+}
+
+
+void
+lp_setup_destroy_threads(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   if (!setup->mt.num_threads)
+      return;
+
+   if (setup->mt.queue_initialized)
+      util_queue_destroy(&setup->mt.queue);
+
+   for (i = 0; i < setup->mt.num_threads; i++)
+      util_queue_fence_destroy(&setup->mt.jobs[i].fence);
+
+   FREE(setup->mt.tris);
+   setup->mt.num_threads = 0;
+}
+
+
+/**
+ * Forget the setup threads' data blocks, called when the scene is reset.
+ */
+void
+lp_setup_reset_threads(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   for (i = 0; i < setup->mt.num_threads; i++)
+      setup->mt.jobs[i].block = NULL;
+}
+
+
+/**
+ * Start deferring the triangles of a draw of \p count triangles, if it
+ * is worth setting them up in parallel.  Must be paired with
+ * lp_setup_end_triangles() if it returns TRUE.
+ */
+boolean
+lp_setup_begin_triangles(struct lp_setup_context *setup, unsigned count)
+{
+   if (!setup->mt.num_threads || count < LP_SETUP_MIN_THREADED_TRIS)
+      return FALSE;
+
+   assert(setup->state == SETUP_ACTIVE);
+
+   if (!setup->mt.queue_initialized) {
+      if (!util_queue_init(&setup->mt.queue, "lpsetup",
+                           LP_MAX_SETUP_THREADS,
+                           setup->mt.num_threads - 1, 0)) {
+         setup->mt.num_threads = 0;
+         return FALSE;
+      }
+      setup->mt.queue_initialized = TRUE;
+   }
+
+   lp_setup_choose_triangle(setup);
+   if (setup->triangle == triangle_noop)
+      return FALSE;
+
+   assert(setup->mt.num_tris == 0);
+   setup->mt.triangle = setup->triangle;
+   setup->triangle = triangle_deferred;
+   return TRUE;
+}
+
+
+/**
+ * Set up and bin the deferred triangles.  Called before binning anything
+ * else, to keep primitive order.
+ */
+void
+lp_setup_flush_triangles(struct lp_setup_context *setup)
+{
+   unsigned num_tris = setup->mt.num_tris;
+   unsigned num_jobs, job_count, start, i;
+   boolean serial = FALSE;
+
+   if (!num_tris)
+      return;
+
+   num_jobs = num_tris < LP_SETUP_MIN_THREADED_TRIS ? 1 : setup->mt.num_threads;
+   job_count = DIV_ROUND_UP(num_tris, num_jobs);
+
+   /* The calling thread does the first job itself. */
+   start = job_count;
+   for (i = 1; i < num_jobs && start < num_tris; i++) {
+      struct lp_setup_thread_job *job = &setup->mt.jobs[i];
+
+      job->start = start;
+      job->end = MIN2(start + job_count, num_tris);
+      start = job->end;
+      util_queue_add_job(&setup->mt.queue, job, &job->fence,
+                         setup_thread_job_execute, NULL);
+   }
+   num_jobs = i;
+
+   setup->mt.jobs[0].start = 0;
+   setup->mt.jobs[0].end = MIN2(job_count, num_tris);
+   setup_thread_job_run(&setup->mt.jobs[0]);
+
+   for (i = 1; i < num_jobs; i++)
+      util_queue_fence_wait(&setup->mt.jobs[i].fence);
+
+   for (i = 0; i < num_tris; i++) {
+      struct lp_setup_deferred_tri *d = &setup->mt.tris[i];
+
+      if (d->culled)
+         continue;
+
+      /* Once the scene is full, set up what's left again on this thread,
+       * restarting the scene as needed.
+       */
+      if (!serial && d->tri &&
+          lp_setup_bin_triangle(setup, d->tri, &d->bbox, &d->bboxpos,
+                                d->nr_planes, d->viewport_index))
+         continue;
+
+      serial = TRUE;
+      {
+         PIPE_ALIGN_VAR(16) struct fixed_position position;
+
+         calc_fixed_position(setup, &position, d->v[0], d->v[1], d->v[2]);
+         retry_triangle_ccw(setup, &position, d->v[0], d->v[1], d->v[2],
+                            d->frontfacing);
+      }
+   }
+
+   setup->mt.num_tris = 0;
+}
+
+
+void
+lp_setup_end_triangles(struct lp_setup_context *setup)
+{
+   lp_setup_flush_triangles(setup);
+
+   /* The scene may have been flushed, which resets setup->triangle. */
+   if (setup->triangle == triangle_deferred)
+      setup->triangle = setup->mt.triangle;
+}
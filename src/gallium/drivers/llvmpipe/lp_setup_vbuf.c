@@ -41,11 +41,16 @@
 #include "draw/draw_vbuf.h"
 #include "draw/draw_vertex.h"
 #include "util/u_memory.h"
+#include "util/u_prim.h"
 
 
 #define LP_MAX_VBUF_INDEXES 1024
 #define LP_MAX_VBUF_SIZE    4096
 
+/* Larger chunks for threaded triangle setup, see lp_setup_begin_triangles() */
+#define LP_MAX_VBUF_INDEXES_MT 8192
+#define LP_MAX_VBUF_SIZE_MT    (128 * 1024)
+
   
 
 /** cast wrapper */
@@ -139,6 +144,7 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    const unsigned stride = setup->vertex_info->size * sizeof(float);
    const void *vertex_buffer = setup->vertex_buffer;
    const boolean flatshade_first = setup->flatshade_first;
+   boolean deferred;
    unsigned i;
 
    assert(setup->setup.variant);
@@ -146,6 +152,10 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    if (!lp_setup_update_state(setup, TRUE))
       return;
 
+   deferred = u_reduced_prim(setup->prim) == PIPE_PRIM_TRIANGLES &&
+              lp_setup_begin_triangles(setup,
+                 u_reduced_prims_for_vertices(setup->prim, nr));
+
    switch (setup->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
@@ -184,16 +194,47 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
+      /* pass pairs of triangles, which may make rectangles */
+      for (i = 5; i < nr; i += 6) {
+         lp_setup_triangle_pair( setup,
+                                 get_vert(vertex_buffer, indices[i-5], stride),
+                                 get_vert(vertex_buffer, indices[i-4], stride),
+                                 get_vert(vertex_buffer, indices[i-3], stride),
+                                 get_vert(vertex_buffer, indices[i-2], stride),
+                                 get_vert(vertex_buffer, indices[i-1], stride),
+                                 get_vert(vertex_buffer, indices[i-0], stride) );
+      }
+      if (i - 3 < nr) {
          setup->triangle( setup,
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+                          get_vert(vertex_buffer, indices[i-5], stride),
+                          get_vert(vertex_buffer, indices[i-4], stride),
+                          get_vert(vertex_buffer, indices[i-3], stride) );
       }
       break;
 
    case PIPE_PRIM_TRIANGLE_STRIP:
-      if (flatshade_first) {
+      if (nr == 4) {
+         /* a single quad, which may be a rectangle */
+         if (flatshade_first) {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, indices[0], stride),
+                                    get_vert(vertex_buffer, indices[1], stride),
+                                    get_vert(vertex_buffer, indices[2], stride),
+                                    get_vert(vertex_buffer, indices[1], stride),
+                                    get_vert(vertex_buffer, indices[3], stride),
+                                    get_vert(vertex_buffer, indices[2], stride) );
+         }
+         else {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, indices[0], stride),
+                                    get_vert(vertex_buffer, indices[1], stride),
+                                    get_vert(vertex_buffer, indices[2], stride),
+                                    get_vert(vertex_buffer, indices[2], stride),
+                                    get_vert(vertex_buffer, indices[1], stride),
+                                    get_vert(vertex_buffer, indices[3], stride) );
+         }
+      }
+      else if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first triangle vertex as first triangle vertex */
             setup->triangle( setup,
@@ -215,7 +256,28 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLE_FAN:
-      if (flatshade_first) {
+      if (nr == 4) {
+         /* a single quad, which may be a rectangle */
+         if (flatshade_first) {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, indices[1], stride),
+                                    get_vert(vertex_buffer, indices[2], stride),
+                                    get_vert(vertex_buffer, indices[0], stride),
+                                    get_vert(vertex_buffer, indices[2], stride),
+                                    get_vert(vertex_buffer, indices[3], stride),
+                                    get_vert(vertex_buffer, indices[0], stride) );
+         }
+         else {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, indices[0], stride),
+                                    get_vert(vertex_buffer, indices[1], stride),
+                                    get_vert(vertex_buffer, indices[2], stride),
+                                    get_vert(vertex_buffer, indices[0], stride),
+                                    get_vert(vertex_buffer, indices[2], stride),
+                                    get_vert(vertex_buffer, indices[3], stride) );
+         }
+      }
+      else if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first non-spoke vertex as first vertex */
             setup->triangle( setup,
@@ -240,29 +302,25 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) { 
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            setup->triangle( setup,
-                             get_vert(vertex_buffer, indices[i-0], stride),
-                             get_vert(vertex_buffer, indices[i-3], stride),
-                             get_vert(vertex_buffer, indices[i-2], stride) );
-
-            setup->triangle( setup,
-                             get_vert(vertex_buffer, indices[i-0], stride),
-                             get_vert(vertex_buffer, indices[i-2], stride),
-                             get_vert(vertex_buffer, indices[i-1], stride) );
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, indices[i-0], stride),
+                                    get_vert(vertex_buffer, indices[i-3], stride),
+                                    get_vert(vertex_buffer, indices[i-2], stride),
+                                    get_vert(vertex_buffer, indices[i-0], stride),
+                                    get_vert(vertex_buffer, indices[i-2], stride),
+                                    get_vert(vertex_buffer, indices[i-1], stride) );
          }
       }
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            setup->triangle( setup,
-                          get_vert(vertex_buffer, indices[i-3], stride),
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
-
-            setup->triangle( setup,
-                             get_vert(vertex_buffer, indices[i-2], stride),
-                             get_vert(vertex_buffer, indices[i-1], stride),
-                             get_vert(vertex_buffer, indices[i-0], stride) );
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, indices[i-3], stride),
+                                    get_vert(vertex_buffer, indices[i-2], stride),
+                                    get_vert(vertex_buffer, indices[i-0], stride),
+                                    get_vert(vertex_buffer, indices[i-2], stride),
+                                    get_vert(vertex_buffer, indices[i-1], stride),
+                                    get_vert(vertex_buffer, indices[i-0], stride) );
          }
       }
       break;
@@ -324,6 +382,9 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   if (deferred)
+      lp_setup_end_triangles(setup);
 }
 
 
@@ -339,11 +400,16 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    const void *vertex_buffer =
       (void *) get_vert(setup->vertex_buffer, start, stride);
    const boolean flatshade_first = setup->flatshade_first;
+   boolean deferred;
    unsigned i;
 
    if (!lp_setup_update_state(setup, TRUE))
       return;
 
+   deferred = u_reduced_prim(setup->prim) == PIPE_PRIM_TRIANGLES &&
+              lp_setup_begin_triangles(setup,
+                 u_reduced_prims_for_vertices(setup->prim, nr));
+
    switch (setup->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
@@ -382,16 +448,47 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
+      /* pass pairs of triangles, which may make rectangles */
+      for (i = 5; i < nr; i += 6) {
+         lp_setup_triangle_pair( setup,
+                                 get_vert(vertex_buffer, i-5, stride),
+                                 get_vert(vertex_buffer, i-4, stride),
+                                 get_vert(vertex_buffer, i-3, stride),
+                                 get_vert(vertex_buffer, i-2, stride),
+                                 get_vert(vertex_buffer, i-1, stride),
+                                 get_vert(vertex_buffer, i-0, stride) );
+      }
+      if (i - 3 < nr) {
          setup->triangle( setup,
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+                          get_vert(vertex_buffer, i-5, stride),
+                          get_vert(vertex_buffer, i-4, stride),
+                          get_vert(vertex_buffer, i-3, stride) );
       }
       break;
 
    case PIPE_PRIM_TRIANGLE_STRIP:
-      if (flatshade_first) {
+      if (nr == 4) {
+         /* a single quad, which may be a rectangle */
+         if (flatshade_first) {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, 0, stride),
+                                    get_vert(vertex_buffer, 1, stride),
+                                    get_vert(vertex_buffer, 2, stride),
+                                    get_vert(vertex_buffer, 1, stride),
+                                    get_vert(vertex_buffer, 3, stride),
+                                    get_vert(vertex_buffer, 2, stride) );
+         }
+         else {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, 0, stride),
+                                    get_vert(vertex_buffer, 1, stride),
+                                    get_vert(vertex_buffer, 2, stride),
+                                    get_vert(vertex_buffer, 2, stride),
+                                    get_vert(vertex_buffer, 1, stride),
+                                    get_vert(vertex_buffer, 3, stride) );
+         }
+      }
+      else if (flatshade_first) {
          for (i = 2; i < nr; i++) {
             /* emit first triangle vertex as first triangle vertex */
             setup->triangle( setup,
@@ -412,7 +509,28 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLE_FAN:
-      if (flatshade_first) {
+      if (nr == 4) {
+         /* a single quad, which may be a rectangle */
+         if (flatshade_first) {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, 1, stride),
+                                    get_vert(vertex_buffer, 2, stride),
+                                    get_vert(vertex_buffer, 0, stride),
+                                    get_vert(vertex_buffer, 2, stride),
+                                    get_vert(vertex_buffer, 3, stride),
+                                    get_vert(vertex_buffer, 0, stride) );
+         }
+         else {
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, 0, stride),
+                                    get_vert(vertex_buffer, 1, stride),
+                                    get_vert(vertex_buffer, 2, stride),
+                                    get_vert(vertex_buffer, 0, stride),
+                                    get_vert(vertex_buffer, 2, stride),
+                                    get_vert(vertex_buffer, 3, stride) );
+         }
+      }
+      else if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first non-spoke vertex as first vertex */
             setup->triangle( setup,
@@ -437,27 +555,25 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) { 
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            setup->triangle( setup,
-                             get_vert(vertex_buffer, i-0, stride),
-                             get_vert(vertex_buffer, i-3, stride),
-                             get_vert(vertex_buffer, i-2, stride) );
-            setup->triangle( setup,
-                             get_vert(vertex_buffer, i-0, stride),
-                             get_vert(vertex_buffer, i-2, stride),
-                             get_vert(vertex_buffer, i-1, stride) );
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, i-0, stride),
+                                    get_vert(vertex_buffer, i-3, stride),
+                                    get_vert(vertex_buffer, i-2, stride),
+                                    get_vert(vertex_buffer, i-0, stride),
+                                    get_vert(vertex_buffer, i-2, stride),
+                                    get_vert(vertex_buffer, i-1, stride) );
          }
       }
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            setup->triangle( setup,
-                             get_vert(vertex_buffer, i-3, stride),
-                             get_vert(vertex_buffer, i-2, stride),
-                             get_vert(vertex_buffer, i-0, stride) );
-            setup->triangle( setup,
-                             get_vert(vertex_buffer, i-2, stride),
-                             get_vert(vertex_buffer, i-1, stride),
-                             get_vert(vertex_buffer, i-0, stride) );
+            lp_setup_triangle_pair( setup,
+                                    get_vert(vertex_buffer, i-3, stride),
+                                    get_vert(vertex_buffer, i-2, stride),
+                                    get_vert(vertex_buffer, i-0, stride),
+                                    get_vert(vertex_buffer, i-2, stride),
+                                    get_vert(vertex_buffer, i-1, stride),
+                                    get_vert(vertex_buffer, i-0, stride) );
          }
       }
       break;
@@ -519,6 +635,9 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   if (deferred)
+      lp_setup_end_triangles(setup);
 }
 
 
@@ -585,8 +704,14 @@ lp_setup_pipeline_statistics(
 void
 lp_setup_init_vbuf(struct lp_setup_context *setup)
 {
-   setup->base.max_indices = LP_MAX_VBUF_INDEXES;
-   setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   if (setup->mt.num_threads) {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES_MT;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE_MT;
+   }
+   else {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   }
 
    setup->base.get_vertex_info = lp_setup_get_vertex_info;
    setup->base.allocate_vertices = lp_setup_allocate_vertices;
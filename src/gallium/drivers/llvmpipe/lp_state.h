@@ -114,6 +114,9 @@ llvmpipe_init_clip_funcs(struct llvmpipe_context *llvmpipe);
 void
 llvmpipe_init_fs_funcs(struct llvmpipe_context *llvmpipe);
 
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe);
+
 void
 llvmpipe_init_vs_funcs(struct llvmpipe_context *llvmpipe);
 
@@ -0,0 +1,989 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Compute shaders.
+ *
+ * A variant runs a whole work group, looping over its invocations one
+ * vector at a time.  Shaders with barriers are built as a coroutine per
+ * vector of invocations instead, each suspended at the barriers until all
+ * of them reached it.
+ *
+ * The work groups of a launch are shared by the rasterizer threads, which
+ * run them as a scene holding an lp_rast_job rather than bins.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/simple_list.h"
+#include "util/os_time.h"
+#include "util/u_atomic.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_coro.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_intr.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_tgsi.h"
+
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_fence.h"
+#include "lp_flush.h"
+#include "lp_perf.h"
+#include "lp_rast.h"
+#include "lp_scene.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_tex_sample.h"
+#include "lp_texture.h"
+
+
+/** Compute shader number (for debugging) */
+static unsigned cs_no = 0;
+
+
+/**
+ * Most vectors of invocations in a work group, i.e. the pipe caps'
+ * PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK over the smallest vector length.
+ */
+#define LP_MAX_CS_VECTORS (1024 / 4)
+
+
+/** Subclass of lp_build_tgsi_cs_iface */
+struct lp_cs_tgsi_iface
+{
+   struct lp_build_tgsi_cs_iface base;
+
+   /** The coroutine running the shader, NULL if it has no barriers */
+   const struct lp_build_coro *coro;
+};
+
+
+static void
+cs_emit_barrier(const struct lp_build_tgsi_cs_iface *cs_iface,
+                struct lp_build_tgsi_context *bld_base)
+{
+   const struct lp_cs_tgsi_iface *iface =
+      (const struct lp_cs_tgsi_iface *) cs_iface;
+
+   lp_build_coro_suspend(bld_base->base.gallivm, iface->coro);
+}
+
+
+/**
+ * Run the shader for one vector of invocations of the work group, the ones
+ * starting at \p first.  The lanes past the end of the work group are
+ * masked out.
+ */
+static void
+generate_invocations(struct gallivm_state *gallivm,
+                     struct lp_compute_shader *shader,
+                     struct lp_compute_shader_variant *variant,
+                     struct lp_type type,
+                     LLVMValueRef context_ptr,
+                     LLVMValueRef thread_data_ptr,
+                     const LLVMValueRef *block_id,
+                     const LLVMValueRef *grid_size,
+                     const LLVMValueRef *block_size,
+                     LLVMValueRef shared_ptr,
+                     LLVMValueRef first,
+                     const struct lp_build_coro *coro)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context uint_bld;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_build_mask_context mask;
+   struct lp_build_sampler_soa *sampler;
+   struct lp_cs_tgsi_iface iface;
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+   LLVMValueRef consts_ptr, num_consts_ptr;
+   LLVMValueRef ssbo_ptr, num_ssbo_ptr;
+   LLVMValueRef lanes[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef index, total, mask_val, xy_size;
+   unsigned i;
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(type));
+
+   /* Linear index of the invocations in the work group */
+   for (i = 0; i < type.length; i++)
+      lanes[i] = lp_build_const_int32(gallivm, i);
+   index = lp_build_broadcast_scalar(&uint_bld, first);
+   index = LLVMBuildAdd(builder, index,
+                        LLVMConstVector(lanes, type.length), "");
+
+   xy_size = LLVMBuildMul(builder, block_size[0], block_size[1], "");
+   total = LLVMBuildMul(builder, xy_size, block_size[2], "");
+   mask_val = lp_build_cmp(&uint_bld, PIPE_FUNC_LESS, index,
+                           lp_build_broadcast_scalar(&uint_bld, total));
+
+   memset(&system_values, 0, sizeof system_values);
+   system_values.thread_id[0] =
+      lp_build_mod(&uint_bld, index,
+                   lp_build_broadcast_scalar(&uint_bld, block_size[0]));
+   system_values.thread_id[1] =
+      lp_build_mod(&uint_bld,
+                   lp_build_div(&uint_bld, index,
+                                lp_build_broadcast_scalar(&uint_bld,
+                                                          block_size[0])),
+                   lp_build_broadcast_scalar(&uint_bld, block_size[1]));
+   system_values.thread_id[2] =
+      lp_build_div(&uint_bld, index,
+                   lp_build_broadcast_scalar(&uint_bld, xy_size));
+   for (i = 0; i < 3; i++) {
+      system_values.block_id[i] = block_id[i];
+      system_values.block_size[i] = block_size[i];
+      system_values.grid_size[i] = grid_size[i];
+   }
+
+   memset(&iface, 0, sizeof iface);
+   iface.base.shared_ptr =
+      LLVMBuildBitCast(builder, shared_ptr,
+                       LLVMPointerType(LLVMInt32TypeInContext(gallivm->context),
+                                       0), "");
+   iface.base.shared_size = lp_build_const_int32(gallivm,
+                                                 shader->req_local_mem);
+   if (coro) {
+      iface.base.emit_barrier = cs_emit_barrier;
+      iface.coro = coro;
+   }
+
+   consts_ptr = lp_jit_context_constants(gallivm, context_ptr);
+   num_consts_ptr = lp_jit_context_num_constants(gallivm, context_ptr);
+   ssbo_ptr = lp_jit_context_ssbos(gallivm, context_ptr);
+   num_ssbo_ptr = lp_jit_context_num_ssbos(gallivm, context_ptr);
+
+   /* code generated texture sampling */
+   sampler = lp_llvm_sampler_soa_create(variant->key.state);
+
+   memset(outputs, 0, sizeof outputs);
+
+   lp_build_mask_begin(&mask, gallivm, type, mask_val);
+
+   lp_build_tgsi_soa(gallivm, shader->tokens, type, &mask,
+                     consts_ptr, num_consts_ptr, ssbo_ptr, num_ssbo_ptr,
+                     &system_values, NULL, outputs, context_ptr,
+                     thread_data_ptr, sampler, &shader->info.base,
+                     NULL, &iface.base);
+
+   lp_build_mask_end(&mask);
+
+   sampler->destroy(sampler);
+}
+
+
+static void
+generate_compute(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(lc);
+   LLVMTypeRef i8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+   LLVMTypeRef arg_types[12];
+   LLVMTypeRef func_type;
+   LLVMValueRef function;
+   LLVMValueRef context_ptr, thread_data_ptr, shared_ptr;
+   LLVMValueRef block_id[3], grid_size[3], block_size[3];
+   LLVMValueRef total, step;
+   LLVMBasicBlockRef block;
+   LLVMBuilderRef builder;
+   struct lp_type cs_type;
+   boolean use_coro = FALSE;
+   unsigned i;
+
+   (void) lp;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+
+   assert(cs_type.length >= 4);
+
+#if HAVE_LLVM >= 0x0800
+   use_coro = shader->info.base.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+#endif
+
+   /*
+    * Generate the function prototype. Any change here must be reflected in
+    * lp_jit.h's lp_jit_cs_func function pointer type, and vice-versa.
+    */
+   arg_types[0] = variant->jit_context_ptr_type;       /* context */
+   arg_types[1] = int32_type;                          /* block_x */
+   arg_types[2] = int32_type;                          /* block_y */
+   arg_types[3] = int32_type;                          /* block_z */
+   arg_types[4] = int32_type;                          /* grid_x */
+   arg_types[5] = int32_type;                          /* grid_y */
+   arg_types[6] = int32_type;                          /* grid_z */
+   arg_types[7] = int32_type;                          /* size_x */
+   arg_types[8] = int32_type;                          /* size_y */
+   arg_types[9] = int32_type;                          /* size_z */
+   arg_types[10] = i8_ptr_type;                        /* shared */
+   arg_types[11] = variant->jit_thread_data_ptr_type;  /* per thread data */
+
+#if HAVE_LLVM >= 0x0800
+   if (use_coro) {
+      /*
+       * The coroutine takes the index of its first invocation as an extra
+       * argument, and returns its handle.
+       */
+      LLVMTypeRef coro_arg_types[13];
+      LLVMValueRef coro_func;
+      LLVMValueRef coro_args[13];
+      struct lp_build_coro coro;
+
+      memcpy(coro_arg_types, arg_types, sizeof arg_types);
+      coro_arg_types[12] = int32_type;                 /* first invocation */
+
+      func_type = LLVMFunctionType(i8_ptr_type, coro_arg_types,
+                                   ARRAY_SIZE(coro_arg_types), 0);
+
+      coro_func = LLVMAddFunction(gallivm->module, "cs_co_variant",
+                                  func_type);
+      LLVMSetFunctionCallConv(coro_func, LLVMCCallConv);
+      LLVMSetLinkage(coro_func, LLVMInternalLinkage);
+
+      for (i = 0; i < ARRAY_SIZE(coro_arg_types); ++i)
+         if (LLVMGetTypeKind(coro_arg_types[i]) == LLVMPointerTypeKind &&
+             i != 10)
+            lp_add_function_attr(coro_func, i + 1, LP_FUNC_ATTR_NOALIAS);
+
+      block = LLVMAppendBasicBlockInContext(lc, coro_func, "entry");
+      builder = gallivm->builder;
+      LLVMPositionBuilderAtEnd(builder, block);
+
+      for (i = 0; i < 3; i++) {
+         block_id[i] = LLVMGetParam(coro_func, 1 + i);
+         grid_size[i] = LLVMGetParam(coro_func, 4 + i);
+         block_size[i] = LLVMGetParam(coro_func, 7 + i);
+      }
+
+      lp_build_coro_begin(gallivm, &coro);
+
+      generate_invocations(gallivm, shader, variant, cs_type,
+                           LLVMGetParam(coro_func, 0),
+                           LLVMGetParam(coro_func, 11),
+                           block_id, grid_size, block_size,
+                           LLVMGetParam(coro_func, 10),
+                           LLVMGetParam(coro_func, 12),
+                           &coro);
+
+      lp_build_coro_end(gallivm, &coro);
+
+      gallivm_verify_function(gallivm, coro_func);
+
+      /*
+       * The work group function starts a coroutine per vector of
+       * invocations, and resumes them all until they are done.  The
+       * barriers must be reached by all the invocations in uniform control
+       * flow, so they are all done at the same time.
+       */
+      func_type = LLVMFunctionType(LLVMVoidTypeInContext(lc),
+                                   arg_types, ARRAY_SIZE(arg_types), 0);
+
+      function = LLVMAddFunction(gallivm->module, "cs_variant", func_type);
+      LLVMSetFunctionCallConv(function, LLVMCCallConv);
+      variant->function = function;
+
+      block = LLVMAppendBasicBlockInContext(lc, function, "entry");
+      LLVMPositionBuilderAtEnd(builder, block);
+
+      {
+         struct lp_build_loop_state loop_state;
+         LLVMValueRef hdls, hdl_ptr, hdl0, done, num_vectors;
+         LLVMBasicBlockRef check_block, resume_block, destroy_block;
+
+         for (i = 0; i < ARRAY_SIZE(arg_types); i++)
+            coro_args[i] = LLVMGetParam(function, i);
+
+         total = LLVMBuildMul(builder, coro_args[7], coro_args[8], "");
+         total = LLVMBuildMul(builder, total, coro_args[9], "");
+         step = lp_build_const_int32(gallivm, cs_type.length);
+         num_vectors = LLVMBuildAdd(builder, total,
+                                    lp_build_const_int32(gallivm,
+                                                         cs_type.length - 1),
+                                    "");
+         num_vectors = LLVMBuildUDiv(builder, num_vectors, step, "");
+
+         hdls = lp_build_array_alloca(gallivm, i8_ptr_type,
+                                      lp_build_const_int32(gallivm,
+                                                           LP_MAX_CS_VECTORS),
+                                      "coro_hdls");
+
+         lp_build_loop_begin(&loop_state, gallivm,
+                             lp_build_const_int32(gallivm, 0));
+         {
+            coro_args[12] = LLVMBuildMul(builder, loop_state.counter, step,
+                                         "");
+            hdl_ptr = LLVMBuildGEP(builder, hdls, &loop_state.counter, 1, "");
+            LLVMBuildStore(builder,
+                           LLVMBuildCall(builder, coro_func, coro_args,
+                                         ARRAY_SIZE(coro_args), ""),
+                           hdl_ptr);
+         }
+         lp_build_loop_end_cond(&loop_state, num_vectors, NULL, LLVMIntUGE);
+
+         check_block = lp_build_insert_new_block(gallivm, "check_done");
+         resume_block = lp_build_insert_new_block(gallivm, "resume");
+         destroy_block = lp_build_insert_new_block(gallivm, "destroy");
+
+         LLVMBuildBr(builder, check_block);
+         LLVMPositionBuilderAtEnd(builder, check_block);
+         hdl0 = LLVMBuildLoad(builder, hdls, "");
+         done = lp_build_coro_done(gallivm, hdl0);
+         LLVMBuildCondBr(builder, done, destroy_block, resume_block);
+
+         LLVMPositionBuilderAtEnd(builder, resume_block);
+         lp_build_loop_begin(&loop_state, gallivm,
+                             lp_build_const_int32(gallivm, 0));
+         {
+            hdl_ptr = LLVMBuildGEP(builder, hdls, &loop_state.counter, 1, "");
+            lp_build_coro_resume(gallivm, LLVMBuildLoad(builder, hdl_ptr, ""));
+         }
+         lp_build_loop_end_cond(&loop_state, num_vectors, NULL, LLVMIntUGE);
+         LLVMBuildBr(builder, check_block);
+
+         LLVMPositionBuilderAtEnd(builder, destroy_block);
+         lp_build_loop_begin(&loop_state, gallivm,
+                             lp_build_const_int32(gallivm, 0));
+         {
+            hdl_ptr = LLVMBuildGEP(builder, hdls, &loop_state.counter, 1, "");
+            lp_build_coro_destroy(gallivm, LLVMBuildLoad(builder, hdl_ptr, ""));
+         }
+         lp_build_loop_end_cond(&loop_state, num_vectors, NULL, LLVMIntUGE);
+      }
+
+      LLVMBuildRetVoid(builder);
+
+      gallivm_verify_function(gallivm, function);
+      return;
+   }
+#endif
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(lc),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, "cs_variant", func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+   variant->function = function;
+
+   /* The shared memory can be accessed through several of the buffers */
+   for (i = 0; i < ARRAY_SIZE(arg_types); ++i)
+      if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind && i != 10)
+         lp_add_function_attr(function, i + 1, LP_FUNC_ATTR_NOALIAS);
+
+   context_ptr = LLVMGetParam(function, 0);
+   for (i = 0; i < 3; i++) {
+      block_id[i] = LLVMGetParam(function, 1 + i);
+      grid_size[i] = LLVMGetParam(function, 4 + i);
+      block_size[i] = LLVMGetParam(function, 7 + i);
+   }
+   shared_ptr = LLVMGetParam(function, 10);
+   thread_data_ptr = LLVMGetParam(function, 11);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(shared_ptr, "shared");
+   lp_build_name(thread_data_ptr, "thread_data");
+
+   block = LLVMAppendBasicBlockInContext(lc, function, "entry");
+   builder = gallivm->builder;
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   total = LLVMBuildMul(builder, block_size[0], block_size[1], "");
+   total = LLVMBuildMul(builder, total, block_size[2], "");
+   step = lp_build_const_int32(gallivm, cs_type.length);
+
+   {
+      struct lp_build_loop_state loop_state;
+
+      lp_build_loop_begin(&loop_state, gallivm,
+                          lp_build_const_int32(gallivm, 0));
+
+      generate_invocations(gallivm, shader, variant, cs_type,
+                           context_ptr, thread_data_ptr,
+                           block_id, grid_size, block_size,
+                           shared_ptr, loop_state.counter, NULL);
+
+      lp_build_loop_end_cond(&loop_state, total, step, LLVMIntUGE);
+   }
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+/**
+ * Generate a new compute shader variant from the shader code and the
+ * sampler state indicated by the key.
+ */
+static struct lp_compute_shader_variant *
+generate_variant(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 const struct lp_compute_shader_variant_key *key)
+{
+   struct lp_compute_shader_variant *variant;
+   char module_name[64];
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   util_snprintf(module_name, sizeof(module_name), "cs%u_variant%u",
+                 shader->no, shader->variants_created);
+
+   variant->gallivm = gallivm_create(module_name, lp->context, NULL);
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   variant->shader = shader;
+   variant->list_item_local.base = variant;
+   variant->no = shader->variants_created++;
+
+   memcpy(&variant->key, key, shader->variant_key_size);
+
+   lp_jit_init_cs_types(variant);
+
+   generate_compute(lp, shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   variant->jit_function = (lp_jit_cs_func)
+      gallivm_jit_function(variant->gallivm, variant->function);
+
+   gallivm_free_ir(variant->gallivm);
+
+   return variant;
+}
+
+
+static void
+make_variant_key(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant_key *key)
+{
+   unsigned i;
+
+   memset(key, 0, shader->variant_key_size);
+
+   key->nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
+
+   for (i = 0; i < key->nr_samplers; ++i) {
+      if (shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
+         lp_sampler_static_sampler_state(&key->state[i].sampler_state,
+                                         lp->samplers[PIPE_SHADER_COMPUTE][i]);
+      }
+   }
+
+   /* Same as for fragment shaders, see make_variant_key() there */
+   if (shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] != -1) {
+      key->nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+      for (i = 0; i < key->nr_sampler_views; ++i) {
+         if (shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
+            lp_sampler_static_texture_state(&key->state[i].texture_state,
+                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+         }
+      }
+   }
+   else {
+      key->nr_sampler_views = key->nr_samplers;
+      for (i = 0; i < key->nr_sampler_views; ++i) {
+         if (shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
+            lp_sampler_static_texture_state(&key->state[i].texture_state,
+                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+         }
+      }
+   }
+}
+
+
+/**
+ * Find or generate the variant of the bound compute shader matching the
+ * current state.
+ */
+static struct lp_compute_shader_variant *
+llvmpipe_update_cs(struct llvmpipe_context *lp)
+{
+   struct lp_compute_shader *shader = lp->cs;
+   struct lp_compute_shader_variant_key key;
+   struct lp_compute_shader_variant *variant = NULL;
+   struct lp_cs_variant_list_item *li;
+   int64_t t0, t1;
+
+   make_variant_key(lp, shader, &key);
+
+   /* Search the variants for one which matches the key */
+   li = first_elem(&shader->variants);
+   while (!at_end(&shader->variants, li)) {
+      if (memcmp(&li->base->key, &key, shader->variant_key_size) == 0) {
+         variant = li->base;
+         break;
+      }
+      li = next_elem(li);
+   }
+
+   if (variant) {
+      move_to_head(&shader->variants, &variant->list_item_local);
+      return variant;
+   }
+
+   t0 = os_time_get();
+   variant = generate_variant(lp, shader, &key);
+   t1 = os_time_get();
+   LP_COUNT_ADD(llvm_compile_time, t1 - t0);
+   LP_COUNT_ADD(nr_llvm_compiles, 1);
+
+   if (variant) {
+      insert_at_head(&shader->variants, &variant->list_item_local);
+      shader->variants_cached++;
+   }
+
+   return variant;
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+   int nr_samplers;
+   int nr_sampler_views;
+
+   if (templ->ir_type != PIPE_SHADER_IR_TGSI)
+      return NULL;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->no = cs_no++;
+   shader->req_local_mem = templ->req_local_mem;
+   make_empty_list(&shader->variants);
+
+   /* we need to keep a local copy of the tokens */
+   shader->tokens = tgsi_dup_tokens(templ->prog);
+   if (!shader->tokens) {
+      FREE(shader);
+      return NULL;
+   }
+
+   /* get/save the summary info for this shader */
+   lp_build_tgsi_info(shader->tokens, &shader->info);
+
+   nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
+   nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+
+   shader->variant_key_size = Offset(struct lp_compute_shader_variant_key,
+                                     state[MAX2(nr_samplers, nr_sampler_views)]);
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader #%u %p:\n",
+                   shader->no, (void *) shader);
+      tgsi_dump(shader->tokens, 0);
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *) cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct lp_compute_shader *shader = cs;
+   struct lp_cs_variant_list_item *li;
+
+   assert(cs != llvmpipe->cs);
+   (void) llvmpipe;
+
+   /* Launches are synchronous, so none of the variants is still in use */
+   li = first_elem(&shader->variants);
+   while (!at_end(&shader->variants, li)) {
+      struct lp_cs_variant_list_item *next = next_elem(li);
+      struct lp_compute_shader_variant *variant = li->base;
+
+      gallivm_destroy(variant->gallivm);
+      remove_from_list(&variant->list_item_local);
+      shader->variants_cached--;
+      FREE(variant);
+
+      li = next;
+   }
+
+   assert(shader->variants_cached == 0);
+   FREE((void *) shader->tokens);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_shader_buffers(struct pipe_context *pipe,
+                            enum pipe_shader_type shader,
+                            unsigned start_slot, unsigned count,
+                            const struct pipe_shader_buffer *buffers,
+                            unsigned writable_bitmask)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= ARRAY_SIZE(llvmpipe->ssbos[shader]));
+
+   for (i = 0; i < count; i++) {
+      struct pipe_shader_buffer *dst = &llvmpipe->ssbos[shader][start_slot + i];
+
+      if (buffers && buffers[i].buffer) {
+         pipe_resource_reference(&dst->buffer, buffers[i].buffer);
+         dst->buffer_offset = buffers[i].buffer_offset;
+         dst->buffer_size = buffers[i].buffer_size;
+      }
+      else {
+         pipe_resource_reference(&dst->buffer, NULL);
+         dst->buffer_offset = 0;
+         dst->buffer_size = 0;
+      }
+   }
+}
+
+
+/**
+ * The work groups of a launch, shared by the rasterizer threads.
+ */
+struct lp_cs_job
+{
+   struct lp_rast_job base;
+
+   const struct lp_compute_shader_variant *variant;
+   const struct lp_jit_context *jit_context;
+
+   unsigned grid[3];
+   unsigned block[3];
+
+   uint64_t num_blocks;
+   uint64_t next_block;
+
+   /** Shared memory of the work group run by each thread */
+   uint8_t *shared_mem;
+   unsigned shared_stride;
+};
+
+
+static void
+cs_job_run(struct lp_rast_job *base,
+           unsigned thread_index,
+           struct lp_jit_thread_data *thread_data)
+{
+   struct lp_cs_job *job = (struct lp_cs_job *) base;
+   void *shared = job->shared_mem + thread_index * job->shared_stride;
+   uint64_t b;
+
+   /* Each thread grabs the next work group until there are none left */
+   while ((b = p_atomic_inc_return(&job->next_block) - 1) < job->num_blocks) {
+      unsigned x = b % job->grid[0];
+      unsigned y = (b / job->grid[0]) % job->grid[1];
+      unsigned z = b / job->grid[0] / job->grid[1];
+
+      job->variant->jit_function(job->jit_context, x, y, z,
+                                 job->grid[0], job->grid[1], job->grid[2],
+                                 job->block[0], job->block[1], job->block[2],
+                                 shared, thread_data);
+   }
+}
+
+
+/**
+ * Set up the JIT context of the compute shader from the bound constant
+ * buffers, shader buffers and sampler state.  The resources were flushed
+ * beforehand, and stay bound until the launch returns.
+ */
+static void
+update_cs_jit_context(struct llvmpipe_context *lp,
+                      struct lp_jit_context *jit_context)
+{
+   static const float fake_const_buf[4];
+   static const uint32_t fake_ssbo[4];
+   unsigned i;
+
+   memset(jit_context, 0, sizeof *jit_context);
+
+   for (i = 0; i < ARRAY_SIZE(lp->constants[PIPE_SHADER_COMPUTE]); i++) {
+      const struct pipe_constant_buffer *cb =
+         &lp->constants[PIPE_SHADER_COMPUTE][i];
+      const ubyte *data = NULL;
+
+      if (cb->buffer)
+         data = (const ubyte *) llvmpipe_resource_data(cb->buffer);
+      else if (cb->user_buffer)
+         data = (const ubyte *) cb->user_buffer;
+
+      if (data) {
+         jit_context->constants[i] =
+            (const float *) (data + cb->buffer_offset);
+         jit_context->num_constants[i] =
+            cb->buffer_size / (sizeof(float) * 4);
+      }
+      else {
+         jit_context->constants[i] = fake_const_buf;
+         jit_context->num_constants[i] = 0;
+      }
+   }
+
+   for (i = 0; i < ARRAY_SIZE(lp->ssbos[PIPE_SHADER_COMPUTE]); i++) {
+      const struct pipe_shader_buffer *sb = &lp->ssbos[PIPE_SHADER_COMPUTE][i];
+
+      if (sb->buffer) {
+         const ubyte *data = llvmpipe_resource_data(sb->buffer);
+         unsigned size = MIN2(sb->buffer_size,
+                              sb->buffer->width0 - sb->buffer_offset);
+
+         jit_context->ssbos[i] = (const uint32_t *) (data + sb->buffer_offset);
+         jit_context->num_ssbos[i] = size;
+      }
+      else {
+         jit_context->ssbos[i] = fake_ssbo;
+         jit_context->num_ssbos[i] = 0;
+      }
+   }
+
+   for (i = 0; i < lp->num_sampler_views[PIPE_SHADER_COMPUTE]; i++) {
+      const struct pipe_sampler_view *view =
+         lp->sampler_views[PIPE_SHADER_COMPUTE][i];
+
+      if (view)
+         lp_jit_texture_from_view(&jit_context->textures[i], view);
+   }
+
+   for (i = 0; i < lp->num_samplers[PIPE_SHADER_COMPUTE]; i++) {
+      const struct pipe_sampler_state *sampler =
+         lp->samplers[PIPE_SHADER_COMPUTE][i];
+
+      if (sampler) {
+         struct lp_jit_sampler *jit_sam = &jit_context->samplers[i];
+
+         jit_sam->min_lod = sampler->min_lod;
+         jit_sam->max_lod = sampler->max_lod;
+         jit_sam->lod_bias = sampler->lod_bias;
+         COPY_4V(jit_sam->border_color, sampler->border_color.f);
+      }
+   }
+}
+
+
+/**
+ * Wait for the rendering which touches the resources of the launch,
+ * whether queued already or still being binned.
+ */
+static void
+flush_cs_resources(struct llvmpipe_context *lp)
+{
+   struct pipe_context *pipe = &lp->pipe;
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(lp->ssbos[PIPE_SHADER_COMPUTE]); i++) {
+      struct pipe_resource *res = lp->ssbos[PIPE_SHADER_COMPUTE][i].buffer;
+
+      if (res)
+         llvmpipe_flush_resource(pipe, res, 0, FALSE, FALSE, FALSE,
+                                 __FUNCTION__);
+   }
+
+   for (i = 0; i < ARRAY_SIZE(lp->constants[PIPE_SHADER_COMPUTE]); i++) {
+      struct pipe_resource *res = lp->constants[PIPE_SHADER_COMPUTE][i].buffer;
+
+      if (res)
+         llvmpipe_flush_resource(pipe, res, 0, TRUE, FALSE, FALSE,
+                                 __FUNCTION__);
+   }
+
+   for (i = 0; i < lp->num_sampler_views[PIPE_SHADER_COMPUTE]; i++) {
+      struct pipe_sampler_view *view = lp->sampler_views[PIPE_SHADER_COMPUTE][i];
+
+      if (view)
+         llvmpipe_flush_resource(pipe, view->texture, 0, TRUE, FALSE, FALSE,
+                                 __FUNCTION__);
+   }
+}
+
+
+/**
+ * Run the work groups on the rasterizer threads, and wait for them.  The
+ * launch is queued after the scenes flushed so far, which are rasterized
+ * first.
+ */
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const struct pipe_grid_info *info)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   const unsigned num_threads = MAX2(1, screen->num_threads);
+   struct lp_compute_shader_variant *variant;
+   struct lp_jit_context jit_context;
+   struct lp_scene *scene;
+   struct lp_cs_job job;
+   unsigned i;
+
+   if (!lp->cs)
+      return;
+
+   memset(&job, 0, sizeof job);
+
+   if (info->indirect) {
+      const uint32_t *grid;
+
+      llvmpipe_flush_resource(pipe, info->indirect, 0, TRUE, TRUE, FALSE,
+                              __FUNCTION__);
+      grid = (const uint32_t *)
+         ((const ubyte *) llvmpipe_resource_data(info->indirect) +
+          info->indirect_offset);
+      for (i = 0; i < 3; i++)
+         job.grid[i] = grid[i];
+   }
+   else {
+      for (i = 0; i < 3; i++)
+         job.grid[i] = info->grid[i];
+   }
+
+   job.num_blocks = (uint64_t) job.grid[0] * job.grid[1] * job.grid[2];
+   if (!job.num_blocks)
+      return;
+
+   variant = llvmpipe_update_cs(lp);
+   if (!variant)
+      return;
+
+   flush_cs_resources(lp);
+
+   update_cs_jit_context(lp, &jit_context);
+
+   if (!lp->cs_scene) {
+      lp->cs_scene = lp_scene_create(pipe);
+      if (!lp->cs_scene)
+         return;
+   }
+   scene = lp->cs_scene;
+
+   job.base.run = cs_job_run;
+   job.variant = variant;
+   job.jit_context = &jit_context;
+   for (i = 0; i < 3; i++)
+      job.block[i] = info->block[i];
+
+   job.shared_stride = align(MAX2(lp->cs->req_local_mem, 1), 64);
+   job.shared_mem = align_malloc(num_threads * job.shared_stride, 64);
+   if (!job.shared_mem)
+      return;
+
+   scene->job = &job.base;
+   scene->fence = lp_fence_create(num_threads);
+   if (!scene->fence) {
+      scene->job = NULL;
+      align_free(job.shared_mem);
+      return;
+   }
+
+   scene->fence->issued = TRUE;
+
+   mtx_lock(&screen->rast_mutex);
+   lp_rast_queue_scene(screen->rast, scene);
+   mtx_unlock(&screen->rast_mutex);
+
+   lp_fence_wait(scene->fence);
+   lp_scene_end_rasterization(scene);
+   scene->job = NULL;
+
+   align_free(job.shared_mem);
+}
+
+
+/**
+ * Launches run to completion before returning, so there is nothing to wait
+ * for between them and the rendering.
+ */
+static void
+llvmpipe_memory_barrier(struct pipe_context *pipe, unsigned flags)
+{
+   (void) pipe;
+   (void) flags;
+}
+
+
+void
+llvmpipe_cleanup_compute(struct llvmpipe_context *lp)
+{
+   unsigned i, j;
+
+   for (i = 0; i < ARRAY_SIZE(lp->ssbos); i++) {
+      for (j = 0; j < ARRAY_SIZE(lp->ssbos[i]); j++)
+         pipe_resource_reference(&lp->ssbos[i][j].buffer, NULL);
+   }
+
+   if (lp->cs_scene) {
+      lp_scene_destroy(lp->cs_scene);
+      lp->cs_scene = NULL;
+   }
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+
+   llvmpipe->pipe.set_shader_buffers = llvmpipe_set_shader_buffers;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+   llvmpipe->pipe.memory_barrier = llvmpipe_memory_barrier;
+}
@@ -68,6 +68,7 @@
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
 #include "util/os_time.h"
+#include "util/mesa-sha1.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
@@ -102,6 +103,7 @@
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -476,10 +478,10 @@ generate_fs_loop(struct gallivm_state *gallivm,
 
    /* Build the actual shader */
    lp_build_tgsi_soa(gallivm, tokens, type, &mask,
-                     consts_ptr, num_consts_ptr, &system_values,
+                     consts_ptr, num_consts_ptr, NULL, NULL, &system_values,
                      interp->inputs,
                      outputs, context_ptr, thread_data_ptr,
-                     sampler, &shader->info.base, NULL);
+                     sampler, &shader->info.base, NULL, NULL);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -2486,8 +2488,9 @@ generate_fragment(struct llvmpipe_context *lp,
 
    blend_vec_type = lp_build_vec_type(gallivm, blend_type);
 
-   util_snprintf(func_name, sizeof(func_name), "fs%u_variant%u_%s",
-                 shader->no, variant->no, partial_mask ? "partial" : "whole");
+   /* Not numbered, as the name must match the one in cached object code. */
+   util_snprintf(func_name, sizeof(func_name), "fs_variant_%s",
+                 partial_mask ? "partial" : "whole");
 
    arg_types[0] = variant->jit_context_ptr_type;       /* context */
    arg_types[1] = int32_type;                          /* x */
@@ -2578,7 +2581,7 @@ generate_fragment(struct llvmpipe_context *lp,
 
    num_fs = 16 / fs_type.length; /* number of loops per 4x4 stamp */
    /* for 1d resources only run "upper half" of stamp */
-   if (key->resource_1d)
+   if (key->resource_1d && num_fs > 1)
       num_fs /= 2;
 
    {
@@ -2664,6 +2667,38 @@ generate_fragment(struct llvmpipe_context *lp,
 
    sampler->destroy(sampler);
 
+   /*
+    * The blend and format conversion code tops out at 8-wide vectors.  With
+    * 16-wide (AVX-512) shading hand it the stamp as two 8-wide halves, which
+    * are in the order the 8-wide loop would have produced them.
+    */
+   if (fs_type.length == 16) {
+      struct lp_type half_type = fs_type;
+      unsigned num_colors = MAX2(key->nr_cbufs, dual_source_blend ? 2 : 0);
+      unsigned half;
+
+      half_type.length = 8;
+      for (cbuf = 0; cbuf < num_colors; cbuf++) {
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+            LLVMValueRef color = LLVMBuildLoad(builder,
+                                               fs_out_color[cbuf][chan][0], "");
+            for (half = 0; half < 2; half++) {
+               LLVMValueRef ptr = lp_build_alloca(gallivm,
+                                                  lp_build_vec_type(gallivm, half_type),
+                                                  "color_half");
+               LLVMBuildStore(builder,
+                              lp_build_extract_range(gallivm, color, half * 8, 8),
+                              ptr);
+               fs_out_color[cbuf][chan][half] = ptr;
+            }
+         }
+      }
+      fs_mask[1] = lp_build_extract_range(gallivm, fs_mask[0], 8, 8);
+      fs_mask[0] = lp_build_extract_range(gallivm, fs_mask[0], 0, 8);
+      fs_type = half_type;
+      num_fs = key->resource_1d ? 1 : 2;
+   }
+
    /* Loop over color outputs / color buffers to do blending.
     */
    for(cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
@@ -2803,10 +2838,330 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
    tgsi_dump(variant->shader->base.tokens, 0);
    dump_fs_variant_key(&variant->key);
    debug_printf("variant->opaque = %u\n", variant->opaque);
+   debug_printf("variant->blit = %u\n", variant->blit);
    debug_printf("\n");
 }
 
 
+static void
+lp_fs_get_ir_cache_key(struct lp_fragment_shader *shader,
+                       const struct lp_fragment_shader_variant_key *key,
+                       unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, key, shader->variant_key_size);
+   _mesa_sha1_update(&ctx, shader->base.tokens,
+                     tgsi_num_tokens(shader->base.tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
+
+/**
+ * Find out whether the shader only outputs a fetch of texture 0, like blit
+ * and compositor shaders do:
+ *
+ *   TEX OUT[0], IN[n].xyyy, SAMP[0], 2D
+ *
+ * possibly through a temporary which is then moved to the output.
+ *
+ * \return the texture coordinate input n, or -1
+ */
+static int
+analyse_blit_shader(const struct lp_fragment_shader *shader)
+{
+   const struct lp_tgsi_info *info = &shader->info;
+   const struct lp_tgsi_texture_info *tex = &info->tex[0];
+   struct tgsi_parse_context parse;
+   unsigned num_instructions = 0;
+   unsigned temp = 0;
+   boolean written = FALSE;
+   boolean ok = TRUE;
+   int input;
+
+   if (info->num_texs != 1 ||
+       info->indirect_textures ||
+       info->base.num_outputs != 1 ||
+       info->base.output_semantic_name[0] != TGSI_SEMANTIC_COLOR ||
+       info->base.output_semantic_index[0] != 0 ||
+       (tex->target != TGSI_TEXTURE_2D && tex->target != TGSI_TEXTURE_RECT) ||
+       tex->texture_unit != 0 ||
+       tex->sampler_unit != 0 ||
+       tex->coord[0].swizzle != PIPE_SWIZZLE_X ||
+       tex->coord[1].swizzle != PIPE_SWIZZLE_Y ||
+       tex->coord[0].u.index != tex->coord[1].u.index) {
+      return -1;
+   }
+
+   input = tex->coord[0].u.index;
+   if (shader->inputs[input].interp != LP_INTERP_LINEAR &&
+       shader->inputs[input].interp != LP_INTERP_PERSPECTIVE) {
+      return -1;
+   }
+
+   tgsi_parse_init(&parse, shader->base.tokens);
+
+   while (ok && !tgsi_parse_end_of_tokens(&parse)) {
+      const struct tgsi_full_instruction *inst;
+      const struct tgsi_dst_register *dst;
+
+      tgsi_parse_token(&parse);
+      if (parse.FullToken.Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &parse.FullToken.FullInstruction;
+      if (inst->Instruction.Opcode == TGSI_OPCODE_END)
+         break;
+
+      dst = &inst->Dst[0].Register;
+      if (inst->Instruction.Saturate ||
+          dst->Indirect ||
+          dst->WriteMask != TGSI_WRITEMASK_XYZW ||
+          (dst->File != TGSI_FILE_OUTPUT && dst->File != TGSI_FILE_TEMPORARY) ||
+          (dst->File == TGSI_FILE_OUTPUT && dst->Index != 0)) {
+         ok = FALSE;
+         break;
+      }
+
+      switch (num_instructions++) {
+      case 0:
+         /* the texture fetch, whose coordinates were checked above */
+         ok = inst->Instruction.Opcode == TGSI_OPCODE_TEX;
+         temp = dst->Index;
+         break;
+      case 1:
+         /* the move of the fetched color to the output */
+         {
+            const struct tgsi_src_register *src = &inst->Src[0].Register;
+            ok = inst->Instruction.Opcode == TGSI_OPCODE_MOV &&
+                 !written &&
+                 dst->File == TGSI_FILE_OUTPUT &&
+                 src->File == TGSI_FILE_TEMPORARY &&
+                 src->Index == temp &&
+                 !src->Indirect && !src->Absolute && !src->Negate &&
+                 src->SwizzleX == PIPE_SWIZZLE_X &&
+                 src->SwizzleY == PIPE_SWIZZLE_Y &&
+                 src->SwizzleZ == PIPE_SWIZZLE_Z &&
+                 src->SwizzleW == PIPE_SWIZZLE_W;
+         }
+         break;
+      default:
+         ok = FALSE;
+         break;
+      }
+
+      written = dst->File == TGSI_FILE_OUTPUT;
+   }
+
+   tgsi_parse_free(&parse);
+
+   return ok && written ? input : -1;
+}
+
+
+/**
+ * Work out whether rectangles drawn with the variant may be drawn by
+ * copying or blending the texels directly, see lp_rast_rectangle().
+ */
+static unsigned
+get_blit_mode(const struct lp_fragment_shader *shader,
+              const struct lp_fragment_shader_variant_key *key,
+              boolean fullcolormask)
+{
+   const struct lp_static_sampler_state *sampler =
+      &key->state[0].sampler_state;
+   const struct lp_static_texture_state *texture =
+      &key->state[0].texture_state;
+   const struct pipe_rt_blend_state *blend = &key->blend.rt[0];
+   enum pipe_format format = key->cbuf_format[0];
+
+   if (shader->blit_input < 0 ||
+       key->nr_cbufs != 1 ||
+       !fullcolormask ||
+       key->blend.logicop_enable ||
+       key->blend.alpha_to_coverage ||
+       key->depth.enabled ||
+       key->stencil[0].enabled ||
+       key->alpha.enabled ||
+       key->occlusion_count) {
+      return LP_BLIT_NONE;
+   }
+
+   /* The texels must be stored like the pixels */
+   switch (format) {
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+      if (texture->format != format)
+         return LP_BLIT_NONE;
+      break;
+   case PIPE_FORMAT_B8G8R8X8_UNORM:
+      if (texture->format != format &&
+          texture->format != PIPE_FORMAT_B8G8R8A8_UNORM)
+         return LP_BLIT_NONE;
+      break;
+   case PIPE_FORMAT_R8G8B8X8_UNORM:
+      if (texture->format != format &&
+          texture->format != PIPE_FORMAT_R8G8B8A8_UNORM)
+         return LP_BLIT_NONE;
+      break;
+   default:
+      return LP_BLIT_NONE;
+   }
+
+   if (texture->swizzle_r != PIPE_SWIZZLE_X ||
+       texture->swizzle_g != PIPE_SWIZZLE_Y ||
+       texture->swizzle_b != PIPE_SWIZZLE_Z ||
+       texture->swizzle_a != PIPE_SWIZZLE_W ||
+       (texture->target != PIPE_TEXTURE_2D &&
+        texture->target != PIPE_TEXTURE_RECT)) {
+      return LP_BLIT_NONE;
+   }
+
+   /* Only point sampling of the base level returns the texels unchanged */
+   if (sampler->min_img_filter != PIPE_TEX_FILTER_NEAREST ||
+       sampler->mag_img_filter != PIPE_TEX_FILTER_NEAREST ||
+       sampler->min_mip_filter != PIPE_TEX_MIPFILTER_NONE ||
+       sampler->compare_mode != PIPE_TEX_COMPARE_NONE) {
+      return LP_BLIT_NONE;
+   }
+
+   if (!blend->blend_enable)
+      return LP_BLIT_COPY;
+
+   if (blend->rgb_func == PIPE_BLEND_ADD &&
+       blend->alpha_func == PIPE_BLEND_ADD &&
+       blend->rgb_src_factor == PIPE_BLENDFACTOR_ONE &&
+       blend->alpha_src_factor == PIPE_BLENDFACTOR_ONE &&
+       blend->rgb_dst_factor == PIPE_BLENDFACTOR_INV_SRC_ALPHA &&
+       blend->alpha_dst_factor == PIPE_BLENDFACTOR_INV_SRC_ALPHA &&
+       util_format_has_alpha(texture->format)) {
+      return LP_BLIT_OVER;
+   }
+
+   return LP_BLIT_NONE;
+}
+
+
+/**
+ * Generate and compile the functions of a variant in its gallivm.
+ */
+static void
+compile_variant(struct llvmpipe_context *lp,
+                struct lp_fragment_shader *shader,
+                struct lp_fragment_shader_variant *variant)
+{
+   lp_jit_init_types(variant);
+   
+   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
+      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+
+   if (variant->jit_function[RAST_WHOLE] == NULL) {
+      if (variant->opaque) {
+         /* Specialized shader, which doesn't need to read the color buffer. */
+         generate_fragment(lp, shader, variant, RAST_WHOLE);
+      }
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   if (variant->function[RAST_EDGE_TEST]) {
+      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_EDGE_TEST]);
+   }
+
+   if (variant->function[RAST_WHOLE]) {
+         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+               gallivm_jit_function(variant->gallivm,
+                                    variant->function[RAST_WHOLE]);
+   } else if (!variant->jit_function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+}
+
+
+struct lp_fs_opt_job
+{
+   struct llvmpipe_context *lp;
+   struct lp_fragment_shader_variant *variant;
+   unsigned char ir_sha1_cache_key[20];
+   boolean needs_caching;
+};
+
+
+/**
+ * Compile a variant again, this time optimized, and switch over to the new
+ * code.  Runs on the screen's fs_opt_queue, with a LLVM context of its own.
+ */
+static void
+optimize_variant(void *data, int thread_index)
+{
+   struct lp_fs_opt_job *job = (struct lp_fs_opt_job *)data;
+   struct lp_fragment_shader_variant *variant = job->variant;
+   struct llvmpipe_screen *screen = llvmpipe_screen(job->lp->pipe.screen);
+   struct lp_fragment_shader_variant *opt;
+   struct lp_cached_code cached = { 0 };
+   LLVMContextRef context;
+   char module_name[64];
+
+   /* A scratch copy, so that nothing the rasterizer uses changes under it */
+   opt = MALLOC_STRUCT(lp_fragment_shader_variant);
+   if (!opt)
+      return;
+   memcpy(opt, variant, sizeof *opt);
+   opt->jit_context_ptr_type = NULL;
+   opt->jit_thread_data_ptr_type = NULL;
+   opt->jit_linear_context_ptr_type = NULL;
+   opt->function[RAST_EDGE_TEST] = opt->function[RAST_WHOLE] = NULL;
+   opt->jit_function[RAST_EDGE_TEST] = opt->jit_function[RAST_WHOLE] = NULL;
+
+   context = LLVMContextCreate();
+   if (!context) {
+      FREE(opt);
+      return;
+   }
+
+   util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u_opt",
+                 variant->shader->no, variant->no);
+
+   opt->gallivm = gallivm_create(module_name, context, &cached);
+   if (opt->gallivm) {
+      compile_variant(job->lp, variant->shader, opt);
+
+      if (job->needs_caching)
+         lp_disk_cache_insert_shader(screen, &cached, job->ir_sha1_cache_key);
+
+      gallivm_free_ir(opt->gallivm);
+
+      /* The rasterizer threads pick up either pointer at any time. */
+      variant->opt_gallivm = opt->gallivm;
+      p_atomic_set(&variant->jit_function[RAST_WHOLE],
+                   opt->jit_function[RAST_WHOLE]);
+      p_atomic_set(&variant->jit_function[RAST_EDGE_TEST],
+                   opt->jit_function[RAST_EDGE_TEST]);
+   }
+
+   free(cached.data);
+   LLVMContextDispose(context);
+   FREE(opt);
+}
+
+
+static void
+optimize_variant_cleanup(void *data, int thread_index)
+{
+   FREE(data);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -2816,10 +3171,15 @@ generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc = NULL;
    boolean fullcolormask;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
+   struct lp_fs_opt_job *job = NULL;
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
    if (!variant)
@@ -2828,8 +3188,15 @@ generate_variant(struct llvmpipe_context *lp,
    util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
                  shader->no, shader->variants_created);
 
-   variant->gallivm = gallivm_create(module_name, lp->context);
+   if (screen->disk_shader_cache) {
+      lp_fs_get_ir_cache_key(shader, key, ir_sha1_cache_key);
+      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+      needs_caching = !cached.data_size;
+   }
+
+   variant->gallivm = gallivm_create(module_name, lp->context, &cached);
    if (!variant->gallivm) {
+      free(cached.data);
       FREE(variant);
       return NULL;
    }
@@ -2862,45 +3229,40 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.writes_samplemask
       ? TRUE : FALSE;
 
+   variant->blit = get_blit_mode(shader, key, fullcolormask);
+
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
-
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
-   }
-
    /*
-    * Compile everything
+    * Unless the optimized code is in the disk cache, compile quickly first
+    * so the draw needn't wait, and optimize on the fs_opt_queue.
     */
-
-   gallivm_compile_module(variant->gallivm);
-
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
-
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
+   util_queue_fence_init(&variant->opt_fence);
+   if (!cached.data_size &&
+       util_queue_is_initialized(&screen->fs_opt_queue) &&
+       !(gallivm_perf & GALLIVM_PERF_NO_OPT)) {
+      job = CALLOC_STRUCT(lp_fs_opt_job);
    }
+   variant->gallivm->fast = job != NULL;
 
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   compile_variant(lp, shader, variant);
+
+   if (job) {
+      job->lp = lp;
+      job->variant = variant;
+      memcpy(job->ir_sha1_cache_key, ir_sha1_cache_key,
+             sizeof job->ir_sha1_cache_key);
+      job->needs_caching = needs_caching;
+      util_queue_add_job(&screen->fs_opt_queue, job, &variant->opt_fence,
+                         optimize_variant, optimize_variant_cleanup);
+   } else if (needs_caching) {
+      lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
    }
 
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    return variant;
 }
@@ -2980,6 +3342,8 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       shader->inputs[i].src_index = i+1;
    }
 
+   shader->blit_input = analyse_blit_shader(shader);
+
    if (LP_DEBUG & DEBUG_TGSI) {
       unsigned attrib;
       debug_printf("llvmpipe: Create fragment shader #%u %p:\n",
@@ -3036,6 +3400,12 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants, variant->nr_instrs, lp->nr_fs_instrs);
    }
 
+   util_queue_drop_job(&llvmpipe_screen(lp->pipe.screen)->fs_opt_queue,
+                       &variant->opt_fence);
+   util_queue_fence_destroy(&variant->opt_fence);
+   if (variant->opt_gallivm)
+      gallivm_destroy(variant->opt_gallivm);
+
    gallivm_destroy(variant->gallivm);
 
    /* remove from shader's list */
@@ -3051,6 +3421,22 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
 }
 
 
+/**
+ * Stop optimizing the context's variants in the background. Shaders which
+ * are never deleted would otherwise be optimized after the context is gone.
+ */
+void
+llvmpipe_cancel_fs_optimization(struct llvmpipe_context *lp)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fs_variant_list_item *li;
+
+   foreach(li, &lp->fs_variants_list) {
+      util_queue_drop_job(&screen->fs_opt_queue, &li->base->opt_fence);
+   }
+}
+
+
 static void
 llvmpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
 {
@@ -3128,7 +3514,7 @@ llvmpipe_set_constant_buffer(struct pipe_context *pipe,
       draw_set_mapped_constant_buffer(llvmpipe->draw, shader,
                                       index, data, size);
    }
-   else {
+   else if (shader == PIPE_SHADER_FRAGMENT) {
       llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
    }
 
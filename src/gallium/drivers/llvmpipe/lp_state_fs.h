@@ -33,6 +33,7 @@
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
+#include "util/u_queue.h" /* for util_queue_fence */
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
 #include "lp_bld_interp.h" /* for struct lp_shader_input */
@@ -47,6 +48,12 @@ struct lp_fragment_shader;
 #define RAST_EDGE_TEST 1
 
 
+/** Values of lp_fragment_shader_variant::blit */
+#define LP_BLIT_NONE 0
+#define LP_BLIT_COPY 1   /**< color = texel */
+#define LP_BLIT_OVER 2   /**< color = texel + color * (1 - texel.a) */
+
+
 struct lp_sampler_static_state
 {
    /*
@@ -99,6 +106,9 @@ struct lp_fragment_shader_variant
 
    boolean opaque;
 
+   /** LP_BLIT_x: how a rectangle may be drawn without running the shader */
+   unsigned blit;
+
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -109,6 +119,14 @@ struct lp_fragment_shader_variant
 
    lp_jit_frag_func jit_function[2];
 
+   /**
+    * Optimized code replacing jit_function[] once compiled in the
+    * background, see LP_PERF=no_tiered.  The quickly compiled code in
+    * gallivm may still be running and is only freed with the variant.
+    */
+   struct gallivm_state *opt_gallivm;
+   struct util_queue_fence opt_fence;
+
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
@@ -139,6 +157,12 @@ struct lp_fragment_shader
 
    /** Fragment shader input interpolation info */
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
+
+   /**
+    * The texture coordinate input, if the shader only outputs a fetch of
+    * texture 0, or -1.
+    */
+   int blit_input;
 };
 
 
@@ -149,4 +173,7 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant);
 
+void
+llvmpipe_cancel_fs_optimization(struct llvmpipe_context *lp);
+
 #endif /* LP_STATE_FS_H_ */
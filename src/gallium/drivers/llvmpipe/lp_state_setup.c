@@ -30,6 +30,7 @@
 #include "util/u_memory.h"
 #include "util/simple_list.h"
 #include "util/os_time.h"
+#include "util/mesa-sha1.h"
 #include "gallivm/lp_bld_arit.h"
 #include "gallivm/lp_bld_bitarit.h"
 #include "gallivm/lp_bld_const.h"
@@ -717,6 +718,10 @@ generate_setup_variant(struct lp_setup_variant_key *key,
    LLVMBasicBlockRef block;
    LLVMBuilderRef builder;
    int64_t t0 = 0, t1;
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
 
    if (0)
       goto fail;
@@ -730,7 +735,14 @@ generate_setup_variant(struct lp_setup_variant_key *key,
    util_snprintf(func_name, sizeof(func_name), "setup_variant_%u",
                  variant->no);
 
-   variant->gallivm = gallivm = gallivm_create(func_name, lp->context);
+   if (screen->disk_shader_cache) {
+      _mesa_sha1_compute(key, key->size, ir_sha1_cache_key);
+      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+      needs_caching = !cached.data_size;
+   }
+
+   variant->gallivm = gallivm = gallivm_create(func_name, lp->context,
+                                               &cached);
    if (!variant->gallivm) {
       goto fail;
    }
@@ -761,7 +773,9 @@ generate_setup_variant(struct lp_setup_variant_key *key,
    func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
                                 arg_types, ARRAY_SIZE(arg_types), 0);
 
-   variant->function = LLVMAddFunction(gallivm->module, func_name, func_type);
+   /* Not numbered, as the name must match the one in cached object code. */
+   variant->function = LLVMAddFunction(gallivm->module, "setup_variant",
+                                       func_type);
    if (!variant->function)
       goto fail;
 
@@ -805,7 +819,11 @@ generate_setup_variant(struct lp_setup_variant_key *key,
    if (!variant->jit_function)
       goto fail;
 
+   if (needs_caching)
+      lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    /*
     * Update timing information:
@@ -825,6 +843,7 @@ fail:
       }
       FREE(variant);
    }
+   free(cached.data);
 
    return NULL;
 }
@@ -786,8 +786,8 @@ private:
 
    inline void checkInterference(const RIG_Node *, Graph::EdgeIterator&);
 
-   inline void insertOrderedTail(std::list<RIG_Node *>&, RIG_Node *);
-   void checkList(std::list<RIG_Node *>&);
+   static bool beginsBefore(const RIG_Node *, const RIG_Node *);
+   void checkList(std::vector<RIG_Node *>&);
 
 private:
    std::stack<uint32_t> stack;
@@ -1178,11 +1178,11 @@ GCRA::~GCRA()
 }
 
 void
-GCRA::checkList(std::list<RIG_Node *>& lst)
+GCRA::checkList(std::vector<RIG_Node *>& lst)
 {
    GCRA::RIG_Node *prev = NULL;
 
-   for (std::list<RIG_Node *>::iterator it = lst.begin();
+   for (std::vector<RIG_Node *>::iterator it = lst.begin();
         it != lst.end();
         ++it) {
       assert((*it)->getValue()->join == (*it)->getValue());
@@ -1192,56 +1192,62 @@ GCRA::checkList(std::list<RIG_Node *>& lst)
    }
 }
 
-void
-GCRA::insertOrderedTail(std::list<RIG_Node *>& list, RIG_Node *node)
+bool
+GCRA::beginsBefore(const RIG_Node *a, const RIG_Node *b)
 {
-   if (node->livei.isEmpty())
-      return;
-   // only the intervals of joined values don't necessarily arrive in order
-   std::list<RIG_Node *>::iterator prev, it;
-   for (it = list.end(); it != list.begin(); it = prev) {
-      prev = it;
-      --prev;
-      if ((*prev)->livei.begin() <= node->livei.begin())
-         break;
-   }
-   list.insert(it, node);
+   return a->livei.begin() < b->livei.begin();
 }
 
 void
 GCRA::buildRIG(ArrayList& insns)
 {
-   std::list<RIG_Node *> values, active;
+   std::vector<RIG_Node *> values;
+   // values can only interfere within their file, so keep one active list
+   // per file instead of walking past the other files' values every time
+   std::list<RIG_Node *> active[LAST_REGISTER_FILE + 1];
 
    for (std::deque<ValueDef>::iterator it = func->ins.begin();
-        it != func->ins.end(); ++it)
-      insertOrderedTail(values, getNode(it->get()->asLValue()));
+        it != func->ins.end(); ++it) {
+      RIG_Node *node = getNode(it->get()->asLValue());
+      if (!node->livei.isEmpty())
+         values.push_back(node);
+   }
 
    for (int i = 0; i < insns.getSize(); ++i) {
       Instruction *insn = reinterpret_cast<Instruction *>(insns.get(i));
-      for (int d = 0; insn->defExists(d); ++d)
-         if (insn->getDef(d)->rep() == insn->getDef(d))
-            insertOrderedTail(values, getNode(insn->getDef(d)->asLValue()));
+      for (int d = 0; insn->defExists(d); ++d) {
+         if (insn->getDef(d)->rep() != insn->getDef(d))
+            continue;
+         RIG_Node *node = getNode(insn->getDef(d)->asLValue());
+         if (!node->livei.isEmpty())
+            values.push_back(node);
+      }
    }
+   // only the intervals of joined values don't necessarily arrive in order,
+   // sorting once is much cheaper than an ordered insertion of each of them
+   // for large programs; stable to keep the order of equal starts
+   std::stable_sort(values.begin(), values.end(), beginsBefore);
    checkList(values);
 
-   while (!values.empty()) {
-      RIG_Node *cur = values.front();
+   for (std::vector<RIG_Node *>::iterator vit = values.begin();
+        vit != values.end(); ++vit) {
+      RIG_Node *cur = *vit;
+      assert(cur->f <= LAST_REGISTER_FILE);
+      std::list<RIG_Node *>& act = active[cur->f];
 
-      for (std::list<RIG_Node *>::iterator it = active.begin();
-           it != active.end();) {
+      for (std::list<RIG_Node *>::iterator it = act.begin();
+           it != act.end();) {
          RIG_Node *node = *it;
 
          if (node->livei.end() <= cur->livei.begin()) {
-            it = active.erase(it);
+            it = act.erase(it);
          } else {
-            if (node->f == cur->f && node->livei.overlaps(cur->livei))
+            if (node->livei.overlaps(cur->livei))
                cur->addInterference(node);
             ++it;
          }
       }
-      values.pop_front();
-      active.push_back(cur);
+      act.push_back(cur);
    }
 }
 
@@ -336,7 +336,8 @@ nouveau_buffer_cache(struct nouveau_context *nv, struct nv04_resource *buf)
  * operation to complete on this data.
  */
 static inline bool
-nouveau_buffer_should_discard(struct nv04_resource *buf, unsigned usage)
+nouveau_buffer_should_discard(struct nouveau_context *nv,
+                              struct nv04_resource *buf, unsigned usage)
 {
    if (!(usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))
       return false;
@@ -344,7 +345,14 @@ nouveau_buffer_should_discard(struct nv04_resource *buf, unsigned usage)
       return false;
    if (unlikely(usage & PIPE_TRANSFER_PERSISTENT))
       return false;
-   return buf->mm && nouveau_buffer_busy(buf, PIPE_TRANSFER_WRITE);
+   if (buf->mm)
+      return nouveau_buffer_busy(buf, PIPE_TRANSFER_WRITE);
+
+   /* A bo of its own would otherwise be waited on by nouveau_bo_map below,
+    * ask the kernel whether that wait would block.
+    */
+   return nouveau_bo_wait(buf->bo, NOUVEAU_BO_RDWR | NOUVEAU_BO_NOBLOCK,
+                          nv->client) != 0;
 }
 
 /* Returns a pointer to a memory area representing a window into the
@@ -440,7 +448,7 @@ nouveau_buffer_transfer_map(struct pipe_context *pipe,
 
    /* At this point, buf->domain == GART */
 
-   if (nouveau_buffer_should_discard(buf, usage)) {
+   if (nouveau_buffer_should_discard(nv, buf, usage)) {
       int ref = buf->base.reference.count - 1;
       nouveau_buffer_reallocate(nv->screen, buf, buf->domain);
       if (ref > 0) /* any references inside context possible ? */
@@ -22,8 +22,12 @@
 
 #include "pipe/p_defines.h"
 
+#include "compiler/blob.h"
 #include "compiler/nir/nir.h"
+#include "compiler/nir/nir_serialize.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/disk_cache.h"
 
 #include "nvc0/nvc0_context.h"
 
@@ -570,11 +574,152 @@ nvc0_program_dump(struct nvc0_program *prog)
 }
 #endif
 
+/* The compiled programs are cached by everything that goes into the
+ * translation: the source, the stage, the target and the few inputs taken
+ * from the program (user clip planes, shared memory, stream output).
+ */
+static void
+nvc0_program_cache_key(const struct nvc0_program *prog,
+                       const struct nv50_ir_prog_info *info,
+                       struct disk_cache *cache, cache_key key)
+{
+   struct blob blob;
+
+   blob_init(&blob);
+   blob_write_uint32(&blob, prog->type);
+   blob_write_uint32(&blob, info->target);
+   blob_write_uint32(&blob, info->optLevel);
+   blob_write_uint32(&blob, prog->vp.num_ucps);
+   blob_write_uint32(&blob, prog->cp.smem_size);
+   blob_write_bytes(&blob, &prog->pipe.stream_output,
+                    sizeof(prog->pipe.stream_output));
+
+   if (prog->pipe.type == PIPE_SHADER_IR_TGSI) {
+      blob_write_bytes(&blob, prog->pipe.tokens,
+                       tgsi_num_tokens(prog->pipe.tokens) *
+                       sizeof(struct tgsi_token));
+   } else {
+      nir_serialize(&blob, prog->pipe.ir.nir, true);
+   }
+
+   disk_cache_compute_key(cache, blob.data, blob.size, key);
+   blob_finish(&blob);
+}
+
+static bool
+nvc0_program_cache_load(struct nvc0_program *prog, struct disk_cache *cache,
+                        const cache_key key)
+{
+   const struct nvc0_program orig = *prog;
+   struct blob_reader blob;
+   size_t size;
+
+   void *buffer = disk_cache_get(cache, key, &size);
+   if (!buffer)
+      return false;
+
+   blob_reader_init(&blob, buffer, size);
+
+   prog->code_size = blob_read_uint32(&blob);
+   if (prog->code_size) {
+      prog->code = MALLOC(prog->code_size);
+      if (!prog->code)
+         goto fail;
+      blob_copy_bytes(&blob, prog->code, prog->code_size);
+   }
+   prog->num_gprs = blob_read_uint32(&blob);
+   prog->need_tls = blob_read_uint32(&blob);
+   prog->num_barriers = blob_read_uint32(&blob);
+   blob_copy_bytes(&blob, prog->hdr, sizeof(prog->hdr));
+   blob_copy_bytes(&blob, prog->flags, sizeof(prog->flags));
+   blob_copy_bytes(&blob, &prog->vp, sizeof(prog->vp));
+   prog->fp.early_z = blob_read_uint32(&blob);
+   prog->fp.colors = blob_read_uint32(&blob);
+   blob_copy_bytes(&blob, prog->fp.color_interp, sizeof(prog->fp.color_interp));
+   prog->fp.sample_mask_in = blob_read_uint32(&blob);
+   prog->fp.reads_framebuffer = blob_read_uint32(&blob);
+   prog->fp.post_depth_coverage = blob_read_uint32(&blob);
+   blob_copy_bytes(&blob, &prog->tp, sizeof(prog->tp));
+   prog->cp.smem_size = blob_read_uint32(&blob);
+
+   prog->cp.num_syms = blob_read_uint32(&blob);
+   if (prog->cp.num_syms) {
+      size_t syms_size =
+         prog->cp.num_syms * sizeof(struct nv50_ir_prog_symbol);
+      prog->cp.syms = MALLOC(syms_size);
+      if (!prog->cp.syms)
+         goto fail;
+      blob_copy_bytes(&blob, prog->cp.syms, syms_size);
+   }
+
+   if (blob_read_uint32(&blob)) {
+      prog->tfb = MALLOC_STRUCT(nvc0_transform_feedback_state);
+      if (!prog->tfb)
+         goto fail;
+      blob_copy_bytes(&blob, prog->tfb, sizeof(*prog->tfb));
+   }
+
+   if (blob.overrun || blob.current != blob.end)
+      goto fail;
+
+   free(buffer);
+   return true;
+
+fail:
+   /* leave the program as if nothing was found */
+   FREE(prog->code);
+   FREE(prog->cp.syms);
+   FREE(prog->tfb);
+   *prog = orig;
+   free(buffer);
+   return false;
+}
+
+static void
+nvc0_program_cache_store(const struct nvc0_program *prog,
+                         struct disk_cache *cache, const cache_key key)
+{
+   struct blob blob;
+
+   blob_init(&blob);
+   blob_write_uint32(&blob, prog->code_size);
+   blob_write_bytes(&blob, prog->code, prog->code_size);
+   blob_write_uint32(&blob, prog->num_gprs);
+   blob_write_uint32(&blob, prog->need_tls);
+   blob_write_uint32(&blob, prog->num_barriers);
+   blob_write_bytes(&blob, prog->hdr, sizeof(prog->hdr));
+   blob_write_bytes(&blob, prog->flags, sizeof(prog->flags));
+   blob_write_bytes(&blob, &prog->vp, sizeof(prog->vp));
+   blob_write_uint32(&blob, prog->fp.early_z);
+   blob_write_uint32(&blob, prog->fp.colors);
+   blob_write_bytes(&blob, prog->fp.color_interp, sizeof(prog->fp.color_interp));
+   blob_write_uint32(&blob, prog->fp.sample_mask_in);
+   blob_write_uint32(&blob, prog->fp.reads_framebuffer);
+   blob_write_uint32(&blob, prog->fp.post_depth_coverage);
+   blob_write_bytes(&blob, &prog->tp, sizeof(prog->tp));
+   blob_write_uint32(&blob, prog->cp.smem_size);
+
+   blob_write_uint32(&blob, prog->cp.num_syms);
+   blob_write_bytes(&blob, prog->cp.syms,
+                    prog->cp.num_syms * sizeof(struct nv50_ir_prog_symbol));
+
+   blob_write_uint32(&blob, prog->tfb != NULL);
+   if (prog->tfb)
+      blob_write_bytes(&blob, prog->tfb, sizeof(*prog->tfb));
+
+   if (!blob.out_of_memory)
+      disk_cache_put(cache, key, blob.data, blob.size, NULL);
+
+   blob_finish(&blob);
+}
+
 bool
 nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset,
+                       struct disk_cache *disk_cache,
                        struct pipe_debug_callback *debug)
 {
    struct nv50_ir_prog_info *info;
+   cache_key cache_key;
    int ret;
 
    info = CALLOC_STRUCT(nv50_ir_prog_info);
@@ -584,6 +729,27 @@ nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset,
    info->type = prog->type;
    info->target = chipset;
 
+#ifdef DEBUG
+   info->target = debug_get_num_option("NV50_PROG_CHIPSET", chipset);
+   info->optLevel = debug_get_num_option("NV50_PROG_OPTIMIZE", 3);
+   info->dbgFlags = debug_get_num_option("NV50_PROG_DEBUG", 0);
+   info->omitLineNum = debug_get_num_option("NV50_PROG_DEBUG_OMIT_LINENUM", 0);
+#else
+   info->optLevel = 3;
+#endif
+
+   /* the debug output needs an actual compile */
+   if (info->dbgFlags)
+      disk_cache = NULL;
+
+   if (disk_cache) {
+      nvc0_program_cache_key(prog, info, disk_cache, cache_key);
+      if (nvc0_program_cache_load(prog, disk_cache, cache_key)) {
+         FREE(info);
+         return true;
+      }
+   }
+
    info->bin.sourceRep = prog->pipe.type;
    switch (prog->pipe.type) {
    case PIPE_SHADER_IR_TGSI:
@@ -594,18 +760,10 @@ nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset,
       break;
    default:
       assert(!"unsupported IR!");
+      FREE(info);
       return false;
    }
 
-#ifdef DEBUG
-   info->target = debug_get_num_option("NV50_PROG_CHIPSET", chipset);
-   info->optLevel = debug_get_num_option("NV50_PROG_OPTIMIZE", 3);
-   info->dbgFlags = debug_get_num_option("NV50_PROG_DEBUG", 0);
-   info->omitLineNum = debug_get_num_option("NV50_PROG_DEBUG_OMIT_LINENUM", 0);
-#else
-   info->optLevel = 3;
-#endif
-
    info->bin.smemSize = prog->cp.smem_size;
    info->io.genUserClip = prog->vp.num_ucps;
    info->io.auxCBSlot = 15;
@@ -711,6 +869,13 @@ nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset,
       prog->tfb = nvc0_program_create_tfb_state(info,
                                                 &prog->pipe.stream_output);
 
+   /* The relocations are only needed for the builtin library, and the
+    * fixups hold pointers to the codegen functions applying them, don't
+    * cache the (few) programs having any.
+    */
+   if (disk_cache && !prog->relocs && !prog->fixups)
+      nvc0_program_cache_store(prog, disk_cache, cache_key);
+
    pipe_debug_message(debug, SHADER_INFO,
                       "type: %d, local: %d, shared: %d, gpr: %d, inst: %d, bytes: %d",
                       prog->type, info->bin.tlsSpace, info->bin.smemSize,
@@ -31,6 +31,7 @@
 
 #include "util/macros.h"
 #include "util/u_format.h"
+#include "util/u_framebuffer.h"
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "util/u_memory.h"
@@ -2019,6 +2020,13 @@ panfrost_set_framebuffer_state(struct pipe_context *pctx,
 {
         struct panfrost_context *ctx = pan_context(pctx);
 
+        /* The state tracker rebinds the same framebuffer a lot (around blits
+         * and clears, for instance). That isn't a switch, so don't flush and
+         * write back the tiles for it */
+
+        if (util_framebuffer_state_equal(&ctx->pipe_framebuffer, fb))
+                return;
+
         /* Flush when switching away from an FBO */
 
         if (!panfrost_is_scanout(ctx)) {
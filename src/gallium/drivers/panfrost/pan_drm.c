@@ -28,6 +28,8 @@
 
 #include "drm-uapi/panfrost_drm.h"
 
+#include "c11/threads.h"
+#include "util/list.h"
 #include "util/u_memory.h"
 #include "util/os_time.h"
 #include "os/os_mman.h"
@@ -38,11 +40,149 @@
 #include "pan_drm.h"
 #include "pan_trace.h"
 
+/* Creating, mapping and closing BOs are expensive kernel round trips, and
+ * streaming uploads create and destroy resources every frame. So instead of
+ * closing freed BOs, keep them around to hand out again for allocations that
+ * don't care about the initial contents. A BO freed while a frame is in
+ * flight may still be read by the GPU, so it only becomes reusable once
+ * we've waited on that frame's fence. */
+
+#define PANFROST_BO_CACHE_MAX_SIZE (64 << 20)
+
+struct panfrost_cached_bo {
+        struct list_head link;
+
+        uint8_t *cpu;
+        mali_ptr gpu;
+        size_t size;
+        int gem_handle;
+};
+
 struct panfrost_drm {
 	struct panfrost_driver base;
 	int fd;
+
+        mtx_t bo_cache_lock;
+
+        /* Freed BOs ready for reuse, oldest first */
+        struct list_head bo_cache;
+
+        /* Freed BOs that the last submitted frame may still be using */
+        struct list_head bo_cache_pending;
+
+        /* Total size of the BOs of both lists */
+        size_t bo_cache_size;
 };
 
+static bool
+panfrost_drm_bo_cache_get(struct panfrost_drm *drm,
+                          struct panfrost_memory *mem, size_t size)
+{
+        struct panfrost_cached_bo *found = NULL;
+
+        mtx_lock(&drm->bo_cache_lock);
+
+        list_for_each_entry_rev(struct panfrost_cached_bo, entry,
+                                &drm->bo_cache, link) {
+                if (entry->size == size) {
+                        found = entry;
+                        list_del(&found->link);
+                        drm->bo_cache_size -= size;
+                        break;
+                }
+        }
+
+        mtx_unlock(&drm->bo_cache_lock);
+
+        if (!found)
+                return false;
+
+        mem->cpu = found->cpu;
+        mem->gpu = found->gpu;
+        mem->size = found->size;
+        mem->gem_handle = found->gem_handle;
+        mem->stack_bottom = 0;
+
+        FREE(found);
+        return true;
+}
+
+static bool
+panfrost_drm_bo_cache_put(struct panfrost_screen *screen,
+                          struct panfrost_memory *mem)
+{
+	struct panfrost_drm *drm = (struct panfrost_drm *)screen->driver;
+        bool cached = false;
+
+        mtx_lock(&drm->bo_cache_lock);
+
+        if (drm->bo_cache_size + mem->size <= PANFROST_BO_CACHE_MAX_SIZE) {
+                struct panfrost_cached_bo *entry =
+                        CALLOC_STRUCT(panfrost_cached_bo);
+
+                if (entry) {
+                        entry->cpu = mem->cpu;
+                        entry->gpu = mem->gpu;
+                        entry->size = mem->size;
+                        entry->gem_handle = mem->gem_handle;
+
+                        list_addtail(&entry->link, screen->last_fragment_flushed ?
+                                                   &drm->bo_cache :
+                                                   &drm->bo_cache_pending);
+                        drm->bo_cache_size += mem->size;
+                        cached = true;
+                }
+        }
+
+        mtx_unlock(&drm->bo_cache_lock);
+
+        return cached;
+}
+
+/* Called once the last submitted frame is known to be done with */
+
+static void
+panfrost_drm_bo_cache_release_pending(struct panfrost_drm *drm)
+{
+        mtx_lock(&drm->bo_cache_lock);
+        list_splicetail(&drm->bo_cache_pending, &drm->bo_cache);
+        list_inithead(&drm->bo_cache_pending);
+        mtx_unlock(&drm->bo_cache_lock);
+}
+
+static void
+panfrost_drm_release_bo(struct panfrost_drm *drm, void *cpu, size_t size,
+                        int gem_handle)
+{
+	struct drm_gem_close gem_close = {
+		.handle = gem_handle,
+	};
+	int ret;
+
+        if (os_munmap(cpu, size)) {
+                perror("munmap");
+                abort();
+        }
+
+	ret = drmIoctl(drm->fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+	if (ret) {
+                fprintf(stderr, "DRM_IOCTL_GEM_CLOSE failed: %d\n", ret);
+		assert(0);
+	}
+}
+
+static void
+panfrost_drm_bo_cache_evict_list(struct panfrost_drm *drm,
+                                 struct list_head *list)
+{
+        list_for_each_entry_safe(struct panfrost_cached_bo, entry, list, link) {
+                panfrost_drm_release_bo(drm, entry->cpu, entry->size,
+                                        entry->gem_handle);
+                list_del(&entry->link);
+                FREE(entry);
+        }
+}
+
 static void
 panfrost_drm_allocate_slab(struct panfrost_screen *screen,
 		           struct panfrost_memory *mem,
@@ -60,7 +200,10 @@ panfrost_drm_allocate_slab(struct panfrost_screen *screen,
 	struct drm_panfrost_mmap_bo mmap_bo = {0,};
 	int ret;
 
-	// TODO cache allocations
+        if ((extra_flags & PAN_ALLOCATE_RECYCLE) &&
+            panfrost_drm_bo_cache_get(drm, mem, create_bo.size))
+                return;
+
 	// TODO properly handle errors
 	// TODO take into account extra_flags
 
@@ -99,24 +242,12 @@ static void
 panfrost_drm_free_slab(struct panfrost_screen *screen, struct panfrost_memory *mem)
 {
 	struct panfrost_drm *drm = (struct panfrost_drm *)screen->driver;
-	struct drm_gem_close gem_close = {
-		.handle = mem->gem_handle,
-	};
-	int ret;
 
-        if (os_munmap((void *) (uintptr_t) mem->cpu, mem->size)) {
-                perror("munmap");
-                abort();
-        }
+        if (!panfrost_drm_bo_cache_put(screen, mem))
+                panfrost_drm_release_bo(drm, (void *) (uintptr_t) mem->cpu,
+                                        mem->size, mem->gem_handle);
 
 	mem->cpu = NULL;
-
-	ret = drmIoctl(drm->fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
-	if (ret) {
-                fprintf(stderr, "DRM_IOCTL_GEM_CLOSE failed: %d\n", ret);
-		assert(0);
-	}
-
 	mem->gem_handle = -1;
 }
 
@@ -307,6 +438,9 @@ panfrost_drm_force_flush_fragment(struct panfrost_context *ctx,
 		drmSyncobjWait(drm->fd, &ctx->out_sync, 1, INT64_MAX, 0, NULL);
                 screen->last_fragment_flushed = true;
 
+                /* BOs freed during the frame can be reused now */
+                panfrost_drm_bo_cache_release_pending(drm);
+
                 /* The job finished up, so we're safe to clean it up now */
                 panfrost_free_job(ctx, screen->last_job);
 	}
@@ -406,6 +540,19 @@ panfrost_drm_fence_finish(struct pipe_screen *pscreen,
         return ret >= 0;
 }
 
+static void
+panfrost_drm_destroy(struct panfrost_screen *screen)
+{
+	struct panfrost_drm *drm = (struct panfrost_drm *)screen->driver;
+
+        panfrost_drm_bo_cache_evict_list(drm, &drm->bo_cache);
+        panfrost_drm_bo_cache_evict_list(drm, &drm->bo_cache_pending);
+        mtx_destroy(&drm->bo_cache_lock);
+
+        FREE(drm);
+        screen->driver = NULL;
+}
+
 struct panfrost_driver *
 panfrost_create_drm_driver(int fd)
 {
@@ -413,6 +560,10 @@ panfrost_create_drm_driver(int fd)
 
 	driver->fd = fd;
 
+        mtx_init(&driver->bo_cache_lock, mtx_plain);
+        list_inithead(&driver->bo_cache);
+        list_inithead(&driver->bo_cache_pending);
+
 	driver->base.import_bo = panfrost_drm_import_bo;
 	driver->base.export_bo = panfrost_drm_export_bo;
 	driver->base.free_imported_bo = panfrost_drm_free_imported_bo;
@@ -426,6 +577,7 @@ panfrost_create_drm_driver(int fd)
 	driver->base.fence_reference = panfrost_drm_fence_reference;
 	driver->base.fence_finish = panfrost_drm_fence_finish;
 	driver->base.dump_counters = panfrost_drm_dump_counters;
+	driver->base.destroy = panfrost_drm_destroy;
 
         return &driver->base;
 }
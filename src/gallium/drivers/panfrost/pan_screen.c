@@ -502,8 +502,11 @@ panfrost_is_format_supported( struct pipe_screen *screen,
 
 
 static void
-panfrost_destroy_screen( struct pipe_screen *screen )
+panfrost_destroy_screen( struct pipe_screen *pscreen )
 {
+        struct panfrost_screen *screen = pan_screen(pscreen);
+
+        screen->driver->destroy(screen);
         FREE(screen);
 }
 
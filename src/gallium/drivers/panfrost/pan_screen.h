@@ -47,6 +47,10 @@ struct panfrost_screen;
 #define PAN_ALLOCATE_INVISIBLE (1 << 2)
 #define PAN_ALLOCATE_COHERENT_LOCAL (1 << 3)
 
+/* The initial contents don't matter, so the memory may be recycled from a
+ * previously freed BO instead of freshly allocated (and cleared) */
+#define PAN_ALLOCATE_RECYCLE (1 << 4)
+
 struct panfrost_driver {
 	struct panfrost_bo * (*import_bo) (struct panfrost_screen *screen, struct winsys_handle *whandle);
 	int (*export_bo) (struct panfrost_screen *screen, int gem_handle, unsigned int stride, struct winsys_handle *whandle);
@@ -76,6 +80,7 @@ struct panfrost_driver {
                       struct pipe_context *ctx,
                       struct pipe_fence_handle *fence,
                       uint64_t timeout);
+        void (*destroy) (struct panfrost_screen *screen);
 };
 
 struct panfrost_screen {
@@ -2750,7 +2750,8 @@ void *r600_create_vertex_fetch_shader(struct pipe_context *ctx,
 
 			fprintf(stderr, "______________________________________________________________\n");
 		} else {
-			r600_sb_bytecode_process(rctx, &bc, NULL, 1 /*dump*/, 0 /*optimize*/);
+			r600_sb_bytecode_process(rctx, &rctx->sb_context, &bc, NULL,
+						 1 /*dump*/, 0 /*optimize*/);
 		}
 	}
 
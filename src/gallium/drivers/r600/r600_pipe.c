@@ -68,9 +68,15 @@ static void r600_destroy_context(struct pipe_context *context)
 	struct r600_context *rctx = (struct r600_context *)context;
 	unsigned sh, i;
 
+	if (util_queue_is_initialized(&rctx->shader_compiler_queue)) {
+		util_queue_finish(&rctx->shader_compiler_queue);
+		util_queue_destroy(&rctx->shader_compiler_queue);
+	}
+
 	r600_isa_destroy(rctx->isa);
 
 	r600_sb_context_destroy(rctx->sb_context);
+	r600_sb_context_destroy(rctx->sb_compiler_context);
 
 	for (sh = 0; sh < (rctx->b.chip_class < EVERGREEN ? R600_NUM_HW_STAGES : EG_NUM_HW_STAGES); sh++) {
 		r600_resource_reference(&rctx->scratch_buffers[sh].buffer, NULL);
@@ -225,6 +231,13 @@ static struct pipe_context *r600_create_context(struct pipe_screen *screen,
 	if (!rctx->isa || r600_isa_init(rctx, rctx->isa))
 		goto fail;
 
+	/* Keep compiling synchronously when dumping shaders, so that the
+	 * output isn't interleaved.  Failing to start the thread only
+	 * means the same. */
+	if (!(rscreen->b.debug_flags & DBG_ALL_SHADERS))
+		util_queue_init(&rctx->shader_compiler_queue, "r600_sh", 32, 1,
+				UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+
 	if (rscreen->b.debug_flags & DBG_FORCE_DMA)
 		rctx->b.b.resource_copy_region = rctx->b.dma_copy;
 
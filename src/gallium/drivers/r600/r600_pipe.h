@@ -359,6 +359,11 @@ struct r600_pipe_shader_selector {
 	uint64_t        lds_patch_outputs_written_mask;
 	uint64_t        lds_outputs_written_mask;
 	unsigned	nr_ps_max_color_exports;
+
+	/* variant compiled on the shader compiler queue, not uploaded yet */
+	struct r600_context		*rctx;
+	struct r600_pipe_shader		*precompiled;
+	struct util_queue_fence		ready;
 };
 
 struct r600_pipe_sampler_state {
@@ -591,6 +596,9 @@ struct r600_context {
 	unsigned			last_start_instance;
 
 	void				*sb_context;
+	/* compiles the first variant of new shaders in the background */
+	struct util_queue		shader_compiler_queue;
+	void				*sb_compiler_context;
 	struct r600_isa		*isa;
 	float sample_positions[4 * 16];
 	float tess_state[8];
@@ -734,6 +742,13 @@ void r600_resource_copy_region(struct pipe_context *ctx,
 			       const struct pipe_box *src_box);
 
 /* r600_shader.c */
+int r600_pipe_shader_compile(struct r600_context *rctx,
+			     void **sb_context,
+			     struct r600_pipe_shader *shader,
+			     union r600_shader_key key);
+int r600_pipe_shader_finish(struct pipe_context *ctx,
+			    struct r600_pipe_shader *shader,
+			    union r600_shader_key key);
 int r600_pipe_shader_create(struct pipe_context *ctx,
 			    struct r600_pipe_shader *shader,
 			    union r600_shader_key key);
@@ -33,6 +33,8 @@
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_scan.h"
 #include "tgsi/tgsi_dump.h"
+#include "compiler/blob.h"
+#include "util/disk_cache.h"
 #include "util/u_bitcast.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
@@ -157,18 +159,190 @@ static int store_shader(struct pipe_context *ctx,
 	return 0;
 }
 
-int r600_pipe_shader_create(struct pipe_context *ctx,
-			    struct r600_pipe_shader *shader,
-			    union r600_shader_key key)
+/*
+ * Backend shader cache:
+ *
+ * The compiled bytecode and the plain-data part of r600_shader are cached
+ * by the hash of the TGSI tokens, the stream output info and the variant
+ * key, which lets a variant skip both the TGSI translation and the sb
+ * optimizer.  The bytecode lists and the temp arrays (only needed by sb)
+ * aren't stored.
+ */
+
+#define SHADER_CACHE_START  offsetof(struct r600_shader, ninput)
+#define SHADER_CACHE_SIZE   (offsetof(struct r600_shader, arrays) - \
+			     SHADER_CACHE_START)
+#define SHADER_CACHE_TAIL   offsetof(struct r600_shader, uses_doubles)
+#define SHADER_CACHE_TAIL_SIZE (sizeof(struct r600_shader) - SHADER_CACHE_TAIL)
+
+static bool r600_shader_use_cache(struct r600_context *rctx,
+				  struct r600_pipe_shader *shader,
+				  union r600_shader_key key)
+{
+	struct r600_pipe_shader_selector *sel = shader->selector;
+
+	if (!rctx->screen->b.disk_shader_cache)
+		return false;
+
+	/* A GS also needs its copy shader and an ES is laid out after the
+	 * inputs of the currently bound GS, neither is covered by the key. */
+	switch (sel->type) {
+	case PIPE_SHADER_GEOMETRY:
+		return false;
+	case PIPE_SHADER_VERTEX:
+		return !key.vs.as_es;
+	case PIPE_SHADER_TESS_EVAL:
+		return !key.tes.as_es;
+	default:
+		return true;
+	}
+}
+
+static void r600_shader_cache_key(struct r600_context *rctx,
+				  struct r600_pipe_shader *shader,
+				  union r600_shader_key key,
+				  cache_key cache_key)
+{
+	struct r600_pipe_shader_selector *sel = shader->selector;
+	/* sb changes the generated code: */
+	uint32_t sb_flags = rctx->screen->b.debug_flags &
+			    (DBG_NO_SB | DBG_SB_SAFEMATH);
+	struct blob blob;
+
+	blob_init(&blob);
+	blob_write_bytes(&blob, sel->tokens,
+			 tgsi_num_tokens(sel->tokens) * sizeof(struct tgsi_token));
+	blob_write_bytes(&blob, &sel->so, sizeof(sel->so));
+	blob_write_bytes(&blob, &key, sizeof(key));
+	blob_write_uint32(&blob, rctx->b.chip_class);
+	blob_write_uint32(&blob, rctx->screen->has_compressed_msaa_texturing);
+	blob_write_uint32(&blob, sb_flags);
+
+	disk_cache_compute_key(rctx->screen->b.disk_shader_cache,
+			       blob.data, blob.size, cache_key);
+
+	blob_finish(&blob);
+}
+
+/**
+ * Look up the variant in the disk cache.  On a hit, the shader info and
+ * the final bytecode are filled in as if the shader had been compiled.
+ */
+static bool r600_shader_cache_load(struct r600_context *rctx,
+				   struct r600_pipe_shader *shader,
+				   const cache_key cache_key)
+{
+	struct r600_shader *rshader = &shader->shader;
+	struct r600_isa *isa = rshader->bc.isa;
+	struct blob_reader blob;
+	size_t size;
+
+	void *buffer = disk_cache_get(rctx->screen->b.disk_shader_cache,
+				      cache_key, &size);
+	if (!buffer)
+		return false;
+
+	r600_bytecode_init(&rshader->bc, rctx->b.chip_class, rctx->b.family,
+			   rctx->screen->has_compressed_msaa_texturing);
+
+	blob_reader_init(&blob, buffer, size);
+
+	if (blob_read_uint32(&blob) != SHADER_CACHE_SIZE ||
+	    blob_read_uint32(&blob) != SHADER_CACHE_TAIL_SIZE)
+		goto fail;
+
+	rshader->processor_type = blob_read_uint32(&blob);
+	blob_copy_bytes(&blob, (char *)rshader + SHADER_CACHE_START,
+			SHADER_CACHE_SIZE);
+	blob_copy_bytes(&blob, (char *)rshader + SHADER_CACHE_TAIL,
+			SHADER_CACHE_TAIL_SIZE);
+	rshader->arrays = NULL;
+	rshader->num_arrays = rshader->max_arrays = 0;
+
+	rshader->bc.ngpr = blob_read_uint32(&blob);
+	rshader->bc.nstack = blob_read_uint32(&blob);
+	rshader->bc.nlds_dw = blob_read_uint32(&blob);
+	shader->scratch_space_needed = blob_read_uint32(&blob);
+	shader->enabled_stream_buffers_mask = blob_read_uint32(&blob);
+
+	rshader->bc.ndw = blob_read_uint32(&blob);
+	if (blob.overrun || !rshader->bc.ndw)
+		goto fail;
+	rshader->bc.bytecode = malloc(rshader->bc.ndw * 4);
+	if (!rshader->bc.bytecode)
+		goto fail;
+	blob_copy_bytes(&blob, rshader->bc.bytecode, rshader->bc.ndw * 4);
+
+	if (blob.overrun || blob.current != blob.end)
+		goto fail;
+
+	free(buffer);
+	return true;
+
+fail:
+	/* leave the shader as if nothing was found: */
+	r600_bytecode_clear(&rshader->bc);
+	memset(rshader, 0, sizeof(*rshader));
+	rshader->bc.isa = isa;
+	shader->scratch_space_needed = 0;
+	shader->enabled_stream_buffers_mask = 0;
+	free(buffer);
+	return false;
+}
+
+/**
+ * Store a freshly compiled variant in the disk cache.
+ */
+static void r600_shader_cache_store(struct r600_context *rctx,
+				    struct r600_pipe_shader *shader,
+				    const cache_key cache_key)
+{
+	struct r600_shader *rshader = &shader->shader;
+	struct blob blob;
+
+	blob_init(&blob);
+	blob_write_uint32(&blob, SHADER_CACHE_SIZE);
+	blob_write_uint32(&blob, SHADER_CACHE_TAIL_SIZE);
+	blob_write_uint32(&blob, rshader->processor_type);
+	blob_write_bytes(&blob, (char *)rshader + SHADER_CACHE_START,
+			 SHADER_CACHE_SIZE);
+	blob_write_bytes(&blob, (char *)rshader + SHADER_CACHE_TAIL,
+			 SHADER_CACHE_TAIL_SIZE);
+	blob_write_uint32(&blob, rshader->bc.ngpr);
+	blob_write_uint32(&blob, rshader->bc.nstack);
+	blob_write_uint32(&blob, rshader->bc.nlds_dw);
+	blob_write_uint32(&blob, shader->scratch_space_needed);
+	blob_write_uint32(&blob, shader->enabled_stream_buffers_mask);
+	blob_write_uint32(&blob, rshader->bc.ndw);
+	blob_write_bytes(&blob, rshader->bc.bytecode, rshader->bc.ndw * 4);
+
+	if (!blob.out_of_memory)
+		disk_cache_put(rctx->screen->b.disk_shader_cache, cache_key,
+			       blob.data, blob.size, NULL);
+
+	blob_finish(&blob);
+}
+
+/**
+ * Translate and optimize the shader into its final bytecode.  This only
+ * reads immutable context state and uses the given sb context, so it can
+ * run off the context thread; the upload is left to
+ * r600_pipe_shader_finish().  On failure the shader is left for the caller
+ * to destroy.
+ */
+int r600_pipe_shader_compile(struct r600_context *rctx,
+			     void **sb_context,
+			     struct r600_pipe_shader *shader,
+			     union r600_shader_key key)
 {
-	struct r600_context *rctx = (struct r600_context *)ctx;
 	struct r600_pipe_shader_selector *sel = shader->selector;
 	int r;
 	bool dump = r600_can_dump_shader(&rctx->screen->b,
 					 tgsi_get_processor_type(sel->tokens));
 	unsigned use_sb = !(rctx->screen->b.debug_flags & DBG_NO_SB);
 	unsigned sb_disasm;
-	unsigned export_shader;
+	bool use_cache;
+	cache_key cache_key;
 
 	shader->shader.bc.isa = rctx->isa;
 
@@ -180,10 +354,17 @@ int r600_pipe_shader_create(struct pipe_context *ctx,
 			r600_dump_streamout(&sel->so);
 		}
 	}
+	use_cache = !dump && r600_shader_use_cache(rctx, shader, key);
+	if (use_cache) {
+		r600_shader_cache_key(rctx, shader, key, cache_key);
+		if (r600_shader_cache_load(rctx, shader, cache_key))
+			return 0;
+	}
+
 	r = r600_shader_from_tgsi(rctx, shader, key);
 	if (r) {
 		R600_ERR("translation from TGSI failed !\n");
-		goto error;
+		return r;
 	}
 	if (shader->shader.processor_type == PIPE_SHADER_VERTEX) {
 		/* only disable for vertex shaders in tess paths */
@@ -206,7 +387,7 @@ int r600_pipe_shader_create(struct pipe_context *ctx,
 		r = r600_bytecode_build(&shader->shader.bc);
 		if (r) {
 			R600_ERR("building bytecode failed !\n");
-			goto error;
+			return r;
 		}
 	}
 
@@ -216,30 +397,49 @@ int r600_pipe_shader_create(struct pipe_context *ctx,
 		r600_bytecode_disasm(&shader->shader.bc);
 		fprintf(stderr, "______________________________________________________________\n");
 	} else if ((dump && sb_disasm) || use_sb) {
-		r = r600_sb_bytecode_process(rctx, &shader->shader.bc, &shader->shader,
-		                             dump, use_sb);
+		r = r600_sb_bytecode_process(rctx, sb_context, &shader->shader.bc,
+					     &shader->shader, dump, use_sb);
 		if (r) {
 			R600_ERR("r600_sb_bytecode_process failed !\n");
-			goto error;
+			return r;
 		}
 	}
 
-	if (shader->gs_copy_shader) {
-		if (dump) {
-			// dump copy shader
-			r = r600_sb_bytecode_process(rctx, &shader->gs_copy_shader->shader.bc,
-						     &shader->gs_copy_shader->shader, dump, 0);
-			if (r)
-				goto error;
-		}
+	if (use_cache)
+		r600_shader_cache_store(rctx, shader, cache_key);
 
+	if (shader->gs_copy_shader && dump) {
+		// dump copy shader
+		r = r600_sb_bytecode_process(rctx, sb_context,
+					     &shader->gs_copy_shader->shader.bc,
+					     &shader->gs_copy_shader->shader, dump, 0);
+		if (r)
+			return r;
+	}
+
+	return 0;
+}
+
+/**
+ * Upload a compiled shader and build its register state, this has to
+ * happen on the context thread.
+ */
+int r600_pipe_shader_finish(struct pipe_context *ctx,
+			    struct r600_pipe_shader *shader,
+			    union r600_shader_key key)
+{
+	struct r600_context *rctx = (struct r600_context *)ctx;
+	unsigned export_shader;
+	int r;
+
+	if (shader->gs_copy_shader) {
 		if ((r = store_shader(ctx, shader->gs_copy_shader)))
-			goto error;
+			return r;
 	}
 
 	/* Store the shader in a buffer. */
 	if ((r = store_shader(ctx, shader)))
-		goto error;
+		return r;
 
 	/* Build state. */
 	switch (shader->shader.processor_type) {
@@ -288,13 +488,23 @@ int r600_pipe_shader_create(struct pipe_context *ctx,
 		evergreen_update_ls_state(ctx, shader);
 		break;
 	default:
-		r = -EINVAL;
-		goto error;
+		return -EINVAL;
 	}
 	return 0;
+}
 
-error:
-	r600_pipe_shader_destroy(ctx, shader);
+int r600_pipe_shader_create(struct pipe_context *ctx,
+			    struct r600_pipe_shader *shader,
+			    union r600_shader_key key)
+{
+	struct r600_context *rctx = (struct r600_context *)ctx;
+	int r;
+
+	r = r600_pipe_shader_compile(rctx, &rctx->sb_context, shader, key);
+	if (!r)
+		r = r600_pipe_shader_finish(ctx, shader, key);
+	if (r)
+		r600_pipe_shader_destroy(ctx, shader);
 	return r;
 }
 
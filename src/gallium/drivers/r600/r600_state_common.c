@@ -834,6 +834,71 @@ static inline void r600_shader_selector_key(const struct pipe_context *ctx,
 	}
 }
 
+/* Guess the key of the variant the first draw with this shader is going
+ * to use, from the common state only: no GS/tessellation stages, a single
+ * color buffer and nothing else set. */
+static bool r600_shader_precompile_key(const struct r600_pipe_shader_selector *sel,
+				       union r600_shader_key *key)
+{
+	memset(key, 0, sizeof(*key));
+
+	switch (sel->type) {
+	case PIPE_SHADER_VERTEX:
+	case PIPE_SHADER_TESS_EVAL:
+		return true;
+	case PIPE_SHADER_FRAGMENT:
+		key->ps.nr_cbufs = 1;
+		return true;
+	default:
+		/* GS variants need their copy shader and the TCS key depends on
+		 * the bound TES, they are compiled at draw time. */
+		return false;
+	}
+}
+
+static void r600_shader_precompile(void *job, int thread_index)
+{
+	struct r600_pipe_shader_selector *sel = job;
+	struct r600_context *rctx = sel->rctx;
+	struct r600_pipe_shader *shader = sel->precompiled;
+
+	if (r600_pipe_shader_compile(rctx, &rctx->sb_compiler_context,
+				     shader, shader->key)) {
+		r600_pipe_shader_destroy(&rctx->b.b, shader);
+		FREE(shader);
+		sel->precompiled = NULL;
+	}
+}
+
+/* Wait for the variant compiled at shader creation and make it the first
+ * one in the list, returns true if there was one. */
+static bool r600_shader_install_precompiled(struct pipe_context *ctx,
+					    struct r600_pipe_shader_selector *sel)
+{
+	struct r600_pipe_shader *shader;
+
+	util_queue_fence_wait(&sel->ready);
+
+	shader = sel->precompiled;
+	if (!shader)
+		return false;
+	sel->precompiled = NULL;
+
+	if (r600_pipe_shader_finish(ctx, shader, shader->key)) {
+		r600_pipe_shader_destroy(ctx, shader);
+		FREE(shader);
+		return false;
+	}
+
+	if (sel->type == PIPE_SHADER_FRAGMENT)
+		sel->nr_ps_max_color_exports = shader->shader.nr_ps_max_color_exports;
+
+	shader->next_variant = NULL;
+	sel->current = shader;
+	sel->num_shaders = 1;
+	return true;
+}
+
 /* Select the hw shader variant depending on the current state.
  * (*dirty) is set to 1 if current variant was changed */
 int r600_shader_select(struct pipe_context *ctx,
@@ -842,8 +907,12 @@ int r600_shader_select(struct pipe_context *ctx,
 {
 	union r600_shader_key key;
 	struct r600_pipe_shader * shader = NULL;
+	bool installed = false;
 	int r;
 
+	if (unlikely(!sel->current))
+		installed = r600_shader_install_precompiled(ctx, sel);
+
 	r600_shader_selector_key(ctx, sel, &key);
 
 	/* Check if we don't need to change anything.
@@ -851,6 +920,8 @@ int r600_shader_select(struct pipe_context *ctx,
 	 * variants, it will cost just a computation of the key and this
 	 * test. */
 	if (likely(sel->current && memcmp(&sel->current->key, &key, sizeof(key)) == 0)) {
+		if (unlikely(installed) && dirty)
+			*dirty = true;
 		return 0;
 	}
 
@@ -913,6 +984,7 @@ struct r600_pipe_shader_selector *r600_create_shader_state_tokens(struct pipe_co
 	sel->type = pipe_shader_type;
 	sel->tokens = tgsi_dup_tokens(tokens);
 	tgsi_scan_shader(tokens, &sel->info);
+	util_queue_fence_init(&sel->ready);
 	return sel;
 }
 
@@ -920,6 +992,8 @@ static void *r600_create_shader_state(struct pipe_context *ctx,
 			       const struct pipe_shader_state *state,
 			       unsigned pipe_shader_type)
 {
+	struct r600_context *rctx = (struct r600_context *)ctx;
+	union r600_shader_key key;
 	int i;
 	struct r600_pipe_shader_selector *sel = r600_create_shader_state_tokens(ctx, state->tokens, pipe_shader_type);
 
@@ -960,6 +1034,22 @@ static void *r600_create_shader_state(struct pipe_context *ctx,
 		break;
 	}
 
+	/* Get the likely first variant compiled before it is needed. */
+	if (util_queue_is_initialized(&rctx->shader_compiler_queue) &&
+	    r600_shader_precompile_key(sel, &key)) {
+		struct r600_pipe_shader *shader =
+			CALLOC(1, sizeof(struct r600_pipe_shader));
+
+		if (shader) {
+			shader->selector = sel;
+			shader->key = key;
+			sel->rctx = rctx;
+			sel->precompiled = shader;
+			util_queue_add_job(&rctx->shader_compiler_queue, sel,
+					   &sel->ready, r600_shader_precompile, NULL);
+		}
+	}
+
 	return sel;
 }
 
@@ -1073,7 +1163,16 @@ static void r600_bind_tes_state(struct pipe_context *ctx, void *state)
 void r600_delete_shader_selector(struct pipe_context *ctx,
 				 struct r600_pipe_shader_selector *sel)
 {
-	struct r600_pipe_shader *p = sel->current, *c;
+	struct r600_pipe_shader *p, *c;
+
+	util_queue_fence_wait(&sel->ready);
+	if (sel->precompiled) {
+		r600_pipe_shader_destroy(ctx, sel->precompiled);
+		FREE(sel->precompiled);
+	}
+	util_queue_fence_destroy(&sel->ready);
+
+	p = sel->current;
 	while (p) {
 		c = p->next_variant;
 		r600_pipe_shader_destroy(ctx, p);
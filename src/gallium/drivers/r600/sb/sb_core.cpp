@@ -88,6 +88,7 @@ void r600_sb_context_destroy(void * sctx) {
 }
 
 int r600_sb_bytecode_process(struct r600_context *rctx,
+                             void **sctx,
                              struct r600_bytecode *bc,
                              struct r600_shader *pshader,
                              int dump_bytecode,
@@ -95,9 +96,9 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 	int r = 0;
 	unsigned shader_id = bc->debug_id;
 
-	sb_context *ctx = (sb_context *)rctx->sb_context;
+	sb_context *ctx = (sb_context *)*sctx;
 	if (!ctx) {
-		rctx->sb_context = ctx = r600_sb_context_create(rctx);
+		*sctx = ctx = r600_sb_context_create(rctx);
 	}
 
 	int64_t time_start = 0;
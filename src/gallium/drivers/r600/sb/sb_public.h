@@ -38,6 +38,7 @@ struct r600_shader;
 void r600_sb_context_destroy(void *sctx);
 
 int r600_sb_bytecode_process(struct r600_context *rctx,
+                             void **sctx,
                              struct r600_bytecode *bc,
                              struct r600_shader *pshader,
                              int dump_source_bytecode,
@@ -1043,6 +1043,8 @@ static void ruvd_decode_bitstream(struct pipe_video_codec *decoder,
 				  const unsigned *sizes)
 {
 	struct ruvd_decoder *dec = (struct ruvd_decoder*)decoder;
+	struct rvid_buffer *buf = &dec->bs_buffers[dec->cur_buffer];
+	unsigned new_size = dec->bs_size;
 	unsigned i;
 
 	assert(decoder);
@@ -1050,26 +1052,28 @@ static void ruvd_decode_bitstream(struct pipe_video_codec *decoder,
 	if (!dec->bs_ptr)
 		return;
 
-	for (i = 0; i < num_buffers; ++i) {
-		struct rvid_buffer *buf = &dec->bs_buffers[dec->cur_buffer];
-		unsigned new_size = dec->bs_size + sizes[i];
-
-		if (new_size > buf->res->buf->size) {
-			dec->ws->buffer_unmap(buf->res->buf);
-			if (!si_vid_resize_buffer(dec->screen, dec->cs, buf, new_size)) {
-				RVID_ERR("Can't resize bitstream buffer!");
-				return;
-			}
+	/* the state tracker can hand over all the slices of a picture at
+	 * once, so grow the bitstream buffer a single time for all of them */
+	for (i = 0; i < num_buffers; ++i)
+		new_size += sizes[i];
 
-			dec->bs_ptr = dec->ws->buffer_map(
-				buf->res->buf, dec->cs,
-				PIPE_TRANSFER_WRITE | RADEON_TRANSFER_TEMPORARY);
-			if (!dec->bs_ptr)
-				return;
-
-			dec->bs_ptr += dec->bs_size;
+	if (new_size > buf->res->buf->size) {
+		dec->ws->buffer_unmap(buf->res->buf);
+		if (!si_vid_resize_buffer(dec->screen, dec->cs, buf, new_size)) {
+			RVID_ERR("Can't resize bitstream buffer!");
+			return;
 		}
 
+		dec->bs_ptr = dec->ws->buffer_map(
+			buf->res->buf, dec->cs,
+			PIPE_TRANSFER_WRITE | RADEON_TRANSFER_TEMPORARY);
+		if (!dec->bs_ptr)
+			return;
+
+		dec->bs_ptr += dec->bs_size;
+	}
+
+	for (i = 0; i < num_buffers; ++i) {
 		memcpy(dec->bs_ptr, buffers[i], sizes[i]);
 		dec->bs_size += sizes[i];
 		dec->bs_ptr += sizes[i];
@@ -125,6 +125,12 @@ enum radeon_value_id {
     RADEON_CURRENT_MCLK,
     RADEON_GPU_RESET_COUNTER, /* DRM 2.43.0 */
     RADEON_CS_THREAD_TIME,
+    RADEON_BO_CACHE_HITS,
+    RADEON_BO_CACHE_MISSES,
+    RADEON_BO_CACHE_EVICTIONS,
+    RADEON_SLAB_CACHE_HITS,
+    RADEON_SLAB_CACHE_MISSES,
+    RADEON_NUM_SLABS,
 };
 
 enum radeon_bo_priority {
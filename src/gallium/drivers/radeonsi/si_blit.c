@@ -592,6 +592,22 @@ si_decompress_image_color_textures(struct si_context *sctx,
 
 		tex = (struct si_texture *)view->resource;
 
+		if (tex->dcc_image_store_decompress &&
+		    view->access & PIPE_IMAGE_ACCESS_WRITE &&
+		    vi_dcc_enabled(tex, view->u.tex.level)) {
+			/* Image stores don't write DCC, so it must be
+			 * decompressed if rendering has compressed it.
+			 */
+			if (tex->dcc_image_store_dirty) {
+				si_decompress_dcc(sctx, tex);
+				tex->dcc_image_store_dirty = false;
+				tex->num_dcc_image_store_decompresses++;
+				sctx->num_dcc_image_store_decompresses++;
+			} else {
+				sctx->num_dcc_image_store_decompresses_skipped++;
+			}
+		}
+
 		si_decompress_color_texture(sctx, tex, view->u.tex.level,
 					    view->u.tex.level);
 	}
@@ -588,9 +588,23 @@ static void si_buffer_do_flush_region(struct pipe_context *ctx,
 			return;
 		}
 
-		/* Copy the staging buffer into the original one. */
-		si_copy_buffer(sctx, transfer->resource, &stransfer->staging->b.b,
-			       box->x, src_offset, box->width);
+		if (box->x % 4 == 0 && src_offset % 4 == 0 &&
+		    box->width % 4 == 0 &&
+		    si_use_sdma_upload(sctx, buf, box->width)) {
+			struct pipe_box src_box;
+
+			/* Copy with SDMA and submit it right away, so that it
+			 * executes while the gfx IB is being recorded.
+			 */
+			u_box_1d(src_offset, box->width, &src_box);
+			sctx->dma_copy(ctx, transfer->resource, 0, box->x, 0, 0,
+				       &stransfer->staging->b.b, 0, &src_box);
+			si_flush_dma_cs(sctx, PIPE_FLUSH_ASYNC, NULL);
+		} else {
+			/* Copy the staging buffer into the original one. */
+			si_copy_buffer(sctx, transfer->resource, &stransfer->staging->b.b,
+				       box->x, src_offset, box->width);
+		}
 	}
 
 	util_range_add(&buf->valid_buffer_range, box->x,
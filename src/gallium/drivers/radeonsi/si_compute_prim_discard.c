@@ -0,0 +1,381 @@
+/*
+ * Copyright 2018 Advanced Micro Devices, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/* The primitive discard prepass culls the triangles of large indexed draws
+ * before the draw, which helps triangle-heavy scenes where most triangles
+ * are outside of the viewport or back facing.
+ *
+ * 1. The clip space positions of the vertices are captured by drawing the
+ *    vertex range of the draw with a copy of the VS writing the position
+ *    to a streamout buffer, with the rasterizer discarding everything.
+ * 2. A compute shader culls the triangles against the x and y planes of
+ *    the clip volume and the face culling state, per chunk of
+ *    SI_PRIM_DISCARD_CHUNK_SIZE triangles.
+ * 3. Another one computes where each chunk goes in the compacted index
+ *    buffer, and the arguments of the indirect draw.
+ * 4. The last one copies the triangles kept to the compacted index buffer,
+ *    so that they stay in the original order.
+ * 5. The draw is executed with DRAW_INDEX_INDIRECT.
+ *
+ * Only draws whose result doesn't depend on the triangles culled, and
+ * whose vertices can be captured without side effects use it.
+ */
+
+#include "si_pipe.h"
+#include "util/u_upload_mgr.h"
+
+/* Smaller draws aren't worth the prepass. */
+#define SI_PRIM_DISCARD_MIN_TRIANGLES	1024
+
+static bool si_prim_discard_supported(struct si_context *sctx,
+				      const struct pipe_draw_info *info)
+{
+	struct si_shader_selector *vs = sctx->vs_shader.cso;
+	struct si_shader_selector *ps = sctx->ps_shader.cso;
+	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
+
+	if (info->mode != PIPE_PRIM_TRIANGLES ||
+	    !info->index_size ||
+	    info->indirect ||
+	    info->count_from_stream_output ||
+	    info->primitive_restart ||
+	    info->instance_count != 1 ||
+	    info->count / 3 < SI_PRIM_DISCARD_MIN_TRIANGLES)
+		return false;
+
+	/* The vertex range is captured, so it must be known and not larger
+	 * than the draw. */
+	if (info->max_index < info->min_index ||
+	    info->max_index - info->min_index >= info->count)
+		return false;
+
+	if (sctx->gs_shader.cso || sctx->tes_shader.cso ||
+	    sctx->streamout.num_targets ||
+	    sctx->streamout.num_prims_gen_queries ||
+	    rs->rasterizer_discard)
+		return false;
+
+	/* The VS runs once more for the vertex range, as a non-indexed draw. */
+	if (!vs->tokens ||
+	    !vs->info.writes_position ||
+	    vs->info.writes_memory ||
+	    vs->info.writes_viewport_index ||
+	    vs->info.uses_basevertex ||
+	    vs->info.uses_vertexid_nobase ||
+	    vs->info.uses_drawid ||
+	    vs->info.properties[TGSI_PROPERTY_VS_WINDOW_SPACE_POSITION])
+		return false;
+
+	/* Primitive IDs change with the compaction. */
+	if (ps && ps->info.uses_primid)
+		return false;
+
+	return true;
+}
+
+static struct si_shader_selector *
+si_get_prim_discard_pos_vs(struct si_context *sctx,
+			   struct si_shader_selector *vs)
+{
+	mtx_lock(&vs->mutex);
+	if (!vs->prim_discard_pos_vs) {
+		struct pipe_shader_state state = {};
+		unsigned i;
+
+		for (i = 0; i < vs->info.num_outputs; i++) {
+			if (vs->info.output_semantic_name[i] == TGSI_SEMANTIC_POSITION)
+				break;
+		}
+		assert(i < vs->info.num_outputs);
+
+		state.type = PIPE_SHADER_IR_TGSI;
+		state.tokens = vs->tokens;
+		state.stream_output.num_outputs = 1;
+		state.stream_output.stride[0] = 4;
+		state.stream_output.output[0].register_index = i;
+		state.stream_output.output[0].num_components = 4;
+
+		vs->prim_discard_pos_vs = sctx->b.create_vs_state(&sctx->b, &state);
+	}
+	mtx_unlock(&vs->mutex);
+
+	return vs->prim_discard_pos_vs;
+}
+
+static bool si_init_prim_discard_shaders(struct si_context *sctx)
+{
+	if (!sctx->prim_discard_rasterizer) {
+		struct pipe_rasterizer_state rs = {};
+
+		rs.rasterizer_discard = 1;
+		rs.half_pixel_center = 1;
+		sctx->prim_discard_rasterizer =
+			sctx->b.create_rasterizer_state(&sctx->b, &rs);
+	}
+	if (!sctx->cs_prim_discard_cull)
+		sctx->cs_prim_discard_cull = si_create_prim_discard_cull_cs(sctx);
+	if (!sctx->cs_prim_discard_scan)
+		sctx->cs_prim_discard_scan = si_create_prim_discard_scan_cs(sctx);
+	if (!sctx->cs_prim_discard_copy)
+		sctx->cs_prim_discard_copy = si_create_prim_discard_copy_cs(sctx);
+
+	return sctx->prim_discard_rasterizer &&
+	       sctx->cs_prim_discard_cull &&
+	       sctx->cs_prim_discard_scan &&
+	       sctx->cs_prim_discard_copy;
+}
+
+static void si_prim_discard_launch(struct si_context *sctx, void *cs,
+				   const void *constants, unsigned constants_size,
+				   struct pipe_shader_buffer *sb, unsigned num_sb,
+				   unsigned writable_bitmask,
+				   unsigned num_threads)
+{
+	struct pipe_context *ctx = &sctx->b;
+	struct pipe_constant_buffer cb = {};
+	struct pipe_grid_info info = {};
+
+	cb.buffer_size = constants_size;
+	cb.user_buffer = constants;
+	ctx->set_constant_buffer(ctx, PIPE_SHADER_COMPUTE, 0, &cb);
+	ctx->set_shader_buffers(ctx, PIPE_SHADER_COMPUTE, 0, num_sb, sb,
+				writable_bitmask);
+	ctx->bind_compute_state(ctx, cs);
+
+	info.block[0] = 64;
+	info.block[1] = 1;
+	info.block[2] = 1;
+	info.grid[0] = DIV_ROUND_UP(num_threads, 64);
+	info.grid[1] = 1;
+	info.grid[2] = 1;
+	ctx->launch_grid(ctx, &info);
+
+	sctx->flags |= SI_CONTEXT_CS_PARTIAL_FLUSH |
+		       si_get_flush_flags(sctx, SI_COHERENCY_SHADER, L2_LRU);
+}
+
+static void si_set_sub_buffer(struct pipe_shader_buffer *sb,
+			      struct pipe_resource *buf,
+			      unsigned offset, unsigned size)
+{
+	sb->buffer = buf;
+	sb->buffer_offset = offset;
+	sb->buffer_size = size;
+}
+
+/* Execute info with the primitive discard prepass.
+ * \return false if the draw doesn't support it and wasn't executed
+ */
+bool si_prim_discard_draw(struct si_context *sctx,
+			  const struct pipe_draw_info *info)
+{
+	struct pipe_context *ctx = &sctx->b;
+	struct si_shader_selector *vs = sctx->vs_shader.cso;
+	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
+	struct si_shader_selector *pos_vs;
+
+	if (!si_prim_discard_supported(sctx, info) ||
+	    !si_init_prim_discard_shaders(sctx))
+		return false;
+
+	pos_vs = si_get_prim_discard_pos_vs(sctx, vs);
+	if (!pos_vs)
+		return false;
+
+	unsigned num_triangles = info->count / 3;
+	unsigned num_vertices = info->max_index - info->min_index + 1;
+	unsigned num_chunks = DIV_ROUND_UP(num_triangles,
+					   SI_PRIM_DISCARD_CHUNK_SIZE);
+
+	/* Everything the prepass writes is in one buffer. */
+	unsigned pos_size = num_vertices * 16;
+	unsigned chunk_size = num_chunks * SI_PRIM_DISCARD_CHUNK_SIZE * 12;
+	unsigned count_size = num_chunks * 4;
+	unsigned index_size = num_triangles * 12;
+	unsigned pos_offset = 0;
+	unsigned chunk_offset = pos_offset + align(pos_size, 256);
+	unsigned count_offset = chunk_offset + align(chunk_size, 256);
+	unsigned offsets_offset = count_offset + align(count_size, 256);
+	unsigned index_offset = offsets_offset + align(count_size, 256);
+	unsigned args_offset = index_offset + align(index_size, 256);
+
+	struct pipe_resource *buf =
+		pipe_buffer_create(ctx->screen, 0, PIPE_USAGE_DEFAULT,
+				   args_offset + 20);
+	if (!buf)
+		return false;
+
+	struct pipe_resource *indexbuf = NULL;
+	unsigned indexbuf_offset;
+
+	if (info->has_user_indices) {
+		u_upload_data(ctx->stream_uploader, 0,
+			      info->count * info->index_size,
+			      sctx->screen->info.tcc_cache_line_size,
+			      (char*)info->index.user +
+			      info->start * info->index_size,
+			      &indexbuf_offset, &indexbuf);
+		if (!indexbuf) {
+			pipe_resource_reference(&buf, NULL);
+			return false;
+		}
+	} else {
+		pipe_resource_reference(&indexbuf, info->index.resource);
+		indexbuf_offset = info->start * info->index_size;
+	}
+
+	/* Internal work, which must not be counted by queries or skipped by
+	 * the render condition. */
+	si_compute_internal_begin(sctx);
+
+	/* Capture the positions. */
+	struct pipe_stream_output_target *target =
+		ctx->create_stream_output_target(ctx, buf, pos_offset, pos_size);
+	unsigned target_offset = 0;
+	struct pipe_draw_info pos_draw = {};
+
+	pos_draw.mode = PIPE_PRIM_POINTS;
+	pos_draw.start = info->min_index + info->index_bias;
+	pos_draw.count = num_vertices;
+	pos_draw.instance_count = 1;
+	pos_draw.start_instance = info->start_instance;
+	pos_draw.min_index = pos_draw.start;
+	pos_draw.max_index = pos_draw.start + num_vertices - 1;
+
+	ctx->bind_vs_state(ctx, pos_vs);
+	ctx->bind_rasterizer_state(ctx, sctx->prim_discard_rasterizer);
+	ctx->set_stream_output_targets(ctx, 1, &target, &target_offset);
+	ctx->draw_vbo(ctx, &pos_draw);
+	ctx->set_stream_output_targets(ctx, 0, NULL, NULL);
+	ctx->bind_rasterizer_state(ctx, rs);
+	ctx->bind_vs_state(ctx, vs);
+	pipe_so_target_reference(&target, NULL);
+
+	/* Save states. */
+	void *saved_cs = sctx->cs_shader_state.program;
+	struct pipe_constant_buffer saved_cb = {};
+	struct pipe_shader_buffer saved_sb[4] = {};
+	unsigned saved_writable_mask = 0;
+
+	si_get_pipe_constant_buffer(sctx, PIPE_SHADER_COMPUTE, 0, &saved_cb);
+	si_get_shader_buffers(sctx, PIPE_SHADER_COMPUTE, 0, 4, saved_sb);
+	for (unsigned i = 0; i < 4; i++) {
+		if (sctx->const_and_shader_buffers[PIPE_SHADER_COMPUTE].writable_mask &
+		    (1u << si_get_shaderbuf_slot(i)))
+			saved_writable_mask |= 1 << i;
+	}
+
+	sctx->flags |= SI_CONTEXT_CS_PARTIAL_FLUSH |
+		       si_get_flush_flags(sctx, SI_COHERENCY_SHADER, L2_LRU);
+
+	/* Cull. */
+	struct pipe_viewport_state *vp = &sctx->viewports.states[0];
+	union {
+		uint32_t u;
+		float f;
+	} cull_constants[12];
+	struct pipe_shader_buffer sb[4] = {};
+
+	cull_constants[0].u = num_triangles;
+	cull_constants[1].u = indexbuf_offset;
+	cull_constants[2].u = info->index_size;
+	cull_constants[3].u = u_bit_consecutive(0, info->index_size * 8);
+	cull_constants[4].u = info->min_index;
+	cull_constants[5].u = num_vertices;
+	cull_constants[6].u = num_chunks;
+	/* The face is determined in window space. */
+	cull_constants[7].f = vp->scale[0] * vp->scale[1] < 0 ? -1 : 1;
+	cull_constants[8].u = rs->cull_front ? ~0u : 0;
+	cull_constants[9].u = rs->cull_back ? ~0u : 0;
+	cull_constants[10].u = rs->front_ccw ? ~0u : 0;
+	cull_constants[11].u = 0;
+
+	si_set_sub_buffer(&sb[0], indexbuf, 0, indexbuf->width0);
+	si_set_sub_buffer(&sb[1], buf, pos_offset, pos_size);
+	si_set_sub_buffer(&sb[2], buf, chunk_offset, chunk_size);
+	si_set_sub_buffer(&sb[3], buf, count_offset, count_size);
+	si_prim_discard_launch(sctx, sctx->cs_prim_discard_cull,
+			       cull_constants, sizeof(cull_constants),
+			       sb, 4, 0xc, num_chunks);
+
+	/* Compute the chunk offsets and the draw arguments. */
+	uint32_t scan_constants[8] = {
+		num_chunks, index_offset / 4, info->index_bias,
+		info->start_instance, DIV_ROUND_UP(num_chunks, 64),
+	};
+
+	si_set_sub_buffer(&sb[0], buf, count_offset, count_size);
+	si_set_sub_buffer(&sb[1], buf, offsets_offset, count_size);
+	si_set_sub_buffer(&sb[2], buf, args_offset, 20);
+	si_prim_discard_launch(sctx, sctx->cs_prim_discard_scan,
+			       scan_constants, sizeof(scan_constants),
+			       sb, 3, 0x6, 64);
+
+	/* Compact. */
+	uint32_t copy_constants[4] = { num_chunks };
+
+	si_set_sub_buffer(&sb[0], buf, chunk_offset, chunk_size);
+	si_set_sub_buffer(&sb[1], buf, count_offset, count_size);
+	si_set_sub_buffer(&sb[2], buf, offsets_offset, count_size);
+	si_set_sub_buffer(&sb[3], buf, index_offset, index_size);
+	si_prim_discard_launch(sctx, sctx->cs_prim_discard_copy,
+			       copy_constants, sizeof(copy_constants),
+			       sb, 4, 0x8, num_chunks);
+
+	/* The index buffer and the draw arguments are read by the CP and
+	 * the VGT, which don't use L2 on older chips. */
+	sctx->flags |= SI_CONTEXT_CS_PARTIAL_FLUSH |
+		       (sctx->chip_class <= VI ? SI_CONTEXT_WRITEBACK_GLOBAL_L2 : 0);
+
+	/* Restore states. */
+	ctx->bind_compute_state(ctx, saved_cs);
+	ctx->set_shader_buffers(ctx, PIPE_SHADER_COMPUTE, 0, 4, saved_sb,
+				saved_writable_mask);
+	ctx->set_constant_buffer(ctx, PIPE_SHADER_COMPUTE, 0, &saved_cb);
+	for (unsigned i = 0; i < 4; i++)
+		pipe_resource_reference(&saved_sb[i].buffer, NULL);
+	pipe_resource_reference(&saved_cb.buffer, NULL);
+	si_compute_internal_end(sctx);
+
+	/* Draw the triangles kept. */
+	struct pipe_draw_indirect_info indirect = {};
+	struct pipe_draw_info draw = *info;
+
+	indirect.buffer = buf;
+	indirect.offset = args_offset;
+	indirect.draw_count = 1;
+
+	draw.index_size = 4;
+	draw.has_user_indices = false;
+	draw.index.resource = buf;
+	draw.start = 0;
+	draw.count = num_triangles * 3;
+	draw.indirect = &indirect;
+	ctx->draw_vbo(ctx, &draw);
+
+	pipe_resource_reference(&indexbuf, NULL);
+	pipe_resource_reference(&buf, NULL);
+	return true;
+}
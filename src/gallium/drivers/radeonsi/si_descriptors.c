@@ -136,6 +136,7 @@ static void si_release_descriptors(struct si_descriptors *desc)
 {
 	si_resource_reference(&desc->buffer, NULL);
 	FREE(desc->list);
+	FREE(desc->heap_indices);
 }
 
 static bool si_upload_descriptors(struct si_context *sctx,
@@ -481,6 +482,18 @@ static bool color_needs_decompression(struct si_texture *tex)
 		(tex->cmask_buffer || tex->dcc_offset));
 }
 
+/* Writable images keeping DCC are checked before every use, see
+ * si_texture_keep_dcc_for_image_stores.
+ */
+static bool image_color_needs_decompression(struct si_texture *tex,
+					    const struct pipe_image_view *view)
+{
+	return color_needs_decompression(tex) ||
+	       (tex->dcc_image_store_decompress &&
+		view->access & PIPE_IMAGE_ACCESS_WRITE &&
+		vi_dcc_enabled(tex, view->u.tex.level));
+}
+
 static bool depth_needs_decompression(struct si_texture *tex)
 {
 	/* If the depth/stencil texture is TC-compatible, no decompression
@@ -787,6 +800,16 @@ static void si_set_shader_image(struct si_context *ctx,
 	if (&images->views[slot] != view)
 		util_copy_image_view(&images->views[slot], view);
 
+	/* Decompress DCC before each use instead of disabling it. */
+	if (!skip_decompress &&
+	    res->b.b.target != PIPE_BUFFER &&
+	    !(view->shader_access & SI_IMAGE_ACCESS_AS_BUFFER) &&
+	    view->access & PIPE_IMAGE_ACCESS_WRITE &&
+	    vi_dcc_enabled((struct si_texture *)res, view->u.tex.level) &&
+	    vi_dcc_formats_compatible(res->b.b.format, view->format) &&
+	    si_texture_keep_dcc_for_image_stores(ctx, (struct si_texture *)res))
+		skip_decompress = true;
+
 	si_set_shader_image_desc(ctx, view, skip_decompress, desc, NULL);
 
 	if (res->b.b.target == PIPE_BUFFER ||
@@ -797,7 +820,7 @@ static void si_set_shader_image(struct si_context *ctx,
 		struct si_texture *tex = (struct si_texture *)res;
 		unsigned level = view->u.tex.level;
 
-		if (color_needs_decompression(tex)) {
+		if (image_color_needs_decompression(tex, view)) {
 			images->needs_color_decompress_mask |= 1 << slot;
 		} else {
 			images->needs_color_decompress_mask &= ~(1 << slot);
@@ -857,7 +880,7 @@ si_images_update_needs_color_decompress_mask(struct si_images *images)
 		if (res && res->target != PIPE_BUFFER) {
 			struct si_texture *tex = (struct si_texture *)res;
 
-			if (color_needs_decompression(tex)) {
+			if (image_color_needs_decompression(tex, &images->views[i])) {
 				images->needs_color_decompress_mask |= 1 << i;
 			} else {
 				images->needs_color_decompress_mask &= ~(1 << i);
@@ -1284,6 +1307,33 @@ static void si_pipe_set_constant_buffer(struct pipe_context *ctx,
 	if (input && input->buffer)
 		si_resource(input->buffer)->bind_history |= PIPE_BIND_CONSTANT_BUFFER;
 
+	/* The culling GS owns GS constant buffer 0 while it's bound. Keep
+	 * the buffer of the application for when it's unbound. */
+	if (shader == PIPE_SHADER_GEOMETRY && slot == 0 &&
+	    sctx->gs_shader.cso && sctx->gs_shader.cso->is_cull_gs) {
+		struct pipe_constant_buffer *saved =
+			&sctx->cull_gs_saved_const_buffer;
+
+		pipe_resource_reference(&saved->buffer, NULL);
+		saved->buffer_offset = 0;
+		saved->buffer_size = 0;
+
+		if (input && input->user_buffer) {
+			si_upload_const_buffer(sctx,
+					       (struct si_resource**)&saved->buffer,
+					       input->user_buffer,
+					       input->buffer_size,
+					       &saved->buffer_offset);
+			if (saved->buffer)
+				saved->buffer_size = input->buffer_size;
+		} else if (input && input->buffer) {
+			pipe_resource_reference(&saved->buffer, input->buffer);
+			saved->buffer_offset = input->buffer_offset;
+			saved->buffer_size = input->buffer_size;
+		}
+		return;
+	}
+
 	slot = si_get_constbuf_slot(slot);
 	si_set_constant_buffer(sctx, &sctx->const_and_shader_buffers[shader],
 			       si_const_and_shader_buffer_descriptors_idx(shader),
@@ -1301,6 +1351,39 @@ void si_get_pipe_constant_buffer(struct si_context *sctx, uint shader,
 		&cbuf->buffer, &cbuf->buffer_offset, &cbuf->buffer_size);
 }
 
+/* Save GS constant buffer 0 of the application when the culling GS is
+ * bound, and restore it when it's unbound.
+ */
+void si_swap_cull_gs_const_buffer(struct si_context *sctx, bool bind)
+{
+	struct pipe_constant_buffer *saved = &sctx->cull_gs_saved_const_buffer;
+
+	if (bind) {
+		memset(saved, 0, sizeof(*saved));
+		si_get_pipe_constant_buffer(sctx, PIPE_SHADER_GEOMETRY, 0, saved);
+		sctx->cull_gs_constants_valid = false;
+	} else {
+		si_set_constant_buffer(sctx,
+				       &sctx->const_and_shader_buffers[PIPE_SHADER_GEOMETRY],
+				       si_const_and_shader_buffer_descriptors_idx(PIPE_SHADER_GEOMETRY),
+				       si_get_constbuf_slot(0), saved);
+		pipe_resource_reference(&saved->buffer, NULL);
+	}
+}
+
+void si_set_cull_gs_constants(struct si_context *sctx, const void *data,
+			      unsigned size)
+{
+	struct pipe_constant_buffer cb = {};
+
+	cb.user_buffer = data;
+	cb.buffer_size = size;
+	si_set_constant_buffer(sctx,
+			       &sctx->const_and_shader_buffers[PIPE_SHADER_GEOMETRY],
+			       si_const_and_shader_buffer_descriptors_idx(PIPE_SHADER_GEOMETRY),
+			       si_get_constbuf_slot(0), &cb);
+}
+
 /* SHADER BUFFERS */
 
 static void si_set_shader_buffer(struct si_context *sctx,
@@ -2238,8 +2321,16 @@ static void si_init_bindless_descriptors(struct si_context *sctx,
 	assert(desc_slot == 0);
 }
 
+static void si_desc_heap_delete_key(struct hash_entry *entry)
+{
+	FREE((void*)entry->key);
+}
+
 static void si_release_bindless_descriptors(struct si_context *sctx)
 {
+	if (sctx->desc_heap)
+		_mesa_hash_table_destroy(sctx->desc_heap, si_desc_heap_delete_key);
+
 	si_release_descriptors(&sctx->bindless_descriptors);
 	util_idalloc_fini(&sctx->bindless_used_slots);
 }
@@ -2265,6 +2356,176 @@ static unsigned si_get_first_free_bindless_slot(struct si_context *sctx)
 	return desc_slot;
 }
 
+/* DESCRIPTOR HEAP
+ *
+ * With R600_DEBUG=descheap, the descriptors of bound sampler views and
+ * images are stored in bindless slots, where they are deduplicated by
+ * content and never modified. The samplers_and_images list of each stage
+ * then only contains one heap slot index per 8-dword unit, so a state change
+ * uploads 4 bytes per sampler instead of 64, and shaders load the descriptor
+ * through the bindless pointer.
+ *
+ * The CPU lists are still filled as before and resolved to heap slots when
+ * they are uploaded. New heap entries are uploaded together with
+ * a copy of the whole bindless array, like new bindless handles.
+ */
+
+/* The maximum number of heap entries before the heap is cleared. */
+#define SI_DESC_HEAP_MAX_ENTRIES	16384
+/* The maximum number of heap entries one upload can add. */
+#define SI_DESC_HEAP_MAX_NEW_ENTRIES	(SI_NUM_SHADERS * \
+					 (SI_NUM_IMAGES + SI_NUM_SAMPLERS))
+
+static uint32_t si_desc_heap_hash(const void *key)
+{
+	return _mesa_hash_data(key, 16 * 4);
+}
+
+static bool si_desc_heap_equals(const void *a, const void *b)
+{
+	return !memcmp(a, b, 16 * 4);
+}
+
+static void si_init_desc_heap(struct si_context *sctx)
+{
+	unsigned num_units = (SI_NUM_IMAGES / 2 + SI_NUM_SAMPLERS) * 2;
+
+	sctx->desc_heap = _mesa_hash_table_create(NULL, si_desc_heap_hash,
+						  si_desc_heap_equals);
+
+	for (unsigned i = 0; i < SI_NUM_SHADERS; i++) {
+		struct si_descriptors *desc =
+			si_sampler_and_image_descriptors(sctx, i);
+
+		/* Slot 0 is never allocated and stays zeroed, so it's a valid
+		 * initial value for all units.
+		 */
+		if (desc->list)
+			desc->heap_indices = CALLOC(num_units, 4);
+	}
+}
+
+/* Free all heap entries. This is safe for draws in flight, because they use
+ * older copies of the bindless array.
+ */
+static void si_reset_desc_heap(struct si_context *sctx)
+{
+	unsigned num_units = (SI_NUM_IMAGES / 2 + SI_NUM_SAMPLERS) * 2;
+
+	hash_table_foreach(sctx->desc_heap, entry) {
+		util_idalloc_free(&sctx->bindless_used_slots,
+				  (uintptr_t)entry->data);
+	}
+	_mesa_hash_table_clear(sctx->desc_heap, si_desc_heap_delete_key);
+	sctx->num_desc_heap_entries = 0;
+
+	/* Resolve all lists again. */
+	for (unsigned i = 0; i < SI_NUM_SHADERS; i++) {
+		struct si_descriptors *desc =
+			si_sampler_and_image_descriptors(sctx, i);
+
+		if (desc->heap_indices) {
+			memset(desc->heap_indices, 0, num_units * 4);
+			sctx->descriptors_dirty |=
+				1u << si_sampler_and_image_descriptors_idx(i);
+		}
+	}
+}
+
+/* Return the heap slot holding \p desc_list, adding it if needed.
+ * \p cached_slot is the slot the descriptor had at the last upload.
+ */
+static unsigned si_get_desc_heap_slot(struct si_context *sctx,
+				      const uint32_t *desc_list,
+				      unsigned num_dwords,
+				      unsigned cached_slot)
+{
+	struct si_descriptors *heap = &sctx->bindless_descriptors;
+	uint32_t key[16] = {};
+	struct hash_entry *entry;
+	unsigned desc_slot;
+	uint32_t hash;
+
+	memcpy(key, desc_list, num_dwords * 4);
+
+	/* This is the common case: the descriptor hasn't changed. */
+	if (!memcmp(heap->list + cached_slot * 16, key, sizeof(key)))
+		return cached_slot;
+
+	hash = _mesa_hash_data(key, sizeof(key));
+	entry = _mesa_hash_table_search_pre_hashed(sctx->desc_heap, hash, key);
+	if (entry)
+		return (uintptr_t)entry->data;
+
+	desc_slot = si_get_first_free_bindless_slot(sctx);
+	memcpy(heap->list + desc_slot * 16, key, sizeof(key));
+
+	uint32_t *new_key = MALLOC(sizeof(key));
+	memcpy(new_key, key, sizeof(key));
+	_mesa_hash_table_insert_pre_hashed(sctx->desc_heap, hash, new_key,
+					   (void*)(uintptr_t)desc_slot);
+
+	sctx->num_desc_heap_entries++;
+	sctx->desc_heap_dirty = true;
+	return desc_slot;
+}
+
+/* The descriptor heap version of si_upload_descriptors for
+ * samplers_and_images lists.
+ */
+static bool si_upload_desc_heap_indices(struct si_context *sctx,
+					struct si_descriptors *desc)
+{
+	unsigned first_unit = desc->first_active_slot * 2;
+	unsigned num_units = desc->num_active_slots * 2;
+	unsigned first_unit_offset = first_unit * 4;
+	unsigned upload_size = num_units * 4;
+
+	if (!upload_size)
+		return true;
+
+	for (unsigned i = first_unit; i < first_unit + num_units; i++) {
+		/* Images use one unit. Samplers use two, but only the index
+		 * of the first one is read.
+		 */
+		if (i < SI_NUM_IMAGES) {
+			desc->heap_indices[i] =
+				si_get_desc_heap_slot(sctx, desc->list + i * 8, 8,
+						      desc->heap_indices[i]);
+		} else if (!((i - SI_NUM_IMAGES) % 2)) {
+			desc->heap_indices[i] =
+				si_get_desc_heap_slot(sctx, desc->list + i * 8, 16,
+						      desc->heap_indices[i]);
+		}
+	}
+
+	uint32_t *ptr;
+	unsigned buffer_offset;
+	u_upload_alloc(sctx->b.const_uploader, first_unit_offset, upload_size,
+		       si_optimal_tcc_alignment(sctx, upload_size),
+		       &buffer_offset, (struct pipe_resource**)&desc->buffer,
+		       (void**)&ptr);
+	if (!desc->buffer) {
+		desc->gpu_address = 0;
+		return false; /* skip the draw call */
+	}
+
+	util_memcpy_cpu_to_le32(ptr, desc->heap_indices + first_unit,
+				upload_size);
+	/* The uploaded list doesn't contain descriptors. */
+	desc->gpu_list = NULL;
+
+	radeon_add_to_buffer_list(sctx, sctx->gfx_cs, desc->buffer,
+                            RADEON_USAGE_READ, RADEON_PRIO_DESCRIPTORS);
+
+	/* The shader pointer should point to unit 0. */
+	buffer_offset -= first_unit_offset;
+	desc->gpu_address = desc->buffer->gpu_address + buffer_offset;
+
+	si_mark_atom_dirty(sctx, &sctx->atoms.s.shader_pointers);
+	return true;
+}
+
 static unsigned
 si_create_bindless_descriptor(struct si_context *sctx, uint32_t *desc_list,
 			      unsigned size)
@@ -2722,6 +2983,9 @@ void si_init_all_descriptors(struct si_context *sctx)
 				     SI_SGPR_BINDLESS_SAMPLERS_AND_IMAGES,
 				     1024);
 
+	if (sctx->screen->debug_flags & DBG(DESC_HEAP))
+		si_init_desc_heap(sctx);
+
 	sctx->descriptors_dirty = u_bit_consecutive(0, SI_NUM_DESCS);
 
 	/* Set pipe_context functions. */
@@ -2764,6 +3028,14 @@ void si_init_all_descriptors(struct si_context *sctx)
 
 static bool si_upload_shader_descriptors(struct si_context *sctx, unsigned mask)
 {
+	/* Clear the heap before the uploads below, so that none of them
+	 * can refer to freed slots.
+	 */
+	if (sctx->desc_heap &&
+	    sctx->num_desc_heap_entries + SI_DESC_HEAP_MAX_NEW_ENTRIES >
+	    SI_DESC_HEAP_MAX_ENTRIES)
+		si_reset_desc_heap(sctx);
+
 	unsigned dirty = sctx->descriptors_dirty & mask;
 
 	/* Assume nothing will go wrong: */
@@ -2771,9 +3043,24 @@ static bool si_upload_shader_descriptors(struct si_context *sctx, unsigned mask)
 
 	while (dirty) {
 		unsigned i = u_bit_scan(&dirty);
+		struct si_descriptors *desc = &sctx->descriptors[i];
 
-		if (!si_upload_descriptors(sctx, &sctx->descriptors[i]))
+		if (desc->heap_indices) {
+			if (!si_upload_desc_heap_indices(sctx, desc))
+				return false;
+		} else if (!si_upload_descriptors(sctx, desc)) {
 			return false;
+		}
+	}
+
+	if (sctx->desc_heap_dirty) {
+		/* Re-upload the whole array with the new heap entries. */
+		if (!si_upload_descriptors(sctx, &sctx->bindless_descriptors))
+			return false;
+
+		sctx->graphics_bindless_pointer_dirty = true;
+		sctx->compute_bindless_pointer_dirty = true;
+		sctx->desc_heap_dirty = false;
 	}
 
 	sctx->descriptors_dirty &= ~mask;
@@ -227,6 +227,22 @@ void si_flush_dma_cs(struct si_context *ctx, unsigned flags,
 	}
 }
 
+/* Whether a staging upload of \p size bytes into \p dst should be copied
+ * with SDMA, so that it doesn't take gfx ring time. The gfx IB must not use
+ * \p dst yet, because SDMA would have to wait for it to be flushed.
+ * Later gfx IBs wait for the copy through the buffer fences.
+ */
+bool si_use_sdma_upload(struct si_context *ctx, struct si_resource *dst,
+			uint64_t size)
+{
+	return ctx->dma_cs &&
+	       ctx->screen->info.has_dedicated_vram &&
+	       size >= SI_SDMA_UPLOAD_MIN_SIZE &&
+	       !(dst->flags & RADEON_FLAG_SPARSE) &&
+	       !ctx->ws->cs_is_buffer_referenced(ctx->gfx_cs, dst->buf,
+						 RADEON_USAGE_READWRITE);
+}
+
 void si_screen_clear_buffer(struct si_screen *sscreen, struct pipe_resource *dst,
 			    uint64_t offset, uint64_t size, unsigned value)
 {
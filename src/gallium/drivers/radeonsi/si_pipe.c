@@ -59,6 +59,8 @@ static const struct debug_named_value debug_options[] = {
 	{ "unsafemath", DBG(UNSAFE_MATH), "Enable unsafe math shader optimizations" },
 	{ "sisched", DBG(SI_SCHED), "Enable LLVM SI Machine Instruction Scheduler." },
 	{ "gisel", DBG(GISEL), "Enable LLVM global instruction selector." },
+	{ "fastcompile", DBG(FAST_COMPILE), "Compile shader main parts with less optimizations, and optimized variants asynchronously." },
+	{ "descheap", DBG(DESC_HEAP), "Upload indices into a heap of deduplicated sampler and image descriptors instead of the descriptors." },
 
 	/* Shader compiler options (with no effect on the shader cache): */
 	{ "checkir", DBG(CHECK_IR), "Enable additional sanity checks on shader IR" },
@@ -95,6 +97,8 @@ static const struct debug_named_value debug_options[] = {
 	{ "nodccfb", DBG(NO_DCC_FB), "Disable separate DCC on the main framebuffer" },
 	{ "nodccmsaa", DBG(NO_DCC_MSAA), "Disable DCC for MSAA" },
 	{ "nofmask", DBG(NO_FMASK), "Disable MSAA compression" },
+	{ "primdiscard", DBG(PRIM_DISCARD), "Cull and compact large indexed triangle draws with a compute prepass." },
+	{ "cullgs", DBG(CULL_GS), "Cull triangles in a geometry shader merged with the VS on GFX9+." },
 
 	/* Tests: */
 	{ "testdma", DBG(TEST_DMA), "Invoke SDMA tests and exit." },
@@ -113,9 +117,10 @@ static void si_init_compiler(struct si_screen *sscreen,
 			     struct ac_llvm_compiler *compiler)
 {
 	/* Only create the less-optimizing version of the compiler on APUs
-	 * predating Ryzen (Raven). */
-	bool create_low_opt_compiler = !sscreen->info.has_dedicated_vram &&
-				       sscreen->info.chip_class <= VI;
+	 * predating Ryzen (Raven), or for fast compilation. */
+	bool create_low_opt_compiler = (!sscreen->info.has_dedicated_vram &&
+					sscreen->info.chip_class <= VI) ||
+				       sscreen->debug_flags & DBG(FAST_COMPILE);
 
 	enum ac_target_machine_options tm_options =
 		(sscreen->debug_flags & DBG(SI_SCHED) ? AC_TM_SISCHED : 0) |
@@ -214,6 +219,15 @@ static void si_destroy_context(struct pipe_context *context)
 		sctx->b.delete_compute_state(&sctx->b, sctx->cs_clear_render_target_1d_array);
 	if (sctx->cs_dcc_retile)
 		sctx->b.delete_compute_state(&sctx->b, sctx->cs_dcc_retile);
+	if (sctx->cs_prim_discard_cull)
+		sctx->b.delete_compute_state(&sctx->b, sctx->cs_prim_discard_cull);
+	if (sctx->cs_prim_discard_scan)
+		sctx->b.delete_compute_state(&sctx->b, sctx->cs_prim_discard_scan);
+	if (sctx->cs_prim_discard_copy)
+		sctx->b.delete_compute_state(&sctx->b, sctx->cs_prim_discard_copy);
+	if (sctx->prim_discard_rasterizer)
+		sctx->b.delete_rasterizer_state(&sctx->b, sctx->prim_discard_rasterizer);
+	pipe_resource_reference(&sctx->cull_gs_saved_const_buffer.buffer, NULL);
 
 	if (sctx->blitter)
 		util_blitter_destroy(sctx->blitter);
@@ -444,6 +458,9 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 	if (!sctx->b.stream_uploader)
 		goto fail;
 
+	/* Deferred flushes don't submit, so recycling the buffers is cheap. */
+	u_upload_enable_ring(sctx->b.stream_uploader, 4);
+
 	sctx->cached_gtt_allocator = u_upload_create(&sctx->b, 16 * 1024,
 						       0, PIPE_USAGE_STAGING, 0);
 	if (!sctx->cached_gtt_allocator)
@@ -846,6 +863,8 @@ static void si_disk_cache_create(struct si_screen *sscreen)
 	#define ALL_FLAGS (DBG(FS_CORRECT_DERIVS_AFTER_KILL) |	\
 			   DBG(SI_SCHED) |			\
 			   DBG(GISEL) |				\
+			   DBG(FAST_COMPILE) |			\
+			   DBG(DESC_HEAP) |			\
 			   DBG(UNSAFE_MATH))
 	uint64_t shader_debug_flags = sscreen->debug_flags &
 		ALL_FLAGS;
@@ -100,6 +100,8 @@
 #define SI_MAX_VIEWPORTS		16
 #define SIX_BITS			0x3F
 #define SI_MAP_BUFFER_ALIGNMENT		64
+/* Staging uploads from this size can be done with SDMA. */
+#define SI_SDMA_UPLOAD_MIN_SIZE		(128 * 1024)
 #define SI_MAX_VARIABLE_THREADS_PER_BLOCK 1024
 
 #define SI_RESOURCE_FLAG_TRANSFER	(PIPE_RESOURCE_FLAG_DRV_PRIV << 0)
@@ -144,6 +146,8 @@ enum {
 	DBG_UNSAFE_MATH,
 	DBG_SI_SCHED,
 	DBG_GISEL,
+	DBG_FAST_COMPILE,
+	DBG_DESC_HEAP,
 
 	/* Shader compiler options (with no effect on the shader cache): */
 	DBG_CHECK_IR,
@@ -180,6 +184,8 @@ enum {
 	DBG_NO_DCC_FB,
 	DBG_NO_DCC_MSAA,
 	DBG_NO_FMASK,
+	DBG_PRIM_DISCARD,
+	DBG_CULL_GS,
 
 	/* Tests: */
 	DBG_TEST_DMA,
@@ -322,6 +328,13 @@ struct si_texture {
 	bool				separate_dcc_dirty:1;
 	/* Statistics gathering for the DCC enablement heuristic. */
 	bool				dcc_gather_statistics:1;
+	/* Image stores can't write DCC. If this is set, DCC is kept for
+	 * writable image bindings and decompressed before they are used,
+	 * instead of being disabled. See si_texture_keep_dcc_for_image_stores.
+	 */
+	bool				dcc_image_store_decompress:1;
+	/* Rendering may have compressed DCC since the last decompression. */
+	bool				dcc_image_store_dirty:1;
 	/* Counter that should be non-zero if the texture is bound to a
 	 * framebuffer.
 	 */
@@ -342,6 +355,10 @@ struct si_texture {
 	 * inaccurate (we need to count CB updates, not PS invocations).
 	 */
 	unsigned			ps_draw_ratio;
+	/* Framebuffer bindings and DCC decompressions since
+	 * dcc_image_store_decompress was set. */
+	unsigned			num_dcc_image_store_fb_binds;
+	unsigned			num_dcc_image_store_decompresses;
 	/* The number of clears since the last DCC usage analysis. */
 	unsigned			num_slow_clears;
 };
@@ -835,6 +852,10 @@ struct si_context {
 	void				*cs_clear_render_target;
 	void				*cs_clear_render_target_1d_array;
 	void				*cs_dcc_retile;
+	void				*cs_prim_discard_cull;
+	void				*cs_prim_discard_scan;
+	void				*cs_prim_discard_copy;
+	void				*prim_discard_rasterizer;
 	struct si_screen		*screen;
 	struct pipe_debug_callback	debug;
 	struct ac_llvm_compiler		compiler; /* only non-threaded compilation */
@@ -945,6 +966,12 @@ struct si_context {
 	bool				ps_uses_fbfetch;
 	bool				smoothing_enabled;
 
+	/* Culling GS state. GS constant buffer 0 of the application is
+	 * saved while the culling GS is bound. */
+	struct pipe_constant_buffer	cull_gs_saved_const_buffer;
+	uint32_t			cull_gs_constants[12];
+	bool				cull_gs_constants_valid;
+
 	/* DB render state. */
 	unsigned		ps_db_shader_control;
 	unsigned		dbcb_copy_sample;
@@ -1020,6 +1047,13 @@ struct si_context {
 	bool			graphics_bindless_pointer_dirty;
 	bool			compute_bindless_pointer_dirty;
 
+	/* Descriptor heap (R600_DEBUG=descheap): descriptors of bound sampler
+	 * views and images are deduplicated into bindless slots, and only
+	 * their slot indices are uploaded per draw. */
+	struct hash_table	*desc_heap;
+	unsigned		num_desc_heap_entries;
+	bool			desc_heap_dirty;
+
 	/* Allocated bindless handles */
 	struct hash_table	*tex_handles;
 	struct hash_table	*img_handles;
@@ -1066,6 +1100,9 @@ struct si_context {
 	unsigned			num_db_cache_flushes;
 	unsigned			num_L2_invalidates;
 	unsigned			num_L2_writebacks;
+	unsigned			num_dcc_disables;
+	unsigned			num_dcc_image_store_decompresses;
+	unsigned			num_dcc_image_store_decompresses_skipped;
 	unsigned			num_resident_handles;
 	uint64_t			num_alloc_tex_transfer_bytes;
 	unsigned			last_tex_ps_draw_ratio; /* for query */
@@ -1209,6 +1246,8 @@ void si_compute_clear_render_target(struct pipe_context *ctx,
 				    bool render_condition_enabled);
 void si_retile_dcc(struct si_context *sctx, struct si_texture *tex);
 void si_init_compute_blit_functions(struct si_context *sctx);
+void si_compute_internal_begin(struct si_context *sctx);
+void si_compute_internal_end(struct si_context *sctx);
 
 /* si_cp_dma.c */
 #define SI_CPDMA_SKIP_CHECK_CS_SPACE	(1 << 0) /* don't call need_cs_space */
@@ -1269,6 +1308,8 @@ void si_need_dma_space(struct si_context *ctx, unsigned num_dw,
 		       struct si_resource *dst, struct si_resource *src);
 void si_flush_dma_cs(struct si_context *ctx, unsigned flags,
 		     struct pipe_fence_handle **fence);
+bool si_use_sdma_upload(struct si_context *ctx, struct si_resource *dst,
+			uint64_t size);
 void si_screen_clear_buffer(struct si_screen *sscreen, struct pipe_resource *dst,
 			    uint64_t offset, uint64_t size, unsigned value);
 
@@ -1305,6 +1346,12 @@ unsigned si_end_counter(struct si_screen *sscreen, unsigned type,
 /* si_compute.c */
 void si_init_compute_functions(struct si_context *sctx);
 
+/* si_compute_prim_discard.c */
+#define SI_PRIM_DISCARD_CHUNK_SIZE	64 /* triangles per thread */
+
+bool si_prim_discard_draw(struct si_context *sctx,
+			  const struct pipe_draw_info *info);
+
 /* si_perfcounters.c */
 void si_init_perfcounters(struct si_screen *screen);
 void si_destroy_perfcounters(struct si_screen *screen);
@@ -1331,6 +1378,10 @@ void *si_clear_render_target_shader(struct pipe_context *ctx);
 void *si_clear_render_target_shader_1d_array(struct pipe_context *ctx);
 void *si_create_dcc_retile_cs(struct pipe_context *ctx);
 void *si_create_query_result_cs(struct si_context *sctx);
+void *si_create_prim_discard_cull_cs(struct si_context *sctx);
+void *si_create_prim_discard_scan_cs(struct si_context *sctx);
+void *si_create_prim_discard_copy_cs(struct si_context *sctx);
+void *si_create_cull_gs(struct si_context *sctx, struct si_shader_selector *vs);
 
 /* si_test_dma.c */
 void si_test_dma(struct si_screen *sscreen);
@@ -1391,6 +1442,8 @@ void vi_separate_dcc_stop_query(struct si_context *sctx,
 				struct si_texture *tex);
 void vi_separate_dcc_process_and_reset_stats(struct pipe_context *ctx,
 					     struct si_texture *tex);
+bool si_texture_keep_dcc_for_image_stores(struct si_context *sctx,
+					  struct si_texture *tex);
 bool si_texture_disable_dcc(struct si_context *sctx,
 			    struct si_texture *tex);
 void si_init_screen_texture_functions(struct si_screen *sscreen);
@@ -82,6 +82,12 @@ static enum radeon_value_id winsys_id_from_type(unsigned type)
 	case SI_QUERY_GFX_IB_SIZE: return RADEON_GFX_IB_SIZE_COUNTER;
 	case SI_QUERY_NUM_BYTES_MOVED: return RADEON_NUM_BYTES_MOVED;
 	case SI_QUERY_NUM_EVICTIONS: return RADEON_NUM_EVICTIONS;
+	case SI_QUERY_BO_CACHE_HITS: return RADEON_BO_CACHE_HITS;
+	case SI_QUERY_BO_CACHE_MISSES: return RADEON_BO_CACHE_MISSES;
+	case SI_QUERY_BO_CACHE_EVICTIONS: return RADEON_BO_CACHE_EVICTIONS;
+	case SI_QUERY_SLAB_CACHE_HITS: return RADEON_SLAB_CACHE_HITS;
+	case SI_QUERY_SLAB_CACHE_MISSES: return RADEON_SLAB_CACHE_MISSES;
+	case SI_QUERY_NUM_SLABS: return RADEON_NUM_SLABS;
 	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: return RADEON_NUM_VRAM_CPU_PAGE_FAULTS;
 	case SI_QUERY_VRAM_USAGE: return RADEON_VRAM_USAGE;
 	case SI_QUERY_VRAM_VIS_USAGE: return RADEON_VRAM_VIS_USAGE;
@@ -94,6 +100,17 @@ static enum radeon_value_id winsys_id_from_type(unsigned type)
 	}
 }
 
+static enum tc_sync_reason tc_sync_reason_from_type(unsigned type)
+{
+	switch (type) {
+	case SI_QUERY_TC_FLUSH_SYNCS: return TC_SYNC_FLUSH;
+	case SI_QUERY_TC_QUERY_SYNCS: return TC_SYNC_QUERY;
+	case SI_QUERY_TC_TRANSFER_SYNCS: return TC_SYNC_TRANSFER;
+	case SI_QUERY_TC_OTHER_SYNCS: return TC_SYNC_OTHER;
+	default: unreachable("query type does not correspond to a sync reason");
+	}
+}
+
 static int64_t si_finish_dma_get_cpu_time(struct si_context *sctx)
 {
 	struct pipe_fence_handle *fence = NULL;
@@ -168,6 +185,15 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_NUM_L2_WRITEBACKS:
 		query->begin_result = sctx->num_L2_writebacks;
 		break;
+	case SI_QUERY_NUM_DCC_DISABLES:
+		query->begin_result = sctx->num_dcc_disables;
+		break;
+	case SI_QUERY_NUM_DCC_IMAGE_STORE_DECOMPRESSES:
+		query->begin_result = sctx->num_dcc_image_store_decompresses;
+		break;
+	case SI_QUERY_NUM_DCC_IMAGE_STORE_DECOMPRESSES_SKIPPED:
+		query->begin_result = sctx->num_dcc_image_store_decompresses_skipped;
+		break;
 	case SI_QUERY_NUM_RESIDENT_HANDLES:
 		query->begin_result = sctx->num_resident_handles;
 		break;
@@ -180,6 +206,20 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_TC_NUM_SYNCS:
 		query->begin_result = sctx->tc ? sctx->tc->num_syncs : 0;
 		break;
+	case SI_QUERY_TC_FLUSH_SYNCS:
+	case SI_QUERY_TC_QUERY_SYNCS:
+	case SI_QUERY_TC_TRANSFER_SYNCS:
+	case SI_QUERY_TC_OTHER_SYNCS:
+		query->begin_result = sctx->tc ?
+			sctx->tc->num_syncs_by_reason[tc_sync_reason_from_type(query->b.type)] : 0;
+		break;
+	case SI_QUERY_TC_SYNC_TIME:
+		query->begin_result = sctx->tc ? sctx->tc->sync_time_ns : 0;
+		break;
+	case SI_QUERY_TC_BATCH_FILL:
+		query->begin_result = sctx->tc ? sctx->tc->num_offloaded_slots : 0;
+		query->begin_time = sctx->tc ? sctx->tc->num_batches : 0;
+		break;
 	case SI_QUERY_REQUESTED_VRAM:
 	case SI_QUERY_REQUESTED_GTT:
 	case SI_QUERY_MAPPED_VRAM:
@@ -190,6 +230,7 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_GPU_TEMPERATURE:
 	case SI_QUERY_CURRENT_GPU_SCLK:
 	case SI_QUERY_CURRENT_GPU_MCLK:
+	case SI_QUERY_NUM_SLABS:
 	case SI_QUERY_BACK_BUFFER_PS_DRAW_RATIO:
 	case SI_QUERY_NUM_MAPPED_BUFFERS:
 		query->begin_result = 0;
@@ -200,6 +241,11 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_NUM_SDMA_IBS:
 	case SI_QUERY_NUM_BYTES_MOVED:
 	case SI_QUERY_NUM_EVICTIONS:
+	case SI_QUERY_BO_CACHE_HITS:
+	case SI_QUERY_BO_CACHE_MISSES:
+	case SI_QUERY_BO_CACHE_EVICTIONS:
+	case SI_QUERY_SLAB_CACHE_HITS:
+	case SI_QUERY_SLAB_CACHE_MISSES:
 	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
 		enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
 		query->begin_result = sctx->ws->query_value(sctx->ws, ws_id);
@@ -331,6 +377,15 @@ static bool si_query_sw_end(struct si_context *sctx,
 	case SI_QUERY_NUM_L2_WRITEBACKS:
 		query->end_result = sctx->num_L2_writebacks;
 		break;
+	case SI_QUERY_NUM_DCC_DISABLES:
+		query->end_result = sctx->num_dcc_disables;
+		break;
+	case SI_QUERY_NUM_DCC_IMAGE_STORE_DECOMPRESSES:
+		query->end_result = sctx->num_dcc_image_store_decompresses;
+		break;
+	case SI_QUERY_NUM_DCC_IMAGE_STORE_DECOMPRESSES_SKIPPED:
+		query->end_result = sctx->num_dcc_image_store_decompresses_skipped;
+		break;
 	case SI_QUERY_NUM_RESIDENT_HANDLES:
 		query->end_result = sctx->num_resident_handles;
 		break;
@@ -343,6 +398,20 @@ static bool si_query_sw_end(struct si_context *sctx,
 	case SI_QUERY_TC_NUM_SYNCS:
 		query->end_result = sctx->tc ? sctx->tc->num_syncs : 0;
 		break;
+	case SI_QUERY_TC_FLUSH_SYNCS:
+	case SI_QUERY_TC_QUERY_SYNCS:
+	case SI_QUERY_TC_TRANSFER_SYNCS:
+	case SI_QUERY_TC_OTHER_SYNCS:
+		query->end_result = sctx->tc ?
+			sctx->tc->num_syncs_by_reason[tc_sync_reason_from_type(query->b.type)] : 0;
+		break;
+	case SI_QUERY_TC_SYNC_TIME:
+		query->end_result = sctx->tc ? sctx->tc->sync_time_ns : 0;
+		break;
+	case SI_QUERY_TC_BATCH_FILL:
+		query->end_result = sctx->tc ? sctx->tc->num_offloaded_slots : 0;
+		query->end_time = sctx->tc ? sctx->tc->num_batches : 0;
+		break;
 	case SI_QUERY_REQUESTED_VRAM:
 	case SI_QUERY_REQUESTED_GTT:
 	case SI_QUERY_MAPPED_VRAM:
@@ -360,6 +429,12 @@ static bool si_query_sw_end(struct si_context *sctx,
 	case SI_QUERY_NUM_SDMA_IBS:
 	case SI_QUERY_NUM_BYTES_MOVED:
 	case SI_QUERY_NUM_EVICTIONS:
+	case SI_QUERY_BO_CACHE_HITS:
+	case SI_QUERY_BO_CACHE_MISSES:
+	case SI_QUERY_BO_CACHE_EVICTIONS:
+	case SI_QUERY_SLAB_CACHE_HITS:
+	case SI_QUERY_SLAB_CACHE_MISSES:
+	case SI_QUERY_NUM_SLABS:
 	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
 		enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
 		query->end_result = sctx->ws->query_value(sctx->ws, ws_id);
@@ -460,6 +535,15 @@ static bool si_query_sw_get_result(struct si_context *sctx,
 		result->u64 = (query->end_result - query->begin_result) /
 			      (query->end_time - query->begin_time);
 		return true;
+	case SI_QUERY_TC_BATCH_FILL: {
+		uint64_t num_batches = query->end_time - query->begin_time;
+
+		/* Percentage of the call slots used by offloaded batches. */
+		result->u64 = num_batches ?
+			(query->end_result - query->begin_result) * 100 /
+			(num_batches * TC_CALLS_PER_BATCH) : 0;
+		return true;
+	}
 	case SI_QUERY_CS_THREAD_BUSY:
 	case SI_QUERY_GALLIUM_THREAD_BUSY:
 		result->u64 = (query->end_result - query->begin_result) * 100 /
@@ -486,6 +570,7 @@ static bool si_query_sw_get_result(struct si_context *sctx,
 
 	switch (query->b.type) {
 	case SI_QUERY_BUFFER_WAIT_TIME:
+	case SI_QUERY_TC_SYNC_TIME:
 	case SI_QUERY_GPU_TEMPERATURE:
 		result->u64 /= 1000;
 		break;
@@ -607,6 +692,7 @@ void si_query_hw_destroy(struct si_screen *sscreen,
 
 	si_query_buffer_destroy(sscreen, &query->buffer);
 	si_resource_reference(&query->workaround_buf, NULL);
+	si_resource_reference(&query->resolve_buf, NULL);
 	FREE(squery);
 }
 
@@ -1101,6 +1187,7 @@ bool si_query_hw_begin(struct si_context *sctx,
 		si_query_buffer_reset(sctx, &query->buffer);
 
 	si_resource_reference(&query->workaround_buf, NULL);
+	query->resolve_pending = false;
 
 	si_query_hw_emit_start(sctx, query);
 	if (!query->buffer.buf)
@@ -1128,6 +1215,7 @@ bool si_query_hw_end(struct si_context *sctx,
 		si_query_buffer_reset(sctx, &query->buffer);
 
 	si_query_hw_emit_stop(sctx, query);
+	query->resolve_pending = false;
 
 	if (!(query->flags & SI_QUERY_HW_FLAG_NO_START)) {
 		LIST_DELINIT(&query->b.active_list);
@@ -1391,6 +1479,128 @@ static void si_query_hw_clear_result(struct si_query_hw *query,
 	util_query_clear_result(result, query->b.type);
 }
 
+static bool si_query_hw_can_resolve(struct si_query_hw *query)
+{
+	/* The query result shader computes a single value. */
+	switch (query->b.type) {
+	case PIPE_QUERY_OCCLUSION_COUNTER:
+	case PIPE_QUERY_OCCLUSION_PREDICATE:
+	case PIPE_QUERY_OCCLUSION_PREDICATE_CONSERVATIVE:
+	case PIPE_QUERY_TIME_ELAPSED:
+	case PIPE_QUERY_TIMESTAMP:
+	case PIPE_QUERY_PRIMITIVES_EMITTED:
+	case PIPE_QUERY_PRIMITIVES_GENERATED:
+	case PIPE_QUERY_SO_OVERFLOW_PREDICATE:
+	case PIPE_QUERY_SO_OVERFLOW_ANY_PREDICATE:
+		return query->buffer.buf != NULL;
+	default:
+		return false;
+	}
+}
+
+/* Accumulate the results into query->resolve_buf on the GPU. */
+static void si_query_hw_resolve(struct si_context *sctx,
+				struct si_query_hw *query, bool wait)
+{
+	bool old_force_off = sctx->render_cond_force_off;
+
+	if (!query->resolve_buf) {
+		query->resolve_buf = si_resource(
+			pipe_buffer_create(&sctx->screen->b, 0,
+					   PIPE_USAGE_STAGING, 16));
+		if (!query->resolve_buf)
+			return;
+	}
+
+	sctx->render_cond_force_off = true;
+	/* Get the availability first: if it's set, the result was available
+	 * to the second dispatch as well.
+	 */
+	si_query_hw_get_result_resource(sctx, &query->b, wait,
+					PIPE_QUERY_TYPE_U32, -1,
+					&query->resolve_buf->b.b, 8);
+	si_query_hw_get_result_resource(sctx, &query->b, false,
+					PIPE_QUERY_TYPE_U64, 0,
+					&query->resolve_buf->b.b, 0);
+	sctx->render_cond_force_off = old_force_off;
+
+	query->resolve_pending = true;
+}
+
+static uint32_t *si_query_hw_map_resolve_buf(struct si_context *sctx,
+					     struct si_query_hw *query,
+					     unsigned usage)
+{
+	if (query->b.b.flushed)
+		return sctx->ws->buffer_map(query->resolve_buf->buf, NULL, usage);
+
+	return si_buffer_map_sync_with_rings(sctx, query->resolve_buf, usage);
+}
+
+/* Read the result resolved by the GPU. This only maps a few bytes instead of
+ * all the raw results, which don't even have to be idle.
+ *
+ * If the query was flushed, the threaded context can call this from the
+ * application thread, so if no resolve was done before, the CPU must read
+ * the result instead.
+ *
+ * \return false if the CPU must read the result, otherwise *ready is set
+ */
+static bool si_query_hw_get_resolved_result(struct si_context *sctx,
+					    struct si_query_hw *query,
+					    bool wait,
+					    union pipe_query_result *result,
+					    bool *ready)
+{
+	unsigned usage = PIPE_TRANSFER_READ |
+			 (wait ? 0 : PIPE_TRANSFER_DONTBLOCK);
+	bool flushed = query->b.b.flushed;
+	uint32_t *map;
+
+	if (!si_query_hw_can_resolve(query))
+		return false;
+
+	if (!flushed && !query->resolve_pending)
+		si_query_hw_resolve(sctx, query, wait);
+
+	if (!query->resolve_pending)
+		return false;
+
+	map = si_query_hw_map_resolve_buf(sctx, query, usage);
+	if (map && !map[2] && wait && !flushed) {
+		/* An earlier resolve ran before the results were written. */
+		si_query_hw_resolve(sctx, query, true);
+		map = si_query_hw_map_resolve_buf(sctx, query, usage);
+	}
+
+	if (!map) {
+		*ready = false;
+		return true;
+	}
+
+	if (!map[2]) {
+		/* Resolve again the next time. */
+		query->resolve_pending = false;
+		*ready = false;
+		return !flushed;
+	}
+
+	switch (query->b.type) {
+	case PIPE_QUERY_OCCLUSION_PREDICATE:
+	case PIPE_QUERY_OCCLUSION_PREDICATE_CONSERVATIVE:
+	case PIPE_QUERY_SO_OVERFLOW_PREDICATE:
+	case PIPE_QUERY_SO_OVERFLOW_ANY_PREDICATE:
+		result->b = *(uint64_t*)map != 0;
+		break;
+	default:
+		/* Timestamps are already converted by the shader. */
+		result->u64 = *(uint64_t*)map;
+		break;
+	}
+	*ready = true;
+	return true;
+}
+
 bool si_query_hw_get_result(struct si_context *sctx,
 			    struct si_query *squery,
 			    bool wait, union pipe_query_result *result)
@@ -1398,9 +1608,13 @@ bool si_query_hw_get_result(struct si_context *sctx,
 	struct si_screen *sscreen = sctx->screen;
 	struct si_query_hw *query = (struct si_query_hw *)squery;
 	struct si_query_buffer *qbuf;
+	bool ready;
 
 	query->ops->clear_result(query, result);
 
+	if (si_query_hw_get_resolved_result(sctx, query, wait, result, &ready))
+		return ready;
+
 	for (qbuf = &query->buffer; qbuf; qbuf = qbuf->previous) {
 		unsigned usage = PIPE_TRANSFER_READ |
 				 (wait ? 0 : PIPE_TRANSFER_DONTBLOCK);
@@ -1710,10 +1924,19 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
 	X("num-DB-cache-flushes",	NUM_DB_CACHE_FLUSHES,	UINT64, AVERAGE),
 	X("num-L2-invalidates",		NUM_L2_INVALIDATES,	UINT64, AVERAGE),
 	X("num-L2-writebacks",		NUM_L2_WRITEBACKS,	UINT64, AVERAGE),
+	X("num-DCC-disables",		NUM_DCC_DISABLES,	UINT64, AVERAGE),
+	X("num-DCC-image-store-decompresses", NUM_DCC_IMAGE_STORE_DECOMPRESSES, UINT64, AVERAGE),
+	X("num-DCC-image-store-decompresses-skipped", NUM_DCC_IMAGE_STORE_DECOMPRESSES_SKIPPED, UINT64, AVERAGE),
 	X("num-resident-handles",	NUM_RESIDENT_HANDLES,	UINT64, AVERAGE),
 	X("tc-offloaded-slots",		TC_OFFLOADED_SLOTS,     UINT64, AVERAGE),
 	X("tc-direct-slots",		TC_DIRECT_SLOTS,	UINT64, AVERAGE),
 	X("tc-num-syncs",		TC_NUM_SYNCS,		UINT64, AVERAGE),
+	X("tc-flush-syncs",		TC_FLUSH_SYNCS,		UINT64, AVERAGE),
+	X("tc-query-syncs",		TC_QUERY_SYNCS,		UINT64, AVERAGE),
+	X("tc-transfer-syncs",		TC_TRANSFER_SYNCS,	UINT64, AVERAGE),
+	X("tc-other-syncs",		TC_OTHER_SYNCS,		UINT64, AVERAGE),
+	X("tc-sync-time",		TC_SYNC_TIME,		MICROSECONDS, CUMULATIVE),
+	X("tc-batch-fill",		TC_BATCH_FILL,		UINT64, AVERAGE),
 	X("CS-thread-busy",		CS_THREAD_BUSY,		UINT64, AVERAGE),
 	X("gallium-thread-busy",	GALLIUM_THREAD_BUSY,	UINT64, AVERAGE),
 	X("requested-VRAM",		REQUESTED_VRAM,		BYTES, AVERAGE),
@@ -1728,6 +1951,12 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
 	X("GFX-IB-size",		GFX_IB_SIZE,		UINT64, AVERAGE),
 	X("num-bytes-moved",		NUM_BYTES_MOVED,	BYTES, CUMULATIVE),
 	X("num-evictions",		NUM_EVICTIONS,		UINT64, CUMULATIVE),
+	X("BO-cache-hits",		BO_CACHE_HITS,		UINT64, CUMULATIVE),
+	X("BO-cache-misses",		BO_CACHE_MISSES,	UINT64, CUMULATIVE),
+	X("BO-cache-evictions",		BO_CACHE_EVICTIONS,	UINT64, CUMULATIVE),
+	X("slab-cache-hits",		SLAB_CACHE_HITS,	UINT64, CUMULATIVE),
+	X("slab-cache-misses",		SLAB_CACHE_MISSES,	UINT64, CUMULATIVE),
+	X("num-slabs",			NUM_SLABS,		UINT64, AVERAGE),
 	X("VRAM-CPU-page-faults",	NUM_VRAM_CPU_PAGE_FAULTS, UINT64, CUMULATIVE),
 	X("VRAM-usage",			VRAM_USAGE,		BYTES, AVERAGE),
 	X("VRAM-vis-usage",		VRAM_VIS_USAGE,		BYTES, AVERAGE),
@@ -55,10 +55,19 @@ enum {
 	SI_QUERY_NUM_DB_CACHE_FLUSHES,
 	SI_QUERY_NUM_L2_INVALIDATES,
 	SI_QUERY_NUM_L2_WRITEBACKS,
+	SI_QUERY_NUM_DCC_DISABLES,
+	SI_QUERY_NUM_DCC_IMAGE_STORE_DECOMPRESSES,
+	SI_QUERY_NUM_DCC_IMAGE_STORE_DECOMPRESSES_SKIPPED,
 	SI_QUERY_NUM_RESIDENT_HANDLES,
 	SI_QUERY_TC_OFFLOADED_SLOTS,
 	SI_QUERY_TC_DIRECT_SLOTS,
 	SI_QUERY_TC_NUM_SYNCS,
+	SI_QUERY_TC_FLUSH_SYNCS,
+	SI_QUERY_TC_QUERY_SYNCS,
+	SI_QUERY_TC_TRANSFER_SYNCS,
+	SI_QUERY_TC_OTHER_SYNCS,
+	SI_QUERY_TC_SYNC_TIME,
+	SI_QUERY_TC_BATCH_FILL,
 	SI_QUERY_CS_THREAD_BUSY,
 	SI_QUERY_GALLIUM_THREAD_BUSY,
 	SI_QUERY_REQUESTED_VRAM,
@@ -73,6 +82,12 @@ enum {
 	SI_QUERY_GFX_IB_SIZE,
 	SI_QUERY_NUM_BYTES_MOVED,
 	SI_QUERY_NUM_EVICTIONS,
+	SI_QUERY_BO_CACHE_HITS,
+	SI_QUERY_BO_CACHE_MISSES,
+	SI_QUERY_BO_CACHE_EVICTIONS,
+	SI_QUERY_SLAB_CACHE_HITS,
+	SI_QUERY_SLAB_CACHE_MISSES,
+	SI_QUERY_NUM_SLABS,
 	SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS,
 	SI_QUERY_VRAM_USAGE,
 	SI_QUERY_VRAM_VIS_USAGE,
@@ -209,6 +224,13 @@ struct si_query_hw {
 	/* Workaround via compute shader */
 	struct si_resource *workaround_buf;
 	unsigned workaround_offset;
+
+	/* The result accumulated by the query result shader (64 bits) and its
+	 * availability (32 bits), so that reading the result doesn't need
+	 * mapping the raw per-RB results.
+	 */
+	struct si_resource *resolve_buf;
+	bool resolve_pending;
 };
 
 void si_query_hw_destroy(struct si_screen *sscreen,
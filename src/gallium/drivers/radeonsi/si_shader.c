@@ -6654,14 +6654,27 @@ static void si_build_wrapper_function(struct si_shader_context *ctx,
 }
 
 static bool si_should_optimize_less(struct ac_llvm_compiler *compiler,
-				    struct si_shader_selector *sel)
+				    struct si_shader *shader)
 {
+	struct si_shader_selector *sel = shader->selector;
+	bool fast_compile = sel->screen->debug_flags & DBG(FAST_COMPILE);
+
 	if (!compiler->low_opt_passes)
 		return false;
 
+	/* Main parts are what draws wait for. Optimized variants, which are
+	 * monolithic and compiled asynchronously, replace them. Compute
+	 * shaders don't have such variants.
+	 */
+	if (fast_compile &&
+	    !shader->is_monolithic &&
+	    sel->type != PIPE_SHADER_COMPUTE)
+		return true;
+
 	/* Assume a slow CPU. */
-	assert(!sel->screen->info.has_dedicated_vram &&
-	       sel->screen->info.chip_class <= VI);
+	assert(fast_compile ||
+	       (!sel->screen->info.has_dedicated_vram &&
+		sel->screen->info.chip_class <= VI));
 
 	/* For a crazy dEQP test containing 2597 memory opcodes, mostly
 	 * buffer stores. */
@@ -6903,7 +6916,7 @@ int si_compile_tgsi_shader(struct si_screen *sscreen,
 	r = si_compile_llvm(sscreen, &shader->binary, &shader->config, compiler,
 			    ctx.ac.module, debug, ctx.type,
 			    si_get_shader_name(shader, ctx.type),
-			    si_should_optimize_less(compiler, shader->selector));
+			    si_should_optimize_less(compiler, shader));
 	si_llvm_dispose(&ctx);
 	if (r) {
 		fprintf(stderr, "LLVM failed to compile shader\n");
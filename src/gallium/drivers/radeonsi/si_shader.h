@@ -333,6 +333,21 @@ struct si_shader_selector {
 
 	struct si_shader	*gs_copy_shader;
 
+	/* A copy of the VS streaming out the position, for the primitive
+	 * discard prepass. */
+	struct si_shader_selector *prim_discard_pos_vs;
+
+	/* The GS culling the triangles of this VS, see si_update_cull_gs. */
+	struct si_shader_selector *cull_gs;
+	bool			is_cull_gs;
+
+	/* The monolithic variants used the most are recorded in the disk
+	 * cache under this key, and compiled ahead of time the next time
+	 * the shader is created. */
+	unsigned char		variants_cache_key[20];
+	bool			has_variants_cache_key;
+	bool			variants_used; /* record them again */
+
 	struct tgsi_token       *tokens;
 	struct nir_shader       *nir;
 	struct pipe_stream_output_info  so;
@@ -607,7 +622,9 @@ struct si_shader {
 	bool				compilation_failed;
 	bool				is_monolithic;
 	bool				is_optimized;
+	bool				is_precompiled;
 	bool				is_binary_shared;
+	unsigned			use_count; /* selections, for precompiling */
 	bool				is_gs_copy_shader;
 
 	/* The following data is all that's needed for binary shaders. */
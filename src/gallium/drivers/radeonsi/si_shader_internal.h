@@ -307,6 +307,8 @@ LLVMValueRef si_load_image_desc(struct si_shader_context *ctx,
 				LLVMValueRef list, LLVMValueRef index,
 				enum ac_descriptor_type desc_type, bool dcc_off,
 				bool bindless);
+LLVMValueRef si_load_desc_heap_ptr(struct si_shader_context *ctx,
+				   LLVMValueRef unit);
 
 void si_load_system_value(struct si_shader_context *ctx,
 			  unsigned index,
@@ -1041,11 +1041,22 @@ si_nir_load_sampler_desc(struct ac_shader_abi *abi,
 		index = LLVMBuildSub(ctx->ac.builder,
 				     LLVMConstInt(ctx->i32, SI_NUM_IMAGES - 1, 0),
 				     index, "");
+		if (ctx->screen->debug_flags & DBG(DESC_HEAP)) {
+			list = si_load_desc_heap_ptr(ctx, index);
+			index = ctx->i32_0;
+		}
 		return si_load_image_desc(ctx, list, index, desc_type, dcc_off, false);
 	}
 
 	index = LLVMBuildAdd(ctx->ac.builder, index,
 			     LLVMConstInt(ctx->i32, SI_NUM_IMAGES / 2, 0), "");
+	if (ctx->screen->debug_flags & DBG(DESC_HEAP)) {
+		/* Sampler slots are 2 units. */
+		index = LLVMBuildMul(ctx->ac.builder, index,
+				     LLVMConstInt(ctx->i32, 2, 0), "");
+		list = si_load_desc_heap_ptr(ctx, index);
+		index = ctx->i32_0;
+	}
 	return si_load_sampler_desc(ctx, list, index, desc_type);
 }
 
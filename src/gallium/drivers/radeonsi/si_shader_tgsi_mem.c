@@ -201,6 +201,30 @@ LLVMValueRef si_load_image_desc(struct si_shader_context *ctx,
 	return rsrc;
 }
 
+/**
+ * With R600_DEBUG=descheap, the samplers_and_images list contains the heap
+ * slot of each 8-dword unit. Return a pointer to the heap slot of \p unit,
+ * which is a bindless slot.
+ */
+LLVMValueRef si_load_desc_heap_ptr(struct si_shader_context *ctx,
+				   LLVMValueRef unit)
+{
+	LLVMBuilderRef builder = ctx->ac.builder;
+	LLVMValueRef list = LLVMGetParam(ctx->main_fn,
+					 ctx->param_samplers_and_images);
+	LLVMValueRef heap = LLVMGetParam(ctx->main_fn,
+					 ctx->param_bindless_samplers_and_images);
+	LLVMValueRef slot;
+
+	list = LLVMBuildPointerCast(builder, list,
+				    ac_array_in_const32_addr_space(ctx->i32), "");
+	slot = ac_build_load_to_sgpr(&ctx->ac, list, unit);
+
+	/* Heap slots are 16 dwords. */
+	slot = LLVMBuildMul(builder, slot, LLVMConstInt(ctx->i32, 2, 0), "");
+	return ac_build_pointer_add(&ctx->ac, heap, slot);
+}
+
 /**
  * Load the resource descriptor for \p image.
  */
@@ -262,6 +286,9 @@ image_fetch_rsrc(
 		index = LLVMBuildMul(ctx->ac.builder, index,
 				     LLVMConstInt(ctx->i32, 2, 0), "");
 		bindless = true;
+	} else if (ctx->screen->debug_flags & DBG(DESC_HEAP)) {
+		rsrc_ptr = si_load_desc_heap_ptr(ctx, index);
+		index = ctx->i32_0;
 	}
 
 	*rsrc = si_load_image_desc(ctx, rsrc_ptr, index,
@@ -1174,6 +1201,11 @@ static void tex_fetch_ptrs(struct lp_build_tgsi_context *bld_base,
 		index = LLVMBuildMul(ctx->ac.builder, index, LLVMConstInt(ctx->i32, 2, 0), "");
 		list = ac_build_pointer_add(&ctx->ac, list, index);
 		index = ctx->i32_0;
+	} else if (ctx->screen->debug_flags & DBG(DESC_HEAP)) {
+		/* Sampler slots are 2 units. */
+		index = LLVMBuildMul(ctx->ac.builder, index, LLVMConstInt(ctx->i32, 2, 0), "");
+		list = si_load_desc_heap_ptr(ctx, index);
+		index = ctx->i32_0;
 	}
 
 	if (target == TGSI_TEXTURE_BUFFER)
@@ -23,6 +23,7 @@
  */
 
 #include "si_pipe.h"
+#include "tgsi/tgsi_strings.h"
 #include "tgsi/tgsi_text.h"
 #include "tgsi/tgsi_ureg.h"
 
@@ -660,3 +661,531 @@ void *si_clear_render_target_shader_1d_array(struct pipe_context *ctx)
 
 	return ctx->create_compute_state(ctx, &state);
 }
+
+/* Create the compute shader culling the triangles of a draw for the
+ * primitive discard prepass, see si_compute_prim_discard.c.
+ *
+ * Each thread culls a chunk of SI_PRIM_DISCARD_CHUNK_SIZE triangles and
+ * writes the indices of the remaining ones in order to its part of the
+ * chunk buffer, and their number to the count buffer.
+ *
+ * BUFFER[0]: index buffer
+ * BUFFER[1]: clip space positions of the vertices min_index..max_index
+ * BUFFER[2]: chunk buffer, 32-bit indices
+ * BUFFER[3]: triangle count of each chunk
+ *
+ * CONST[0][0]: num_triangles, index byte offset, index size, index mask
+ * CONST[0][1]: min_index, num_vertices, num_chunks, window space det sign
+ * CONST[0][2]: cull mask if front facing, if back facing, front_ccw mask
+ */
+void *si_create_prim_discard_cull_cs(struct si_context *sctx)
+{
+	/* TEMP[0].x = chunk index
+	 * TEMP[0].y = current triangle
+	 * TEMP[0].z = end triangle of the chunk
+	 * TEMP[0].w = number of triangles kept
+	 *
+	 * TEMP[1].xyz = vertex indices
+	 * TEMP[2..4] = vertex positions
+	 *
+	 * TEMP[6].x = all vertex indices in range
+	 * TEMP[6].y = culled
+	 * TEMP[6].z = all w > 0
+	 */
+	static const char text_tmpl[] =
+		"COMP\n"
+		"PROPERTY CS_FIXED_BLOCK_WIDTH 64\n"
+		"PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+		"PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+		"DCL SV[0], THREAD_ID\n"
+		"DCL SV[1], BLOCK_ID\n"
+		"DCL BUFFER[0]\n"
+		"DCL BUFFER[1]\n"
+		"DCL BUFFER[2]\n"
+		"DCL BUFFER[3]\n"
+		"DCL CONST[0][0..2]\n"
+		"DCL TEMP[0..8], LOCAL\n"
+		"IMM[0] UINT32 {0, 1, 2, 3}\n"
+		"IMM[1] UINT32 {%u, 4294967292, 8, 16}\n"
+		"IMM[2] UINT32 {12, 64, 4, 0}\n"
+
+		"UMAD TEMP[0].x, SV[1].xxxx, IMM[2].yyyy, SV[0].xxxx\n"
+		"USLT TEMP[5].x, TEMP[0].xxxx, CONST[0][1].zzzz\n"
+		"UIF TEMP[5].xxxx\n"
+			"UMUL TEMP[0].y, TEMP[0].xxxx, IMM[1].xxxx\n"
+			"UADD TEMP[0].z, TEMP[0].yyyy, IMM[1].xxxx\n"
+			"UMIN TEMP[0].z, TEMP[0].zzzz, CONST[0][0].xxxx\n"
+			"MOV TEMP[0].w, IMM[0].xxxx\n"
+
+			"BGNLOOP\n"
+				"USGE TEMP[5].x, TEMP[0].yyyy, TEMP[0].zzzz\n"
+				"UIF TEMP[5].xxxx\n"
+					"BRK\n"
+				"ENDIF\n"
+
+				/* Load the indices from the dwords containing them. */
+				"UMUL TEMP[5].x, TEMP[0].yyyy, IMM[0].wwww\n"
+				"UADD TEMP[5].xyz, TEMP[5].xxxx, IMM[0].xyzz\n"
+				"UMAD TEMP[5].xyz, TEMP[5].xyzz, CONST[0][0].zzzz, CONST[0][0].yyyy\n"
+				"AND TEMP[6].xyz, TEMP[5].xyzz, IMM[1].yyyy\n"
+				"LOAD TEMP[1].x, BUFFER[0], TEMP[6].xxxx\n"
+				"LOAD TEMP[7].x, BUFFER[0], TEMP[6].yyyy\n"
+				"MOV TEMP[1].y, TEMP[7].xxxx\n"
+				"LOAD TEMP[7].x, BUFFER[0], TEMP[6].zzzz\n"
+				"MOV TEMP[1].z, TEMP[7].xxxx\n"
+				"AND TEMP[5].xyz, TEMP[5].xyzz, IMM[0].wwww\n"
+				"UMUL TEMP[5].xyz, TEMP[5].xyzz, IMM[1].zzzz\n"
+				"USHR TEMP[1].xyz, TEMP[1].xyzz, TEMP[5].xyzz\n"
+				"AND TEMP[1].xyz, TEMP[1].xyzz, CONST[0][0].wwww\n"
+
+				/* Load the positions. */
+				"UADD TEMP[5].xyz, TEMP[1].xyzz, -CONST[0][1].xxxx\n"
+				"USLT TEMP[6].xyz, TEMP[5].xyzz, CONST[0][1].yyyy\n"
+				"AND TEMP[6].x, TEMP[6].xxxx, TEMP[6].yyyy\n"
+				"AND TEMP[6].x, TEMP[6].xxxx, TEMP[6].zzzz\n"
+				"UMUL TEMP[5].xyz, TEMP[5].xyzz, IMM[1].wwww\n"
+				"LOAD TEMP[2], BUFFER[1], TEMP[5].xxxx\n"
+				"LOAD TEMP[3], BUFFER[1], TEMP[5].yyyy\n"
+				"LOAD TEMP[4], BUFFER[1], TEMP[5].zzzz\n"
+
+				/* Cull if all vertices are outside of the same
+				 * x or y plane of the clip volume.
+				 */
+				"FSLT TEMP[7].xy, TEMP[2].xyyy, -TEMP[2].wwww\n"
+				"FSLT TEMP[7].zw, TEMP[2].wwww, TEMP[2].xxxy\n"
+				"FSLT TEMP[8].xy, TEMP[3].xyyy, -TEMP[3].wwww\n"
+				"FSLT TEMP[8].zw, TEMP[3].wwww, TEMP[3].xxxy\n"
+				"AND TEMP[7], TEMP[7], TEMP[8]\n"
+				"FSLT TEMP[8].xy, TEMP[4].xyyy, -TEMP[4].wwww\n"
+				"FSLT TEMP[8].zw, TEMP[4].wwww, TEMP[4].xxxy\n"
+				"AND TEMP[7], TEMP[7], TEMP[8]\n"
+				"OR TEMP[7].xy, TEMP[7].xyyy, TEMP[7].zwww\n"
+				"OR TEMP[6].y, TEMP[7].xxxx, TEMP[7].yyyy\n"
+
+				/* Face culling, which needs all w > 0. */
+				"FSLT TEMP[7].x, IMM[0].xxxx, TEMP[2].wwww\n"
+				"FSLT TEMP[7].y, IMM[0].xxxx, TEMP[3].wwww\n"
+				"FSLT TEMP[7].z, IMM[0].xxxx, TEMP[4].wwww\n"
+				"AND TEMP[7].x, TEMP[7].xxxx, TEMP[7].yyyy\n"
+				"AND TEMP[6].z, TEMP[7].xxxx, TEMP[7].zzzz\n"
+				"UIF TEMP[6].zzzz\n"
+					"RCP TEMP[7].x, TEMP[2].wwww\n"
+					"RCP TEMP[7].y, TEMP[3].wwww\n"
+					"RCP TEMP[7].z, TEMP[4].wwww\n"
+					"MUL TEMP[2].xy, TEMP[2].xyyy, TEMP[7].xxxx\n"
+					"MUL TEMP[3].xy, TEMP[3].xyyy, TEMP[7].yyyy\n"
+					"MUL TEMP[4].xy, TEMP[4].xyyy, TEMP[7].zzzz\n"
+
+					/* e = v0 - v2, f = v1 - v2, det = ex * fy - ey * fx */
+					"ADD TEMP[7].xy, TEMP[2].xyyy, -TEMP[4].xyyy\n"
+					"ADD TEMP[7].zw, TEMP[3].xxxy, -TEMP[4].xxxy\n"
+					"MUL TEMP[8].x, TEMP[7].xxxx, TEMP[7].wwww\n"
+					"MUL TEMP[8].y, TEMP[7].yyyy, TEMP[7].zzzz\n"
+					"ADD TEMP[8].x, TEMP[8].xxxx, -TEMP[8].yyyy\n"
+					"MUL TEMP[8].x, TEMP[8].xxxx, CONST[0][1].wwww\n"
+
+					/* Counter-clockwise if det < 0, like draw_pipe_cull.
+					 * Zero area triangles are back facing.
+					 */
+					"FSLT TEMP[8].y, TEMP[8].xxxx, IMM[0].xxxx\n"
+					"USEQ TEMP[8].y, TEMP[8].yyyy, CONST[0][2].zzzz\n"
+					"UCMP TEMP[8].z, TEMP[8].yyyy, CONST[0][2].xxxx, CONST[0][2].yyyy\n"
+					"FSEQ TEMP[8].y, TEMP[8].xxxx, IMM[0].xxxx\n"
+					"UCMP TEMP[8].z, TEMP[8].yyyy, CONST[0][2].yyyy, TEMP[8].zzzz\n"
+					/* Never cull NaNs. */
+					"FSEQ TEMP[8].w, TEMP[8].xxxx, TEMP[8].xxxx\n"
+					"AND TEMP[8].z, TEMP[8].zzzz, TEMP[8].wwww\n"
+					"OR TEMP[6].y, TEMP[6].yyyy, TEMP[8].zzzz\n"
+				"ENDIF\n"
+
+				/* Keep the triangle if it's not culled, or if an
+				 * index is out of range.
+				 */
+				"NOT TEMP[6].xy, TEMP[6].xyyy\n"
+				"OR TEMP[6].x, TEMP[6].xxxx, TEMP[6].yyyy\n"
+				"UIF TEMP[6].xxxx\n"
+					"UMAD TEMP[5].x, TEMP[0].xxxx, IMM[1].xxxx, TEMP[0].wwww\n"
+					"UMUL TEMP[5].x, TEMP[5].xxxx, IMM[2].xxxx\n"
+					"STORE BUFFER[2].xyz, TEMP[5].xxxx, TEMP[1]\n"
+					"UADD TEMP[0].w, TEMP[0].wwww, IMM[0].yyyy\n"
+				"ENDIF\n"
+
+				"UADD TEMP[0].y, TEMP[0].yyyy, IMM[0].yyyy\n"
+			"ENDLOOP\n"
+
+			"UMUL TEMP[5].x, TEMP[0].xxxx, IMM[2].zzzz\n"
+			"STORE BUFFER[3].x, TEMP[5].xxxx, TEMP[0].wwww\n"
+		"ENDIF\n"
+		"END\n";
+
+	char text[sizeof(text_tmpl) + 32];
+	struct tgsi_token tokens[1024];
+	struct pipe_compute_state state = {};
+
+	snprintf(text, sizeof(text), text_tmpl, SI_PRIM_DISCARD_CHUNK_SIZE);
+
+	if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+		assert(false);
+		return NULL;
+	}
+
+	state.ir_type = PIPE_SHADER_IR_TGSI;
+	state.prog = tokens;
+
+	return sctx->b.create_compute_state(&sctx->b, &state);
+}
+
+/* Create the compute shader computing where each chunk of the primitive
+ * discard prepass goes in the compacted index buffer, and the arguments
+ * of the indirect draw.  It's a single workgroup: each thread sums its
+ * range of chunks, and the sums are combined through shared memory.
+ *
+ * BUFFER[0]: triangle count of each chunk
+ * BUFFER[1]: offset of each chunk in the compacted index buffer, in indices
+ * BUFFER[2]: DRAW_INDEX_INDIRECT arguments
+ *
+ * CONST[0][0]: num_chunks, first index, index_bias, start_instance
+ * CONST[0][1].x: number of chunks per thread
+ */
+void *si_create_prim_discard_scan_cs(struct si_context *sctx)
+{
+	/* TEMP[0].x = first chunk of the thread
+	 * TEMP[0].y = end chunk of the thread
+	 * TEMP[0].z = loop counter
+	 * TEMP[0].w = triangle count of the thread
+	 *
+	 * TEMP[2].x = triangle count before the current chunk
+	 * TEMP[2].y = total triangle count
+	 */
+	static const char text[] =
+		"COMP\n"
+		"PROPERTY CS_FIXED_BLOCK_WIDTH 64\n"
+		"PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+		"PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+		"DCL SV[0], THREAD_ID\n"
+		"DCL BUFFER[0]\n"
+		"DCL BUFFER[1]\n"
+		"DCL BUFFER[2]\n"
+		"DCL CONST[0][0..1]\n"
+		"DCL MEMORY[0], SHARED\n"
+		"DCL TEMP[0..3], LOCAL\n"
+		"IMM[0] UINT32 {0, 1, 4, 3}\n"
+		"IMM[1] UINT32 {16, 64, 0, 0}\n"
+
+		"UMUL TEMP[0].x, SV[0].xxxx, CONST[0][1].xxxx\n"
+		"UADD TEMP[0].y, TEMP[0].xxxx, CONST[0][1].xxxx\n"
+		"UMIN TEMP[0].y, TEMP[0].yyyy, CONST[0][0].xxxx\n"
+		"MOV TEMP[0].z, TEMP[0].xxxx\n"
+		"MOV TEMP[0].w, IMM[0].xxxx\n"
+		"BGNLOOP\n"
+			"USGE TEMP[1].x, TEMP[0].zzzz, TEMP[0].yyyy\n"
+			"UIF TEMP[1].xxxx\n"
+				"BRK\n"
+			"ENDIF\n"
+			"UMUL TEMP[1].x, TEMP[0].zzzz, IMM[0].zzzz\n"
+			"LOAD TEMP[3].x, BUFFER[0], TEMP[1].xxxx\n"
+			"UADD TEMP[0].w, TEMP[0].wwww, TEMP[3].xxxx\n"
+			"UADD TEMP[0].z, TEMP[0].zzzz, IMM[0].yyyy\n"
+		"ENDLOOP\n"
+
+		"UMUL TEMP[1].x, SV[0].xxxx, IMM[0].zzzz\n"
+		"STORE MEMORY[0].x, TEMP[1].xxxx, TEMP[0].wwww\n"
+		"BARRIER\n"
+
+		/* Add up the counts of the threads before this one. */
+		"MOV TEMP[2].xy, IMM[0].xxxx\n"
+		"MOV TEMP[0].z, IMM[0].xxxx\n"
+		"BGNLOOP\n"
+			"USGE TEMP[1].x, TEMP[0].zzzz, IMM[1].yyyy\n"
+			"UIF TEMP[1].xxxx\n"
+				"BRK\n"
+			"ENDIF\n"
+			"UMUL TEMP[1].x, TEMP[0].zzzz, IMM[0].zzzz\n"
+			"LOAD TEMP[3].x, MEMORY[0], TEMP[1].xxxx\n"
+			"USLT TEMP[1].z, TEMP[0].zzzz, SV[0].xxxx\n"
+			"AND TEMP[1].z, TEMP[1].zzzz, TEMP[3].xxxx\n"
+			"UADD TEMP[2].x, TEMP[2].xxxx, TEMP[1].zzzz\n"
+			"UADD TEMP[2].y, TEMP[2].yyyy, TEMP[3].xxxx\n"
+			"UADD TEMP[0].z, TEMP[0].zzzz, IMM[0].yyyy\n"
+		"ENDLOOP\n"
+
+		/* Store the offsets of the chunks of this thread. */
+		"MOV TEMP[0].z, TEMP[0].xxxx\n"
+		"BGNLOOP\n"
+			"USGE TEMP[1].x, TEMP[0].zzzz, TEMP[0].yyyy\n"
+			"UIF TEMP[1].xxxx\n"
+				"BRK\n"
+			"ENDIF\n"
+			"UMUL TEMP[1].x, TEMP[0].zzzz, IMM[0].zzzz\n"
+			"LOAD TEMP[3].x, BUFFER[0], TEMP[1].xxxx\n"
+			"UMUL TEMP[1].z, TEMP[2].xxxx, IMM[0].wwww\n"
+			"STORE BUFFER[1].x, TEMP[1].xxxx, TEMP[1].zzzz\n"
+			"UADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+			"UADD TEMP[0].z, TEMP[0].zzzz, IMM[0].yyyy\n"
+		"ENDLOOP\n"
+
+		/* count, instance_count, start, index_bias, start_instance */
+		"USEQ TEMP[1].x, SV[0].xxxx, IMM[0].xxxx\n"
+		"UIF TEMP[1].xxxx\n"
+			"UMUL TEMP[3].x, TEMP[2].yyyy, IMM[0].wwww\n"
+			"MOV TEMP[3].y, IMM[0].yyyy\n"
+			"MOV TEMP[3].zw, CONST[0][0].yyyz\n"
+			"STORE BUFFER[2].xyzw, IMM[0].xxxx, TEMP[3]\n"
+			"MOV TEMP[3].x, CONST[0][0].wwww\n"
+			"STORE BUFFER[2].x, IMM[1].xxxx, TEMP[3].xxxx\n"
+		"ENDIF\n"
+		"END\n";
+
+	struct tgsi_token tokens[1024];
+	struct pipe_compute_state state = {};
+
+	if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+		assert(false);
+		return NULL;
+	}
+
+	state.ir_type = PIPE_SHADER_IR_TGSI;
+	state.prog = tokens;
+	state.req_local_mem = 64 * 4;
+
+	return sctx->b.create_compute_state(&sctx->b, &state);
+}
+
+/* Create the compute shader copying the triangles kept in each chunk of
+ * the primitive discard prepass to the compacted index buffer.
+ *
+ * BUFFER[0]: chunk buffer, 32-bit indices
+ * BUFFER[1]: triangle count of each chunk
+ * BUFFER[2]: offset of each chunk in the compacted index buffer, in indices
+ * BUFFER[3]: compacted index buffer
+ *
+ * CONST[0][0].x: num_chunks
+ */
+void *si_create_prim_discard_copy_cs(struct si_context *sctx)
+{
+	/* TEMP[0].x = chunk index
+	 * TEMP[0].y = triangle count of the chunk
+	 * TEMP[0].z = source address
+	 * TEMP[0].w = destination address
+	 */
+	static const char text_tmpl[] =
+		"COMP\n"
+		"PROPERTY CS_FIXED_BLOCK_WIDTH 64\n"
+		"PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+		"PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+		"DCL SV[0], THREAD_ID\n"
+		"DCL SV[1], BLOCK_ID\n"
+		"DCL BUFFER[0]\n"
+		"DCL BUFFER[1]\n"
+		"DCL BUFFER[2]\n"
+		"DCL BUFFER[3]\n"
+		"DCL CONST[0][0]\n"
+		"DCL TEMP[0..2], LOCAL\n"
+		"IMM[0] UINT32 {0, 1, 4, 12}\n"
+		"IMM[1] UINT32 {64, %u, 0, 0}\n"
+
+		"UMAD TEMP[0].x, SV[1].xxxx, IMM[1].xxxx, SV[0].xxxx\n"
+		"USLT TEMP[1].x, TEMP[0].xxxx, CONST[0][0].xxxx\n"
+		"UIF TEMP[1].xxxx\n"
+			"UMUL TEMP[1].x, TEMP[0].xxxx, IMM[0].zzzz\n"
+			"LOAD TEMP[2].x, BUFFER[1], TEMP[1].xxxx\n"
+			"MOV TEMP[0].y, TEMP[2].xxxx\n"
+			"LOAD TEMP[2].x, BUFFER[2], TEMP[1].xxxx\n"
+			"UMUL TEMP[0].w, TEMP[2].xxxx, IMM[0].zzzz\n"
+			"UMUL TEMP[0].z, TEMP[0].xxxx, IMM[1].yyyy\n"
+			"UMUL TEMP[0].z, TEMP[0].zzzz, IMM[0].wwww\n"
+
+			"BGNLOOP\n"
+				"USEQ TEMP[1].x, TEMP[0].yyyy, IMM[0].xxxx\n"
+				"UIF TEMP[1].xxxx\n"
+					"BRK\n"
+				"ENDIF\n"
+				"LOAD TEMP[2].xyz, BUFFER[0], TEMP[0].zzzz\n"
+				"STORE BUFFER[3].xyz, TEMP[0].wwww, TEMP[2]\n"
+				"UADD TEMP[0].y, TEMP[0].yyyy, -IMM[0].yyyy\n"
+				"UADD TEMP[0].zw, TEMP[0], IMM[0].wwww\n"
+			"ENDLOOP\n"
+		"ENDIF\n"
+		"END\n";
+
+	char text[sizeof(text_tmpl) + 32];
+	struct tgsi_token tokens[1024];
+	struct pipe_compute_state state = {};
+
+	snprintf(text, sizeof(text), text_tmpl, SI_PRIM_DISCARD_CHUNK_SIZE);
+
+	if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+		assert(false);
+		return NULL;
+	}
+
+	state.ir_type = PIPE_SHADER_IR_TGSI;
+	state.prog = tokens;
+
+	return sctx->b.create_compute_state(&sctx->b, &state);
+}
+
+/* Create the culling GS inserted after the VS by si_update_cull_gs.
+ *
+ * It passes the triangles through unless they are outside of the same x or
+ * y plane of the clip volume, culled by the face culling state, zero area,
+ * or small enough to miss all pixel centers.
+ *
+ * CONST[0][0]: window space det sign, cull mask if front facing,
+ *              if back facing, front_ccw mask
+ * CONST[0][1]: viewport scale xy, translate xy
+ * CONST[0][2].x: small primitive culling mask
+ */
+void *si_create_cull_gs(struct si_context *sctx, struct si_shader_selector *vs)
+{
+	/* TEMP[0..2] = vertex positions
+	 * TEMP[5].x = culled
+	 * TEMP[5].y = all w > 0
+	 */
+	static const char cull_text[] =
+		/* Cull if all vertices are outside of the same x or y plane
+		 * of the clip volume.
+		 */
+		"FSLT TEMP[3].xy, TEMP[0].xyyy, -TEMP[0].wwww\n"
+		"FSLT TEMP[3].zw, TEMP[0].wwww, TEMP[0].xxxy\n"
+		"FSLT TEMP[4].xy, TEMP[1].xyyy, -TEMP[1].wwww\n"
+		"FSLT TEMP[4].zw, TEMP[1].wwww, TEMP[1].xxxy\n"
+		"AND TEMP[3], TEMP[3], TEMP[4]\n"
+		"FSLT TEMP[4].xy, TEMP[2].xyyy, -TEMP[2].wwww\n"
+		"FSLT TEMP[4].zw, TEMP[2].wwww, TEMP[2].xxxy\n"
+		"AND TEMP[3], TEMP[3], TEMP[4]\n"
+		"OR TEMP[3].xy, TEMP[3].xyyy, TEMP[3].zwww\n"
+		"OR TEMP[5].x, TEMP[3].xxxx, TEMP[3].yyyy\n"
+
+		/* The other tests need all w > 0. */
+		"FSLT TEMP[3].x, IMM[0].xxxx, TEMP[0].wwww\n"
+		"FSLT TEMP[3].y, IMM[0].xxxx, TEMP[1].wwww\n"
+		"FSLT TEMP[3].z, IMM[0].xxxx, TEMP[2].wwww\n"
+		"AND TEMP[3].x, TEMP[3].xxxx, TEMP[3].yyyy\n"
+		"AND TEMP[5].y, TEMP[3].xxxx, TEMP[3].zzzz\n"
+		"UIF TEMP[5].yyyy\n"
+			"RCP TEMP[3].x, TEMP[0].wwww\n"
+			"RCP TEMP[3].y, TEMP[1].wwww\n"
+			"RCP TEMP[3].z, TEMP[2].wwww\n"
+			"MUL TEMP[0].xy, TEMP[0].xyyy, TEMP[3].xxxx\n"
+			"MUL TEMP[1].xy, TEMP[1].xyyy, TEMP[3].yyyy\n"
+			"MUL TEMP[2].xy, TEMP[2].xyyy, TEMP[3].zzzz\n"
+
+			/* e = v0 - v2, f = v1 - v2, det = ex * fy - ey * fx */
+			"ADD TEMP[3].xy, TEMP[0].xyyy, -TEMP[2].xyyy\n"
+			"ADD TEMP[3].zw, TEMP[1].xxxy, -TEMP[2].xxxy\n"
+			"MUL TEMP[4].x, TEMP[3].xxxx, TEMP[3].wwww\n"
+			"MUL TEMP[4].y, TEMP[3].yyyy, TEMP[3].zzzz\n"
+			"ADD TEMP[4].x, TEMP[4].xxxx, -TEMP[4].yyyy\n"
+			"MUL TEMP[4].x, TEMP[4].xxxx, CONST[0][0].xxxx\n"
+
+			/* Counter-clockwise if det < 0, like the primitive
+			 * discard prepass. Zero area triangles are culled.
+			 */
+			"FSLT TEMP[4].y, TEMP[4].xxxx, IMM[0].xxxx\n"
+			"USEQ TEMP[4].y, TEMP[4].yyyy, CONST[0][0].wwww\n"
+			"UCMP TEMP[4].z, TEMP[4].yyyy, CONST[0][0].yyyy, CONST[0][0].zzzz\n"
+			"FSEQ TEMP[4].y, TEMP[4].xxxx, IMM[0].xxxx\n"
+			"OR TEMP[4].z, TEMP[4].zzzz, TEMP[4].yyyy\n"
+			/* Never cull NaNs. */
+			"FSEQ TEMP[4].w, TEMP[4].xxxx, TEMP[4].xxxx\n"
+			"AND TEMP[4].z, TEMP[4].zzzz, TEMP[4].wwww\n"
+			"OR TEMP[5].x, TEMP[5].xxxx, TEMP[4].zzzz\n"
+
+			/* Cull if the window space bounding box, grown by
+			 * the subpixel precision, doesn't contain any pixel
+			 * center in x or y.
+			 */
+			"MAD TEMP[0].xy, TEMP[0].xyyy, CONST[0][1].xyyy, CONST[0][1].zwww\n"
+			"MAD TEMP[1].xy, TEMP[1].xyyy, CONST[0][1].xyyy, CONST[0][1].zwww\n"
+			"MAD TEMP[2].xy, TEMP[2].xyyy, CONST[0][1].xyyy, CONST[0][1].zwww\n"
+			"MIN TEMP[3].xy, TEMP[0].xyyy, TEMP[1].xyyy\n"
+			"MIN TEMP[3].xy, TEMP[3].xyyy, TEMP[2].xyyy\n"
+			"MAX TEMP[3].zw, TEMP[0].xxxy, TEMP[1].xxxy\n"
+			"MAX TEMP[3].zw, TEMP[3].zzzw, TEMP[2].xxxy\n"
+			"ADD TEMP[3].xy, TEMP[3].xyyy, -IMM[0].yyyy\n"
+			"ADD TEMP[3].zw, TEMP[3].zzzw, IMM[0].yyyy\n"
+			"ROUND TEMP[3], TEMP[3]\n"
+			"FSEQ TEMP[3].xy, TEMP[3].xyyy, TEMP[3].zwww\n"
+			"OR TEMP[3].x, TEMP[3].xxxx, TEMP[3].yyyy\n"
+			"AND TEMP[3].x, TEMP[3].xxxx, CONST[0][2].xxxx\n"
+			"OR TEMP[5].x, TEMP[5].xxxx, TEMP[3].xxxx\n"
+		"ENDIF\n"
+
+		"NOT TEMP[5].x, TEMP[5].xxxx\n"
+		"UIF TEMP[5].xxxx\n";
+
+	const struct tgsi_shader_info *info = &vs->info;
+	struct tgsi_token tokens[2048];
+	struct pipe_shader_state state = {};
+	unsigned pos_index = 0;
+	char *text;
+	size_t size = 0;
+	FILE *f = open_memstream(&text, &size);
+
+	if (!f)
+		return NULL;
+
+	fprintf(f, "GEOM\n"
+		"PROPERTY GS_INPUT_PRIMITIVE TRIANGLES\n"
+		"PROPERTY GS_OUTPUT_PRIMITIVE TRIANGLE_STRIP\n"
+		"PROPERTY GS_MAX_OUTPUT_VERTICES 3\n"
+		"PROPERTY GS_INVOCATIONS 1\n");
+	if (info->properties[TGSI_PROPERTY_NUM_CLIPDIST_ENABLED]) {
+		fprintf(f, "PROPERTY NUM_CLIPDIST_ENABLED %u\n",
+			info->properties[TGSI_PROPERTY_NUM_CLIPDIST_ENABLED]);
+	}
+	if (info->properties[TGSI_PROPERTY_NUM_CULLDIST_ENABLED]) {
+		fprintf(f, "PROPERTY NUM_CULLDIST_ENABLED %u\n",
+			info->properties[TGSI_PROPERTY_NUM_CULLDIST_ENABLED]);
+	}
+
+	for (unsigned i = 0; i < info->num_outputs; i++) {
+		const char *name =
+			tgsi_semantic_names[info->output_semantic_name[i]];
+		unsigned index = info->output_semantic_index[i];
+
+		/* Skip holes between the declared outputs. */
+		if (!info->output_usagemask[i])
+			continue;
+
+		if (info->output_semantic_name[i] == TGSI_SEMANTIC_POSITION)
+			pos_index = i;
+
+		fprintf(f, "DCL IN[][%u], %s[%u]\n", i, name, index);
+		fprintf(f, "DCL OUT[%u], %s[%u]\n", i, name, index);
+	}
+
+	fprintf(f, "DCL CONST[0][0..2]\n"
+		"DCL TEMP[0..5]\n"
+		"IMM[0] FLT32 {0, 0.00390625, 0, 0}\n"
+		"IMM[1] UINT32 {0, 0, 0, 0}\n");
+
+	for (unsigned v = 0; v < 3; v++)
+		fprintf(f, "MOV TEMP[%u], IN[%u][%u]\n", v, v, pos_index);
+
+	fputs(cull_text, f);
+
+	for (unsigned v = 0; v < 3; v++) {
+		for (unsigned i = 0; i < info->num_outputs; i++) {
+			if (info->output_usagemask[i])
+				fprintf(f, "MOV OUT[%u], IN[%u][%u]\n", i, v, i);
+		}
+		fputs("EMIT IMM[1].xxxx\n", f);
+	}
+	fputs("ENDIF\n"
+	      "END\n", f);
+	fclose(f);
+
+	if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+		assert(false);
+		free(text);
+		return NULL;
+	}
+	free(text);
+
+	state.type = PIPE_SHADER_IR_TGSI;
+	state.tokens = tokens;
+
+	return sctx->b.create_gs_state(&sctx->b, &state);
+}
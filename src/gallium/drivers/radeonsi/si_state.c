@@ -874,8 +874,14 @@ static void *si_create_rs_state(struct pipe_context *ctx,
 	rs->clamp_fragment_color = state->clamp_fragment_color;
 	rs->clamp_vertex_color = state->clamp_vertex_color;
 	rs->flatshade = state->flatshade;
+	rs->flatshade_first = state->flatshade_first;
 	rs->sprite_coord_enable = state->sprite_coord_enable;
 	rs->rasterizer_discard = state->rasterizer_discard;
+	rs->cull_front = !!(state->cull_face & PIPE_FACE_FRONT);
+	rs->cull_back = !!(state->cull_face & PIPE_FACE_BACK);
+	rs->front_ccw = state->front_ccw;
+	rs->poly_mode = state->fill_front != PIPE_POLYGON_MODE_FILL ||
+			state->fill_back != PIPE_POLYGON_MODE_FILL;
 	rs->pa_sc_line_stipple = state->line_stipple_enable ?
 				S_028A0C_LINE_PATTERN(state->line_stipple_pattern) |
 				S_028A0C_REPEAT_COUNT(state->line_stipple_factor) : 0;
@@ -2712,6 +2718,8 @@ void si_update_fb_dirtiness_after_rendering(struct si_context *sctx)
 			tex->dirty_level_mask |= 1 << surf->u.tex.level;
 		if (tex->dcc_gather_statistics)
 			tex->separate_dcc_dirty = true;
+		if (tex->dcc_image_store_decompress)
+			tex->dcc_image_store_dirty = true;
 	}
 }
 
@@ -2932,6 +2940,12 @@ static void si_set_framebuffer_state(struct pipe_context *ctx,
 			sctx->framebuffer.compressed_cb_mask |= 1 << i;
 			vi_separate_dcc_start_query(sctx, tex);
 		}
+
+		if (tex->dcc_image_store_decompress) {
+			/* Dirty tracking decides when DCC is decompressed. */
+			sctx->framebuffer.compressed_cb_mask |= 1 << i;
+			tex->num_dcc_image_store_fb_binds++;
+		}
 	}
 
 	/* For optimal DCC performance. */
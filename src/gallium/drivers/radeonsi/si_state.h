@@ -73,6 +73,7 @@ struct si_state_rasterizer {
 	unsigned		clip_plane_enable:8;
 	unsigned		half_pixel_center:1;
 	unsigned		flatshade:1;
+	unsigned		flatshade_first:1;
 	unsigned		two_side:1;
 	unsigned		multisample_enable:1;
 	unsigned		force_persample_interp:1;
@@ -86,6 +87,10 @@ struct si_state_rasterizer {
 	unsigned		rasterizer_discard:1;
 	unsigned		scissor_enable:1;
 	unsigned		clip_halfz:1;
+	unsigned		cull_front:1;
+	unsigned		cull_back:1;
+	unsigned		front_ccw:1;
+	unsigned		poly_mode:1;
 };
 
 struct si_dsa_stencil_ref_part {
@@ -405,6 +410,10 @@ struct si_descriptors {
 	/* If there is only one slot enabled, bind it directly instead of
 	 * uploading descriptors. -1 if disabled. */
 	signed char slot_index_to_bind_directly;
+
+	/* With the descriptor heap, the heap slot of each 8-dword unit of the
+	 * list. These are uploaded instead of the list. */
+	uint32_t *heap_indices;
 };
 
 struct si_buffer_resources {
@@ -449,6 +458,9 @@ void si_set_mutable_tex_desc_fields(struct si_screen *sscreen,
 void si_update_ps_colorbuf0_slot(struct si_context *sctx);
 void si_get_pipe_constant_buffer(struct si_context *sctx, uint shader,
 				 uint slot, struct pipe_constant_buffer *cbuf);
+void si_swap_cull_gs_const_buffer(struct si_context *sctx, bool bind);
+void si_set_cull_gs_constants(struct si_context *sctx, const void *data,
+			      unsigned size);
 void si_get_shader_buffers(struct si_context *sctx,
 			   enum pipe_shader_type shader,
 			   uint start_slot, uint count,
@@ -533,6 +545,8 @@ bool si_shader_cache_insert_shader(struct si_screen *sscreen, void *ir_binary,
 				   struct si_shader *shader,
 				   bool insert_into_disk_cache);
 bool si_update_shaders(struct si_context *sctx);
+void si_update_cull_gs(struct si_context *sctx,
+		       const struct pipe_draw_info *info);
 void si_init_shader_functions(struct si_context *sctx);
 bool si_init_shader_cache(struct si_screen *sscreen);
 void si_destroy_shader_cache(struct si_screen *sscreen);
@@ -1249,7 +1249,48 @@ static void si_emit_all_states(struct si_context *sctx, const struct pipe_draw_i
 	si_emit_draw_registers(sctx, info, num_patches);
 }
 
-static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+/* An upper bound of the dwords emitted by si_emit_draw_packets for a direct
+ * draw.
+ */
+#define SI_MAX_DIRECT_DRAW_DWORDS	16
+
+/* Emit the draw packets of one draw, or of each draw of a multi-draw. */
+static void si_emit_draws(struct si_context *sctx,
+			  const struct pipe_draw_info *info,
+			  const struct pipe_draw_start_count *draws,
+			  unsigned num_draws,
+			  struct pipe_resource *indexbuf,
+			  unsigned index_size,
+			  unsigned index_offset)
+{
+	if (!draws) {
+		si_emit_draw_packets(sctx, info, indexbuf, index_size,
+				     index_offset);
+		return;
+	}
+
+	struct pipe_draw_info draw = *info;
+
+	for (unsigned i = 0; i < num_draws; i++) {
+		if (!draws[i].count)
+			continue;
+
+		draw.start = draws[i].start;
+		draw.count = draws[i].count;
+		draw.index_bias = draws[i].index_bias;
+		draw.drawid = info->drawid + i;
+		si_emit_draw_packets(sctx, &draw, indexbuf, index_size,
+				     index_offset);
+	}
+}
+
+/* Validate and emit the states once, then draw either info alone (draws is
+ * NULL), or each of the draws of a multi-draw.
+ */
+static void si_draw(struct pipe_context *ctx,
+		    const struct pipe_draw_info *info,
+		    const struct pipe_draw_start_count *draws,
+		    unsigned num_draws)
 {
 	struct si_context *sctx = (struct si_context *)ctx;
 	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
@@ -1268,7 +1309,7 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 			return;
 
 		/* Handle count == 0. */
-		if (unlikely(!info->count &&
+		if (unlikely(!draws && !info->count &&
 			     (index_size || !info->count_from_stream_output)))
 			return;
 	}
@@ -1281,6 +1322,10 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 		return;
 	}
 
+	if (unlikely(sctx->screen->debug_flags & DBG(PRIM_DISCARD)) &&
+	    !draws && si_prim_discard_draw(sctx, info))
+		return;
+
 	/* Recompute and re-emit the texture resource states if needed. */
 	dirty_tex_counter = p_atomic_read(&sctx->screen->dirty_tex_counter);
 	if (unlikely(dirty_tex_counter != sctx->last_dirty_tex_counter)) {
@@ -1294,6 +1339,9 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 
 	si_decompress_textures(sctx, u_bit_consecutive(0, SI_NUM_GRAPHICS_SHADERS));
 
+	if (unlikely(sctx->screen->debug_flags & DBG(CULL_GS)))
+		si_update_cull_gs(sctx, info);
+
 	/* Set the rasterization primitive type.
 	 *
 	 * This must be done after si_decompress_textures, which can call
@@ -1367,6 +1415,9 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 			unsigned start, count, start_offset, size, offset;
 			void *ptr;
 
+			/* si_multi_draw doesn't get here. */
+			assert(!draws);
+
 			si_get_draw_start_count(sctx, info, &start, &count);
 			start_offset = start * 2;
 			size = count * 2;
@@ -1389,7 +1440,7 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 		} else if (info->has_user_indices) {
 			unsigned start_offset;
 
-			assert(!info->indirect);
+			assert(!info->indirect && !draws);
 			start_offset = info->start * index_size;
 
 			indexbuf = NULL;
@@ -1435,6 +1486,13 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 
 	si_need_gfx_cs_space(sctx);
 
+	/* si_need_gfx_cs_space only reserves space for one draw. */
+	if (draws &&
+	    !sctx->ws->cs_check_space(sctx->gfx_cs,
+				      si_get_minimum_num_gfx_cs_dwords(sctx) +
+				      num_draws * SI_MAX_DIRECT_DRAW_DWORDS))
+		si_flush_gfx_cs(sctx, RADEON_FLUSH_ASYNC_START_NEXT_GFX_IB_NOW, NULL);
+
 	if (sctx->bo_list_add_all_gfx_resources)
 		si_gfx_resources_add_all_to_bo_list(sctx);
 
@@ -1492,7 +1550,8 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 
 		sctx->dirty_atoms = 0;
 
-		si_emit_draw_packets(sctx, info, indexbuf, index_size, index_offset);
+		si_emit_draws(sctx, info, draws, num_draws, indexbuf, index_size,
+			      index_offset);
 		/* <-- CUs are busy here. */
 
 		/* Start prefetches after the draw has been started. Both will run
@@ -1523,7 +1582,8 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 
 		sctx->dirty_atoms = 0;
 
-		si_emit_draw_packets(sctx, info, indexbuf, index_size, index_offset);
+		si_emit_draws(sctx, info, draws, num_draws, indexbuf, index_size,
+			      index_offset);
 
 		/* Prefetch the remaining shaders after the draw has been
 		 * started. */
@@ -1551,7 +1611,7 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 	if (unlikely(sctx->decompression_enabled)) {
 		sctx->num_decompress_calls++;
 	} else {
-		sctx->num_draw_calls++;
+		sctx->num_draw_calls += draws ? num_draws : 1;
 		if (sctx->framebuffer.state.nr_cbufs > 1)
 			sctx->num_mrt_draw_calls++;
 		if (info->primitive_restart)
@@ -1565,6 +1625,45 @@ return_cleanup:
 		pipe_resource_reference(&indexbuf, NULL);
 }
 
+static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+{
+	si_draw(ctx, info, NULL, 1);
+}
+
+static void si_multi_draw(struct pipe_context *ctx,
+			  const struct pipe_draw_info *info,
+			  const struct pipe_draw_start_count *draws,
+			  unsigned num_draws)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+	/* Limit the CS space that has to be reserved at once. */
+	const unsigned max_draws = 256;
+
+	assert(!info->indirect && !info->count_from_stream_output);
+	assert(!info->has_user_indices);
+
+	/* Instancing makes IA_MULTI_VGT_PARAM depend on the vertex count and
+	 * 8-bit indices are translated per draw before VI, so do separate
+	 * draws then.
+	 */
+	if (info->instance_count > 1 ||
+	    (sctx->chip_class <= CIK && info->index_size == 1)) {
+		struct pipe_draw_info draw = *info;
+
+		for (unsigned i = 0; i < num_draws; i++) {
+			draw.start = draws[i].start;
+			draw.count = draws[i].count;
+			draw.index_bias = draws[i].index_bias;
+			draw.drawid = info->drawid + i;
+			si_draw(ctx, &draw, NULL, 1);
+		}
+		return;
+	}
+
+	for (unsigned i = 0; i < num_draws; i += max_draws)
+		si_draw(ctx, info, draws + i, MIN2(num_draws - i, max_draws));
+}
+
 static void
 si_draw_rectangle(struct blitter_context *blitter,
 		  void *vertex_elements_cso,
@@ -1629,6 +1728,7 @@ void si_trace_emit(struct si_context *sctx)
 void si_init_draw_functions(struct si_context *sctx)
 {
 	sctx->b.draw_vbo = si_draw_vbo;
+	sctx->b.multi_draw = si_multi_draw;
 
 	sctx->blitter->draw_rectangle = si_draw_rectangle;
 
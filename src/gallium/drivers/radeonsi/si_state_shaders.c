@@ -58,7 +58,7 @@ void *si_get_ir_binary(struct si_shader_selector *sel)
 		assert(sel->nir);
 
 		blob_init(&blob);
-		nir_serialize(&blob, sel->nir);
+		nir_serialize(&blob, sel->nir, true);
 		ir_binary = blob.data;
 		ir_size = blob.size;
 	}
@@ -1678,6 +1678,12 @@ static inline void si_shader_selector_key(struct pipe_context *ctx,
 		assert(0);
 	}
 
+	/* The main parts are compiled with less optimizations, so always
+	 * compile optimized variants to replace them.
+	 */
+	if (unlikely(sctx->screen->debug_flags & DBG(FAST_COMPILE)))
+		key->opt.prefer_mono = 1;
+
 	if (unlikely(sctx->screen->debug_flags & DBG(NO_OPT_VARIANT)))
 		memset(&key->opt, 0, sizeof(key->opt));
 }
@@ -1738,6 +1744,165 @@ static void si_build_shader_variant_low_priority(void *job, int thread_index)
 
 static const struct si_shader_key zeroed;
 
+/* Variant prediction
+ *
+ * When a shader selector is destroyed, the keys of its monolithic variants
+ * used the most are stored in the disk cache. The next time the same shader
+ * is created, these variants are compiled on the low priority queue right
+ * away, so that they are likely ready when draws need them.
+ */
+#define SI_MAX_RECORDED_VARIANTS 8
+
+struct si_recorded_variant {
+	uint32_t		use_count;
+	struct si_shader_key	key;
+};
+
+static bool si_variant_can_be_recorded(struct si_shader_selector *sel,
+				       const struct si_shader_key *key)
+{
+	/* The keys of merged shaders point to the first shader. */
+	if (sel->type == PIPE_SHADER_TESS_CTRL && key->part.tcs.ls)
+		return false;
+	if (sel->type == PIPE_SHADER_GEOMETRY && key->part.gs.es)
+		return false;
+	return true;
+}
+
+static void si_record_variants(struct si_screen *sscreen,
+			       struct si_shader_selector *sel)
+{
+	struct si_recorded_variant variants[SI_MAX_RECORDED_VARIANTS];
+	struct si_shader *shader;
+	unsigned num = 0, i;
+
+	if (!sscreen->disk_shader_cache ||
+	    !sel->has_variants_cache_key ||
+	    !sel->variants_used)
+		return;
+
+	memset(variants, 0, sizeof(variants));
+
+	/* Keep the most used variants, sorted. */
+	for (shader = sel->first_variant; shader; shader = shader->next_variant) {
+		if (!shader->is_monolithic ||
+		    !util_queue_fence_is_signalled(&shader->ready) ||
+		    shader->compilation_failed ||
+		    !si_variant_can_be_recorded(sel, &shader->key))
+			continue;
+
+		if (num == SI_MAX_RECORDED_VARIANTS &&
+		    variants[num - 1].use_count >= shader->use_count)
+			continue;
+
+		i = num < SI_MAX_RECORDED_VARIANTS ? num++ : num - 1;
+		for (; i > 0 && variants[i - 1].use_count < shader->use_count; i--)
+			variants[i] = variants[i - 1];
+
+		variants[i].use_count = shader->use_count;
+		variants[i].key = shader->key;
+	}
+
+	if (!num)
+		return;
+
+	unsigned size = 3 * 4 + num * sizeof(variants[0]);
+	uint32_t *buffer = MALLOC(size);
+	if (!buffer)
+		return;
+
+	buffer[0] = size;
+	buffer[1] = sizeof(struct si_shader_key);
+	buffer[2] = num;
+	memcpy(buffer + 3, variants, num * sizeof(variants[0]));
+
+	disk_cache_put(sscreen->disk_shader_cache, sel->variants_cache_key,
+		       buffer, size, NULL);
+	FREE(buffer);
+}
+
+static void si_precompile_recorded_variants(struct si_screen *sscreen,
+					    struct si_shader_selector *sel)
+{
+	const struct si_recorded_variant *variants;
+	uint32_t *buffer;
+	size_t size;
+	unsigned i;
+
+	if (!sscreen->disk_shader_cache || !sel->has_variants_cache_key)
+		return;
+
+	buffer = disk_cache_get(sscreen->disk_shader_cache,
+				sel->variants_cache_key, &size);
+	if (!buffer)
+		return;
+
+	if (size < 3 * 4 ||
+	    buffer[0] != size ||
+	    buffer[1] != sizeof(struct si_shader_key) ||
+	    buffer[2] > SI_MAX_RECORDED_VARIANTS ||
+	    size != 3 * 4 + buffer[2] * sizeof(variants[0])) {
+		disk_cache_remove(sscreen->disk_shader_cache,
+				  sel->variants_cache_key);
+		free(buffer);
+		return;
+	}
+
+	variants = (const struct si_recorded_variant *)(buffer + 3);
+
+	for (i = 0; i < buffer[2]; i++) {
+		const struct si_shader_key *key = &variants[i].key;
+		struct si_shader *shader;
+
+		if (!si_variant_can_be_recorded(sel, key))
+			continue;
+
+		/* Same as in si_shader_select_with_key. */
+		bool is_pure_monolithic =
+			sscreen->use_monolithic_shaders ||
+			memcmp(&key->mono, &zeroed.mono, sizeof(key->mono)) != 0;
+		bool is_optimized =
+			!is_pure_monolithic &&
+			memcmp(&key->opt, &zeroed.opt, sizeof(key->opt)) != 0;
+
+		if (!is_pure_monolithic && !is_optimized)
+			continue;
+
+		shader = CALLOC_STRUCT(si_shader);
+		if (!shader)
+			break;
+
+		util_queue_fence_init(&shader->ready);
+
+		/* No debug callback: the context may not exist anymore when
+		 * the compilation starts. */
+		shader->selector = sel;
+		shader->key = *key;
+		shader->is_monolithic = true;
+		shader->is_optimized = is_optimized;
+		shader->is_precompiled = true;
+		/* Halve the count, so that variants that aren't used anymore
+		 * are eventually replaced. */
+		shader->use_count = variants[i].use_count / 2;
+
+		mtx_lock(&sel->mutex);
+		util_queue_add_job(&sscreen->shader_compiler_queue_low_priority,
+				   shader, &shader->ready,
+				   si_build_shader_variant_low_priority, NULL);
+
+		if (!sel->last_variant) {
+			sel->first_variant = shader;
+			sel->last_variant = shader;
+		} else {
+			sel->last_variant->next_variant = shader;
+			sel->last_variant = shader;
+		}
+		mtx_unlock(&sel->mutex);
+	}
+
+	free(buffer);
+}
+
 static bool si_check_missing_main_part(struct si_screen *sscreen,
 				       struct si_shader_selector *sel,
 				       struct si_compiler_ctx_state *compiler_state,
@@ -1820,6 +1985,9 @@ current_not_ready:
 		/* Don't check the "current" shader. We checked it above. */
 		if (current != iter &&
 		    memcmp(&iter->key, key, sizeof(*key)) == 0) {
+			iter->use_count++;
+			if (iter->is_monolithic)
+				sel->variants_used = true;
 			mtx_unlock(&sel->mutex);
 
 			if (unlikely(!util_queue_fence_is_signalled(&iter->ready))) {
@@ -1930,6 +2098,10 @@ current_not_ready:
 		!is_pure_monolithic &&
 		memcmp(&key->opt, &zeroed.opt, sizeof(key->opt)) != 0;
 
+	shader->use_count = 1;
+	if (shader->is_monolithic)
+		sel->variants_used = true;
+
 	/* If it's an optimized shader, compile it asynchronously. */
 	if (shader->is_optimized &&
 	    !is_pure_monolithic &&
@@ -2076,6 +2248,21 @@ static void si_init_shader_selector_async(void *job, int thread_index)
 		if (sel->tokens || sel->nir)
 			ir_binary = si_get_ir_binary(sel);
 
+		/* The key of the recorded variants, see si_record_variants. */
+		if (ir_binary && sscreen->disk_shader_cache) {
+			static const char prefix[] = "radeonsi variants";
+			struct mesa_sha1 ctx;
+			unsigned char sha1[20];
+
+			_mesa_sha1_init(&ctx);
+			_mesa_sha1_update(&ctx, prefix, sizeof(prefix));
+			_mesa_sha1_update(&ctx, ir_binary, *(uint32_t*)ir_binary);
+			_mesa_sha1_final(&ctx, sha1);
+			disk_cache_compute_key(sscreen->disk_shader_cache, sha1,
+					       sizeof(sha1), sel->variants_cache_key);
+			sel->has_variants_cache_key = true;
+		}
+
 		/* Try to load the shader from the shader cache. */
 		mtx_lock(&sscreen->shader_cache_mutex);
 
@@ -2158,6 +2345,8 @@ static void si_init_shader_selector_async(void *job, int thread_index)
 
 		si_shader_vs(sscreen, sel->gs_copy_shader, sel);
 	}
+
+	si_precompile_recorded_variants(sscreen, sel);
 }
 
 void si_schedule_initial_compile(struct si_context *sctx, unsigned processor,
@@ -2562,10 +2751,16 @@ static void si_bind_gs_shader(struct pipe_context *ctx, void *state)
 	struct si_shader *old_hw_vs_variant = si_get_vs_state(sctx);
 	struct si_shader_selector *sel = state;
 	bool enable_changed = !!sctx->gs_shader.cso != !!sel;
+	bool cull_gs_changed =
+		(sctx->gs_shader.cso && sctx->gs_shader.cso->is_cull_gs) !=
+		(sel && sel->is_cull_gs);
 
 	if (sctx->gs_shader.cso == sel)
 		return;
 
+	if (cull_gs_changed)
+		si_swap_cull_gs_const_buffer(sctx, sel && sel->is_cull_gs);
+
 	sctx->gs_shader.cso = sel;
 	sctx->gs_shader.current = sel ? sel->first_variant : NULL;
 	sctx->ia_multi_vgt_param_key.u.uses_gs = sel != NULL;
@@ -2671,7 +2866,7 @@ static void si_bind_ps_shader(struct pipe_context *ctx, void *state)
 
 static void si_delete_shader(struct si_context *sctx, struct si_shader *shader)
 {
-	if (shader->is_optimized) {
+	if (shader->is_optimized || shader->is_precompiled) {
 		util_queue_drop_job(&sctx->screen->shader_compiler_queue_low_priority,
 				    &shader->ready);
 	}
@@ -2733,6 +2928,8 @@ void si_destroy_shader_selector(struct si_context *sctx,
 
 	util_queue_drop_job(&sctx->screen->shader_compiler_queue, &sel->ready);
 
+	si_record_variants(sctx->screen, sel);
+
 	if (current_shader[sel->type]->cso == sel) {
 		current_shader[sel->type]->cso = NULL;
 		current_shader[sel->type]->current = NULL;
@@ -2752,6 +2949,13 @@ void si_destroy_shader_selector(struct si_context *sctx,
 		si_delete_shader(sctx, sel->main_shader_part_es);
 	if (sel->gs_copy_shader)
 		si_delete_shader(sctx, sel->gs_copy_shader);
+	if (sel->prim_discard_pos_vs)
+		si_shader_selector_reference(sctx, &sel->prim_discard_pos_vs, NULL);
+	if (sel->cull_gs) {
+		if (sctx->gs_shader.cso == sel->cull_gs)
+			si_bind_gs_shader(&sctx->b, NULL);
+		si_shader_selector_reference(sctx, &sel->cull_gs, NULL);
+	}
 
 	util_queue_fence_destroy(&sel->ready);
 	mtx_destroy(&sel->mutex);
@@ -3327,6 +3531,118 @@ static void si_update_vgt_shader_config(struct si_context *sctx)
 	si_pm4_bind_state(sctx, vgt_shader_config, *pm4);
 }
 
+/* The culling GS is a primitive shader for the VS: on GFX9, where the ES
+ * and the GS are merged, it culls the triangles in the same shader as the
+ * VS, before they reach the primitive assembler and the rasterizer.
+ *
+ * Only draws whose result doesn't change with the GS use it.
+ */
+static bool si_cull_gs_supported(struct si_context *sctx,
+				 const struct pipe_draw_info *info)
+{
+	struct si_shader_selector *vs = sctx->vs_shader.cso;
+	struct si_shader_selector *ps = sctx->ps_shader.cso;
+	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
+
+	if (sctx->chip_class < GFX9 || sctx->blitter->running)
+		return false;
+
+	/* The GS input triangles of strips only keep the provoking vertex
+	 * in place if it's the last one, and those of fans never do. */
+	if (info->mode != PIPE_PRIM_TRIANGLES &&
+	    (info->mode != PIPE_PRIM_TRIANGLE_STRIP || rs->flatshade_first))
+		return false;
+
+	if (sctx->tes_shader.cso ||
+	    sctx->streamout.num_targets ||
+	    sctx->streamout.num_prims_gen_queries ||
+	    rs->rasterizer_discard ||
+	    rs->poly_mode)
+		return false;
+
+	if (!vs->tokens ||
+	    !vs->info.writes_position ||
+	    vs->info.writes_edgeflag ||
+	    vs->info.writes_viewport_index ||
+	    vs->info.properties[TGSI_PROPERTY_VS_WINDOW_SPACE_POSITION] ||
+	    vs->info.properties[TGSI_PROPERTY_VS_BLIT_SGPRS])
+		return false;
+
+	/* Primitive IDs aren't passed through. */
+	if (ps && ps->info.uses_primid)
+		return false;
+
+	return true;
+}
+
+static struct si_shader_selector *
+si_get_cull_gs(struct si_context *sctx, struct si_shader_selector *vs)
+{
+	mtx_lock(&vs->mutex);
+	if (!vs->cull_gs) {
+		vs->cull_gs = si_create_cull_gs(sctx, vs);
+		if (vs->cull_gs)
+			vs->cull_gs->is_cull_gs = true;
+	}
+	mtx_unlock(&vs->mutex);
+
+	return vs->cull_gs;
+}
+
+static void si_update_cull_gs_constants(struct si_context *sctx)
+{
+	struct pipe_viewport_state *vp = &sctx->viewports.states[0];
+	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
+	union {
+		uint32_t u;
+		float f;
+	} constants[12] = {};
+
+	/* The face is determined in window space. */
+	constants[0].f = vp->scale[0] * vp->scale[1] < 0 ? -1 : 1;
+	constants[1].u = rs->cull_front ? ~0u : 0;
+	constants[2].u = rs->cull_back ? ~0u : 0;
+	constants[3].u = rs->front_ccw ? ~0u : 0;
+	constants[4].f = vp->scale[0];
+	constants[5].f = vp->scale[1];
+	constants[6].f = vp->translate[0];
+	constants[7].f = vp->translate[1];
+	/* Small primitives can only be culled if pixels are covered by
+	 * their center alone. */
+	constants[8].u = rs->half_pixel_center && !rs->poly_smooth &&
+			 (!rs->multisample_enable ||
+			  sctx->framebuffer.nr_samples <= 1) ? ~0u : 0;
+
+	if (sctx->cull_gs_constants_valid &&
+	    !memcmp(sctx->cull_gs_constants, constants, sizeof(constants)))
+		return;
+
+	memcpy(sctx->cull_gs_constants, constants, sizeof(constants));
+	sctx->cull_gs_constants_valid = true;
+	si_set_cull_gs_constants(sctx, constants, sizeof(constants));
+}
+
+/* Bind or unbind the culling GS for the draw, unless the application has
+ * bound a GS.
+ */
+void si_update_cull_gs(struct si_context *sctx,
+		       const struct pipe_draw_info *info)
+{
+	struct si_shader_selector *gs = sctx->gs_shader.cso;
+	struct si_shader_selector *cull_gs = NULL;
+
+	if (gs && !gs->is_cull_gs)
+		return;
+
+	if (si_cull_gs_supported(sctx, info))
+		cull_gs = si_get_cull_gs(sctx, sctx->vs_shader.cso);
+
+	if (cull_gs != gs)
+		si_bind_gs_shader(&sctx->b, cull_gs);
+	if (cull_gs)
+		si_update_cull_gs_constants(sctx);
+}
+
 bool si_update_shaders(struct si_context *sctx)
 {
 	struct pipe_context *ctx = (struct pipe_context*)sctx;
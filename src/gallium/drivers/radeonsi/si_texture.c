@@ -442,6 +442,7 @@ static bool si_texture_discard_dcc(struct si_screen *sscreen,
 	tex->dcc_offset = 0;
 	tex->display_dcc_offset = 0;
 	tex->dcc_retile_map_offset = 0;
+	tex->dcc_image_store_decompress = false;
 
 	/* Notify all contexts about the change. */
 	p_atomic_inc(&sscreen->dirty_tex_counter);
@@ -490,7 +491,53 @@ bool si_texture_disable_dcc(struct si_context *sctx,
 	if (&sctx->b == sscreen->aux_context)
 		mtx_unlock(&sscreen->aux_context_lock);
 
-	return si_texture_discard_dcc(sscreen, tex);
+	if (!si_texture_discard_dcc(sscreen, tex))
+		return false;
+
+	sctx->num_dcc_disables++;
+	return true;
+}
+
+/**
+ * Return whether DCC of a texture that is being bound as a writable shader
+ * image should be kept instead of disabled. If so, DCC is decompressed before
+ * draws and dispatches using the image, but only if it has been rendered to
+ * since the last decompression.
+ *
+ * This pays off if the texture is rendered to much more often than it is
+ * written by image stores after rendering, so DCC is disabled after all
+ * if decompressions turn out to be frequent.
+ */
+bool si_texture_keep_dcc_for_image_stores(struct si_context *sctx,
+					  struct si_texture *tex)
+{
+	/* DCC can't be decompressed without graphics. */
+	if (!sctx->has_graphics)
+		return false;
+
+	if (tex->dcc_image_store_decompress) {
+		if (tex->num_dcc_image_store_decompresses >= 8 &&
+		    tex->num_dcc_image_store_decompresses * 4 >
+		    tex->num_dcc_image_store_fb_binds) {
+			tex->dcc_image_store_decompress = false;
+			return false;
+		}
+		return true;
+	}
+
+	tex->dcc_image_store_decompress = true;
+	tex->dcc_image_store_dirty = true;
+	tex->num_dcc_image_store_fb_binds = 0;
+	tex->num_dcc_image_store_decompresses = 0;
+
+	/* Enable dirty tracking if the texture is bound as a color buffer. */
+	for (unsigned i = 0; i < sctx->framebuffer.state.nr_cbufs; i++) {
+		struct pipe_surface *surf = sctx->framebuffer.state.cbufs[i];
+
+		if (surf && surf->texture == &tex->buffer.b.b)
+			sctx->framebuffer.compressed_cb_mask |= 1 << i;
+	}
+	return true;
 }
 
 static void si_reallocate_texture_inplace(struct si_context *sctx,
@@ -2028,7 +2075,16 @@ static void si_texture_transfer_unmap(struct pipe_context *ctx,
 						  &stransfer->staging->b.b, transfer->level,
 						  &transfer->box);
 		} else {
+			unsigned num_dma_calls = sctx->num_dma_calls;
+
 			si_copy_from_staging_texture(ctx, stransfer);
+
+			/* Submit large SDMA uploads right away, so that they
+			 * execute while the gfx IB is being recorded.
+			 */
+			if (sctx->num_dma_calls != num_dma_calls &&
+			    stransfer->staging->buf->size >= SI_SDMA_UPLOAD_MIN_SIZE)
+				si_flush_dma_cs(sctx, PIPE_FLUSH_ASYNC, NULL);
 		}
 	}
 
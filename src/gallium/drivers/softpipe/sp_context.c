@@ -44,6 +44,7 @@
 #include "sp_context.h"
 #include "sp_flush.h"
 #include "sp_prim_vbuf.h"
+#include "sp_rast.h"
 #include "sp_state.h"
 #include "sp_surface.h"
 #include "sp_tile_cache.h"
@@ -75,6 +76,8 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
+   sp_rast_destroy(softpipe->rast);
+
    if (softpipe->quad.shade)
       softpipe->quad.shade->destroy( softpipe->quad.shade );
 
@@ -319,6 +322,10 @@ softpipe_create_context(struct pipe_screen *screen,
    if (debug_get_bool_option( "SOFTPIPE_NO_RAST", FALSE ))
       softpipe->no_rast = TRUE;
 
+   softpipe->rast = sp_rast_create(softpipe,
+                                   debug_get_num_option("SOFTPIPE_NUM_THREADS",
+                                                        0));
+
    softpipe->vbuf_backend = sp_create_vbuf_backend(softpipe);
    if (!softpipe->vbuf_backend)
       goto fail;
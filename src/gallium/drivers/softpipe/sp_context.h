@@ -56,6 +56,7 @@ struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
 struct sp_so_state;
+struct sp_rast;
 
 struct softpipe_context {
    struct pipe_context pipe;  /**< base class */
@@ -183,6 +184,9 @@ struct softpipe_context {
    /** The primitive drawing context */
    struct draw_context *draw;
 
+   /** Rasterization threads, NULL if rasterizing on the calling thread */
+   struct sp_rast *rast;
+
    /** Draw module backend */
    struct vbuf_render *vbuf_backend;
    struct draw_stage *vbuf;
@@ -37,6 +37,7 @@
 
 
 #include "sp_context.h"
+#include "sp_rast.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "sp_prim_vbuf.h"
@@ -49,6 +50,10 @@
 #define SP_MAX_VBUF_INDEXES 1024
 #define SP_MAX_VBUF_SIZE    4096
 
+/** Larger batches for the rasterization threads, see sp_rast.c */
+#define SP_MAX_VBUF_INDEXES_MT 8192
+#define SP_MAX_VBUF_SIZE_MT    (128 * 1024)
+
 typedef const float (*cptrf4)[4];
 
 /**
@@ -154,16 +159,25 @@ static inline cptrf4 get_vert( const void *vertex_buffer,
 
 
 /**
- * draw elements / indexed primitives
+ * The primitives of a draw_elements/arrays call, for sp_rast_draw().
  */
+struct sp_vbuf_prims
+{
+   struct softpipe_vbuf_render *cvbr;
+   const ushort *indices;
+   uint start;
+   uint nr;
+};
+
+
 static void
-sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+draw_elements(struct softpipe_vbuf_render *cvbr,
+              struct setup_context *setup,
+              const ushort *indices, uint nr)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
    struct softpipe_context *softpipe = cvbr->softpipe;
    const unsigned stride = softpipe->vertex_info.size * sizeof(float);
    const void *vertex_buffer = cvbr->vertex_buffer;
-   struct setup_context *setup = cvbr->setup;
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
@@ -348,16 +362,39 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
 }
 
 
+static void
+draw_elements_job(struct setup_context *setup, void *data)
+{
+   const struct sp_vbuf_prims *prims = (const struct sp_vbuf_prims *) data;
+   draw_elements(prims->cvbr, setup, prims->indices, prims->nr);
+}
+
+
 /**
- * This function is hit when the draw module is working in pass-through mode.
- * It's up to us to convert the vertex array into point/line/tri prims.
+ * draw elements / indexed primitives
  */
 static void
-sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
 {
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct sp_vbuf_prims prims;
+
+   prims.cvbr = cvbr;
+   prims.indices = indices;
+   prims.start = 0;
+   prims.nr = nr;
+
+   if (!sp_rast_draw(cvbr->softpipe->rast, draw_elements_job, &prims))
+      draw_elements(cvbr, cvbr->setup, indices, nr);
+}
+
+
+static void
+draw_arrays(struct softpipe_vbuf_render *cvbr,
+            struct setup_context *setup,
+            uint start, uint nr)
+{
    struct softpipe_context *softpipe = cvbr->softpipe;
-   struct setup_context *setup = cvbr->setup;
    const unsigned stride = softpipe->vertex_info.size * sizeof(float);
    const void *vertex_buffer =
       (void *) get_vert(cvbr->vertex_buffer, start, stride);
@@ -587,6 +624,34 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    }
 }
 
+
+static void
+draw_arrays_job(struct setup_context *setup, void *data)
+{
+   const struct sp_vbuf_prims *prims = (const struct sp_vbuf_prims *) data;
+   draw_arrays(prims->cvbr, setup, prims->start, prims->nr);
+}
+
+
+/**
+ * This function is hit when the draw module is working in pass-through mode.
+ * It's up to us to convert the vertex array into point/line/tri prims.
+ */
+static void
+sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+{
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct sp_vbuf_prims prims;
+
+   prims.cvbr = cvbr;
+   prims.indices = NULL;
+   prims.start = start;
+   prims.nr = nr;
+
+   if (!sp_rast_draw(cvbr->softpipe->rast, draw_arrays_job, &prims))
+      draw_arrays(cvbr, cvbr->setup, start, nr);
+}
+
 /*
  * FIXME: it is unclear if primitives_storage_needed (which is generally
  * the same as pipe query num_primitives_generated) should increase
@@ -650,8 +715,14 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
 
    assert(sp->draw);
 
-   cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
-   cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
+   if (sp->rast) {
+      cvbr->base.max_indices = SP_MAX_VBUF_INDEXES_MT;
+      cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE_MT;
+   }
+   else {
+      cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
+      cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
+   }
 
    cvbr->base.get_vertex_info = sp_vbuf_get_vertex_info;
    cvbr->base.allocate_vertices = sp_vbuf_allocate_vertices;
@@ -667,7 +738,7 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
 
    cvbr->softpipe = sp;
 
-   cvbr->setup = sp_setup_create_context(cvbr->softpipe);
+   cvbr->setup = sp_setup_create_context(cvbr->softpipe, NULL);
 
    return &cvbr->base;
 }
@@ -932,9 +932,7 @@ blend_fallback(struct quad_stage *qs,
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
-                                 quads[0]->input.x0, 
-                                 quads[0]->input.y0, quads[0]->input.layer);
+            = sp_quad_get_tile(qs, softpipe->cbuf_cache[cbuf], quads[0]);
          const boolean clamp = bqs->clamp[cbuf];
          const float *blend_color;
          const boolean dual_source_blend = util_blend_state_is_dual(blend, cbuf);
@@ -1035,9 +1033,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0, quads[0]->input.layer);
+      = sp_quad_get_tile(qs, qs->softpipe->cbuf_cache[0], quads[0]);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
@@ -1109,9 +1105,7 @@ blend_single_add_one_one(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0, quads[0]->input.layer);
+      = sp_quad_get_tile(qs, qs->softpipe->cbuf_cache[0], quads[0]);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
@@ -1177,9 +1171,7 @@ single_output_color(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0, quads[0]->input.layer);
+      = sp_quad_get_tile(qs, qs->softpipe->cbuf_cache[0], quads[0]);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
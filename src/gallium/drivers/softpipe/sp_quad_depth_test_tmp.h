@@ -71,7 +71,7 @@ NAME(struct quad_stage *qs,
 
    depth_step = (ushort)(dzdx * scale);
 
-   tile = sp_get_cached_tile(qs->softpipe->zsbuf_cache, ix, iy, quads[0]->input.layer);
+   tile = sp_quad_get_tile(qs, qs->softpipe->zsbuf_cache, quads[0]);
 
    for (i = 0; i < nr; i++) {
       const unsigned outmask = quads[i]->inout.mask;
@@ -45,6 +45,7 @@
 #include "sp_state.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast.h"
 
 
 struct quad_shade_stage
@@ -63,11 +64,14 @@ static inline boolean
 shade_quad(struct quad_stage *qs, struct quad_header *quad)
 {
    struct softpipe_context *softpipe = qs->softpipe;
-   struct tgsi_exec_machine *machine = softpipe->fs_machine;
+   struct tgsi_exec_machine *machine = sp_quad_fs_machine(qs);
 
    if (softpipe->active_statistics_queries) {
-      softpipe->pipeline_statistics.ps_invocations +=
-         util_bitcount(quad->inout.mask);         
+      if (qs->thread)
+         qs->thread->ps_invocations += util_bitcount(quad->inout.mask);
+      else
+         softpipe->pipeline_statistics.ps_invocations +=
+            util_bitcount(quad->inout.mask);         
    }
 
    /* run shader */
@@ -106,7 +110,7 @@ shade_quads(struct quad_stage *qs,
             unsigned nr)
 {
    struct softpipe_context *softpipe = qs->softpipe;
-   struct tgsi_exec_machine *machine = softpipe->fs_machine;
+   struct tgsi_exec_machine *machine = sp_quad_fs_machine(qs);
    unsigned i, nr_quads = 0;
 
    tgsi_exec_set_constant_buffers(machine, PIPE_MAX_CONSTANT_BUFFERS,
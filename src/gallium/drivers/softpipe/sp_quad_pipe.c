@@ -27,15 +27,42 @@
 
 
 #include "sp_context.h"
+#include "sp_quad.h"
 #include "sp_state.h"
+#include "sp_tile_cache.h"
 #include "pipe/p_shader_tokens.h"
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct quad_stage **first, struct quad_stage *quad)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   quad->next = *first;
+   *first = quad;
+}
+
+
+/**
+ * Link up the given stages the way the context's pipeline is, see
+ * sp_build_quad_pipeline(), and return the first one.
+ */
+struct quad_stage *
+sp_link_quad_pipeline(const struct softpipe_context *sp,
+                      struct quad_stage *shade,
+                      struct quad_stage *depth_test,
+                      struct quad_stage *blend)
+{
+   struct quad_stage *first = blend;
+
+   if (sp->early_depth) {
+      insert_stage_at_head( &first, shade );
+      insert_stage_at_head( &first, depth_test );
+   }
+   else {
+      insert_stage_at_head( &first, depth_test );
+      insert_stage_at_head( &first, shade );
+   }
+
+   return first;
 }
 
 
@@ -51,21 +78,31 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
        !sp->fs_variant->info.writes_stencil) ||
       sp->fs_variant->info.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL];
 
-   sp->quad.first = sp->quad.blend;
-
    sp->early_depth = early_depth_test;
-   if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
-   }
-   else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
-   }
+   sp->quad.first = sp_link_quad_pipeline(sp, sp->quad.shade,
+                                          sp->quad.depth_test,
+                                          sp->quad.blend);
 
 #if !DO_PSTIPPLE_IN_DRAW_MODULE && !DO_PSTIPPLE_IN_HELPER_MODULE
    if (sp->rasterizer->poly_stipple_enable)
-      insert_stage_at_head( sp, sp->quad.pstipple );
+      insert_stage_at_head( &sp->quad.first, sp->quad.pstipple );
 #endif
 }
 
+
+/**
+ * Get the color or depth tile the quad (and the rest of its batch) is in.
+ */
+struct softpipe_cached_tile *
+sp_quad_get_tile(const struct quad_stage *qs,
+                 struct softpipe_tile_cache *tc,
+                 const struct quad_header *quad)
+{
+   if (qs->thread)
+      return sp_get_cached_tile_mt(tc, quad->input.x0, quad->input.y0,
+                                   quad->input.layer);
+
+   return sp_get_cached_tile(tc, quad->input.x0, quad->input.y0,
+                             quad->input.layer);
+}
+
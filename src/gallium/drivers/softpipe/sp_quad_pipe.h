@@ -33,6 +33,9 @@
 
 
 struct softpipe_context;
+struct softpipe_tile_cache;
+struct softpipe_cached_tile;
+struct sp_rast_thread;
 struct quad_header;
 
 
@@ -43,6 +46,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   struct sp_rast_thread *thread;   /**< NULL for the context's own stages */
 
    struct quad_stage *next;
 
@@ -69,4 +73,15 @@ struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
+struct quad_stage *
+sp_link_quad_pipeline(const struct softpipe_context *sp,
+                      struct quad_stage *shade,
+                      struct quad_stage *depth_test,
+                      struct quad_stage *blend);
+
+struct softpipe_cached_tile *
+sp_quad_get_tile(const struct quad_stage *qs,
+                 struct softpipe_tile_cache *tc,
+                 const struct quad_header *quad);
+
 #endif /* SP_QUAD_PIPE_H */
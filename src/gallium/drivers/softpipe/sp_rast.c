@@ -0,0 +1,389 @@
+/**************************************************************************
+ *
+ * Copyright 2007 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-parallel rasterization.
+ *
+ * The primitives of a vbuf draw are handed to all the threads.  Each one
+ * sets them all up with its own setup context, and runs its own quad
+ * pipeline on the quads of the tiles it owns, see sp_rast_owns_tile().
+ * The color and depth tile caches are shared: the threads never get
+ * tiles of the same cache position.  The fragment shader machine, the
+ * sampler and its texture caches are per thread.
+ *
+ * Setting up every primitive on every thread is redundant, but setup is
+ * cheap compared to shading, and rendering each tile in primitive order
+ * gives the same results as a single thread.
+ */
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_exec.h"
+#include "util/u_memory.h"
+
+#include "sp_rast.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+
+
+struct sp_rast
+{
+   struct softpipe_context *softpipe;
+   unsigned num_threads;
+
+   /** Runs threads[1..num_threads-1], threads[0] is the calling thread */
+   struct util_queue queue;
+   boolean queue_initialized;
+
+   struct sp_rast_thread threads[SP_MAX_THREADS];
+
+   /** What the threads do for the current draw */
+   sp_rast_func func;
+   void *data;
+};
+
+
+static void
+rast_thread_execute(void *job, int thread_index)
+{
+   struct sp_rast_thread *t = (struct sp_rast_thread *) job;
+
+   t->rast->func(t->setup, t->rast->data);
+}
+
+
+static boolean
+init_thread(struct sp_rast *rast, struct sp_rast_thread *t, unsigned index)
+{
+   struct softpipe_context *sp = rast->softpipe;
+
+   t->rast = rast;
+   t->index = index;
+   t->num_threads = rast->num_threads;
+
+   t->setup = sp_setup_create_context(sp, t);
+   t->quad.shade = sp_quad_shade_stage(sp);
+   t->quad.depth_test = sp_quad_depth_test_stage(sp);
+   t->quad.blend = sp_quad_blend_stage(sp);
+   t->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   t->sampler = sp_create_tgsi_sampler();
+
+   util_queue_fence_init(&t->fence);
+
+   if (!t->setup || !t->quad.shade || !t->quad.depth_test ||
+       !t->quad.blend || !t->fs_machine || !t->sampler)
+      return FALSE;
+
+   t->quad.shade->thread = t;
+   t->quad.depth_test->thread = t;
+   t->quad.blend->thread = t;
+
+   return TRUE;
+}
+
+
+static void
+destroy_thread(struct sp_rast_thread *t)
+{
+   unsigned i;
+
+   if (!t->rast)
+      return;
+
+   if (t->setup)
+      sp_setup_destroy_context(t->setup);
+
+   if (t->quad.shade)
+      t->quad.shade->destroy(t->quad.shade);
+   if (t->quad.depth_test)
+      t->quad.depth_test->destroy(t->quad.depth_test);
+   if (t->quad.blend)
+      t->quad.blend->destroy(t->quad.blend);
+
+   if (t->fs_machine)
+      tgsi_exec_machine_destroy(t->fs_machine);
+
+   for (i = 0; i < ARRAY_SIZE(t->tex_cache); i++) {
+      if (t->tex_cache[i]) {
+         /* drop the texture reference */
+         sp_tex_tile_cache_set_sampler_view(t->tex_cache[i], NULL);
+         sp_destroy_tex_tile_cache(t->tex_cache[i]);
+      }
+   }
+
+   FREE(t->sampler);
+
+   util_queue_fence_destroy(&t->fence);
+}
+
+
+/**
+ * Create the rasterization threads.
+ * \return NULL for rasterizing on the calling thread only
+ */
+struct sp_rast *
+sp_rast_create(struct softpipe_context *softpipe, unsigned num_threads)
+{
+   struct sp_rast *rast;
+   unsigned i;
+
+   num_threads = MIN2(num_threads, SP_MAX_THREADS);
+   if (num_threads < 2)
+      return NULL;
+
+   rast = CALLOC_STRUCT(sp_rast);
+   if (!rast)
+      return NULL;
+
+   rast->softpipe = softpipe;
+   rast->num_threads = num_threads;
+
+   for (i = 0; i < num_threads; i++) {
+      if (!init_thread(rast, &rast->threads[i], i))
+         goto fail;
+   }
+
+   if (!util_queue_init(&rast->queue, "sprast", SP_MAX_THREADS,
+                        num_threads - 1, 0))
+      goto fail;
+   rast->queue_initialized = TRUE;
+
+   return rast;
+
+fail:
+   sp_rast_destroy(rast);
+   return NULL;
+}
+
+
+void
+sp_rast_destroy(struct sp_rast *rast)
+{
+   unsigned i;
+
+   if (!rast)
+      return;
+
+   if (rast->queue_initialized)
+      util_queue_destroy(&rast->queue);
+
+   for (i = 0; i < rast->num_threads; i++)
+      destroy_thread(&rast->threads[i]);
+
+   FREE(rast);
+}
+
+
+/**
+ * Whether the current state allows rasterizing on several threads.
+ */
+static boolean
+can_draw_threaded(const struct softpipe_context *sp)
+{
+   const struct tgsi_shader_info *info;
+   unsigned i;
+
+   if (!sp->fs_variant)
+      return FALSE;
+
+   /* the threads shade in a different order, but the shader must not
+    * be able to tell
+    */
+   info = &sp->fs_variant->info;
+   if (info->file_count[TGSI_FILE_IMAGE] ||
+       info->file_count[TGSI_FILE_BUFFER] ||
+       info->file_count[TGSI_FILE_HW_ATOMIC] ||
+       info->writes_memory)
+      return FALSE;
+
+   /* not with the softpipe polygon stipple stage */
+   if (sp->quad.first == sp->quad.pstipple)
+      return FALSE;
+
+   /* mapping a texture which is also being rendered to would flush the
+    * tile caches in the middle of the draw
+    */
+   for (i = 0; i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      const struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      unsigned j;
+
+      if (!view)
+         continue;
+
+      for (j = 0; j < sp->framebuffer.nr_cbufs; j++) {
+         if (sp->framebuffer.cbufs[j] &&
+             sp->framebuffer.cbufs[j]->texture == view->texture)
+            return FALSE;
+      }
+      if (sp->framebuffer.zsbuf &&
+          sp->framebuffer.zsbuf->texture == view->texture)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Bring a thread's quad pipeline, shader machine and sampler up to date
+ * with the context's state, and start a draw.
+ */
+static boolean
+prepare_thread(struct sp_rast_thread *t)
+{
+   struct softpipe_context *sp = t->rast->softpipe;
+   const struct sp_tgsi_sampler *sampler =
+      sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   unsigned i;
+
+   t->quad.first = sp_link_quad_pipeline(sp, t->quad.shade,
+                                         t->quad.depth_test,
+                                         t->quad.blend);
+
+   if (t->fs_variant != sp->fs_variant) {
+      sp->fs_variant->prepare(sp->fs_variant,
+                              t->fs_machine,
+                              (struct tgsi_sampler *) t->sampler,
+                              (struct tgsi_image *)
+                                 sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                              (struct tgsi_buffer *)
+                                 sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+      t->fs_variant = sp->fs_variant;
+   }
+
+   memcpy(t->sampler->sp_sampler, sampler->sp_sampler,
+          sizeof(sampler->sp_sampler));
+
+   for (i = 0; i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+
+      t->sampler->sp_sview[i] = sampler->sp_sview[i];
+
+      if (!view)
+         continue;
+
+      if (!t->tex_cache[i]) {
+         t->tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+         if (!t->tex_cache[i])
+            return FALSE;
+      }
+
+      /* the texture may have changed since the previous draw */
+      sp_tex_tile_cache_set_sampler_view(t->tex_cache[i], view);
+      sp_flush_tex_tile_cache(t->tex_cache[i]);
+      t->sampler->sp_sview[i].cache = t->tex_cache[i];
+   }
+
+   sp_setup_prepare(t->setup);
+
+   t->occlusion_count = 0;
+   t->ps_invocations = 0;
+
+   return TRUE;
+}
+
+
+/**
+ * Run func on all the rasterization threads, each rendering the tiles it
+ * owns, and wait for them.
+ * \return FALSE if the caller must rasterize on its own instead
+ */
+boolean
+sp_rast_draw(struct sp_rast *rast, sp_rast_func func, void *data)
+{
+   struct softpipe_context *sp;
+   unsigned i;
+
+   if (!rast)
+      return FALSE;
+
+   sp = rast->softpipe;
+
+   if (!can_draw_threaded(sp))
+      return FALSE;
+
+   for (i = 0; i < sp->framebuffer.nr_cbufs; i++) {
+      if (!sp_tile_cache_prepare_threads(sp->cbuf_cache[i]))
+         return FALSE;
+   }
+   if (!sp_tile_cache_prepare_threads(sp->zsbuf_cache))
+      return FALSE;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      if (!prepare_thread(&rast->threads[i]))
+         return FALSE;
+   }
+
+   rast->func = func;
+   rast->data = data;
+
+   for (i = 1; i < rast->num_threads; i++) {
+      util_queue_add_job(&rast->queue, &rast->threads[i],
+                         &rast->threads[i].fence,
+                         rast_thread_execute, NULL);
+   }
+
+   rast_thread_execute(&rast->threads[0], 0);
+
+   for (i = 1; i < rast->num_threads; i++)
+      util_queue_fence_wait(&rast->threads[i].fence);
+
+   for (i = 0; i < rast->num_threads; i++) {
+      sp->occlusion_count += rast->threads[i].occlusion_count;
+      sp->pipeline_statistics.ps_invocations +=
+         rast->threads[i].ps_invocations;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Called before deleting a fragment shader variant, which the threads'
+ * machines may still have bound.
+ */
+void
+sp_rast_unbind_fs_variant(struct sp_rast *rast,
+                          const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   if (!rast)
+      return;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_rast_thread *t = &rast->threads[i];
+
+      if (t->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(t->fs_machine, NULL, NULL, NULL, NULL);
+         t->fs_variant = NULL;
+      }
+   }
+}
@@ -0,0 +1,132 @@
+/**************************************************************************
+ *
+ * Copyright 2007 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-parallel rasterization on several threads.
+ */
+
+#ifndef SP_RAST_H
+#define SP_RAST_H
+
+#include "pipe/p_state.h"
+#include "util/u_queue.h"
+
+#include "sp_context.h"
+#include "sp_limits.h"
+#include "sp_quad_pipe.h"
+#include "sp_tile_cache.h"
+
+
+struct setup_context;
+struct sp_rast;
+struct sp_fragment_shader_variant;
+struct sp_tgsi_sampler;
+struct softpipe_tex_tile_cache;
+struct tgsi_exec_machine;
+
+
+/**
+ * A rasterization thread.  Every thread sets up all the primitives of a
+ * draw, and renders the quads of the tiles it owns only.
+ */
+struct sp_rast_thread
+{
+   struct sp_rast *rast;
+   unsigned index;
+   unsigned num_threads;
+
+   struct setup_context *setup;
+
+   /** Quad pipeline, linked like the context's one */
+   struct {
+      struct quad_stage *shade;
+      struct quad_stage *depth_test;
+      struct quad_stage *blend;
+      struct quad_stage *first;
+   } quad;
+
+   struct tgsi_exec_machine *fs_machine;
+   const struct sp_fragment_shader_variant *fs_variant;  /**< in fs_machine */
+
+   /** Copy of the context's fragment sampler, with the caches below */
+   struct sp_tgsi_sampler *sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   /** Added to the context's counters after each draw */
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+
+   struct util_queue_fence fence;
+};
+
+
+/**
+ * Rasterize primitives with the given setup context.
+ */
+typedef void (*sp_rast_func)(struct setup_context *setup, void *data);
+
+
+struct sp_rast *
+sp_rast_create(struct softpipe_context *softpipe, unsigned num_threads);
+
+void
+sp_rast_destroy(struct sp_rast *rast);
+
+boolean
+sp_rast_draw(struct sp_rast *rast, sp_rast_func func, void *data);
+
+void
+sp_rast_unbind_fs_variant(struct sp_rast *rast,
+                          const struct sp_fragment_shader_variant *var);
+
+
+/**
+ * Whether the thread renders the tile at (x, y), in pixels.
+ *
+ * The tiles of a cache position all go to the same thread, which gets
+ * them in the same order as if rendering on a single thread: the colors
+ * the tile caches hold between evictions, and so the results, don't
+ * depend on the number of threads.
+ */
+static inline boolean
+sp_rast_owns_tile(const struct sp_rast_thread *thread,
+                  int x, int y, unsigned layer)
+{
+   unsigned pos = CACHE_POS(x / TILE_SIZE, y / TILE_SIZE, layer);
+
+   return pos % thread->num_threads == thread->index;
+}
+
+
+static inline struct tgsi_exec_machine *
+sp_quad_fs_machine(const struct quad_stage *qs)
+{
+   return qs->thread ? qs->thread->fs_machine : qs->softpipe->fs_machine;
+}
+
+
+#endif /* SP_RAST_H */
@@ -35,6 +35,7 @@
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "draw/draw_context.h"
@@ -73,6 +74,7 @@ struct edge {
  */
 struct setup_context {
    struct softpipe_context *softpipe;
+   struct sp_rast_thread *thread;   /**< NULL for the context's own setup */
 
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
@@ -153,6 +155,28 @@ quad_clip(struct setup_context *setup, struct quad_header *quad)
 }
 
 
+/**
+ * The first stage of the quad pipeline the setup context feeds.
+ */
+static inline struct quad_stage *
+quad_pipeline(const struct setup_context *setup)
+{
+   return setup->thread ? setup->thread->quad.first :
+                          setup->softpipe->quad.first;
+}
+
+
+/**
+ * Whether the quads at (x, y) are rendered with this setup context: on
+ * rasterization threads, only those of the tiles the thread owns are.
+ */
+static inline boolean
+quad_owned(const struct setup_context *setup, int x, int y, unsigned layer)
+{
+   return !setup->thread || sp_rast_owns_tile(setup->thread, x, y, layer);
+}
+
+
 /**
  * Emit a quad (pass to next stage) with clipping.
  */
@@ -161,14 +185,15 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
 {
    quad_clip(setup, quad);
 
-   if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+   if (quad->inout.mask &&
+       quad_owned(setup, quad->input.x0, quad->input.y0, quad->input.layer)) {
+      struct quad_stage *pipe = quad_pipeline(setup);
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      pipe->run( pipe, &quad, 1 );
    }
 }
 
@@ -203,7 +228,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = quad_pipeline(setup);
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -229,6 +254,10 @@ flush_spans(struct setup_context *setup)
       unsigned mask0 = ~skipmask_left0 & ~skipmask_right0;
       unsigned mask1 = ~skipmask_left1 & ~skipmask_right1;
 
+      /* the chunk is within one tile */
+      if (!quad_owned(setup, x, setup->span.y, setup->quad[0].input.layer))
+         continue;
+
       if (mask0 | mask1) {
          do {
             unsigned quadmask = (mask0 & 3) | ((mask1 & 3) << 2);
@@ -873,7 +902,9 @@ sp_setup_tri(struct setup_context *setup,
 
    flush_spans( setup );
 
-   if (setup->softpipe->active_statistics_queries) {
+   /* the rasterization threads all set up every triangle */
+   if (setup->softpipe->active_statistics_queries &&
+       (!setup->thread || setup->thread->index == 0)) {
       setup->softpipe->pipeline_statistics.c_primitives++;
    }
 
@@ -1454,7 +1485,7 @@ sp_setup_prepare(struct setup_context *setup)
    struct softpipe_context *sp = setup->softpipe;
    int i;
    unsigned max_layer = ~0;
-   if (sp->dirty) {
+   if (sp->dirty && !setup->thread) {
       softpipe_update_derived(sp, sp->reduced_api_prim);
    }
 
@@ -1478,7 +1509,7 @@ sp_setup_prepare(struct setup_context *setup)
 
    setup->max_layer = max_layer;
 
-   sp->quad.first->begin( sp->quad.first );
+   quad_pipeline(setup)->begin( quad_pipeline(setup) );
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1504,12 +1535,17 @@ sp_setup_destroy_context(struct setup_context *setup)
  * Create a new primitive setup/render stage.
  */
 struct setup_context *
-sp_setup_create_context(struct softpipe_context *softpipe)
+sp_setup_create_context(struct softpipe_context *softpipe,
+                        struct sp_rast_thread *thread)
 {
    struct setup_context *setup = CALLOC_STRUCT(setup_context);
    unsigned i;
 
+   if (!setup)
+      return NULL;
+
    setup->softpipe = softpipe;
+   setup->thread = thread;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
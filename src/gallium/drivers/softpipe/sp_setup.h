@@ -29,6 +29,7 @@
 
 struct setup_context;
 struct softpipe_context;
+struct sp_rast_thread;
 
 /**
  * Attribute interpolation mode
@@ -70,7 +71,8 @@ sp_clamp_viewport_idx(int idx)
    return (PIPE_MAX_VIEWPORTS > idx && idx >= 0) ? idx : 0;
 }
 
-struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe );
+struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe,
+                                              struct sp_rast_thread *thread );
 void sp_setup_prepare( struct setup_context *setup );
 void sp_setup_destroy_context( struct setup_context *setup );
 
@@ -33,6 +33,7 @@
  */
 
 #include "util/u_inlines.h"
+#include "util/u_atomic.h"
 #include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_tile.h"
@@ -42,16 +43,6 @@ static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
 
-/**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
- */
-#define CACHE_POS(x, y, l)                        \
-   (((x) + (y) * 5 + (l) * 10) % NUM_ENTRIES)
-
-
 static inline int addr_to_clear_pos(union tile_address addr)
 {
    int pos;
@@ -76,14 +67,19 @@ is_clear_flag_set(const uint *bitvec, union tile_address addr, unsigned max)
 
 /**
  * Mark the tile at (x,y) as not cleared.
+ * Atomically, as rasterization threads may do so for neighbouring tiles.
  */
 static inline void
 clear_clear_flag(uint *bitvec, union tile_address addr, unsigned max)
 {
    int pos;
+   uint old;
    pos = addr_to_clear_pos(addr);
    assert(pos / 32 < max);
-   bitvec[pos / 32] &= ~(1 << (pos & 31));
+   do {
+      old = bitvec[pos / 32];
+   } while (p_atomic_cmpxchg(&bitvec[pos / 32], old,
+                             old & ~(1u << (pos & 31))) != old);
 }
    
 
@@ -513,9 +509,8 @@ sp_alloc_tile(struct softpipe_tile_cache *tc)
  * Get a tile from the cache.
  * \param x, y  position of tile, in pixels
  */
-struct softpipe_cached_tile *
-sp_find_cached_tile(struct softpipe_tile_cache *tc, 
-                    union tile_address addr )
+static struct softpipe_cached_tile *
+find_tile(struct softpipe_tile_cache *tc, union tile_address addr)
 {
    struct pipe_transfer *pt;
    /* cache pos/entry: */
@@ -618,12 +613,63 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
       }
    }
 
+   return tile;
+}
+
+
+struct softpipe_cached_tile *
+sp_find_cached_tile(struct softpipe_tile_cache *tc, 
+                    union tile_address addr )
+{
+   struct softpipe_cached_tile *tile = find_tile(tc, addr);
+
    tc->last_tile = tile;
    tc->last_tile_addr = addr;
    return tile;
 }
 
 
+/**
+ * Allocate all the cache entries, so that rasterization threads can use
+ * the cache concurrently as long as they get tiles of different cache
+ * positions, see sp_get_cached_tile_mt().
+ * \return FALSE if out of memory
+ */
+boolean
+sp_tile_cache_prepare_threads(struct softpipe_tile_cache *tc)
+{
+   uint pos;
+
+   if (!tc->num_maps)
+      return TRUE;
+
+   for (pos = 0; pos < ARRAY_SIZE(tc->entries); pos++) {
+      if (!tc->entries[pos]) {
+         tc->entries[pos] = MALLOC_STRUCT(softpipe_cached_tile);
+         if (!tc->entries[pos])
+            return FALSE;
+      }
+   }
+
+   /* the threads may replace it */
+   tc->last_tile_addr.bits.invalid = 1;
+   return TRUE;
+}
+
+
+/**
+ * Like sp_get_cached_tile(), for the rasterization threads, which don't
+ * share the most recently retrieved tile.
+ */
+struct softpipe_cached_tile *
+sp_get_cached_tile_mt(struct softpipe_tile_cache *tc,
+                      int x, int y, int layer)
+{
+   assert(tc->entries[CACHE_POS(x / TILE_SIZE, y / TILE_SIZE, layer)]);
+   return find_tile(tc, tile_address(x, y, layer));
+}
+
+
 
 
 
@@ -124,6 +124,19 @@ KNOBS = [
         'category'  : 'perf',
     }],
 
+    ['THREAD_POOL_PARTITIONS', {
+        'type'      : 'uint32_t',
+        'default'   : '0',
+        'desc'      : ['Number of partitions the cores of each NUMA-node are split into, for',
+                       'processes with several contexts rendering at the same time.',
+                       'Each new context binds its worker threads to the cores of the partition',
+                       'used by the fewest other contexts of the process.',
+                       '  0 == Each context uses all the cores',
+                       '  N == Each context uses 1/N of the cores of each NUMA-node',
+                       'Ignored when MAX_WORKER_THREADS is set.'],
+        'category'  : 'perf',
+    }],
+
     ['BUCKETS_START_FRAME', {
         'type'      : 'uint32_t',
         'default'   : '1200',
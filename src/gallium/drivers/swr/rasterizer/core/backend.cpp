@@ -347,6 +347,9 @@ void BackendNullPS(DRAW_CONTEXT*        pDC,
                     AR_EVENT(EarlyDepthStencilInfoNullPS(_simd_movemask_ps(depthPassMask),
                                                          _simd_movemask_ps(stencilPassMask),
                                                          _simd_movemask_ps(vCoverageMask)));
+                    UPDATE_STAT_BE(EarlyZKills,
+                                   _mm_popcnt_u32(_simd_movemask_ps(vCoverageMask) &
+                                                  ~_simd_movemask_ps(depthPassMask)));
                     DepthStencilWrite(&state.vp[work.triFlags.viewportIndex],
                                       &state.depthStencilState,
                                       work.triFlags.frontFacing,
@@ -1179,8 +1179,11 @@ void BackendPixelRate(DRAW_CONTEXT*        pDC,
             // Early-Z?
             if (T::bCanEarlyZ && !T::bForcedSampleCount)
             {
+                uint32_t coveredMask    = _simd_movemask_ps(activeLanes);
                 uint32_t depthPassCount = PixelRateZTest(activeLanes, psContext, BEEarlyDepthTest);
                 UPDATE_STAT_BE(DepthPassCount, depthPassCount);
+                UPDATE_STAT_BE(EarlyZKills,
+                               _mm_popcnt_u32(coveredMask & ~_simd_movemask_ps(activeLanes)));
                 AR_EVENT(EarlyDepthInfoPixelRate(depthPassCount, _simd_movemask_ps(activeLanes)));
             }
 
@@ -156,6 +156,9 @@ void BackendSingleSample(DRAW_CONTEXT*        pDC,
                     AR_EVENT(EarlyDepthStencilInfoSingleSample(_simd_movemask_ps(depthPassMask),
                                                                _simd_movemask_ps(stencilPassMask),
                                                                _simd_movemask_ps(vCoverageMask)));
+                    UPDATE_STAT_BE(EarlyZKills,
+                                   _mm_popcnt_u32(_simd_movemask_ps(vCoverageMask) &
+                                                  ~_simd_movemask_ps(depthPassMask)));
                     RDTSC_END(BEEarlyDepthTest, 0);
 
                     // early-exit if no pixels passed depth or earlyZ is forced on
@@ -807,6 +807,7 @@ void SIMDCALL BinTrianglesImpl(DRAW_CONTEXT*          pDC,
     if (origTriMask ^ triMask)
     {
         RDTSC_EVENT(FECullZeroAreaAndBackface, _mm_popcnt_u32(origTriMask ^ triMask), 0);
+        UPDATE_STAT_FE(CulledPrimitives, _mm_popcnt_u32(origTriMask ^ triMask));
     }
 
     AR_EVENT(CullInfoEvent(pDC->drawId, cullZeroAreaMask, cullTris, origTriMask));
@@ -918,6 +919,7 @@ void SIMDCALL BinTrianglesImpl(DRAW_CONTEXT*          pDC,
         if (origTriMask ^ triMask)
         {
             RDTSC_EVENT(FECullBetweenCenters, _mm_popcnt_u32(origTriMask ^ triMask), 0);
+            UPDATE_STAT_FE(CulledPrimitives, _mm_popcnt_u32(origTriMask ^ triMask));
         }
     }
 
@@ -643,6 +643,9 @@ OSALIGNLINE(struct) SWR_STATS
     uint64_t PsInvocations; // Number of Pixel Shader invocations
     uint64_t CsInvocations; // Number of Compute Shader invocations
 
+    // Efficiency Stats
+    uint64_t EarlyZKills; // Number of pixels/samples failing early depth/stencil
+    uint64_t BackendTime; // Worker time spent on macrotile work, in nanoseconds
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -661,6 +664,7 @@ OSALIGNLINE(struct) SWR_STATS_FE
     uint64_t GsPrimitives;  // Number of prims GS outputs.
     uint64_t CInvocations;  // Number of clipper invocations
     uint64_t CPrimitives;   // Number of clipper primitives.
+    uint64_t CulledPrimitives; // Number of triangles culled by the binner.
 
     // Streamout Stats
     uint64_t SoPrimStorageNeeded[4];
@@ -29,6 +29,8 @@
 #include <utility>
 #include <fstream>
 #include <string>
+#include <mutex>
+#include <chrono>
 
 #if defined(__linux__) || defined(__gnu_linux__) || defined(__APPLE__)
 #include <pthread.h>
@@ -423,7 +425,8 @@ INLINE void UpdateClientStats(SWR_CONTEXT* pContext, uint32_t workerId, DRAW_CON
         stats.DepthPassCount += dynState.pStats[i].DepthPassCount;
         stats.PsInvocations += dynState.pStats[i].PsInvocations;
         stats.CsInvocations += dynState.pStats[i].CsInvocations;
-
+        stats.EarlyZKills += dynState.pStats[i].EarlyZKills;
+        stats.BackendTime += dynState.pStats[i].BackendTime;
     }
 
 
@@ -625,6 +628,10 @@ bool WorkOnFifoBE(SWR_CONTEXT* pContext,
                     bShutdown = true;
                 }
 
+                bool bTimeWork = GetApiState(pDC).enableStatsBE;
+                auto startTime = bTimeWork ? std::chrono::steady_clock::now()
+                                           : std::chrono::steady_clock::time_point();
+
                 while ((pWork = tile->peek()) != nullptr)
                 {
                     pWork->pfnWork(pDC, workerId, tileID, &pWork->desc);
@@ -632,6 +639,14 @@ bool WorkOnFifoBE(SWR_CONTEXT* pContext,
                 }
                 RDTSC_END(WorkerFoundWork, numWorkItems);
 
+                if (bTimeWork)
+                {
+                    UPDATE_STAT_BE(BackendTime,
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now() - startTime)
+                                       .count());
+                }
+
                 _ReadWriteBarrier();
 
                 pDC->pTileMgr->markTileComplete(tileID);
@@ -982,6 +997,48 @@ DWORD workerThreadInit(LPVOID pData)
 template <>
 DWORD workerThreadInit<false, false>(LPVOID pData) = delete;
 
+//////////////////////////////////////////////////////////////////////////
+/// Number of live contexts in each core partition of the process, see
+/// KNOB_THREAD_POOL_PARTITIONS.
+//////////////////////////////////////////////////////////////////////////
+static std::mutex            gPartitionLock;
+static std::vector<uint32_t> gPartitionUseCount;
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Picks the partition used by the fewest contexts, so that
+///        concurrent contexts spread over the cores instead of all binding
+///        their workers to the same ones.
+/// @param numPartitions - Number of partitions the cores are split into.
+static uint32_t AcquirePartition(uint32_t numPartitions)
+{
+    std::lock_guard<std::mutex> guard(gPartitionLock);
+
+    if (gPartitionUseCount.size() < numPartitions)
+    {
+        gPartitionUseCount.resize(numPartitions, 0);
+    }
+
+    uint32_t partition = 0;
+    for (uint32_t p = 1; p < numPartitions; ++p)
+    {
+        if (gPartitionUseCount[p] < gPartitionUseCount[partition])
+        {
+            partition = p;
+        }
+    }
+    gPartitionUseCount[partition]++;
+
+    return partition;
+}
+
+static void ReleasePartition(uint32_t partition)
+{
+    std::lock_guard<std::mutex> guard(gPartitionLock);
+
+    SWR_ASSERT(partition < gPartitionUseCount.size() && gPartitionUseCount[partition]);
+    gPartitionUseCount[partition]--;
+}
+
 static void InitPerThreadStats(SWR_CONTEXT* pContext, uint32_t numThreads)
 {
     // Initialize DRAW_CONTEXT's per-thread stats
@@ -1003,6 +1060,8 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
     uint32_t     numThreadsPerProcGroup = 0;
     CalculateProcessorTopology(nodes, numThreadsPerProcGroup);
 
+    pPool->partition = ~0U;
+
     // Assumption, for asymmetric topologies, multi-threaded cores will appear
     // in the list before single-threaded cores.  This appears to be true for
     // Windows when the total HW threads is limited to 64.
@@ -1088,6 +1147,21 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
         numCoresPerNode = std::min(numCoresPerNode, pContext->threadInfo.MAX_CORES_PER_NUMA_NODE);
     }
 
+    // Share the cores with the other contexts of the process: every context
+    // still spans all the NUMA nodes, with its own subset of cores on each.
+    uint32_t numPartitions = std::min(pContext->threadInfo.THREAD_POOL_PARTITIONS, numCoresPerNode);
+    if (numPartitions > 1 && !pContext->threadInfo.SINGLE_THREADED &&
+        !pContext->threadInfo.MAX_WORKER_THREADS)
+    {
+        uint32_t partition = AcquirePartition(numPartitions);
+        uint32_t coreBegin = partition * numCoresPerNode / numPartitions;
+        uint32_t coreEnd   = (partition + 1) * numCoresPerNode / numPartitions;
+
+        pPool->partition = partition;
+        pContext->threadInfo.BASE_CORE += coreBegin;
+        numCoresPerNode = coreEnd - coreBegin;
+    }
+
     // Calc used NUMA nodes
     if (numNodes > pContext->threadInfo.BASE_NUMA_NODE)
     {
@@ -1396,6 +1470,11 @@ void DestroyThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
 
     delete[] pPool->pThreads;
 
+    if (pPool->partition != ~0U)
+    {
+        ReleasePartition(pPool->partition);
+    }
+
     // Clean up data used by threads
     delete[] pPool->pThreadData;
     delete[] pPool->pApiThreadData;
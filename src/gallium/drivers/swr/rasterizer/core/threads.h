@@ -60,6 +60,7 @@ struct THREAD_POOL
     void*        pWorkerPrivateDataArray; // All memory for worker private data
     uint32_t     numReservedThreads;      // Number of threads reserved for API use
     THREAD_DATA* pApiThreadData;
+    uint32_t     partition;               // Process-wide core partition, ~0 if none
 };
 
 struct TileSet;
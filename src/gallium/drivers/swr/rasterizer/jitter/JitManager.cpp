@@ -129,10 +129,7 @@ JitManager::JitManager(uint32_t simdWidth, const char* arch, const char* core) :
         mOptLevel = CodeGenOpt::Level(KNOB_JIT_OPTIMIZATION_LEVEL);
     }
 
-    if (KNOB_JIT_ENABLE_CACHE)
-    {
-        mCache.Init(this, mHostCpuName, mOptLevel);
-    }
+    mCache.Init(this, mHostCpuName, mOptLevel);
 
     SetupNewModule();
     mIsModuleFinalized = true;
@@ -194,7 +191,7 @@ void JitManager::CreateExecEngine(std::unique_ptr<Module> pModule)
                  .setMCPU(mHostCpuName)
                  .create();
 
-    if (KNOB_JIT_ENABLE_CACHE)
+    if (KNOB_JIT_ENABLE_CACHE || mCache.HasObjectStore())
     {
         mpExec->setObjectCache(&mCache);
     }
@@ -525,6 +522,13 @@ void JITCALL JitDestroyContext(HANDLE hJitContext)
         delete reinterpret_cast<JitManager*>(hJitContext);
     }
 }
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Set persistent storage for the compiled code.
+void JITCALL JitSetObjectStore(HANDLE hJitContext, const JIT_OBJECT_STORE* pStore)
+{
+    reinterpret_cast<JitManager*>(hJitContext)->mCache.SetObjectStore(pStore);
+}
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -598,7 +602,7 @@ private:
     char     m_Cpu[JC_STR_MAX_LEN]      = {};
 };
 
-static inline uint32_t ComputeModuleCRC(const llvm::Module* M)
+static inline std::string GetModuleBitcode(const llvm::Module* M)
 {
     std::string        bitcodeBuffer;
     raw_string_ostream bitcodeStream(bitcodeBuffer);
@@ -612,6 +616,13 @@ static inline uint32_t ComputeModuleCRC(const llvm::Module* M)
 
     bitcodeStream.flush();
 
+    return bitcodeBuffer;
+}
+
+static inline uint32_t ComputeModuleCRC(const llvm::Module* M)
+{
+    std::string bitcodeBuffer = GetModuleBitcode(M);
+
     return ComputeCRC(0, bitcodeBuffer.data(), bitcodeBuffer.size());
 }
 
@@ -679,6 +690,20 @@ void JitCache::notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef
         return;
     }
 
+    if (mpStore)
+    {
+        if (mCurrentModuleKey.size())
+        {
+            mpStore->pfnPut(mpStore->pPrivate,
+                            mCurrentModuleKey.data(),
+                            mCurrentModuleKey.size(),
+                            Obj.getBufferStart(),
+                            Obj.getBufferSize());
+            mCurrentModuleKey.clear();
+        }
+        return;
+    }
+
     if (!mModuleCacheDir.size())
     {
         SWR_INVALID("Unset module cache directory");
@@ -727,7 +752,39 @@ void JitCache::notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef
 std::unique_ptr<llvm::MemoryBuffer> JitCache::getObject(const llvm::Module* M)
 {
     const std::string& moduleID = M->getModuleIdentifier();
-    mCurrentModuleCRC           = ComputeModuleCRC(M);
+
+    if (mpStore)
+    {
+        mCurrentModuleKey.clear();
+        if (!moduleID.length())
+        {
+            return nullptr;
+        }
+
+        // The object only matches the exact same IR, target and opt level
+        mCurrentModuleKey = GetModuleBitcode(M);
+        mCurrentModuleKey.append(moduleID.c_str(), moduleID.length() + 1);
+        mCurrentModuleKey.append(mCpu.c_str(), mCpu.length() + 1);
+        mCurrentModuleKey.append((const char*)&mOptLevel, sizeof(mOptLevel));
+
+        size_t objSize = 0;
+        void*  pObj    = mpStore->pfnGet(
+            mpStore->pPrivate, mCurrentModuleKey.data(), mCurrentModuleKey.size(), &objSize);
+        if (!pObj)
+        {
+            return nullptr;
+        }
+
+        std::unique_ptr<llvm::MemoryBuffer> pBuf =
+            llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef((const char*)pObj, objSize));
+        free(pObj);
+
+        // found, nothing to store once it is loaded
+        mCurrentModuleKey.clear();
+        return pBuf;
+    }
+
+    mCurrentModuleCRC = ComputeModuleCRC(M);
 
     if (!moduleID.length())
     {
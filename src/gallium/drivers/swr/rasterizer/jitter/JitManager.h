@@ -88,6 +88,7 @@ struct JitLLVMContext : llvm::LLVMContext
 /// JitCache
 //////////////////////////////////////////////////////////////////////////
 struct JitManager; // Forward Decl
+struct JIT_OBJECT_STORE;
 class JitCache : public llvm::ObjectCache
 {
 public:
@@ -102,6 +103,10 @@ public:
         mOptLevel = level;
     }
 
+    /// Use pStore instead of the cache directory, see JIT_OBJECT_STORE.
+    void SetObjectStore(const JIT_OBJECT_STORE* pStore) { mpStore = pStore; }
+    bool HasObjectStore() const { return mpStore != nullptr; }
+
     /// notifyObjectCompiled - Provides a pointer to compiled code for Module M.
     void notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef Obj) override;
 
@@ -117,6 +122,8 @@ private:
     uint32_t                    mCurrentModuleCRC = 0;
     JitManager*                 mpJitMgr          = nullptr;
     llvm::CodeGenOpt::Level     mOptLevel         = llvm::CodeGenOpt::None;
+    const JIT_OBJECT_STORE*     mpStore           = nullptr;
+    std::string                 mCurrentModuleKey;
 
     /// Calculate actual directory where module will be cached.
     /// This is always a subdirectory of mCacheDir.  Full absolute
@@ -65,6 +65,28 @@ struct JIT_COMPILE_INPUT
 
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// Jit Object Store
+/// @brief Persistent storage for the compiled object code of the jitted
+/// functions, used instead of the JIT cache directory when set.  The key
+/// is a blob made of the module bitcode, module name, target cpu and
+/// optimization level.
+//////////////////////////////////////////////////////////////////////////
+struct JIT_OBJECT_STORE
+{
+    void* pPrivate;
+
+    /// Returns malloc'ed object code for the key, or NULL if not found.
+    void* (*pfnGet)(void* pPrivate, const void* pKey, size_t keySize, size_t* pObjSize);
+
+    /// Stores the object code for the key.
+    void (*pfnPut)(void*       pPrivate,
+                   const void* pKey,
+                   size_t      keySize,
+                   const void* pObj,
+                   size_t      objSize);
+};
+
 
 extern "C" {
 
@@ -76,6 +98,12 @@ HANDLE JITCALL JitCreateContext(uint32_t targetSimdWidth, const char* arch, cons
 /// @brief Destroy JIT context.
 void JITCALL JitDestroyContext(HANDLE hJitContext);
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Set persistent storage for the compiled code.
+/// @param hJitContext - Jit Context
+/// @param pStore - Object store, must outlive the context.  NULL to unset.
+void JITCALL JitSetObjectStore(HANDLE hJitContext, const JIT_OBJECT_STORE* pStore);
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief JIT compile shader.
 /// @param hJitContext - Jit Context
@@ -440,6 +440,8 @@ swr_UpdateStats(HANDLE hPrivateContext, const SWR_STATS *pStats)
    pSwrStats->DepthPassCount += pStats->DepthPassCount;
    pSwrStats->PsInvocations += pStats->PsInvocations;
    pSwrStats->CsInvocations += pStats->CsInvocations;
+   pSwrStats->EarlyZKills += pStats->EarlyZKills;
+   pSwrStats->BackendTime += pStats->BackendTime;
 }
 
 static void
@@ -461,6 +463,7 @@ swr_UpdateStatsFE(HANDLE hPrivateContext, const SWR_STATS_FE *pStats)
    p_atomic_add(&pSwrStats->GsInvocations, pStats->GsInvocations);
    p_atomic_add(&pSwrStats->CInvocations, pStats->CInvocations);
    p_atomic_add(&pSwrStats->CPrimitives, pStats->CPrimitives);
+   p_atomic_add(&pSwrStats->CulledPrimitives, pStats->CulledPrimitives);
    p_atomic_add(&pSwrStats->GsPrimitives, pStats->GsPrimitives);
 
    for (unsigned i = 0; i < 4; i++) {
@@ -502,6 +505,7 @@ swr_create_context(struct pipe_screen *p_screen, void *priv, unsigned flags)
    threadingInfo.MAX_NUMA_NODES            = KNOB_MAX_NUMA_NODES;
    threadingInfo.MAX_CORES_PER_NUMA_NODE   = KNOB_MAX_CORES_PER_NUMA_NODE;
    threadingInfo.MAX_THREADS_PER_CORE      = KNOB_MAX_THREADS_PER_CORE;
+   threadingInfo.THREAD_POOL_PARTITIONS    = KNOB_THREAD_POOL_PARTITIONS;
    threadingInfo.SINGLE_THREADED           = KNOB_SINGLE_THREADED;
 
    // Use non-standard settings for KNL
@@ -42,7 +42,9 @@ swr_create_query(struct pipe_context *pipe, unsigned type, unsigned index)
 {
    struct swr_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= SWR_QUERY_CULLED_PRIMITIVES &&
+           type <= SWR_QUERY_BACKEND_TIME));
    assert(index < MAX_SO_STREAMS);
 
    pq = (struct swr_query *) AlignedMalloc(sizeof(struct swr_query), 64);
@@ -150,6 +152,17 @@ swr_get_query_result(struct pipe_context *pipe,
       result->b = num_primitives_written > primitives_storage_needed;
    }
       break;
+   /* Driver specific */
+   case SWR_QUERY_CULLED_PRIMITIVES:
+      result->u64 = pq->result.coreFE.CulledPrimitives;
+      break;
+   case SWR_QUERY_EARLY_Z_KILLS:
+      result->u64 = pq->result.core.EarlyZKills;
+      break;
+   case SWR_QUERY_BACKEND_TIME:
+      /* summed over the workers */
+      result->u64 = pq->result.core.BackendTime / 1000;
+      break;
    default:
       assert(0 && "Unsupported query");
       break;
@@ -256,6 +269,47 @@ swr_set_active_query_state(struct pipe_context *pipe, boolean enable)
 {
 }
 
+static const struct pipe_driver_query_info swr_driver_query_list[] = {
+   {"swr-culled-primitives", SWR_QUERY_CULLED_PRIMITIVES, {0},
+    PIPE_DRIVER_QUERY_TYPE_UINT64, PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE},
+   {"swr-early-z-kills", SWR_QUERY_EARLY_Z_KILLS, {0},
+    PIPE_DRIVER_QUERY_TYPE_UINT64, PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE},
+   {"swr-backend-time", SWR_QUERY_BACKEND_TIME, {0},
+    PIPE_DRIVER_QUERY_TYPE_MICROSECONDS, PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE},
+};
+
+int
+swr_get_driver_query_info(struct pipe_screen *screen,
+                          unsigned index,
+                          struct pipe_driver_query_info *info)
+{
+   if (!info)
+      return ARRAY_SIZE(swr_driver_query_list);
+
+   if (index >= ARRAY_SIZE(swr_driver_query_list))
+      return 0;
+
+   *info = swr_driver_query_list[index];
+   return 1;
+}
+
+int
+swr_get_driver_query_group_info(struct pipe_screen *screen,
+                                unsigned index,
+                                struct pipe_driver_query_group_info *info)
+{
+   if (!info)
+      return 1;
+
+   if (index > 0)
+      return 0;
+
+   info->name = "SWR core";
+   info->max_active_queries = ARRAY_SIZE(swr_driver_query_list);
+   info->num_queries = ARRAY_SIZE(swr_driver_query_list);
+   return 1;
+}
+
 void
 swr_query_init(struct pipe_context *pipe)
 {
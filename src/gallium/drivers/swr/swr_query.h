@@ -42,7 +42,20 @@ OSALIGNLINE(struct) swr_query {
    struct pipe_fence_handle *fence;
 };
 
+/* Efficiency counters of the core, for the HUD and performance monitors */
+#define SWR_QUERY_CULLED_PRIMITIVES (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define SWR_QUERY_EARLY_Z_KILLS     (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+#define SWR_QUERY_BACKEND_TIME      (PIPE_QUERY_DRIVER_SPECIFIC + 2)
+
 extern void swr_query_init(struct pipe_context *pipe);
 
+extern int swr_get_driver_query_info(struct pipe_screen *screen,
+                                     unsigned index,
+                                     struct pipe_driver_query_info *info);
+
+extern int swr_get_driver_query_group_info(struct pipe_screen *screen,
+                                           unsigned index,
+                                           struct pipe_driver_query_group_info *info);
+
 extern boolean swr_check_render_cond(struct pipe_context *pipe);
 #endif
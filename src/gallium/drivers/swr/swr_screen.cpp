@@ -26,6 +26,7 @@
 #include "swr_screen.h"
 #include "swr_resource.h"
 #include "swr_fence.h"
+#include "swr_query.h"
 #include "gen_knobs.h"
 
 #include "pipe/p_screen.h"
@@ -37,9 +38,14 @@
 #include "util/u_format_s3tc.h"
 #include "util/u_string.h"
 #include "util/u_screen.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 
 #include "state_tracker/sw_winsys.h"
 
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_init.h"
+
 #include "jit_api.h"
 
 #include "memory/TilingFunctions.h"
@@ -1089,6 +1095,9 @@ swr_destroy_screen_internal(struct swr_screen **screen)
 
    JitDestroyContext((*screen)->hJitMgr);
 
+   disk_cache_destroy((*screen)->disk_shader_cache);
+   FREE((*screen)->jit_object_store);
+
    if ((*screen)->pLibrary)
       util_dl_close((*screen)->pLibrary);
 
@@ -1154,6 +1163,119 @@ swr_validate_env_options(struct swr_screen *screen)
 }
 
 
+static struct disk_cache *
+swr_get_disk_shader_cache(struct pipe_screen *p_screen)
+{
+   return swr_screen(p_screen)->disk_shader_cache;
+}
+
+
+static void
+swr_disk_cache_create(struct swr_screen *screen)
+{
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char cache_id[20 * 2 + 1];
+   unsigned simd_width = KNOB_SIMD_WIDTH;
+
+   _mesa_sha1_init(&ctx);
+
+   if (!disk_cache_get_function_identifier((void *)swr_disk_cache_create,
+                                           &ctx) ||
+       !disk_cache_get_function_identifier((void *)JitCreateContext, &ctx))
+      return;
+
+   /* The generated code depends on these and is only valid on this CPU. */
+   _mesa_sha1_update(&ctx, &gallivm_perf, sizeof(gallivm_perf));
+   _mesa_sha1_update(&ctx, &simd_width, sizeof(simd_width));
+   _mesa_sha1_update(&ctx, &util_cpu_caps, sizeof(util_cpu_caps));
+
+   _mesa_sha1_final(&ctx, sha1);
+   disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+   screen->disk_shader_cache = disk_cache_create("swr", cache_id, 0);
+}
+
+
+/**
+ * Look up the machine code of a shader variant in the disk cache, and put
+ * it in cache->data if found.
+ */
+void
+swr_disk_cache_find_shader(struct swr_screen *screen,
+                           struct lp_cached_code *cache,
+                           const unsigned char ir_sha1_cache_key[20])
+{
+   unsigned char sha1[CACHE_KEY_SIZE];
+   size_t binary_size;
+   uint8_t *buffer;
+
+   if (!screen->disk_shader_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key, 20,
+                          sha1);
+
+   buffer = (uint8_t *)disk_cache_get(screen->disk_shader_cache, sha1,
+                                      &binary_size);
+   if (!buffer) {
+      cache->data_size = 0;
+      return;
+   }
+
+   cache->data_size = binary_size;
+   cache->data = buffer;
+}
+
+
+/**
+ * Store the machine code of a shader variant, generated while compiling it
+ * with \p cache, in the disk cache.
+ */
+void
+swr_disk_cache_insert_shader(struct swr_screen *screen,
+                             struct lp_cached_code *cache,
+                             const unsigned char ir_sha1_cache_key[20])
+{
+   unsigned char sha1[CACHE_KEY_SIZE];
+
+   if (!screen->disk_shader_cache || !cache->data_size || cache->dont_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key, 20,
+                          sha1);
+   disk_cache_put(screen->disk_shader_cache, sha1, cache->data,
+                  cache->data_size, NULL);
+}
+
+
+/* The fetch, blend and streamout functions go through the same cache, keyed
+ * by the rasterizer's JitCache on their IR.
+ */
+static void *
+swr_jit_object_get(void *priv, const void *key, size_t key_size,
+                   size_t *obj_size)
+{
+   struct disk_cache *cache = (struct disk_cache *)priv;
+   unsigned char sha1[CACHE_KEY_SIZE];
+
+   disk_cache_compute_key(cache, key, key_size, sha1);
+   return disk_cache_get(cache, sha1, obj_size);
+}
+
+
+static void
+swr_jit_object_put(void *priv, const void *key, size_t key_size,
+                   const void *obj, size_t obj_size)
+{
+   struct disk_cache *cache = (struct disk_cache *)priv;
+   unsigned char sha1[CACHE_KEY_SIZE];
+
+   disk_cache_compute_key(cache, key, key_size, sha1);
+   disk_cache_put(cache, sha1, obj, obj_size, NULL);
+}
+
+
 struct pipe_screen *
 swr_create_screen_internal(struct sw_winsys *winsys)
 {
@@ -1183,10 +1305,24 @@ swr_create_screen_internal(struct sw_winsys *winsys)
    screen->base.resource_destroy = swr_resource_destroy;
 
    screen->base.flush_frontbuffer = swr_flush_frontbuffer;
+   screen->base.get_disk_shader_cache = swr_get_disk_shader_cache;
+   screen->base.get_driver_query_info = swr_get_driver_query_info;
+   screen->base.get_driver_query_group_info = swr_get_driver_query_group_info;
 
    // Pass in "" for architecture for run-time determination
    screen->hJitMgr = JitCreateContext(KNOB_SIMD_WIDTH, "", "swr");
 
+   swr_disk_cache_create(screen);
+   if (screen->disk_shader_cache) {
+      screen->jit_object_store = CALLOC_STRUCT(JIT_OBJECT_STORE);
+      if (screen->jit_object_store) {
+         screen->jit_object_store->pPrivate = screen->disk_shader_cache;
+         screen->jit_object_store->pfnGet = swr_jit_object_get;
+         screen->jit_object_store->pfnPut = swr_jit_object_put;
+         JitSetObjectStore(screen->hJitMgr, screen->jit_object_store);
+      }
+   }
+
    swr_fence_init(&screen->base);
 
    swr_validate_env_options(screen);
@@ -35,6 +35,9 @@
 #include "memory/TilingFunctions.h"
 
 struct sw_winsys;
+struct disk_cache;
+struct lp_cached_code;
+struct JIT_OBJECT_STORE;
 
 struct swr_screen {
    struct pipe_screen base;
@@ -51,6 +54,10 @@ struct swr_screen {
 
    HANDLE hJitMgr;
 
+   /* Shaders and fetch/blend/streamout functions compiled by any process */
+   struct disk_cache *disk_shader_cache;
+   struct JIT_OBJECT_STORE *jit_object_store;
+
    /* Dynamic backend implementations */
    util_dl_library *pLibrary;
    PFNSwrGetInterface pfnSwrGetInterface;
@@ -68,4 +75,14 @@ swr_screen(struct pipe_screen *pipe)
 SWR_FORMAT
 mesa_to_swr_format(enum pipe_format format);
 
+void
+swr_disk_cache_find_shader(struct swr_screen *screen,
+                           struct lp_cached_code *cache,
+                           const unsigned char ir_sha1_cache_key[20]);
+
+void
+swr_disk_cache_insert_shader(struct swr_screen *screen,
+                             struct lp_cached_code *cache,
+                             const unsigned char ir_sha1_cache_key[20]);
+
 #endif
@@ -36,8 +36,10 @@
 #include "functionpasses/passes.h"
 
 #include "tgsi/tgsi_strings.h"
+#include "tgsi/tgsi_parse.h"
 #include "util/u_format.h"
 #include "util/u_prim.h"
+#include "util/mesa-sha1.h"
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_flow.h"
 #include "gallivm/lp_bld_struct.h"
@@ -209,12 +211,32 @@ swr_generate_gs_key(struct swr_jit_gs_key &key,
    swr_generate_sampler_key(swr_gs->info, ctx, PIPE_SHADER_GEOMETRY, key);
 }
 
+/**
+ * Disk cache key of a shader variant: the code only depends on the
+ * tokens and on the variant key.
+ */
+static void
+swr_get_ir_cache_key(const struct pipe_shader_state *shader,
+                     const void *key, size_t key_size,
+                     unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, key, key_size);
+   _mesa_sha1_update(&ctx, shader->tokens,
+                     tgsi_num_tokens(shader->tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
 struct BuilderSWR : public Builder {
-   BuilderSWR(JitManager *pJitMgr, const char *pName)
+   BuilderSWR(JitManager *pJitMgr, const char *pName,
+              struct lp_cached_code *cache = NULL)
       : Builder(pJitMgr)
    {
       pJitMgr->SetupNewModule();
-      gallivm = gallivm_create(pName, wrap(&JM()->mContext));
+      gallivm = gallivm_create(pName, wrap(&JM()->mContext), cache);
       pJitMgr->mpCurrentModule = unwrap(gallivm->module);
    }
 
@@ -683,6 +705,8 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
                      &mask,
                      wrap(consts_ptr),
                      wrap(const_sizes_ptr),
+                     NULL, // shader buffers
+                     NULL, // shader buffer sizes
                      &system_values,
                      inputs,
                      outputs,
@@ -690,7 +714,8 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
                      NULL, // thread data
                      sampler,
                      &gs->info.base,
-                     &gs_iface.base);
+                     &gs_iface.base,
+                     NULL); // compute shader iface
 
    lp_build_mask_end(&mask);
 
@@ -717,12 +742,28 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
 PFN_GS_FUNC
 swr_compile_gs(struct swr_context *ctx, swr_jit_gs_key &key)
 {
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "GS");
-   PFN_GS_FUNC func = builder.CompileGS(ctx, key);
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+   struct lp_cached_code cached = {0};
+   unsigned char ir_sha1_cache_key[20];
+   bool needs_caching;
+
+   swr_get_ir_cache_key(&ctx->gs->pipe, &key, sizeof(key), ir_sha1_cache_key);
+   swr_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+   needs_caching = !cached.data_size;
+
+   PFN_GS_FUNC func;
+   {
+      BuilderSWR builder(reinterpret_cast<JitManager *>(screen->hJitMgr),
+                         "GS", &cached);
+      func = builder.CompileGS(ctx, key);
+
+      ctx->gs->map.insert(std::make_pair(key, make_unique<VariantGS>(builder.gallivm, func)));
+   }
+
+   if (needs_caching)
+      swr_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+   free(cached.data);
 
-   ctx->gs->map.insert(std::make_pair(key, make_unique<VariantGS>(builder.gallivm, func)));
    return func;
 }
 
@@ -834,6 +875,8 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
                      NULL, // mask
                      wrap(consts_ptr),
                      wrap(const_sizes_ptr),
+                     NULL, // shader buffers
+                     NULL, // shader buffer sizes
                      &system_values,
                      inputs,
                      outputs,
@@ -841,7 +884,8 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
                      NULL, // thread data
                      sampler, // sampler
                      &swr_vs->info.base,
-                     NULL); // geometry shader face
+                     NULL, // geometry shader face
+                     NULL); // compute shader iface
 
    sampler->destroy(sampler);
 
@@ -971,12 +1015,28 @@ swr_compile_vs(struct swr_context *ctx, swr_jit_vs_key &key)
    if (!ctx->vs->pipe.tokens)
       return NULL;
 
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "VS");
-   PFN_VERTEX_FUNC func = builder.CompileVS(ctx, key);
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+   struct lp_cached_code cached = {0};
+   unsigned char ir_sha1_cache_key[20];
+   bool needs_caching;
+
+   swr_get_ir_cache_key(&ctx->vs->pipe, &key, sizeof(key), ir_sha1_cache_key);
+   swr_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+   needs_caching = !cached.data_size;
+
+   PFN_VERTEX_FUNC func;
+   {
+      BuilderSWR builder(reinterpret_cast<JitManager *>(screen->hJitMgr),
+                         "VS", &cached);
+      func = builder.CompileVS(ctx, key);
+
+      ctx->vs->map.insert(std::make_pair(key, make_unique<VariantVS>(builder.gallivm, func)));
+   }
+
+   if (needs_caching)
+      swr_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+   free(cached.data);
 
-   ctx->vs->map.insert(std::make_pair(key, make_unique<VariantVS>(builder.gallivm, func)));
    return func;
 }
 
@@ -1324,6 +1384,8 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
                      uses_mask ? &mask : NULL, // mask
                      wrap(consts_ptr),
                      wrap(const_sizes_ptr),
+                     NULL, // shader buffers
+                     NULL, // shader buffer sizes
                      &system_values,
                      inputs,
                      outputs,
@@ -1331,7 +1393,8 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
                      NULL, // thread data
                      sampler, // sampler
                      &swr_fs->info.base,
-                     NULL); // geometry shader face
+                     NULL, // geometry shader face
+                     NULL); // compute shader iface
 
    sampler->destroy(sampler);
 
@@ -1421,11 +1484,27 @@ swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key)
    if (!ctx->fs->pipe.tokens)
       return NULL;
 
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "FS");
-   PFN_PIXEL_KERNEL func = builder.CompileFS(ctx, key);
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+   struct lp_cached_code cached = {0};
+   unsigned char ir_sha1_cache_key[20];
+   bool needs_caching;
+
+   swr_get_ir_cache_key(&ctx->fs->pipe, &key, sizeof(key), ir_sha1_cache_key);
+   swr_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+   needs_caching = !cached.data_size;
+
+   PFN_PIXEL_KERNEL func;
+   {
+      BuilderSWR builder(reinterpret_cast<JitManager *>(screen->hJitMgr),
+                         "FS", &cached);
+      func = builder.CompileFS(ctx, key);
+
+      ctx->fs->map.insert(std::make_pair(key, make_unique<VariantFS>(builder.gallivm, func)));
+   }
+
+   if (needs_caching)
+      swr_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+   free(cached.data);
 
-   ctx->fs->map.insert(std::make_pair(key, make_unique<VariantFS>(builder.gallivm, func)));
    return func;
 }
@@ -453,6 +453,7 @@ v3d_tfu(struct pipe_context *pctx,
         }
 
         dst->writes++;
+        dst->gpu_write_pending = true;
 
         return true;
 }
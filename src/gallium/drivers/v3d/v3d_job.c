@@ -365,6 +365,30 @@ v3d_clif_dump(struct v3d_context *v3d, struct v3d_job *job)
         clif_dump_destroy(clif);
 }
 
+static void
+v3d_job_mark_gpu_writes(struct v3d_job *job)
+{
+        if (job->write_prscs) {
+                set_foreach(job->write_prscs, entry) {
+                        struct pipe_resource *prsc = (void *)entry->key;
+
+                        v3d_resource(prsc)->gpu_write_pending = true;
+                }
+        }
+
+        for (int i = 0; i < V3D_MAX_DRAW_BUFFERS; i++) {
+                if (job->cbufs[i])
+                        v3d_resource(job->cbufs[i]->texture)->gpu_write_pending = true;
+        }
+        if (job->zsbuf) {
+                struct v3d_resource *rsc = v3d_resource(job->zsbuf->texture);
+
+                rsc->gpu_write_pending = true;
+                if (rsc->separate_stencil)
+                        rsc->separate_stencil->gpu_write_pending = true;
+        }
+}
+
 /**
  * Submits the job to the kernel and then reinitializes it.
  */
@@ -414,6 +438,8 @@ v3d_job_submit(struct v3d_context *v3d, struct v3d_job *job)
 
         v3d_clif_dump(v3d, job);
 
+        v3d_job_mark_gpu_writes(job);
+
         if (!(V3D_DEBUG & V3D_DEBUG_NORAST)) {
                 int ret;
 
@@ -105,6 +105,7 @@ v3d_resource_bo_alloc(struct v3d_resource *rsc)
         if (bo) {
                 v3d_bo_unreference(&rsc->bo);
                 rsc->bo = bo;
+                rsc->gpu_write_pending = false;
                 v3d_debug_resource_layout(rsc, "alloc");
                 return true;
         } else {
@@ -112,6 +113,19 @@ v3d_resource_bo_alloc(struct v3d_resource *rsc)
         }
 }
 
+/**
+ * Returns whether a job or TFU blit that wrote the resource may still be
+ * running.
+ */
+bool
+v3d_resource_gpu_write_pending(struct v3d_resource *rsc)
+{
+        if (rsc->gpu_write_pending && v3d_bo_wait(rsc->bo, 0, NULL))
+                rsc->gpu_write_pending = false;
+
+        return rsc->gpu_write_pending;
+}
+
 static void
 v3d_resource_transfer_unmap(struct pipe_context *pctx,
                             struct pipe_transfer *ptrans)
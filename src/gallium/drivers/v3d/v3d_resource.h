@@ -148,6 +148,15 @@ struct v3d_resource {
          */
         uint32_t initialized_buffers;
 
+        /**
+         * Set when a submitted job (or TFU blit) has written the resource,
+         * until we've seen its BO go idle.
+         *
+         * Used for only blocking the binner on the last render when it reads
+         * a resource that may still be being rendered to.
+         */
+        bool gpu_write_pending;
+
         enum pipe_format internal_format;
 
         /* Resource storing the S8 part of a Z32F_S8 resource, or NULL. */
@@ -180,6 +189,7 @@ void v3d_update_shadow_texture(struct pipe_context *pctx,
                                struct pipe_sampler_view *view);
 uint32_t v3d_layer_offset(struct pipe_resource *prsc, uint32_t level,
                           uint32_t layer);
+bool v3d_resource_gpu_write_pending(struct v3d_resource *rsc);
 
 
 #endif /* VC5_RESOURCE_H */
@@ -178,6 +178,33 @@ v3d_predraw_check_stage_inputs(struct pipe_context *pctx,
         }
 }
 
+/**
+ * Returns whether the binner reads any resource that a previously submitted
+ * job may still be writing.
+ */
+static bool
+v3d_bin_inputs_write_pending(struct v3d_context *v3d,
+                             const struct pipe_draw_info *info)
+{
+        struct v3d_texture_stateobj *stage_tex = &v3d->tex[PIPE_SHADER_VERTEX];
+
+        for (int i = 0; i < stage_tex->num_textures; i++) {
+                struct pipe_sampler_view *pview = stage_tex->textures[i];
+                if (!pview)
+                        continue;
+                struct v3d_sampler_view *view = v3d_sampler_view(pview);
+
+                if (v3d_resource_gpu_write_pending(v3d_resource(view->texture)))
+                        return true;
+        }
+
+        if (info->indirect &&
+            v3d_resource_gpu_write_pending(v3d_resource(info->indirect->buffer)))
+                return true;
+
+        return false;
+}
+
 static void
 v3d_emit_gl_shader_state(struct v3d_context *v3d,
                          const struct pipe_draw_info *info)
@@ -501,11 +528,11 @@ v3d_draw_vbo(struct pipe_context *pctx, const struct pipe_draw_info *info)
          * ensure that that rendering is complete before we run a coordinate
          * shader that depends on it.
          *
-         * Given that doing that is unusual, for now we just block the binner
-         * on the last submitted render, rather than tracking the last
-         * rendering to each texture's BO.
+         * We don't track the last rendering to each texture's BO, so if any
+         * of them may still be rendered to, we just block the binner on the
+         * last submitted render.
          */
-        if (v3d->tex[PIPE_SHADER_VERTEX].num_textures || info->indirect) {
+        if (v3d_bin_inputs_write_pending(v3d, info)) {
                 perf_debug("Blocking binner on last render "
                            "due to vertex texturing or indirect drawing.\n");
                 job->submit.in_sync_bcl = v3d->out_sync;
@@ -40,15 +40,16 @@ static void *virgl_buffer_transfer_map(struct pipe_context *ctx,
    struct virgl_transfer *trans;
    void *ptr;
    bool readback;
-   bool flush = false;
+   bool flush;
 
    trans = virgl_resource_create_transfer(&vctx->transfer_pool, resource,
                                           &vbuf->metadata, level, usage, box);
-   if (usage & PIPE_TRANSFER_READ)
-      flush = true;
-   else
-      flush = virgl_res_needs_flush(vctx, trans);
 
+   /* Reads don't need a flush of their own: a buffer that isn't clean is
+    * read back, which virgl_res_needs_flush() already flushes for when
+    * the buffer is used by the current command buffer, and the guest
+    * copy of a clean one is up to date. */
+   flush = virgl_res_needs_flush(vctx, trans);
    if (flush)
       ctx->flush(ctx, NULL, 0);
 
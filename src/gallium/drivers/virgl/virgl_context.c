@@ -36,7 +36,10 @@
 #include "util/u_helpers.h"
 #include "util/slab.h"
 #include "util/u_upload_mgr.h"
+#include "util/hash_table.h"
+#include "util/mesa-sha1.h"
 #include "util/u_blitter.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_text.h"
 #include "indices/u_primconvert.h"
 
@@ -547,15 +550,65 @@ void virgl_transfer_inline_write(struct pipe_context *ctx,
                               box, data, stride, layer_stride);
 }
 
+/*
+ * Identical shaders created on the same context share one host object, so
+ * that neither the TGSI transform and encoding nor the host compile are
+ * repeated for them.  Host objects are per context, so this can't reach
+ * across contexts.
+ */
+struct virgl_shader_cache_entry {
+   unsigned char sha1[20];
+   uint32_t handle;
+   unsigned refcount;
+};
+
+static uint32_t virgl_shader_cache_hash(const void *key)
+{
+   return _mesa_hash_data(key, 20);
+}
+
+static bool virgl_shader_cache_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, 20) == 0;
+}
+
+static void virgl_shader_hash(const struct pipe_shader_state *shader,
+                              unsigned type, unsigned char sha1[20])
+{
+   const struct pipe_stream_output_info *so = &shader->stream_output;
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &type, sizeof(type));
+   _mesa_sha1_update(&ctx, &so->num_outputs, sizeof(so->num_outputs));
+   _mesa_sha1_update(&ctx, so->stride, sizeof(so->stride));
+   _mesa_sha1_update(&ctx, so->output,
+                     so->num_outputs * sizeof(so->output[0]));
+   _mesa_sha1_update(&ctx, shader->tokens,
+                     tgsi_num_tokens(shader->tokens) * sizeof(struct tgsi_token));
+   _mesa_sha1_final(&ctx, sha1);
+}
+
 static void *virgl_shader_encoder(struct pipe_context *ctx,
                                   const struct pipe_shader_state *shader,
                                   unsigned type)
 {
    struct virgl_context *vctx = virgl_context(ctx);
+   struct virgl_shader_cache_entry *cached;
+   struct hash_entry *entry;
+   unsigned char sha1[20];
    uint32_t handle;
    struct tgsi_token *new_tokens;
    int ret;
 
+   virgl_shader_hash(shader, type, sha1);
+   entry = _mesa_hash_table_search(vctx->shader_cache, sha1);
+   if (entry) {
+      cached = entry->data;
+      cached->refcount++;
+      return (void *)(unsigned long)cached->handle;
+   }
+
    new_tokens = virgl_tgsi_transform(vctx, shader->tokens);
    if (!new_tokens)
       return NULL;
@@ -570,9 +623,37 @@ static void *virgl_shader_encoder(struct pipe_context *ctx,
    }
 
    FREE(new_tokens);
+
+   cached = CALLOC_STRUCT(virgl_shader_cache_entry);
+   if (cached) {
+      memcpy(cached->sha1, sha1, sizeof(sha1));
+      cached->handle = handle;
+      cached->refcount = 1;
+      _mesa_hash_table_insert(vctx->shader_cache, cached->sha1, cached);
+      _mesa_hash_table_u64_insert(vctx->shader_handles, handle, cached);
+   }
+
    return (void *)(unsigned long)handle;
 
 }
+
+static void virgl_delete_shader(struct virgl_context *vctx, uint32_t handle)
+{
+   struct virgl_shader_cache_entry *cached =
+      _mesa_hash_table_u64_search(vctx->shader_handles, handle);
+
+   if (cached) {
+      if (--cached->refcount)
+         return;
+
+      _mesa_hash_table_remove_key(vctx->shader_cache, cached->sha1);
+      _mesa_hash_table_u64_remove(vctx->shader_handles, handle);
+      FREE(cached);
+   }
+
+   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+}
+
 static void *virgl_create_vs_state(struct pipe_context *ctx,
                                    const struct pipe_shader_state *shader)
 {
@@ -610,7 +691,7 @@ virgl_delete_fs_state(struct pipe_context *ctx,
    uint32_t handle = (unsigned long)fs;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_delete_shader(vctx, handle);
 }
 
 static void
@@ -620,7 +701,7 @@ virgl_delete_gs_state(struct pipe_context *ctx,
    uint32_t handle = (unsigned long)gs;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_delete_shader(vctx, handle);
 }
 
 static void
@@ -630,7 +711,7 @@ virgl_delete_vs_state(struct pipe_context *ctx,
    uint32_t handle = (unsigned long)vs;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_delete_shader(vctx, handle);
 }
 
 static void
@@ -640,7 +721,7 @@ virgl_delete_tcs_state(struct pipe_context *ctx,
    uint32_t handle = (unsigned long)tcs;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_delete_shader(vctx, handle);
 }
 
 static void
@@ -650,7 +731,7 @@ virgl_delete_tes_state(struct pipe_context *ctx,
    uint32_t handle = (unsigned long)tes;
    struct virgl_context *vctx = virgl_context(ctx);
 
-   virgl_encode_delete_object(vctx, handle, VIRGL_OBJECT_SHADER);
+   virgl_delete_shader(vctx, handle);
 }
 
 static void virgl_bind_vs_state(struct pipe_context *ctx,
@@ -1192,6 +1273,13 @@ virgl_context_destroy( struct pipe_context *ctx )
    util_primconvert_destroy(vctx->primconvert);
    virgl_transfer_queue_fini(&vctx->queue);
 
+   if (vctx->shader_cache) {
+      hash_table_foreach(vctx->shader_cache, entry)
+         FREE(entry->data);
+      _mesa_hash_table_destroy(vctx->shader_cache, NULL);
+   }
+   _mesa_hash_table_u64_destroy(vctx->shader_handles, NULL);
+
    slab_destroy_child(&vctx->transfer_pool);
    FREE(vctx);
 }
@@ -1342,6 +1430,12 @@ struct pipe_context *virgl_context_create(struct pipe_screen *pscreen,
    if (vctx->encoded_transfers)
       vctx->cbuf->cdw = VIRGL_MAX_TBUF_DWORDS;
 
+   vctx->shader_cache = _mesa_hash_table_create(NULL, virgl_shader_cache_hash,
+                                                virgl_shader_cache_equal);
+   vctx->shader_handles = _mesa_hash_table_u64_create(NULL);
+   if (!vctx->shader_cache || !vctx->shader_handles)
+      goto fail;
+
    vctx->primconvert = util_primconvert_create(&vctx->base, rs->caps.caps.v1.prim_mask);
    vctx->uploader = u_upload_create(&vctx->base, 1024 * 1024,
                                      PIPE_BIND_INDEX_BUFFER, PIPE_USAGE_STREAM, 0);
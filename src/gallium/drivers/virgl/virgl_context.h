@@ -30,6 +30,8 @@
 
 #include "virgl_transfer_queue.h"
 
+struct hash_table;
+struct hash_table_u64;
 struct pipe_screen;
 struct tgsi_token;
 struct u_upload_mgr;
@@ -89,6 +91,10 @@ struct virgl_context {
 
    struct primconvert_context *primconvert;
    uint32_t hw_sub_ctx_id;
+
+   /* shader objects by the hash of their TGSI, and by handle */
+   struct hash_table *shader_cache;
+   struct hash_table_u64 *shader_handles;
 };
 
 static inline struct virgl_sampler_view *
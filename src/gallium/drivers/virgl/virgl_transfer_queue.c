@@ -51,18 +51,57 @@ struct list_iteration_args
    enum virgl_transfer_queue_lists type;
 };
 
-static bool transfers_intersect(struct virgl_transfer *queued,
+/* Returns true if the ranges [a, a + a_len) and [b, b + b_len) intersect
+ * or touch, so that their union is a single range. */
+static bool ranges_join(int a, int a_len, int b, int b_len)
+{
+   return a <= b + b_len && b <= a + a_len;
+}
+
+/*
+ * Two transfers can be replaced by one covering the union of their boxes
+ * when that union doesn't cover anything else, i.e. buffer ranges that
+ * intersect or touch, and texture boxes of the same layers that line up
+ * on one axis and intersect or touch on the other.  Texture transfers
+ * also have to address the resource with its own layout, which isn't
+ * the case for the ones staged for a resolve.
+ */
+static bool transfers_can_merge(struct virgl_transfer *queued,
                                 struct virgl_transfer *current)
 {
-   boolean tmp;
    struct pipe_resource *queued_res = queued->base.resource;
    struct pipe_resource *current_res = current->base.resource;
+   const struct pipe_box *a = &queued->base.box;
+   const struct pipe_box *b = &current->base.box;
 
    if (queued_res != current_res)
       return false;
 
-   tmp = u_box_test_intersection_2d(&queued->base.box, &current->base.box);
-   return (tmp == TRUE);
+   if (queued_res->target == PIPE_BUFFER)
+      return ranges_join(a->x, a->width, b->x, b->width);
+
+   if (queued->base.level != current->base.level)
+      return false;
+
+   const struct virgl_resource_metadata *metadata =
+      &virgl_resource(queued_res)->metadata;
+   unsigned level = queued->base.level;
+
+   if (queued->base.stride != metadata->stride[level] ||
+       current->base.stride != metadata->stride[level] ||
+       queued->l_stride != current->l_stride)
+      return false;
+
+   if (a->z != b->z || a->depth != b->depth)
+      return false;
+
+   if (a->x == b->x && a->width == b->width)
+      return ranges_join(a->y, a->height, b->y, b->height);
+
+   if (a->y == b->y && a->height == b->height)
+      return ranges_join(a->x, a->width, b->x, b->width);
+
+   return false;
 }
 
 static bool transfers_overlap(struct virgl_transfer *queued,
@@ -122,8 +161,10 @@ static void replace_unmapped_transfer(struct virgl_transfer_queue *queue,
    struct virgl_transfer *current = args->current;
    struct virgl_transfer *queued = args->queued;
 
+   /* The offset of the box corner that comes first in memory, the union
+    * starts there. */
    u_box_union_2d(&current->base.box, &current->base.box, &queued->base.box);
-   current->offset = current->base.box.x;
+   current->offset = MIN2(current->offset, queued->offset);
 
    remove_transfer(queue, args);
    queue->num_dwords -= (VIRGL_TRANSFER3D_SIZE + 1);
@@ -268,14 +309,12 @@ int virgl_transfer_queue_unmap(struct virgl_transfer_queue *queue,
    res = transfer->base.resource;
    pipe_resource_reference(&pres, res);
 
-   if (res->target == PIPE_BUFFER) {
-      memset(&iter, 0, sizeof(iter));
-      iter.current = transfer;
-      iter.compare = transfers_intersect;
-      iter.action = replace_unmapped_transfer;
-      iter.type = PENDING_LIST;
-      compare_and_perform_action(queue, &iter);
-   }
+   memset(&iter, 0, sizeof(iter));
+   iter.current = transfer;
+   iter.compare = transfers_can_merge;
+   iter.action = replace_unmapped_transfer;
+   iter.type = PENDING_LIST;
+   compare_and_perform_action(queue, &iter);
 
    add_internal(queue, transfer);
    return 0;
@@ -49,6 +49,7 @@ struct pipe_debug_callback;
 struct pipe_depth_stencil_alpha_state;
 struct pipe_device_reset_callback;
 struct pipe_draw_info;
+struct pipe_draw_start_count;
 struct pipe_grid_info;
 struct pipe_fence_handle;
 struct pipe_framebuffer_state;
@@ -108,6 +109,20 @@ struct pipe_context {
    /*@{*/
    void (*draw_vbo)( struct pipe_context *pipe,
                      const struct pipe_draw_info *info );
+
+   /**
+    * Optional.  Perform \p num_draws direct draws that only differ by their
+    * start, count and index bias, which are taken from \p draws rather than
+    * \p info.  Draw i uses info->drawid + i as its draw id.
+    *
+    * info->indirect and info->count_from_stream_output must be NULL,
+    * info->has_user_indices must be false, and info->min_index and
+    * info->max_index must cover all the draws.
+    */
+   void (*multi_draw)( struct pipe_context *pipe,
+                       const struct pipe_draw_info *info,
+                       const struct pipe_draw_start_count *draws,
+                       unsigned num_draws );
    /*@}*/
 
    /**
@@ -455,6 +455,29 @@ struct pipe_screen {
    bool (*is_parallel_shader_compilation_finished)(struct pipe_screen *screen,
                                                    void *shader,
                                                    unsigned shader_type);
+
+   /**
+    * Return the final machine code of a shader CSO, so that it can be stored
+    * in a program binary and recreated by create_shader_from_binary.
+    * Only drivers whose shader CSOs can be shared between contexts should
+    * implement this.
+    *
+    * \param shader  a shader CSO returned by pipe_context::create_*_state
+    * \param size    returns the size of the binary
+    * \return  a binary to be freed with free(), or NULL
+    */
+   void *(*get_shader_binary)(struct pipe_screen *screen,
+                              enum pipe_shader_type shader_type,
+                              void *shader, unsigned *size);
+
+   /**
+    * Create a shader CSO, usable with any context of the screen, from a
+    * binary returned by get_shader_binary.  That may come from an earlier
+    * run, so drivers must return NULL if it doesn't match the device.
+    */
+   void *(*create_shader_from_binary)(struct pipe_screen *screen,
+                                      enum pipe_shader_type shader_type,
+                                      const void *binary, unsigned size);
 };
 
 
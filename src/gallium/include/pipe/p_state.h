@@ -779,6 +779,17 @@ struct pipe_draw_info
 };
 
 
+/**
+ * The per-draw parameters of a pipe_context::multi_draw call.
+ */
+struct pipe_draw_start_count
+{
+   unsigned start;
+   unsigned count;
+   int index_bias; /**< only used by indexed draws */
+};
+
+
 /**
  * Information to describe a blit call.
  */
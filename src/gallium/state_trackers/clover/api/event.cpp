@@ -192,7 +192,7 @@ clEnqueueMarkerWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
    // Create a hard event that depends on the events in the wait list:
    // previous commands in the same queue are implicitly serialized
-   // with respect to it -- hard events always are.
+   // with respect to it -- markers always are, even out of order.
    auto hev = create<hard_event>(q, CL_COMMAND_MARKER, deps);
 
    ret_object(rd_ev, hev);
@@ -204,9 +204,12 @@ clEnqueueMarkerWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
 CLOVER_API cl_int
 clEnqueueBarrier(cl_command_queue d_q) try {
-   obj(d_q);
+   auto &q = obj(d_q);
 
-   // No need to do anything, q preserves data ordering strictly.
+   // No need to do anything for in-order queues, they preserve data
+   // ordering strictly.
+   if (q.out_of_order())
+      create<hard_event>(q, CL_COMMAND_BARRIER, ref_vector<event> {});
 
    return CL_SUCCESS;
 
@@ -227,7 +230,8 @@ clEnqueueBarrierWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
    // Create a hard event that depends on the events in the wait list:
    // subsequent commands in the same queue will be implicitly
-   // serialized with respect to it -- hard events always are.
+   // serialized with respect to it -- barriers always are, even out of
+   // order.
    auto hev = create<hard_event>(q, CL_COMMAND_BARRIER, deps);
 
    ret_object(rd_ev, hev);
@@ -25,6 +25,8 @@
 #include "core/platform.hpp"
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "util/u_debug.h"
 
 using namespace clover;
@@ -40,10 +42,33 @@ namespace {
       pipe->get_compute_param(pipe, ir_format, cap, &v.front());
       return v;
    }
+
+   struct disk_cache *
+   create_disk_cache(const device &dev) {
+#ifdef HAVE_DLFCN_H
+      struct mesa_sha1 ctx;
+      unsigned char sha1[20];
+      char cache_id[20 * 2 + 1];
+
+      // The cached binaries are produced by clover's own LLVM invocation,
+      // so it is the clover build that identifies them.
+      _mesa_sha1_init(&ctx);
+      if (!disk_cache_get_function_identifier(
+             reinterpret_cast<void *>(create_disk_cache), &ctx))
+         return NULL;
+      _mesa_sha1_final(&ctx, sha1);
+      disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+      return disk_cache_create(("clover-" + dev.ir_target()).c_str(),
+                               cache_id, 0);
+#else
+      return NULL;
+#endif
+   }
 }
 
 device::device(clover::platform &platform, pipe_loader_device *ldev) :
-   platform(platform), ldev(ldev) {
+   platform(platform), ldev(ldev), cache(NULL) {
    pipe = pipe_loader_create_screen(ldev);
    if (!pipe || !pipe->get_param(pipe, PIPE_CAP_COMPUTE) ||
        !supports_ir(PIPE_SHADER_IR_NATIVE)) {
@@ -51,9 +76,13 @@ device::device(clover::platform &platform, pipe_loader_device *ldev) :
          pipe->destroy(pipe);
       throw error(CL_INVALID_DEVICE);
    }
+
+   cache = create_disk_cache(*this);
 }
 
 device::~device() {
+   if (cache)
+      disk_cache_destroy(cache);
    if (pipe)
       pipe->destroy(pipe);
    if (ldev)
@@ -293,3 +322,8 @@ device::supported_extensions() const {
       + std::string(has_doubles() ? " cl_khr_fp64" : "")
       + std::string(has_halves() ? " cl_khr_fp16" : "");
 }
+
+struct disk_cache *
+device::disk_cache() const {
+   return cache;
+}
@@ -30,6 +30,8 @@
 #include "core/format.hpp"
 #include "pipe-loader/pipe_loader.h"
 
+struct disk_cache;
+
 namespace clover {
    class platform;
    class root_resource;
@@ -84,6 +86,7 @@ namespace clover {
       enum pipe_endian endianness() const;
       bool supports_ir(enum pipe_shader_ir ir) const;
       std::string supported_extensions() const;
+      struct disk_cache *disk_cache() const;
 
       friend class command_queue;
       friend class root_resource;
@@ -96,6 +99,7 @@ namespace clover {
    private:
       pipe_screen *pipe;
       pipe_loader_device *ldev;
+      struct disk_cache *cache;
    };
 }
 
@@ -72,10 +72,17 @@ command_queue::flush() {
    if (!queued_events.empty()) {
       pipe->flush(pipe, &fence, 0);
 
-      while (!queued_events.empty() &&
-             queued_events.front()().signalled()) {
-         queued_events.front()().fence(fence);
-         queued_events.pop_front();
+      // In an in-order queue the signalled events are always at the
+      // front, in an out-of-order one they can be anywhere.
+      for (auto it = queued_events.begin(); it != queued_events.end();) {
+         if ((*it)().signalled()) {
+            (*it)().fence(fence);
+            it = queued_events.erase(it);
+         } else if (!out_of_order()) {
+            break;
+         } else {
+            ++it;
+         }
       }
 
       screen->fence_reference(screen, &fence, NULL);
@@ -92,11 +99,37 @@ command_queue::profiling_enabled() const {
    return props & CL_QUEUE_PROFILING_ENABLE;
 }
 
+bool
+command_queue::out_of_order() const {
+   return props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+}
+
 void
 command_queue::sequence(hard_event &ev) {
    std::lock_guard<std::mutex> lock(queued_events_mutex);
-   if (!queued_events.empty())
-      queued_events.back()().chain(ev);
+
+   if (!out_of_order()) {
+      if (!queued_events.empty())
+         queued_events.back()().chain(ev);
+
+   } else if (ev.command() == CL_COMMAND_BARRIER ||
+              ev.command() == CL_COMMAND_MARKER || !ev.command()) {
+      // Synchronization points (and the internal event of clFinish())
+      // complete after everything enqueued before them.  Events that are
+      // already signalled don't add to the wait count.
+      for (auto &qev : queued_events)
+         qev().chain(ev);
+
+   } else {
+      // Other commands only wait for their wait list, and for the last
+      // barrier that hasn't been flushed yet.
+      for (auto it = queued_events.rbegin(); it != queued_events.rend(); ++it) {
+         if ((*it)().command() == CL_COMMAND_BARRIER) {
+            (*it)().chain(ev);
+            break;
+         }
+      }
+   }
 
    queued_events.push_back(ev);
 }
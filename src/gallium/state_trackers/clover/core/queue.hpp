@@ -50,6 +50,7 @@ namespace clover {
 
       cl_command_queue_properties properties() const;
       bool profiling_enabled() const;
+      bool out_of_order() const;
 
       const intrusive_ref<clover::context> context;
       const intrusive_ref<clover::device> device;
@@ -65,7 +66,8 @@ namespace clover {
 
    private:
       /// Serialize a hardware event with respect to the previous ones,
-      /// and push it to the pending list.
+      /// or only to the last barrier for out-of-order queues, and push it
+      /// to the pending list.
       void sequence(hard_event &ev);
 
       cl_command_queue_properties props;
@@ -20,6 +20,8 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <unistd.h>
+
 #include "core/resource.hpp"
 #include "core/memory.hpp"
 #include "pipe/p_screen.h"
@@ -139,12 +141,25 @@ root_resource::root_resource(clover::device &dev, memory_obj &obj,
                 PIPE_BIND_COMPUTE_RESOURCE |
                 PIPE_BIND_GLOBAL);
 
-   if (obj.flags() & CL_MEM_USE_HOST_PTR && user_ptr_support) {
-      // Page alignment is normally required for this, just try, hope for the
-      // best and fall back if it fails.
-      pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info, obj.host_ptr());
-      if (pipe)
+   if (obj.flags() & CL_MEM_USE_HOST_PTR && user_ptr_support &&
+       info.target == PIPE_BUFFER) {
+      // Drivers need page aligned user memory, so wrap the pages spanned
+      // by the host buffer and point at the host data within them.  Fall
+      // back to a copy if this fails anyway.
+      const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+      const uintptr_t ptr = reinterpret_cast<uintptr_t>(obj.host_ptr());
+      const uintptr_t start = ptr & ~(page_size - 1);
+      const uintptr_t end = (ptr + obj.size() + page_size - 1) &
+         ~(page_size - 1);
+
+      info.width0 = end - start;
+      pipe = dev.pipe->resource_from_user_memory(
+         dev.pipe, &info, reinterpret_cast<void *>(start));
+      if (pipe) {
+         offset = {{ ptr - start, 0, 0 }};
          return;
+      }
+      info.width0 = obj.size();
    }
 
    if (obj.flags() & (CL_MEM_ALLOC_HOST_PTR | CL_MEM_USE_HOST_PTR)) {
@@ -24,6 +24,7 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <llvm/Config/llvm-config.h>
 #include <llvm/IR/DiagnosticPrinter.h>
 #include <llvm/IR/DiagnosticInfo.h>
 #include <llvm/IR/LLVMContext.h>
@@ -52,6 +53,7 @@
 #include "llvm/metadata.hpp"
 #include "llvm/util.hpp"
 #include "util/algorithm.hpp"
+#include "util/disk_cache.h"
 
 
 using namespace clover;
@@ -291,15 +293,116 @@ namespace {
    }
 }
 
+namespace {
+   bool
+   use_disk_cache(const device &dev) {
+      // The dumps are produced while compiling.
+      return dev.disk_cache() && !has_flag(debug::clc) &&
+         !has_flag(debug::llvm) && !has_flag(debug::native);
+   }
+
+   ///
+   /// Compute the cache key of a build from \a input, which must uniquely
+   /// describe the inputs of the build besides the device.
+   ///
+   void
+   compute_cache_key(const device &dev, const std::string &input,
+                     cache_key key) {
+      std::ostringstream oss;
+
+      oss << LLVM_VERSION_STRING << '\0' << dev.ir_target() << '\0'
+          << dev.device_clc_version() << '\0'
+          << dev.supported_extensions() << '\0' << input;
+
+      const std::string data = oss.str();
+      disk_cache_compute_key(dev.disk_cache(), data.data(), data.size(), key);
+   }
+
+   ///
+   /// Look up a build in the disk cache.  The entries are the build log
+   /// followed by the serialized module.
+   ///
+   bool
+   load_cached_module(const device &dev, const cache_key key,
+                      module &m, std::string &r_log) {
+      size_t size;
+      char *buffer = static_cast<char *>(
+         disk_cache_get(dev.disk_cache(), key, &size));
+
+      if (!buffer)
+         return false;
+
+      try {
+         std::istringstream iss(std::string(buffer, size));
+         uint32_t log_size;
+
+         iss.exceptions(std::ios::failbit | std::ios::badbit);
+         iss.read(reinterpret_cast<char *>(&log_size), sizeof(log_size));
+
+         std::string log(log_size, '\0');
+         iss.read(&log[0], log_size);
+
+         m = module::deserialize(iss);
+         r_log += log;
+      } catch (std::exception &) {
+         free(buffer);
+         return false;
+      }
+
+      free(buffer);
+      return true;
+   }
+
+   void
+   store_cached_module(const device &dev, const cache_key key,
+                       const module &m, const std::string &log) {
+      std::ostringstream oss;
+      const uint32_t log_size = log.size();
+
+      oss.write(reinterpret_cast<const char *>(&log_size), sizeof(log_size));
+      oss << log;
+      m.serialize(oss);
+
+      const std::string data = oss.str();
+      disk_cache_put(dev.disk_cache(), key, data.data(), data.size(), NULL);
+   }
+}
+
 module
 clover::llvm::compile_program(const std::string &source,
                               const header_map &headers,
                               const device &dev,
                               const std::string &opts,
                               std::string &r_log) {
+   // Files included from the file system aren't part of the key, so don't
+   // cache anything that may include one.
+   const bool cached = use_disk_cache(dev) &&
+      source.find("include") == std::string::npos &&
+      std::none_of(headers.begin(), headers.end(),
+                   [](const std::pair<std::string, std::string> &header) {
+                      return header.second.find("include") !=
+                         std::string::npos;
+                   });
+   cache_key key;
+   module m;
+
+   if (cached) {
+      std::ostringstream input;
+
+      input << "compile" << '\0' << opts << '\0';
+      for (auto &header : headers)
+         input << header.first << '\0' << header.second << '\0';
+      input << source;
+
+      compute_cache_key(dev, input.str(), key);
+      if (load_cached_module(dev, key, m, r_log))
+         return m;
+   }
+
    if (has_flag(debug::clc))
       debug::log(".cl", "// Options: " + opts + '\n' + source);
 
+   const size_t log_start = r_log.size();
    auto ctx = create_context(r_log);
    auto c = create_compiler_instance(dev, tokenize(opts + " input.cl"), r_log);
    auto mod = compile(*ctx, *c, "input.cl", source, headers, dev, opts, r_log);
@@ -307,7 +410,12 @@ clover::llvm::compile_program(const std::string &source,
    if (has_flag(debug::llvm))
       debug::log(".ll", print_module_bitcode(*mod));
 
-   return build_module_library(*mod, module::section::text_intermediate);
+   m = build_module_library(*mod, module::section::text_intermediate);
+
+   if (cached)
+      store_cached_module(dev, key, m, r_log.substr(log_start));
+
+   return m;
 }
 
 namespace {
@@ -369,6 +477,24 @@ clover::llvm::link_program(const std::vector<module> &modules,
    const bool create_library = count("-create-library", options);
    erase_if(equals("-create-library"), options);
 
+   const bool cached = use_disk_cache(dev);
+   cache_key key;
+
+   if (cached) {
+      std::ostringstream input;
+
+      input << "link" << '\0' << opts << '\0';
+      for (auto &m : modules)
+         m.serialize(input);
+
+      compute_cache_key(dev, input.str(), key);
+
+      module m;
+      if (load_cached_module(dev, key, m, r_log))
+         return m;
+   }
+
+   const size_t log_start = r_log.size();
    auto ctx = create_context(r_log);
    auto c = create_compiler_instance(dev, options, r_log);
    auto mod = link(*ctx, *c, modules, r_log);
@@ -382,16 +508,23 @@ clover::llvm::link_program(const std::vector<module> &modules,
    if (has_flag(debug::llvm))
       debug::log(id + ".ll", print_module_bitcode(*mod));
 
+   module m;
+
    if (create_library) {
-      return build_module_library(*mod, module::section::text_library);
+      m = build_module_library(*mod, module::section::text_library);
 
    } else if (dev.ir_format() == PIPE_SHADER_IR_NATIVE) {
       if (has_flag(debug::native))
          debug::log(id +  ".asm", print_module_native(*mod, dev.ir_target()));
 
-      return build_module_native(*mod, dev.ir_target(), *c, r_log);
+      m = build_module_native(*mod, dev.ir_target(), *c, r_log);
 
    } else {
       unreachable("Unsupported IR.");
    }
+
+   if (cached)
+      store_cached_module(dev, key, m, r_log.substr(log_start));
+
+   return m;
 }
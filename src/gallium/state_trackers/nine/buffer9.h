@@ -32,6 +32,9 @@
 #include "pipe/p_state.h"
 #include "util/list.h"
 
+/* Managed buffer updates up to this size are copied into the csmt queue */
+#define NINE_BUFFER_INLINE_UPLOAD_MAX 4096
+
 struct pipe_screen;
 struct pipe_context;
 struct pipe_transfer;
@@ -104,12 +107,20 @@ NineBuffer9_Upload( struct NineBuffer9 *This )
     struct NineDevice9 *device = This->base.base.device;
 
     assert(This->base.pool == D3DPOOL_MANAGED && This->managed.dirty);
-    nine_context_range_upload(device, &This->managed.pending_upload,
-                              (struct NineUnknown *)This,
-                              This->base.resource,
-                              This->managed.dirty_box.x,
-                              This->managed.dirty_box.width,
-                              (char *)This->managed.data + This->managed.dirty_box.x);
+    /* Small updates are copied into the csmt queue, so that the next Lock
+     * doesn't have to wait for the worker to read managed.data. */
+    if (This->managed.dirty_box.width <= NINE_BUFFER_INLINE_UPLOAD_MAX)
+        nine_context_range_upload_inline(device, This->base.resource,
+                                         This->managed.dirty_box.x,
+                                         (uint8_t *)This->managed.data + This->managed.dirty_box.x,
+                                         This->managed.dirty_box.width);
+    else
+        nine_context_range_upload(device, &This->managed.pending_upload,
+                                  (struct NineUnknown *)This,
+                                  This->base.resource,
+                                  This->managed.dirty_box.x,
+                                  This->managed.dirty_box.width,
+                                  (char *)This->managed.data + This->managed.dirty_box.x);
     This->managed.dirty = FALSE;
 }
 
@@ -112,6 +112,8 @@ struct NineDevice9
         float *ps_const;
 
         struct util_hash_table *ht_fvf;
+
+        struct disk_cache *disk_cache; /* owned by the screen */
     } ff;
 
     struct {
@@ -20,6 +20,8 @@
 #include "pipe/p_context.h"
 #include "tgsi/tgsi_ureg.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/disk_cache.h"
 #include "util/u_box.h"
 #include "util/u_hash_table.h"
 #include "util/u_upload_mgr.h"
@@ -168,13 +170,24 @@ static int nine_ff_fvf_key_comp(void *key1, void *key2)
 static void nine_ff_prune_vs(struct NineDevice9 *);
 static void nine_ff_prune_ps(struct NineDevice9 *);
 
-static void nine_ureg_tgsi_dump(struct ureg_program *ureg, boolean override)
+static void nine_ff_tgsi_dump(const struct tgsi_token *toks, boolean override)
 {
-    if (debug_get_bool_option("NINE_FF_DUMP", FALSE) || override) {
-        const struct tgsi_token *toks = ureg_get_tokens(ureg, NULL);
+    if (debug_get_bool_option("NINE_FF_DUMP", FALSE) || override)
         tgsi_dump(toks, 0);
-        ureg_free_tokens(toks);
-    }
+}
+
+/* Take the tokens out of a finished ureg program, which is destroyed. */
+static const struct tgsi_token *
+nine_ff_get_tokens(struct ureg_program *ureg)
+{
+    const struct tgsi_token *toks;
+
+    ureg_END(ureg);
+    toks = ureg_get_tokens(ureg, NULL);
+    ureg_destroy(ureg);
+    if (toks)
+        nine_ff_tgsi_dump(toks, FALSE);
+    return toks;
 }
 
 #define _X(r) ureg_scalar(ureg_src(r), TGSI_SWIZZLE_X)
@@ -328,7 +341,7 @@ ureg_normalize3(struct ureg_program *ureg,
     ureg_release_temporary(ureg, tmp);
 }
 
-static void *
+static const struct tgsi_token *
 nine_ff_build_vs(struct NineDevice9 *device, struct vs_build_ctx *vs)
 {
     const struct nine_ff_vs_key *key = vs->key;
@@ -1058,9 +1071,7 @@ nine_ff_build_vs(struct NineDevice9 *device, struct vs_build_ctx *vs)
     if (key->position_t && device->driver_caps.window_space_position_support)
         ureg_property(ureg, TGSI_PROPERTY_VS_WINDOW_SPACE_POSITION, TRUE);
 
-    ureg_END(ureg);
-    nine_ureg_tgsi_dump(ureg, FALSE);
-    return ureg_create_shader_and_destroy(ureg, device->context.pipe);
+    return nine_ff_get_tokens(ureg);
 }
 
 /* PS FF constants layout:
@@ -1313,7 +1324,7 @@ ps_do_ts_op(struct ps_build_ctx *ps, unsigned top, struct ureg_dst dst, struct u
     ureg_release_temporary(ureg, tmp2);
 }
 
-static void *
+static const struct tgsi_token *
 nine_ff_build_ps(struct NineDevice9 *device, struct nine_ff_ps_key *key)
 {
     struct ps_build_ctx ps;
@@ -1553,9 +1564,128 @@ nine_ff_build_ps(struct NineDevice9 *device, struct nine_ff_ps_key *key)
         ureg_MOV(ureg, oCol, ps.rCurSrc);
     }
 
-    ureg_END(ureg);
-    nine_ureg_tgsi_dump(ureg, FALSE);
-    return ureg_create_shader_and_destroy(ureg, device->context.pipe);
+    return nine_ff_get_tokens(ureg);
+}
+
+/* Generated ff shaders are stored in the driver's shader disk cache, so that
+ * the next run can skip building them with ureg.
+ * An entry is made of the size of the stage specific data (the vs input
+ * map), that data, and the TGSI tokens.
+ * The key hashes the ff key and the screen caps the generation depends on.
+ */
+static void
+nine_ff_compute_cache_key(struct NineDevice9 *device, unsigned processor,
+                          const void *key, unsigned key_size,
+                          cache_key cache_key)
+{
+    struct pipe_screen *screen = device->screen;
+    struct {
+        char magic[8];
+        uint32_t processor;
+        uint32_t texcoord_sn;
+        uint32_t window_space_position;
+        uint32_t fs_position_is_sysval;
+        uint64_t value64[6];
+    } data;
+
+    assert(key_size <= sizeof(data.value64));
+
+    memset(&data, 0, sizeof(data));
+    memcpy(data.magic, "nine_ff", 8);
+    data.processor = processor;
+    data.texcoord_sn = get_texcoord_sn(screen);
+    data.window_space_position = device->driver_caps.window_space_position_support;
+    data.fs_position_is_sysval =
+        screen->get_param(screen, PIPE_CAP_TGSI_FS_POSITION_IS_SYSVAL);
+    memcpy(data.value64, key, key_size);
+
+    disk_cache_compute_key(device->ff.disk_cache, &data, sizeof(data), cache_key);
+}
+
+/* On a hit, the extra data is copied to @extra and the tokens are returned,
+ * to be released with ureg_free_tokens(). */
+static const struct tgsi_token *
+nine_ff_cache_retrieve(struct NineDevice9 *device, const cache_key cache_key,
+                       void *extra, unsigned extra_size)
+{
+    const struct tgsi_token *toks;
+    uint8_t *buffer;
+    uint32_t stored_extra_size;
+    size_t size, toks_size;
+    void *copy;
+
+    if (!device->ff.disk_cache)
+        return NULL;
+
+    buffer = disk_cache_get(device->ff.disk_cache, cache_key, &size);
+    if (!buffer)
+        return NULL;
+
+    if (size < sizeof(uint32_t) + extra_size + sizeof(struct tgsi_header))
+        goto fail;
+    memcpy(&stored_extra_size, buffer, sizeof(uint32_t));
+    if (stored_extra_size != extra_size)
+        goto fail;
+    toks_size = size - sizeof(uint32_t) - extra_size;
+    toks = (const struct tgsi_token *)(buffer + sizeof(uint32_t) + extra_size);
+    if (toks_size % sizeof(struct tgsi_token) ||
+        tgsi_num_tokens(toks) * sizeof(struct tgsi_token) != toks_size)
+        goto fail;
+
+    copy = MALLOC(toks_size);
+    if (!copy)
+        goto fail;
+    memcpy(copy, toks, toks_size);
+    if (extra_size)
+        memcpy(extra, buffer + sizeof(uint32_t), extra_size);
+    free(buffer);
+
+    DBG("ff shader found in the disk cache\n");
+    return copy;
+
+fail:
+    free(buffer);
+    return NULL;
+}
+
+static void
+nine_ff_cache_store(struct NineDevice9 *device, const cache_key cache_key,
+                    const void *extra, unsigned extra_size,
+                    const struct tgsi_token *toks)
+{
+    const uint32_t stored_extra_size = extra_size;
+    size_t toks_size, size;
+    uint8_t *data;
+
+    if (!device->ff.disk_cache)
+        return;
+
+    toks_size = tgsi_num_tokens(toks) * sizeof(struct tgsi_token);
+    size = sizeof(uint32_t) + extra_size + toks_size;
+    data = MALLOC(size);
+    if (!data)
+        return;
+
+    memcpy(data, &stored_extra_size, sizeof(uint32_t));
+    if (extra_size)
+        memcpy(data + sizeof(uint32_t), extra, extra_size);
+    memcpy(data + sizeof(uint32_t) + extra_size, toks, toks_size);
+
+    disk_cache_put(device->ff.disk_cache, cache_key, data, size, NULL);
+    FREE(data);
+}
+
+static void *
+nine_ff_create_shader(struct NineDevice9 *device, unsigned processor,
+                      const struct tgsi_token *toks)
+{
+    struct pipe_context *pipe = device->context.pipe;
+    struct pipe_shader_state state;
+
+    pipe_shader_state_from_tgsi(&state, toks);
+    if (processor == PIPE_SHADER_VERTEX)
+        return pipe->create_vs_state(pipe, &state);
+    return pipe->create_fs_state(pipe, &state);
 }
 
 static struct NineVertexShader9 *
@@ -1570,6 +1700,12 @@ nine_ff_get_vs(struct NineDevice9 *device)
     boolean has_indexes = false;
     boolean has_weights = false;
     char input_texture_coord[8];
+    const struct tgsi_token *toks = NULL;
+    cache_key cache_key;
+    struct {
+        uint32_t num_inputs;
+        uint16_t input[PIPE_MAX_ATTRIBS];
+    } cached_inputs;
 
     assert(sizeof(key) <= sizeof(key.value32));
 
@@ -1687,7 +1823,29 @@ nine_ff_get_vs(struct NineDevice9 *device)
     vs = util_hash_table_get(device->ff.ht_vs, &key);
     if (vs)
         return vs;
-    NineVertexShader9_new(device, &vs, NULL, nine_ff_build_vs(device, &bld));
+
+    if (device->ff.disk_cache)
+        nine_ff_compute_cache_key(device, PIPE_SHADER_VERTEX,
+                                  &key, sizeof(key), cache_key);
+    toks = nine_ff_cache_retrieve(device, cache_key,
+                                  &cached_inputs, sizeof(cached_inputs));
+    if (toks) {
+        bld.num_inputs = cached_inputs.num_inputs;
+        memcpy(bld.input, cached_inputs.input, sizeof(bld.input));
+    } else {
+        toks = nine_ff_build_vs(device, &bld);
+        if (toks) {
+            cached_inputs.num_inputs = bld.num_inputs;
+            memcpy(cached_inputs.input, bld.input, sizeof(cached_inputs.input));
+            nine_ff_cache_store(device, cache_key,
+                                &cached_inputs, sizeof(cached_inputs), toks);
+        }
+    }
+    if (toks) {
+        NineVertexShader9_new(device, &vs, NULL,
+                              nine_ff_create_shader(device, PIPE_SHADER_VERTEX, toks));
+        ureg_free_tokens(toks);
+    }
 
     nine_ff_prune_vs(device);
     if (vs) {
@@ -1723,6 +1881,8 @@ nine_ff_get_ps(struct NineDevice9 *device)
     struct nine_ff_ps_key key;
     unsigned s;
     uint8_t sampler_mask = 0;
+    const struct tgsi_token *toks;
+    cache_key cache_key;
 
     assert(sizeof(key) <= sizeof(key.value32));
 
@@ -1841,7 +2001,21 @@ nine_ff_get_ps(struct NineDevice9 *device)
     ps = util_hash_table_get(device->ff.ht_ps, &key);
     if (ps)
         return ps;
-    NinePixelShader9_new(device, &ps, NULL, nine_ff_build_ps(device, &key));
+
+    if (device->ff.disk_cache)
+        nine_ff_compute_cache_key(device, PIPE_SHADER_FRAGMENT,
+                                  &key, sizeof(key), cache_key);
+    toks = nine_ff_cache_retrieve(device, cache_key, NULL, 0);
+    if (!toks) {
+        toks = nine_ff_build_ps(device, &key);
+        if (toks)
+            nine_ff_cache_store(device, cache_key, NULL, 0, toks);
+    }
+    if (toks) {
+        NinePixelShader9_new(device, &ps, NULL,
+                             nine_ff_create_shader(device, PIPE_SHADER_FRAGMENT, toks));
+        ureg_free_tokens(toks);
+    }
 
     nine_ff_prune_ps(device);
     if (ps) {
@@ -2097,6 +2271,9 @@ nine_ff_init(struct NineDevice9 *device)
     device->ff.ht_fvf = util_hash_table_create(nine_ff_fvf_key_hash,
                                                nine_ff_fvf_key_comp);
 
+    if (device->screen->get_disk_shader_cache)
+        device->ff.disk_cache = device->screen->get_disk_shader_cache(device->screen);
+
     device->ff.vs_const = CALLOC(NINE_FF_NUM_VS_CONST, 4 * sizeof(float));
     device->ff.ps_const = CALLOC(NINE_FF_NUM_PS_CONST, 4 * sizeof(float));
 
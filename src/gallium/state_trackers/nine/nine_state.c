@@ -2437,6 +2437,19 @@ CSMT_ITEM_NO_WAIT_WITH_COUNTER(nine_context_range_upload,
     context->pipe->buffer_subdata(context->pipe, res, 0, offset, size, data);
 }
 
+/* Same as nine_context_range_upload, but the data is copied into the
+ * queue, so the caller can overwrite it right away. */
+CSMT_ITEM_NO_WAIT(nine_context_range_upload_inline,
+                  ARG_BIND_RES(struct pipe_resource, res),
+                  ARG_VAL(unsigned, offset),
+                  ARG_MEM(uint8_t, data),
+                  ARG_MEM_SIZE(unsigned, size))
+{
+    struct nine_context *context = &device->context;
+
+    context->pipe->buffer_subdata(context->pipe, res, 0, offset, size, data);
+}
+
 CSMT_ITEM_NO_WAIT_WITH_COUNTER(nine_context_box_upload,
                                ARG_BIND_REF(struct NineUnknown, src_ref),
                                ARG_BIND_RES(struct pipe_resource, res),
@@ -566,6 +566,13 @@ nine_context_range_upload(struct NineDevice9 *device,
                           unsigned size,
                           const void *data);
 
+void
+nine_context_range_upload_inline(struct NineDevice9 *device,
+                                 struct pipe_resource *res,
+                                 unsigned offset,
+                                 const uint8_t *data,
+                                 unsigned size);
+
 void
 nine_context_box_upload(struct NineDevice9 *device,
                         unsigned *counter,
@@ -237,6 +237,9 @@ vlVaCreateContext(VADriverContextP ctx, VAConfigID config_id, int picture_width,
    if (!context)
       return VA_STATUS_ERROR_ALLOCATION_FAILED;
 
+   util_dynarray_init(&context->slice_data, NULL);
+   util_dynarray_init(&context->slice_sizes, NULL);
+
    if (is_vpp) {
       context->decoder = NULL;
    } else {
@@ -370,6 +373,8 @@ vlVaDestroyContext(VADriverContextP ctx, VAContextID context_id)
       vl_deint_filter_cleanup(context->deint);
       FREE(context->deint);
    }
+   util_dynarray_fini(&context->slice_data);
+   util_dynarray_fini(&context->slice_sizes);
    FREE(context);
    handle_table_remove(drv->htab, context_id);
    mtx_unlock(&drv->mutex);
@@ -322,6 +322,21 @@ handleVASliceDataBufferType(vlVaContext *context, vlVaBuffer *buf)
       sizes[num_buffers++] = sizeof(eoi_jpeg);
    }
 
+   /* H.264 and HEVC slices only get a constant start code prepended, so
+    * their data can be kept around until all the slices of the call have
+    * been seen and handed to the decoder at once.
+    */
+   if (format == PIPE_VIDEO_FORMAT_MPEG4_AVC ||
+       format == PIPE_VIDEO_FORMAT_HEVC) {
+      unsigned i;
+
+      for (i = 0; i < num_buffers; ++i) {
+         util_dynarray_append(&context->slice_data, const void *, buffers[i]);
+         util_dynarray_append(&context->slice_sizes, unsigned, sizes[i]);
+      }
+      return;
+   }
+
    if (context->needs_begin_frame) {
       context->decoder->begin_frame(context->decoder, context->target,
          &context->desc.base);
@@ -331,6 +346,27 @@ handleVASliceDataBufferType(vlVaContext *context, vlVaBuffer *buf)
       num_buffers, (const void * const*)buffers, sizes);
 }
 
+static void
+flushSliceData(vlVaContext *context)
+{
+   unsigned num_buffers = util_dynarray_num_elements(&context->slice_sizes, unsigned);
+
+   if (!num_buffers)
+      return;
+
+   if (context->needs_begin_frame) {
+      context->decoder->begin_frame(context->decoder, context->target,
+         &context->desc.base);
+      context->needs_begin_frame = false;
+   }
+   context->decoder->decode_bitstream(context->decoder, context->target, &context->desc.base,
+      num_buffers, util_dynarray_begin(&context->slice_data),
+      util_dynarray_begin(&context->slice_sizes));
+
+   util_dynarray_clear(&context->slice_data);
+   util_dynarray_clear(&context->slice_sizes);
+}
+
 static VAStatus
 handleVAEncMiscParameterTypeRateControl(vlVaContext *context, VAEncMiscParameterBuffer *misc)
 {
@@ -485,10 +521,17 @@ vlVaRenderPicture(VADriverContextP ctx, VAContextID context_id, VABufferID *buff
    for (i = 0; i < num_buffers; ++i) {
       vlVaBuffer *buf = handle_table_get(drv->htab, buffers[i]);
       if (!buf) {
+         flushSliceData(context);
          mtx_unlock(&drv->mutex);
          return VA_STATUS_ERROR_INVALID_BUFFER;
       }
 
+      /* Keep the gathered slices in order with anything that isn't
+       * describing slices. */
+      if (buf->type != VASliceParameterBufferType &&
+          buf->type != VASliceDataBufferType)
+         flushSliceData(context);
+
       switch (buf->type) {
       case VAPictureParameterBufferType:
          vaStatus = handlePictureParameterBuffer(drv, context, buf);
@@ -533,6 +576,7 @@ vlVaRenderPicture(VADriverContextP ctx, VAContextID context_id, VABufferID *buff
          break;
       }
    }
+   flushSliceData(context);
    mtx_unlock(&drv->mutex);
 
    return vaStatus;
@@ -677,6 +677,7 @@ vlVaCreateSurfaces2(VADriverContextP ctx, unsigned int format,
    int i;
    int memory_type;
    int expected_fourcc;
+   bool export_hint;
    VAStatus vaStatus;
    vlVaSurface *surf;
 
@@ -700,6 +701,7 @@ vlVaCreateSurfaces2(VADriverContextP ctx, unsigned int format,
    memory_attribute = NULL;
    memory_type = VA_SURFACE_ATTRIB_MEM_TYPE_VA;
    expected_fourcc = 0;
+   export_hint = false;
 
    for (i = 0; i < num_attribs && attrib_list; i++) {
       if ((attrib_list[i].type == VASurfaceAttribPixelFormat) &&
@@ -731,6 +733,16 @@ vlVaCreateSurfaces2(VADriverContextP ctx, unsigned int format,
             return VA_STATUS_ERROR_INVALID_PARAMETER;
          memory_attribute = (VASurfaceAttribExternalBuffers *)attrib_list[i].value.value.p;
       }
+
+#if VA_CHECK_VERSION(1, 1, 0)
+      if ((attrib_list[i].type == VASurfaceAttribUsageHint) &&
+          (attrib_list[i].flags & VA_SURFACE_ATTRIB_SETTABLE)) {
+         if (attrib_list[i].value.type != VAGenericValueTypeInteger)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+         if (attrib_list[i].value.value.i & VA_SURFACE_ATTRIB_USAGE_HINT_EXPORT)
+            export_hint = true;
+      }
+#endif
    }
 
    if (VA_RT_FORMAT_YUV420 != format &&
@@ -769,6 +781,17 @@ vlVaCreateSurfaces2(VADriverContextP ctx, unsigned int format,
       PIPE_VIDEO_CAP_PREFERS_INTERLACED
    );
 
+   /* Exporting (or deriving) an interlaced surface means weaving it into a
+    * progressive copy first, so allocate the surfaces that are going to be
+    * exported progressive from the start when the decoder can handle it.
+    */
+   if (export_hint && templat.interlaced &&
+       pscreen->get_video_param(pscreen,
+                                PIPE_VIDEO_PROFILE_UNKNOWN,
+                                PIPE_VIDEO_ENTRYPOINT_BITSTREAM,
+                                PIPE_VIDEO_CAP_SUPPORTS_PROGRESSIVE))
+      templat.interlaced = 0;
+
    if (expected_fourcc) {
       enum pipe_format expected_format = VaFourccToPipeFormat(expected_fourcc);
 
@@ -313,6 +313,10 @@ typedef struct {
    int gop_coeff;
    bool needs_begin_frame;
    void *blit_cs;
+
+   /* slice data gathered during a vaRenderPicture call */
+   struct util_dynarray slice_data; /* const void * */
+   struct util_dynarray slice_sizes; /* unsigned */
 } vlVaContext;
 
 typedef struct {
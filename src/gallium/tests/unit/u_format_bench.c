@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Throughput of the pack/unpack functions of the formats exercised by
+ * u_format_test, to measure changes to the code u_format_pack.py generates.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/os_time.h"
+#include "util/u_format.h"
+#include "util/u_format_tests.h"
+#include "util/u_memory.h"
+
+
+#define WIDTH 1024
+#define HEIGHT 64
+#define ITERATIONS 64
+
+
+static void
+report(const char *name, enum pipe_format format, int64_t start)
+{
+   int64_t elapsed = os_time_get_nano() - start;
+   double mpixels = (double)WIDTH * HEIGHT * ITERATIONS / 1e6;
+
+   printf("%-40s %-20s %10.1f Mpixel/s\n", util_format_name(format), name,
+          mpixels / ((double)elapsed / 1e9));
+}
+
+
+static void
+bench_format(const struct util_format_test_case *test)
+{
+   const struct util_format_description *desc =
+      util_format_description(test->format);
+   unsigned packed_stride =
+      WIDTH / desc->block.width * desc->block.bits / 8;
+   unsigned width = WIDTH - WIDTH % desc->block.width;
+   unsigned height = HEIGHT - HEIGHT % desc->block.height;
+   uint8_t *packed = MALLOC(packed_stride * HEIGHT);
+   uint8_t *rgba8 = MALLOC(WIDTH * HEIGHT * 4);
+   float *rgbaf = MALLOC(WIDTH * HEIGHT * 4 * sizeof(float));
+   unsigned blocksize = desc->block.bits / 8;
+   unsigned i;
+   int64_t start;
+
+   if (!packed || !rgba8 || !rgbaf)
+      goto out;
+
+   /* Fill the image with the packed test value. */
+   for (i = 0; i + blocksize <= packed_stride * HEIGHT; i += blocksize)
+      memcpy(packed + i, test->packed, blocksize);
+
+   if (desc->unpack_rgba_float) {
+      start = os_time_get_nano();
+      for (i = 0; i < ITERATIONS; i++)
+         desc->unpack_rgba_float(rgbaf, WIDTH * 4 * sizeof(float),
+                                 packed, packed_stride, width, height);
+      report("unpack_rgba_float", test->format, start);
+   }
+
+   if (desc->unpack_rgba_8unorm) {
+      start = os_time_get_nano();
+      for (i = 0; i < ITERATIONS; i++)
+         desc->unpack_rgba_8unorm(rgba8, WIDTH * 4,
+                                  packed, packed_stride, width, height);
+      report("unpack_rgba_8unorm", test->format, start);
+   }
+
+   if (desc->pack_rgba_float && desc->unpack_rgba_float) {
+      start = os_time_get_nano();
+      for (i = 0; i < ITERATIONS; i++)
+         desc->pack_rgba_float(packed, packed_stride,
+                               rgbaf, WIDTH * 4 * sizeof(float),
+                               width, height);
+      report("pack_rgba_float", test->format, start);
+   }
+
+   if (desc->pack_rgba_8unorm && desc->unpack_rgba_8unorm) {
+      start = os_time_get_nano();
+      for (i = 0; i < ITERATIONS; i++)
+         desc->pack_rgba_8unorm(packed, packed_stride,
+                                rgba8, WIDTH * 4, width, height);
+      report("pack_rgba_8unorm", test->format, start);
+   }
+
+out:
+   FREE(packed);
+   FREE(rgba8);
+   FREE(rgbaf);
+}
+
+
+int main(int argc, char **argv)
+{
+   enum pipe_format last_format = PIPE_FORMAT_NONE;
+   unsigned i;
+
+   for (i = 0; i < util_format_nr_test_cases; ++i) {
+      const struct util_format_test_case *test = &util_format_test_cases[i];
+
+      /* The tests list several values per format, one is enough here. */
+      if (test->format == last_format)
+         continue;
+      last_format = test->format;
+
+      if (argc > 1 && strcmp(argv[1], util_format_name(test->format)) != 0)
+         continue;
+
+      bench_format(test);
+   }
+
+   return 0;
+}
@@ -0,0 +1,118 @@
+#!/usr/bin/env python2
+##########################################################################
+# 
+# Copyright 2008 VMware, Inc.
+# All Rights Reserved.
+# 
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sub license, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+# 
+# The above copyright notice and this permission notice (including the
+# next paragraph) shall be included in all copies or substantial portions
+# of the Software.
+# 
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+# IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+# ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+# 
+##########################################################################
+
+'''Report the time spent in each pipe call of a trace, as recorded by the
+trace driver, or compare the times of two traces of the same workload.'''
+
+
+import sys
+
+import parse
+
+
+class CallTimes(parse.TraceParser):
+
+    def __init__(self, fp):
+        parse.TraceParser.__init__(self, fp)
+        self.times = {}
+
+    def handle_call(self, call):
+        if call.time is None:
+            return
+        name = call.klass + '::' + call.method
+        count, total, maximum = self.times.get(name, (0, 0, 0))
+        time = call.time.value
+        self.times[name] = (count + 1, total + time, max(maximum, time))
+
+
+def sort_key(options, times):
+    column = {'count': 0, 'total': 1, 'max': 2}[options.sort]
+    return lambda name: -times[name][column]
+
+
+class Main(parse.Main):
+
+    def get_optparser(self):
+        optparser = parse.Main.get_optparser(self)
+        optparser.set_usage("\n\t%prog [options] TRACE [NEW_TRACE]")
+        optparser.add_option("-s", "--sort", type="choice", dest="sort",
+                             choices=["count", "total", "max"], default="total",
+                             help="sort by count, total or max time [default: %default]")
+        optparser.add_option("-n", "--lines", type="int", dest="lines", default=0,
+                             help="only print the first N calls")
+        return optparser
+
+    def main(self):
+        optparser = self.get_optparser()
+        (options, args) = optparser.parse_args(sys.argv[1:])
+
+        if len(args) not in (1, 2):
+            optparser.error('one or two traces expected')
+
+        results = []
+        for arg in args:
+            parser = CallTimes(parse.open_trace(arg))
+            parser.parse()
+            results.append(parser.times)
+
+        if len(results) == 1:
+            self.report(results[0], options)
+        else:
+            self.compare(results[0], results[1], options)
+
+    def limit(self, names, options):
+        if options.lines:
+            return names[:options.lines]
+        return names
+
+    def report(self, times, options):
+        names = sorted(times, key=sort_key(options, times))
+        sys.stdout.write('%-48s %10s %12s %10s %10s\n' %
+                         ('call', 'count', 'total (us)', 'mean (us)', 'max (us)'))
+        for name in self.limit(names, options):
+            count, total, maximum = times[name]
+            sys.stdout.write('%-48s %10u %12u %10.1f %10u\n' %
+                             (name, count, total, float(total) / count, maximum))
+
+    def compare(self, old, new, options):
+        names = sorted(set(old) | set(new), key=sort_key(options, new))
+        sys.stdout.write('%-48s %12s %12s %8s\n' %
+                         ('call', 'old (us)', 'new (us)', 'change'))
+        for name in self.limit(names, options):
+            old_total = old.get(name, (0, 0, 0))[1]
+            new_total = new.get(name, (0, 0, 0))[1]
+            if old_total:
+                change = '%+7.1f%%' % ((new_total - old_total) * 100.0 / old_total)
+            else:
+                change = ''
+            sys.stdout.write('%-48s %12u %12u %8s\n' %
+                             (name, old_total, new_total, change))
+
+
+if __name__ == '__main__':
+    Main().main()
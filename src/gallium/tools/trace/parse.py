@@ -28,6 +28,8 @@
 
 
 import sys
+import struct
+import binascii
 import xml.parsers.expat
 import optparse
 
@@ -187,13 +189,90 @@ class XmlParser:
         return data
 
 
+class PrefixedFile:
+    """File whose first bytes have already been read."""
+
+    def __init__(self, prefix, fp):
+        self.prefix = prefix
+        self.fp = fp
+
+    def read(self, size):
+        if self.prefix:
+            data = self.prefix[:size]
+            self.prefix = self.prefix[size:]
+            if len(data) < size:
+                data += self.fp.read(size - len(data))
+            return data
+        return self.fp.read(size)
+
+
+# See tr_dump.c.
+BINARY_MAGIC = b'GTRB\x01\0\0\0'
+
+(BIN_CALL, BIN_CALL_END, BIN_ARG, BIN_RET, BIN_NULL, BIN_BOOL, BIN_INT,
+ BIN_UINT, BIN_FLOAT, BIN_BLOB, BIN_STRING, BIN_ENUM, BIN_ARRAY,
+ BIN_ARRAY_END, BIN_STRUCT, BIN_MEMBER, BIN_STRUCT_END, BIN_PTR) = range(1, 19)
+
+
+class BinaryReader:
+    """Reader of the tokens of a binary trace."""
+
+    def __init__(self, fp):
+        self.fp = fp
+        self.names = []
+        self.blobs = []
+
+    def read(self, size):
+        data = self.fp.read(size)
+        if len(data) != size:
+            raise EOFError
+        return data
+
+    def token(self):
+        data = self.fp.read(1)
+        if not data:
+            return None
+        return ord(data)
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = ord(self.read(1))
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def name(self):
+        index = self.varint()
+        if index == len(self.names):
+            self.names.append(self.read(self.varint()).decode('utf-8'))
+        return self.names[index]
+
+    def blob(self):
+        index = self.varint()
+        if index == len(self.blobs):
+            self.blobs.append(self.read(self.varint()))
+        return self.blobs[index]
+
+
 class TraceParser(XmlParser):
 
     def __init__(self, fp):
-        XmlParser.__init__(self, fp)
+        magic = fp.read(len(BINARY_MAGIC))
+        if magic == BINARY_MAGIC:
+            self.reader = BinaryReader(fp)
+        else:
+            self.reader = None
+            XmlParser.__init__(self, PrefixedFile(magic, fp))
         self.last_call_no = 0
     
     def parse(self):
+        if self.reader:
+            self.parse_binary()
+            return
+
         self.element_start('trace')
         while self.token.type not in (ELEMENT_END, EOF):
             call = self.parse_call()
@@ -346,6 +425,91 @@ class TraceParser(XmlParser):
 
         return Pointer(address)
 
+    def parse_binary(self):
+        reader = self.reader
+        while True:
+            token = reader.token()
+            if token is None:
+                break
+            if token != BIN_CALL:
+                raise ValueError('call expected, token %u found' % token)
+            try:
+                call = self.parse_binary_call()
+            except EOFError:
+                # the application didn't exit cleanly
+                break
+            self.handle_call(call)
+
+    def parse_binary_call(self):
+        reader = self.reader
+        no = reader.varint()
+        self.last_call_no = no
+        klass = reader.name()
+        method = reader.name()
+        args = []
+        ret = None
+        time = None
+        while True:
+            token = reader.token()
+            if token is None:
+                raise EOFError
+            if token == BIN_ARG:
+                name = reader.name()
+                args.append((name, self.parse_binary_value()))
+            elif token == BIN_RET:
+                ret = self.parse_binary_value()
+            elif token == BIN_CALL_END:
+                time = Literal(reader.varint())
+                break
+            else:
+                raise ValueError('arg or ret expected, token %u found' % token)
+        return Call(no, klass, method, args, ret, time)
+
+    def parse_binary_value(self, token = None):
+        reader = self.reader
+        if token is None:
+            token = reader.token()
+        if token == BIN_NULL:
+            return Literal(None)
+        if token == BIN_BOOL:
+            return Literal(ord(reader.read(1)))
+        if token == BIN_INT:
+            value = reader.varint()
+            return Literal((value >> 1) ^ -(value & 1))
+        if token == BIN_UINT:
+            return Literal(reader.varint())
+        if token == BIN_FLOAT:
+            return Literal(struct.unpack('<d', reader.read(8))[0])
+        if token == BIN_BLOB:
+            return Blob(binascii.b2a_hex(reader.blob()).upper())
+        if token == BIN_STRING:
+            return Literal(reader.read(reader.varint()).decode('utf-8'))
+        if token == BIN_ENUM:
+            return NamedConstant(reader.name())
+        if token == BIN_ARRAY:
+            elems = []
+            token = reader.token()
+            while token != BIN_ARRAY_END:
+                elems.append(self.parse_binary_value(token))
+                token = reader.token()
+            return Array(elems)
+        if token == BIN_STRUCT:
+            name = reader.name()
+            members = []
+            token = reader.token()
+            while token == BIN_MEMBER:
+                member = reader.name()
+                members.append((member, self.parse_binary_value()))
+                token = reader.token()
+            if token != BIN_STRUCT_END:
+                raise ValueError('member expected, token %s found' % token)
+            return Struct(name, members)
+        if token == BIN_PTR:
+            return Pointer('0x%08x' % reader.varint())
+        if token is None:
+            raise EOFError
+        raise ValueError('value expected, token %u found' % token)
+
     def handle_call(self, call):
         pass
     
@@ -362,6 +526,17 @@ class TraceDumper(TraceParser):
         self.formatter.newline()
         
 
+def open_trace(name):
+    if name.endswith('.gz'):
+        from gzip import GzipFile
+        return GzipFile(name, 'rb')
+    elif name.endswith('.bz2'):
+        from bz2 import BZ2File
+        return BZ2File(name, 'rb')
+    else:
+        return open(name, 'rb')
+
+
 class Main:
     '''Common main class for all retrace command line utilities.''' 
 
@@ -376,15 +551,7 @@ class Main:
             optparser.error('insufficient number of arguments')
 
         for arg in args:
-            if arg.endswith('.gz'):
-                from gzip import GzipFile
-                stream = GzipFile(arg, 'rt')
-            elif arg.endswith('.bz2'):
-                from bz2 import BZ2File
-                stream = BZ2File(arg, 'rU')
-            else:
-                stream = open(arg, 'rt')
-            self.process_arg(stream, options)
+            self.process_arg(open_trace(arg), options)
 
     def get_optparser(self):
         optparser = optparse.OptionParser(
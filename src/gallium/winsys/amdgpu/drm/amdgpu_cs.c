@@ -1277,6 +1277,69 @@ static bool amdgpu_add_sparse_backing_buffers(struct amdgpu_cs_context *cs)
    return true;
 }
 
+static int amdgpu_bo_list_key_compare(const void *a, const void *b)
+{
+   uint64_t ka = *(const uint64_t*)a, kb = *(const uint64_t*)b;
+
+   return ka < kb ? -1 : ka > kb;
+}
+
+/* Return the kernel handle of the buffer list if it's the same as the one
+ * of the previous submission, creating it the second time it's used.
+ * Otherwise, remember the list for the next submission and return 0.
+ *
+ * Most IBs use the same buffers as the previous one. The kernel then doesn't
+ * have to look up all the handles and build a temporary list for each one.
+ *
+ * \param keys  the unique ID and the priority of each buffer
+ */
+static uint32_t amdgpu_cs_reuse_bo_list(struct amdgpu_cs *acs,
+                                        struct drm_amdgpu_bo_list_entry *list,
+                                        uint64_t *keys, unsigned num_handles)
+{
+   struct amdgpu_winsys *ws = acs->ctx->ws;
+   unsigned size = num_handles * sizeof(*keys);
+
+   if (!num_handles)
+      return 0;
+
+   qsort(keys, num_handles, sizeof(*keys), amdgpu_bo_list_key_compare);
+
+   if (num_handles == acs->num_last_bo_list &&
+       !memcmp(keys, acs->last_bo_list, size)) {
+      if (!acs->last_bo_list_handle &&
+          amdgpu_bo_list_create_raw(ws->dev, num_handles, list,
+                                    &acs->last_bo_list_handle)) {
+         acs->last_bo_list_handle = 0;
+         acs->num_last_bo_list = 0;
+      }
+
+      return acs->last_bo_list_handle;
+   }
+
+   if (acs->last_bo_list_handle) {
+      amdgpu_bo_list_destroy_raw(ws->dev, acs->last_bo_list_handle);
+      acs->last_bo_list_handle = 0;
+   }
+
+   if (num_handles > acs->max_last_bo_list) {
+      uint64_t *new_list =
+         REALLOC(acs->last_bo_list, acs->max_last_bo_list * sizeof(*keys),
+                 size);
+
+      if (!new_list) {
+         acs->num_last_bo_list = 0;
+         return 0;
+      }
+      acs->last_bo_list = new_list;
+      acs->max_last_bo_list = num_handles;
+   }
+
+   memcpy(acs->last_bo_list, keys, size);
+   acs->num_last_bo_list = num_handles;
+   return 0;
+}
+
 void amdgpu_cs_submit_ib(void *job, int thread_index)
 {
    struct amdgpu_cs *acs = (struct amdgpu_cs*)job;
@@ -1284,6 +1347,7 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
    struct amdgpu_cs_context *cs = acs->cst;
    int i, r;
    uint32_t bo_list = 0;
+   bool reuse_bo_list = false;
    uint64_t seq_no = 0;
    bool has_user_fence = amdgpu_cs_has_user_fence(cs);
    bool use_bo_list_create = ws->info.drm_minor < 27;
@@ -1324,6 +1388,7 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
 
       struct drm_amdgpu_bo_list_entry *list =
          alloca(cs->num_real_buffers * sizeof(struct drm_amdgpu_bo_list_entry));
+      uint64_t *keys = alloca(cs->num_real_buffers * sizeof(uint64_t));
 
       unsigned num_handles = 0;
       for (i = 0; i < cs->num_real_buffers; ++i) {
@@ -1336,10 +1401,16 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
 
          list[num_handles].bo_handle = buffer->bo->u.real.kms_handle;
          list[num_handles].bo_priority = (util_last_bit(buffer->u.real.priority_usage) - 1) / 2;
+         keys[num_handles] = (uint64_t)buffer->bo->unique_id << 32 |
+                             list[num_handles].bo_priority;
          ++num_handles;
       }
 
-      if (use_bo_list_create) {
+      bo_list = amdgpu_cs_reuse_bo_list(acs, list, keys, num_handles);
+      if (bo_list) {
+         /* Reuse path passing the kernel list of the previous submission. */
+         reuse_bo_list = true;
+      } else if (use_bo_list_create) {
          /* Legacy path creating the buffer list handle and passing it to the CS ioctl. */
          r = amdgpu_bo_list_create_raw(ws->dev, num_handles, list, &bo_list);
          if (r) {
@@ -1366,7 +1437,7 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
       unsigned num_chunks = 0;
 
       /* BO list */
-      if (!use_bo_list_create) {
+      if (!use_bo_list_create && !reuse_bo_list) {
          chunks[num_chunks].chunk_id = AMDGPU_CHUNK_ID_BO_HANDLES;
          chunks[num_chunks].length_dw = sizeof(struct drm_amdgpu_bo_list_in) / 4;
          chunks[num_chunks].chunk_data = (uintptr_t)&bo_list_in;
@@ -1479,7 +1550,7 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
    }
 
    /* Cleanup. */
-   if (bo_list)
+   if (bo_list && !reuse_bo_list)
       amdgpu_bo_list_destroy_raw(ws->dev, bo_list);
 
 cleanup:
@@ -1640,6 +1711,9 @@ static void amdgpu_cs_destroy(struct radeon_cmdbuf *rcs)
 
    amdgpu_cs_sync_flush(rcs);
    util_queue_fence_destroy(&cs->flush_completed);
+   if (cs->last_bo_list_handle)
+      amdgpu_bo_list_destroy_raw(cs->ctx->ws->dev, cs->last_bo_list_handle);
+   FREE(cs->last_bo_list);
    p_atomic_dec(&cs->ctx->ws->num_cs);
    pb_reference(&cs->main.big_ib_buffer, NULL);
    FREE(cs->main.base.prev);
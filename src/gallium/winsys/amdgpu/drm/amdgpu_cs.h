@@ -142,6 +142,15 @@ struct amdgpu_cs {
 
    struct util_queue_fence flush_completed;
    struct pipe_fence_handle *next_fence;
+
+   /* The buffer list of the previous submission, as sorted unique IDs and
+    * priorities, which unlike GEM handles are never reused. The kernel
+    * keeps a list submitted twice in a row for the following ones.
+    * Only used by the submit thread. */
+   uint64_t *last_bo_list;
+   unsigned num_last_bo_list;
+   unsigned max_last_bo_list;
+   uint32_t last_bo_list_handle;
 };
 
 struct amdgpu_fence {
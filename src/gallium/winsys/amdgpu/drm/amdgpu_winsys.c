@@ -224,6 +224,31 @@ static uint64_t amdgpu_query_value(struct radeon_winsys *rws,
       return 0;
    case RADEON_CS_THREAD_TIME:
       return util_queue_get_thread_time_nano(&ws->cs_queue, 0);
+   case RADEON_BO_CACHE_HITS:
+   case RADEON_BO_CACHE_MISSES:
+   case RADEON_BO_CACHE_EVICTIONS: {
+      struct pb_cache_stats stats;
+
+      pb_cache_get_total_stats(&ws->bo_cache, &stats);
+      return value == RADEON_BO_CACHE_HITS ? stats.hits :
+             value == RADEON_BO_CACHE_MISSES ? stats.misses :
+                                               stats.evictions;
+   }
+   case RADEON_SLAB_CACHE_HITS:
+   case RADEON_SLAB_CACHE_MISSES:
+   case RADEON_NUM_SLABS: {
+      uint64_t total = 0;
+
+      for (unsigned i = 0; i < NUM_SLAB_ALLOCATORS; i++) {
+         struct pb_slabs_stats stats;
+
+         pb_slabs_get_stats(&ws->bo_slabs[i], &stats);
+         total += value == RADEON_SLAB_CACHE_HITS ? stats.cache_hits :
+                  value == RADEON_SLAB_CACHE_MISSES ? stats.cache_misses :
+                                                      stats.num_slabs;
+      }
+      return total;
+   }
    }
    return 0;
 }
@@ -724,6 +724,29 @@ static uint64_t radeon_query_value(struct radeon_winsys *rws,
         return retval;
     case RADEON_CS_THREAD_TIME:
         return util_queue_get_thread_time_nano(&ws->cs_queue, 0);
+    case RADEON_BO_CACHE_HITS:
+    case RADEON_BO_CACHE_MISSES:
+    case RADEON_BO_CACHE_EVICTIONS: {
+        struct pb_cache_stats stats;
+
+        pb_cache_get_total_stats(&ws->bo_cache, &stats);
+        return value == RADEON_BO_CACHE_HITS ? stats.hits :
+               value == RADEON_BO_CACHE_MISSES ? stats.misses :
+                                                 stats.evictions;
+    }
+    case RADEON_SLAB_CACHE_HITS:
+    case RADEON_SLAB_CACHE_MISSES:
+    case RADEON_NUM_SLABS: {
+        struct pb_slabs_stats stats;
+
+        if (!ws->info.r600_has_virtual_memory)
+            return 0;
+
+        pb_slabs_get_stats(&ws->bo_slabs, &stats);
+        return value == RADEON_SLAB_CACHE_HITS ? stats.cache_hits :
+               value == RADEON_SLAB_CACHE_MISSES ? stats.cache_misses :
+                                                   stats.num_slabs;
+    }
     }
     return 0;
 }
@@ -553,6 +553,70 @@ gbm_dri_to_gbm_format(int dri_format)
    return 0;
 }
 
+static int
+gbm_format_to_visual_index(uint32_t gbm_format)
+{
+   for (int i = 0; i < ARRAY_SIZE(gbm_dri_visuals_table); i++) {
+      if (gbm_dri_visuals_table[i].gbm_format == gbm_format)
+         return i;
+   }
+
+   return -1;
+}
+
+/**
+ * Returns the modifiers the driver supports for a canonical format, and
+ * their plane counts.  The driver is only queried the first time for each
+ * format, compositors ask for these on every output and buffer setup.
+ */
+static const struct gbm_dri_format_modifiers *
+gbm_dri_get_format_modifiers(struct gbm_dri_device *dri, uint32_t format)
+{
+   struct gbm_dri_format_modifiers *mods;
+   int idx = gbm_format_to_visual_index(format);
+
+   if (idx < 0 || !dri->format_modifiers)
+      return NULL;
+
+   mtx_lock(&dri->mutex);
+   mods = &dri->format_modifiers[idx];
+   if (!mods->queried) {
+      int count = 0;
+
+      mods->queried = true;
+      if (dri->image->queryDmaBufModifiers(dri->screen, format, 0, NULL,
+                                           NULL, &count) && count > 0) {
+         mods->modifiers = calloc(count, sizeof(*mods->modifiers));
+         mods->plane_counts = calloc(count, sizeof(*mods->plane_counts));
+         if (mods->modifiers && mods->plane_counts &&
+             dri->image->queryDmaBufModifiers(dri->screen, format, count,
+                                              mods->modifiers, NULL,
+                                              &mods->count)) {
+            for (int i = 0; i < mods->count; i++) {
+               if (dri->image->base.version < 16 ||
+                   !dri->image->queryDmaBufFormatModifierAttribs ||
+                   !dri->image->queryDmaBufFormatModifierAttribs(
+                      dri->screen, format, mods->modifiers[i],
+                      __DRI_IMAGE_FORMAT_MODIFIER_ATTRIB_PLANE_COUNT,
+                      &mods->plane_counts[i]))
+                  mods->plane_counts[i] = 0;
+            }
+         } else {
+            /* Still report the format as supported, just without the
+             * modifier list. */
+            free(mods->modifiers);
+            free(mods->plane_counts);
+            mods->modifiers = NULL;
+            mods->plane_counts = NULL;
+            mods->count = count;
+         }
+      }
+   }
+   mtx_unlock(&dri->mutex);
+
+   return mods;
+}
+
 static int
 gbm_dri_is_format_supported(struct gbm_device *gbm,
                             uint32_t format,
@@ -584,11 +648,10 @@ gbm_dri_is_format_supported(struct gbm_device *gbm,
    /* Check if the driver returns any modifiers for this format; since linear
     * is counted as a modifier, we will have at least one modifier for any
     * supported format. */
-   if (!dri->image->queryDmaBufModifiers(dri->screen, format, 0, NULL, NULL,
-                                         &count))
-      return 0;
+   const struct gbm_dri_format_modifiers *mods =
+      gbm_dri_get_format_modifiers(dri, format);
 
-   return (count > 0);
+   return mods && mods->count > 0;
 }
 
 static int
@@ -607,6 +670,15 @@ gbm_dri_get_format_modifier_plane_count(struct gbm_device *gbm,
    if (gbm_format_to_dri_format(format) == 0)
       return -1;
 
+   const struct gbm_dri_format_modifiers *mods =
+      gbm_dri_get_format_modifiers(dri, format);
+   if (mods && mods->modifiers) {
+      for (int i = 0; i < mods->count; i++) {
+         if (mods->modifiers[i] == modifier && mods->plane_counts[i])
+            return mods->plane_counts[i];
+      }
+   }
+
    if (!dri->image->queryDmaBufFormatModifierAttribs(
          dri->screen, format, modifier,
          __DRI_IMAGE_FORMAT_MODIFIER_ATTRIB_PLANE_COUNT, &plane_count))
@@ -1301,6 +1373,13 @@ dri_destroy(struct gbm_device *gbm)
       dri->core->destroyContext(dri->context);
 
    dri->core->destroyScreen(dri->screen);
+   if (dri->format_modifiers) {
+      for (i = 0; i < dri->num_visuals; i++) {
+         free(dri->format_modifiers[i].modifiers);
+         free(dri->format_modifiers[i].plane_counts);
+      }
+      free(dri->format_modifiers);
+   }
    for (i = 0; dri->driver_configs[i]; i++)
       free((__DRIconfig *) dri->driver_configs[i]);
    free(dri->driver_configs);
@@ -1345,6 +1424,8 @@ dri_device_create(int fd)
 
    dri->visual_table = gbm_dri_visuals_table;
    dri->num_visuals = ARRAY_SIZE(gbm_dri_visuals_table);
+   dri->format_modifiers = calloc(dri->num_visuals,
+                                  sizeof(*dri->format_modifiers));
 
    mtx_init(&dri->mutex, mtx_plain);
 
@@ -1363,6 +1444,7 @@ dri_device_create(int fd)
    return &dri->base;
 
 err_dri:
+   free(dri->format_modifiers);
    free(dri);
 
    return NULL;
@@ -51,6 +51,14 @@ struct gbm_dri_visual {
    } rgba_masks;
 };
 
+/* Results of the driver's format modifier queries for one visual */
+struct gbm_dri_format_modifiers {
+   bool queried;
+   int count;
+   uint64_t *modifiers;
+   uint64_t *plane_counts; /* 0 when the driver can't tell */
+};
+
 struct gbm_dri_device {
    struct gbm_device base;
 
@@ -111,6 +119,9 @@ struct gbm_dri_device {
 
    const struct gbm_dri_visual *visual_table;
    int num_visuals;
+
+   /* Indexed like visual_table, protected by mutex */
+   struct gbm_dri_format_modifiers *format_modifiers;
 };
 
 struct gbm_dri_bo {
@@ -119,6 +119,12 @@ struct blorp_surf
    uint32_t tile_x_sa, tile_y_sa;
 };
 
+/** A rectangle in pixels, x1 and y1 are exclusive. */
+struct blorp_rect {
+   uint32_t x0, y0;
+   uint32_t x1, y1;
+};
+
 enum blorp_filter {
    BLORP_FILTER_NONE,
    BLORP_FILTER_NEAREST,
@@ -217,7 +223,7 @@ blorp_clear_attachments(struct blorp_batch *batch,
                         enum isl_format depth_format,
                         uint32_t num_samples,
                         uint32_t start_layer, uint32_t num_layers,
-                        uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                        uint32_t num_rects, const struct blorp_rect *rects,
                         bool clear_color, union isl_color_value color_value,
                         bool clear_depth, float depth_value,
                         uint8_t stencil_mask, uint8_t stencil_value);
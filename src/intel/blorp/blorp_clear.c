@@ -799,7 +799,7 @@ blorp_clear_attachments(struct blorp_batch *batch,
                         enum isl_format depth_format,
                         uint32_t num_samples,
                         uint32_t start_layer, uint32_t num_layers,
-                        uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                        uint32_t num_rects, const struct blorp_rect *rects,
                         bool clear_color, union isl_color_value color_value,
                         bool clear_depth, float depth_value,
                         uint8_t stencil_mask, uint8_t stencil_value)
@@ -808,11 +808,24 @@ blorp_clear_attachments(struct blorp_batch *batch,
    blorp_params_init(&params);
 
    assert(batch->flags & BLORP_BATCH_NO_EMIT_DEPTH_STENCIL);
+   assert(num_rects > 0);
 
-   params.x0 = x0;
-   params.y0 = y0;
-   params.x1 = x1;
-   params.y1 = y1;
+   /* All the rectangles share the pipeline state and are drawn by a single
+    * RECTLIST primitive.
+    */
+   params.num_rects = num_rects;
+   params.rects = rects;
+
+   params.x0 = rects[0].x0;
+   params.y0 = rects[0].y0;
+   params.x1 = rects[0].x1;
+   params.y1 = rects[0].y1;
+   for (uint32_t i = 1; i < num_rects; i++) {
+      params.x0 = MIN2(params.x0, rects[i].x0);
+      params.y0 = MIN2(params.y0, rects[i].y0);
+      params.x1 = MAX2(params.x1, rects[i].x1);
+      params.y1 = MAX2(params.y1, rects[i].y1);
+   }
 
    params.use_pre_baked_binding_table = true;
    params.pre_baked_binding_table_offset = binding_table_offset;
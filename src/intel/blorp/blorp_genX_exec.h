@@ -222,16 +222,25 @@ blorp_emit_vertex_data(struct blorp_batch *batch,
                        struct blorp_address *addr,
                        uint32_t *size)
 {
-   const float vertices[] = {
-      /* v0 */ (float)params->x1, (float)params->y1, params->z,
-      /* v1 */ (float)params->x0, (float)params->y1, params->z,
-      /* v2 */ (float)params->x0, (float)params->y0, params->z,
+   const struct blorp_rect rect = {
+      .x0 = params->x0, .y0 = params->y0,
+      .x1 = params->x1, .y1 = params->y1,
    };
+   const struct blorp_rect *rects = params->rects ? params->rects : &rect;
+   assert(params->num_rects == 1 || params->rects);
 
-   void *data = blorp_alloc_vertex_buffer(batch, sizeof(vertices), addr);
-   memcpy(data, vertices, sizeof(vertices));
-   *size = sizeof(vertices);
-   blorp_flush_range(batch, data, *size);
+   *size = params->num_rects * 9 * sizeof(float);
+   float *vertices = blorp_alloc_vertex_buffer(batch, *size, addr);
+
+   for (uint32_t i = 0; i < params->num_rects; i++) {
+      float *v = vertices + i * 9;
+
+      /* v0 */ v[0] = rects[i].x1; v[1] = rects[i].y1; v[2] = params->z;
+      /* v1 */ v[3] = rects[i].x0; v[4] = rects[i].y1; v[5] = params->z;
+      /* v2 */ v[6] = rects[i].x0; v[7] = rects[i].y0; v[8] = params->z;
+   }
+
+   blorp_flush_range(batch, vertices, *size);
 }
 
 static void
@@ -1791,6 +1800,7 @@ blorp_exec(struct blorp_batch *batch, const struct blorp_params *params)
 
 #if GEN_GEN >= 8
    if (params->hiz_op != ISL_AUX_OP_NONE) {
+      assert(params->num_rects == 1);
       blorp_emit_gen8_hiz_op(batch, params);
       return;
    }
@@ -1812,7 +1822,7 @@ blorp_exec(struct blorp_batch *batch, const struct blorp_params *params)
 #if GEN_GEN >= 7
       prim.PredicateEnable = batch->flags & BLORP_BATCH_PREDICATE_ENABLE;
 #endif
-      prim.VertexCountPerInstance = 3;
+      prim.VertexCountPerInstance = 3 * params->num_rects;
       prim.InstanceCount = params->num_layers;
    }
 }
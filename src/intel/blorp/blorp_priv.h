@@ -185,6 +185,14 @@ struct blorp_params
    uint32_t y0;
    uint32_t x1;
    uint32_t y1;
+
+   /**
+    * If set, the rectangles to draw with the same state, in one primitive.
+    * x0, y0, x1 and y1 are then their bounds.
+    */
+   uint32_t num_rects;
+   const struct blorp_rect *rects;
+
    float z;
    uint8_t stencil_mask;
    uint8_t stencil_ref;
@@ -67,6 +67,11 @@
 static const struct nir_shader_compiler_options scalar_nir_options = {
    COMMON_OPTIONS,
    COMMON_SCALAR_OPTIONS,
+
+   /* Give the scheduler two iterations to interleave in loops we can't
+    * unroll completely.
+    */
+   .partial_unroll_factor = 2,
 };
 
 static const struct nir_shader_compiler_options vector_nir_options = {
@@ -192,6 +197,7 @@ brw_compiler_create(void *mem_ctx, const struct gen_device_info *devinfo)
       compiler->glsl_compiler_options[i].NirOptions = nir_options;
 
       compiler->glsl_compiler_options[i].ClampBlockIndicesToArrayBounds = true;
+      compiler->glsl_compiler_options[i].SkipCompileTimeOptimizations = true;
    }
 
    compiler->glsl_compiler_options[MESA_SHADER_TESS_CTRL].EmitNoIndirectInput = false;
@@ -7256,20 +7256,35 @@ fs_visitor::allocate_registers(unsigned min_dispatch_width, bool allow_spilling)
    /* Try each scheduling heuristic to see if it can successfully register
     * allocate without spilling.  They should be ordered by decreasing
     * performance but increasing likelihood of allocating.
+    *
+    * The dependency DAGs are built once, and each heuristic schedules the
+    * instructions from them.
     */
+   void *scheduler_ctx = ralloc_context(NULL);
+   fs_instruction_scheduler *sched = prepare_scheduler(scheduler_ctx);
+
    for (unsigned i = 0; i < ARRAY_SIZE(pre_modes); i++) {
-      schedule_instructions(pre_modes[i]);
+      schedule_instructions_pre_ra(sched, pre_modes[i]);
 
       if (0) {
          assign_regs_trivial();
          allocated_without_spills = true;
       } else {
-         allocated_without_spills = assign_regs(false, spill_all);
+         allocated_without_spills = assign_regs(false, spill_all, 0);
       }
       if (allocated_without_spills)
          break;
+
+      /* Spilling everything changed the instructions of the DAGs. */
+      if (unlikely(spill_all)) {
+         ralloc_free(scheduler_ctx);
+         scheduler_ctx = ralloc_context(NULL);
+         sched = prepare_scheduler(scheduler_ctx);
+      }
    }
 
+   ralloc_free(scheduler_ctx);
+
    if (!allocated_without_spills) {
       if (!allow_spilling)
          fail("Failure to register allocate and spilling is not allowed.");
@@ -7290,9 +7305,12 @@ fs_visitor::allocate_registers(unsigned min_dispatch_width, bool allow_spilling)
       }
 
       /* Since we're out of heuristics, just go spill registers until we
-       * get an allocation.
+       * get an allocation.  Spill one more register with every round, so
+       * that shaders needing lots of spills don't rebuild the liveness and
+       * the interference graph for each of them.
        */
-      while (!assign_regs(true, spill_all)) {
+      for (unsigned max_spills = 1;
+           !assign_regs(true, spill_all, max_spills); max_spills++) {
          if (failed)
             break;
       }
@@ -7990,7 +8008,13 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
       prog_data->reg_blocks_8 = brw_register_blocks(v8.grf_used);
    }
 
-   if (v8.max_dispatch_width >= 16 &&
+   /* The wider compiles aren't allowed to spill, and need at least twice
+    * as many registers as the narrower one: don't waste time on them once
+    * a narrower one has spilled or failed to allocate.
+    */
+   bool try_wider = !v8.spilled_any_registers;
+
+   if (v8.max_dispatch_width >= 16 && (try_wider || use_rep_send) &&
        likely(!(INTEL_DEBUG & DEBUG_NO16) || use_rep_send)) {
       /* Try a SIMD16 compile */
       fs_visitor v16(compiler, log_data, mem_ctx, key,
@@ -8001,6 +8025,7 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
          compiler->shader_perf_log(log_data,
                                    "SIMD16 shader failed to compile: %s",
                                    v16.fail_msg);
+         try_wider = false;
       } else {
          simd16_cfg = v16.cfg;
          prog_data->dispatch_grf_start_reg_16 = v16.payload.num_regs;
@@ -8009,7 +8034,7 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
    }
 
    /* Currently, the compiler only supports SIMD32 on SNB+ */
-   if (v8.max_dispatch_width >= 32 && !use_rep_send &&
+   if (v8.max_dispatch_width >= 32 && !use_rep_send && try_wider &&
        compiler->devinfo->gen >= 6 &&
        unlikely(INTEL_DEBUG & DEBUG_DO32)) {
       /* Try a SIMD32 compile */
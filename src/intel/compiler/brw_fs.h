@@ -43,6 +43,7 @@ namespace brw {
 }
 
 struct brw_gs_compile;
+class fs_instruction_scheduler;
 
 static inline fs_reg
 offset(const fs_reg &reg, const brw::fs_builder &bld, unsigned delta)
@@ -113,13 +114,14 @@ public:
    void assign_tcs_single_patch_urb_setup();
    void assign_tes_urb_setup();
    void assign_gs_urb_setup();
-   bool assign_regs(bool allow_spilling, bool spill_all);
+   bool assign_regs(bool allow_spilling, bool spill_all,
+                    unsigned max_spills);
    void assign_regs_trivial();
    void calculate_payload_ranges(int payload_node_count,
                                  int *payload_last_use_ip);
    void setup_payload_interference(struct ra_graph *g, int payload_reg_count,
                                    int first_payload_node);
-   int choose_spill_reg(struct ra_graph *g);
+   void set_spill_costs(struct ra_graph *g);
    void spill_reg(unsigned spill_reg);
    void split_virtual_grfs();
    bool compact_virtual_grfs();
@@ -154,6 +156,9 @@ public:
    bool opt_sampler_eot();
    bool virtual_grf_interferes(int a, int b);
    void schedule_instructions(instruction_scheduler_mode mode);
+   fs_instruction_scheduler *prepare_scheduler(void *mem_ctx);
+   void schedule_instructions_pre_ra(fs_instruction_scheduler *sched,
+                                     instruction_scheduler_mode mode);
    void insert_gen4_send_dependency_workarounds();
    void insert_gen4_pre_send_dependency_workarounds(bblock_t *block,
                                                     fs_inst *inst);
@@ -528,7 +528,8 @@ setup_mrf_hack_interference(fs_visitor *v, struct ra_graph *g,
 }
 
 bool
-fs_visitor::assign_regs(bool allow_spilling, bool spill_all)
+fs_visitor::assign_regs(bool allow_spilling, bool spill_all,
+                        unsigned max_spills)
 {
    /* Most of this allocation was written for a reg_width of 1
     * (dispatch_width == 8).  In extending to SIMD16, the code was
@@ -723,7 +724,8 @@ fs_visitor::assign_regs(bool allow_spilling, bool spill_all)
 
    /* Debug of register spilling: Go spill everything. */
    if (unlikely(spill_all)) {
-      int reg = choose_spill_reg(g);
+      set_spill_costs(g);
+      int reg = ra_get_best_spill_node(g);
 
       if (reg != -1) {
          spill_reg(reg);
@@ -733,16 +735,23 @@ fs_visitor::assign_regs(bool allow_spilling, bool spill_all)
    }
 
    if (!ra_allocate(g)) {
-      /* Failed to allocate registers.  Spill a reg, and the caller will
-       * loop back into here to try again.
+      /* Failed to allocate registers.  Spill up to max_spills regs at once,
+       * which don't interfere with each other, and the caller will loop
+       * back into here to try again.
        */
-      int reg = choose_spill_reg(g);
+      unsigned spill_regs[MAX2(max_spills, 1)];
+      unsigned spill_count;
 
-      if (reg == -1) {
+      set_spill_costs(g);
+      spill_count = ra_get_best_spill_nodes(g, spill_regs,
+                                            MAX2(max_spills, 1));
+
+      if (!spill_count) {
          fail("no register to spill:\n");
          dump_instructions(NULL);
       } else if (allow_spilling) {
-         spill_reg(reg);
+         for (unsigned i = 0; i < spill_count && !failed; i++)
+            spill_reg(spill_regs[i]);
       }
 
       ralloc_free(g);
@@ -871,8 +880,8 @@ emit_spill(const fs_builder &bld, fs_reg src,
    }
 }
 
-int
-fs_visitor::choose_spill_reg(struct ra_graph *g)
+void
+fs_visitor::set_spill_costs(struct ra_graph *g)
 {
    float block_scale = 1.0;
    float spill_costs[this->alloc.count];
@@ -947,8 +956,6 @@ fs_visitor::choose_spill_reg(struct ra_graph *g)
       if (!no_spill[i])
 	 ra_set_node_spill_cost(g, i, adjusted_cost);
    }
-
-   return ra_get_best_spill_node(g);
 }
 
 void
@@ -837,6 +837,25 @@ brw_nir_link_shaders(const struct brw_compiler *compiler,
    }
 }
 
+static bool
+brw_nir_should_vectorize_mem(unsigned align, unsigned bit_size,
+                             unsigned num_components, unsigned high_offset,
+                             nir_intrinsic_instr *low,
+                             nir_intrinsic_instr *high)
+{
+   /* Our untyped and byte scattered messages only do up to a vec4 of 32-bit
+    * components and need dword alignment for anything wider than a single
+    * component, so only vectorize what they can take in one message.
+    */
+   if (bit_size != 32 || num_components > 4)
+      return false;
+
+   if (align < bit_size / 8)
+      return false;
+
+   return true;
+}
+
 /* Prepare the given shader for codegen
  *
  * This function is intended to be called right before going into the actual
@@ -854,6 +873,10 @@ brw_postprocess_nir(nir_shader *nir, const struct brw_compiler *compiler,
 
    UNUSED bool progress; /* Written by OPT */
 
+   OPT(nir_opt_load_store_vectorize,
+       nir_var_mem_ubo | nir_var_mem_ssbo |
+       nir_var_mem_shared | nir_var_mem_global,
+       brw_nir_should_vectorize_mem);
    OPT(brw_nir_lower_mem_access_bit_sizes);
    OPT(nir_lower_int64, nir->options->lower_int64_options);
 
@@ -81,6 +81,13 @@ public:
     */
    unsigned cand_generation;
 
+   /**
+    * parent_count and unblocked_time once the DAG is built, to schedule the
+    * block again from the same DAG.
+    */
+   int initial_parent_count;
+   int initial_unblocked_time;
+
    /**
     * This is the sum of the instruction's latency plus the maximum delay of
     * its children, or just the issue_time if it's a leaf node.
@@ -526,6 +533,8 @@ schedule_node::set_latency_gen7(bool is_haswell)
 
 class instruction_scheduler {
 public:
+   DECLARE_RALLOC_CXX_OPERATORS(instruction_scheduler)
+
    instruction_scheduler(backend_shader *s, int grf_count,
                          unsigned hw_reg_count, int block_count,
                          instruction_scheduler_mode mode)
@@ -538,6 +547,8 @@ public:
       this->instructions_to_schedule = 0;
       this->post_reg_alloc = (mode == SCHEDULE_POST);
       this->mode = mode;
+      this->nodes = NULL;
+      this->dags_built = false;
       if (!post_reg_alloc) {
          this->reg_pressure_in = rzalloc_array(mem_ctx, int, block_count);
 
@@ -582,6 +593,8 @@ public:
 
    void run(cfg_t *cfg);
    void add_insts_from_block(bblock_t *block);
+   void save_dag(bblock_t *block);
+   void restore_dag(bblock_t *block);
    void compute_delays();
    void compute_exits();
    virtual void calculate_deps() = 0;
@@ -616,6 +629,14 @@ public:
 
    instruction_scheduler_mode mode;
 
+   /*
+    * If not NULL, the nodes of all the instructions by IP, so that the
+    * instructions can be scheduled again from the same DAGs, e.g. with
+    * another mode, which start from the order the DAGs were built from.
+    */
+   schedule_node **nodes;
+   bool dags_built;
+
    /*
     * The register pressure at the beginning of each basic block.
     */
@@ -894,6 +915,8 @@ schedule_node::schedule_node(backend_instruction *inst,
    this->parent_count = 0;
    this->unblocked_time = 0;
    this->cand_generation = 0;
+   this->initial_parent_count = 0;
+   this->initial_unblocked_time = 0;
    this->delay = 0;
    this->exit = NULL;
 
@@ -920,6 +943,33 @@ instruction_scheduler::add_insts_from_block(bblock_t *block)
    this->instructions_to_schedule = block->end_ip - block->start_ip + 1;
 }
 
+void
+instruction_scheduler::save_dag(bblock_t *block)
+{
+   int ip = block->start_ip;
+
+   foreach_in_list(schedule_node, n, &instructions) {
+      n->initial_parent_count = n->parent_count;
+      n->initial_unblocked_time = n->unblocked_time;
+      nodes[ip++] = n;
+   }
+}
+
+void
+instruction_scheduler::restore_dag(bblock_t *block)
+{
+   for (int ip = block->start_ip; ip <= block->end_ip; ip++) {
+      schedule_node *n = nodes[ip];
+
+      n->parent_count = n->initial_parent_count;
+      n->unblocked_time = n->initial_unblocked_time;
+      n->cand_generation = 0;
+      instructions.push_tail(n);
+   }
+
+   this->instructions_to_schedule = block->end_ip - block->start_ip + 1;
+}
+
 /** Computation of the delay member of each node. */
 void
 instruction_scheduler::compute_delays()
@@ -1529,24 +1579,25 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
        * shaders which naturally do a better job of hiding instruction
        * latency.
        */
+      int chosen_register_pressure_benefit = 0;
+
       foreach_in_list(schedule_node, n, &instructions) {
          fs_inst *inst = (fs_inst *)n->inst;
+         int register_pressure_benefit = get_register_pressure_benefit(n->inst);
 
          if (!chosen) {
             chosen = n;
+            chosen_register_pressure_benefit = register_pressure_benefit;
             continue;
          }
 
          /* Most important: If we can definitely reduce register pressure, do
           * so immediately.
           */
-         int register_pressure_benefit = get_register_pressure_benefit(n->inst);
-         int chosen_register_pressure_benefit =
-            get_register_pressure_benefit(chosen->inst);
-
          if (register_pressure_benefit > 0 &&
              register_pressure_benefit > chosen_register_pressure_benefit) {
             chosen = n;
+            chosen_register_pressure_benefit = register_pressure_benefit;
             continue;
          } else if (chosen_register_pressure_benefit > 0 &&
                     (register_pressure_benefit <
@@ -1564,6 +1615,7 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
              */
             if (n->cand_generation > chosen->cand_generation) {
                chosen = n;
+               chosen_register_pressure_benefit = register_pressure_benefit;
                continue;
             } else if (n->cand_generation < chosen->cand_generation) {
                continue;
@@ -1586,6 +1638,7 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
                if (inst->size_written <= 4 * inst->exec_size &&
                    chosen_inst->size_written > 4 * chosen_inst->exec_size) {
                   chosen = n;
+                  chosen_register_pressure_benefit = register_pressure_benefit;
                   continue;
                } else if (inst->size_written > chosen_inst->size_written) {
                   continue;
@@ -1601,6 +1654,7 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
           */
          if (n->delay > chosen->delay) {
             chosen = n;
+            chosen_register_pressure_benefit = register_pressure_benefit;
             continue;
          } else if (n->delay < chosen->delay) {
             continue;
@@ -1610,6 +1664,7 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
           */
          if (exit_unblocked_time(n) < exit_unblocked_time(chosen)) {
             chosen = n;
+            chosen_register_pressure_benefit = register_pressure_benefit;
             continue;
          } else if (exit_unblocked_time(n) > exit_unblocked_time(chosen)) {
             continue;
@@ -1782,7 +1837,7 @@ instruction_scheduler::run(cfg_t *cfg)
          bs->dump_instructions();
    }
 
-   if (!post_reg_alloc)
+   if (!post_reg_alloc && !dags_built)
       setup_liveness(cfg);
 
    foreach_block(block, cfg) {
@@ -1797,16 +1852,26 @@ instruction_scheduler::run(cfg_t *cfg)
             count_reads_remaining(inst);
       }
 
-      add_insts_from_block(block);
+      if (dags_built) {
+         restore_dag(block);
+      } else {
+         add_insts_from_block(block);
+
+         calculate_deps();
 
-      calculate_deps();
+         compute_delays();
+         compute_exits();
 
-      compute_delays();
-      compute_exits();
+         if (nodes)
+            save_dag(block);
+      }
 
       schedule_instructions(block);
    }
 
+   if (nodes)
+      dags_built = true;
+
    if (debug && !post_reg_alloc) {
       fprintf(stderr, "\nInstructions after scheduling (reg_alloc %d)\n",
               post_reg_alloc);
@@ -1835,6 +1900,39 @@ fs_visitor::schedule_instructions(instruction_scheduler_mode mode)
    invalidate_live_intervals();
 }
 
+/**
+ * Create a pre-RA scheduler keeping the dependency DAGs of the instructions
+ * across schedule_instructions_pre_ra() calls.  The instructions must not be
+ * changed in between.
+ */
+fs_instruction_scheduler *
+fs_visitor::prepare_scheduler(void *mem_ctx)
+{
+   fs_instruction_scheduler *sched =
+      new(mem_ctx) fs_instruction_scheduler(this, alloc.count,
+                                            first_non_payload_grf,
+                                            cfg->num_blocks, SCHEDULE_PRE);
+
+   sched->nodes = ralloc_array(sched->mem_ctx, schedule_node *,
+                               cfg->blocks[cfg->num_blocks - 1]->end_ip + 1);
+   return sched;
+}
+
+void
+fs_visitor::schedule_instructions_pre_ra(fs_instruction_scheduler *sched,
+                                         instruction_scheduler_mode mode)
+{
+   assert(mode != SCHEDULE_POST);
+
+   if (!sched->dags_built)
+      calculate_live_intervals();
+
+   sched->mode = mode;
+   sched->run(cfg);
+
+   invalidate_live_intervals();
+}
+
 void
 vec4_visitor::opt_schedule_instructions()
 {
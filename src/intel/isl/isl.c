@@ -24,8 +24,12 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "genxml/genX_bits.h"
+#include "util/macros.h"
+#include "util/simple_mtx.h"
 
 #include "isl.h"
 #include "isl_gen4.h"
@@ -94,6 +98,24 @@ __isl_finishme(const char *file, int line, const char *fmt, ...)
    fprintf(stderr, "%s:%d: FINISHME: %s\n", file, line, buf);
 }
 
+/**
+ * Number of entries of the surface layout cache.  The cache is direct mapped,
+ * it only needs to be large enough for the handful of surface shapes an
+ * application keeps recreating, e.g. its per-frame transient targets.
+ */
+#define ISL_SURF_CACHE_SIZE 64
+
+struct isl_surf_cache_entry {
+   bool valid;
+   struct isl_surf_init_info info;
+   struct isl_surf surf;
+};
+
+struct isl_surf_cache {
+   simple_mtx_t mutex;
+   struct isl_surf_cache_entry entries[ISL_SURF_CACHE_SIZE];
+};
+
 void
 isl_device_init(struct isl_device *dev,
                 const struct gen_device_info *info,
@@ -171,6 +193,20 @@ isl_device_init(struct isl_device *dev,
       dev->ds.stencil_offset = 0;
       dev->ds.hiz_offset = 0;
    }
+
+   dev->surf_cache = calloc(1, sizeof(*dev->surf_cache));
+   if (dev->surf_cache)
+      simple_mtx_init(&dev->surf_cache->mutex, mtx_plain);
+}
+
+void
+isl_device_finish(struct isl_device *dev)
+{
+   if (dev->surf_cache) {
+      simple_mtx_destroy(&dev->surf_cache->mutex);
+      free(dev->surf_cache);
+      dev->surf_cache = NULL;
+   }
 }
 
 /**
@@ -1440,10 +1476,10 @@ isl_calc_row_pitch(const struct isl_device *dev,
    return true;
 }
 
-bool
-isl_surf_init_s(const struct isl_device *dev,
-                struct isl_surf *surf,
-                const struct isl_surf_init_info *restrict info)
+static bool
+isl_surf_init_uncached(const struct isl_device *dev,
+                       struct isl_surf *surf,
+                       const struct isl_surf_init_info *restrict info)
 {
    const struct isl_format_layout *fmtl = isl_format_get_layout(info->format);
 
@@ -1592,6 +1628,75 @@ isl_surf_init_s(const struct isl_device *dev,
    return true;
 }
 
+/**
+ * Hash a cache key a dword at a time.  A byte-wise hash of the whole key
+ * costs about as much as computing the layout itself.
+ */
+static uint32_t
+isl_surf_cache_hash(const struct isl_surf_init_info *key)
+{
+   STATIC_ASSERT(sizeof(*key) % sizeof(uint32_t) == 0);
+   const uint32_t *dw = (const uint32_t *) key;
+   uint32_t hash = 0;
+
+   for (unsigned i = 0; i < sizeof(*key) / sizeof(uint32_t); i++)
+      hash = (hash ^ dw[i]) * 0x9e3779b1;
+
+   return hash ^ (hash >> 16);
+}
+
+bool
+isl_surf_init_s(const struct isl_device *dev,
+                struct isl_surf *surf,
+                const struct isl_surf_init_info *restrict info)
+{
+   struct isl_surf_cache *cache = dev->surf_cache;
+
+   if (!cache)
+      return isl_surf_init_uncached(dev, surf, info);
+
+   /* Copy the fields one by one so that the padding of the key is zero and
+    * it can be hashed and compared as a whole.
+    */
+   struct isl_surf_init_info key;
+   memset(&key, 0, sizeof(key));
+   key.dim = info->dim;
+   key.format = info->format;
+   key.width = info->width;
+   key.height = info->height;
+   key.depth = info->depth;
+   key.levels = info->levels;
+   key.array_len = info->array_len;
+   key.samples = info->samples;
+   key.min_alignment_B = info->min_alignment_B;
+   key.row_pitch_B = info->row_pitch_B;
+   key.usage = info->usage;
+   key.tiling_flags = info->tiling_flags;
+
+   struct isl_surf_cache_entry *entry =
+      &cache->entries[isl_surf_cache_hash(&key) % ISL_SURF_CACHE_SIZE];
+
+   simple_mtx_lock(&cache->mutex);
+   if (entry->valid && memcmp(&entry->info, &key, sizeof(key)) == 0) {
+      *surf = entry->surf;
+      simple_mtx_unlock(&cache->mutex);
+      return true;
+   }
+   simple_mtx_unlock(&cache->mutex);
+
+   /* Failures aren't cached, they are rare and usually fatal anyway. */
+   if (!isl_surf_init_uncached(dev, surf, info))
+      return false;
+
+   simple_mtx_lock(&cache->mutex);
+   entry->valid = true;
+   entry->info = key;
+   entry->surf = *surf;
+   simple_mtx_unlock(&cache->mutex);
+
+   return true;
+}
+
 void
 isl_surf_get_tile_info(const struct isl_surf *surf,
                        struct isl_tile_info *tile_info)
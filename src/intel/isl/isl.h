@@ -956,11 +956,19 @@ typedef enum {
   ISL_MEMCPY_INVALID,
 } isl_memcpy_type;
 
+struct isl_surf_cache;
+
 struct isl_device {
    const struct gen_device_info *info;
    bool use_separate_stencil;
    bool has_bit6_swizzling;
 
+   /**
+    * Layouts recently computed by isl_surf_init_s(), shared by all copies of
+    * the device.  May be NULL, in which case every layout is computed.
+    */
+   struct isl_surf_cache *surf_cache;
+
    /**
     * Describes the layout of a RENDER_SURFACE_STATE structure for the
     * current gen.
@@ -1431,6 +1439,9 @@ isl_device_init(struct isl_device *dev,
                 const struct gen_device_info *info,
                 bool has_bit6_swizzling);
 
+void
+isl_device_finish(struct isl_device *dev);
+
 isl_sample_count_mask_t ATTRIBUTE_CONST
 isl_device_get_sample_counts(struct isl_device *dev);
 
@@ -57,6 +57,9 @@ static const uint32_t xtile_span = 64;
 static const uint32_t ytile_width = 128;
 static const uint32_t ytile_height = 32;
 static const uint32_t ytile_span = 16;
+static const uint32_t wtile_width = 64;
+static const uint32_t wtile_height = 64;
+static const uint32_t wtile_span = 8;
 
 static inline uint32_t
 ror(uint32_t n, uint32_t d)
@@ -813,6 +816,161 @@ ytiled_to_linear_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
                     dst, src, dst_pitch, swizzle_bit, mem_copy, mem_copy);
 }
 
+/**
+ * W tiles are made of 8x8 byte blocks, stored in 512-byte columns like the
+ * 16-byte wide columns of a Y tile.  There is no linear span in a block: the
+ * bits of the X and Y coordinates are interleaved in the offset of a byte,
+ * so W tiles are copied one block at a time, and the "span" is a block row.
+ */
+static inline uint32_t
+wtile_block_offset(uint32_t bx, uint32_t by)
+{
+   return 512 * (bx / 8) + 64 * (by / 8);
+}
+
+static inline uint32_t
+wtile_byte_offset(uint32_t x, uint32_t y)
+{
+   return ((y & 4) << 3) | ((x & 4) << 2) | ((y & 2) << 2) |
+          ((x & 2) << 1) | ((y & 1) << 1) | (x & 1);
+}
+
+/**
+ * Copy texture data from linear to W tile layout.
+ *
+ * \copydoc tile_copy_fn
+ *
+ * Blocks which are entirely covered are interleaved on the stack and
+ * written out with one copy, the others a byte at a time.
+ */
+static inline void
+linear_to_wtiled(uint32_t x0, uint32_t x3,
+                 uint32_t y0, uint32_t y1,
+                 char *dst, const char *src,
+                 int32_t src_pitch,
+                 uint32_t swizzle_bit)
+{
+   for (uint32_t by = ALIGN_DOWN(y0, 8); by < y1; by += 8) {
+      for (uint32_t bx = ALIGN_DOWN(x0, 8); bx < x3; bx += 8) {
+         /* Bit 9 of the destination offset controls swizzling, and bits 6
+          * and 9 only come from the offset of the block.
+          */
+         uint32_t block = wtile_block_offset(bx, by);
+         char *dst_block = dst + (block ^ ((block >> 3) & swizzle_bit));
+         const char *src_block = src + (ptrdiff_t)by * src_pitch + bx;
+
+         if (bx >= x0 && bx + 8 <= x3 && by >= y0 && by + 8 <= y1) {
+            char tmp[64];
+
+            for (uint32_t y = 0; y < 8; y++) {
+               for (uint32_t x = 0; x < 8; x++) {
+                  tmp[wtile_byte_offset(x, y)] =
+                     src_block[(ptrdiff_t)y * src_pitch + x];
+               }
+            }
+            memcpy(dst_block, tmp, sizeof(tmp));
+         } else {
+            const uint32_t ys = MAX2(y0, by) - by, ye = MIN2(y1, by + 8) - by;
+            const uint32_t xs = MAX2(x0, bx) - bx, xe = MIN2(x3, bx + 8) - bx;
+
+            for (uint32_t y = ys; y < ye; y++) {
+               for (uint32_t x = xs; x < xe; x++) {
+                  dst_block[wtile_byte_offset(x, y)] =
+                     src_block[(ptrdiff_t)y * src_pitch + x];
+               }
+            }
+         }
+      }
+   }
+}
+
+/**
+ * Copy texture data from W tile layout to linear.
+ *
+ * \copydoc tile_copy_fn
+ *
+ * Every block touched is read as a whole with mem_copy_align16, so that
+ * streaming loads can be used, and then deinterleaved from the stack.
+ */
+static inline void
+wtiled_to_linear(uint32_t x0, uint32_t x3,
+                 uint32_t y0, uint32_t y1,
+                 char *dst, const char *src,
+                 int32_t dst_pitch,
+                 uint32_t swizzle_bit,
+                 isl_mem_copy_fn mem_copy_align16)
+{
+   for (uint32_t by = ALIGN_DOWN(y0, 8); by < y1; by += 8) {
+      for (uint32_t bx = ALIGN_DOWN(x0, 8); bx < x3; bx += 8) {
+         uint32_t block = wtile_block_offset(bx, by);
+         const char *src_block = src + (block ^ ((block >> 3) & swizzle_bit));
+         char *dst_block = dst + (ptrdiff_t)by * dst_pitch + bx;
+
+         const uint32_t ys = MAX2(y0, by) - by, ye = MIN2(y1, by + 8) - by;
+         const uint32_t xs = MAX2(x0, bx) - bx, xe = MIN2(x3, bx + 8) - bx;
+
+         char tmp[64];
+         mem_copy_align16(tmp, src_block, sizeof(tmp));
+
+         for (uint32_t y = ys; y < ye; y++) {
+            for (uint32_t x = xs; x < xe; x++) {
+               dst_block[(ptrdiff_t)y * dst_pitch + x] =
+                  tmp[wtile_byte_offset(x, y)];
+            }
+         }
+      }
+   }
+}
+
+/**
+ * Copy texture data from linear to W tile layout, faster.
+ *
+ * W tiles are only used for stencil, so there are no BGRA copies.
+ *
+ * \copydoc tile_copy_fn
+ */
+static FLATTEN void
+linear_to_wtiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                        uint32_t y0, uint32_t y1,
+                        char *dst, const char *src,
+                        int32_t src_pitch,
+                        uint32_t swizzle_bit,
+                        isl_memcpy_type copy_type)
+{
+   assert(copy_type == ISL_MEMCPY);
+
+   if (x0 == 0 && x3 == wtile_width && y0 == 0 && y1 == wtile_height) {
+      return linear_to_wtiled(0, wtile_width, 0, wtile_height,
+                              dst, src, src_pitch, swizzle_bit);
+   }
+
+   linear_to_wtiled(x0, x3, y0, y1, dst, src, src_pitch, swizzle_bit);
+}
+
+/**
+ * Copy texture data from W tile layout to linear, faster.
+ *
+ * \copydoc tile_copy_fn
+ */
+static FLATTEN void
+wtiled_to_linear_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                        uint32_t y0, uint32_t y1,
+                        char *dst, const char *src,
+                        int32_t dst_pitch,
+                        uint32_t swizzle_bit,
+                        isl_memcpy_type copy_type)
+{
+#if defined(INLINE_SSE41)
+   if (copy_type == ISL_MEMCPY_STREAMING_LOAD) {
+      return wtiled_to_linear(x0, x3, y0, y1, dst, src, dst_pitch,
+                              swizzle_bit, _memcpy_streaming_load);
+   }
+#endif
+
+   assert(copy_type == ISL_MEMCPY);
+   wtiled_to_linear(x0, x3, y0, y1, dst, src, dst_pitch, swizzle_bit, memcpy);
+}
+
 /**
  * Copy from linear to tiled texture.
  *
@@ -850,6 +1008,15 @@ intel_linear_to_tiled(uint32_t xt1, uint32_t xt2,
       th = ytile_height;
       span = ytile_span;
       tile_copy = linear_to_ytiled_faster;
+   } else if (tiling == ISL_TILING_W) {
+      tw = wtile_width;
+      th = wtile_height;
+      span = wtile_span;
+      tile_copy = linear_to_wtiled_faster;
+      /* The pitch of W tiled surfaces is in units of the 128x32 physical
+       * tile, which is twice the number of bytes in a row of 64x64 tiles.
+       */
+      dst_pitch /= 2;
    } else {
       unreachable("unsupported tiling");
    }
@@ -941,6 +1108,15 @@ intel_tiled_to_linear(uint32_t xt1, uint32_t xt2,
       th = ytile_height;
       span = ytile_span;
       tile_copy = ytiled_to_linear_faster;
+   } else if (tiling == ISL_TILING_W) {
+      tw = wtile_width;
+      th = wtile_height;
+      span = wtile_span;
+      tile_copy = wtiled_to_linear_faster;
+      /* The pitch of W tiled surfaces is in units of the 128x32 physical
+       * tile, which is twice the number of bytes in a row of 64x64 tiles.
+       */
+      src_pitch /= 2;
    } else {
       unreachable("unsupported tiling");
    }
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dev/gen_device_info.h"
+#include "isl/isl.h"
+#include "util/os_time.h"
+
+#define SKL_GT2_DEVID 0x1912
+
+#define NUM_ITERATIONS 100000
+
+// An asssert that works regardless of NDEBUG.
+#define t_assert(cond) \
+   do { \
+      if (!(cond)) { \
+         fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); \
+         abort(); \
+      } \
+   } while (0)
+
+static const struct isl_surf_init_info infos[] = {
+   {
+      .dim = ISL_SURF_DIM_2D,
+      .format = ISL_FORMAT_R8G8B8A8_UNORM,
+      .width = 1920,
+      .height = 1080,
+      .depth = 1,
+      .levels = 1,
+      .array_len = 1,
+      .samples = 1,
+      .usage = ISL_SURF_USAGE_RENDER_TARGET_BIT | ISL_SURF_USAGE_TEXTURE_BIT,
+      .tiling_flags = ISL_TILING_ANY_MASK,
+   },
+   {
+      .dim = ISL_SURF_DIM_2D,
+      .format = ISL_FORMAT_R32_FLOAT,
+      .width = 1920,
+      .height = 1080,
+      .depth = 1,
+      .levels = 1,
+      .array_len = 1,
+      .samples = 4,
+      .usage = ISL_SURF_USAGE_DEPTH_BIT,
+      .tiling_flags = ISL_TILING_Y0_BIT,
+   },
+   {
+      .dim = ISL_SURF_DIM_2D,
+      .format = ISL_FORMAT_R16G16B16A16_FLOAT,
+      .width = 512,
+      .height = 512,
+      .depth = 1,
+      .levels = 10,
+      .array_len = 6,
+      .samples = 1,
+      .usage = ISL_SURF_USAGE_TEXTURE_BIT | ISL_SURF_USAGE_CUBE_BIT,
+      .tiling_flags = ISL_TILING_ANY_MASK,
+   },
+   {
+      .dim = ISL_SURF_DIM_3D,
+      .format = ISL_FORMAT_R8_UNORM,
+      .width = 64,
+      .height = 64,
+      .depth = 64,
+      .levels = 7,
+      .array_len = 1,
+      .samples = 1,
+      .usage = ISL_SURF_USAGE_TEXTURE_BIT,
+      .tiling_flags = ISL_TILING_ANY_MASK,
+   },
+};
+
+static void
+t_assert_surf_equal(const struct isl_surf *a, const struct isl_surf *b)
+{
+   t_assert(memcmp(a, b, sizeof(*a)) == 0);
+}
+
+/* Cached layouts must be identical to the ones computed from scratch. */
+static void
+test_cached_surf_matches(const struct isl_device *dev,
+                         const struct isl_device *uncached_dev)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(infos); i++) {
+      struct isl_surf ref, miss, hit;
+
+      memset(&ref, 0, sizeof(ref));
+      memset(&miss, 0, sizeof(miss));
+      memset(&hit, 0, sizeof(hit));
+
+      t_assert(isl_surf_init_s(uncached_dev, &ref, &infos[i]));
+      t_assert(isl_surf_init_s(dev, &miss, &infos[i]));
+      t_assert(isl_surf_init_s(dev, &hit, &infos[i]));
+
+      t_assert_surf_equal(&ref, &miss);
+      t_assert_surf_equal(&ref, &hit);
+   }
+}
+
+/* A key differing in any field must not hit another surface's entry. */
+static void
+test_cached_surf_distinct(const struct isl_device *dev)
+{
+   struct isl_surf_init_info info = infos[0];
+   struct isl_surf a, b;
+
+   t_assert(isl_surf_init_s(dev, &a, &info));
+
+   info.width /= 2;
+   t_assert(isl_surf_init_s(dev, &b, &info));
+   t_assert(b.logical_level0_px.width == info.width);
+   t_assert(b.size_B < a.size_B);
+
+   info = infos[0];
+   info.tiling_flags = ISL_TILING_LINEAR_BIT;
+   t_assert(isl_surf_init_s(dev, &b, &info));
+   t_assert(b.tiling == ISL_TILING_LINEAR);
+   t_assert(a.tiling != ISL_TILING_LINEAR);
+}
+
+/* Failures aren't cached and must keep failing. */
+static void
+test_cached_surf_failure(const struct isl_device *dev)
+{
+   struct isl_surf_init_info info = infos[0];
+   struct isl_surf surf;
+
+   /* The row pitch is too small to hold a row of the surface. */
+   info.row_pitch_B = 1;
+   t_assert(!isl_surf_init_s(dev, &surf, &info));
+   t_assert(!isl_surf_init_s(dev, &surf, &info));
+}
+
+static int64_t
+time_surf_init(const struct isl_device *dev)
+{
+   struct isl_surf surf;
+   int64_t start = os_time_get_nano();
+
+   for (unsigned i = 0; i < NUM_ITERATIONS; i++)
+      isl_surf_init_s(dev, &surf, &infos[i % ARRAY_SIZE(infos)]);
+
+   return os_time_get_nano() - start;
+}
+
+int main(void)
+{
+   struct gen_device_info devinfo;
+   t_assert(gen_get_device_info(SKL_GT2_DEVID, &devinfo));
+
+   struct isl_device dev;
+   isl_device_init(&dev, &devinfo, /*bit6_swizzle*/ false);
+   t_assert(dev.surf_cache);
+
+   struct isl_device uncached_dev;
+   isl_device_init(&uncached_dev, &devinfo, /*bit6_swizzle*/ false);
+   isl_device_finish(&uncached_dev);
+   t_assert(!uncached_dev.surf_cache);
+
+   test_cached_surf_matches(&dev, &uncached_dev);
+   test_cached_surf_distinct(&dev);
+   test_cached_surf_failure(&dev);
+
+   int64_t uncached_ns = time_surf_init(&uncached_dev);
+   int64_t cached_ns = time_surf_init(&dev);
+   printf("isl_surf_init: %.1f ns uncached, %.1f ns cached\n",
+          (double) uncached_ns / NUM_ITERATIONS,
+          (double) cached_ns / NUM_ITERATIONS);
+
+   isl_device_finish(&dev);
+
+   return 0;
+}
@@ -165,6 +165,8 @@ test_bdw_2d_r8g8b8a8_unorm_512x512_array01_samples01_noaux_tiley0(void)
    t_assert_offset_el(&surf, 7, 0, 0, 256, 760); // +0, +8
    t_assert_offset_el(&surf, 8, 0, 0, 256, 764); // +0, +4
    t_assert_offset_el(&surf, 9, 0, 0, 256, 768); // +0, +4
+
+   isl_device_finish(&dev);
 }
 
 static void
@@ -226,6 +228,8 @@ test_bdw_2d_r8g8b8a8_unorm_1024x1024_array06_samples01_noaux_tiley0(void)
    t_assert(isl_surf_get_array_pitch_el_rows(&surf) == 1540);
 
    /* skip the remaining array layers */
+
+   isl_device_finish(&dev);
 }
 
 static void
@@ -270,6 +274,8 @@ test_bdw_3d_r8g8b8a8_unorm_256x256x256_levels09_tiley0(void)
    t_assert_gen4_3d_layer(&surf, 6,   4,   4,   4,  64,   1, &base_y);
    t_assert_gen4_3d_layer(&surf, 7,   4,   4,   2, 128,   1, &base_y);
    t_assert_gen4_3d_layer(&surf, 8,   4,   4,   1, 256,   1, &base_y);
+
+   isl_device_finish(&dev);
 }
 
 int main(void)
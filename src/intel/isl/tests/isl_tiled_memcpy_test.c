@@ -0,0 +1,137 @@
+/*
+ * Copyright 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isl/isl.h"
+
+/* A W tiled surface 5 tiles wide and 4 tiles high. */
+#define WIDTH 320
+#define HEIGHT 256
+#define ROW_PITCH (5 * 128)
+#define TILED_SIZE (ROW_PITCH * 32 * 4)
+
+#define NUM_ITERATIONS 1000
+
+// An asssert that works regardless of NDEBUG.
+#define t_assert(cond) \
+   do { \
+      if (!(cond)) { \
+         fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); \
+         abort(); \
+      } \
+   } while (0)
+
+/**
+ * Reference address of the byte (x, y) of a W tiled surface.
+ *
+ * See the Sandy Bridge PRM, Volume 1, Part 2, Section 4.5.2.1 W-Major Tile
+ * Format.
+ */
+static uint32_t
+w_offset(uint32_t pitch, uint32_t x, uint32_t y, bool swizzled)
+{
+   uint32_t byte_x = x % 64;
+   uint32_t byte_y = y % 64;
+
+   uint32_t u = (y / 64) * 64 * pitch / 2
+              + (x / 64) * 4096
+              + 512 * (byte_x / 8)
+              +  64 * (byte_y / 8)
+              +  32 * ((byte_y / 4) % 2)
+              +  16 * ((byte_x / 4) % 2)
+              +   8 * ((byte_y / 2) % 2)
+              +   4 * ((byte_x / 2) % 2)
+              +   2 * (byte_y % 2)
+              +   1 * (byte_x % 2);
+
+   /* Bit 6 is flipped when bit 9 is set. */
+   if (swizzled && (u & (1 << 9)))
+      u ^= 1 << 6;
+
+   return u;
+}
+
+static void
+test_w_tiling(char *ref, char *tiled, char *linear, char *readback,
+              bool swizzled, isl_memcpy_type read_type)
+{
+   uint32_t x1 = rand() % WIDTH;
+   uint32_t x2 = x1 + 1 + rand() % (WIDTH - x1);
+   uint32_t y1 = rand() % HEIGHT;
+   uint32_t y2 = y1 + 1 + rand() % (HEIGHT - y1);
+   uint32_t pitch = x2 - x1 + rand() % 32;
+
+   for (uint32_t i = 0; i < TILED_SIZE; i++)
+      ref[i] = tiled[i] = rand();
+   for (uint32_t i = 0; i < pitch * (y2 - y1); i++)
+      linear[i] = rand();
+
+   for (uint32_t y = y1; y < y2; y++) {
+      for (uint32_t x = x1; x < x2; x++) {
+         ref[w_offset(ROW_PITCH, x, y, swizzled)] =
+            linear[(y - y1) * pitch + (x - x1)];
+      }
+   }
+
+   isl_memcpy_linear_to_tiled(x1, x2, y1, y2, tiled, linear, ROW_PITCH, pitch,
+                              swizzled, ISL_TILING_W, ISL_MEMCPY);
+   t_assert(memcmp(ref, tiled, TILED_SIZE) == 0);
+
+   memset(readback, 0, pitch * (y2 - y1));
+   isl_memcpy_tiled_to_linear(x1, x2, y1, y2, readback, tiled, pitch,
+                              ROW_PITCH, swizzled, ISL_TILING_W, read_type);
+   for (uint32_t y = 0; y < y2 - y1; y++) {
+      t_assert(memcmp(readback + y * pitch, linear + y * pitch,
+                      x2 - x1) == 0);
+   }
+}
+
+int main(void)
+{
+   char *ref = aligned_alloc(4096, TILED_SIZE);
+   char *tiled = aligned_alloc(4096, TILED_SIZE);
+   char *linear = malloc((WIDTH + 32) * HEIGHT);
+   char *readback = malloc((WIDTH + 32) * HEIGHT);
+   t_assert(ref && tiled && linear && readback);
+
+   for (unsigned i = 0; i < NUM_ITERATIONS; i++) {
+      test_w_tiling(ref, tiled, linear, readback, false, ISL_MEMCPY);
+      test_w_tiling(ref, tiled, linear, readback, true, ISL_MEMCPY);
+#ifdef USE_SSE41
+      test_w_tiling(ref, tiled, linear, readback, false,
+                    ISL_MEMCPY_STREAMING_LOAD);
+#endif
+   }
+
+   free(ref);
+   free(tiled);
+   free(linear);
+   free(readback);
+
+   return 0;
+}
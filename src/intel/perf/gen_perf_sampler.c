@@ -0,0 +1,333 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <drm-uapi/i915_drm.h>
+
+#include "gen_perf.h"
+#include "gen_perf_sampler.h"
+
+#include "dev/gen_debug.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/u_atomic.h"
+#include "util/u_metric_ring.h"
+#include "util/u_thread.h"
+
+#define FILE_DEBUG_FLAG DEBUG_PERFMON
+
+/* How long the thread sleeps at most before checking whether it should
+ * stop.
+ */
+#define SAMPLER_POLL_TIMEOUT_MS 100
+
+/* Size in dwords of the largest OA report format we use. */
+#define SAMPLER_MAX_REPORT_DWORDS 64
+
+/* The metrics we sample, from the "Render Metrics Basic" set which exists
+ * on all the platforms.
+ */
+static const struct {
+   const char *counter_name;
+   const char *column_name;
+} sampler_metrics[] = {
+   { "GPU Busy",             "gpu_busy" },
+   { "EU Active",            "eu_active" },
+   { "GTI Read Throughput",  "gti_read_bw" },
+   { "GTI Write Throughput", "gti_write_bw" },
+};
+
+struct gen_perf_sampler {
+   struct gen_perf *perf;
+   const struct gen_perf_query_info *query;
+   const struct gen_perf_query_counter *counters[ARRAY_SIZE(sampler_metrics)];
+   unsigned num_counters;
+
+   int stream_fd;
+   uint64_t interval_ns;
+   struct u_metric_ring *ring;
+
+   /* Counters accumulated since the last sample written to the ring. */
+   struct gen_perf_query_result result;
+   uint32_t prev_report[SAMPLER_MAX_REPORT_DWORDS];
+   bool have_prev_report;
+
+   thrd_t thread;
+   bool quit;
+};
+
+static const struct gen_perf_query_info *
+find_basic_render_query(const struct gen_perf *perf)
+{
+   for (int i = 0; i < perf->n_queries; i++) {
+      const struct gen_perf_query_info *query = &perf->queries[i];
+
+      if (query->kind == GEN_PERF_QUERY_TYPE_OA &&
+          strncmp(query->name, "Render Metrics Basic", 20) == 0)
+         return query;
+   }
+
+   return NULL;
+}
+
+static const struct gen_perf_query_counter *
+find_counter(const struct gen_perf_query_info *query, const char *name)
+{
+   for (int i = 0; i < query->n_counters; i++) {
+      if (strcmp(query->counters[i].name, name) == 0)
+         return &query->counters[i];
+   }
+
+   return NULL;
+}
+
+/**
+ * Pick the smallest OA period exponent giving a few reports per interval,
+ * accumulating more often than that would only cost CPU time.
+ */
+static int
+choose_period_exponent(const struct gen_perf *perf, uint64_t interval_ns)
+{
+   const uint64_t freq = perf->sys_vars.timestamp_frequency;
+   int exponent;
+
+   for (exponent = 0; exponent < 31; exponent++) {
+      uint64_t period_ns = (2ull << exponent) * 1000000000ull / freq;
+      if (period_ns >= interval_ns / 8)
+         break;
+   }
+
+   return exponent;
+}
+
+static int
+open_system_wide_oa_stream(struct gen_perf_sampler *sampler, int drm_fd,
+                           int period_exponent)
+{
+   uint64_t properties[] = {
+      /* Include OA reports in samples */
+      DRM_I915_PERF_PROP_SAMPLE_OA, true,
+
+      /* OA unit configuration */
+      DRM_I915_PERF_PROP_OA_METRICS_SET, sampler->query->oa_metrics_set_id,
+      DRM_I915_PERF_PROP_OA_FORMAT, sampler->query->oa_format,
+      DRM_I915_PERF_PROP_OA_EXPONENT, period_exponent,
+   };
+   struct drm_i915_perf_open_param param = {
+      .flags = I915_PERF_FLAG_FD_CLOEXEC |
+               I915_PERF_FLAG_FD_NONBLOCK,
+      .num_properties = ARRAY_SIZE(properties) / 2,
+      .properties_ptr = (uintptr_t) properties,
+   };
+
+   return sampler->perf->ioctl(drm_fd, DRM_IOCTL_I915_PERF_OPEN, &param);
+}
+
+static void
+write_sample(struct gen_perf_sampler *sampler, uint64_t time_ns)
+{
+   double values[ARRAY_SIZE(sampler_metrics)];
+
+   for (unsigned i = 0; i < sampler->num_counters; i++) {
+      const struct gen_perf_query_counter *counter = sampler->counters[i];
+
+      switch (counter->data_type) {
+      case GEN_PERF_COUNTER_DATA_TYPE_UINT64:
+         values[i] = counter->oa_counter_read_uint64(sampler->perf,
+                                                     sampler->query,
+                                                     sampler->result.accumulator);
+         break;
+      case GEN_PERF_COUNTER_DATA_TYPE_FLOAT:
+         values[i] = counter->oa_counter_read_float(sampler->perf,
+                                                    sampler->query,
+                                                    sampler->result.accumulator);
+         break;
+      default:
+         unreachable("unexpected counter data type");
+      }
+   }
+
+   u_metric_ring_push(sampler->ring, time_ns, values);
+}
+
+/**
+ * Accumulate the deltas between all the consecutive reports available on
+ * the stream.
+ */
+static void
+read_reports(struct gen_perf_sampler *sampler, uint8_t *buf, size_t size)
+{
+   while (1) {
+      int len;
+
+      while ((len = read(sampler->stream_fd, buf, size)) < 0 &&
+             errno == EINTR)
+         ;
+
+      if (len <= 0) {
+         if (len < 0 && errno != EAGAIN)
+            DBG("Error reading i915 perf samples: %m\n");
+         return;
+      }
+
+      int offset = 0;
+      while (offset < len) {
+         const struct drm_i915_perf_record_header *header =
+            (const struct drm_i915_perf_record_header *) &buf[offset];
+         const uint32_t *report = (const uint32_t *) (header + 1);
+
+         switch (header->type) {
+         case DRM_I915_PERF_RECORD_SAMPLE: {
+            size_t report_size = header->size - sizeof(*header);
+            assert(report_size <= sizeof(sampler->prev_report));
+
+            if (sampler->have_prev_report) {
+               gen_perf_query_result_accumulate(&sampler->result,
+                                                sampler->query,
+                                                sampler->prev_report, report);
+            }
+            memcpy(sampler->prev_report, report, report_size);
+            sampler->have_prev_report = true;
+            break;
+         }
+
+         case DRM_I915_PERF_RECORD_OA_BUFFER_LOST:
+         case DRM_I915_PERF_RECORD_OA_REPORT_LOST:
+            /* Don't accumulate over the gap. */
+            DBG("i915 perf: OA reports lost\n");
+            sampler->have_prev_report = false;
+            break;
+
+         default:
+            break;
+         }
+
+         offset += header->size;
+      }
+   }
+}
+
+static int
+sampler_thread(void *data)
+{
+   struct gen_perf_sampler *sampler = data;
+   uint8_t buf[4096];
+   uint64_t last_time = os_time_get_nano();
+
+   u_thread_setname("gen_perf_sampler");
+
+   gen_perf_query_result_clear(&sampler->result);
+
+   while (!p_atomic_read(&sampler->quit)) {
+      struct pollfd pollfd = {
+         .fd = sampler->stream_fd,
+         .events = POLLIN,
+      };
+      poll(&pollfd, 1, SAMPLER_POLL_TIMEOUT_MS);
+
+      read_reports(sampler, buf, sizeof(buf));
+
+      uint64_t now = os_time_get_nano();
+      if (now - last_time >= sampler->interval_ns) {
+         if (sampler->result.reports_accumulated)
+            write_sample(sampler, now);
+         gen_perf_query_result_clear(&sampler->result);
+         last_time = now;
+      }
+   }
+
+   return 0;
+}
+
+/**
+ * Start sampling.  \p perf must have the OA metrics loaded, and outlive the
+ * sampler.  Returns NULL if the metrics or the OA unit aren't available.
+ */
+struct gen_perf_sampler *
+gen_perf_sampler_create(struct gen_perf *perf, int drm_fd,
+                        const char *ring_path,
+                        uint64_t interval_ns)
+{
+   const struct gen_perf_query_info *query = find_basic_render_query(perf);
+   if (!query) {
+      DBG("i915 perf: no basic render metric set to sample\n");
+      return NULL;
+   }
+
+   struct gen_perf_sampler *sampler = calloc(1, sizeof(*sampler));
+   if (!sampler)
+      return NULL;
+
+   const char *names[ARRAY_SIZE(sampler_metrics)];
+
+   sampler->perf = perf;
+   sampler->query = query;
+   sampler->interval_ns = interval_ns;
+   for (unsigned i = 0; i < ARRAY_SIZE(sampler_metrics); i++) {
+      const struct gen_perf_query_counter *counter =
+         find_counter(query, sampler_metrics[i].counter_name);
+      if (!counter)
+         continue;
+
+      names[sampler->num_counters] = sampler_metrics[i].column_name;
+      sampler->counters[sampler->num_counters++] = counter;
+   }
+
+   sampler->stream_fd =
+      open_system_wide_oa_stream(sampler, drm_fd,
+                                 choose_period_exponent(perf, interval_ns));
+   if (sampler->stream_fd == -1) {
+      DBG("Error opening i915 perf OA stream: %m\n");
+      free(sampler);
+      return NULL;
+   }
+
+   sampler->ring = u_metric_ring_create(ring_path, sampler->num_counters,
+                                        names);
+   if (!sampler->ring) {
+      fprintf(stderr, "gen_perf: can't create the metric ring %s\n",
+              ring_path);
+      close(sampler->stream_fd);
+      free(sampler);
+      return NULL;
+   }
+
+   sampler->thread = u_thread_create(sampler_thread, sampler);
+
+   return sampler;
+}
+
+void
+gen_perf_sampler_destroy(struct gen_perf_sampler *sampler)
+{
+   p_atomic_set(&sampler->quit, true);
+   thrd_join(sampler->thread, NULL);
+
+   u_metric_ring_destroy(sampler->ring);
+   close(sampler->stream_fd);
+   free(sampler);
+}
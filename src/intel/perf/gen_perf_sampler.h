@@ -0,0 +1,50 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GEN_PERF_SAMPLER_H
+#define GEN_PERF_SAMPLER_H
+
+#include <stdint.h>
+
+struct gen_perf;
+struct gen_perf_sampler;
+
+/*
+ * Periodic sampling of a few global OA metrics (GPU busy, EU active and
+ * GTI bandwidth) from a system wide i915 perf stream.
+ *
+ * A thread accumulates the OA reports and writes the metrics to a
+ * u_metric_ring at \p ring_path about every \p interval_ns, so that the
+ * gallium HUD or any other process can read them.
+ *
+ * The OA unit can only be used by one stream at a time, so while sampling,
+ * the OA queries of GL_INTEL_performance_query are unavailable.
+ */
+struct gen_perf_sampler *
+gen_perf_sampler_create(struct gen_perf *perf, int drm_fd,
+                        const char *ring_path,
+                        uint64_t interval_ns);
+
+void gen_perf_sampler_destroy(struct gen_perf_sampler *sampler);
+
+#endif /* GEN_PERF_SAMPLER_H */
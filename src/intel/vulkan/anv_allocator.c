@@ -325,16 +325,15 @@ anv_state_table_add(struct anv_state_table *table, uint32_t *idx,
    }
 }
 
-void
-anv_free_list_push(union anv_free_list *list,
-                   struct anv_state_table *table,
-                   uint32_t first, uint32_t count)
+/* Pushes the entries first..last, already linked together through their
+ * next fields, in a single compare-and-swap.
+ */
+static void
+anv_free_list_push_chain(union anv_free_list *list,
+                         struct anv_state_table *table,
+                         uint32_t first, uint32_t last)
 {
    union anv_free_list current, old, new;
-   uint32_t last = first;
-
-   for (uint32_t i = 1; i < count; i++, last++)
-      table->map[last].next = last + 1;
 
    old = *list;
    do {
@@ -346,6 +345,19 @@ anv_free_list_push(union anv_free_list *list,
    } while (old.u64 != current.u64);
 }
 
+void
+anv_free_list_push(union anv_free_list *list,
+                   struct anv_state_table *table,
+                   uint32_t first, uint32_t count)
+{
+   uint32_t last = first;
+
+   for (uint32_t i = 1; i < count; i++, last++)
+      table->map[last].next = last + 1;
+
+   anv_free_list_push_chain(list, table, first, last);
+}
+
 struct anv_state *
 anv_free_list_pop(union anv_free_list *list,
                   struct anv_state_table *table)
@@ -1251,6 +1263,133 @@ anv_state_pool_free(struct anv_state_pool *pool, struct anv_state state)
    anv_state_pool_free_no_vg(pool, state);
 }
 
+/* The state cache is a single threaded front for a state pool, for the
+ * states of one size that an externally synchronized object, like a command
+ * pool, allocates and frees all the time.  It takes ANV_STATE_CACHE_REFILL
+ * states from the pool at once, split from a single pool allocation, and
+ * gives them back in batches pushed to the free list with a single atomic
+ * operation, so that threads recording command buffers from different pools
+ * rarely touch the pool's free lists at the same time.
+ *
+ * Like the blocks of a state stream, the states of a cache are not tracked
+ * by valgrind.
+ */
+void
+anv_state_cache_init(struct anv_state_cache *cache,
+                     struct anv_state_pool *pool,
+                     uint32_t state_size)
+{
+   assert(util_is_power_of_two_or_zero(state_size));
+   assert(state_size * ANV_STATE_CACHE_REFILL <=
+          (1 << ANV_MAX_STATE_SIZE_LOG2));
+
+   cache->pool = pool;
+   cache->state_size = state_size;
+   cache->count = 0;
+}
+
+static void
+anv_state_cache_refill(struct anv_state_cache *cache)
+{
+   struct anv_state_pool *pool = cache->pool;
+   const uint32_t size = cache->state_size;
+   const uint32_t count = ANV_STATE_CACHE_REFILL;
+
+   /* Take back the states that were returned to the pool first, or they
+    * would never get reused by a cache.
+    */
+   uint32_t bucket = anv_state_pool_get_bucket(size);
+   while (cache->count < count) {
+      struct anv_state *state =
+         anv_free_list_pop(&pool->buckets[bucket].free_list, &pool->table);
+      if (!state)
+         break;
+      cache->states[cache->count++] = *state;
+   }
+
+   if (cache->count > 0)
+      return;
+
+   struct anv_state chunk =
+      anv_state_pool_alloc_no_vg(pool, size * count, size);
+
+   /* The chunk's entry in the state table becomes the first state, the
+    * others get entries of their own.
+    */
+   struct anv_state *state = anv_state_table_get(&pool->table, chunk.idx);
+   state->alloc_size = size;
+   cache->states[cache->count++] = *state;
+
+   uint32_t st_idx;
+   UNUSED VkResult result = anv_state_table_add(&pool->table, &st_idx,
+                                                count - 1);
+   assert(result == VK_SUCCESS);
+   for (uint32_t i = 0; i < count - 1; i++) {
+      state = anv_state_table_get(&pool->table, st_idx + i);
+      state->alloc_size = size;
+      state->offset = chunk.offset + size * (i + 1);
+      state->map = anv_block_pool_map(&pool->block_pool, state->offset);
+      cache->states[cache->count++] = *state;
+   }
+}
+
+/* Returns the first count states of the cache to the pool. */
+static void
+anv_state_cache_return(struct anv_state_cache *cache, uint32_t count)
+{
+   struct anv_state_pool *pool = cache->pool;
+
+   if (count == 0)
+      return;
+
+   for (uint32_t i = 0; i + 1 < count; i++)
+      pool->table.map[cache->states[i].idx].next = cache->states[i + 1].idx;
+
+   uint32_t bucket = anv_state_pool_get_bucket(cache->state_size);
+   anv_free_list_push_chain(&pool->buckets[bucket].free_list, &pool->table,
+                            cache->states[0].idx,
+                            cache->states[count - 1].idx);
+
+   cache->count -= count;
+   memmove(cache->states, cache->states + count,
+           cache->count * sizeof(cache->states[0]));
+}
+
+void
+anv_state_cache_flush(struct anv_state_cache *cache)
+{
+   anv_state_cache_return(cache, cache->count);
+}
+
+void
+anv_state_cache_finish(struct anv_state_cache *cache)
+{
+   anv_state_cache_flush(cache);
+}
+
+struct anv_state
+anv_state_cache_alloc(struct anv_state_cache *cache)
+{
+   if (cache->count == 0)
+      anv_state_cache_refill(cache);
+
+   return cache->states[--cache->count];
+}
+
+void
+anv_state_cache_free(struct anv_state_cache *cache, struct anv_state state)
+{
+   assert(state.alloc_size == cache->state_size && state.offset >= 0);
+
+   /* Keep the most recently freed states, they are the likeliest to still
+    * be in the CPU caches.
+    */
+   if (cache->count == ANV_STATE_CACHE_SIZE)
+      anv_state_cache_return(cache, ANV_STATE_CACHE_SIZE / 2);
+
+   cache->states[cache->count++] = state;
+}
+
 struct anv_state_stream_block {
    struct anv_state block;
 
@@ -1274,6 +1413,7 @@ anv_state_stream_init(struct anv_state_stream *stream,
                       uint32_t block_size)
 {
    stream->state_pool = state_pool;
+   stream->cache = NULL;
    stream->block_size = block_size;
 
    stream->block = ANV_STATE_NULL;
@@ -1288,6 +1428,18 @@ anv_state_stream_init(struct anv_state_stream *stream,
    VG(VALGRIND_CREATE_MEMPOOL(stream, 0, false));
 }
 
+/* Same as anv_state_stream_init(), with the stream's blocks coming from
+ * the given cache.  The cache must outlive the stream, and must not be used
+ * concurrently with it.
+ */
+void
+anv_state_stream_init_cached(struct anv_state_stream *stream,
+                             struct anv_state_cache *cache)
+{
+   anv_state_stream_init(stream, cache->pool, cache->state_size);
+   stream->cache = cache;
+}
+
 void
 anv_state_stream_finish(struct anv_state_stream *stream)
 {
@@ -1296,7 +1448,10 @@ anv_state_stream_finish(struct anv_state_stream *stream)
       struct anv_state_stream_block sb = VG_NOACCESS_READ(next);
       VG(VALGRIND_MEMPOOL_FREE(stream, sb._vg_ptr));
       VG(VALGRIND_MAKE_MEM_UNDEFINED(next, stream->block_size));
-      anv_state_pool_free_no_vg(stream->state_pool, sb.block);
+      if (stream->cache && sb.block.alloc_size == stream->cache->state_size)
+         anv_state_cache_free(stream->cache, sb.block);
+      else
+         anv_state_pool_free_no_vg(stream->state_pool, sb.block);
       next = sb.next;
    }
 
@@ -1318,8 +1473,12 @@ anv_state_stream_alloc(struct anv_state_stream *stream,
       if (block_size < size)
          block_size = round_to_power_of_two(size);
 
-      stream->block = anv_state_pool_alloc_no_vg(stream->state_pool,
-                                                 block_size, PAGE_SIZE);
+      if (stream->cache && block_size == stream->cache->state_size) {
+         stream->block = anv_state_cache_alloc(stream->cache);
+      } else {
+         stream->block = anv_state_pool_alloc_no_vg(stream->state_pool,
+                                                    block_size, PAGE_SIZE);
+      }
 
       struct anv_state_stream_block *sb = stream->block.map;
       VG_NOACCESS_WRITE(&sb->block, stream->block);
@@ -1664,7 +1823,8 @@ anv_bo_cache_lookup(struct anv_bo_cache *cache, uint32_t gem_handle)
     EXEC_OBJECT_ASYNC | \
     EXEC_OBJECT_SUPPORTS_48B_ADDRESS | \
     EXEC_OBJECT_PINNED | \
-    ANV_BO_EXTERNAL)
+    ANV_BO_EXTERNAL | \
+    ANV_BO_RESIDENT)
 
 VkResult
 anv_bo_cache_alloc(struct anv_device *device,
@@ -1804,6 +1964,7 @@ anv_bo_cache_import(struct anv_device *device,
       new_flags |= (bo->bo.flags & bo_flags) & EXEC_OBJECT_ASYNC;
       new_flags |= (bo->bo.flags & bo_flags) & EXEC_OBJECT_SUPPORTS_48B_ADDRESS;
       new_flags |= (bo->bo.flags | bo_flags) & EXEC_OBJECT_PINNED;
+      new_flags |= (bo->bo.flags | bo_flags) & ANV_BO_RESIDENT;
 
       /* It's theoretically possible for a BO to get imported such that it's
        * both pinned and not pinned.  The only way this can happen is if it
@@ -161,7 +161,8 @@ anv_reloc_list_add(struct anv_reloc_list *list,
    int index;
 
    if (target_bo->flags & EXEC_OBJECT_PINNED) {
-      _mesa_set_add(list->deps, target_bo);
+      if (!(target_bo->flags & ANV_BO_RESIDENT))
+         _mesa_set_add(list->deps, target_bo);
       return VK_SUCCESS;
    }
 
@@ -902,6 +903,33 @@ anv_cmd_buffer_end_batch_buffer(struct anv_cmd_buffer *cmd_buffer)
 
          emit_batch_buffer_start(cmd_buffer, &batch_bo->bo, 0);
          assert(cmd_buffer->batch.start == batch_bo->bo.map);
+      } else if (cmd_buffer->device->instance->physicalDevice.use_softpin) {
+         cmd_buffer->exec_mode = ANV_CMD_BUFFER_EXEC_MODE_CALL_AND_RETURN;
+
+         /* A simultaneous use secondary can't be chained to a single place
+          * in a primary.  Instead of copying it, we end it with an
+          * MI_BATCH_BUFFER_START whose address each primary executing the
+          * secondary writes from the GPU, with the address to return to,
+          * right before jumping into it.  That only works if the addresses
+          * are known when the primary is recorded, so with softpin.
+          *
+          * A secondary with a single batch BO only gets here if it is more
+          * than half a batch BO long, so the return address is always far
+          * out of the command streamer prefetch when the jump happens.
+          */
+         cmd_buffer->batch.end += GEN8_MI_BATCH_BUFFER_START_length * 4;
+         assert(cmd_buffer->batch.start == batch_bo->bo.map);
+         assert(cmd_buffer->batch.end == batch_bo->bo.map + batch_bo->bo.size);
+
+         emit_batch_buffer_start(cmd_buffer, &batch_bo->bo, 0);
+         assert(cmd_buffer->batch.start == batch_bo->bo.map);
+
+         /* The address follows the MI_BATCH_BUFFER_START header dword */
+         cmd_buffer->return_addr = (struct anv_address) {
+            .bo = &batch_bo->bo,
+            .offset = cmd_buffer->batch.next - cmd_buffer->batch.start -
+                      GEN8_MI_BATCH_BUFFER_START_length * 4 + 4,
+         };
       } else {
          cmd_buffer->exec_mode = ANV_CMD_BUFFER_EXEC_MODE_COPY_AND_CHAIN;
       }
@@ -984,6 +1012,46 @@ anv_cmd_buffer_add_secondary(struct anv_cmd_buffer *primary,
                             GEN8_MI_BATCH_BUFFER_START_length * 4);
       break;
    }
+   case ANV_CMD_BUFFER_EXEC_MODE_CALL_AND_RETURN: {
+      struct anv_batch_bo *first_bbo =
+         list_first_entry(&secondary->batch_bos, struct anv_batch_bo, link);
+
+      /* Emit the store of the return address and the jump at once, so that
+       * they land in the same batch BO and we return right after the jump.
+       */
+      const uint32_t sdi_length = GEN8_MI_STORE_DATA_IMM_length + 1;
+      uint32_t *dw = anv_batch_emit_dwords(&primary->batch, sdi_length +
+                                           GEN8_MI_BATCH_BUFFER_START_length);
+      if (dw == NULL)
+         break;
+
+      struct anv_batch_bo *this_bbo = anv_cmd_buffer_current_batch_bo(primary);
+      assert(primary->batch.start == this_bbo->bo.map);
+      const struct anv_address return_addr = {
+         .bo = &this_bbo->bo,
+         .offset = primary->batch.next - primary->batch.start,
+      };
+
+      struct GEN8_MI_STORE_DATA_IMM sdi = {
+         GEN8_MI_STORE_DATA_IMM_header,
+         .DWordLength = sdi_length - GEN8_MI_STORE_DATA_IMM_length_bias,
+         .StoreQword = true,
+         .Address = secondary->return_addr,
+         .ImmediateData = anv_address_physical(return_addr),
+      };
+      GEN8_MI_STORE_DATA_IMM_pack(&primary->batch, dw, &sdi);
+
+      struct GEN8_MI_BATCH_BUFFER_START bbs = {
+         GEN8_MI_BATCH_BUFFER_START_header,
+         .SecondLevelBatchBuffer = Firstlevelbatch,
+         .AddressSpaceIndicator = ASI_PPGTT,
+         .BatchBufferStartAddress = { &first_bbo->bo, 0 },
+      };
+      GEN8_MI_BATCH_BUFFER_START_pack(&primary->batch, dw + sdi_length, &bbs);
+
+      anv_cmd_buffer_add_seen_bbos(primary, &secondary->batch_bos);
+      break;
+   }
    default:
       assert(!"Invalid execution mode");
    }
@@ -1483,10 +1551,6 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
       first_batch_bo->bo.index = last_idx;
    }
 
-   /* If we are pinning our BOs, we shouldn't have to relocate anything */
-   if (cmd_buffer->device->instance->physicalDevice.use_softpin)
-      assert(!execbuf->has_relocs);
-
    /* Now we go through and fixup all of the relocation lists to point to
     * the correct indices in the object array.  We have to do this after we
     * reorder the list above as some of the indices may have changed.
@@ -1520,7 +1584,13 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
       .rsvd2 = 0,
    };
 
-   if (relocate_cmd_buffer(cmd_buffer, execbuf)) {
+   if (cmd_buffer->device->instance->physicalDevice.use_softpin) {
+      /* If we are pinning our BOs, we shouldn't have to relocate anything
+       * and all the offsets we pass are the final ones.
+       */
+      assert(!execbuf->has_relocs);
+      execbuf->execbuf.flags |= I915_EXEC_NO_RELOC;
+   } else if (relocate_cmd_buffer(cmd_buffer, execbuf)) {
       /* If we were able to successfully relocate everything, tell the kernel
        * that it can skip doing relocations. The requirement for using
        * NO_RELOC is:
@@ -1581,6 +1651,9 @@ setup_empty_execbuf(struct anv_execbuf *execbuf, struct anv_device *device)
       .rsvd2 = 0,
    };
 
+   if (device->trivial_batch_bo.flags & EXEC_OBJECT_PINNED)
+      execbuf->execbuf.flags |= I915_EXEC_NO_RELOC;
+
    return VK_SUCCESS;
 }
 
@@ -1005,6 +1005,40 @@ binding_table_for_surface_state(struct anv_cmd_buffer *cmd_buffer,
    return VK_SUCCESS;
 }
 
+#define MAX_CLEAR_RECTS 32
+
+/**
+ * Convert up to MAX_CLEAR_RECTS of the given clear rects to blorp rects so
+ * they can be cleared by a single blorp_clear_attachments() call.  If
+ * match_layers is set, stop at the first rect with a different layer range
+ * from the first one.  Returns the number of rects converted.
+ */
+static uint32_t
+get_blorp_clear_rects(struct blorp_rect *rects,
+                      uint32_t rectCount, const VkClearRect *pRects,
+                      bool match_layers)
+{
+   const uint32_t count = MIN2(rectCount, MAX_CLEAR_RECTS);
+
+   for (uint32_t r = 0; r < count; ++r) {
+      if (match_layers &&
+          (pRects[r].baseArrayLayer != pRects[0].baseArrayLayer ||
+           pRects[r].layerCount != pRects[0].layerCount))
+         return r;
+
+      const VkOffset2D offset = pRects[r].rect.offset;
+      const VkExtent2D extent = pRects[r].rect.extent;
+      rects[r] = (struct blorp_rect) {
+         .x0 = offset.x,
+         .y0 = offset.y,
+         .x1 = offset.x + extent.width,
+         .y1 = offset.y + extent.height,
+      };
+   }
+
+   return count;
+}
+
 static void
 clear_color_attachment(struct anv_cmd_buffer *cmd_buffer,
                        struct blorp_batch *batch,
@@ -1034,35 +1068,35 @@ clear_color_attachment(struct anv_cmd_buffer *cmd_buffer,
    union isl_color_value clear_color =
       vk_to_isl_color(attachment->clearValue.color);
 
+   struct blorp_rect rects[MAX_CLEAR_RECTS];
+   uint32_t num_rects;
+
    /* If multiview is enabled we ignore baseArrayLayer and layerCount */
    if (subpass->view_mask) {
       uint32_t view_idx;
       for_each_bit(view_idx, subpass->view_mask) {
-         for (uint32_t r = 0; r < rectCount; ++r) {
-            const VkOffset2D offset = pRects[r].rect.offset;
-            const VkExtent2D extent = pRects[r].rect.extent;
+         for (uint32_t r = 0; r < rectCount; r += num_rects) {
+            num_rects = get_blorp_clear_rects(rects, rectCount - r,
+                                              pRects + r, false);
             blorp_clear_attachments(batch, binding_table,
                                     ISL_FORMAT_UNSUPPORTED, pass_att->samples,
-                                    view_idx, 1,
-                                    offset.x, offset.y,
-                                    offset.x + extent.width,
-                                    offset.y + extent.height,
+                                    view_idx, 1, num_rects, rects,
                                     true, clear_color, false, 0.0f, 0, 0);
          }
       }
       return;
    }
 
-   for (uint32_t r = 0; r < rectCount; ++r) {
-      const VkOffset2D offset = pRects[r].rect.offset;
-      const VkExtent2D extent = pRects[r].rect.extent;
+   /* Rects sharing a layer range are cleared together. */
+   for (uint32_t r = 0; r < rectCount; r += num_rects) {
       assert(pRects[r].layerCount != VK_REMAINING_ARRAY_LAYERS);
+      num_rects = get_blorp_clear_rects(rects, rectCount - r,
+                                        pRects + r, true);
       blorp_clear_attachments(batch, binding_table,
                               ISL_FORMAT_UNSUPPORTED, pass_att->samples,
                               pRects[r].baseArrayLayer,
                               pRects[r].layerCount,
-                              offset.x, offset.y,
-                              offset.x + extent.width, offset.y + extent.height,
+                              num_rects, rects,
                               true, clear_color, false, 0.0f, 0, 0);
    }
 }
@@ -1102,20 +1136,20 @@ clear_depth_stencil_attachment(struct anv_cmd_buffer *cmd_buffer,
    if (result != VK_SUCCESS)
       return;
 
+   const VkClearDepthStencilValue value = attachment->clearValue.depthStencil;
+   struct blorp_rect rects[MAX_CLEAR_RECTS];
+   uint32_t num_rects;
+
    /* If multiview is enabled we ignore baseArrayLayer and layerCount */
    if (subpass->view_mask) {
       uint32_t view_idx;
       for_each_bit(view_idx, subpass->view_mask) {
-         for (uint32_t r = 0; r < rectCount; ++r) {
-            const VkOffset2D offset = pRects[r].rect.offset;
-            const VkExtent2D extent = pRects[r].rect.extent;
-            VkClearDepthStencilValue value = attachment->clearValue.depthStencil;
+         for (uint32_t r = 0; r < rectCount; r += num_rects) {
+            num_rects = get_blorp_clear_rects(rects, rectCount - r,
+                                              pRects + r, false);
             blorp_clear_attachments(batch, binding_table,
                                     depth_format, pass_att->samples,
-                                    view_idx, 1,
-                                    offset.x, offset.y,
-                                    offset.x + extent.width,
-                                    offset.y + extent.height,
+                                    view_idx, 1, num_rects, rects,
                                     false, color_value,
                                     clear_depth, value.depth,
                                     clear_stencil ? 0xff : 0, value.stencil);
@@ -1124,17 +1158,16 @@ clear_depth_stencil_attachment(struct anv_cmd_buffer *cmd_buffer,
       return;
    }
 
-   for (uint32_t r = 0; r < rectCount; ++r) {
-      const VkOffset2D offset = pRects[r].rect.offset;
-      const VkExtent2D extent = pRects[r].rect.extent;
-      VkClearDepthStencilValue value = attachment->clearValue.depthStencil;
+   /* Rects sharing a layer range are cleared together. */
+   for (uint32_t r = 0; r < rectCount; r += num_rects) {
       assert(pRects[r].layerCount != VK_REMAINING_ARRAY_LAYERS);
+      num_rects = get_blorp_clear_rects(rects, rectCount - r,
+                                        pRects + r, true);
       blorp_clear_attachments(batch, binding_table,
                               depth_format, pass_att->samples,
                               pRects[r].baseArrayLayer,
                               pRects[r].layerCount,
-                              offset.x, offset.y,
-                              offset.x + extent.width, offset.y + extent.height,
+                              num_rects, rects,
                               false, color_value,
                               clear_depth, value.depth,
                               clear_stencil ? 0xff : 0, value.stencil);
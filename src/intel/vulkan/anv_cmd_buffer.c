@@ -225,10 +225,10 @@ static VkResult anv_create_cmd_buffer(
    if (result != VK_SUCCESS)
       goto fail;
 
-   anv_state_stream_init(&cmd_buffer->surface_state_stream,
-                         &device->surface_state_pool, 4096);
-   anv_state_stream_init(&cmd_buffer->dynamic_state_stream,
-                         &device->dynamic_state_pool, 16384);
+   anv_state_stream_init_cached(&cmd_buffer->surface_state_stream,
+                                &pool->surface_state_cache);
+   anv_state_stream_init_cached(&cmd_buffer->dynamic_state_stream,
+                                &pool->dynamic_state_cache);
 
    anv_cmd_state_init(cmd_buffer);
 
@@ -318,12 +318,12 @@ anv_cmd_buffer_reset(struct anv_cmd_buffer *cmd_buffer)
    anv_cmd_state_reset(cmd_buffer);
 
    anv_state_stream_finish(&cmd_buffer->surface_state_stream);
-   anv_state_stream_init(&cmd_buffer->surface_state_stream,
-                         &cmd_buffer->device->surface_state_pool, 4096);
+   anv_state_stream_init_cached(&cmd_buffer->surface_state_stream,
+                                &cmd_buffer->pool->surface_state_cache);
 
    anv_state_stream_finish(&cmd_buffer->dynamic_state_stream);
-   anv_state_stream_init(&cmd_buffer->dynamic_state_stream,
-                         &cmd_buffer->device->dynamic_state_pool, 16384);
+   anv_state_stream_init_cached(&cmd_buffer->dynamic_state_stream,
+                                &cmd_buffer->pool->dynamic_state_cache);
    return VK_SUCCESS;
 }
 
@@ -577,6 +577,14 @@ anv_cmd_buffer_bind_descriptor_set(struct anv_cmd_buffer *cmd_buffer,
       assert(bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS);
       pipe_state = &cmd_buffer->state.gfx.base;
    }
+   /* Rebinding the same set with new dynamic offsets is common.  The set
+    * can't have been updated since it was bound, bindings which may be
+    * updated after bind are always bindless, so only the binding tables
+    * holding dynamic buffers have to be re-emitted.  Push descriptor sets
+    * come without dynamic offsets and are updated in place.
+    */
+   bool set_changed = pipe_state->descriptors[set_index] != set ||
+                      dynamic_offsets == NULL;
    pipe_state->descriptors[set_index] = set;
 
    if (dynamic_offsets) {
@@ -605,14 +613,19 @@ anv_cmd_buffer_bind_descriptor_set(struct anv_cmd_buffer *cmd_buffer,
       }
    }
 
+   VkShaderStageFlags stages;
    if (bind_point == VK_PIPELINE_BIND_POINT_COMPUTE) {
-      cmd_buffer->state.descriptors_dirty |= VK_SHADER_STAGE_COMPUTE_BIT;
+      stages = VK_SHADER_STAGE_COMPUTE_BIT;
    } else {
       assert(bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS);
-      cmd_buffer->state.descriptors_dirty |=
-         set_layout->shader_stages & VK_SHADER_STAGE_ALL_GRAPHICS;
+      stages = set_layout->shader_stages & VK_SHADER_STAGE_ALL_GRAPHICS;
    }
 
+   if (set_changed)
+      cmd_buffer->state.descriptors_dirty |= stages;
+   else if (set_layout->dynamic_offset_count > 0)
+      cmd_buffer->state.dynamic_offsets_dirty |= stages;
+
    /* Pipeline layout objects are required to live at least while any command
     * buffers that use them are in recording state. We need to grab a reference
     * to the pipeline layout being bound here so we can compute correct dynamic
@@ -916,6 +929,15 @@ VkResult anv_CreateCommandPool(
 
    list_inithead(&pool->cmd_buffers);
 
+   /* Command pools are externally synchronized, and so are the command
+    * buffers allocated from them, so the pool can keep the blocks its
+    * command buffers free without locking.
+    */
+   anv_state_cache_init(&pool->surface_state_cache,
+                        &device->surface_state_pool, 4096);
+   anv_state_cache_init(&pool->dynamic_state_cache,
+                        &device->dynamic_state_pool, 16384);
+
    *pCmdPool = anv_cmd_pool_to_handle(pool);
 
    return VK_SUCCESS;
@@ -937,6 +959,9 @@ void anv_DestroyCommandPool(
       anv_cmd_buffer_destroy(cmd_buffer);
    }
 
+   anv_state_cache_finish(&pool->surface_state_cache);
+   anv_state_cache_finish(&pool->dynamic_state_cache);
+
    vk_free2(&device->alloc, pAllocator, pool);
 }
 
@@ -960,7 +985,10 @@ void anv_TrimCommandPool(
     VkCommandPool                               commandPool,
     VkCommandPoolTrimFlags                      flags)
 {
-   /* Nothing for us to do here.  Our pools stay pretty tidy. */
+   ANV_FROM_HANDLE(anv_cmd_pool, pool, commandPool);
+
+   anv_state_cache_flush(&pool->surface_state_cache);
+   anv_state_cache_flush(&pool->dynamic_state_cache);
 }
 
 /**
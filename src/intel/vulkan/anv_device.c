@@ -37,6 +37,7 @@
 #include "util/build_id.h"
 #include "util/disk_cache.h"
 #include "util/mesa-sha1.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_string.h"
 #include "git_sha1.h"
 #include "vk_util.h"
@@ -550,8 +551,10 @@ anv_physical_device_init(struct anv_physical_device *device,
    isl_device_init(&device->isl_dev, &device->info, swizzled);
 
    result = anv_physical_device_init_uuids(device);
-   if (result != VK_SUCCESS)
+   if (result != VK_SUCCESS) {
+      isl_device_finish(&device->isl_dev);
       goto fail;
+   }
 
    anv_physical_device_init_disk_cache(device);
 
@@ -573,6 +576,7 @@ anv_physical_device_init(struct anv_physical_device *device,
    if (result != VK_SUCCESS) {
       ralloc_free(device->compiler);
       anv_physical_device_free_disk_cache(device);
+      isl_device_finish(&device->isl_dev);
       goto fail;
    }
 
@@ -597,6 +601,7 @@ anv_physical_device_finish(struct anv_physical_device *device)
    anv_finish_wsi(device);
    anv_physical_device_free_disk_cache(device);
    ralloc_free(device->compiler);
+   isl_device_finish(&device->isl_dev);
    close(device->local_fd);
    if (device->master_fd >= 0)
       close(device->master_fd);
@@ -2187,7 +2192,10 @@ VkResult anv_CreateDevice(
    if (result != VK_SUCCESS)
       goto fail_batch_bo_pool;
 
-   if (!physical_device->use_softpin)
+   /* When pinned, the state pool BOs are put in every execbuf. */
+   if (physical_device->use_softpin)
+      bo_flags |= ANV_BO_RESIDENT;
+   else
       bo_flags &= ~EXEC_OBJECT_SUPPORTS_48B_ADDRESS;
 
    result = anv_state_pool_init(&device->dynamic_state_pool, device,
@@ -2268,6 +2276,22 @@ VkResult anv_CreateDevice(
 
    anv_pipeline_cache_init(&device->default_pipeline_cache, device, true);
 
+   /* Allocation callbacks may only be called from the thread of the API
+    * command, and pipelines allocate their shaders from the device
+    * allocator, so only compile pipelines on other threads if it is ours.
+    * If initializing the queue fails, they're just compiled on the calling
+    * thread.
+    */
+   memset(&device->pipeline_queue, 0, sizeof(device->pipeline_queue));
+   if (device->alloc.pfnAllocation == default_alloc_func &&
+       env_var_as_boolean("ANV_ENABLE_PIPELINE_THREADS", true)) {
+      util_cpu_detect();
+      if (util_cpu_caps.nr_cpus > 1)
+         util_queue_init(&device->pipeline_queue, "anv_pipeline",
+                         64, MIN2(util_cpu_caps.nr_cpus, 16),
+                         UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+
    anv_device_init_blorp(device);
 
    anv_device_init_border_colors(device);
@@ -2321,6 +2345,9 @@ void anv_DestroyDevice(
 
    anv_device_finish_blorp(device);
 
+   if (util_queue_is_initialized(&device->pipeline_queue))
+      util_queue_destroy(&device->pipeline_queue);
+
    anv_pipeline_cache_finish(&device->default_pipeline_cache);
 
    anv_queue_finish(&device->queue);
@@ -2657,8 +2684,9 @@ VkResult anv_AllocateMemory(
       bo_flags |= EXEC_OBJECT_ASYNC;
    }
 
+   /* When pinned, all the memory objects are put in every execbuf. */
    if (pdevice->use_softpin)
-      bo_flags |= EXEC_OBJECT_PINNED;
+      bo_flags |= EXEC_OBJECT_PINNED | ANV_BO_RESIDENT;
 
    const VkExportMemoryAllocateInfo *export_info =
       vk_find_struct_const(pAllocateInfo->pNext, EXPORT_MEMORY_ALLOCATE_INFO);
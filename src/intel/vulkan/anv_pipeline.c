@@ -931,6 +931,41 @@ anv_pipeline_compile_fs(const struct brw_compiler *compiler,
    return code;
 }
 
+/* Returns the stages of the pipeline with dynamic buffer surface states in
+ * their binding table, which have to be re-emitted when only the dynamic
+ * offsets change.
+ */
+static VkShaderStageFlags
+anv_pipeline_dynamic_buffer_stages(const struct anv_pipeline *pipeline,
+                                   const struct anv_pipeline_layout *layout)
+{
+   if (layout == NULL)
+      return 0;
+
+   VkShaderStageFlags stages = 0;
+   for (unsigned s = 0; s < MESA_SHADER_STAGES; s++) {
+      if (pipeline->shaders[s] == NULL)
+         continue;
+
+      const struct anv_pipeline_bind_map *map = &pipeline->shaders[s]->bind_map;
+      for (uint32_t i = 0; i < map->surface_count; i++) {
+         const struct anv_pipeline_binding *binding =
+            &map->surface_to_descriptor[i];
+         if (binding->set >= MAX_SETS)
+            continue;
+
+         const struct anv_descriptor_set_layout *set_layout =
+            layout->set[binding->set].layout;
+         if (set_layout->binding[binding->binding].dynamic_offset_index >= 0) {
+            stages |= mesa_to_vk_shader_stage(s);
+            break;
+         }
+      }
+   }
+
+   return stages;
+}
+
 static VkResult
 anv_pipeline_compile_graphics(struct anv_pipeline *pipeline,
                               struct anv_pipeline_cache *cache,
@@ -1214,6 +1249,9 @@ done:
       pipeline->active_stages &= ~VK_SHADER_STAGE_FRAGMENT_BIT;
    }
 
+   pipeline->dynamic_buffer_stages =
+      anv_pipeline_dynamic_buffer_stages(pipeline, layout);
+
    pipeline_feedback.duration = os_time_get_nano() - pipeline_start;
 
    const VkPipelineCreationFeedbackCreateInfoEXT *create_feedback =
@@ -1359,6 +1397,8 @@ anv_pipeline_compile_cs(struct anv_pipeline *pipeline,
 
    pipeline->active_stages = VK_SHADER_STAGE_COMPUTE_BIT;
    pipeline->shaders[MESA_SHADER_COMPUTE] = bin;
+   pipeline->dynamic_buffer_stages =
+      anv_pipeline_dynamic_buffer_stages(pipeline, layout);
 
    return VK_SUCCESS;
 }
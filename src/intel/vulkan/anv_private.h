@@ -56,6 +56,7 @@
 #include "util/u_atomic.h"
 #include "util/u_vector.h"
 #include "util/u_math.h"
+#include "util/u_queue.h"
 #include "util/vma.h"
 #include "vk_alloc.h"
 #include "vk_debug_report.h"
@@ -585,7 +586,13 @@ anv_multialloc_alloc2(struct anv_multialloc *ma,
 
 /* Extra ANV-defined BO flags which won't be passed to the kernel */
 #define ANV_BO_EXTERNAL    (1ull << 31)
-#define ANV_BO_FLAG_MASK   (1ull << 31)
+
+/* The BO is pinned and put in the validation list of every execbuf, so there
+ * is no need to track it as a dependency of the batches referencing it.
+ */
+#define ANV_BO_RESIDENT    (1ull << 30)
+
+#define ANV_BO_FLAG_MASK   (ANV_BO_EXTERNAL | ANV_BO_RESIDENT)
 
 struct anv_bo {
    uint32_t gem_handle;
@@ -763,9 +770,28 @@ struct anv_state_pool {
 
 struct anv_state_stream_block;
 
+/* Maximum number of free states held by a state cache */
+#define ANV_STATE_CACHE_SIZE 32
+
+/* Number of states a state cache takes from its pool at once */
+#define ANV_STATE_CACHE_REFILL 8
+
+struct anv_state_cache {
+   struct anv_state_pool *pool;
+
+   /* The size of all the states in the cache */
+   uint32_t state_size;
+
+   uint32_t count;
+   struct anv_state states[ANV_STATE_CACHE_SIZE];
+};
+
 struct anv_state_stream {
    struct anv_state_pool *state_pool;
 
+   /* Cache the blocks come from and go back to, if any */
+   struct anv_state_cache *cache;
+
    /* The size of blocks to allocate from the state pool */
    uint32_t block_size;
 
@@ -804,9 +830,19 @@ struct anv_state anv_state_pool_alloc(struct anv_state_pool *pool,
                                       uint32_t state_size, uint32_t alignment);
 struct anv_state anv_state_pool_alloc_back(struct anv_state_pool *pool);
 void anv_state_pool_free(struct anv_state_pool *pool, struct anv_state state);
+void anv_state_cache_init(struct anv_state_cache *cache,
+                          struct anv_state_pool *pool,
+                          uint32_t state_size);
+void anv_state_cache_finish(struct anv_state_cache *cache);
+void anv_state_cache_flush(struct anv_state_cache *cache);
+struct anv_state anv_state_cache_alloc(struct anv_state_cache *cache);
+void anv_state_cache_free(struct anv_state_cache *cache,
+                          struct anv_state state);
 void anv_state_stream_init(struct anv_state_stream *stream,
                            struct anv_state_pool *state_pool,
                            uint32_t block_size);
+void anv_state_stream_init_cached(struct anv_state_stream *stream,
+                                  struct anv_state_cache *cache);
 void anv_state_stream_finish(struct anv_state_stream *stream);
 struct anv_state anv_state_stream_alloc(struct anv_state_stream *stream,
                                         uint32_t size, uint32_t alignment);
@@ -1131,6 +1167,9 @@ struct anv_device {
     struct anv_pipeline_cache                   default_pipeline_cache;
     struct blorp_context                        blorp;
 
+    /** Compiles the pipelines of vkCreate*Pipelines calls in parallel */
+    struct util_queue                           pipeline_queue;
+
     struct anv_state                            border_colors;
 
     struct anv_queue                            queue;
@@ -2332,6 +2371,8 @@ struct anv_cmd_state {
 
    enum anv_pipe_bits                           pending_pipe_bits;
    VkShaderStageFlags                           descriptors_dirty;
+   /* Stages for which only the dynamic offsets of the bound sets changed */
+   VkShaderStageFlags                           dynamic_offsets_dirty;
    VkShaderStageFlags                           push_constants_dirty;
 
    struct anv_framebuffer *                     framebuffer;
@@ -2386,6 +2427,10 @@ struct anv_cmd_state {
 struct anv_cmd_pool {
    VkAllocationCallbacks                        alloc;
    struct list_head                             cmd_buffers;
+
+   /* Blocks of the state streams of the pool's command buffers */
+   struct anv_state_cache                       surface_state_cache;
+   struct anv_state_cache                       dynamic_state_cache;
 };
 
 #define ANV_CMD_BUFFER_BATCH_SIZE 8192
@@ -2396,6 +2441,7 @@ enum anv_cmd_buffer_exec_mode {
    ANV_CMD_BUFFER_EXEC_MODE_GROW_AND_EMIT,
    ANV_CMD_BUFFER_EXEC_MODE_CHAIN,
    ANV_CMD_BUFFER_EXEC_MODE_COPY_AND_CHAIN,
+   ANV_CMD_BUFFER_EXEC_MODE_CALL_AND_RETURN,
 };
 
 struct anv_cmd_buffer {
@@ -2415,6 +2461,11 @@ struct anv_cmd_buffer {
    struct list_head                             batch_bos;
    enum anv_cmd_buffer_exec_mode                exec_mode;
 
+   /* Address of the MI_BATCH_BUFFER_START address ending a secondary
+    * executed in ANV_CMD_BUFFER_EXEC_MODE_CALL_AND_RETURN mode.
+    */
+   struct anv_address                           return_addr;
+
    /* A vector of anv_batch_bo pointers for every batch or surface buffer
     * referenced by this command buffer
     *
@@ -2751,6 +2802,8 @@ struct anv_pipeline {
    } urb;
 
    VkShaderStageFlags                           active_stages;
+   /* Stages with dynamic buffers in their binding table */
+   VkShaderStageFlags                           dynamic_buffer_stages;
    struct anv_state                             blend_state;
 
    uint32_t                                     vb_used;
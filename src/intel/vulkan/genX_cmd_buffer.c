@@ -2335,8 +2335,14 @@ flush_descriptor_sets(struct anv_cmd_buffer *cmd_buffer)
 {
    struct anv_pipeline *pipeline = cmd_buffer->state.gfx.base.pipeline;
 
-   VkShaderStageFlags dirty = cmd_buffer->state.descriptors_dirty &
-                              pipeline->active_stages;
+   /* Only the stages with dynamic buffers in their binding table are
+    * affected by new dynamic offsets, pushed UBOs and the dynamic offset
+    * push constants are handled by push_constants_dirty.
+    */
+   VkShaderStageFlags dirty =
+      (cmd_buffer->state.descriptors_dirty |
+       (cmd_buffer->state.dynamic_offsets_dirty &
+        pipeline->dynamic_buffer_stages)) & pipeline->active_stages;
 
    VkResult result = VK_SUCCESS;
    anv_foreach_stage(s, dirty) {
@@ -2379,6 +2385,7 @@ flush_descriptor_sets(struct anv_cmd_buffer *cmd_buffer)
    }
 
    cmd_buffer->state.descriptors_dirty &= ~dirty;
+   cmd_buffer->state.dynamic_offsets_dirty &= ~VK_SHADER_STAGE_ALL_GRAPHICS;
 
    return dirty;
 }
@@ -2711,7 +2718,8 @@ genX(cmd_buffer_flush_state)(struct anv_cmd_buffer *cmd_buffer)
     * 3DSTATE_BINDING_TABLE_POINTER_* for the push constants to take effect.
     */
    uint32_t dirty = 0;
-   if (cmd_buffer->state.descriptors_dirty)
+   if (cmd_buffer->state.descriptors_dirty ||
+       cmd_buffer->state.dynamic_offsets_dirty)
       dirty = flush_descriptor_sets(cmd_buffer);
 
    if (dirty || cmd_buffer->state.push_constants_dirty) {
@@ -3479,6 +3487,8 @@ genX(cmd_buffer_flush_compute_state)(struct anv_cmd_buffer *cmd_buffer)
    }
 
    if ((cmd_buffer->state.descriptors_dirty & VK_SHADER_STAGE_COMPUTE_BIT) ||
+       (cmd_buffer->state.dynamic_offsets_dirty &
+        pipeline->dynamic_buffer_stages) ||
        cmd_buffer->state.compute.pipeline_dirty) {
       /* FIXME: figure out descriptors for gen7 */
       result = flush_compute_descriptor_set(cmd_buffer);
@@ -3487,6 +3497,7 @@ genX(cmd_buffer_flush_compute_state)(struct anv_cmd_buffer *cmd_buffer)
 
       cmd_buffer->state.descriptors_dirty &= ~VK_SHADER_STAGE_COMPUTE_BIT;
    }
+   cmd_buffer->state.dynamic_offsets_dirty &= ~VK_SHADER_STAGE_COMPUTE_BIT;
 
    if (cmd_buffer->state.push_constants_dirty & VK_SHADER_STAGE_COMPUTE_BIT) {
       struct anv_state push_state =
@@ -2146,6 +2146,102 @@ compute_pipeline_create(
    return pipeline->batch.status;
 }
 
+struct pipeline_job {
+   VkDevice device;
+   struct anv_pipeline_cache *cache;
+   const VkGraphicsPipelineCreateInfo *graphics_info;
+   const VkComputePipelineCreateInfo *compute_info;
+   VkPipeline pipeline;
+   VkResult result;
+   struct util_queue_fence fence;
+};
+
+static void
+pipeline_job_execute(void *data, int thread_index)
+{
+   struct pipeline_job *job = data;
+
+   job->pipeline = VK_NULL_HANDLE;
+   if (job->graphics_info) {
+      job->result = genX(graphics_pipeline_create)(job->device, job->cache,
+                                                   job->graphics_info, NULL,
+                                                   &job->pipeline);
+   } else {
+      job->result = compute_pipeline_create(job->device, job->cache,
+                                            job->compute_info, NULL,
+                                            &job->pipeline);
+   }
+}
+
+/**
+ * Create the pipelines of a batch on the device's pipeline queue and the
+ * calling thread.  Only done without allocation callbacks, see
+ * anv_CreateDevice().  anv doesn't use base pipelines, so derivatives don't
+ * have to wait for their parent.
+ */
+static bool
+create_pipelines_in_parallel(struct anv_device *device,
+                             struct anv_pipeline_cache *cache,
+                             uint32_t count,
+                             const VkGraphicsPipelineCreateInfo *graphics_infos,
+                             const VkComputePipelineCreateInfo *compute_infos,
+                             const VkAllocationCallbacks *pAllocator,
+                             VkPipeline *pPipelines,
+                             VkResult *result)
+{
+   struct pipeline_job *jobs;
+
+   if (count < 2 || pAllocator ||
+       !util_queue_is_initialized(&device->pipeline_queue))
+      return false;
+
+   jobs = calloc(count, sizeof(*jobs));
+   if (!jobs)
+      return false;
+
+   for (uint32_t i = 0; i < count; i++) {
+      struct pipeline_job *job = &jobs[i];
+
+      job->device = anv_device_to_handle(device);
+      job->cache = cache;
+      job->graphics_info = graphics_infos ? &graphics_infos[i] : NULL;
+      job->compute_info = compute_infos ? &compute_infos[i] : NULL;
+      util_queue_fence_init(&job->fence);
+
+      /* The calling thread creates the last pipeline itself. */
+      if (i == count - 1) {
+         pipeline_job_execute(job, 0);
+      } else {
+         util_queue_add_job(&device->pipeline_queue, job, &job->fence,
+                            pipeline_job_execute, NULL);
+      }
+   }
+
+   *result = VK_SUCCESS;
+   for (uint32_t i = 0; i < count; i++) {
+      struct pipeline_job *job = &jobs[i];
+
+      util_queue_fence_wait(&job->fence);
+      util_queue_fence_destroy(&job->fence);
+
+      /* Report the error of the first pipeline that failed, and only leave
+       * handles to the pipelines that were created successfully.
+       */
+      if (job->result != VK_SUCCESS) {
+         if (job->pipeline != VK_NULL_HANDLE)
+            anv_DestroyPipeline(job->device, job->pipeline, NULL);
+         if (*result == VK_SUCCESS)
+            *result = job->result;
+         pPipelines[i] = VK_NULL_HANDLE;
+      } else {
+         pPipelines[i] = job->pipeline;
+      }
+   }
+
+   free(jobs);
+   return true;
+}
+
 VkResult genX(CreateGraphicsPipelines)(
     VkDevice                                    _device,
     VkPipelineCache                             pipelineCache,
@@ -2154,10 +2250,16 @@ VkResult genX(CreateGraphicsPipelines)(
     const VkAllocationCallbacks*                pAllocator,
     VkPipeline*                                 pPipelines)
 {
+   ANV_FROM_HANDLE(anv_device, device, _device);
    ANV_FROM_HANDLE(anv_pipeline_cache, pipeline_cache, pipelineCache);
 
    VkResult result = VK_SUCCESS;
 
+   if (create_pipelines_in_parallel(device, pipeline_cache, count,
+                                    pCreateInfos, NULL, pAllocator,
+                                    pPipelines, &result))
+      return result;
+
    unsigned i;
    for (i = 0; i < count; i++) {
       result = genX(graphics_pipeline_create)(_device,
@@ -2185,10 +2287,16 @@ VkResult genX(CreateComputePipelines)(
     const VkAllocationCallbacks*                pAllocator,
     VkPipeline*                                 pPipelines)
 {
+   ANV_FROM_HANDLE(anv_device, device, _device);
    ANV_FROM_HANDLE(anv_pipeline_cache, pipeline_cache, pipelineCache);
 
    VkResult result = VK_SUCCESS;
 
+   if (create_pipelines_in_parallel(device, pipeline_cache, count,
+                                    NULL, pCreateInfos, pAllocator,
+                                    pPipelines, &result))
+      return result;
+
    unsigned i;
    for (i = 0; i < count; i++) {
       result = compute_pipeline_create(_device, pipeline_cache,
@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Stress test of state caches sharing a state pool: every thread allocates
+ * and frees states through its own cache, and checks that no other thread
+ * wrote to them.  The time per state is printed with and without the caches.
+ */
+
+#undef NDEBUG
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "anv_private.h"
+#include "util/os_time.h"
+
+#define NUM_THREADS 8
+#define STATE_SIZE 256
+#define STATES_PER_ROUND 64
+#define NUM_ROUNDS 1024
+
+struct job {
+   pthread_t thread;
+   unsigned id;
+   struct anv_state_pool *pool;
+   bool use_cache;
+} jobs[NUM_THREADS];
+
+pthread_barrier_t barrier;
+
+static void *alloc_states(void *_job)
+{
+   struct job *job = _job;
+   struct anv_state_cache cache;
+   struct anv_state states[STATES_PER_ROUND];
+
+   anv_state_cache_init(&cache, job->pool, STATE_SIZE);
+
+   pthread_barrier_wait(&barrier);
+
+   for (unsigned r = 0; r < NUM_ROUNDS; r++) {
+      /* Vary the number of states held at once, to go through both the
+       * refills and the returns of the cache.
+       */
+      const unsigned count = 1 + (r * 7 + job->id) % STATES_PER_ROUND;
+      const uint8_t tag = (job->id << 5) | (r & 31);
+
+      for (unsigned i = 0; i < count; i++) {
+         if (job->use_cache)
+            states[i] = anv_state_cache_alloc(&cache);
+         else
+            states[i] = anv_state_pool_alloc(job->pool, STATE_SIZE, 64);
+         assert(states[i].offset != 0);
+         assert(states[i].alloc_size == STATE_SIZE);
+         memset(states[i].map, tag, STATE_SIZE);
+      }
+
+      for (unsigned i = 0; i < count; i++) {
+         const uint8_t *map = states[i].map;
+         for (unsigned j = 0; j < STATE_SIZE; j++)
+            assert(map[j] == tag);
+
+         if (job->use_cache)
+            anv_state_cache_free(&cache, states[i]);
+         else
+            anv_state_pool_free(job->pool, states[i]);
+      }
+   }
+
+   anv_state_cache_finish(&cache);
+
+   return NULL;
+}
+
+static int64_t run_test(bool use_cache)
+{
+   struct anv_instance instance;
+   struct anv_device device = {
+      .instance = &instance,
+   };
+   struct anv_state_pool state_pool;
+
+   pthread_mutex_init(&device.mutex, NULL);
+   anv_state_pool_init(&state_pool, &device, 4096, 4096, 0);
+
+   /* Grab one so a zero offset is impossible */
+   anv_state_pool_alloc(&state_pool, 16, 16);
+
+   pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+
+   int64_t start = os_time_get_nano();
+
+   for (unsigned i = 0; i < NUM_THREADS; i++) {
+      jobs[i].pool = &state_pool;
+      jobs[i].id = i;
+      jobs[i].use_cache = use_cache;
+      pthread_create(&jobs[i].thread, NULL, alloc_states, &jobs[i]);
+   }
+
+   for (unsigned i = 0; i < NUM_THREADS; i++)
+      pthread_join(jobs[i].thread, NULL);
+
+   int64_t time = os_time_get_nano() - start;
+
+   pthread_barrier_destroy(&barrier);
+   anv_state_pool_finish(&state_pool);
+   pthread_mutex_destroy(&device.mutex);
+
+   return time;
+}
+
+int main(int argc, char **argv)
+{
+   const unsigned num_states =
+      NUM_THREADS * NUM_ROUNDS * (STATES_PER_ROUND + 1) / 2;
+
+   int64_t pool_time = run_test(false);
+   int64_t cache_time = run_test(true);
+
+   printf("state pool: %.1f ns/state, state caches: %.1f ns/state\n",
+          (double) pool_time / num_states, (double) cache_time / num_states);
+
+   return 0;
+}
@@ -1187,6 +1187,7 @@ intelDestroyContext(__DRIcontext * driContextPriv)
 
    blorp_finish(&brw->blorp);
 
+   brw_destroy_performance_queries(brw);
    brw_destroy_state(brw);
    brw_draw_destroy(brw);
 
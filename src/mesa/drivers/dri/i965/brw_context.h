@@ -682,6 +682,7 @@ struct shader_times;
 
 struct gen_l3_config;
 struct gen_perf;
+struct gen_perf_sampler;
 
 struct brw_uploader {
    struct brw_bufmgr *bufmgr;
@@ -772,6 +773,13 @@ struct brw_context
     */
    bool is_shared_buffer_dirty;
 
+   /**
+    * Set if a glBufferSubData blit has been emitted since the last flush,
+    * and the next draw or dispatch needs to flush it before reading the
+    * buffer.
+    */
+   bool subdata_flush_pending;
+
    /** Framerate throttling: @{ */
    struct brw_bo *throttle_batch[2];
 
@@ -1164,6 +1172,9 @@ struct brw_context
    struct {
       struct gen_perf *perf;
 
+      /* Background sampling of OA metrics, see INTEL_PERF_SAMPLE_RING */
+      struct gen_perf_sampler *sampler;
+
       /* The i915 perf stream we open to setup + enable the OA counters */
       int oa_stream_fd;
 
@@ -1455,6 +1466,7 @@ uint32_t brw_depth_format(struct brw_context *brw, mesa_format format);
 
 /* brw_performance_query.c */
 void brw_init_performance_queries(struct brw_context *brw);
+void brw_destroy_performance_queries(struct brw_context *brw);
 
 /* intel_extensions.c */
 extern void intelInitExtensions(struct gl_context *ctx);
@@ -73,6 +73,23 @@ gen_shader_sha1(struct gl_program *prog, gl_shader_stage stage,
    _mesa_sha1_compute(manifest, strlen(manifest), out_sha1);
 }
 
+/**
+ * The disk cache key of the list of variants seen for a program's stage.
+ */
+static void
+gen_variants_sha1(struct gl_program *prog, gl_shader_stage stage,
+                  unsigned char *out_sha1)
+{
+   char sha1_buf[41];
+   char manifest[256];
+
+   _mesa_sha1_format(sha1_buf, prog->sh.data->sha1);
+   snprintf(manifest, sizeof(manifest), "program: %s\n%s_variants\n",
+            sha1_buf, _mesa_shader_stage_to_abbrev(stage));
+
+   _mesa_sha1_compute(manifest, strlen(manifest), out_sha1);
+}
+
 static bool
 read_blob_program_data(struct blob_reader *binary, struct gl_program *prog,
                        gl_shader_stage stage, const uint8_t **program,
@@ -83,32 +100,49 @@ read_blob_program_data(struct blob_reader *binary, struct gl_program *prog,
       (binary->current == binary->end);
 }
 
-static bool
-read_and_upload(struct brw_context *brw, struct disk_cache *cache,
-                struct gl_program *prog, gl_shader_stage stage)
+static struct brw_stage_state *
+stage_state_for_stage(struct brw_context *brw, gl_shader_stage stage)
 {
-   unsigned char binary_sha1[20];
-
-   union brw_any_prog_key prog_key;
+   switch (stage) {
+   case MESA_SHADER_VERTEX:
+      return &brw->vs.base;
+   case MESA_SHADER_TESS_CTRL:
+      return &brw->tcs.base;
+   case MESA_SHADER_TESS_EVAL:
+      return &brw->tes.base;
+   case MESA_SHADER_GEOMETRY:
+      return &brw->gs.base;
+   case MESA_SHADER_FRAGMENT:
+      return &brw->wm.base;
+   case MESA_SHADER_COMPUTE:
+      return &brw->cs.base;
+   default:
+      unreachable("Unsupported stage!");
+   }
+}
 
+static void
+populate_key(struct brw_context *brw, gl_shader_stage stage,
+             union brw_any_prog_key *prog_key)
+{
    switch (stage) {
    case MESA_SHADER_VERTEX:
-      brw_vs_populate_key(brw, &prog_key.vs);
+      brw_vs_populate_key(brw, &prog_key->vs);
       break;
    case MESA_SHADER_TESS_CTRL:
-      brw_tcs_populate_key(brw, &prog_key.tcs);
+      brw_tcs_populate_key(brw, &prog_key->tcs);
       break;
    case MESA_SHADER_TESS_EVAL:
-      brw_tes_populate_key(brw, &prog_key.tes);
+      brw_tes_populate_key(brw, &prog_key->tes);
       break;
    case MESA_SHADER_GEOMETRY:
-      brw_gs_populate_key(brw, &prog_key.gs);
+      brw_gs_populate_key(brw, &prog_key->gs);
       break;
    case MESA_SHADER_FRAGMENT:
-      brw_wm_populate_key(brw, &prog_key.wm);
+      brw_wm_populate_key(brw, &prog_key->wm);
       break;
    case MESA_SHADER_COMPUTE:
-      brw_cs_populate_key(brw, &prog_key.cs);
+      brw_cs_populate_key(brw, &prog_key->cs);
       break;
    default:
       unreachable("Unsupported stage!");
@@ -116,15 +150,27 @@ read_and_upload(struct brw_context *brw, struct disk_cache *cache,
 
    /* We don't care what instance of the program it is for the disk cache hash
     * lookup, so set the id to 0 for the sha1 hashing. program_string_id will
-    * be set below.
+    * be set when uploading.
     */
-   brw_prog_key_set_id(&prog_key, stage, 0);
+   brw_prog_key_set_id(prog_key, stage, 0);
+}
+
+/**
+ * Look up the variant of a program for the given key (with a zero
+ * program_string_id) in the disk cache, and upload it to the program cache.
+ */
+static bool
+read_and_upload(struct brw_context *brw, struct disk_cache *cache,
+                struct gl_program *prog, gl_shader_stage stage,
+                union brw_any_prog_key prog_key,
+                uint32_t *out_offset, void *out_prog_data)
+{
+   unsigned char binary_sha1[20];
 
    gen_shader_sha1(prog, stage, &prog_key, binary_sha1);
 
-   size_t buffer_size;
-   uint8_t *buffer = disk_cache_get(cache, binary_sha1, &buffer_size);
-   if (buffer == NULL) {
+   struct disk_cache_view buffer;
+   if (!disk_cache_get_view(cache, binary_sha1, &buffer)) {
       if (brw->ctx._Shader->Flags & GLSL_CACHE_INFO) {
          char sha1_buf[41];
          _mesa_sha1_format(sha1_buf, binary_sha1);
@@ -142,7 +188,7 @@ read_and_upload(struct brw_context *brw, struct disk_cache *cache,
    }
 
    struct blob_reader binary;
-   blob_reader_init(&binary, buffer, buffer_size);
+   blob_reader_init(&binary, buffer.data, buffer.size);
 
    const uint8_t *program;
    struct brw_stage_prog_data *prog_data =
@@ -156,43 +202,14 @@ read_and_upload(struct brw_context *brw, struct disk_cache *cache,
                  "cache item)\n");
       }
 
+      disk_cache_release_view(cache, &buffer);
       disk_cache_remove(cache, binary_sha1);
       ralloc_free(prog_data);
-      free(buffer);
       return false;
    }
 
-   enum brw_cache_id cache_id;
-   struct brw_stage_state *stage_state;
-
-   switch (stage) {
-   case MESA_SHADER_VERTEX:
-      cache_id = BRW_CACHE_VS_PROG;
-      stage_state = &brw->vs.base;
-      break;
-   case MESA_SHADER_TESS_CTRL:
-      cache_id = BRW_CACHE_TCS_PROG;
-      stage_state = &brw->tcs.base;
-      break;
-   case MESA_SHADER_TESS_EVAL:
-      cache_id = BRW_CACHE_TES_PROG;
-      stage_state = &brw->tes.base;
-      break;
-   case MESA_SHADER_GEOMETRY:
-      cache_id = BRW_CACHE_GS_PROG;
-      stage_state = &brw->gs.base;
-      break;
-   case MESA_SHADER_FRAGMENT:
-      cache_id = BRW_CACHE_FS_PROG;
-      stage_state = &brw->wm.base;
-      break;
-   case MESA_SHADER_COMPUTE:
-      cache_id = BRW_CACHE_CS_PROG;
-      stage_state = &brw->cs.base;
-      break;
-   default:
-      unreachable("Unsupported stage!");
-   }
+   enum brw_cache_id cache_id = brw_stage_cache_id(stage);
+   struct brw_stage_state *stage_state = stage_state_for_stage(brw, stage);
 
    brw_prog_key_set_id(&prog_key, stage, brw_program(prog)->id);
 
@@ -213,13 +230,12 @@ read_and_upload(struct brw_context *brw, struct disk_cache *cache,
 
    brw_upload_cache(&brw->cache, cache_id, &prog_key, brw_prog_key_size(stage),
                     program, prog_data->program_size, prog_data,
-                    brw_prog_data_size(stage), &stage_state->prog_offset,
-                    &stage_state->prog_data);
+                    brw_prog_data_size(stage), out_offset, out_prog_data);
 
    prog->program_written_to_cache = true;
 
    ralloc_free(prog_data);
-   free(buffer);
+   disk_cache_release_view(cache, &buffer);
 
    return true;
 }
@@ -238,7 +254,13 @@ brw_disk_cache_upload_program(struct brw_context *brw, gl_shader_stage stage)
    if (brw->ctx._Shader->Flags & GLSL_CACHE_FALLBACK)
       goto fail;
 
-   if (!read_and_upload(brw, cache, prog, stage))
+   union brw_any_prog_key prog_key;
+   populate_key(brw, stage, &prog_key);
+
+   struct brw_stage_state *stage_state = stage_state_for_stage(brw, stage);
+
+   if (!read_and_upload(brw, cache, prog, stage, prog_key,
+                        &stage_state->prog_offset, &stage_state->prog_data))
       goto fail;
 
    if (brw->ctx._Shader->Flags & GLSL_CACHE_INFO) {
@@ -259,6 +281,56 @@ fail:
    return false;
 }
 
+struct variant_list_state {
+   struct blob *blob;
+   gl_shader_stage stage;
+};
+
+static void
+add_variant_key(void *data, const void *key, const void *program,
+                struct brw_stage_prog_data *prog_data)
+{
+   struct variant_list_state *state = data;
+   const unsigned key_size = brw_prog_key_size(state->stage);
+
+   union brw_any_prog_key prog_key;
+   memcpy(&prog_key, key, key_size);
+   brw_prog_key_set_id(&prog_key, state->stage, 0);
+
+   blob_write_bytes(state->blob, &prog_key, key_size);
+}
+
+/**
+ * Store the keys of all the variants of a program we have in the program
+ * cache, so that the next run can upload all of them from the disk cache
+ * when the program is linked, rather than when each of them is first drawn
+ * with.  This includes the variants loaded from the disk cache, so the list
+ * keeps growing across runs.
+ */
+static void
+write_variant_list(struct brw_context *brw, struct gl_program *prog,
+                   struct disk_cache *cache, gl_shader_stage stage)
+{
+   struct blob list;
+   blob_init(&list);
+
+   struct variant_list_state state = {
+      .blob = &list,
+      .stage = stage,
+   };
+   brw_foreach_program_variant(&brw->cache, brw_stage_cache_id(stage),
+                               brw_program(prog)->id, add_variant_key,
+                               &state);
+
+   unsigned char sha1[20];
+   gen_variants_sha1(prog, stage, sha1);
+
+   if (!list.out_of_memory && list.size > 0)
+      disk_cache_put(cache, sha1, list.data, list.size, NULL);
+
+   blob_finish(&list);
+}
+
 static void
 write_program_data(struct brw_context *brw, struct gl_program *prog,
                    void *key, struct brw_stage_prog_data *prog_data,
@@ -287,6 +359,8 @@ write_program_data(struct brw_context *brw, struct gl_program *prog,
 
    prog->program_written_to_cache = true;
    blob_finish(&binary);
+
+   write_variant_list(brw, prog, cache, stage);
 }
 
 void
@@ -373,6 +447,76 @@ brw_disk_cache_write_compute_program(struct brw_context *brw)
    }
 }
 
+static void
+upload_variants(struct brw_context *brw, struct disk_cache *cache,
+                struct gl_program *prog, gl_shader_stage stage)
+{
+   const unsigned key_size = brw_prog_key_size(stage);
+   const enum brw_cache_id cache_id = brw_stage_cache_id(stage);
+
+   unsigned char sha1[20];
+   gen_variants_sha1(prog, stage, sha1);
+
+   struct disk_cache_view buffer;
+   if (!disk_cache_get_view(cache, sha1, &buffer))
+      return;
+
+   if (buffer.size % key_size != 0) {
+      if (brw->ctx._Shader->Flags & GLSL_CACHE_INFO) {
+         fprintf(stderr, "Error reading program variants from cache "
+                 "(invalid i965 cache item)\n");
+      }
+
+      disk_cache_release_view(cache, &buffer);
+      disk_cache_remove(cache, sha1);
+      return;
+   }
+
+   const unsigned num_variants = buffer.size / key_size;
+
+   for (unsigned i = 0; i < num_variants; i++) {
+      union brw_any_prog_key prog_key;
+      memcpy(&prog_key, (const char *) buffer.data + i * key_size, key_size);
+
+      /* Skip the ones we already have, e.g. from the precompile. */
+      uint32_t offset = 0;
+      void *prog_data = NULL;
+      brw_prog_key_set_id(&prog_key, stage, brw_program(prog)->id);
+      if (brw_search_cache(&brw->cache, cache_id, &prog_key, key_size,
+                           &offset, &prog_data, false))
+         continue;
+
+      brw_prog_key_set_id(&prog_key, stage, 0);
+      read_and_upload(brw, cache, prog, stage, prog_key, &offset, &prog_data);
+   }
+
+   disk_cache_release_view(cache, &buffer);
+}
+
+/**
+ * Upload all the variants of a linked program's stages recorded in the disk
+ * cache by previous runs, so that the ones needed because of the
+ * non-orthogonal state don't have to be read or recompiled at draw time.
+ */
+void
+brw_disk_cache_upload_variants(struct brw_context *brw,
+                               struct gl_shader_program *sh_prog)
+{
+   struct disk_cache *cache = brw->ctx.Cache;
+   if (cache == NULL || (brw->ctx._Shader->Flags & GLSL_CACHE_FALLBACK))
+      return;
+
+   /* Internal programs aren't in the shader cache, and have no sha1. */
+   if (sh_prog->Name == 0)
+      return;
+
+   for (unsigned stage = 0; stage < MESA_SHADER_STAGES; stage++) {
+      struct gl_linked_shader *shader = sh_prog->_LinkedShaders[stage];
+      if (shader)
+         upload_variants(brw, cache, shader->Program, stage);
+   }
+}
+
 void
 brw_disk_cache_init(struct intel_screen *screen)
 {
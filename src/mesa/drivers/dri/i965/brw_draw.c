@@ -590,6 +590,12 @@ brw_predraw_resolve_inputs(struct brw_context *brw, bool rendering,
          }
       }
    }
+
+   /* Make the buffer object blits of glBufferSubData visible. */
+   if (brw->subdata_flush_pending) {
+      brw_emit_mi_flush(brw);
+      brw->subdata_flush_pending = false;
+   }
 }
 
 static void
@@ -229,8 +229,14 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
    unsigned int stage;
    struct shader_info *infos[MESA_SHADER_STAGES] = { 0, };
 
-   if (shProg->data->LinkStatus == LINKING_SKIPPED)
+   if (shProg->data->LinkStatus == LINKING_SKIPPED) {
+      /* The program came from the shader cache, so there's likely also
+       * native code for the variants it needed last time.
+       */
+      if (brw->precompile)
+         brw_disk_cache_upload_variants(brw, shProg);
       return GL_TRUE;
+   }
 
    for (stage = 0; stage < ARRAY_SIZE(shProg->_LinkedShaders); stage++) {
       struct gl_linked_shader *shader = shProg->_LinkedShaders[stage];
@@ -371,8 +377,12 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
       }
    }
 
-   if (brw->precompile && !brw_shader_precompile(ctx, shProg))
-      return false;
+   if (brw->precompile) {
+      if (!brw_shader_precompile(ctx, shProg))
+         return false;
+
+      brw_disk_cache_upload_variants(brw, shProg);
+   }
 
    /* SPIR-V programs build its resource list from linked NIR shaders. */
    if (!shProg->data->spirv)
@@ -75,6 +75,7 @@
 
 #include "perf/gen_perf.h"
 #include "perf/gen_perf_mdapi.h"
+#include "perf/gen_perf_sampler.h"
 
 #define FILE_DEBUG_FLAG DEBUG_PERFMON
 
@@ -1814,4 +1815,23 @@ brw_init_performance_queries(struct brw_context *brw)
    ctx->Driver.WaitPerfQuery = brw_wait_perf_query;
    ctx->Driver.IsPerfQueryReady = brw_is_perf_query_ready;
    ctx->Driver.GetPerfQueryData = brw_get_perf_query_data;
+
+   /* Sample a few OA metrics in the background for monitoring tools and
+    * the HUD.  This uses the OA unit for the whole life of the context, so
+    * the OA queries can't be used at the same time.
+    */
+   const char *ring_path = getenv("INTEL_PERF_SAMPLE_RING");
+   if (ring_path && brw_init_perf_query_info(ctx)) {
+      brw->perfquery.sampler =
+         gen_perf_sampler_create(brw->perfquery.perf,
+                                 brw->screen->driScrnPriv->fd,
+                                 ring_path, 100000000ull /* 100ms */);
+   }
+}
+
+void
+brw_destroy_performance_queries(struct brw_context *brw)
+{
+   if (brw->perfquery.sampler)
+      gen_perf_sampler_destroy(brw->perfquery.sampler);
 }
@@ -108,6 +108,9 @@ bool brw_gs_precompile(struct gl_context *ctx, struct gl_program *prog);
 bool brw_fs_precompile(struct gl_context *ctx, struct gl_program *prog);
 bool brw_cs_precompile(struct gl_context *ctx, struct gl_program *prog);
 
+void brw_disk_cache_upload_variants(struct brw_context *brw,
+                                    struct gl_shader_program *sh_prog);
+
 GLboolean brw_link_shader(struct gl_context *ctx, struct gl_shader_program *prog);
 
 void brw_upload_tcs_prog(struct brw_context *brw);
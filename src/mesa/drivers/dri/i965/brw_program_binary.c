@@ -132,7 +132,7 @@ serialize_nir_part(struct blob *writer, struct gl_program *prog)
    blob_write_uint32(writer, NIR_PART);
    intptr_t size_offset = blob_reserve_uint32(writer);
    size_t nir_start = writer->size;
-   nir_serialize(writer, prog->nir);
+   nir_serialize(writer, prog->nir, false);
    blob_overwrite_uint32(writer, size_offset, writer->size - nir_start);
 }
 
@@ -243,36 +243,52 @@ brw_deserialize_program_binary(struct gl_context *ctx,
    brw_program_deserialize_driver_blob(ctx, prog, prog->info.stage);
 }
 
+struct serialize_gen_state {
+   struct blob *writer;
+   gl_shader_stage stage;
+};
+
+static void
+serialize_gen_variant(void *data, const void *key, const void *program_map,
+                      struct brw_stage_prog_data *prog_data)
+{
+   struct serialize_gen_state *state = data;
+   struct blob *writer = state->writer;
+
+   /* TODO: Improve perf for non-LLC. It would be best to save it at
+    * program generation time when the program is in normal memory
+    * accessible with cache to the CPU. Another easier change would be to
+    * use _mesa_streaming_load_memcpy to read from the program mapped
+    * memory.
+    */
+   blob_write_uint32(writer, GEN_PART);
+   intptr_t size_offset = blob_reserve_uint32(writer);
+   size_t gen_start = writer->size;
+   blob_write_bytes(writer, key, brw_prog_key_size(state->stage));
+   brw_write_blob_program_data(writer, state->stage, program_map, prog_data);
+   blob_overwrite_uint32(writer, size_offset, writer->size - gen_start);
+}
+
+/**
+ * Write a GEN_PART for each variant of the program compiled so far, not
+ * just the one for the default key, so that recompiles triggered by the
+ * non-orthogonal state don't have to happen again when the binary is
+ * loaded.
+ */
 static void
 serialize_gen_part(struct blob *writer, struct gl_context *ctx,
-                   struct gl_shader_program *sh_prog,
                    struct gl_program *prog)
 {
    struct brw_context *brw = brw_context(ctx);
 
-   union brw_any_prog_key key;
-   brw_populate_default_key(&brw->screen->devinfo, &key, sh_prog, prog);
-
-   const gl_shader_stage stage = prog->info.stage;
-   uint32_t offset = 0;
-   void *prog_data = NULL;
-   if (brw_search_cache(&brw->cache, brw_stage_cache_id(stage), &key,
-                        brw_prog_key_size(stage), &offset, &prog_data,
-                        false)) {
-      const void *program_map = brw->cache.map + offset;
-      /* TODO: Improve perf for non-LLC. It would be best to save it at
-       * program generation time when the program is in normal memory
-       * accessible with cache to the CPU. Another easier change would be to
-       * use _mesa_streaming_load_memcpy to read from the program mapped
-       * memory.
-       */
-      blob_write_uint32(writer, GEN_PART);
-      intptr_t size_offset = blob_reserve_uint32(writer);
-      size_t gen_start = writer->size;
-      blob_write_bytes(writer, &key, brw_prog_key_size(stage));
-      brw_write_blob_program_data(writer, stage, program_map, prog_data);
-      blob_overwrite_uint32(writer, size_offset, writer->size - gen_start);
-   }
+   struct serialize_gen_state state = {
+      .writer = writer,
+      .stage = prog->info.stage,
+   };
+
+   brw_foreach_program_variant(&brw->cache, brw_stage_cache_id(state.stage),
+                               brw_program(prog)->id,
+                               serialize_gen_variant, &state);
 }
 
 void
@@ -297,7 +313,7 @@ brw_serialize_program_binary(struct gl_context *ctx,
    struct blob writer;
    blob_init(&writer);
    serialize_nir_part(&writer, prog);
-   serialize_gen_part(&writer, ctx, sh_prog, prog);
+   serialize_gen_part(&writer, ctx, prog);
    blob_write_uint32(&writer, END_PART);
    prog->driver_cache_blob = ralloc_size(NULL, writer.size);
    memcpy(prog->driver_cache_blob, writer.data, writer.size);
@@ -329,6 +329,27 @@ brw_find_previous_compile(struct brw_cache *cache,
    return NULL;
 }
 
+/**
+ * Call \p cb for each program in the cache which was compiled for the given
+ * program string id, i.e. for every variant of a program.
+ */
+void
+brw_foreach_program_variant(struct brw_cache *cache,
+                            enum brw_cache_id cache_id,
+                            unsigned program_string_id,
+                            brw_program_variant_cb cb, void *data)
+{
+   for (unsigned i = 0; i < cache->size; i++) {
+      for (struct brw_cache_item *c = cache->items[i]; c; c = c->next) {
+         if (c->cache_id == cache_id &&
+             get_program_string_id(cache_id, c->key) == program_string_id) {
+            cb(data, c->key, cache->map + c->offset,
+               (void *) ((char *) c->key + c->key_size));
+         }
+      }
+   }
+}
+
 void
 brw_upload_cache(struct brw_cache *cache,
                  enum brw_cache_id cache_id,
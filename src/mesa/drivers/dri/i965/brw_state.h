@@ -203,6 +203,15 @@ const void *brw_find_previous_compile(struct brw_cache *cache,
                                       enum brw_cache_id cache_id,
                                       unsigned program_string_id);
 
+typedef void (*brw_program_variant_cb)(void *data, const void *key,
+                                       const void *program,
+                                       struct brw_stage_prog_data *prog_data);
+
+void brw_foreach_program_variant(struct brw_cache *cache,
+                                 enum brw_cache_id cache_id,
+                                 unsigned program_string_id,
+                                 brw_program_variant_cb cb, void *data);
+
 void brw_program_cache_check_size(struct brw_context *brw);
 
 void brw_init_caches( struct brw_context *brw );
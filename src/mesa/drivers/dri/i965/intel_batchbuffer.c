@@ -292,6 +292,7 @@ intel_batchbuffer_reset_and_clear_render_cache(struct brw_context *brw)
 {
    intel_batchbuffer_reset(brw);
    brw_cache_sets_clear(brw);
+   brw->subdata_flush_pending = false;
 }
 
 void
@@ -289,18 +289,22 @@ brw_buffer_subdata(struct gl_context *ctx,
                     intel_obj->gpu_active_end,
                     intel_obj->valid_data_start,
                     intel_obj->valid_data_end);
-         struct brw_bo *temp_bo =
-            brw_bo_alloc(brw->bufmgr, "subdata temp", size, BRW_MEMZONE_OTHER);
-
-         brw_bo_subdata(temp_bo, 0, size, data);
+         /* Stream the data through the upload buffer rather than allocating
+          * a temporary BO for every call.  The flush making the copy visible
+          * is deferred to the next draw or dispatch, so that a run of
+          * subdata calls only pays for one.
+          */
+         struct brw_bo *src_bo = NULL;
+         uint32_t src_offset;
+         brw_upload_data(&brw->upload, data, size, 64, &src_bo, &src_offset);
 
          brw_blorp_copy_buffers(brw,
-                                temp_bo, 0,
+                                src_bo, src_offset,
                                 intel_obj->buffer, offset,
                                 size);
-         brw_emit_mi_flush(brw);
+         brw->subdata_flush_pending = true;
 
-         brw_bo_unreference(temp_bo);
+         brw_bo_unreference(src_bo);
          mark_buffer_valid_data(intel_obj, offset, size);
          return;
       } else {
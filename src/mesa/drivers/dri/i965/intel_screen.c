@@ -1693,6 +1693,7 @@ intelDestroyScreen(__DRIscreen * sPriv)
    driDestroyOptionInfo(&screen->optionCache);
 
    disk_cache_destroy(screen->disk_cache);
+   isl_device_finish(&screen->isl_dev);
 
    ralloc_free(screen);
    sPriv->driverPrivate = NULL;
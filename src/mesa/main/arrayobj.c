@@ -451,6 +451,20 @@ _mesa_initialize_vao(struct gl_context *ctx,
 
    _mesa_reference_buffer_object(ctx, &vao->IndexBufferObj,
                                  ctx->Shared->NullBufferObj);
+
+   _mesa_update_vao_stamp(vao);
+}
+
+
+/**
+ * Assign a new gl_vertex_array_object::_Stamp to the VAO.
+ */
+void
+_mesa_update_vao_stamp(struct gl_vertex_array_object *vao)
+{
+   static unsigned next_stamp;
+
+   vao->_Stamp = p_atomic_inc_return(&next_stamp);
 }
 
 
@@ -573,6 +587,8 @@ _mesa_update_vao_derived_arrays(struct gl_context *ctx,
    /* Make sure we do not run into problems with shared objects */
    assert(!vao->SharedAndImmutable || vao->NewArrays == 0);
 
+   _mesa_update_vao_stamp(vao);
+
    /* Limit used for common binding scanning below. */
    const GLsizeiptr MaxRelativeOffset =
       ctx->Const.MaxVertexAttribRelativeOffset;
@@ -150,6 +150,7 @@
 
 #include "compiler/glsl_types.h"
 #include "compiler/glsl/glsl_parser_extras.h"
+#include "compiler/nir/nir.h"
 #include <stdbool.h>
 
 
@@ -1388,6 +1389,9 @@ _mesa_free_context_data(struct gl_context *ctx, bool destroy_compiler_types)
    if (destroy_compiler_types)
       _mesa_destroy_shader_compiler_types();
 
+   if (should_collect_nir_pass_stats())
+      nir_pass_stats_report();
+
    /* unbind the context if it's currently bound */
    if (ctx == _mesa_get_current_context()) {
       _mesa_make_current(NULL, NULL, NULL);
@@ -1108,6 +1108,14 @@ struct dd_function_table {
    void (*SetBackgroundContext)(struct gl_context *ctx,
                                 struct util_queue_monitoring *queue_info);
 
+   /**
+    * Pin the threads of the driver to the given L3 cache.
+    *
+    * GL multithreading calls this from the background thread when the
+    * application thread has moved to a different L3 cache. Optional.
+    */
+   void (*PinDriverToL3Cache)(struct gl_context *ctx, unsigned L3_cache);
+
    /**
     * \name GL_ARB_sparse_buffer interface
     */
@@ -27,6 +27,8 @@
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "sse_swizzle.h"
+#include "x86/common_x86_asm.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(4, 1, 1, 1, 4, 0, 1, 2, 3);
@@ -192,6 +194,19 @@ convert_ubyte_rgba_to_bgra(size_t width, size_t height,
 {
    int row;
 
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      static const uint8_t swizzle[4] = { 2, 1, 0, 3 };
+
+      for (row = 0; row < height; row++) {
+         _mesa_swizzle_ubyte_to_rgba(dst, src, 4, swizzle, true, width);
+         src += src_stride;
+         dst += dst_stride;
+      }
+      return;
+   }
+#endif
+
    if (sizeof(void *) == 8 &&
        src_stride % 8 == 0 &&
        dst_stride % 8 == 0 &&
@@ -1511,6 +1526,16 @@ _mesa_swizzle_and_convert(void *void_dst, enum mesa_array_format_datatype dst_ty
                                   swizzle, normalized, count))
       return;
 
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1 &&
+       dst_type == MESA_ARRAY_FORMAT_TYPE_UBYTE &&
+       src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE &&
+       num_dst_channels == 4 &&
+       _mesa_swizzle_ubyte_to_rgba(void_dst, void_src, num_src_channels,
+                                   swizzle, normalized, count))
+      return;
+#endif
+
    switch (dst_type) {
    case MESA_ARRAY_FORMAT_TYPE_FLOAT:
       convert_float(void_dst, num_dst_channels, void_src, src_type,
@@ -36,23 +36,57 @@
 #include "main/glthread.h"
 #include "main/marshal.h"
 #include "main/marshal_generated.h"
+#include "util/os_time.h"
 #include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_thread.h"
 
+#if defined(__linux__) && !defined(ANDROID)
+#include <sched.h>
+#define HAVE_SCHED_GETCPU 1
+#else
+#define sched_getcpu() 0
+#define HAVE_SCHED_GETCPU 0
+#endif
+
 
 static void
 glthread_unmarshal_batch(void *job, int thread_index)
 {
    struct glthread_batch *batch = (struct glthread_batch*)job;
    struct gl_context *ctx = batch->ctx;
+   struct glthread_state *glthread = ctx->GLThread;
    size_t pos = 0;
 
    _glapi_set_dispatch(ctx->CurrentServerDispatch);
 
+   if (batch->pin_L3_cache >= 0) {
+      if (ctx->Driver.PinDriverToL3Cache)
+         ctx->Driver.PinDriverToL3Cache(ctx, batch->pin_L3_cache);
+      batch->pin_L3_cache = -1;
+   }
+
+   int64_t start = os_time_get_nano();
+
    while (pos < batch->used)
       pos += _mesa_unmarshal_dispatch_cmd(ctx, &batch->buffer[pos]);
 
    assert(pos == batch->used);
+
+   /* Only full batches say something about the batch size; the ones flushed
+    * early by a sync would only shrink it.
+    */
+   if (batch->used >= glthread->batch_size / 2) {
+      int64_t time = os_time_get_nano() - start;
+
+      if (time < MARSHAL_FAST_BATCH_NS &&
+          glthread->batch_size < MARSHAL_MAX_CMD_SIZE)
+         p_atomic_set(&glthread->batch_size, glthread->batch_size * 2);
+      else if (time > MARSHAL_SLOW_BATCH_NS &&
+               glthread->batch_size > MARSHAL_MIN_BATCH_SIZE)
+         p_atomic_set(&glthread->batch_size, glthread->batch_size / 2);
+   }
+
    batch->used = 0;
 }
 
@@ -73,8 +107,9 @@ _mesa_glthread_init(struct gl_context *ctx)
    if (!glthread)
       return;
 
+   /* Only the application thread bound to the context submits batches. */
    if (!util_queue_init(&glthread->queue, "gl", MARSHAL_MAX_BATCHES - 2,
-                        1, 0)) {
+                        1, UTIL_QUEUE_INIT_SINGLE_PRODUCER)) {
       free(glthread);
       return;
    }
@@ -88,9 +123,13 @@ _mesa_glthread_init(struct gl_context *ctx)
 
    for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++) {
       glthread->batches[i].ctx = ctx;
+      glthread->batches[i].pin_L3_cache = -1;
       util_queue_fence_init(&glthread->batches[i].fence);
    }
 
+   glthread->batch_size = MARSHAL_MAX_CMD_SIZE;
+   glthread->pinned_L3_cache = -1;
+
    glthread->stats.queue = &glthread->queue;
    ctx->CurrentClientDispatch = ctx->MarshalExec;
    ctx->GLThread = glthread;
@@ -142,6 +181,40 @@ _mesa_glthread_restore_dispatch(struct gl_context *ctx, const char *func)
    }
 }
 
+/**
+ * Re-pin the worker thread and, through the next batch, the driver threads
+ * to the L3 cache the application thread is running on, so that the data
+ * passed between them stays in the same cache. This only matters on CPUs
+ * with several L3 caches, like AMD Zen.
+ */
+static void
+glthread_pin_to_app_thread(struct gl_context *ctx,
+                           struct glthread_batch *next)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!HAVE_SCHED_GETCPU ||
+       util_cpu_caps.nr_cpus == util_cpu_caps.cores_per_L3 ||
+       ++glthread->pin_counter < MARSHAL_PIN_CHECK_INTERVAL)
+      return;
+
+   glthread->pin_counter = 0;
+
+   int cpu = sched_getcpu();
+   if (cpu < 0)
+      return;
+
+   int L3_cache = cpu / util_cpu_caps.cores_per_L3;
+   if (L3_cache == glthread->pinned_L3_cache)
+      return;
+
+   util_pin_thread_to_L3(glthread->queue.threads[0], L3_cache,
+                         util_cpu_caps.cores_per_L3);
+   next->pin_L3_cache = L3_cache;
+   glthread->pinned_L3_cache = L3_cache;
+   p_atomic_inc(&glthread->stats.num_repins);
+}
+
 void
 _mesa_glthread_flush_batch(struct gl_context *ctx)
 {
@@ -164,7 +237,10 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
       return;
    }
 
+   glthread_pin_to_app_thread(ctx, next);
+
    p_atomic_add(&glthread->stats.num_offloaded_items, next->used);
+   p_atomic_inc(&glthread->stats.num_batches);
 
    util_queue_add_job(&glthread->queue, next, &next->fence,
                       glthread_unmarshal_batch, NULL);
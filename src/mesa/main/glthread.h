@@ -35,6 +35,26 @@
  */
 #define MARSHAL_MAX_CMD_SIZE (8 * 1024)
 
+/* The smallest size a batch is submitted at, see glthread_state::batch_size.
+ *
+ * Batches are shrunk towards it when the worker thread takes long enough to
+ * execute them that the application thread would observe the latency, and
+ * grown back to MARSHAL_MAX_CMD_SIZE when they are cheap enough that the
+ * u_queue overhead dominates.
+ */
+#define MARSHAL_MIN_BATCH_SIZE (1024)
+
+/* Batch execution times below and above which the batch size is doubled or
+ * halved, in nanoseconds.
+ */
+#define MARSHAL_FAST_BATCH_NS (50 * 1000)
+#define MARSHAL_SLOW_BATCH_NS (500 * 1000)
+
+/* How many batches are submitted between checks of which L3 cache the
+ * application thread is running on.
+ */
+#define MARSHAL_PIN_CHECK_INTERVAL 64
+
 /* The number of batch slots in memory.
  *
  * One batch is being executed, one batch is being filled, the rest are
@@ -62,6 +82,12 @@ struct glthread_batch
    /** Amount of data used by batch commands, in bytes. */
    size_t used;
 
+   /**
+    * L3 cache the driver threads should be pinned to before the batch is
+    * executed, or -1 to leave them where they are.
+    */
+   int pin_L3_cache;
+
    /** Data contained in the command buffer. */
    uint8_t buffer[MARSHAL_MAX_CMD_SIZE];
 };
@@ -83,6 +109,19 @@ struct glthread_state
    /** Index of the batch being filled and about to be submitted. */
    unsigned next;
 
+   /**
+    * Size at which the batch being filled is submitted. It's adjusted by the
+    * worker thread based on how long batches take to execute and is always
+    * between MARSHAL_MIN_BATCH_SIZE and MARSHAL_MAX_CMD_SIZE.
+    */
+   unsigned batch_size;
+
+   /** Number of submitted batches since the last pinning check. */
+   unsigned pin_counter;
+
+   /** L3 cache the worker thread is pinned to, or -1 if it's unknown. */
+   int pinned_L3_cache;
+
    /**
     * Tracks on the main thread side whether the current vertex array binding
     * is in a VBO.
@@ -94,6 +133,15 @@ struct glthread_state
     * buffer) binding is in a VBO.
     */
    bool element_array_is_vbo;
+
+   /**
+    * Names of the buffers bound to the targets that glGetIntegerv() queries
+    * are answered for on the main thread, see _mesa_marshal_GetIntegerv().
+    */
+   unsigned array_buffer_name;
+   unsigned draw_indirect_buffer_name;
+   unsigned pixel_pack_buffer_name;
+   unsigned pixel_unpack_buffer_name;
 };
 
 void _mesa_glthread_init(struct gl_context *ctx);
@@ -235,6 +235,7 @@ track_vbo_binding(struct gl_context *ctx, GLenum target, GLuint buffer)
    switch (target) {
    case GL_ARRAY_BUFFER:
       glthread->vertex_array_is_vbo = (buffer != 0);
+      glthread->array_buffer_name = buffer;
       break;
    case GL_ELEMENT_ARRAY_BUFFER:
       /* The current element array buffer binding is actually tracked in the
@@ -243,6 +244,43 @@ track_vbo_binding(struct gl_context *ctx, GLenum target, GLuint buffer)
        */
       glthread->element_array_is_vbo = (buffer != 0);
       break;
+   case GL_DRAW_INDIRECT_BUFFER:
+      glthread->draw_indirect_buffer_name = buffer;
+      break;
+   case GL_PIXEL_PACK_BUFFER:
+      glthread->pixel_pack_buffer_name = buffer;
+      break;
+   case GL_PIXEL_UNPACK_BUFFER:
+      glthread->pixel_unpack_buffer_name = buffer;
+      break;
+   }
+}
+
+
+/**
+ * Deleting a bound buffer binds the null buffer instead.
+ */
+static void
+track_vbo_deletion(struct gl_context *ctx, GLsizei n, const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   for (GLsizei i = 0; i < n; i++) {
+      const GLuint buffer = buffers[i];
+
+      if (buffer == 0)
+         continue;
+
+      if (buffer == glthread->array_buffer_name) {
+         glthread->array_buffer_name = 0;
+         glthread->vertex_array_is_vbo = false;
+      }
+      if (buffer == glthread->draw_indirect_buffer_name)
+         glthread->draw_indirect_buffer_name = 0;
+      if (buffer == glthread->pixel_pack_buffer_name)
+         glthread->pixel_pack_buffer_name = 0;
+      if (buffer == glthread->pixel_unpack_buffer_name)
+         glthread->pixel_unpack_buffer_name = 0;
    }
 }
 
@@ -288,6 +326,103 @@ _mesa_marshal_BindBuffer(GLenum target, GLuint buffer)
    }
 }
 
+/* DeleteBuffers: marshalled asynchronously */
+struct marshal_cmd_DeleteBuffers
+{
+   struct marshal_cmd_base cmd_base;
+   GLsizei n;
+   /* Next n * sizeof(GLuint) bytes are GLuint buffer[n] */
+};
+
+/**
+ * This is just like the code-generated glDeleteBuffers() support, except
+ * that we call track_vbo_deletion().
+ */
+void
+_mesa_unmarshal_DeleteBuffers(struct gl_context *ctx,
+                              const struct marshal_cmd_DeleteBuffers *cmd)
+{
+   const GLsizei n = cmd->n;
+   const GLuint *buffer = (const GLuint *) (cmd + 1);
+
+   CALL_DeleteBuffers(ctx->CurrentServerDispatch, (n, buffer));
+}
+
+void GLAPIENTRY
+_mesa_marshal_DeleteBuffers(GLsizei n, const GLuint *buffer)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   size_t cmd_size = sizeof(struct marshal_cmd_DeleteBuffers) +
+                     (n > 0 ? n * sizeof(GLuint) : 0);
+   debug_print_marshal("DeleteBuffers");
+
+   if (n >= 0 && buffer)
+      track_vbo_deletion(ctx, n, buffer);
+
+   if (n >= 0 && cmd_size <= MARSHAL_MAX_CMD_SIZE) {
+      struct marshal_cmd_DeleteBuffers *cmd =
+         _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_DeleteBuffers,
+                                         cmd_size);
+      cmd->n = n;
+      if (n > 0)
+         memcpy(cmd + 1, buffer, n * sizeof(GLuint));
+      _mesa_post_marshal_hook(ctx);
+   } else {
+      _mesa_glthread_finish(ctx);
+      CALL_DeleteBuffers(ctx->CurrentServerDispatch, (n, buffer));
+   }
+}
+
+/**
+ * Queries of the buffer bindings tracked by track_vbo_binding() are answered
+ * without syncing.  Not in compatibility contexts, where glPopClientAttrib()
+ * can change the bindings as well.
+ */
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (ctx->API == API_OPENGL_CORE) {
+      switch (pname) {
+      case GL_ARRAY_BUFFER_BINDING:
+         *params = glthread->array_buffer_name;
+         return;
+      case GL_DRAW_INDIRECT_BUFFER_BINDING:
+         if (!_mesa_has_ARB_draw_indirect(ctx))
+            break;
+         *params = glthread->draw_indirect_buffer_name;
+         return;
+      case GL_PIXEL_PACK_BUFFER_BINDING:
+         *params = glthread->pixel_pack_buffer_name;
+         return;
+      case GL_PIXEL_UNPACK_BUFFER_BINDING:
+         *params = glthread->pixel_unpack_buffer_name;
+         return;
+      }
+   }
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync("GetIntegerv");
+   CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+/**
+ * Return a copy of the data of a buffer upload that doesn't fit into a
+ * batch, so that it can still be queued instead of syncing.  The unmarshal
+ * function frees it.
+ */
+static void *
+copy_large_upload(const void *data, size_t size)
+{
+   void *copy = malloc(size);
+
+   if (copy)
+      memcpy(copy, data, size);
+   return copy;
+}
+
 /* BufferData: marshalled asynchronously */
 struct marshal_cmd_BufferData
 {
@@ -296,6 +431,7 @@ struct marshal_cmd_BufferData
    GLsizeiptr size;
    GLenum usage;
    bool data_null; /* If set, no data follows for "data" */
+   void *heap_data; /* If set, holds the data instead, see copy_large_upload() */
    /* Next size bytes are GLubyte data[size] */
 };
 
@@ -310,10 +446,13 @@ _mesa_unmarshal_BufferData(struct gl_context *ctx,
 
    if (cmd->data_null)
       data = NULL;
+   else if (cmd->heap_data)
+      data = cmd->heap_data;
    else
       data = (const void *) (cmd + 1);
 
    CALL_BufferData(ctx->CurrentServerDispatch, (target, size, data, usage));
+   free(cmd->heap_data);
 }
 
 void GLAPIENTRY
@@ -331,6 +470,14 @@ _mesa_marshal_BufferData(GLenum target, GLsizeiptr size, const GLvoid * data,
       return;
    }
 
+   void *heap_data = NULL;
+   if (target != GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD &&
+       cmd_size > MARSHAL_MAX_CMD_SIZE) {
+      heap_data = copy_large_upload(data, size);
+      if (heap_data)
+         cmd_size = sizeof(struct marshal_cmd_BufferData);
+   }
+
    if (target != GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD &&
        cmd_size <= MARSHAL_MAX_CMD_SIZE) {
       struct marshal_cmd_BufferData *cmd =
@@ -341,7 +488,8 @@ _mesa_marshal_BufferData(GLenum target, GLsizeiptr size, const GLvoid * data,
       cmd->size = size;
       cmd->usage = usage;
       cmd->data_null = !data;
-      if (data) {
+      cmd->heap_data = heap_data;
+      if (data && !heap_data) {
          char *variable_data = (char *) (cmd + 1);
          memcpy(variable_data, data, size);
       }
@@ -360,6 +508,7 @@ struct marshal_cmd_BufferSubData
    GLenum target;
    GLintptr offset;
    GLsizeiptr size;
+   void *heap_data; /* If set, holds the data instead, see copy_large_upload() */
    /* Next size bytes are GLubyte data[size] */
 };
 
@@ -370,10 +519,11 @@ _mesa_unmarshal_BufferSubData(struct gl_context *ctx,
    const GLenum target = cmd->target;
    const GLintptr offset = cmd->offset;
    const GLsizeiptr size = cmd->size;
-   const void *data = (const void *) (cmd + 1);
+   const void *data = cmd->heap_data ? cmd->heap_data : (const void *) (cmd + 1);
 
    CALL_BufferSubData(ctx->CurrentServerDispatch,
                       (target, offset, size, data));
+   free(cmd->heap_data);
 }
 
 void GLAPIENTRY
@@ -390,6 +540,14 @@ _mesa_marshal_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
       return;
    }
 
+   void *heap_data = NULL;
+   if (target != GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD &&
+       data && cmd_size > MARSHAL_MAX_CMD_SIZE) {
+      heap_data = copy_large_upload(data, size);
+      if (heap_data)
+         cmd_size = sizeof(struct marshal_cmd_BufferSubData);
+   }
+
    if (target != GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD &&
        cmd_size <= MARSHAL_MAX_CMD_SIZE) {
       struct marshal_cmd_BufferSubData *cmd =
@@ -398,8 +556,11 @@ _mesa_marshal_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
       cmd->target = target;
       cmd->offset = offset;
       cmd->size = size;
-      char *variable_data = (char *) (cmd + 1);
-      memcpy(variable_data, data, size);
+      cmd->heap_data = heap_data;
+      if (!heap_data) {
+         char *variable_data = (char *) (cmd + 1);
+         memcpy(variable_data, data, size);
+      }
       _mesa_post_marshal_hook(ctx);
    } else {
       _mesa_glthread_finish(ctx);
@@ -416,6 +577,7 @@ struct marshal_cmd_NamedBufferData
    GLsizei size;
    GLenum usage;
    bool data_null; /* If set, no data follows for "data" */
+   void *heap_data; /* If set, holds the data instead, see copy_large_upload() */
    /* Next size bytes are GLubyte data[size] */
 };
 
@@ -430,11 +592,14 @@ _mesa_unmarshal_NamedBufferData(struct gl_context *ctx,
 
    if (cmd->data_null)
       data = NULL;
+   else if (cmd->heap_data)
+      data = cmd->heap_data;
    else
       data = (const void *) (cmd + 1);
 
    CALL_NamedBufferData(ctx->CurrentServerDispatch,
                         (name, size, data, usage));
+   free(cmd->heap_data);
 }
 
 void GLAPIENTRY
@@ -451,6 +616,13 @@ _mesa_marshal_NamedBufferData(GLuint buffer, GLsizeiptr size,
       return;
    }
 
+   void *heap_data = NULL;
+   if (buffer > 0 && cmd_size > MARSHAL_MAX_CMD_SIZE) {
+      heap_data = copy_large_upload(data, size);
+      if (heap_data)
+         cmd_size = sizeof(struct marshal_cmd_NamedBufferData);
+   }
+
    if (buffer > 0 && cmd_size <= MARSHAL_MAX_CMD_SIZE) {
       struct marshal_cmd_NamedBufferData *cmd =
          _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_NamedBufferData,
@@ -459,7 +631,8 @@ _mesa_marshal_NamedBufferData(GLuint buffer, GLsizeiptr size,
       cmd->size = size;
       cmd->usage = usage;
       cmd->data_null = !data;
-      if (data) {
+      cmd->heap_data = heap_data;
+      if (data && !heap_data) {
          char *variable_data = (char *) (cmd + 1);
          memcpy(variable_data, data, size);
       }
@@ -478,6 +651,7 @@ struct marshal_cmd_NamedBufferSubData
    GLuint name;
    GLintptr offset;
    GLsizei size;
+   void *heap_data; /* If set, holds the data instead, see copy_large_upload() */
    /* Next size bytes are GLubyte data[size] */
 };
 
@@ -488,10 +662,11 @@ _mesa_unmarshal_NamedBufferSubData(struct gl_context *ctx,
    const GLuint name = cmd->name;
    const GLintptr offset = cmd->offset;
    const GLsizei size = cmd->size;
-   const void *data = (const void *) (cmd + 1);
+   const void *data = cmd->heap_data ? cmd->heap_data : (const void *) (cmd + 1);
 
    CALL_NamedBufferSubData(ctx->CurrentServerDispatch,
                            (name, offset, size, data));
+   free(cmd->heap_data);
 }
 
 void GLAPIENTRY
@@ -508,6 +683,13 @@ _mesa_marshal_NamedBufferSubData(GLuint buffer, GLintptr offset,
       return;
    }
 
+   void *heap_data = NULL;
+   if (buffer > 0 && data && cmd_size > MARSHAL_MAX_CMD_SIZE) {
+      heap_data = copy_large_upload(data, size);
+      if (heap_data)
+         cmd_size = sizeof(struct marshal_cmd_NamedBufferSubData);
+   }
+
    if (buffer > 0 && cmd_size <= MARSHAL_MAX_CMD_SIZE) {
       struct marshal_cmd_NamedBufferSubData *cmd =
          _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_NamedBufferSubData,
@@ -515,8 +697,11 @@ _mesa_marshal_NamedBufferSubData(GLuint buffer, GLintptr offset,
       cmd->name = buffer;
       cmd->offset = offset;
       cmd->size = size;
-      char *variable_data = (char *) (cmd + 1);
-      memcpy(variable_data, data, size);
+      cmd->heap_data = heap_data;
+      if (!heap_data) {
+         char *variable_data = (char *) (cmd + 1);
+         memcpy(variable_data, data, size);
+      }
       _mesa_post_marshal_hook(ctx);
    } else {
       _mesa_glthread_finish(ctx);
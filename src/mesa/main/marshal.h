@@ -57,7 +57,7 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
    struct marshal_cmd_base *cmd_base;
    const size_t aligned_size = ALIGN(size, 8);
 
-   if (unlikely(next->used + size > MARSHAL_MAX_CMD_SIZE)) {
+   if (unlikely(next->used + size > glthread->batch_size)) {
       _mesa_glthread_flush_batch(ctx);
       next = &glthread->batches[glthread->next];
    }
@@ -178,6 +178,7 @@ struct marshal_cmd_Enable;
 struct marshal_cmd_ShaderSource;
 struct marshal_cmd_Flush;
 struct marshal_cmd_BindBuffer;
+struct marshal_cmd_DeleteBuffers;
 struct marshal_cmd_BufferData;
 struct marshal_cmd_BufferSubData;
 struct marshal_cmd_NamedBufferData;
@@ -217,6 +218,16 @@ void
 _mesa_unmarshal_BindBuffer(struct gl_context *ctx,
                            const struct marshal_cmd_BindBuffer *cmd);
 
+void GLAPIENTRY
+_mesa_marshal_DeleteBuffers(GLsizei n, const GLuint *buffer);
+
+void
+_mesa_unmarshal_DeleteBuffers(struct gl_context *ctx,
+                              const struct marshal_cmd_DeleteBuffers *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params);
+
 void
 _mesa_unmarshal_BufferData(struct gl_context *ctx,
                            const struct marshal_cmd_BufferData *cmd);
@@ -1568,6 +1568,15 @@ struct gl_vertex_array_object
    /** Mask of VERT_BIT_* values indicating changed/dirty arrays */
    GLbitfield NewArrays;
 
+   /**
+    * Identifies the current contents of the VAO.
+    *
+    * A new value, unique among all VAOs, is assigned whenever the derived
+    * arrays are updated, so drivers can cache state derived from the VAO
+    * under it.
+    */
+   unsigned _Stamp;
+
    /** The index buffer (also known as the element array buffer in OpenGL). */
    struct gl_buffer_object *IndexBufferObj;
 };
@@ -3093,6 +3102,7 @@ struct gl_shader_program
 #define GLSL_DUMP_ON_ERROR 0x80 /**< Dump shaders to stderr on compile error */
 #define GLSL_CACHE_INFO 0x100 /**< Print debug information about shader cache */
 #define GLSL_CACHE_FALLBACK 0x200 /**< Force shader cache fallback paths */
+#define GLSL_PARALLEL_LINK 0x400 /**< Link the stages of programs in parallel */
 
 
 /**
@@ -3193,6 +3203,13 @@ struct gl_shader_compiler_options
    /** Clamp UBO and SSBO block indices so they don't go out-of-bounds. */
    GLboolean ClampBlockIndicesToArrayBounds;
 
+   /**
+    * Don't run the GLSL IR optimization loop when compiling a shader.  The
+    * linker still runs the optimizations it needs to eliminate dead varyings
+    * and uniforms, anything beyond that is left to the NIR compiler.
+    */
+   GLboolean SkipCompileTimeOptimizations;
+
    const struct nir_shader_compiler_options *NirOptions;
 };
 
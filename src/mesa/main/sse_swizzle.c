@@ -0,0 +1,100 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "main/sse_swizzle.h"
+#include "main/formats.h"
+#include <smmintrin.h>
+#include <string.h>
+
+/**
+ * Swizzle \p count pixels of 1 to 4 unsigned byte channels into 4 channel
+ * unsigned byte pixels, as _mesa_swizzle_and_convert does, 4 pixels at a
+ * time with PSHUFB.  This covers the common texture uploads that expand
+ * or reorder 8-bit channels: RGB to RGBA, BGRA to RGBA, luminance to RGBA...
+ *
+ * \return false if the swizzle reads a channel missing in the source, in
+ *         which case nothing was converted.
+ */
+bool
+_mesa_swizzle_ubyte_to_rgba(uint8_t *dst, const uint8_t *src,
+                            int num_src_channels, const uint8_t swizzle[4],
+                            bool normalized, int count)
+{
+   const uint8_t one = normalized ? UINT8_MAX : 1;
+   uint8_t shuffle[16], ones[16];
+   int i, c;
+
+   for (c = 0; c < 4; c++) {
+      if (swizzle[c] <= MESA_FORMAT_SWIZZLE_W &&
+          swizzle[c] >= num_src_channels)
+         return false;
+   }
+
+   /* Bytes with the top bit set in the PSHUFB control are zeroed and then
+    * or'ed with the constant channels.
+    */
+   for (i = 0; i < 4; i++) {
+      for (c = 0; c < 4; c++) {
+         if (swizzle[c] <= MESA_FORMAT_SWIZZLE_W) {
+            shuffle[i * 4 + c] = i * num_src_channels + swizzle[c];
+            ones[i * 4 + c] = 0;
+         } else {
+            shuffle[i * 4 + c] = 0x80;
+            ones[i * 4 + c] = swizzle[c] == MESA_FORMAT_SWIZZLE_ONE ? one : 0;
+         }
+      }
+   }
+
+   const __m128i shuffle_mask = _mm_loadu_si128((const __m128i *) shuffle);
+   const __m128i ones_mask = _mm_loadu_si128((const __m128i *) ones);
+
+   /* Each iteration loads 16 source bytes, so stop before reading past the
+    * end of the source.
+    */
+   const int src_size = count * num_src_channels;
+
+   for (i = 0; i + 4 <= count && i * num_src_channels + 16 <= src_size;
+        i += 4) {
+      __m128i pixels =
+         _mm_loadu_si128((const __m128i *) (src + i * num_src_channels));
+
+      pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle_mask),
+                            ones_mask);
+      _mm_storeu_si128((__m128i *) (dst + i * 4), pixels);
+   }
+
+   /* The remaining pixels, copied first in case of in-place conversion. */
+   for (; i < count; i++) {
+      uint8_t pixel[4];
+
+      memcpy(pixel, src + i * num_src_channels, num_src_channels);
+      for (c = 0; c < 4; c++) {
+         if (swizzle[c] <= MESA_FORMAT_SWIZZLE_W)
+            dst[i * 4 + c] = pixel[swizzle[c]];
+         else
+            dst[i * 4 + c] = ones[c];
+      }
+   }
+
+   return true;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name format_utils.cpp
+ *
+ * Check the unsigned byte swizzles of _mesa_swizzle_and_convert, which may
+ * use SIMD code, against a plain per pixel implementation.
+ */
+
+#include <gtest/gtest.h>
+
+#include "main/cpuinfo.h"
+#include "main/format_utils.h"
+
+static const uint8_t swizzles[][4] = {
+   { 0, 1, 2, 3 }, /* identity */
+   { 2, 1, 0, 3 }, /* BGRA <-> RGBA */
+   { 3, 2, 1, 0 }, /* ABGR */
+   { 0, 1, 2, MESA_FORMAT_SWIZZLE_ONE }, /* RGB -> RGBA */
+   { 2, 1, 0, MESA_FORMAT_SWIZZLE_ONE }, /* BGR -> RGBA */
+   { 0, 0, 0, MESA_FORMAT_SWIZZLE_ONE }, /* luminance */
+   { 0, 0, 0, 1 }, /* luminance alpha */
+   { 0, MESA_FORMAT_SWIZZLE_ZERO, MESA_FORMAT_SWIZZLE_ZERO,
+     MESA_FORMAT_SWIZZLE_ONE }, /* red */
+};
+
+class SwizzleUbyteTest : public ::testing::Test {
+protected:
+   virtual void SetUp()
+   {
+      _mesa_get_cpu_features();
+
+      for (unsigned i = 0; i < sizeof(src); i++)
+         src[i] = i * 7 + 3;
+   }
+
+   void reference(uint8_t *dst, int num_src_channels,
+                  const uint8_t swizzle[4], bool normalized, int count)
+   {
+      for (int i = 0; i < count; i++) {
+         for (int c = 0; c < 4; c++) {
+            if (swizzle[c] == MESA_FORMAT_SWIZZLE_ZERO)
+               dst[i * 4 + c] = 0;
+            else if (swizzle[c] == MESA_FORMAT_SWIZZLE_ONE)
+               dst[i * 4 + c] = normalized ? 0xff : 1;
+            else
+               dst[i * 4 + c] = src[i * num_src_channels + swizzle[c]];
+         }
+      }
+   }
+
+   uint8_t src[4 * 67];
+};
+
+TEST_F(SwizzleUbyteTest, ToRGBA)
+{
+   for (int num_src_channels = 1; num_src_channels <= 4; num_src_channels++) {
+      for (unsigned s = 0; s < ARRAY_SIZE(swizzles); s++) {
+         bool valid = true;
+         for (int c = 0; c < 4; c++) {
+            if (swizzles[s][c] <= MESA_FORMAT_SWIZZLE_W &&
+                swizzles[s][c] >= num_src_channels)
+               valid = false;
+         }
+         if (!valid)
+            continue;
+
+         for (int count = 0; count <= 67; count++) {
+            for (int normalized = 0; normalized <= 1; normalized++) {
+               uint8_t expected[4 * 67 + 1], dst[4 * 67 + 1];
+
+               SCOPED_TRACE(testing::Message() << num_src_channels
+                            << " channels, swizzle " << s
+                            << ", count " << count);
+
+               memset(dst, 0xa5, sizeof(dst));
+               reference(expected, num_src_channels, swizzles[s],
+                         normalized, count);
+               _mesa_swizzle_and_convert(dst, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                                         4, src, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                                         num_src_channels, swizzles[s],
+                                         normalized, count);
+
+               EXPECT_EQ(0, memcmp(dst, expected, count * 4));
+               /* Nothing is written past the last pixel. */
+               EXPECT_EQ(0xa5, dst[count * 4]);
+            }
+         }
+      }
+   }
+}
+
+TEST_F(SwizzleUbyteTest, InPlace)
+{
+   uint8_t expected[4 * 67], dst[4 * 67];
+
+   reference(expected, 4, swizzles[1], true, 67);
+   memcpy(dst, src, sizeof(dst));
+   _mesa_swizzle_and_convert(dst, MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+                             dst, MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+                             swizzles[1], true, 67);
+
+   EXPECT_EQ(0, memcmp(dst, expected, sizeof(dst)));
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Microbenchmark of the unsigned byte swizzles of _mesa_swizzle_and_convert
+ * done by texture uploads, with and without the SIMD code paths.
+ *
+ * Usage: swizzle_and_convert_bench [WIDTH [ROWS]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "main/cpuinfo.h"
+#include "main/format_utils.h"
+#include "util/os_time.h"
+
+static const struct {
+   const char *name;
+   int num_src_channels;
+   uint8_t swizzle[4];
+} cases[] = {
+   { "RGB8 -> RGBA8", 3, { 0, 1, 2, MESA_FORMAT_SWIZZLE_ONE } },
+   { "BGRA8 -> RGBA8", 4, { 2, 1, 0, 3 } },
+   { "L8 -> RGBA8", 1, { 0, 0, 0, MESA_FORMAT_SWIZZLE_ONE } },
+   { "LA8 -> RGBA8", 2, { 0, 0, 0, 1 } },
+};
+
+static double
+run(const uint8_t *src, uint8_t *dst, int num_src_channels,
+    const uint8_t swizzle[4], int width, int rows)
+{
+   int64_t t = os_time_get_nano();
+
+   for (int y = 0; y < rows; y++) {
+      _mesa_swizzle_and_convert(dst, MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+                                src + y * width * num_src_channels,
+                                MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                                num_src_channels, swizzle, true, width);
+   }
+
+   /* Megapixels per second. */
+   return (double) width * rows / ((os_time_get_nano() - t) / 1000.0);
+}
+
+int
+main(int argc, char **argv)
+{
+   int width = argc > 1 ? atoi(argv[1]) : 4096;
+   int rows = argc > 2 ? atoi(argv[2]) : 4096;
+   uint8_t *src = malloc((size_t) width * rows * 4);
+   uint8_t *dst = malloc((size_t) width * 4);
+
+   if (!src || !dst)
+      return 1;
+
+   for (size_t i = 0; i < (size_t) width * rows * 4; i++)
+      src[i] = i;
+
+   _mesa_get_cpu_features();
+
+   printf("%-16s %12s %12s\n", "conversion", "default", "generic");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(cases); i++) {
+      double simd, generic;
+
+      simd = run(src, dst, cases[i].num_src_channels, cases[i].swizzle,
+                 width, rows);
+
+#if defined(USE_X86_ASM) || defined(USE_X86_64_ASM)
+      /* Disable the CPU specific code paths. */
+      int features = _mesa_x86_cpu_features;
+      _mesa_x86_cpu_features = 0;
+#endif
+      generic = run(src, dst, cases[i].num_src_channels, cases[i].swizzle,
+                    width, rows);
+#if defined(USE_X86_ASM) || defined(USE_X86_64_ASM)
+      _mesa_x86_cpu_features = features;
+#endif
+
+      printf("%-16s %9.1f MP/s %9.1f MP/s\n", cases[i].name, simd, generic);
+   }
+
+   free(src);
+   free(dst);
+   return 0;
+}
@@ -1035,39 +1035,73 @@ _mesa_flush_vertices_for_uniforms(struct gl_context *ctx,
    ctx->NewDriverState |= new_driver_state;
 }
 
-static void
+/**
+ * Store the new values of a uniform, unless they are the same as the ones
+ * already there.  If \p flush is set, vertices are flushed before the
+ * storage is changed.
+ *
+ * \return whether the values changed.
+ */
+static bool
 copy_uniforms_to_storage(gl_constant_value *storage,
                          struct gl_uniform_storage *uni,
                          struct gl_context *ctx, GLsizei count,
                          const GLvoid *values, const int size_mul,
                          const unsigned offset, const unsigned components,
-                         enum glsl_base_type basicType)
+                         enum glsl_base_type basicType, bool flush)
 {
    if (!uni->type->is_boolean() && !uni->is_bindless) {
-      memcpy(storage, values,
-             sizeof(storage[0]) * components * count * size_mul);
+      const unsigned size =
+         sizeof(storage[0]) * components * count * size_mul;
+
+      if (!memcmp(storage, values, size))
+         return false;
+
+      if (flush)
+         _mesa_flush_vertices_for_uniforms(ctx, uni);
+
+      memcpy(storage, values, size);
+      return true;
    } else if (uni->is_bindless) {
       const union gl_constant_value *src =
          (const union gl_constant_value *) values;
       GLuint64 *dst = (GLuint64 *)&storage->i;
       const unsigned elems = components * count;
+      bool changed = false;
 
       for (unsigned i = 0; i < elems; i++) {
-         dst[i] = src[i].i;
+         if (dst[i] != (GLuint64) src[i].i) {
+            if (flush && !changed)
+               _mesa_flush_vertices_for_uniforms(ctx, uni);
+            dst[i] = src[i].i;
+            changed = true;
+         }
       }
+      return changed;
    } else {
       const union gl_constant_value *src =
          (const union gl_constant_value *) values;
       union gl_constant_value *dst = storage;
       const unsigned elems = components * count;
+      bool changed = false;
 
       for (unsigned i = 0; i < elems; i++) {
+         int value;
+
          if (basicType == GLSL_TYPE_FLOAT) {
-            dst[i].i = src[i].f != 0.0f ? ctx->Const.UniformBooleanTrue : 0;
+            value = src[i].f != 0.0f ? ctx->Const.UniformBooleanTrue : 0;
          } else {
-            dst[i].i = src[i].i != 0    ? ctx->Const.UniformBooleanTrue : 0;
+            value = src[i].i != 0    ? ctx->Const.UniformBooleanTrue : 0;
+         }
+
+         if (dst[i].i != value) {
+            if (flush && !changed)
+               _mesa_flush_vertices_for_uniforms(ctx, uni);
+            dst[i].i = value;
+            changed = true;
          }
       }
+      return changed;
    }
 }
 
@@ -1126,11 +1160,13 @@ _mesa_uniform(GLint location, GLsizei count, const GLvoid *values,
    }
 
    /* We check samplers for changes and flush if needed in the sampler
-    * handling code further down, so just skip them here.
+    * handling code further down, so just skip them here.  Other uniforms
+    * are only flushed when their values actually change, which avoids
+    * re-uploading the constants of applications that set the same values
+    * again and again.
     */
-   if (!uni->type->is_sampler()) {
-       _mesa_flush_vertices_for_uniforms(ctx, uni);
-   }
+   bool flush = !uni->type->is_sampler();
+   bool changed = false;
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
@@ -1141,17 +1177,26 @@ _mesa_uniform(GLint location, GLsizei count, const GLvoid *values,
          storage = (gl_constant_value *)
             uni->driver_storage[s].data + (size_mul * offset * components);
 
-         copy_uniforms_to_storage(storage, uni, ctx, count, values, size_mul,
-                                  offset, components, basicType);
+         if (copy_uniforms_to_storage(storage, uni, ctx, count, values,
+                                      size_mul, offset, components, basicType,
+                                      flush && !changed))
+            changed = true;
       }
    } else {
       storage = &uni->storage[size_mul * components * offset];
-      copy_uniforms_to_storage(storage, uni, ctx, count, values, size_mul,
-                               offset, components, basicType);
-
-      _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+      if (copy_uniforms_to_storage(storage, uni, ctx, count, values, size_mul,
+                                   offset, components, basicType, flush)) {
+         changed = true;
+         _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+      }
    }
 
+   /* Opaque uniforms with unchanged values still need the handling below,
+    * e.g. to mark bindless handles as bound.
+    */
+   if (!changed && !uni->type->contains_opaque())
+      return;
+
    /* If the uniform is a sampler, do the extra magic necessary to propagate
     * the changes through.
     */
@@ -1241,21 +1286,42 @@ _mesa_uniform(GLint location, GLsizei count, const GLvoid *values,
 }
 
 
-static void
-copy_uniform_matrix_to_storage(gl_constant_value *storage,
+/**
+ * Like copy_uniforms_to_storage(), for matrices.  Transposed matrices are
+ * always stored.
+ *
+ * \return whether the values may have changed.
+ */
+static bool
+copy_uniform_matrix_to_storage(struct gl_context *ctx,
+                               struct gl_uniform_storage *uni,
+                               gl_constant_value *storage,
                                GLsizei count, const void *values,
                                const unsigned size_mul, const unsigned offset,
                                const unsigned components,
                                const unsigned vectors, bool transpose,
                                unsigned cols, unsigned rows,
-                               enum glsl_base_type basicType)
+                               enum glsl_base_type basicType, bool flush)
 {
    const unsigned elements = components * vectors;
 
    if (!transpose) {
-      memcpy(storage, values,
-             sizeof(storage[0]) * elements * count * size_mul);
-   } else if (basicType == GLSL_TYPE_FLOAT) {
+      const unsigned size = sizeof(storage[0]) * elements * count * size_mul;
+
+      if (!memcmp(storage, values, size))
+         return false;
+
+      if (flush)
+         _mesa_flush_vertices_for_uniforms(ctx, uni);
+
+      memcpy(storage, values, size);
+      return true;
+   }
+
+   if (flush)
+      _mesa_flush_vertices_for_uniforms(ctx, uni);
+
+   if (basicType == GLSL_TYPE_FLOAT) {
       /* Copy and transpose the matrix.
        */
       const float *src = (const float *)values;
@@ -1287,6 +1353,8 @@ copy_uniform_matrix_to_storage(gl_constant_value *storage,
          src += elements;
       }
    }
+
+   return true;
 }
 
 
@@ -1385,28 +1453,31 @@ _mesa_uniform_matrix(GLint location, GLsizei count,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
-   _mesa_flush_vertices_for_uniforms(ctx, uni);
-
    /* Store the data in the "actual type" backing storage for the uniform.
+    * Vertices are only flushed if the values change.
     */
    gl_constant_value *storage;
    const unsigned elements = components * vectors;
    if (ctx->Const.PackedDriverUniformStorage) {
+      bool flushed = false;
+
       for (unsigned s = 0; s < uni->num_driver_storage; s++) {
          storage = (gl_constant_value *)
             uni->driver_storage[s].data + (size_mul * offset * elements);
 
-         copy_uniform_matrix_to_storage(storage, count, values, size_mul,
-                                        offset, components, vectors,
-                                        transpose, cols, rows, basicType);
+         if (copy_uniform_matrix_to_storage(ctx, uni, storage, count, values,
+                                            size_mul, offset, components,
+                                            vectors, transpose, cols, rows,
+                                            basicType, !flushed))
+            flushed = true;
       }
    } else {
       storage =  &uni->storage[size_mul * elements * offset];
-      copy_uniform_matrix_to_storage(storage, count, values, size_mul, offset,
-                                     components, vectors, transpose, cols,
-                                     rows, basicType);
-
-      _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+      if (copy_uniform_matrix_to_storage(ctx, uni, storage, count, values,
+                                         size_mul, offset, components,
+                                         vectors, transpose, cols, rows,
+                                         basicType, true))
+         _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
    }
 }
 
@@ -383,6 +383,66 @@ set_vertex_attribs(struct st_context *st,
    cso_set_vertex_elements(cso, num_velements, velements);
 }
 
+/**
+ * Set the vertex buffer for the given binding.
+ *
+ * Return false if the buffer has no storage.
+ */
+static bool
+setup_vbuffer(struct st_context *st,
+              const struct gl_vertex_buffer_binding *binding,
+              struct pipe_vertex_buffer *vbuffer)
+{
+   if (_mesa_is_bufferobj(binding->BufferObj)) {
+      struct st_buffer_object *stobj = st_buffer_object(binding->BufferObj);
+      if (!stobj || !stobj->buffer)
+         return false; /* out-of-memory error probably */
+
+      /* Set the binding */
+      vbuffer->buffer.resource = stobj->buffer;
+      vbuffer->is_user_buffer = false;
+      vbuffer->buffer_offset = _mesa_draw_binding_offset(binding);
+   } else {
+      /* Set the binding */
+      const void *ptr = (const void *)_mesa_draw_binding_offset(binding);
+      vbuffer->buffer.user = ptr;
+      vbuffer->is_user_buffer = true;
+      vbuffer->buffer_offset = 0;
+
+      if (!binding->InstanceDivisor)
+         st->draw_needs_minmax_index = true;
+   }
+   vbuffer->stride = binding->Stride; /* in bytes */
+   return true;
+}
+
+/**
+ * Look up the array setup of the current VAO and vertex program variant in
+ * st_context::array_cache.
+ *
+ * The vertex elements only depend on the VAO contents, which are identified
+ * by gl_vertex_array_object::_Stamp, on the enabled arrays and on the
+ * variant, so switching between a few VAOs doesn't derive them again.
+ */
+static struct st_array_cache_entry *
+find_array_cache_entry(struct st_context *st,
+                       const struct st_vp_variant *vp_variant)
+{
+   const struct gl_context *ctx = st->ctx;
+   const unsigned vao_stamp = ctx->Array._DrawVAO->_Stamp;
+   const GLbitfield enabled = ctx->Array._DrawVAOEnabledAttribs;
+
+   for (unsigned i = 0; i < NUM_ARRAY_CACHE_ENTRIES; i++) {
+      struct st_array_cache_entry *entry = &st->array_cache.entries[i];
+
+      if (entry->vao_stamp == vao_stamp &&
+          entry->vp_variant_id == vp_variant->id &&
+          entry->enabled == enabled)
+         return entry;
+   }
+   return NULL;
+}
+
 void
 st_setup_arrays(struct st_context *st,
                 const struct st_vertex_program *vp,
@@ -395,6 +455,30 @@ st_setup_arrays(struct st_context *st,
    const GLbitfield inputs_read = vp_variant->vert_attrib_mask;
    const ubyte *input_to_index = vp->input_to_index;
 
+   /* The cached vertex elements refer to the vertex buffers by index. */
+   assert(*num_vbuffers == 0);
+
+   struct st_array_cache_entry *entry = find_array_cache_entry(st, vp_variant);
+   if (entry) {
+      memcpy(velements, entry->velements,
+             vp_variant->num_inputs * sizeof(*velements));
+
+      for (unsigned i = 0; i < entry->num_vbuffers; i++) {
+         const struct gl_vertex_buffer_binding *const binding
+            = _mesa_draw_buffer_binding(vao, entry->vbuffer_attrib[i]);
+
+         if (!setup_vbuffer(st, binding, &vbuffer[i])) {
+            st->vertex_array_out_of_memory = true;
+            return;
+         }
+      }
+      *num_vbuffers = entry->num_vbuffers;
+      return;
+   }
+
+   entry = &st->array_cache.entries[st->array_cache.next];
+   entry->vao_stamp = 0;
+
    /* Process attribute array data. */
    GLbitfield mask = inputs_read & _mesa_draw_array_bits(ctx);
    while (mask) {
@@ -404,28 +488,11 @@ st_setup_arrays(struct st_context *st,
          = _mesa_draw_buffer_binding(vao, i);
       const unsigned bufidx = (*num_vbuffers)++;
 
-      if (_mesa_is_bufferobj(binding->BufferObj)) {
-         struct st_buffer_object *stobj = st_buffer_object(binding->BufferObj);
-         if (!stobj || !stobj->buffer) {
-            st->vertex_array_out_of_memory = true;
-            return; /* out-of-memory error probably */
-         }
-
-         /* Set the binding */
-         vbuffer[bufidx].buffer.resource = stobj->buffer;
-         vbuffer[bufidx].is_user_buffer = false;
-         vbuffer[bufidx].buffer_offset = _mesa_draw_binding_offset(binding);
-      } else {
-         /* Set the binding */
-         const void *ptr = (const void *)_mesa_draw_binding_offset(binding);
-         vbuffer[bufidx].buffer.user = ptr;
-         vbuffer[bufidx].is_user_buffer = true;
-         vbuffer[bufidx].buffer_offset = 0;
-
-         if (!binding->InstanceDivisor)
-            st->draw_needs_minmax_index = true;
+      if (!setup_vbuffer(st, binding, &vbuffer[bufidx])) {
+         st->vertex_array_out_of_memory = true;
+         return;
       }
-      vbuffer[bufidx].stride = binding->Stride; /* in bytes */
+      entry->vbuffer_attrib[bufidx] = i;
 
       const GLbitfield boundmask = _mesa_draw_bound_attrib_bits(binding);
       GLbitfield attrmask = mask & boundmask;
@@ -444,6 +511,17 @@ st_setup_arrays(struct st_context *st,
                                input_to_index[attr]);
       }
    }
+
+   /* The velements of the current attributes are filled in afterwards, and
+    * may be left undefined in the cached copy.
+    */
+   memcpy(entry->velements, velements,
+          vp_variant->num_inputs * sizeof(*velements));
+   entry->num_vbuffers = *num_vbuffers;
+   entry->vao_stamp = vao->_Stamp;
+   entry->vp_variant_id = vp_variant->id;
+   entry->enabled = ctx->Array._DrawVAOEnabledAttribs;
+   st->array_cache.next = (st->array_cache.next + 1) % NUM_ARRAY_CACHE_ENTRIES;
 }
 
 void
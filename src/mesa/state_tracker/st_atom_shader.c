@@ -110,6 +110,7 @@ st_update_fp( struct st_context *st )
        stfp->variants &&
        !stfp->variants->key.drawpixels &&
        !stfp->variants->key.bitmap) {
+      util_queue_fence_wait(&stfp->variants->fence);
       shader = stfp->variants->driver_shader;
    } else {
       struct st_fp_variant_key key;
@@ -170,6 +171,7 @@ st_update_vp( struct st_context *st )
        stvp->variants &&
        stvp->variants->key.passthrough_edgeflags == st->vertdata_edgeflags) {
       st->vp_variant = stvp->variants;
+      util_queue_fence_wait(&st->vp_variant->fence);
    } else {
       struct st_vp_variant_key key;
 
@@ -217,8 +219,10 @@ st_update_common_program(struct st_context *st, struct gl_program *prog,
    stp = st_common_program(prog);
    st_reference_prog(st, dst, stp);
 
-   if (st->shader_has_one_variant[prog->info.stage] && stp->variants)
+   if (st->shader_has_one_variant[prog->info.stage] && stp->variants) {
+      util_queue_fence_wait(&stp->variants->fence);
       return stp->variants->driver_shader;
+   }
 
    return st_get_basic_variant(st, pipe_shader, stp)->driver_shader;
 }
@@ -271,6 +275,7 @@ st_update_cp( struct st_context *st )
    void *shader;
 
    if (st->shader_has_one_variant[MESA_SHADER_COMPUTE] && stcp->variants) {
+      util_queue_fence_wait(&stcp->variants->fence);
       shader = stcp->variants->driver_shader;
    } else {
       shader = st_get_cp_variant(st, &stcp->tgsi,
@@ -96,13 +96,93 @@ st_update_single_texture(struct st_context *st,
 }
 
 
+/**
+ * Whether the sampler view bound to a slot can be used again for the given
+ * texture unit, without looking it up in the texture object.
+ *
+ * This is the case if the unit has the same texture as when the view was
+ * created and the sampler views of the texture haven't been released since,
+ * which happens on every change that affects them, see
+ * st_texture_object::view_stamp.
+ */
+static bool
+reuse_sampler_view(struct st_context *st,
+                   const struct st_sampler_view_source *source,
+                   const struct pipe_sampler_view *view,
+                   GLuint texUnit, bool glsl130_or_later,
+                   bool ignore_srgb_decode)
+{
+   struct gl_context *ctx = st->ctx;
+   struct gl_texture_object *texObj = ctx->Texture.Unit[texUnit]._Current;
+   struct st_texture_object *stObj = st_texture_object(texObj);
+
+   if (!view || source->texObj != texObj ||
+       source->view_stamp != p_atomic_read(&stObj->view_stamp) ||
+       source->glsl130_or_later != glsl130_or_later)
+      return false;
+
+   const bool srgb_skip_decode = !ignore_srgb_decode &&
+      _mesa_get_samplerobj(ctx, texUnit)->sRGBDecode == GL_SKIP_DECODE_EXT;
+   if (source->srgb_skip_decode != srgb_skip_decode)
+      return false;
+
+   /* Validation may reallocate the texture and release its views. */
+   return st_finalize_texture(ctx, st->pipe, texObj, 0) &&
+          view->texture == stObj->pt &&
+          source->view_stamp == p_atomic_read(&stObj->view_stamp);
+}
+
+
+/**
+ * Remember what the sampler view just created for a texture unit was
+ * created for, see reuse_sampler_view().
+ */
+static void
+set_sampler_view_source(struct st_context *st,
+                        struct st_sampler_view_source *source,
+                        GLuint texUnit, bool glsl130_or_later,
+                        bool ignore_srgb_decode)
+{
+   struct gl_context *ctx = st->ctx;
+   const struct gl_texture_object *texObj =
+      ctx->Texture.Unit[texUnit]._Current;
+
+   /* Buffer texture views also depend on the buffer object, and external
+    * textures have to be checked for changes on every use.
+    */
+   if (texObj->Target == GL_TEXTURE_BUFFER ||
+       texObj->TargetIndex == TEXTURE_EXTERNAL_INDEX) {
+      source->texObj = NULL;
+      return;
+   }
+
+   source->texObj = texObj;
+   source->view_stamp =
+      p_atomic_read(&st_texture_object_const(texObj)->view_stamp);
+   source->glsl130_or_later = glsl130_or_later;
+   source->srgb_skip_decode = !ignore_srgb_decode &&
+      _mesa_get_samplerobj(ctx, texUnit)->sRGBDecode == GL_SKIP_DECODE_EXT;
+}
+
 
+/**
+ * Update the sampler views of a shader stage.
+ *
+ * The views are kept in st_context, so that units whose texture didn't
+ * change keep their view without a lookup, and the driver is only called
+ * when a view of the stage actually changed.  Many state changes flag the sampler
+ * views of all stages dirty, e.g. any glBindTexture, while most of them only
+ * affect one stage, if any.
+ */
 static void
 update_textures(struct st_context *st,
                 enum pipe_shader_type shader_stage,
-                const struct gl_program *prog,
-                struct pipe_sampler_view **sampler_views)
+                const struct gl_program *prog)
 {
+   struct pipe_sampler_view **sampler_views =
+      st->state.sampler_views[shader_stage];
+   struct st_sampler_view_source *sources =
+      st->state.sampler_view_sources[shader_stage];
    const GLuint old_max = st->state.num_sampler_views[shader_stage];
    GLbitfield samplers_used = prog->SamplersUsed;
    GLbitfield texel_fetch_samplers = prog->info.textures_used_by_txf;
@@ -114,6 +194,7 @@ update_textures(struct st_context *st,
       return;
 
    unsigned num_textures = 0;
+   bool changed = false;
 
    /* prog->sh.data is NULL if it's ARB_fragment_program */
    bool glsl130 = (prog->sh.data ? prog->sh.data->Version : 0) >= 130;
@@ -153,12 +234,25 @@ update_textures(struct st_context *st,
           * So we simply ignore the setting entirely for samplers that are
           * (statically) accessed with a texelFetch function.
           */
+         if (reuse_sampler_view(st, &sources[unit], sampler_views[unit],
+                                texUnit, glsl130, texel_fetch_samplers & 1)) {
+            num_textures = unit + 1;
+            continue;
+         }
+
          st_update_single_texture(st, &sampler_view, texUnit, glsl130,
                                   texel_fetch_samplers & 1);
+         set_sampler_view_source(st, &sources[unit], texUnit, glsl130,
+                                 texel_fetch_samplers & 1);
          num_textures = unit + 1;
+      } else {
+         sources[unit].texObj = NULL;
       }
 
-      pipe_sampler_view_reference(&(sampler_views[unit]), sampler_view);
+      if (sampler_views[unit] != sampler_view) {
+         changed = true;
+         pipe_sampler_view_reference(&(sampler_views[unit]), sampler_view);
+      }
    }
 
    /* For any external samplers with multiplaner YUV, stuff the additional
@@ -188,18 +282,23 @@ update_textures(struct st_context *st,
          tmpl.format = PIPE_FORMAT_RG88_UNORM;
          tmpl.swizzle_g = PIPE_SWIZZLE_Y;   /* tmpl from Y plane is R8 */
          extra = u_bit_scan(&free_slots);
+         assert(!sampler_views[extra]);
          sampler_views[extra] =
                st->pipe->create_sampler_view(st->pipe, stObj->pt->next, &tmpl);
+         changed = true;
          break;
       case PIPE_FORMAT_IYUV:
          /* we need two additional R8 views: */
          tmpl.format = PIPE_FORMAT_R8_UNORM;
          extra = u_bit_scan(&free_slots);
+         assert(!sampler_views[extra]);
          sampler_views[extra] =
                st->pipe->create_sampler_view(st->pipe, stObj->pt->next, &tmpl);
          extra = u_bit_scan(&free_slots);
+         assert(!sampler_views[extra]);
          sampler_views[extra] =
                st->pipe->create_sampler_view(st->pipe, stObj->pt->next->next, &tmpl);
+         changed = true;
          break;
       default:
          break;
@@ -208,26 +307,18 @@ update_textures(struct st_context *st,
       num_textures = MAX2(num_textures, extra + 1);
    }
 
-   cso_set_sampler_views(st->cso_context,
-                         shader_stage,
-                         num_textures,
-                         sampler_views);
+   changed |= num_textures != old_max;
    st->state.num_sampler_views[shader_stage] = num_textures;
-}
-
-/* Same as update_textures, but don't store the views in st_context. */
-static void
-update_textures_local(struct st_context *st,
-                      enum pipe_shader_type shader_stage,
-                      const struct gl_program *prog)
-{
-   struct pipe_sampler_view *local_views[PIPE_MAX_SAMPLERS] = {0};
-
-   update_textures(st, shader_stage, prog, local_views);
 
-   unsigned num = st->state.num_sampler_views[shader_stage];
-   for (unsigned i = 0; i < num; i++)
-      pipe_sampler_view_reference(&local_views[i], NULL);
+   /* Fragment sampler views are also set by the meta operations through
+    * cso_context, which compares them with its own copy anyway.
+    */
+   if (changed || shader_stage == PIPE_SHADER_FRAGMENT) {
+      cso_set_sampler_views(st->cso_context,
+                            shader_stage,
+                            num_textures,
+                            sampler_views);
+   }
 }
 
 void
@@ -236,8 +327,8 @@ st_update_vertex_textures(struct st_context *st)
    const struct gl_context *ctx = st->ctx;
 
    if (ctx->Const.Program[MESA_SHADER_VERTEX].MaxTextureImageUnits > 0) {
-      update_textures_local(st, PIPE_SHADER_VERTEX,
-                            ctx->VertexProgram._Current);
+      update_textures(st, PIPE_SHADER_VERTEX,
+                      ctx->VertexProgram._Current);
    }
 }
 
@@ -249,8 +340,7 @@ st_update_fragment_textures(struct st_context *st)
 
    update_textures(st,
                    PIPE_SHADER_FRAGMENT,
-                   ctx->FragmentProgram._Current,
-                   st->state.frag_sampler_views);
+                   ctx->FragmentProgram._Current);
 }
 
 
@@ -260,8 +350,8 @@ st_update_geometry_textures(struct st_context *st)
    const struct gl_context *ctx = st->ctx;
 
    if (ctx->GeometryProgram._Current) {
-      update_textures_local(st, PIPE_SHADER_GEOMETRY,
-                            ctx->GeometryProgram._Current);
+      update_textures(st, PIPE_SHADER_GEOMETRY,
+                      ctx->GeometryProgram._Current);
    }
 }
 
@@ -272,8 +362,8 @@ st_update_tessctrl_textures(struct st_context *st)
    const struct gl_context *ctx = st->ctx;
 
    if (ctx->TessCtrlProgram._Current) {
-      update_textures_local(st, PIPE_SHADER_TESS_CTRL,
-                            ctx->TessCtrlProgram._Current);
+      update_textures(st, PIPE_SHADER_TESS_CTRL,
+                      ctx->TessCtrlProgram._Current);
    }
 }
 
@@ -284,8 +374,8 @@ st_update_tesseval_textures(struct st_context *st)
    const struct gl_context *ctx = st->ctx;
 
    if (ctx->TessEvalProgram._Current) {
-      update_textures_local(st, PIPE_SHADER_TESS_EVAL,
-                            ctx->TessEvalProgram._Current);
+      update_textures(st, PIPE_SHADER_TESS_EVAL,
+                      ctx->TessEvalProgram._Current);
    }
 }
 
@@ -296,7 +386,7 @@ st_update_compute_textures(struct st_context *st)
    const struct gl_context *ctx = st->ctx;
 
    if (ctx->ComputeProgram._Current) {
-      update_textures_local(st, PIPE_SHADER_COMPUTE,
-                            ctx->ComputeProgram._Current);
+      update_textures(st, PIPE_SHADER_COMPUTE,
+                      ctx->ComputeProgram._Current);
    }
 }
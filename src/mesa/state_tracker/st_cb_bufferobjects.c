@@ -42,12 +42,14 @@
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
 #include "st_cb_memoryobjects.h"
+#include "st_cb_readpixels.h"
 #include "st_debug.h"
 #include "st_util.h"
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
+#include "cso_cache/cso_context.h"
 
 
 /**
@@ -91,6 +93,20 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
 
 
 
+/**
+ * Called when the contents of the buffer change, so that vertices u_vbuf
+ * translated from it aren't reused.
+ */
+void
+st_bufferobj_changed(struct st_context *st, struct gl_buffer_object *obj)
+{
+   struct st_buffer_object *st_obj = st_buffer_object(obj);
+
+   if (st_obj->buffer)
+      cso_invalidate_vertex_buffer(st->cso_context, st_obj->buffer);
+}
+
+
 /**
  * Replace data in a subrange of buffer object.  If the data range
  * specified by size + offset extends beyond the end of the buffer or
@@ -105,6 +121,9 @@ st_bufferobj_subdata(struct gl_context *ctx,
 {
    struct st_buffer_object *st_obj = st_buffer_object(obj);
 
+   st_flush_readbacks(st_context(ctx));
+   st_bufferobj_changed(st_context(ctx), obj);
+
    /* we may be called from VBO code, so double-check params here */
    assert(offset >= 0);
    assert(size >= 0);
@@ -149,6 +168,8 @@ st_bufferobj_get_subdata(struct gl_context *ctx,
 {
    struct st_buffer_object *st_obj = st_buffer_object(obj);
 
+   st_flush_readbacks(st_context(ctx));
+
    /* we may be called from VBO code, so double-check params here */
    assert(offset >= 0);
    assert(size >= 0);
@@ -284,6 +305,9 @@ bufferobj_data(struct gl_context *ctx,
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    struct st_memory_object *st_mem_obj = st_memory_object(memObj);
 
+   st_flush_readbacks(st);
+   st_bufferobj_changed(st, obj);
+
    if (target != GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD &&
        size && st_obj->buffer &&
        st_obj->Base.Size == size &&
@@ -418,6 +442,8 @@ st_bufferobj_invalidate(struct gl_context *ctx,
    struct pipe_context *pipe = st->pipe;
    struct st_buffer_object *st_obj = st_buffer_object(obj);
 
+   st_flush_readbacks(st);
+
    /* We ignore partial invalidates. */
    if (offset != 0 || size != obj->Size)
       return;
@@ -489,6 +515,10 @@ st_bufferobj_map_range(struct gl_context *ctx,
    struct pipe_context *pipe = st_context(ctx)->pipe;
    struct st_buffer_object *st_obj = st_buffer_object(obj);
 
+   st_flush_readbacks(st_context(ctx));
+   if (access & GL_MAP_WRITE_BIT)
+      st_bufferobj_changed(st_context(ctx), obj);
+
    assert(offset >= 0);
    assert(length >= 0);
    assert(offset < obj->Size);
@@ -579,6 +609,9 @@ st_copy_buffer_subdata(struct gl_context *ctx,
    if (!size)
       return;
 
+   st_flush_readbacks(st_context(ctx));
+   st_bufferobj_changed(st_context(ctx), dst);
+
    /* buffer should not already be mapped */
    assert(!_mesa_check_disallowed_mapping(src));
    assert(!_mesa_check_disallowed_mapping(dst));
@@ -603,6 +636,9 @@ st_clear_buffer_subdata(struct gl_context *ctx,
    struct st_buffer_object *buf = st_buffer_object(bufObj);
    static const char zeros[16] = {0};
 
+   st_flush_readbacks(st_context(ctx));
+   st_bufferobj_changed(st_context(ctx), bufObj);
+
    if (!pipe->clear_buffer) {
       _mesa_ClearBufferSubData_sw(ctx, offset, size,
                                   clearValue, clearValueSize, bufObj);
@@ -55,6 +55,9 @@ st_buffer_object(struct gl_buffer_object *obj)
 }
 
 
+void
+st_bufferobj_changed(struct st_context *st, struct gl_buffer_object *obj);
+
 enum pipe_transfer_usage
 st_access_flags_to_transfer_flags(GLbitfield access, bool wholeBuffer);
 
@@ -31,6 +31,7 @@
 #include "st_cb_bitmap.h"
 #include "st_cb_bufferobjects.h"
 #include "st_cb_compute.h"
+#include "st_cb_readpixels.h"
 #include "st_util.h"
 
 #include "pipe/p_context.h"
@@ -48,7 +49,9 @@ static void st_dispatch_compute_common(struct gl_context *ctx,
    struct pipe_grid_info info = { 0 };
 
    st_flush_bitmap_cache(st);
+   st_flush_readbacks(st);
    st_invalidate_readpix_cache(st);
+   st->may_have_written_buffers = true;
 
    if (ctx->NewState)
       _mesa_update_state(ctx);
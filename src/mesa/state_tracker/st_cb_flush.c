@@ -37,6 +37,7 @@
 #include "st_context.h"
 #include "st_cb_bitmap.h"
 #include "st_cb_flush.h"
+#include "st_cb_readpixels.h"
 #include "st_cb_clear.h"
 #include "st_cb_fbo.h"
 #include "st_context.h"
@@ -54,6 +55,11 @@ st_flush(struct st_context *st,
 {
    st_flush_bitmap_cache(st);
 
+   /* Whatever waits on the flush, be it glFinish, a swap or another context,
+    * must see the pixels of earlier glReadPixels into buffers.
+    */
+   st_flush_readbacks(st);
+
    /* We want to call this function periodically.
     * Typically, it has nothing to do so it shouldn't be expensive.
     */
@@ -282,41 +282,54 @@ st_get_shader_program_completion_status(struct gl_context *ctx,
 {
    struct pipe_screen *screen = st_context(ctx)->pipe->screen;
 
-   if (!screen->is_parallel_shader_compilation_finished)
-      return true;
-
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       struct gl_linked_shader *linked = shprog->_LinkedShaders[i];
-      void *sh = NULL;
+      struct util_queue_fence *fence = NULL;
+      void **sh = NULL;
 
       if (!linked || !linked->Program)
          continue;
 
       switch (i) {
       case MESA_SHADER_VERTEX:
-         if (st_vertex_program(linked->Program)->variants)
-            sh = st_vertex_program(linked->Program)->variants->driver_shader;
+         if (st_vertex_program(linked->Program)->variants) {
+            sh = &st_vertex_program(linked->Program)->variants->driver_shader;
+            fence = &st_vertex_program(linked->Program)->variants->fence;
+         }
          break;
       case MESA_SHADER_FRAGMENT:
-         if (st_fragment_program(linked->Program)->variants)
-            sh = st_fragment_program(linked->Program)->variants->driver_shader;
+         if (st_fragment_program(linked->Program)->variants) {
+            sh = &st_fragment_program(linked->Program)->variants->driver_shader;
+            fence = &st_fragment_program(linked->Program)->variants->fence;
+         }
          break;
       case MESA_SHADER_TESS_CTRL:
       case MESA_SHADER_TESS_EVAL:
       case MESA_SHADER_GEOMETRY:
-         if (st_common_program(linked->Program)->variants)
-            sh = st_common_program(linked->Program)->variants->driver_shader;
+         if (st_common_program(linked->Program)->variants) {
+            sh = &st_common_program(linked->Program)->variants->driver_shader;
+            fence = &st_common_program(linked->Program)->variants->fence;
+         }
          break;
       case MESA_SHADER_COMPUTE:
-         if (st_compute_program(linked->Program)->variants)
-            sh = st_compute_program(linked->Program)->variants->driver_shader;
+         if (st_compute_program(linked->Program)->variants) {
+            sh = &st_compute_program(linked->Program)->variants->driver_shader;
+            fence = &st_compute_program(linked->Program)->variants->fence;
+         }
          break;
       }
 
+      if (!sh)
+         continue;
+
+      /* Still being created by the state tracker's compile thread. */
+      if (!util_queue_fence_is_signalled(fence))
+         return false;
+
       unsigned type = pipe_shader_type_from_mesa(i);
 
-      if (sh &&
-          !screen->is_parallel_shader_compilation_finished(screen, sh, type))
+      if (*sh && screen->is_parallel_shader_compilation_finished &&
+          !screen->is_parallel_shader_compilation_finished(screen, *sh, type))
          return false;
    }
    return true;
@@ -45,6 +45,7 @@
 #include "st_cb_queryobj.h"
 #include "st_cb_bitmap.h"
 #include "st_cb_bufferobjects.h"
+#include "st_cb_readpixels.h"
 #include "st_util.h"
 
 
@@ -391,6 +392,9 @@ st_StoreQueryResult(struct gl_context *ctx, struct gl_query_object *q,
    enum pipe_query_value_type result_type;
    int index;
 
+   st_flush_readbacks(st_context(ctx));
+   st_bufferobj_changed(st_context(ctx), buf);
+
    /* GL_QUERY_TARGET is a bit of an extension since it has nothing to
     * do with the GPU end of the query. Write it in "by hand".
     */
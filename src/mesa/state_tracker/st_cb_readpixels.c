@@ -40,6 +40,7 @@
 #include "st_atom.h"
 #include "st_context.h"
 #include "st_cb_bitmap.h"
+#include "st_cb_bufferobjects.h"
 #include "st_cb_readpixels.h"
 #include "st_debug.h"
 #include "state_tracker/st_cb_texture.h"
@@ -109,13 +110,15 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    struct st_pbo_addresses addr;
    struct pipe_framebuffer_state fb;
    enum pipe_texture_target view_target;
+   enum pipe_format image_format;
    bool success = false;
 
    if (texture->nr_samples > 1)
       return false;
 
-   if (!screen->is_format_supported(screen, dst_format, PIPE_BUFFER, 0, 0,
-                                    PIPE_BIND_SHADER_IMAGE))
+   /* Packed formats may be written as integers packed by the shader. */
+   image_format = st_pbo_get_download_image_format(screen, dst_format);
+   if (image_format == PIPE_FORMAT_NONE)
       return false;
 
    desc = util_format_description(dst_format);
@@ -199,7 +202,7 @@ try_pbo_readpixels(struct st_context *st, struct st_renderbuffer *strb,
 
       memset(&image, 0, sizeof(image));
       image.resource = addr.buffer;
-      image.format = dst_format;
+      image.format = image_format;
       image.access = PIPE_IMAGE_ACCESS_WRITE;
       image.shader_access = PIPE_IMAGE_ACCESS_WRITE;
       image.u.buf.offset = addr.first_element * addr.bytes_per_pixel;
@@ -382,6 +385,89 @@ try_cached_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    return dst;
 }
 
+/**
+ * Copy the pending readbacks from their staging textures into their pixel
+ * pack buffers, waiting for the blits if necessary.
+ */
+void
+st_resolve_readbacks(struct st_context *st)
+{
+   struct pipe_context *pipe = st->pipe;
+   unsigned num = st->readbacks.num;
+
+   /* Mapping the buffers below must not get back here. */
+   st->readbacks.num = 0;
+
+   for (unsigned i = 0; i < num; i++) {
+      struct st_pending_readback *rb = &st->readbacks.entries[i];
+      struct pipe_resource *buf = st_buffer_object(rb->bufobj)->buffer;
+      struct pipe_transfer *tex_xfer, *buf_xfer;
+      GLintptr first = rb->dst_offset;
+      ubyte *map, *dest;
+
+      if (rb->dst_stride < 0)
+         first += (GLintptr) rb->dst_stride * (rb->height - 1);
+
+      map = buf ? pipe_transfer_map_3d(pipe, rb->staging, 0,
+                                       PIPE_TRANSFER_READ,
+                                       rb->x, rb->y, 0,
+                                       rb->width, rb->height, 1,
+                                       &tex_xfer) : NULL;
+      if (map) {
+         dest = pipe_buffer_map_range(pipe, buf, first,
+                                      (GLintptr) abs(rb->dst_stride) *
+                                      (rb->height - 1) + rb->bytes_per_row,
+                                      PIPE_TRANSFER_WRITE, &buf_xfer);
+         if (dest) {
+            dest += rb->dst_offset - first;
+
+            for (unsigned row = 0; row < rb->height; row++) {
+               memcpy(dest, map, rb->bytes_per_row);
+               map += tex_xfer->stride;
+               dest += rb->dst_stride;
+            }
+            pipe_buffer_unmap(pipe, buf_xfer);
+         }
+         pipe_transfer_unmap(pipe, tex_xfer);
+      }
+
+      pipe_resource_reference(&rb->staging, NULL);
+      _mesa_reference_buffer_object(st->ctx, &rb->bufobj, NULL);
+   }
+}
+
+/**
+ * Record the copy of a staging texture into a pixel pack buffer, to be done
+ * by st_resolve_readbacks() once something uses the buffer.
+ */
+static void
+queue_readback(struct st_context *st, struct pipe_resource *staging,
+               unsigned x, unsigned y, unsigned width, unsigned height,
+               unsigned bytes_per_row, int dst_stride, GLintptr dst_offset,
+               struct gl_buffer_object *bufobj)
+{
+   struct st_pending_readback *rb;
+
+   if (st->readbacks.num == NUM_PENDING_READBACKS)
+      st_resolve_readbacks(st);
+
+   rb = &st->readbacks.entries[st->readbacks.num++];
+   rb->staging = NULL;
+   rb->bufobj = NULL;
+   pipe_resource_reference(&rb->staging, staging);
+   _mesa_reference_buffer_object(st->ctx, &rb->bufobj, bufobj);
+   rb->x = x;
+   rb->y = y;
+   rb->width = width;
+   rb->height = height;
+   rb->bytes_per_row = bytes_per_row;
+   rb->dst_stride = dst_stride;
+   rb->dst_offset = dst_offset;
+
+   /* Get the blit going while the application does other work. */
+   st->pipe->flush(st->pipe, NULL, PIPE_FLUSH_ASYNC);
+}
+
 /**
  * This uses a blit to copy the read buffer to a texture format which matches
  * the format and type combo and then a fast read-back is done using memcpy.
@@ -466,19 +552,33 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
     * for the format+type combo. */
    dst_format = st_choose_matching_format(st, bind, format, type,
                                           pack->SwapBytes);
-   if (dst_format == PIPE_FORMAT_NONE) {
-      goto fallback;
-   }
+
+   if (_mesa_is_bufferobj(pack->BufferObj))
+      st_bufferobj_changed(st, pack->BufferObj);
 
    if (st->pbo.download_enabled && _mesa_is_bufferobj(pack->BufferObj)) {
-      if (try_pbo_readpixels(st, strb,
+      /* PBO downloads write shader images, so the format doesn't need to
+       * be renderable.
+       */
+      enum pipe_format pbo_format = dst_format;
+
+      if (pbo_format == PIPE_FORMAT_NONE && bind == PIPE_BIND_RENDER_TARGET)
+         pbo_format = st_choose_matching_format(st, 0, format, type,
+                                                pack->SwapBytes);
+
+      if (pbo_format != PIPE_FORMAT_NONE &&
+          try_pbo_readpixels(st, strb,
                              st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
                              x, y, width, height,
-                             src_format, dst_format,
+                             src_format, pbo_format,
                              pack, pixels))
          return;
    }
 
+   if (dst_format == PIPE_FORMAT_NONE) {
+      goto fallback;
+   }
+
    if (needs_integer_signed_unsigned_conversion(ctx, format, type)) {
       goto fallback;
    }
@@ -512,6 +612,25 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       dst_y = 0;
    }
 
+   /* Leave the copy into a PBO for later, so that the application doesn't
+    * wait for the blit until it actually uses the buffer.  A buffer mapped
+    * by the application can be read without going through GL, so it gets
+    * the pixels right away.
+    */
+   if (_mesa_is_bufferobj(pack->BufferObj) &&
+       !_mesa_bufferobj_mapped(pack->BufferObj, MAP_USER)) {
+      const char *dest = _mesa_image_address2d(pack, pixels,
+                                               width, height, format,
+                                               type, 0, 0);
+
+      queue_readback(st, dst, dst_x, dst_y, width, height,
+                     width * util_format_get_blocksize(dst_format),
+                     _mesa_image_row_stride(pack, width, format, type),
+                     (GLintptr) dest, pack->BufferObj);
+      pipe_resource_reference(&dst, NULL);
+      return;
+   }
+
    /* map resources */
    pixels = _mesa_map_pbo_dest(ctx, pack, pixels);
 
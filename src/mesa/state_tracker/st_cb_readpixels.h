@@ -30,11 +30,28 @@
 #define ST_CB_READPIXELS_H
 
 #include "main/glheader.h"
+#include "st_context.h"
 
 struct dd_function_table;
 
 extern void
 st_init_readpixels_functions(struct dd_function_table *functions);
 
+extern void
+st_resolve_readbacks(struct st_context *st);
+
+/**
+ * Finish the glReadPixels into pixel pack buffers that were left pending.
+ * This must be called before anything reads or writes buffer objects, and
+ * before flushes and fences, which other contexts and persistent mappings
+ * rely on.
+ */
+static inline void
+st_flush_readbacks(struct st_context *st)
+{
+   if (unlikely(st->readbacks.num))
+      st_resolve_readbacks(st);
+}
+
 
 #endif /* ST_CB_READPIXELS_H */
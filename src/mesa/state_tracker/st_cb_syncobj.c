@@ -35,6 +35,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_screen.h"
 #include "st_context.h"
+#include "st_cb_readpixels.h"
 #include "st_cb_syncobj.h"
 
 struct st_sync_object {
@@ -68,12 +69,18 @@ static void st_delete_sync_object(struct gl_context *ctx,
 static void st_fence_sync(struct gl_context *ctx, struct gl_sync_object *obj,
                           GLenum condition, GLbitfield flags)
 {
-   struct pipe_context *pipe = st_context(ctx)->pipe;
+   struct st_context *st = st_context(ctx);
+   struct pipe_context *pipe = st->pipe;
    struct st_sync_object *so = (struct st_sync_object*)obj;
 
    assert(condition == GL_SYNC_GPU_COMMANDS_COMPLETE && flags == 0);
    assert(so->fence == NULL);
 
+   /* The fence covers earlier glReadPixels into buffers, which the
+    * application may read through a persistent mapping once it signals.
+    */
+   st_flush_readbacks(st);
+
    pipe->flush(pipe, &so->fence, PIPE_FLUSH_DEFERRED);
 }
 
@@ -75,6 +75,7 @@
 #include "util/u_sampler.h"
 #include "util/u_math.h"
 #include "util/u_box.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_simple_shaders.h"
 #include "cso_cache/cso_context.h"
 #include "tgsi/tgsi_ureg.h"
@@ -173,6 +174,7 @@ st_NewTextureObject(struct gl_context * ctx, GLuint name, GLenum target)
 
    simple_mtx_init(&obj->validate_mutex, mtx_plain);
    obj->needs_validation = true;
+   st_texture_update_view_stamp(obj);
 
    return &obj->base;
 }
@@ -324,6 +326,133 @@ st_MapTextureImage(struct gl_context *ctx,
 }
 
 
+/**
+ * A rectangle of a compressed image to decompress to RGBA8.  The source
+ * stride is the size of a row of blocks.
+ */
+struct st_decompress_job {
+   uint8_t *dst;
+   unsigned dst_stride;
+   const uint8_t *src;
+   unsigned src_stride;
+   unsigned width, height;
+   mesa_format format;
+   bool bgra;
+   struct util_queue_fence fence;
+};
+
+/* Images with fewer pixels than this are decompressed on the app thread. */
+#define ST_DECOMPRESS_THREADED_MIN_PIXELS (512 * 512)
+
+static void
+st_decompress_rows(const struct st_decompress_job *job)
+{
+   if (job->format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(job->dst, job->dst_stride,
+                                 job->src, job->src_stride,
+                                 job->width, job->height);
+   } else if (_mesa_is_format_etc2(job->format)) {
+      _mesa_unpack_etc2_format(job->dst, job->dst_stride,
+                               job->src, job->src_stride,
+                               job->width, job->height,
+                               job->format, job->bgra);
+   } else if (_mesa_is_format_astc_2d(job->format)) {
+      _mesa_unpack_astc_2d_ldr(job->dst, job->dst_stride,
+                               job->src, job->src_stride,
+                               job->width, job->height,
+                               job->format);
+   } else {
+      unreachable("unexpected format for a compressed format fallback");
+   }
+}
+
+static void
+st_decompress_job_execute(void *data, int thread_index)
+{
+   st_decompress_rows(data);
+}
+
+static bool
+st_get_decompress_queue(struct st_context *st)
+{
+   if (!st->decompress.initialized) {
+      unsigned num_threads = util_cpu_caps.nr_cpus > 1 ?
+                             MIN2(util_cpu_caps.nr_cpus, 8) - 1 : 0;
+
+      st->decompress.initialized = true;
+
+      if (num_threads &&
+          util_queue_init(&st->decompress.queue, "st_decompress",
+                          num_threads, num_threads, 0))
+         st->decompress.num_threads = num_threads;
+   }
+
+   return st->decompress.num_threads != 0;
+}
+
+void
+st_destroy_decompress_queue(struct st_context *st)
+{
+   if (!st->decompress.num_threads)
+      return;
+
+   util_queue_destroy(&st->decompress.queue);
+   st->decompress.num_threads = 0;
+}
+
+/**
+ * Decompress an upload to a compressed format the driver doesn't support.
+ *
+ * The blocks are independent, so large images are split in bands of block
+ * rows decompressed by the decompress threads and the app thread together.
+ */
+static void
+st_decompress_image(struct st_context *st, const struct st_decompress_job *image)
+{
+   struct st_decompress_job jobs[8];
+   unsigned blk_w, blk_h;
+
+   if (image->width * image->height < ST_DECOMPRESS_THREADED_MIN_PIXELS ||
+       !st_get_decompress_queue(st)) {
+      st_decompress_rows(image);
+      return;
+   }
+
+   _mesa_get_format_block_size(image->format, &blk_w, &blk_h);
+
+   unsigned num_jobs = st->decompress.num_threads + 1;
+   unsigned block_rows = DIV_ROUND_UP(image->height, blk_h);
+   unsigned rows_per_job = DIV_ROUND_UP(block_rows, num_jobs);
+   unsigned n = 0;
+
+   assert(num_jobs <= ARRAY_SIZE(jobs));
+
+   for (unsigned row = 0; row < block_rows; row += rows_per_job, n++) {
+      struct st_decompress_job *job = &jobs[n];
+      unsigned y = row * blk_h;
+
+      *job = *image;
+      job->dst += y * image->dst_stride;
+      job->src += row * image->src_stride;
+      job->height = MIN2(rows_per_job * blk_h, image->height - y);
+
+      /* The first band is decompressed by this thread below. */
+      if (n > 0) {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(&st->decompress.queue, job, &job->fence,
+                            st_decompress_job_execute, NULL);
+      }
+   }
+
+   st_decompress_rows(&jobs[0]);
+
+   for (unsigned i = 1; i < n; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
 /** called via ctx->Driver.UnmapTextureImage() */
 static void
 st_UnmapTextureImage(struct gl_context *ctx,
@@ -343,29 +472,18 @@ st_UnmapTextureImage(struct gl_context *ctx,
       assert(z == transfer->box.z);
 
       if (transfer->usage & PIPE_TRANSFER_WRITE) {
-         if (texImage->TexFormat == MESA_FORMAT_ETC1_RGB8) {
-            _mesa_etc1_unpack_rgba8888(itransfer->map, transfer->stride,
-                                       itransfer->temp_data,
-                                       itransfer->temp_stride,
-                                       transfer->box.width,
-                                       transfer->box.height);
-         } else if (_mesa_is_format_etc2(texImage->TexFormat)) {
-            bool bgra = stImage->pt->format == PIPE_FORMAT_B8G8R8A8_SRGB;
-            _mesa_unpack_etc2_format(itransfer->map, transfer->stride,
-                                     itransfer->temp_data,
-                                     itransfer->temp_stride,
-                                     transfer->box.width, transfer->box.height,
-                                     texImage->TexFormat,
-                                     bgra);
-         } else if (_mesa_is_format_astc_2d(texImage->TexFormat)) {
-            _mesa_unpack_astc_2d_ldr(itransfer->map, transfer->stride,
-                                     itransfer->temp_data,
-                                     itransfer->temp_stride,
-                                     transfer->box.width, transfer->box.height,
-                                     texImage->TexFormat);
-         } else {
-            unreachable("unexpected format for a compressed format fallback");
-         }
+         struct st_decompress_job job = {
+            .dst = itransfer->map,
+            .dst_stride = transfer->stride,
+            .src = itransfer->temp_data,
+            .src_stride = itransfer->temp_stride,
+            .width = transfer->box.width,
+            .height = transfer->box.height,
+            .format = texImage->TexFormat,
+            .bgra = stImage->pt->format == PIPE_FORMAT_B8G8R8A8_SRGB,
+         };
+
+         st_decompress_image(st, &job);
       }
 
       itransfer->temp_data = NULL;
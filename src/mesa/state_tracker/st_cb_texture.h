@@ -55,4 +55,7 @@ st_finalize_texture(struct gl_context *ctx,
 extern void
 st_init_texture_functions(struct dd_function_table *functions);
 
+void
+st_destroy_decompress_queue(struct st_context *st);
+
 #endif /* ST_CB_TEXTURE_H */
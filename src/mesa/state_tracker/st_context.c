@@ -423,6 +423,8 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
 {
    uint i;
 
+   st_destroy_compile_queue(st);
+   st_destroy_decompress_queue(st);
    st_destroy_atoms(st);
    st_destroy_draw(st);
    st_destroy_clear(st);
@@ -431,11 +433,14 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
    st_destroy_drawtex(st);
    st_destroy_perfmon(st);
    st_destroy_pbo_helpers(st);
+   if (st->gen_mipmap_cs)
+      st->pipe->delete_compute_state(st->pipe, st->gen_mipmap_cs);
    st_destroy_bound_texture_handles(st);
    st_destroy_bound_image_handles(st);
 
-   for (i = 0; i < ARRAY_SIZE(st->state.frag_sampler_views); i++) {
-      pipe_sampler_view_reference(&st->state.frag_sampler_views[i], NULL);
+   for (unsigned s = 0; s < PIPE_SHADER_TYPES; s++) {
+      for (i = 0; i < ARRAY_SIZE(st->state.sampler_views[s]); i++)
+         pipe_sampler_view_reference(&st->state.sampler_views[s][i], NULL);
    }
 
    /* free glReadPixels cache data */
@@ -546,9 +551,13 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
     * So tell the u_vbuf module that user VBOs are not possible with the Core
     * profile, so that u_vbuf is bypassed completely if there is nothing else
     * to do.
+    *
+    * Vertices translated from buffers are cached, st_bufferobj_changed and
+    * prepare_draw tell u_vbuf when they may have changed.
     */
    unsigned vbuf_flags =
-      ctx->API == API_OPENGL_CORE ? U_VBUF_FLAG_NO_USER_VBOS : 0;
+      (ctx->API == API_OPENGL_CORE ? U_VBUF_FLAG_NO_USER_VBOS : 0) |
+      U_VBUF_FLAG_CACHE_TRANSLATIONS;
    st->cso_context = cso_create_context(pipe, vbuf_flags);
 
    st_init_atoms(st);
@@ -755,6 +764,18 @@ st_set_background_context(struct gl_context *ctx,
 }
 
 
+static void
+st_pin_driver_to_l3_cache(struct gl_context *ctx, unsigned L3_cache)
+{
+   struct pipe_context *pipe = st_context(ctx)->pipe;
+
+   if (pipe->set_context_param) {
+      pipe->set_context_param(pipe, PIPE_CONTEXT_PARAM_PIN_THREADS_TO_L3_CACHE,
+                              L3_cache);
+   }
+}
+
+
 static void
 st_get_device_uuid(struct gl_context *ctx, char *uuid)
 {
@@ -825,6 +846,7 @@ st_init_driver_functions(struct pipe_screen *screen,
    functions->UpdateState = st_invalidate_state;
    functions->QueryMemoryInfo = st_query_memory_info;
    functions->SetBackgroundContext = st_set_background_context;
+   functions->PinDriverToL3Cache = st_pin_driver_to_l3_cache;
    functions->GetDriverUuid = st_get_driver_uuid;
    functions->GetDeviceUuid = st_get_device_uuid;
 
@@ -941,6 +963,8 @@ st_destroy_context(struct st_context *st)
    /* This must be called first so that glthread has a chance to finish */
    _mesa_glthread_destroy(ctx);
 
+   st_flush_readbacks(st);
+
    _mesa_HashWalk(ctx->Shared->TexObjects, destroy_tex_sampler_cb, st);
 
    /* For the fallback textures, free any sampler views belonging to this
@@ -35,6 +35,7 @@
 #include "state_tracker/st_atom.h"
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
+#include "util/u_queue.h"
 #include "util/list.h"
 #include "vbo/vbo.h"
 #include "util/list.h"
@@ -49,6 +50,7 @@ struct dd_function_table;
 struct draw_context;
 struct draw_stage;
 struct gen_mipmap_state;
+struct hash_table_u64;
 struct st_context;
 struct st_fragment_program;
 struct st_perf_monitor_group;
@@ -96,6 +98,42 @@ struct drawpix_cache_entry
 };
 
 
+#define NUM_PENDING_READBACKS 4
+
+/**
+ * A glReadPixels into a pixel pack buffer whose data has been blitted to a
+ * staging texture but not yet copied into the buffer, see
+ * st_flush_readbacks().
+ */
+struct st_pending_readback
+{
+   struct pipe_resource *staging;
+   struct gl_buffer_object *bufobj;
+   unsigned x, y, width, height;  /**< region of the staging texture */
+   unsigned bytes_per_row;
+   int dst_stride;
+   GLintptr dst_offset;           /**< offset of the first row in bufobj */
+};
+
+
+#define NUM_ARRAY_CACHE_ENTRIES 8
+
+/**
+ * Vertex elements and vertex buffer layout derived from the arrays of a VAO
+ * for one vertex program variant, see st_setup_arrays().
+ */
+struct st_array_cache_entry
+{
+   unsigned vao_stamp;        /**< gl_vertex_array_object::_Stamp, 0 if unused */
+   unsigned vp_variant_id;    /**< st_vp_variant::id */
+   GLbitfield enabled;        /**< gl_context::Array._DrawVAOEnabledAttribs */
+   unsigned num_vbuffers;
+   /** The first attribute of the binding of each vertex buffer */
+   ubyte vbuffer_attrib[PIPE_MAX_ATTRIBS];
+   struct pipe_vertex_element velements[PIPE_MAX_ATTRIBS];
+};
+
+
 /*
  * Node for a linked list of dead sampler views.
  */
@@ -154,6 +192,32 @@ struct st_context
     */
    boolean shader_has_one_variant[MESA_SHADER_STAGES];
 
+   /**
+    * Thread creating the driver shaders of variants precompiled at link
+    * time, with a pipe_context of its own.  Only used with shareable shaders
+    * and drivers that don't have a compiler queue themselves.
+    */
+   struct {
+      struct util_queue queue;
+      struct pipe_context *pipe;
+      bool initialized;
+      bool precompiling; /**< inside st_precompile_shader_variant() */
+
+      /** Driver binary to create the next precompiled shader from */
+      const void *binary;
+      unsigned binary_size;
+   } compile;
+
+   /**
+    * Threads decompressing large uploads of compressed formats the driver
+    * doesn't support.  num_threads is 0 when they are unavailable.
+    */
+   struct {
+      struct util_queue queue;
+      unsigned num_threads;
+      bool initialized;
+   } decompress;
+
    boolean needs_texcoord_semantic;
    boolean apply_texture_swizzle_to_border_color;
 
@@ -174,7 +238,14 @@ struct st_context
       struct pipe_rasterizer_state          rasterizer;
       struct pipe_sampler_state frag_samplers[PIPE_MAX_SAMPLERS];
       GLuint num_frag_samplers;
-      struct pipe_sampler_view *frag_sampler_views[PIPE_MAX_SAMPLERS];
+      struct pipe_sampler_view *sampler_views[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
+      /** What each of the sampler_views was created for */
+      struct st_sampler_view_source {
+         const struct gl_texture_object *texObj; /**< NULL if not reusable */
+         unsigned view_stamp;
+         bool glsl130_or_later;
+         bool srgb_skip_decode;
+      } sampler_view_sources[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
       GLuint num_sampler_views[PIPE_SHADER_TYPES];
       struct pipe_clip_state clip;
       struct {
@@ -266,6 +337,17 @@ struct st_context
       unsigned hits;
    } readpix_cache;
 
+   /** glReadPixels into PBOs waiting for their staging copy */
+   struct {
+      struct st_pending_readback entries[NUM_PENDING_READBACKS];
+      unsigned num;
+   } readbacks;
+
+   /** The last draw or dispatch may have written buffers on the GPU, so
+    * vertices u_vbuf translated from buffers may be stale.
+    */
+   bool may_have_written_buffers;
+
    /** for glClear */
    struct {
       struct pipe_rasterizer_state raster;
@@ -276,6 +358,9 @@ struct st_context
       void *gs_layered;
    } clear;
 
+   /** for util_compute_gen_mipmap() */
+   void *gen_mipmap_cs;
+
    /* For gl(Compressed)Tex(Sub)Image */
    struct {
       struct pipe_rasterizer_state raster;
@@ -284,6 +369,8 @@ struct st_context
       void *gs;
       void *upload_fs[3];
       void *download_fs[3][PIPE_MAX_TEXTURE_TYPES];
+      /* Download shaders packing texels, by format and target. */
+      struct hash_table_u64 *download_packed_fs;
       bool upload_enabled;
       bool download_enabled;
       bool rgba_only;
@@ -306,6 +393,12 @@ struct st_context
    /* The number of vertex buffers from the last call of validate_arrays. */
    unsigned last_num_vbuffers;
 
+   /** Cache of the vertex array setup of recently drawn VAOs */
+   struct {
+      struct st_array_cache_entry entries[NUM_ARRAY_CACHE_ENTRIES];
+      unsigned next;
+   } array_cache;
+
    int32_t draw_stamp;
    int32_t read_stamp;
 
@@ -41,6 +41,7 @@
 #include "main/image.h"
 #include "main/bufferobj.h"
 #include "main/macros.h"
+#include "main/transformfeedback.h"
 #include "main/varray.h"
 
 #include "compiler/glsl/ir_uniform.h"
@@ -51,6 +52,7 @@
 #include "st_atom.h"
 #include "st_cb_bitmap.h"
 #include "st_cb_bufferobjects.h"
+#include "st_cb_readpixels.h"
 #include "st_cb_xformfb.h"
 #include "st_debug.h"
 #include "st_draw.h"
@@ -115,6 +117,27 @@ translate_prim(const struct gl_context *ctx, unsigned prim)
    return prim;
 }
 
+/**
+ * Whether the draw can write buffer objects through shader storage
+ * buffers, images, atomic counters or transform feedback.
+ */
+static bool
+draw_may_write_buffers(struct gl_context *ctx)
+{
+   if (_mesa_is_xfb_active_and_unpaused(ctx))
+      return true;
+
+   for (unsigned i = MESA_SHADER_VERTEX; i <= MESA_SHADER_FRAGMENT; i++) {
+      struct gl_program *prog = ctx->_Shader->CurrentProgram[i];
+
+      if (prog && (prog->info.num_ssbos || prog->info.num_images ||
+                   prog->info.num_abos))
+         return true;
+   }
+
+   return false;
+}
+
 static inline void
 prepare_draw(struct st_context *st, struct gl_context *ctx)
 {
@@ -124,8 +147,16 @@ prepare_draw(struct st_context *st, struct gl_context *ctx)
    if (unlikely(!st->bitmap.cache.empty))
       st_flush_bitmap_cache(st);
 
+   st_flush_readbacks(st);
    st_invalidate_readpix_cache(st);
 
+   /* Translated vertices are only reused if nothing else could have written
+    * the buffers they were read from, including other contexts.
+    */
+   if (unlikely(st->may_have_written_buffers || ctx->Shared->RefCount > 1))
+      cso_invalidate_vertex_buffer(st->cso_context, NULL);
+   st->may_have_written_buffers = draw_may_write_buffers(ctx);
+
    /* Validate state. */
    if ((st->dirty | ctx->NewDriverState) & ST_PIPELINE_RENDER_STATE_MASK ||
        st->gfx_shaders_may_be_dirty) {
@@ -157,6 +188,70 @@ prepare_draw(struct st_context *st, struct gl_context *ctx)
    }
 }
 
+/**
+ * Whether the prims only differ by the parameters of a
+ * pipe_draw_start_count and have consecutive draw ids, so that they can be
+ * submitted with a single pipe_context::multi_draw call.
+ */
+static bool
+prims_allow_multi_draw(const struct _mesa_prim *prims, unsigned nr_prims)
+{
+   for (unsigned i = 1; i < nr_prims; i++) {
+      if (prims[i].mode != prims[0].mode ||
+          prims[i].num_instances != prims[0].num_instances ||
+          prims[i].base_instance != prims[0].base_instance ||
+          prims[i].draw_id != prims[0].draw_id + i)
+         return false;
+   }
+   return true;
+}
+
+/**
+ * Submit the prims with cso_multi_draw, in chunks of a fixed size.
+ * Empty prims are kept so that the draw ids stay consecutive.
+ */
+static void
+st_multi_draw(struct st_context *st, struct pipe_draw_info *info,
+              const struct _mesa_prim *prims, unsigned nr_prims,
+              unsigned start)
+{
+   struct pipe_draw_start_count draws[64];
+
+   info->mode = translate_prim(st->ctx, prims[0].mode);
+   info->start_instance = prims[0].base_instance;
+   info->instance_count = prims[0].num_instances;
+
+   for (unsigned first = 0; first < nr_prims; first += ARRAY_SIZE(draws)) {
+      unsigned num_draws = MIN2(nr_prims - first, ARRAY_SIZE(draws));
+      unsigned min_index = ~0u, max_index = 0;
+
+      for (unsigned i = 0; i < num_draws; i++) {
+         const struct _mesa_prim *prim = &prims[first + i];
+
+         draws[i].start = start + prim->start;
+         draws[i].count = prim->count;
+         draws[i].index_bias = prim->basevertex;
+
+         if (prim->count) {
+            min_index = MIN2(min_index, draws[i].start);
+            max_index = MAX2(max_index, draws[i].start + prim->count - 1);
+         }
+      }
+
+      /* Nothing to draw in this chunk. */
+      if (min_index > max_index)
+         continue;
+
+      if (!info->index_size) {
+         info->min_index = min_index;
+         info->max_index = max_index;
+      }
+      info->drawid = prims[first].draw_id;
+
+      cso_multi_draw(st->cso_context, info, draws, num_draws);
+   }
+}
+
 /**
  * This function gets plugged into the VBO module and is called when
  * we have something to render.
@@ -240,6 +335,16 @@ st_draw_vbo(struct gl_context *ctx,
 
    assert(!indirect);
 
+   /* Multi-draws of real index buffers or of arrays are submitted at once
+    * if the driver supports it, sharing the validation above.
+    */
+   if (nr_prims > 1 && st->pipe->multi_draw && !tfb_vertcount &&
+       !info.has_user_indices && !(ST_DEBUG & DEBUG_DRAW) &&
+       prims_allow_multi_draw(prims, nr_prims)) {
+      st_multi_draw(st, &info, prims, nr_prims, start);
+      return;
+   }
+
    /* do actual drawing */
    for (i = 0; i < nr_prims; i++) {
       info.count = prims[i].count;
@@ -336,6 +336,9 @@ void st_init_limits(struct pipe_screen *screen,
        * because it can actually optimize SSBO access.
        */
       options->LowerBufferInterfaceBlocks = !prefer_nir;
+
+      /* The linked shaders are optimized in NIR. */
+      options->SkipCompileTimeOptimizations = prefer_nir;
    }
 
    c->MaxUserAssignableUniformLocations =
@@ -35,8 +35,11 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
+#include "util/u_compute.h"
 #include "util/u_gen_mipmap.h"
+#include "cso_cache/cso_context.h"
 
+#include "st_atom.h"
 #include "st_debug.h"
 #include "st_context.h"
 #include "st_texture.h"
@@ -46,6 +49,41 @@
 #include "st_cb_texture.h"
 
 
+/**
+ * Generate the levels with util_compute_gen_mipmap(), which saves a blit per
+ * level when there are at least two levels to generate.
+ */
+static bool
+compute_gen_mipmap(struct st_context *st, struct pipe_resource *pt,
+                   enum pipe_format format, unsigned base_level,
+                   unsigned last_level, unsigned first_layer,
+                   unsigned last_layer)
+{
+   struct pipe_sampler_view **views =
+      st->state.sampler_views[PIPE_SHADER_COMPUTE];
+
+   if (last_level < base_level + 2)
+      return false;
+
+   /* The compute state is bound behind the back of the CSO context and the
+    * compute atoms, which must bind everything again for the next dispatch.
+    */
+   cso_set_compute_shader_handle(st->cso_context, NULL);
+   st->dirty |= ST_PIPELINE_COMPUTE_STATE_MASK;
+
+   if (!util_compute_gen_mipmap(st->pipe, pt, format, base_level, last_level,
+                                first_layer, last_layer,
+                                &st->gen_mipmap_cs))
+      return false;
+
+   for (unsigned i = 0; i < st->state.num_sampler_views[PIPE_SHADER_COMPUTE];
+        i++)
+      pipe_sampler_view_reference(&views[i], NULL);
+   st->state.num_sampler_views[PIPE_SHADER_COMPUTE] = 0;
+   return true;
+}
+
+
 /**
  * Called via ctx->Driver.GenerateMipmap().
  */
@@ -126,15 +164,17 @@ st_generate_mipmap(struct gl_context *ctx, GLenum target,
       format = pt->format;
 
    /* First see if the driver supports hardware mipmap generation,
-    * if not then generate the mipmap by rendering/texturing.
-    * If that fails, use the software fallback.
+    * if not then generate the mipmap with compute shaders or by
+    * rendering/texturing.  If that fails, use the software fallback.
     */
    if (!st->pipe->screen->get_param(st->pipe->screen,
                                     PIPE_CAP_GENERATE_MIPMAP) ||
        !st->pipe->generate_mipmap(st->pipe, pt, format, baseLevel,
                                   lastLevel, first_layer, last_layer)) {
 
-      if (!util_gen_mipmap(st->pipe, pt, format, baseLevel, lastLevel,
+      if (!compute_gen_mipmap(st, pt, format, baseLevel, lastLevel,
+                              first_layer, last_layer) &&
+          !util_gen_mipmap(st->pipe, pt, format, baseLevel, lastLevel,
                            first_layer, last_layer, PIPE_TEX_FILTER_LINEAR)) {
          _mesa_generate_mipmap(ctx, target, texObj);
       }
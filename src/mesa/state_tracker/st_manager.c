@@ -822,8 +822,9 @@ st_start_thread(struct st_context_iface *stctxi)
    /* Pin all driver threads to one L3 cache for optimal performance
     * on AMD Zen. This is only done if glthread is enabled.
     *
-    * If glthread is disabled, st_draw.c re-pins driver threads regularly
-    * based on the location of the app thread.
+    * The threads follow the app thread afterwards: glthread re-pins them
+    * when the app thread moves to a different L3 cache, and if glthread is
+    * disabled, st_draw.c re-pins driver threads regularly.
     */
    struct glthread_state *glthread = st->ctx->GLThread;
    if (glthread && st->pipe->set_context_param) {
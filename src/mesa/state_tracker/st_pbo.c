@@ -32,12 +32,14 @@
 #include "state_tracker/st_nir.h"
 #include "state_tracker/st_pbo.h"
 #include "state_tracker/st_cb_bufferobjects.h"
+#include "state_tracker/st_cb_readpixels.h"
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "cso_cache/cso_context.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/hash_table.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
@@ -53,6 +55,15 @@ enum st_pbo_conversion {
    ST_NUM_PBO_CONVERSIONS
 };
 
+/* How the download fragment shader packs the texels of a packed unorm format
+ * which can't be used as a shader image.
+ */
+struct st_pbo_packing {
+   bool enabled;
+   unsigned shift[4]; /* of each RGBA component */
+   unsigned max[4]; /* 0 for components missing in the format */
+};
+
 /* Final setup of buffer addressing information.
  *
  * buf_offset is in pixels.
@@ -195,6 +206,9 @@ st_pbo_draw(struct st_context *st, const struct st_pbo_addresses *addr,
 {
    struct cso_context *cso = st->cso_context;
 
+   /* The buffer may still be waiting for the copy of an earlier readback. */
+   st_flush_readbacks(st);
+
    /* Setup vertex and geometry shaders */
    if (!st->pbo.vs) {
       st->pbo.vs = st_pbo_create_vs(st);
@@ -391,6 +405,76 @@ st_pbo_create_gs(struct st_context *st)
    return ureg_create_shader_and_destroy(ureg, st->pipe);
 }
 
+/* Fill in the packing of the texels of \p format by the download fragment
+ * shader, or return false if it isn't a packed unorm format.
+ */
+static bool
+get_pbo_packing(enum pipe_format format, struct st_pbo_packing *packing)
+{
+   const struct util_format_description *desc = util_format_description(format);
+
+   memset(packing, 0, sizeof(*packing));
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->is_array || !desc->is_bitmask ||
+       (desc->block.bits != 16 && desc->block.bits != 32))
+      return false;
+
+   for (unsigned i = 0; i < desc->nr_channels; i++) {
+      if (desc->channel[i].type != UTIL_FORMAT_TYPE_VOID &&
+          (desc->channel[i].type != UTIL_FORMAT_TYPE_UNSIGNED ||
+           !desc->channel[i].normalized))
+         return false;
+   }
+
+   for (unsigned i = 0; i < 4; i++) {
+      unsigned chan = desc->swizzle[i];
+
+      if (chan <= PIPE_SWIZZLE_W &&
+          desc->channel[chan].type != UTIL_FORMAT_TYPE_VOID) {
+         packing->shift[i] = desc->channel[chan].shift;
+         packing->max[i] = u_bit_consecutive(0, desc->channel[chan].size);
+      }
+   }
+
+   packing->enabled = true;
+   return true;
+}
+
+/**
+ * Return the format of the shader image written by the PBO download
+ * fragment shader for \p format.
+ *
+ * This is \p format itself if the driver supports it, otherwise a 16 or
+ * 32-bit unsigned integer format if \p format is a packed unorm format like
+ * B5G6R5 or R10G10B10A2, in which case the shader packs the texels itself.
+ * PIPE_FORMAT_NONE means that PBO downloads aren't possible.
+ */
+enum pipe_format
+st_pbo_get_download_image_format(struct pipe_screen *screen,
+                                 enum pipe_format format)
+{
+   struct st_pbo_packing packing;
+   enum pipe_format image_format;
+
+   if (screen->is_format_supported(screen, format, PIPE_BUFFER, 0, 0,
+                                   PIPE_BIND_SHADER_IMAGE))
+      return format;
+
+   if (!get_pbo_packing(format, &packing))
+      return PIPE_FORMAT_NONE;
+
+   image_format = util_format_get_blocksizebits(format) == 16 ?
+                  PIPE_FORMAT_R16_UINT : PIPE_FORMAT_R32_UINT;
+
+   if (!screen->is_format_supported(screen, image_format, PIPE_BUFFER, 0, 0,
+                                    PIPE_BIND_SHADER_IMAGE))
+      return PIPE_FORMAT_NONE;
+
+   return image_format;
+}
+
 static void
 build_conversion(struct ureg_program *ureg, const struct ureg_dst *temp,
                  enum st_pbo_conversion conversion)
@@ -431,7 +515,8 @@ static void *
 create_fs_nir(struct st_context *st,
               bool download,
               enum pipe_texture_target target,
-              enum st_pbo_conversion conversion)
+              enum st_pbo_conversion conversion,
+              const struct st_pbo_packing *packing)
 {
    struct pipe_screen *screen = st->pipe->screen;
    struct nir_builder b;
@@ -541,11 +626,32 @@ create_fs_nir(struct st_context *st,
    else if (conversion == ST_PBO_CONVERT_UINT_TO_SINT)
       result = nir_umin(&b, result, nir_imm_int(&b, (1u << 31) - 1));
 
+   if (packing->enabled) {
+      /* packed = sum(f2u(sat(result[i]) * max[i] + 0.5) << shift[i]) */
+      nir_ssa_def *packed = zero;
+
+      result = nir_fsat(&b, result);
+      for (unsigned i = 0; i < 4; i++) {
+         if (!packing->max[i])
+            continue;
+
+         nir_ssa_def *value =
+            nir_f2u32(&b, nir_ffma(&b, nir_channel(&b, result, i),
+                                   nir_imm_float(&b, packing->max[i]),
+                                   nir_imm_float(&b, 0.5)));
+         packed = nir_ior(&b, packed,
+                          nir_ishl(&b, value, nir_imm_int(&b, packing->shift[i])));
+      }
+      result = nir_vec4(&b, packed, zero, zero, zero);
+   }
+
    if (download) {
       nir_variable *img_var =
          nir_variable_create(b.shader, nir_var_uniform,
                              glsl_image_type(GLSL_SAMPLER_DIM_BUF, false,
-                                             GLSL_TYPE_FLOAT), "img");
+                                             packing->enabled ? GLSL_TYPE_UINT :
+                                                                GLSL_TYPE_FLOAT),
+                             "img");
       img_var->data.image.access = ACCESS_NON_READABLE;
       img_var->data.explicit_binding = true;
       img_var->data.binding = 0;
@@ -576,7 +682,8 @@ create_fs_nir(struct st_context *st,
 static void *
 create_fs_tgsi(struct st_context *st, bool download,
                enum pipe_texture_target target,
-               enum st_pbo_conversion conversion)
+               enum st_pbo_conversion conversion,
+               const struct st_pbo_packing *packing)
 {
    struct pipe_context *pipe = st->pipe;
    struct pipe_screen *screen = pipe->screen;
@@ -696,6 +803,27 @@ create_fs_tgsi(struct st_context *st, bool download,
 
       build_conversion(ureg, &temp1, conversion);
 
+      if (packing->enabled) {
+         const unsigned *max = packing->max;
+         const unsigned *shift = packing->shift;
+
+         /* temp1 = f2u(sat(temp1) * max + 0.5) << shift */
+         ureg_MOV(ureg, ureg_saturate(temp1), ureg_src(temp1));
+         ureg_MAD(ureg, temp1, ureg_src(temp1),
+                        ureg_imm4f(ureg, max[0], max[1], max[2], max[3]),
+                        ureg_imm1f(ureg, 0.5));
+         ureg_F2U(ureg, temp1, ureg_src(temp1));
+         ureg_SHL(ureg, temp1, ureg_src(temp1),
+                        ureg_imm4u(ureg, shift[0], shift[1], shift[2], shift[3]));
+
+         /* temp1.x = temp1.x | temp1.y | temp1.z | temp1.w */
+         for (unsigned i = 1; i < 4; i++) {
+            ureg_OR(ureg, ureg_writemask(temp1, TGSI_WRITEMASK_X),
+                          ureg_scalar(ureg_src(temp1), TGSI_SWIZZLE_X),
+                          ureg_scalar(ureg_src(temp1), i));
+         }
+      }
+
       /* store(out, temp0, temp1) */
       op[0] = ureg_src(temp0);
       op[1] = ureg_src(temp1);
@@ -722,7 +850,8 @@ create_fs_tgsi(struct st_context *st, bool download,
 static void *
 create_fs(struct st_context *st, bool download,
           enum pipe_texture_target target,
-          enum st_pbo_conversion conversion)
+          enum st_pbo_conversion conversion,
+          const struct st_pbo_packing *packing)
 {
    struct pipe_screen *pscreen = st->pipe->screen;
    bool use_nir = PIPE_SHADER_IR_NIR ==
@@ -730,9 +859,9 @@ create_fs(struct st_context *st, bool download,
                                 PIPE_SHADER_CAP_PREFERRED_IR);
 
    if (use_nir)
-      return create_fs_nir(st, download, target, conversion);
+      return create_fs_nir(st, download, target, conversion, packing);
 
-   return create_fs_tgsi(st, download, target, conversion);
+   return create_fs_tgsi(st, download, target, conversion, packing);
 }
 
 static enum st_pbo_conversion
@@ -757,9 +886,11 @@ st_pbo_get_upload_fs(struct st_context *st,
    STATIC_ASSERT(ARRAY_SIZE(st->pbo.upload_fs) == ST_NUM_PBO_CONVERSIONS);
 
    enum st_pbo_conversion conversion = get_pbo_conversion(src_format, dst_format);
+   struct st_pbo_packing no_packing = { false };
 
    if (!st->pbo.upload_fs[conversion])
-      st->pbo.upload_fs[conversion] = create_fs(st, false, 0, conversion);
+      st->pbo.upload_fs[conversion] = create_fs(st, false, 0, conversion,
+                                                &no_packing);
 
    return st->pbo.upload_fs[conversion];
 }
@@ -773,11 +904,42 @@ st_pbo_get_download_fs(struct st_context *st, enum pipe_texture_target target,
    assert(target < PIPE_MAX_TEXTURE_TYPES);
 
    enum st_pbo_conversion conversion = get_pbo_conversion(src_format, dst_format);
+   struct pipe_screen *screen = st->pipe->screen;
+   struct st_pbo_packing packing = { false };
 
-   if (!st->pbo.download_fs[conversion][target])
-      st->pbo.download_fs[conversion][target] = create_fs(st, true, target, conversion);
+   if (st_pbo_get_download_image_format(screen, dst_format) == dst_format) {
+      if (!st->pbo.download_fs[conversion][target]) {
+         st->pbo.download_fs[conversion][target] =
+            create_fs(st, true, target, conversion, &packing);
+      }
 
-   return st->pbo.download_fs[conversion][target];
+      return st->pbo.download_fs[conversion][target];
+   }
+
+   /* The shader packs the texels of dst_format itself, one variant per
+    * format and target.
+    */
+   uint64_t key = (uint64_t)dst_format * PIPE_MAX_TEXTURE_TYPES + target;
+   void *fs;
+
+   if (!st->pbo.download_packed_fs) {
+      st->pbo.download_packed_fs = _mesa_hash_table_u64_create(NULL);
+      if (!st->pbo.download_packed_fs)
+         return NULL;
+   }
+
+   fs = _mesa_hash_table_u64_search(st->pbo.download_packed_fs, key);
+   if (fs)
+      return fs;
+
+   if (!get_pbo_packing(dst_format, &packing))
+      return NULL;
+
+   fs = create_fs(st, true, target, ST_PBO_CONVERT_NONE, &packing);
+   if (fs)
+      _mesa_hash_table_u64_insert(st->pbo.download_packed_fs, key, fs);
+
+   return fs;
 }
 
 void
@@ -842,6 +1004,14 @@ st_destroy_pbo_helpers(struct st_context *st)
       }
    }
 
+   if (st->pbo.download_packed_fs) {
+      hash_table_foreach(st->pbo.download_packed_fs->table, entry)
+         cso_delete_fragment_shader(st->cso_context, entry->data);
+
+      _mesa_hash_table_u64_destroy(st->pbo.download_packed_fs, NULL);
+      st->pbo.download_packed_fs = NULL;
+   }
+
    if (st->pbo.gs) {
       cso_delete_geometry_shader(st->cso_context, st->pbo.gs);
       st->pbo.gs = NULL;
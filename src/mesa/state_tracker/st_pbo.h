@@ -25,6 +25,7 @@
 #define ST_PBO_H
 
 struct gl_pixelstore_attrib;
+struct pipe_screen;
 
 struct st_context;
 
@@ -89,6 +90,10 @@ st_pbo_get_upload_fs(struct st_context *st,
                      enum pipe_format src_format,
                      enum pipe_format dst_format);
 
+enum pipe_format
+st_pbo_get_download_image_format(struct pipe_screen *screen,
+                                 enum pipe_format format);
+
 void *
 st_pbo_get_download_fs(struct st_context *st, enum pipe_texture_target target,
                        enum pipe_format src_format,
@@ -62,6 +62,7 @@
 #include "st_nir.h"
 #include "st_shader_cache.h"
 #include "cso_cache/cso_context.h"
+#include "util/u_atomic.h"
 
 
 
@@ -222,6 +223,172 @@ delete_ir(struct pipe_shader_state *ir)
     */
 }
 
+struct st_compile_job {
+   struct pipe_context *pipe;
+   enum pipe_shader_type type;
+   union {
+      struct pipe_shader_state shader;
+      struct pipe_compute_state compute;
+   } state;
+   const struct tgsi_token *free_tokens;
+   void **driver_shader;
+};
+
+static void *
+create_driver_shader(struct pipe_context *pipe, enum pipe_shader_type type,
+                     const void *state)
+{
+   switch (type) {
+   case PIPE_SHADER_VERTEX:
+      return pipe->create_vs_state(pipe, state);
+   case PIPE_SHADER_TESS_CTRL:
+      return pipe->create_tcs_state(pipe, state);
+   case PIPE_SHADER_TESS_EVAL:
+      return pipe->create_tes_state(pipe, state);
+   case PIPE_SHADER_GEOMETRY:
+      return pipe->create_gs_state(pipe, state);
+   case PIPE_SHADER_FRAGMENT:
+      return pipe->create_fs_state(pipe, state);
+   case PIPE_SHADER_COMPUTE:
+      return pipe->create_compute_state(pipe, state);
+   default:
+      unreachable("bad shader type in create_driver_shader");
+   }
+}
+
+static void
+st_compile_job_execute(void *data, int thread_index)
+{
+   struct st_compile_job *job = (struct st_compile_job *) data;
+
+   *job->driver_shader = create_driver_shader(job->pipe, job->type,
+                                              &job->state);
+   if (job->free_tokens)
+      tgsi_free_tokens(job->free_tokens);
+}
+
+static void
+st_compile_job_cleanup(void *data, int thread_index)
+{
+   free(data);
+}
+
+/**
+ * Whether driver shaders can be created on the compile thread of \p st.
+ *
+ * Shaders created there are used by other contexts, so they have to be
+ * shareable.  Drivers with their own compiler queue don't block in
+ * create_*_state() anyway.
+ */
+static bool
+st_can_compile_in_background(struct st_context *st)
+{
+   struct pipe_screen *screen = st->pipe->screen;
+
+   if (!st->has_shareable_shaders ||
+       screen->is_parallel_shader_compilation_finished ||
+       st->ctx->Hint.MaxShaderCompilerThreads == 0)
+      return false;
+
+   if (!st->compile.initialized) {
+      st->compile.initialized = true;
+      st->compile.pipe = screen->context_create(screen, NULL, 0);
+
+      if (st->compile.pipe &&
+          !util_queue_init(&st->compile.queue, "st_compile", 32, 1,
+                           UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+         st->compile.pipe->destroy(st->compile.pipe);
+         st->compile.pipe = NULL;
+      }
+   }
+
+   return st->compile.pipe != NULL;
+}
+
+/**
+ * Create the driver shader of a new variant into \p driver_shader.
+ *
+ * For variants precompiled at link time this is done by the compile thread
+ * when possible, and \p fence is signalled once \p driver_shader is set.
+ * \p free_tokens are TGSI tokens only needed to create the shader, which
+ * are freed afterwards.
+ */
+static void
+st_create_driver_shader(struct st_context *st, enum pipe_shader_type type,
+                        const void *state,
+                        const struct tgsi_token *free_tokens,
+                        void **driver_shader, struct util_queue_fence *fence)
+{
+   if (st->compile.binary) {
+      struct pipe_screen *screen = st->pipe->screen;
+      void *shader = screen->create_shader_from_binary(screen, type,
+                                                       st->compile.binary,
+                                                       st->compile.binary_size);
+
+      /* The binary is only meant for the first variant, and if the driver
+       * rejects it (e.g. it was made for another GPU), compile as usual.
+       */
+      st->compile.binary = NULL;
+
+      if (shader) {
+         /* The driver doesn't take ownership of the IR in this case. */
+         if (type == PIPE_SHADER_COMPUTE) {
+            const struct pipe_compute_state *cs = state;
+            if (cs->ir_type == PIPE_SHADER_IR_NIR)
+               ralloc_free((void *) cs->prog);
+         } else {
+            const struct pipe_shader_state *ss = state;
+            if (ss->type == PIPE_SHADER_IR_NIR)
+               ralloc_free(ss->ir.nir);
+         }
+
+         *driver_shader = shader;
+         if (free_tokens)
+            tgsi_free_tokens(free_tokens);
+         return;
+      }
+   }
+
+   if (st->compile.precompiling && st_can_compile_in_background(st)) {
+      struct st_compile_job *job = CALLOC_STRUCT(st_compile_job);
+
+      if (job) {
+         job->pipe = st->compile.pipe;
+         job->type = type;
+         if (type == PIPE_SHADER_COMPUTE)
+            job->state.compute = *(const struct pipe_compute_state *) state;
+         else
+            job->state.shader = *(const struct pipe_shader_state *) state;
+         job->free_tokens = free_tokens;
+         job->driver_shader = driver_shader;
+
+         util_queue_add_job(&st->compile.queue, job, fence,
+                            st_compile_job_execute, st_compile_job_cleanup);
+         return;
+      }
+   }
+
+   *driver_shader = create_driver_shader(st->pipe, type, state);
+   if (free_tokens)
+      tgsi_free_tokens(free_tokens);
+}
+
+/**
+ * Wait for the pending background compiles of \p st and free the compile
+ * thread.
+ */
+void
+st_destroy_compile_queue(struct st_context *st)
+{
+   if (!st->compile.pipe)
+      return;
+
+   util_queue_finish(&st->compile.queue);
+   util_queue_destroy(&st->compile.queue);
+   st->compile.pipe->destroy(st->compile.pipe);
+   st->compile.pipe = NULL;
+}
+
 /**
  * Delete a vertex program variant.  Note the caller must unlink
  * the variant from the linked list.
@@ -229,6 +396,9 @@ delete_ir(struct pipe_shader_state *ir)
 static void
 delete_vp_variant(struct st_context *st, struct st_vp_variant *vpv)
 {
+   util_queue_fence_wait(&vpv->fence);
+   util_queue_fence_destroy(&vpv->fence);
+
    if (vpv->driver_shader) {
       if (st->has_shareable_shaders || vpv->key.st == st) {
          cso_delete_vertex_shader(st->cso_context, vpv->driver_shader);
@@ -277,6 +447,9 @@ st_release_vp_variants( struct st_context *st,
 static void
 delete_fp_variant(struct st_context *st, struct st_fp_variant *fpv)
 {
+   util_queue_fence_wait(&fpv->fence);
+   util_queue_fence_destroy(&fpv->fence);
+
    if (fpv->driver_shader) {
       if (st->has_shareable_shaders || fpv->key.st == st) {
          cso_delete_fragment_shader(st->cso_context, fpv->driver_shader);
@@ -318,6 +491,9 @@ static void
 delete_basic_variant(struct st_context *st, struct st_basic_variant *v,
                      GLenum target)
 {
+   util_queue_fence_wait(&v->fence);
+   util_queue_fence_destroy(&v->fence);
+
    if (v->driver_shader) {
       if (st->has_shareable_shaders || v->key.st == st) {
          /* The shader's context matches the calling context, or we
@@ -639,8 +815,10 @@ st_create_vp_variant(struct st_context *st,
                      const struct st_vp_variant_key *key)
 {
    struct st_vp_variant *vpv = CALLOC_STRUCT(st_vp_variant);
-   struct pipe_context *pipe = st->pipe;
+   static unsigned next_id;
 
+   util_queue_fence_init(&vpv->fence);
+   vpv->id = p_atomic_inc_return(&next_id);
    vpv->key = *key;
    vpv->tgsi.stream_output = stvp->tgsi.stream_output;
    vpv->num_inputs = stvp->num_inputs;
@@ -666,7 +844,8 @@ st_create_vp_variant(struct st_context *st,
       st_finalize_nir(st, &stvp->Base, stvp->shader_program,
                       vpv->tgsi.ir.nir);
 
-      vpv->driver_shader = pipe->create_vs_state(pipe, &vpv->tgsi);
+      st_create_driver_shader(st, PIPE_SHADER_VERTEX, &vpv->tgsi, NULL,
+                              &vpv->driver_shader, &vpv->fence);
       /* driver takes ownership of IR: */
       vpv->tgsi.ir.nir = NULL;
       return vpv;
@@ -696,7 +875,8 @@ st_create_vp_variant(struct st_context *st,
       debug_printf("\n");
    }
 
-   vpv->driver_shader = pipe->create_vs_state(pipe, &vpv->tgsi);
+   st_create_driver_shader(st, PIPE_SHADER_VERTEX, &vpv->tgsi, NULL,
+                           &vpv->driver_shader, &vpv->fence);
    return vpv;
 }
 
@@ -735,6 +915,9 @@ st_get_vp_variant(struct st_context *st,
       }
    }
 
+   if (vpv && !st->compile.precompiling)
+      util_queue_fence_wait(&vpv->fence);
+
    return vpv;
 }
 
@@ -1128,7 +1311,6 @@ st_create_fp_variant(struct st_context *st,
                      struct st_fragment_program *stfp,
                      const struct st_fp_variant_key *key)
 {
-   struct pipe_context *pipe = st->pipe;
    struct st_fp_variant *variant = CALLOC_STRUCT(st_fp_variant);
    struct pipe_shader_state tgsi = {0};
    struct gl_program_parameter_list *params = stfp->Base.Parameters;
@@ -1142,6 +1324,8 @@ st_create_fp_variant(struct st_context *st,
    if (!variant)
       return NULL;
 
+   util_queue_fence_init(&variant->fence);
+
    if (stfp->tgsi.type == PIPE_SHADER_IR_NIR) {
       tgsi.type = PIPE_SHADER_IR_NIR;
       tgsi.ir.nir = nir_shader_clone(NULL, stfp->tgsi.ir.nir);
@@ -1222,8 +1406,9 @@ st_create_fp_variant(struct st_context *st,
       nir_shader_gather_info(tgsi.ir.nir,
                              nir_shader_get_entrypoint(tgsi.ir.nir));
 
-      variant->driver_shader = pipe->create_fs_state(pipe, &tgsi);
       variant->key = *key;
+      st_create_driver_shader(st, PIPE_SHADER_FRAGMENT, &tgsi, NULL,
+                              &variant->driver_shader, &variant->fence);
 
       return variant;
    }
@@ -1343,11 +1528,11 @@ st_create_fp_variant(struct st_context *st,
    }
 
    /* fill in variant */
-   variant->driver_shader = pipe->create_fs_state(pipe, &tgsi);
    variant->key = *key;
+   st_create_driver_shader(st, PIPE_SHADER_FRAGMENT, &tgsi,
+                           tgsi.tokens != stfp->tgsi.tokens ? tgsi.tokens : NULL,
+                           &variant->driver_shader, &variant->fence);
 
-   if (tgsi.tokens != stfp->tgsi.tokens)
-      tgsi_free_tokens(tgsi.tokens);
    return variant;
 }
 
@@ -1394,6 +1579,9 @@ st_get_fp_variant(struct st_context *st,
       }
    }
 
+   if (fpv && !st->compile.precompiling)
+      util_queue_fence_wait(&fpv->fence);
+
    return fpv;
 }
 
@@ -1634,7 +1822,6 @@ st_get_basic_variant(struct st_context *st,
                      unsigned pipe_shader,
                      struct st_common_program *prog)
 {
-   struct pipe_context *pipe = st->pipe;
    struct st_basic_variant *v;
    struct st_basic_variant_key key;
    struct pipe_shader_state tgsi = {0};
@@ -1662,13 +1849,8 @@ st_get_basic_variant(struct st_context *st,
          /* fill in new variant */
          switch (pipe_shader) {
          case PIPE_SHADER_TESS_CTRL:
-            v->driver_shader = pipe->create_tcs_state(pipe, &tgsi);
-            break;
          case PIPE_SHADER_TESS_EVAL:
-            v->driver_shader = pipe->create_tes_state(pipe, &tgsi);
-            break;
          case PIPE_SHADER_GEOMETRY:
-            v->driver_shader = pipe->create_gs_state(pipe, &tgsi);
             break;
          default:
             assert(!"unhandled shader type");
@@ -1676,6 +1858,9 @@ st_get_basic_variant(struct st_context *st,
             return NULL;
          }
 
+         util_queue_fence_init(&v->fence);
+         st_create_driver_shader(st, pipe_shader, &tgsi, NULL,
+                                 &v->driver_shader, &v->fence);
          v->key = key;
 
          /* insert into list */
@@ -1684,6 +1869,9 @@ st_get_basic_variant(struct st_context *st,
       }
    }
 
+   if (v && !st->compile.precompiling)
+      util_queue_fence_wait(&v->fence);
+
    return v;
 }
 
@@ -1819,7 +2007,6 @@ st_get_cp_variant(struct st_context *st,
                   struct pipe_compute_state *tgsi,
                   struct st_basic_variant **variants)
 {
-   struct pipe_context *pipe = st->pipe;
    struct st_basic_variant *v;
    struct st_basic_variant_key key;
 
@@ -1843,7 +2030,9 @@ st_get_cp_variant(struct st_context *st,
          struct pipe_compute_state cs = *tgsi;
          if (tgsi->ir_type == PIPE_SHADER_IR_NIR)
             cs.prog = nir_shader_clone(NULL, tgsi->prog);
-         v->driver_shader = pipe->create_compute_state(pipe, &cs);
+         util_queue_fence_init(&v->fence);
+         st_create_driver_shader(st, PIPE_SHADER_COMPUTE, &cs, NULL,
+                                 &v->driver_shader, &v->fence);
          v->key = key;
 
          /* insert into list */
@@ -1852,6 +2041,9 @@ st_get_cp_variant(struct st_context *st,
       }
    }
 
+   if (v && !st->compile.precompiling)
+      util_queue_fence_wait(&v->fence);
+
    return v;
 }
 
@@ -2038,11 +2230,12 @@ st_print_current_vertex_program(void)
 
 
 /**
- * Compile one shader variant.
+ * Get or create the variant used by default for \p prog, and return its
+ * driver shader.  That is NULL until the variant's fence has been waited
+ * for, if it is being created in the background.
  */
-void
-st_precompile_shader_variant(struct st_context *st,
-                             struct gl_program *prog)
+static void *
+get_default_variant(struct st_context *st, struct gl_program *prog)
 {
    switch (prog->Target) {
    case GL_VERTEX_PROGRAM_ARB: {
@@ -2052,26 +2245,29 @@ st_precompile_shader_variant(struct st_context *st,
       memset(&key, 0, sizeof(key));
 
       key.st = st->has_shareable_shaders ? NULL : st;
-      st_get_vp_variant(st, p, &key);
-      break;
+      struct st_vp_variant *v = st_get_vp_variant(st, p, &key);
+      return v ? v->driver_shader : NULL;
    }
 
    case GL_TESS_CONTROL_PROGRAM_NV: {
       struct st_common_program *p = st_common_program(prog);
-      st_get_basic_variant(st, PIPE_SHADER_TESS_CTRL, p);
-      break;
+      struct st_basic_variant *v =
+         st_get_basic_variant(st, PIPE_SHADER_TESS_CTRL, p);
+      return v ? v->driver_shader : NULL;
    }
 
    case GL_TESS_EVALUATION_PROGRAM_NV: {
       struct st_common_program *p = st_common_program(prog);
-      st_get_basic_variant(st, PIPE_SHADER_TESS_EVAL, p);
-      break;
+      struct st_basic_variant *v =
+         st_get_basic_variant(st, PIPE_SHADER_TESS_EVAL, p);
+      return v ? v->driver_shader : NULL;
    }
 
    case GL_GEOMETRY_PROGRAM_NV: {
       struct st_common_program *p = st_common_program(prog);
-      st_get_basic_variant(st, PIPE_SHADER_GEOMETRY, p);
-      break;
+      struct st_basic_variant *v =
+         st_get_basic_variant(st, PIPE_SHADER_GEOMETRY, p);
+      return v ? v->driver_shader : NULL;
    }
 
    case GL_FRAGMENT_PROGRAM_ARB: {
@@ -2081,17 +2277,46 @@ st_precompile_shader_variant(struct st_context *st,
       memset(&key, 0, sizeof(key));
 
       key.st = st->has_shareable_shaders ? NULL : st;
-      st_get_fp_variant(st, p, &key);
-      break;
+      struct st_fp_variant *v = st_get_fp_variant(st, p, &key);
+      return v ? v->driver_shader : NULL;
    }
 
    case GL_COMPUTE_PROGRAM_NV: {
       struct st_compute_program *p = (struct st_compute_program *)prog;
-      st_get_cp_variant(st, &p->tgsi, &p->variants);
-      break;
+      struct st_basic_variant *v =
+         st_get_cp_variant(st, &p->tgsi, &p->variants);
+      return v ? v->driver_shader : NULL;
    }
 
    default:
       assert(0);
+      return NULL;
    }
 }
+
+
+/**
+ * Compile one shader variant.
+ */
+void
+st_precompile_shader_variant(struct st_context *st,
+                             struct gl_program *prog)
+{
+   /* Let the driver shader be created in the background.  Everything using
+    * the variant waits for it, see st_create_driver_shader().
+    */
+   st->compile.precompiling = true;
+   get_default_variant(st, prog);
+   st->compile.precompiling = false;
+}
+
+
+/**
+ * Return the driver shader of the variant created by
+ * st_precompile_shader_variant(), compiling it first if needed.
+ */
+void *
+st_get_default_driver_shader(struct st_context *st, struct gl_program *prog)
+{
+   return get_default_variant(st, prog);
+}
@@ -123,6 +123,9 @@ struct st_fp_variant
    /** Driver's compiled shader */
    void *driver_shader;
 
+   /** Signalled once driver_shader is set, see st_create_driver_shader() */
+   struct util_queue_fence fence;
+
    /** For glBitmap variants */
    uint bitmap_sampler;
 
@@ -188,6 +191,9 @@ struct st_vp_variant
    /** Driver's compiled shader */
    void *driver_shader;
 
+   /** Signalled once driver_shader is set, see st_create_driver_shader() */
+   struct util_queue_fence fence;
+
    /** For using our private draw module (glRasterPos) */
    struct draw_vertex_shader *draw_shader;
 
@@ -199,6 +205,9 @@ struct st_vp_variant
 
    /** Bitfield of VERT_BIT_* bits of mesa vertex processing inputs */
    GLbitfield vert_attrib_mask;
+
+   /** Unique among all variants, for caching state derived from them */
+   unsigned id;
 };
 
 
@@ -254,6 +263,9 @@ struct st_basic_variant
 
    void *driver_shader;
 
+   /** Signalled once driver_shader is set, see st_create_driver_shader() */
+   struct util_queue_fence fence;
+
    struct st_basic_variant *next;
 };
 
@@ -454,6 +466,12 @@ extern void
 st_precompile_shader_variant(struct st_context *st,
                              struct gl_program *prog);
 
+extern void *
+st_get_default_driver_shader(struct st_context *st, struct gl_program *prog);
+
+extern void
+st_destroy_compile_queue(struct st_context *st);
+
 #ifdef __cplusplus
 }
 #endif
@@ -180,6 +180,18 @@ st_texture_get_current_sampler_view(const struct st_context *st,
 }
 
 
+/**
+ * Assign a new st_texture_object::view_stamp to the texture.
+ */
+void
+st_texture_update_view_stamp(struct st_texture_object *stObj)
+{
+   static unsigned next_stamp;
+
+   p_atomic_set(&stObj->view_stamp, p_atomic_inc_return(&next_stamp));
+}
+
+
 /**
  * For the given texture object, release any sampler views which belong
  * to the calling context.  This is used to free any sampler views
@@ -238,6 +250,7 @@ st_texture_release_all_sampler_views(struct st_context *st,
       }
    }
    views->count = 0;
+   st_texture_update_view_stamp(stObj);
    simple_mtx_unlock(&stObj->validate_mutex);
 }
 
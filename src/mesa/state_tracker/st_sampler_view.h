@@ -57,6 +57,9 @@ st_create_texture_sampler_view(struct pipe_context *pipe,
 }
 
 
+extern void
+st_texture_update_view_stamp(struct st_texture_object *stObj);
+
 extern void
 st_texture_release_context_sampler_view(struct st_context *st,
                                         struct st_texture_object *stObj);
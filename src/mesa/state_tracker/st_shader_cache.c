@@ -31,6 +31,7 @@
 #include "compiler/nir/nir_serialize.h"
 #include "pipe/p_shader_tokens.h"
 #include "program/ir_to_mesa.h"
+#include "tgsi/tgsi_from_mesa.h"
 #include "util/u_memory.h"
 
 void
@@ -61,22 +62,64 @@ write_tgsi_to_cache(struct blob *blob, const struct tgsi_token *tokens,
 {
    blob_write_uint32(blob, num_tokens);
    blob_write_bytes(blob, tokens, num_tokens * sizeof(struct tgsi_token));
-   copy_blob_to_driver_cache_blob(blob, prog);
 }
 
 static void
 write_nir_to_cache(struct blob *blob, struct gl_program *prog)
 {
-   nir_serialize(blob, prog->nir);
-   copy_blob_to_driver_cache_blob(blob, prog);
+   nir_serialize(blob, prog->nir, false);
 }
 
+/**
+ * Write the driver's binary of the default variant, if \p native is set and
+ * the driver can recreate shaders from it.  A size of 0 means there is none.
+ */
+static void
+write_driver_binary_to_cache(struct blob *blob, struct gl_context *ctx,
+                             struct gl_program *prog, bool native)
+{
+   struct st_context *st = st_context(ctx);
+   struct pipe_screen *screen = st->pipe->screen;
+   void *binary = NULL;
+   unsigned size = 0;
+
+   if (native && st->has_shareable_shaders &&
+       screen->get_shader_binary && screen->create_shader_from_binary) {
+      void *shader = st_get_default_driver_shader(st, prog);
+
+      if (shader) {
+         binary = screen->get_shader_binary(screen,
+               pipe_shader_type_from_mesa(prog->info.stage), shader, &size);
+      }
+   }
+
+   blob_write_uint32(blob, binary ? size : 0);
+   if (binary) {
+      blob_write_bytes(blob, binary, size);
+      free(binary);
+   }
+}
+
+/**
+ * Serialise the IR of \p prog into prog->driver_cache_blob.  For program
+ * binaries (\p native), the driver's final binary is included as well, so
+ * that glProgramBinary doesn't have to run the backend compiler again.
+ */
 static void
 st_serialise_ir_program(struct gl_context *ctx, struct gl_program *prog,
-                        bool nir)
+                        bool nir, bool native)
 {
-   if (prog->driver_cache_blob)
-      return;
+   if (prog->driver_cache_blob) {
+      /* The disk cache blob is created at link time, before there is a
+       * variant to take the driver binary from.
+       */
+      if (!native || !st_context(ctx)->pipe->screen->get_shader_binary)
+         return;
+
+      ralloc_free(prog->driver_cache_blob);
+      prog->driver_cache_blob = NULL;
+      prog->driver_cache_blob_size = 0;
+   }
 
    struct blob blob;
    blob_init(&blob);
@@ -140,6 +183,9 @@ st_serialise_ir_program(struct gl_context *ctx, struct gl_program *prog,
       unreachable("Unsupported stage");
    }
 
+   write_driver_binary_to_cache(&blob, ctx, prog, native);
+
+   copy_blob_to_driver_cache_blob(&blob, prog);
    blob_finish(&blob);
 }
 
@@ -160,7 +206,7 @@ st_store_ir_in_disk_cache(struct st_context *st, struct gl_program *prog,
    if (memcmp(prog->sh.data->sha1, zero, sizeof(prog->sh.data->sha1)) == 0)
       return;
 
-   st_serialise_ir_program(st->ctx, prog, nir);
+   st_serialise_ir_program(st->ctx, prog, nir, false);
 
    if (st->ctx->_Shader->Flags & GLSL_CACHE_INFO) {
       fprintf(stderr, "putting %s state tracker IR in cache\n",
@@ -352,6 +398,11 @@ st_deserialise_ir_program(struct gl_context *ctx,
       unreachable("Unsupported stage");
    }
 
+   unsigned binary_size = blob_read_uint32(&blob_reader);
+   const void *binary = NULL;
+   if (binary_size)
+      binary = blob_read_bytes(&blob_reader, binary_size);
+
    /* Make sure we don't try to read more data than we wrote. This should
     * never happen in release builds but its useful to have this check to
     * catch development bugs.
@@ -368,10 +419,19 @@ st_deserialise_ir_program(struct gl_context *ctx,
    st_set_prog_affected_state_flags(prog);
    _mesa_associate_uniform_storage(ctx, shProg, prog, false);
 
-   /* Create Gallium shaders now instead of on demand. */
-   if (ST_DEBUG & DEBUG_PRECOMPILE ||
-       st->shader_has_one_variant[prog->info.stage])
+   /* Create Gallium shaders now instead of on demand.  With a driver binary
+    * this doesn't need the backend compiler, so always do it then.
+    */
+   if (binary && !blob_reader.overrun &&
+       st->pipe->screen->create_shader_from_binary) {
+      st->compile.binary = binary;
+      st->compile.binary_size = binary_size;
       st_precompile_shader_variant(st, prog);
+      st->compile.binary = NULL;
+   } else if (ST_DEBUG & DEBUG_PRECOMPILE ||
+              st->shader_has_one_variant[prog->info.stage]) {
+      st_precompile_shader_variant(st, prog);
+   }
 }
 
 bool
@@ -412,7 +472,7 @@ st_load_ir_from_disk_cache(struct gl_context *ctx,
 void
 st_serialise_tgsi_program(struct gl_context *ctx, struct gl_program *prog)
 {
-   st_serialise_ir_program(ctx, prog, false);
+   st_serialise_ir_program(ctx, prog, false, false);
 }
 
 void
@@ -420,7 +480,7 @@ st_serialise_tgsi_program_binary(struct gl_context *ctx,
                                  struct gl_shader_program *shProg,
                                  struct gl_program *prog)
 {
-   st_serialise_ir_program(ctx, prog, false);
+   st_serialise_ir_program(ctx, prog, false, true);
 }
 
 void
@@ -434,7 +494,7 @@ st_deserialise_tgsi_program(struct gl_context *ctx,
 void
 st_serialise_nir_program(struct gl_context *ctx, struct gl_program *prog)
 {
-   st_serialise_ir_program(ctx, prog, true);
+   st_serialise_ir_program(ctx, prog, true, false);
 }
 
 void
@@ -442,7 +502,7 @@ st_serialise_nir_program_binary(struct gl_context *ctx,
                                 struct gl_shader_program *shProg,
                                 struct gl_program *prog)
 {
-   st_serialise_ir_program(ctx, prog, true);
+   st_serialise_ir_program(ctx, prog, true, true);
 }
 
 void
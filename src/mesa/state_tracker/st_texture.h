@@ -187,6 +187,14 @@ struct st_texture_object
      * the pipe_resource *pt above.
      */
     bool needs_validation;
+
+   /**
+    * Renewed whenever the sampler views of the texture are released, with a
+    * value unique among all texture objects.  A sampler view created for
+    * the texture remains usable as long as this doesn't change and pt is
+    * the same, see update_textures().
+    */
+   unsigned view_stamp;
 };
 
 
@@ -75,6 +75,18 @@ struct vbo_save_vertex_list {
    GLuint prim_count;
 
    struct vbo_save_primitive_store *prim_store;
+
+   /* The primitives above turned into indexed lists and merged into as few
+    * draws as possible, or NULL.  Strips and fans are split according to
+    * merged_provoking_vertex, when that is non-zero, so the merged draws
+    * may only be used while that convention is current.  Splitting line
+    * strips restarts the stipple pattern for each segment.
+    */
+   struct _mesa_prim *merged_prims;
+   GLuint merged_prim_count;
+   struct _mesa_index_buffer merged_ib;
+   GLenum16 merged_provoking_vertex;
+   bool merged_line_strips;
 };
 
 
@@ -524,6 +524,256 @@ update_vao(struct gl_context *ctx,
 }
 
 
+/**
+ * Return the independent primitive type that primitives of type \p mode
+ * become in merged draws, or GL_NONE if they can't be merged.
+ */
+static GLenum
+merged_prim_mode(GLenum mode, bool edgeflags)
+{
+   switch (mode) {
+   case GL_POINTS:
+      return GL_POINTS;
+   case GL_LINES:
+   case GL_LINE_STRIP:
+      return GL_LINES;
+   case GL_TRIANGLES:
+      return GL_TRIANGLES;
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+      /* Edge flags would start to apply to the split triangles. */
+      return edgeflags ? GL_NONE : GL_TRIANGLES;
+   case GL_QUADS:
+      return GL_QUADS;
+   default:
+      /* Split polygons would show their diagonals in GL_LINE polygon mode,
+       * and line loops have been turned into strips that may continue in
+       * the next vertex list.
+       */
+      return GL_NONE;
+   }
+}
+
+
+/**
+ * Return the number of indices write_merged_indices() writes for \p prim.
+ */
+static unsigned
+count_merged_indices(const struct _mesa_prim *prim)
+{
+   const GLuint count = prim->count;
+
+   switch (prim->mode) {
+   case GL_POINTS:
+      return count;
+   case GL_LINES:
+      return count & ~1u;
+   case GL_LINE_STRIP:
+      return count >= 2 ? 2 * (count - 1) : 0;
+   case GL_TRIANGLES:
+      return count - count % 3;
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+      return count >= 3 ? 3 * (count - 2) : 0;
+   case GL_QUADS:
+      return count & ~3u;
+   default:
+      unreachable("primitive type is not merged");
+   }
+}
+
+
+/**
+ * Write the indices drawing \p prim as merged_prim_mode(prim->mode).  The
+ * split triangles keep the winding of the strip or fan, and start or end
+ * with its provoking vertex depending on \p provoking_vertex.
+ */
+static void
+write_merged_indices(GLuint *indices, const struct _mesa_prim *prim,
+                     GLenum provoking_vertex)
+{
+   const GLuint start = prim->start;
+   const GLuint count = prim->count;
+   const bool last = provoking_vertex == GL_LAST_VERTEX_CONVENTION_EXT;
+
+   switch (prim->mode) {
+   case GL_LINE_STRIP:
+      for (GLuint i = 0; i + 1 < count; i++) {
+         *indices++ = start + i;
+         *indices++ = start + i + 1;
+      }
+      break;
+   case GL_TRIANGLE_STRIP:
+      for (GLuint i = 0; i + 2 < count; i++) {
+         if (i % 2 == 0) {
+            *indices++ = start + i;
+            *indices++ = start + i + 1;
+            *indices++ = start + i + 2;
+         } else if (last) {
+            *indices++ = start + i + 1;
+            *indices++ = start + i;
+            *indices++ = start + i + 2;
+         } else {
+            *indices++ = start + i;
+            *indices++ = start + i + 2;
+            *indices++ = start + i + 1;
+         }
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (GLuint i = 0; i + 2 < count; i++) {
+         if (last) {
+            *indices++ = start;
+            *indices++ = start + i + 1;
+            *indices++ = start + i + 2;
+         } else {
+            *indices++ = start + i + 1;
+            *indices++ = start + i + 2;
+            *indices++ = start;
+         }
+      }
+      break;
+   default: {
+      const unsigned num_indices = count_merged_indices(prim);
+      for (GLuint i = 0; i < num_indices; i++)
+         *indices++ = start + i;
+      break;
+   }
+   }
+}
+
+
+/**
+ * Turn the primitives of \p node into indexed lists stored in a buffer
+ * object of their own, and merge consecutive ones of the same type into a
+ * single draw.  Display lists made of many small glBegin/glEnd pairs then
+ * need only a few draws instead of one per pair.
+ */
+static void
+merge_vertex_list_prims(struct gl_context *ctx,
+                        struct vbo_save_vertex_list *node, bool edgeflags)
+{
+   const struct _mesa_prim *prims = node->prims;
+   GLenum provoking_vertex = 0;
+   bool line_strips = false;
+   unsigned num_indices = 0;
+   unsigned num_draws = 0;
+   GLenum mode = GL_NONE;
+
+   node->merged_prims = NULL;
+   node->merged_prim_count = 0;
+   memset(&node->merged_ib, 0, sizeof(node->merged_ib));
+   node->merged_provoking_vertex = 0;
+   node->merged_line_strips = false;
+
+   if (node->prim_count < 2)
+      return;
+
+   for (unsigned i = 0; i < node->prim_count; i++) {
+      const GLenum prim_mode = merged_prim_mode(prims[i].mode, edgeflags);
+
+      if (prim_mode == GL_NONE)
+         return;
+
+      if (prim_mode != mode) {
+         mode = prim_mode;
+         num_draws++;
+      }
+
+      if (prims[i].mode == GL_TRIANGLE_STRIP ||
+          prims[i].mode == GL_TRIANGLE_FAN)
+         provoking_vertex = ctx->Light.ProvokingVertex;
+      else if (prims[i].mode == GL_LINE_STRIP)
+         line_strips = true;
+
+      num_indices += count_merged_indices(&prims[i]);
+   }
+
+   if (num_draws == node->prim_count || num_indices == 0)
+      return;
+
+   GLuint *indices = malloc(num_indices * sizeof(GLuint));
+   struct _mesa_prim *merged = malloc(num_draws * sizeof(*merged));
+   if (!indices || !merged) {
+      free(indices);
+      free(merged);
+      return;
+   }
+
+   unsigned n = 0;
+   num_draws = 0;
+   mode = GL_NONE;
+
+   for (unsigned i = 0; i < node->prim_count; i++) {
+      const GLenum prim_mode = merged_prim_mode(prims[i].mode, edgeflags);
+
+      if (prim_mode != mode) {
+         /* Reuse the previous draw if its primitives were all degenerate. */
+         if (num_draws == 0 || merged[num_draws - 1].count != 0)
+            num_draws++;
+
+         struct _mesa_prim *draw = &merged[num_draws - 1];
+         memset(draw, 0, sizeof(*draw));
+         draw->mode = prim_mode;
+         draw->indexed = 1;
+         draw->begin = 1;
+         draw->end = 1;
+         draw->start = n;
+         draw->num_instances = 1;
+         mode = prim_mode;
+      }
+
+      const unsigned prim_indices = count_merged_indices(&prims[i]);
+      write_merged_indices(indices + n, &prims[i], provoking_vertex);
+      merged[num_draws - 1].count += prim_indices;
+      n += prim_indices;
+   }
+
+   if (merged[num_draws - 1].count == 0)
+      num_draws--;
+
+   /* Use 16-bit indices when possible.  0xffff is left out so that drivers
+    * can't mistake it for a restart index.
+    */
+   const unsigned index_size =
+      _vbo_save_get_max_index(node) < 0xffff ? 2 : 4;
+   void *data = indices;
+
+   if (index_size == 2) {
+      GLushort *indices16 = malloc(n * sizeof(GLushort));
+      if (indices16) {
+         for (unsigned i = 0; i < n; i++)
+            indices16[i] = indices[i];
+      }
+      free(indices);
+      data = indices16;
+   }
+
+   struct gl_buffer_object *obj = NULL;
+   if (data && num_draws > 0)
+      obj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID);
+
+   if (obj && ctx->Driver.BufferData(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                                     n * index_size, data, GL_STATIC_DRAW_ARB,
+                                     GL_DYNAMIC_STORAGE_BIT, obj)) {
+      node->merged_prims = merged;
+      node->merged_prim_count = num_draws;
+      node->merged_ib.count = n;
+      node->merged_ib.index_size = index_size;
+      node->merged_ib.obj = obj;
+      node->merged_ib.ptr = NULL;
+      node->merged_provoking_vertex = provoking_vertex;
+      node->merged_line_strips = line_strips;
+   } else {
+      /* Just draw the primitives one by one. */
+      _mesa_reference_buffer_object(ctx, &obj, NULL);
+      free(merged);
+   }
+
+   free(data);
+}
+
+
 /**
  * Insert the active immediate struct onto the display list currently
  * being built.
@@ -653,6 +903,9 @@ compile_vertex_list(struct gl_context *ctx)
       node->prims[i].start += start_offset;
    }
 
+   merge_vertex_list_prims(ctx, node,
+                           save->enabled & BITFIELD64_BIT(VBO_ATTRIB_EDGEFLAG));
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1845,6 +2098,10 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
 
    free(node->current_data);
    node->current_data = NULL;
+
+   free(node->merged_prims);
+   node->merged_prims = NULL;
+   _mesa_reference_buffer_object(ctx, &node->merged_ib.obj, NULL);
 }
 
 
@@ -1872,6 +2129,11 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data, FILE *f)
              (prim->begin) ? "BEGIN" : "(wrap)",
              (prim->end) ? "END" : "(wrap)");
    }
+
+   if (node->merged_prims) {
+      fprintf(f, "   merged into %u indexed draws, %u indices\n",
+              node->merged_prim_count, node->merged_ib.count);
+   }
 }
 
 
@@ -117,6 +117,32 @@ playback_copy_to_current(struct gl_context *ctx,
 
 
 
+/**
+ * Return whether the merged draws of \p node can be used with the current
+ * state, see merge_vertex_list_prims().
+ */
+static bool
+use_merged_prims(const struct gl_context *ctx,
+                 const struct vbo_save_vertex_list *node)
+{
+   if (!node->merged_prims)
+      return false;
+
+   /* The merged indices could contain the restart index. */
+   if (ctx->Array._PrimitiveRestart)
+      return false;
+
+   if (node->merged_provoking_vertex &&
+       node->merged_provoking_vertex != ctx->Light.ProvokingVertex)
+      return false;
+
+   if (node->merged_line_strips && ctx->Line.StippleFlag)
+      return false;
+
+   return true;
+}
+
+
 /**
  * Set the appropriate VAO to draw.
  */
@@ -212,8 +238,15 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       if (node->vertex_count > 0) {
          GLuint min_index = _vbo_save_get_min_index(node);
          GLuint max_index = _vbo_save_get_max_index(node);
-         ctx->Driver.Draw(ctx, node->prims, node->prim_count, NULL, GL_TRUE,
-                          min_index, max_index, NULL, 0, NULL);
+
+         if (use_merged_prims(ctx, node)) {
+            ctx->Driver.Draw(ctx, node->merged_prims, node->merged_prim_count,
+                             &node->merged_ib, GL_TRUE, min_index, max_index,
+                             NULL, 0, NULL);
+         } else {
+            ctx->Driver.Draw(ctx, node->prims, node->prim_count, NULL,
+                             GL_TRUE, min_index, max_index, NULL, 0, NULL);
+         }
       }
    }
 
@@ -0,0 +1,261 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* zlib is only a dependency of the build when the shader cache is enabled. */
+#ifdef ENABLE_SHADER_CACHE
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include "zlib.h"
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "util/macros.h"
+
+#include "compress.h"
+
+/* Zstd level 1 is about as fast as LZ4 to decompress but compresses much
+ * better, higher levels mostly cost compile-time stalls on the cache thread.
+ */
+#define ZSTD_COMPRESSION_LEVEL 1
+
+bool
+util_compress_codec_supported(enum util_compress_codec codec)
+{
+   switch (codec) {
+   case UTIL_COMPRESS_NONE:
+   case UTIL_COMPRESS_DEFLATE:
+      return true;
+   case UTIL_COMPRESS_LZ4:
+#ifdef HAVE_LZ4
+      return true;
+#else
+      return false;
+#endif
+   case UTIL_COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   return false;
+}
+
+static const char *const codec_names[] = {
+   [UTIL_COMPRESS_NONE]    = "none",
+   [UTIL_COMPRESS_DEFLATE] = "deflate",
+   [UTIL_COMPRESS_LZ4]     = "lz4",
+   [UTIL_COMPRESS_ZSTD]    = "zstd",
+};
+
+const char *
+util_compress_codec_name(enum util_compress_codec codec)
+{
+   if (codec >= ARRAY_SIZE(codec_names))
+      return "unknown";
+
+   return codec_names[codec];
+}
+
+bool
+util_compress_codec_from_name(const char *name,
+                              enum util_compress_codec *codec)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(codec_names); i++) {
+      if (strcmp(name, codec_names[i]) == 0) {
+         if (!util_compress_codec_supported(i))
+            return false;
+
+         *codec = i;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+size_t
+util_compress_max_compressed_len(enum util_compress_codec codec,
+                                 size_t in_size)
+{
+   switch (codec) {
+   case UTIL_COMPRESS_NONE:
+      return in_size;
+   case UTIL_COMPRESS_DEFLATE:
+      /* deflateBound() needs an initialized stream, compressBound() gives
+       * the bound for the default parameters we use below.
+       */
+      return compressBound(in_size);
+   case UTIL_COMPRESS_LZ4:
+#ifdef HAVE_LZ4
+      if (in_size > LZ4_MAX_INPUT_SIZE)
+         return 0;
+      return LZ4_compressBound(in_size);
+#else
+      break;
+#endif
+   case UTIL_COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+      return ZSTD_compressBound(in_size);
+#else
+      break;
+#endif
+   }
+
+   return 0;
+}
+
+static size_t
+deflate_buffer(const void *in, size_t in_size, void *out, size_t out_size)
+{
+   z_stream strm;
+   memset(&strm, 0, sizeof(strm));
+
+   if (in_size > UINT_MAX || out_size > UINT_MAX)
+      return 0;
+
+   if (deflateInit(&strm, Z_BEST_COMPRESSION) != Z_OK)
+      return 0;
+
+   strm.next_in = (Bytef *) in;
+   strm.avail_in = in_size;
+   strm.next_out = out;
+   strm.avail_out = out_size;
+
+   /* The output buffer is big enough for all of it, so a single call must
+    * finish the stream.
+    */
+   int ret = deflate(&strm, Z_FINISH);
+   size_t compressed_size = out_size - strm.avail_out;
+
+   (void)deflateEnd(&strm);
+
+   return ret == Z_STREAM_END ? compressed_size : 0;
+}
+
+static bool
+inflate_buffer(const void *in, size_t in_size, void *out, size_t out_size)
+{
+   z_stream strm;
+   memset(&strm, 0, sizeof(strm));
+
+   if (in_size > UINT_MAX || out_size > UINT_MAX)
+      return false;
+
+   if (inflateInit(&strm) != Z_OK)
+      return false;
+
+   strm.next_in = (Bytef *) in;
+   strm.avail_in = in_size;
+   strm.next_out = out;
+   strm.avail_out = out_size;
+
+   int ret = inflate(&strm, Z_FINISH);
+   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+
+   (void)inflateEnd(&strm);
+
+   /* Unless there was an error we should have decompressed everything in one
+    * go as we know the uncompressed size.
+    */
+   return ret == Z_STREAM_END && strm.avail_out == 0;
+}
+
+size_t
+util_compress(enum util_compress_codec codec,
+              const void *in, size_t in_size, void *out, size_t out_size)
+{
+   switch (codec) {
+   case UTIL_COMPRESS_NONE:
+      if (out_size < in_size)
+         return 0;
+      memcpy(out, in, in_size);
+      return in_size;
+   case UTIL_COMPRESS_DEFLATE:
+      return deflate_buffer(in, in_size, out, out_size);
+   case UTIL_COMPRESS_LZ4:
+#ifdef HAVE_LZ4
+      if (in_size > LZ4_MAX_INPUT_SIZE || out_size > INT_MAX)
+         return 0;
+      return MAX2(LZ4_compress_default(in, out, in_size, out_size), 0);
+#else
+      break;
+#endif
+   case UTIL_COMPRESS_ZSTD: {
+#ifdef HAVE_ZSTD
+      size_t ret = ZSTD_compress(out, out_size, in, in_size,
+                                 ZSTD_COMPRESSION_LEVEL);
+      return ZSTD_isError(ret) ? 0 : ret;
+#else
+      break;
+#endif
+   }
+   }
+
+   return 0;
+}
+
+bool
+util_decompress(enum util_compress_codec codec,
+                const void *in, size_t in_size, void *out, size_t out_size)
+{
+   switch (codec) {
+   case UTIL_COMPRESS_NONE:
+      if (in_size != out_size)
+         return false;
+      memcpy(out, in, in_size);
+      return true;
+   case UTIL_COMPRESS_DEFLATE:
+      return inflate_buffer(in, in_size, out, out_size);
+   case UTIL_COMPRESS_LZ4:
+#ifdef HAVE_LZ4
+      if (in_size > INT_MAX || out_size > INT_MAX)
+         return false;
+      return LZ4_decompress_safe(in, out, in_size, out_size) == (int) out_size;
+#else
+      break;
+#endif
+   case UTIL_COMPRESS_ZSTD: {
+#ifdef HAVE_ZSTD
+      size_t ret = ZSTD_decompress(out, out_size, in, in_size);
+      return !ZSTD_isError(ret) && ret == out_size;
+#else
+      break;
+#endif
+   }
+   }
+
+   return false;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef UTIL_COMPRESS_H
+#define UTIL_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The values are stored in on-disk cache entries, so never renumber them. */
+enum util_compress_codec {
+   UTIL_COMPRESS_NONE    = 0,
+   UTIL_COMPRESS_DEFLATE = 1,
+   UTIL_COMPRESS_LZ4     = 2,
+   UTIL_COMPRESS_ZSTD    = 3,
+};
+
+/** Whether support for \codec was built in. */
+bool
+util_compress_codec_supported(enum util_compress_codec codec);
+
+const char *
+util_compress_codec_name(enum util_compress_codec codec);
+
+/**
+ * Parse a codec name as returned by util_compress_codec_name().
+ *
+ * \return false if the name is unknown or the codec is not supported.
+ */
+bool
+util_compress_codec_from_name(const char *name,
+                              enum util_compress_codec *codec);
+
+/**
+ * Upper bound of the size of \in_size bytes of data once compressed.
+ */
+size_t
+util_compress_max_compressed_len(enum util_compress_codec codec,
+                                 size_t in_size);
+
+/**
+ * Compress \in_size bytes from \in into \out, which must be able to hold
+ * util_compress_max_compressed_len() bytes.
+ *
+ * \return The compressed size, or 0 on failure.
+ */
+size_t
+util_compress(enum util_compress_codec codec,
+              const void *in, size_t in_size, void *out, size_t out_size);
+
+/**
+ * Decompress \in_size bytes from \in into \out.  The decompressed data is
+ * expected to be exactly \out_size bytes.
+ */
+bool
+util_decompress(enum util_compress_codec codec,
+                const void *in, size_t in_size, void *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UTIL_COMPRESS_H */
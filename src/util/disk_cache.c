@@ -37,12 +37,14 @@
 #include <pwd.h>
 #include <errno.h>
 #include <dirent.h>
-#include "zlib.h"
 
+#include "util/compress.h"
 #include "util/crc32.h"
 #include "util/debug.h"
+#include "util/list.h"
 #include "util/rand_xor.h"
 #include "util/u_atomic.h"
+#include "util/u_dynarray.h"
 #include "util/u_queue.h"
 #include "util/mesa-sha1.h"
 #include "util/ralloc.h"
@@ -50,6 +52,7 @@
 #include "main/errors.h"
 
 #include "disk_cache.h"
+#include "disk_cache_pack.h"
 
 /* Number of bits to mask off from a cache key to get an index. */
 #define CACHE_INDEX_KEY_BITS 16
@@ -72,7 +75,15 @@
  * - There is no strict requirement that cache versions be backwards
  *   compatible but effort should be taken to limit disruption where possible.
  */
-#define CACHE_VERSION 1
+#define CACHE_VERSION 2
+
+/* How long puts to pack file storage are held back by default so that they
+ * can be written out together, (in milliseconds).
+ */
+#define WRITE_COMBINE_DEFAULT_INTERVAL_MS 100
+
+/* Amount of pending data that triggers a write before the interval is up. */
+#define WRITE_COMBINE_MAX_PENDING_SIZE (4 * 1024 * 1024)
 
 struct disk_cache {
    /* The path to the cache directory. */
@@ -98,6 +109,23 @@ struct disk_cache {
    /* Maximum size of all cached objects (in bytes). */
    uint64_t max_size;
 
+   /* Pack file storage, NULL when every entry is stored in its own file. */
+   struct disk_cache_pack *pack;
+
+   /* Codec new entries are compressed with. */
+   enum util_compress_codec codec;
+
+   /* Write combining of pack file puts, see cache_flush(). Disabled when
+    * flush_interval_ms is 0. The lock protects all of the fields below it.
+    */
+   unsigned flush_interval_ms;
+   mtx_t pending_lock;
+   cnd_t pending_cond;
+   struct list_head pending_jobs;
+   size_t pending_size;
+   bool flush_queued;
+   bool flush_now;
+
    /* Driver cache keys. */
    uint8_t *driver_keys_blob;
    size_t driver_keys_blob_size;
@@ -120,6 +148,20 @@ struct disk_cache_put_job {
    size_t size;
 
    struct cache_item_metadata cache_item_metadata;
+
+   /* Whether data already is a serialized cache entry, (as found in an
+    * archive being imported), rather than an item to be serialized.
+    */
+   bool serialized;
+
+   /* Link in disk_cache::pending_jobs while waiting to be write combined. */
+   struct list_head link;
+};
+
+struct disk_cache_flush_job {
+   struct util_queue_fence fence;
+
+   struct disk_cache *cache;
 };
 
 /* Create a directory named 'path' if it does not already exist.
@@ -368,12 +410,52 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
 
    cache->max_size = max_size;
 
+   /* Optionally store entries in a few pack files instead of one file per
+    * entry. If the pack files can't be set up we just fall back to the
+    * regular layout.
+    */
+   if (env_var_as_boolean("MESA_GLSL_CACHE_PACK", false))
+      cache->pack = disk_cache_pack_open(cache, cache->path, max_size);
+
+   /* Pack files are mapped directly by disk_cache_get_view(), so keep
+    * entries uncompressed there by default. Entries record the codec they
+    * were written with, so changing it doesn't invalidate the cache.
+    */
+   if (cache->pack)
+      cache->codec = UTIL_COMPRESS_NONE;
+   else if (util_compress_codec_supported(UTIL_COMPRESS_ZSTD))
+      cache->codec = UTIL_COMPRESS_ZSTD;
+   else
+      cache->codec = UTIL_COMPRESS_DEFLATE;
+
+   const char *codec_str = getenv("MESA_GLSL_CACHE_COMPRESSION");
+   if (codec_str &&
+       !util_compress_codec_from_name(codec_str, &cache->codec)) {
+      fprintf(stderr, "Mesa: unsupported shader cache compression '%s', "
+              "using '%s'.\n", codec_str,
+              util_compress_codec_name(cache->codec));
+   }
+
    /* 1 thread was chosen because we don't really care about getting things
     * to disk quickly just that it's not blocking other tasks.
     *
     * The queue will resize automatically when it's full, so adding new jobs
     * doesn't stall.
     */
+   /* Pack file writes have to take the index lock, so rather than doing
+    * that for every single put we collect them for a short while and write
+    * them out as one batch.
+    */
+   if (cache->pack) {
+      cache->flush_interval_ms =
+         env_var_as_unsigned("MESA_GLSL_CACHE_FLUSH_INTERVAL",
+                             WRITE_COMBINE_DEFAULT_INTERVAL_MS);
+   }
+
+   mtx_init(&cache->pending_lock, mtx_plain);
+   cnd_init(&cache->pending_cond);
+   list_inithead(&cache->pending_jobs);
+
    util_queue_init(&cache->cache_queue, "disk$", 32, 1,
                    UTIL_QUEUE_INIT_RESIZE_IF_FULL |
                    UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY |
@@ -435,8 +517,23 @@ void
 disk_cache_destroy(struct disk_cache *cache)
 {
    if (cache && !cache->path_init_failed) {
+      /* Make the pending flush job, if any, write out what it has got right
+       * away, so that the entries aren't lost.
+       */
+      if (cache->flush_interval_ms) {
+         mtx_lock(&cache->pending_lock);
+         cache->flush_now = true;
+         cnd_broadcast(&cache->pending_cond);
+         mtx_unlock(&cache->pending_lock);
+
+         util_queue_finish(&cache->cache_queue);
+      }
+
       util_queue_destroy(&cache->cache_queue);
+      mtx_destroy(&cache->pending_lock);
+      cnd_destroy(&cache->pending_cond);
       munmap(cache->index_mmap, cache->index_mmap_size);
+      disk_cache_pack_close(cache->pack);
    }
 
    ralloc_free(cache);
@@ -671,6 +768,11 @@ disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
    struct stat sb;
 
+   if (cache->pack) {
+      disk_cache_pack_remove(cache->pack, key);
+      return;
+   }
+
    char *filename = get_cache_file(cache, key);
    if (filename == NULL) {
       return;
@@ -718,73 +820,33 @@ write_all(int fd, const void *buf, size_t count)
    return done;
 }
 
-/* From the zlib docs:
- *    "If the memory is available, buffers sizes on the order of 128K or 256K
- *    bytes should be used."
+/* Destination a cache entry is serialized to, either a file or a memory
+ * buffer that then gets appended to a pack file.
  */
-#define BUFSIZE 256 * 1024
+struct cache_entry_writer {
+   bool (*write)(struct cache_entry_writer *writer,
+                 const void *data, size_t size);
+   int fd;
+   struct util_dynarray buf;
+};
 
-/**
- * Compresses cache entry in memory and writes it to disk. Returns the size
- * of the data written to disk.
- */
-static size_t
-deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
-                          const char *filename)
+static bool
+write_entry_to_fd(struct cache_entry_writer *writer,
+                  const void *data, size_t size)
 {
-   unsigned char out[BUFSIZE];
-
-   /* allocate deflate state */
-   z_stream strm;
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = (uint8_t *) in_data;
-   strm.avail_in = in_data_size;
-
-   int ret = deflateInit(&strm, Z_BEST_COMPRESSION);
-   if (ret != Z_OK)
-       return 0;
-
-   /* compress until end of in_data */
-   size_t compressed_size = 0;
-   int flush;
-   do {
-      int remaining = in_data_size - BUFSIZE;
-      flush = remaining > 0 ? Z_NO_FLUSH : Z_FINISH;
-      in_data_size -= BUFSIZE;
-
-      /* Run deflate() on input until the output buffer is not full (which
-       * means there is no more data to deflate).
-       */
-      do {
-         strm.avail_out = BUFSIZE;
-         strm.next_out = out;
-
-         ret = deflate(&strm, flush);    /* no bad return value */
-         assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-
-         size_t have = BUFSIZE - strm.avail_out;
-         compressed_size += have;
-
-         ssize_t written = write_all(dest, out, have);
-         if (written == -1) {
-            (void)deflateEnd(&strm);
-            return 0;
-         }
-      } while (strm.avail_out == 0);
-
-      /* all input should be used */
-      assert(strm.avail_in == 0);
-
-   } while (flush != Z_FINISH);
+   return write_all(writer->fd, data, size) != -1;
+}
 
-   /* stream should be complete */
-   assert(ret == Z_STREAM_END);
+static bool
+write_entry_to_buffer(struct cache_entry_writer *writer,
+                      const void *data, size_t size)
+{
+   void *dst = util_dynarray_grow(&writer->buf, size);
+   if (writer->buf.data == NULL)
+      return false;
 
-   /* clean up and return */
-   (void)deflateEnd(&strm);
-   return compressed_size;
+   memcpy(dst, data, size);
+   return true;
 }
 
 static struct disk_cache_put_job *
@@ -801,6 +863,7 @@ create_put_job(struct disk_cache *cache, const cache_key key,
       dc_job->data = dc_job + 1;
       memcpy(dc_job->data, data, size);
       dc_job->size = size;
+      dc_job->serialized = false;
 
       /* Copy the cache item metadata */
       if (cache_item_metadata) {
@@ -846,8 +909,104 @@ destroy_put_job(void *job, int thread_index)
 struct cache_entry_file_data {
    uint32_t crc32;
    uint32_t uncompressed_size;
+
+   /* The enum util_compress_codec the payload was compressed with. */
+   uint32_t codec;
 };
 
+/**
+ * Serializes the cache entry of a put job, (header, metadata and compressed
+ * payload). Returns false if anything could not be written.
+ */
+static bool
+write_cache_entry(struct disk_cache_put_job *dc_job,
+                  struct cache_entry_writer *writer)
+{
+   if (dc_job->serialized)
+      return writer->write(writer, dc_job->data, dc_job->size);
+
+   /* Write the driver_keys_blob, this can be used find information about the
+    * mesa version that produced the entry or deal with hash collisions,
+    * should that ever become a real problem.
+    */
+   if (!writer->write(writer, dc_job->cache->driver_keys_blob,
+                      dc_job->cache->driver_keys_blob_size))
+      return false;
+
+   /* Write the cache item metadata. This data can be used to deal with
+    * hash collisions, as well as providing useful information to 3rd party
+    * tools reading the cache files.
+    */
+   if (!writer->write(writer, &dc_job->cache_item_metadata.type,
+                      sizeof(uint32_t)))
+      return false;
+
+   if (dc_job->cache_item_metadata.type == CACHE_ITEM_TYPE_GLSL) {
+      if (!writer->write(writer, &dc_job->cache_item_metadata.num_keys,
+                         sizeof(uint32_t)))
+         return false;
+
+      if (!writer->write(writer, dc_job->cache_item_metadata.keys[0],
+                         dc_job->cache_item_metadata.num_keys *
+                         sizeof(cache_key)))
+         return false;
+   }
+
+   /* Create CRC of the data. We will read this when restoring the cache and
+    * use it to check for corruption.
+    */
+   struct cache_entry_file_data cf_data;
+   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
+   cf_data.uncompressed_size = dc_job->size;
+
+   cf_data.codec = dc_job->cache->codec;
+
+   if (cf_data.codec == UTIL_COMPRESS_NONE) {
+      return writer->write(writer, &cf_data, sizeof(cf_data)) &&
+             writer->write(writer, dc_job->data, dc_job->size);
+   }
+
+   size_t max_size =
+      util_compress_max_compressed_len(cf_data.codec, dc_job->size);
+   void *compressed = malloc(max_size);
+   if (!compressed)
+      return false;
+
+   size_t compressed_size = util_compress(cf_data.codec,
+                                          dc_job->data, dc_job->size,
+                                          compressed, max_size);
+
+   bool ret = compressed_size != 0 &&
+              writer->write(writer, &cf_data, sizeof(cf_data)) &&
+              writer->write(writer, compressed, compressed_size);
+
+   free(compressed);
+   return ret;
+}
+
+/* Variant of cache_put() for caches using pack file storage. */
+static void
+cache_put_pack(struct disk_cache_put_job *dc_job)
+{
+   struct disk_cache_pack *pack = dc_job->cache->pack;
+
+   if (disk_cache_pack_contains(pack, dc_job->key))
+      return;
+
+   struct cache_entry_writer writer = {
+      .write = write_entry_to_buffer,
+      .fd = -1,
+   };
+   util_dynarray_init(&writer.buf, NULL);
+
+   if (write_cache_entry(dc_job, &writer)) {
+      disk_cache_pack_write(pack, dc_job->key, writer.buf.data,
+                            writer.buf.size);
+   }
+
+   util_dynarray_fini(&writer.buf);
+}
+
 static void
 cache_put(void *job, int thread_index)
 {
@@ -858,6 +1017,11 @@ cache_put(void *job, int thread_index)
    char *filename = NULL, *filename_tmp = NULL;
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
 
+   if (dc_job->cache->pack) {
+      cache_put_pack(dc_job);
+      return;
+   }
+
    filename = get_cache_file(dc_job->cache, dc_job->key);
    if (filename == NULL)
       goto done;
@@ -914,68 +1078,16 @@ cache_put(void *job, int thread_index)
    /* OK, we're now on the hook to write out a file that we know is
     * not in the cache, and is also not being written out to the cache
     * by some other process.
+    *
+    * Write out the contents to the temporary file, then rename them
+    * atomically to the destination filename, and also perform an atomic
+    * increment of the total cache size.
     */
-
-   /* Write the driver_keys_blob, this can be used find information about the
-    * mesa version that produced the entry or deal with hash collisions,
-    * should that ever become a real problem.
-    */
-   ret = write_all(fd, dc_job->cache->driver_keys_blob,
-                   dc_job->cache->driver_keys_blob_size);
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   /* Write the cache item metadata. This data can be used to deal with
-    * hash collisions, as well as providing useful information to 3rd party
-    * tools reading the cache files.
-    */
-   ret = write_all(fd, &dc_job->cache_item_metadata.type,
-                   sizeof(uint32_t));
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   if (dc_job->cache_item_metadata.type == CACHE_ITEM_TYPE_GLSL) {
-      ret = write_all(fd, &dc_job->cache_item_metadata.num_keys,
-                      sizeof(uint32_t));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-
-      ret = write_all(fd, dc_job->cache_item_metadata.keys[0],
-                      dc_job->cache_item_metadata.num_keys *
-                      sizeof(cache_key));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-   }
-
-   /* Create CRC of the data. We will read this when restoring the cache and
-    * use it to check for corruption.
-    */
-   struct cache_entry_file_data cf_data;
-   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
-   cf_data.uncompressed_size = dc_job->size;
-
-   size_t cf_data_size = sizeof(cf_data);
-   ret = write_all(fd, &cf_data, cf_data_size);
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   /* Now, finally, write out the contents to the temporary file, then
-    * rename them atomically to the destination filename, and also
-    * perform an atomic increment of the total cache size.
-    */
-   size_t file_size = deflate_and_write_to_disk(dc_job->data, dc_job->size,
-                                                fd, filename_tmp);
-   if (file_size == 0) {
+   struct cache_entry_writer writer = {
+      .write = write_entry_to_fd,
+      .fd = fd,
+   };
+   if (!write_cache_entry(dc_job, &writer)) {
       unlink(filename_tmp);
       goto done;
    }
@@ -1006,6 +1118,143 @@ cache_put(void *job, int thread_index)
    free(filename);
 }
 
+/* Writes out a list of put jobs to pack file storage with a single
+ * disk_cache_pack_write_batch() call and frees them.
+ */
+static void
+cache_put_pack_batch(struct disk_cache *cache, struct list_head *jobs)
+{
+   unsigned count = 0;
+   list_for_each_entry(struct disk_cache_put_job, dc_job, jobs, link)
+      count++;
+
+   struct disk_cache_pack_entry *entries =
+      malloc(count * sizeof(struct disk_cache_pack_entry));
+   size_t *offsets = malloc(count * sizeof(size_t));
+
+   struct cache_entry_writer writer = {
+      .write = write_entry_to_buffer,
+      .fd = -1,
+   };
+   util_dynarray_init(&writer.buf, NULL);
+
+   unsigned n = 0;
+   list_for_each_entry(struct disk_cache_put_job, dc_job, jobs, link) {
+      if (!entries || !offsets)
+         break;
+
+      /* The same entry may have been put more than once in a row. */
+      bool duplicate = false;
+      for (unsigned i = 0; i < n; i++) {
+         if (memcmp(entries[i].key, dc_job->key, CACHE_KEY_SIZE) == 0) {
+            duplicate = true;
+            break;
+         }
+      }
+
+      if (duplicate || disk_cache_pack_contains(cache->pack, dc_job->key))
+         continue;
+
+      size_t offset = writer.buf.size;
+      if (!write_cache_entry(dc_job, &writer)) {
+         writer.buf.size = offset;
+         continue;
+      }
+
+      memcpy(entries[n].key, dc_job->key, CACHE_KEY_SIZE);
+      entries[n].size = writer.buf.size - offset;
+      offsets[n] = offset;
+      n++;
+   }
+
+   /* Only point into the buffer once it stopped growing. */
+   for (unsigned i = 0; i < n; i++)
+      entries[i].data = (uint8_t *) writer.buf.data + offsets[i];
+
+   if (n > 0)
+      disk_cache_pack_write_batch(cache->pack, entries, n);
+
+   util_dynarray_fini(&writer.buf);
+   free(offsets);
+   free(entries);
+
+   list_for_each_entry_safe(struct disk_cache_put_job, dc_job, jobs, link)
+      destroy_put_job(dc_job, 0);
+}
+
+/* Waits for the write combining interval to pass, (or for enough data to
+ * pile up), then writes out all pending puts at once.
+ */
+static void
+cache_flush(void *job, int thread_index)
+{
+   struct disk_cache_flush_job *flush_job = (struct disk_cache_flush_job *) job;
+   struct disk_cache *cache = flush_job->cache;
+   struct list_head jobs;
+   struct timespec deadline;
+
+   timespec_get(&deadline, TIME_UTC);
+   deadline.tv_sec += cache->flush_interval_ms / 1000;
+   deadline.tv_nsec += (cache->flush_interval_ms % 1000) * 1000000;
+   if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+   }
+
+   mtx_lock(&cache->pending_lock);
+   while (!cache->flush_now &&
+          cache->pending_size < WRITE_COMBINE_MAX_PENDING_SIZE) {
+      if (cnd_timedwait(&cache->pending_cond, &cache->pending_lock,
+                        &deadline) != thrd_success)
+         break;
+   }
+
+   /* Take over the pending jobs, later puts queue a new flush job. */
+   list_replace(&cache->pending_jobs, &jobs);
+   list_inithead(&cache->pending_jobs);
+   cache->pending_size = 0;
+   cache->flush_queued = false;
+   mtx_unlock(&cache->pending_lock);
+
+   cache_put_pack_batch(cache, &jobs);
+}
+
+static void
+destroy_flush_job(void *job, int thread_index)
+{
+   free(job);
+}
+
+/* Adds a put job to the list of pending pack writes, making sure a flush
+ * job is queued to write it out.
+ */
+static void
+cache_put_combined(struct disk_cache *cache,
+                   struct disk_cache_put_job *dc_job)
+{
+   struct disk_cache_flush_job *flush_job = NULL;
+
+   mtx_lock(&cache->pending_lock);
+   list_addtail(&dc_job->link, &cache->pending_jobs);
+   cache->pending_size += dc_job->size;
+
+   if (!cache->flush_queued) {
+      flush_job = malloc(sizeof(struct disk_cache_flush_job));
+      if (flush_job)
+         cache->flush_queued = true;
+   } else if (cache->pending_size >= WRITE_COMBINE_MAX_PENDING_SIZE) {
+      cnd_signal(&cache->pending_cond);
+   }
+   mtx_unlock(&cache->pending_lock);
+
+   if (flush_job) {
+      flush_job->cache = cache;
+      util_queue_fence_init(&flush_job->fence);
+      util_queue_add_job(&cache->cache_queue, flush_job, &flush_job->fence,
+                         cache_flush, destroy_flush_job);
+   }
+}
+
 void
 disk_cache_put(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
@@ -1022,7 +1271,12 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    struct disk_cache_put_job *dc_job =
       create_put_job(cache, key, data, size, cache_item_metadata);
 
-   if (dc_job) {
+   if (!dc_job)
+      return;
+
+   if (cache->flush_interval_ms) {
+      cache_put_combined(cache, dc_job);
+   } else {
       util_queue_fence_init(&dc_job->fence);
       util_queue_add_job(&cache->cache_queue, dc_job, &dc_job->fence,
                          cache_put, destroy_put_job);
@@ -1030,53 +1284,149 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
 }
 
 /**
- * Decompresses cache entry, returns true if successful.
+ * Validates the header of a serialized cache entry and locates its payload.
+ *
+ * \return false if the entry is truncated or was written by a different
+ * driver build.
  */
 static bool
-inflate_cache_data(uint8_t *in_data, size_t in_data_size,
-                   uint8_t *out_data, size_t out_data_size)
+parse_cache_entry(struct disk_cache *cache, const uint8_t *entry,
+                  size_t entry_size, struct cache_entry_file_data *cf_data,
+                  const uint8_t **payload, size_t *payload_size)
 {
-   z_stream strm;
-
-   /* allocate inflate state */
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = in_data;
-   strm.avail_in = in_data_size;
-   strm.next_out = out_data;
-   strm.avail_out = out_data_size;
-
-   int ret = inflateInit(&strm);
-   if (ret != Z_OK)
+   const uint8_t *end = entry + entry_size;
+
+   size_t ck_size = cache->driver_keys_blob_size;
+   if (entry_size < ck_size)
       return false;
 
-   ret = inflate(&strm, Z_NO_FLUSH);
-   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+   /* Check for extremely unlikely hash collisions */
+   if (memcmp(cache->driver_keys_blob, entry, ck_size) != 0) {
+      assert(!"Mesa cache keys mismatch!");
+      return false;
+   }
+   entry += ck_size;
 
-   /* Unless there was an error we should have decompressed everything in one
-    * go as we know the uncompressed file size.
-    */
-   if (ret != Z_STREAM_END) {
-      (void)inflateEnd(&strm);
+   uint32_t md_type;
+   if (end - entry < sizeof(md_type))
       return false;
+   memcpy(&md_type, entry, sizeof(md_type));
+   entry += sizeof(md_type);
+
+   if (md_type == CACHE_ITEM_TYPE_GLSL) {
+      uint32_t num_keys;
+      if (end - entry < sizeof(num_keys))
+         return false;
+      memcpy(&num_keys, entry, sizeof(num_keys));
+      entry += sizeof(num_keys);
+
+      /* The cache item metadata is currently just used for distributing
+       * precompiled shaders, they are not used by Mesa so just skip them for
+       * now.
+       * TODO: pass the metadata back to the caller and do some basic
+       * validation.
+       */
+      if (end - entry < (uint64_t) num_keys * sizeof(cache_key))
+         return false;
+      entry += num_keys * sizeof(cache_key);
    }
-   assert(strm.avail_out == 0);
 
-   /* clean up and return */
-   (void)inflateEnd(&strm);
+   /* Load the CRC that was created when the file was written. */
+   if (end - entry < sizeof(*cf_data))
+      return false;
+   memcpy(cf_data, entry, sizeof(*cf_data));
+   entry += sizeof(*cf_data);
+
+   *payload = entry;
+   *payload_size = end - entry;
+
    return true;
 }
 
+/**
+ * Validates a serialized cache entry and decompresses its payload.
+ *
+ * \return The malloc'ed payload, or NULL if the entry is corrupt or was
+ * written by a different driver build.
+ */
+static void *
+read_cache_entry(struct disk_cache *cache, const uint8_t *entry,
+                 size_t entry_size, size_t *size)
+{
+   struct cache_entry_file_data cf_data;
+   const uint8_t *payload;
+   size_t payload_size;
+   uint8_t *uncompressed_data = NULL;
+
+   if (!parse_cache_entry(cache, entry, entry_size, &cf_data,
+                          &payload, &payload_size))
+      return NULL;
+
+   uncompressed_data = malloc(cf_data.uncompressed_size);
+   if (!uncompressed_data)
+      return NULL;
+
+   /* Entries written with a codec this build doesn't support are simply
+    * treated as misses.
+    */
+   if (!util_compress_codec_supported(cf_data.codec) ||
+       !util_decompress(cf_data.codec, payload, payload_size,
+                        uncompressed_data, cf_data.uncompressed_size))
+      goto fail;
+
+   /* Check the data for corruption */
+   if (cf_data.crc32 != util_hash_crc32(uncompressed_data,
+                                        cf_data.uncompressed_size))
+      goto fail;
+
+   if (size)
+      *size = cf_data.uncompressed_size;
+
+   return uncompressed_data;
+
+ fail:
+   free(uncompressed_data);
+   return NULL;
+}
+
+/* Reads a whole cache file into a malloc'ed buffer. */
+static uint8_t *
+read_cache_file(const char *filename, size_t *size)
+{
+   struct stat sb;
+   uint8_t *data = NULL;
+
+   int fd = open(filename, O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      return NULL;
+
+   if (fstat(fd, &sb) == -1)
+      goto fail;
+
+   data = malloc(sb.st_size);
+   if (data == NULL)
+      goto fail;
+
+   if (read_all(fd, data, sb.st_size) == -1) {
+      free(data);
+      data = NULL;
+      goto fail;
+   }
+
+   *size = sb.st_size;
+
+ fail:
+   close(fd);
+   return data;
+}
+
 void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
 {
-   int fd = -1, ret;
-   struct stat sb;
    char *filename = NULL;
    uint8_t *data = NULL;
-   uint8_t *uncompressed_data = NULL;
-   uint8_t *file_header = NULL;
+   size_t data_size;
+   void *result = NULL;
 
    if (size)
       *size = 0;
@@ -1103,112 +1453,79 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
       return blob;
    }
 
-   filename = get_cache_file(cache, key);
-   if (filename == NULL)
-      goto fail;
+   if (cache->pack) {
+      data = disk_cache_pack_read(cache->pack, key, &data_size);
+      if (data == NULL)
+         return NULL;
 
-   fd = open(filename, O_RDONLY | O_CLOEXEC);
-   if (fd == -1)
-      goto fail;
+      result = read_cache_entry(cache, data, data_size, size);
+      free(data);
+      return result;
+   }
 
-   if (fstat(fd, &sb) == -1)
-      goto fail;
+   filename = get_cache_file(cache, key);
+   if (filename == NULL)
+      return NULL;
 
-   data = malloc(sb.st_size);
+   data = read_cache_file(filename, &data_size);
+   free(filename);
    if (data == NULL)
-      goto fail;
-
-   size_t ck_size = cache->driver_keys_blob_size;
-   file_header = malloc(ck_size);
-   if (!file_header)
-      goto fail;
+      return NULL;
 
-   if (sb.st_size < ck_size)
-      goto fail;
+   result = read_cache_entry(cache, data, data_size, size);
+   free(data);
 
-   ret = read_all(fd, file_header, ck_size);
-   if (ret == -1)
-      goto fail;
+   return result;
+}
 
-   /* Check for extremely unlikely hash collisions */
-   if (memcmp(cache->driver_keys_blob, file_header, ck_size) != 0) {
-      assert(!"Mesa cache keys mismatch!");
-      goto fail;
-   }
+bool
+disk_cache_get_view(struct disk_cache *cache, const cache_key key,
+                    struct disk_cache_view *view)
+{
+   memset(view, 0, sizeof(*view));
 
-   size_t cache_item_md_size = sizeof(uint32_t);
-   uint32_t md_type;
-   ret = read_all(fd, &md_type, cache_item_md_size);
-   if (ret == -1)
-      goto fail;
+   if (cache->pack && !cache->blob_get_cb) {
+      struct cache_entry_file_data cf_data;
+      const uint8_t *entry, *payload;
+      size_t entry_size, payload_size;
 
-   if (md_type == CACHE_ITEM_TYPE_GLSL) {
-      uint32_t num_keys;
-      cache_item_md_size += sizeof(uint32_t);
-      ret = read_all(fd, &num_keys, sizeof(uint32_t));
-      if (ret == -1)
-         goto fail;
+      entry = disk_cache_pack_map(cache->pack, key, &entry_size,
+                                  &view->map, &view->map_size);
+      if (entry == NULL)
+         return false;
+
+      if (parse_cache_entry(cache, entry, entry_size, &cf_data,
+                            &payload, &payload_size) &&
+          cf_data.codec == UTIL_COMPRESS_NONE &&
+          payload_size == cf_data.uncompressed_size &&
+          cf_data.crc32 == util_hash_crc32(payload, payload_size)) {
+         view->data = payload;
+         view->size = payload_size;
+         return true;
+      }
 
-      /* The cache item metadata is currently just used for distributing
-       * precompiled shaders, they are not used by Mesa so just skip them for
-       * now.
-       * TODO: pass the metadata back to the caller and do some basic
-       * validation.
+      /* The entry is compressed or corrupt, let disk_cache_get() deal
+       * with it.
        */
-      cache_item_md_size += num_keys * sizeof(cache_key);
-      ret = lseek(fd, num_keys * sizeof(cache_key), SEEK_CUR);
-      if (ret == -1)
-         goto fail;
+      disk_cache_pack_unmap(view->map, view->map_size);
+      view->map = NULL;
+      view->map_size = 0;
    }
 
-   /* Load the CRC that was created when the file was written. */
-   struct cache_entry_file_data cf_data;
-   size_t cf_data_size = sizeof(cf_data);
-   ret = read_all(fd, &cf_data, cf_data_size);
-   if (ret == -1)
-      goto fail;
-
-   /* Load the actual cache data. */
-   size_t cache_data_size =
-      sb.st_size - cf_data_size - ck_size - cache_item_md_size;
-   ret = read_all(fd, data, cache_data_size);
-   if (ret == -1)
-      goto fail;
-
-   /* Uncompress the cache data */
-   uncompressed_data = malloc(cf_data.uncompressed_size);
-   if (!inflate_cache_data(data, cache_data_size, uncompressed_data,
-                           cf_data.uncompressed_size))
-      goto fail;
+   view->copy = disk_cache_get(cache, key, &view->size);
+   view->data = view->copy;
 
-   /* Check the data for corruption */
-   if (cf_data.crc32 != util_hash_crc32(uncompressed_data,
-                                        cf_data.uncompressed_size))
-      goto fail;
-
-   free(data);
-   free(filename);
-   free(file_header);
-   close(fd);
-
-   if (size)
-      *size = cf_data.uncompressed_size;
-
-   return uncompressed_data;
+   return view->data != NULL;
+}
 
- fail:
-   if (data)
-      free(data);
-   if (uncompressed_data)
-      free(uncompressed_data);
-   if (filename)
-      free(filename);
-   if (file_header)
-      free(file_header);
-   if (fd != -1)
-      close(fd);
+void
+disk_cache_release_view(struct disk_cache *cache, struct disk_cache_view *view)
+{
+   if (view->map)
+      disk_cache_pack_unmap(view->map, view->map_size);
+   free(view->copy);
 
-   return NULL;
+   memset(view, 0, sizeof(*view));
 }
 
 void
@@ -1279,4 +1596,302 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    cache->blob_get_cb = get;
 }
 
+/* Archives written by disk_cache_export() start with this header, followed
+ * by the driver_keys_blob of the cache they were exported from and the
+ * entries. Everything is in host byte order, archives can only be imported
+ * by the very same driver build anyway.
+ */
+#define CACHE_ARCHIVE_MAGIC "MESACAR"
+#define CACHE_ARCHIVE_VERSION 1
+
+struct cache_archive_header {
+   char magic[8];
+   uint32_t version;
+   uint32_t driver_keys_blob_size;
+};
+
+/* Each entry is the key followed by the serialized entry exactly as it is
+ * stored in the cache.
+ */
+struct cache_archive_entry {
+   uint8_t key[CACHE_KEY_SIZE];
+   uint32_t size;
+};
+
+struct cache_export_state {
+   struct disk_cache *cache;
+   int fd;
+   int count;
+   bool error;
+};
+
+/* Returns whether a serialized entry is intact and was written by the
+ * driver build \cache belongs to.
+ */
+static bool
+is_valid_cache_entry(struct disk_cache *cache, const uint8_t *entry,
+                     size_t entry_size)
+{
+   /* Filter out entries of other drivers before read_cache_entry() gets to
+    * treat them as hash collisions.
+    */
+   if (entry_size < cache->driver_keys_blob_size ||
+       memcmp(entry, cache->driver_keys_blob,
+              cache->driver_keys_blob_size) != 0)
+      return false;
+
+   void *payload = read_cache_entry(cache, entry, entry_size, NULL);
+   if (payload == NULL)
+      return false;
+
+   free(payload);
+   return true;
+}
+
+static void
+export_cache_entry(struct cache_export_state *state, const cache_key key,
+                   const uint8_t *entry, size_t entry_size)
+{
+   if (state->error || entry_size > UINT32_MAX ||
+       !is_valid_cache_entry(state->cache, entry, entry_size))
+      return;
+
+   struct cache_archive_entry header;
+   memcpy(header.key, key, CACHE_KEY_SIZE);
+   header.size = entry_size;
+
+   if (write_all(state->fd, &header, sizeof(header)) == -1 ||
+       write_all(state->fd, entry, entry_size) == -1) {
+      state->error = true;
+      return;
+   }
+
+   state->count++;
+}
+
+static void
+export_pack_entry(const cache_key key, void *data)
+{
+   struct cache_export_state *state = data;
+   size_t size;
+
+   uint8_t *entry = disk_cache_pack_read(state->cache->pack, key, &size);
+   if (entry == NULL)
+      return;
+
+   export_cache_entry(state, key, entry, size);
+   free(entry);
+}
+
+/* Parses the 40 character hexadecimal representation of a key, as used for
+ * the cache file names.
+ */
+static bool
+parse_cache_key(const char *hex, cache_key key)
+{
+   for (unsigned i = 0; i < CACHE_KEY_SIZE * 2; i++) {
+      char c = hex[i];
+      unsigned nibble;
+
+      if (c >= '0' && c <= '9')
+         nibble = c - '0';
+      else if (c >= 'a' && c <= 'f')
+         nibble = c - 'a' + 10;
+      else
+         return false;
+
+      if (i % 2 == 0)
+         key[i / 2] = nibble << 4;
+      else
+         key[i / 2] |= nibble;
+   }
+
+   return true;
+}
+
+static void
+export_cache_files(struct cache_export_state *state)
+{
+   char hex[CACHE_KEY_SIZE * 2];
+
+   for (unsigned i = 0; i < 256 && !state->error; i++) {
+      char *dir_path;
+      if (asprintf(&dir_path, "%s/%02x", state->cache->path, i) == -1)
+         continue;
+
+      DIR *dir = opendir(dir_path);
+      if (dir == NULL) {
+         free(dir_path);
+         continue;
+      }
+
+      struct dirent *dir_ent;
+      while ((dir_ent = readdir(dir)) != NULL) {
+         cache_key key;
+         char *filename;
+         size_t size;
+
+         /* The first two digits of the key are the directory name. This
+          * skips temporary files as well.
+          */
+         if (strlen(dir_ent->d_name) != CACHE_KEY_SIZE * 2 - 2)
+            continue;
+
+         snprintf(hex, sizeof(hex), "%02x", i);
+         memcpy(hex + 2, dir_ent->d_name, CACHE_KEY_SIZE * 2 - 2);
+         if (!parse_cache_key(hex, key))
+            continue;
+
+         if (asprintf(&filename, "%s/%s", dir_path, dir_ent->d_name) == -1)
+            continue;
+
+         uint8_t *entry = read_cache_file(filename, &size);
+         free(filename);
+         if (entry == NULL)
+            continue;
+
+         export_cache_entry(state, key, entry, size);
+         free(entry);
+      }
+
+      closedir(dir);
+      free(dir_path);
+   }
+}
+
+int
+disk_cache_export(struct disk_cache *cache, const char *filename)
+{
+   struct cache_export_state state = {
+      .cache = cache,
+   };
+
+   if (cache->blob_get_cb || cache->path_init_failed)
+      return -1;
+
+   state.fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (state.fd == -1)
+      return -1;
+
+   struct cache_archive_header header = {
+      .magic = CACHE_ARCHIVE_MAGIC,
+      .version = CACHE_ARCHIVE_VERSION,
+      .driver_keys_blob_size = cache->driver_keys_blob_size,
+   };
+
+   if (write_all(state.fd, &header, sizeof(header)) == -1 ||
+       write_all(state.fd, cache->driver_keys_blob,
+                 cache->driver_keys_blob_size) == -1)
+      state.error = true;
+
+   /* Entries still in the queue aren't exported. */
+   if (cache->pack)
+      disk_cache_pack_foreach_key(cache->pack, export_pack_entry, &state);
+   else
+      export_cache_files(&state);
+
+   if (close(state.fd) == -1)
+      state.error = true;
+
+   if (state.error) {
+      unlink(filename);
+      return -1;
+   }
+
+   return state.count;
+}
+
+int
+disk_cache_import(struct disk_cache *cache, const char *filename)
+{
+   struct cache_archive_header header;
+   struct list_head jobs;
+   size_t jobs_size = 0;
+   uint8_t *blob = NULL;
+   int count = -1;
+
+   if (cache->blob_put_cb || cache->path_init_failed)
+      return -1;
+
+   int fd = open(filename, O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      return -1;
+
+   if (read_all(fd, &header, sizeof(header)) == -1 ||
+       memcmp(header.magic, CACHE_ARCHIVE_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != CACHE_ARCHIVE_VERSION ||
+       header.driver_keys_blob_size != cache->driver_keys_blob_size)
+      goto fail;
+
+   /* Only accept archives exported by the same driver build. */
+   blob = malloc(header.driver_keys_blob_size);
+   if (blob == NULL ||
+       read_all(fd, blob, header.driver_keys_blob_size) == -1 ||
+       memcmp(blob, cache->driver_keys_blob,
+              cache->driver_keys_blob_size) != 0)
+      goto fail;
+
+   list_inithead(&jobs);
+   count = 0;
+
+   while (true) {
+      struct cache_archive_entry entry;
+      ssize_t ret = read(fd, &entry, sizeof(entry));
+      if (ret == 0)
+         break;
+
+      if (ret != sizeof(entry)) {
+         count = -1;
+         break;
+      }
+
+      uint8_t *data = malloc(entry.size);
+      if (data == NULL || read_all(fd, data, entry.size) == -1) {
+         free(data);
+         count = -1;
+         break;
+      }
+
+      if (!is_valid_cache_entry(cache, data, entry.size)) {
+         free(data);
+         continue;
+      }
+
+      struct disk_cache_put_job *dc_job =
+         create_put_job(cache, entry.key, data, entry.size, NULL);
+      free(data);
+      if (dc_job == NULL)
+         continue;
+
+      dc_job->serialized = true;
+      count++;
+
+      /* The entries are written synchronously so that they are all in
+       * place when we return, batching them up when using pack files.
+       */
+      if (cache->pack) {
+         list_addtail(&dc_job->link, &jobs);
+         jobs_size += dc_job->size;
+
+         if (jobs_size >= WRITE_COMBINE_MAX_PENDING_SIZE) {
+            cache_put_pack_batch(cache, &jobs);
+            list_inithead(&jobs);
+            jobs_size = 0;
+         }
+      } else {
+         cache_put(dc_job, 0);
+         destroy_put_job(dc_job, 0);
+      }
+   }
+
+   if (cache->pack)
+      cache_put_pack_batch(cache, &jobs);
+
+ fail:
+   free(blob);
+   close(fd);
+
+   return count;
+}
+
 #endif /* ENABLE_SHADER_CACHE */
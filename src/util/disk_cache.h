@@ -76,6 +76,19 @@ struct cache_item_metadata {
 
 struct disk_cache;
 
+/**
+ * A read-only view of a cache item, see disk_cache_get_view().
+ */
+struct disk_cache_view {
+   const void *data;
+   size_t size;
+
+   /* Private to the cache implementation. */
+   void *map;
+   size_t map_size;
+   void *copy;
+};
+
 static inline char *
 disk_cache_format_hex_id(char *buf, const uint8_t *hex_id, unsigned size)
 {
@@ -210,6 +223,28 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
 void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size);
 
+/**
+ * Look up the item stored under the name \key, like disk_cache_get(), but
+ * without handing ownership of a copy to the caller.
+ *
+ * When the item is stored uncompressed in memory-mappable storage, \view
+ * points directly into the mapped cache and nothing is copied.  Otherwise
+ * this falls back to disk_cache_get().  Either way the data must be treated
+ * as read-only and stays valid until disk_cache_release_view() is called.
+ *
+ * \return true if the item was found.
+ */
+bool
+disk_cache_get_view(struct disk_cache *cache, const cache_key key,
+                    struct disk_cache_view *view);
+
+/**
+ * Release a view obtained from a successful disk_cache_get_view().
+ */
+void
+disk_cache_release_view(struct disk_cache *cache,
+                        struct disk_cache_view *view);
+
 /**
  * Store the name \key within the cache, (without any associated data).
  *
@@ -246,6 +281,32 @@ void
 disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
                          disk_cache_get_cb get);
 
+/**
+ * Write all entries of \cache that were created by the same driver build,
+ * (as identified by the arguments to disk_cache_create()), to the archive
+ * \filename.
+ *
+ * The archive doesn't depend on the cache directory or its layout, so it can
+ * be imported into the cache of another machine running the same build with
+ * disk_cache_import().  Entries that are still being written aren't
+ * included.
+ *
+ * \return The number of exported entries, or -1 on error.
+ */
+int
+disk_cache_export(struct disk_cache *cache, const char *filename);
+
+/**
+ * Add the entries of an archive created by disk_cache_export() to \cache.
+ *
+ * The archive must have been exported by the same driver build.  All
+ * entries are written out by the time this returns.
+ *
+ * \return The number of imported entries, or -1 on error.
+ */
+int
+disk_cache_import(struct disk_cache *cache, const char *filename);
+
 #else
 
 static inline struct disk_cache *
@@ -280,6 +341,20 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    return NULL;
 }
 
+static inline bool
+disk_cache_get_view(struct disk_cache *cache, const cache_key key,
+                    struct disk_cache_view *view)
+{
+   return false;
+}
+
+static inline void
+disk_cache_release_view(struct disk_cache *cache,
+                        struct disk_cache_view *view)
+{
+   return;
+}
+
 static inline void
 disk_cache_put_key(struct disk_cache *cache, const cache_key key)
 {
@@ -306,6 +381,18 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    return;
 }
 
+static inline int
+disk_cache_export(struct disk_cache *cache, const char *filename)
+{
+   return -1;
+}
+
+static inline int
+disk_cache_import(struct disk_cache *cache, const char *filename)
+{
+   return -1;
+}
+
 #endif /* ENABLE_SHADER_CACHE */
 
 #ifdef __cplusplus
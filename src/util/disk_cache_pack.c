@@ -0,0 +1,725 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/ralloc.h"
+#include "util/simple_mtx.h"
+#include "util/u_atomic.h"
+#include "main/compiler.h"
+
+#include "disk_cache_pack.h"
+
+/* The index is a fixed-size open addressing hash table of slots.  A key may
+ * only live in one of PACK_INDEX_MAX_PROBE consecutive slots starting at its
+ * hash, so lookups never need to scan for tombstones or empty slots.
+ */
+#define PACK_INDEX_SLOT_BITS 16
+#define PACK_INDEX_SLOTS (1 << PACK_INDEX_SLOT_BITS)
+#define PACK_INDEX_SLOT_MASK (PACK_INDEX_SLOTS - 1)
+#define PACK_INDEX_MAX_PROBE 16
+
+#define PACK_INDEX_MAGIC 0x4b41504d /* "MPAK" */
+
+/* Bump this whenever the layout of the index or the pack files changes. */
+#define PACK_INDEX_VERSION 1
+
+struct pack_index_header {
+   uint32_t magic;
+   uint32_t version;
+
+   /* Pack file new entries are appended to. */
+   uint32_t current;
+   uint32_t pad;
+
+   /* Incremented whenever a pack file is recycled.  An index slot is only
+    * valid while its generation matches the one of the pack it points into,
+    * which is what makes eviction of a whole pack O(1).  Zero is never a
+    * valid generation so that a zeroed slot always reads as empty.
+    */
+   uint32_t generation[DISK_CACHE_PACK_FILES];
+
+   /* Number of bytes written to each pack file. */
+   uint64_t used[DISK_CACHE_PACK_FILES];
+};
+
+struct pack_index_slot {
+   uint8_t key[CACHE_KEY_SIZE];
+   uint32_t pack;
+   uint64_t offset;
+   uint32_t size;
+   uint32_t generation;
+};
+
+struct disk_cache_pack {
+   char *dir;
+
+   int index_fd;
+
+   /* Recycling a pack replaces the file rather than truncating it, so that
+    * mappings handed out by disk_cache_pack_map() stay valid.  Each process
+    * notices the replacement through the generation in the index and
+    * reopens the file.  The mutex protects the file descriptors below.
+    */
+   simple_mtx_t mtx;
+   int pack_fd[DISK_CACHE_PACK_FILES];
+   uint32_t pack_fd_generation[DISK_CACHE_PACK_FILES];
+
+   uint8_t *index_mmap;
+   size_t index_mmap_size;
+
+   struct pack_index_header *header;
+   struct pack_index_slot *slots;
+
+   /* Maximum number of bytes in a single pack file. */
+   uint64_t pack_max_size;
+};
+
+static ssize_t
+pread_all(int fd, void *buf, size_t count, off_t offset)
+{
+   char *in = buf;
+   ssize_t read_ret;
+   size_t done;
+
+   for (done = 0; done < count; done += read_ret) {
+      read_ret = pread(fd, in + done, count - done, offset + done);
+      if (read_ret == -1 || read_ret == 0)
+         return -1;
+   }
+   return done;
+}
+
+static ssize_t
+pwrite_all(int fd, const void *buf, size_t count, off_t offset)
+{
+   const char *out = buf;
+   ssize_t written;
+   size_t done;
+
+   for (done = 0; done < count; done += written) {
+      written = pwrite(fd, out + done, count - done, offset + done);
+      if (written == -1)
+         return -1;
+   }
+   return done;
+}
+
+/* Replace pack file \n by a new, empty file.  Must be called with the index
+ * locked.
+ */
+static bool
+replace_pack_file(struct disk_cache_pack *pack, unsigned n, uint32_t generation)
+{
+   char *path = ralloc_asprintf(pack, "%s/pack.%u", pack->dir, n);
+   char *path_tmp = ralloc_asprintf(pack, "%s/pack.%u.tmp", pack->dir, n);
+   bool ret = false;
+   int fd = -1;
+
+   if (path == NULL || path_tmp == NULL)
+      goto done;
+
+   fd = open(path_tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (fd == -1)
+      goto done;
+
+   if (rename(path_tmp, path) == -1) {
+      unlink(path_tmp);
+      close(fd);
+      goto done;
+   }
+
+   simple_mtx_lock(&pack->mtx);
+   if (pack->pack_fd[n] != -1)
+      close(pack->pack_fd[n]);
+   pack->pack_fd[n] = fd;
+   pack->pack_fd_generation[n] = generation;
+   simple_mtx_unlock(&pack->mtx);
+
+   ret = true;
+
+ done:
+   ralloc_free(path);
+   ralloc_free(path_tmp);
+   return ret;
+}
+
+static bool
+reset_index(struct disk_cache_pack *pack)
+{
+   memset(pack->index_mmap, 0, pack->index_mmap_size);
+
+   for (unsigned i = 0; i < DISK_CACHE_PACK_FILES; i++) {
+      if (!replace_pack_file(pack, i, 1))
+         return false;
+      pack->header->generation[i] = 1;
+   }
+
+   pack->header->version = PACK_INDEX_VERSION;
+   p_atomic_set(&pack->header->magic, PACK_INDEX_MAGIC);
+
+   return true;
+}
+
+/* Return a file descriptor for pack \n holding the data of \generation, or -1
+ * if that generation of the pack has been recycled.  Must be called with
+ * pack->mtx held.
+ */
+static int
+get_pack_fd(struct disk_cache_pack *pack, unsigned n, uint32_t generation)
+{
+   if (pack->pack_fd_generation[n] == generation)
+      return pack->pack_fd[n];
+
+   char *path = ralloc_asprintf(pack, "%s/pack.%u", pack->dir, n);
+   if (path == NULL)
+      return -1;
+
+   int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   ralloc_free(path);
+   if (fd == -1)
+      return -1;
+
+   /* The generation is bumped before the file is replaced, so if it still
+    * matches we know we opened the right file.
+    */
+   if (p_atomic_read(&pack->header->generation[n]) != generation) {
+      close(fd);
+      return -1;
+   }
+
+   if (pack->pack_fd[n] != -1)
+      close(pack->pack_fd[n]);
+   pack->pack_fd[n] = fd;
+   pack->pack_fd_generation[n] = generation;
+
+   return fd;
+}
+
+struct disk_cache_pack *
+disk_cache_pack_open(void *mem_ctx, const char *dir, uint64_t max_size)
+{
+   struct disk_cache_pack *pack;
+   struct stat sb;
+   size_t size;
+   char *path;
+
+   pack = rzalloc(mem_ctx, struct disk_cache_pack);
+   if (pack == NULL)
+      return NULL;
+
+   simple_mtx_init(&pack->mtx, mtx_plain);
+   pack->index_fd = -1;
+   for (unsigned i = 0; i < DISK_CACHE_PACK_FILES; i++)
+      pack->pack_fd[i] = -1;
+
+   pack->pack_max_size = max_size / DISK_CACHE_PACK_FILES;
+
+   pack->dir = ralloc_strdup(pack, dir);
+   if (pack->dir == NULL)
+      goto fail;
+
+   path = ralloc_asprintf(pack, "%s/pack.idx", dir);
+   if (path == NULL)
+      goto fail;
+
+   pack->index_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   ralloc_free(path);
+   if (pack->index_fd == -1)
+      goto fail;
+
+   /* Creating or resetting the index must not race with other processes
+    * doing the same, or with writers appending to the packs.
+    */
+   if (flock(pack->index_fd, LOCK_EX) == -1)
+      goto fail;
+
+   if (fstat(pack->index_fd, &sb) == -1)
+      goto fail_unlock;
+
+   size = sizeof(struct pack_index_header) +
+          PACK_INDEX_SLOTS * sizeof(struct pack_index_slot);
+   if (sb.st_size != size) {
+      if (ftruncate(pack->index_fd, size) == -1)
+         goto fail_unlock;
+   }
+
+   pack->index_mmap = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, pack->index_fd, 0);
+   if (pack->index_mmap == MAP_FAILED) {
+      pack->index_mmap = NULL;
+      goto fail_unlock;
+   }
+   pack->index_mmap_size = size;
+
+   pack->header = (struct pack_index_header *) pack->index_mmap;
+   pack->slots = (struct pack_index_slot *) (pack->header + 1);
+
+   if (pack->header->magic != PACK_INDEX_MAGIC ||
+       pack->header->version != PACK_INDEX_VERSION ||
+       pack->header->current >= DISK_CACHE_PACK_FILES) {
+      if (!reset_index(pack))
+         goto fail_unlock;
+   }
+
+   flock(pack->index_fd, LOCK_UN);
+
+   return pack;
+
+ fail_unlock:
+   flock(pack->index_fd, LOCK_UN);
+ fail:
+   disk_cache_pack_close(pack);
+   return NULL;
+}
+
+void
+disk_cache_pack_close(struct disk_cache_pack *pack)
+{
+   if (pack == NULL)
+      return;
+
+   if (pack->index_mmap)
+      munmap(pack->index_mmap, pack->index_mmap_size);
+
+   if (pack->index_fd != -1)
+      close(pack->index_fd);
+
+   for (unsigned i = 0; i < DISK_CACHE_PACK_FILES; i++) {
+      if (pack->pack_fd[i] != -1)
+         close(pack->pack_fd[i]);
+   }
+
+   simple_mtx_destroy(&pack->mtx);
+   ralloc_free(pack);
+}
+
+static unsigned
+slot_hash(const cache_key key)
+{
+   const uint32_t *key_chunk = (const uint32_t *) key;
+   return CPU_TO_LE32(*key_chunk) & PACK_INDEX_SLOT_MASK;
+}
+
+/* Whether \slot, as copied out of the index, still points at data that is
+ * present in a pack file.
+ */
+static bool
+slot_is_live(struct disk_cache_pack *pack, const struct pack_index_slot *slot)
+{
+   if (slot->generation == 0 || slot->pack >= DISK_CACHE_PACK_FILES)
+      return false;
+
+   if (slot->generation != p_atomic_read(&pack->header->generation[slot->pack]))
+      return false;
+
+   return slot->offset + slot->size <= pack->header->used[slot->pack];
+}
+
+/* Find the slot holding \key.  The slot is copied to \out so that callers
+ * work on a consistent snapshot even if another process updates the index
+ * underneath us.
+ */
+static struct pack_index_slot *
+find_slot(struct disk_cache_pack *pack, const cache_key key,
+          struct pack_index_slot *out)
+{
+   unsigned hash = slot_hash(key);
+
+   for (unsigned i = 0; i < PACK_INDEX_MAX_PROBE; i++) {
+      struct pack_index_slot *slot =
+         &pack->slots[(hash + i) & PACK_INDEX_SLOT_MASK];
+
+      out->generation = p_atomic_read(&slot->generation);
+      if (out->generation == 0)
+         continue;
+
+      memcpy(out->key, slot->key, CACHE_KEY_SIZE);
+      out->pack = slot->pack;
+      out->offset = slot->offset;
+      out->size = slot->size;
+
+      if (memcmp(out->key, key, CACHE_KEY_SIZE) == 0 &&
+          slot_is_live(pack, out))
+         return slot;
+   }
+
+   return NULL;
+}
+
+/* Pick the slot a new entry for \key goes into, preferring dead slots over
+ * live ones.  When all candidate slots are live the entry in the oldest
+ * pack is replaced.  Must be called with the index locked.
+ */
+static struct pack_index_slot *
+choose_free_slot(struct disk_cache_pack *pack, const cache_key key)
+{
+   unsigned hash = slot_hash(key);
+   struct pack_index_slot *victim = NULL;
+   unsigned victim_age = 0;
+
+   for (unsigned i = 0; i < PACK_INDEX_MAX_PROBE; i++) {
+      struct pack_index_slot *slot =
+         &pack->slots[(hash + i) & PACK_INDEX_SLOT_MASK];
+
+      if (!slot_is_live(pack, slot))
+         return slot;
+
+      /* Number of pack switches since this entry was written. */
+      unsigned age = (pack->header->current + DISK_CACHE_PACK_FILES -
+                      slot->pack) % DISK_CACHE_PACK_FILES;
+      if (victim == NULL || age > victim_age) {
+         victim = slot;
+         victim_age = age;
+      }
+   }
+
+   return victim;
+}
+
+/* Make the next pack file the current one, throwing away all entries that
+ * were stored in it.  Must be called with the index locked.
+ */
+static bool
+recycle_next_pack(struct disk_cache_pack *pack)
+{
+   unsigned next = (pack->header->current + 1) % DISK_CACHE_PACK_FILES;
+   uint32_t generation = pack->header->generation[next] + 1;
+
+   if (generation == 0)
+      generation = 1;
+
+   /* Invalidate the slots before replacing the file so that nobody trusts
+    * the contents of the new file for the old generation.
+    */
+   p_atomic_set(&pack->header->generation[next], generation);
+   pack->header->used[next] = 0;
+
+   if (!replace_pack_file(pack, next, generation))
+      return false;
+
+   pack->header->current = next;
+   return true;
+}
+
+/* Like pwrite_all(), but gathering the data from \iov, which gets clobbered.
+ */
+static ssize_t
+pwritev_all(int fd, struct iovec *iov, int iovcnt, off_t offset)
+{
+   size_t done = 0;
+
+   while (iovcnt > 0) {
+      ssize_t written = pwritev(fd, iov, iovcnt, offset + done);
+      if (written == -1)
+         return -1;
+
+      done += written;
+
+      /* Skip what was written and retry with the rest. */
+      while (iovcnt > 0 && written >= iov->iov_len) {
+         written -= iov->iov_len;
+         iov++;
+         iovcnt--;
+      }
+      if (iovcnt > 0) {
+         iov->iov_base = (uint8_t *) iov->iov_base + written;
+         iov->iov_len -= written;
+      }
+   }
+
+   return done;
+}
+
+/* Maximum number of entries appended with a single pwritev(). */
+#define PACK_WRITE_MAX_BATCH 64
+
+bool
+disk_cache_pack_write_batch(struct disk_cache_pack *pack,
+                            const struct disk_cache_pack_entry *entries,
+                            unsigned count)
+{
+   struct pack_index_slot existing;
+   struct pack_index_slot *slot;
+   bool ret = true;
+
+   if (flock(pack->index_fd, LOCK_EX) == -1)
+      return false;
+
+   unsigned i = 0;
+   while (i < count) {
+      /* Another process may have won the race to write this entry. */
+      if (entries[i].size > UINT32_MAX ||
+          find_slot(pack, entries[i].key, &existing)) {
+         i++;
+         continue;
+      }
+
+      unsigned cur = pack->header->current;
+      uint64_t used = pack->header->used[cur];
+
+      /* An entry bigger than a whole pack still gets a pack of its own so
+       * that tiny cache sizes keep working.
+       */
+      if (used > 0 && used + entries[i].size > pack->pack_max_size) {
+         if (!recycle_next_pack(pack)) {
+            ret = false;
+            break;
+         }
+         cur = pack->header->current;
+         used = 0;
+      }
+
+      /* Gather as many of the following entries as fit in this pack. */
+      struct iovec iov[PACK_WRITE_MAX_BATCH];
+      uint64_t offsets[PACK_WRITE_MAX_BATCH];
+      unsigned indices[PACK_WRITE_MAX_BATCH];
+      unsigned n = 0;
+      uint64_t end = used;
+
+      for (; i < count && n < PACK_WRITE_MAX_BATCH; i++) {
+         const struct disk_cache_pack_entry *entry = &entries[i];
+
+         if (entry->size > UINT32_MAX ||
+             find_slot(pack, entry->key, &existing))
+            continue;
+
+         if (n > 0 && end + entry->size > pack->pack_max_size)
+            break;
+
+         iov[n].iov_base = (void *) entry->data;
+         iov[n].iov_len = entry->size;
+         offsets[n] = end;
+         indices[n] = i;
+         end += entry->size;
+         n++;
+      }
+
+      if (n == 0)
+         continue;
+
+      simple_mtx_lock(&pack->mtx);
+      int fd = get_pack_fd(pack, cur, pack->header->generation[cur]);
+      bool written = fd != -1 && pwritev_all(fd, iov, n, used) != -1;
+      simple_mtx_unlock(&pack->mtx);
+
+      if (!written) {
+         ret = false;
+         break;
+      }
+
+      pack->header->used[cur] = end;
+
+      for (unsigned k = 0; k < n; k++) {
+         const struct disk_cache_pack_entry *entry = &entries[indices[k]];
+
+         slot = choose_free_slot(pack, entry->key);
+
+         /* Publish the slot by writing the generation last, readers treat
+          * a slot with a zero or stale generation as empty.
+          */
+         p_atomic_set(&slot->generation, 0);
+         memcpy(slot->key, entry->key, CACHE_KEY_SIZE);
+         slot->pack = cur;
+         slot->offset = offsets[k];
+         slot->size = entry->size;
+         p_atomic_set(&slot->generation, pack->header->generation[cur]);
+      }
+   }
+
+   flock(pack->index_fd, LOCK_UN);
+   return ret;
+}
+
+bool
+disk_cache_pack_write(struct disk_cache_pack *pack, const cache_key key,
+                      const void *data, size_t size)
+{
+   struct disk_cache_pack_entry entry = {
+      .data = data,
+      .size = size,
+   };
+   memcpy(entry.key, key, CACHE_KEY_SIZE);
+
+   return disk_cache_pack_write_batch(pack, &entry, 1);
+}
+
+void *
+disk_cache_pack_read(struct disk_cache_pack *pack, const cache_key key,
+                     size_t *size)
+{
+   struct pack_index_slot slot;
+   void *data;
+
+   if (!find_slot(pack, key, &slot))
+      return NULL;
+
+   data = malloc(slot.size);
+   if (data == NULL)
+      return NULL;
+
+   simple_mtx_lock(&pack->mtx);
+   int fd = get_pack_fd(pack, slot.pack, slot.generation);
+   bool read = fd != -1 && pread_all(fd, data, slot.size, slot.offset) != -1;
+   simple_mtx_unlock(&pack->mtx);
+
+   if (!read) {
+      free(data);
+      return NULL;
+   }
+
+   /* If the pack was recycled while we were reading, what we read may be a
+    * mix of old and new data.  The caller's checksum would most likely catch
+    * that too, but there is no need to rely on it.
+    */
+   if (p_atomic_read(&pack->header->generation[slot.pack]) !=
+       slot.generation) {
+      free(data);
+      return NULL;
+   }
+
+   if (size)
+      *size = slot.size;
+
+   return data;
+}
+
+const void *
+disk_cache_pack_map(struct disk_cache_pack *pack, const cache_key key,
+                    size_t *size, void **map, size_t *map_size)
+{
+   struct pack_index_slot slot;
+   void *ptr;
+
+   if (!find_slot(pack, key, &slot))
+      return NULL;
+
+   if (slot.size == 0)
+      return NULL;
+
+   const uint64_t page_size = sysconf(_SC_PAGESIZE);
+   const uint64_t map_offset = slot.offset & ~(page_size - 1);
+   const size_t length = slot.offset + slot.size - map_offset;
+
+   simple_mtx_lock(&pack->mtx);
+   int fd = get_pack_fd(pack, slot.pack, slot.generation);
+   ptr = fd == -1 ? MAP_FAILED :
+         mmap(NULL, length, PROT_READ, MAP_SHARED, fd, map_offset);
+   simple_mtx_unlock(&pack->mtx);
+
+   if (ptr == MAP_FAILED)
+      return NULL;
+
+   /* The file we just mapped is never modified in place; once recycled it
+    * is replaced by a new file and our mapping keeps referring to the old
+    * one.  If the recycling happened before we got here the mapping may
+    * cover the new file though, so check the generation again.
+    */
+   if (p_atomic_read(&pack->header->generation[slot.pack]) !=
+       slot.generation) {
+      munmap(ptr, length);
+      return NULL;
+   }
+
+   *map = ptr;
+   *map_size = length;
+   *size = slot.size;
+
+   return (const uint8_t *) ptr + (slot.offset - map_offset);
+}
+
+void
+disk_cache_pack_unmap(void *map, size_t map_size)
+{
+   munmap(map, map_size);
+}
+
+bool
+disk_cache_pack_contains(struct disk_cache_pack *pack, const cache_key key)
+{
+   struct pack_index_slot slot;
+
+   return find_slot(pack, key, &slot) != NULL;
+}
+
+void
+disk_cache_pack_remove(struct disk_cache_pack *pack, const cache_key key)
+{
+   struct pack_index_slot copy;
+   struct pack_index_slot *slot;
+
+   if (flock(pack->index_fd, LOCK_EX) == -1)
+      return;
+
+   /* The data stays in the pack file until the pack gets recycled. */
+   slot = find_slot(pack, key, &copy);
+   if (slot)
+      p_atomic_set(&slot->generation, 0);
+
+   flock(pack->index_fd, LOCK_UN);
+}
+
+void
+disk_cache_pack_foreach_key(struct disk_cache_pack *pack,
+                            disk_cache_pack_key_cb cb, void *data)
+{
+   for (unsigned i = 0; i < PACK_INDEX_SLOTS; i++) {
+      struct pack_index_slot *slot = &pack->slots[i];
+      struct pack_index_slot copy;
+
+      copy.generation = p_atomic_read(&slot->generation);
+      if (copy.generation == 0)
+         continue;
+
+      memcpy(copy.key, slot->key, CACHE_KEY_SIZE);
+      copy.pack = slot->pack;
+      copy.offset = slot->offset;
+      copy.size = slot->size;
+
+      if (slot_is_live(pack, &copy))
+         cb(copy.key, data);
+   }
+}
+
+uint64_t
+disk_cache_pack_size(struct disk_cache_pack *pack)
+{
+   uint64_t size = 0;
+
+   for (unsigned i = 0; i < DISK_CACHE_PACK_FILES; i++)
+      size += pack->header->used[i];
+
+   return size;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
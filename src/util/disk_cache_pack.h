@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file disk_cache_pack.h
+ *
+ * Pack file storage backend for the on-disk shader cache.
+ *
+ * Instead of one file per cache entry, entries are appended to a small,
+ * fixed number of pack files and located through a hash index that is
+ * mmapped shared between all processes using the cache.  A lookup is a probe
+ * of the index followed by a single read, and eviction recycles the oldest
+ * pack file as a whole, which is O(1) regardless of the number of entries.
+ *
+ * This is an internal interface of disk_cache.c.
+ */
+
+#ifndef DISK_CACHE_PACK_H
+#define DISK_CACHE_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/disk_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of pack files the cache is split into.  When the pack currently
+ * being appended to is full the oldest one is discarded, so at most
+ * 1/DISK_CACHE_PACK_FILES of the cache is lost on eviction.
+ */
+#define DISK_CACHE_PACK_FILES 4
+
+struct disk_cache_pack;
+
+struct disk_cache_pack *
+disk_cache_pack_open(void *mem_ctx, const char *dir, uint64_t max_size);
+
+void
+disk_cache_pack_close(struct disk_cache_pack *pack);
+
+/**
+ * Append an already serialized cache entry to the current pack file and
+ * make it visible in the index.  Safe against concurrent writers in other
+ * processes.
+ */
+bool
+disk_cache_pack_write(struct disk_cache_pack *pack, const cache_key key,
+                      const void *data, size_t size);
+
+struct disk_cache_pack_entry {
+   cache_key key;
+   const void *data;
+   size_t size;
+};
+
+/**
+ * Append several entries at once.  Consecutive entries are written with a
+ * single system call, and the index is only locked once for the whole
+ * batch.
+ */
+bool
+disk_cache_pack_write_batch(struct disk_cache_pack *pack,
+                            const struct disk_cache_pack_entry *entries,
+                            unsigned count);
+
+/**
+ * Read back the serialized entry stored under \key.
+ *
+ * \return A malloc'ed copy of the entry or NULL if there is none.
+ */
+void *
+disk_cache_pack_read(struct disk_cache_pack *pack, const cache_key key,
+                     size_t *size);
+
+/**
+ * Map the serialized entry stored under \key read-only into memory.
+ *
+ * The contents of the mapping stay valid and unchanged until it is released
+ * with disk_cache_pack_unmap(), even if the entry gets evicted meanwhile.
+ *
+ * \return A pointer to the entry within the mapping, or NULL if there is no
+ * such entry.
+ */
+const void *
+disk_cache_pack_map(struct disk_cache_pack *pack, const cache_key key,
+                    size_t *size, void **map, size_t *map_size);
+
+void
+disk_cache_pack_unmap(void *map, size_t map_size);
+
+bool
+disk_cache_pack_contains(struct disk_cache_pack *pack, const cache_key key);
+
+void
+disk_cache_pack_remove(struct disk_cache_pack *pack, const cache_key key);
+
+typedef void (*disk_cache_pack_key_cb)(const cache_key key, void *data);
+
+/**
+ * Call \cb for the key of every entry currently stored in the pack files.
+ * Entries written or evicted concurrently may or may not be reported.
+ */
+void
+disk_cache_pack_foreach_key(struct disk_cache_pack *pack,
+                            disk_cache_pack_key_cb cb, void *data);
+
+/** Total number of bytes currently stored in all pack files. */
+uint64_t
+disk_cache_pack_size(struct disk_cache_pack *pack);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_PACK_H */
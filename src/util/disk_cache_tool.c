@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * A simple executable that exports the on-disk shader cache entries of one
+ * driver build into a portable archive, or imports such an archive into the
+ * cache of the current user.  This allows shipping a warm cache to machines
+ * running the same build.
+ *
+ * The cache location and backend are picked the same way as in the driver,
+ * so the MESA_GLSL_CACHE_* environment variables apply.
+ */
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/disk_cache.h"
+
+static void
+print_help(const char *progname, FILE *file)
+{
+   fprintf(file,
+           "Usage: %s [OPTION]... export|import ARCHIVE\n"
+           "Export the shader cache entries of one driver build to ARCHIVE,\n"
+           "or import them into the shader cache of the current user.\n\n"
+           "  -g, --gpu=NAME         GPU name the driver creates the cache with\n"
+           "  -d, --driver-id=ID     driver ID, (usually the build-id), the\n"
+           "                         driver creates the cache with\n"
+           "  -f, --flags=FLAGS      driver flags the driver creates the cache\n"
+           "                         with, (defaults to 0)\n"
+           "  -h, --help             display this help and exit\n",
+           progname);
+}
+
+int
+main(int argc, char *argv[])
+{
+   const char *gpu_name = NULL;
+   const char *driver_id = NULL;
+   uint64_t driver_flags = 0;
+   int c, i;
+
+   const struct option long_opts[] = {
+      { "gpu",       required_argument, NULL, 'g' },
+      { "driver-id", required_argument, NULL, 'd' },
+      { "flags",     required_argument, NULL, 'f' },
+      { "help",      no_argument,       NULL, 'h' },
+      { NULL,        0,                 NULL, 0 }
+   };
+
+   i = 0;
+   while ((c = getopt_long(argc, argv, "g:d:f:h", long_opts, &i)) != -1) {
+      switch (c) {
+      case 'g':
+         gpu_name = optarg;
+         break;
+      case 'd':
+         driver_id = optarg;
+         break;
+      case 'f':
+         driver_flags = strtoull(optarg, NULL, 0);
+         break;
+      case 'h':
+         print_help(argv[0], stdout);
+         return EXIT_SUCCESS;
+      default:
+         print_help(argv[0], stderr);
+         return EXIT_FAILURE;
+      }
+   }
+
+   if (optind + 2 != argc || gpu_name == NULL || driver_id == NULL) {
+      print_help(argv[0], stderr);
+      return EXIT_FAILURE;
+   }
+
+   const char *command = argv[optind];
+   const char *archive = argv[optind + 1];
+   bool export;
+
+   if (strcmp(command, "export") == 0) {
+      export = true;
+   } else if (strcmp(command, "import") == 0) {
+      export = false;
+   } else {
+      print_help(argv[0], stderr);
+      return EXIT_FAILURE;
+   }
+
+   struct disk_cache *cache =
+      disk_cache_create(gpu_name, driver_id, driver_flags);
+   if (cache == NULL) {
+      fprintf(stderr, "Failed to open the shader cache\n");
+      return EXIT_FAILURE;
+   }
+
+   int count = export ? disk_cache_export(cache, archive) :
+                        disk_cache_import(cache, archive);
+
+   disk_cache_destroy(cache);
+
+   if (count < 0) {
+      fprintf(stderr, "Failed to %s %s\n", command, archive);
+      return EXIT_FAILURE;
+   }
+
+   printf("%s %d entries\n", export ? "Exported" : "Imported", count);
+
+   return EXIT_SUCCESS;
+}
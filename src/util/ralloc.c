@@ -35,6 +35,7 @@ _CRTIMP int _vscprintf(const char *format, va_list argptr);
 #endif
 
 #include "ralloc.h"
+#include "u_atomic.h"
 
 #ifndef va_copy
 #ifdef __va_copy
@@ -66,6 +67,14 @@ struct
    unsigned canary;
 #endif
 
+   /* Nodes carved out of an arena, see ralloc_arena_context().  For those
+    * the offset to the start of the chunk holding them and the size of the
+    * whole node are kept, in units of ARENA_ALIGNMENT.
+    */
+   unsigned in_arena:1;
+   unsigned arena_offset:12;
+   unsigned arena_size:19;
+
    struct ralloc_header *parent;
 
    /* The first child (head of a linked list) */
@@ -94,6 +103,131 @@ get_header(const void *ptr)
 
 #define PTR_FROM_HEADER(info) (((char *) info) + sizeof(ralloc_header))
 
+/* Arena nodes are allocated with this granularity, which is also the
+ * alignment malloc guarantees on 64-bit platforms.
+ */
+#define ARENA_ALIGNMENT 16
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/* Nodes larger than this get a chunk of their own. */
+#define ARENA_MAX_SHARED_NODE_SIZE (ARENA_CHUNK_SIZE / 4)
+
+/* Nodes too large for the arena_size field are malloc'ed as usual. */
+#define ARENA_MAX_NODE_SIZE (((1u << 19) - 1) * ARENA_ALIGNMENT)
+
+struct ralloc_arena_chunk
+{
+   struct ralloc_arena *arena;
+   struct ralloc_arena_chunk *next;
+};
+
+#define ARENA_CHUNK_HEADER_SIZE \
+   ALIGN_POT(sizeof(struct ralloc_arena_chunk), ARENA_ALIGNMENT)
+
+struct ralloc_arena
+{
+   /* The context returned by ralloc_arena_context(). */
+   ralloc_header *root;
+
+   /* All chunks of the arena, most recently allocated first. */
+   struct ralloc_arena_chunk *chunks;
+
+   /* The chunk small nodes are currently carved from, and its free space. */
+   struct ralloc_arena_chunk *current;
+   char *next;
+   char *end;
+};
+
+static struct ralloc_arena *
+get_arena(const ralloc_header *info)
+{
+   const struct ralloc_arena_chunk *chunk = (const void *)
+      ((const char *) info - info->arena_offset * ARENA_ALIGNMENT);
+
+   assert(info->in_arena);
+   return chunk->arena;
+}
+
+static struct ralloc_arena_chunk *
+arena_add_chunk(struct ralloc_arena *arena, size_t size)
+{
+   struct ralloc_arena_chunk *chunk = malloc(size);
+
+   if (unlikely(chunk == NULL))
+      return NULL;
+
+   chunk->arena = arena;
+   chunk->next = arena->chunks;
+   arena->chunks = chunk;
+   return chunk;
+}
+
+static ralloc_header *
+arena_alloc(struct ralloc_arena *arena, size_t size)
+{
+   size_t node_size = ALIGN_POT(sizeof(ralloc_header) + size, ARENA_ALIGNMENT);
+   struct ralloc_arena_chunk *chunk;
+   ralloc_header *info;
+
+   if (unlikely(node_size > ARENA_MAX_SHARED_NODE_SIZE)) {
+      chunk = arena_add_chunk(arena, ARENA_CHUNK_HEADER_SIZE + node_size);
+      if (unlikely(chunk == NULL))
+         return NULL;
+
+      info = (ralloc_header *) ((char *) chunk + ARENA_CHUNK_HEADER_SIZE);
+   } else {
+      if (unlikely((size_t) (arena->end - arena->next) < node_size)) {
+         chunk = arena_add_chunk(arena, ARENA_CHUNK_SIZE);
+         if (unlikely(chunk == NULL))
+            return NULL;
+
+         arena->current = chunk;
+         arena->next = (char *) chunk + ARENA_CHUNK_HEADER_SIZE;
+         arena->end = (char *) chunk + ARENA_CHUNK_SIZE;
+      }
+
+      chunk = arena->current;
+      info = (ralloc_header *) arena->next;
+      arena->next += node_size;
+   }
+
+   info->in_arena = 1;
+   info->arena_offset = ((char *) info - (char *) chunk) / ARENA_ALIGNMENT;
+   info->arena_size = node_size / ARENA_ALIGNMENT;
+   return info;
+}
+
+static void
+arena_destroy(struct ralloc_arena *arena)
+{
+   while (arena->chunks != NULL) {
+      struct ralloc_arena_chunk *chunk = arena->chunks;
+      arena->chunks = chunk->next;
+      free(chunk);
+   }
+
+   free(arena);
+}
+
+/* Allocate the memory for a new node that will be a child of \p parent. */
+static ralloc_header *
+alloc_node(const ralloc_header *parent, size_t size)
+{
+   ralloc_header *info;
+
+   if (parent != NULL && parent->in_arena && size <= ARENA_MAX_NODE_SIZE)
+      return arena_alloc(get_arena(parent), size);
+
+   info = malloc(size + sizeof(ralloc_header));
+   if (likely(info != NULL)) {
+      info->in_arena = 0;
+      info->arena_offset = 0;
+      info->arena_size = 0;
+   }
+
+   return info;
+}
+
 static void
 add_child(ralloc_header *parent, ralloc_header *info)
 {
@@ -114,16 +248,63 @@ ralloc_context(const void *ctx)
 }
 
 void *
-ralloc_size(const void *ctx, size_t size)
+ralloc_arena_context(const void *ctx)
 {
-   void *block = malloc(size + sizeof(ralloc_header));
+   struct ralloc_arena *arena = calloc(1, sizeof(*arena));
    ralloc_header *info;
-   ralloc_header *parent;
 
-   if (unlikely(block == NULL))
+   if (unlikely(arena == NULL))
+      return NULL;
+
+   info = arena_alloc(arena, 0);
+   if (unlikely(info == NULL)) {
+      free(arena);
       return NULL;
+   }
+
+   info->parent = NULL;
+   info->child = NULL;
+   info->prev = NULL;
+   info->next = NULL;
+   info->destructor = NULL;
+
+   add_child(ctx != NULL ? get_header(ctx) : NULL, info);
+
+#ifndef NDEBUG
+   info->canary = CANARY;
+#endif
+
+   arena->root = info;
+   return PTR_FROM_HEADER(info);
+}
+
+static bool count_bytes = false;
+static uint64_t allocated_bytes = 0;
+
+void
+ralloc_enable_byte_count(void)
+{
+   count_bytes = true;
+}
+
+uint64_t
+ralloc_allocated_bytes(void)
+{
+   return p_atomic_read(&allocated_bytes);
+}
+
+void *
+ralloc_size(const void *ctx, size_t size)
+{
+   ralloc_header *parent = ctx != NULL ? get_header(ctx) : NULL;
+   ralloc_header *info = alloc_node(parent, size);
+
+   if (unlikely(info == NULL))
+      return NULL;
+
+   if (unlikely(count_bytes))
+      p_atomic_add(&allocated_bytes, size);
 
-   info = (ralloc_header *) block;
    /* measurements have shown that calloc is slower (because of
     * the multiplication overflow checking?), so clear things
     * manually
@@ -134,8 +315,6 @@ ralloc_size(const void *ctx, size_t size)
    info->next = NULL;
    info->destructor = NULL;
 
-   parent = ctx != NULL ? get_header(ctx) : NULL;
-
    add_child(parent, info);
 
 #ifndef NDEBUG
@@ -156,6 +335,39 @@ rzalloc_size(const void *ctx, size_t size)
    return ptr;
 }
 
+/* Arena memory can't be realloc'ed, so copy the node if it doesn't fit in
+ * the slack it was allocated with.
+ */
+static ralloc_header *
+arena_resize(ralloc_header *old, size_t size)
+{
+   size_t old_size = old->arena_size * ARENA_ALIGNMENT - sizeof(ralloc_header);
+   struct ralloc_arena *arena = get_arena(old);
+   ralloc_header *info;
+
+   if (size <= old_size)
+      return old;
+
+   info = alloc_node(old, size);
+   if (unlikely(info == NULL))
+      return NULL;
+
+#ifndef NDEBUG
+   info->canary = old->canary;
+#endif
+   info->parent = old->parent;
+   info->child = old->child;
+   info->prev = old->prev;
+   info->next = old->next;
+   info->destructor = old->destructor;
+   memcpy(PTR_FROM_HEADER(info), PTR_FROM_HEADER(old), old_size);
+
+   if (arena->root == old)
+      arena->root = info;
+
+   return info;
+}
+
 /* helper function - assumes ptr != NULL */
 static void *
 resize(void *ptr, size_t size)
@@ -163,11 +375,17 @@ resize(void *ptr, size_t size)
    ralloc_header *child, *old, *info;
 
    old = get_header(ptr);
-   info = realloc(old, size + sizeof(ralloc_header));
+   if (old->in_arena)
+      info = arena_resize(old, size);
+   else
+      info = realloc(old, size + sizeof(ralloc_header));
 
    if (info == NULL)
       return NULL;
 
+   if (unlikely(count_bytes))
+      p_atomic_add(&allocated_bytes, size);
+
    /* Update parent and sibling's links to the reallocated node. */
    if (info != old && info->parent != NULL) {
       if (info->parent->child == old)
@@ -271,7 +489,11 @@ unsafe_free(ralloc_header *info)
    if (info->destructor != NULL)
       info->destructor(PTR_FROM_HEADER(info));
 
-   free(info);
+   /* Arena nodes are only given back together with the whole arena. */
+   if (!info->in_arena)
+      free(info);
+   else if (get_arena(info)->root == info)
+      arena_destroy(get_arena(info));
 }
 
 void
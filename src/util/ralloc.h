@@ -49,6 +49,7 @@
 #include <stddef.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "macros.h"
 
@@ -91,6 +92,22 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new ralloc context backed by an arena.
+ *
+ * Instead of being malloc'ed one by one, all descendants of the returned
+ * context are carved out of large chunks owned by it.  They otherwise behave
+ * like any other ralloc'd memory: they can be resized, stolen and have
+ * destructors.  Freeing one of them calls the destructors, but the memory
+ * itself is only given back, all at once, when the arena context is freed.
+ *
+ * This makes it a good fit for allocation heavy, short lived contexts such
+ * as the scratch memory of a compiler pass.  Memory allocated out of an arena
+ * must not outlive it, so anything stolen into another context has to be
+ * freed before the arena context is.
+ */
+void *ralloc_arena_context(const void *ctx);
+
 /**
  * Allocate memory chained off of the given context.
  *
@@ -251,6 +268,18 @@ void *ralloc_parent(const void *ptr);
  */
 void ralloc_set_destructor(const void *ptr, void(*destructor)(void *));
 
+/**
+ * Start counting the bytes requested from ralloc, see
+ * ralloc_allocated_bytes().  This is meant for profiling and can't be undone.
+ */
+void ralloc_enable_byte_count(void);
+
+/**
+ * Return the number of bytes requested from ralloc by all threads since
+ * ralloc_enable_byte_count() was called.  Resizes count with their new size.
+ */
+uint64_t ralloc_allocated_bytes(void);
+
 /// \defgroup array String Functions @{
 /**
  * Duplicate a string, allocating the memory from the given context.
@@ -168,6 +168,23 @@ struct ra_graph {
    unsigned int *stack;
    unsigned int stack_count;
 
+   /**
+    * Per-word state of ra_simplify(), which lets it skip whole words of
+    * nodes at once instead of visiting every node in each pass.
+    * @{
+    */
+   /** Nodes in the stack or with a register assigned. */
+   BITSET_WORD *removed;
+   /** Nodes passing the pq test. */
+   BITSET_WORD *pq_test;
+   /**
+    * The lowest q total of the word's remaining nodes and the highest such
+    * node, or UINT_MAX if it has to be recomputed.
+    */
+   unsigned int *min_q_total;
+   unsigned int *min_q_node;
+   /** @} */
+
    /**
     * Tracks the start of the set of optimistically-colored registers in the
     * stack.
@@ -426,6 +443,11 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
 
    g->stack = rzalloc_array(g, unsigned int, count);
 
+   g->removed = rzalloc_array(g, BITSET_WORD, BITSET_WORDS(count));
+   g->pq_test = rzalloc_array(g, BITSET_WORD, BITSET_WORDS(count));
+   g->min_q_total = rzalloc_array(g, unsigned int, BITSET_WORDS(count));
+   g->min_q_node = rzalloc_array(g, unsigned int, BITSET_WORDS(count));
+
    for (i = 0; i < count; i++) {
       int bitset_count = BITSET_WORDS(count);
       g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
@@ -477,6 +499,28 @@ pq_test(struct ra_graph *g, unsigned int n)
    return g->nodes[n].q_total < g->regs->classes[n_class]->p;
 }
 
+/**
+ * Updates the ra_simplify() state of a node not yet removed from the graph
+ * after its q total was lowered.
+ */
+static void
+update_pq_info(struct ra_graph *g, unsigned int n)
+{
+   unsigned int i = BITSET_BITWORD(n);
+
+   if (pq_test(g, n)) {
+      BITSET_SET(g->pq_test, n);
+   } else if (g->min_q_total[i] != UINT_MAX) {
+      /* Ties go to the highest node, like in a scan from the last node. */
+      if (g->nodes[n].q_total < g->min_q_total[i] ||
+          (g->nodes[n].q_total == g->min_q_total[i] &&
+           n > g->min_q_node[i])) {
+         g->min_q_total[i] = g->nodes[n].q_total;
+         g->min_q_node[i] = n;
+      }
+   }
+}
+
 static void
 decrement_q(struct ra_graph *g, unsigned int n)
 {
@@ -490,10 +534,24 @@ decrement_q(struct ra_graph *g, unsigned int n)
       if (!g->nodes[n2].in_stack) {
          assert(g->nodes[n2].q_total >= g->regs->classes[n2_class]->q[n_class]);
          g->nodes[n2].q_total -= g->regs->classes[n2_class]->q[n_class];
+         if (!BITSET_TEST(g->removed, n2))
+            update_pq_info(g, n2);
       }
    }
 }
 
+static void
+add_node_to_stack(struct ra_graph *g, unsigned int n)
+{
+   decrement_q(g, n);
+   g->stack[g->stack_count] = n;
+   g->stack_count++;
+   g->nodes[n].in_stack = true;
+   BITSET_SET(g->removed, n);
+   /* The node may have been the minimum of its word. */
+   g->min_q_total[BITSET_BITWORD(n)] = UINT_MAX;
+}
+
 /**
  * Simplifies the interference graph by pushing all
  * trivially-colorable nodes into a stack of nodes to be colored,
@@ -503,13 +561,36 @@ decrement_q(struct ra_graph *g, unsigned int n)
  * we optimistically choose a node and push it on the stack. We heuristically
  * push the node with the lowest total q value, since it has the fewest
  * neighbors and therefore is most likely to be allocated.
+ *
+ * Nodes are visited from the last one in every pass, a word of the node
+ * bitsets at a time, so that the words with no node left or with no node
+ * passing the pq test are skipped right away.
  */
 static void
 ra_simplify(struct ra_graph *g)
 {
    bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
-   int i;
+   const int num_words = BITSET_WORDS(g->count);
+   const unsigned int top_word_high_bit = (g->count - 1) % BITSET_WORDBITS;
+   int i, j, high_bit;
+
+   if (!g->count)
+      return;
+
+   for (i = 0; i < num_words; i++) {
+      g->removed[i] = 0;
+      g->pq_test[i] = 0;
+      g->min_q_total[i] = UINT_MAX;
+      g->min_q_node[i] = UINT_MAX;
+   }
+
+   for (unsigned int n = 0; n < g->count; n++) {
+      if (g->nodes[n].in_stack || g->nodes[n].reg != NO_REG)
+         BITSET_SET(g->removed, n);
+      else if (pq_test(g, n))
+         BITSET_SET(g->pq_test, n);
+   }
 
    while (progress) {
       unsigned int best_optimistic_node = ~0;
@@ -517,34 +598,55 @@ ra_simplify(struct ra_graph *g)
 
       progress = false;
 
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
-
-	 if (pq_test(g, i)) {
-	    decrement_q(g, i);
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = true;
-	    progress = true;
-	 } else {
-	    unsigned int new_q_total = g->nodes[i].q_total;
-	    if (new_q_total < lowest_q_total) {
-	       best_optimistic_node = i;
-	       lowest_q_total = new_q_total;
-	    }
-	 }
+      for (i = num_words - 1, high_bit = top_word_high_bit; i >= 0;
+           i--, high_bit = BITSET_WORDBITS - 1) {
+         const BITSET_WORD mask =
+            ~(BITSET_WORD)0 >> (BITSET_WORDBITS - 1 - high_bit);
+         BITSET_WORD pq;
+
+         if ((g->removed[i] & mask) == mask)
+            continue;
+
+         pq = g->pq_test[i] & ~g->removed[i] & mask;
+         if (pq) {
+            /* Pushing nodes lowers the q totals of others, so reload the
+             * word after each node like a scan of the nodes would see it.
+             */
+            for (j = high_bit; j >= 0; j--) {
+               if (pq & BITSET_BIT(j)) {
+                  add_node_to_stack(g, i * BITSET_WORDBITS + j);
+                  pq = g->pq_test[i] & ~g->removed[i];
+                  progress = true;
+               }
+            }
+         } else if (!progress) {
+            if (g->min_q_total[i] == UINT_MAX) {
+               for (j = high_bit; j >= 0; j--) {
+                  unsigned int n = i * BITSET_WORDBITS + j;
+
+                  if (BITSET_TEST(g->removed, n))
+                     continue;
+
+                  if (g->nodes[n].q_total < g->min_q_total[i]) {
+                     g->min_q_total[i] = g->nodes[n].q_total;
+                     g->min_q_node[i] = n;
+                  }
+               }
+            }
+
+            if (g->min_q_total[i] < lowest_q_total) {
+               best_optimistic_node = g->min_q_node[i];
+               lowest_q_total = g->min_q_total[i];
+            }
+         }
       }
 
       if (!progress && best_optimistic_node != ~0U) {
          if (stack_optimistic_start == UINT_MAX)
             stack_optimistic_start = g->stack_count;
 
-	 decrement_q(g, best_optimistic_node);
-	 g->stack[g->stack_count] = best_optimistic_node;
-	 g->stack_count++;
-	 g->nodes[best_optimistic_node].in_stack = true;
-	 progress = true;
+         add_node_to_stack(g, best_optimistic_node);
+         progress = true;
       }
    }
 
@@ -768,6 +870,67 @@ ra_get_best_spill_node(struct ra_graph *g)
    return best_node;
 }
 
+/**
+ * Returns up to max_count nodes to be spilled at once, in decreasing order of
+ * cost/benefit, into nodes, and their number.
+ *
+ * No two of the nodes interfere: once a node is spilled, spilling its
+ * neighbors too is much less likely to be needed, while nodes in other parts
+ * of the program are still competing for registers.  This lets the caller
+ * spill a batch of registers per rebuild of the interference graph without
+ * spilling much more than it would one at a time.
+ */
+unsigned int
+ra_get_best_spill_nodes(struct ra_graph *g, unsigned int *nodes,
+                        unsigned int max_count)
+{
+   unsigned int count = 0;
+   unsigned int n, i;
+   float *ratios = malloc(g->count * sizeof(float));
+
+   if (!ratios) {
+      int best = ra_get_best_spill_node(g);
+
+      if (best < 0 || !max_count)
+         return 0;
+      nodes[0] = best;
+      return 1;
+   }
+
+   for (n = 0; n < g->count; n++) {
+      float cost = g->nodes[n].spill_cost;
+
+      if (cost <= 0.0f || g->nodes[n].in_stack)
+         ratios[n] = 0.0f;
+      else
+         ratios[n] = ra_get_spill_benefit(g, n) / cost;
+   }
+
+   while (count < max_count) {
+      unsigned int best_node = -1;
+      float best_ratio = 0.0f;
+
+      for (n = 0; n < g->count; n++) {
+         if (ratios[n] > best_ratio) {
+            best_ratio = ratios[n];
+            best_node = n;
+         }
+      }
+
+      if (best_node == ~0u)
+         break;
+
+      nodes[count++] = best_node;
+      ratios[best_node] = 0.0f;
+      for (i = 0; i < g->nodes[best_node].adjacency_count; i++)
+         ratios[g->nodes[best_node].adjacency_list[i]] = 0.0f;
+   }
+
+   free(ratios);
+
+   return count;
+}
+
 /**
  * Only nodes with a spill cost set (cost != 0.0) will be considered
  * for register spilling.
@@ -28,6 +28,11 @@
 #include <stdbool.h>
 #include <string.h>
 
+/* Number of migrated frees that are collected before they are handed back to
+ * their pools.
+ */
+#define SLAB_MAGAZINE_SIZE 32
+
 #define SLAB_MAGIC_ALLOCATED 0xcafe4321
 #define SLAB_MAGIC_FREE 0x7ee01234
 
@@ -128,6 +133,44 @@ void slab_create_child(struct slab_child_pool *pool,
    pool->pages = NULL;
    pool->free = NULL;
    pool->migrated = NULL;
+   pool->magazine = NULL;
+   pool->num_magazine = 0;
+   memset(&pool->stats, 0, sizeof(pool->stats));
+}
+
+/* Hand the elements in the magazine back to the pools they belong to, (or
+ * free them if their pool has been destroyed meanwhile).
+ */
+static void
+slab_flush_magazine(struct slab_child_pool *pool)
+{
+   struct slab_element_header *elt, *next, *orphaned = NULL;
+
+   mtx_lock(&pool->parent->mutex);
+   for (elt = pool->magazine; elt; elt = next) {
+      /* As in slab_free, the owner has to be read with the mutex held. */
+      intptr_t owner_int = p_atomic_read(&elt->owner);
+
+      next = elt->next;
+      if (!(owner_int & 1)) {
+         struct slab_child_pool *owner = (struct slab_child_pool *)owner_int;
+         elt->next = owner->migrated;
+         owner->migrated = elt;
+      } else {
+         elt->next = orphaned;
+         orphaned = elt;
+      }
+   }
+   mtx_unlock(&pool->parent->mutex);
+
+   for (elt = orphaned; elt; elt = next) {
+      next = elt->next;
+      slab_free_orphaned(elt);
+   }
+
+   pool->magazine = NULL;
+   pool->num_magazine = 0;
+   pool->stats.num_magazine_flushes++;
 }
 
 /**
@@ -141,6 +184,9 @@ void slab_destroy_child(struct slab_child_pool *pool)
    if (!pool->parent)
       return; /* the slab probably wasn't even created */
 
+   if (pool->magazine)
+      slab_flush_magazine(pool);
+
    mtx_lock(&pool->parent->mutex);
 
    while (pool->pages) {
@@ -193,6 +239,7 @@ slab_add_new_page(struct slab_child_pool *pool)
 
    page->u.next = pool->pages;
    pool->pages = page;
+   pool->stats.num_pages++;
 
    return true;
 }
@@ -223,6 +270,7 @@ slab_alloc(struct slab_child_pool *pool)
 
    elt = pool->free;
    pool->free = elt->next;
+   pool->stats.num_allocs++;
 
    CHECK_MAGIC(elt, SLAB_MAGIC_FREE);
    SET_MAGIC(elt, SLAB_MAGIC_ALLOCATED);
@@ -242,11 +290,12 @@ slab_alloc(struct slab_child_pool *pool)
 void slab_free(struct slab_child_pool *pool, void *ptr)
 {
    struct slab_element_header *elt = ((struct slab_element_header*)ptr - 1);
-   intptr_t owner_int;
 
    CHECK_MAGIC(elt, SLAB_MAGIC_ALLOCATED);
    SET_MAGIC(elt, SLAB_MAGIC_FREE);
 
+   pool->stats.num_frees++;
+
    if (p_atomic_read(&elt->owner) == (intptr_t)pool) {
       /* This is the simple case: The caller guarantees that we can safely
        * access the free list.
@@ -256,24 +305,27 @@ void slab_free(struct slab_child_pool *pool, void *ptr)
       return;
    }
 
-   /* The slow case: migration or an orphaned page. */
-   mtx_lock(&pool->parent->mutex);
-
-   /* Note: we _must_ re-read elt->owner here because the owning child pool
-    * may have been destroyed by another thread in the meantime.
+   /* The slow case: migration or an orphaned page. Collect these in the
+    * magazine, which only we access, and sort them out all at once.
     */
-   owner_int = p_atomic_read(&elt->owner);
+   pool->stats.num_migrated_frees++;
 
-   if (!(owner_int & 1)) {
-      struct slab_child_pool *owner = (struct slab_child_pool *)owner_int;
-      elt->next = owner->migrated;
-      owner->migrated = elt;
-      mtx_unlock(&pool->parent->mutex);
-   } else {
-      mtx_unlock(&pool->parent->mutex);
+   elt->next = pool->magazine;
+   pool->magazine = elt;
 
-      slab_free_orphaned(elt);
-   }
+   if (++pool->num_magazine >= SLAB_MAGAZINE_SIZE)
+      slab_flush_magazine(pool);
+}
+
+/**
+ * Return the statistics of the child pool. Single-threaded (i.e. the caller
+ * must ensure that no operation happens on the same child pool in another
+ * thread).
+ */
+void
+slab_get_stats(struct slab_child_pool *pool, struct slab_stats *stats)
+{
+   *stats = pool->stats;
 }
 
 /**
@@ -33,7 +33,9 @@
  * Allocations obtained from one child pool should usually be freed in the
  * same child pool. Freeing an allocation in a different child pool associated
  * to the same parent is allowed (and requires no locking by the caller), but
- * it is discouraged because it implies a performance penalty.
+ * it is discouraged because it implies a performance penalty. Such frees are
+ * batched up, so they only take the parent mutex every once in a while, but
+ * the memory can't be reused by the owning pool until then.
  *
  * For convenience and to ease the transition, there is also a set of wrapper
  * functions around a single parent-child pair.
@@ -42,11 +44,24 @@
 #ifndef SLAB_H
 #define SLAB_H
 
+#include <stdint.h>
+
 #include "c11/threads.h"
 
 struct slab_element_header;
 struct slab_page_header;
 
+/* Counters for tuning the page size, (num_items), of a pool. */
+struct slab_stats {
+   uint64_t num_allocs;
+   uint64_t num_frees;
+   /* Frees of objects that were allocated from a different child pool. */
+   uint64_t num_migrated_frees;
+   /* Number of times migrated frees were handed back to their pools. */
+   uint64_t num_magazine_flushes;
+   uint64_t num_pages;
+};
+
 struct slab_parent_pool {
    mtx_t mutex;
    unsigned element_size;
@@ -67,6 +82,16 @@ struct slab_child_pool {
     * This list is protected by the parent mutex.
     */
    struct slab_element_header *migrated;
+
+   /* Elements owned by other pools that were freed with this pool as the
+    * argument to slab_free. They are handed back to their owners in batches
+    * of SLAB_MAGAZINE_SIZE, so that the parent mutex is only taken once per
+    * batch.
+    */
+   struct slab_element_header *magazine;
+   unsigned num_magazine;
+
+   struct slab_stats stats;
 };
 
 void slab_create_parent(struct slab_parent_pool *parent,
@@ -78,6 +103,7 @@ void slab_create_child(struct slab_child_pool *pool,
 void slab_destroy_child(struct slab_child_pool *pool);
 void *slab_alloc(struct slab_child_pool *pool);
 void slab_free(struct slab_child_pool *pool, void *ptr);
+void slab_get_stats(struct slab_child_pool *pool, struct slab_stats *stats);
 
 struct slab_mempool {
    struct slab_parent_pool parent;
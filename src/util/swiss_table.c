@@ -0,0 +1,729 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Implements an open addressing hash table probing groups of control bytes
+ * at once, see swiss_table.h.
+ *
+ * The table is split into a power of two number of groups.  After mixing,
+ * the upper bits of the hash select the group a lookup starts at, and the
+ * low 7 bits are stored in the control byte of the slot.  Groups are probed in triangular
+ * order, which visits each of them once, until one containing an empty slot
+ * is found.  Because of this, a removed entry only needs to leave a
+ * tombstone if its group has no empty slot left, otherwise no probe
+ * sequence can go past it.
+ *
+ * At most 7/8 of the slots are used before the table is grown, or rehashed
+ * in place if that many are taken by tombstones.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "swiss_table.h"
+#include "bitscan.h"
+#include "ralloc.h"
+#include "u_math.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GROUP_WIDTH 16
+#define GROUP_MASK_SHIFT 0
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GROUP_WIDTH 8
+#define GROUP_MASK_SHIFT 3
+#else
+#define GROUP_WIDTH 8
+#define GROUP_MASK_SHIFT 3
+#endif
+
+#define CTRL_EMPTY   ((int8_t) -128)
+#define CTRL_DELETED ((int8_t) -2)
+
+#define MIN_SIZE 16
+
+#define LSBS UINT64_C(0x0101010101010101)
+#define MSBS UINT64_C(0x8080808080808080)
+
+/* A bitmask of the slots of a group matching some condition.  With SSE2
+ * there is one bit per slot, otherwise it is the most significant bit of
+ * each byte.
+ */
+typedef uint64_t group_bits;
+
+#if GROUP_WIDTH == 16
+
+static inline group_bits
+group_match(const int8_t *ctrl, int8_t h2)
+{
+   __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+}
+
+static inline group_bits
+group_match_empty(const int8_t *ctrl)
+{
+   return group_match(ctrl, CTRL_EMPTY);
+}
+
+/* Both empty and deleted slots have the sign bit set. */
+static inline group_bits
+group_match_free(const int8_t *ctrl)
+{
+   return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+}
+
+#else
+
+static inline uint64_t
+group_load(const int8_t *ctrl)
+{
+   uint64_t group;
+   memcpy(&group, ctrl, sizeof(group));
+   return util_le64_to_cpu(group);
+}
+
+static inline group_bits
+group_match(const int8_t *ctrl, int8_t h2)
+{
+#ifdef __ARM_NEON
+   uint8x8_t eq = vceq_s8(vld1_s8(ctrl), vdup_n_s8(h2));
+   return vget_lane_u64(vreinterpret_u64_u8(eq), 0) & MSBS;
+#else
+   /* Flag the bytes that are zero after the xor.  Adding 0x7f to the low 7
+    * bits can't carry into the next byte, so unlike the usual haszero()
+    * trick this has no false positives.
+    */
+   uint64_t x = group_load(ctrl) ^ (LSBS * (uint8_t) h2);
+   return ~(((x & ~MSBS) + ~MSBS) | x) & MSBS;
+#endif
+}
+
+/* Empty is 0b10000000 and deleted 0b11111110: look for the sign bit set
+ * with bit 1 clear.
+ */
+static inline group_bits
+group_match_empty(const int8_t *ctrl)
+{
+   uint64_t group = group_load(ctrl);
+   return group & (~group << 6) & MSBS;
+}
+
+static inline group_bits
+group_match_free(const int8_t *ctrl)
+{
+   return group_load(ctrl) & MSBS;
+}
+
+#endif
+
+/* Return the index of the first slot set in \p bits and remove it. */
+static inline unsigned
+group_bits_next(group_bits *bits)
+{
+   unsigned i = ffsll(*bits) - 1;
+   *bits &= *bits - 1;
+   return i >> GROUP_MASK_SHIFT;
+}
+
+/* The finalizer of MurmurHash3.  Hashes are mixed before use since weak
+ * ones, like _mesa_hash_pointer() or sequential GL names, would otherwise
+ * pile up in a few groups.
+ */
+static inline uint32_t
+mix_hash(uint32_t hash)
+{
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6b;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35;
+   hash ^= hash >> 16;
+   return hash;
+}
+
+static inline uint32_t
+hash_group(uint32_t hash, uint32_t group_mask)
+{
+   return (hash >> 7) & group_mask;
+}
+
+static inline int8_t
+hash_ctrl(uint32_t hash)
+{
+   return hash & 0x7f;
+}
+
+static inline uint32_t
+max_entries(uint32_t size)
+{
+   return size - size / 8;
+}
+
+/* Find the first empty or deleted slot on the probe sequence of the mixed
+ * hash \p h.
+ */
+static uint32_t
+find_free_slot(const int8_t *ctrl, uint32_t group_mask, uint32_t h)
+{
+   uint32_t group = hash_group(h, group_mask);
+
+   for (uint32_t stride = 1;; stride++) {
+      group_bits bits = group_match_free(ctrl + group * GROUP_WIDTH);
+      if (bits)
+         return group * GROUP_WIDTH + group_bits_next(&bits);
+
+      assert(stride <= group_mask + 1);
+      group = (group + stride) & group_mask;
+   }
+}
+
+/* Free \p slot of a table, which must have been full. */
+static void
+free_slot(int8_t *ctrl, uint32_t slot, uint32_t *growth_left,
+          uint32_t *deleted_entries)
+{
+   if (group_match_empty(ctrl + (slot & ~(GROUP_WIDTH - 1)))) {
+      ctrl[slot] = CTRL_EMPTY;
+      (*growth_left)++;
+   } else {
+      ctrl[slot] = CTRL_DELETED;
+      (*deleted_entries)++;
+   }
+}
+
+/* Size of the table to rehash into once no free slot is left: only grow if
+ * the entries, rather than tombstones, take at least half the space.
+ */
+static uint32_t
+rehash_size(uint32_t size, uint32_t entries)
+{
+   return entries >= max_entries(size) / 2 ? size * 2 : size;
+}
+
+static bool
+swiss_table_alloc(struct swiss_table *ht, uint32_t size)
+{
+   int8_t *ctrl = ralloc_array(ht, int8_t, size);
+   struct hash_entry *table = ralloc_array(ht, struct hash_entry, size);
+
+   if (ctrl == NULL || table == NULL) {
+      ralloc_free(ctrl);
+      ralloc_free(table);
+      return false;
+   }
+
+   memset(ctrl, CTRL_EMPTY, size);
+
+   ht->ctrl = ctrl;
+   ht->table = table;
+   ht->size = size;
+   ht->group_mask = size / GROUP_WIDTH - 1;
+   ht->deleted_entries = 0;
+   ht->growth_left = max_entries(size) - ht->entries;
+   return true;
+}
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b))
+{
+   struct swiss_table *ht = ralloc(mem_ctx, struct swiss_table);
+   if (ht == NULL)
+      return NULL;
+
+   ht->key_hash_function = key_hash_function;
+   ht->key_equals_function = key_equals_function;
+   ht->entries = 0;
+
+   if (!swiss_table_alloc(ht, MIN_SIZE)) {
+      ralloc_free(ht);
+      return NULL;
+   }
+
+   return ht;
+}
+
+struct swiss_table *
+_mesa_pointer_swiss_table_create(void *mem_ctx)
+{
+   return _mesa_swiss_table_create(mem_ctx, _mesa_hash_pointer,
+                                   _mesa_key_pointer_equal);
+}
+
+/**
+ * Frees the given hash table.
+ *
+ * If delete_function is passed, it gets called on each entry present before
+ * freeing.
+ */
+void
+_mesa_swiss_table_destroy(struct swiss_table *ht,
+                          void (*delete_function)(struct hash_entry *entry))
+{
+   if (!ht)
+      return;
+
+   if (delete_function) {
+      swiss_table_foreach(ht, entry) {
+         delete_function(entry);
+      }
+   }
+   ralloc_free(ht);
+}
+
+/**
+ * Deletes all entries of the given hash table without deleting the table
+ * itself or changing its structure.
+ *
+ * If delete_function is passed, it gets called on each entry present.
+ */
+void
+_mesa_swiss_table_clear(struct swiss_table *ht,
+                        void (*delete_function)(struct hash_entry *entry))
+{
+   if (delete_function) {
+      swiss_table_foreach(ht, entry) {
+         delete_function(entry);
+      }
+   }
+
+   memset(ht->ctrl, CTRL_EMPTY, ht->size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   ht->growth_left = max_entries(ht->size);
+}
+
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *ht, uint32_t hash,
+                                    const void *key)
+{
+   uint32_t h = mix_hash(hash);
+   uint32_t group = hash_group(h, ht->group_mask);
+   int8_t h2 = hash_ctrl(h);
+
+   assert(!ht->key_hash_function || hash == ht->key_hash_function(key));
+
+   for (uint32_t stride = 1;; stride++) {
+      const int8_t *ctrl = ht->ctrl + group * GROUP_WIDTH;
+      group_bits bits = group_match(ctrl, h2);
+
+      while (bits) {
+         struct hash_entry *entry =
+            &ht->table[group * GROUP_WIDTH + group_bits_next(&bits)];
+
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key))
+            return entry;
+      }
+
+      if (group_match_empty(ctrl))
+         return NULL;
+
+      assert(stride <= ht->group_mask + 1);
+      group = (group + stride) & ht->group_mask;
+   }
+}
+
+/**
+ * Finds a hash table entry with the given key and hash of that key.
+ *
+ * Returns NULL if no entry is found.  Note that the data pointer may be
+ * modified by the user.
+ */
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *ht, const void *key)
+{
+   return _mesa_swiss_table_search_pre_hashed(ht, ht->key_hash_function(key),
+                                              key);
+}
+
+static bool
+swiss_table_rehash(struct swiss_table *ht, uint32_t new_size)
+{
+   int8_t *old_ctrl = ht->ctrl;
+   struct hash_entry *old_table = ht->table;
+   uint32_t old_size = ht->size;
+
+   if (!swiss_table_alloc(ht, new_size))
+      return false;
+
+   for (uint32_t i = 0; i < old_size; i++) {
+      if (old_ctrl[i] < 0)
+         continue;
+
+      uint32_t slot = find_free_slot(ht->ctrl, ht->group_mask,
+                                     mix_hash(old_table[i].hash));
+      ht->ctrl[slot] = old_ctrl[i];
+      ht->table[slot] = old_table[i];
+   }
+
+   ralloc_free(old_ctrl);
+   ralloc_free(old_table);
+   return true;
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *ht, uint32_t hash,
+                                    const void *key, void *data)
+{
+   uint32_t h = mix_hash(hash);
+   uint32_t group = hash_group(h, ht->group_mask);
+   int8_t h2 = hash_ctrl(h);
+   bool have_free = false;
+   uint32_t slot = 0;
+
+   assert(!ht->key_hash_function || hash == ht->key_hash_function(key));
+
+   /* Look for an existing entry, remembering the first free slot on the
+    * way in case there is none.
+    */
+   for (uint32_t stride = 1;; stride++) {
+      const int8_t *ctrl = ht->ctrl + group * GROUP_WIDTH;
+      group_bits bits = group_match(ctrl, h2);
+
+      while (bits) {
+         struct hash_entry *entry =
+            &ht->table[group * GROUP_WIDTH + group_bits_next(&bits)];
+
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
+      }
+
+      if (!have_free) {
+         bits = group_match_free(ctrl);
+         if (bits) {
+            slot = group * GROUP_WIDTH + group_bits_next(&bits);
+            have_free = true;
+         }
+      }
+
+      if (group_match_empty(ctrl))
+         break;
+
+      assert(stride <= ht->group_mask + 1);
+      group = (group + stride) & ht->group_mask;
+   }
+
+   if (ht->ctrl[slot] == CTRL_EMPTY && ht->growth_left == 0) {
+      if (!swiss_table_rehash(ht, rehash_size(ht->size, ht->entries)))
+         return NULL;
+
+      slot = find_free_slot(ht->ctrl, ht->group_mask, h);
+   }
+
+   if (ht->ctrl[slot] == CTRL_DELETED)
+      ht->deleted_entries--;
+   else
+      ht->growth_left--;
+
+   struct hash_entry *entry = &ht->table[slot];
+   ht->ctrl[slot] = h2;
+   entry->hash = hash;
+   entry->key = key;
+   entry->data = data;
+   ht->entries++;
+
+   return entry;
+}
+
+/**
+ * Inserts the key into the table.  If the key is already present, its data
+ * is replaced.
+ *
+ * Note that insertion may rearrange the table on a resize or rehash, so
+ * previously found hash_entries are no longer valid after this function.
+ */
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *ht, const void *key, void *data)
+{
+   return _mesa_swiss_table_insert_pre_hashed(ht, ht->key_hash_function(key),
+                                              key, data);
+}
+
+/**
+ * This function deletes the given hash table entry.
+ *
+ * Note that deletion doesn't otherwise modify the table, so an iteration
+ * over the table deleting entries is safe.
+ */
+void
+_mesa_swiss_table_remove(struct swiss_table *ht, struct hash_entry *entry)
+{
+   if (!entry)
+      return;
+
+   assert(ht->ctrl[entry - ht->table] >= 0);
+   free_slot(ht->ctrl, entry - ht->table, &ht->growth_left,
+             &ht->deleted_entries);
+   ht->entries--;
+}
+
+/**
+ * Removes the entry with the corresponding key, if exists.
+ */
+void
+_mesa_swiss_table_remove_key(struct swiss_table *ht, const void *key)
+{
+   _mesa_swiss_table_remove(ht, _mesa_swiss_table_search(ht, key));
+}
+
+/**
+ * This function is an iterator over the hash table.
+ *
+ * Pass in NULL for the first entry, as in the start of a for loop.  Note that
+ * an iteration over the table is O(table_size) not O(entries).
+ */
+struct hash_entry *
+_mesa_swiss_table_next_entry(struct swiss_table *ht, struct hash_entry *entry)
+{
+   uint32_t i = entry ? entry - ht->table + 1 : 0;
+
+   for (; i < ht->size; i++) {
+      if (ht->ctrl[i] >= 0)
+         return &ht->table[i];
+   }
+
+   return NULL;
+}
+
+static bool
+swiss_table_u32_alloc(struct swiss_table_u32 *ht, uint32_t size)
+{
+   int8_t *ctrl = ralloc_array(ht, int8_t, size);
+   struct swiss_table_u32_entry *table =
+      ralloc_array(ht, struct swiss_table_u32_entry, size);
+
+   if (ctrl == NULL || table == NULL) {
+      ralloc_free(ctrl);
+      ralloc_free(table);
+      return false;
+   }
+
+   memset(ctrl, CTRL_EMPTY, size);
+
+   ht->ctrl = ctrl;
+   ht->table = table;
+   ht->size = size;
+   ht->group_mask = size / GROUP_WIDTH - 1;
+   ht->deleted_entries = 0;
+   ht->growth_left = max_entries(size) - ht->entries;
+   return true;
+}
+
+struct swiss_table_u32 *
+_mesa_swiss_table_u32_create(void *mem_ctx)
+{
+   struct swiss_table_u32 *ht = ralloc(mem_ctx, struct swiss_table_u32);
+   if (ht == NULL)
+      return NULL;
+
+   ht->entries = 0;
+
+   if (!swiss_table_u32_alloc(ht, MIN_SIZE)) {
+      ralloc_free(ht);
+      return NULL;
+   }
+
+   return ht;
+}
+
+void
+_mesa_swiss_table_u32_destroy(struct swiss_table_u32 *ht,
+                              void (*delete_function)(struct swiss_table_u32_entry *entry))
+{
+   if (!ht)
+      return;
+
+   if (delete_function) {
+      swiss_table_u32_foreach(ht, entry) {
+         delete_function(entry);
+      }
+   }
+   ralloc_free(ht);
+}
+
+void
+_mesa_swiss_table_u32_clear(struct swiss_table_u32 *ht,
+                            void (*delete_function)(struct swiss_table_u32_entry *entry))
+{
+   if (delete_function) {
+      swiss_table_u32_foreach(ht, entry) {
+         delete_function(entry);
+      }
+   }
+
+   memset(ht->ctrl, CTRL_EMPTY, ht->size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   ht->growth_left = max_entries(ht->size);
+}
+
+struct swiss_table_u32_entry *
+_mesa_swiss_table_u32_search(struct swiss_table_u32 *ht, uint32_t key)
+{
+   uint32_t h = mix_hash(key);
+   uint32_t group = hash_group(h, ht->group_mask);
+   int8_t h2 = hash_ctrl(h);
+
+   for (uint32_t stride = 1;; stride++) {
+      const int8_t *ctrl = ht->ctrl + group * GROUP_WIDTH;
+      group_bits bits = group_match(ctrl, h2);
+
+      while (bits) {
+         struct swiss_table_u32_entry *entry =
+            &ht->table[group * GROUP_WIDTH + group_bits_next(&bits)];
+
+         if (entry->key == key)
+            return entry;
+      }
+
+      if (group_match_empty(ctrl))
+         return NULL;
+
+      assert(stride <= ht->group_mask + 1);
+      group = (group + stride) & ht->group_mask;
+   }
+}
+
+static bool
+swiss_table_u32_rehash(struct swiss_table_u32 *ht, uint32_t new_size)
+{
+   int8_t *old_ctrl = ht->ctrl;
+   struct swiss_table_u32_entry *old_table = ht->table;
+   uint32_t old_size = ht->size;
+
+   if (!swiss_table_u32_alloc(ht, new_size))
+      return false;
+
+   for (uint32_t i = 0; i < old_size; i++) {
+      if (old_ctrl[i] < 0)
+         continue;
+
+      uint32_t slot = find_free_slot(ht->ctrl, ht->group_mask,
+                                     mix_hash(old_table[i].key));
+      ht->ctrl[slot] = old_ctrl[i];
+      ht->table[slot] = old_table[i];
+   }
+
+   ralloc_free(old_ctrl);
+   ralloc_free(old_table);
+   return true;
+}
+
+struct swiss_table_u32_entry *
+_mesa_swiss_table_u32_insert(struct swiss_table_u32 *ht, uint32_t key,
+                             void *data)
+{
+   uint32_t h = mix_hash(key);
+   uint32_t group = hash_group(h, ht->group_mask);
+   int8_t h2 = hash_ctrl(h);
+   bool have_free = false;
+   uint32_t slot = 0;
+
+   for (uint32_t stride = 1;; stride++) {
+      const int8_t *ctrl = ht->ctrl + group * GROUP_WIDTH;
+      group_bits bits = group_match(ctrl, h2);
+
+      while (bits) {
+         struct swiss_table_u32_entry *entry =
+            &ht->table[group * GROUP_WIDTH + group_bits_next(&bits)];
+
+         if (entry->key == key) {
+            entry->data = data;
+            return entry;
+         }
+      }
+
+      if (!have_free) {
+         bits = group_match_free(ctrl);
+         if (bits) {
+            slot = group * GROUP_WIDTH + group_bits_next(&bits);
+            have_free = true;
+         }
+      }
+
+      if (group_match_empty(ctrl))
+         break;
+
+      assert(stride <= ht->group_mask + 1);
+      group = (group + stride) & ht->group_mask;
+   }
+
+   if (ht->ctrl[slot] == CTRL_EMPTY && ht->growth_left == 0) {
+      if (!swiss_table_u32_rehash(ht, rehash_size(ht->size, ht->entries)))
+         return NULL;
+
+      slot = find_free_slot(ht->ctrl, ht->group_mask, h);
+   }
+
+   if (ht->ctrl[slot] == CTRL_DELETED)
+      ht->deleted_entries--;
+   else
+      ht->growth_left--;
+
+   struct swiss_table_u32_entry *entry = &ht->table[slot];
+   ht->ctrl[slot] = h2;
+   entry->key = key;
+   entry->data = data;
+   ht->entries++;
+
+   return entry;
+}
+
+void
+_mesa_swiss_table_u32_remove(struct swiss_table_u32 *ht,
+                             struct swiss_table_u32_entry *entry)
+{
+   if (!entry)
+      return;
+
+   assert(ht->ctrl[entry - ht->table] >= 0);
+   free_slot(ht->ctrl, entry - ht->table, &ht->growth_left,
+             &ht->deleted_entries);
+   ht->entries--;
+}
+
+void
+_mesa_swiss_table_u32_remove_key(struct swiss_table_u32 *ht, uint32_t key)
+{
+   _mesa_swiss_table_u32_remove(ht, _mesa_swiss_table_u32_search(ht, key));
+}
+
+struct swiss_table_u32_entry *
+_mesa_swiss_table_u32_next_entry(struct swiss_table_u32 *ht,
+                                 struct swiss_table_u32_entry *entry)
+{
+   uint32_t i = entry ? entry - ht->table + 1 : 0;
+
+   for (; i < ht->size; i++) {
+      if (ht->ctrl[i] >= 0)
+         return &ht->table[i];
+   }
+
+   return NULL;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file swiss_table.h
+ *
+ * An open addressing hash table in the style of the "Swiss tables".
+ *
+ * Besides the entries, the table keeps one control byte per slot holding 7
+ * bits of the hash of the key stored there, or a marker for empty and
+ * deleted slots.  Slots are grouped by 16 (8 without SSE2), and a lookup
+ * compares all control bytes of a group at once, so only entries whose
+ * hash bits match are ever touched.
+ *
+ * The interface mirrors the one of hash_table.h and uses the same entry
+ * type.  As there, entry pointers stay valid until the next insertion, and
+ * removing entries while iterating with swiss_table_foreach() is allowed.
+ */
+
+#ifndef _SWISS_TABLE_H
+#define _SWISS_TABLE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct swiss_table {
+   int8_t *ctrl;
+   struct hash_entry *table;
+   uint32_t (*key_hash_function)(const void *key);
+   bool (*key_equals_function)(const void *a, const void *b);
+   uint32_t size;
+   uint32_t group_mask;
+   uint32_t entries;
+   uint32_t deleted_entries;
+   uint32_t growth_left;
+};
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b));
+
+struct swiss_table *
+_mesa_pointer_swiss_table_create(void *mem_ctx);
+
+void _mesa_swiss_table_destroy(struct swiss_table *ht,
+                               void (*delete_function)(struct hash_entry *entry));
+void _mesa_swiss_table_clear(struct swiss_table *ht,
+                             void (*delete_function)(struct hash_entry *entry));
+
+static inline uint32_t _mesa_swiss_table_num_entries(struct swiss_table *ht)
+{
+   return ht->entries;
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *ht, const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *ht, uint32_t hash,
+                                    const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *ht, const void *key);
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *ht, uint32_t hash,
+                                    const void *key);
+void _mesa_swiss_table_remove(struct swiss_table *ht,
+                              struct hash_entry *entry);
+void _mesa_swiss_table_remove_key(struct swiss_table *ht,
+                                  const void *key);
+
+struct hash_entry *_mesa_swiss_table_next_entry(struct swiss_table *ht,
+                                                struct hash_entry *entry);
+
+#define swiss_table_foreach(ht, entry)                                      \
+   for (struct hash_entry *entry = _mesa_swiss_table_next_entry(ht, NULL);  \
+        entry != NULL;                                                      \
+        entry = _mesa_swiss_table_next_entry(ht, entry))
+
+/**
+ * Swiss table specialized for 32-bit integer keys, such as GL object names.
+ *
+ * Keys are stored inline and hashed internally, so no callbacks are
+ * involved in lookups.  Any key value is allowed.
+ */
+struct swiss_table_u32_entry {
+   uint32_t key;
+   void *data;
+};
+
+struct swiss_table_u32 {
+   int8_t *ctrl;
+   struct swiss_table_u32_entry *table;
+   uint32_t size;
+   uint32_t group_mask;
+   uint32_t entries;
+   uint32_t deleted_entries;
+   uint32_t growth_left;
+};
+
+struct swiss_table_u32 *
+_mesa_swiss_table_u32_create(void *mem_ctx);
+
+void
+_mesa_swiss_table_u32_destroy(struct swiss_table_u32 *ht,
+                              void (*delete_function)(struct swiss_table_u32_entry *entry));
+
+void
+_mesa_swiss_table_u32_clear(struct swiss_table_u32 *ht,
+                            void (*delete_function)(struct swiss_table_u32_entry *entry));
+
+static inline uint32_t
+_mesa_swiss_table_u32_num_entries(struct swiss_table_u32 *ht)
+{
+   return ht->entries;
+}
+
+/**
+ * Insert \p data under \p key, replacing the data of an existing entry with
+ * the same key.
+ */
+struct swiss_table_u32_entry *
+_mesa_swiss_table_u32_insert(struct swiss_table_u32 *ht, uint32_t key,
+                             void *data);
+
+struct swiss_table_u32_entry *
+_mesa_swiss_table_u32_search(struct swiss_table_u32 *ht, uint32_t key);
+
+/** Return the data stored under \p key, or NULL if there is none. */
+static inline void *
+_mesa_swiss_table_u32_search_data(struct swiss_table_u32 *ht, uint32_t key)
+{
+   struct swiss_table_u32_entry *entry = _mesa_swiss_table_u32_search(ht, key);
+   return entry ? entry->data : NULL;
+}
+
+void
+_mesa_swiss_table_u32_remove(struct swiss_table_u32 *ht,
+                             struct swiss_table_u32_entry *entry);
+
+void
+_mesa_swiss_table_u32_remove_key(struct swiss_table_u32 *ht, uint32_t key);
+
+struct swiss_table_u32_entry *
+_mesa_swiss_table_u32_next_entry(struct swiss_table_u32 *ht,
+                                 struct swiss_table_u32_entry *entry);
+
+#define swiss_table_u32_foreach(ht, entry)                                  \
+   for (struct swiss_table_u32_entry *entry =                               \
+           _mesa_swiss_table_u32_next_entry(ht, NULL);                      \
+        entry != NULL;                                                      \
+        entry = _mesa_swiss_table_u32_next_entry(ht, entry))
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* _SWISS_TABLE_H */
@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "util/u_metric_ring.h"
+#include "util/u_thread.h"
+
+namespace {
+
+static const char *const names[] = { "gpu_busy", "eu_active" };
+
+class u_metric_ring_test : public ::testing::Test {
+public:
+   char path[64];
+
+   virtual void SetUp()
+   {
+      snprintf(path, sizeof(path), "/tmp/u_metric_ring_test.%d",
+               (int) getpid());
+   }
+
+   virtual void TearDown()
+   {
+      unlink(path);
+   }
+};
+
+TEST_F(u_metric_ring_test, columns)
+{
+   struct u_metric_ring *writer = u_metric_ring_create(path, 2, names);
+   ASSERT_TRUE(writer != NULL);
+
+   struct u_metric_ring *reader = u_metric_ring_open(path);
+   ASSERT_TRUE(reader != NULL);
+
+   EXPECT_EQ(0, u_metric_ring_find_column(reader, "gpu_busy"));
+   EXPECT_EQ(1, u_metric_ring_find_column(reader, "eu_active"));
+   EXPECT_EQ(-1, u_metric_ring_find_column(reader, "gpu"));
+
+   u_metric_ring_destroy(reader);
+   u_metric_ring_destroy(writer);
+}
+
+TEST_F(u_metric_ring_test, latest)
+{
+   struct u_metric_ring *writer = u_metric_ring_create(path, 2, names);
+   ASSERT_TRUE(writer != NULL);
+   struct u_metric_ring *reader = u_metric_ring_open(path);
+   ASSERT_TRUE(reader != NULL);
+
+   struct u_metric_ring_sample sample;
+   EXPECT_FALSE(u_metric_ring_read_latest(reader, &sample));
+
+   /* Go around the ring a few times, the reader must see the last one. */
+   for (unsigned i = 0; i < 3 * U_METRIC_RING_NUM_SAMPLES + 7; i++) {
+      const double values[] = { (double) i, 2.0 * i };
+      u_metric_ring_push(writer, 1000 * i, values);
+
+      ASSERT_TRUE(u_metric_ring_read_latest(reader, &sample));
+      EXPECT_EQ(1000 * i, sample.time_ns);
+      EXPECT_EQ((double) i, sample.values[0]);
+      EXPECT_EQ(2.0 * i, sample.values[1]);
+   }
+
+   u_metric_ring_destroy(reader);
+   u_metric_ring_destroy(writer);
+}
+
+TEST_F(u_metric_ring_test, replaced)
+{
+   struct u_metric_ring *writer = u_metric_ring_create(path, 2, names);
+   ASSERT_TRUE(writer != NULL);
+   struct u_metric_ring *reader = u_metric_ring_open(path);
+   ASSERT_TRUE(reader != NULL);
+
+   const double values[] = { 1.0, 2.0 };
+   u_metric_ring_push(writer, 1, values);
+   u_metric_ring_destroy(writer);
+
+   /* A new writer doesn't disturb readers of the old ring. */
+   writer = u_metric_ring_create(path, 1, names);
+   ASSERT_TRUE(writer != NULL);
+
+   struct u_metric_ring_sample sample;
+   ASSERT_TRUE(u_metric_ring_read_latest(reader, &sample));
+   EXPECT_EQ(1u, sample.time_ns);
+   u_metric_ring_destroy(reader);
+
+   reader = u_metric_ring_open(path);
+   ASSERT_TRUE(reader != NULL);
+   EXPECT_FALSE(u_metric_ring_read_latest(reader, &sample));
+   EXPECT_EQ(-1, u_metric_ring_find_column(reader, "eu_active"));
+
+   u_metric_ring_destroy(reader);
+   u_metric_ring_destroy(writer);
+}
+
+TEST_F(u_metric_ring_test, missing)
+{
+   EXPECT_TRUE(u_metric_ring_open(path) == NULL);
+}
+
+struct writer_data {
+   struct u_metric_ring *ring;
+   unsigned count;
+};
+
+static int
+writer_thread(void *data)
+{
+   struct writer_data *w = (struct writer_data *) data;
+
+   for (unsigned i = 1; i <= w->count; i++) {
+      const double values[] = { (double) i, (double) i };
+      u_metric_ring_push(w->ring, i, values);
+   }
+
+   return 0;
+}
+
+/* Samples read while the writer is running must never be torn. */
+TEST_F(u_metric_ring_test, concurrent)
+{
+   struct writer_data w;
+   w.ring = u_metric_ring_create(path, 2, names);
+   w.count = 1000000;
+   ASSERT_TRUE(w.ring != NULL);
+   struct u_metric_ring *reader = u_metric_ring_open(path);
+   ASSERT_TRUE(reader != NULL);
+
+   thrd_t thread = u_thread_create(writer_thread, &w);
+
+   uint64_t last = 0;
+   while (last < w.count) {
+      struct u_metric_ring_sample sample;
+      if (!u_metric_ring_read_latest(reader, &sample))
+         continue;
+
+      ASSERT_GE(sample.time_ns, last);
+      ASSERT_EQ((double) sample.time_ns, sample.values[0]);
+      ASSERT_EQ((double) sample.time_ns, sample.values[1]);
+      last = sample.time_ns;
+   }
+
+   thrd_join(thread, NULL);
+
+   u_metric_ring_destroy(reader);
+   u_metric_ring_destroy(w.ring);
+}
+
+} // namespace
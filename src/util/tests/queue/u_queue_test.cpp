@@ -0,0 +1,263 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include "util/u_queue.h"
+
+namespace {
+
+struct job_log {
+   mtx_t lock;
+   cnd_t cond;
+   bool released;
+   unsigned num_executed;
+   int order[16];
+};
+
+struct test_job {
+   struct util_queue_fence fence;
+   struct job_log *log;
+   int id;
+};
+
+void
+log_execute(void *data, int thread_index)
+{
+   struct test_job *job = (struct test_job *) data;
+
+   mtx_lock(&job->log->lock);
+   job->log->order[job->log->num_executed++] = job->id;
+   mtx_unlock(&job->log->lock);
+}
+
+/* Keeps the thread busy until the test releases it. */
+void
+blocking_execute(void *data, int thread_index)
+{
+   struct test_job *job = (struct test_job *) data;
+
+   mtx_lock(&job->log->lock);
+   while (!job->log->released)
+      cnd_wait(&job->log->cond, &job->log->lock);
+   mtx_unlock(&job->log->lock);
+}
+
+class u_queue_test : public ::testing::Test {
+protected:
+   void SetUp()
+   {
+      memset(&log, 0, sizeof(log));
+      mtx_init(&log.lock, mtx_plain);
+      cnd_init(&log.cond);
+
+      ASSERT_TRUE(util_queue_init(&queue, "test", 8, 1,
+                                  UTIL_QUEUE_INIT_RESIZE_IF_FULL));
+
+      blocker.log = &log;
+      blocker.id = -1;
+      util_queue_fence_init(&blocker.fence);
+      util_queue_add_job(&queue, &blocker, &blocker.fence,
+                         blocking_execute, NULL);
+   }
+
+   void TearDown()
+   {
+      util_queue_destroy(&queue);
+      cnd_destroy(&log.cond);
+      mtx_destroy(&log.lock);
+   }
+
+   void add(struct test_job *job, int id, enum util_queue_priority priority)
+   {
+      job->log = &log;
+      job->id = id;
+      util_queue_fence_init(&job->fence);
+      util_queue_add_job_with_priority(&queue, job, &job->fence,
+                                       log_execute, NULL, priority);
+   }
+
+   void release()
+   {
+      mtx_lock(&log.lock);
+      log.released = true;
+      cnd_broadcast(&log.cond);
+      mtx_unlock(&log.lock);
+   }
+
+   struct util_queue queue;
+   struct job_log log;
+   struct test_job blocker;
+};
+
+} /* anonymous namespace */
+
+TEST_F(u_queue_test, high_priority_first)
+{
+   struct test_job jobs[4];
+
+   /* The only thread is busy with the blocker while these are queued. */
+   add(&jobs[0], 0, UTIL_QUEUE_PRIORITY_LOW);
+   add(&jobs[1], 1, UTIL_QUEUE_PRIORITY_HIGH);
+   add(&jobs[2], 2, UTIL_QUEUE_PRIORITY_LOW);
+   add(&jobs[3], 3, UTIL_QUEUE_PRIORITY_HIGH);
+   release();
+
+   util_queue_finish(&queue);
+
+   ASSERT_EQ(log.num_executed, 4u);
+   EXPECT_EQ(log.order[0], 1);
+   EXPECT_EQ(log.order[1], 3);
+   EXPECT_EQ(log.order[2], 0);
+   EXPECT_EQ(log.order[3], 2);
+}
+
+TEST_F(u_queue_test, finish_waits_for_low_priority)
+{
+   struct test_job jobs[12];
+
+   /* More than fit in the initial ring, which has to grow. */
+   for (int i = 0; i < 12; i++)
+      add(&jobs[i], i, UTIL_QUEUE_PRIORITY_LOW);
+   release();
+
+   util_queue_finish(&queue);
+
+   ASSERT_EQ(log.num_executed, 12u);
+   for (int i = 0; i < 12; i++) {
+      EXPECT_TRUE(util_queue_fence_is_signalled(&jobs[i].fence));
+      EXPECT_EQ(log.order[i], i);
+   }
+}
+
+TEST_F(u_queue_test, drop_low_priority_job)
+{
+   struct test_job jobs[2];
+
+   add(&jobs[0], 0, UTIL_QUEUE_PRIORITY_LOW);
+   add(&jobs[1], 1, UTIL_QUEUE_PRIORITY_LOW);
+
+   util_queue_drop_job(&queue, &jobs[0].fence);
+   EXPECT_TRUE(util_queue_fence_is_signalled(&jobs[0].fence));
+   release();
+
+   util_queue_finish(&queue);
+
+   ASSERT_EQ(log.num_executed, 1u);
+   EXPECT_EQ(log.order[0], 1);
+}
+
+namespace {
+
+struct counter_job {
+   struct util_queue_fence fence;
+   unsigned *counter;
+};
+
+void
+count_execute(void *data, int thread_index)
+{
+   struct counter_job *job = (struct counter_job *) data;
+   p_atomic_inc(job->counter);
+}
+
+struct producer {
+   struct util_queue *queue;
+   struct counter_job jobs[1000];
+   unsigned counter;
+};
+
+int
+produce(void *data)
+{
+   struct producer *p = (struct producer *) data;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(p->jobs); i++) {
+      p->jobs[i].counter = &p->counter;
+      util_queue_fence_init(&p->jobs[i].fence);
+      util_queue_add_job(p->queue, &p->jobs[i], &p->jobs[i].fence,
+                         count_execute, NULL);
+   }
+
+   return 0;
+}
+
+} /* anonymous namespace */
+
+TEST(u_queue_lockless, multiple_producers)
+{
+   struct util_queue queue;
+   static struct producer producers[4];
+   thrd_t threads[4];
+
+   /* A small ring so that producers have to wait for space. */
+   ASSERT_TRUE(util_queue_init(&queue, "test", 4, 4,
+                               UTIL_QUEUE_INIT_LOCKLESS));
+
+   for (unsigned i = 0; i < 4; i++) {
+      producers[i].queue = &queue;
+      producers[i].counter = 0;
+      threads[i] = u_thread_create(produce, &producers[i]);
+   }
+
+   for (unsigned i = 0; i < 4; i++)
+      thrd_join(threads[i], NULL);
+
+   util_queue_finish(&queue);
+
+   for (unsigned i = 0; i < 4; i++) {
+      EXPECT_EQ(producers[i].counter, ARRAY_SIZE(producers[i].jobs));
+      for (unsigned j = 0; j < ARRAY_SIZE(producers[i].jobs); j++)
+         EXPECT_TRUE(util_queue_fence_is_signalled(&producers[i].jobs[j].fence));
+   }
+
+   util_queue_destroy(&queue);
+}
+
+TEST(u_queue_lockless, single_producer_in_order)
+{
+   struct util_queue queue;
+   struct job_log log;
+   struct test_job jobs[16];
+
+   memset(&log, 0, sizeof(log));
+   mtx_init(&log.lock, mtx_plain);
+
+   ASSERT_TRUE(util_queue_init(&queue, "test", 2, 1,
+                               UTIL_QUEUE_INIT_SINGLE_PRODUCER));
+
+   for (int i = 0; i < 16; i++) {
+      jobs[i].log = &log;
+      jobs[i].id = i;
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job(&queue, &jobs[i], &jobs[i].fence, log_execute, NULL);
+   }
+
+   util_queue_fence_wait(&jobs[15].fence);
+
+   ASSERT_EQ(log.num_executed, 16u);
+   for (int i = 0; i < 16; i++)
+      EXPECT_EQ(log.order[i], i);
+
+   util_queue_destroy(&queue);
+   mtx_destroy(&log.lock);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Times ra_allocate() on interference graphs made of random live ranges,
+ * the way a large shader looks to a backend, against a register file of
+ * 128 registers with aligned pairs and quads like the one of brw.  The
+ * register pressure is set so that some nodes have to be colored
+ * optimistically, which is where ra_simplify() does the most passes.
+ *
+ * Usage: ra_bench [MAX_NODES [ITERATIONS]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "os_time.h"
+#include "ralloc.h"
+#include "register_allocate.h"
+
+#define NUM_BASE_REGS 128
+
+static struct ra_regs *
+create_reg_set(unsigned classes[3])
+{
+   unsigned num_regs = NUM_BASE_REGS + NUM_BASE_REGS / 2 + NUM_BASE_REGS / 4;
+   struct ra_regs *regs = ra_alloc_reg_set(NULL, num_regs, true);
+   unsigned r = 0;
+
+   for (unsigned c = 0; c < 3; c++) {
+      unsigned size = 1 << c;
+
+      classes[c] = ra_alloc_reg_class(regs);
+      for (unsigned base = 0; base < NUM_BASE_REGS; base += size, r++) {
+         ra_class_add_reg(regs, classes[c], r);
+         for (unsigned i = 0; c > 0 && i < size; i++)
+            ra_add_transitive_reg_conflict(regs, base + i, r);
+      }
+   }
+
+   ra_set_finalize(regs, NULL);
+
+   return regs;
+}
+
+static struct ra_graph *
+create_graph(struct ra_regs *regs, const unsigned classes[3],
+             unsigned num_nodes)
+{
+   struct ra_graph *g = ra_alloc_interference_graph(regs, num_nodes);
+   unsigned *start = malloc(num_nodes * sizeof(*start));
+   unsigned *end = malloc(num_nodes * sizeof(*end));
+
+   for (unsigned n = 0; n < num_nodes; n++) {
+      /* Mostly scalars, like in scalar backends. */
+      unsigned r = rand() % 8;
+      ra_set_node_class(g, n, classes[r < 5 ? 0 : r < 7 ? 1 : 2]);
+      ra_set_node_spill_cost(g, n, 1.0f + rand() % 16);
+
+      start[n] = n;
+      end[n] = n + 1 + rand() % NUM_BASE_REGS;
+   }
+
+   /* The live ranges start in order, so only look ahead as far as the
+    * longest one goes.
+    */
+   for (unsigned n1 = 0; n1 < num_nodes; n1++) {
+      for (unsigned n2 = n1 + 1; n2 < num_nodes && start[n2] < end[n1]; n2++)
+         ra_add_node_interference(g, n1, n2);
+   }
+
+   free(start);
+   free(end);
+
+   return g;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned max_nodes = argc > 1 ? atoi(argv[1]) : 32768;
+   unsigned iterations = argc > 2 ? atoi(argv[2]) : 4;
+   unsigned classes[3];
+   struct ra_regs *regs = create_reg_set(classes);
+
+   printf("%10s %14s %10s\n", "nodes", "ra_allocate", "result");
+
+   for (unsigned num_nodes = 1024; num_nodes <= max_nodes; num_nodes *= 2) {
+      int64_t ns = 0;
+      unsigned allocated = 0;
+
+      srand(num_nodes);
+
+      for (unsigned i = 0; i < iterations; i++) {
+         struct ra_graph *g = create_graph(regs, classes, num_nodes);
+         int64_t t = os_time_get_nano();
+
+         allocated += ra_allocate(g);
+         ns += os_time_get_nano() - t;
+
+         ralloc_free(g);
+      }
+
+      printf("%10u %11.3f ms %4u/%-5u\n", num_nodes,
+             ns / (iterations * 1e6), allocated, iterations);
+   }
+
+   ralloc_free(regs);
+
+   return 0;
+}
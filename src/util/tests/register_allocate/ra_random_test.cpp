@@ -0,0 +1,388 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Checks ra_allocate() against a straightforward implementation of the
+ * Runeson/Nyström allocator on random interference graphs.  Every driver
+ * relies on the order the nodes are pushed in, ties included: it decides
+ * which registers the nodes get, so both have to agree on the register of
+ * every node, on whether the allocation succeeded and, when it didn't, on
+ * the node to spill.
+ */
+
+/* it is a test after all */
+#undef NDEBUG
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <err.h>
+
+#include "ralloc.h"
+#include "register_allocate.h"
+
+namespace {
+
+static const unsigned NO_REG = ~0u;
+
+/* Registers made of 1, 2 and 4 aligned base registers. */
+static const unsigned NUM_CLASSES = 3;
+
+struct reference_node {
+   unsigned cls;
+   unsigned reg;
+   bool in_stack;
+   unsigned q_total;
+   float spill_cost;
+   std::vector<unsigned> adjacency;
+};
+
+/*
+ * The allocator as it was before ra_simplify() learnt to skip words of
+ * nodes: a full scan of the nodes from the last one per pass.
+ */
+struct reference_ra {
+   /* base registers covered by each register */
+   std::vector<uint64_t> masks;
+   std::vector<unsigned> reg_class;
+   unsigned p[NUM_CLASSES];
+   unsigned q[NUM_CLASSES][NUM_CLASSES];
+   bool round_robin;
+
+   std::vector<reference_node> nodes;
+   std::vector<unsigned> stack;
+   unsigned stack_optimistic_start;
+
+   bool conflicts(unsigned r1, unsigned r2) const
+   {
+      return masks[r1] & masks[r2];
+   }
+
+   void finalize()
+   {
+      for (unsigned b = 0; b < NUM_CLASSES; b++) {
+         p[b] = std::count(reg_class.begin(), reg_class.end(), b);
+
+         for (unsigned c = 0; c < NUM_CLASSES; c++) {
+            q[b][c] = 0;
+            for (unsigned rc = 0; rc < masks.size(); rc++) {
+               if (reg_class[rc] != c)
+                  continue;
+
+               unsigned count = 0;
+               for (unsigned rb = 0; rb < masks.size(); rb++) {
+                  if (reg_class[rb] == b && conflicts(rb, rc))
+                     count++;
+               }
+               q[b][c] = std::max(q[b][c], count);
+            }
+         }
+      }
+   }
+
+   void add_interference(unsigned n1, unsigned n2)
+   {
+      if (n1 == n2 ||
+          std::find(nodes[n1].adjacency.begin(), nodes[n1].adjacency.end(),
+                    n2) != nodes[n1].adjacency.end())
+         return;
+
+      nodes[n1].adjacency.push_back(n2);
+      nodes[n1].q_total += q[nodes[n1].cls][nodes[n2].cls];
+      nodes[n2].adjacency.push_back(n1);
+      nodes[n2].q_total += q[nodes[n2].cls][nodes[n1].cls];
+   }
+
+   void push(unsigned n)
+   {
+      for (unsigned n2 : nodes[n].adjacency) {
+         if (!nodes[n2].in_stack) {
+            assert(nodes[n2].q_total >= q[nodes[n2].cls][nodes[n].cls]);
+            nodes[n2].q_total -= q[nodes[n2].cls][nodes[n].cls];
+         }
+      }
+      stack.push_back(n);
+      nodes[n].in_stack = true;
+   }
+
+   void simplify()
+   {
+      bool progress = true;
+
+      stack_optimistic_start = UINT_MAX;
+
+      while (progress) {
+         unsigned best_optimistic_node = ~0u;
+         unsigned lowest_q_total = ~0u;
+
+         progress = false;
+
+         for (int i = nodes.size() - 1; i >= 0; i--) {
+            if (nodes[i].in_stack || nodes[i].reg != NO_REG)
+               continue;
+
+            if (nodes[i].q_total < p[nodes[i].cls]) {
+               push(i);
+               progress = true;
+            } else if (nodes[i].q_total < lowest_q_total) {
+               best_optimistic_node = i;
+               lowest_q_total = nodes[i].q_total;
+            }
+         }
+
+         if (!progress && best_optimistic_node != ~0u) {
+            if (stack_optimistic_start == UINT_MAX)
+               stack_optimistic_start = stack.size();
+
+            push(best_optimistic_node);
+            progress = true;
+         }
+      }
+   }
+
+   bool any_neighbors_conflict(unsigned n, unsigned r) const
+   {
+      for (unsigned n2 : nodes[n].adjacency) {
+         if (!nodes[n2].in_stack && conflicts(r, nodes[n2].reg))
+            return true;
+      }
+      return false;
+   }
+
+   bool select()
+   {
+      unsigned start_search_reg = 0;
+
+      while (!stack.empty()) {
+         unsigned n = stack.back();
+         unsigned r = 0, ri;
+
+         nodes[n].in_stack = false;
+
+         for (ri = 0; ri < masks.size(); ri++) {
+            r = (start_search_reg + ri) % masks.size();
+            if (reg_class[r] == nodes[n].cls && !any_neighbors_conflict(n, r))
+               break;
+         }
+
+         if (ri >= masks.size())
+            return false;
+
+         nodes[n].reg = r;
+         stack.pop_back();
+
+         if (round_robin && stack.size() - 1 <= stack_optimistic_start)
+            start_search_reg = r + 1;
+      }
+
+      return true;
+   }
+
+   int best_spill_node() const
+   {
+      unsigned best_node = -1;
+      float best_benefit = 0.0;
+
+      for (unsigned n = 0; n < nodes.size(); n++) {
+         float cost = nodes[n].spill_cost;
+         float benefit = 0;
+
+         if (cost <= 0.0f || nodes[n].in_stack)
+            continue;
+
+         for (unsigned n2 : nodes[n].adjacency) {
+            benefit += ((float)q[nodes[n].cls][nodes[n2].cls] /
+                        p[nodes[n].cls]);
+         }
+
+         if (benefit / cost > best_benefit) {
+            best_benefit = benefit / cost;
+            best_node = n;
+         }
+      }
+
+      return best_node;
+   }
+};
+
+struct random_test {
+   random_test(uint_fast32_t seed) : rand{seed}
+   {
+   }
+
+   void test(unsigned long count)
+   {
+      while (count-- > 0)
+         test_graph();
+   }
+
+private:
+   void test_graph()
+   {
+      std::uniform_int_distribution<unsigned> base_count_dist(1, 16);
+      std::uniform_int_distribution<unsigned> node_count_dist(1, 300);
+      std::uniform_int_distribution<unsigned> percent(0, 99);
+      std::uniform_real_distribution<float> cost_dist(0.0f, 10.0f);
+
+      const unsigned num_base = base_count_dist(rand) * 4;
+      const unsigned num_nodes = node_count_dist(rand);
+      reference_ra ref;
+
+      ref.round_robin = percent(rand) < 50;
+
+      void *mem_ctx = ralloc_context(NULL);
+      unsigned num_regs = num_base + num_base / 2 + num_base / 4;
+      struct ra_regs *regs = ra_alloc_reg_set(mem_ctx, num_regs, true);
+      unsigned classes[NUM_CLASSES];
+
+      if (ref.round_robin)
+         ra_set_allocate_round_robin(regs);
+
+      for (unsigned c = 0; c < NUM_CLASSES; c++)
+         classes[c] = ra_alloc_reg_class(regs);
+
+      for (unsigned c = 0, r = 0; c < NUM_CLASSES; c++) {
+         const unsigned size = 1 << c;
+
+         for (unsigned base = 0; base < num_base; base += size, r++) {
+            ra_class_add_reg(regs, classes[c], r);
+            for (unsigned i = 0; c > 0 && i < size; i++)
+               ra_add_transitive_reg_conflict(regs, base + i, r);
+
+            ref.masks.push_back(((UINT64_C(1) << size) - 1) << base);
+            ref.reg_class.push_back(c);
+         }
+      }
+
+      ra_set_finalize(regs, NULL);
+      ref.finalize();
+
+      struct ra_graph *g = ra_alloc_interference_graph(regs, num_nodes);
+
+      ref.nodes.resize(num_nodes);
+      for (unsigned n = 0; n < num_nodes; n++) {
+         unsigned c = percent(rand) % NUM_CLASSES;
+
+         ra_set_node_class(g, n, classes[c]);
+         ref.nodes[n].cls = c;
+         ref.nodes[n].reg = NO_REG;
+         ref.nodes[n].in_stack = false;
+         ref.nodes[n].q_total = 0;
+         ref.nodes[n].spill_cost = 0.0f;
+      }
+
+      /* Mostly live ranges with a few random long-distance edges, at a
+       * pressure around the size of the register file so that both the
+       * trivially and the optimistically colored paths get used.
+       */
+      std::uniform_int_distribution<unsigned> start_dist(0, num_nodes * 2);
+      std::uniform_int_distribution<unsigned> length_dist(1, num_base * 2);
+      std::vector<unsigned> start(num_nodes), end(num_nodes);
+
+      for (unsigned n = 0; n < num_nodes; n++) {
+         start[n] = start_dist(rand);
+         end[n] = start[n] + length_dist(rand);
+      }
+
+      for (unsigned n1 = 0; n1 < num_nodes; n1++) {
+         for (unsigned n2 = n1 + 1; n2 < num_nodes; n2++) {
+            bool interfere = start[n1] < end[n2] && start[n2] < end[n1];
+
+            if (!interfere && percent(rand) == 0)
+               interfere = true;
+
+            if (interfere) {
+               ra_add_node_interference(g, n1, n2);
+               ref.add_interference(n1, n2);
+            }
+         }
+      }
+
+      for (unsigned n = 0; n < num_nodes; n++) {
+         if (percent(rand) < 3) {
+            unsigned r = std::find(ref.reg_class.begin(), ref.reg_class.end(),
+                                   ref.nodes[n].cls) - ref.reg_class.begin();
+            r += percent(rand) % ref.p[ref.nodes[n].cls];
+
+            ra_set_node_reg(g, n, r);
+            ref.nodes[n].reg = r;
+         } else if (percent(rand) < 80) {
+            float cost = cost_dist(rand);
+
+            ra_set_node_spill_cost(g, n, cost);
+            ref.nodes[n].spill_cost = cost;
+         }
+      }
+
+      bool allocated = ra_allocate(g);
+
+      ref.simplify();
+      bool ref_allocated = ref.select();
+
+      assert(allocated == ref_allocated);
+      for (unsigned n = 0; n < num_nodes; n++)
+         assert(ra_get_node_reg(g, n) == ref.nodes[n].reg);
+      if (!allocated)
+         assert(ra_get_best_spill_node(g) == ref.best_spill_node());
+
+      ralloc_free(g);
+      ralloc_free(mem_ctx);
+   }
+
+   std::mt19937_64 rand;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   unsigned long seed, count;
+   if (argc == 3) {
+      char *arg_end = NULL;
+      seed = strtoul(argv[1], &arg_end, 0);
+      if (!arg_end || *arg_end || seed == ULONG_MAX)
+         errx(1, "invalid seed \"%s\"", argv[1]);
+
+      arg_end = NULL;
+      count = strtoul(argv[2], &arg_end, 0);
+      if (!arg_end || *arg_end || count == ULONG_MAX)
+         errx(1, "invalid count \"%s\"", argv[2]);
+   } else if (argc == 1) {
+      seed = 8675309;
+      count = 2000;
+   } else {
+      errx(1, "USAGE: %s seed iter_count\n", argv[0]);
+   }
+
+   random_test r{(uint_fast32_t)seed};
+   r.test(count);
+
+   printf("ok\n");
+   return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "swiss_table.h"
+
+/* Every key hashes to the same value, so all of them share one probe
+ * sequence spanning many groups.
+ */
+static uint32_t
+bad_hash(const void *key)
+{
+   (void) key;
+   return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct swiss_table *ht;
+   struct hash_entry *entry;
+   unsigned size = 1000;
+   uint32_t keys[size];
+   uint32_t i;
+
+   (void) argc;
+   (void) argv;
+
+   ht = _mesa_swiss_table_create(NULL, bad_hash, _mesa_key_pointer_equal);
+
+   for (i = 0; i < size; i++) {
+      keys[i] = i;
+      _mesa_swiss_table_insert(ht, keys + i, NULL);
+   }
+
+   for (i = 0; i < size; i++)
+      assert(_mesa_swiss_table_search(ht, keys + i)->key == keys + i);
+
+   /* Drop entries from the start of the probe sequence, the remaining ones
+    * must still be found behind the tombstones.
+    */
+   for (i = 0; i < size / 2; i++)
+      _mesa_swiss_table_remove_key(ht, keys + i);
+
+   for (i = 0; i < size; i++) {
+      entry = _mesa_swiss_table_search(ht, keys + i);
+      assert((entry != NULL) == (i >= size / 2));
+   }
+   assert(ht->entries == size / 2);
+
+   _mesa_swiss_table_clear(ht, NULL);
+   assert(ht->entries == 0);
+   assert(_mesa_swiss_table_next_entry(ht, NULL) == NULL);
+
+   _mesa_swiss_table_destroy(ht, NULL);
+
+   return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Compares the performance of hash_table and swiss_table on a few key
+ * distributions typical for Mesa:
+ *
+ *  - sequential GL object names,
+ *  - sparse random 32-bit keys,
+ *  - pointers to heap allocated objects, as in NIR instruction sets.
+ *
+ * Integer keys are also run through swiss_table_u32.  For each table the
+ * time of inserting all keys, looking every one of them up, looking up as
+ * many absent keys and removing all of them is reported.
+ *
+ * Usage: swiss_table_bench [NUM_KEYS [ITERATIONS]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_table.h"
+#include "os_time.h"
+#include "swiss_table.h"
+
+enum op {
+   OP_INSERT,
+   OP_HIT,
+   OP_MISS,
+   OP_REMOVE,
+   NUM_OPS,
+};
+
+static const char *op_names[NUM_OPS] = {
+   "insert", "hit", "miss", "remove",
+};
+
+/* Like the hash of mesa/main/hash.c, which stores GL names as pointers. */
+static uint32_t
+uint_hash(const void *key)
+{
+   return (uintptr_t) key;
+}
+
+static volatile uintptr_t sink;
+
+static void
+run_hash_table(const uintptr_t *keys, const uintptr_t *misses, unsigned count,
+               uint32_t (*hash)(const void *key), int64_t *ns)
+{
+   struct hash_table *ht =
+      _mesa_hash_table_create(NULL, hash, _mesa_key_pointer_equal);
+   int64_t t = os_time_get_nano();
+   uintptr_t found = 0;
+
+   for (unsigned i = 0; i < count; i++)
+      _mesa_hash_table_insert(ht, (void *) keys[i], NULL);
+   ns[OP_INSERT] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      found += (uintptr_t) _mesa_hash_table_search(ht, (void *) keys[i]);
+   ns[OP_HIT] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      found += (uintptr_t) _mesa_hash_table_search(ht, (void *) misses[i]);
+   ns[OP_MISS] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      _mesa_hash_table_remove_key(ht, (void *) keys[i]);
+   ns[OP_REMOVE] += os_time_get_nano() - t;
+
+   sink = found;
+   _mesa_hash_table_destroy(ht, NULL);
+}
+
+static void
+run_swiss_table(const uintptr_t *keys, const uintptr_t *misses,
+                unsigned count, uint32_t (*hash)(const void *key),
+                int64_t *ns)
+{
+   struct swiss_table *ht =
+      _mesa_swiss_table_create(NULL, hash, _mesa_key_pointer_equal);
+   int64_t t = os_time_get_nano();
+   uintptr_t found = 0;
+
+   for (unsigned i = 0; i < count; i++)
+      _mesa_swiss_table_insert(ht, (void *) keys[i], NULL);
+   ns[OP_INSERT] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      found += (uintptr_t) _mesa_swiss_table_search(ht, (void *) keys[i]);
+   ns[OP_HIT] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      found += (uintptr_t) _mesa_swiss_table_search(ht, (void *) misses[i]);
+   ns[OP_MISS] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      _mesa_swiss_table_remove_key(ht, (void *) keys[i]);
+   ns[OP_REMOVE] += os_time_get_nano() - t;
+
+   sink = found;
+   _mesa_swiss_table_destroy(ht, NULL);
+}
+
+static void
+run_swiss_table_u32(const uintptr_t *keys, const uintptr_t *misses,
+                    unsigned count, uint32_t (*hash)(const void *key),
+                    int64_t *ns)
+{
+   struct swiss_table_u32 *ht = _mesa_swiss_table_u32_create(NULL);
+   int64_t t = os_time_get_nano();
+   uintptr_t found = 0;
+
+   (void) hash;
+
+   for (unsigned i = 0; i < count; i++)
+      _mesa_swiss_table_u32_insert(ht, keys[i], NULL);
+   ns[OP_INSERT] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      found += (uintptr_t) _mesa_swiss_table_u32_search(ht, keys[i]);
+   ns[OP_HIT] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      found += (uintptr_t) _mesa_swiss_table_u32_search(ht, misses[i]);
+   ns[OP_MISS] += os_time_get_nano() - t;
+
+   t = os_time_get_nano();
+   for (unsigned i = 0; i < count; i++)
+      _mesa_swiss_table_u32_remove_key(ht, keys[i]);
+   ns[OP_REMOVE] += os_time_get_nano() - t;
+
+   sink = found;
+   _mesa_swiss_table_u32_destroy(ht, NULL);
+}
+
+typedef void (*run_func)(const uintptr_t *keys, const uintptr_t *misses,
+                         unsigned count, uint32_t (*hash)(const void *key),
+                         int64_t *ns);
+
+static void
+bench(const char *dist, const char *table, run_func run,
+      const uintptr_t *keys, const uintptr_t *misses, unsigned count,
+      unsigned iterations, uint32_t (*hash)(const void *key))
+{
+   int64_t ns[NUM_OPS] = { 0 };
+
+   for (unsigned i = 0; i < iterations; i++)
+      run(keys, misses, count, hash, ns);
+
+   printf("%-10s %-16s", dist, table);
+   for (unsigned i = 0; i < NUM_OPS; i++)
+      printf(" %8.2f", (double) ns[i] / ((double) count * iterations));
+   printf("\n");
+}
+
+/* xorshift, as rand() may only have 15 bits. */
+static uint32_t
+random_u32(uint32_t *state)
+{
+   uint32_t x = *state;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return *state = x;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned count = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+   unsigned iterations = argc > 2 ? strtoul(argv[2], NULL, 0) : 10;
+   uintptr_t *keys = malloc(count * sizeof(*keys));
+   uintptr_t *misses = malloc(count * sizeof(*misses));
+   uint32_t state = 0x12345678;
+
+   if (count == 0 || iterations == 0 || !keys || !misses) {
+      fprintf(stderr, "Usage: %s [NUM_KEYS [ITERATIONS]]\n", argv[0]);
+      return 1;
+   }
+
+   printf("%-10s %-16s", "keys", "table");
+   for (unsigned i = 0; i < NUM_OPS; i++)
+      printf(" %8s", op_names[i]);
+   printf("   (ns per operation)\n");
+
+   /* GL names are handed out sequentially, starting at 1. */
+   for (unsigned i = 0; i < count; i++) {
+      keys[i] = i + 1;
+      misses[i] = count + i + 1;
+   }
+   bench("names", "hash_table", run_hash_table, keys, misses, count,
+         iterations, uint_hash);
+   bench("names", "swiss_table", run_swiss_table, keys, misses, count,
+         iterations, uint_hash);
+   bench("names", "swiss_table_u32", run_swiss_table_u32, keys, misses, count,
+         iterations, uint_hash);
+
+   /* Odd random keys, so that even ones make for misses. */
+   for (unsigned i = 0; i < count; i++) {
+      keys[i] = random_u32(&state) | 1;
+      misses[i] = random_u32(&state) & ~1u;
+   }
+   bench("random", "hash_table", run_hash_table, keys, misses, count,
+         iterations, uint_hash);
+   bench("random", "swiss_table", run_swiss_table, keys, misses, count,
+         iterations, uint_hash);
+   bench("random", "swiss_table_u32", run_swiss_table_u32, keys, misses,
+         count, iterations, uint_hash);
+
+   /* Instruction sized heap objects, looked up in allocation order. */
+   char *objects = malloc(2 * count * 64);
+   if (!objects)
+      return 1;
+   for (unsigned i = 0; i < count; i++) {
+      keys[i] = (uintptr_t) (objects + 2 * i * 64);
+      misses[i] = (uintptr_t) (objects + (2 * i + 1) * 64);
+   }
+   bench("pointers", "hash_table", run_hash_table, keys, misses, count,
+         iterations, _mesa_hash_pointer);
+   bench("pointers", "swiss_table", run_swiss_table, keys, misses, count,
+         iterations, _mesa_hash_pointer);
+
+   free(objects);
+   free(keys);
+   free(misses);
+
+   return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "swiss_table.h"
+
+#define NUM_KEYS 4096
+
+static unsigned destroyed;
+
+static void
+delete_function(struct swiss_table_u32_entry *entry)
+{
+   (void) entry;
+   destroyed++;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct swiss_table_u32 *ht;
+   bool present[NUM_KEYS] = { false };
+   unsigned count = 0;
+   uint32_t i;
+
+   (void) argc;
+   (void) argv;
+
+   ht = _mesa_swiss_table_u32_create(NULL);
+
+   /* Keys 0 and ~0 are ordinary keys. */
+   _mesa_swiss_table_u32_insert(ht, 0, &present[0]);
+   _mesa_swiss_table_u32_insert(ht, UINT32_MAX, &present[1]);
+   assert(_mesa_swiss_table_u32_search_data(ht, 0) == &present[0]);
+   assert(_mesa_swiss_table_u32_search_data(ht, UINT32_MAX) == &present[1]);
+   _mesa_swiss_table_u32_remove_key(ht, 0);
+   _mesa_swiss_table_u32_remove_key(ht, UINT32_MAX);
+   assert(_mesa_swiss_table_u32_num_entries(ht) == 0);
+
+   /* Random inserts and removals checked against a reference. */
+   srand(42);
+   for (i = 0; i < 100000; i++) {
+      uint32_t key = rand() % NUM_KEYS;
+
+      if (rand() % 3) {
+         _mesa_swiss_table_u32_insert(ht, key, &present[key]);
+         count += !present[key];
+         present[key] = true;
+      } else {
+         _mesa_swiss_table_u32_remove_key(ht, key);
+         count -= present[key];
+         present[key] = false;
+      }
+   }
+   assert(_mesa_swiss_table_u32_num_entries(ht) == count);
+
+   for (i = 0; i < NUM_KEYS; i++) {
+      void *data = _mesa_swiss_table_u32_search_data(ht, i);
+      assert(data == (present[i] ? &present[i] : NULL));
+   }
+
+   swiss_table_u32_foreach(ht, entry) {
+      assert(entry->key < NUM_KEYS && present[entry->key]);
+      assert(entry->data == &present[entry->key]);
+   }
+
+   _mesa_swiss_table_u32_destroy(ht, delete_function);
+   assert(destroyed == count);
+
+   return 0;
+}
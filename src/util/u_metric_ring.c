@@ -0,0 +1,257 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_config.h"
+#include "util/u_atomic.h"
+#include "util/u_metric_ring.h"
+
+#ifdef PIPE_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define U_METRIC_RING_MAGIC 0x474e524d /* "MRNG" */
+#define U_METRIC_RING_VERSION 1
+
+#ifdef PIPE_OS_UNIX
+
+static struct u_metric_ring *
+map_ring(int fd, bool writer)
+{
+   struct u_metric_ring *ring = calloc(1, sizeof(*ring));
+   if (!ring)
+      return NULL;
+
+   int prot = writer ? PROT_READ | PROT_WRITE : PROT_READ;
+   void *map = mmap(NULL, sizeof(struct u_metric_ring_header), prot,
+                    MAP_SHARED, fd, 0);
+   if (map == MAP_FAILED) {
+      free(ring);
+      return NULL;
+   }
+
+   ring->header = map;
+   ring->writer = writer;
+   return ring;
+}
+
+/**
+ * Create the ring at \p path, replacing any existing one.
+ *
+ * The new file is renamed over the old one, so readers that still have the
+ * old one mapped don't fault, they just stop seeing new samples.
+ */
+struct u_metric_ring *
+u_metric_ring_create(const char *path, unsigned num_columns,
+                     const char *const *names)
+{
+   assert(num_columns <= U_METRIC_RING_MAX_COLUMNS);
+
+   char tmp_path[4096];
+   if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d",
+                path, (int) getpid()) >= (int) sizeof(tmp_path))
+      return NULL;
+
+   int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (fd < 0)
+      return NULL;
+
+   struct u_metric_ring *ring = NULL;
+   if (ftruncate(fd, sizeof(struct u_metric_ring_header)) == 0)
+      ring = map_ring(fd, true);
+   close(fd);
+
+   if (!ring || rename(tmp_path, path) != 0) {
+      unlink(tmp_path);
+      if (ring)
+         u_metric_ring_destroy(ring);
+      return NULL;
+   }
+
+   struct u_metric_ring_header *header = ring->header;
+   header->version = U_METRIC_RING_VERSION;
+   header->num_columns = num_columns;
+   header->num_samples = U_METRIC_RING_NUM_SAMPLES;
+   for (unsigned i = 0; i < num_columns; i++) {
+      strncpy(header->names[i], names[i], U_METRIC_RING_NAME_SIZE - 1);
+      header->names[i][U_METRIC_RING_NAME_SIZE - 1] = '\0';
+   }
+   header->head = 0;
+
+   /* Readers ignore the ring until they see the magic. */
+   p_atomic_set(&header->magic, U_METRIC_RING_MAGIC);
+
+   return ring;
+}
+
+/**
+ * Open an existing ring for reading.  Returns NULL if there's no ring at
+ * \p path, or it isn't initialized yet.
+ */
+struct u_metric_ring *
+u_metric_ring_open(const char *path)
+{
+   int fd = open(path, O_RDONLY | O_CLOEXEC);
+   if (fd < 0)
+      return NULL;
+
+   struct stat st;
+   struct u_metric_ring *ring = NULL;
+   if (fstat(fd, &st) == 0 &&
+       st.st_size >= (off_t) sizeof(struct u_metric_ring_header))
+      ring = map_ring(fd, false);
+   close(fd);
+
+   if (!ring)
+      return NULL;
+
+   const struct u_metric_ring_header *header = ring->header;
+   if (p_atomic_read(&header->magic) != U_METRIC_RING_MAGIC ||
+       header->version != U_METRIC_RING_VERSION ||
+       header->num_columns > U_METRIC_RING_MAX_COLUMNS ||
+       header->num_samples != U_METRIC_RING_NUM_SAMPLES) {
+      u_metric_ring_destroy(ring);
+      return NULL;
+   }
+
+   return ring;
+}
+
+void
+u_metric_ring_destroy(struct u_metric_ring *ring)
+{
+   munmap(ring->header, sizeof(struct u_metric_ring_header));
+   free(ring);
+}
+
+/**
+ * Append a sample with one value per column.
+ */
+void
+u_metric_ring_push(struct u_metric_ring *ring, uint64_t time_ns,
+                   const double *values)
+{
+   struct u_metric_ring_header *header = ring->header;
+   assert(ring->writer);
+
+   uint64_t head = header->head;
+   struct u_metric_ring_sample *sample =
+      &header->samples[head % U_METRIC_RING_NUM_SAMPLES];
+
+   sample->time_ns = time_ns;
+   memcpy(sample->values, values, header->num_columns * sizeof(double));
+
+   /* Publish the sample. */
+   p_atomic_set(&header->head, head + 1);
+}
+
+/**
+ * Return the index of the column called \p name, or -1.
+ */
+int
+u_metric_ring_find_column(const struct u_metric_ring *ring, const char *name)
+{
+   const struct u_metric_ring_header *header = ring->header;
+
+   for (unsigned i = 0; i < header->num_columns; i++) {
+      if (strncmp(header->names[i], name, U_METRIC_RING_NAME_SIZE) == 0)
+         return i;
+   }
+
+   return -1;
+}
+
+/**
+ * Copy the latest sample.  Returns false if there is none yet.
+ */
+bool
+u_metric_ring_read_latest(const struct u_metric_ring *ring,
+                          struct u_metric_ring_sample *sample)
+{
+   const struct u_metric_ring_header *header = ring->header;
+
+   while (true) {
+      uint64_t head = p_atomic_read(&header->head);
+      if (head == 0)
+         return false;
+
+      uint64_t index = head - 1;
+      memcpy(sample, &header->samples[index % U_METRIC_RING_NUM_SAMPLES],
+             sizeof(*sample));
+
+      /* The writer is at most writing sample head, which is in another slot
+       * than ours unless it went all around the ring in the meantime.
+       */
+      __sync_synchronize();
+      if (p_atomic_read(&header->head) - index < U_METRIC_RING_NUM_SAMPLES)
+         return true;
+   }
+}
+
+#else
+
+struct u_metric_ring *
+u_metric_ring_create(const char *path, unsigned num_columns,
+                     const char *const *names)
+{
+   return NULL;
+}
+
+struct u_metric_ring *
+u_metric_ring_open(const char *path)
+{
+   return NULL;
+}
+
+void
+u_metric_ring_destroy(struct u_metric_ring *ring)
+{
+}
+
+void
+u_metric_ring_push(struct u_metric_ring *ring, uint64_t time_ns,
+                   const double *values)
+{
+}
+
+int
+u_metric_ring_find_column(const struct u_metric_ring *ring, const char *name)
+{
+   return -1;
+}
+
+bool
+u_metric_ring_read_latest(const struct u_metric_ring *ring,
+                          struct u_metric_ring_sample *sample)
+{
+   return false;
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef U_METRIC_RING_H
+#define U_METRIC_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @file u_metric_ring.h
+ *
+ * A ring of samples of named metrics, stored in a file that is shared with
+ * mmap() between one writer and any number of readers, in any process.
+ *
+ * The writer never waits for the readers.  A reader only ever looks at the
+ * latest sample, and retries if the writer overwrote it while it was being
+ * copied.
+ */
+
+#define U_METRIC_RING_MAX_COLUMNS 16
+#define U_METRIC_RING_NAME_SIZE 32
+#define U_METRIC_RING_NUM_SAMPLES 256
+
+struct u_metric_ring_sample {
+   uint64_t time_ns;
+   double values[U_METRIC_RING_MAX_COLUMNS];
+};
+
+/* Layout of the shared file. */
+struct u_metric_ring_header {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_columns;
+   uint32_t num_samples;
+   char names[U_METRIC_RING_MAX_COLUMNS][U_METRIC_RING_NAME_SIZE];
+
+   /* Number of samples written so far, the latest one is at
+    * (head - 1) % num_samples.
+    */
+   uint64_t head;
+
+   struct u_metric_ring_sample samples[U_METRIC_RING_NUM_SAMPLES];
+};
+
+struct u_metric_ring {
+   struct u_metric_ring_header *header;
+   bool writer;
+};
+
+struct u_metric_ring *
+u_metric_ring_create(const char *path, unsigned num_columns,
+                     const char *const *names);
+
+struct u_metric_ring *
+u_metric_ring_open(const char *path);
+
+void
+u_metric_ring_destroy(struct u_metric_ring *ring);
+
+void
+u_metric_ring_push(struct u_metric_ring *ring, uint64_t time_ns,
+                   const double *values);
+
+int
+u_metric_ring_find_column(const struct u_metric_ring *ring, const char *name);
+
+bool
+u_metric_ring_read_latest(const struct u_metric_ring *ring,
+                          struct u_metric_ring_sample *sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_METRIC_RING_H */
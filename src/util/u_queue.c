@@ -29,6 +29,7 @@
 #include <time.h>
 
 #include "util/os_time.h"
+#include "util/u_math.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
 #include "u_process.h"
@@ -233,6 +234,157 @@ struct thread_input {
    int thread_index;
 };
 
+#ifdef HAVE_PTHREAD_SETAFFINITY
+static void
+set_full_thread_affinity(thrd_t thread)
+{
+   cpu_set_t cpuset;
+   CPU_ZERO(&cpuset);
+   for (unsigned i = 0; i < CPU_SETSIZE; i++)
+      CPU_SET(i, &cpuset);
+
+   pthread_setaffinity_np(thread, sizeof(cpuset), &cpuset);
+}
+#endif
+
+/****************************************************************************
+ * Lock-free ring, (a bounded MPMC queue as described by Dmitry Vyukov)
+ */
+
+static bool
+lockless_ring_init(struct util_queue_lockless_ring *ring, unsigned max_jobs)
+{
+   unsigned size = util_next_power_of_two(MAX2(max_jobs, 2));
+
+   ring->cells = (struct util_queue_lockless_cell*)
+                 calloc(size, sizeof(struct util_queue_lockless_cell));
+   if (!ring->cells)
+      return false;
+
+   for (unsigned i = 0; i < size; i++)
+      ring->cells[i].sequence = i;
+
+   ring->mask = size - 1;
+   ring->write_pos = 0;
+   ring->read_pos = 0;
+   return true;
+}
+
+static bool
+lockless_ring_push(struct util_queue_lockless_ring *ring,
+                   const struct util_queue_job *job, bool single_producer)
+{
+   struct util_queue_lockless_cell *cell;
+   unsigned pos = p_atomic_read(&ring->write_pos);
+
+   while (1) {
+      cell = &ring->cells[pos & ring->mask];
+      int diff = (int)(p_atomic_read(&cell->sequence) - pos);
+
+      /* The cell still holds the job from one lap ago. */
+      if (diff < 0)
+         return false;
+
+      if (diff == 0) {
+         if (single_producer) {
+            p_atomic_set(&ring->write_pos, pos + 1);
+            break;
+         }
+
+         unsigned old = p_atomic_cmpxchg(&ring->write_pos, pos, pos + 1);
+         if (old == pos)
+            break;
+         pos = old;
+      } else {
+         /* Another producer claimed this position. */
+         pos = p_atomic_read(&ring->write_pos);
+      }
+   }
+
+   cell->job = *job;
+   p_atomic_set(&cell->sequence, pos + 1);
+   return true;
+}
+
+static bool
+lockless_ring_pop(struct util_queue_lockless_ring *ring,
+                  struct util_queue_job *job)
+{
+   struct util_queue_lockless_cell *cell;
+   unsigned pos = p_atomic_read(&ring->read_pos);
+
+   while (1) {
+      cell = &ring->cells[pos & ring->mask];
+      int diff = (int)(p_atomic_read(&cell->sequence) - (pos + 1));
+
+      /* Nothing has been written at this position yet. */
+      if (diff < 0)
+         return false;
+
+      if (diff == 0) {
+         unsigned old = p_atomic_cmpxchg(&ring->read_pos, pos, pos + 1);
+         if (old == pos)
+            break;
+         pos = old;
+      } else {
+         /* Another consumer took the job at this position. */
+         pos = p_atomic_read(&ring->read_pos);
+      }
+   }
+
+   *job = cell->job;
+   p_atomic_set(&cell->sequence, pos + ring->mask + 1);
+   return true;
+}
+
+static bool
+lockless_ring_is_empty(struct util_queue_lockless_ring *ring)
+{
+   unsigned pos = p_atomic_read(&ring->read_pos);
+   struct util_queue_lockless_cell *cell = &ring->cells[pos & ring->mask];
+
+   return (int)(p_atomic_read(&cell->sequence) - (pos + 1)) < 0;
+}
+
+static bool
+lockless_ring_is_full(struct util_queue_lockless_ring *ring)
+{
+   unsigned pos = p_atomic_read(&ring->write_pos);
+   struct util_queue_lockless_cell *cell = &ring->cells[pos & ring->mask];
+
+   return (int)(p_atomic_read(&cell->sequence) - pos) < 0;
+}
+
+/* Wakes up threads that announced in \num_waiters that they are about to
+ * wait on \cond.
+ *
+ * The waiting side increments the counter before checking the lock-free ring
+ * one last time, and we update the ring before reading the counter. Reading
+ * it with a read-modify-write orders it against that increment, so either
+ * the waiter sees our update or we see the waiter.
+ */
+static void
+wake_lockless_waiters(struct util_queue *queue, int *num_waiters, cnd_t *cond)
+{
+   if (p_atomic_cmpxchg(num_waiters, 0, 0) == 0)
+      return;
+
+   mtx_lock(&queue->lock);
+   cnd_broadcast(cond);
+   mtx_unlock(&queue->lock);
+}
+
+static void
+util_queue_execute_job(struct util_queue_job *job, int thread_index)
+{
+   if (job->job) {
+      job->execute(job->job, thread_index);
+      util_queue_fence_signal(job->fence);
+      if (job->cleanup)
+         job->cleanup(job->job, thread_index);
+   }
+}
+
 static int
 util_queue_thread_func(void *input)
 {
@@ -246,15 +398,17 @@ util_queue_thread_func(void *input)
       /* Don't inherit the thread affinity from the parent thread.
        * Set the full mask.
        */
-      cpu_set_t cpuset;
-      CPU_ZERO(&cpuset);
-      for (unsigned i = 0; i < CPU_SETSIZE; i++)
-         CPU_SET(i, &cpuset);
-
-      pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+      set_full_thread_affinity(pthread_self());
    }
 #endif
 
+   /* This has to come after the above, util_queue_set_L3_affinity() only
+    * pins the threads that already exist when it's called.
+    */
+   int L3_index = p_atomic_read(&queue->L3_index);
+   if (L3_index >= 0)
+      util_pin_thread_to_L3(thrd_current(), L3_index, queue->cores_per_L3);
+
    if (strlen(queue->name) > 0) {
       char name[16];
       util_snprintf(name, sizeof(name), "%s%i", queue->name, thread_index);
@@ -264,12 +418,31 @@ util_queue_thread_func(void *input)
    while (1) {
       struct util_queue_job job;
 
+      /* Lock-free jobs have the highest priority. */
+      if (queue->lockless.cells && lockless_ring_pop(&queue->lockless, &job)) {
+         wake_lockless_waiters(queue, &queue->num_space_waiters,
+                               &queue->has_space_cond);
+         util_queue_execute_job(&job, thread_index);
+         continue;
+      }
+
       mtx_lock(&queue->lock);
-      assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
+      assert(queue->num_queued >= 0);
 
       /* wait if the queue is empty */
-      while (thread_index < queue->num_threads && queue->num_queued == 0)
-         cnd_wait(&queue->has_queued_cond, &queue->lock);
+      while (thread_index < queue->num_threads && queue->num_queued == 0) {
+         if (queue->lockless.cells) {
+            p_atomic_inc(&queue->num_waiting);
+            if (!lockless_ring_is_empty(&queue->lockless)) {
+               p_atomic_dec(&queue->num_waiting);
+               break;
+            }
+            cnd_wait(&queue->has_queued_cond, &queue->lock);
+            p_atomic_dec(&queue->num_waiting);
+         } else {
+            cnd_wait(&queue->has_queued_cond, &queue->lock);
+         }
+      }
 
       /* only kill threads that are above "num_threads" */
       if (thread_index >= queue->num_threads) {
@@ -277,34 +450,56 @@ util_queue_thread_func(void *input)
          break;
       }
 
-      job = queue->jobs[queue->read_idx];
-      memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
-      queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
+      /* Woken up for a lock-free job. */
+      if (queue->num_queued == 0) {
+         mtx_unlock(&queue->lock);
+         continue;
+      }
 
+      /* Take the oldest job of the highest priority. */
+      struct util_queue_ring *ring = queue->rings;
+      while (ring->num_queued == 0)
+         ring++;
+
+      job = ring->jobs[ring->read_idx];
+      memset(&ring->jobs[ring->read_idx], 0, sizeof(struct util_queue_job));
+      ring->read_idx = (ring->read_idx + 1) % ring->max_jobs;
+
+      /* Producers waiting for space may be waiting for any of the rings. */
+      if (ring->num_queued-- == ring->max_jobs)
+         cnd_broadcast(&queue->has_space_cond);
       queue->num_queued--;
-      cnd_signal(&queue->has_space_cond);
       mtx_unlock(&queue->lock);
 
-      if (job.job) {
-         job.execute(job.job, thread_index);
-         util_queue_fence_signal(job.fence);
-         if (job.cleanup)
-            job.cleanup(job.job, thread_index);
-      }
+      util_queue_execute_job(&job, thread_index);
    }
 
    /* signal remaining jobs if all threads are being terminated */
    mtx_lock(&queue->lock);
    if (queue->num_threads == 0) {
-      for (unsigned i = queue->read_idx; i != queue->write_idx;
-           i = (i + 1) % queue->max_jobs) {
-         if (queue->jobs[i].job) {
-            util_queue_fence_signal(queue->jobs[i].fence);
-            queue->jobs[i].job = NULL;
+      for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES; p++) {
+         struct util_queue_ring *ring = &queue->rings[p];
+
+         for (unsigned i = ring->read_idx; i != ring->write_idx;
+              i = (i + 1) % ring->max_jobs) {
+            if (ring->jobs[i].job) {
+               util_queue_fence_signal(ring->jobs[i].fence);
+               ring->jobs[i].job = NULL;
+            }
          }
+         ring->read_idx = ring->write_idx;
+         ring->num_queued = 0;
       }
-      queue->read_idx = queue->write_idx;
       queue->num_queued = 0;
+
+      if (queue->lockless.cells) {
+         struct util_queue_job job;
+
+         while (lockless_ring_pop(&queue->lockless, &job)) {
+            if (job.job)
+               util_queue_fence_signal(job.fence);
+         }
+      }
    }
    mtx_unlock(&queue->lock);
    return 0;
@@ -411,15 +606,29 @@ util_queue_init(struct util_queue *queue,
       util_snprintf(queue->name, sizeof(queue->name), "%s", name);
    }
 
+   if (flags & UTIL_QUEUE_INIT_SINGLE_PRODUCER)
+      flags |= UTIL_QUEUE_INIT_LOCKLESS;
+
    queue->flags = flags;
    queue->max_threads = num_threads;
    queue->num_threads = num_threads;
-   queue->max_jobs = max_jobs;
-
-   queue->jobs = (struct util_queue_job*)
-                 calloc(max_jobs, sizeof(struct util_queue_job));
-   if (!queue->jobs)
-      goto fail;
+   queue->L3_index = -1;
+
+   /* Lock-free rings can't be resized while others may be accessing them. */
+   assert(!(flags & UTIL_QUEUE_INIT_LOCKLESS) ||
+          !(flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL));
+
+   if ((flags & UTIL_QUEUE_INIT_LOCKLESS) &&
+       !lockless_ring_init(&queue->lockless, max_jobs))
+      goto fail_rings;
+
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++) {
+      queue->rings[i].max_jobs = max_jobs;
+      queue->rings[i].jobs = (struct util_queue_job*)
+                             calloc(max_jobs, sizeof(struct util_queue_job));
+      if (!queue->rings[i].jobs)
+         goto fail_rings;
+   }
 
    (void) mtx_init(&queue->lock, mtx_plain);
    (void) mtx_init(&queue->finish_lock, mtx_plain);
@@ -452,12 +661,16 @@ util_queue_init(struct util_queue *queue,
 fail:
    free(queue->threads);
 
-   if (queue->jobs) {
-      cnd_destroy(&queue->has_space_cond);
-      cnd_destroy(&queue->has_queued_cond);
-      mtx_destroy(&queue->lock);
-      free(queue->jobs);
-   }
+   cnd_destroy(&queue->has_space_cond);
+   cnd_destroy(&queue->has_queued_cond);
+   mtx_destroy(&queue->finish_lock);
+   mtx_destroy(&queue->lock);
+
+fail_rings:
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].jobs);
+   free(queue->lockless.cells);
+
    /* also util_queue_is_initialized can be used to check for success */
    memset(queue, 0, sizeof(*queue));
    return false;
@@ -504,19 +717,65 @@ util_queue_destroy(struct util_queue *queue)
    cnd_destroy(&queue->has_queued_cond);
    mtx_destroy(&queue->finish_lock);
    mtx_destroy(&queue->lock);
-   free(queue->jobs);
+   for (unsigned i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].jobs);
+   free(queue->lockless.cells);
    free(queue->threads);
 }
 
+static void
+util_queue_add_job_lockless(struct util_queue *queue,
+                            void *job,
+                            struct util_queue_fence *fence,
+                            util_queue_execute_func execute,
+                            util_queue_execute_func cleanup)
+{
+   const bool single_producer =
+      queue->flags & UTIL_QUEUE_INIT_SINGLE_PRODUCER;
+   const struct util_queue_job entry = {
+      .job = job,
+      .fence = fence,
+      .execute = execute,
+      .cleanup = cleanup,
+   };
+
+   /* Racy, but so is adding jobs while the queue is being destroyed. */
+   if (p_atomic_read(&queue->num_threads) == 0)
+      return;
+
+   util_queue_fence_reset(fence);
+
+   while (!lockless_ring_push(&queue->lockless, &entry, single_producer)) {
+      /* Wait until a thread takes a job, see wake_lockless_waiters(). */
+      mtx_lock(&queue->lock);
+      p_atomic_inc(&queue->num_space_waiters);
+      if (lockless_ring_is_full(&queue->lockless))
+         cnd_wait(&queue->has_space_cond, &queue->lock);
+      p_atomic_dec(&queue->num_space_waiters);
+      mtx_unlock(&queue->lock);
+   }
+
+   wake_lockless_waiters(queue, &queue->num_waiting, &queue->has_queued_cond);
+}
+
 void
-util_queue_add_job(struct util_queue *queue,
-                   void *job,
-                   struct util_queue_fence *fence,
-                   util_queue_execute_func execute,
-                   util_queue_execute_func cleanup)
+util_queue_add_job_with_priority(struct util_queue *queue,
+                                 void *job,
+                                 struct util_queue_fence *fence,
+                                 util_queue_execute_func execute,
+                                 util_queue_execute_func cleanup,
+                                 enum util_queue_priority priority)
 {
+   struct util_queue_ring *ring = &queue->rings[priority];
    struct util_queue_job *ptr;
 
+   assert(priority < UTIL_QUEUE_NUM_PRIORITIES);
+
+   if (queue->lockless.cells && priority == UTIL_QUEUE_PRIORITY_HIGH) {
+      util_queue_add_job_lockless(queue, job, fence, execute, cleanup);
+      return;
+   }
+
    mtx_lock(&queue->lock);
    if (queue->num_threads == 0) {
       mtx_unlock(&queue->lock);
@@ -528,14 +787,14 @@ util_queue_add_job(struct util_queue *queue,
 
    util_queue_fence_reset(fence);
 
-   assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
+   assert(ring->num_queued >= 0 && ring->num_queued <= ring->max_jobs);
 
-   if (queue->num_queued == queue->max_jobs) {
+   if (ring->num_queued == ring->max_jobs) {
       if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) {
          /* If the queue is full, make it larger to avoid waiting for a free
           * slot.
           */
-         unsigned new_max_jobs = queue->max_jobs + 8;
+         unsigned new_max_jobs = ring->max_jobs + 8;
          struct util_queue_job *jobs =
             (struct util_queue_job*)calloc(new_max_jobs,
                                            sizeof(struct util_queue_job));
@@ -543,40 +802,52 @@ util_queue_add_job(struct util_queue *queue,
 
          /* Copy all queued jobs into the new list. */
          unsigned num_jobs = 0;
-         unsigned i = queue->read_idx;
+         unsigned i = ring->read_idx;
 
          do {
-            jobs[num_jobs++] = queue->jobs[i];
-            i = (i + 1) % queue->max_jobs;
-         } while (i != queue->write_idx);
+            jobs[num_jobs++] = ring->jobs[i];
+            i = (i + 1) % ring->max_jobs;
+         } while (i != ring->write_idx);
 
-         assert(num_jobs == queue->num_queued);
+         assert(num_jobs == ring->num_queued);
 
-         free(queue->jobs);
-         queue->jobs = jobs;
-         queue->read_idx = 0;
-         queue->write_idx = num_jobs;
-         queue->max_jobs = new_max_jobs;
+         free(ring->jobs);
+         ring->jobs = jobs;
+         ring->read_idx = 0;
+         ring->write_idx = num_jobs;
+         ring->max_jobs = new_max_jobs;
       } else {
          /* Wait until there is a free slot. */
-         while (queue->num_queued == queue->max_jobs)
+         while (ring->num_queued == ring->max_jobs)
             cnd_wait(&queue->has_space_cond, &queue->lock);
       }
    }
 
-   ptr = &queue->jobs[queue->write_idx];
+   ptr = &ring->jobs[ring->write_idx];
    assert(ptr->job == NULL);
    ptr->job = job;
    ptr->fence = fence;
    ptr->execute = execute;
    ptr->cleanup = cleanup;
-   queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
+   ring->write_idx = (ring->write_idx + 1) % ring->max_jobs;
 
+   ring->num_queued++;
    queue->num_queued++;
    cnd_signal(&queue->has_queued_cond);
    mtx_unlock(&queue->lock);
 }
 
+void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   util_queue_execute_func cleanup)
+{
+   util_queue_add_job_with_priority(queue, job, fence, execute, cleanup,
+                                    UTIL_QUEUE_PRIORITY_HIGH);
+}
+
 /**
  * Remove a queued job. If the job hasn't started execution, it's removed from
  * the queue. If the job has started execution, the function waits for it to
@@ -596,16 +867,20 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
       return;
 
    mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].fence == fence) {
-         if (queue->jobs[i].cleanup)
-            queue->jobs[i].cleanup(queue->jobs[i].job, -1);
-
-         /* Just clear it. The threads will treat as a no-op job. */
-         memset(&queue->jobs[i], 0, sizeof(queue->jobs[i]));
-         removed = true;
-         break;
+   for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES && !removed; p++) {
+      struct util_queue_ring *ring = &queue->rings[p];
+
+      for (unsigned i = ring->read_idx; i != ring->write_idx;
+           i = (i + 1) % ring->max_jobs) {
+         if (ring->jobs[i].fence == fence) {
+            if (ring->jobs[i].cleanup)
+               ring->jobs[i].cleanup(ring->jobs[i].job, -1);
+
+            /* Just clear it. The threads will treat as a no-op job. */
+            memset(&ring->jobs[i], 0, sizeof(ring->jobs[i]));
+            removed = true;
+            break;
+         }
       }
    }
    mtx_unlock(&queue->lock);
@@ -640,9 +915,14 @@ util_queue_finish(struct util_queue *queue)
    fences = malloc(queue->num_threads * sizeof(*fences));
    util_barrier_init(&barrier, queue->num_threads);
 
+   /* Threads only get to the barrier, (which has the lowest priority), once
+    * they have started all jobs that were queued before it.
+    */
    for (unsigned i = 0; i < queue->num_threads; ++i) {
       util_queue_fence_init(&fences[i]);
-      util_queue_add_job(queue, &barrier, &fences[i], util_queue_finish_execute, NULL);
+      util_queue_add_job_with_priority(queue, &barrier, &fences[i],
+                                       util_queue_finish_execute, NULL,
+                                       UTIL_QUEUE_PRIORITY_LOW);
    }
 
    for (unsigned i = 0; i < queue->num_threads; ++i) {
@@ -665,3 +945,23 @@ util_queue_get_thread_time_nano(struct util_queue *queue, unsigned thread_index)
 
    return u_thread_get_time_nano(queue->threads[thread_index]);
 }
+
+void
+util_queue_set_L3_affinity(struct util_queue *queue, int L3_index,
+                           unsigned cores_per_L3)
+{
+   mtx_lock(&queue->finish_lock);
+   queue->cores_per_L3 = cores_per_L3;
+   p_atomic_set(&queue->L3_index, L3_index);
+
+   for (unsigned i = 0; i < queue->num_threads; i++) {
+      if (L3_index >= 0) {
+         util_pin_thread_to_L3(queue->threads[i], L3_index, cores_per_L3);
+      } else {
+#ifdef HAVE_PTHREAD_SETAFFINITY
+         set_full_thread_affinity(queue->threads[i]);
+#endif
+      }
+   }
+   mtx_unlock(&queue->finish_lock);
+}
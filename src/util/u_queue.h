@@ -49,6 +49,15 @@ extern "C" {
 #define UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY      (1 << 0)
 #define UTIL_QUEUE_INIT_RESIZE_IF_FULL            (1 << 1)
 #define UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY  (1 << 2)
+/* Queue high priority jobs without taking the queue lock. This can't be
+ * combined with UTIL_QUEUE_INIT_RESIZE_IF_FULL, and util_queue_drop_job()
+ * waits for such jobs instead of removing them.
+ */
+#define UTIL_QUEUE_INIT_LOCKLESS                  (1 << 3)
+/* Like UTIL_QUEUE_INIT_LOCKLESS, but all jobs are added by the same thread,
+ * which saves an atomic compare-and-swap per job.
+ */
+#define UTIL_QUEUE_INIT_SINGLE_PRODUCER           (1 << 4)
 
 #if defined(__GNUC__) && defined(HAVE_LINUX_FUTEX_H)
 #define UTIL_QUEUE_FENCE_FUTEX
@@ -198,6 +207,40 @@ struct util_queue_job {
    util_queue_execute_func cleanup;
 };
 
+/* Threads only start a job when no job of a higher priority is queued, so
+ * that e.g. a compile a draw call is blocked on doesn't wait behind
+ * speculative or background compiles. Jobs of the same priority are
+ * executed in order.
+ */
+enum util_queue_priority {
+   UTIL_QUEUE_PRIORITY_HIGH,
+   UTIL_QUEUE_PRIORITY_LOW,
+   UTIL_QUEUE_NUM_PRIORITIES,
+};
+
+struct util_queue_ring {
+   int max_jobs;
+   int num_queued;
+   int write_idx, read_idx; /* ring buffer pointers */
+   struct util_queue_job *jobs;
+};
+
+/* Bounded lock-free ring for UTIL_QUEUE_INIT_LOCKLESS queues. The sequence
+ * number of a cell tells whether it can be written, (sequence == position),
+ * or read, (sequence == position + 1), at a given position.
+ */
+struct util_queue_lockless_cell {
+   unsigned sequence;
+   struct util_queue_job job;
+};
+
+struct util_queue_lockless_ring {
+   struct util_queue_lockless_cell *cells;
+   unsigned mask;
+   unsigned write_pos;
+   unsigned read_pos;
+};
+
 /* Put this into your context. */
 struct util_queue {
    char name[14]; /* 13 characters = the thread name without the index */
@@ -207,12 +250,24 @@ struct util_queue {
    cnd_t has_space_cond;
    thrd_t *threads;
    unsigned flags;
-   int num_queued;
+   int num_queued; /* sum of all rings */
    unsigned max_threads;
    unsigned num_threads; /* decreasing this number will terminate threads */
-   int max_jobs;
-   int write_idx, read_idx; /* ring buffer pointers */
-   struct util_queue_job *jobs;
+   struct util_queue_ring rings[UTIL_QUEUE_NUM_PRIORITIES];
+
+   /* Replaces the high priority ring with UTIL_QUEUE_INIT_LOCKLESS. Threads
+    * about to wait on has_queued_cond or has_space_cond announce it in the
+    * counters, so that producers only need the lock when someone waits.
+    */
+   struct util_queue_lockless_ring lockless;
+   int num_waiting;
+   int num_space_waiters;
+
+   /* L3 cache the threads are pinned to, -1 if none. See
+    * util_queue_set_L3_affinity().
+    */
+   int L3_index;
+   unsigned cores_per_L3;
 
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;
@@ -231,6 +286,14 @@ void util_queue_add_job(struct util_queue *queue,
                         struct util_queue_fence *fence,
                         util_queue_execute_func execute,
                         util_queue_execute_func cleanup);
+
+/* Same as util_queue_add_job(), which uses UTIL_QUEUE_PRIORITY_HIGH. */
+void util_queue_add_job_with_priority(struct util_queue *queue,
+                                      void *job,
+                                      struct util_queue_fence *fence,
+                                      util_queue_execute_func execute,
+                                      util_queue_execute_func cleanup,
+                                      enum util_queue_priority priority);
 void util_queue_drop_job(struct util_queue *queue,
                          struct util_queue_fence *fence);
 
@@ -246,6 +309,15 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads);
 int64_t util_queue_get_thread_time_nano(struct util_queue *queue,
                                         unsigned thread_index);
 
+/* Hint that all threads of the queue, (including ones created later), should
+ * run on the CPU cores sharing the given L3 cache, e.g. the one of the thread
+ * feeding the queue. Pass -1 as the L3_index to allow all cores again.
+ * Ignored where thread affinity isn't supported.
+ */
+void
+util_queue_set_L3_affinity(struct util_queue *queue, int L3_index,
+                           unsigned cores_per_L3);
+
 /* util_queue needs to be cleared to zeroes for this to work */
 static inline bool
 util_queue_is_initialized(struct util_queue *queue)
@@ -265,6 +337,8 @@ struct util_queue_monitoring
    unsigned num_offloaded_items;
    unsigned num_direct_items;
    unsigned num_syncs;
+   unsigned num_batches;
+   unsigned num_repins;
 };
 
 #ifdef __cplusplus
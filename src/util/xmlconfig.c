@@ -40,7 +40,10 @@
 #include <dirent.h>
 #include <fnmatch.h>
 #include "xmlconfig.h"
+#include "list.h"
+#include "u_dynarray.h"
 #include "u_process.h"
+#include "simple_mtx.h"
 
 /* For systems like Hurd */
 #ifndef PATH_MAX
@@ -702,6 +705,7 @@ struct OptConfData {
     uint32_t inDevice;
     uint32_t inApp;
     uint32_t inOption;
+    struct util_dynarray *settings;
 };
 
 /** \brief Elements in configuration files. */
@@ -755,6 +759,41 @@ parseAppAttr(struct OptConfData *data, const XML_Char **attr)
         data->ignoringApp = data->inApp;
 }
 
+/** \brief An option setting from a matching section of a config file */
+struct OptConfSetting {
+    char *name;
+    char *value;
+};
+
+static void
+recordSetting(struct util_dynarray *settings, const char *name,
+              const char *value)
+{
+    struct OptConfSetting setting = {
+        .name = ralloc_strdup(settings->mem_ctx, name),
+        .value = ralloc_strdup(settings->mem_ctx, value),
+    };
+    util_dynarray_append(settings, struct OptConfSetting, setting);
+}
+
+/** \brief Set an option of the cache, returns false for an illegal value */
+static bool
+applySetting(driOptionCache *cache, const char *name, const char *value)
+{
+    uint32_t opt = findOption (cache, name);
+    if (cache->info[opt].name == NULL)
+        /* don't use XML_WARNING, drirc defines options for all drivers,
+         * but not all drivers support them */
+        return true;
+    else if (getenv (cache->info[opt].name))
+      /* don't use XML_WARNING, we want the user to see this! */
+        fprintf (stderr, "ATTENTION: option value of option %s ignored.\n",
+                 cache->info[opt].name);
+    else if (!parseValue (&cache->values[opt], cache->info[opt].type, value))
+        return false;
+    return true;
+}
+
 /** \brief Parse attributes of an option element. */
 static void
 parseOptConfAttr(struct OptConfData *data, const XML_Char **attr)
@@ -769,17 +808,9 @@ parseOptConfAttr(struct OptConfData *data, const XML_Char **attr)
     if (!name) XML_WARNING1 ("name attribute missing in option.");
     if (!value) XML_WARNING1 ("value attribute missing in option.");
     if (name && value) {
-        driOptionCache *cache = data->cache;
-        uint32_t opt = findOption (cache, name);
-        if (cache->info[opt].name == NULL)
-            /* don't use XML_WARNING, drirc defines options for all drivers,
-             * but not all drivers support them */
-            return;
-        else if (getenv (cache->info[opt].name))
-          /* don't use XML_WARNING, we want the user to see this! */
-            fprintf (stderr, "ATTENTION: option value of option %s ignored.\n",
-                     cache->info[opt].name);
-        else if (!parseValue (&cache->values[opt], cache->info[opt].type, value))
+        if (data->settings)
+            recordSetting (data->settings, name, value);
+        if (!applySetting (data->cache, name, value))
             XML_WARNING ("illegal option value: %s.", value);
     }
 }
@@ -990,6 +1021,46 @@ parseConfigDir(struct OptConfData *data, const char *dirname)
 #define DATADIR "/usr/share"
 #endif
 
+/**
+ * \brief Settings that the config files apply to one device
+ *
+ * Screens and contexts of a process keep asking for the same device, so
+ * the config files are only parsed the first time and the settings of the
+ * matching sections are replayed afterwards.  This means the config files
+ * are read once per process.
+ */
+struct OptConfDevice {
+    struct list_head link;
+    int screenNum;
+    char *driverName;
+    char *kernelDriverName;
+    struct util_dynarray settings;
+};
+
+static struct list_head parsedDevices = {
+    &parsedDevices, &parsedDevices
+};
+static simple_mtx_t parsedDevicesMutex = _SIMPLE_MTX_INITIALIZER_NP;
+
+static bool
+strEqualOrNull(const char *a, const char *b)
+{
+    return a == b || (a && b && !strcmp (a, b));
+}
+
+static struct OptConfDevice *
+findParsedDevice(int screenNum, const char *driverName,
+                 const char *kernelDriverName)
+{
+    list_for_each_entry(struct OptConfDevice, device, &parsedDevices, link) {
+        if (device->screenNum == screenNum &&
+            strEqualOrNull (device->driverName, driverName) &&
+            strEqualOrNull (device->kernelDriverName, kernelDriverName))
+            return device;
+    }
+    return NULL;
+}
+
 void
 driParseConfigFiles(driOptionCache *cache, const driOptionCache *info,
                     int screenNum, const char *driverName,
@@ -997,14 +1068,36 @@ driParseConfigFiles(driOptionCache *cache, const driOptionCache *info,
 {
     char *home;
     struct OptConfData userData;
+    struct OptConfDevice *device;
 
     initOptionCache (cache, info);
 
+    simple_mtx_lock(&parsedDevicesMutex);
+
+    device = findParsedDevice (screenNum, driverName, kernelDriverName);
+    if (device) {
+        util_dynarray_foreach(&device->settings, struct OptConfSetting,
+                              setting) {
+            if (!applySetting (cache, setting->name, setting->value))
+                __driUtilMessage ("Warning: illegal option value: %s.",
+                                  setting->value);
+        }
+        simple_mtx_unlock(&parsedDevicesMutex);
+        return;
+    }
+
+    device = rzalloc(NULL, struct OptConfDevice);
+    device->screenNum = screenNum;
+    device->driverName = ralloc_strdup(device, driverName);
+    device->kernelDriverName = ralloc_strdup(device, kernelDriverName);
+    util_dynarray_init(&device->settings, device);
+
     userData.cache = cache;
     userData.screenNum = screenNum;
     userData.driverName = driverName;
     userData.kernelDriverName = kernelDriverName;
     userData.execName = util_get_process_name();
+    userData.settings = &device->settings;
 
     parseConfigDir(&userData, DATADIR "/drirc.d");
     parseOneConfigFile(&userData, SYSCONFDIR "/drirc");
@@ -1015,6 +1108,10 @@ driParseConfigFiles(driOptionCache *cache, const driOptionCache *info,
         snprintf(filename, PATH_MAX, "%s/.drirc", home);
         parseOneConfigFile(&userData, filename);
     }
+
+    list_addtail(&device->link, &parsedDevices);
+
+    simple_mtx_unlock(&parsedDevicesMutex);
 }
 
 void
@@ -151,6 +151,11 @@ struct swapchain_data {
    enum overlay_param_enabled stat_selector;
    struct frame_stat stats_min, stats_max;
    struct frame_stat stats[200];
+
+   /* Stats summed over the current fps sampling period, for the output
+    * file.
+    */
+   struct frame_stat accumulated_stats;
 };
 
 static struct hash_table *vk_object_to_data = NULL;
@@ -371,6 +376,44 @@ static void destroy_swapchain_data(struct swapchain_data *data)
    ralloc_free(data);
 }
 
+static bool is_output_stat(const struct overlay_params *params, uint32_t i)
+{
+   return params->enabled[i] &&
+          i != OVERLAY_PARAM_ENABLED_fps &&
+          i != OVERLAY_PARAM_ENABLED_frame_timing &&
+          i != OVERLAY_PARAM_ENABLED_acquire_timing;
+}
+
+static void output_header(const struct overlay_params *params)
+{
+   fprintf(params->output_file, "fps");
+   for (uint32_t i = 0; i < OVERLAY_PARAM_ENABLED_MAX; i++) {
+      if (is_output_stat(params, i))
+         fprintf(params->output_file, ",%s", overlay_param_names[i]);
+   }
+   fprintf(params->output_file, "\n");
+   fflush(params->output_file);
+}
+
+/* Writes one line per fps sampling period: the fps followed by the enabled
+ * stats summed over the period.  Only the counters are gathered, so this is
+ * cheap enough to leave on with no_display.
+ */
+static void output_swapchain_stats(struct swapchain_data *data)
+{
+   const struct overlay_params *params = &data->device->instance->params;
+
+   fprintf(params->output_file, "%.2f", data->fps);
+   for (uint32_t i = 0; i < OVERLAY_PARAM_ENABLED_MAX; i++) {
+      if (is_output_stat(params, i))
+         fprintf(params->output_file, ",%u", data->accumulated_stats.stats[i]);
+   }
+   fprintf(params->output_file, "\n");
+   fflush(params->output_file);
+
+   memset(&data->accumulated_stats, 0, sizeof(data->accumulated_stats));
+}
+
 static void snapshot_swapchain_frame(struct swapchain_data *data)
 {
    struct instance_data *instance_data = data->device->instance;
@@ -387,16 +430,16 @@ static void snapshot_swapchain_frame(struct swapchain_data *data)
          data->fps = 1000000.0f * data->n_frames_since_update / elapsed;
          data->n_frames_since_update = 0;
          data->last_fps_update = now;
-         if (instance_data->params.output_file) {
-            fprintf(instance_data->params.output_file, "%.2f\n", data->fps);
-            fflush(instance_data->params.output_file);
-         }
+         if (instance_data->params.output_file)
+            output_swapchain_stats(data);
       }
    } else {
       data->last_fps_update = now;
    }
 
    struct device_data *device_data = data->device;
+   for (uint32_t i = 0; i < ARRAY_SIZE(device_data->stats.stats); i++)
+      data->accumulated_stats.stats[i] += device_data->stats.stats[i];
    data->stats[data->n_frames % ARRAY_SIZE(data->frame_times)] = device_data->stats;
    memset(&device_data->stats, 0, sizeof(device_data->stats));
 
@@ -1362,6 +1405,9 @@ static void before_present(struct swapchain_data *swapchain_data,
 {
    snapshot_swapchain_frame(swapchain_data);
 
+   if (swapchain_data->device->instance->params.no_display)
+      return;
+
    compute_swapchain_display(swapchain_data);
    render_swapchain_display(swapchain_data, imageIndex);
 }
@@ -1377,7 +1423,8 @@ VKAPI_ATTR VkResult VKAPI_CALL overlay_CreateSwapchainKHR(
    if (result != VK_SUCCESS) return result;
 
    struct swapchain_data *swapchain_data = new_swapchain_data(*pSwapchain, device_data);
-   setup_swapchain_data(swapchain_data, pCreateInfo);
+   if (!device_data->instance->params.no_display)
+      setup_swapchain_data(swapchain_data, pCreateInfo);
    return result;
 }
 
@@ -1388,7 +1435,8 @@ VKAPI_ATTR void VKAPI_CALL overlay_DestroySwapchainKHR(
 {
    struct swapchain_data *swapchain_data = FIND_SWAPCHAIN_DATA(swapchain);
 
-   shutdown_swapchain_data(swapchain_data);
+   if (!swapchain_data->device->instance->params.no_display)
+      shutdown_swapchain_data(swapchain_data);
    swapchain_data->device->vtable.DestroySwapchainKHR(device, swapchain, pAllocator);
    destroy_swapchain_data(swapchain_data);
 }
@@ -1402,9 +1450,11 @@ VKAPI_ATTR VkResult VKAPI_CALL overlay_QueuePresentKHR(
 
    /* If we present on the graphic queue this layer is using to draw an
     * overlay, we don't need more than submitting the overlay draw prior to
-    * present.
+    * present.  Without a display, there is nothing to synchronize with
+    * either.
     */
-   if (queue_data == device_data->graphic_queue) {
+   if (queue_data == device_data->graphic_queue ||
+       device_data->instance->params.no_display) {
       for (uint32_t i = 0; i < pPresentInfo->swapchainCount; i++) {
          struct swapchain_data *swapchain_data = FIND_SWAPCHAIN_DATA(pPresentInfo->pSwapchains[i]);
          before_present(swapchain_data, pPresentInfo->pImageIndices[i]);
@@ -1719,6 +1769,8 @@ VKAPI_ATTR VkResult VKAPI_CALL overlay_CreateInstance(
    instance_data_map_physical_devices(instance_data, true);
 
    parse_overlay_env(&instance_data->params, getenv("VK_LAYER_MESA_OVERLAY_CONFIG"));
+   if (instance_data->params.output_file)
+      output_header(&instance_data->params);
 
    return result;
 }
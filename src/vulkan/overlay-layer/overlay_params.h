@@ -50,6 +50,7 @@ extern "C" {
    OVERLAY_PARAM_BOOL(acquire_timing)                \
    OVERLAY_PARAM_CUSTOM(fps_sampling_period)         \
    OVERLAY_PARAM_CUSTOM(output_file)                 \
+   OVERLAY_PARAM_CUSTOM(no_display)                  \
    OVERLAY_PARAM_CUSTOM(position)                    \
    OVERLAY_PARAM_CUSTOM(help)
 
@@ -74,6 +75,7 @@ struct overlay_params {
    enum overlay_param_position position;
    FILE *output_file;
    uint32_t fps_sampling_period; /* us */
+   bool no_display;
    bool help;
 };
 
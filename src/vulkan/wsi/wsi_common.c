@@ -66,6 +66,7 @@ wsi_device_init(struct wsi_device *wsi,
 
    wsi->maxImageDimension2D = pdp2.properties.limits.maxImageDimension2D;
    wsi->override_present_mode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+   wsi->mailbox_min_image_count = 4;
 
    GetPhysicalDeviceMemoryProperties(pdevice, &wsi->memory_props);
    GetPhysicalDeviceQueueFamilyProperties(pdevice, &wsi->queue_family_count, NULL);
@@ -131,6 +132,15 @@ wsi_device_init(struct wsi_device *wsi,
       }
    }
 
+   const char *mailbox_images = getenv("MESA_VK_WSI_MAILBOX_IMAGES");
+   if (mailbox_images) {
+      int count = atoi(mailbox_images);
+      if (count >= 2)
+         wsi->mailbox_min_image_count = count;
+      else
+         fprintf(stderr, "Invalid MESA_VK_WSI_MAILBOX_IMAGES value!\n");
+   }
+
    if (dri_options) {
       if (driCheckOption(dri_options, "adaptive_sync", DRI_BOOL))
          wsi->enable_adaptive_sync = driQueryOptionb(dri_options,
@@ -105,6 +105,11 @@ struct wsi_device {
    uint32_t maxImageDimension2D;
    VkPresentModeKHR override_present_mode;
 
+   /* Number of images MAILBOX swapchains get at least, so that rendering
+    * doesn't wait for the image on screen or the one queued behind it
+    * (MESA_VK_WSI_MAILBOX_IMAGES). */
+   uint32_t mailbox_min_image_count;
+
    /* Whether to enable adaptive sync for a swapchain if implemented and
     * available. Not all window systems might support this. */
    bool enable_adaptive_sync;
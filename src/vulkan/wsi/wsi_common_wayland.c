@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <string.h>
 #include <pthread.h>
+#include <poll.h>
 
 #include "drm-uapi/drm_fourcc.h"
 
@@ -748,12 +749,66 @@ wsi_wl_swapchain_get_wsi_image(struct wsi_swapchain *wsi_chain,
    return &chain->images[image_index].base;
 }
 
+/**
+ * Wait until events for the queue are read and dispatch them, or until
+ * the absolute timeout expires.  Returns the number of dispatched events,
+ * 0 on timeout and -1 on error.
+ */
+static int
+wsi_wl_dispatch_queue_timeout(struct wl_display *display,
+                              struct wl_event_queue *queue,
+                              uint64_t abs_timeout)
+{
+   while (wl_display_prepare_read_queue(display, queue) != 0) {
+      int ret = wl_display_dispatch_queue_pending(display, queue);
+      if (ret != 0)
+         return ret;
+   }
+
+   if (wl_display_flush(display) < 0 && errno != EAGAIN) {
+      wl_display_cancel_read(display);
+      return -1;
+   }
+
+   int timeout_ms = -1;
+   if (abs_timeout != UINT64_MAX) {
+      uint64_t now = wsi_common_get_current_time();
+      if (abs_timeout <= now) {
+         timeout_ms = 0;
+      } else {
+         /* Round up so we don't spin on sub-millisecond remainders. */
+         timeout_ms = MIN2((abs_timeout - now + 999999) / 1000000, INT32_MAX);
+      }
+   }
+
+   struct pollfd pfd = {
+      .fd = wl_display_get_fd(display),
+      .events = POLLIN,
+   };
+   int ret = poll(&pfd, 1, timeout_ms);
+   if (ret <= 0) {
+      wl_display_cancel_read(display);
+      return ret < 0 && errno != EINTR ? -1 : 0;
+   }
+
+   if (wl_display_read_events(display) < 0)
+      return -1;
+
+   return wl_display_dispatch_queue_pending(display, queue);
+}
+
 static VkResult
 wsi_wl_swapchain_acquire_next_image(struct wsi_swapchain *wsi_chain,
                                     const VkAcquireNextImageInfoKHR *info,
                                     uint32_t *image_index)
 {
    struct wsi_wl_swapchain *chain = (struct wsi_wl_swapchain *)wsi_chain;
+   uint64_t abs_timeout = UINT64_MAX;
+
+   if (info->timeout != UINT64_MAX) {
+      uint64_t now = wsi_common_get_current_time();
+      abs_timeout = now + MIN2(info->timeout, UINT64_MAX - 1 - now);
+   }
 
    int ret = wl_display_dispatch_queue_pending(chain->display->wl_display,
                                                chain->display->queue);
@@ -774,13 +829,20 @@ wsi_wl_swapchain_acquire_next_image(struct wsi_swapchain *wsi_chain,
          }
       }
 
-      /* This time we do a blocking dispatch because we can't go
-       * anywhere until we get an event.
+      if (info->timeout == 0)
+         return VK_NOT_READY;
+
+      /* Wait for the next event rather than a full roundtrip, so that we
+       * return as soon as the compositor releases a buffer.
        */
-      int ret = wl_display_roundtrip_queue(chain->display->wl_display,
-                                           chain->display->queue);
+      ret = wsi_wl_dispatch_queue_timeout(chain->display->wl_display,
+                                          chain->display->queue,
+                                          abs_timeout);
       if (ret < 0)
          return VK_ERROR_OUT_OF_DATE_KHR;
+      if (ret == 0 && abs_timeout != UINT64_MAX &&
+          wsi_common_get_current_time() >= abs_timeout)
+         return VK_TIMEOUT;
    }
 }
 
@@ -54,6 +54,8 @@ struct wsi_x11_connection {
    bool has_dri3_modifiers;
    bool has_present;
    bool is_proprietary_x11;
+   /* the X server renders with another GPU, presents need a prime blit */
+   bool is_different_gpu;
 };
 
 struct wsi_x11 {
@@ -189,6 +191,11 @@ wsi_x11_connection_create(struct wsi_device *wsi_dev,
 #endif
 
    wsi_conn->has_dri3_modifiers = has_dri3_v1_2 && has_present_v1_2;
+
+   /* Opening the DRI3 device costs a round trip and an open(), do it once
+    * rather than for every swapchain (re)creation and surface query. */
+   wsi_conn->is_different_gpu = wsi_conn->has_dri3 &&
+      !wsi_x11_check_dri3_compatible(wsi_dev, conn);
    wsi_conn->is_proprietary_x11 = false;
    if (amd_reply && amd_reply->present)
       wsi_conn->is_proprietary_x11 = true;
@@ -621,7 +628,7 @@ x11_surface_is_local_to_gpu(struct wsi_device *wsi_dev,
    if (!wsi_x11_check_for_dri3(wsi_conn))
       return false;
 
-   if (!wsi_x11_check_dri3_compatible(wsi_dev, conn))
+   if (wsi_conn->is_different_gpu)
       return false;
 
    return true;
@@ -1356,7 +1363,15 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
 
    assert(pCreateInfo->sType == VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR);
 
-   const unsigned num_images = pCreateInfo->minImageCount;
+   const VkPresentModeKHR present_mode =
+      wsi_swapchain_get_present_mode(wsi_device, pCreateInfo);
+
+   /* The application can only ask for a number of images in total, give
+    * MAILBOX enough of them to never block on the X server.
+    */
+   unsigned num_images = pCreateInfo->minImageCount;
+   if (present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
+      num_images = MAX2(num_images, wsi_device->mailbox_min_image_count);
 
    xcb_connection_t *conn = x11_surface_get_connection(icd_surface);
    struct wsi_x11_connection *wsi_conn =
@@ -1388,7 +1403,7 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    chain->base.get_wsi_image = x11_get_wsi_image;
    chain->base.acquire_next_image = x11_acquire_next_image;
    chain->base.queue_present = x11_queue_present;
-   chain->base.present_mode = wsi_swapchain_get_present_mode(wsi_device, pCreateInfo);
+   chain->base.present_mode = present_mode;
    chain->base.image_count = num_images;
    chain->conn = conn;
    chain->window = window;
@@ -1412,7 +1427,7 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    else
       chain->last_present_mode = XCB_PRESENT_COMPLETE_MODE_COPY;
 
-   if (!wsi_x11_check_dri3_compatible(wsi_device, conn))
+   if (wsi_conn->is_different_gpu)
        chain->base.use_prime_blit = true;
 
    chain->event_id = xcb_generate_id(chain->conn);